@@ -0,0 +1,78 @@
+"""Generate cell_profile.h, the compile-time cell parameters of a build with
+-DCELL_PROFILE=<config.json>.
+
+Usage: python3 gen_cell_profile.py <config.json> <output header>
+
+The antenna and stream counts are derived from the simulation keys of the
+config the same way Config does. Agora checks them against the loaded config
+at startup and uses the generic kernels if they differ.
+"""
+import json
+import sys
+
+
+def strip_comments(text):
+  """Remove the // and /* */ comments that Config's JSON parser accepts"""
+  out = []
+  i = 0
+  in_string = False
+  while i < len(text):
+    c = text[i]
+    if in_string:
+      out.append(c)
+      if c == '\\':
+        out.append(text[i + 1])
+        i += 1
+      elif c == '"':
+        in_string = False
+    elif c == '"':
+      in_string = True
+      out.append(c)
+    elif text.startswith('//', i):
+      i = text.find('\n', i)
+      if i < 0:
+        break
+      continue
+    elif text.startswith('/*', i):
+      i = text.index('*/', i) + 2
+      continue
+    else:
+      out.append(c)
+    i += 1
+  return ''.join(out)
+
+
+def main():
+  if len(sys.argv) != 3:
+    sys.exit('Usage: gen_cell_profile.py <config.json> <output header>')
+  with open(sys.argv[1]) as f:
+    conf = json.loads(strip_comments(f.read()))
+
+  channel = conf.get('channel', 'A')
+  ue_channel = conf.get('ue_channel', channel)
+  bs_ant_num = len(channel) * conf.get('bs_radio_num', 8)
+  ue_ant_num = len(ue_channel) * conf.get('ue_radio_num', 8)
+  spatial_streams = conf.get('spatial_streams', ue_ant_num)
+
+  with open(sys.argv[2], 'w') as f:
+    f.write(f'''/**
+ * @file cell_profile.h
+ * @brief Compile-time cell parameters, generated by gen_cell_profile.py from
+ * {sys.argv[1]}
+ */
+#ifndef CELL_PROFILE_H_
+#define CELL_PROFILE_H_
+
+#include <cstddef>
+
+namespace CellProfile {{
+static constexpr size_t kBsAntNum = {bs_ant_num};
+static constexpr size_t kSpatialStreams = {spatial_streams};
+}}  // namespace CellProfile
+
+#endif  // CELL_PROFILE_H_
+''')
+
+
+if __name__ == '__main__':
+  main()
@@ -4,21 +4,56 @@
  */
 #include "channel.h"
 
+#include <cstring>
+#include <random>
 #include <utility>
 
 static constexpr bool kPrintChannelOutput = false;
-static constexpr bool kPrintSNRCheck = false;
 static constexpr double kMeanChannelGain = 0.1f;
+// Above this SNR, no noise is added
+static constexpr double kNoiselessSnrDb = 120.0;
+// Noise streams of the seed used by the channel matrices, the AWGN of each
+// thread uses the streams after them
+static constexpr size_t kChannelStreams = 1;
+
+ChannelThreadState::ChannelThreadState(size_t tid, const Channel& channel)
+    : h_(channel.UeAnt(), channel.BsAnt(), arma::fill::zeros),
+      coherence_interval_(SIZE_MAX),
+      noise_(channel.Seed(), kChannelStreams + tid),
+      fft_handle_(nullptr) {
+  if (channel.Fading() != nullptr) {
+    fading_ = std::make_unique<FadingState>(*channel.Fading());
+    const size_t fft_size = channel.FftSize();
+    const size_t max_ant = std::max(channel.UeAnt(), channel.BsAnt());
+    freq_in_.zeros(fft_size, max_ant);
+    freq_out_.zeros(fft_size, max_ant);
+    DftiCreateDescriptor(&fft_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
+                         fft_size);
+    DftiSetValue(fft_handle_, DFTI_BACKWARD_SCALE, 1.0f / fft_size);
+    DftiCommitDescriptor(fft_handle_);
+  }
+}
+
+ChannelThreadState::~ChannelThreadState() {
+  if (fft_handle_ != nullptr) {
+    DftiFreeDescriptor(&fft_handle_);
+  }
+}
 
 Channel::Channel(const Config* const config, std::string& in_channel_type,
-                 double in_channel_snr)
+                 double in_channel_snr, size_t coherence_frames,
+                 double delay_spread_ns, double doppler_hz)
     : cfg_(config),
+      coherence_frames_(coherence_frames),
+      seed_(std::random_device{}()),
       sim_chan_model_(std::move(in_channel_type)),
       channel_snr_db_(in_channel_snr) {
+  RtAssert(coherence_frames_ > 0, "Channel: coherence_frames must be > 0");
   bs_ant_ = cfg_->BsAntNum();
   ue_ant_ = cfg_->UeAntNum();
   n_samps_ = cfg_->SampsPerSymbol();
 
+  FadingModel::Profile profile;
   if (sim_chan_model_ == "AWGN") {
     chan_model_ = kAwgn;
   } else if (sim_chan_model_ == "RAYLEIGH") {
@@ -27,6 +62,16 @@ Channel::Channel(const Config* const config, std::string& in_channel_type,
     chan_model_ = kRan3Gpp;
     printf("3GPP Model in progress, setting to RAYLEIGH channel \n");
     chan_model_ = kRayleigh;
+  } else if (FadingModel::ParseProfile(sim_chan_model_, profile)) {
+    chan_model_ = kFading;
+    RtAssert(cfg_->OfdmTxZeroPrefix() + cfg_->CpLen() + cfg_->OfdmCaNum() <=
+                     n_samps_ &&
+                 cfg_->CpLen() <= cfg_->OfdmCaNum(),
+             "Channel: the OFDM symbol does not fit in the samples");
+    // The channel advances once per symbol of SampsPerSymbol samples
+    fading_ = std::make_unique<FadingModel>(
+        profile, ue_ant_, bs_ant_, delay_spread_ns, doppler_hz, cfg_->Rate(),
+        cfg_->OfdmCaNum(), n_samps_ / cfg_->Rate(), kMeanChannelGain, seed_);
   } else {
     chan_model_ = kAwgn;
   }
@@ -38,77 +83,115 @@ Channel::Channel(const Config* const config, std::string& in_channel_type,
 
 Channel::~Channel() = default;
 
+void Channel::GenerateChannel(size_t interval, arma::cx_fmat& h) const {
+  switch (chan_model_) {
+    case kAwgn:
+      h.ones();
+      break;
+
+    case kFading:
+      // Applied per subcarrier block by ApplyFading
+      break;
+
+    case kRayleigh:
+    case kRan3Gpp: {
+      // Simple Uncorrelated Rayleigh Channel - Flat fading (single tap).
+      // The generator is counter-based, so each interval seeks directly to
+      // its own values of the channel stream.
+      const size_t groups_per_interval =
+          ((2 * h.n_elem) + NoiseGenerator::kGroupSize - 1) /
+          NoiseGenerator::kGroupSize;
+      NoiseGenerator channel_stream(seed_, 0);
+      channel_stream.Seek(interval * groups_per_interval);
+      channel_stream.Gaussian(reinterpret_cast<float*>(h.memptr()),
+                              2 * h.n_elem,
+                              std::sqrt(kMeanChannelGain / 2.0f));
+    } break;
+  }
+}
+
 void Channel::ApplyChan(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
-                        const bool is_downlink, const bool is_newChan) {
-  arma::cx_fmat fmat_h;
-
-  if (is_newChan) {
-    switch (chan_model_) {
-      case kAwgn: {
-        arma::fmat rmat(ue_ant_, bs_ant_, arma::fill::ones);
-        arma::fmat imat(ue_ant_, bs_ant_, arma::fill::zeros);
-        h_ = arma::cx_fmat(rmat, imat);
-        // H = H / abs(H).max();
-      } break;
-
-      case kRayleigh:
-        // Simple Uncorrelated Rayleigh Channel - Flat fading (single tap)
-        {
-          arma::fmat rmat(ue_ant_, bs_ant_, arma::fill::randn);
-          arma::fmat imat(ue_ant_, bs_ant_, arma::fill::randn);
-          h_ = arma::cx_fmat(rmat, imat);
-          h_ = sqrt(kMeanChannelGain / 2.0f) * h_;
-          // H = H / abs(H).max();
-        }
-        break;
-
-      case kRan3Gpp:
-        Lte3gpp(fmat_src, fmat_dst);
-        break;
+                        const bool is_downlink, size_t frame_id,
+                        size_t symbol_id, ChannelThreadState& state) const {
+  const size_t n_in = is_downlink ? bs_ant_ : ue_ant_;
+  const size_t n_out = is_downlink ? ue_ant_ : bs_ant_;
+  RtAssert((fmat_src.n_rows == n_samps_) && (fmat_src.n_cols == n_in) &&
+               (fmat_dst.n_rows == n_samps_) && (fmat_dst.n_cols == n_out),
+           "Channel: invalid matrix dimensions");
+
+  // Draw the noise into the destination, then add the channel output in the
+  // same GEMM: dst = src * H + noise, or src * H.st() + noise on the downlink
+  arma::cx_float beta(0.0f, 0.0f);
+  if (channel_snr_db_ < kNoiselessSnrDb) {
+    state.noise_.Gaussian(reinterpret_cast<float*>(fmat_dst.memptr()),
+                          2 * fmat_dst.n_elem, noise_samp_std_);
+    beta = arma::cx_float(1.0f, 0.0f);
+  }
+
+  if (chan_model_ == kFading) {
+    if (channel_snr_db_ >= kNoiselessSnrDb) {
+      fmat_dst.zeros();
     }
+    ApplyFading(fmat_src, fmat_dst, is_downlink,
+                (frame_id * cfg_->Frame().NumTotalSyms()) + symbol_id, state);
+    return;
   }
-  if (is_downlink) {
-    fmat_h = fmat_src * h_.st();
-  } else {
-    fmat_h = fmat_src * h_;
+
+  const size_t interval = frame_id / coherence_frames_;
+  if (interval != state.coherence_interval_) {
+    GenerateChannel(interval, state.h_);
+    state.coherence_interval_ = interval;
+    if (kPrintChannelOutput) {
+      Utils::PrintMat(state.h_, "H");
+    }
   }
+  const arma::cx_float alpha(1.0f, 0.0f);
+  cblas_cgemm(CblasColMajor, CblasNoTrans,
+              is_downlink ? CblasTrans : CblasNoTrans, n_samps_, n_out, n_in,
+              &alpha, fmat_src.memptr(), fmat_src.n_rows, state.h_.memptr(),
+              state.h_.n_rows, &beta, fmat_dst.memptr(), fmat_dst.n_rows);
+}
 
-  // Add noise
-  Awgn(fmat_h, fmat_dst);
+void Channel::ApplyFading(const arma::cx_fmat& fmat_src,
+                          arma::cx_fmat& fmat_dst, bool is_downlink,
+                          size_t symbol_index,
+                          ChannelThreadState& state) const {
+  fading_->Update(symbol_index, *state.fading_);
+
+  const size_t fft_size = cfg_->OfdmCaNum();
+  const size_t cp_len = cfg_->CpLen();
+  const size_t start = cfg_->OfdmTxZeroPrefix() + cp_len;
+  for (size_t ant = 0; ant < fmat_src.n_cols; ant++) {
+    std::memcpy(state.freq_in_.colptr(ant), fmat_src.colptr(ant) + start,
+                fft_size * sizeof(arma::cx_float));
+    DftiComputeForward(state.fft_handle_, state.freq_in_.colptr(ant));
+  }
 
-  if (kPrintChannelOutput) {
-    Utils::PrintMat(h_, "H");
+  // All the subcarriers of a block see the same channel matrix
+  const arma::cx_float alpha(1.0f, 0.0f);
+  const arma::cx_float beta(0.0f, 0.0f);
+  for (size_t block = 0; block < fading_->NumBlocks(); block++) {
+    const size_t sc = fading_->BlockStart(block);
+    cblas_cgemm(CblasColMajor, CblasNoTrans,
+                is_downlink ? CblasTrans : CblasNoTrans,
+                fading_->BlockSize(block), fmat_dst.n_cols, fmat_src.n_cols,
+                &alpha, state.freq_in_.memptr() + sc, fft_size,
+                state.fading_->Response(block), ue_ant_, &beta,
+                state.freq_out_.memptr() + sc, fft_size);
   }
-}
 
-void Channel::Awgn(const arma::cx_fmat& src, arma::cx_fmat& dst) const {
-  if (channel_snr_db_ < 120.0f) {
-    const int n_row = src.n_rows;
-    const int n_col = src.n_cols;
-
-    // Generate noise
-    arma::cx_fmat noise(arma::randn<arma::fmat>(n_row, n_col),
-                        arma::randn<arma::fmat>(n_row, n_col));
-    // Supposed to be faster
-    // arma::fmat x(n_row, n_col, arma::fill::arma::randn);
-    // arma::fmat y(n_row, n_col, arma::fill::arma::randn);
-    // arma::cx_fmat noise = arma::cx_fmat(x, y);
-
-    // Add noise to signal
-    noise *= noise_samp_std_;
-    dst = src + noise;
-
-    // Check SNR
-    if (kPrintSNRCheck) {
-      arma::fmat noise_sq = arma::square(abs(noise));
-      arma::frowvec noise_vec = arma::mean(noise_sq, 0);
-      arma::fmat src_sq = arma::square(abs(src));
-      arma::frowvec pwr_vec = arma::mean(src_sq, 0);
-      arma::frowvec snr = 10.0f * arma::log10(pwr_vec / noise_vec);
-      std::cout << "SNR: " << snr;
+  for (size_t ant = 0; ant < fmat_dst.n_cols; ant++) {
+    arma::cx_float* faded = state.freq_out_.colptr(ant);
+    DftiComputeBackward(state.fft_handle_, faded);
+    arma::cx_float* dst = fmat_dst.colptr(ant) + start;
+    for (size_t i = 0; i < fft_size; i++) {
+      dst[i] += faded[i];
+    }
+    // Rebuild the cyclic prefix from the end of the faded symbol
+    arma::cx_float* cp = dst - cp_len;
+    for (size_t i = 0; i < cp_len; i++) {
+      cp[i] += faded[fft_size - cp_len + i];
     }
-  } else {
-    dst = src;
   }
 }
 
@@ -10,30 +10,82 @@
 #include <cmath>
 #include <ctime>
 #include <iomanip>
+#include <memory>
 #include <numeric>
 
 #include "armadillo"
 #include "config.h"
+#include "fading_model.h"
 #include "gettime.h"
 #include "memory_manage.h"
 #include "message.h"
+#include "mkl_dfti.h"
+#include "noise_generator.h"
 #include "signal_handler.h"
 #include "symbols.h"
 #include "utils.h"
 
+class Channel;
+
+/**
+ * @brief Per-thread state of Channel::ApplyChan, so that the worker threads
+ * of the channel simulator share no mutable state
+ */
+class ChannelThreadState {
+ public:
+  ChannelThreadState(size_t tid, const Channel& channel);
+  ~ChannelThreadState();
+
+  // Channel matrix (ue_ant x bs_ant) of coherence_interval_
+  arma::cx_fmat h_;
+  size_t coherence_interval_;
+  // Independent AWGN stream of this thread
+  NoiseGenerator noise_;
+
+  // Fading models only: the fading at the last symbol, and the FFT and
+  // subcarriers (OfdmCaNum x antennas) of the symbol in the frequency domain
+  std::unique_ptr<FadingState> fading_;
+  DFTI_DESCRIPTOR_HANDLE fft_handle_;
+  arma::cx_fmat freq_in_;
+  arma::cx_fmat freq_out_;
+};
+
 class Channel {
  public:
+  /**
+   * @param channel_type AWGN, RAYLEIGH or a fading model: TDL_A, TDL_C,
+   * TDL_D or CDL_A
+   * @param coherence_frames Frames in which the AWGN and RAYLEIGH channels
+   * stay the same
+   * @param delay_spread_ns RMS delay spread of the fading models
+   * @param doppler_hz Maximum Doppler shift of the fading models
+   */
   Channel(const Config* const config, std::string& channel_type,
-          double channel_snr);
+          double channel_snr, size_t coherence_frames = 1,
+          double delay_spread_ns = 100.0, double doppler_hz = 10.0);
   ~Channel();
 
-  // Dimensions of fmat_src: ( bscfg->sampsPerSymbol, uecfg->UE_ANT_NUM )
-  void ApplyChan(const arma::cx_fmat& fmat_src, arma::cx_fmat& mat_dst,
-                 const bool is_downlink, const bool is_newChan);
+  /**
+   * @brief Apply the channel of the frame and add AWGN, without allocating
+   *
+   * Dimensions of fmat_src: (SampsPerSymbol, UeAntNum) on the uplink or
+   * (SampsPerSymbol, BsAntNum) on the downlink, and the other way around for
+   * fmat_dst, which must already have its size
+   *
+   * The fading models are applied to the OFDM symbol in the frequency
+   * domain, as a circular convolution whose cyclic prefix is then rebuilt
+   */
+  void ApplyChan(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
+                 const bool is_downlink, size_t frame_id, size_t symbol_id,
+                 ChannelThreadState& state) const;
 
-  // Additive White Gaussian Noise. Dimensions of src: ( bscfg->sampsPerSymbol,
-  // uecfg->UE_ANT_NUM )
-  void Awgn(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst) const;
+  /// Seed of the channel and noise streams
+  inline unsigned int Seed() const { return seed_; }
+  inline size_t UeAnt() const { return ue_ant_; }
+  inline size_t BsAnt() const { return bs_ant_; }
+  inline size_t FftSize() const { return cfg_->OfdmCaNum(); }
+  /// The fading model, or nullptr if the channel is not a fading model
+  inline const FadingModel* Fading() const { return fading_.get(); }
 
   /*
    * From "Study on 3D-channel model for Elevation Beamforming
@@ -49,19 +101,27 @@ class Channel {
   void Lte3gpp(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst);
 
  private:
+  // The channel matrix of a coherence interval. It only depends on the seed
+  // and the interval, so that every thread computes the same one.
+  void GenerateChannel(size_t interval, arma::cx_fmat& h) const;
+  // Add the faded symbol of fmat_src to fmat_dst
+  void ApplyFading(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
+                   bool is_downlink, size_t symbol_index,
+                   ChannelThreadState& state) const;
+
   const Config* const cfg_;
 
-  Channel* channel_;
   size_t bs_ant_;
   size_t ue_ant_;
   size_t n_samps_;
+  const size_t coherence_frames_;
+  const unsigned int seed_;
 
   std::string sim_chan_model_;
   double channel_snr_db_;
-  double noise_samp_std_;
-  enum ChanModel { kAwgn, kRayleigh, kRan3Gpp } chan_model_;
-
-  arma::cx_fmat h_;
+  float noise_samp_std_;
+  enum ChanModel { kAwgn, kRayleigh, kRan3Gpp, kFading } chan_model_;
+  std::unique_ptr<FadingModel> fading_;
 };
 
 #endif  // CHANNEL_H_
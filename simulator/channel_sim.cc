@@ -8,9 +8,13 @@
 #include <utility>
 
 #include "datatype_conversion.h"
+#if defined(USE_DPDK)
+#include "dpdk_comm.h"
+#endif
 #include "gettime.h"
 #include "logger.h"
 #include "message.h"
+#include "shm_comm.h"
 #include "signal_handler.h"
 
 static std::atomic<bool> running = true;
@@ -64,7 +68,8 @@ class SocketRxBuffer {
 ChannelSim::ChannelSim(const Config* const config, size_t bs_thread_num,
                        size_t user_thread_num, size_t worker_thread_num,
                        size_t in_core_offset, std::string in_chan_type,
-                       double in_chan_snr)
+                       double in_chan_snr, size_t coherence_frames,
+                       double delay_spread_ns, double doppler_hz)
     : cfg_(config),
       bs_thread_num_(bs_thread_num),
       user_thread_num_(user_thread_num),
@@ -74,6 +79,8 @@ ChannelSim::ChannelSim(const Config* const config, size_t bs_thread_num,
       core_offset_(in_core_offset),
       channel_type_(std::move(in_chan_type)),
       channel_snr_(in_chan_snr) {
+  RtAssert(config->FronthaulAggregation() == 1,
+           "ChannelSim: fronthaul_aggregation is not supported");
   // initialize parameters from config
   ::srand(time(nullptr));
   dl_data_plus_bcast_symbols_ =
@@ -104,7 +111,9 @@ ChannelSim::ChannelSim(const Config* const config, size_t bs_thread_num,
   payload_length_ = cfg_->PacketLength() - Packet::kOffsetOfData;
 
   // Initialize channel
-  channel_ = std::make_unique<Channel>(cfg_, channel_type_, channel_snr_);
+  channel_ = std::make_unique<Channel>(cfg_, channel_type_, channel_snr_,
+                                       coherence_frames, delay_spread_ns,
+                                       doppler_hz);
 
   for (size_t i = 0; i < worker_thread_num_; i++) {
     task_ptok_.at(i) =
@@ -131,6 +140,13 @@ ChannelSim::~ChannelSim() {
       join_thread.join();
     }
   }
+#if defined(USE_DPDK)
+  if (cfg_->SimDpdk()) {
+    bs_comm_.clear();
+    ue_comm_.clear();
+    DpdkComm::ClosePorts();
+  }
+#endif
 }
 
 void ChannelSim::ScheduleTask(EventData do_task,
@@ -349,7 +365,8 @@ void* ChannelSim::TaskThread(size_t tid) {
   moodycamel::ConsumerToken ue_consumer_token(task_queue_user_);
 
   ChSimWorkerStorage thread_store(tid, cfg_->UeAntNum(), cfg_->BsAntNum(),
-                                  cfg_->SampsPerSymbol(), cfg_->PacketLength());
+                                  cfg_->SampsPerSymbol(), cfg_->PacketLength(),
+                                  *channel_);
 
   EventData event;
   while (running) {
@@ -435,7 +452,7 @@ void* ChannelSim::RxLoop(ChSimRxStorage* rx_storage) {
 void ChannelSim::DoTx(size_t frame_id, size_t symbol_id, size_t max_ant,
                       size_t ant_per_socket, const arma::cx_float* source_data,
                       SimdAlignByteVector* udp_pkt_buf,
-                      std::vector<std::unique_ptr<UDPComm>>& udp_senders) {
+                      std::vector<std::unique_ptr<PacketComm>>& udp_senders) {
   // The 2 is from complex float -> float
   const size_t convert_length = (2 * cfg_->SampsPerSymbol());
 
@@ -515,18 +532,13 @@ void ChannelSim::DoTxBs(ChSimWorkerStorage* local, size_t tag) {
 
   arma::cx_fmat* fmat_noisy = local->UeOutput();
   const bool is_downlink = false;
-  bool is_new_frame;
-  if (symbol_id == 0) {
-    is_new_frame = true;
-  } else {
-    is_new_frame = false;
-  }
 
   [[maybe_unused]] double start_time;
   if (kEnableChannelTiming) {
     start_time = GetTime::GetTimeUs();
   }
-  channel_->ApplyChan(*fmat_src, *fmat_noisy, is_downlink, is_new_frame);
+  channel_->ApplyChan(*fmat_src, *fmat_noisy, is_downlink, frame_id,
+                      symbol_id, local->ChannelState());
   if (kEnableChannelTiming) {
     const double apply_channel_time =
         (GetTime::GetTimeUs() - start_time) / 1000.0f;
@@ -605,18 +617,13 @@ void ChannelSim::DoTxUser(ChSimWorkerStorage* local, size_t tag) {
   arma::cx_fmat* fmat_noisy = local->BsOutput();
   // Apply Channel
   const bool is_downlink = true;
-  bool is_new_frame;
-  if (symbol_id == 0) {
-    is_new_frame = true;
-  } else {
-    is_new_frame = false;
-  }
 
   [[maybe_unused]] double start_time;
   if (kEnableChannelTiming) {
     start_time = GetTime::GetTimeUs();
   }
-  channel_->ApplyChan(*fmat_src, *fmat_noisy, is_downlink, is_new_frame);
+  channel_->ApplyChan(*fmat_src, *fmat_noisy, is_downlink, frame_id,
+                      symbol_id, local->ChannelState());
   if (kEnableChannelTiming) {
     const double apply_channel_time =
         (GetTime::GetTimeUs() - start_time) / 1000.0f;
@@ -650,19 +657,32 @@ void ChannelSim::DoTxUser(ChSimWorkerStorage* local, size_t tag) {
            "UE TX message enqueue failed!\n");
 }
 
-static std::vector<std::unique_ptr<UDPComm>> CreateCommSockets(
-    const std::string& local_address, int local_port,
-    const std::string& remote_address, int remote_port,
-    size_t interface_count) {
-  std::vector<std::unique_ptr<UDPComm>> comm_sockets;
+// dpdk_port is the port of DpdkComm::InitPorts() of the links with
+// "sim_transport": "dpdk"
+static std::vector<std::unique_ptr<PacketComm>> CreateCommSockets(
+    const Config* cfg, const std::string& local_address, int local_port,
+    const std::string& remote_address, int remote_port, size_t interface_count,
+    size_t dpdk_port) {
+  unused(dpdk_port);
+  std::vector<std::unique_ptr<PacketComm>> comm_sockets;
   const size_t total_sockets = interface_count;
   for (size_t socket_id = 0; socket_id < total_sockets; socket_id++) {
     const size_t local_port_id = local_port + socket_id;
     const size_t remote_port_id = remote_port + socket_id;
-    comm_sockets.emplace_back(std::make_unique<UDPComm>(
-        local_address, local_port_id, kSockBufSize, 0));
     //Create a 1:1 connection
-    comm_sockets.back()->Connect(remote_address, remote_port_id);
+    std::unique_ptr<PacketComm> comm;
+#if defined(USE_DPDK)
+    if (cfg->SimDpdk()) {
+      comm = std::make_unique<DpdkComm>(dpdk_port, local_address,
+                                        local_port_id, remote_address,
+                                        remote_port_id);
+    }
+#endif
+    if (comm == nullptr) {
+      comm = CreateSimComm(cfg, local_address, local_port_id, remote_address,
+                           remote_port_id, kSockBufSize);
+    }
+    comm_sockets.emplace_back(std::move(comm));
     AGORA_LOG_INFO(
         "ChannelSim set up UDP socket server listening to %s:%zu for remote "
         "%s:%zu\n",
@@ -674,7 +694,7 @@ static std::vector<std::unique_ptr<UDPComm>> CreateCommSockets(
 
 size_t ChannelSim::AddRxThreads(
     size_t desired_threads, size_t total_interfaces,
-    std::vector<std::unique_ptr<UDPComm>>& comm, ChSimRxBuffer* rx_buffer,
+    std::vector<std::unique_ptr<PacketComm>>& comm, ChSimRxBuffer* rx_buffer,
     std::vector<std::pair<std::thread, std::unique_ptr<ChSimRxStorage>>>&
         rx_threads_out) {
   size_t interfaces_per_thread = total_interfaces / desired_threads;
@@ -712,17 +732,30 @@ ChannelSim::CreateRxThreads() {
   std::vector<std::pair<std::thread, std::unique_ptr<ChSimRxStorage>>>
       rx_threads;
 
+  // With DPDK, the links to the BS are on the first port, and the links to
+  // the users on the second one if there is one
+  const size_t ue_dpdk_port = (cfg_->DpdkNumPorts() > 1) ? 1 : 0;
+#if defined(USE_DPDK)
+  if (cfg_->SimDpdk()) {
+    std::vector<size_t> link_counts(ue_dpdk_port + 1, 0);
+    link_counts.front() += cfg_->BsAntNum();
+    link_counts.back() += cfg_->UeAntNum();
+    DpdkComm::InitPorts(cfg_, core_offset_,
+                        bs_thread_num_ + user_thread_num_, link_counts);
+  }
+#endif
+
   //Create communication sockets (Rx + Tx)
-  bs_comm_ = CreateCommSockets(cfg_->BsRruAddr(), cfg_->BsRruPort(),
+  bs_comm_ = CreateCommSockets(cfg_, cfg_->BsRruAddr(), cfg_->BsRruPort(),
                                cfg_->BsServerAddr(), cfg_->BsServerPort(),
-                               cfg_->BsAntNum());
+                               cfg_->BsAntNum(), 0);
 
   size_t thread_count = AddRxThreads(bs_thread_num_, cfg_->BsAntNum(), bs_comm_,
                                      rx_buffer_bs_.get(), rx_threads);
 
-  ue_comm_ = CreateCommSockets(cfg_->UeRruAddr(), cfg_->UeRruPort(),
+  ue_comm_ = CreateCommSockets(cfg_, cfg_->UeRruAddr(), cfg_->UeRruPort(),
                                cfg_->UeServerAddr(), cfg_->UeServerPort(),
-                               cfg_->UeAntNum());
+                               cfg_->UeAntNum(), ue_dpdk_port);
 
   thread_count += AddRxThreads(user_thread_num_, cfg_->UeAntNum(), ue_comm_,
                                rx_buffer_ue_.get(), rx_threads);
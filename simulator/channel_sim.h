@@ -16,8 +16,8 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "message.h"
+#include "packet_comm.h"
 #include "time_frame_counters.h"
-#include "udp_comm.h"
 
 /**
  * @brief Simualtor for many-antenna MU-MIMO channel to work with
@@ -32,7 +32,8 @@ class ChannelSim {
              size_t user_thread_num, size_t worker_thread_num,
              size_t in_core_offset = 30,
              std::string in_chan_type = std::string("RAYLEIGH"),
-             double in_chan_snr = 20);
+             double in_chan_snr = 20, size_t coherence_frames = 1,
+             double delay_spread_ns = 100.0, double doppler_hz = 10.0);
   ~ChannelSim();
 
   void Run();
@@ -60,20 +61,20 @@ class ChannelSim {
   void DoTx(size_t frame_id, size_t symbol_id, size_t max_ant,
             size_t ant_per_socket, const arma::cx_float* source_data,
             SimdAlignByteVector* udp_pkt_buf,
-            std::vector<std::unique_ptr<UDPComm>>& udp_senders);
+            std::vector<std::unique_ptr<PacketComm>>& udp_senders);
 
   std::vector<std::pair<std::thread, std::unique_ptr<ChSimRxStorage>>>
   CreateRxThreads();
   size_t AddRxThreads(
       size_t desired_threads, size_t total_interfaces,
-      std::vector<std::unique_ptr<UDPComm>>& comm, ChSimRxBuffer* rx_buffer,
+      std::vector<std::unique_ptr<PacketComm>>& comm, ChSimRxBuffer* rx_buffer,
       std::vector<std::pair<std::thread, std::unique_ptr<ChSimRxStorage>>>&
           rx_threads_out);
 
   // BS-facing sockets
-  std::vector<std::unique_ptr<UDPComm>> bs_comm_;
+  std::vector<std::unique_ptr<PacketComm>> bs_comm_;
   // UE-facing sockets
-  std::vector<std::unique_ptr<UDPComm>> ue_comm_;
+  std::vector<std::unique_ptr<PacketComm>> ue_comm_;
 
   const Config* const cfg_;
   std::unique_ptr<Channel> channel_;
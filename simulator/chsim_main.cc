@@ -21,8 +21,15 @@ DEFINE_string(
     conf_file,
     TOSTRING(PROJECT_DIRECTORY) "/files/config/ci/tddconfig-sim-both.json",
     "Config filename");
-DEFINE_string(chan_model, "RAYLEIGH", "Simulator Channel Type: RAYLEIGH/AWGN");
+DEFINE_string(chan_model, "RAYLEIGH",
+              "Simulator Channel Type: RAYLEIGH/AWGN/TDL_A/TDL_C/TDL_D/CDL_A");
 DEFINE_double(chan_snr, 20.0, "Signal-to-Noise Ratio");
+DEFINE_uint64(chan_coherence_frames, 1,
+              "Number of frames in which the channel stays the same");
+DEFINE_double(chan_delay_spread_ns, 100.0,
+              "RMS delay spread of the TDL and CDL channels in ns");
+DEFINE_double(chan_doppler_hz, 10.0,
+              "Maximum Doppler shift of the TDL and CDL channels in Hz");
 
 int main(int argc, char* argv[]) {
   int ret = EXIT_FAILURE;
@@ -40,7 +47,8 @@ int main(int argc, char* argv[]) {
       auto sim = std::make_unique<ChannelSim>(
           config.get(), FLAGS_bs_threads, FLAGS_ue_threads,
           FLAGS_worker_threads, FLAGS_core_offset, FLAGS_chan_model,
-          FLAGS_chan_snr);
+          FLAGS_chan_snr, FLAGS_chan_coherence_frames,
+          FLAGS_chan_delay_spread_ns, FLAGS_chan_doppler_hz);
       sim->Run();
       ret = EXIT_SUCCESS;
     } catch (SignalException& e) {
@@ -9,18 +9,22 @@
 #include <memory>
 
 #include "armadillo"
+#include "channel.h"
 #include "concurrentqueue.h"
 #include "logger.h"
 #include "memory_manage.h"
 #include "message.h"
+#include "packet_comm.h"
 #include "simd_types.h"
-#include "udp_comm.h"
 
 class ChSimWorkerStorage {
  public:
   ChSimWorkerStorage(size_t tid, size_t ue_ant_count, size_t bs_ant_count,
-                     size_t samples_per_symbol, size_t udp_packet_size)
-      : tid_(tid), udp_tx_buffer_(udp_packet_size) {
+                     size_t samples_per_symbol, size_t udp_packet_size,
+                     const Channel& channel)
+      : tid_(tid),
+        udp_tx_buffer_(udp_packet_size),
+        channel_state_(tid, channel) {
     //UE
     const size_t ue_input_storage_size =
         (ue_ant_count * samples_per_symbol * sizeof(arma::cx_float));
@@ -98,6 +102,7 @@ class ChSimWorkerStorage {
 
   inline arma::cx_fmat* BsInput() { return bs_input_matrix_.get(); }
   inline arma::cx_fmat* BsOutput() { return bs_output_matrix_.get(); }
+  inline ChannelThreadState& ChannelState() { return channel_state_; }
 
  private:
   size_t tid_;
@@ -110,6 +115,8 @@ class ChSimWorkerStorage {
   std::unique_ptr<arma::cx_fmat> bs_output_matrix_;
 
   SimdAlignByteVector udp_tx_buffer_;
+  // Channel of the current coherence interval or fading, and noise stream
+  ChannelThreadState channel_state_;
 };
 
 class ChSimRxBuffer {
@@ -172,7 +179,7 @@ class ChSimRxStorage {
  public:
   ChSimRxStorage(size_t tid, size_t core_id, size_t rx_packet_size,
                  size_t socket_offset, size_t socket_number,
-                 std::vector<std::unique_ptr<UDPComm>>* udp_comm,
+                 std::vector<std::unique_ptr<PacketComm>>* udp_comm,
                  ChSimRxBuffer* rx_output_storage,
                  moodycamel::ConcurrentQueue<EventData>* response_queue)
       : tid_(tid),
@@ -189,7 +196,7 @@ class ChSimRxStorage {
   inline size_t PacketLength() const { return rx_packet_size_; }
   inline size_t SocketOffset() const { return socket_offset_; }
   inline size_t SocketNumber() const { return socket_number_; }
-  inline UDPComm* Socket(size_t id) { return comm_->at(id).get(); }
+  inline PacketComm* Socket(size_t id) { return comm_->at(id).get(); }
   inline void TransferRxData(size_t frame, size_t symbol, size_t ant,
                              const short* input, size_t data_size) {
     return rx_output_->Copy(frame, symbol, ant, input, data_size);
@@ -205,7 +212,7 @@ class ChSimRxStorage {
   size_t socket_offset_;
   size_t socket_number_;
 
-  std::vector<std::unique_ptr<UDPComm>>* const comm_;
+  std::vector<std::unique_ptr<PacketComm>>* const comm_;
   ChSimRxBuffer* const rx_output_;
   moodycamel::ConcurrentQueue<EventData>* const response_queue_;
 };
@@ -0,0 +1,391 @@
+/**
+ * @file fading_model.cc
+ * @brief Implementation file for the FadingModel class
+ */
+#include "fading_model.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "logger.h"
+#include "utils.h"
+
+namespace {
+constexpr double kPi = M_PI;
+// Sinusoids of the Rayleigh process of a TDL tap
+constexpr size_t kTdlSinusoids = 16;
+// Subcarriers of a block stay within 0.9 correlation of its center, up to
+// 1 / (50 x rms delay spread) apart
+constexpr double kCoherenceBandwidthFactor = 50.0;
+// Spread of the CDL departure directions of the UE antennas around the BS
+constexpr double kCdlSectorDeg = 120.0;
+
+// TR 38.901 Table 7.7.2-1, TDL-A: normalized delay, power (dB)
+constexpr std::array<std::array<double, 2>, 23> kTdlA = {{
+    {0.0000, -13.4}, {0.3819, 0.0},   {0.4025, -2.2},  {0.5868, -4.0},
+    {0.4610, -6.0},  {0.5375, -8.2},  {0.6708, -9.9},  {0.5750, -10.5},
+    {0.7618, -7.5},  {1.5375, -15.9}, {1.8978, -6.6},  {2.2242, -16.7},
+    {2.1718, -12.4}, {2.4942, -15.2}, {2.5119, -10.8}, {3.0582, -11.3},
+    {4.0810, -12.7}, {4.4579, -16.2}, {4.5695, -18.3}, {4.7966, -18.9},
+    {5.0066, -16.6}, {5.3043, -19.9}, {9.6586, -29.7},
+}};
+
+// TR 38.901 Table 7.7.2-3, TDL-C
+constexpr std::array<std::array<double, 2>, 24> kTdlC = {{
+    {0.0000, -4.4},  {0.2099, -1.2},  {0.2219, -3.5},  {0.2329, -5.2},
+    {0.2176, -2.5},  {0.6366, 0.0},   {0.6448, -2.2},  {0.6560, -3.9},
+    {0.6584, -7.4},  {0.7935, -7.1},  {0.8213, -10.7}, {0.9336, -11.1},
+    {1.2285, -5.1},  {1.3083, -6.8},  {2.1704, -8.7},  {2.7105, -13.2},
+    {4.2589, -13.9}, {4.6003, -13.9}, {5.4902, -15.8}, {5.6077, -17.1},
+    {6.3065, -16.0}, {6.6374, -15.7}, {7.0427, -21.6}, {8.6523, -22.8},
+}};
+
+// TR 38.901 Table 7.7.2-4, TDL-D. The first tap is the LOS path.
+constexpr std::array<std::array<double, 2>, 14> kTdlD = {{
+    {0.0, -0.2},
+    {0.0, -13.5},
+    {0.035, -18.8},
+    {0.612, -21.0},
+    {1.363, -22.8},
+    {1.405, -17.9},
+    {1.804, -20.1},
+    {2.596, -21.9},
+    {1.775, -22.9},
+    {4.042, -27.8},
+    {7.937, -23.6},
+    {9.424, -24.8},
+    {9.708, -30.0},
+    {12.525, -27.7},
+}};
+
+// TR 38.901 Table 7.7.1-1, CDL-A: AOD, AOA, ZOD, ZOA (deg) of the clusters,
+// whose delays and powers are the ones of TDL-A
+constexpr std::array<std::array<double, 4>, 23> kCdlAAngles = {{
+    {-178.1, 51.3, 50.2, 125.4}, {-4.2, -152.7, 93.2, 91.3},
+    {-4.2, -152.7, 93.2, 91.3},  {-4.2, -152.7, 93.2, 91.3},
+    {90.2, 76.6, 122.0, 94.0},   {90.2, 76.6, 122.0, 94.0},
+    {90.2, 76.6, 122.0, 94.0},   {121.5, -1.8, 150.2, 47.1},
+    {-81.7, -41.9, 55.2, 56.0},  {158.4, 94.2, 26.4, 30.1},
+    {-83.0, 51.9, 126.4, 58.8},  {134.8, -115.9, 171.6, 26.0},
+    {-153.0, 26.6, 151.4, 49.2}, {-172.0, 76.6, 157.2, 143.1},
+    {-129.9, -7.0, 47.2, 117.4}, {-136.0, -23.0, 40.4, 122.7},
+    {165.4, -47.2, 43.3, 123.2}, {148.4, 110.4, 161.8, 32.6},
+    {132.7, 144.5, 10.8, 27.2},  {-118.6, 155.3, 16.7, 15.2},
+    {-154.1, 102.0, 171.7, 146.0}, {126.5, -151.8, 22.7, 150.7},
+    {-56.2, 55.2, 144.9, 156.1},
+}};
+// Cluster ASD, ASA, ZSD, ZSA (deg) of CDL-A
+constexpr std::array<double, 4> kCdlASpreads = {5.0, 11.0, 3.0, 3.0};
+
+// TR 38.901 Table 7.5-3, ray offset angles within a cluster
+constexpr std::array<double, 20> kRayOffsets = {
+    0.0447,  -0.0447, 0.1413,  -0.1413, 0.2492,  -0.2492, 0.3715,
+    -0.3715, 0.5129,  -0.5129, 0.6797,  -0.6797, 0.8844,  -0.8844,
+    1.1481,  -1.1481, 1.5195,  -1.5195, 2.1551,  -2.1551};
+
+constexpr double DegToRad(double deg) { return deg * kPi / 180.0; }
+
+template <size_t kTaps>
+void SplitTable(const std::array<std::array<double, 2>, kTaps>& table,
+                std::vector<double>& delays, std::vector<double>& powers_db) {
+  for (const auto& tap : table) {
+    delays.push_back(tap.at(0));
+    powers_db.push_back(tap.at(1));
+  }
+}
+
+// Linear powers of the taps, scaled to a total of mean_gain
+std::vector<double> TapPowers(const std::vector<double>& powers_db,
+                              float mean_gain) {
+  std::vector<double> powers;
+  for (const double power_db : powers_db) {
+    powers.push_back(std::pow(10.0, power_db / 10.0));
+  }
+  const double total = std::accumulate(powers.begin(), powers.end(), 0.0);
+  for (double& power : powers) {
+    power *= mean_gain / total;
+  }
+  return powers;
+}
+}  // namespace
+
+FadingState::FadingState(const FadingModel& model)
+    : ue_ant_(model.UeAnt()),
+      bs_ant_(model.BsAnt()),
+      symbol_index_(SIZE_MAX),
+      phasors_(model.NumRays()),
+      taps_(model.NumTaps() * model.UeAnt() * model.BsAnt()),
+      response_(model.NumBlocks() * model.UeAnt() * model.BsAnt()) {}
+
+bool FadingModel::ParseProfile(const std::string& name, Profile& profile) {
+  if (name == "TDL_A") {
+    profile = Profile::kTdlA;
+  } else if (name == "TDL_C") {
+    profile = Profile::kTdlC;
+  } else if (name == "TDL_D") {
+    profile = Profile::kTdlD;
+  } else if (name == "CDL_A") {
+    profile = Profile::kCdlA;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FadingModel::FadingModel(Profile profile, size_t ue_ant, size_t bs_ant,
+                         double delay_spread_ns, double doppler_hz,
+                         double sample_rate, size_t fft_size,
+                         double symbol_duration_s, float mean_gain,
+                         uint64_t seed)
+    : ue_ant_(ue_ant),
+      bs_ant_(bs_ant),
+      doppler_hz_(doppler_hz),
+      symbol_duration_s_(symbol_duration_s),
+      mean_gain_(mean_gain),
+      rays_per_pair_(0),
+      rays_per_tap_(0) {
+  RtAssert(delay_spread_ns >= 0.0 && doppler_hz >= 0.0,
+           "FadingModel: delay spread and Doppler must not be negative");
+  RtAssert(fft_size > 1 && sample_rate > 0.0,
+           "FadingModel: invalid FFT size or sample rate");
+
+  std::vector<double> delays;
+  std::vector<double> powers_db;
+  switch (profile) {
+    case Profile::kTdlA:
+      SplitTable(kTdlA, delays, powers_db);
+      InitTdl(delays, powers_db, false, seed);
+      break;
+    case Profile::kTdlC:
+      SplitTable(kTdlC, delays, powers_db);
+      InitTdl(delays, powers_db, false, seed);
+      break;
+    case Profile::kTdlD:
+      SplitTable(kTdlD, delays, powers_db);
+      InitTdl(delays, powers_db, true, seed);
+      break;
+    case Profile::kCdlA:
+      InitCdl(seed);
+      break;
+  }
+
+  // The rays are drawn from normalized delays, scaled to the delay spread
+  const double delay_spread_s = delay_spread_ns * 1e-9;
+  for (double& delay : tap_delays_s_) {
+    delay *= delay_spread_s;
+  }
+  ray_step_.resize(ray_start_.size());
+  for (size_t ray = 0; ray < ray_start_.size(); ray++) {
+    ray_step_.at(ray) =
+        std::polar(1.0, ray_doppler_rad_.at(ray) * symbol_duration_s_);
+  }
+  InitBlocks(delay_spread_s, sample_rate, fft_size);
+}
+
+void FadingModel::InitTdl(const std::vector<double>& delays,
+                          const std::vector<double>& powers_db, bool los,
+                          uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 2.0 * kPi);
+  const std::vector<double> powers = TapPowers(powers_db, mean_gain_);
+  tap_delays_s_ = delays;
+
+  // A LOS tap is a single ray, the other ones kTdlSinusoids rays
+  tap_first_ray_.push_back(0);
+  for (size_t tap = 0; tap < delays.size(); tap++) {
+    const bool specular = los && tap == 0;
+    tap_first_ray_.push_back(tap_first_ray_.back() +
+                             (specular ? 1 : kTdlSinusoids));
+  }
+  rays_per_pair_ = tap_first_ray_.back();
+
+  // Pairs in the order of the channel matrix, UE antennas first. Each UE
+  // antenna moves in its own direction.
+  std::vector<double> los_arrival(ue_ant_);
+  for (double& angle : los_arrival) {
+    angle = uniform(rng);
+  }
+  for (size_t bs = 0; bs < bs_ant_; bs++) {
+    for (size_t ue = 0; ue < ue_ant_; ue++) {
+      for (size_t tap = 0; tap < delays.size(); tap++) {
+        const size_t num_rays =
+            tap_first_ray_.at(tap + 1) - tap_first_ray_.at(tap);
+        const double amplitude = std::sqrt(powers.at(tap) / num_rays);
+        // Sum of sinusoids with arrival angles evenly spread around a random
+        // offset
+        const double offset =
+            (num_rays == 1) ? los_arrival.at(ue) : uniform(rng);
+        for (size_t i = 0; i < num_rays; i++) {
+          const double arrival = ((2.0 * kPi * i) + offset) / num_rays;
+          ray_start_.push_back(std::polar(amplitude, uniform(rng)));
+          ray_doppler_rad_.push_back(2.0 * kPi * doppler_hz_ *
+                                     std::cos(arrival));
+        }
+      }
+    }
+  }
+}
+
+void FadingModel::InitCdl(uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<double> delays;
+  std::vector<double> powers_db;
+  SplitTable(kTdlA, delays, powers_db);
+  const std::vector<double> powers = TapPowers(powers_db, mean_gain_);
+  tap_delays_s_ = delays;
+  rays_per_tap_ = kRayOffsets.size();
+
+  std::array<size_t, kRayOffsets.size()> arrival_rays;
+  std::array<size_t, kRayOffsets.size()> zod_rays;
+  std::array<size_t, kRayOffsets.size()> zoa_rays;
+  for (size_t ue = 0; ue < ue_ant_; ue++) {
+    // Each UE antenna sees the clusters from its own side of the sector and
+    // moves in its own direction
+    const double translation_deg = (uniform(rng) - 0.5) * kCdlSectorDeg;
+    const double travel = 2.0 * kPi * uniform(rng);
+    for (size_t tap = 0; tap < delays.size(); tap++) {
+      const auto& angles = kCdlAAngles.at(tap);
+      const double amplitude = std::sqrt(powers.at(tap) / rays_per_tap_);
+      // Random coupling of the rays in the other angles
+      std::iota(arrival_rays.begin(), arrival_rays.end(), 0);
+      std::iota(zod_rays.begin(), zod_rays.end(), 0);
+      std::iota(zoa_rays.begin(), zoa_rays.end(), 0);
+      std::shuffle(arrival_rays.begin(), arrival_rays.end(), rng);
+      std::shuffle(zod_rays.begin(), zod_rays.end(), rng);
+      std::shuffle(zoa_rays.begin(), zoa_rays.end(), rng);
+      for (size_t ray = 0; ray < rays_per_tap_; ray++) {
+        const double aod =
+            DegToRad(angles.at(0) + translation_deg +
+                     (kCdlASpreads.at(0) * kRayOffsets.at(ray)));
+        const double aoa = DegToRad(angles.at(1) +
+                                    (kCdlASpreads.at(1) *
+                                     kRayOffsets.at(arrival_rays.at(ray))));
+        const double zod =
+            DegToRad(angles.at(2) +
+                     (kCdlASpreads.at(2) * kRayOffsets.at(zod_rays.at(ray))));
+        const double zoa =
+            DegToRad(angles.at(3) +
+                     (kCdlASpreads.at(3) * kRayOffsets.at(zoa_rays.at(ray))));
+
+        ray_start_.push_back(std::polar(amplitude, 2.0 * kPi * uniform(rng)));
+        ray_doppler_rad_.push_back(2.0 * kPi * doppler_hz_ * std::sin(zoa) *
+                                   std::cos(aoa - travel));
+        // BS array along the y axis
+        const double spatial_phase = kPi * std::sin(zod) * std::sin(aod);
+        for (size_t bs = 0; bs < bs_ant_; bs++) {
+          ray_steering_.push_back(
+              std::polar(1.0f, static_cast<float>(spatial_phase * bs)));
+        }
+      }
+    }
+  }
+}
+
+void FadingModel::InitBlocks(double delay_spread_s, double sample_rate,
+                             size_t fft_size) {
+  const double subcarrier_spacing = sample_rate / fft_size;
+  const size_t half = fft_size / 2;
+  size_t block_size = half;
+  if (delay_spread_s > 0.0) {
+    const double coherence_bandwidth =
+        1.0 / (kCoherenceBandwidthFactor * delay_spread_s);
+    block_size = std::clamp(
+        static_cast<size_t>(coherence_bandwidth / subcarrier_spacing),
+        size_t{1}, half);
+  }
+
+  // Blocks do not cross from the positive to the negative frequencies
+  for (const auto& [start, end] : {std::make_pair(size_t{0}, half),
+                                   std::make_pair(half, fft_size)}) {
+    for (size_t sc = start; sc < end; sc += block_size) {
+      block_start_.push_back(sc);
+      block_size_.push_back(std::min(block_size, end - sc));
+    }
+  }
+
+  for (size_t block = 0; block < block_start_.size(); block++) {
+    const double center =
+        block_start_.at(block) + ((block_size_.at(block) - 1) / 2.0);
+    const double freq =
+        ((center < half) ? center : center - fft_size) * subcarrier_spacing;
+    for (const double delay : tap_delays_s_) {
+      block_delay_phasor_.push_back(std::polar(
+          1.0f, static_cast<float>(-2.0 * kPi * freq * delay)));
+    }
+  }
+  AGORA_LOG_INFO(
+      "FadingModel: %zu taps, %zu rays, %zu blocks of up to %zu "
+      "subcarriers\n",
+      NumTaps(), NumRays(), NumBlocks(), block_size);
+}
+
+void FadingModel::Update(size_t symbol_index, FadingState& state) const {
+  if (symbol_index == state.symbol_index_) {
+    return;
+  }
+  if ((state.symbol_index_ != SIZE_MAX) &&
+      (symbol_index == state.symbol_index_ + 1) &&
+      (symbol_index % kResyncSymbols != 0)) {
+    for (size_t ray = 0; ray < ray_step_.size(); ray++) {
+      state.phasors_[ray] *= ray_step_[ray];
+    }
+  } else {
+    const double time = symbol_index * symbol_duration_s_;
+    for (size_t ray = 0; ray < ray_start_.size(); ray++) {
+      state.phasors_[ray] =
+          ray_start_[ray] *
+          std::polar(1.0, std::fmod(ray_doppler_rad_[ray] * time, 2.0 * kPi));
+    }
+  }
+  state.symbol_index_ = symbol_index;
+
+  // Taps, as ue_ant x bs_ant matrices
+  const size_t num_taps = NumTaps();
+  const size_t pairs = ue_ant_ * bs_ant_;
+  if (rays_per_tap_ == 0) {
+    for (size_t pair = 0; pair < pairs; pair++) {
+      const std::complex<double>* rays = &state.phasors_[pair * rays_per_pair_];
+      for (size_t tap = 0; tap < num_taps; tap++) {
+        std::complex<double> sum = 0.0;
+        for (size_t ray = tap_first_ray_[tap]; ray < tap_first_ray_[tap + 1];
+             ray++) {
+          sum += rays[ray];
+        }
+        state.taps_[(tap * pairs) + pair] = std::complex<float>(sum);
+      }
+    }
+  } else {
+    std::fill(state.taps_.begin(), state.taps_.end(), 0.0f);
+    for (size_t ue = 0; ue < ue_ant_; ue++) {
+      for (size_t tap = 0; tap < num_taps; tap++) {
+        std::complex<float>* h = &state.taps_[(tap * pairs) + ue];
+        const size_t first_ray = ((ue * num_taps) + tap) * rays_per_tap_;
+        for (size_t ray = first_ray; ray < first_ray + rays_per_tap_; ray++) {
+          const auto gain = std::complex<float>(state.phasors_[ray]);
+          const std::complex<float>* steering = &ray_steering_[ray * bs_ant_];
+          for (size_t bs = 0; bs < bs_ant_; bs++) {
+            h[bs * ue_ant_] += gain * steering[bs];
+          }
+        }
+      }
+    }
+  }
+
+  // Frequency response at the center of each block
+  for (size_t block = 0; block < NumBlocks(); block++) {
+    std::complex<float>* response = &state.response_[block * pairs];
+    const std::complex<float>* delay_phasors =
+        &block_delay_phasor_[block * num_taps];
+    std::fill(response, response + pairs, 0.0f);
+    for (size_t tap = 0; tap < num_taps; tap++) {
+      const std::complex<float>* h = &state.taps_[tap * pairs];
+      for (size_t pair = 0; pair < pairs; pair++) {
+        response[pair] += h[pair] * delay_phasors[tap];
+      }
+    }
+  }
+}
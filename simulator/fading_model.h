@@ -0,0 +1,132 @@
+/**
+ * @file fading_model.h
+ * @brief Declaration file for the FadingModel class, the TDL and CDL fading
+ * channels of 3GPP TR 38.901 with Doppler for the channel simulator
+ */
+#ifndef FADING_MODEL_H_
+#define FADING_MODEL_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FadingModel;
+
+/**
+ * @brief Per-thread state of a fading channel: the phases of its rays, its
+ * taps and its frequency response at the symbol it was last updated to
+ */
+class FadingState {
+ public:
+  explicit FadingState(const FadingModel& model);
+
+  /// Channel matrix (ue_ant x bs_ant, column major) of a subcarrier block
+  inline const std::complex<float>* Response(size_t block) const {
+    return &response_.at(block * ue_ant_ * bs_ant_);
+  }
+
+ private:
+  friend class FadingModel;
+
+  const size_t ue_ant_;
+  const size_t bs_ant_;
+  size_t symbol_index_;
+  std::vector<std::complex<double>> phasors_;
+  // Channel matrix of each tap, then of each subcarrier block
+  std::vector<std::complex<float>> taps_;
+  std::vector<std::complex<float>> response_;
+};
+
+/**
+ * @brief A multi-tap fading channel between the UE and BS antennas, made of
+ * rays of constant Doppler shift
+ *
+ * The taps of a symbol are the sums of the rays at its time, which a thread
+ * advances from one symbol to the next with a single rotation per ray. The
+ * channel is then evaluated once per block of subcarriers narrower than the
+ * coherence bandwidth, so its cost follows the delay spread and not the FFT
+ * size.
+ *
+ * TDL profiles draw an independent sum-of-sinusoids Rayleigh process per tap
+ * and antenna pair. The CDL profile sends the rays of each cluster from its
+ * departure angle to a uniform linear array of half-wavelength spacing at the
+ * BS, so the BS antennas are correlated, and gives each UE antenna its own
+ * rays and travel direction.
+ */
+class FadingModel {
+ public:
+  enum class Profile { kTdlA, kTdlC, kTdlD, kCdlA };
+
+  /// The profile of a channel model name, e.g. "TDL_A". False if the name is
+  /// not a fading model.
+  static bool ParseProfile(const std::string& name, Profile& profile);
+
+  /**
+   * @param delay_spread_ns RMS delay spread the normalized delays are scaled
+   * to
+   * @param doppler_hz Maximum Doppler shift
+   * @param sample_rate Sample rate, which sets the subcarrier spacing with
+   * fft_size
+   * @param symbol_duration_s Time between two symbols
+   * @param mean_gain Expected sum of the tap powers
+   * @param seed Seed of the rays, the same for all threads
+   */
+  FadingModel(Profile profile, size_t ue_ant, size_t bs_ant,
+              double delay_spread_ns, double doppler_hz, double sample_rate,
+              size_t fft_size, double symbol_duration_s, float mean_gain,
+              uint64_t seed);
+
+  /// Bring the frequency response of state to the symbol, which is cheapest
+  /// when it follows the last symbol of state
+  void Update(size_t symbol_index, FadingState& state) const;
+
+  inline size_t UeAnt() const { return ue_ant_; }
+  inline size_t BsAnt() const { return bs_ant_; }
+  inline size_t NumTaps() const { return tap_delays_s_.size(); }
+  inline size_t NumRays() const { return ray_start_.size(); }
+  inline size_t NumBlocks() const { return block_start_.size(); }
+  /// The subcarriers, in FFT order, of a block
+  inline size_t BlockStart(size_t block) const {
+    return block_start_.at(block);
+  }
+  inline size_t BlockSize(size_t block) const {
+    return block_size_.at(block);
+  }
+
+ private:
+  // Recompute the rays exactly after this many rotations
+  static constexpr size_t kResyncSymbols = 256;
+
+  void InitTdl(const std::vector<double>& delays,
+               const std::vector<double>& powers_db, bool los, uint64_t seed);
+  void InitCdl(uint64_t seed);
+  void InitBlocks(double delay_spread_s, double sample_rate, size_t fft_size);
+
+  const size_t ue_ant_;
+  const size_t bs_ant_;
+  const double doppler_hz_;
+  const double symbol_duration_s_;
+  const float mean_gain_;
+
+  std::vector<double> tap_delays_s_;
+  // Each ray has a starting phasor, a Doppler shift and a rotation per symbol
+  std::vector<std::complex<double>> ray_start_;
+  std::vector<double> ray_doppler_rad_;
+  std::vector<std::complex<double>> ray_step_;
+  // TDL: rays of each antenna pair, with the first ray of each tap
+  size_t rays_per_pair_;
+  std::vector<size_t> tap_first_ray_;
+  // CDL: rays_per_tap_ rays per UE antenna and tap, and the BS array
+  // response of each ray
+  size_t rays_per_tap_;
+  std::vector<std::complex<float>> ray_steering_;
+
+  std::vector<size_t> block_start_;
+  std::vector<size_t> block_size_;
+  // exp(-j 2 pi f tau) of each block center and tap
+  std::vector<std::complex<float>> block_delay_phasor_;
+};
+
+#endif  // FADING_MODEL_H_
@@ -12,7 +12,7 @@
 #include "gettime.h"
 #include "logger.h"
 #include "message.h"
-#include "udp_client.h"
+#include "shm_comm.h"
 
 #if defined(USE_DPDK)
 #define DPDK_BURST_BULK
@@ -20,6 +20,10 @@
 #endif
 
 static constexpr bool kDebugPrintSender = false;
+// Time for the paced workers to leave the start barrier before the first frame
+static constexpr size_t kPacedStartDelayUs = 1000;
+// Frames read from a replayed trace at a time
+static constexpr size_t kReplayFramesPerRead = 32;
 
 static std::atomic<bool> keep_running = true;
 // A spinning barrier to synchronize the start of worker threads
@@ -39,7 +43,8 @@ void DelayTicks(uint64_t start, uint64_t ticks) {
 Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
                size_t frame_duration, size_t inter_frame_delay,
                size_t enable_slow_start, const std::string& server_mac_addr_str,
-               bool create_thread_for_master)
+               bool create_thread_for_master, bool prebuilt_packets,
+               const std::string& replay_file)
     : cfg_(cfg),
       freq_ghz_(GetTime::MeasureRdtscFreq()),
       ticks_per_usec_(freq_ghz_ * 1e3),
@@ -47,7 +52,8 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
       enable_slow_start_(enable_slow_start),
       core_offset_(core_offset),
       inter_frame_delay_(inter_frame_delay),
-      ticks_inter_frame_(inter_frame_delay_ * ticks_per_usec_) {
+      ticks_inter_frame_(inter_frame_delay_ * ticks_per_usec_),
+      prebuilt_packets_(prebuilt_packets) {
   if (frame_duration == 0) {
     frame_duration_ =
         (cfg->Frame().NumTotalSyms() * cfg->SampsPerSymbol() * 1000000ul) /
@@ -73,11 +79,44 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
   for (auto& i : packet_count_per_symbol_) {
     i = new size_t[cfg->Frame().NumTotalSyms()]();
   }
+  for (auto& workers_done : paced_workers_done_) {
+    workers_done.store(0);
+  }
 
-  InitIqFromFile(std::string(TOSTRING(PROJECT_DIRECTORY)) +
-                 "/files/experiment/LDPC_rx_data_" +
-                 std::to_string(cfg->OfdmCaNum()) + "_ant" +
-                 std::to_string(cfg->BsAntNum()) + ".bin");
+  if (replay_file.empty()) {
+    InitIqFromFile(std::string(TOSTRING(PROJECT_DIRECTORY)) +
+                   "/files/experiment/LDPC_rx_data_" +
+                   std::to_string(cfg->OfdmCaNum()) + "_ant" +
+                   std::to_string(cfg->BsAntNum()) + ".bin");
+  } else {
+#if defined(ENABLE_HDF5)
+    // The trace holds int16 samples, which are sent as they are
+    RtAssert((prebuilt_packets == false) && (cfg->FronthaulBfpBits() == 0) &&
+                 (kUse12BitIQ == false),
+             "Sender: A trace cannot be replayed with prebuilt packets, BFP "
+             "or 12-bit IQ");
+    replay_ =
+        std::make_unique<TraceReplay>(cfg, replay_file, kReplayFramesPerRead);
+#else
+    RtAssert(false, "Sender: Replaying a trace needs ENABLE_HDF5");
+#endif
+  }
+  // We currently don't support zero-padding OFDM prefix and postfix
+  if (cfg->FronthaulBfpBits() != 0) {
+    payload_length_ = iq_data_bfp_.at(0).size();
+  } else if (cfg->ScSliceNodes() > 1) {
+    // The float16 slice of a split carrier
+    payload_length_ = 4 * cfg->OfdmDataNum();
+  } else {
+    payload_length_ = (kUse12BitIQ ? 3 : 4) * (cfg->SampsPerSymbol());
+  }
+  RtAssert(cfg->PacketLength() == Packet::kOffsetOfData + payload_length_,
+           "Sender: Packet length does not match the IQ samples");
+  RtAssert((prebuilt_packets_ == false) || (cfg->FronthaulAggregation() == 1),
+           "Sender: prebuilt packets are not aggregated");
+  if (prebuilt_packets_) {
+    BuildPacketImages();
+  }
 
   task_ptok_ =
       static_cast<moodycamel::ProducerToken**>(Agora_memory::PaddedAlignedAlloc(
@@ -100,8 +139,8 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
       rte_socket_id());
   RtAssert(cfg->DpdkNumPorts() <= rte_eth_dev_count_avail(),
            "Invalid number of DPDK ports");
-  mbuf_pool_ =
-      DpdkTransport::CreateMempool(cfg->DpdkNumPorts(), cfg->PacketLength());
+  mbuf_pool_ = DpdkTransport::CreateMempool(cfg->DpdkNumPorts(),
+                                            cfg->AggregatePacketLength());
 
   // Parse IP addresses
   int status = inet_pton(AF_INET, cfg->BsRruAddr().c_str(), &bs_rru_addr_);
@@ -132,7 +171,7 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
 
     const int num_queues = cfg_->NumRadios() / cfg->DpdkNumPorts();
     const auto nic_status = DpdkTransport::NicInit(
-        port_ids_.at(i), mbuf_pool_, num_queues, cfg->PacketLength());
+        port_ids_.at(i), mbuf_pool_, num_queues, cfg->AggregatePacketLength());
     if (nic_status != 0) {
       rte_exit(EXIT_FAILURE, "Cannot init port %u\n", port_ids_.at(i));
     }
@@ -160,6 +199,7 @@ Sender::~Sender() {
   }
 
   iq_data_short_.Free();
+  packet_images_.Free();
   for (auto& i : packet_count_per_symbol_) {
     delete[] i;
     i = nullptr;
@@ -230,6 +270,20 @@ void* Sender::MasterThread(int /*unused*/) {
   while (num_workers_ready_atomic.load() < (socket_thread_num_ + 1)) {
     // Wait
   }
+  if (prebuilt_packets_) {
+    // The workers follow the schedule from here on their own
+    paced_start_tsc_.store(
+        GetTime::Rdtsc() +
+        static_cast<uint64_t>(kPacedStartDelayUs * ticks_per_usec_));
+    while ((keep_running.load() == true) &&
+           (paced_frames_done_.load() < cfg_->FramesToTest())) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    keep_running.store(false);
+    AGORA_LOG_INFO("Sender main thread exit\n");
+    WriteStatsToFile(cfg_->FramesToTest());
+    return nullptr;
+  }
 
   uint64_t tick_start = GetTime::Rdtsc();
   double frame_start_us = GetTime::GetTimeUs();
@@ -287,6 +341,11 @@ void* Sender::MasterThread(int /*unused*/) {
           // the workers (now)
           frame_end_us = GetTime::GetTimeUs();
           next_frame_id++;
+#if defined(ENABLE_HDF5)
+          if (replay_ != nullptr) {
+            replay_->Release(next_frame_id);
+          }
+#endif
 
           // Find start symbol of next frame and add proper delay
           next_symbol_id = FindNextSymbol(0);
@@ -363,23 +422,22 @@ void* Sender::WorkerThread(int tid) {
       "this worker %zu\n",
       tid, radio_lo, radio_hi, radios_this_worker);
 
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  DftiCommitDescriptor(mkl_handle);
+  auto fft_plan = FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum());
+  const size_t aggregation = cfg_->FronthaulAggregation();
 
 #if defined(USE_DPDK)
   uint16_t port_id = port_ids_.at(tid % cfg_->DpdkNumPorts());
   AGORA_LOG_INFO("Sender worker[%d]: using port %u\n", tid, port_id);
-  std::array<rte_mbuf*, kDequeueBulkSize> tx_mbufs;
+  std::vector<rte_mbuf*> tx_mbufs(kDequeueBulkSize * aggregation);
 #else
   // Make a client / socket for each interface (simular to radio behavior)
-  std::vector<std::unique_ptr<UDPClient> > udp_clients;
+  std::vector<std::unique_ptr<PacketComm> > udp_clients;
   //Setting up the source port.  Each radio has a unique source port id
   for (size_t radio_number = radio_lo; radio_number <= radio_hi;
        radio_number++) {
-    udp_clients.emplace_back(std::make_unique<UDPClient>(
-        cfg_->BsRruAddr(), cfg_->BsRruPort() + radio_number));
+    udp_clients.emplace_back(CreateSimComm(
+        cfg_, cfg_->BsRruAddr(), cfg_->BsRruPort() + radio_number,
+        cfg_->BsServerAddr(), cfg_->BsServerPort() + radio_number, 0));
   }
 #endif
 
@@ -387,8 +445,9 @@ void* Sender::WorkerThread(int tid) {
       static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
           Agora_memory::Alignment_t::kAlign64,
           cfg_->OfdmCaNum() * sizeof(complex_float)));
-  auto* socks_pkt_buf = static_cast<Packet*>(PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign32, cfg_->PacketLength()));
+  auto* socks_pkt_buf = static_cast<Packet*>(
+      PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign32,
+                         cfg_->AggregatePacketLength()));
 
   double begin = GetTime::GetTimeUs();
   size_t total_tx_packets = 0;
@@ -398,56 +457,62 @@ void* Sender::WorkerThread(int tid) {
   AGORA_LOG_INFO("Sender worker[%d]: %zu antennas, total bs antennas: %zu\n",
                  tid, ant_num_this_thread, cfg_->BsAntNum());
 
-  // We currently don't support zero-padding OFDM prefix and postfix
-  RtAssert(cfg_->PacketLength() ==
-           Packet::kOffsetOfData +
-               (kUse12BitIQ ? 3 : 4) * (cfg_->SampsPerSymbol()));
-  const size_t ant_num_per_cell = cfg_->BsAntNum() / cfg_->NumCells();
-
-  size_t tags[kDequeueBulkSize];
+  // With fronthaul_aggregation, a datagram takes up to that many tags
+  std::vector<size_t> tags(kDequeueBulkSize * aggregation);
   while (keep_running.load() == true) {
     size_t num_tags = send_queue_.try_dequeue_bulk_from_producer(
-        *(task_ptok_[tid]), tags, kDequeueBulkSize);
+        *(task_ptok_[tid]), tags.data(), tags.size());
     if (num_tags > 0) {
-      for (size_t tag_id = 0; (tag_id < num_tags); tag_id++) {
+      size_t num_pkts = 0;
+      size_t tag_id = 0;
+      while (tag_id < num_tags) {
         const size_t start_tsc_send = GetTime::Rdtsc();
-        const auto tag = gen_tag_t(tags[tag_id]);
+        const auto tag = gen_tag_t(tags.at(tag_id));
         assert((cfg_->GetSymbolType(tag.symbol_id_) == SymbolType::kPilot) ||
                (cfg_->GetSymbolType(tag.symbol_id_) == SymbolType::kUL));
+        // The following tags of the same frame share the datagram
+        size_t num_entries = 1;
+        while ((num_entries < aggregation) &&
+               ((tag_id + num_entries) < num_tags) &&
+               (gen_tag_t(tags.at(tag_id + num_entries)).frame_id_ ==
+                tag.frame_id_)) {
+          num_entries++;
+        }
+        const size_t pkt_length = cfg_->AggregatePacketLength(num_entries);
 
         // Send a message to the server. We assume that the server is running.
         Packet* pkt = nullptr;
 #if defined(USE_DPDK)
-        tx_mbufs.at(tag_id) = DpdkTransport::AllocUdp(
+        tx_mbufs.at(num_pkts) = DpdkTransport::AllocUdp(
             mbuf_pool_, sender_mac_addr_[port_id], server_mac_addr_[port_id],
             bs_rru_addr_, bs_server_addr_, cfg_->BsRruPort() + cur_radio,
-            cfg_->BsServerPort() + cur_radio, cfg_->PacketLength(),
+            cfg_->BsServerPort() + cur_radio, pkt_length,
             (uint16_t(tag.frame_id_ & 0xffff) << 8) |
                 uint16_t(tag.symbol_id_ & 0xffff));
         pkt = reinterpret_cast<Packet*>(
-            rte_pktmbuf_mtod(tx_mbufs.at(tag_id), uint8_t*) + kPayloadOffset);
+            rte_pktmbuf_mtod(tx_mbufs.at(num_pkts), uint8_t*) +
+            kPayloadOffset);
 #else
         pkt = socks_pkt_buf;
 #endif
 
         if (kDebugPrintSender) {
           AGORA_LOG_INFO(
-              "Sender worker [%d]: processing frame %d symbol %d, type %d\n",
+              "Sender worker [%d]: processing frame %d symbol %d, type %d, "
+              "%zu packets\n",
               tid, tag.frame_id_, tag.symbol_id_,
-              static_cast<int>(cfg_->GetSymbolType(tag.symbol_id_)));
+              static_cast<int>(cfg_->GetSymbolType(tag.symbol_id_)),
+              num_entries);
         }
 
         // Update the TX buffer
-        pkt->frame_id_ = tag.frame_id_;
-        pkt->symbol_id_ = tag.symbol_id_;
-        pkt->cell_id_ = tag.ant_id_ / ant_num_per_cell;
-        pkt->ant_id_ = tag.ant_id_ - ant_num_per_cell * (pkt->cell_id_);
-        std::memcpy(
-            pkt->data_,
-            iq_data_short_[(pkt->symbol_id_ * cfg_->BsAntNum()) + tag.ant_id_],
-            (cfg_->SampsPerSymbol()) * (kUse12BitIQ ? 3 : 4));
-        if (cfg_->FftInRru() == true) {
-          RunFft(pkt, fft_inout, mkl_handle);
+        if (aggregation > 1) {
+          WriteAggregatePacket(reinterpret_cast<AggregatePacket*>(pkt),
+                               &tags.at(tag_id), num_entries, fft_inout,
+                               fft_plan.get());
+        } else {
+          WritePacket(pkt, tag.frame_id_, tag.symbol_id_, tag.ant_id_,
+                      fft_inout, fft_plan.get());
         }
 
         const size_t dest_port = cfg_->BsServerPort() + cur_radio;
@@ -456,7 +521,7 @@ void* Sender::WorkerThread(int tid) {
         const size_t queue_id =
             cur_radio % (cfg_->NumRadios() / cfg_->DpdkNumPorts());
         const size_t nb_tx_new =
-            rte_eth_tx_burst(port_id, queue_id, &tx_mbufs.at(tag_id), 1);
+            rte_eth_tx_burst(port_id, queue_id, &tx_mbufs.at(num_pkts), 1);
         if (unlikely(nb_tx_new != 1)) {
           AGORA_LOG_ERROR(
               "Thread %d rte_eth_tx_burst() failed, nb_tx_new: %zu, \n", tid,
@@ -467,28 +532,26 @@ void* Sender::WorkerThread(int tid) {
 #elif (!defined(USE_DPDK))
         const size_t interface_idx = cur_radio - radio_lo;
         udp_clients.at(interface_idx)
-            ->Send(cfg_->BsServerAddr(), dest_port,
-                   reinterpret_cast<std::byte*>(socks_pkt_buf),
-                   cfg_->PacketLength());
+            ->Send(reinterpret_cast<std::byte*>(socks_pkt_buf), pkt_length);
 #endif
 
         if (kDebugSenderReceiver) {
           AGORA_LOG_INFO(
-              "Thread %d (tag = %s) transmit frame %d, symbol %d, ant %d, size "
-              "%zu, dest port %zu, TX time: %.3f us\n",
-              tid, gen_tag_t(tag).ToString().c_str(), pkt->frame_id_,
-              pkt->symbol_id_, pkt->ant_id_, cfg_->PacketLength(), dest_port,
+              "Thread %d (tag = %s) transmit frame %d, symbol %d, ant %d, "
+              "packets %zu, size %zu, dest port %zu, TX time: %.3f us\n",
+              tid, gen_tag_t(tag).ToString().c_str(), tag.frame_id_,
+              tag.symbol_id_, tag.ant_id_, num_entries, pkt_length, dest_port,
               GetTime::CyclesToUs(GetTime::Rdtsc() - start_tsc_send,
                                   freq_ghz_));
         }
 
-        total_tx_packets_rolling++;
-        total_tx_packets++;
-        if (total_tx_packets_rolling ==
+        total_tx_packets_rolling += num_entries;
+        total_tx_packets += num_entries;
+        if (total_tx_packets_rolling >=
             ant_num_this_thread * max_symbol_id * 1000) {
           const double end = GetTime::GetTimeUs();
-          const double byte_len = cfg_->PacketLength() * ant_num_this_thread *
-                                  max_symbol_id * 1000.f;
+          const double byte_len = cfg_->PacketLength() *
+                                  total_tx_packets_rolling;
           const double diff = end - begin;
           AGORA_LOG_INFO(
               "Thread %zu send %zu frames in %f secs, tput %f Mbps\n",
@@ -504,38 +567,250 @@ void* Sender::WorkerThread(int tid) {
         } else {
           cur_radio++;
         }
+        tag_id += num_entries;
+        num_pkts++;
       }
 
 #if (defined(USE_DPDK) && defined(DPDK_BURST_BULK))
       const size_t queue_id =
           cur_radio % (cfg_->NumRadios() / cfg_->DpdkNumPorts());
       //queue id might be a little abused here
-      AGORA_LOG_TRACE("Thread %d rte_eth_tx_burst(), queue %zu num_tags: %zu\n",
-                      tid, queue_id, num_tags);
+      AGORA_LOG_TRACE("Thread %d rte_eth_tx_burst(), queue %zu num_pkts: %zu\n",
+                      tid, queue_id, num_pkts);
       const size_t nb_tx_new =
-          rte_eth_tx_burst(port_id, queue_id, tx_mbufs.data(), num_tags);
-      if (unlikely(nb_tx_new != num_tags)) {
+          rte_eth_tx_burst(port_id, queue_id, tx_mbufs.data(), num_pkts);
+      if (unlikely(nb_tx_new != num_pkts)) {
         AGORA_LOG_ERROR(
-            "Thread %d rte_eth_tx_burst() failed, nb_tx_new: %zu, num_tags: "
+            "Thread %d rte_eth_tx_burst() failed, nb_tx_new: %zu, num_pkts: "
             "%zu\n",
-            tid, nb_tx_new, num_tags);
+            tid, nb_tx_new, num_pkts);
         keep_running.store(false);
         break;
       }
 #endif
-      RtAssert(completion_queue_.enqueue_bulk(tags, num_tags),
+      RtAssert(completion_queue_.enqueue_bulk(tags.data(), num_tags),
                "Completion enqueue failed");
     }  // if (num_tags > 0)
   }    // while (keep_running.load() == true)
 
-  DftiFreeDescriptor(&mkl_handle);
-
   std::free(static_cast<void*>(socks_pkt_buf));
   std::free(static_cast<void*>(fft_inout));
   AGORA_LOG_FRAME("Sender: worker thread %d exit\n", tid);
   return nullptr;
 }
 
+void Sender::WritePacket(Packet* pkt, size_t frame_id, size_t symbol_id,
+                         size_t ant_id, complex_float* fft_inout,
+                         FftPlan* fft_plan) const {
+  const size_t ant_num_per_cell = cfg_->BsAntNum() / cfg_->NumCells();
+  pkt->frame_id_ = frame_id;
+  pkt->symbol_id_ = symbol_id;
+  pkt->cell_id_ = ant_id / ant_num_per_cell;
+  pkt->ant_id_ = ant_id - ant_num_per_cell * (pkt->cell_id_);
+  WritePayload(pkt->data_, frame_id, symbol_id, ant_id, fft_inout, fft_plan);
+}
+
+void Sender::WriteAggregatePacket(AggregatePacket* agg, const size_t* tags,
+                                  size_t num_tags, complex_float* fft_inout,
+                                  FftPlan* fft_plan) const {
+  agg->frame_id_ = gen_tag_t(tags[0]).frame_id_;
+  agg->num_entries_ = static_cast<uint32_t>(num_tags);
+  for (size_t i = 0; i < num_tags; i++) {
+    const auto tag = gen_tag_t(tags[i]);
+    agg->entries_[i].symbol_id_ = static_cast<uint16_t>(tag.symbol_id_);
+    agg->entries_[i].ant_id_ = static_cast<uint16_t>(tag.ant_id_);
+    WritePayload(agg->Samples(i, payload_length_), tag.frame_id_,
+                 tag.symbol_id_, tag.ant_id_, fft_inout, fft_plan);
+  }
+}
+
+void Sender::WritePayload(short* data, size_t frame_id, size_t symbol_id,
+                          size_t ant_id, complex_float* fft_inout,
+                          FftPlan* fft_plan) const {
+  const size_t iq_index = (symbol_id * cfg_->BsAntNum()) + ant_id;
+  if (cfg_->FronthaulBfpBits() != 0) {
+    std::memcpy(data, iq_data_bfp_.at(iq_index).data(), payload_length_);
+  } else {
+    const short* samples = nullptr;
+#if defined(ENABLE_HDF5)
+    if (replay_ != nullptr) {
+      // The frame id of the trace is rewritten to the one of the packet
+      samples = replay_->Samples(frame_id, symbol_id, ant_id);
+    }
+#endif
+    if (samples == nullptr) {
+      samples = iq_data_short_.At(iq_index);
+    }
+    if (cfg_->FftInRru() == true) {
+      RunFft(data, samples, fft_inout, fft_plan);
+    } else {
+      std::memcpy(data, samples, payload_length_);
+    }
+  }
+}
+
+/* Sends the prebuilt packets of its antennas from the start set by master */
+void* Sender::PacedWorkerThread(int tid) {
+  PinToCoreWithOffset(ThreadType::kWorkerTX, (core_offset_ + 1), tid);
+
+  // Wait for all Sender threads (including master) to start runnung
+  num_workers_ready_atomic.fetch_add(1);
+  while (num_workers_ready_atomic.load() < (socket_thread_num_ + 1)) {
+    // Wait
+  }
+
+  size_t radios_per_worker = (cfg_->NumRadios() / socket_thread_num_);
+  if ((cfg_->NumRadios() % socket_thread_num_) != 0) {
+    radios_per_worker++;
+  }
+  const size_t num_active_workers =
+      (cfg_->NumRadios() + radios_per_worker - 1) / radios_per_worker;
+  const size_t radio_lo = tid * radios_per_worker;
+  //This thread has nothing to do
+  if (radio_lo >= cfg_->NumRadios()) {
+    return nullptr;
+  }
+  const size_t radio_hi =
+      std::min(radio_lo + radios_per_worker, cfg_->NumRadios()) - 1;
+  const size_t ant_lo = radio_lo * cfg_->NumChannels();
+  const size_t ant_num_this_thread =
+      ((radio_hi - radio_lo) + 1) * cfg_->NumChannels();
+
+  AGORA_LOG_INFO(
+      "Sender paced worker[%d]: emulating radios %zu:%zu with prebuilt "
+      "packets\n",
+      tid, radio_lo, radio_hi);
+
+#if defined(USE_DPDK)
+  uint16_t port_id = port_ids_.at(tid % cfg_->DpdkNumPorts());
+  std::array<rte_mbuf*, kDequeueBulkSize> tx_mbufs;
+#else
+  // A socket connected to the server port of each radio, so a send is a
+  // single system call
+  std::vector<std::unique_ptr<PacketComm> > udp_clients;
+  for (size_t radio_number = radio_lo; radio_number <= radio_hi;
+       radio_number++) {
+    udp_clients.emplace_back(CreateSimComm(
+        cfg_, cfg_->BsRruAddr(), cfg_->BsRruPort() + radio_number,
+        cfg_->BsServerAddr(), cfg_->BsServerPort() + radio_number, 0));
+  }
+#endif
+
+  uint64_t frame_tsc;
+  while ((frame_tsc = paced_start_tsc_.load()) == 0) {
+    if (keep_running.load() == false) {
+      return nullptr;
+    }
+  }
+
+  for (size_t frame_id = 0;
+       (frame_id < cfg_->FramesToTest()) && (keep_running.load() == true);
+       frame_id++) {
+    const uint64_t symbol_ticks = GetTicksForFrame(frame_id);
+    if (tid == 0) {
+      while (GetTime::Rdtsc() < frame_tsc) {
+        _mm_pause();
+      }
+      frame_start_[(frame_id % kNumStatsFrames)] = GetTime::GetTimeUs();
+    }
+
+    for (size_t symbol_id = FindNextSymbol(0);
+         symbol_id < cfg_->Frame().NumTotalSyms();
+         symbol_id = FindNextSymbol(symbol_id + 1)) {
+      const uint64_t symbol_tsc = frame_tsc + (symbol_id * symbol_ticks);
+      // Spread the batches of the symbol evenly over its duration, so each
+      // queue sends at the symbol rate instead of in one burst
+      for (size_t first = 0; first < ant_num_this_thread;
+           first += kDequeueBulkSize) {
+        const size_t num_pkts =
+            std::min(kDequeueBulkSize, ant_num_this_thread - first);
+        const uint64_t batch_tsc =
+            symbol_tsc + ((symbol_ticks * first) / ant_num_this_thread);
+        while (GetTime::Rdtsc() < batch_tsc) {
+          _mm_pause();
+        }
+
+        for (size_t i = 0; i < num_pkts; i++) {
+          const size_t ant_id = ant_lo + first + i;
+          const size_t radio = ant_id / cfg_->NumChannels();
+          auto* image = reinterpret_cast<Packet*>(
+              packet_images_[(symbol_id * cfg_->BsAntNum()) + ant_id]);
+          // Each image belongs to one worker, only its frame id changes
+          image->frame_id_ = frame_id;
+#if defined(USE_DPDK)
+          tx_mbufs.at(i) = DpdkTransport::AllocUdp(
+              mbuf_pool_, sender_mac_addr_[port_id], server_mac_addr_[port_id],
+              bs_rru_addr_, bs_server_addr_, cfg_->BsRruPort() + radio,
+              cfg_->BsServerPort() + radio, cfg_->PacketLength(),
+              (uint16_t(frame_id & 0xffff) << 8) |
+                  uint16_t(symbol_id & 0xffff));
+          std::memcpy(
+              rte_pktmbuf_mtod(tx_mbufs.at(i), uint8_t*) + kPayloadOffset,
+              image, cfg_->PacketLength());
+#else
+          udp_clients.at(radio - radio_lo)
+              ->Send(reinterpret_cast<std::byte*>(image),
+                     cfg_->PacketLength());
+#endif
+        }
+
+#if defined(USE_DPDK)
+        const size_t queue_id = (ant_lo + first) / cfg_->NumChannels() %
+                                (cfg_->NumRadios() / cfg_->DpdkNumPorts());
+        const size_t nb_tx_new =
+            rte_eth_tx_burst(port_id, queue_id, tx_mbufs.data(), num_pkts);
+        if (unlikely(nb_tx_new != num_pkts)) {
+          AGORA_LOG_ERROR(
+              "Thread %d rte_eth_tx_burst() failed, nb_tx_new: %zu, num_pkts: "
+              "%zu\n",
+              tid, nb_tx_new, num_pkts);
+          keep_running.store(false);
+          break;
+        }
+#endif
+      }
+    }
+
+    // The last worker to finish a frame ends it
+    const size_t frame_slot = frame_id % kFrameWnd;
+    if (paced_workers_done_.at(frame_slot).fetch_add(1) + 1 ==
+        num_active_workers) {
+      paced_workers_done_.at(frame_slot).store(0);
+      frame_end_[(frame_id % kNumStatsFrames)] = GetTime::GetTimeUs();
+      paced_frames_done_.fetch_add(1);
+      if (kDebugPrintPerFrameDone == true) {
+        AGORA_LOG_INFO("Sender: Tx frame %zu\n", frame_id);
+      }
+    }
+    frame_tsc += (symbol_ticks * cfg_->Frame().NumTotalSyms()) +
+                 ticks_inter_frame_;
+  }
+  AGORA_LOG_FRAME("Sender: paced worker thread %d exit\n", tid);
+  return nullptr;
+}
+
+void Sender::BuildPacketImages() {
+  const size_t packets_per_frame =
+      cfg_->Frame().NumTotalSyms() * cfg_->BsAntNum();
+  packet_images_.Calloc(packets_per_frame, Roundup<64>(cfg_->PacketLength()),
+                        Agora_memory::Alignment_t::kAlign64);
+
+  auto fft_plan = FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum());
+  auto* fft_inout =
+      static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+          Agora_memory::Alignment_t::kAlign64,
+          cfg_->OfdmCaNum() * sizeof(complex_float)));
+  for (size_t symbol_id = 0; symbol_id < cfg_->Frame().NumTotalSyms();
+       symbol_id++) {
+    for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+      WritePacket(reinterpret_cast<Packet*>(
+                      packet_images_[(symbol_id * cfg_->BsAntNum()) + ant_id]),
+                  0, symbol_id, ant_id, fft_inout, fft_plan.get());
+    }
+  }
+  std::free(static_cast<void*>(fft_inout));
+}
+
 uint64_t Sender::GetTicksForFrame(size_t frame_id) const {
   if (enable_slow_start_ == 0) {
     return ticks_all_;
@@ -583,13 +858,27 @@ void Sender::InitIqFromFile(const std::string& filename) {
                               expected_count);
     }
   }
+  if (cfg_->FronthaulBfpBits() != 0) {
+    // Compress once here, the packets are only copied on the send path
+    iq_data_bfp_.resize(packets_per_frame);
+    for (size_t i = 0; i < packets_per_frame; i++) {
+      iq_data_bfp_.at(i).resize(
+          BfpBytes(cfg_->SampsPerSymbol(), cfg_->FronthaulBfpBits()));
+      BfpCompress(iq_data_short_[i], iq_data_bfp_.at(i).data(),
+                  cfg_->SampsPerSymbol(), cfg_->FronthaulBfpBits());
+    }
+  }
   std::fclose(fp);
   iq_data_float.Free();
 }
 
 void Sender::CreateWorkerThreads(size_t num_workers) {
   for (size_t i = 0u; i < num_workers; i++) {
-    threads_.emplace_back(&Sender::WorkerThread, this, i);
+    if (prebuilt_packets_) {
+      threads_.emplace_back(&Sender::PacedWorkerThread, this, i);
+    } else {
+      threads_.emplace_back(&Sender::WorkerThread, this, i);
+    }
   }
 }
 
@@ -606,17 +895,39 @@ void Sender::WriteStatsToFile(size_t tx_frame_count) const {
   }
 }
 
-void Sender::RunFft(Packet* pkt, complex_float* fft_inout,
-                    DFTI_DESCRIPTOR_HANDLE mkl_handle) const {
-  // pkt->data has (cp_len + ofdm_ca_num) unsigned short samples. After FFT,
+void Sender::RunFft(short* data, const short* samples,
+                    complex_float* fft_inout,
+                    FftPlan* fft_plan) const {
+  // samples has (cp_len + ofdm_ca_num) unsigned short samples. After FFT,
   // we'll remove the cyclic prefix and have ofdm_ca_num() short samples left.
-  SimdConvertShortToFloat(&pkt->data_[2 * cfg_->CpLen()],
+  SimdConvertShortToFloat(&samples[2 * cfg_->CpLen()],
                           reinterpret_cast<float*>(fft_inout),
                           cfg_->OfdmCaNum() * 2);
 
-  DftiComputeForward(mkl_handle, reinterpret_cast<float*>(fft_inout));
+  fft_plan->Forward(fft_inout);
 
-  SimdConvertFloat32ToFloat16(reinterpret_cast<float*>(pkt->data_),
-                              reinterpret_cast<float*>(fft_inout),
-                              cfg_->OfdmCaNum() * 2);
+  if (cfg_->ScSliceNodes() == 1) {
+    SimdConvertFloat32ToFloat16(reinterpret_cast<float*>(data),
+                                reinterpret_cast<float*>(fft_inout),
+                                cfg_->OfdmCaNum() * 2);
+    return;
+  }
+  // As a fronthaul splitter, send only the node's slice, FFT-shifted. In the
+  // unshifted output it is at most two runs, on either side of ofdm_ca_num/2.
+  const size_t half = cfg_->OfdmCaNum() / 2;
+  const size_t start = cfg_->OfdmDataStart();
+  const size_t stop = cfg_->OfdmDataStop();
+  auto* out = reinterpret_cast<float*>(data);
+  if (start < half) {
+    const size_t run = std::min(stop, half) - start;
+    SimdConvertFloat32ToFloat16(
+        out, reinterpret_cast<float*>(&fft_inout[start + half]), run * 2);
+    out += run;
+  }
+  if (stop > half) {
+    const size_t run_start = std::max(start, half);
+    SimdConvertFloat32ToFloat16(
+        out, reinterpret_cast<float*>(&fft_inout[run_start - half]),
+        (stop - run_start) * 2);
+  }
 }
@@ -12,8 +12,11 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <thread>
 #include <vector>
@@ -22,16 +25,19 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "datatype_conversion.h"
+#include "fft_backend.h"
 #include "gettime.h"
 #include "memory_manage.h"
 #include "message.h"
-#include "mkl_dfti.h"
 #include "symbols.h"
 #include "utils.h"
 
 #if defined(USE_DPDK)
 #include "dpdk_transport.h"
 #endif
+#if defined(ENABLE_HDF5)
+#include "trace_replay.h"
+#endif
 
 class Sender {
  public:
@@ -54,12 +60,20 @@ class Sender {
    * duration larger than the TTI
    *
    * @param server_mac_addr_str The MAC address of the server's NIC
+   *
+   * @param prebuilt_packets If true, build every packet of a frame once and
+   * let each worker send its antennas on a fixed schedule, without a round
+   * trip through the master per symbol
+   *
+   * @param replay_file If set, send the pilot and uplink samples of this hdf5
+   * trace of the recorder instead of the generated ones
    */
   Sender(Config* cfg, size_t socket_thread_num, size_t core_offset = 30,
          size_t frame_duration = 1000, size_t inter_frame_delay = 0,
          size_t enable_slow_start = 1,
          const std::string& server_mac_addr_str = "ff:ff:ff:ff:ff:ff",
-         bool create_thread_for_master = false);
+         bool create_thread_for_master = false, bool prebuilt_packets = false,
+         const std::string& replay_file = "");
 
   ~Sender();
 
@@ -72,6 +86,9 @@ class Sender {
  private:
   void* MasterThread(int tid);
   void* WorkerThread(int tid);
+  // Worker of the prebuilt packets, which waits for the start of each batch
+  // of its antennas instead of for tasks from the master
+  void* PacedWorkerThread(int tid);
 
   /**
    * @brief Read time-domain 32-bit floating-point IQ samples from [filename]
@@ -97,10 +114,28 @@ class Sender {
   size_t FindNextSymbol(size_t start_symbol);
   void ScheduleSymbol(size_t frame, size_t symbol_id);
 
-  // Run FFT on the data field in pkt, output to fft_inout
-  // Recombine pkt header data and fft output data into payload
-  void RunFft(Packet* pkt, complex_float* fft_inout,
-              DFTI_DESCRIPTOR_HANDLE mkl_handle) const;
+  // Write the header and samples of the packet of an antenna and symbol to
+  // pkt
+  void WritePacket(Packet* pkt, size_t frame_id, size_t symbol_id,
+                   size_t ant_id, complex_float* fft_inout,
+                   FftPlan* fft_plan) const;
+  // Write the index and payloads of the num_tags packets of tags, all of
+  // one frame, to agg
+  void WriteAggregatePacket(AggregatePacket* agg, const size_t* tags,
+                            size_t num_tags, complex_float* fft_inout,
+                            FftPlan* fft_plan) const;
+  // Write the samples of the packet of an antenna and symbol to data
+  void WritePayload(short* data, size_t frame_id, size_t symbol_id,
+                    size_t ant_id, complex_float* fft_inout,
+                    FftPlan* fft_plan) const;
+  // Fill packet_images_ with the packets of every symbol and antenna
+  void BuildPacketImages();
+
+  // Run FFT on the time-domain samples, using fft_inout
+  // Write the float16 fft output (the node's slice of a split carrier) into
+  // the payload at data
+  void RunFft(short* data, const short* samples, complex_float* fft_inout,
+              FftPlan* fft_plan) const;
 
   Config* cfg_;
   const double freq_ghz_;           // RDTSC frequency in GHz
@@ -136,6 +171,26 @@ class Sender {
   // First dimension: symbol_num_perframe * BS_ANT_NUM
   // Second dimension: (CP_LEN + OFDM_CA_NUM) * 2
   Table<short> iq_data_short_;
+  // iq_data_short_ compressed to the fronthaul format, if
+  // Config::FronthaulBfpBits() is set
+  std::vector<std::vector<uint8_t>> iq_data_bfp_;
+  // Bytes of IQ data in a packet
+  size_t payload_length_;
+
+  const bool prebuilt_packets_;
+  // First dimension: symbol_num_perframe * BS_ANT_NUM
+  // Second dimension: the packet, header included, padded to 64 bytes
+  Table<uint8_t> packet_images_;
+  // RDTSC tick the paced workers start the first frame at, 0 until set
+  std::atomic<uint64_t> paced_start_tsc_{0};
+  // Number of paced workers done with each frame in the window
+  std::array<std::atomic<size_t>, kFrameWnd> paced_workers_done_;
+  std::atomic<size_t> paced_frames_done_{0};
+
+#if defined(ENABLE_HDF5)
+  // The trace the samples are replayed from, if any
+  std::unique_ptr<TraceReplay> replay_;
+#endif
 
   // Number of packets transmitted for each symbol in a frame
   size_t* packet_count_per_symbol_[kFrameWnd];
@@ -21,6 +21,12 @@ DEFINE_string(
 DEFINE_uint64(
     enable_slow_start, 1,
     "Send frames slower than the specified frame duration during warmup");
+DEFINE_bool(prebuilt_packets, false,
+            "Build every packet of a frame at startup and let each thread "
+            "send its antennas on a fixed schedule");
+DEFINE_string(replay_file, "",
+              "HDF5 trace of the recorder to send the pilot and uplink "
+              "samples of, instead of the generated ones");
 
 int main(int argc, char* argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -35,7 +41,8 @@ int main(int argc, char* argv[]) {
       auto sender = std::make_unique<Sender>(
           cfg.get(), FLAGS_num_threads, FLAGS_core_offset, FLAGS_frame_duration,
           FLAGS_inter_frame_delay, FLAGS_enable_slow_start,
-          FLAGS_server_mac_addr);
+          FLAGS_server_mac_addr, false, FLAGS_prebuilt_packets,
+          FLAGS_replay_file);
       sender->StartTx();
     }  // end context sender
   }    // end context Config
@@ -0,0 +1,137 @@
+/**
+ * @file trace_replay.cc
+ * @brief Implementation file for the TraceReplay class
+ */
+#include "trace_replay.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "logger.h"
+#include "utils.h"
+
+// Group and datasets of the uplink traces of RecorderWorkerHDF5
+static const std::string kTraceGroup = "Data";
+static const std::string kPilotDataset = "Pilot_Samples";
+static const std::string kUplinkDataset = "UplinkData";
+static constexpr size_t kLoadPollUs = 50;
+
+TraceReplay::TraceReplay(const Config* cfg, const std::string& filename,
+                         size_t frames_per_read)
+    : cfg_(cfg),
+      reader_(std::make_unique<Agora_recorder::Hdf5Reader>(filename,
+                                                           kTraceGroup)),
+      frames_per_read_(frames_per_read),
+      num_slots_(2 * frames_per_read),
+      num_trace_frames_(SIZE_MAX),
+      ant_per_cell_(cfg->BsAntNum() / cfg->NumCells()) {
+  RtAssert(frames_per_read_ > 0, "TraceReplay: Must read at least a frame");
+  InitStream(pilots_, kPilotDataset, cfg_->Frame().NumPilotSyms());
+  InitStream(uplink_, kUplinkDataset, cfg_->Frame().NumULSyms());
+  // The datasets are extended past the last frame, which MAX_FRAME records
+  size_t max_frame;
+  if (reader_->ReadAttribute("MAX_FRAME", max_frame) && (max_frame > 0)) {
+    num_trace_frames_ = std::min(num_trace_frames_, max_frame);
+  }
+  RtAssert(num_trace_frames_ != SIZE_MAX,
+           "TraceReplay: No pilot or uplink symbols to replay");
+  AGORA_LOG_INFO(
+      "TraceReplay: Replaying %zu frames of %s, %zu frames at a time\n",
+      num_trace_frames_, filename.c_str(), frames_per_read_);
+  loader_ = std::thread(&TraceReplay::LoadThread, this);
+}
+
+TraceReplay::~TraceReplay() {
+  running_.store(false);
+  loader_.join();
+}
+
+void TraceReplay::InitStream(Stream& stream, const std::string& dataset,
+                             size_t num_symbols) {
+  stream.dataset_ = dataset;
+  stream.num_symbols_ = num_symbols;
+  stream.num_antennas_ = 0;
+  stream.frame_elems_ = 0;
+  if (num_symbols == 0) {
+    return;
+  }
+  RtAssert(reader_->HasDataset(dataset),
+           "TraceReplay: The trace has no " + dataset + " dataset");
+  const auto dims = reader_->DatasetDims(dataset);
+  RtAssert(dims.at(1) == cfg_->NumCells() && dims.at(2) == num_symbols &&
+               dims.at(3) >= ant_per_cell_ &&
+               dims.at(4) == 2 * cfg_->SampsPerSymbol(),
+           "TraceReplay: The " + dataset +
+               " dataset does not match the frame, antennas or samples of "
+               "the config");
+  num_trace_frames_ = std::min<size_t>(num_trace_frames_, dims.at(0));
+  stream.num_antennas_ = dims.at(3);
+  stream.frame_elems_ = dims.at(1) * dims.at(2) * dims.at(3) * dims.at(4);
+  stream.ring_.resize(num_slots_ * stream.frame_elems_);
+}
+
+const short* TraceReplay::Samples(size_t frame_id, size_t symbol_id,
+                                  size_t ant_id) const {
+  while (frame_id >= loaded_frames_.load()) {
+    _mm_pause();
+  }
+  const bool is_pilot = cfg_->GetSymbolType(symbol_id) == SymbolType::kPilot;
+  const Stream& stream = is_pilot ? pilots_ : uplink_;
+  const size_t symbol_index = is_pilot
+                                  ? cfg_->Frame().GetPilotSymbolIdx(symbol_id)
+                                  : cfg_->Frame().GetULSymbolIdx(symbol_id);
+  const size_t cell_id = ant_id / ant_per_cell_;
+  const size_t cell_ant_id = ant_id - (cell_id * ant_per_cell_);
+  const size_t index =
+      ((cell_id * stream.num_symbols_) + symbol_index) * stream.num_antennas_ +
+      cell_ant_id;
+  return &stream.ring_.at(((frame_id % num_slots_) * stream.frame_elems_) +
+                          (index * 2 * cfg_->SampsPerSymbol()));
+}
+
+void TraceReplay::Release(size_t frame_id) {
+  if (frame_id > released_frames_.load()) {
+    released_frames_.store(frame_id);
+  }
+}
+
+void TraceReplay::LoadThread() {
+  size_t next_frame = 0;
+  while (running_.load() == true) {
+    // Wait for the slots of the next read to be released
+    if ((next_frame + frames_per_read_) >
+        (released_frames_.load() + num_slots_)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(kLoadPollUs));
+      continue;
+    }
+    const size_t slot = next_frame % num_slots_;
+    size_t num_read = 0;
+    while (num_read < frames_per_read_) {
+      // Start over from the first frame of the trace after its last one
+      const size_t trace_frame = (next_frame + num_read) % num_trace_frames_;
+      const size_t num_frames = std::min(frames_per_read_ - num_read,
+                                         num_trace_frames_ - trace_frame);
+      ReadFrames(pilots_, trace_frame, num_frames, slot + num_read);
+      ReadFrames(uplink_, trace_frame, num_frames, slot + num_read);
+      num_read += num_frames;
+    }
+    next_frame += frames_per_read_;
+    loaded_frames_.store(next_frame);
+  }
+}
+
+void TraceReplay::ReadFrames(Stream& stream, size_t trace_frame,
+                             size_t num_frames, size_t slot) {
+  if (stream.frame_elems_ == 0) {
+    return;
+  }
+  const std::array<hsize_t, Agora_recorder::kDsDimsNum> start = {
+      trace_frame, 0, 0, 0, 0};
+  const std::array<hsize_t, Agora_recorder::kDsDimsNum> count = {
+      num_frames, cfg_->NumCells(), stream.num_symbols_, stream.num_antennas_,
+      2 * cfg_->SampsPerSymbol()};
+  reader_->ReadDataset(stream.dataset_, start, count,
+                       &stream.ring_.at(slot * stream.frame_elems_));
+}
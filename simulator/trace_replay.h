@@ -0,0 +1,86 @@
+/**
+ * @file trace_replay.h
+ * @brief Declaration file for the TraceReplay class, the uplink IQ samples of
+ * a recorded hdf5 trace streamed back to the sender
+ */
+#ifndef TRACE_REPLAY_H_
+#define TRACE_REPLAY_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "hdf5_reader.h"
+
+/**
+ * @brief The pilot and uplink samples of a trace of RecorderWorkerHDF5, read
+ * ahead of the sender in batches of frames by a loader thread.
+ *
+ * Frame f of the sender plays frame f of the trace, from its first frame
+ * again after its last one, so the frame ids of the trace are rewritten to
+ * those of the sender. The frames are held in a ring of slots that the
+ * sender frees with Release().
+ */
+class TraceReplay {
+ public:
+  /**
+   * @param cfg The config of the sender, which must have the frame schedule,
+   * cells, antennas and samples per symbol of the trace
+   * @param filename The hdf5 trace
+   * @param frames_per_read Frames read from the file at a time. The ring
+   * holds two reads.
+   */
+  TraceReplay(const Config* cfg, const std::string& filename,
+              size_t frames_per_read);
+  ~TraceReplay();
+
+  inline size_t NumTraceFrames() const { return num_trace_frames_; }
+
+  /// The int16 IQ samples of an antenna in a pilot or uplink symbol of the
+  /// frame, waiting for the frame to be read if needed
+  const short* Samples(size_t frame_id, size_t symbol_id, size_t ant_id) const;
+
+  /// The sender is done with the frames before frame_id
+  void Release(size_t frame_id);
+
+ private:
+  // A dataset of the trace, [frame][cell][symbol][antenna][sample]
+  struct Stream {
+    std::string dataset_;
+    size_t num_symbols_;
+    size_t num_antennas_;
+    size_t frame_elems_;
+    // Frames of the slots one after the other
+    std::vector<short> ring_;
+  };
+
+  void LoadThread();
+  void InitStream(Stream& stream, const std::string& dataset,
+                  size_t num_symbols);
+  // Read num_frames frames of the trace from trace_frame on to the slots from
+  // slot on
+  void ReadFrames(Stream& stream, size_t trace_frame, size_t num_frames,
+                  size_t slot);
+
+  const Config* const cfg_;
+  std::unique_ptr<Agora_recorder::Hdf5Reader> reader_;
+  const size_t frames_per_read_;
+  const size_t num_slots_;
+  size_t num_trace_frames_;
+  const size_t ant_per_cell_;
+  Stream pilots_;
+  Stream uplink_;
+
+  // Frames read and released so far
+  std::atomic<size_t> loaded_frames_{0};
+  std::atomic<size_t> released_frames_{0};
+  std::atomic<bool> running_{true};
+  std::thread loader_;
+};
+
+#endif  // TRACE_REPLAY_H_
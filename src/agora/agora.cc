@@ -5,15 +5,28 @@
 
 #include "agora.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
 
 #if defined(USE_DPDK)
 #include "packet_txrx_dpdk.h"
+#include "packet_txrx_oran.h"
+#endif
+#if defined(USE_XDP)
+#include "packet_txrx_xdp.h"
 #endif
 #include "concurrent_queue_wrapper.h"
+#include "idle_policy.h"
 #include "logger.h"
+#include "mkl_dft_cache.h"
 #include "modulation.h"
+#include "packed_llr.h"
+#include "packet_txrx_bench.h"
 #include "packet_txrx_radio.h"
 #include "packet_txrx_sim.h"
 #include "signal_handler.h"
@@ -27,6 +40,12 @@ static const std::string kOutputFilepath =
 static const std::string kTxDataFilename = kOutputFilepath + "tx_data.bin";
 static const std::string kDecodeDataFilename =
     kOutputFilepath + "decode_data.bin";
+static const std::string kTraceFilename = kOutputFilepath + "task_trace.json";
+static const std::string kFrameLogFilename = kOutputFilepath + "frame_log.bin";
+
+// With event batching, tasks are packed so that each worker still gets about
+// this many events per symbol, to keep the load balanced
+static constexpr size_t kBatchEventsPerWorker = 2;
 
 //Recording parameters
 static constexpr size_t kRecordFrameInterval = 1;
@@ -46,15 +65,20 @@ static const std::vector<Agora_recorder::RecorderWorker::RecorderWorkerTypes>
                        kRecorderWorkerMultiFile};
 #endif
 
-Agora::Agora(Config* const cfg)
+Agora::Agora(Config* const cfg, bool own_workers)
     : base_worker_core_offset_(cfg->CoreOffset() + 1 + cfg->SocketThreadNum()),
       config_(cfg),
-      mac_sched_(std::make_unique<MacScheduler>(cfg)),
+      mac_sched_(std::make_unique<MacScheduler>(cfg, true)),
       stats_(std::make_unique<Stats>(cfg)),
       phy_stats_(std::make_unique<PhyStats>(cfg, Direction::kUplink)),
+      own_workers_(own_workers),
       agora_memory_(std::make_unique<AgoraBuffer>(cfg)) {
   AGORA_LOG_INFO("Agora: project directory [%s], RDTSC frequency = %.2f GHz\n",
                  kProjectDirectory.c_str(), cfg->FreqGhz());
+  RtAssert(own_workers || (cfg->MasterRunsWorker() == false),
+           "Agora: the master thread runs doers only with its own workers");
+  master_budget_tsc_ =
+      GetTime::UsToCycles(cfg->MasterTaskBudgetUs(), cfg->FreqGhz());
 
   PinToCoreWithOffset(ThreadType::kMaster, cfg->CoreOffset(), 0,
                       kEnableCoreReuse, false /* quiet */);
@@ -70,10 +94,27 @@ Agora::Agora(Config* const cfg)
   message_ = std::make_unique<MessageInfo>(
       kDefaultWorkerQueueSize * config_->Frame().NumDataSyms(),
       kDefaultMessageQueueSize * config_->Frame().NumDataSyms(),
-      config_->SocketThreadNum());
+      config_->SocketThreadNum(), config_->PipelineDepth());
+  if (config_->RxEventRings()) {
+    message_->EnableRxRings(kDefaultMessageQueueSize *
+                            config_->Frame().NumDataSyms());
+  }
+  for (auto& held : held_events_) {
+    held.reserve(kDefaultWorkerQueueSize);
+  }
+  if (config_->WorkStealing()) {
+    message_->EnableWorkStealing(config_->WorkerThreadNum());
+    message_->GetWorkStealing()->SetAffinityWidth(config_->DecodeUeAffinity());
+  }
 
   InitializeCounters();
+  if (config_->PrefaultBuffers() || config_->LockMemory()) {
+    // Overlaps the thread creation and the radio bring-up of Start()
+    agora_memory_->StartPrefault();
+  }
+  const double threads_start_us = GetTime::GetTimeUs();
   InitializeThreads();
+  threads_time_ms_ = (GetTime::GetTimeUs() - threads_start_us) / 1000.0;
 
   if (kRecordUplinkFrame) {
     recorder_ = std::make_unique<Agora_recorder::RecorderThread>(
@@ -84,18 +125,90 @@ Agora::Agora(Config* const cfg)
             kDefaultQueueSize,
         0, config_->BsAntNum(), kRecordFrameInterval, Direction::kUplink,
         kRecorderTypes, true);
+    if (config_->CaptureFrames() > 0) {
+      recorder_->EnableCapture(config_->CaptureFrames());
+      const size_t ul_frame_entries =
+          config_->Frame().NumULSyms() * config_->OfdmDataNum();
+      for (const auto& table : config_->CaptureTables()) {
+        // Each table holds a frame contiguously in its frame window slot
+        std::vector<const void*> frame_data;
+        size_t frame_bytes;
+        std::vector<uint8_t> header;
+        if (table == "csi") {
+          for (size_t i = 0; i < config_->FrameWindow(); i++) {
+            frame_data.push_back(agora_memory_->GetCsi()[i][0]);
+          }
+          frame_bytes = config_->UeAntNum() * config_->BsAntNum() *
+                        config_->OfdmDataNum() * sizeof(complex_float);
+        } else if (table == "equal") {
+          for (size_t i = 0; i < config_->FrameWindow(); i++) {
+            frame_data.push_back(agora_memory_->GetEqual()
+                                     [config_->GetTotalDataSymbolIdxUl(i, 0)]);
+          }
+          frame_bytes = ul_frame_entries * config_->SpatialStreamsNum() *
+                        sizeof(complex_float);
+        } else {
+          for (size_t i = 0; i < config_->FrameWindow(); i++) {
+            frame_data.push_back(agora_memory_->GetDemod()[i][0][0]);
+          }
+          // The LLRs are packed as in the buffer, so the file starts with
+          // their bits: 8 for int8 LLRs, 4 or 6 for packed_llr.h chunks
+          frame_bytes = config_->Frame().NumULSyms() *
+                        config_->SpatialStreamsNum() *
+                        PackedLlrBytes(kMaxModType * config_->OfdmDataNum(),
+                                       config_->DemodLlrBits());
+          header.push_back(static_cast<uint8_t>(config_->DemodLlrBits()));
+        }
+        recorder_->AddCaptureTable(table, std::move(frame_data), frame_bytes,
+                                   std::move(header));
+      }
+      capture_evm_avg_.assign(config_->UeAntNum(), NAN);
+      SignalHandler signal_handler;
+      signal_handler.SetupCaptureSignalHandler();
+    }
     recorder_->Start();
+  } else if (config_->CaptureFrames() > 0) {
+    AGORA_LOG_WARN(
+        "Agora: capture_frames needs the recorder, built with ENABLE_HDF5\n");
+  }
+
+  if (config_->BsTelemetryPort() != 0) {
+    telemetry_ = std::make_unique<TelemetryServer>(
+        "agora", config_->TelemetryAddr(), config_->BsTelemetryPort(),
+        std::vector<std::string>{"rx", "tx", "task", "complete", "mac"},
+        config_->TelemetryIntervalMs(), config_->FreqGhz());
+  }
+
+  if (config_->FrameLog()) {
+    InitializeFrameLog();
+  }
+
+  if (config_->AdaptiveBlockTargetUs() > 0.0) {
+    RtAssert(kIsWorkerTimingEnabled,
+             "adaptive_block_target_us needs the worker timing");
+    block_sizer_ = std::make_unique<BlockSizeController>(
+        config_->AdaptiveBlockTargetUs(), config_->WorkerThreadNum(),
+        kBatchEventsPerWorker);
   }
 
   duration_stat_ = stats_->GetDurationStat(DoerType::kSched, 0);
 }
 
 Agora::~Agora() {
+  telemetry_.reset();
+  frame_log_.reset();
+  rx_manager_.reset();
   if (kEnableMac == true) {
     mac_std_thread_.join();
   }
 
   worker_.reset();
+  stall_monitor_.reset();
+  analog_beams_.reset();
+  // The TxRx threads are already stopped by Stop()
+  if (tracer_ != nullptr) {
+    tracer_->WriteJson(kTraceFilename);
+  }
   if (recorder_ != nullptr) {
     AGORA_LOG_INFO("Waiting for Recording to complete\n");
     recorder_->Stop();
@@ -104,11 +217,30 @@ Agora::~Agora() {
   stats_.reset();
   phy_stats_.reset();
   message_.reset();  // remove tokens for each doer
+  rx_filler_samples_.Free();
+}
+
+AgoraWorker::Cell Agora::WorkerCell() {
+  AgoraWorker::Cell cell;
+  cell.cfg_ = config_;
+  cell.mac_sched_ = mac_sched_.get();
+  cell.stats_ = stats_.get();
+  cell.phy_stats_ = phy_stats_.get();
+  cell.message_ = message_.get();
+  cell.buffer_ = agora_memory_.get();
+  cell.frame_ = &frame_tracking_;
+  cell.tracer_ = tracer_.get();
+  cell.taps_ = taps_.get();
+  cell.stall_monitor_ = stall_monitor_.get();
+  cell.analog_beams_ = analog_beams_.get();
+  return cell;
 }
 
 void Agora::Stop() {
   AGORA_LOG_INFO("Agora: terminating\n");
   config_->Running(false);
+  // The RX thread handles the packets of the TXRX threads until it ends
+  rx_manager_->Stop();
   usleep(1000);
   packet_tx_rx_.reset();
 }
@@ -131,6 +263,15 @@ void Agora::SendSnrReport(EventType event_type, size_t frame_id,
 #endif
 
 void Agora::ScheduleDownlinkProcessing(size_t frame_id) {
+  mac_sched_->ScheduleFrame(frame_id);
+  // A frame that cannot meet its TX slot would only delay the later frames
+  if ((config_->DlDeadlineMarginUs() > 0.0) &&
+      (config_->Frame().NumDLSyms() > 0) &&
+      (DlSlackUs(frame_id) < config_->DlDeadlineMarginUs())) {
+    DropDownlink(frame_id);
+    return;
+  }
+
   // Schedule broadcast symbols generation
   if (config_->Frame().NumDlControlSyms() > 0) {
     ScheduleBroadCastSymbols(EventType::kBroadcast, frame_id);
@@ -140,8 +281,7 @@ void Agora::ScheduleDownlinkProcessing(size_t frame_id) {
   size_t num_pilot_symbols = config_->Frame().ClientDlPilotSymbols();
   for (size_t i = 0; i < num_pilot_symbols; i++) {
     if (beam_last_frame_ == frame_id) {
-      ScheduleSubcarriers(EventType::kPrecode, frame_id,
-                          config_->Frame().GetDLSymbol(i));
+      SchedulePrecode(frame_id, config_->Frame().GetDLSymbol(i));
     } else {
       encode_cur_frame_for_symbol_.at(i) = frame_id;
     }
@@ -154,30 +294,38 @@ void Agora::ScheduleDownlinkProcessing(size_t frame_id) {
   }
 }
 
+void Agora::SchedulePrecode(size_t frame_id, size_t symbol_id) {
+  if (config_->FusePrecodeIfft()) {
+    // Each IFFT task precodes its antenna first
+    ScheduleAntennas(EventType::kIFFT, frame_id, symbol_id);
+  } else {
+    ScheduleSubcarriers(EventType::kPrecode, frame_id, symbol_id);
+  }
+}
+
 void Agora::ScheduleAntennas(EventType event_type, size_t frame_id,
                              size_t symbol_id) {
   assert(event_type == EventType::kFFT or event_type == EventType::kIFFT);
   auto base_tag = gen_tag_t::FrmSymAnt(frame_id, symbol_id, 0);
 
-  size_t num_blocks = config_->BsAntNum() / config_->FftBlockSize();
-  size_t num_remainder = config_->BsAntNum() % config_->FftBlockSize();
-  if (num_remainder > 0) {
-    num_blocks++;
-  }
+  // A batched IFFT task covers all the antennas, from the tag of antenna 0
+  const size_t num_tasks =
+      ((event_type == EventType::kIFFT) && config_->IfftBatchSymbol())
+          ? 1
+          : config_->BsAntNum();
+  const size_t batch_size = EventBatchSize(num_tasks, config_->FftBlockSize());
   EventData event;
-  event.num_tags_ = config_->FftBlockSize();
   event.event_type_ = event_type;
-  size_t qid = frame_id & 0x1;
-  for (size_t i = 0; i < num_blocks; i++) {
-    if ((i == num_blocks - 1) && num_remainder > 0) {
-      event.num_tags_ = num_remainder;
-    }
+  size_t qid = Qid(frame_id);
+  for (size_t i = 0; i < num_tasks; i += batch_size) {
+    event.num_tags_ = std::min(batch_size, num_tasks - i);
     for (size_t j = 0; j < event.num_tags_; j++) {
       event.tags_[j] = base_tag.tag_;
       base_tag.ant_id_++;
     }
 
-    message_->EnqueueEventTaskQueue(event_type, qid, event);
+    message_->EnqueueEventTaskQueue(event_type, qid, event,
+                                    GetTaskPriority(event_type, frame_id));
   }
 }
 
@@ -243,38 +391,119 @@ void Agora::ScheduleSubcarriers(EventType event_type, size_t frame_id,
       RtAssert(false, "Invalid event type in ScheduleSubcarriers");
     }
   }
+  if (config_->GpuUplink() && (event_type != EventType::kPrecode)) {
+    // DoUplinkGpu computes all the subcarriers of the frame or symbol at once
+    num_events = 1;
+    block_size = config_->OfdmDataNum();
+  }
 
-  const size_t qid = (frame_id & 0x1);
-  for (size_t i = 0; i < num_events; i++) {
-    message_->EnqueueEventTaskQueue(event_type, qid,
-                                    EventData(event_type, base_tag.tag_));
-    base_tag.sc_id_ += block_size;
+  // Each tag is one block of subcarriers
+  const size_t batch_size =
+      (block_sizer_ != nullptr)
+          ? block_sizer_->BlocksPerEvent(event_type, num_events)
+          : EventBatchSize(num_events, 1);
+  EventData event;
+  event.event_type_ = event_type;
+  const size_t qid = Qid(frame_id);
+  for (size_t i = 0; i < num_events; i += batch_size) {
+    event.num_tags_ = std::min(batch_size, num_events - i);
+    for (size_t j = 0; j < event.num_tags_; j++) {
+      event.tags_[j] = base_tag.tag_;
+      base_tag.sc_id_ += block_size;
+    }
+    message_->EnqueueEventTaskQueue(event_type, qid, event,
+                                    GetTaskPriority(event_type, frame_id));
   }
 }
 
 void Agora::ScheduleCodeblocks(EventType event_type, Direction dir,
                                size_t frame_id, size_t symbol_idx) {
   auto base_tag = gen_tag_t::FrmSymCb(frame_id, symbol_idx, 0);
-  const size_t num_tasks = config_->SpatialStreamsNum() *
-                           config_->LdpcConfig(dir).NumBlocksInSymbol();
-  size_t num_blocks = num_tasks / config_->EncodeBlockSize();
-  const size_t num_remainder = num_tasks % config_->EncodeBlockSize();
-  if (num_remainder > 0) {
-    num_blocks++;
-  }
+  const size_t num_blocks = config_->LdpcConfig(dir).NumBlocksInSymbol();
+  const size_t num_tasks = config_->SpatialStreamsNum() * num_blocks;
+  // Batched encoding gives each event as many code blocks as it holds, which
+  // DoEncode encodes together in SIMD lanes
+  const size_t batch_size =
+      ((event_type == EventType::kEncode) && config_->BatchEncode())
+          ? EventData::kMaxTags
+          : EventBatchSize(num_tasks, config_->EncodeBlockSize());
+  // With UE affinity, the events of decode do not span UEs, and go to the
+  // workers of their UE
+  const bool ue_affinity =
+      (event_type == EventType::kDecode) && (config_->DecodeUeAffinity() > 0);
   EventData event;
-  event.num_tags_ = config_->EncodeBlockSize();
   event.event_type_ = event_type;
-  size_t qid = frame_id & 0x1;
-  for (size_t i = 0; i < num_blocks; i++) {
-    if ((i == num_blocks - 1) && num_remainder > 0) {
-      event.num_tags_ = num_remainder;
+  size_t qid = Qid(frame_id);
+  for (size_t i = 0; i < num_tasks; i += event.num_tags_) {
+    event.num_tags_ = std::min(batch_size, num_tasks - i);
+    if (ue_affinity) {
+      event.num_tags_ =
+          std::min<size_t>(event.num_tags_, num_blocks - (i % num_blocks));
     }
     for (size_t j = 0; j < event.num_tags_; j++) {
       event.tags_[j] = base_tag.tag_;
       base_tag.cb_id_++;
     }
-    message_->EnqueueEventTaskQueue(event_type, qid, event);
+    if (ue_affinity) {
+      message_->EnqueueAffineTask(event_type, qid, event,
+                                  GetTaskPriority(event_type, frame_id),
+                                  i / num_blocks);
+    } else {
+      message_->EnqueueEventTaskQueue(event_type, qid, event,
+                                      GetTaskPriority(event_type, frame_id));
+    }
+  }
+}
+
+void Agora::ScheduleCodeblockGroup(size_t frame_id, size_t symbol_id,
+                                   size_t first_cb, size_t num_cbs) {
+  const size_t num_blocks =
+      config_->LdpcConfig(Direction::kUplink).NumBlocksInSymbol();
+  const size_t num_tasks = config_->SpatialStreamsNum() * num_cbs;
+  const size_t batch_size =
+      EventBatchSize(num_tasks, config_->EncodeBlockSize());
+  const bool ue_affinity = (config_->DecodeUeAffinity() > 0);
+  const TaskPriority priority = GetTaskPriority(EventType::kDecode, frame_id);
+  EventData event;
+  event.event_type_ = EventType::kDecode;
+  event.num_tags_ = 0;
+  const size_t qid = Qid(frame_id);
+  const auto enqueue = [&](size_t ss_id) {
+    if (ue_affinity) {
+      message_->EnqueueAffineTask(EventType::kDecode, qid, event, priority,
+                                  ss_id);
+    } else {
+      message_->EnqueueEventTaskQueue(EventType::kDecode, qid, event,
+                                      priority);
+    }
+    event.num_tags_ = 0;
+  };
+  for (size_t ss_id = 0; ss_id < config_->SpatialStreamsNum(); ss_id++) {
+    for (size_t cb = first_cb; cb < first_cb + num_cbs; cb++) {
+      event.tags_[event.num_tags_] =
+          gen_tag_t::FrmSymCb(frame_id, symbol_id, (ss_id * num_blocks) + cb)
+              .tag_;
+      event.num_tags_++;
+      if (event.num_tags_ == batch_size) {
+        enqueue(ss_id);
+      }
+    }
+    // With UE affinity, the events do not span UEs
+    if (ue_affinity && (event.num_tags_ > 0)) {
+      enqueue(ss_id);
+    }
+  }
+  if (event.num_tags_ > 0) {
+    enqueue(0);
+  }
+}
+
+void Agora::ScheduleTransportBlocks(size_t frame_id) {
+  for (size_t i = 0; i < config_->SpatialStreamsNum(); i++) {
+    const MacTbDescriptor tb = {static_cast<uint32_t>(frame_id),
+                                static_cast<uint32_t>(i)};
+    // The ring holds the transport blocks of a whole frame window
+    RtAssert(mac_tb_ring_->TryPush(tb), "Agora: MAC-PHY ring full");
   }
 }
 
@@ -291,72 +520,228 @@ void Agora::ScheduleUsers(EventType event_type, size_t frame_id,
   }
 }
 
+size_t Agora::EventBatchSize(size_t num_tasks, size_t min_batch_size) const {
+  if (config_->EventBatching() == false) {
+    return min_batch_size;
+  }
+  const size_t batch_size = std::min(
+      num_tasks / (kBatchEventsPerWorker * config_->WorkerThreadNum()),
+      EventData::kMaxTags);
+  return std::max(batch_size, min_batch_size);
+}
+
+TaskPriority Agora::GetTaskPriority(EventType event_type,
+                                    size_t frame_id) const {
+  if ((event_type == EventType::kIFFT) ||
+      ((event_type == EventType::kDecode) &&
+       (frame_id == frame_tracking_.cur_proc_frame_id_))) {
+    return TaskPriority::kCritical;
+  }
+  if ((config_->DlDeadlineMarginUs() > 0.0) &&
+      ((event_type == EventType::kEncode) ||
+       (event_type == EventType::kPrecode)) &&
+      (DlSlackUs(frame_id) < config_->GetFrameDurationSec() * 1e6)) {
+    return TaskPriority::kCritical;
+  }
+  return TaskPriority::kNormal;
+}
+
+void Agora::SetDlDeadline(size_t frame_id, size_t symbol_id) {
+  size_t first_dl_symbol = config_->Frame().GetDLSymbol(0);
+  if (config_->Frame().NumDlControlSyms() > 0) {
+    first_dl_symbol =
+        std::min(first_dl_symbol, config_->Frame().GetDLControlSymbol(0));
+  }
+  // The radios transmit the downlink of a frame TX_FRAME_DELTA frames after
+  // receiving it, see TxRxWorkerHw::DoTx
+  const long long tx_offset =
+      config_->SymbolTimeOffset(frame_id + TX_FRAME_DELTA, first_dl_symbol) -
+      config_->SymbolTimeOffset(frame_id, symbol_id);
+  DlDeadline& deadline = dl_deadlines_.at(frame_id % kFrameWnd);
+  deadline.frame_id_ = frame_id;
+  deadline.dropped_ = false;
+  deadline.tx_tsc_ =
+      GetTime::Rdtsc() + GetTime::UsToCycles(tx_offset * 1e6 / config_->Rate(),
+                                             config_->FreqGhz());
+}
+
+void Agora::BuildMasterSchedule() {
+  // Finishing the stages of a frame first frees its slot and meets its TX
+  // slot before the next frame's stages start
+  static constexpr std::array<EventType, 9> kStageOrder = {
+      EventType::kIFFT,   EventType::kBroadcast, EventType::kPrecode,
+      EventType::kEncode, EventType::kDecode,    EventType::kDemul,
+      EventType::kBeam,   EventType::kFFTSymbol, EventType::kFFT};
+  master_schedule_.clear();
+  const size_t oldest_frame = frame_tracking_.cur_proc_frame_id_;
+  for (const bool critical : {true, false}) {
+    for (size_t frame_id = oldest_frame;
+         frame_id < oldest_frame + config_->PipelineDepth(); frame_id++) {
+      for (const EventType event_type : kStageOrder) {
+        if ((GetTaskPriority(event_type, frame_id) ==
+             TaskPriority::kCritical) == critical) {
+          master_schedule_.push_back({event_type, Qid(frame_id)});
+        }
+      }
+    }
+  }
+}
+
+void Agora::RunMasterTasks() {
+  BuildMasterSchedule();
+  const size_t start_tsc = GetTime::Rdtsc();
+  const size_t num_tasks =
+      worker_->RunWorkerFor(master_budget_tsc_, master_schedule_);
+  if (num_tasks > 0) {
+    master_task_rounds_++;
+    master_tasks_ += num_tasks;
+    if (GetTime::Rdtsc() - start_tsc >= master_budget_tsc_) {
+      master_task_full_rounds_++;
+    }
+  }
+}
+
+double Agora::DlSlackUs(size_t frame_id) const {
+  const DlDeadline& deadline = dl_deadlines_.at(frame_id % kFrameWnd);
+  if (deadline.frame_id_ != frame_id) {
+    return std::numeric_limits<double>::infinity();
+  }
+  const size_t now = GetTime::Rdtsc();
+  if (now > deadline.tx_tsc_) {
+    return -GetTime::CyclesToUs(now - deadline.tx_tsc_, config_->FreqGhz());
+  }
+  return GetTime::CyclesToUs(deadline.tx_tsc_ - now, config_->FreqGhz());
+}
+
+bool Agora::IsDlDropped(size_t frame_id) const {
+  const DlDeadline& deadline = dl_deadlines_.at(frame_id % kFrameWnd);
+  return (deadline.frame_id_ == frame_id) && deadline.dropped_;
+}
+
+void Agora::DropDownlink(size_t frame_id) {
+  AGORA_LOG_WARN(
+      "Agora: Dropping the downlink of frame %zu, %.1f us before its TX "
+      "slot\n",
+      frame_id, DlSlackUs(frame_id));
+  dl_deadlines_.at(frame_id % kFrameWnd).dropped_ = true;
+  stats_->MasterDlFrameDropped();
+  if (CaptureEnabled() && config_->CaptureDeadlineMiss()) {
+    recorder_->TriggerCapture(frame_id,
+                              Agora_recorder::CaptureTrigger::kDeadlineMiss);
+  }
+  // Otherwise CheckIncrementScheduleFrame marks the downlink complete when
+  // it moves to frame_id
+  if (frame_tracking_.cur_sche_frame_id_ == frame_id) {
+    CheckIncrementScheduleFrame(frame_id, kDownlinkComplete);
+  }
+}
+
+bool Agora::CaptureEnabled() const {
+  return (recorder_ != nullptr) && (config_->CaptureFrames() > 0);
+}
+
+void Agora::CheckCaptureEvm(size_t frame_id, const arma::uvec& ue_map) {
+  if (config_->CaptureEvmDrop() <= 0.0f) {
+    return;
+  }
+  // Exponential average over about the last 16 frames of each UE
+  static constexpr float kEvmAvgWeight = 1.0f / 16.0f;
+  bool dropped = false;
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    if (ue_map.at(i) == 0) {
+      continue;
+    }
+    const float snr = phy_stats_->LatestSnr(i);
+    if (std::isfinite(snr) == false) {
+      continue;
+    }
+    float& avg = capture_evm_avg_.at(i);
+    if (std::isnan(avg)) {
+      avg = snr;
+    } else if ((avg - snr) > config_->CaptureEvmDrop()) {
+      AGORA_LOG_WARN(
+          "Agora: EVM SNR of UE %zu dropped to %.1f dB (average %.1f dB) in "
+          "frame %zu\n",
+          i, snr, avg, frame_id);
+      dropped = true;
+    }
+    avg += kEvmAvgWeight * (snr - avg);
+  }
+  if (dropped) {
+    recorder_->TriggerCapture(frame_id,
+                              Agora_recorder::CaptureTrigger::kEvmDrop);
+  }
+}
+
+void Agora::CheckCaptureCrc(size_t frame_id) {
+  if (config_->CaptureCrcBurst() == 0) {
+    return;
+  }
+  if (phy_stats_->PopFrameBlockErrors(frame_id) == 0) {
+    capture_crc_frames_ = 0;
+    return;
+  }
+  capture_crc_frames_++;
+  if (capture_crc_frames_ == config_->CaptureCrcBurst()) {
+    recorder_->TriggerCapture(frame_id,
+                              Agora_recorder::CaptureTrigger::kCrcBurst);
+    capture_crc_frames_ = 0;
+  }
+}
+
 void Agora::ScheduleBroadCastSymbols(EventType event_type, size_t frame_id) {
   auto base_tag = gen_tag_t::FrmSym(frame_id, 0u);
-  const size_t qid = (frame_id & 0x1);
+  const size_t qid = Qid(frame_id);
   message_->EnqueueEventTaskQueue(event_type, qid,
                                   EventData(event_type, base_tag.tag_));
 }
 
 void Agora::TryScheduleFft() {
-  const auto& cfg = this->config_;
-  std::queue<fft_req_tag_t>& cur_fftq =
-      fft_queue_arr_.at(frame_tracking_.cur_sche_frame_id_ % kFrameWnd);
-  const size_t qid = frame_tracking_.cur_sche_frame_id_ & 0x1;
-
-  if (cur_fftq.size() >= config_->FftBlockSize()) {
-    const size_t num_fft_blocks = cur_fftq.size() / config_->FftBlockSize();
-    for (size_t i = 0; i < num_fft_blocks; i++) {
-      EventData do_fft_task;
-      do_fft_task.num_tags_ = config_->FftBlockSize();
-      do_fft_task.event_type_ = EventType::kFFT;
-
-      for (size_t j = 0; j < config_->FftBlockSize(); j++) {
-        RtAssert(!cur_fftq.empty(),
-                 "Using front element cur_fftq when it is empty");
-        do_fft_task.tags_[j] = cur_fftq.front().tag_;
-        cur_fftq.pop();
-
-        if (this->fft_created_count_ == 0) {
-          this->stats_->MasterSetTsc(TsType::kProcessingStarted,
-                                     frame_tracking_.cur_sche_frame_id_);
-          stats_->PrintPerFrameDone(PrintType::kProcessingStart,
-                                    frame_tracking_.cur_sche_frame_id_);
-        }
-        this->fft_created_count_++;
-        if (this->fft_created_count_ == rx_counters_.num_rx_pkts_per_frame_) {
-          this->fft_created_count_ = 0;
-          if (cfg->BigstationMode() == true) {
-            this->CheckIncrementScheduleFrame(
-                frame_tracking_.cur_sche_frame_id_, kUplinkComplete);
-          }
-        }
-      }
-      message_->EnqueueEventTaskQueue(EventType::kFFT, qid, do_fft_task);
-    }
+  if (rx_manager_->Threaded()) {
+    rx_manager_->PublishFrames(frame_tracking_);
+    return;
+  }
+  const size_t frame_id = frame_tracking_.cur_sche_frame_id_;
+  if (rx_manager_->TryScheduleFft(frame_tracking_) &&
+      config_->BigstationMode()) {
+    this->CheckIncrementScheduleFrame(frame_id, kUplinkComplete);
   }
 }
 
 size_t Agora::FetchStreamerEvent(std::vector<EventData>& events_list) {
   size_t total_events = 0;
   size_t remaining_events = events_list.size();
-  for (size_t i = 0; i < config_->SocketThreadNum(); i++) {
+  size_t num_sockets = config_->SocketThreadNum();
+  if (rx_manager_->Threaded()) {
+    // The RX thread dequeues the packets, and hands over the frame starts
+    // and TX completions
+    total_events = rx_manager_->MasterQueue()->try_dequeue_bulk(
+        &events_list.at(0), remaining_events);
+    remaining_events = remaining_events - total_events;
+    num_sockets = 0;
+  }
+  // Round-robin over the sockets, so that the first ones do not take the
+  // whole events_list every time
+  for (size_t n = 0; n < num_sockets; n++) {
+    const size_t i = (rx_next_socket_ + n) % num_sockets;
     if (remaining_events > 0) {
       // Restrict the amount from each socket
-      const size_t request_events =
-          std::min(kDequeueBulkSizeTXRX, remaining_events);
-      const size_t new_events =
-          message_->GetRxConQ()->try_dequeue_bulk_from_producer(
-              *(message_->GetRxPTokPtr(i)), &events_list.at(total_events),
-              request_events);
+      AdaptiveBulk& bulk = rx_bulks_.at(i);
+      const size_t request_events = std::min(bulk.Size(), remaining_events);
+      const size_t new_events = message_->DequeueRxEvents(
+          i, &events_list.at(total_events), request_events);
+      bulk.Update(request_events, new_events);
       remaining_events = remaining_events - new_events;
       total_events = total_events + new_events;
     } else {
       AGORA_LOG_WARN("remaining_events = %zu:%zu, queue %zu num elements %zu\n",
                      remaining_events, total_events, i,
-                     message_->GetRxConQ()->size_approx());
+                     message_->RxQueueDepth());
     }
   }
+  if (num_sockets > 0) {
+    rx_next_socket_ = (rx_next_socket_ + 1) % num_sockets;
+  }
 
   if (kEnableMac) {
     if (remaining_events > 0) {
@@ -370,17 +755,71 @@ size_t Agora::FetchStreamerEvent(std::vector<EventData>& events_list) {
                      mac_response_queue_.size_approx());
     }
   }
+
+  if (mac_tb_done_ring_ != nullptr) {
+    MacTbDescriptor tb;
+    while ((remaining_events > 0) && mac_tb_done_ring_->TryPop(tb)) {
+      events_list.at(total_events) = EventData(
+          EventType::kPacketToMac,
+          gen_tag_t::FrmSymUe(tb.frame_id_, 0, tb.ue_id_).tag_);
+      total_events++;
+      remaining_events--;
+    }
+  }
   return total_events;
 }
 
+// Completions that may finish or transmit a frame, or that depend on the
+// earlier frames being done. The master handles them in frame order.
+static bool IsFrameOrdered(EventType event_type) {
+  switch (event_type) {
+    case EventType::kFFT:
+    case EventType::kFFTSymbol:
+    case EventType::kBeam:
+      return false;
+    case EventType::kDemul:
+      return kUplinkHardDemod;
+    default:
+      return true;
+  }
+}
+
 size_t Agora::FetchDoerEvent(std::vector<EventData>& events_list) {
-  return message_->DequeueEventCompQueueBulk(
-      frame_tracking_.cur_proc_frame_id_ & 0x1, events_list);
+  const size_t cur_frame = frame_tracking_.cur_proc_frame_id_;
+  std::vector<EventData>& held = held_events_.at(Qid(cur_frame));
+  if (held.empty() == false) {
+    const size_t num_events = std::min(held.size(), events_list.size());
+    std::copy(held.end() - num_events, held.end(), events_list.begin());
+    held.resize(held.size() - num_events);
+    return num_events;
+  }
+  const size_t request_events = doer_bulk_.Size();
+  size_t num_events = message_->DequeueEventCompQueueBulk(
+      Qid(cur_frame), events_list, request_events);
+  doer_bulk_.Update(request_events, num_events);
+  // Once the current frame has none, the FFT, beamweight and demodulation
+  // completions of the frames ahead, so that they overlap with its tail
+  for (size_t ahead = 1;
+       (num_events == 0) && (ahead < config_->PipelineDepth()); ahead++) {
+    const size_t qid = Qid(cur_frame + ahead);
+    const size_t num_ahead =
+        message_->DequeueEventCompQueueBulk(qid, events_list, request_events);
+    for (size_t i = 0; i < num_ahead; i++) {
+      if (IsFrameOrdered(events_list.at(i).event_type_)) {
+        held_events_.at(qid).push_back(events_list.at(i));
+      } else {
+        events_list.at(num_events) = events_list.at(i);
+        num_events++;
+      }
+    }
+  }
+  return num_events;
 }
 
 void Agora::Start() {
   const auto& cfg = this->config_;
 
+  const double txrx_start_us = GetTime::GetTimeUs();
   const bool start_status = packet_tx_rx_->StartTxRx(
       agora_memory_->GetCalibDl(), agora_memory_->GetCalibUl());
   // Start packet I/O
@@ -388,36 +827,87 @@ void Agora::Start() {
     this->Stop();
     return;
   }
+  PrintStartupProfile((GetTime::GetTimeUs() - txrx_start_us) / 1000.0);
+  if (config_->LockMemory()) {
+    // The prefault is joined, so this only faults in what it does not cover:
+    // the doer scratch buffers, the stacks and the I/O buffers
+    const double lock_start_us = GetTime::GetTimeUs();
+    if (Agora_memory::LockAllMemory()) {
+      AGORA_LOG_INFO("Agora: locked the memory in %.1f ms\n",
+                     (GetTime::GetTimeUs() - lock_start_us) / 1000.0);
+    } else {
+      AGORA_LOG_WARN(
+          "Agora: cannot lock the memory (%s), raise RLIMIT_MEMLOCK or run "
+          "with CAP_IPC_LOCK\n",
+          std::strerror(errno));
+    }
+  }
 
   // Counters for printing summary
   size_t tx_count = 0;
   double tx_begin = GetTime::GetTimeUs();
+  bench_start_tsc_ = GetTime::Rdtsc();
+
+  if (cfg->RxManager()) {
+    RtAssert(recorder_ == nullptr,
+             "rx_manager does not hand the received packets to the recorder");
+    // On the first core after the workers
+    rx_manager_->Start(base_worker_core_offset_ + cfg->DedicatedWorkerNum());
+  }
 
   bool is_turn_to_dequeue_from_io = true;
   const size_t max_events_needed =
       std::max(kDequeueBulkSizeTXRX * (cfg->SocketThreadNum() + 1 /* MAC */),
                kDequeueBulkSizeWorker * cfg->WorkerThreadNum());
-  std::vector<EventData> events_list(max_events_needed);
+  // The fixed sizes are the smallest adaptive ones
+  const size_t bulk_growth =
+      cfg->AdaptiveDequeue() ? kDequeueBulkMaxGrowth : 1;
+  rx_bulks_.assign(cfg->SocketThreadNum(),
+                   AdaptiveBulk(kDequeueBulkSizeTXRX,
+                                kDequeueBulkSizeTXRX * bulk_growth));
+  doer_bulk_ = AdaptiveBulk(max_events_needed, max_events_needed * bulk_growth);
+  std::vector<EventData> events_list(max_events_needed * bulk_growth);
 
   bool finish = false;
+  IdlePolicy idle(config_);
 
   while ((config_->Running() == true) &&
          (SignalHandler::GotExitSignal() == false) && (!finish)) {
     // size_t start_tsc = GetTime::WorkerRdtsc();
 
+    // With inline_txrx, this thread sends the pending TX and receives the
+    // packets whose events it fetches below
+    const bool io_done = cfg->InlineTxRx() && packet_tx_rx_->PollInline();
+
     // Get a batch of events
     const size_t num_events = is_turn_to_dequeue_from_io
                                   ? FetchStreamerEvent(events_list)
                                   : FetchDoerEvent(events_list);
 
     is_turn_to_dequeue_from_io = !is_turn_to_dequeue_from_io;
+    if ((num_events > 0) || io_done) {
+      idle.Busy();
+    } else {
+      idle.Idle();
+    }
+    if (CaptureEnabled() && SignalHandler::PopCaptureSignal()) {
+      recorder_->TriggerCapture(frame_tracking_.cur_sche_frame_id_,
+                                Agora_recorder::CaptureTrigger::kSignal);
+    }
     // duration_stat_->task_duration_[1] += GetTime::WorkerRdtsc() - start_tsc;
 
     // Handle each event
     for (size_t ev_i = 0; ev_i < num_events; ev_i++) {
       // size_t tsc0 = GetTime::WorkerRdtsc();
 
-      HandleEvents(events_list.at(ev_i), tx_count, tx_begin, finish);
+      if (tracer_ != nullptr) {
+        const size_t start_tsc = GetTime::Rdtsc();
+        HandleEvents(events_list.at(ev_i), tx_count, tx_begin, finish);
+        tracer_->MasterRing()->Record(events_list.at(ev_i), start_tsc,
+                                      GetTime::Rdtsc());
+      } else {
+        HandleEvents(events_list.at(ev_i), tx_count, tx_begin, finish);
+      }
       if (finish) {
         break;
       }
@@ -425,18 +915,55 @@ void Agora::Start() {
       // duration_stat_->task_count_++;
       // duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - tsc0;
 
-#ifdef SINGLE_THREAD
-      worker_->RunWorker();
-#endif
+      if (config_->MasterRunsWorker() && (master_budget_tsc_ == 0)) {
+        worker_->RunWorker();
+      }
     } /* End of for */
 
+    // With a budget, the master runs its tasks between the batches of
+    // events, even when there were none
+    if (master_budget_tsc_ > 0) {
+      RunMasterTasks();
+    }
+
+    if (rx_tracker_ != nullptr) {
+      CheckRxTimeout();
+    }
+    if ((telemetry_ != nullptr) && telemetry_->PublishDue()) {
+      PublishTelemetry();
+    }
+
     // duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
   } /* End of while */
 
   // finish:
+  idle.PrintSummary("Master");
+  if (master_task_rounds_ > 0) {
+    AGORA_LOG_INFO(
+        "Agora: master ran %zu tasks in %zu rounds of %.1f us, %.1f%% of "
+        "them using the whole budget\n",
+        master_tasks_, master_task_rounds_, config_->MasterTaskBudgetUs(),
+        100.0 * master_task_full_rounds_ / master_task_rounds_);
+  }
+  if (block_sizer_ != nullptr) {
+    block_sizer_->PrintSummary();
+  }
+  if (config_->BenchMode()) {
+    PrintBenchSummary(GetTime::Rdtsc());
+  }
+  if (rx_tracker_ != nullptr) {
+    AGORA_LOG_INFO(
+        "Agora: %zu frames timed out and went on with %zu packets lost, "
+        "%zu late and %zu duplicate packets dropped\n",
+        rx_tracker_->PartialFrames(), rx_tracker_->LostPackets(),
+        rx_tracker_->LatePackets(), rx_tracker_->DuplicatePackets());
+  }
   AGORA_LOG_INFO("Agora: printing stats and saving to file\n");
   this->stats_->PrintSummary();
-  this->stats_->SaveToFile();
+  // The frame log has the timestamps and stage times of every frame
+  if (frame_log_ == nullptr) {
+    this->stats_->SaveToFile();
+  }
   if (flags_.enable_save_decode_data_to_file_ == true) {
     SaveDecodeDataToFile(this->stats_->LastFrameId());
   }
@@ -448,9 +975,173 @@ void Agora::Start() {
   if ((kEnableMac == false) && (kPrintPhyStats == true)) {
     this->phy_stats_->PrintPhyStats();
   }
+  if (config_->AdaptiveDecodeIter()) {
+    this->phy_stats_->PrintDecodeIterStats();
+  }
+  if (agora_memory_->GetHarq() != nullptr) {
+    agora_memory_->GetHarq()->PrintSummary();
+  }
   this->Stop();
 }
 
+void Agora::PublishTelemetry() {
+  TelemetrySnapshot& snapshot = telemetry_->Staging();
+  const size_t frames = frame_tracking_.cur_proc_frame_id_;
+  const size_t dl_dropped = stats_->DlDroppedFrames();
+  snapshot.frames_ = frames;
+  // Each frame carries the payload of every spatial stream
+  snapshot.ul_bits_ = frames * config_->SpatialStreamsNum() *
+                      config_->MacDataBytesNumPerframe(Direction::kUplink) *
+                      8;
+  snapshot.dl_bits_ = (frames - std::min(frames, dl_dropped)) *
+                      config_->SpatialStreamsNum() *
+                      config_->MacDataBytesNumPerframe(Direction::kDownlink) *
+                      8;
+  snapshot.dl_dropped_frames_ = dl_dropped;
+  snapshot.rx_dropped_packets_ = packet_tx_rx_->RxDropped();
+  snapshot.acc_ops_in_flight_ = stats_->AccOpsInFlight();
+  snapshot.acc_decode_blocks_ = stats_->AccDecodeBlocks(false);
+  snapshot.acc_spilled_blocks_ = stats_->AccDecodeBlocks(true);
+  snapshot.queue_depths_ = {
+      message_->RxQueueDepth(),
+      message_->GetTxConQ()->size_approx(),
+      message_->TaskQueueDepth(),
+      message_->CompQueueDepth(),
+      mac_request_queue_.size_approx() + mac_response_queue_.size_approx()};
+
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    const auto ts_type = static_cast<TsType>(i);
+    snapshot.latency_frames_.at(i) = stats_->LatencyCount(ts_type);
+    if (snapshot.latency_frames_.at(i) == 0) {
+      continue;
+    }
+    for (size_t p = 0; p < TelemetrySnapshot::kPercentiles.size(); p++) {
+      snapshot.latency_us_.at(i).at(p) = stats_->LatencyPercentileUs(
+          ts_type, TelemetrySnapshot::kPercentiles.at(p));
+    }
+    snapshot.deadline_misses_.at(i) = stats_->DeadlineMisses(ts_type);
+  }
+
+  const RadioTiming* radio_timing = packet_tx_rx_->Timing();
+  snapshot.radio_timing_ = (radio_timing != nullptr);
+  if (radio_timing != nullptr) {
+    for (size_t i = 0; i < RadioTiming::kNumRxTypes; i++) {
+      snapshot.rx_arrival_.at(i) =
+          radio_timing->RxSummary(static_cast<RadioTiming::RxType>(i));
+    }
+    for (size_t i = 0; i < RadioTiming::kNumTxTypes; i++) {
+      snapshot.tx_lead_.at(i) =
+          radio_timing->TxSummary(static_cast<RadioTiming::TxType>(i));
+    }
+  }
+
+  snapshot.num_ues_ = config_->UeAntNum();
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    snapshot.snr_db_.at(i) = phy_stats_->LatestSnr(i);
+    snapshot.sinr_db_.at(i) = phy_stats_->LatestSinr(i);
+    snapshot.decode_iters_.at(i) = phy_stats_->MeanDecodeIterations(i);
+    phy_stats_->GetBlockCounts(i, &snapshot.decoded_blocks_.at(i),
+                               &snapshot.block_errors_.at(i));
+  }
+  telemetry_->Publish();
+}
+
+void Agora::InitializeFrameLog() {
+  using Column = FrameLog::Column;
+  using ColumnType = FrameLog::ColumnType;
+  std::vector<Column> columns;
+  columns.push_back({"frame_id", ColumnType::kU64});
+  columns.push_back({"first_symbol_rx_ns", ColumnType::kU64});
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    const auto ts_type = static_cast<TsType>(i);
+    if (ts_type != TsType::kFirstSymbolRX) {
+      columns.push_back({Stats::TsTypeName(ts_type) + "_us", ColumnType::kF32});
+    }
+  }
+  if (kIsWorkerTimingEnabled) {
+    for (const DoerType doer_type : kAllDoerTypes) {
+      std::string name = kDoerNames.at(doer_type);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      columns.push_back({name + "_us", ColumnType::kF32});
+    }
+  }
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    const std::string ue = "ue" + std::to_string(i) + "_";
+    columns.push_back({ue + "snr_db", ColumnType::kF32});
+    columns.push_back({ue + "evm_pct", ColumnType::kF32});
+    columns.push_back({ue + "blocks", ColumnType::kU64});
+    columns.push_back({ue + "block_errors", ColumnType::kU64});
+  }
+  columns.push_back({"air_to_mac_us", ColumnType::kF32});
+  columns.push_back({"mac_to_air_us", ColumnType::kF32});
+  columns.push_back({"dl_dropped", ColumnType::kU64});
+  columns.push_back({"rx_dropped_packets", ColumnType::kU64});
+  frame_log_blocks_.assign(config_->UeAntNum(), 0);
+  frame_log_block_errors_.assign(config_->UeAntNum(), 0);
+  frame_log_ = std::make_unique<FrameLog>(kFrameLogFilename, columns);
+}
+
+std::string Agora::DescribeQueues() const {
+  std::string description =
+      "queues: rx " + std::to_string(message_->RxQueueDepth()) + ", tx " +
+      std::to_string(message_->GetTxConQ()->size_approx()) + ", complete " +
+      std::to_string(message_->CompQueueDepth()) + ", tasks";
+  for (size_t i = 0; i < kNumEventTypes; i++) {
+    const auto event_type = static_cast<EventType>(i);
+    const size_t depth = message_->TaskQueueDepth(event_type);
+    if (depth > 0) {
+      description += std::string(" ") +
+                     EventTracer::EventTypeName(event_type) + " " +
+                     std::to_string(depth);
+    }
+  }
+  return description;
+}
+
+void Agora::LogFrame(size_t frame_id) {
+  FrameLog::Value* row = frame_log_->BeginRow();
+  if (row == nullptr) {
+    return;
+  }
+  // In the order of the columns of InitializeFrameLog()
+  size_t col = 0;
+  row[col++].u_ = frame_id;
+  row[col++].u_ =
+      static_cast<uint64_t>(stats_->MasterFrameStartUs(frame_id) * 1000.0);
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    const auto ts_type = static_cast<TsType>(i);
+    if (ts_type != TsType::kFirstSymbolRX) {
+      row[col++].f_ = stats_->MasterFrameLatencyUs(ts_type, frame_id);
+    }
+  }
+  if (kIsWorkerTimingEnabled) {
+    for (const DoerType doer_type : kAllDoerTypes) {
+      row[col++].f_ = stats_->DoerUs(doer_type, frame_id);
+    }
+  }
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    const double snr_db = phy_stats_->LatestSnr(i);
+    row[col++].f_ = snr_db;
+    row[col++].f_ = 100.0 * std::pow(10.0, -snr_db / 20.0);
+    // The code blocks counted since the previous frame
+    size_t blocks = 0;
+    size_t block_errors = 0;
+    phy_stats_->GetBlockCounts(i, &blocks, &block_errors);
+    row[col++].u_ = blocks - frame_log_blocks_.at(i);
+    row[col++].u_ = block_errors - frame_log_block_errors_.at(i);
+    frame_log_blocks_.at(i) = blocks;
+    frame_log_block_errors_.at(i) = block_errors;
+  }
+  row[col++].f_ = stats_->MasterAirToMacUs(frame_id);
+  row[col++].f_ = stats_->MasterMacToAirUs(frame_id);
+  row[col++].u_ = IsDlDropped(frame_id) ? 1 : 0;
+  const size_t rx_dropped = packet_tx_rx_->RxDropped();
+  row[col++].u_ = rx_dropped - frame_log_rx_dropped_;
+  frame_log_rx_dropped_ = rx_dropped;
+  RtAssert(col == frame_log_->NumColumns(), "Frame log row mismatch");
+  frame_log_->CommitRow();
+}
+
 void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
                          bool& finish) {
   const auto& cfg = this->config_;
@@ -466,61 +1157,84 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
         recorder_->DispatchWork(event);
       }
 
-      if (pkt->frame_id_ >=
-          ((frame_tracking_.cur_sche_frame_id_ + kFrameWnd))) {
-        AGORA_LOG_ERROR(
-            "Error: Received packet for future frame %u beyond "
-            "frame window (= %zu + %zu). This can happen if "
-            "Agora is running slowly, e.g., in debug mode\n",
-            pkt->frame_id_, frame_tracking_.cur_sche_frame_id_, kFrameWnd);
+      if (rx_manager_->InFrameWindow(pkt->frame_id_, frame_tracking_) ==
+          false) {
         cfg->Running(false);
         break;
       }
 
+      if ((rx_tracker_ != nullptr) &&
+          (rx_tracker_->Receive(pkt->frame_id_, pkt->symbol_id_,
+                                pkt->ant_id_, GetTime::Rdtsc()) !=
+           RxFrameTracker::RxStatus::kNew)) {
+        // The frame went on without this packet, or it is a copy
+        rx->Free();
+        break;
+      }
+
       UpdateRxCounters(pkt->frame_id_, pkt->symbol_id_);
-      fft_queue_arr_.at(pkt->frame_id_ % kFrameWnd)
-          .push(fft_req_tag_t(event.tags_[0]));
+      if (pkt->air_tsc_ != 0) {
+        stats_->MasterSetAirTsc(pkt->frame_id_, pkt->symbol_id_,
+                                pkt->air_tsc_);
+      }
+      rx_manager_->QueueFft(pkt->frame_id_, fft_req_tag_t(event.tags_[0]));
+    } break;
+
+    case EventType::kFrameStart: {
+      StartFrame(gen_tag_t(event.tags_[0]).frame_id_,
+                 gen_tag_t(event.tags_[0]).symbol_id_);
     } break;
 
     case EventType::kFFT: {
       for (size_t i = 0; i < event.num_tags_; i++) {
-        HandleEventFft(event.tags_[i]);
+        HandleEventFft(event.tags_[i], 1);
+      }
+    } break;
+
+    case EventType::kFFTSymbol: {
+      for (size_t i = 0; i < event.num_tags_; i++) {
+        HandleEventFft(event.tags_[i], config_->BsAntNum());
       }
     } break;
 
     case EventType::kBeam: {
-      for (size_t tag_id = 0; (tag_id < event.num_tags_); tag_id++) {
-        const size_t frame_id = gen_tag_t(event.tags_[tag_id]).frame_id_;
-        stats_->PrintPerTaskDone(PrintType::kBeam, frame_id, 0,
-                                 beam_counters_.GetTaskCount(frame_id), 0);
-        const bool last_beam_task = this->beam_counters_.CompleteTask(frame_id);
-        if (last_beam_task == true) {
-          this->stats_->MasterSetTsc(TsType::kBeamDone, frame_id);
-          beam_last_frame_ = frame_id;
-          stats_->PrintPerFrameDone(PrintType::kBeam, frame_id);
-          this->beam_counters_.Reset(frame_id);
-          if (kPrintBeamStats) {
-            this->phy_stats_->PrintBeamStats(frame_id);
-          }
+      // All the blocks of a batched event are of the same frame
+      const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
+      stats_->PrintPerTaskDone(PrintType::kBeam, frame_id, 0,
+                               beam_counters_.GetTaskCount(frame_id), 0);
+      // With shared counters, only the last beam tasks are posted
+      const bool last_beam_task =
+          config_->SharedCounters() || config_->GpuUplink() ||
+          this->beam_counters_.CompleteTasks(frame_id, event.num_tags_);
+      if (last_beam_task == true) {
+        this->stats_->MasterSetTsc(TsType::kBeamDone, frame_id);
+        beam_last_frame_ = frame_id;
+        if (message_->GetFftDemulFusion() != nullptr) {
+          message_->GetFftDemulFusion()->SetBeamReady(frame_id);
+        }
+        stats_->PrintPerFrameDone(PrintType::kBeam, frame_id);
+        this->beam_counters_.Reset(frame_id);
+        if (kPrintBeamStats) {
+          this->phy_stats_->PrintBeamStats(frame_id);
+        }
 
-          for (size_t i = 0; i < cfg->Frame().NumULSyms(); i++) {
-            if (this->fft_cur_frame_for_symbol_.at(i) == frame_id) {
-              ScheduleSubcarriers(EventType::kDemul, frame_id,
-                                  cfg->Frame().GetULSymbol(i));
-            }
+        for (size_t i = 0; i < cfg->Frame().NumULSyms(); i++) {
+          if (this->fft_cur_frame_for_symbol_.at(i) == frame_id) {
+            ScheduleSubcarriers(EventType::kDemul, frame_id,
+                                cfg->Frame().GetULSymbol(i));
           }
-          // Schedule precoding for downlink symbols
-          for (size_t i = 0; i < cfg->Frame().NumDLSyms(); i++) {
-            const size_t last_encoded_frame =
-                this->encode_cur_frame_for_symbol_.at(i);
-            if ((last_encoded_frame != SIZE_MAX) &&
-                (last_encoded_frame >= frame_id)) {
-              ScheduleSubcarriers(EventType::kPrecode, frame_id,
-                                  cfg->Frame().GetDLSymbol(i));
-            }
+        }
+        // Schedule precoding for downlink symbols
+        for (size_t i = 0; i < cfg->Frame().NumDLSyms(); i++) {
+          const size_t last_encoded_frame =
+              this->encode_cur_frame_for_symbol_.at(i);
+          if ((last_encoded_frame != SIZE_MAX) &&
+              (last_encoded_frame >= frame_id) &&
+              (IsDlDropped(frame_id) == false)) {
+            SchedulePrecode(frame_id, cfg->Frame().GetDLSymbol(i));
           }
-        }  // end if (beam_counters_.last_task(frame_id) == true)
-      }
+        }
+      }  // end if (beam_counters_.last_task(frame_id) == true)
     } break;
 
     case EventType::kDemul: {
@@ -532,11 +1246,29 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
           PrintType::kDemul, frame_id, symbol_id, base_sc_id,
           demul_counters_.GetTaskCount(frame_id, symbol_id));
 
+      // All the blocks of a batched event are of the same symbol. With shared
+      // counters, only the last blocks of the symbol are posted.
       const bool last_demul_task =
-          this->demul_counters_.CompleteTask(frame_id, symbol_id);
+          config_->SharedCounters() || config_->GpuUplink() ||
+          this->demul_counters_.CompleteTasks(frame_id, symbol_id,
+                                              event.num_tags_);
+
+      if ((kUplinkHardDemod == false) && (demul_status_ != nullptr)) {
+        // Decode the code blocks whose LLRs are all demodulated
+        const size_t symbol_idx_ul = cfg->Frame().GetULSymbolIdx(symbol_id);
+        for (size_t i = 0; i < event.num_tags_; i++) {
+          size_t first_cb;
+          const size_t num_cbs = demul_status_->CompleteBlock(
+              frame_id, symbol_idx_ul, gen_tag_t(event.tags_[i]).sc_id_,
+              first_cb);
+          if (num_cbs > 0) {
+            ScheduleCodeblockGroup(frame_id, symbol_id, first_cb, num_cbs);
+          }
+        }
+      }
 
       if (last_demul_task == true) {
-        if (kUplinkHardDemod == false) {
+        if ((kUplinkHardDemod == false) && (demul_status_ == nullptr)) {
           ScheduleCodeblocks(EventType::kDecode, Direction::kUplink, frame_id,
                              symbol_id);
         }
@@ -546,7 +1278,6 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
         const bool last_demul_symbol =
             this->demul_counters_.CompleteSymbol(frame_id);
         if (last_demul_symbol == true) {
-          max_equaled_frame_ = frame_id;
           this->stats_->MasterSetTsc(TsType::kDemulDone, frame_id);
           stats_->PrintPerFrameDone(PrintType::kDemul, frame_id);
           auto ue_map = mac_sched_->ScheduledUeMap(frame_id, 0u);
@@ -558,7 +1289,16 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
           this->phy_stats_->RecordCsiCond(frame_id, config_->LogScNum());
           this->phy_stats_->RecordEvm(frame_id, config_->LogScNum(), ue_map);
           this->phy_stats_->RecordEvmSnr(frame_id, ue_map);
+          this->phy_stats_->UpdateLatestSnr(frame_id, ue_map);
 #endif
+          if (CaptureEnabled()) {
+            if (config_->CaptureTables().empty() == false) {
+              recorder_->CaptureFrame(frame_id);
+            }
+#if !defined(TIME_EXCLUSIVE)
+            CheckCaptureEvm(frame_id, ue_map);
+#endif
+          }
           if (kUplinkHardDemod) {
             this->phy_stats_->RecordBer(frame_id, ue_map);
             this->phy_stats_->RecordSer(frame_id, ue_map);
@@ -595,15 +1335,21 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
       const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
       const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
 
+      // All the code blocks of a batched event are of the same symbol
       const bool last_decode_task =
-          this->decode_counters_.CompleteTask(frame_id, symbol_id);
+          config_->SharedCounters() ||
+          this->decode_counters_.CompleteTasks(frame_id, symbol_id,
+                                               event.num_tags_);
       if (last_decode_task == true) {
-        if (kEnableMac == true) {
+        if ((kEnableMac == true) && (mac_tb_ring_ == nullptr)) {
           ScheduleUsers(EventType::kPacketToMac, frame_id, symbol_id);
         }
         stats_->PrintPerSymbolDone(
             PrintType::kDecode, frame_id, symbol_id,
             decode_counters_.GetSymbolCount(frame_id) + 1);
+        if (config_->UlMiniSlotSymbols() > 0) {
+          CompleteMiniSlotSymbol(frame_id, symbol_id);
+        }
         const bool last_decode_symbol =
             this->decode_counters_.CompleteSymbol(frame_id);
         if (last_decode_symbol == true) {
@@ -612,6 +1358,12 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
           auto ue_map = mac_sched_->ScheduledUeMap(frame_id, 0u);
           this->phy_stats_->RecordBer(frame_id, ue_map);
           this->phy_stats_->RecordSer(frame_id, ue_map);
+          if (CaptureEnabled()) {
+            CheckCaptureCrc(frame_id);
+          }
+          if (mac_tb_ring_ != nullptr) {
+            ScheduleTransportBlocks(frame_id);
+          }
           if (kEnableMac == false) {
             assert(frame_tracking_.cur_proc_frame_id_ == frame_id);
             const bool work_finished = this->CheckFrameComplete(frame_id);
@@ -635,26 +1387,34 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
 
     case EventType::kPacketToMac: {
       const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-      const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
+      // A transport block back from the MAC-PHY ring completes the tasks of
+      // all the uplink symbols of its UE
+      const size_t num_symbols =
+          (mac_tb_ring_ != nullptr) ? cfg->Frame().NumULSyms() : 1;
+      for (size_t i = 0; i < num_symbols; i++) {
+        const size_t symbol_id = (mac_tb_ring_ != nullptr)
+                                     ? cfg->Frame().GetULSymbol(i)
+                                     : gen_tag_t(event.tags_[0]).symbol_id_;
+
+        const bool last_tomac_task =
+            this->tomac_counters_.CompleteTask(frame_id, symbol_id);
+        if (last_tomac_task == true) {
+          stats_->PrintPerSymbolDone(
+              PrintType::kPacketToMac, frame_id, symbol_id,
+              tomac_counters_.GetSymbolCount(frame_id) + 1);
 
-      const bool last_tomac_task =
-          this->tomac_counters_.CompleteTask(frame_id, symbol_id);
-      if (last_tomac_task == true) {
-        stats_->PrintPerSymbolDone(
-            PrintType::kPacketToMac, frame_id, symbol_id,
-            tomac_counters_.GetSymbolCount(frame_id) + 1);
-
-        const bool last_tomac_symbol =
-            this->tomac_counters_.CompleteSymbol(frame_id);
-        if (last_tomac_symbol == true) {
-          assert(frame_tracking_.cur_proc_frame_id_ == frame_id);
-          // this->stats_->MasterSetTsc(TsType::kMacTXDone, frame_id);
-          stats_->PrintPerFrameDone(PrintType::kPacketToMac, frame_id);
-          const bool work_finished = this->CheckFrameComplete(frame_id);
-          if (work_finished == true) {
-            // goto finish;
-            finish = true;
-            return;
+          const bool last_tomac_symbol =
+              this->tomac_counters_.CompleteSymbol(frame_id);
+          if (last_tomac_symbol == true) {
+            assert(frame_tracking_.cur_proc_frame_id_ == frame_id);
+            this->stats_->MasterSetTsc(TsType::kMacDelivered, frame_id);
+            stats_->PrintPerFrameDone(PrintType::kPacketToMac, frame_id);
+            const bool work_finished = this->CheckFrameComplete(frame_id);
+            if (work_finished == true) {
+              // goto finish;
+              finish = true;
+              return;
+            }
           }
         }
       }
@@ -696,12 +1456,13 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
       const size_t frame_id = pkt->Frame();
       const bool last_ue = this->mac_to_phy_counters_.CompleteTask(frame_id, 0);
       if (last_ue == true) {
+        stats_->MasterSetMacDlReady(frame_id);
         // schedule this frame's encoding
         // Defer the schedule.  If frames are already deferred or the
         // current received frame is too far off
         if ((this->encode_deferral_.empty() == false) ||
-            (frame_id >=
-             (frame_tracking_.cur_proc_frame_id_ + kScheduleQueues))) {
+            (frame_id >= (frame_tracking_.cur_proc_frame_id_ +
+                          config_->PipelineDepth()))) {
           if (kDebugDeferral) {
             AGORA_LOG_INFO("   +++ Deferring encoding of frame %zu\n",
                            frame_id);
@@ -727,7 +1488,7 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
               cfg->Frame().GetDLSymbolIdx(symbol_id)) = frame_id;
           // If precoder of the current frame exists
           if (beam_last_frame_ == frame_id) {
-            ScheduleSubcarriers(EventType::kPrecode, frame_id, symbol_id);
+            SchedulePrecode(frame_id, symbol_id);
           }
           stats_->PrintPerSymbolDone(
               PrintType::kEncode, frame_id, symbol_id,
@@ -753,7 +1514,9 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
           PrintType::kPrecode, frame_id, symbol_id, sc_id,
           precode_counters_.GetTaskCount(frame_id, symbol_id));
       const bool last_precode_task =
-          this->precode_counters_.CompleteTask(frame_id, symbol_id);
+          config_->SharedCounters() ||
+          this->precode_counters_.CompleteTasks(frame_id, symbol_id,
+                                                event.num_tags_);
 
       if (last_precode_task == true) {
         // precode_cur_frame_for_symbol_.at(
@@ -811,6 +1574,10 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
               this->ifft_counters_.CompleteSymbol(frame_id);
           if (last_ifft_symbol == true) {
             ifft_next_symbol_ = 0;
+            if (config_->FusePrecodeIfft()) {
+              // The precoding is done by the IFFT tasks
+              this->stats_->MasterSetTsc(TsType::kPrecodeDone, frame_id);
+            }
             this->stats_->MasterSetTsc(TsType::kIFFTDone, frame_id);
             stats_->PrintPerFrameDone(PrintType::kIFFT, frame_id);
             assert(frame_id == frame_tracking_.cur_proc_frame_id_);
@@ -894,20 +1661,32 @@ void Agora::HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
       std::exit(0);
   } /* End of switch */
 
+  // Frames whose downlink was dropped can complete without a downlink event
+  while (IsDlDropped(frame_tracking_.cur_proc_frame_id_)) {
+    const size_t frame_id = frame_tracking_.cur_proc_frame_id_;
+    finish = this->CheckFrameComplete(frame_id);
+    if (finish) {
+      return;
+    }
+    if (frame_tracking_.cur_proc_frame_id_ == frame_id) {
+      break;
+    }
+  }
+
   // We schedule FFT processing if the event handling above results in
   // either (a) sufficient packets received for the current frame,
   // or (b) the current frame being updated.
   TryScheduleFft();
 }
 
-void Agora::HandleEventFft(size_t tag) {
+void Agora::HandleEventFft(size_t tag, size_t num_tasks) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const SymbolType sym_type = config_->GetSymbolType(symbol_id);
 
   if (sym_type == SymbolType::kPilot) {
     const bool last_fft_task =
-        pilot_fft_counters_.CompleteTask(frame_id, symbol_id);
+        pilot_fft_counters_.CompleteTasks(frame_id, symbol_id, num_tasks);
     if (last_fft_task == true) {
       stats_->PrintPerSymbolDone(
           PrintType::kFFTPilots, frame_id, symbol_id,
@@ -923,6 +1702,9 @@ void Agora::HandleEventFft(size_t tag) {
           this->stats_->MasterSetTsc(TsType::kFFTPilotsDone, frame_id);
           stats_->PrintPerFrameDone(PrintType::kFFTPilots, frame_id);
           this->pilot_fft_counters_.Reset(frame_id);
+          if (analog_beams_ != nullptr) {
+            analog_beams_->CompleteFrame(frame_id);
+          }
 #if !defined(TIME_EXCLUSIVE)
           if (kPrintPhyStats == true) {
             this->phy_stats_->PrintUlSnrStats(frame_id);
@@ -940,7 +1722,7 @@ void Agora::HandleEventFft(size_t tag) {
     const size_t symbol_idx_ul = config_->Frame().GetULSymbolIdx(symbol_id);
 
     const bool last_fft_per_symbol =
-        uplink_fft_counters_.CompleteTask(frame_id, symbol_id);
+        uplink_fft_counters_.CompleteTasks(frame_id, symbol_id, num_tasks);
 
     if (last_fft_per_symbol == true) {
       fft_cur_frame_for_symbol_.at(symbol_idx_ul) = frame_id;
@@ -948,8 +1730,12 @@ void Agora::HandleEventFft(size_t tag) {
       stats_->PrintPerSymbolDone(
           PrintType::kFFTData, frame_id, symbol_id,
           uplink_fft_counters_.GetSymbolCount(frame_id) + 1);
-      // If precoder exist, schedule demodulation
-      if (beam_last_frame_ == frame_id) {
+      // If precoder exist, schedule demodulation, unless the worker that
+      // completed the FFT of the symbol already runs it
+      const bool fused_demul =
+          (message_->GetFftDemulFusion() != nullptr) &&
+          message_->GetFftDemulFusion()->TakeFused(frame_id, symbol_id);
+      if ((beam_last_frame_ == frame_id) && (fused_demul == false)) {
         ScheduleSubcarriers(EventType::kDemul, frame_id, symbol_id);
       }
       const bool last_uplink_fft =
@@ -988,94 +1774,164 @@ void Agora::HandleEventFft(size_t tag) {
 }
 
 void Agora::UpdateRanConfig(RanConfig rc) {
-  nlohmann::json msc_params = config_->MCSParams(Direction::kUplink);
-  msc_params["mcs_index"] = rc.mcs_index_;
-  config_->UpdateUlMCS(msc_params);
+  // The workers read the coding parameters of each frame's MCS from the
+  // precomputed table, so the change takes effect at the next frame
+  if (config_->UlMcsSwitchable(rc.mcs_index_) == false) {
+    AGORA_LOG_WARN(
+        "Agora: uplink MCS %zu does not keep the task counts of MCS %zu, "
+        "ignoring the RAN config update\n",
+        rc.mcs_index_, config_->McsIndex(Direction::kUplink));
+    return;
+  }
+  mac_sched_->UpdateRanConfig(rc);
 }
 
 void Agora::UpdateRxCounters(size_t frame_id, size_t symbol_id) {
-  const size_t frame_slot = frame_id % kFrameWnd;
-  if (config_->IsPilot(frame_id, symbol_id)) {
-    rx_counters_.num_pilot_pkts_[frame_slot]++;
-    if (rx_counters_.num_pilot_pkts_.at(frame_slot) ==
-        rx_counters_.num_pilot_pkts_per_frame_) {
-      rx_counters_.num_pilot_pkts_.at(frame_slot) = 0;
-      this->stats_->MasterSetTsc(TsType::kPilotAllRX, frame_id);
-      stats_->PrintPerFrameDone(PrintType::kPacketRXPilots, frame_id);
-    }
-  } else if (config_->IsCalDlPilot(frame_id, symbol_id) ||
-             config_->IsCalUlPilot(frame_id, symbol_id)) {
-    rx_counters_.num_reciprocity_pkts_.at(frame_slot)++;
-    if (rx_counters_.num_reciprocity_pkts_.at(frame_slot) ==
-        rx_counters_.num_reciprocity_pkts_per_frame_) {
-      rx_counters_.num_reciprocity_pkts_.at(frame_slot) = 0;
-      this->stats_->MasterSetTsc(TsType::kRCAllRX, frame_id);
-    }
-  }
   // Receive first packet in a frame
-  if (rx_counters_.num_pkts_.at(frame_slot) == 0) {
-    if (kEnableMac == false) {
-      // schedule this frame's encoding
-      // Defer the schedule.  If frames are already deferred or the current
-      // received frame is too far off
-      if ((encode_deferral_.empty() == false) ||
-          (frame_id >=
-           (frame_tracking_.cur_proc_frame_id_ + kScheduleQueues))) {
-        if (kDebugDeferral) {
-          AGORA_LOG_INFO("   +++ Deferring encoding of frame %zu\n", frame_id);
-        }
-        encode_deferral_.push(frame_id);
-      } else {
-        ScheduleDownlinkProcessing(frame_id);
+  if ((rx_manager_->CountPacket(frame_id, symbol_id) & kRxFirstPacket) != 0) {
+    StartFrame(frame_id, symbol_id);
+  }
+}
+
+void Agora::StartFrame(size_t frame_id, size_t symbol_id) {
+  mac_sched_->ScheduleFrame(frame_id);
+  if ((config_->DlDeadlineMarginUs() > 0.0) &&
+      (config_->Frame().NumDLSyms() > 0)) {
+    SetDlDeadline(frame_id, symbol_id);
+  }
+  if (kEnableMac == false) {
+    // schedule this frame's encoding
+    // Defer the schedule.  If frames are already deferred or the current
+    // received frame is too far off
+    if ((encode_deferral_.empty() == false) ||
+        (frame_id >=
+         (frame_tracking_.cur_proc_frame_id_ + config_->PipelineDepth()))) {
+      if (kDebugDeferral) {
+        AGORA_LOG_INFO("   +++ Deferring encoding of frame %zu\n", frame_id);
       }
+      encode_deferral_.push(frame_id);
+    } else {
+      ScheduleDownlinkProcessing(frame_id);
     }
-    this->stats_->MasterSetTsc(TsType::kFirstSymbolRX, frame_id);
-    if (kDebugPrintPerFrameStart) {
-      const size_t prev_frame_slot = (frame_slot + kFrameWnd - 1) % kFrameWnd;
-      AGORA_LOG_INFO(
-          "Main [frame %zu + %.2f ms since last frame]: Received "
-          "first packet. Remaining packets in prev frame: %zu\n",
-          frame_id,
-          this->stats_->MasterGetDeltaMs(TsType::kFirstSymbolRX, frame_id,
-                                         frame_id - 1),
-          rx_counters_.num_pkts_[prev_frame_slot]);
+  }
+  this->stats_->MasterSetTsc(TsType::kFirstSymbolRX, frame_id);
+  if (kDebugPrintPerFrameStart) {
+    AGORA_LOG_INFO(
+        "Main [frame %zu + %.2f ms since last frame]: Received "
+        "first packet. Remaining packets in prev frame: %zu\n",
+        frame_id,
+        this->stats_->MasterGetDeltaMs(TsType::kFirstSymbolRX, frame_id,
+                                       frame_id - 1),
+        rx_manager_->Counters().Packets(frame_id + kFrameWnd - 1));
+  }
+  rx_manager_->FrameStarted(frame_id);
+}
+
+void Agora::CheckRxTimeout() {
+  if (rx_tracker_->Expired(GetTime::Rdtsc()) == false) {
+    return;
+  }
+  const size_t frame_id = rx_tracker_->OpenFrame();
+  rx_missing_.clear();
+  const size_t num_missing_cal =
+      rx_tracker_->CloseOpenFrame(GetTime::Rdtsc(), rx_missing_);
+  AGORA_LOG_WARN(
+      "Agora: Frame %zu timed out with %zu packets missing, going on with "
+      "the received ones\n",
+      frame_id, rx_missing_.size() + num_missing_cal);
+
+  // The zero CSI of a lost pilot gives its antenna zero beamweights, so the
+  // antenna is left out of the uplink and downlink of the frame
+  for (const auto& missing : rx_missing_) {
+    RxPacket* filler =
+        TakeRxFiller(frame_id, missing.symbol_id_, missing.ant_id_);
+    UpdateRxCounters(frame_id, missing.symbol_id_);
+    rx_manager_->QueueFft(frame_id, fft_req_tag_t(filler));
+  }
+  // The lost calibration packets are only counted, the antennas keep their
+  // previous calibration
+  if (num_missing_cal > 0) {
+    const size_t cal_symbol = (config_->Frame().NumULCalSyms() > 0)
+                                  ? config_->Frame().GetULCalSymbol(0)
+                                  : config_->Frame().GetDLCalSymbol(0);
+    for (size_t i = 0; i < num_missing_cal; i++) {
+      UpdateRxCounters(frame_id, cal_symbol);
+      HandleEventFft(gen_tag_t::FrmSym(frame_id, cal_symbol).tag_, 1);
     }
   }
+  TryScheduleFft();
+}
 
-  rx_counters_.num_pkts_.at(frame_slot)++;
-  if (rx_counters_.num_pkts_.at(frame_slot) ==
-      rx_counters_.num_rx_pkts_per_frame_) {
-    this->stats_->MasterSetTsc(TsType::kRXDone, frame_id);
-    stats_->PrintPerFrameDone(PrintType::kPacketRX, frame_id);
-    rx_counters_.num_pkts_.at(frame_slot) = 0;
+RxPacket* Agora::TakeRxFiller(size_t frame_id, size_t symbol_id,
+                              size_t ant_id) {
+  size_t i = 0;
+  for (; i < rx_fillers_.size(); i++) {
+    if (rx_fillers_.at(rx_filler_next_)->Empty()) {
+      break;
+    }
+    rx_filler_next_ = (rx_filler_next_ + 1) % rx_fillers_.size();
   }
+  if (i == rx_fillers_.size()) {
+    // All in use, which only takes more losses than one frame's worth
+    rx_filler_headers_.push_back(std::make_unique<Packet>(0, 0, 0, 0));
+    rx_fillers_.push_back(
+        std::make_unique<RxPacket>(rx_filler_headers_.back().get()));
+    rx_fillers_.back()->SetExternalSamples(rx_filler_samples_[0], nullptr,
+                                           nullptr);
+    rx_filler_next_ = rx_fillers_.size() - 1;
+  }
+  Packet* header = rx_filler_headers_.at(rx_filler_next_).get();
+  header->frame_id_ = frame_id;
+  header->symbol_id_ = symbol_id;
+  header->ant_id_ = ant_id;
+  RxPacket* filler = rx_fillers_.at(rx_filler_next_).get();
+  filler->Use();
+  rx_filler_next_ = (rx_filler_next_ + 1) % rx_fillers_.size();
+  return filler;
 }
 
 void Agora::InitializeCounters() {
   const auto& cfg = config_;
 
-  rx_counters_.num_pilot_pkts_per_frame_ =
+  const size_t num_pilot_pkts_per_frame =
       cfg->BsAntNum() * cfg->Frame().NumPilotSyms();
   // BfAntNum() for each 'L' symbol (no ref node)
   // RefRadio * NumChannels() for each 'C'.
-  //rx_counters_.num_reciprocity_pkts_per_frame_ = cfg->BsAntNum();
   const size_t num_rx_ul_cal_antennas = cfg->BfAntNum();
   // Same as the number of rx reference antennas (ref ant + other channels)
   const size_t num_rx_dl_cal_antennas = cfg->BsAntNum() - cfg->BfAntNum();
 
-  rx_counters_.num_reciprocity_pkts_per_frame_ =
+  const size_t num_reciprocity_pkts_per_frame =
       (cfg->Frame().NumULCalSyms() * num_rx_ul_cal_antennas) +
       (cfg->Frame().NumDLCalSyms() * num_rx_dl_cal_antennas);
 
   AGORA_LOG_INFO("Agora: Total recip cal receive symbols per frame: %zu\n",
-                 rx_counters_.num_reciprocity_pkts_per_frame_);
-
-  rx_counters_.num_rx_pkts_per_frame_ =
-      rx_counters_.num_pilot_pkts_per_frame_ +
-      rx_counters_.num_reciprocity_pkts_per_frame_ +
-      (cfg->BsAntNum() * cfg->Frame().NumULSyms());
+                 num_reciprocity_pkts_per_frame);
+
+  rx_manager_ = std::make_unique<RxManager>(
+      cfg, message_.get(), stats_.get(), agora_memory_->GetFftSymbolPackets(),
+      num_pilot_pkts_per_frame, num_reciprocity_pkts_per_frame,
+      num_pilot_pkts_per_frame + num_reciprocity_pkts_per_frame +
+          (cfg->BsAntNum() * cfg->Frame().NumULSyms()));
+
+  if (cfg->RxFrameTimeoutUs() > 0.0) {
+    std::vector<bool> fill_symbols(cfg->Frame().NumTotalSyms());
+    for (size_t i = 0; i < fill_symbols.size(); i++) {
+      const SymbolType sym_type = cfg->GetSymbolType(i);
+      fill_symbols.at(i) =
+          (sym_type == SymbolType::kPilot) || (sym_type == SymbolType::kUL);
+    }
+    rx_tracker_ = std::make_unique<RxFrameTracker>(
+        kFrameWnd, fill_symbols, cfg->BsAntNum(),
+        num_reciprocity_pkts_per_frame,
+        GetTime::UsToCycles(cfg->RxFrameTimeoutUs(), cfg->FreqGhz()));
+    // Zeros in every sample format
+    rx_filler_samples_.Calloc(1, cfg->PacketLength() / sizeof(short),
+                              Agora_memory::Alignment_t::kAlign64);
+    rx_fillers_.reserve(cfg->BsAntNum() * cfg->Frame().NumTotalSyms());
+    rx_filler_headers_.reserve(rx_fillers_.capacity());
+  }
 
-  fft_created_count_ = 0;
   pilot_fft_counters_.Init(cfg->Frame().NumPilotSyms(), cfg->BsAntNum());
   uplink_fft_counters_.Init(cfg->Frame().NumULSyms(), cfg->BsAntNum());
   fft_cur_frame_for_symbol_ =
@@ -1091,6 +1947,15 @@ void Agora::InitializeCounters() {
       cfg->Frame().NumULSyms(),
       cfg->LdpcConfig(Direction::kUplink).NumBlocksInSymbol() *
           cfg->SpatialStreamsNum());
+  mini_slot_counters_.Init(cfg->UlMiniSlots(), cfg->UlMiniSlotSymbols());
+  if (cfg->EarlyDecode() && (cfg->Frame().NumULSyms() > 0)) {
+    demul_status_ = std::make_unique<DemulStatus>(
+        cfg->FrameWindow(), cfg->Frame().NumULSyms(),
+        cfg->LdpcConfig(Direction::kUplink).NumBlocksInSymbol(),
+        cfg->LdpcConfig(Direction::kUplink).NumCbCodewLen(),
+        cfg->ModOrderBits(Direction::kUplink), cfg->DemulBlockSize(),
+        cfg->DemulEventsPerSymbol());
+  }
 
   tomac_counters_.Init(cfg->Frame().NumULSyms(), cfg->SpatialStreamsNum());
 
@@ -1109,18 +1974,94 @@ void Agora::InitializeCounters() {
                            config_->DemulEventsPerSymbol());
     // precode_cur_frame_for_symbol_ =
     //    std::vector<size_t>(config_->Frame().NumDLSyms(), SIZE_MAX);
-    ifft_counters_.Init(config_->Frame().NumDLSyms(), config_->BsAntNum());
+    ifft_counters_.Init(config_->Frame().NumDLSyms(),
+                        config_->IfftBatchSymbol() ? 1 : config_->BsAntNum());
     tx_counters_.Init(
         config_->Frame().NumDlControlSyms() + config_->Frame().NumDLSyms(),
         config_->BsAntNum());
     // mac data is sent per frame, so we set max symbol to 1
     mac_to_phy_counters_.Init(1, config_->SpatialStreamsNum());
   }
+
+  if (config_->FuseFftDemul() && (config_->Frame().NumULSyms() > 0)) {
+    message_->EnableFftDemulFusion(config_->BsAntNum());
+  }
+
+  if (config_->SharedCounters()) {
+    message_->EnableSharedCounters(EventType::kBeam,
+                                   beam_counters_.MaxSymbolCount());
+    message_->EnableSharedCounters(EventType::kDemul,
+                                   demul_counters_.MaxTaskCount());
+    message_->EnableSharedCounters(EventType::kDecode,
+                                   decode_counters_.MaxTaskCount());
+    if (config_->Frame().NumDLSyms() > 0) {
+      message_->EnableSharedCounters(EventType::kPrecode,
+                                     precode_counters_.MaxTaskCount());
+    }
+  }
 }
 
 void Agora::InitializeThreads() {
+  if (config_->TaskTraceEvents() > 0) {
+    tracer_ = std::make_unique<EventTracer>(
+        config_->TaskTraceEvents(), config_->FreqGhz(),
+        config_->SocketThreadNum(), config_->WorkerThreadNum());
+  }
+  if (config_->TapPoints().empty() == false) {
+    // The largest record of each tap point: a symbol of an antenna for the
+    // FFT and CSI, a task of the beam, demul and decode stages
+    std::array<size_t, kNumTapPoints> record_bytes{};
+    record_bytes.at(static_cast<size_t>(TapPoint::kFftIq)) =
+        config_->OfdmDataNum() * sizeof(complex_float);
+    record_bytes.at(static_cast<size_t>(TapPoint::kCsi)) =
+        config_->OfdmDataNum() * sizeof(complex_float);
+    record_bytes.at(static_cast<size_t>(TapPoint::kBeams)) =
+        config_->BeamBlockSize() * config_->BsAntNum() *
+        config_->SpatialStreamsNum() * sizeof(complex_float);
+    record_bytes.at(static_cast<size_t>(TapPoint::kEqual)) =
+        config_->DemulBlockSize() * config_->SpatialStreamsNum() *
+        sizeof(complex_float);
+    record_bytes.at(static_cast<size_t>(TapPoint::kLlr)) =
+        config_->DemulBlockSize() * kMaxModType;
+    record_bytes.at(static_cast<size_t>(TapPoint::kDecoded)) =
+        config_->UlDecodedCbStride();
+    taps_ = std::make_unique<DataTaps>(config_, "agora", record_bytes);
+  }
+  if (config_->StallFactor() > 0.0) {
+    stall_monitor_ = std::make_unique<StallMonitor>(
+        config_->WorkerThreadNum(), config_->StallFactor(),
+        config_->StallMinUs(), config_->FreqGhz(),
+        [this]() { return DescribeQueues(); });
+    stall_monitor_->Start();
+  }
+  if (config_->NumAnalogBeams() > 0) {
+    analog_beams_ = std::make_unique<AnalogBeams>(
+        config_->NumAnalogBeams(), config_->BeamSweepInterval());
+  }
+
+  // Only the simulator and DPDK workers receive AggregatePacket datagrams
+  RtAssert((config_->FronthaulAggregation() == 1) ||
+               ((config_->BenchMode() == false) && (kUseArgos == false) &&
+                (kUseUHD == false) && (kUsePureUHD == false) &&
+                (kUseXDP == false)),
+           "fronthaul_aggregation needs the simulator or DPDK packet I/O");
+  // UHD and SoapySDR block in their receive calls, so only the simulator and
+  // DPDK workers can be polled by the master
+  RtAssert((config_->InlineTxRx() == false) ||
+               ((config_->BenchMode() == false) && (kUseArgos == false) &&
+                (kUseUHD == false) && (kUsePureUHD == false) &&
+                (kUseXDP == false)),
+           "inline_txrx needs the simulator or DPDK packet I/O");
   /* Initialize TXRX threads */
-  if (kUseArgos || kUseUHD || kUsePureUHD) {
+  if (config_->BenchMode()) {
+    packet_tx_rx_ = std::make_unique<PacketTxRxBench>(
+        config_, config_->CoreOffset() + 1, message_->GetRxConQ(),
+        message_->GetTxConQ(), message_->GetRxPTokPtr(),
+        message_->GetTxPTokPtr(), agora_memory_->GetUlSocket(),
+        agora_memory_->GetUlSocketSize() / config_->PacketLength(),
+        this->stats_->FrameStart(), agora_memory_->GetDlSocket(),
+        frames_done_);
+  } else if (kUseArgos || kUseUHD || kUsePureUHD) {
     packet_tx_rx_ = std::make_unique<PacketTxRxRadio>(
         config_, config_->CoreOffset() + 1, message_->GetRxConQ(),
         message_->GetTxConQ(), message_->GetRxPTokPtr(),
@@ -1128,6 +2069,13 @@ void Agora::InitializeThreads() {
         agora_memory_->GetUlSocketSize() / config_->PacketLength(),
         this->stats_->FrameStart(), agora_memory_->GetDlSocket());
 #if defined(USE_DPDK)
+  } else if (kUseDPDK && config_->OranFronthaul()) {
+    packet_tx_rx_ = std::make_unique<PacketTxRxOran>(
+        config_, config_->CoreOffset() + 1, message_->GetRxConQ(),
+        message_->GetTxConQ(), message_->GetRxPTokPtr(),
+        message_->GetTxPTokPtr(), agora_memory_->GetUlSocket(),
+        agora_memory_->GetUlSocketSize() / config_->PacketLength(),
+        this->stats_->FrameStart(), agora_memory_->GetDlSocket());
   } else if (kUseDPDK) {
     packet_tx_rx_ = std::make_unique<PacketTxRxDpdk>(
         config_, config_->CoreOffset() + 1, message_->GetRxConQ(),
@@ -1135,6 +2083,15 @@ void Agora::InitializeThreads() {
         message_->GetTxPTokPtr(), agora_memory_->GetUlSocket(),
         agora_memory_->GetUlSocketSize() / config_->PacketLength(),
         this->stats_->FrameStart(), agora_memory_->GetDlSocket());
+#endif
+#if defined(USE_XDP)
+  } else if (kUseXDP) {
+    packet_tx_rx_ = std::make_unique<PacketTxRxXdp>(
+        config_, config_->CoreOffset() + 1, message_->GetRxConQ(),
+        message_->GetTxConQ(), message_->GetRxPTokPtr(),
+        message_->GetTxPTokPtr(), agora_memory_->GetUlSocket(),
+        agora_memory_->GetUlSocketSize() / config_->PacketLength(),
+        this->stats_->FrameStart(), agora_memory_->GetDlSocket());
 #endif
   } else {
     /* Default to the simulator */
@@ -1146,14 +2103,35 @@ void Agora::InitializeThreads() {
         this->stats_->FrameStart(), agora_memory_->GetDlSocket());
   }
 
+  if (tracer_ != nullptr) {
+    packet_tx_rx_->SetTracer(tracer_.get());
+  }
+  packet_tx_rx_->SetAnalogBeams(analog_beams_.get());
+  if (config_->RxEventRings()) {
+    std::vector<SpscEventRing*> notify_rings;
+    for (size_t i = 0; i < config_->SocketThreadNum(); i++) {
+      notify_rings.push_back(message_->GetRxRing(i));
+    }
+    packet_tx_rx_->SetNotifyRings(std::move(notify_rings));
+  }
+
   if (kEnableMac == true) {
     const size_t mac_cpu_core = config_->CoreOffset() +
                                 config_->SocketThreadNum() +
                                 config_->WorkerThreadNum() + 1;
+    if (config_->MacTbRing()) {
+      mac_tb_ring_ = std::make_unique<MacPhyRing>(
+          kFrameWnd * config_->SpatialStreamsNum(),
+          config_->MacRingHugepage());
+      mac_tb_done_ring_ = std::make_unique<MacPhyRing>(
+          kFrameWnd * config_->SpatialStreamsNum(),
+          config_->MacRingHugepage());
+    }
     mac_thread_ = std::make_unique<MacThreadBaseStation>(
         config_, mac_cpu_core, agora_memory_->GetDecod(),
         &agora_memory_->GetDlBits(), &agora_memory_->GetDlBitsStatus(),
-        &mac_request_queue_, &mac_response_queue_);
+        &mac_request_queue_, &mac_response_queue_, "", mac_tb_ring_.get(),
+        mac_tb_done_ring_.get());
 
     mac_std_thread_ =
         std::thread(&MacThreadBaseStation::RunEventLoop, mac_thread_.get());
@@ -1161,23 +2139,64 @@ void Agora::InitializeThreads() {
 
   // Create workers
   ///\todo convert unique ptr to shared
+  if (own_workers_ == false) {
+    AGORA_LOG_INFO(
+        "Master thread core %zu, TX/RX thread cores %zu--%zu, shared worker "
+        "threads\n",
+        config_->CoreOffset(), config_->CoreOffset() + 1,
+        config_->CoreOffset() + 1 + config_->SocketThreadNum() - 1);
+    return;
+  }
   worker_ = std::make_unique<AgoraWorker>(
       config_, mac_sched_.get(), stats_.get(), phy_stats_.get(), message_.get(),
-      agora_memory_.get(), &frame_tracking_);
+      agora_memory_.get(), &frame_tracking_, tracer_.get(), taps_.get(),
+      stall_monitor_.get(), analog_beams_.get());
+  worker_pool_ = worker_.get();
+
+  if (config_->InlineTxRx()) {
+    AGORA_LOG_INFO("Master/worker/TX/RX thread core %zu\n",
+                   config_->CoreOffset());
+  } else if (config_->GetExecutionModel() == ExecutionModel::kSingleCore) {
+    AGORA_LOG_INFO(
+        "Master/worker thread core %zu, TX/RX thread cores %zu--%zu\n",
+        config_->CoreOffset(), config_->CoreOffset() + 1,
+        config_->CoreOffset() + 1 + config_->SocketThreadNum() - 1);
+  } else {
+    AGORA_LOG_INFO(
+        "Master%s thread core %zu, TX/RX thread cores %zu--%zu, worker thread "
+        "cores %zu--%zu\n",
+        config_->MasterRunsWorker() ? "/worker" : "", config_->CoreOffset(),
+        config_->CoreOffset() + 1,
+        config_->CoreOffset() + 1 + config_->SocketThreadNum() - 1,
+        base_worker_core_offset_,
+        base_worker_core_offset_ + config_->DedicatedWorkerNum() - 1);
+  }
+}
 
-#ifdef SINGLE_THREAD
-  AGORA_LOG_INFO("Master/worker thread core %zu, TX/RX thread cores %zu--%zu\n",
-                 config_->CoreOffset(), config_->CoreOffset() + 1,
-                 config_->CoreOffset() + 1 + config_->SocketThreadNum() - 1);
-#else
-  AGORA_LOG_INFO(
-      "Master thread core %zu, TX/RX thread cores %zu--%zu, worker thread "
-      "cores %zu--%zu\n",
-      config_->CoreOffset(), config_->CoreOffset() + 1,
-      config_->CoreOffset() + 1 + config_->SocketThreadNum() - 1,
-      base_worker_core_offset_,
-      base_worker_core_offset_ + config_->WorkerThreadNum() - 1);
-#endif
+void Agora::PrintStartupProfile(double txrx_time_ms) {
+  const double prefault_time_ms = agora_memory_->JoinPrefault();
+  const double worker_time_ms =
+      (worker_pool_ != nullptr) ? worker_pool_->InitTimeMs() : -1.0;
+  AGORA_LOG_INFO("Agora: startup profile\n");
+  AGORA_LOG_INFO("Agora:   %-22s %9.1f ms\n", "config",
+                 config_->InitTimeMs());
+  AGORA_LOG_INFO("Agora:   %-22s %9.1f ms\n", "pilots and data",
+                 config_->GenDataTimeMs());
+  AGORA_LOG_INFO("Agora:   %-22s %9.1f ms\n", "buffers",
+                 agora_memory_->AllocTimeMs());
+  AGORA_LOG_INFO("Agora:   %-22s %9.1f ms\n", "threads", threads_time_ms_);
+  if (worker_time_ms < 0) {
+    AGORA_LOG_INFO("Agora:   %-22s %12s\n", "worker doers", "pending");
+  } else {
+    AGORA_LOG_INFO("Agora:   %-22s %9.1f ms, %zu MKL descriptors\n",
+                   "worker doers", worker_time_ms,
+                   MklDftCache::NumCommitted());
+  }
+  AGORA_LOG_INFO("Agora:   %-22s %9.1f ms\n", "radio bring-up", txrx_time_ms);
+  if (config_->PrefaultBuffers() || config_->LockMemory()) {
+    AGORA_LOG_INFO("Agora:   %-22s %9.1f ms (background)\n", "prefault",
+                   prefault_time_ms);
+  }
 }
 
 void Agora::SaveDecodeDataToFile(int frame_id) {
@@ -1194,7 +2213,7 @@ void Agora::SaveDecodeDataToFile(int frame_id) {
     for (size_t i = 0; i < cfg->Frame().NumULSyms(); i++) {
       for (size_t j = 0; j < cfg->UeAntNum(); j++) {
         const int8_t* ptr =
-            agora_memory_->GetDecod()[(frame_id % kFrameWnd)][i][j];
+            agora_memory_->GetDecod()[(frame_id % cfg->FrameWindow())][i][j];
         const auto write_status =
             std::fwrite(ptr, sizeof(uint8_t), num_decoded_bytes, fp);
         if (write_status != num_decoded_bytes) {
@@ -1240,12 +2259,25 @@ void Agora::SaveTxDataToFile(int frame_id) {
   }
 }
 
-void Agora::GetEqualData(float** ptr, int* size) {
-  const auto& cfg = config_;
-  auto offset = cfg->GetTotalDataSymbolIdxUl(
-      max_equaled_frame_, cfg->Frame().ClientUlPilotSymbols());
-  *ptr = (float*)&agora_memory_->GetEqual()[offset][0];
-  *size = cfg->UeAntNum() * cfg->OfdmDataNum() * 2;
+void Agora::CompleteMiniSlotSymbol(size_t frame_id, size_t symbol_id) {
+  const size_t num_pilot_symbols = config_->Frame().ClientUlPilotSymbols();
+  const size_t symbol_idx_ul = config_->Frame().GetULSymbolIdx(symbol_id);
+  if (symbol_idx_ul < num_pilot_symbols) {
+    return;
+  }
+  const size_t mini_slot =
+      config_->UlMiniSlot(symbol_idx_ul - num_pilot_symbols);
+  // The last mini-slot is short if the frame does not split evenly
+  mini_slot_counters_.CompleteTask(frame_id, mini_slot);
+  if (mini_slot_counters_.GetTaskCount(frame_id, mini_slot) ==
+      config_->UlMiniSlotDataSyms(mini_slot)) {
+    mini_slot_counters_.CompleteSymbol(frame_id);
+    stats_->MasterRecordMiniSlotLatency(frame_id, mini_slot);
+    AGORA_LOG_FRAME("Main [frame %zu + %.2f ms]: Decoded mini-slot %zu\n",
+                    frame_id,
+                    stats_->MasterGetMsSince(TsType::kFirstSymbolRX, frame_id),
+                    mini_slot);
+  }
 }
 
 void Agora::CheckIncrementScheduleFrame(size_t frame_id,
@@ -1261,13 +2293,48 @@ void Agora::CheckIncrementScheduleFrame(size_t frame_id,
     if (this->config_->Frame().NumULSyms() == 0) {
       this->schedule_process_flags_ += ScheduleProcessingFlags::kUplinkComplete;
     }
-    if (this->config_->Frame().NumDLSyms() == 0) {
+    if ((this->config_->Frame().NumDLSyms() == 0) ||
+        IsDlDropped(frame_tracking_.cur_sche_frame_id_)) {
       this->schedule_process_flags_ +=
           ScheduleProcessingFlags::kDownlinkComplete;
     }
   }
 }
 
+void Agora::PrintBenchSummary(size_t end_tsc) {
+  const size_t num_frames = frames_done_.load();
+  const size_t warmup_frames = BenchWarmupFrames();
+  if (num_frames <= warmup_frames) {
+    AGORA_LOG_WARN(
+        "Agora: Bench stopped after %zu frames, within the %zu warm-up "
+        "frames\n",
+        num_frames, warmup_frames);
+    return;
+  }
+  const double elapsed_us =
+      GetTime::CyclesToUs(end_tsc - bench_start_tsc_, config_->FreqGhz());
+  const double frame_us = elapsed_us / (num_frames - warmup_frames);
+  bench_frames_per_sec_ = 1e6 / frame_us;
+  AGORA_LOG_INFO(
+      "Agora: Bench processed %zu frames (%zu warm-up) with %zu workers: "
+      "%.1f frames/s, %.1f us per frame (%.2fx real time for %.1f us "
+      "frames)\n",
+      num_frames, warmup_frames, config_->WorkerThreadNum(),
+      bench_frames_per_sec_, frame_us,
+      (config_->GetFrameDurationSec() * 1e6) / frame_us,
+      config_->GetFrameDurationSec() * 1e6);
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    const auto ts_type = static_cast<TsType>(i);
+    const size_t timed_frames = stats_->LatencyCount(ts_type);
+    if (timed_frames > 0) {
+      bench_deadline_miss_ratio_ = std::max(
+          bench_deadline_miss_ratio_,
+          static_cast<double>(stats_->DeadlineMisses(ts_type)) / timed_frames);
+    }
+  }
+  stats_->PrintCyclesPerFrame(num_frames);
+}
+
 bool Agora::CheckFrameComplete(size_t frame_id) {
   bool finished = false;
 
@@ -1281,8 +2348,9 @@ bool Agora::CheckFrameComplete(size_t frame_id) {
       static_cast<int>(this->tx_counters_.IsLastSymbol(frame_id)));
 
   // Complete if last frame and ifft / decode complete
-  if ((true == this->ifft_counters_.IsLastSymbol(frame_id)) &&
-      (true == this->tx_counters_.IsLastSymbol(frame_id)) &&
+  if ((((true == this->ifft_counters_.IsLastSymbol(frame_id)) &&
+        (true == this->tx_counters_.IsLastSymbol(frame_id))) ||
+       (true == IsDlDropped(frame_id))) &&
       (((false == kEnableMac) &&
         (true == this->decode_counters_.IsLastSymbol(frame_id))) ||
        ((true == kUplinkHardDemod) &&
@@ -1290,32 +2358,51 @@ bool Agora::CheckFrameComplete(size_t frame_id) {
        ((true == kEnableMac) &&
         (true == this->tomac_counters_.IsLastSymbol(frame_id))))) {
     this->stats_->UpdateStats(frame_id);
+    this->stats_->MasterRecordFrameLatency(frame_id);
+    if (frame_log_ != nullptr) {
+      LogFrame(frame_id);
+    }
+    if (block_sizer_ != nullptr) {
+      const size_t queue_depth = message_->TaskQueueDepth();
+      block_sizer_->Update(EventType::kBeam,
+                           stats_->TaskUs(DoerType::kBeam), queue_depth);
+      block_sizer_->Update(EventType::kDemul,
+                           stats_->TaskUs(DoerType::kDemul), queue_depth);
+      block_sizer_->Update(EventType::kPrecode,
+                           stats_->TaskUs(DoerType::kPrecode), queue_depth);
+    }
     assert(frame_id == frame_tracking_.cur_proc_frame_id_);
     if (true == kUplinkHardDemod) {
       this->demul_counters_.Reset(frame_id);
     }
     this->decode_counters_.Reset(frame_id);
+    this->mini_slot_counters_.Reset(frame_id);
     this->tomac_counters_.Reset(frame_id);
     this->ifft_counters_.Reset(frame_id);
     this->tx_counters_.Reset(frame_id);
     if (config_->Frame().NumDLSyms() > 0) {
       for (size_t ue_id = 0; ue_id < config_->SpatialStreamsNum(); ue_id++) {
-        this->agora_memory_->GetDlBitsStatus()[ue_id][frame_id % kFrameWnd] = 0;
+        this->agora_memory_
+            ->GetDlBitsStatus()[ue_id][frame_id % config_->FrameWindow()] = 0;
       }
     }
     frame_tracking_.cur_proc_frame_id_++;
+    frames_done_.store(frame_tracking_.cur_proc_frame_id_);
+    if (frame_tracking_.cur_proc_frame_id_ == BenchWarmupFrames()) {
+      bench_start_tsc_ = GetTime::Rdtsc();
+    }
 
     if (frame_id == (this->config_->FramesToTest() - 1)) {
       finished = true;
     } else {
-      // Only schedule up to kScheduleQueues so we don't flood the queues
+      // Only schedule up to the pipeline depth so we don't flood the queues
       // Cannot access the front() element if the queue is empty
-      for (size_t encode = 0;
-           (encode < kScheduleQueues) && (!encode_deferral_.empty());
+      for (size_t encode = 0; (encode < config_->PipelineDepth()) &&
+                              (!encode_deferral_.empty());
            encode++) {
         const size_t deferred_frame = this->encode_deferral_.front();
         if (deferred_frame <
-            (frame_tracking_.cur_proc_frame_id_ + kScheduleQueues)) {
+            (frame_tracking_.cur_proc_frame_id_ + config_->PipelineDepth())) {
           if (kDebugDeferral) {
             AGORA_LOG_INFO("   +++ Scheduling deferred frame %zu : %zu \n",
                            deferred_frame, frame_tracking_.cur_proc_frame_id_);
@@ -1329,7 +2416,7 @@ bool Agora::CheckFrameComplete(size_t frame_id) {
           // No need to check the next frame because it is too large
           break;
         }
-      }  // for each encodable frames in kScheduleQueues
+      }  // for each encodable frame within the pipeline depth
     }    // !finished
   }
   return finished;
@@ -1347,7 +2434,4 @@ EXPORT void AgoraStop(/*Agora *agora*/) {
   SignalHandler::SetExitSignal(true); /*agora->stop();*/
 }
 EXPORT void AgoraDestroy(Agora* agora) { delete agora; }
-EXPORT void AgoraGetEqualData(Agora* agora, float** ptr, int* size) {
-  return agora->GetEqualData(ptr, size);
-}
 }
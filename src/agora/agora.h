@@ -7,6 +7,7 @@
 #define AGORA_H_
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -14,9 +15,16 @@
 #include <thread>
 #include <vector>
 
+#include "adaptive_bulk.h"
 #include "agora_buffer.h"
+#include "analog_beams.h"
+#include "demul_status.h"
 #include "agora_worker.h"
+#include "block_size_controller.h"
 #include "concurrentqueue.h"
+#include "data_tap.h"
+#include "event_tracer.h"
+#include "frame_log.h"
 #include "mac_scheduler.h"
 #include "mac_thread_basestation.h"
 #include "message.h"
@@ -24,18 +32,40 @@
 #include "phy_stats.h"
 #include "ran_config.h"
 #include "recorder_thread.h"
+#include "rx_frame_tracker.h"
+#include "rx_manager.h"
+#include "stall_monitor.h"
 #include "stats.h"
 #include "symbols.h"
+#include "telemetry.h"
 
 class Agora {
  public:
-  /// Create an Agora object and start the worker threads
-  explicit Agora(Config* cfg);
+  /// Create an Agora object and start the worker threads. Without
+  /// own_workers, the cell's tasks run on the shared workers set with
+  /// SetWorkerPool, see MultiCellAgora.
+  explicit Agora(Config* cfg, bool own_workers = true);
   ~Agora();
 
+  /// The cell's buffers and state, for the workers shared between cells
+  AgoraWorker::Cell WorkerCell();
+  /// Run the cell's tasks on the shared workers, before Start()
+  inline void SetWorkerPool(AgoraWorker* worker_pool) {
+    worker_pool_ = worker_pool;
+  }
+
   void Start();  /// The main Agora event loop
   void Stop();
-  void GetEqualData(float** ptr, int* size);
+  /// Frames per second of the bench mode after Start() returns, 0 if it did
+  /// not get past the warm-up frames
+  inline double BenchFramesPerSec() const { return bench_frames_per_sec_; }
+  /// Fraction of the frames of the bench mode that reached a stage after its
+  /// deadline (stage_deadlines_us), of the worst stage, after Start() returns
+  inline double BenchDeadlineMissRatio() const {
+    return bench_deadline_miss_ratio_;
+  }
+  /// Frames completed so far
+  inline size_t FramesDone() const { return frames_done_.load(); }
 
   // Flags that allow developer control over Agora internals
   struct {
@@ -63,6 +93,11 @@ class Agora {
   /// otherwise.
   bool CheckFrameComplete(size_t frame_id);
 
+  /// Counts the decoded uplink symbol_id of frame_id in its mini-slot, and
+  /// records the latency of the mini-slot when all its data symbols are
+  /// decoded. Client uplink pilot symbols are in no mini-slot.
+  void CompleteMiniSlotSymbol(size_t frame_id, size_t symbol_id);
+
   /// Increments the cur_sche_frame_id when all ScheduleProcessingFlags have
   /// been acheived.
   void CheckIncrementScheduleFrame(size_t frame_id,
@@ -76,14 +111,31 @@ class Agora {
   void InitializeCounters();
   void InitializeThreads();
 
+  /// Frames left out of the bench throughput while the pipeline fills up
+  inline size_t BenchWarmupFrames() const {
+    return (config_->FramesToTest() > (2 * config_->FrameWindow()))
+               ? config_->FrameWindow()
+               : 0;
+  }
+  /// Log the frames per second of the bench mode up to end_tsc and the
+  /// worker cycles per frame of each stage
+  void PrintBenchSummary(size_t end_tsc);
+  /// Log the time spent in each startup step, up to the end of the radio
+  /// bring-up that took txrx_time_ms
+  void PrintStartupProfile(double txrx_time_ms);
+
   void SaveDecodeDataToFile(int frame_id);
   void SaveTxDataToFile(int frame_id);
 
   void HandleEvents(EventData& event, size_t& tx_count, double tx_begin,
                     bool& finish);
   void HandleStreamerEvents(EventData& event);
-  void HandleEventFft(size_t tag);
+  /// Count num_tasks completed antenna FFTs of the symbol of tag
+  void HandleEventFft(size_t tag, size_t num_tasks);
   void UpdateRxCounters(size_t frame_id, size_t symbol_id);
+  /// Schedule frame_id, whose first packet is symbol_id, in the MAC and
+  /// its downlink processing, and let the RxManager start its FFTs
+  void StartFrame(size_t frame_id, size_t symbol_id);
 
   /// Update Agora's RAN config parameters
   void UpdateRanConfig(RanConfig rc);
@@ -93,8 +145,17 @@ class Agora {
   void ScheduleAntennas(EventType event_type, size_t frame_id,
                         size_t symbol_id);
   void ScheduleAntennasTX(size_t frame_id, size_t symbol_id);
+  /// Schedule the precoding of a downlink symbol, as kIFFT tasks when the
+  /// precoding is fused into the IFFT
+  void SchedulePrecode(size_t frame_id, size_t symbol_id);
   void ScheduleDownlinkProcessing(size_t frame_id);
+  /// Schedule the received FFTs of the current scheduling frame, or
+  /// publish the frame progress to the RxManager thread
   void TryScheduleFft();
+  /// The set of task and completion queues of the tasks of a frame
+  inline size_t Qid(size_t frame_id) const {
+    return frame_id % config_->PipelineDepth();
+  }
 
   /**
    * @brief Schedule LDPC decoding or encoding over code blocks
@@ -105,19 +166,81 @@ class Agora {
    */
   void ScheduleCodeblocks(EventType event_type, Direction dir, size_t frame_id,
                           size_t symbol_idx);
+  /// Schedule the decoding of uplink code blocks [first_cb, first_cb +
+  /// num_cbs) of a symbol for every spatial stream, with early_decode
+  void ScheduleCodeblockGroup(size_t frame_id, size_t symbol_id,
+                              size_t first_cb, size_t num_cbs);
 
   void ScheduleUsers(EventType event_type, size_t frame_id, size_t symbol_id);
   void ScheduleBroadCastSymbols(EventType event_type, size_t frame_id);
 
+  /// Number of tasks (tags) to pack into one event when scheduling num_tasks
+  /// tasks of a symbol: at least min_batch_size, and more with event
+  /// batching if there are enough tasks for every worker
+  size_t EventBatchSize(size_t num_tasks, size_t min_batch_size) const;
+
+  /// Priority of the tasks of event_type for frame_id in the work-stealing
+  /// scheduler: decoding of the oldest frame in processing and IFFT (bounded
+  /// by the TX deadline) are on the critical path, and so are encoding and
+  /// precoding of frames less than one frame away from their TX slot
+  TaskPriority GetTaskPriority(EventType event_type, size_t frame_id) const;
+
+  /// Record the TX slot of frame_id's downlink when its first packet,
+  /// symbol_id, is received
+  void SetDlDeadline(size_t frame_id, size_t symbol_id);
+  /// Microseconds left before the TX slot of frame_id's first downlink
+  /// symbol (negative if it has passed), infinity if it is not known
+  double DlSlackUs(size_t frame_id) const;
+  /// True if the downlink of frame_id was dropped to meet later TX slots
+  bool IsDlDropped(size_t frame_id) const;
+  /// Skip the downlink processing of frame_id, which completes the frame
+  /// once its uplink is done
+  void DropDownlink(size_t frame_id);
+  /// Order the task queues of the master thread's doers for the next
+  /// master_task_budget_us: the critical tasks of GetTaskPriority first,
+  /// then the others, each from the oldest frame on and from the TX end of
+  /// the pipeline back to the FFT
+  void BuildMasterSchedule();
+  /// Run the tasks of master_schedule_ for up to master_task_budget_us
+  void RunMasterTasks();
+
+  /// Process the oldest frame still receiving packets with the packets it
+  /// has once it times out, see rx_frame_timeout_us
+  void CheckRxTimeout();
+  /// A packet of zeros in place of the lost packet of ant_id in symbol_id
+  /// of frame_id, which the FFT frees like the received ones
+  RxPacket* TakeRxFiller(size_t frame_id, size_t symbol_id, size_t ant_id);
+
+  /// True if the recorder keeps a capture of the last frames, see
+  /// capture_frames
+  bool CaptureEnabled() const;
+  /// Fire a capture of the recorder if a UE's EVM SNR of frame_id drops
+  /// capture_evm_drop dB below its average
+  void CheckCaptureEvm(size_t frame_id, const arma::uvec& ue_map);
+  /// Fire a capture of the recorder if frame_id ends a burst of
+  /// capture_crc_burst frames with block errors
+  void CheckCaptureCrc(size_t frame_id);
+
+  /// Hand the MAC the uplink transport blocks of frame_id, one per UE,
+  /// through the MAC-PHY ring
+  void ScheduleTransportBlocks(size_t frame_id);
+
   // Send current frame's SNR measurements from PHY to MAC
   void SendSnrReport(EventType event_type, size_t frame_id, size_t symbol_id);
+  /// Fill in and publish a telemetry snapshot
+  void PublishTelemetry();
+  /// Create the frame log with the columns that LogFrame() fills in
+  void InitializeFrameLog();
+  /// Append the row of a completed frame to the frame log
+  void LogFrame(size_t frame_id);
+  /// The depths of the queues of the cell, for the stall reports. Safe to
+  /// call from any thread.
+  std::string DescribeQueues() const;
 
   // Worker thread i runs on core base_worker_core_offset + i
   const size_t base_worker_core_offset_;
 
   Config* const config_;
-  size_t fft_created_count_;
-  size_t max_equaled_frame_ = SIZE_MAX;
   std::unique_ptr<PacketTxRx> packet_tx_rx_;
 
   // The thread running MAC layer functions
@@ -129,6 +252,10 @@ class Agora {
   std::unique_ptr<Stats> stats_;
   std::unique_ptr<PhyStats> phy_stats_;
   std::unique_ptr<AgoraWorker> worker_;
+  // The workers running the cell's tasks, worker_ or the ones shared with
+  // other cells
+  AgoraWorker* worker_pool_ = nullptr;
+  const bool own_workers_;
 
   //Agora Buffer containment
   std::unique_ptr<AgoraBuffer> agora_memory_;
@@ -139,6 +266,11 @@ class Agora {
   FrameCounters beam_counters_;
   FrameCounters demul_counters_;
   FrameCounters decode_counters_;
+  // Decoded data symbols of each uplink mini-slot, with ul_mini_slot_symbols
+  FrameCounters mini_slot_counters_;
+  // Releases the uplink code blocks whose LLRs are demodulated, with
+  // early_decode
+  std::unique_ptr<DemulStatus> demul_status_;
   FrameCounters encode_counters_;
   FrameCounters precode_counters_;
   FrameCounters ifft_counters_;
@@ -146,7 +278,9 @@ class Agora {
   FrameCounters tomac_counters_;
   FrameCounters mac_to_phy_counters_;
   FrameCounters rc_counters_;
-  RxCounters rx_counters_;
+  // The received packet counts and the FFT scheduling, on the master or on
+  // a thread of their own with rx_manager
+  std::unique_ptr<RxManager> rx_manager_;
   size_t beam_last_frame_ = SIZE_MAX;
   size_t rc_last_frame_ = SIZE_MAX;
   size_t ifft_next_symbol_ = 0;
@@ -158,6 +292,15 @@ class Agora {
   // variables are possible to have different values.
   FrameInfo frame_tracking_{0, 0};
   std::unique_ptr<MessageInfo> message_;
+  // Per queue set, the completions of a frame ahead of cur_proc_frame_id
+  // that must be handled in frame order, held until it is the current frame
+  std::array<std::vector<EventData>, kMaxScheduleQueues> held_events_;
+  // Dequeue bulk sizes of the packets of each TXRX thread and of the
+  // completions
+  std::vector<AdaptiveBulk> rx_bulks_;
+  AdaptiveBulk doer_bulk_{kDequeueBulkSizeWorker, kDequeueBulkSizeWorker};
+  // The TXRX thread FetchStreamerEvent dequeues from first
+  size_t rx_next_socket_ = 0;
 
   // The frame index for a symbol whose FFT is done
   std::vector<size_t> fft_cur_frame_for_symbol_;
@@ -169,20 +312,75 @@ class Agora {
   // The frame index for a symbol whose precode is done
   std::vector<size_t> precode_cur_frame_for_symbol_;
 
-  // Per-frame queues of delayed FFT tasks. The queue contains offsets into
-  // TX/RX buffers.
-  std::array<std::queue<fft_req_tag_t>, kFrameWnd> fft_queue_arr_;
-
   // Master-to-worker queue for MAC
   moodycamel::ConcurrentQueue<EventData> mac_request_queue_;
 
   // Worker-to-master queue for MAC
   moodycamel::ConcurrentQueue<EventData> mac_response_queue_;
 
+  // Transport blocks to and back from the MAC, if mac_tb_ring
+  std::unique_ptr<MacPhyRing> mac_tb_ring_;
+  std::unique_ptr<MacPhyRing> mac_tb_done_ring_;
+
   uint8_t schedule_process_flags_;
   std::queue<size_t> encode_deferral_;
+  // TX deadlines of the frames in the window, if dl_deadline_margin_us > 0
+  std::array<DlDeadline, kFrameWnd> dl_deadlines_;
+  // Received packets of the frames in the window, if rx_frame_timeout_us > 0
+  std::unique_ptr<RxFrameTracker> rx_tracker_;
+  std::vector<RxFrameTracker::MissingPacket> rx_missing_;
+  // Packets standing in for the lost ones, with their headers and the
+  // samples of zeros they share. A filler is reused once the FFT frees it.
+  std::vector<std::unique_ptr<RxPacket>> rx_fillers_;
+  std::vector<std::unique_ptr<Packet>> rx_filler_headers_;
+  Table<short> rx_filler_samples_;
+  size_t rx_filler_next_ = 0;
 
   std::unique_ptr<Agora_recorder::RecorderThread> recorder_;
+  // Live metrics over HTTP, if bs_telemetry_port is set
+  std::unique_ptr<TelemetryServer> telemetry_;
+  // Timeline of the events of all the threads, if task_trace_events is set
+  std::unique_ptr<EventTracer> tracer_;
+  // Taps of the intermediate data, if tap_points is set
+  std::unique_ptr<DataTaps> taps_;
+  // Progress of the workers and its monitor thread, if stall_factor is set
+  std::unique_ptr<StallMonitor> stall_monitor_;
+  // Beam sweep of the analog arrays, if analog_beams is set
+  std::unique_ptr<AnalogBeams> analog_beams_;
+  // Row per frame in a binary file, if frame_log is set, with the counts at
+  // the previous row: decoded and errored code blocks of each UE, dropped
+  // packets
+  std::unique_ptr<FrameLog> frame_log_;
+  std::vector<size_t> frame_log_blocks_;
+  std::vector<size_t> frame_log_block_errors_;
+  size_t frame_log_rx_dropped_ = 0;
+  // Frames in a row with block errors, and the average EVM SNR of each UE,
+  // for the capture triggers
+  size_t capture_crc_frames_ = 0;
+  std::vector<float> capture_evm_avg_;
+
+  // Frames completed in order, which the bench mode producer stays within a
+  // frame window of
+  std::atomic<size_t> frames_done_{0};
+  // Completion of the bench warm-up frames, or the start of the event loop
+  size_t bench_start_tsc_ = 0;
+  double bench_frames_per_sec_ = 0;
+  double bench_deadline_miss_ratio_ = 0;
+  // Time spent creating the TXRX, MAC and worker threads
+  double threads_time_ms_ = 0;
+
+  // Sizes the subcarrier events with adaptive_block_target_us, else nullptr
+  std::unique_ptr<BlockSizeController> block_sizer_;
+
+  // Task queues of the master thread's doers, most urgent first, rebuilt
+  // every iteration if master_task_budget_us > 0
+  std::vector<AgoraWorker::QueueSlot> master_schedule_;
+  size_t master_budget_tsc_ = 0;
+  // Iterations in which the master ran tasks, those of them that used the
+  // whole budget, and the tasks run
+  size_t master_task_rounds_ = 0;
+  size_t master_task_full_rounds_ = 0;
+  size_t master_tasks_ = 0;
 
   DurationStat* duration_stat_;
 };
@@ -4,96 +4,208 @@
  */
 #include "agora_buffer.h"
 
+#include <utility>
+#include <vector>
+
+#include "gettime.h"
+#include "int16_equalizer.h"
+#include "logger.h"
+#include "packed_llr.h"
+
+// Threads that fault in the buffers, next to the thread creation and the
+// radio bring-up
+static constexpr size_t kPrefaultThreads = 4;
+
+// Placement of the buffers used by the threads starting at core_offset, the
+// same core PinToCoreWithOffset gives their first thread
+static Agora_memory::MemoryPolicy BufferPolicy(const Config* cfg,
+                                               size_t core_offset) {
+  Agora_memory::MemoryPolicy policy;
+  policy.page_type_ = cfg->BufferPageType();
+  if (cfg->NumaBindBuffers()) {
+    policy.numa_node_ = NumaNodeOfCoreWithOffset(core_offset, 0);
+  }
+  return policy;
+}
+
 AgoraBuffer::AgoraBuffer(Config* const cfg)
     : config_(cfg),
-      ul_socket_buf_size_(cfg->PacketLength() * cfg->BsAntNum() * kFrameWnd *
+      // The recorder holds the rx packets it records, up to
+      // recorder_lag_frames frames behind the FFT
+      ul_socket_buf_size_(cfg->PacketLength() * cfg->BsAntNum() *
+                          (cfg->FrameWindow() + cfg->RecorderLagFrames()) *
                           cfg->Frame().NumTotalSyms()),
-      csi_buffer_(kFrameWnd, cfg->UeAntNum(),
-                  cfg->BsAntNum() * cfg->OfdmDataNum()),
-      ul_beam_matrix_(kFrameWnd, cfg->OfdmDataNum(),
-                      cfg->BsAntNum() * cfg->SpatialStreamsNum()),
-      dl_beam_matrix_(kFrameWnd, cfg->OfdmDataNum(),
-                      cfg->SpatialStreamsNum() * cfg->BsAntNum()),
-      demod_buffer_(kFrameWnd, cfg->Frame().NumULSyms(),
-                    cfg->SpatialStreamsNum(), kMaxModType * cfg->OfdmDataNum()),
-      decoded_buffer_(kFrameWnd, cfg->Frame().NumULSyms(), cfg->UeAntNum(),
+      socket_policy_(BufferPolicy(cfg, cfg->CoreOffset() + 1)),
+      worker_policy_(
+          BufferPolicy(cfg, cfg->CoreOffset() + 1 + cfg->SocketThreadNum())),
+      csi_buffer_(cfg->FrameWindow(), cfg->UeAntNum(),
+                  cfg->BsAntNum() * cfg->OfdmDataNum(), worker_policy_),
+      ul_beam_matrix_(cfg->FrameWindow(), cfg->OfdmDataNum(),
+                      cfg->BsAntNum() * cfg->SpatialStreamsNum(),
+                      worker_policy_),
+      dl_beam_matrix_(cfg->FrameWindow(), cfg->OfdmDataNum(),
+                      cfg->SpatialStreamsNum() * cfg->BsAntNum(),
+                      worker_policy_),
+      demod_buffer_(cfg->FrameWindow(), cfg->Frame().NumULSyms(),
+                    cfg->SpatialStreamsNum(),
+                    PackedLlrBytes(kMaxModType * cfg->OfdmDataNum(),
+                                   cfg->DemodLlrBits()),
+                    worker_policy_),
+      decoded_buffer_(cfg->FrameWindow(), cfg->Frame().NumULSyms(),
+                      cfg->UeAntNum(),
                       cfg->LdpcConfig(Direction::kUplink).NumBlocksInSymbol() *
-                          Roundup<64>(cfg->NumBytesPerCb(Direction::kUplink))) {
+                          cfg->UlDecodedCbStride(),
+                      worker_policy_) {
+  const double start_us = GetTime::GetTimeUs();
   AllocateTables();
   AllocatePhaseShifts();
+  // Includes the member initializers, which are timed with the tables
+  alloc_time_ms_ = (GetTime::GetTimeUs() - start_us) / 1000.0;
+  PrintAllocation();
+#if defined(USE_CUDA)
+  if (cfg->GpuUplink()) {
+    gpu_uplink_ = std::make_unique<GpuUplink>(cfg, this);
+  }
+#endif
 }
 
-AgoraBuffer::~AgoraBuffer() { FreeTables(); }
+AgoraBuffer::~AgoraBuffer() {
+  JoinPrefault();
+#if defined(USE_CUDA)
+  gpu_uplink_.reset();
+#endif
+  FreeTables();
+}
 
 void AgoraBuffer::AllocateTables() {
   // Uplink
   const size_t task_buffer_symbol_num_ul =
-      config_->Frame().NumULSyms() * kFrameWnd;
+      config_->Frame().NumULSyms() * config_->FrameWindow();
 
   ul_socket_buffer_.Malloc(config_->SocketThreadNum() /* RX */,
                            ul_socket_buf_size_,
-                           Agora_memory::Alignment_t::kAlign64);
+                           Agora_memory::Alignment_t::kAlign64, socket_policy_);
 
   fft_buffer_.Malloc(task_buffer_symbol_num_ul,
                      config_->OfdmDataNum() * config_->BsAntNum(),
-                     Agora_memory::Alignment_t::kAlign64);
+                     Agora_memory::Alignment_t::kAlign64, worker_policy_);
 
   equal_buffer_.Malloc(task_buffer_symbol_num_ul,
                        config_->OfdmDataNum() * config_->SpatialStreamsNum(),
-                       Agora_memory::Alignment_t::kAlign64);
+                       Agora_memory::Alignment_t::kAlign64, worker_policy_);
   ue_spec_pilot_buffer_.Calloc(
-      kFrameWnd,
+      config_->FrameWindow(),
       config_->Frame().ClientUlPilotSymbols() * config_->SpatialStreamsNum(),
       Agora_memory::Alignment_t::kAlign64);
 
+  if (config_->BeamReuseThreshold() > 0.0f) {
+    beam_ref_csi_buffer_.Calloc(config_->BeamEventsPerSymbol(),
+                                config_->BeamBlockSize() *
+                                    config_->BsAntNum() *
+                                    config_->SpatialStreamsNum(),
+                                Agora_memory::Alignment_t::kAlign64);
+    beam_reuse_state_ =
+        std::vector<BeamReuseState>(config_->BeamEventsPerSymbol());
+    const size_t block_mat_size = config_->BeamBlockSize() *
+                                  config_->BsAntNum() *
+                                  config_->SpatialStreamsNum();
+    if (config_->BeamPredictionFrames() > 0) {
+      beam_pred_buffer_.Calloc(config_->BeamEventsPerSymbol(),
+                               2 * block_mat_size,
+                               Agora_memory::Alignment_t::kAlign64);
+    }
+    for (size_t i = 0; i < beam_reuse_state_.size(); i++) {
+      BeamReuseState& state = beam_reuse_state_.at(i);
+      state.busy_ = false;
+      state.computed_frame_ = SIZE_MAX;
+      state.computed_ue_list_.fill(SIZE_MAX);
+      state.written_frame_ = SIZE_MAX;
+      state.predicted_frame_ = SIZE_MAX;
+      state.predicted_ue_list_.fill(SIZE_MAX);
+      state.predicted_csi_ = nullptr;
+      state.predicted_ul_beams_ = nullptr;
+      if (config_->BeamPredictionFrames() > 0) {
+        state.predicted_csi_ = beam_pred_buffer_[i];
+        state.predicted_ul_beams_ = beam_pred_buffer_[i] + block_mat_size;
+      }
+    }
+  }
+
+  if (config_->FftBatchSymbol()) {
+    fft_symbol_packets_ = std::vector<RxPacket*>(
+        config_->FrameWindow() * config_->Frame().NumTotalSyms() *
+            config_->BsAntNum(),
+        nullptr);
+  }
+
+  if (config_->UlBeamInt16()) {
+    ul_beam_int16_.Alloc(config_->FrameWindow(), config_->OfdmDataNum(),
+                         Int16Equalizer::kValuesPerEntry *
+                             config_->BsAntNum() *
+                             config_->SpatialStreamsNum(),
+                         worker_policy_);
+    ul_beam_scale_.Calloc(config_->FrameWindow(), config_->OfdmDataNum(),
+                          Agora_memory::Alignment_t::kAlign64, worker_policy_);
+  }
+
+  if (config_->HarqProcesses() > 0) {
+    const LDPCconfig& ldpc_config = config_->LdpcConfig(Direction::kUplink);
+    harq_buffer_ = std::make_unique<HarqBuffer>(
+        config_->UeAntNum(), config_->HarqProcesses(),
+        config_->Frame().NumULSyms() * ldpc_config.NumBlocksInSymbol(),
+        ldpc_config.NumCbCodewLen(), config_->HarqLlrBits(),
+        config_->HarqMaxTx());
+  }
+
   // Downlink Control + Data
   if (config_->Frame().NumDlControlSyms() + config_->Frame().NumDLSyms() > 0) {
     const size_t socket_buffer_symbol_num =
-        kFrameWnd *
+        config_->FrameWindow() *
         (config_->Frame().NumDlControlSyms() + config_->Frame().NumDLSyms());
 
     size_t dl_socket_buffer_status_size =
         config_->BsAntNum() * socket_buffer_symbol_num;
-    size_t dl_socket_buffer_size =
+    dl_socket_buf_size_ =
         config_->DlPacketLength() * dl_socket_buffer_status_size;
-    AllocBuffer1d(&dl_socket_buffer_, dl_socket_buffer_size,
-                  Agora_memory::Alignment_t::kAlign64, 1);
+    AllocBuffer1d(&dl_socket_buffer_, dl_socket_buf_size_,
+                  Agora_memory::Alignment_t::kAlign64, 1, socket_policy_);
   }
 
   // Downlink Data
   if (config_->Frame().NumDLSyms() > 0) {
     const size_t task_buffer_symbol_num =
-        kFrameWnd * config_->Frame().NumDLSyms();
+        config_->FrameWindow() * config_->Frame().NumDLSyms();
 
     size_t dl_bits_buffer_size =
-        kFrameWnd * config_->MacBytesNumPerframe(Direction::kDownlink);
+        config_->FrameWindow() *
+        config_->MacBytesNumPerframe(Direction::kDownlink);
     dl_bits_buffer_.Calloc(config_->UeAntNum(), dl_bits_buffer_size,
                            Agora_memory::Alignment_t::kAlign64);
-    dl_bits_buffer_status_.Calloc(config_->UeAntNum(), kFrameWnd,
+    dl_bits_buffer_status_.Calloc(config_->UeAntNum(), config_->FrameWindow(),
                                   Agora_memory::Alignment_t::kAlign64);
 
     dl_ifft_buffer_.Calloc(config_->BsAntNum() * task_buffer_symbol_num,
                            config_->OfdmCaNum(),
-                           Agora_memory::Alignment_t::kAlign64);
-    calib_dl_buffer_.Malloc(kFrameWnd,
+                           Agora_memory::Alignment_t::kAlign64, worker_policy_);
+    calib_dl_buffer_.Malloc(config_->FrameWindow(),
                             config_->BfAntNum() * config_->OfdmDataNum(),
                             Agora_memory::Alignment_t::kAlign64);
-    calib_ul_buffer_.Malloc(kFrameWnd,
+    calib_ul_buffer_.Malloc(config_->FrameWindow(),
                             config_->BfAntNum() * config_->OfdmDataNum(),
                             Agora_memory::Alignment_t::kAlign64);
-    calib_dl_msum_buffer_.Malloc(kFrameWnd,
+    calib_dl_msum_buffer_.Malloc(config_->FrameWindow(),
                                  config_->BfAntNum() * config_->OfdmDataNum(),
                                  Agora_memory::Alignment_t::kAlign64);
-    calib_ul_msum_buffer_.Malloc(kFrameWnd,
+    calib_ul_msum_buffer_.Malloc(config_->FrameWindow(),
                                  config_->BfAntNum() * config_->OfdmDataNum(),
                                  Agora_memory::Alignment_t::kAlign64);
-    calib_buffer_.Malloc(kFrameWnd,
+    calib_buffer_.Malloc(config_->FrameWindow(),
                          config_->BfAntNum() * config_->OfdmDataNum(),
                          Agora_memory::Alignment_t::kAlign64);
     //initialize the calib buffers
     const complex_float complex_init = {0.0f, 0.0f};
     //const complex_float complex_init = {1.0f, 0.0f};
-    for (size_t frame = 0u; frame < kFrameWnd; frame++) {
+    for (size_t frame = 0u; frame < config_->FrameWindow(); frame++) {
       for (size_t i = 0; i < (config_->OfdmDataNum() * config_->BfAntNum());
            i++) {
         calib_dl_buffer_[frame][i] = complex_init;
@@ -103,27 +215,116 @@ void AgoraBuffer::AllocateTables() {
         calib_buffer_[frame][i] = complex_init;
       }
     }
-    dl_mod_bits_buffer_.Calloc(
-        task_buffer_symbol_num,
-        Roundup<64>(config_->GetOFDMDataNum()) * config_->SpatialStreamsNum(),
-        Agora_memory::Alignment_t::kAlign64);
+    if (config_->FuseEncodeModulation()) {
+      // The encoder writes the modulated symbols, so no modulation bits
+      dl_mod_symbols_buffer_.Calloc(
+          task_buffer_symbol_num,
+          config_->OfdmDataNum() * config_->SpatialStreamsNum(),
+          Agora_memory::Alignment_t::kAlign64, worker_policy_);
+    } else {
+      dl_mod_bits_buffer_.Calloc(
+          task_buffer_symbol_num,
+          Roundup<64>(config_->GetOFDMDataNum()) *
+              config_->SpatialStreamsNum(),
+          Agora_memory::Alignment_t::kAlign64, worker_policy_);
+    }
   }
 }
 
 void AgoraBuffer::AllocatePhaseShifts() {
-  for (size_t frame = 0; frame < kFrameWnd; frame++) {
+  for (size_t frame = 0; frame < config_->FrameWindow(); frame++) {
     ul_phase_base_[frame] = arma::fmat(config_->UeAntNum(),
                                        config_->Frame().ClientUlPilotSymbols());
     ul_phase_shift_per_symbol_[frame] = ul_phase_base_[frame].col(0);
   }
 }
 
+void AgoraBuffer::StartPrefault() {
+  RtAssert(prefault_thread_.joinable() == false,
+           "AgoraBuffer: prefault already started");
+  // The other tables are zeroed, which already faulted their pages in
+  std::vector<std::pair<void*, size_t>> buffers = {
+      {ul_socket_buffer_.get_data_ptr(), ul_socket_buffer_.SizeBytes()},
+      {fft_buffer_.get_data_ptr(), fft_buffer_.SizeBytes()},
+      {equal_buffer_.get_data_ptr(), equal_buffer_.SizeBytes()},
+      {dl_socket_buffer_, dl_socket_buf_size_}};
+  prefault_thread_ = std::thread([this, buffers]() {
+    const double start_us = GetTime::GetTimeUs();
+    size_t bytes = 0;
+    for (const auto& buffer : buffers) {
+      bytes += buffer.second;
+    }
+    if (Agora_memory::PrefaultParallel(buffers, kPrefaultThreads) == false) {
+      AGORA_LOG_WARN(
+          "AgoraBuffer: the kernel cannot prefault buffers, they are "
+          "faulted in by the first frames\n");
+      bytes = 0;
+    }
+    prefault_time_ms_ = (GetTime::GetTimeUs() - start_us) / 1000.0;
+    AGORA_LOG_INFO("AgoraBuffer: prefaulted %.3f MB in %.1f ms\n",
+                   bytes / (1024.0 * 1024.0), prefault_time_ms_);
+  });
+}
+
+double AgoraBuffer::JoinPrefault() {
+  if (prefault_thread_.joinable()) {
+    prefault_thread_.join();
+  }
+  return prefault_time_ms_;
+}
+
+void AgoraBuffer::PrintAllocation() const {
+  const std::vector<std::pair<const char*, size_t>> buffers = {
+      {"ul_socket", ul_socket_buffer_.SizeBytes()},
+      {"csi", csi_buffer_.SizeBytes()},
+      {"ul_beam_matrix", ul_beam_matrix_.SizeBytes()},
+      {"ul_beam_int16",
+       ul_beam_int16_.SizeBytes() + ul_beam_scale_.SizeBytes()},
+      {"dl_beam_matrix", dl_beam_matrix_.SizeBytes()},
+      {"demod", demod_buffer_.SizeBytes()},
+      {"decoded", decoded_buffer_.SizeBytes()},
+      {"fft", fft_buffer_.SizeBytes()},
+      {"equal", equal_buffer_.SizeBytes()},
+      {"ue_spec_pilot", ue_spec_pilot_buffer_.SizeBytes()},
+      {"beam_ref_csi", beam_ref_csi_buffer_.SizeBytes()},
+      {"beam_pred", beam_pred_buffer_.SizeBytes()},
+      {"harq", (harq_buffer_ != nullptr) ? harq_buffer_->SizeBytes() : 0},
+      {"dl_socket", dl_socket_buf_size_},
+      {"dl_ifft", dl_ifft_buffer_.SizeBytes()},
+      {"dl_mod_bits", dl_mod_bits_buffer_.SizeBytes()},
+      {"dl_mod_symbols", dl_mod_symbols_buffer_.SizeBytes()},
+      {"dl_bits", dl_bits_buffer_.SizeBytes()},
+      {"calib", calib_dl_buffer_.SizeBytes() + calib_ul_buffer_.SizeBytes() +
+                    calib_dl_msum_buffer_.SizeBytes() +
+                    calib_ul_msum_buffer_.SizeBytes() +
+                    calib_buffer_.SizeBytes()}};
+
+  size_t total_bytes = 0;
+  AGORA_LOG_INFO(
+      "AgoraBuffer: allocated for a frame window of %zu frames, page type %zu, "
+      "socket buffers on NUMA node %d, worker buffers on NUMA node %d\n",
+      config_->FrameWindow(), static_cast<size_t>(config_->BufferPageType()),
+      socket_policy_.numa_node_, worker_policy_.numa_node_);
+  for (const auto& buffer : buffers) {
+    if (buffer.second > 0) {
+      AGORA_LOG_INFO("AgoraBuffer:   %-16s %10.3f MB\n", buffer.first,
+                     buffer.second / (1024.0 * 1024.0));
+    }
+    total_bytes += buffer.second;
+  }
+  AGORA_LOG_INFO("AgoraBuffer:   %-16s %10.3f MB\n", "total",
+                 total_bytes / (1024.0 * 1024.0));
+}
+
 void AgoraBuffer::FreeTables() {
   // Uplink
   ul_socket_buffer_.Free();
   fft_buffer_.Free();
   equal_buffer_.Free();
   ue_spec_pilot_buffer_.Free();
+  beam_ref_csi_buffer_.Free();
+  beam_pred_buffer_.Free();
+  ul_beam_scale_.Free();
 
   // Downlink
   if (config_->Frame().NumDLSyms() > 0) {
@@ -135,6 +336,7 @@ void AgoraBuffer::FreeTables() {
     calib_ul_msum_buffer_.Free();
     calib_buffer_.Free();
     dl_mod_bits_buffer_.Free();
+    dl_mod_symbols_buffer_.Free();
     dl_bits_buffer_.Free();
     dl_bits_buffer_status_.Free();
   }
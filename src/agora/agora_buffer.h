@@ -6,20 +6,55 @@
 #ifndef AGORA_BUFFER_H_
 #define AGORA_BUFFER_H_
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <memory>
 #include <queue>
+#include <thread>
+#include <vector>
 
 #include "common_typedef_sdk.h"
 #include "concurrent_queue_wrapper.h"
 #include "concurrentqueue.h"
 #include "config.h"
+#include "harq_buffer.h"
 #include "mac_scheduler.h"
 #include "memory_manage.h"
 #include "message.h"
+#include "shared_counters.h"
+#include "spsc_event_ring.h"
 #include "symbols.h"
+#include "task_scheduler.h"
 #include "utils.h"
 
+#if defined(USE_CUDA)
+#include "gpu_uplink.h"
+#endif
+
+/// Bookkeeping of one beam block for reusing beamweights across frames.
+/// Shared by all DoBeamWeights workers; only the worker that set busy_ may
+/// read or modify the other fields.
+struct BeamReuseState {
+  std::atomic<bool> busy_;
+  /// Frame whose CSI was used to compute the current beamweights
+  size_t computed_frame_;
+  /// Scheduled UEs of computed_frame_, by spatial stream. The reference CSI
+  /// is stored by spatial stream, so it only compares the channels of the
+  /// same UEs.
+  std::array<size_t, kMaxUEs> computed_ue_list_;
+  /// Last frame whose beamweight slot holds valid beamweights
+  size_t written_frame_;
+  /// Frame the predicted CSI and uplink beamweights are for, with
+  /// beam_prediction_frames
+  size_t predicted_frame_;
+  /// Scheduled UEs of predicted_frame_, by spatial stream
+  std::array<size_t, kMaxUEs> predicted_ue_list_;
+  complex_float* predicted_csi_;
+  complex_float* predicted_ul_beams_;
+};
+
 class AgoraBuffer {
  public:
   explicit AgoraBuffer(Config* const cfg);
@@ -34,9 +69,20 @@ class AgoraBuffer {
   inline PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& GetUlBeamMatrix() {
     return ul_beam_matrix_;
   }
+  inline PtrGrid<kFrameWnd, kMaxDataSCs, int16_t>& GetUlBeamInt16() {
+    return ul_beam_int16_;
+  }
+  inline Table<float>& GetUlBeamScale() { return ul_beam_scale_; }
   inline PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& GetDlBeamMatrix() {
     return dl_beam_matrix_;
   }
+  inline Table<complex_float>& GetBeamRefCsi() { return beam_ref_csi_buffer_; }
+  inline std::vector<BeamReuseState>& GetBeamReuseState() {
+    return beam_reuse_state_;
+  }
+  inline std::vector<RxPacket*>& GetFftSymbolPackets() {
+    return fft_symbol_packets_;
+  }
   inline PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& GetDemod() {
     return demod_buffer_;
   }
@@ -44,6 +90,12 @@ class AgoraBuffer {
   inline PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& GetDecod() {
     return decoded_buffer_;
   }
+  /// Uplink HARQ soft buffers, nullptr if HARQ is off
+  inline HarqBuffer* GetHarq() { return harq_buffer_.get(); }
+#if defined(USE_CUDA)
+  /// Device state of the uplink on the GPU, nullptr without gpu_uplink
+  inline GpuUplink* GetGpuUplink() { return gpu_uplink_.get(); }
+#endif
   inline Table<complex_float>& GetFft() { return fft_buffer_; }
   inline Table<complex_float>& GetEqual() { return equal_buffer_; }
   inline Table<complex_float>& GetUeSpecPilot() {
@@ -60,6 +112,9 @@ class AgoraBuffer {
     return dl_bcast_socket_buffer_;
   }
   inline Table<int8_t>& GetDlModBits() { return dl_mod_bits_buffer_; }
+  inline Table<complex_float>& GetDlModSymbols() {
+    return dl_mod_symbols_buffer_;
+  }
   inline Table<int8_t>& GetDlBits() { return dl_bits_buffer_; }
   inline Table<int8_t>& GetDlBitsStatus() { return dl_bits_buffer_status_; }
 
@@ -77,16 +132,34 @@ class AgoraBuffer {
     return ul_phase_shift_per_symbol_;
   }
 
+  /// Time spent allocating the buffers, for the startup profile
+  inline double AllocTimeMs() const { return alloc_time_ms_; }
+  /// Fault in the pages of the buffers that are not zeroed at allocation on
+  /// a background thread, so that the first frames do not page fault
+  void StartPrefault();
+  /// Wait for StartPrefault to finish. Returns the time the background
+  /// thread spent, 0 if it was not started.
+  double JoinPrefault();
+
  private:
   void AllocateTables();
   void AllocatePhaseShifts();
+  /// Log the bytes allocated for each buffer and their total
+  void PrintAllocation() const;
   void FreeTables();
 
   Config* const config_;
   const size_t ul_socket_buf_size_;
+  // Placement of the buffers used by the TXRX threads and by the workers
+  const Agora_memory::MemoryPolicy socket_policy_;
+  const Agora_memory::MemoryPolicy worker_policy_;
 
   PtrGrid<kFrameWnd, kMaxUEs, complex_float> csi_buffer_;
   PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ul_beam_matrix_;
+  // int16 copies of the uplink beamweights and the scale of each, with
+  // ul_beam_int16
+  PtrGrid<kFrameWnd, kMaxDataSCs, int16_t> ul_beam_int16_;
+  Table<float> ul_beam_scale_;
   PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> dl_beam_matrix_;
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t> demod_buffer_;
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t> decoded_buffer_;
@@ -94,37 +167,64 @@ class AgoraBuffer {
   Table<complex_float> equal_buffer_;
   Table<complex_float> ue_spec_pilot_buffer_;
   Table<complex_float> dl_ifft_buffer_;
+  // Antenna-major like calib_ul_buffer_, calib_buffer_ is subcarrier-major
   Table<complex_float> calib_ul_msum_buffer_;
   Table<complex_float> calib_dl_msum_buffer_;
   Table<complex_float> calib_buffer_;
+  // CSI each beam block's beamweights were last computed with
+  Table<complex_float> beam_ref_csi_buffer_;
+  // Predicted CSI, then predicted uplink beamweights, of each beam block
+  Table<complex_float> beam_pred_buffer_;
+  std::vector<BeamReuseState> beam_reuse_state_;
+  // Received packets of the symbols FFTed in one task, indexed by
+  // ((frame slot * symbols per frame) + symbol) * antennas + antenna
+  std::vector<RxPacket*> fft_symbol_packets_;
+  std::unique_ptr<HarqBuffer> harq_buffer_;
+#if defined(USE_CUDA)
+  // Page-locks the tables it copies from and to, so it is destroyed first
+  std::unique_ptr<GpuUplink> gpu_uplink_;
+#endif
   Table<int8_t> dl_mod_bits_buffer_;
+  // Modulated downlink symbols in the precoder input layout, with
+  // fuse_encode_modulation
+  Table<complex_float> dl_mod_symbols_buffer_;
   Table<int8_t> dl_bits_buffer_;
   Table<int8_t> dl_bits_buffer_status_;
   Table<std::complex<int16_t>> dl_bcast_socket_buffer_;
 
+  // Sized for kFrameWnd, only the first FrameWindow() frames are used
   std::array<arma::fmat, kFrameWnd> ul_phase_base_;
   std::array<arma::fmat, kFrameWnd> ul_phase_shift_per_symbol_;
 
   Table<char> ul_socket_buffer_;
   char* dl_socket_buffer_;
+  size_t dl_socket_buf_size_{0};
   Table<complex_float> calib_ul_buffer_;
   Table<complex_float> calib_dl_buffer_;
+
+  double alloc_time_ms_{0};
+  std::thread prefault_thread_;
+  double prefault_time_ms_{0};
 };
 
-#if !defined(SINGLE_THREAD)
 struct SchedInfo {
   moodycamel::ConcurrentQueue<EventData> concurrent_q_;
   moodycamel::ProducerToken* ptok_;
 };
-#endif
 
 // Used to communicate between the manager and the streamer/worker class
 // Needs to manage its own memory
 class MessageInfo {
  public:
+  /// num_queue_sets sets of task and completion queues are allocated, one
+  /// per frame in processing
   explicit MessageInfo(size_t queue_size, size_t rx_queue_size,
-                       size_t num_socket_thread)
-      : num_socket_thread(num_socket_thread) {
+                       size_t num_socket_thread,
+                       size_t num_queue_sets = kScheduleQueues)
+      : num_socket_thread(num_socket_thread),
+        num_queue_sets_(num_queue_sets) {
+    RtAssert(num_queue_sets_ <= kMaxScheduleQueues,
+             "MessageInfo: too many queue sets");
     tx_concurrent_queue = moodycamel::ConcurrentQueue<EventData>(queue_size);
     rx_concurrent_queue = moodycamel::ConcurrentQueue<EventData>(rx_queue_size);
 
@@ -133,10 +233,8 @@ class MessageInfo {
       tx_ptoks_ptr_[i] = new moodycamel::ProducerToken(tx_concurrent_queue);
     }
 
-#if !defined(SINGLE_THREAD)
     // Allocate memory for the task concurrent queues
     Alloc(queue_size);
-#endif
   }
   ~MessageInfo() {
     for (size_t i = 0; i < num_socket_thread; i++) {
@@ -146,10 +244,8 @@ class MessageInfo {
       tx_ptoks_ptr_[i] = nullptr;
     }
 
-#if !defined(SINGLE_THREAD)
     // Free memory for the task concurrent queues
     Free();
-#endif
   }
 
   inline moodycamel::ConcurrentQueue<EventData>* GetTxConQ() {
@@ -167,33 +263,37 @@ class MessageInfo {
     return rx_ptoks_ptr_[idx];
   }
 
-#ifdef SINGLE_THREAD
-  inline std::queue<EventData>* GetTaskQueue(EventType event_type, size_t qid) {
-    return &task_queues.at(qid).at(static_cast<size_t>(event_type));
+  /// Give each TxRx thread a ring of num_slots events of its own, which
+  /// replaces its producer of the RX concurrent queue
+  inline void EnableRxRings(size_t num_slots) {
+    rx_rings_.clear();
+    for (size_t i = 0; i < num_socket_thread; i++) {
+      rx_rings_.push_back(std::make_unique<SpscEventRing>(num_slots));
+    }
   }
-  inline std::queue<EventData>& GetCompQueue(size_t qid) {
-    return complete_task_queues_.at(qid);
+  /// The ring of TxRx thread idx, nullptr if it uses the RX concurrent queue
+  inline SpscEventRing* GetRxRing(size_t idx) {
+    return rx_rings_.empty() ? nullptr : rx_rings_.at(idx).get();
   }
-  inline void EnqueueEventTaskQueue(EventType event_type, size_t qid,
-                                    EventData event) {
-    this->GetTaskQueue(event_type, qid)->push(event);
+  /// Dequeue up to max_events events of TxRx thread idx, from its ring or
+  /// its producer of the RX concurrent queue
+  inline size_t DequeueRxEvents(size_t idx, EventData* events,
+                                size_t max_events) {
+    if (rx_rings_.empty() == false) {
+      return rx_rings_.at(idx)->TryPopBulk(events, max_events);
+    }
+    return rx_concurrent_queue.try_dequeue_bulk_from_producer(
+        *rx_ptoks_ptr_[idx], events, max_events);
   }
-  inline size_t DequeueEventCompQueueBulk(size_t qid,
-                                          std::vector<EventData>& events_list) {
-    size_t total_events = 0;
-    size_t max_events = events_list.size();
-    std::queue<EventData>* comp_queue = &this->GetCompQueue(qid);
-    while (!comp_queue->empty() && total_events < max_events) {
-      events_list.at(total_events) = comp_queue->front();
-      comp_queue->pop();
-      ++total_events;
+  /// Approximate number of events from the TxRx threads
+  inline size_t RxQueueDepth() const {
+    size_t depth = rx_concurrent_queue.size_approx();
+    for (const auto& ring : rx_rings_) {
+      depth += ring->SizeApprox();
     }
-    // if (total_events == max_events) {
-    //   printf("Note: use up max space of complete queue\n");
-    // }
-    return total_events;
+    return depth;
   }
-#else
+
   inline moodycamel::ProducerToken* GetPtok(EventType event_type, size_t qid) {
     return task_queue_.at(qid).at(static_cast<size_t>(event_type)).ptok_;
   }
@@ -210,77 +310,152 @@ class MessageInfo {
                                                   size_t worker_id) {
     return worker_ptoks_ptr_.at(qid).at(worker_id);
   }
-  inline void EnqueueEventTaskQueue(EventType event_type, size_t qid,
-                                    EventData event) {
-    TryEnqueueFallback(this->GetTaskQueue(event_type, qid),
-                       this->GetPtok(event_type, qid), event);
+  inline void EnqueueEventTaskQueue(
+      EventType event_type, size_t qid, EventData event,
+      TaskPriority priority = TaskPriority::kNormal) {
+    if (work_stealing_ != nullptr) {
+      work_stealing_->Push(event, qid, priority);
+    } else {
+      TryEnqueueFallback(this->GetTaskQueue(event_type, qid),
+                         this->GetPtok(event_type, qid), event);
+    }
+  }
+
+  /// Enqueue a task of the UE (or spatial stream) key: on the workers that
+  /// the key is affine to with work stealing, as EnqueueEventTaskQueue()
+  /// otherwise
+  inline void EnqueueAffineTask(EventType event_type, size_t qid,
+                                EventData event, TaskPriority priority,
+                                size_t key) {
+    if (work_stealing_ != nullptr) {
+      work_stealing_->PushAffine(event, qid, priority, key);
+    } else {
+      EnqueueEventTaskQueue(event_type, qid, event, priority);
+    }
+  }
+
+  /// Route all tasks through per-worker deques with work stealing instead of
+  /// the per-EventType task queues
+  inline void EnableWorkStealing(size_t num_workers) {
+    work_stealing_ = std::make_unique<WorkStealingScheduler>(num_workers);
+  }
+  /// The work-stealing scheduler, nullptr if tasks go through the task queues
+  inline WorkStealingScheduler* GetWorkStealing() {
+    return work_stealing_.get();
+  }
+  /// Count the completed tasks of event_type in the workers, so that only
+  /// the last task of each symbol is posted to the completion queue
+  inline void EnableSharedCounters(EventType event_type,
+                                   size_t max_task_count) {
+    shared_counters_.at(static_cast<size_t>(event_type)) =
+        std::make_unique<SharedTaskCounters>(max_task_count);
+  }
+  /// The shared task counters of event_type, nullptr if the master counts
+  /// the tasks of event_type
+  inline SharedTaskCounters* GetSharedCounters(EventType event_type) {
+    return shared_counters_.at(static_cast<size_t>(event_type)).get();
+  }
+  /// Let the worker that completes the FFT of an uplink symbol run its demul
+  inline void EnableFftDemulFusion(size_t fft_tasks_per_symbol) {
+    fft_demul_fusion_ = std::make_unique<FftDemulFusion>(fft_tasks_per_symbol);
+  }
+  /// The FFT-demul fusion state, nullptr if the master schedules all demul
+  inline FftDemulFusion* GetFftDemulFusion() {
+    return fft_demul_fusion_.get();
+  }
+  /// Approximate number of tasks in the task queues. Tasks in the deques of
+  /// the work-stealing scheduler are not counted.
+  inline size_t TaskQueueDepth() const {
+    size_t depth = 0;
+    for (const auto& queue : task_queue_) {
+      for (const auto& event : queue) {
+        depth += event.concurrent_q_.size_approx();
+      }
+    }
+    return depth;
+  }
+  /// Approximate number of events in the completion queues
+  /// Approximate number of tasks of event_type in the task queues
+  inline size_t TaskQueueDepth(EventType event_type) const {
+    size_t depth = 0;
+    for (const auto& queue : task_queue_) {
+      depth += queue.at(static_cast<size_t>(event_type))
+                   .concurrent_q_.size_approx();
+    }
+    return depth;
+  }
+
+  inline size_t CompQueueDepth() const {
+    size_t depth = 0;
+    for (const auto& queue : complete_task_queue_) {
+      depth += queue.size_approx();
+    }
+    return depth;
   }
   inline size_t DequeueEventCompQueueBulk(size_t qid,
                                           std::vector<EventData>& events_list) {
     return this->GetCompQueue(qid).try_dequeue_bulk(&events_list.at(0),
                                                     events_list.size());
   }
-#endif
+  /// At most max_events of them
+  inline size_t DequeueEventCompQueueBulk(size_t qid,
+                                          std::vector<EventData>& events_list,
+                                          size_t max_events) {
+    return this->GetCompQueue(qid).try_dequeue_bulk(
+        &events_list.at(0), std::min(max_events, events_list.size()));
+  }
 
  private:
   size_t num_socket_thread;
+  size_t num_queue_sets_;
   // keep the concurrent queue to communicate to streamer thread
   moodycamel::ConcurrentQueue<EventData> tx_concurrent_queue;
   moodycamel::ConcurrentQueue<EventData> rx_concurrent_queue;
   moodycamel::ProducerToken* rx_ptoks_ptr_[kMaxThreads];
   moodycamel::ProducerToken* tx_ptoks_ptr_[kMaxThreads];
+  // One per TxRx thread, empty unless EnableRxRings() is called
+  std::vector<std::unique_ptr<SpscEventRing>> rx_rings_;
 
-#ifdef SINGLE_THREAD
-  std::array<std::array<std::queue<EventData>, kNumEventTypes>, kScheduleQueues>
-      task_queues;
-  std::array<std::queue<EventData>, kScheduleQueues> complete_task_queues_;
-#else
-  std::array<std::array<SchedInfo, kNumEventTypes>, kScheduleQueues>
+  std::unique_ptr<WorkStealingScheduler> work_stealing_;
+  std::array<std::unique_ptr<SharedTaskCounters>, kNumEventTypes>
+      shared_counters_;
+  std::unique_ptr<FftDemulFusion> fft_demul_fusion_;
+  std::array<std::array<SchedInfo, kNumEventTypes>, kMaxScheduleQueues>
       task_queue_;
-  std::array<moodycamel::ConcurrentQueue<EventData>, kScheduleQueues>
+  std::array<moodycamel::ConcurrentQueue<EventData>, kMaxScheduleQueues>
       complete_task_queue_;
   std::array<std::array<moodycamel::ProducerToken*, kMaxThreads>,
-             kScheduleQueues>
+             kMaxScheduleQueues>
       worker_ptoks_ptr_;
 
   inline void Alloc(size_t queue_size) {
-    // Allocate memory for the task concurrent queues
-    for (auto& queue : complete_task_queue_) {
-      queue = moodycamel::ConcurrentQueue<EventData>(queue_size);
-    }
-    for (auto& queue : task_queue_) {
-      for (auto& event : queue) {
+    // Allocate memory for the task concurrent queues of the sets in use
+    for (size_t qid = 0; qid < num_queue_sets_; qid++) {
+      complete_task_queue_.at(qid) =
+          moodycamel::ConcurrentQueue<EventData>(queue_size);
+      for (auto& event : task_queue_.at(qid)) {
         event.concurrent_q_ =
             moodycamel::ConcurrentQueue<EventData>(queue_size);
         event.ptok_ = new moodycamel::ProducerToken(event.concurrent_q_);
       }
-    }
-
-    size_t queue_count = 0;
-    for (auto& queue : worker_ptoks_ptr_) {
-      for (auto& worker : queue) {
-        worker =
-            new moodycamel::ProducerToken(complete_task_queue_.at(queue_count));
+      for (auto& worker : worker_ptoks_ptr_.at(qid)) {
+        worker = new moodycamel::ProducerToken(complete_task_queue_.at(qid));
       }
-      queue_count++;
     }
   }
 
   inline void Free() {
-    for (auto& queue : task_queue_) {
-      for (auto& event : queue) {
+    for (size_t qid = 0; qid < num_queue_sets_; qid++) {
+      for (auto& event : task_queue_.at(qid)) {
         delete event.ptok_;
         event.ptok_ = nullptr;
       }
-    }
-    for (auto& queue : worker_ptoks_ptr_) {
-      for (auto& worker : queue) {
+      for (auto& worker : worker_ptoks_ptr_.at(qid)) {
         delete worker;
         worker = nullptr;
       }
     }
   }
-#endif
 };
 
 struct FrameInfo {
@@ -288,4 +463,14 @@ struct FrameInfo {
   size_t cur_proc_frame_id_;
 };
 
+/// TX deadline of a frame's downlink, for the deadline-aware downlink
+/// scheduling
+struct DlDeadline {
+  size_t frame_id_ = SIZE_MAX;
+  /// RDTSC timestamp of the TX slot of the frame's first downlink symbol
+  size_t tx_tsc_ = 0;
+  /// The downlink of the frame was dropped instead of processed
+  bool dropped_ = false;
+};
+
 #endif  // AGORA_BUFFER_H_
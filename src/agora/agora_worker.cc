@@ -5,170 +5,454 @@
 
 #include "agora_worker.h"
 
+#include <algorithm>
+
 #include "concurrent_queue_wrapper.h"
 #include "csv_logger.h"
 #include "dobeamweights.h"
+#include "dobroadcast.h"
 #include "dodecode.h"
 #include "dodemul.h"
 #include "doencode.h"
 #include "dofft.h"
 #include "doifft.h"
 #include "doprecode.h"
+#include "idle_policy.h"
 #include "logger.h"
+#include "resctrl.h"
 
 #if defined(USE_ACC100)
+#include "bbdev_device.h"
 #include "dodecode_acc.h"
+#include "dodecode_hybrid.h"
+#include "doencode_acc.h"
+#endif
+
+#if defined(USE_CUDA)
+#include "douplink_gpu.h"
 #endif
 
+// True if worker tid runs the tasks of event_type as one of its own stages:
+// those of its worker groups, and those of the stages with no group
+static bool OwnsStage(const Config* cfg, EventType event_type, int tid) {
+  if (event_type == EventType::kFFTSymbol) {
+    event_type = EventType::kFFT;
+  }
+  for (const auto& stage : kWorkerGroupStages) {
+    if (stage.second != event_type) {
+      continue;
+    }
+    const auto group = cfg->WorkerGroups().find(stage.first);
+    return (group == cfg->WorkerGroups().end()) ||
+           (std::find(group->second.begin(), group->second.end(),
+                      static_cast<size_t>(tid)) != group->second.end());
+  }
+  return true;
+}
+
 AgoraWorker::AgoraWorker(Config* cfg, MacScheduler* mac_sched, Stats* stats,
                          PhyStats* phy_stats, MessageInfo* message,
-                         AgoraBuffer* buffer, FrameInfo* frame)
-    : base_worker_core_offset_(cfg->CoreOffset() + 1 + cfg->SocketThreadNum()),
-      config_(cfg),
-      mac_sched_(mac_sched),
-      stats_(stats),
-      phy_stats_(phy_stats),
-      message_(message),
-      buffer_(buffer),
-      frame_(frame) {
-#ifdef SINGLE_THREAD
-  tid = 0;  // starts with 0 but has only one thread (master)
-  cur_qid = 0;
-  empty_queue_itrs = 0;
-  empty_queue = true;
-
-  InitializeWorker();
-#else
+                         AgoraBuffer* buffer, FrameInfo* frame,
+                         EventTracer* tracer, DataTaps* taps,
+                         StallMonitor* stall_monitor,
+                         AnalogBeams* analog_beams)
+    : AgoraWorker(std::vector<Cell>{{cfg, mac_sched, stats, phy_stats, message,
+                                     buffer, frame, tracer, taps,
+                                     stall_monitor, analog_beams}}) {}
+
+AgoraWorker::AgoraWorker(std::vector<Cell> cells)
+    : cells_(std::move(cells)),
+      config_(cells_.at(0).cfg_),
+      base_worker_core_offset_(config_->CoreOffset() + 1 +
+                               config_->SocketThreadNum()),
+      create_us_(GetTime::GetTimeUs()) {
+  for (const Cell& cell : cells_) {
+    // The message queues and schedulers of each cell have a producer token
+    // or deques per worker
+    RtAssert(cell.cfg_->WorkerThreadNum() == config_->WorkerThreadNum(),
+             "Worker: the cells sharing the workers must configure the same "
+             "worker_thread_num");
+    RtAssert((cells_.size() == 1) || (cell.cfg_->MasterRunsWorker() == false),
+             "Worker: cells sharing the workers need the multi_core execution "
+             "model");
+  }
+  // The worker threads build their doers while the master builds its own
   CreateThreads();
-#endif
+  if (config_->MasterRunsWorker()) {
+    // The master thread always is worker 0
+    master_worker_ = std::make_unique<WorkerContext>(0);
+    InitializeWorker(*master_worker_);
+  }
 }
 
-#ifdef SINGLE_THREAD
-AgoraWorker::~AgoraWorker() {}
-#else
 AgoraWorker::~AgoraWorker() { JoinThreads(); }
-#endif
 
-#ifdef SINGLE_THREAD
-void AgoraWorker::InitializeWorker() {
-  /* Limit the number of thread to be 1 */
-  if (config_->WorkerThreadNum() != 1) {
-    AGORA_LOG_ERROR("Worker: Single-core mode allows only 1 worker thread!\n");
-    exit(EXIT_FAILURE);
+void AgoraWorker::InitializeWorker(WorkerContext& context) {
+  const int tid = context.tid_;
+  AGORA_LOG_INFO("Worker: Initialize worker %d\n", tid);
+
+  // Contiguous blocks of workers per home cell, e.g. workers 0-1 for cell 0
+  // and 2-3 for cell 1 with 4 workers and 2 cells
+  context.home_cell_ = (static_cast<size_t>(tid) * cells_.size()) /
+                       config_->WorkerThreadNum();
+  context.cells_.resize(cells_.size());
+  for (size_t i = 0; i < cells_.size(); i++) {
+    InitializeCell(tid, cells_.at(i), context.cells_.at(i));
   }
+  if (config_->PerfSampleInterval() > 0) {
+    // Opened by the worker thread, which they count
+    context.perf_counters_ =
+        std::make_unique<PerfCounters>(config_->PerfSampleInterval());
+    if (context.perf_counters_->Available() == false) {
+      AGORA_LOG_WARN("Worker %d: hardware counters are not available\n", tid);
+      context.perf_counters_.reset();
+    }
+    for (CellDoers& doers : context.cells_) {
+      for (auto& doer : doers.computers_) {
+        doer->SetPerfCounters(context.perf_counters_.get());
+      }
+    }
+  }
+
+  AGORA_LOG_INFO("Worker: Initialization of worker %d finished\n", tid);
+  const size_t num_workers =
+      config_->DedicatedWorkerNum() + (config_->MasterRunsWorker() ? 1 : 0);
+  if (num_initialized_.fetch_add(1) + 1 == num_workers) {
+    init_time_ms_ = (GetTime::GetTimeUs() - create_us_) / 1000.0;
+  }
+}
 
-  AGORA_LOG_INFO("Worker: Initialize worker (function)\n");
+void AgoraWorker::InitializeCell(int tid, const Cell& cell, CellDoers& doers) {
+  Config* const cfg = cell.cfg_;
+  AgoraBuffer* const buffer = cell.buffer_;
 
   /* Initialize operators */
-  // debug: use make_shared intead of make_unique to escape the scope
   auto compute_beam = std::make_shared<DoBeamWeights>(
-      config_, tid, buffer_->GetCsi(), buffer_->GetCalibDl(),
-      buffer_->GetCalibUl(), buffer_->GetCalibDlMsum(),
-      buffer_->GetCalibUlMsum(), buffer_->GetCalib(),
-      buffer_->GetUlBeamMatrix(), buffer_->GetDlBeamMatrix(), mac_sched_,
-      phy_stats_, stats_);
+      cfg, tid, buffer->GetCsi(), buffer->GetCalibDl(), buffer->GetCalibUl(),
+      buffer->GetCalibDlMsum(), buffer->GetCalibUlMsum(), buffer->GetCalib(),
+      buffer->GetUlBeamMatrix(), buffer->GetDlBeamMatrix(),
+      buffer->GetBeamRefCsi(), buffer->GetBeamReuseState(), cell.mac_sched_,
+      cell.phy_stats_, cell.stats_);
 
   auto compute_fft = std::make_shared<DoFFT>(
-      config_, tid, buffer_->GetFft(), buffer_->GetCsi(), buffer_->GetCalibDl(),
-      buffer_->GetCalibUl(), phy_stats_, stats_);
+      cfg, tid, buffer->GetFft(), buffer->GetCsi(), buffer->GetCalibDl(),
+      buffer->GetCalibUl(), buffer->GetFftSymbolPackets(), cell.phy_stats_,
+      cell.stats_);
 
   // Downlink workers
-  auto compute_ifft = std::make_shared<DoIFFT>(config_, tid, buffer_->GetIfft(),
-                                               buffer_->GetDlSocket(), stats_);
+  auto compute_ifft = std::make_shared<DoIFFT>(
+      cfg, tid, buffer->GetIfft(), buffer->GetDlSocket(), cell.mac_sched_,
+      cell.stats_);
 
   auto compute_precode = std::make_shared<DoPrecode>(
-      config_, tid, buffer_->GetDlBeamMatrix(), buffer_->GetIfft(),
-      buffer_->GetDlModBits(), mac_sched_, stats_);
+      cfg, tid, buffer->GetDlBeamMatrix(), buffer->GetIfft(),
+      buffer->GetDlModBits(), cell.mac_sched_, cell.stats_);
 
-  auto compute_encoding = std::make_shared<DoEncode>(
-      config_, tid, Direction::kDownlink,
-      (kEnableMac == true) ? buffer_->GetDlBits() : config_->DlBits(),
-      (kEnableMac == true) ? kFrameWnd : 1, buffer_->GetDlModBits(), mac_sched_,
-      stats_);
+  std::shared_ptr<DoEncode> compute_encoding;
+#if defined(USE_ACC100)
+  // The card encodes if it can, the CPU otherwise
+  Bbdev::Setup(cfg);
+  if (Bbdev::EncodeEnabled(cfg->BbdevDevId())) {
+    compute_encoding = std::make_shared<DoEncode_ACC>(
+        cfg, tid, (kEnableMac == true) ? buffer->GetDlBits() : cfg->DlBits(),
+        (kEnableMac == true) ? cfg->FrameWindow() : 1, buffer->GetDlModBits(),
+        cell.mac_sched_, cell.stats_, cell.message_);
+  }
+#endif
+  if (compute_encoding == nullptr) {
+    compute_encoding = std::make_shared<DoEncode>(
+        cfg, tid, Direction::kDownlink,
+        (kEnableMac == true) ? buffer->GetDlBits() : cfg->DlBits(),
+        (kEnableMac == true) ? cfg->FrameWindow() : 1, buffer->GetDlModBits(),
+        cell.mac_sched_, cell.stats_);
+  }
+
+  if (cfg->FuseEncodeModulation()) {
+    compute_encoding->EnableModulationFusion(&buffer->GetDlModSymbols());
+    compute_precode->EnableModulationFusion(&buffer->GetDlModSymbols());
+  }
 
   // Uplink workers
 #if defined(USE_ACC100)
-  auto compute_decoding =
-      std::make_shared<DoDecode_ACC>(config_, tid, buffer_->GetDemod(),
-                                     buffer_->GetDecod(), phy_stats_, stats_);
+  std::shared_ptr<Doer> compute_decoding;
+  if (cfg->AccSpillOps() > 0) {
+    compute_decoding = std::make_shared<DoDecode_Hybrid>(
+        cfg, tid, buffer->GetDemod(), buffer->GetDecod(), cell.mac_sched_,
+        cell.phy_stats_, cell.stats_, cell.message_, buffer->GetHarq());
+  } else {
+    compute_decoding = std::make_shared<DoDecode_ACC>(
+        cfg, tid, buffer->GetDemod(), buffer->GetDecod(), cell.phy_stats_,
+        cell.stats_, cell.message_, buffer->GetHarq());
+  }
 #else
   auto compute_decoding = std::make_shared<DoDecode>(
-      config_, tid, buffer_->GetDemod(), buffer_->GetDecod(), mac_sched_,
-      phy_stats_, stats_);
+      cfg, tid, buffer->GetDemod(), buffer->GetDecod(), cell.mac_sched_,
+      cell.phy_stats_, cell.stats_, buffer->GetHarq());
 #endif
 
   auto compute_demul = std::make_shared<DoDemul>(
-      config_, tid, buffer_->GetFft(), buffer_->GetUlBeamMatrix(),
-      buffer_->GetUeSpecPilot(), buffer_->GetEqual(), buffer_->GetDemod(),
-      buffer_->GetUlPhaseBase(), buffer_->GetUlPhaseShiftPerSymbol(),
-      mac_sched_, phy_stats_, stats_);
+      cfg, tid, buffer->GetFft(), buffer->GetUlBeamMatrix(),
+      buffer->GetUeSpecPilot(), buffer->GetEqual(), buffer->GetDemod(),
+      buffer->GetUlPhaseBase(), buffer->GetUlPhaseShiftPerSymbol(),
+      cell.mac_sched_, cell.phy_stats_, cell.stats_);
+
+  if (cell.message_->GetFftDemulFusion() != nullptr) {
+    compute_fft->EnableDemulFusion(cell.message_->GetFftDemulFusion(),
+                                   compute_demul.get());
+  }
+
+  if (cfg->UlBeamInt16()) {
+    compute_beam->EnableInt16Beams(&buffer->GetUlBeamInt16(),
+                                   &buffer->GetUlBeamScale());
+    compute_demul->EnableInt16Beams(&buffer->GetUlBeamInt16(),
+                                    &buffer->GetUlBeamScale());
+  }
+
+  if (cfg->FusePrecodeIfft()) {
+    compute_ifft->EnablePrecodeFusion(compute_precode.get());
+  }
 
   ///*************************
-  computers_vec.push_back(std::move(compute_beam));
-  computers_vec.push_back(std::move(compute_fft));
-  events_vec.push_back(EventType::kBeam);
-  events_vec.push_back(EventType::kFFT);
+  if (cfg->FftBatchSymbol()) {
+    // The same doer also runs the FFT tasks of whole symbols
+    doers.computers_.push_back(compute_fft);
+    doers.events_.push_back(EventType::kFFTSymbol);
+  }
+  std::shared_ptr<Doer> uplink_beam = compute_beam;
+  std::shared_ptr<Doer> uplink_demul = compute_demul;
+#if defined(USE_CUDA)
+  if (cfg->GpuUplink()) {
+    // One doer enqueues both the beamweights and the demodulation on the GPU
+    auto compute_uplink_gpu = std::make_shared<DoUplinkGpu>(
+        cfg, tid, buffer->GetGpuUplink(), cell.mac_sched_, cell.phy_stats_,
+        cell.stats_, cell.message_);
+    uplink_beam = compute_uplink_gpu;
+    uplink_demul = compute_uplink_gpu;
+  }
+#endif
+  doers.computers_.push_back(std::move(uplink_beam));
+  doers.computers_.push_back(std::move(compute_fft));
+  doers.events_.push_back(EventType::kBeam);
+  doers.events_.push_back(EventType::kFFT);
+
+  if (cfg->Frame().NumULSyms() > 0) {
+    doers.computers_.push_back(std::move(compute_decoding));
+    doers.computers_.push_back(std::move(uplink_demul));
+    doers.events_.push_back(EventType::kDecode);
+    doers.events_.push_back(EventType::kDemul);
+  }
+
+  if (cfg->Frame().NumDlControlSyms() > 0) {
+    doers.computers_.push_back(std::make_shared<DoBroadcast>(
+        cfg, tid, buffer->GetDlSocket(), cell.stats_));
+    doers.events_.push_back(EventType::kBroadcast);
+  }
 
-  if (config_->Frame().NumULSyms() > 0) {
-    computers_vec.push_back(std::move(compute_decoding));
-    computers_vec.push_back(std::move(compute_demul));
-    events_vec.push_back(EventType::kDecode);
-    events_vec.push_back(EventType::kDemul);
+  if (cfg->Frame().NumDLSyms() > 0) {
+    doers.computers_.push_back(std::move(compute_ifft));
+    doers.computers_.push_back(std::move(compute_precode));
+    doers.computers_.push_back(std::move(compute_encoding));
+    doers.events_.push_back(EventType::kIFFT);
+    doers.events_.push_back(EventType::kPrecode);
+    doers.events_.push_back(EventType::kEncode);
   }
 
-  if (config_->Frame().NumDLSyms() > 0) {
-    computers_vec.push_back(std::move(compute_ifft));
-    computers_vec.push_back(std::move(compute_precode));
-    computers_vec.push_back(std::move(compute_encoding));
-    events_vec.push_back(EventType::kIFFT);
-    events_vec.push_back(EventType::kPrecode);
-    events_vec.push_back(EventType::kEncode);
+  for (size_t i = 0; i < doers.computers_.size(); i++) {
+    doers.doer_by_event_.at(static_cast<size_t>(doers.events_.at(i))) =
+        doers.computers_.at(i).get();
+    doers.computers_.at(i)->SetSharedCounters(
+        cell.message_->GetSharedCounters(doers.events_.at(i)));
+    if (cell.tracer_ != nullptr) {
+      doers.computers_.at(i)->SetTraceRing(cell.tracer_->WorkerRing(tid));
+    }
+    if (cell.stall_monitor_ != nullptr) {
+      doers.computers_.at(i)->SetProgress(cell.stall_monitor_->Worker(tid));
+    }
+    doers.computers_.at(i)->SetTaps(cell.taps_);
+    doers.computers_.at(i)->SetAnalogBeams(cell.analog_beams_);
   }
 
-  AGORA_LOG_INFO("Worker: Initialization finished\n");
+  // The doers of the other groups' stages stay alive even if never polled,
+  // as fused doers point to each other
+  std::vector<std::shared_ptr<Doer> > computers;
+  std::vector<EventType> events;
+  size_t num_own = 0;
+  for (bool own : {true, false}) {
+    for (size_t i = 0; i < doers.computers_.size(); i++) {
+      if (OwnsStage(cfg, doers.events_.at(i), tid) == own) {
+        computers.push_back(doers.computers_.at(i));
+        events.push_back(doers.events_.at(i));
+      }
+    }
+    if (own) {
+      num_own = computers.size();
+    }
+  }
+  doers.computers_ = std::move(computers);
+  doers.events_ = std::move(events);
+  doers.num_polled_ = cfg->WorkerGroupBorrow() ? doers.computers_.size()
+                                               : num_own;
+  if (cfg->WorkerGroups().empty() == false) {
+    AGORA_LOG_INFO("Worker %d: %zu doers of its own stages, %zu borrowed\n",
+                   tid, num_own, doers.num_polled_ - num_own);
+  }
 }
 
-void AgoraWorker::RunWorker() {
-  // if (config_->Running() == true) {
-  for (size_t i = 0; i < computers_vec.size(); i++) {
-    if (computers_vec.at(i)->TryLaunch(
-            *message_->GetTaskQueue(events_vec.at(i), cur_qid),
-            message_->GetCompQueue(cur_qid))) {
-      empty_queue = false;
-      break;
+bool AgoraWorker::RunOnce(WorkerContext& context) {
+  // The home cell first, so that the other cells only get the cycles it
+  // leaves idle
+  for (size_t i = 0; i < cells_.size(); i++) {
+    const size_t cell_id = (context.home_cell_ + i) % cells_.size();
+    if (RunCellOnce(context.tid_, cells_.at(cell_id),
+                    context.cells_.at(cell_id))) {
+      return true;
     }
   }
-  // If all queues in this set are empty for 5 iterations,
-  // check the other set of queues
-  if (empty_queue == true) {
-    empty_queue_itrs++;
-    if (empty_queue_itrs == 5) {
-      if (frame_->cur_sche_frame_id_ != frame_->cur_proc_frame_id_) {
-        cur_qid ^= 0x1;
-      } else {
-        cur_qid = (frame_->cur_sche_frame_id_ & 0x1);
+  // The work ahead of the tasks only gets the cycles that no task takes
+  for (size_t i = 0; i < cells_.size(); i++) {
+    const size_t cell_id = (context.home_cell_ + i) % cells_.size();
+    const CellDoers& doers = context.cells_.at(cell_id);
+    for (size_t j = 0; j < doers.num_polled_; j++) {
+      if (doers.computers_.at(j)->IdleWork()) {
+        return true;
       }
-      empty_queue_itrs = 0;
     }
-  } else {
-    empty_queue = true;
   }
-  // }
+  return false;
 }
 
-#else
+bool AgoraWorker::RunCellOnce(int tid, const Cell& cell, CellDoers& doers) {
+  MessageInfo* message = cell.message_;
+  if (message->GetWorkStealing() != nullptr) {
+    return RunCellOnceWorkStealing(tid, cell, doers);
+  }
+  // The own stages first, so that a worker borrows only the cycles they
+  // leave idle
+  for (size_t i = 0; i < doers.num_polled_; i++) {
+    if (doers.computers_.at(i)->TryLaunch(
+            *message->GetTaskQueue(doers.events_.at(i), doers.cur_qid_),
+            message->GetCompQueue(doers.cur_qid_),
+            message->GetWorkerPtok(doers.cur_qid_, tid))) {
+      if (kIsWorkerTimingEnabled) {
+        cell.stats_->RecordTaskDurations(tid);
+      }
+      return true;
+    }
+  }
+  // If all queues in this set are empty for 5 iterations,
+  // check the next set of queues
+  doers.empty_queue_itrs_++;
+  if (doers.empty_queue_itrs_ == 5) {
+    const size_t depth = cell.cfg_->PipelineDepth();
+    if (cell.frame_->cur_sche_frame_id_ != cell.frame_->cur_proc_frame_id_) {
+      doers.cur_qid_ = (doers.cur_qid_ + 1) % depth;
+    } else {
+      doers.cur_qid_ = (cell.frame_->cur_sche_frame_id_ % depth);
+    }
+    doers.empty_queue_itrs_ = 0;
+  }
+  return false;
+}
 
-void AgoraWorker::CreateThreads() {
-  // /* Limit the number of thread to be 1 */
-  // if (config_->WorkerThreadNum() != 1) {
-  //   AGORA_LOG_ERROR("Worker: Current implementation allows only 1 worker thread!\n");
-  //   exit(EXIT_FAILURE);
-  // }
+bool AgoraWorker::RunCellOnceWorkStealing(int tid, const Cell& cell,
+                                          CellDoers& doers) {
+  MessageInfo* message = cell.message_;
+  WorkStealingScheduler::Task task;
+  bool stolen = false;
+  if (message->GetWorkStealing()->Pop(tid, task, stolen)) {
+    if (stolen) {
+      cell.stats_->StealCount(tid)++;
+    }
+    Doer* doer =
+        doers.doer_by_event_.at(static_cast<size_t>(task.event_.event_type_));
+    RtAssert(doer != nullptr, "Worker: no doer for the scheduled task");
+    doer->LaunchEventTraced(task.event_, message->GetCompQueue(task.qid_),
+                            message->GetWorkerPtok(task.qid_, tid));
+    if (kIsWorkerTimingEnabled) {
+      cell.stats_->RecordTaskDurations(tid);
+    }
+    return true;
+  }
 
+  bool work_done = false;
+  for (auto& computer : doers.computers_) {
+    work_done |= computer->Poll();
+  }
+  if (kIsWorkerTimingEnabled && work_done) {
+    cell.stats_->RecordTaskDurations(tid);
+  }
+  return work_done;
+}
+
+bool AgoraWorker::AnyCellRunning() const {
+  for (const Cell& cell : cells_) {
+    if (cell.cfg_->Running()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AgoraWorker::RunWorker() {
+  RtAssert(master_worker_ != nullptr,
+           "Worker: the master thread runs no doers in this execution model");
+  RunOnce(*master_worker_);
+}
+
+size_t AgoraWorker::RunWorkerFor(size_t budget_tsc,
+                                 const std::vector<QueueSlot>& schedule) {
+  RtAssert(master_worker_ != nullptr,
+           "Worker: the master thread runs no doers in this execution model");
+  // The master only runs doers of its own cell
+  const Cell& cell = cells_.at(0);
+  CellDoers& doers = master_worker_->cells_.at(0);
+  MessageInfo* message = cell.message_;
+  const int tid = master_worker_->tid_;
+  const size_t end_tsc = GetTime::Rdtsc() + budget_tsc;
+  size_t num_tasks = 0;
+
+  if (message->GetWorkStealing() != nullptr) {
+    // The deques are not per stage, so they run in their own order
+    while ((GetTime::Rdtsc() < end_tsc) &&
+           RunCellOnceWorkStealing(tid, cell, doers)) {
+      num_tasks++;
+    }
+    return num_tasks;
+  }
+  for (const QueueSlot& slot : schedule) {
+    Doer* doer = doers.doer_by_event_.at(static_cast<size_t>(slot.event_type_));
+    if (doer == nullptr) {
+      continue;
+    }
+    auto* task_queue = message->GetTaskQueue(slot.event_type_, slot.qid_);
+    // The accelerator doers also report true for retired ops, so drain by
+    // the queue
+    while ((task_queue->size_approx() > 0) &&
+           doer->TryLaunch(*task_queue, message->GetCompQueue(slot.qid_),
+                           message->GetWorkerPtok(slot.qid_, tid))) {
+      num_tasks++;
+      if (kIsWorkerTimingEnabled) {
+        cell.stats_->RecordTaskDurations(tid);
+      }
+      if (GetTime::Rdtsc() >= end_tsc) {
+        return num_tasks;
+      }
+    }
+  }
+  // The ops in flight of the accelerator doers, whose queues may be empty
+  for (auto& computer : doers.computers_) {
+    computer->Poll();
+  }
+  return num_tasks;
+}
+
+void AgoraWorker::CreateThreads() {
+  // Worker 0 is the master thread when it runs doers
+  const size_t first_tid = config_->MasterRunsWorker() ? 1 : 0;
   AGORA_LOG_SYMBOL("Worker: creating %zu workers\n",
-                   config_->WorkerThreadNum());
-  for (size_t i = 0; i < config_->WorkerThreadNum(); i++) {
-    workers_.emplace_back(&AgoraWorker::WorkerThread, this, i);
+                   config_->DedicatedWorkerNum());
+  for (size_t i = 0; i < config_->DedicatedWorkerNum(); i++) {
+    workers_.emplace_back(&AgoraWorker::WorkerThread, this, first_tid + i);
   }
 }
 
@@ -182,105 +466,30 @@ void AgoraWorker::JoinThreads() {
 }
 
 void AgoraWorker::WorkerThread(int tid) {
-  PinToCoreWithOffset(ThreadType::kWorker, base_worker_core_offset_, tid);
-
-  /* Initialize operators */
-  auto compute_beam = std::make_unique<DoBeamWeights>(
-      config_, tid, buffer_->GetCsi(), buffer_->GetCalibDl(),
-      buffer_->GetCalibUl(), buffer_->GetCalibDlMsum(),
-      buffer_->GetCalibUlMsum(), buffer_->GetCalib(),
-      buffer_->GetUlBeamMatrix(), buffer_->GetDlBeamMatrix(), mac_sched_,
-      phy_stats_, stats_);
-
-  auto compute_fft = std::make_unique<DoFFT>(
-      config_, tid, buffer_->GetFft(), buffer_->GetCsi(), buffer_->GetCalibDl(),
-      buffer_->GetCalibUl(), phy_stats_, stats_);
-
-  // Downlink workers
-  auto compute_ifft = std::make_unique<DoIFFT>(config_, tid, buffer_->GetIfft(),
-                                               buffer_->GetDlSocket(), stats_);
-
-  auto compute_precode = std::make_unique<DoPrecode>(
-      config_, tid, buffer_->GetDlBeamMatrix(), buffer_->GetIfft(),
-      buffer_->GetDlModBits(), mac_sched_, stats_);
-
-  auto compute_encoding = std::make_unique<DoEncode>(
-      config_, tid, Direction::kDownlink,
-      (kEnableMac == true) ? buffer_->GetDlBits() : config_->DlBits(),
-      (kEnableMac == true) ? kFrameWnd : 1, buffer_->GetDlModBits(), mac_sched_,
-      stats_);
-
-  // Uplink workers
-#if defined(USE_ACC100)
-  // RtAssert(config_->WorkerThreadNum() == 1, "ACC100: not compatible with multi thread.");
-  auto compute_decoding =
-      std::make_unique<DoDecode_ACC>(config_, tid, buffer_->GetDemod(),
-                                     buffer_->GetDecod(), phy_stats_, stats_);
-#else
-  auto compute_decoding = std::make_unique<DoDecode>(
-      config_, tid, buffer_->GetDemod(), buffer_->GetDecod(), mac_sched_,
-      phy_stats_, stats_);
-#endif
+  const size_t first_tid = config_->MasterRunsWorker() ? 1 : 0;
+  PinToCoreWithOffset(ThreadType::kWorker, base_worker_core_offset_,
+                      tid - first_tid);
+  // The workers of a stage group with a resctrl class of their own
+  for (const auto& [stage, workers] : config_->WorkerGroups()) {
+    if ((std::find(workers.begin(), workers.end(), static_cast<size_t>(tid)) !=
+         workers.end()) &&
+        Resctrl::HasClass("worker_" + stage)) {
+      Resctrl::AssignThread("worker_" + stage);
+      break;
+    }
+  }
 
-  auto compute_demul = std::make_unique<DoDemul>(
-      config_, tid, buffer_->GetFft(), buffer_->GetUlBeamMatrix(),
-      buffer_->GetUeSpecPilot(), buffer_->GetEqual(), buffer_->GetDemod(),
-      buffer_->GetUlPhaseBase(), buffer_->GetUlPhaseShiftPerSymbol(),
-      mac_sched_, phy_stats_, stats_);
+  WorkerContext context(tid);
+  InitializeWorker(context);
 
-  std::vector<Doer*> computers_vec;
-  std::vector<EventType> events_vec;
-  ///*************************
-  computers_vec.push_back(compute_beam.get());
-  computers_vec.push_back(compute_fft.get());
-  events_vec.push_back(EventType::kBeam);
-  events_vec.push_back(EventType::kFFT);
-
-  if (config_->Frame().NumULSyms() > 0) {
-    computers_vec.push_back(compute_decoding.get());
-    computers_vec.push_back(compute_demul.get());
-    events_vec.push_back(EventType::kDecode);
-    events_vec.push_back(EventType::kDemul);
-  }
-
-  if (config_->Frame().NumDLSyms() > 0) {
-    computers_vec.push_back(compute_ifft.get());
-    computers_vec.push_back(compute_precode.get());
-    computers_vec.push_back(compute_encoding.get());
-    events_vec.push_back(EventType::kIFFT);
-    events_vec.push_back(EventType::kPrecode);
-    events_vec.push_back(EventType::kEncode);
-  }
-
-  size_t cur_qid = 0;
-  size_t empty_queue_itrs = 0;
-  bool empty_queue = true;
-  while (config_->Running() == true) {
-    for (size_t i = 0; i < computers_vec.size(); i++) {
-      if (computers_vec.at(i)->TryLaunch(
-              *message_->GetTaskQueue(events_vec.at(i), cur_qid),
-              message_->GetCompQueue(cur_qid),
-              message_->GetWorkerPtok(cur_qid, tid))) {
-        empty_queue = false;
-        break;
-      }
-    }
-    // If all queues in this set are empty for 5 iterations,
-    // check the other set of queues
-    if (empty_queue == true) {
-      empty_queue_itrs++;
-      if (empty_queue_itrs == 5) {
-        if (frame_->cur_sche_frame_id_ != frame_->cur_proc_frame_id_) {
-          cur_qid ^= 0x1;
-        } else {
-          cur_qid = (frame_->cur_sche_frame_id_ & 0x1);
-        }
-        empty_queue_itrs = 0;
-      }
+  IdlePolicy idle(config_);
+  while (AnyCellRunning()) {
+    if (RunOnce(context)) {
+      idle.Busy();
     } else {
-      empty_queue = true;
+      idle.Idle();
     }
   }
+  idle.PrintSummary("Worker " + std::to_string(tid));
   AGORA_LOG_SYMBOL("Agora worker %d exit\n", tid);
 }
-#endif
\ No newline at end of file
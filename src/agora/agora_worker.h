@@ -6,58 +6,142 @@
 #ifndef AGORA_WORKER_H_
 #define AGORA_WORKER_H_
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <thread>
 #include <vector>
 
 #include "agora_buffer.h"
+#include "analog_beams.h"
 #include "config.h"
 #include "csv_logger.h"
 #include "doer.h"
+#include "event_tracer.h"
 #include "mac_scheduler.h"
 #include "mat_logger.h"
+#include "perf_counters.h"
 #include "phy_stats.h"
+#include "stall_monitor.h"
 #include "stats.h"
 
 class AgoraWorker {
  public:
+  /// The state and buffers of one cell whose tasks the workers run
+  struct Cell {
+    Config* cfg_;
+    MacScheduler* mac_sched_;
+    Stats* stats_;
+    PhyStats* phy_stats_;
+    MessageInfo* message_;
+    AgoraBuffer* buffer_;
+    FrameInfo* frame_;
+    // Rings of the worker threads, nullptr if tracing is disabled
+    EventTracer* tracer_;
+    // Taps of the cell, nullptr if nothing is tapped
+    DataTaps* taps_;
+    // Progress of the worker threads, nullptr if stalls are not detected
+    StallMonitor* stall_monitor_;
+    // Beam sweep of the analog arrays, nullptr if it is not managed
+    AnalogBeams* analog_beams_;
+  };
+
   explicit AgoraWorker(Config* cfg, MacScheduler* mac_sched, Stats* stats,
                        PhyStats* phy_stats, MessageInfo* message,
-                       AgoraBuffer* buffer, FrameInfo* frame);
+                       AgoraBuffer* buffer, FrameInfo* frame,
+                       EventTracer* tracer = nullptr,
+                       DataTaps* taps = nullptr,
+                       StallMonitor* stall_monitor = nullptr,
+                       AnalogBeams* analog_beams = nullptr);
+  /// Share the worker threads between several cells, which all configure
+  /// the same number of workers. The threads run on the worker cores of the
+  /// first cell. Each worker has a home cell, which gets a contiguous share
+  /// of the workers, and runs the tasks of the other cells only when its
+  /// home cell has none, so that each cell's buffers stay in the caches of
+  /// its own workers.
+  explicit AgoraWorker(std::vector<Cell> cells);
   ~AgoraWorker();
 
-#ifdef SINGLE_THREAD
+  /// A task queue of the master thread's doers: a stage in a frame slot
+  struct QueueSlot {
+    EventType event_type_;
+    size_t qid_;
+  };
+
+  /// Run one scheduling round of the doers on the master thread. Only used
+  /// by the single_core and master_assisted execution models.
   void RunWorker();
-#endif
+  /// Run the doers of the master thread for up to budget_tsc cycles. The
+  /// queues of schedule are tried most urgent first, and each one is drained
+  /// before the next, so that a stage runs its tasks back to back. Returns
+  /// the number of tasks run.
+  size_t RunWorkerFor(size_t budget_tsc,
+                      const std::vector<QueueSlot>& schedule);
+  /// Time from construction until every worker built its doers, for the
+  /// startup profile. Negative while some are still initializing.
+  inline double InitTimeMs() const { return init_time_ms_.load(); }
 
  private:
-#ifdef SINGLE_THREAD
-  void InitializeWorker();
-
-  std::vector<std::shared_ptr<Doer> > computers_vec;
-  std::vector<EventType> events_vec;
-  int tid;  // TODO: remove thread id for single-core
-  size_t cur_qid;
-  size_t empty_queue_itrs;
-  bool empty_queue;
-#else
+  /// The doers of one worker for one cell and the state of its queue polling
+  struct CellDoers {
+    // The doers of the worker's own stages first, then those of the stages
+    // of the other worker groups
+    std::vector<std::shared_ptr<Doer> > computers_;
+    std::vector<EventType> events_;
+    // Leading doers of computers_ that the worker polls: its own, or all of
+    // them with worker_group_borrow
+    size_t num_polled_ = 0;
+    // Doer handling each event type, for tasks taken from the work-stealing
+    // scheduler
+    std::array<Doer*, kNumEventTypes> doer_by_event_{};
+    size_t cur_qid_ = 0;
+    size_t empty_queue_itrs_ = 0;
+  };
+
+  /// The doers of one worker
+  struct WorkerContext {
+    explicit WorkerContext(int tid) : tid_(tid) {}
+
+    int tid_;
+    // Hardware counters of the worker thread, nullptr if not sampled
+    std::unique_ptr<PerfCounters> perf_counters_;
+    // Doers of each cell, in the order of cells_
+    std::vector<CellDoers> cells_;
+    size_t home_cell_ = 0;
+  };
+
+  /// Create the doers of the worker with thread id context.tid_
+  void InitializeWorker(WorkerContext& context);
+  /// Create the doers of worker tid for cell
+  void InitializeCell(int tid, const Cell& cell, CellDoers& doers);
+  /// Try the cells starting with the home cell. Returns true if a doer did
+  /// some work.
+  bool RunOnce(WorkerContext& context);
+  /// Try the doers of cell in order and launch the first one with pending
+  /// work. Returns true if a doer did some work.
+  bool RunCellOnce(int tid, const Cell& cell, CellDoers& doers);
+  /// Run the next task of the cell's work-stealing scheduler, or poll the
+  /// doers if there is none. Returns true if a doer did some work.
+  bool RunCellOnceWorkStealing(int tid, const Cell& cell, CellDoers& doers);
+  /// True while any of the cells is running
+  bool AnyCellRunning() const;
+
   void WorkerThread(int tid);
   void CreateThreads();
   void JoinThreads();
 
   std::vector<std::thread> workers_;
-#endif
-
-  const size_t base_worker_core_offset_;
+  // Worker run by the master thread, nullptr in the multi_core model
+  std::unique_ptr<WorkerContext> master_worker_;
 
+  const std::vector<Cell> cells_;
+  // The first cell, whose configuration sets the worker threads
   Config* const config_;
+  const size_t base_worker_core_offset_;
 
-  MacScheduler* mac_sched_;
-  Stats* stats_;
-  PhyStats* phy_stats_;
-  MessageInfo* message_;
-  AgoraBuffer* buffer_;
-  FrameInfo* frame_;
+  const double create_us_;
+  std::atomic<size_t> num_initialized_{0};
+  std::atomic<double> init_time_ms_{-1.0};
 };
 
 #endif  // AGORA_WORKER_H_
\ No newline at end of file
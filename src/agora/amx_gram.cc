@@ -0,0 +1,137 @@
+/**
+ * @file amx_gram.cc
+ * @brief Implementation file for the AMX Gram matrix kernel.
+ */
+#include "amx_gram.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AMX_TILE__) && defined(__AMX_BF16__)
+#include <cpuid.h>
+#include <immintrin.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "utils.h"
+
+namespace AmxGram {
+
+uint16_t ToBf16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bits += 0x7FFFu + ((bits >> 16) & 1u);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+#if defined(__AMX_TILE__) && defined(__AMX_BF16__)
+static constexpr size_t kTileRows = 16;
+static constexpr size_t kTileBytes = 64;
+// bf16 values per tile row, i.e. antennas per tile multiplication
+static constexpr size_t kAntsPerTile = kTileBytes / sizeof(uint16_t);
+
+// Linux arch_prctl() request for the AMX tile data state
+static constexpr int kArchReqXcompPerm = 0x1023;
+static constexpr int kXfeatureXtiledata = 18;
+// CPUID.(EAX=7, ECX=0):EDX feature bits
+static constexpr unsigned int kCpuidAmxBf16 = 1u << 22;
+static constexpr unsigned int kCpuidAmxTile = 1u << 24;
+
+// Layout of the LDTILECFG operand
+struct TileConfig {
+  uint8_t palette_id_;
+  uint8_t start_row_;
+  uint8_t reserved_[14];
+  uint16_t colsb_[16];
+  uint8_t rows_[16];
+};
+
+static bool RequestAmx() {
+  unsigned int eax;
+  unsigned int ebx;
+  unsigned int ecx;
+  unsigned int edx;
+  if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  if (((edx & kCpuidAmxTile) == 0) || ((edx & kCpuidAmxBf16) == 0)) {
+    return false;
+  }
+  return syscall(SYS_arch_prctl, kArchReqXcompPerm, kXfeatureXtiledata) == 0;
+}
+
+bool Available() {
+  static const bool kAvailable = RequestAmx();
+  return kAvailable;
+}
+
+void ComputeGram(const float* csi, size_t num_ants, size_t num_streams,
+                 float* gram) {
+  RtAssert(num_streams <= kMaxStreams,
+           "AmxGram: too many spatial streams for one tile");
+  // Every call uses the same three full tiles: tmm0 accumulates R' * R for
+  // R = [real(H) imag(H)], tmm1 holds R' and tmm2 R in the VNNI pair layout
+  thread_local bool configured = false;
+  if (configured == false) {
+    TileConfig config = {};
+    config.palette_id_ = 1;
+    for (size_t tile = 0; tile < 3; tile++) {
+      config.rows_[tile] = kTileRows;
+      config.colsb_[tile] = kTileBytes;
+    }
+    _tile_loadconfig(&config);
+    configured = true;
+  }
+
+  alignas(64) uint16_t r_t[kTileRows * kAntsPerTile];
+  alignas(64) uint16_t r_pairs[kTileRows * kAntsPerTile];
+  alignas(64) float r_gram[kTileRows * kTileRows];
+  const size_t num_cols = 2 * num_streams;
+  _tile_zero(0);
+  for (size_t ant0 = 0; ant0 < num_ants; ant0 += kAntsPerTile) {
+    const size_t num_tile_ants = std::min(kAntsPerTile, num_ants - ant0);
+    std::memset(r_t, 0, sizeof(r_t));
+    std::memset(r_pairs, 0, sizeof(r_pairs));
+    for (size_t col = 0; col < num_cols; col++) {
+      const float* h = &csi[(2 * (((col % num_streams) * num_ants) + ant0)) +
+                            (col / num_streams)];
+      for (size_t ant = 0; ant < num_tile_ants; ant++) {
+        const uint16_t value = ToBf16(h[2 * ant]);
+        r_t[(col * kAntsPerTile) + ant] = value;
+        r_pairs[((ant / 2) * kAntsPerTile) + (2 * col) + (ant % 2)] = value;
+      }
+    }
+    _tile_loadd(1, r_t, kTileBytes);
+    _tile_loadd(2, r_pairs, kTileBytes);
+    _tile_dpbf16ps(0, 1, 2);
+  }
+  _tile_stored(0, r_gram, kTileRows * sizeof(float));
+
+  // G(i, j) = real(H)(:, i)' * real(H)(:, j) + imag(H)(:, i)' * imag(H)(:, j)
+  //   + 1i * (real(H)(:, i)' * imag(H)(:, j) - imag(H)(:, i)' * real(H)(:, j))
+  const size_t k = num_streams;
+  for (size_t j = 0; j < k; j++) {
+    for (size_t i = 0; i <= j; i++) {
+      const float re =
+          r_gram[(i * kTileRows) + j] + r_gram[((k + i) * kTileRows) + k + j];
+      const float im = (i == j) ? 0.0f
+                                : r_gram[(i * kTileRows) + k + j] -
+                                      r_gram[((k + i) * kTileRows) + j];
+      gram[2 * ((j * k) + i)] = re;
+      gram[2 * ((j * k) + i) + 1] = im;
+      gram[2 * ((i * k) + j)] = re;
+      gram[2 * ((i * k) + j) + 1] = -im;
+    }
+  }
+}
+#else
+bool Available() { return false; }
+
+void ComputeGram(const float* /*csi*/, size_t /*num_ants*/,
+                 size_t /*num_streams*/, float* /*gram*/) {
+  RtAssert(false, "AmxGram: built without AMX-BF16 support");
+}
+#endif
+
+}  // namespace AmxGram
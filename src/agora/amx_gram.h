@@ -0,0 +1,38 @@
+/**
+ * @file amx_gram.h
+ * @brief Declaration file for the AMX Gram matrix kernel, which computes the
+ * H' * H products of the zeroforcing and MMSE detectors with bf16 tile
+ * multiplications (TDPBF16PS) accumulated in fp32.
+ */
+#ifndef AMX_GRAM_H_
+#define AMX_GRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AmxGram {
+
+/// Largest number of spatial streams: the real and imaginary parts of the
+/// channel matrix columns take one row each of a 16-row tile
+static constexpr size_t kMaxStreams = 8;
+
+/// Relative rounding error of a bf16 value (8 significant bits)
+static constexpr float kBf16Epsilon = 1.0f / 256.0f;
+
+/// Returns true if this build has the AMX kernel, the CPU exposes AMX-BF16
+/// and the kernel granted this process the AMX tile state. Checked once.
+bool Available();
+
+/// Round value to the nearest bf16 value (ties to even)
+uint16_t ToBf16(float value);
+
+/// Compute the num_streams x num_streams Gram matrix H' * H of the
+/// num_ants x num_streams complex channel matrix csi. Both matrices are
+/// interleaved and column-major, and gram is exactly Hermitian. Requires
+/// Available() and num_streams <= kMaxStreams.
+void ComputeGram(const float* csi, size_t num_ants, size_t num_streams,
+                 float* gram);
+
+}  // namespace AmxGram
+
+#endif  // AMX_GRAM_H_
@@ -0,0 +1,95 @@
+/**
+ * @file analog_beams.cc
+ * @brief Implementation file for the AnalogBeams class
+ */
+#include "analog_beams.h"
+
+#include <immintrin.h>
+
+#include "logger.h"
+#include "utils.h"
+
+AnalogBeams::AnalogBeams(size_t num_beams, size_t sweep_interval)
+    : num_beams_(num_beams),
+      sweep_interval_(sweep_interval),
+      beam_power_(std::make_unique<float[]>(num_beams)) {
+  RtAssert(num_beams_ > 0, "AnalogBeams: no beams to sweep");
+  RtAssert(sweep_interval_ >= num_beams_,
+           "AnalogBeams: a sweep must end before the next one starts");
+}
+
+size_t AnalogBeams::BeamOfFrame(size_t frame_id) const {
+  const size_t sweep_frame = frame_id % sweep_interval_;
+  if (sweep_frame < num_beams_) {
+    return sweep_frame;
+  }
+  return selected_beam_.load(std::memory_order_relaxed);
+}
+
+void AnalogBeams::AddPilotPower(size_t frame_id, float power) {
+  if ((frame_id % sweep_interval_) >= num_beams_) {
+    return;
+  }
+  std::atomic<float>& total = frames_[frame_id % kFrameSlots].power_;
+  float expected = total.load(std::memory_order_relaxed);
+  while (total.compare_exchange_weak(expected, expected + power,
+                                     std::memory_order_relaxed) == false) {
+  }
+}
+
+bool AnalogBeams::CompleteFrame(size_t frame_id) {
+  const size_t beam = frame_id % sweep_interval_;
+  if (beam >= num_beams_) {
+    return false;
+  }
+  // The slot is free once the frame is closed, as the frames in flight span
+  // fewer than kFrameSlots
+  beam_power_[beam] = frames_[frame_id % kFrameSlots].power_.exchange(
+      0.0f, std::memory_order_relaxed);
+  if (beam != num_beams_ - 1) {
+    return false;
+  }
+
+  size_t best_beam = 0;
+  for (size_t i = 1; i < num_beams_; i++) {
+    if (beam_power_[i] > beam_power_[best_beam]) {
+      best_beam = i;
+    }
+  }
+  const size_t last_beam = selected_beam_.exchange(best_beam);
+  AGORA_LOG_INFO(
+      "AnalogBeams: sweep ending in frame %zu selects beam %zu of %zu "
+      "(power %.3e, beam %zu had %.3e)\n",
+      frame_id, best_beam, num_beams_, beam_power_[best_beam], last_beam,
+      beam_power_[last_beam]);
+  return best_beam != last_beam;
+}
+
+float AnalogBeams::Power(const complex_float* x, size_t n) {
+  const auto* in = reinterpret_cast<const float*>(x);
+  const size_t num_floats = 2 * n;
+  size_t i = 0;
+  float power = 0.0f;
+#if defined(__AVX512F__)
+  __m512 sum = _mm512_setzero_ps();
+  for (; i + 16 <= num_floats; i += 16) {
+    const __m512 data = _mm512_loadu_ps(&in[i]);
+    sum = _mm512_fmadd_ps(data, data, sum);
+  }
+  power = _mm512_reduce_add_ps(sum);
+#elif defined(__AVX2__)
+  __m256 sum = _mm256_setzero_ps();
+  for (; i + 8 <= num_floats; i += 8) {
+    const __m256 data = _mm256_loadu_ps(&in[i]);
+    sum = _mm256_fmadd_ps(data, data, sum);
+  }
+  const __m128 half =
+      _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  const __m128 pairs = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  power = _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+#endif
+  for (; i < num_floats; i++) {
+    power += in[i] * in[i];
+  }
+  return power;
+}
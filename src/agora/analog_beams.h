@@ -0,0 +1,69 @@
+/**
+ * @file analog_beams.h
+ * @brief Declaration file for the AnalogBeams class, which sweeps the
+ * codebook of an analog phased array and selects its beam from the received
+ * power of the pilots.
+ */
+#ifndef ANALOG_BEAMS_H_
+#define ANALOG_BEAMS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "symbols.h"
+
+/**
+ * @brief Beam management of an analog phased array with num_beams beams.
+ *
+ * A sweep starts every sweep_interval frames and lasts num_beams frames, in
+ * which frame i of the sweep uses beam i. Outside the sweeps the array uses
+ * the selected beam. The FFT workers add the power of the pilots of each
+ * frame, and the master closes the frame once its pilots are done. Once the
+ * last frame of a sweep is closed the beam with the most power is selected
+ * for the frames that the TxRx threads have yet to start.
+ */
+class AnalogBeams {
+ public:
+  /// Frames whose pilot power is gathered at the same time
+  static constexpr size_t kFrameSlots = kFrameWnd;
+
+  AnalogBeams(size_t num_beams, size_t sweep_interval);
+
+  /// Beam of the array in frame_id. Can be called from any thread.
+  size_t BeamOfFrame(size_t frame_id) const;
+
+  /// Add the power of a pilot of frame_id. Can be called from any thread.
+  void AddPilotPower(size_t frame_id, float power);
+
+  /// Close frame_id once the power of all its pilots is added. Only called
+  /// by the master thread, in frame order. Returns true if the frame ends a
+  /// sweep that selects another beam.
+  bool CompleteFrame(size_t frame_id);
+
+  inline size_t SelectedBeam() const {
+    return selected_beam_.load(std::memory_order_relaxed);
+  }
+  inline size_t NumBeams() const { return num_beams_; }
+  /// Pilot power of beam in the last sweep. Master thread only.
+  inline float BeamPower(size_t beam) const { return beam_power_[beam]; }
+
+  /// Sum of the power of the n samples of x
+  static float Power(const complex_float* x, size_t n);
+
+ private:
+  // The pilot power of a frame in flight
+  struct alignas(64) FrameSlot {
+    std::atomic<float> power_{0.0f};
+  };
+
+  const size_t num_beams_;
+  const size_t sweep_interval_;
+  std::atomic<size_t> selected_beam_{0};
+  std::array<FrameSlot, kFrameSlots> frames_;
+  // Master thread only
+  std::unique_ptr<float[]> beam_power_;
+};
+
+#endif  // ANALOG_BEAMS_H_
@@ -0,0 +1,133 @@
+/**
+ * @file batched_beam.cc
+ * @brief Implementation file for the compile-time specialized small-MIMO
+ * beamweight kernels. The matrix dimensions are template parameters so every
+ * loop below is fully unrolled and the whole batch stays in registers (or in
+ * L1 for the largest shapes).
+ */
+#include "batched_beam.h"
+
+#include "batched_linalg.h"
+
+namespace BatchedBeam {
+
+using BatchedLinalg::CxLanes;
+using BatchedLinalg::CxMul;
+using BatchedLinalg::CxNorm;
+using BatchedLinalg::CxScale;
+using L = BatchedLinalg::NativeLanes;
+static_assert(kBatchScs == BatchedLinalg::kBatchScs);
+
+template <size_t kBs, size_t kUe>
+struct DetectorImpl {
+  static bool Run(const float* csi_re, const float* csi_im, float noise,
+                  float* beam_re, float* beam_im);
+};
+
+template <size_t kBs, size_t kUe>
+bool DetectorImpl<kBs, kUe>::Run(const float* csi_re, const float* csi_im,
+                                 float noise, float* beam_re, float* beam_im) {
+  static_assert(kUe >= 1 && kUe <= kBs && kBs <= kMaxBatchDim,
+                "Unsupported batched beamweight dimensions");
+
+  const BatchedLinalg::CxPlanes<kBs, kUe, const float> csi = {csi_re, csi_im};
+  const BatchedLinalg::CxPlanes<kUe, kBs> beam = {beam_re, beam_im};
+  const L::F reg = L::Set1(noise);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> h[kBs][kUe];
+    BatchedLinalg::LoadMat(csi, lane, h);
+
+    // G = H' * H + noise * I is Hermitian positive definite when H has full
+    // column rank (or noise > 0)
+    CxLanes<L> g[kUe][kUe];
+    BatchedLinalg::Gram(h, reg, g);
+    if (BatchedLinalg::InvertHermitian(g) == false) {
+      return false;
+    }
+
+    // W = inv(G) * H'
+    CxLanes<L> w[kUe][kBs];
+    BatchedLinalg::MatMulBH(g, h, w);
+    BatchedLinalg::StoreMat(w, lane, beam);
+  }
+  return true;
+}
+
+template <size_t kBs, size_t kUe>
+struct DownlinkImpl {
+  static void Run(const float* ul_beam_re, const float* ul_beam_im,
+                  const float* calib_re, const float* calib_im,
+                  float* dl_beam_re, float* dl_beam_im);
+};
+
+template <size_t kBs, size_t kUe>
+void DownlinkImpl<kBs, kUe>::Run(const float* ul_beam_re,
+                                 const float* ul_beam_im,
+                                 const float* calib_re, const float* calib_im,
+                                 float* dl_beam_re, float* dl_beam_im) {
+  static_assert(kUe >= 1 && kUe <= kBs && kBs <= kMaxBatchDim,
+                "Unsupported batched beamweight dimensions");
+
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    // sign(calib) = calib / |calib|, 0 for a zero calibration value
+    CxLanes<L> calib_sign[kBs];
+    for (size_t ant = 0; ant < kBs; ant++) {
+      const size_t offset = ant * kBatchScs + lane;
+      const CxLanes<L> calib = {L::Load(calib_re + offset),
+                                L::Load(calib_im + offset)};
+      calib_sign[ant] = CxScale(calib, L::SafeRsqrt(CxNorm(calib)));
+    }
+
+    // W_dl(ue, ant) = W_ul(ue, ant) * sign(calib(ant))
+    CxLanes<L> dl_beam[kBs][kUe];
+    L::F max_norm = L::Set1(0.0f);
+    for (size_t ant = 0; ant < kBs; ant++) {
+      for (size_t ue = 0; ue < kUe; ue++) {
+        const size_t offset = (ue + kUe * ant) * kBatchScs + lane;
+        const CxLanes<L> ul_beam = {L::Load(ul_beam_re + offset),
+                                    L::Load(ul_beam_im + offset)};
+        dl_beam[ant][ue] = CxMul(ul_beam, calib_sign[ant]);
+        max_norm = L::Max(max_norm, CxNorm(dl_beam[ant][ue]));
+      }
+    }
+
+    // Scale by 1 / max(abs(W_dl)) and store the transpose
+    const L::F scale = L::SafeRsqrt(max_norm);
+    for (size_t ue = 0; ue < kUe; ue++) {
+      for (size_t ant = 0; ant < kBs; ant++) {
+        const CxLanes<L> out = CxScale(dl_beam[ant][ue], scale);
+        const size_t offset = (ant + kBs * ue) * kBatchScs + lane;
+        L::Store(dl_beam_re + offset, out.re_);
+        L::Store(dl_beam_im + offset, out.im_);
+      }
+    }
+  }
+}
+
+// Walk all supported (kBs, kUe) pairs and return the Run() function of
+// KernelImpl<bs_ant_num, ue_num>
+template <template <size_t, size_t> class KernelImpl, size_t kBs = 1,
+          size_t kUe = 1>
+static decltype(&KernelImpl<1, 1>::Run) SelectKernel(size_t bs_ant_num,
+                                                     size_t ue_num) {
+  if constexpr (kBs > kMaxBatchDim) {
+    return nullptr;
+  } else if constexpr (kUe > kBs) {
+    return SelectKernel<KernelImpl, kBs + 1, 1>(bs_ant_num, ue_num);
+  } else {
+    if ((bs_ant_num == kBs) && (ue_num == kUe)) {
+      return &KernelImpl<kBs, kUe>::Run;
+    }
+    return SelectKernel<KernelImpl, kBs, kUe + 1>(bs_ant_num, ue_num);
+  }
+}
+
+DetectorKernel GetDetectorKernel(size_t bs_ant_num, size_t ue_num) {
+  return SelectKernel<DetectorImpl>(bs_ant_num, ue_num);
+}
+
+DownlinkKernel GetDownlinkKernel(size_t bs_ant_num, size_t ue_num) {
+  return SelectKernel<DownlinkImpl>(bs_ant_num, ue_num);
+}
+
+}  // namespace BatchedBeam
@@ -0,0 +1,68 @@
+/**
+ * @file batched_beam.h
+ * @brief Declaration file for the compile-time specialized small-MIMO
+ * beamweight kernels. Each kernel computes the beamweights of a batch of
+ * subcarriers at once, with one subcarrier per SIMD lane, on top of the
+ * kernels of batched_linalg.h.
+ */
+#ifndef BATCHED_BEAM_H_
+#define BATCHED_BEAM_H_
+
+#include <cstddef>
+
+namespace BatchedBeam {
+
+/// Number of subcarriers computed by one kernel call (one per float lane of
+/// an AVX-512 register)
+static constexpr size_t kBatchScs = 16;
+
+/// Largest number of base station antennas (and spatial streams) supported
+/// by the specialized kernels
+static constexpr size_t kMaxBatchDim = 8;
+
+/// Size (in floats) of one real or imaginary plane of a batched matrix with
+/// the largest supported dimensions
+static constexpr size_t kMaxPlaneSize = kMaxBatchDim * kMaxBatchDim * kBatchScs;
+
+/// Size (in floats) of one real or imaginary plane of a batched per-antenna
+/// vector
+static constexpr size_t kMaxVecPlaneSize = kMaxBatchDim * kBatchScs;
+
+/// Batched regularized zeroforcing detector
+/// W = inv(H' * H + noise * I) * H', i.e. ZF for noise == 0 and MMSE for
+/// noise > 0.
+/// All matrices are stored as separate real and imaginary planes, with the
+/// subcarrier (lane) index as the fastest moving dimension:
+///   csi_re/csi_im:   H(ant, ue) at [(ant + bs_ant_num * ue) * kBatchScs + sc]
+///   beam_re/beam_im: W(ue, ant) at [(ue + ue_num * ant) * kBatchScs + sc]
+/// i.e. column-major BsAnt x Ue input and Ue x BsAnt output per subcarrier.
+/// Returns false if the regularized Gram matrix is close to singular for any
+/// subcarrier in the batch, in which case the output must not be used.
+using DetectorKernel = bool (*)(const float* csi_re, const float* csi_im,
+                                float noise, float* beam_re, float* beam_im);
+
+/// Returns the kernel specialized for (bs_ant_num x ue_num) channel matrices,
+/// or nullptr if this shape is not supported
+/// (bs_ant_num > kMaxBatchDim or ue_num > bs_ant_num)
+DetectorKernel GetDetectorKernel(size_t bs_ant_num, size_t ue_num);
+
+/// Batched downlink precoder derived from the uplink detector through the
+/// reciprocity calibration: W_dl = (W_ul * diagmat(sign(calib))).st(), scaled
+/// by 1 / max(abs(W_dl)) per subcarrier.
+///   ul_beam_re/ul_beam_im: W_ul(ue, ant) at
+///                          [(ue + ue_num * ant) * kBatchScs + sc]
+///   calib_re/calib_im:     calib(ant) at [ant * kBatchScs + sc]
+///   dl_beam_re/dl_beam_im: W_dl(ant, ue) at
+///                          [(ant + bs_ant_num * ue) * kBatchScs + sc]
+using DownlinkKernel = void (*)(const float* ul_beam_re,
+                                const float* ul_beam_im, const float* calib_re,
+                                const float* calib_im, float* dl_beam_re,
+                                float* dl_beam_im);
+
+/// Returns the downlink kernel for (bs_ant_num x ue_num) channel matrices, or
+/// nullptr if this shape is not supported
+DownlinkKernel GetDownlinkKernel(size_t bs_ant_num, size_t ue_num);
+
+}  // namespace BatchedBeam
+
+#endif  // BATCHED_BEAM_H_
@@ -0,0 +1,319 @@
+/**
+ * @file bbdev_device.cc
+ * @brief Implementation file for the bbdev LDPC accelerator shared by the
+ * decoders and encoders of the workers.
+ */
+
+#include "bbdev_device.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "modulation.h"
+#include "rte_bbdev_op.h"
+#include "rte_dev.h"
+#include "rte_eal.h"
+#include "rte_errno.h"
+#include "rte_mbuf.h"
+#include "rte_memory.h"
+#include "utils.h"
+
+#define LCORE_ID 36
+
+namespace Bbdev {
+
+// A probed and started device, one per bbdev_dev_id of the cells
+struct Device {
+  size_t num_workers_ = 0;
+  bool encode_enabled_ = false;
+  const struct rte_device* device_ = nullptr;
+  std::vector<struct rte_mempool*> worker_mbuf_pools_;
+  Properties props_;
+  // Start of the pages already mapped for DMA by the device
+  std::set<uintptr_t> mapped_pages_;
+};
+
+static std::mutex devices_mutex;
+// Never erased, so references to the devices stay valid
+static std::map<uint8_t, Device> devices;
+
+static Device& DeviceOf(uint8_t dev_id) {
+  std::scoped_lock lock(devices_mutex);
+  const auto device = devices.find(dev_id);
+  RtAssert(device != devices.end(), "bbdev: the device is not set up");
+  return device->second;
+}
+
+Family FamilyOf(const std::string& driver_name) {
+  // The PF and VF drivers share a prefix. DPDK spells the FPGA driver
+  // "5ngr" in some releases.
+  if (driver_name.find("acc100") != std::string::npos ||
+      driver_name.find("acc101") != std::string::npos) {
+    return Family::kAcc100;
+  } else if (driver_name.find("vrb1") != std::string::npos ||
+             driver_name.find("acc200") != std::string::npos) {
+    return Family::kVrb1;
+  } else if (driver_name.find("fpga_5gnr") != std::string::npos ||
+             driver_name.find("fpga_5ngr") != std::string::npos) {
+    return Family::kFpga5gnr;
+  }
+  return Family::kUnknown;
+}
+
+const char* FamilyName(Family family) {
+  switch (family) {
+    case Family::kAcc100:
+      return "ACC100";
+    case Family::kVrb1:
+      return "ACC200/VRB1";
+    case Family::kFpga5gnr:
+      return "N3000 FPGA";
+    case Family::kUnknown:
+    default:
+      return "unknown";
+  }
+}
+
+int8_t ScaleLlr(int llr, int8_t llr_size, int8_t llr_decimals) {
+  const int llr_max = (1 << (llr_size - 1)) - 1;
+  const int shift = llr_decimals - kAgoraLlrDecimals;
+  if (shift >= 0) {
+    llr *= (1 << shift);
+  } else {
+    llr /= (1 << -shift);
+  }
+  return static_cast<int8_t>(std::clamp(llr, -llr_max, llr_max));
+}
+
+static void ProbeProperties(uint8_t dev_id, const struct rte_bbdev_info& info,
+                            Properties& props) {
+  props.driver_name_ =
+      (info.drv.driver_name != nullptr) ? info.drv.driver_name : "";
+  props.family_ = FamilyOf(props.driver_name_);
+  props.max_queues_ = static_cast<uint16_t>(info.drv.max_num_queues);
+  props.min_alignment_ = info.drv.min_alignment;
+  props.harq_memory_bytes_ =
+      static_cast<size_t>(info.drv.harq_buffer_size) * 1024;
+
+  const struct rte_bbdev_op_cap* dec_cap =
+      Capability(dev_id, RTE_BBDEV_OP_LDPC_DEC);
+  RtAssert(dec_cap != nullptr, "bbdev: the device cannot decode LDPC");
+  props.llr_size_ = dec_cap->cap.ldpc_dec.llr_size;
+  props.llr_decimals_ = dec_cap->cap.ldpc_dec.llr_decimals;
+  props.dec_flags_ = dec_cap->cap.ldpc_dec.capability_flags;
+  const struct rte_bbdev_op_cap* enc_cap =
+      Capability(dev_id, RTE_BBDEV_OP_LDPC_ENC);
+  props.enc_flags_ =
+      (enc_cap != nullptr) ? enc_cap->cap.ldpc_enc.capability_flags : 0;
+
+  if (props.family_ == Family::kUnknown) {
+    AGORA_LOG_WARN("bbdev: unknown driver %s, using it as an LDPC device\n",
+                   props.driver_name_.c_str());
+  }
+  AGORA_LOG_INFO(
+      "bbdev %u: %s (%s), %u queues, LLRs of %d bits with %d decimals, "
+      "%zu KB of HARQ memory\n",
+      dev_id, FamilyName(props.family_), props.driver_name_.c_str(),
+      props.max_queues_, props.llr_size_, props.llr_decimals_,
+      props.harq_memory_bytes_ / 1024);
+}
+
+static void InitEal() {
+  std::string core_list = std::to_string(LCORE_ID);  // this is hard set to core 36
+
+  const char* rte_argv[] = {"txrx",        "-l",           core_list.c_str(),
+                            "--log-level", "lib.eal:info", nullptr};
+  int rte_argc = static_cast<int>(sizeof(rte_argv) / sizeof(rte_argv[0])) - 1;
+
+  // Initialize DPDK environment, unless the DPDK TX/RX threads already did
+  int ret = rte_eal_init(rte_argc, const_cast<char**>(rte_argv));
+  RtAssert(
+      ret >= 0 || rte_errno == EALREADY,
+      "Failed to initialize DPDK.  Are you running with root permissions?");
+
+  int nb_bbdevs = rte_bbdev_count();
+  std::cout << "num bbdevs: " << nb_bbdevs << std::endl;
+
+  if (nb_bbdevs == 0) rte_exit(EXIT_FAILURE, "No bbdevs detected!\n");
+}
+
+// Start dev_id with a decode queue per worker, and an encode queue per
+// worker if encode and the device can, and an mbuf pool of num_mbufs per
+// worker
+static void SetupDevice(uint8_t dev_id, size_t num_workers, bool encode,
+                        size_t num_mbufs, Device& dev) {
+  RtAssert(rte_bbdev_is_valid(dev_id), "bbdev: no device for bbdev_dev_id");
+  struct rte_bbdev_info info;
+  rte_bbdev_info_get(dev_id, &info);
+  dev.device_ = info.device;
+  ProbeProperties(dev_id, info, dev.props_);
+  // The FPGA has no interrupt support
+  const bool interrupts = (dev.props_.family_ != Family::kFpga5gnr);
+
+  dev.num_workers_ = num_workers;
+  dev.encode_enabled_ =
+      encode && (Capability(dev_id, RTE_BBDEV_OP_LDPC_ENC) != nullptr);
+  // The decode queues come first, then the encode queues
+  const size_t num_queues =
+      dev.encode_enabled_ ? 2 * num_workers : num_workers;
+  RtAssert(num_queues <= dev.props_.max_queues_,
+           "bbdev: more worker threads than bbdev queues");
+
+  int ret = rte_bbdev_setup_queues(dev_id, num_queues, info.socket_id);
+
+  if (ret < 0) {
+    printf("rte_bbdev_setup_queues(%u, %zu, %d) ret %i\n", dev_id, num_queues,
+           rte_socket_id(), ret);
+  }
+
+  if (interrupts) {
+    rte_bbdev_intr_enable(dev_id);
+  }
+
+  struct rte_bbdev_queue_conf qconf;
+  qconf.socket = info.socket_id;
+  qconf.queue_size = info.drv.queue_size_lim;
+  qconf.priority = 0;
+
+  for (size_t q_id = 0; q_id < num_queues; q_id++) {
+    /* Configure all queues belonging to this bbdev device */
+    qconf.op_type = (q_id < num_workers) ? RTE_BBDEV_OP_LDPC_DEC
+                                         : RTE_BBDEV_OP_LDPC_ENC;
+    ret = rte_bbdev_queue_configure(dev_id, q_id, &qconf);
+    if (ret < 0)
+      rte_exit(EXIT_FAILURE,
+               "ERROR(%d): BBDEV %u queue %zu not configured properly\n", ret,
+               dev_id, q_id);
+  }
+
+  ret = rte_bbdev_start(dev_id);
+  RtAssert(ret == 0, "bbdev: failed to start the device");
+
+  const int socket_id =
+      (info.socket_id == SOCKET_ID_ANY) ? 0 : info.socket_id;
+  for (size_t tid = 0; tid < num_workers; tid++) {
+    // Pool names must be unique in the process
+    const std::string name =
+        "acc_pool_" + std::to_string(dev_id) + "_" + std::to_string(tid);
+    struct rte_mempool* pool =
+        rte_pktmbuf_pool_create(name.c_str(), num_mbufs, 0, 0, 0, socket_id);
+    RtAssert(pool != nullptr, "bbdev: unable to create an mbuf pool");
+    dev.worker_mbuf_pools_.push_back(pool);
+  }
+  AGORA_LOG_INFO("bbdev %u: %zu decode and %zu encode queues started\n",
+                 dev_id, num_workers, dev.encode_enabled_ ? num_workers : 0);
+}
+
+// Set up dev_id once, for the first caller
+static void SetupOnce(uint8_t dev_id, size_t num_workers, bool encode,
+                      size_t num_mbufs) {
+  static std::once_flag eal_once;
+  std::call_once(eal_once, InitEal);
+
+  // The workers of a cell set up its device concurrently, and cells may
+  // share a device
+  static std::mutex setup_mutex;
+  std::scoped_lock setup_lock(setup_mutex);
+  {
+    std::scoped_lock lock(devices_mutex);
+    if (devices.count(dev_id) > 0) {
+      RtAssert(devices.at(dev_id).num_workers_ == num_workers,
+               "bbdev: cells sharing a device need the same number of "
+               "workers");
+      return;
+    }
+  }
+  Device dev;
+  SetupDevice(dev_id, num_workers, encode, OptimalMempoolSize(num_mbufs), dev);
+  std::scoped_lock lock(devices_mutex);
+  devices.emplace(dev_id, std::move(dev));
+}
+
+void Setup(const Config* cfg) {
+  // One input and one output mbuf per uplink code block and frame slot for
+  // the decoder, and per op in flight for the encoder
+  const bool encode = (cfg->Frame().NumDLSyms() > 0);
+  SetupOnce(cfg->BbdevDevId(), cfg->WorkerThreadNum(), encode,
+            (2 * cfg->FrameWindow() * cfg->Frame().NumULSyms() *
+             cfg->UeAntNum() *
+             cfg->LdpcConfig(Direction::kUplink).NumBlocksInSymbol()) +
+                (encode ? 2 * kEncodeOps : 0));
+}
+
+void SetupUe(const Config* cfg) {
+  // One input and one output mbuf per downlink code block of a symbol, the
+  // ops of a UE decoder in flight
+  SetupOnce(cfg->UeBbdevDevId(), cfg->UeWorkerThreadNum(), false,
+            2 * cfg->LdpcConfig(Direction::kDownlink).NumBlocksInSymbol());
+}
+
+const Properties& Props(uint8_t dev_id) { return DeviceOf(dev_id).props_; }
+
+int8_t HardLlrMagnitude(uint8_t dev_id) {
+  const Properties& props = Props(dev_id);
+  return ScaleLlr(kHardLlrMagnitude, props.llr_size_, props.llr_decimals_);
+}
+
+Queue DecodeQueue(uint8_t dev_id, size_t tid) {
+  const Device& dev = DeviceOf(dev_id);
+  RtAssert(tid < dev.num_workers_,
+           "bbdev: no decode queue for this worker thread");
+  return Queue(dev_id, static_cast<uint16_t>(tid));
+}
+
+Queue EncodeQueue(uint8_t dev_id, size_t tid) {
+  const Device& dev = DeviceOf(dev_id);
+  RtAssert(dev.encode_enabled_ && (tid < dev.num_workers_),
+           "bbdev: no encode queue for this worker thread");
+  return Queue(dev_id, static_cast<uint16_t>(dev.num_workers_ + tid));
+}
+
+bool EncodeEnabled(uint8_t dev_id) { return DeviceOf(dev_id).encode_enabled_; }
+
+const struct rte_bbdev_op_cap* Capability(uint8_t dev_id,
+                                          enum rte_bbdev_op_type op_type) {
+  struct rte_bbdev_info info;
+  rte_bbdev_info_get(dev_id, &info);
+  for (const struct rte_bbdev_op_cap* cap = info.drv.capabilities;
+       cap->type != RTE_BBDEV_OP_NONE; ++cap) {
+    if (cap->type == op_type) {
+      return cap;
+    }
+  }
+  return nullptr;
+}
+
+struct rte_mempool* WorkerMbufPool(uint8_t dev_id, size_t tid) {
+  return DeviceOf(dev_id).worker_mbuf_pools_.at(tid);
+}
+
+void RegisterExtMem(uint8_t dev_id, void* addr, size_t len) {
+  const size_t page_sz = sysconf(_SC_PAGESIZE);
+  const uintptr_t start =
+      RTE_ALIGN_FLOOR(reinterpret_cast<uintptr_t>(addr), page_sz);
+  const uintptr_t end =
+      RTE_ALIGN_CEIL(reinterpret_cast<uintptr_t>(addr) + len, page_sz);
+  void* base = reinterpret_cast<void*>(start);
+
+  // The memory is registered once per process, and mapped once per device
+  int ret = rte_extmem_register(base, end - start, nullptr, 0, page_sz);
+  RtAssert(ret == 0 || rte_errno == EEXIST,
+           "Failed to register bbdev external memory");
+  Device& dev = DeviceOf(dev_id);
+  std::scoped_lock lock(devices_mutex);
+  if (dev.mapped_pages_.insert(start).second) {
+    ret = rte_dev_dma_map(const_cast<struct rte_device*>(dev.device_), base,
+                          static_cast<uint64_t>(start), end - start);
+    RtAssert(ret == 0, "Failed to DMA map bbdev external memory");
+  }
+}
+
+}  // namespace Bbdev
@@ -0,0 +1,170 @@
+/**
+ * @file bbdev_device.h
+ * @brief Declaration file for the bbdev LDPC accelerators shared by the
+ * decoders and encoders of the workers: their probed properties, queues, mbuf
+ * pools and in-flight requests. Supports the ACC100/ACC101, the ACC200
+ * (VRB1) and the N3000 FPGA, and their SR-IOV VFs.
+ */
+
+#ifdef USE_ACC100
+
+#ifndef BBDEV_DEVICE_H_
+#define BBDEV_DEVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdint>
+#include <queue>
+#include <string>
+
+#include "config.h"
+#include "message.h"
+#include "rte_bbdev.h"
+#include "rte_mempool.h"
+
+namespace Bbdev {
+
+/// Encode ops of a worker that can be in the card at once
+#if defined(ENQUEUE_ASYNC)
+static constexpr size_t kEncodeOps = 512;
+#else
+static constexpr size_t kEncodeOps = EventData::kMaxTags;
+#endif
+/// Format of the demodulated LLRs: 8 bits with one fractional bit
+static constexpr int8_t kAgoraLlrSize = 8;
+static constexpr int8_t kAgoraLlrDecimals = 1;
+
+enum class Family { kAcc100, kVrb1, kFpga5gnr, kUnknown };
+
+/// What the card reported at Setup()
+struct Properties {
+  Family family_;
+  std::string driver_name_;
+  uint16_t max_queues_;
+  // LDPC decoder input format
+  int8_t llr_size_;
+  int8_t llr_decimals_;
+  // RTE_BBDEV_LDPC_* capability flags, 0 without the op type
+  uint32_t dec_flags_;
+  uint32_t enc_flags_;
+  // On-card HARQ memory, 0 if none
+  size_t harq_memory_bytes_;
+  uint16_t min_alignment_;
+};
+
+/// Family of a bbdev PMD, from its driver name
+Family FamilyOf(const std::string& driver_name);
+const char* FamilyName(Family family);
+
+/// Round a mempool size up to 2^n - 1 elements, the size rte_mempool packs
+/// best
+inline unsigned int OptimalMempoolSize(unsigned int num_elements) {
+  unsigned int size = 1;
+  while (size - 1 < num_elements) {
+    size <<= 1;
+  }
+  return size - 1;
+}
+
+/// Scale an LLR in the Agora format into a format of llr_size bits with
+/// llr_decimals fractional bits, saturating to llr_size bits
+int8_t ScaleLlr(int llr, int8_t llr_size, int8_t llr_decimals);
+
+/// Initialize the EAL once per process, then probe and start the device of
+/// cfg (BbdevDevId()) once per device. Every worker thread of the cell gets
+/// an LDPC decode queue and, if the device encodes and the frame has downlink
+/// symbols, an LDPC encode queue on it.
+void Setup(const Config* cfg);
+/// Setup() for the downlink decoders of the UE emulator, on the device of
+/// Config::UeBbdevDevId(), with a decode queue per UE worker thread
+void SetupUe(const Config* cfg);
+
+/// Only after Setup() of dev_id
+const Properties& Props(uint8_t dev_id);
+/// Magnitude of a hard decision LLR in the format of the card, which the
+/// demodulator writes so that its LLRs need no rescaling before the card
+int8_t HardLlrMagnitude(uint8_t dev_id);
+
+/// A queue of the card, the one enqueue/dequeue API of the doers. The op
+/// type of the ops must match the one the queue was configured with.
+class Queue {
+ public:
+  Queue() = default;
+  Queue(uint8_t dev_id, uint16_t queue_id)
+      : dev_id_(dev_id), queue_id_(queue_id) {}
+
+  inline uint16_t Enqueue(struct rte_bbdev_dec_op** ops, size_t num_ops) {
+    return rte_bbdev_enqueue_ldpc_dec_ops(dev_id_, queue_id_, ops,
+                                          static_cast<uint16_t>(num_ops));
+  }
+  inline uint16_t Enqueue(struct rte_bbdev_enc_op** ops, size_t num_ops) {
+    return rte_bbdev_enqueue_ldpc_enc_ops(dev_id_, queue_id_, ops,
+                                          static_cast<uint16_t>(num_ops));
+  }
+  inline uint16_t Dequeue(struct rte_bbdev_dec_op** ops, size_t num_ops) {
+    return rte_bbdev_dequeue_ldpc_dec_ops(dev_id_, queue_id_, ops,
+                                          static_cast<uint16_t>(num_ops));
+  }
+  inline uint16_t Dequeue(struct rte_bbdev_enc_op** ops, size_t num_ops) {
+    return rte_bbdev_dequeue_ldpc_enc_ops(dev_id_, queue_id_, ops,
+                                          static_cast<uint16_t>(num_ops));
+  }
+  inline uint8_t DevId() const { return dev_id_; }
+  inline uint16_t Id() const { return queue_id_; }
+
+ private:
+  uint8_t dev_id_ = 0;
+  uint16_t queue_id_ = 0;
+};
+
+/// The queues of worker tid on dev_id. Only after Setup().
+Queue DecodeQueue(uint8_t dev_id, size_t tid);
+Queue EncodeQueue(uint8_t dev_id, size_t tid);
+/// True if Setup() configured the encode queues of dev_id
+bool EncodeEnabled(uint8_t dev_id);
+/// The capability of op_type, nullptr if the card lacks it
+const struct rte_bbdev_op_cap* Capability(uint8_t dev_id,
+                                          enum rte_bbdev_op_type op_type);
+
+/// Pool of the mbufs of worker tid on dev_id, which have no data room and
+/// are attached to external buffers. Sized for the decoder and the encoder
+/// of the worker.
+struct rte_mempool* WorkerMbufPool(uint8_t dev_id, size_t tid);
+
+/// Register [addr, addr + len) as external memory and map it for DMA by
+/// dev_id. Other doers may have registered or mapped it already.
+void RegisterExtMem(uint8_t dev_id, void* addr, size_t len);
+
+/// Requests whose ops are still in a queue of the card. A queue returns its
+/// ops in order, so the requests complete in the order they were pushed.
+class PendingRequests {
+ public:
+  inline void Push(const EventData& resp_event, size_t num_ops) {
+    this->requests_.push(Request{resp_event, num_ops});
+  }
+  /// Retire the oldest op. Returns true and sets resp_event if it was the
+  /// last op of its request.
+  inline bool RetireOp(EventData& resp_event) {
+    Request& request = this->requests_.front();
+    request.pending_ops_--;
+    if (request.pending_ops_ > 0) {
+      return false;
+    }
+    resp_event = request.resp_event_;
+    this->requests_.pop();
+    return true;
+  }
+
+ private:
+  struct Request {
+    EventData resp_event_;
+    size_t pending_ops_;
+  };
+  std::queue<Request> requests_;
+};
+
+}  // namespace Bbdev
+
+#endif  // BBDEV_DEVICE_H_
+
+#endif  // USE_ACC100
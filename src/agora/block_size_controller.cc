@@ -0,0 +1,72 @@
+/**
+ * @file block_size_controller.cc
+ * @brief Implementation file for the BlockSizeController class
+ */
+#include "block_size_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.h"
+#include "message.h"
+
+// Weight of the latest frame in the smoothed block time
+static constexpr double kBlockUsWeight = 0.25;
+
+BlockSizeController::BlockSizeController(double target_event_us,
+                                         size_t num_workers,
+                                         size_t events_per_worker)
+    : target_event_us_(target_event_us),
+      min_events_(std::max<size_t>(num_workers * events_per_worker, 1)) {}
+
+size_t BlockSizeController::BlocksPerEvent(EventType stage,
+                                           size_t num_blocks) const {
+  const StageState& state = state_.at(static_cast<size_t>(stage));
+  const size_t bound =
+      state.backlog_ ? EventData::kMaxTags
+                     : std::clamp<size_t>(num_blocks / min_events_, 1,
+                                          EventData::kMaxTags);
+  // Before the first measurement the events are as coarse as the bound
+  // allows, like the static event batching
+  return (state.num_updates_ == 0) ? bound : std::min(state.blocks_, bound);
+}
+
+void BlockSizeController::Update(EventType stage, double block_us,
+                                 size_t queue_depth) {
+  StageState& state = state_.at(static_cast<size_t>(stage));
+  if (block_us <= 0.0) {
+    return;
+  }
+  // Smoothed, so that one slow frame does not swing the events
+  state.block_us_ = (state.num_updates_ == 0)
+                        ? block_us
+                        : ((1.0 - kBlockUsWeight) * state.block_us_) +
+                              (kBlockUsWeight * block_us);
+  state.num_updates_++;
+  const auto target = static_cast<size_t>(
+      std::ceil(target_event_us_ / state.block_us_));
+  const size_t blocks = std::clamp<size_t>(target, 1, EventData::kMaxTags);
+  // At most a doubling or a halving per frame
+  if (blocks > state.blocks_) {
+    state.blocks_ = std::min(blocks, 2 * state.blocks_);
+  } else {
+    state.blocks_ = std::max(blocks, state.blocks_ / 2);
+  }
+  state.backlog_ = (queue_depth >= min_events_);
+}
+
+void BlockSizeController::PrintSummary() const {
+  for (const auto& stage : {std::make_pair(EventType::kBeam, "beamweights"),
+                            std::make_pair(EventType::kDemul, "demul"),
+                            std::make_pair(EventType::kPrecode, "precode")}) {
+    const StageState& state = state_.at(static_cast<size_t>(stage.first));
+    if (state.num_updates_ == 0) {
+      continue;
+    }
+    AGORA_LOG_INFO(
+        "BlockSizeController: %s settled on %zu blocks per event, %.2f us "
+        "per block%s\n",
+        stage.second, state.blocks_, state.block_us_,
+        state.backlog_ ? ", with a backlog" : "");
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file block_size_controller.h
+ * @brief Declaration file for the BlockSizeController class, which sizes the
+ * subcarrier task events of the master between frames from the measured
+ * task times.
+ */
+#ifndef BLOCK_SIZE_CONTROLLER_H_
+#define BLOCK_SIZE_CONTROLLER_H_
+
+#include <array>
+#include <cstddef>
+
+#include "symbols.h"
+
+/// Picks the number of subcarrier blocks (of demul_block_size or
+/// beam_block_size) that the master packs into one beamweight, demul or
+/// precode event, so that an event takes about target_event_us.
+///
+/// The blocks per event are bounded so that every worker still gets
+/// events_per_worker events per symbol, which keeps the events coarse with
+/// few workers and fine with many. While tasks queue up behind busy workers
+/// the bound is lifted, as the extra parallelism would not be used.
+/// The block stays the unit of the buffers, so the granularity remains a
+/// multiple of the configured block and of kSCsPerCacheline.
+///
+/// Used by the master thread only.
+class BlockSizeController {
+ public:
+  BlockSizeController(double target_event_us, size_t num_workers,
+                      size_t events_per_worker);
+
+  /// Blocks per event of stage (kBeam, kDemul or kPrecode) for a symbol of
+  /// num_blocks blocks, in [1, EventData::kMaxTags]
+  size_t BlocksPerEvent(EventType stage, size_t num_blocks) const;
+
+  /**
+   * @brief Adjust a stage after a frame
+   *
+   * @param block_us Mean time of one block of the stage in the frame, 0 if
+   * it ran none
+   * @param queue_depth Tasks waiting in the task queues at the end of the
+   * frame
+   */
+  void Update(EventType stage, double block_us, size_t queue_depth);
+
+  /// Smoothed time of one block of stage, 0 before its first measurement
+  inline double BlockUs(EventType stage) const {
+    return state_.at(static_cast<size_t>(stage)).block_us_;
+  }
+
+  /// Log the blocks per event each stage settled on
+  void PrintSummary() const;
+
+ private:
+  struct StageState {
+    double block_us_ = 0.0;
+    // The blocks per event toward target_event_us, before the bound
+    size_t blocks_ = 1;
+    bool backlog_ = false;
+    size_t num_updates_ = 0;
+  };
+
+  const double target_event_us_;
+  const size_t min_events_;
+  std::array<StageState, kNumEventTypes> state_;
+};
+
+#endif  // BLOCK_SIZE_CONTROLLER_H_
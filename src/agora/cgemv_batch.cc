@@ -0,0 +1,61 @@
+/**
+ * @file cgemv_batch.cc
+ * @brief Implementation file for the batched complex matrix-vector products.
+ */
+#include "cgemv_batch.h"
+
+#include "utils.h"
+
+static const MKL_Complex8 kAlpha = {1, 0};
+static const MKL_Complex8 kBeta = {0, 0};
+
+CgemvBatch::CgemvBatch(size_t m, size_t n, size_t max_batch)
+    : m_(static_cast<MKL_INT>(m)),
+      n_(static_cast<MKL_INT>(n)),
+      max_batch_(max_batch),
+      a_array_(max_batch),
+      x_array_(max_batch),
+      y_array_(max_batch) {}
+
+void CgemvBatch::RunStrided(const complex_float* a, size_t a_stride,
+                            const complex_float* x, complex_float* y,
+                            size_t batch) const {
+  RtAssert(batch <= max_batch_, "CgemvBatch: batch too large");
+  // Each product is an (m x n) * (n x 1) GEMM
+  cblas_cgemm_batch_strided(
+      CblasColMajor, CblasNoTrans, CblasNoTrans, m_, 1, n_, &kAlpha, a, m_,
+      static_cast<MKL_INT>(a_stride), x, n_, n_, &kBeta, y, m_, m_,
+      static_cast<MKL_INT>(batch));
+}
+
+void CgemvBatch::Run(const complex_float* const* a, const complex_float* x,
+                     complex_float* y, size_t batch) {
+  RtAssert(batch <= max_batch_, "CgemvBatch: batch too large");
+  for (size_t k = 0; k < batch; k++) {
+    a_array_[k] = a[k];
+    x_array_[k] = x + k * n_;
+    y_array_[k] = y + k * m_;
+  }
+  // One group of batch (m x n) * (n x 1) GEMMs
+  const CBLAS_TRANSPOSE no_trans = CblasNoTrans;
+  const MKL_INT one = 1;
+  const MKL_INT group_size = static_cast<MKL_INT>(batch);
+  cblas_cgemm_batch(CblasColMajor, &no_trans, &no_trans, &m_, &one, &n_,
+                    &kAlpha, a_array_.data(), &m_, x_array_.data(), &n_,
+                    &kBeta, y_array_.data(), &m_, 1, &group_size);
+}
+
+void CgemvBatch::RunGroups(const complex_float* const* a,
+                           const size_t* group_sizes, size_t num_groups,
+                           const complex_float* x, complex_float* y) const {
+  size_t batch = 0;
+  for (size_t g = 0; g < num_groups; g++) {
+    // The vectors of the group are the columns of an n x group_size matrix
+    const auto group_size = static_cast<MKL_INT>(group_sizes[g]);
+    cblas_cgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, m_, group_size, n_,
+                &kAlpha, a[g], m_, x + batch * n_, n_, &kBeta, y + batch * m_,
+                m_);
+    batch += group_sizes[g];
+  }
+  RtAssert(batch <= max_batch_, "CgemvBatch: batch too large");
+}
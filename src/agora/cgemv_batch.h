@@ -0,0 +1,52 @@
+/**
+ * @file cgemv_batch.h
+ * @brief Declaration file for the batched complex matrix-vector products of
+ * the general equalizer and precoder, which multiply the matrices of a block
+ * of subcarriers with one MKL batch GEMM call.
+ */
+#ifndef CGEMV_BATCH_H_
+#define CGEMV_BATCH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "mkl.h"
+#include "symbols.h"
+
+/// y_k = A_k * x_k for k < batch, with column-major m x n matrices A_k and
+/// the vectors x_k and y_k side by side: x_k at x + k * n and y_k at
+/// y + k * m.
+class CgemvBatch {
+ public:
+  CgemvBatch(size_t m, size_t n, size_t max_batch);
+
+  /// A_k at a + k * a_stride, with cblas_cgemm_batch_strided
+  void RunStrided(const complex_float* a, size_t a_stride,
+                  const complex_float* x, complex_float* y,
+                  size_t batch) const;
+
+  /// A_k at a[k], for matrices shared by several subcarriers, with
+  /// cblas_cgemm_batch
+  void Run(const complex_float* const* a, const complex_float* x,
+           complex_float* y, size_t batch);
+
+  /// A_g shared by the group_sizes[g] consecutive vectors of group g, as
+  /// one (m x n) * (n x group_sizes[g]) GEMM per group, so that each matrix
+  /// is loaded once for its group
+  void RunGroups(const complex_float* const* a, const size_t* group_sizes,
+                 size_t num_groups, const complex_float* x,
+                 complex_float* y) const;
+
+  inline size_t MaxBatch() const { return max_batch_; }
+
+ private:
+  MKL_INT m_;
+  MKL_INT n_;
+  size_t max_batch_;
+  // The operand pointers of Run()
+  std::vector<const void*> a_array_;
+  std::vector<const void*> x_array_;
+  std::vector<void*> y_array_;
+};
+
+#endif  // CGEMV_BATCH_H_
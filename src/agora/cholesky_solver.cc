@@ -0,0 +1,74 @@
+/**
+ * @file cholesky_solver.cc
+ * @brief Implementation file for the Cholesky solver.
+ */
+#include "cholesky_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+namespace CholeskySolver {
+
+using Cx = std::complex<float>;
+
+bool Factor(float* a, size_t n, float& rcond) {
+  auto* g = reinterpret_cast<Cx*>(a);
+  float min_pivot = std::numeric_limits<float>::max();
+  float max_pivot = 0;
+  for (size_t j = 0; j < n; j++) {
+    const float diag = g[(j * n) + j].real();
+    float pivot_sq = diag;
+    for (size_t k = 0; k < j; k++) {
+      pivot_sq -= std::norm(g[(k * n) + j]);
+    }
+    // A pivot within rounding error of zero means a numerically singular
+    // matrix. Also rejects NaN.
+    if ((pivot_sq > std::numeric_limits<float>::epsilon() * diag) == false) {
+      return false;
+    }
+    const float pivot = std::sqrt(pivot_sq);
+    g[(j * n) + j] = pivot;
+    for (size_t i = j + 1; i < n; i++) {
+      Cx sum = g[(j * n) + i];
+      for (size_t k = 0; k < j; k++) {
+        sum -= g[(k * n) + i] * std::conj(g[(k * n) + j]);
+      }
+      g[(j * n) + i] = sum / pivot;
+    }
+    min_pivot = std::min(min_pivot, pivot);
+    max_pivot = std::max(max_pivot, pivot);
+  }
+  if (std::isfinite(max_pivot) == false) {
+    return false;
+  }
+  const float ratio = (n == 0) ? 1.0f : (min_pivot / max_pivot);
+  rcond = ratio * ratio;
+  return true;
+}
+
+void Solve(const float* l, size_t n, float* b, size_t m) {
+  const auto* f = reinterpret_cast<const Cx*>(l);
+  for (size_t col = 0; col < m; col++) {
+    Cx* x = reinterpret_cast<Cx*>(b) + (col * n);
+    // L * y = b
+    for (size_t i = 0; i < n; i++) {
+      Cx sum = x[i];
+      for (size_t k = 0; k < i; k++) {
+        sum -= f[(k * n) + i] * x[k];
+      }
+      x[i] = sum / f[(i * n) + i].real();
+    }
+    // L' * x = y
+    for (size_t i = n; i-- > 0;) {
+      Cx sum = x[i];
+      for (size_t k = i + 1; k < n; k++) {
+        sum -= std::conj(f[(i * n) + k]) * x[k];
+      }
+      x[i] = sum / f[(i * n) + i].real();
+    }
+  }
+}
+
+}  // namespace CholeskySolver
@@ -0,0 +1,28 @@
+/**
+ * @file cholesky_solver.h
+ * @brief Declaration file for the exception-free Cholesky solver of the
+ * detector Gram matrices, which also estimates their condition number from
+ * the pivots of the factorization.
+ */
+#ifndef CHOLESKY_SOLVER_H_
+#define CHOLESKY_SOLVER_H_
+
+#include <cstddef>
+
+namespace CholeskySolver {
+
+/// Factor the n x n Hermitian matrix a (interleaved, column-major) in place
+/// into its lower Cholesky factor L, with a = L * L'. Only the lower triangle
+/// of a is read and written. Returns false if a is not numerically positive
+/// definite (or not finite). Otherwise rcond is set to
+/// (min L(i, i) / max L(i, i))^2, an upper bound on the reciprocal condition
+/// number of a that is usually within a small factor of it.
+bool Factor(float* a, size_t n, float& rcond);
+
+/// Overwrite the n x m matrix b (interleaved, column-major) with
+/// inv(L * L') * b, for the factor l of Factor()
+void Solve(const float* l, size_t n, float* b, size_t m);
+
+}  // namespace CholeskySolver
+
+#endif  // CHOLESKY_SOLVER_H_
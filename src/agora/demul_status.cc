@@ -0,0 +1,69 @@
+/**
+ * @file demul_status.cc
+ * @brief Implementation file for the DemulStatus class.
+ */
+#include "demul_status.h"
+
+#include <algorithm>
+
+#include "utils.h"
+
+DemulStatus::DemulStatus(size_t frame_window, size_t num_ul_syms,
+                         size_t num_cbs, size_t llrs_per_cb,
+                         size_t mod_order_bits, size_t demul_block_size,
+                         size_t num_demul_blocks)
+    : frame_window_(frame_window),
+      num_ul_syms_(num_ul_syms),
+      num_cbs_(num_cbs),
+      demul_block_size_(demul_block_size),
+      num_demul_blocks_(num_demul_blocks),
+      cb_num_blocks_(num_cbs),
+      block_first_cb_(num_demul_blocks, num_cbs),
+      block_end_cb_(num_demul_blocks, 0),
+      pending_blocks_(frame_window * num_ul_syms * num_cbs),
+      blocks_done_(frame_window * num_ul_syms, 0) {
+  for (size_t cb = 0; cb < num_cbs; cb++) {
+    const size_t first_block =
+        ((cb * llrs_per_cb) / mod_order_bits) / demul_block_size;
+    const size_t last_block =
+        ((((cb + 1) * llrs_per_cb) - 1) / mod_order_bits) / demul_block_size;
+    RtAssert(last_block < num_demul_blocks,
+             "DemulStatus: code block past the last demul block");
+    cb_num_blocks_.at(cb) = last_block - first_block + 1;
+    for (size_t block = first_block; block <= last_block; block++) {
+      block_first_cb_.at(block) = std::min(block_first_cb_.at(block), cb);
+      block_end_cb_.at(block) = std::max(block_end_cb_.at(block), cb + 1);
+    }
+  }
+  for (size_t i = 0; i < frame_window * num_ul_syms; i++) {
+    std::copy(cb_num_blocks_.begin(), cb_num_blocks_.end(),
+              pending_blocks_.begin() + (i * num_cbs));
+  }
+}
+
+size_t DemulStatus::CompleteBlock(size_t frame_id, size_t symbol_idx_ul,
+                                  size_t base_sc_id, size_t& first_cb) {
+  const size_t symbol_index = SymbolIndex(frame_id, symbol_idx_ul);
+  const size_t block = base_sc_id / demul_block_size_;
+  size_t* pending = &pending_blocks_.at(symbol_index * num_cbs_);
+
+  // The code blocks that this block completes are consecutive: only the
+  // first and the last may also wait for other blocks
+  first_cb = num_cbs_;
+  size_t num_ready = 0;
+  for (size_t cb = block_first_cb_.at(block); cb < block_end_cb_.at(block);
+       cb++) {
+    pending[cb]--;
+    if (pending[cb] == 0) {
+      first_cb = std::min(first_cb, cb);
+      num_ready++;
+    }
+  }
+
+  blocks_done_.at(symbol_index)++;
+  if (blocks_done_.at(symbol_index) == num_demul_blocks_) {
+    blocks_done_.at(symbol_index) = 0;
+    std::copy(cb_num_blocks_.begin(), cb_num_blocks_.end(), pending);
+  }
+  return num_ready;
+}
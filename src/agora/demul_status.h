@@ -0,0 +1,54 @@
+/**
+ * @file demul_status.h
+ * @brief Declaration file for the DemulStatus class, which releases the
+ * uplink code blocks of a symbol to the decoder as their LLRs are demodulated.
+ */
+#ifndef DEMUL_STATUS_H_
+#define DEMUL_STATUS_H_
+
+#include <cstddef>
+#include <vector>
+
+/// Tracks the demul blocks of each uplink symbol that finished. Code block k
+/// of every spatial stream takes the LLRs of subcarriers
+/// [k * llrs_per_cb / mod_order_bits, ((k + 1) * llrs_per_cb - 1) /
+/// mod_order_bits], so it can be decoded once the demul blocks of those
+/// subcarriers are done, without waiting for the rest of the symbol.
+///
+/// Used by the master thread only.
+class DemulStatus {
+ public:
+  DemulStatus(size_t frame_window, size_t num_ul_syms, size_t num_cbs,
+              size_t llrs_per_cb, size_t mod_order_bits,
+              size_t demul_block_size, size_t num_demul_blocks);
+
+  /// Record the demul block that starts at base_sc_id. Returns the number of
+  /// code blocks it completed, which are the consecutive code blocks from
+  /// first_cb on. The counts of a symbol are reset by its last block.
+  size_t CompleteBlock(size_t frame_id, size_t symbol_idx_ul,
+                       size_t base_sc_id, size_t& first_cb);
+
+  inline size_t NumCbs() const { return num_cbs_; }
+
+ private:
+  inline size_t SymbolIndex(size_t frame_id, size_t symbol_idx_ul) const {
+    return ((frame_id % frame_window_) * num_ul_syms_) + symbol_idx_ul;
+  }
+
+  const size_t frame_window_;
+  const size_t num_ul_syms_;
+  const size_t num_cbs_;
+  const size_t demul_block_size_;
+  const size_t num_demul_blocks_;
+  // Demul blocks that each code block waits for
+  std::vector<size_t> cb_num_blocks_;
+  // Code blocks [block_first_cb_[b], block_end_cb_[b]) take LLRs of block b
+  std::vector<size_t> block_first_cb_;
+  std::vector<size_t> block_end_cb_;
+  // Per frame slot and uplink symbol: the demul blocks still pending for
+  // each code block, and the demul blocks done
+  std::vector<size_t> pending_blocks_;
+  std::vector<size_t> blocks_done_;
+};
+
+#endif  // DEMUL_STATUS_H_
@@ -5,16 +5,36 @@
  */
 #include "dobeamweights.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+
 #include "comms-lib.h"
 #include "concurrent_queue_wrapper.h"
 #include "doer.h"
+#include "cholesky_solver.h"
+#include "int16_equalizer.h"
 #include "logger.h"
+#include "recip_calib.h"
+#include "small_mimo_kernels.h"
+#include "tile_layout.h"
 
 static constexpr bool kUseSIMDGather = true;
 // Calculate the zeroforcing receiver using the formula W_zf = inv(H' * H) * H'.
 // This is faster but less accurate than using an SVD-based pseudoinverse.
 static constexpr bool kUseInverseForZF = true;
+// Gram matrices whose estimated reciprocal condition number is below this
+// are solved with regularization
+static constexpr float kMinGramRcond = 1e-5f;
+// Regularization of those Gram matrices, relative to their largest diagonal
+// entry
+static constexpr float kGramRegularization = 1e-3f;
 static constexpr bool kUseUlZfForDownlink = true;
+// Use the compile-time specialized kernels in batched_beam.h for small
+// antenna configurations (ZF and MMSE) that have no dedicated small_mimo_acc
+// path
+static constexpr bool kUseBatchedBeams = true;
 
 DoBeamWeights::DoBeamWeights(
     Config* config, int tid,
@@ -26,30 +46,52 @@ DoBeamWeights::DoBeamWeights(
     Table<complex_float>& calib_buffer,
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_beam_matrices,
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_beam_matrices,
-    MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* stats_manager)
+    Table<complex_float>& beam_ref_csi_buffer,
+    std::vector<BeamReuseState>& beam_reuse_state, MacScheduler* mac_sched,
+    PhyStats* in_phy_stats, Stats* stats_manager)
     : Doer(config, tid),
-      csi_buffers_(csi_buffers),
+      csi_buffers_(csi_buffers.Flat()),
       calib_dl_buffer_(calib_dl_buffer),
       calib_ul_buffer_(calib_ul_buffer),
       calib_dl_msum_buffer_(calib_dl_msum_buffer),
       calib_ul_msum_buffer_(calib_ul_msum_buffer),
       calib_buffer_(calib_buffer),
-      ul_beam_matrices_(ul_beam_matrices),
-      dl_beam_matrices_(dl_beam_matrices),
+      ul_beam_matrices_(ul_beam_matrices.Flat()),
+      dl_beam_matrices_(dl_beam_matrices.Flat()),
+      beam_ref_csi_buffer_(beam_ref_csi_buffer),
+      beam_reuse_state_(beam_reuse_state),
       mac_sched_(mac_sched),
-      phy_stats_(in_phy_stats) {
+      phy_stats_(in_phy_stats),
+      // The uplink and downlink beamweights and the Gram matrix of a
+      // subcarrier
+      arena_(2 * Roundup<64>(config->SpatialStreamsNum() * config->BsAntNum() *
+                             sizeof(complex_float)) +
+                 Roundup<64>(config->SpatialStreamsNum() *
+                             config->SpatialStreamsNum() *
+                             sizeof(complex_float)),
+             scratch_policy_) {
   duration_stat_ = stats_manager->GetDurationStat(DoerType::kBeam, tid);
+  alloc_stat_ = duration_stat_;
   pred_csi_buffer_ =
       static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
           Agora_memory::Alignment_t::kAlign64,
-          kMaxAntennas * kMaxUEs * sizeof(complex_float)));
+          kMaxAntennas * kMaxUEs * sizeof(complex_float), scratch_policy_));
   csi_gather_buffer_ =
       static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
           Agora_memory::Alignment_t::kAlign64,
-          kMaxAntennas * kMaxUEs * sizeof(complex_float)));
+          kMaxAntennas * kMaxUEs * sizeof(complex_float), scratch_policy_));
   calib_gather_buffer_ = static_cast<complex_float*>(
       Agora_memory::PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign64,
-                                       kMaxAntennas * sizeof(complex_float)));
+                                       kMaxAntennas * sizeof(complex_float),
+                                       scratch_policy_));
+  if (mac_sched_->Grouping() != nullptr) {
+    grouping_csi_buffer_ = static_cast<complex_float*>(
+        Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            UeGrouping::kNumSamples * cfg_->BsAntNum() * cfg_->UeAntNum() *
+                sizeof(complex_float),
+            scratch_policy_));
+  }
 
   calib_sc_vec_ptr_ = std::make_unique<arma::cx_fvec>(
       reinterpret_cast<arma::cx_float*>(calib_gather_buffer_), cfg_->BfAntNum(),
@@ -77,17 +119,110 @@ DoBeamWeights::DoBeamWeights(
       }
     }
   }
+
+  // The batched kernels derive the downlink precoder from the uplink detector
+  // (kUseUlZfForDownlink) and do not handle external reference nodes. The
+  // small_mimo_acc zeroforcing paths take precedence for uplink-only frames.
+  batched_kernel_ = nullptr;
+  batched_dl_kernel_ = nullptr;
+  batch_buffer_ = nullptr;
+  const bool small_mimo_zf =
+      cfg_->SmallMimoAcc() &&
+      (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kZF) &&
+      kUseInverseForZF && (cfg_->Frame().NumDLSyms() == 0);
+  const bool batched_algo =
+      (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kMMSE) ||
+      ((cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kZF) &&
+       kUseInverseForZF);
+  if (kUseBatchedBeams && batched_algo && (small_mimo_zf == false) &&
+      (cfg_->Frame().NumDLSyms() == 0 || kUseUlZfForDownlink) &&
+      num_ext_ref_ == 0 && (kEnableMatLog == false) &&
+      (kPrintBeamStats == false)) {
+    batched_kernel_ = BatchedBeam::GetDetectorKernel(
+        cfg_->BsAntNum(), cfg_->SpatialStreamsNum());
+    if (cfg_->Frame().NumDLSyms() > 0) {
+      batched_dl_kernel_ = BatchedBeam::GetDownlinkKernel(
+          cfg_->BsAntNum(), cfg_->SpatialStreamsNum());
+    }
+  }
+  if (batched_kernel_ != nullptr) {
+    batch_buffer_ = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        (4 * BatchedBeam::kMaxPlaneSize + 2 * BatchedBeam::kMaxVecPlaneSize) *
+            sizeof(float), scratch_policy_));
+  }
+
+  amx_gram_ = cfg_->AmxBeams() &&
+              (cfg_->SpatialStreamsNum() <= AmxGram::kMaxStreams) &&
+              AmxGram::Available();
+  if (cfg_->AmxBeams() && (amx_gram_ == false) && (tid_ == 0)) {
+    AGORA_LOG_WARN(
+        "amx_beams is set, but AMX-BF16 is not available for %zu spatial "
+        "streams. Computing the beamweights in float\n",
+        cfg_->SpatialStreamsNum());
+  }
+
+  // Match the buffer layouts used by dofft and dodemul for small_mimo_acc
+  batch_partial_transpose_ = kUsePartialTrans;
+  batch_sc_major_beams_ = false;
+  if (cfg_->SmallMimoAcc() &&
+      ((cfg_->BsAntNum() == 2 && cfg_->UeAntNum() == 2) ||
+       (cfg_->BsAntNum() == 4 && cfg_->UeAntNum() == 4))) {
+#if !defined(ARMA_CUBE_MATOP) && !defined(SIMD_MATOP)
+    batch_partial_transpose_ = false;
+#endif
+#if defined(SIMD_MATOP) || defined(ARMA_VEC_MATOP)
+    batch_sc_major_beams_ = true;
+#endif
+  }
 }
 
 DoBeamWeights::~DoBeamWeights() {
-  std::free(pred_csi_buffer_);
-  std::free(csi_gather_buffer_);
+  if (amx_gram_ && (amx_gram_count_ > 0)) {
+    AGORA_LOG_INFO(
+        "DoBeamWeights [%d]: %zu of %zu AMX Gram matrices recomputed in "
+        "float\n",
+        tid_, amx_fallback_count_, amx_gram_count_);
+  }
+  if (predicted_count_ > 0) {
+    AGORA_LOG_INFO(
+        "DoBeamWeights [%d]: %zu of %zu predicted beam blocks matched the "
+        "measured CSI\n",
+        tid_, prediction_hit_count_, predicted_count_);
+  }
+  if (regularized_count_ > 0) {
+    AGORA_LOG_INFO(
+        "DoBeamWeights [%d]: %zu ill-conditioned Gram matrices solved with "
+        "regularization\n",
+        tid_, regularized_count_);
+  }
+  Agora_memory::PaddedAlignedFree(batch_buffer_);
+  Agora_memory::PaddedAlignedFree(pred_csi_buffer_);
+  Agora_memory::PaddedAlignedFree(csi_gather_buffer_);
+  Agora_memory::PaddedAlignedFree(grouping_csi_buffer_);
   calib_sc_vec_ptr_.reset();
-  std::free(calib_gather_buffer_);
+  Agora_memory::PaddedAlignedFree(calib_gather_buffer_);
 }
 
 EventData DoBeamWeights::Launch(size_t tag) {
   ComputeBeams(tag);
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  // One beam task of the frame measures the correlations for the groups of
+  // the frames still to be scheduled
+  if ((grouping_csi_buffer_ != nullptr) && (gen_tag_t(tag).sc_id_ == 0)) {
+    UpdateUeCorrelation(frame_id);
+  }
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kBeams, frame_id)) {
+    // The subcarriers of the block are contiguous in the frame's beams
+    const size_t base_sc_id = gen_tag_t(tag).sc_id_;
+    const size_t num_scs =
+        std::min(cfg_->BeamBlockSize(), cfg_->OfdmDataNum() - base_sc_id);
+    taps_->Publish(
+        TapPoint::kBeams, frame_id, 0, 0, base_sc_id,
+        ul_beam_matrices_[frame_id % cfg_->FrameWindow()][base_sc_id],
+        num_scs * cfg_->BsAntNum() * cfg_->SpatialStreamsNum() *
+            sizeof(complex_float));
+  }
   return EventData(EventType::kBeam, tag);
 }
 
@@ -102,31 +237,23 @@ void DoBeamWeights::ComputePrecoder(size_t frame_id, size_t cur_sc_id,
     phy_stats_->UpdateUlCsi(frame_id, cur_sc_id, mat_csi);
   }
 #endif
+  arena_.Reset();
   arma::cx_fmat mat_ul_beam(reinterpret_cast<arma::cx_float*>(ul_beam_mem),
                             cfg_->SpatialStreamsNum(), cfg_->BsAntNum(), false);
-  arma::cx_fmat mat_ul_beam_tmp;
+  // Inserting the columns of the reference antennas moves these to the heap
+  arma::cx_fmat mat_ul_beam_tmp(arena_.Alloc<arma::cx_float>(mat_csi.n_elem),
+                                mat_csi.n_cols, mat_csi.n_rows, false, false);
+  gram_rcond_ = -1.0f;
   switch (cfg_->BeamformingAlgo()) {
     case CommsLib::BeamformingAlgorithm::kZF:
       if (kUseInverseForZF) {
-        try {
-          mat_ul_beam_tmp =
-              arma::inv_sympd(mat_csi.t() * mat_csi) * mat_csi.t();
-        } catch (std::runtime_error&) {
-          AGORA_LOG_WARN(
-              "Failed to invert channel matrix, falling back to pinv()\n");
-          arma::pinv(mat_ul_beam_tmp, mat_csi, 1e-2, "dc");
-        }
+        ComputeDetector(mat_csi, 0, mat_ul_beam_tmp);
       } else {
         arma::pinv(mat_ul_beam_tmp, mat_csi, 1e-2, "dc");
       }
       break;
     case CommsLib::BeamformingAlgorithm::kMMSE:
-      mat_ul_beam_tmp =
-          arma::inv_sympd(
-              mat_csi.t() * mat_csi +
-              noise * arma::eye<arma::cx_fmat>(cfg_->SpatialStreamsNum(),
-                                               cfg_->SpatialStreamsNum())) *
-          mat_csi.t();
+      ComputeDetector(mat_csi, noise, mat_ul_beam_tmp);
       break;
     case CommsLib::BeamformingAlgorithm::kMRC:
       mat_ul_beam_tmp = mat_csi.t();
@@ -136,15 +263,24 @@ void DoBeamWeights::ComputePrecoder(size_t frame_id, size_t cur_sc_id,
   }
 
   if (cfg_->Frame().NumDLSyms() > 0) {
-    arma::cx_fmat mat_dl_beam_tmp;
+    arma::cx_fmat mat_dl_beam_tmp(
+        arena_.Alloc<arma::cx_float>(mat_csi.n_elem), mat_csi.n_cols,
+        mat_csi.n_rows, false, false);
     if (kUseUlZfForDownlink == true) {
       // With orthonormal calib matrix:
       // pinv(calib * csi) = pinv(csi)*inv(calib)
       // This probably causes a performance hit since we are throwing
       // magnitude info away by taking the sign of the calibration matrix
       // Inv is already acheived by UL over DL division outside this function
-      arma::cx_fmat inv_calib_mat = arma::diagmat(arma::sign(calib_sc_vec));
-      mat_dl_beam_tmp = mat_ul_beam_tmp * inv_calib_mat;
+      // Scale each antenna's column by the sign instead of multiplying with
+      // a diagonal matrix
+      for (size_t ant = 0; ant < mat_ul_beam_tmp.n_cols; ant++) {
+        const arma::cx_float calib = calib_sc_vec(ant);
+        const float calib_abs = std::abs(calib);
+        mat_dl_beam_tmp.col(ant) =
+            mat_ul_beam_tmp.col(ant) *
+            ((calib_abs > 0) ? (calib / calib_abs) : arma::cx_float(0));
+      }
     } else {
       arma::cx_fmat mat_dl_csi = inv(arma::diagmat(calib_sc_vec)) * mat_csi;
       if (kEnableMatLog) {
@@ -183,8 +319,12 @@ void DoBeamWeights::ComputePrecoder(size_t frame_id, size_t cur_sc_id,
     // We should be scaling the beamforming matrix, so the IFFT
     // output can be scaled with OfdmCaNum() across all antennas.
     // See Argos paper (Mobicom 2012) Sec. 3.4 for details.
-    const float scale = 1 / (abs(mat_dl_beam_tmp).max());
-    mat_dl_beam_tmp = mat_dl_beam_tmp * scale;
+    float max_abs = 0;
+    for (size_t i = 0; i < mat_dl_beam_tmp.n_elem; i++) {
+      max_abs = std::max(max_abs, std::abs(mat_dl_beam_tmp(i)));
+    }
+    const float scale = 1 / max_abs;
+    mat_dl_beam_tmp *= scale;
 
     for (size_t i = 0; i < cfg_->NumCells(); i++) {
       if (cfg_->ExternalRefNode(i)) {
@@ -218,103 +358,145 @@ void DoBeamWeights::ComputePrecoder(size_t frame_id, size_t cur_sc_id,
   if (kEnableMatLog) {
     phy_stats_->UpdateUlBeam(frame_id, cur_sc_id, mat_ul_beam.st());
   }
-  if (kPrintBeamStats) {
-    const float rcond = arma::rcond(mat_csi.t() * mat_csi);
+  if (kPrintBeamStats && phy_stats_->SampleFrame(frame_id) &&
+      phy_stats_->SampleSc(cur_sc_id)) {
+    // The estimate of the detector's Cholesky factorization, if it has one
+    const float rcond = (gram_rcond_ >= 0.0f)
+                            ? gram_rcond_
+                            : arma::rcond(mat_csi.t() * mat_csi);
     phy_stats_->UpdateCsiCond(frame_id, cur_sc_id, rcond);
   }
 #endif
 }
 
-// Called for each frame_id / sc_id
+void DoBeamWeights::ComputeDetector(const arma::cx_fmat& mat_csi,
+                                    float noise,
+                                    arma::cx_fmat& mat_detector) {
+  const size_t ue_num = mat_csi.n_cols;
+  arma::cx_fmat gram(arena_.Alloc<arma::cx_float>(ue_num * ue_num), ue_num,
+                     ue_num, false, true);
+  float rcond = 0;
+  bool factored = false;
+  if (amx_gram_) {
+    AmxGram::ComputeGram(reinterpret_cast<const float*>(mat_csi.memptr()),
+                         mat_csi.n_rows, ue_num,
+                         reinterpret_cast<float*>(gram.memptr()));
+    gram.diag() += noise;
+    amx_gram_count_++;
+    // Rounding H to bf16 perturbs the Gram matrix by about kBf16Epsilon
+    // relative to its norm, which the inverse amplifies by up to its
+    // condition number
+    factored = CholeskySolver::Factor(reinterpret_cast<float*>(gram.memptr()),
+                                      ue_num, rcond) &&
+               (AmxGram::kBf16Epsilon <= cfg_->AmxBeamTolerance() * rcond);
+    if (factored == false) {
+      amx_fallback_count_++;
+    }
+  }
+  if (factored == false) {
+    gram = mat_csi.t() * mat_csi;
+    gram.diag() += noise;
+    factored = CholeskySolver::Factor(reinterpret_cast<float*>(gram.memptr()),
+                                      ue_num, rcond) &&
+               (rcond >= kMinGramRcond);
+  }
+  if (factored == false) {
+    // Ill-conditioned or singular channel: regularize relative to the
+    // strongest stream instead of taking an SVD-based pseudoinverse
+    gram = mat_csi.t() * mat_csi;
+    const float max_diag = arma::max(arma::real(gram.diag()));
+    gram.diag() += noise + (kGramRegularization * max_diag);
+    factored = CholeskySolver::Factor(reinterpret_cast<float*>(gram.memptr()),
+                                      ue_num, rcond);
+    regularized_count_++;
+  }
+  gram_rcond_ = rcond;
+
+  mat_detector = mat_csi.t();
+  if (factored) {
+    CholeskySolver::Solve(reinterpret_cast<const float*>(gram.memptr()),
+                          ue_num,
+                          reinterpret_cast<float*>(mat_detector.memptr()),
+                          mat_csi.n_rows);
+  } else {
+    // All-zero or non-finite CSI
+    mat_detector.zeros();
+  }
+}
+
+void DoBeamWeights::UpdateCalib(size_t frame_id, size_t start_sc,
+                                size_t last_sc) {
+  const size_t frames_to_complete = cfg_->RecipCalFrameCnt();
+  if ((cfg_->Frame().IsRecCalEnabled() == false) ||
+      (frames_to_complete == 0) || (frame_id < frames_to_complete) ||
+      ((frame_id % frames_to_complete) != 0)) {
+    return;
+  }
+  const size_t cal_slot_current = cfg_->RecipCalIndex(frame_id);
+  // Use the previous window which has a full set of calibration results
+  const size_t cal_slot_complete =
+      cfg_->ModifyRecCalIndex(cal_slot_current, -1);
+  const size_t ofdm_data_num = cfg_->OfdmDataNum();
+  const size_t bf_ant_num = cfg_->BfAntNum();
+  const size_t num_scs = last_sc - start_sc;
+  AGORA_LOG_TRACE(
+      "DoBeamWeights[%d]: (Frame %zu, sc_id %zu), UpdateCalib updating calib "
+      "at slot %zu\n",
+      tid_, frame_id, start_sc, cal_slot_complete);
+
+  // oldest frame data in buffer but could be partially written with newest
+  // values using the second oldest....
+  const size_t cal_slot_old = cfg_->ModifyRecCalIndex(cal_slot_current, +1);
+  const size_t cal_slot_prev = cfg_->ModifyRecCalIndex(cal_slot_complete, -1);
+
+  // All buffers but calib_buffer_ are antenna-major, so each antenna's
+  // subcarriers are one contiguous run
+  complex_float* calib =
+      &calib_buffer_[cal_slot_complete][start_sc * bf_ant_num];
+  for (size_t ant_i = 0; ant_i < bf_ant_num; ant_i++) {
+    const size_t offset = (ant_i * ofdm_data_num) + start_sc;
+    const complex_float* cur_dl = &calib_dl_buffer_[cal_slot_complete][offset];
+    const complex_float* cur_ul = &calib_ul_buffer_[cal_slot_complete][offset];
+    if (cfg_->SmoothCalib()) {
+      complex_float* dl_msum =
+          &calib_dl_msum_buffer_[cal_slot_complete][offset];
+      complex_float* ul_msum =
+          &calib_ul_msum_buffer_[cal_slot_complete][offset];
+      // Add new value to old rolling sum.  Then subtract out the oldest.
+      RecipCalib::UpdateMovingSum(
+          &calib_dl_msum_buffer_[cal_slot_prev][offset], cur_dl,
+          &calib_dl_buffer_[cal_slot_old][offset], dl_msum, num_scs);
+      RecipCalib::UpdateMovingSum(
+          &calib_ul_msum_buffer_[cal_slot_prev][offset], cur_ul,
+          &calib_ul_buffer_[cal_slot_old][offset], ul_msum, num_scs);
+      RecipCalib::Ratio(ul_msum, dl_msum, calib + ant_i, num_scs, bf_ant_num);
+    } else {
+      RecipCalib::Ratio(cur_ul, cur_dl, calib + ant_i, num_scs, bf_ant_num);
+    }
+  }
+
+  if (kEnableMatLog) {
+    for (size_t sc_id = start_sc; sc_id < last_sc; sc_id++) {
+      const arma::cx_fvec calib_vec(
+          reinterpret_cast<arma::cx_float*>(
+              &calib_buffer_[cal_slot_complete][sc_id * bf_ant_num]),
+          bf_ant_num, false);
+      phy_stats_->UpdateCalibMat(frame_id, sc_id, calib_vec);
+    }
+  }
+}
+
+// Called for each frame_id / sc_id, after UpdateCalib of its block
 // Updates calib_sc_vec
 void DoBeamWeights::ComputeCalib(size_t frame_id, size_t sc_id,
                                  arma::cx_fvec& calib_sc_vec) {
   const size_t frames_to_complete = cfg_->RecipCalFrameCnt();
   if (cfg_->Frame().IsRecCalEnabled() && (frame_id >= frames_to_complete)) {
-    const size_t cal_slot_current = cfg_->RecipCalIndex(frame_id);
-    const bool frame_update = ((frame_id % frames_to_complete) == 0);
-
-    // Use the previous window which has a full set of calibration results
     const size_t cal_slot_complete =
-        cfg_->ModifyRecCalIndex(cal_slot_current, -1);
-
-    // update moving sum
-    arma::cx_fmat cur_calib_dl_msum_mat(
-        reinterpret_cast<arma::cx_float*>(
-            calib_dl_msum_buffer_[cal_slot_complete]),
-        cfg_->BfAntNum(), cfg_->OfdmDataNum(), false);
-    arma::cx_fmat cur_calib_ul_msum_mat(
-        reinterpret_cast<arma::cx_float*>(
-            calib_ul_msum_buffer_[cal_slot_complete]),
-        cfg_->BfAntNum(), cfg_->OfdmDataNum(), false);
-
-    arma::cx_fmat calib_mat(
-        reinterpret_cast<arma::cx_float*>(calib_buffer_[cal_slot_complete]),
-        cfg_->BfAntNum(), cfg_->OfdmDataNum(), false);
-
-    // Update the moving sum
-    if (frame_update) {
-      if (sc_id == 0) {
-        AGORA_LOG_TRACE(
-            "DoBeamWeights[%d]: (Frame %zu, sc_id %zu), ComputeCalib "
-            "updating "
-            "calib at slot %zu : prev %zu, old %zu\n",
-            tid_, frame_id, sc_id, cal_slot_complete, cal_slot_prev,
-            cal_slot_old);
-      }
-      // Add the most recently completed value
-      const arma::cx_fmat cur_calib_dl_mat(
-          reinterpret_cast<arma::cx_float*>(
-              calib_dl_buffer_[cal_slot_complete]),
-          cfg_->OfdmDataNum(), cfg_->BfAntNum(), false);
-      const arma::cx_fmat cur_calib_ul_mat(
-          reinterpret_cast<arma::cx_float*>(
-              calib_ul_buffer_[cal_slot_complete]),
-          cfg_->OfdmDataNum(), cfg_->BfAntNum(), false);
-
-      if (cfg_->SmoothCalib()) {
-        // oldest frame data in buffer but could be partially written with newest values
-        // using the second oldest....
-        const size_t cal_slot_old =
-            cfg_->ModifyRecCalIndex(cal_slot_current, +1);
-
-        const arma::cx_fmat old_calib_dl_mat(
-            reinterpret_cast<arma::cx_float*>(calib_dl_buffer_[cal_slot_old]),
-            cfg_->OfdmDataNum(), cfg_->BfAntNum(), false);
-        const arma::cx_fmat old_calib_ul_mat(
-            reinterpret_cast<arma::cx_float*>(calib_ul_buffer_[cal_slot_old]),
-            cfg_->OfdmDataNum(), cfg_->BfAntNum(), false);
-
-        const size_t cal_slot_prev =
-            cfg_->ModifyRecCalIndex(cal_slot_complete, -1);
-        const arma::cx_fmat prev_calib_dl_msum_mat(
-            reinterpret_cast<arma::cx_float*>(
-                calib_dl_msum_buffer_[cal_slot_prev]),
-            cfg_->BfAntNum(), cfg_->OfdmDataNum(), false);
-        const arma::cx_fmat prev_calib_ul_msum_mat(
-            reinterpret_cast<arma::cx_float*>(
-                calib_ul_msum_buffer_[cal_slot_prev]),
-            cfg_->BfAntNum(), cfg_->OfdmDataNum(), false);
-
-        // Add new value to old rolling sum.  Then subtract out the oldest.
-
-        cur_calib_dl_msum_mat.col(sc_id) =
-            prev_calib_dl_msum_mat.col(sc_id) +
-            (cur_calib_dl_mat.row(sc_id) - old_calib_dl_mat.row(sc_id)).st();
-        cur_calib_ul_msum_mat.col(sc_id) =
-            prev_calib_ul_msum_mat.col(sc_id) +
-            (cur_calib_ul_mat.row(sc_id) - old_calib_ul_mat.row(sc_id)).st();
-        calib_mat.col(sc_id) =
-            cur_calib_ul_msum_mat.col(sc_id) / cur_calib_dl_msum_mat.col(sc_id);
-      } else {
-        calib_mat.col(sc_id) =
-            (cur_calib_ul_mat.row(sc_id) / cur_calib_dl_mat.row(sc_id)).st();
-      }
-      if (kEnableMatLog) {
-        phy_stats_->UpdateCalibMat(frame_id, sc_id, calib_mat.col(sc_id));
-      }
-    }
-    calib_sc_vec = calib_mat.col(sc_id);
+        cfg_->ModifyRecCalIndex(cfg_->RecipCalIndex(frame_id), -1);
+    std::memcpy(calib_sc_vec.memptr(),
+                &calib_buffer_[cal_slot_complete][sc_id * cfg_->BfAntNum()],
+                cfg_->BfAntNum() * sizeof(complex_float));
   }
   // Otherwise calib_sc_vec = identity from init
 }
@@ -333,10 +515,9 @@ static inline void PartialTransposeGather(size_t cur_sc_id, float* src,
 
   size_t ant_start = 0;
   if (kUseSIMDGather && (bs_ant_num >= kAntNumPerSimd)) {
-    const size_t transpose_block_id = cur_sc_id / kTransposeBlockSize;
-    const size_t sc_inblock_idx = cur_sc_id % kTransposeBlockSize;
     const size_t offset_in_src_buffer =
-        transpose_block_id * bs_ant_num * kTransposeBlockSize + sc_inblock_idx;
+        TileLayout::TileBase(cur_sc_id, bs_ant_num) +
+        (cur_sc_id % kTransposeBlockSize);
 
     src = src + offset_in_src_buffer * 2;
 #ifdef __AVX512F__
@@ -374,12 +555,11 @@ static inline void PartialTransposeGather(size_t cur_sc_id, float* src,
     ant_start = bs_ant_num - (bs_ant_num % kAntNumPerSimd);
   }
   if (ant_start < bs_ant_num) {
-    const size_t pt_base_offset =
-        (cur_sc_id / kTransposeBlockSize) * (kTransposeBlockSize * bs_ant_num);
     auto* cx_src = reinterpret_cast<complex_float*>(src);
     complex_float* cx_dst = (complex_float*)dst + ant_start;
     for (size_t ant_i = ant_start; ant_i < bs_ant_num; ant_i++) {
-      *cx_dst = cx_src[pt_base_offset + (ant_i * kTransposeBlockSize) +
+      *cx_dst = cx_src[TileLayout::TileBase(cur_sc_id, bs_ant_num) +
+                       (ant_i * kTransposeBlockSize) +
                        (cur_sc_id % kTransposeBlockSize)];
       cx_dst++;
     }
@@ -402,7 +582,7 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
   //Request was generated from gen_tag_t::FrmSc
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t base_sc_id = gen_tag_t(tag).sc_id_;
-  const size_t frame_slot = frame_id % kFrameWnd;
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
   if (kDebugPrintInTask) {
     std::printf("In doZF thread %d: frame: %zu, base subcarrier: %zu\n", tid_,
                 frame_id, base_sc_id);
@@ -418,6 +598,11 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
   //        " base_sc_id: %zu, last_sc_id: %zu\n",
   //        cfg_->BeamBlockSize(), cfg_->OfdmDataNum(), base_sc_id, last_sc_id);
 
+  if (cfg_->Frame().NumDLSyms() > 0) {
+    // The whole block at once, also the subcarriers skipped by BeamScStride
+    UpdateCalib(frame_id, base_sc_id, last_sc_id);
+  }
+
   // Note: no subcarrirer grouping or partial transpose for special case.
   // Reduce to scalar, vectorized operation in special case (1x1 ant config),
   // uplink, zeroforcing
@@ -432,9 +617,9 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
     const size_t ue_idx = 0;  // If UeAntNum() == 1, only one UE exists.
 
     // Equivalent to: arma::inv_sympd(mat_csi.t() * mat_csi) * mat_csi.t();
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
+#if defined(SIMD_MATOP)
     // Gather CSI
-    complex_float* ptr_src = csi_buffers_[frame_slot][ue_idx];
+    const complex_float* csi = csi_buffers_[frame_slot][ue_idx];
 
     // Prepare UL beam matrix. Linearly distribute the memory.
     complex_float* ptr_ul_beam = ul_beam_matrices_[frame_slot][base_sc_id];
@@ -443,10 +628,12 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
     duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
 
     // A = [a], B = [1/a] = A^(-1)
-    for (size_t i = 0; i < sc_vec_len; i += kSCsPerCacheline) {
-      __m512 a = _mm512_loadu_ps(ptr_src + i);
-      __m512 inv_a = CommsLib::M512ComplexCf32Reciprocal(a);
-      _mm512_storeu_ps(ptr_ul_beam + i, inv_a);
+    const SmallMimo::Kernels& small_mimo = SmallMimo::Get(
+        cfg_->FastMathPrecision(FastMath::Family::kSmallMimo));
+    if (unlikely(!small_mimo.invert_[SmallMimo::DimIndex(1)](
+            &csi, SmallMimo::TileChunks(1, sc_vec_len), ptr_ul_beam,
+            sc_vec_len))) {
+      AGORA_LOG_WARN("Channel matrix seems not invertible\n");
     }
 #else
     // Gather CSI
@@ -481,64 +668,25 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
     const size_t start_tsc1 = GetTime::WorkerRdtsc();
 
     // Equivalent to: arma::inv_sympd(mat_csi.t() * mat_csi) * mat_csi.t();
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
-
-    // Gather CSI = [csi_a, csi_b; csi_c, csi_d]
-    complex_float* ptr_a = csi_buffers_[frame_slot][0];
-    complex_float* ptr_b = csi_buffers_[frame_slot][1];
-    complex_float* ptr_c = ptr_a + sc_vec_len;
-    complex_float* ptr_d = ptr_b + sc_vec_len;
-
+#if defined(SIMD_MATOP)
     // Prepare UL beam matrix. Linearly distribute the memory.
     complex_float* ul_beam_mem = ul_beam_matrices_[frame_slot][0];
-    complex_float* ul_beam_a = ul_beam_mem;
-    complex_float* ul_beam_b = ul_beam_mem + sc_vec_len;
-    complex_float* ul_beam_c = ul_beam_mem + 2 * sc_vec_len;
-    complex_float* ul_beam_d = ul_beam_mem + 3 * sc_vec_len;
-
-    // arma::cx_frowvec vec_det = arma::zeros<arma::cx_frowvec>(sc_vec_len);
-    // complex_float* ptr_det =
-    //   reinterpret_cast<complex_float*>(vec_det.memptr());
 
     const size_t start_tsc2 = GetTime::WorkerRdtsc();
     duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
 
     // A = [ a b ], B = [a' b'] = [d  -b] / (a*d - b*c) = A^(-1)
     //     [ c d ]      [c' d']   [-c  a]
-    for (size_t i = 0; i < sc_vec_len; i += kSCsPerCacheline) {
-      __m512 a = _mm512_loadu_ps(ptr_a + i);
-      __m512 b = _mm512_loadu_ps(ptr_b + i);
-      __m512 c = _mm512_loadu_ps(ptr_c + i);
-      __m512 d = _mm512_loadu_ps(ptr_d + i);
-
-      // det = a*d - b*c
-      __m512 term1 = CommsLib::M512ComplexCf32Mult(a, d, false);
-      __m512 term2 = CommsLib::M512ComplexCf32Mult(b, c, false);
-      __m512 det = _mm512_sub_ps(term1, term2);
-
-      // lack of division of complex numbers.
-      // use reciprocal for division since multiplication is faster
-      det = CommsLib::M512ComplexCf32Reciprocal(det);
-
-      // check if the channel matrix is invertible,
-      // float lowest > 1e-38, normal range > 1e-8
-      if (unlikely(CommsLib::M512ComplexCf32NearZeros(det, 1e-10))) {
-        AGORA_LOG_WARN("Channel matrix seems not invertible\n");
-      }
-      // _mm512_storeu_ps(ptr_det + i, det);
-
-      a = CommsLib::M512ComplexCf32Mult(a, det, false);
-      b = CommsLib::M512ComplexCf32Mult(b, det, false);
-      c = CommsLib::M512ComplexCf32Mult(c, det, false);
-      d = CommsLib::M512ComplexCf32Mult(d, det, false);
-
-      __m512 neg = _mm512_set1_ps(-1.0f);
-      b = _mm512_mul_ps(b, neg);
-      c = _mm512_mul_ps(c, neg);
-      _mm512_storeu_ps(ul_beam_a + i, d);
-      _mm512_storeu_ps(ul_beam_b + i, b);
-      _mm512_storeu_ps(ul_beam_c + i, c);
-      _mm512_storeu_ps(ul_beam_d + i, a);
+    const complex_float* csi[2] = {csi_buffers_[frame_slot][0],
+                                   csi_buffers_[frame_slot][1]};
+    // check if the channel matrix is invertible,
+    // float lowest > 1e-38, normal range > 1e-8
+    const SmallMimo::Kernels& small_mimo = SmallMimo::Get(
+        cfg_->FastMathPrecision(FastMath::Family::kSmallMimo));
+    if (unlikely(!small_mimo.invert_[SmallMimo::DimIndex(2)](
+            csi, SmallMimo::TileChunks(2, sc_vec_len), ul_beam_mem,
+            sc_vec_len))) {
+      AGORA_LOG_WARN("Channel matrix seems not invertible\n");
     }
 #elif defined(ARMA_VEC_MATOP)
     // Gather CSI = [csi_a, csi_b; csi_c, csi_d]
@@ -596,7 +744,7 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
     // Handle each subcarrier in the block (base_sc_id : last_sc_id -1)
     for (size_t cur_sc_id = base_sc_id; cur_sc_id < last_sc_id; cur_sc_id++) {
       // Gather CSI matrices of each pilot from partially-transposed CSIs.
-      arma::uvec ue_list = mac_sched_->ScheduledUeList(frame_id, cur_sc_id);
+      const auto& ue_list = mac_sched_->Schedule(frame_id).ue_list_;
       for (size_t selected_ue_idx = 0;
            selected_ue_idx < cfg_->SpatialStreamsNum(); selected_ue_idx++) {
         size_t ue_idx = ue_list.at(selected_ue_idx);
@@ -733,364 +881,25 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
 
     const size_t start_tsc1 = GetTime::WorkerRdtsc();
 
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
-    // Gather CSI
-    complex_float* ptr_0_0 = csi_buffers_[frame_slot][0];
-    complex_float* ptr_0_1 = csi_buffers_[frame_slot][1];
-    complex_float* ptr_0_2 = csi_buffers_[frame_slot][2];
-    complex_float* ptr_0_3 = csi_buffers_[frame_slot][3];
-    complex_float* ptr_1_0 = ptr_0_0 + sc_vec_len;
-    complex_float* ptr_1_1 = ptr_0_1 + sc_vec_len;
-    complex_float* ptr_1_2 = ptr_0_2 + sc_vec_len;
-    complex_float* ptr_1_3 = ptr_0_3 + sc_vec_len;
-    complex_float* ptr_2_0 = ptr_1_0 + sc_vec_len;
-    complex_float* ptr_2_1 = ptr_1_1 + sc_vec_len;
-    complex_float* ptr_2_2 = ptr_1_2 + sc_vec_len;
-    complex_float* ptr_2_3 = ptr_1_3 + sc_vec_len;
-    complex_float* ptr_3_0 = ptr_2_0 + sc_vec_len;
-    complex_float* ptr_3_1 = ptr_2_1 + sc_vec_len;
-    complex_float* ptr_3_2 = ptr_2_2 + sc_vec_len;
-    complex_float* ptr_3_3 = ptr_2_3 + sc_vec_len;
-
+#if defined(SIMD_MATOP)
     // Prepare UL beam matrix. Linearly distribute the memory.
     complex_float* ul_beam_mem = ul_beam_matrices_[frame_slot][0];
-    complex_float* ul_beam_0_0 = ul_beam_mem;
-    complex_float* ul_beam_0_1 = ul_beam_0_0 + sc_vec_len;
-    complex_float* ul_beam_0_2 = ul_beam_0_1 + sc_vec_len;
-    complex_float* ul_beam_0_3 = ul_beam_0_2 + sc_vec_len;
-    complex_float* ul_beam_1_0 = ul_beam_0_3 + sc_vec_len;
-    complex_float* ul_beam_1_1 = ul_beam_1_0 + sc_vec_len;
-    complex_float* ul_beam_1_2 = ul_beam_1_1 + sc_vec_len;
-    complex_float* ul_beam_1_3 = ul_beam_1_2 + sc_vec_len;
-    complex_float* ul_beam_2_0 = ul_beam_1_3 + sc_vec_len;
-    complex_float* ul_beam_2_1 = ul_beam_2_0 + sc_vec_len;
-    complex_float* ul_beam_2_2 = ul_beam_2_1 + sc_vec_len;
-    complex_float* ul_beam_2_3 = ul_beam_2_2 + sc_vec_len;
-    complex_float* ul_beam_3_0 = ul_beam_2_3 + sc_vec_len;
-    complex_float* ul_beam_3_1 = ul_beam_3_0 + sc_vec_len;
-    complex_float* ul_beam_3_2 = ul_beam_3_1 + sc_vec_len;
-    complex_float* ul_beam_3_3 = ul_beam_3_2 + sc_vec_len;
-
-    // arma::cx_frowvec vec_det = arma::zeros<arma::cx_frowvec>(sc_vec_len);
-    // complex_float* ptr_det =
-    //   reinterpret_cast<complex_float*>(vec_det.memptr());
 
     const size_t start_tsc2 = GetTime::WorkerRdtsc();
     duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
 
-    for (size_t i = 0; i < sc_vec_len; i += kSCsPerCacheline) {
-      __m512 csi_0_0 = _mm512_loadu_ps(ptr_0_0 + i);
-      __m512 csi_0_1 = _mm512_loadu_ps(ptr_0_1 + i);
-      __m512 csi_0_2 = _mm512_loadu_ps(ptr_0_2 + i);
-      __m512 csi_0_3 = _mm512_loadu_ps(ptr_0_3 + i);
-      __m512 csi_1_0 = _mm512_loadu_ps(ptr_1_0 + i);
-      __m512 csi_1_1 = _mm512_loadu_ps(ptr_1_1 + i);
-      __m512 csi_1_2 = _mm512_loadu_ps(ptr_1_2 + i);
-      __m512 csi_1_3 = _mm512_loadu_ps(ptr_1_3 + i);
-      __m512 csi_2_0 = _mm512_loadu_ps(ptr_2_0 + i);
-      __m512 csi_2_1 = _mm512_loadu_ps(ptr_2_1 + i);
-      __m512 csi_2_2 = _mm512_loadu_ps(ptr_2_2 + i);
-      __m512 csi_2_3 = _mm512_loadu_ps(ptr_2_3 + i);
-      __m512 csi_3_0 = _mm512_loadu_ps(ptr_3_0 + i);
-      __m512 csi_3_1 = _mm512_loadu_ps(ptr_3_1 + i);
-      __m512 csi_3_2 = _mm512_loadu_ps(ptr_3_2 + i);
-      __m512 csi_3_3 = _mm512_loadu_ps(ptr_3_3 + i);
-
-      // Prepare operands to avoid repeated computation
-      __m512 prod_1_0_x_2_1 =
-          CommsLib::M512ComplexCf32Mult(csi_1_0, csi_2_1, false);
-      __m512 prod_1_0_x_2_2 =
-          CommsLib::M512ComplexCf32Mult(csi_1_0, csi_2_2, false);
-      __m512 prod_1_0_x_2_3 =
-          CommsLib::M512ComplexCf32Mult(csi_1_0, csi_2_3, false);
-      __m512 prod_1_0_x_3_1 =
-          CommsLib::M512ComplexCf32Mult(csi_1_0, csi_3_1, false);
-      __m512 prod_1_0_x_3_2 =
-          CommsLib::M512ComplexCf32Mult(csi_1_0, csi_3_2, false);
-      __m512 prod_1_0_x_3_3 =
-          CommsLib::M512ComplexCf32Mult(csi_1_0, csi_3_3, false);
-
-      __m512 prod_1_1_x_2_0 =
-          CommsLib::M512ComplexCf32Mult(csi_1_1, csi_2_0, false);
-      __m512 prod_1_1_x_2_2 =
-          CommsLib::M512ComplexCf32Mult(csi_1_1, csi_2_2, false);
-      __m512 prod_1_1_x_2_3 =
-          CommsLib::M512ComplexCf32Mult(csi_1_1, csi_2_3, false);
-      __m512 prod_1_1_x_3_0 =
-          CommsLib::M512ComplexCf32Mult(csi_1_1, csi_3_0, false);
-      __m512 prod_1_1_x_3_2 =
-          CommsLib::M512ComplexCf32Mult(csi_1_1, csi_3_2, false);
-      __m512 prod_1_1_x_3_3 =
-          CommsLib::M512ComplexCf32Mult(csi_1_1, csi_3_3, false);
-
-      __m512 prod_1_2_x_2_0 =
-          CommsLib::M512ComplexCf32Mult(csi_1_2, csi_2_0, false);
-      __m512 prod_1_2_x_2_1 =
-          CommsLib::M512ComplexCf32Mult(csi_1_2, csi_2_1, false);
-      __m512 prod_1_2_x_2_3 =
-          CommsLib::M512ComplexCf32Mult(csi_1_2, csi_2_3, false);
-      __m512 prod_1_2_x_3_0 =
-          CommsLib::M512ComplexCf32Mult(csi_1_2, csi_3_0, false);
-      __m512 prod_1_2_x_3_1 =
-          CommsLib::M512ComplexCf32Mult(csi_1_2, csi_3_1, false);
-      __m512 prod_1_2_x_3_3 =
-          CommsLib::M512ComplexCf32Mult(csi_1_2, csi_3_3, false);
-
-      __m512 prod_1_3_x_2_0 =
-          CommsLib::M512ComplexCf32Mult(csi_1_3, csi_2_0, false);
-      __m512 prod_1_3_x_2_1 =
-          CommsLib::M512ComplexCf32Mult(csi_1_3, csi_2_1, false);
-      __m512 prod_1_3_x_2_2 =
-          CommsLib::M512ComplexCf32Mult(csi_1_3, csi_2_2, false);
-      __m512 prod_1_3_x_3_0 =
-          CommsLib::M512ComplexCf32Mult(csi_1_3, csi_3_0, false);
-      __m512 prod_1_3_x_3_1 =
-          CommsLib::M512ComplexCf32Mult(csi_1_3, csi_3_1, false);
-      __m512 prod_1_3_x_3_2 =
-          CommsLib::M512ComplexCf32Mult(csi_1_3, csi_3_2, false);
-
-      __m512 prod_2_0_x_3_1 =
-          CommsLib::M512ComplexCf32Mult(csi_2_0, csi_3_1, false);
-      __m512 prod_2_0_x_3_2 =
-          CommsLib::M512ComplexCf32Mult(csi_2_0, csi_3_2, false);
-      __m512 prod_2_0_x_3_3 =
-          CommsLib::M512ComplexCf32Mult(csi_2_0, csi_3_3, false);
-
-      __m512 prod_2_1_x_3_0 =
-          CommsLib::M512ComplexCf32Mult(csi_2_1, csi_3_0, false);
-      __m512 prod_2_1_x_3_2 =
-          CommsLib::M512ComplexCf32Mult(csi_2_1, csi_3_2, false);
-      __m512 prod_2_1_x_3_3 =
-          CommsLib::M512ComplexCf32Mult(csi_2_1, csi_3_3, false);
-
-      __m512 prod_2_2_x_3_0 =
-          CommsLib::M512ComplexCf32Mult(csi_2_2, csi_3_0, false);
-      __m512 prod_2_2_x_3_1 =
-          CommsLib::M512ComplexCf32Mult(csi_2_2, csi_3_1, false);
-      __m512 prod_2_2_x_3_3 =
-          CommsLib::M512ComplexCf32Mult(csi_2_2, csi_3_3, false);
-
-      __m512 prod_2_3_x_3_0 =
-          CommsLib::M512ComplexCf32Mult(csi_2_3, csi_3_0, false);
-      __m512 prod_2_3_x_3_1 =
-          CommsLib::M512ComplexCf32Mult(csi_2_3, csi_3_1, false);
-      __m512 prod_2_3_x_3_2 =
-          CommsLib::M512ComplexCf32Mult(csi_2_3, csi_3_2, false);
-
-      // Calculate determinant, please refer to arma impl for formula
-      __m512 term1 = _mm512_sub_ps(prod_2_2_x_3_3, prod_2_3_x_3_2);
-      __m512 term2 = _mm512_sub_ps(prod_2_3_x_3_1, prod_2_1_x_3_3);
-      __m512 term3 = _mm512_sub_ps(prod_2_1_x_3_2, prod_2_2_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_1_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_1_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_1_3, term3, false);
-      __m512 term = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-      term = CommsLib::M512ComplexCf32Mult(csi_0_0, term, false);
-      __m512 det = term;
-
-      term1 = _mm512_sub_ps(prod_2_2_x_3_3, prod_2_3_x_3_2);
-      term2 = _mm512_sub_ps(prod_2_3_x_3_1, prod_2_1_x_3_3);
-      term3 = _mm512_sub_ps(prod_2_1_x_3_2, prod_2_2_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      term = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-      term = CommsLib::M512ComplexCf32Mult(csi_1_0, term, false);
-      det = _mm512_sub_ps(det, term);
-
-      term1 = _mm512_sub_ps(prod_1_2_x_3_3, prod_1_3_x_3_2);
-      term2 = _mm512_sub_ps(prod_1_3_x_3_1, prod_1_1_x_3_3);
-      term3 = _mm512_sub_ps(prod_1_1_x_3_2, prod_1_2_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      term = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-      term = CommsLib::M512ComplexCf32Mult(csi_2_0, term, false);
-      det = _mm512_add_ps(det, term);
-
-      term1 = _mm512_sub_ps(prod_1_2_x_2_3, prod_1_3_x_2_2);
-      term2 = _mm512_sub_ps(prod_1_3_x_2_1, prod_1_1_x_2_3);
-      term3 = _mm512_sub_ps(prod_1_1_x_2_2, prod_1_2_x_2_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      term = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-      term = CommsLib::M512ComplexCf32Mult(csi_3_0, term, false);
-      det = _mm512_sub_ps(det, term);
-
-      // check if the channel matrix is invertible,
-      // float lowest > 1e-38, normal range > 1e-8
-      if (unlikely(CommsLib::M512ComplexCf32NearZeros(det, 1e-10))) {
-        AGORA_LOG_WARN("Channel matrix seems not invertible\n");
-      }
-      // _mm512_storeu_ps(ptr_det + i, det);
-
-      // lack of division of complex numbers.
-      // use reciprocal for division since multiplication is faster
-      det = CommsLib::M512ComplexCf32Reciprocal(det);
-
-      term1 = _mm512_sub_ps(prod_2_2_x_3_3, prod_2_3_x_3_2);
-      term2 = _mm512_sub_ps(prod_2_3_x_3_1, prod_2_1_x_3_3);
-      term3 = _mm512_sub_ps(prod_2_1_x_3_2, prod_2_2_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_1_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_1_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_1_3, term3, false);
-      __m512 adj_0_0 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_3_x_3_2, prod_2_2_x_3_3);
-      term2 = _mm512_sub_ps(prod_2_1_x_3_3, prod_2_3_x_3_1);
-      term3 = _mm512_sub_ps(prod_2_2_x_3_1, prod_2_1_x_3_2);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_0_1 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_2_x_3_3, prod_1_3_x_3_2);
-      term2 = _mm512_sub_ps(prod_1_3_x_3_1, prod_1_1_x_3_3);
-      term3 = _mm512_sub_ps(prod_1_1_x_3_2, prod_1_2_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_0_2 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_3_x_2_2, prod_1_2_x_2_3);
-      term2 = _mm512_sub_ps(prod_1_1_x_2_3, prod_1_3_x_2_1);
-      term3 = _mm512_sub_ps(prod_1_2_x_2_1, prod_1_1_x_2_2);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_1, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_0_3 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_3_x_3_2, prod_2_2_x_3_3);
-      term2 = _mm512_sub_ps(prod_2_0_x_3_3, prod_2_3_x_3_0);
-      term3 = _mm512_sub_ps(prod_2_2_x_3_0, prod_2_0_x_3_2);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_1_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_1_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_1_3, term3, false);
-      __m512 adj_1_0 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_2_x_3_3, prod_2_3_x_3_2);
-      term2 = _mm512_sub_ps(prod_2_3_x_3_0, prod_2_0_x_3_3);
-      term3 = _mm512_sub_ps(prod_2_0_x_3_2, prod_2_2_x_3_0);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_1_1 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_3_x_3_2, prod_1_2_x_3_3);
-      term2 = _mm512_sub_ps(prod_1_0_x_3_3, prod_1_3_x_3_0);
-      term3 = _mm512_sub_ps(prod_1_2_x_3_0, prod_1_0_x_3_2);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_1_2 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_2_x_2_3, prod_1_3_x_2_2);
-      term2 = _mm512_sub_ps(prod_1_3_x_2_0, prod_1_0_x_2_3);
-      term3 = _mm512_sub_ps(prod_1_0_x_2_2, prod_1_2_x_2_0);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_2, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_1_3 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_1_x_3_3, prod_2_3_x_3_1);
-      term2 = _mm512_sub_ps(prod_2_3_x_3_0, prod_2_0_x_3_3);
-      term3 = _mm512_sub_ps(prod_2_0_x_3_1, prod_2_1_x_3_0);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_1_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_1_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_1_3, term3, false);
-      __m512 adj_2_0 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_3_x_3_1, prod_2_1_x_3_3);
-      term2 = _mm512_sub_ps(prod_2_0_x_3_3, prod_2_3_x_3_0);
-      term3 = _mm512_sub_ps(prod_2_1_x_3_0, prod_2_0_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_2_1 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_1_x_3_3, prod_1_3_x_3_1);
-      term2 = _mm512_sub_ps(prod_1_3_x_3_0, prod_1_0_x_3_3);
-      term3 = _mm512_sub_ps(prod_1_0_x_3_1, prod_1_1_x_3_0);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_2_2 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_3_x_2_1, prod_1_1_x_2_3);
-      term2 = _mm512_sub_ps(prod_1_0_x_2_3, prod_1_3_x_2_0);
-      term3 = _mm512_sub_ps(prod_1_1_x_2_0, prod_1_0_x_2_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_3, term3, false);
-      __m512 adj_2_3 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_2_x_3_1, prod_2_1_x_3_2);
-      term2 = _mm512_sub_ps(prod_2_0_x_3_2, prod_2_2_x_3_0);
-      term3 = _mm512_sub_ps(prod_2_1_x_3_0, prod_2_0_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_1_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_1_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_1_2, term3, false);
-      __m512 adj_3_0 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_2_1_x_3_2, prod_2_2_x_3_1);
-      term2 = _mm512_sub_ps(prod_2_2_x_3_0, prod_2_0_x_3_2);
-      term3 = _mm512_sub_ps(prod_2_0_x_3_1, prod_2_1_x_3_0);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_2, term3, false);
-      __m512 adj_3_1 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_2_x_3_1, prod_1_1_x_3_2);
-      term2 = _mm512_sub_ps(prod_1_0_x_3_2, prod_1_2_x_3_0);
-      term3 = _mm512_sub_ps(prod_1_1_x_3_0, prod_1_0_x_3_1);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_2, term3, false);
-      __m512 adj_3_2 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      term1 = _mm512_sub_ps(prod_1_1_x_2_2, prod_1_2_x_2_1);
-      term2 = _mm512_sub_ps(prod_1_2_x_2_0, prod_1_0_x_2_2);
-      term3 = _mm512_sub_ps(prod_1_0_x_2_1, prod_1_1_x_2_0);
-      term1 = CommsLib::M512ComplexCf32Mult(csi_0_0, term1, false);
-      term2 = CommsLib::M512ComplexCf32Mult(csi_0_1, term2, false);
-      term3 = CommsLib::M512ComplexCf32Mult(csi_0_2, term3, false);
-      __m512 adj_3_3 = _mm512_add_ps(term1, _mm512_add_ps(term2, term3));
-
-      adj_0_0 = CommsLib::M512ComplexCf32Mult(adj_0_0, det, false);
-      adj_0_1 = CommsLib::M512ComplexCf32Mult(adj_0_1, det, false);
-      adj_0_2 = CommsLib::M512ComplexCf32Mult(adj_0_2, det, false);
-      adj_0_3 = CommsLib::M512ComplexCf32Mult(adj_0_3, det, false);
-      adj_1_0 = CommsLib::M512ComplexCf32Mult(adj_1_0, det, false);
-      adj_1_1 = CommsLib::M512ComplexCf32Mult(adj_1_1, det, false);
-      adj_1_2 = CommsLib::M512ComplexCf32Mult(adj_1_2, det, false);
-      adj_1_3 = CommsLib::M512ComplexCf32Mult(adj_1_3, det, false);
-      adj_2_0 = CommsLib::M512ComplexCf32Mult(adj_2_0, det, false);
-      adj_2_1 = CommsLib::M512ComplexCf32Mult(adj_2_1, det, false);
-      adj_2_2 = CommsLib::M512ComplexCf32Mult(adj_2_2, det, false);
-      adj_2_3 = CommsLib::M512ComplexCf32Mult(adj_2_3, det, false);
-      adj_3_0 = CommsLib::M512ComplexCf32Mult(adj_3_0, det, false);
-      adj_3_1 = CommsLib::M512ComplexCf32Mult(adj_3_1, det, false);
-      adj_3_2 = CommsLib::M512ComplexCf32Mult(adj_3_2, det, false);
-      adj_3_3 = CommsLib::M512ComplexCf32Mult(adj_3_3, det, false);
-
-      // store the result
-      _mm512_storeu_ps(ul_beam_0_0 + i, adj_0_0);
-      _mm512_storeu_ps(ul_beam_0_1 + i, adj_0_1);
-      _mm512_storeu_ps(ul_beam_0_2 + i, adj_0_2);
-      _mm512_storeu_ps(ul_beam_0_3 + i, adj_0_3);
-      _mm512_storeu_ps(ul_beam_1_0 + i, adj_1_0);
-      _mm512_storeu_ps(ul_beam_1_1 + i, adj_1_1);
-      _mm512_storeu_ps(ul_beam_1_2 + i, adj_1_2);
-      _mm512_storeu_ps(ul_beam_1_3 + i, adj_1_3);
-      _mm512_storeu_ps(ul_beam_2_0 + i, adj_2_0);
-      _mm512_storeu_ps(ul_beam_2_1 + i, adj_2_1);
-      _mm512_storeu_ps(ul_beam_2_2 + i, adj_2_2);
-      _mm512_storeu_ps(ul_beam_2_3 + i, adj_2_3);
-      _mm512_storeu_ps(ul_beam_3_0 + i, adj_3_0);
-      _mm512_storeu_ps(ul_beam_3_1 + i, adj_3_1);
-      _mm512_storeu_ps(ul_beam_3_2 + i, adj_3_2);
-      _mm512_storeu_ps(ul_beam_3_3 + i, adj_3_3);
+    // A^(-1) = adj(A) / det(A), by the 2x2 minors of the top and bottom rows
+    const complex_float* csi[4] = {
+        csi_buffers_[frame_slot][0], csi_buffers_[frame_slot][1],
+        csi_buffers_[frame_slot][2], csi_buffers_[frame_slot][3]};
+    // check if the channel matrix is invertible,
+    // float lowest > 1e-38, normal range > 1e-8
+    const SmallMimo::Kernels& small_mimo = SmallMimo::Get(
+        cfg_->FastMathPrecision(FastMath::Family::kSmallMimo));
+    if (unlikely(!small_mimo.invert_[SmallMimo::DimIndex(4)](
+            csi, SmallMimo::TileChunks(4, sc_vec_len), ul_beam_mem,
+            sc_vec_len))) {
+      AGORA_LOG_WARN("Channel matrix seems not invertible\n");
     }
 #elif defined(ARMA_VEC_MATOP)
     // Prepare CSI matrix. Read in vectors.
@@ -1279,7 +1088,7 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
     // Handle each subcarrier in the block (base_sc_id : last_sc_id -1)
     for (size_t cur_sc_id = base_sc_id; cur_sc_id < last_sc_id; cur_sc_id++) {
       // Gather CSI matrices of each pilot from partially-transposed CSIs.
-      arma::uvec ue_list = mac_sched_->ScheduledUeList(frame_id, cur_sc_id);
+      const auto& ue_list = mac_sched_->Schedule(frame_id).ue_list_;
       for (size_t selected_ue_idx = 0;
            selected_ue_idx < cfg_->SpatialStreamsNum(); selected_ue_idx++) {
         size_t ue_idx = ue_list.at(selected_ue_idx);
@@ -1698,69 +1507,545 @@ void DoBeamWeights::ComputeBeams(size_t tag) {
   size_t sc_inc = 1;
   size_t start_sc = base_sc_id;
 
-  // When grouping sc, we can skip all sc except sc % PilotScGroupSize == 0
-  if (cfg_->GroupPilotSc()) {
+  // When grouping sc, we can skip all sc except sc % BeamScStride == 0
+  if (cfg_->BeamScStride() > 1) {
     // When grouping sc only process the first sc in each group
-    sc_inc = cfg_->PilotScGroupSize();
-    const size_t rem = start_sc % cfg_->PilotScGroupSize();
+    sc_inc = cfg_->BeamScStride();
+    const size_t rem = start_sc % cfg_->BeamScStride();
     if (rem != 0) {
-      //Start at the next multiple of PilotScGroupSize
-      start_sc += (cfg_->PilotScGroupSize() - rem);
+      //Start at the next multiple of BeamScStride
+      start_sc += (cfg_->BeamScStride() - rem);
     }
   }
 
+  if (cfg_->BeamReuseThreshold() > 0.0f) {
+    const size_t block_id = base_sc_id / cfg_->BeamBlockSize();
+    BeamReuseState& state = beam_reuse_state_.at(block_id);
+    // Skip the reuse bookkeeping if another frame is using this block
+    if (state.busy_.exchange(true, std::memory_order_acquire) == false) {
+      complex_float* ref_csi = beam_ref_csi_buffer_[block_id];
+      if (CanReuseBeams(frame_id, start_sc, last_sc_id, sc_inc, state,
+                        ref_csi)) {
+        const size_t start_tsc = GetTime::WorkerRdtsc();
+        const size_t prev_slot = (frame_id - 1) % cfg_->FrameWindow();
+        const size_t mat_size = cfg_->BsAntNum() * cfg_->SpatialStreamsNum();
+        for (size_t cur_sc_id = start_sc; cur_sc_id < last_sc_id;
+             cur_sc_id = cur_sc_id + sc_inc) {
+          std::memcpy(ul_beam_matrices_[frame_slot][cur_sc_id],
+                      ul_beam_matrices_[prev_slot][cur_sc_id],
+                      mat_size * sizeof(complex_float));
+          if (cfg_->Frame().NumDLSyms() > 0) {
+            std::memcpy(dl_beam_matrices_[frame_slot][cur_sc_id],
+                        dl_beam_matrices_[prev_slot][cur_sc_id],
+                        mat_size * sizeof(complex_float));
+          }
+        }
+        duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+      } else if ((state.predicted_frame_ == frame_id) &&
+                 SameUes(frame_id, state.predicted_ue_list_) &&
+                 CsiMatches(frame_id, start_sc, last_sc_id, sc_inc,
+                            state.predicted_csi_)) {
+        const size_t start_tsc = GetTime::WorkerRdtsc();
+        const size_t mat_size = cfg_->BsAntNum() * cfg_->SpatialStreamsNum();
+        const complex_float* predicted_beams = state.predicted_ul_beams_;
+        for (size_t cur_sc_id = start_sc; cur_sc_id < last_sc_id;
+             cur_sc_id = cur_sc_id + sc_inc) {
+          std::memcpy(ul_beam_matrices_[frame_slot][cur_sc_id],
+                      predicted_beams, mat_size * sizeof(complex_float));
+          predicted_beams += mat_size;
+        }
+        // The beamweights are those of the predicted CSI, which later
+        // frames are compared with to reuse them
+        std::memcpy(ref_csi, state.predicted_csi_,
+                    (predicted_beams - state.predicted_ul_beams_) *
+                        sizeof(complex_float));
+        state.computed_frame_ = frame_id;
+        CopyUes(frame_id, state.computed_ue_list_);
+        prediction_hit_count_++;
+        duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+      } else {
+        ComputeBlockBeams(frame_id, base_sc_id, start_sc, last_sc_id, sc_inc);
+        // No later frame compares with the CSI of rotating groups
+        if (mac_sched_->RotatesGroups() == false) {
+          StoreRefCsi(frame_id, start_sc, last_sc_id, sc_inc, ref_csi);
+        }
+        state.computed_frame_ = frame_id;
+        CopyUes(frame_id, state.computed_ue_list_);
+      }
+      if (ul_beam_int16_ != nullptr) {
+        QuantizeUlBeams(frame_slot, start_sc, last_sc_id, sc_inc);
+      }
+      state.written_frame_ = frame_id;
+      state.busy_.store(false, std::memory_order_release);
+      return;
+    }
+  }
+  ComputeBlockBeams(frame_id, base_sc_id, start_sc, last_sc_id, sc_inc);
+  if (ul_beam_int16_ != nullptr) {
+    QuantizeUlBeams(frame_slot, start_sc, last_sc_id, sc_inc);
+  }
+}
+
+void DoBeamWeights::QuantizeUlBeams(size_t frame_slot, size_t start_sc,
+                                    size_t last_sc, size_t sc_inc) {
+  for (size_t cur_sc_id = start_sc; cur_sc_id < last_sc;
+       cur_sc_id = cur_sc_id + sc_inc) {
+    const auto* ul_beam = reinterpret_cast<const float*>(
+        ul_beam_matrices_[frame_slot][cur_sc_id]);
+    (*ul_beam_scales_)[frame_slot][cur_sc_id] = Int16Equalizer::QuantizeBeam(
+        ul_beam, cfg_->SpatialStreamsNum(), cfg_->BsAntNum(),
+        (*ul_beam_int16_)[frame_slot][cur_sc_id]);
+  }
+}
+
+void DoBeamWeights::ComputeBlockBeams(size_t frame_id, size_t base_sc_id,
+                                      size_t start_sc, size_t last_sc,
+                                      size_t sc_inc) {
+  if (batched_kernel_ != nullptr) {
+    if (cfg_->SmallMimoAcc()) {
+      // The small_mimo_acc demodulation reads the beamweights of every
+      // subcarrier
+      ComputeBatchedBeams(frame_id, base_sc_id, last_sc, 1);
+    } else {
+      ComputeBatchedBeams(frame_id, start_sc, last_sc, sc_inc);
+    }
+    return;
+  }
+
   // Handle each subcarrier in the block (base_sc_id : last_sc_id -1)
-  for (size_t cur_sc_id = start_sc; cur_sc_id < last_sc_id;
+  for (size_t cur_sc_id = start_sc; cur_sc_id < last_sc;
        cur_sc_id = cur_sc_id + sc_inc) {
-    arma::cx_fvec& cal_sc_vec = *calib_sc_vec_ptr_;
-    const size_t start_tsc1 = GetTime::WorkerRdtsc();
+    ComputeScBeams(frame_id, cur_sc_id);
+  }
+}
+
+// CSI of one scheduled UE, antenna and subcarrier as written by dofft
+static inline const complex_float& CsiAt(const complex_float* ue_csi,
+                                         size_t ant_i, size_t sc_id,
+                                         size_t bs_ant_num,
+                                         size_t ofdm_data_num) {
+  return ue_csi[TileLayout::Index(sc_id, ant_i, bs_ant_num, ofdm_data_num)];
+}
+
+bool DoBeamWeights::CanReuseBeams(size_t frame_id, size_t start_sc,
+                                  size_t last_sc, size_t sc_inc,
+                                  const BeamReuseState& state,
+                                  const complex_float* ref_csi) {
+  // The previous frame's beamweights are for other UEs when the groups
+  // rotate every frame
+  if (mac_sched_->RotatesGroups()) {
+    return false;
+  }
+  // The previous frame's beamweights must be complete and not too old
+  if ((frame_id == 0) || (state.written_frame_ != frame_id - 1) ||
+      (frame_id - state.computed_frame_ >= cfg_->BeamReuseMaxFrames())) {
+    return false;
+  }
+  // ComputeCalib updates the calibration moving sums on these frames
+  if ((cfg_->Frame().NumDLSyms() > 0) && cfg_->Frame().IsRecCalEnabled() &&
+      ((frame_id % cfg_->RecipCalFrameCnt()) == 0)) {
+    return false;
+  }
+  // The PF schedule and ue_grouping change the UEs of a frame freely
+  if (SameUes(frame_id, state.computed_ue_list_) == false) {
+    return false;
+  }
 
-    // Gather CSI matrices of each pilot from partially-transposed CSIs.
-    arma::uvec ue_list = mac_sched_->ScheduledUeList(frame_id, cur_sc_id);
+  return CsiMatches(frame_id, start_sc, last_sc, sc_inc, ref_csi);
+}
+
+bool DoBeamWeights::SameUes(size_t frame_id,
+                            const std::array<size_t, kMaxUEs>& ue_list) {
+  const auto& sched_ue_list = mac_sched_->Schedule(frame_id).ue_list_;
+  return std::equal(ue_list.begin(),
+                    ue_list.begin() + cfg_->SpatialStreamsNum(),
+                    sched_ue_list.begin());
+}
+
+void DoBeamWeights::CopyUes(size_t frame_id,
+                            std::array<size_t, kMaxUEs>& ue_list) {
+  std::copy_n(mac_sched_->Schedule(frame_id).ue_list_.begin(),
+              cfg_->SpatialStreamsNum(), ue_list.begin());
+}
+
+bool DoBeamWeights::CsiMatches(size_t frame_id, size_t start_sc,
+                               size_t last_sc, size_t sc_inc,
+                               const complex_float* ref_csi) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  const auto& ue_list = mac_sched_->Schedule(frame_id).ue_list_;
+  float diff_energy = 0;
+  float ref_energy = 0;
+  size_t ref_idx = 0;
+  for (size_t sc_id = start_sc; sc_id < last_sc; sc_id += sc_inc) {
     for (size_t selected_ue_idx = 0;
          selected_ue_idx < cfg_->SpatialStreamsNum(); selected_ue_idx++) {
-      size_t ue_idx = ue_list.at(selected_ue_idx);
+      const complex_float* ue_csi =
+          csi_buffers_[frame_slot][ue_list.at(selected_ue_idx)];
+      for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+        const complex_float& csi =
+            CsiAt(ue_csi, ant_i, sc_id, bs_ant_num, cfg_->OfdmDataNum());
+        const complex_float& ref = ref_csi[ref_idx];
+        const float diff_re = csi.re - ref.re;
+        const float diff_im = csi.im - ref.im;
+        diff_energy += diff_re * diff_re + diff_im * diff_im;
+        ref_energy += ref.re * ref.re + ref.im * ref.im;
+        ref_idx++;
+      }
+    }
+  }
+  const float threshold = cfg_->BeamReuseThreshold();
+  return diff_energy <= threshold * threshold * ref_energy;
+}
+
+bool DoBeamWeights::IdleWork() {
+  if ((cfg_->BeamPredictionFrames() == 0) || (num_ext_ref_ > 0)) {
+    return false;
+  }
+  const size_t block_id = idle_block_;
+  idle_block_ = (idle_block_ + 1) % beam_reuse_state_.size();
+  BeamReuseState& state = beam_reuse_state_.at(block_id);
+  if (state.busy_.exchange(true, std::memory_order_acquire)) {
+    return false;
+  }
+  // The beam task of the next frame has not run yet, and the frames before
+  // it hold complete CSI
+  const size_t frame_id = state.written_frame_ + 1;
+  // The master schedules the frame at its first packet, which may not have
+  // arrived yet
+  bool predict = (state.written_frame_ != SIZE_MAX) &&
+                 (state.predicted_frame_ != frame_id) &&
+                 (frame_id >= cfg_->BeamPredictionFrames()) &&
+                 mac_sched_->Published(frame_id);
+  if (predict) {
+    // Dropped if the row was rewritten while copied
+    CopyUes(frame_id, state.predicted_ue_list_);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    predict = mac_sched_->Published(frame_id);
+  }
+  if (predict) {
+    PredictBeams(frame_id, block_id, state);
+    state.predicted_frame_ = frame_id;
+    predicted_count_++;
+  }
+  state.busy_.store(false, std::memory_order_release);
+  return predict;
+}
+
+void DoBeamWeights::PredictBeams(size_t frame_id, size_t block_id,
+                                 BeamReuseState& state) {
+  const size_t base_sc_id = block_id * cfg_->BeamBlockSize();
+  const size_t last_sc =
+      base_sc_id +
+      std::min(cfg_->BeamBlockSize(), cfg_->OfdmDataNum() - base_sc_id);
+  const size_t sc_inc = cfg_->BeamScStride();
+  const size_t start_sc = ((base_sc_id + sc_inc - 1) / sc_inc) * sc_inc;
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  const size_t num_streams = cfg_->SpatialStreamsNum();
+
+  // Least squares line through the CSI of the last num_frames frames,
+  // evaluated at frame_id: weight of frame (frame_id - num_frames + k)
+  const size_t num_frames = cfg_->BeamPredictionFrames();
+  const float mean_k = (num_frames - 1) / 2.0f;
+  float var_k = 0;
+  for (size_t k = 0; k < num_frames; k++) {
+    var_k += (k - mean_k) * (k - mean_k);
+  }
+  std::array<float, kFrameWnd> weights;
+  for (size_t k = 0; k < num_frames; k++) {
+    weights.at(k) =
+        1.0f / num_frames + (num_frames - mean_k) * (k - mean_k) / var_k;
+  }
+
+  // The slots of the oldest frames may already be refilled by frames ahead
+  // of frame_id, which only makes the prediction miss
+  const auto& ue_list = state.predicted_ue_list_;
+  complex_float* pred_csi = state.predicted_csi_;
+  for (size_t sc_id = start_sc; sc_id < last_sc; sc_id += sc_inc) {
+    for (size_t selected_ue_idx = 0; selected_ue_idx < num_streams;
+         selected_ue_idx++) {
+      for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+        complex_float csi = {0, 0};
+        for (size_t k = 0; k < num_frames; k++) {
+          const size_t slot =
+              (frame_id - num_frames + k) % cfg_->FrameWindow();
+          const complex_float& past =
+              CsiAt(csi_buffers_[slot][ue_list.at(selected_ue_idx)], ant_i,
+                    sc_id, bs_ant_num, cfg_->OfdmDataNum());
+          csi.re += weights.at(k) * past.re;
+          csi.im += weights.at(k) * past.im;
+        }
+        *pred_csi = csi;
+        pred_csi++;
+      }
+    }
+  }
+
+  float noise = 0;
+  if (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kMMSE) {
+    noise = phy_stats_->GetNoise(
+        frame_id - 1,
+        arma::uvec(reinterpret_cast<unsigned long long*>(
+                       state.predicted_ue_list_.data()),
+                   num_streams, false));
+  }
+  const size_t mat_size = bs_ant_num * num_streams;
+  size_t sc_idx = 0;
+  for (size_t sc_id = start_sc; sc_id < last_sc; sc_id += sc_inc) {
+    const arma::cx_fmat mat_csi(
+        reinterpret_cast<arma::cx_float*>(state.predicted_csi_ +
+                                          sc_idx * mat_size),
+        bs_ant_num, num_streams, false);
+    ComputePrecoder(frame_id, sc_id, mat_csi, *calib_sc_vec_ptr_, noise,
+                    state.predicted_ul_beams_ + sc_idx * mat_size, nullptr);
+    sc_idx++;
+  }
+}
+
+void DoBeamWeights::StoreRefCsi(size_t frame_id, size_t start_sc,
+                                size_t last_sc, size_t sc_inc,
+                                complex_float* ref_csi) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  const auto& ue_list = mac_sched_->Schedule(frame_id).ue_list_;
+  size_t ref_idx = 0;
+  for (size_t sc_id = start_sc; sc_id < last_sc; sc_id += sc_inc) {
+    for (size_t selected_ue_idx = 0;
+         selected_ue_idx < cfg_->SpatialStreamsNum(); selected_ue_idx++) {
+      const complex_float* ue_csi =
+          csi_buffers_[frame_slot][ue_list.at(selected_ue_idx)];
+      for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+        ref_csi[ref_idx] =
+            CsiAt(ue_csi, ant_i, sc_id, bs_ant_num, cfg_->OfdmDataNum());
+        ref_idx++;
+      }
+    }
+  }
+}
+
+void DoBeamWeights::ComputeScBeams(size_t frame_id, size_t cur_sc_id) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  arma::cx_fvec& cal_sc_vec = *calib_sc_vec_ptr_;
+  const size_t start_tsc1 = GetTime::WorkerRdtsc();
+
+  // Gather CSI matrices of each pilot from partially-transposed CSIs.
+  arma::uvec ue_list = mac_sched_->ScheduledUeList(frame_id, cur_sc_id);
+  for (size_t selected_ue_idx = 0; selected_ue_idx < cfg_->SpatialStreamsNum();
+       selected_ue_idx++) {
+    size_t ue_idx = ue_list.at(selected_ue_idx);
+    auto* dst_csi_ptr = reinterpret_cast<float*>(
+        csi_gather_buffer_ + cfg_->BsAntNum() * selected_ue_idx);
+    if (kUsePartialTrans) {
+      PartialTransposeGather(
+          cur_sc_id, reinterpret_cast<float*>(csi_buffers_[frame_slot][ue_idx]),
+          dst_csi_ptr, cfg_->BsAntNum());
+    } else {
+      TransposeGather(
+          cur_sc_id, reinterpret_cast<float*>(csi_buffers_[frame_slot][ue_idx]),
+          dst_csi_ptr, cfg_->BsAntNum(), cfg_->OfdmDataNum());
+    }
+  }
+
+  const size_t start_tsc2 = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
+
+  arma::cx_fmat mat_csi((arma::cx_float*)csi_gather_buffer_, cfg_->BsAntNum(),
+                        cfg_->SpatialStreamsNum(), false);
+
+  if (cfg_->Frame().NumDLSyms() > 0) {
+    ComputeCalib(frame_id, cur_sc_id, cal_sc_vec);
+  }
+  if (num_ext_ref_ > 0) {
+    mat_csi.shed_rows(ext_ref_id_);
+  }
+
+  const size_t start_tsc3 = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[2] += start_tsc3 - start_tsc2;
+
+  float noise = 0;
+  if (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kMMSE) {
+    noise = phy_stats_->GetNoise(frame_id, ue_list);
+  }
+  ComputePrecoder(frame_id, cur_sc_id, mat_csi, cal_sc_vec, noise,
+                  ul_beam_matrices_[frame_slot][cur_sc_id],
+                  dl_beam_matrices_[frame_slot][cur_sc_id]);
+
+  duration_stat_->task_duration_[3] += GetTime::WorkerRdtsc() - start_tsc3;
+  duration_stat_->task_count_++;
+  duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc1;
+}
+
+void DoBeamWeights::UpdateUeCorrelation(size_t frame_id) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  // Subcarriers spread over the band, as the channels of two UEs can be
+  // correlated on some subcarriers and not others
+  const size_t sc_step = cfg_->OfdmDataNum() / UeGrouping::kNumSamples;
+  const size_t num_sc = (sc_step == 0) ? 1 : UeGrouping::kNumSamples;
+  for (size_t i = 0; i < num_sc; i++) {
+    const size_t sc_id = i * sc_step;
+    for (size_t ue_idx = 0; ue_idx < cfg_->UeAntNum(); ue_idx++) {
       auto* dst_csi_ptr = reinterpret_cast<float*>(
-          csi_gather_buffer_ + cfg_->BsAntNum() * selected_ue_idx);
+          grouping_csi_buffer_ +
+          (((i * cfg_->UeAntNum()) + ue_idx) * bs_ant_num));
       if (kUsePartialTrans) {
         PartialTransposeGather(
-            cur_sc_id,
-            reinterpret_cast<float*>(csi_buffers_[frame_slot][ue_idx]),
-            dst_csi_ptr, cfg_->BsAntNum());
+            sc_id, reinterpret_cast<float*>(csi_buffers_[frame_slot][ue_idx]),
+            dst_csi_ptr, bs_ant_num);
       } else {
         TransposeGather(
-            cur_sc_id,
-            reinterpret_cast<float*>(csi_buffers_[frame_slot][ue_idx]),
-            dst_csi_ptr, cfg_->BsAntNum(), cfg_->OfdmDataNum());
+            sc_id, reinterpret_cast<float*>(csi_buffers_[frame_slot][ue_idx]),
+            dst_csi_ptr, bs_ant_num, cfg_->OfdmDataNum());
       }
     }
+  }
+  mac_sched_->Grouping()->UpdateCorrelation(grouping_csi_buffer_, bs_ant_num,
+                                            num_sc);
+}
 
-    const size_t start_tsc2 = GetTime::WorkerRdtsc();
-    duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
-
-    arma::cx_fmat mat_csi((arma::cx_float*)csi_gather_buffer_, cfg_->BsAntNum(),
-                          cfg_->SpatialStreamsNum(), false);
+void DoBeamWeights::ComputeBatchedBeams(size_t frame_id, size_t start_sc,
+                                        size_t last_sc, size_t sc_inc) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  const size_t ue_num = cfg_->SpatialStreamsNum();
+  const size_t mat_size = bs_ant_num * ue_num;
+
+  float* csi_re = batch_buffer_;
+  float* csi_im = csi_re + BatchedBeam::kMaxPlaneSize;
+  float* beam_re = csi_im + BatchedBeam::kMaxPlaneSize;
+  float* beam_im = beam_re + BatchedBeam::kMaxPlaneSize;
+  float* calib_re = beam_im + BatchedBeam::kMaxPlaneSize;
+  float* calib_im = calib_re + BatchedBeam::kMaxVecPlaneSize;
+  // The CSI is no longer needed once the uplink detector is computed
+  float* dl_beam_re = csi_re;
+  float* dl_beam_im = csi_im;
+
+  std::array<size_t, BatchedBeam::kBatchScs> sc_ids;
+  for (size_t batch_sc = start_sc; batch_sc < last_sc;
+       batch_sc += sc_inc * BatchedBeam::kBatchScs) {
+    const size_t start_tsc1 = GetTime::WorkerRdtsc();
 
-    if (cfg_->Frame().NumDLSyms() > 0) {
-      ComputeCalib(frame_id, cur_sc_id, cal_sc_vec);
+    size_t num_scs = 0;
+    for (size_t sc_id = batch_sc;
+         (sc_id < last_sc) && (num_scs < BatchedBeam::kBatchScs);
+         sc_id += sc_inc) {
+      sc_ids[num_scs] = sc_id;
+      num_scs++;
     }
-    if (num_ext_ref_ > 0) {
-      mat_csi.shed_rows(ext_ref_id_);
+    // Unused lanes of a partial batch repeat its last subcarrier
+    for (size_t lane = num_scs; lane < BatchedBeam::kBatchScs; lane++) {
+      sc_ids[lane] = sc_ids[num_scs - 1];
     }
 
-    const size_t start_tsc3 = GetTime::WorkerRdtsc();
-    duration_stat_->task_duration_[2] += start_tsc3 - start_tsc2;
+    // Gather the CSI with one lane per subcarrier
+    arma::uvec ue_list = mac_sched_->ScheduledUeList(frame_id, batch_sc);
+    for (size_t selected_ue_idx = 0; selected_ue_idx < ue_num;
+         selected_ue_idx++) {
+      const complex_float* src =
+          csi_buffers_[frame_slot][ue_list.at(selected_ue_idx)];
+      for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+        const size_t dst_offset =
+            (ant_i + bs_ant_num * selected_ue_idx) * BatchedBeam::kBatchScs;
+        for (size_t lane = 0; lane < BatchedBeam::kBatchScs; lane++) {
+          const size_t sc_id = sc_ids[lane];
+          const complex_float& csi =
+              batch_partial_transpose_
+                  ? src[TileLayout::Index(sc_id, ant_i, bs_ant_num,
+                                          cfg_->OfdmDataNum())]
+                  : src[ant_i * cfg_->OfdmDataNum() + sc_id];
+          csi_re[dst_offset + lane] = csi.re;
+          csi_im[dst_offset + lane] = csi.im;
+        }
+      }
+    }
 
     float noise = 0;
     if (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kMMSE) {
       noise = phy_stats_->GetNoise(frame_id, ue_list);
     }
-    ComputePrecoder(frame_id, cur_sc_id, mat_csi, cal_sc_vec, noise,
-                    ul_beam_matrices_[frame_slot][cur_sc_id],
-                    dl_beam_matrices_[frame_slot][cur_sc_id]);
 
-    duration_stat_->task_duration_[3] += GetTime::WorkerRdtsc() - start_tsc3;
-    duration_stat_->task_count_++;
+    const size_t start_tsc2 = GetTime::WorkerRdtsc();
+    duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
+
+    if (batched_kernel_(csi_re, csi_im, noise, beam_re, beam_im) == false) {
+      if (batch_partial_transpose_ && (batch_sc_major_beams_ == false)) {
+        // Ill-conditioned channel in this batch: let the per-subcarrier path
+        // handle it, including the regularized fallback
+        for (size_t lane = 0; lane < num_scs; lane++) {
+          ComputeScBeams(frame_id, sc_ids[lane]);
+        }
+      } else {
+        AGORA_LOG_WARN("Channel matrix seems not invertible\n");
+      }
+      continue;
+    }
+
+    const size_t start_tsc3 = GetTime::WorkerRdtsc();
+    if (batched_dl_kernel_ != nullptr) {
+      // Gathered only after the detector succeeds, since the per-subcarrier
+      // fallback updates the calibration moving sums itself
+      arma::cx_fvec& cal_sc_vec = *calib_sc_vec_ptr_;
+      for (size_t lane = 0; lane < BatchedBeam::kBatchScs; lane++) {
+        // Padding lanes reuse the calibration of the last subcarrier
+        if (lane < num_scs) {
+          ComputeCalib(frame_id, sc_ids[lane], cal_sc_vec);
+        }
+        for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+          calib_re[ant_i * BatchedBeam::kBatchScs + lane] =
+              calib_gather_buffer_[ant_i].re;
+          calib_im[ant_i * BatchedBeam::kBatchScs + lane] =
+              calib_gather_buffer_[ant_i].im;
+        }
+      }
+    }
+    const size_t start_tsc4 = GetTime::WorkerRdtsc();
+    duration_stat_->task_duration_[2] += start_tsc4 - start_tsc3;
+
+    if (batched_dl_kernel_ != nullptr) {
+      batched_dl_kernel_(beam_re, beam_im, calib_re, calib_im, dl_beam_re,
+                         dl_beam_im);
+    }
+
+    if (batch_sc_major_beams_) {
+      complex_float* ul_beam_mem = ul_beam_matrices_[frame_slot][0];
+      for (size_t ue_i = 0; ue_i < ue_num; ue_i++) {
+        for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+          const size_t src_offset =
+              (ue_i + ue_num * ant_i) * BatchedBeam::kBatchScs;
+          complex_float* dst =
+              ul_beam_mem + (ue_i * bs_ant_num + ant_i) * cfg_->OfdmDataNum();
+          for (size_t lane = 0; lane < num_scs; lane++) {
+            dst[sc_ids[lane]].re = beam_re[src_offset + lane];
+            dst[sc_ids[lane]].im = beam_im[src_offset + lane];
+          }
+        }
+      }
+    } else {
+      // Scatter the detectors back to the per-subcarrier (Ue x BsAnt) layout
+      for (size_t lane = 0; lane < num_scs; lane++) {
+        complex_float* ul_beam_mem =
+            ul_beam_matrices_[frame_slot][sc_ids[lane]];
+        for (size_t i = 0; i < mat_size; i++) {
+          ul_beam_mem[i].re = beam_re[i * BatchedBeam::kBatchScs + lane];
+          ul_beam_mem[i].im = beam_im[i * BatchedBeam::kBatchScs + lane];
+        }
+      }
+    }
+    if (batched_dl_kernel_ != nullptr) {
+      // Per-subcarrier (BsAnt x Ue) layout read by doprecode
+      for (size_t lane = 0; lane < num_scs; lane++) {
+        complex_float* dl_beam_mem =
+            dl_beam_matrices_[frame_slot][sc_ids[lane]];
+        for (size_t i = 0; i < mat_size; i++) {
+          dl_beam_mem[i].re = dl_beam_re[i * BatchedBeam::kBatchScs + lane];
+          dl_beam_mem[i].im = dl_beam_im[i * BatchedBeam::kBatchScs + lane];
+        }
+      }
+    }
+
+    duration_stat_->task_duration_[3] +=
+        (start_tsc3 - start_tsc2) + (GetTime::WorkerRdtsc() - start_tsc4);
+    duration_stat_->task_count_ += num_scs;
     duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc1;
   }
 }
@@ -5,9 +5,13 @@
 #ifndef DOBEAMWEIGHTS_H_
 #define DOBEAMWEIGHTS_H_
 
+#include <array>
 #include <memory>
 
+#include "agora_buffer.h"
+#include "amx_gram.h"
 #include "armadillo"
+#include "batched_beam.h"
 #include "common_typedef_sdk.h"
 #include "config.h"
 #include "doer.h"
@@ -17,6 +21,7 @@
 #include "message.h"
 #include "phy_stats.h"
 #include "stats.h"
+#include "task_arena.h"
 
 class DoBeamWeights : public Doer {
  public:
@@ -30,7 +35,9 @@ class DoBeamWeights : public Doer {
       Table<complex_float>& calib_buffer,
       PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_beam_matrices_,
       PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_beam_matrices_,
-      MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* stats_manager);
+      Table<complex_float>& beam_ref_csi_buffer,
+      std::vector<BeamReuseState>& beam_reuse_state, MacScheduler* mac_sched,
+      PhyStats* in_phy_stats, Stats* stats_manager);
   ~DoBeamWeights() override;
 
   /**
@@ -50,6 +57,19 @@ class DoBeamWeights : public Doer {
    */
   EventData Launch(size_t tag) override;
 
+  /// With beam_prediction_frames, predict the CSI and uplink beamweights of
+  /// the next frame of one beam block, from the CSI of the previous frames.
+  /// The blocks are taken in turn, skipping those another worker holds.
+  bool IdleWork() override;
+
+  /// Also store the uplink beamweights as int16 in ul_beam_int16, with the
+  /// scale of each matrix in ul_beam_scales, for the int16 equalizer
+  void EnableInt16Beams(PtrGrid<kFrameWnd, kMaxDataSCs, int16_t>* ul_beam_int16,
+                        Table<float>* ul_beam_scales) {
+    ul_beam_int16_ = ul_beam_int16;
+    ul_beam_scales_ = ul_beam_scales;
+  }
+
  private:
   /// Compute the uplink mMIMO detector matrix and/or the downlink
   /// mMIMO precoder using this CSI matrix and calibration buffer
@@ -57,10 +77,59 @@ class DoBeamWeights : public Doer {
                        const arma::cx_fmat& mat_csi,
                        const arma::cx_fvec& calib_sc_vec, const float noise,
                        complex_float* ul_beam_mem, complex_float* dl_beam_mem);
+  /// Set mat_detector to inv(H' * H + noise * I) * H' for the channel matrix
+  /// H, with a Cholesky solve that never throws. The Gram matrix is computed
+  /// with AMX when enabled and accurate enough for this H, and regularized
+  /// when it is ill-conditioned.
+  void ComputeDetector(const arma::cx_fmat& mat_csi, float noise,
+                       arma::cx_fmat& mat_detector);
+  /// On the frames that complete a calibration window, update the
+  /// calibration moving sums and calib_buffer_ of subcarriers
+  /// (start_sc : last_sc - 1)
+  void UpdateCalib(size_t frame_id, size_t start_sc, size_t last_sc);
+  /// Copy the calibration of one subcarrier from calib_buffer_
   void ComputeCalib(size_t frame_id, size_t sc_id, arma::cx_fvec& calib_sc_vec);
   void ComputeBeams(size_t tag);
+  /// Compute the beamweights of subcarriers (start_sc : sc_inc : last_sc - 1)
+  /// with the batched kernel or one subcarrier at a time
+  void ComputeBlockBeams(size_t frame_id, size_t base_sc_id, size_t start_sc,
+                         size_t last_sc, size_t sc_inc);
+  /// Returns true if the CSI of this beam block is close enough to the CSI
+  /// its beamweights were computed with, for the same UEs, to reuse the
+  /// previous frame's beamweights
+  bool CanReuseBeams(size_t frame_id, size_t start_sc, size_t last_sc,
+                     size_t sc_inc, const BeamReuseState& state,
+                     const complex_float* ref_csi);
+  /// Returns true if the CSI of this beam block is within
+  /// beam_reuse_threshold of ref_csi, gathered as StoreRefCsi does
+  bool CsiMatches(size_t frame_id, size_t start_sc, size_t last_sc,
+                  size_t sc_inc, const complex_float* ref_csi);
+  /// Extrapolate the CSI of the previous beam_prediction_frames frames of
+  /// this beam block to frame_id, and compute the uplink beamweights of the
+  /// predicted CSI, into the prediction buffers of state
+  void PredictBeams(size_t frame_id, size_t block_id, BeamReuseState& state);
+  /// Returns true if ue_list holds the scheduled UEs of frame_id
+  bool SameUes(size_t frame_id, const std::array<size_t, kMaxUEs>& ue_list);
+  /// Copy the scheduled UEs of frame_id to ue_list
+  void CopyUes(size_t frame_id, std::array<size_t, kMaxUEs>& ue_list);
+  /// Gather the CSI of this beam block into ref_csi
+  void StoreRefCsi(size_t frame_id, size_t start_sc, size_t last_sc,
+                   size_t sc_inc, complex_float* ref_csi);
+  /// Gather the CSI of one subcarrier and compute its beamweights
+  void ComputeScBeams(size_t frame_id, size_t cur_sc_id);
+  /// Update the channel correlations of the UE grouping of the scheduler
+  /// from the CSI of all the UEs at a few subcarriers of the frame
+  void UpdateUeCorrelation(size_t frame_id);
+  /// Compute the beamweights of subcarriers (start_sc : sc_inc : last_sc - 1)
+  /// in batches of BatchedBeam::kBatchScs using batched_kernel_
+  void ComputeBatchedBeams(size_t frame_id, size_t start_sc, size_t last_sc,
+                           size_t sc_inc);
+  /// Quantize the uplink beamweights of subcarriers (start_sc : sc_inc :
+  /// last_sc - 1) to ul_beam_int16_
+  void QuantizeUlBeams(size_t frame_slot, size_t start_sc, size_t last_sc,
+                       size_t sc_inc);
 
-  PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers_;
+  FlatGrid<complex_float> csi_buffers_;
   complex_float* pred_csi_buffer_;
 
   //Should be read only (Set by FFT and read by Zf)
@@ -71,17 +140,60 @@ class DoBeamWeights : public Doer {
   Table<complex_float>& calib_dl_msum_buffer_;
   Table<complex_float>& calib_ul_msum_buffer_;
   Table<complex_float>& calib_buffer_;
-  PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_beam_matrices_;
-  PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_beam_matrices_;
+  FlatGrid<complex_float> ul_beam_matrices_;
+  FlatGrid<complex_float> dl_beam_matrices_;
+  // nullptr unless ul_beam_int16 is set
+  PtrGrid<kFrameWnd, kMaxDataSCs, int16_t>* ul_beam_int16_ = nullptr;
+  Table<float>* ul_beam_scales_ = nullptr;
+  // Shared by all doZf objects, used when beam_reuse_threshold is set
+  Table<complex_float>& beam_ref_csi_buffer_;
+  std::vector<BeamReuseState>& beam_reuse_state_;
   DurationStat* duration_stat_;
 
   complex_float* csi_gather_buffer_;  // Intermediate buffer to gather CSI
+  // The CSI of all the UEs at the subcarriers of a correlation update,
+  // nullptr if the scheduler does not group the UEs by their channels
+  complex_float* grouping_csi_buffer_ = nullptr;
   // Intermediate buffer to gather reciprical calibration data vector
   complex_float* calib_gather_buffer_;
   std::unique_ptr<arma::cx_fvec> calib_sc_vec_ptr_;
 
+  // Compile-time specialized kernel for this antenna configuration, nullptr
+  // if the per-subcarrier path must be used
+  BatchedBeam::DetectorKernel batched_kernel_;
+  // Downlink precoder kernel, set when the frame has downlink symbols
+  BatchedBeam::DownlinkKernel batched_dl_kernel_;
+  // CSI layout read by the batched kernel: partially transposed, or
+  // [ant * OfdmDataNum + sc] as written by dofft for small_mimo_acc
+  bool batch_partial_transpose_;
+  // Beamweight layout written by the batched kernel: per subcarrier, or
+  // [(ue * BsAnt + ant) * OfdmDataNum + sc] as read by the small_mimo_acc
+  // demodulation paths
+  bool batch_sc_major_beams_;
+  // Real and imaginary planes of the batched CSI, beamweight matrices and
+  // calibration vectors
+  float* batch_buffer_;
+
+  // Compute the detector Gram matrices with AmxGram (amx_beams)
+  bool amx_gram_;
+  // Detector inverses based on an AMX Gram matrix, and those of them that
+  // exceeded amx_beam_tolerance and were recomputed in float
+  size_t amx_gram_count_ = 0;
+  size_t amx_fallback_count_ = 0;
+  // Detectors solved with a regularized Gram matrix
+  size_t regularized_count_ = 0;
+  // Reciprocal condition estimate of the last Gram matrix, -1 if none
+  float gram_rcond_ = -1.0f;
+  // Next beam block IdleWork() tries to predict
+  size_t idle_block_ = 0;
+  // Beam blocks predicted, and the predictions that the measured CSI matched
+  size_t predicted_count_ = 0;
+  size_t prediction_hit_count_ = 0;
+
   MacScheduler* mac_sched_;
   PhyStats* phy_stats_;
+  // Armadillo temporaries of a subcarrier's precoder
+  TaskArena arena_;
   arma::uvec ext_ref_id_;
   size_t num_ext_ref_;
 };
@@ -16,6 +16,7 @@ DoBroadcast::DoBroadcast(Config* in_config, int in_tid,
     : Doer(in_config, in_tid), dl_socket_buffer_(in_dl_socket_buffer) {
   duration_stat_ =
       in_stats_manager->GetDurationStat(DoerType::kBroadcast, in_tid);
+  alloc_stat_ = duration_stat_;
 }
 
 DoBroadcast::~DoBroadcast() = default;
@@ -5,8 +5,13 @@
  */
 #include "dodecode.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "concurrent_queue_wrapper.h"
-#include "phy_ldpc_decoder_5gnr.h"
+#include "packed_llr.h"
+#include "streaming_store.h"
 
 static constexpr bool kPrintLLRData = false;
 static constexpr bool kPrintDecodedData = false;
@@ -17,33 +22,174 @@ DoDecode::DoDecode(
     Config* in_config, int in_tid,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
-    MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* in_stats_manager)
+    MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* in_stats_manager,
+    HarqBuffer* harq_buffer)
     : Doer(in_config, in_tid),
-      demod_buffers_(demod_buffers),
-      decoded_buffers_(decoded_buffers),
+      demod_buffers_(demod_buffers.Flat()),
+      decoded_buffers_(decoded_buffers.Flat()),
       mac_sched_(mac_sched),
       phy_stats_(in_phy_stats),
+      stats_(in_stats_manager),
+      harq_buffer_(harq_buffer),
       scrambler_(std::make_unique<AgoraScrambler::Scrambler>()) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kDecode, in_tid);
+  alloc_stat_ = duration_stat_;
   resp_var_nodes_ = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64, kVarNodesSize));
+      Agora_memory::Alignment_t::kAlign64, kVarNodesSize, scratch_policy_));
+  if (cfg_->DemodLlrBits() != 8) {
+    // A code block is within the LLRs of a symbol of a stream
+    llr_unpacked_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        Roundup<64>(kMaxModType * cfg_->OfdmDataNum()), scratch_policy_));
+  }
+  if (cfg_->NtStores("decode")) {
+    // Any code block of any MCS fits in its stride of decoded_buffers_
+    decoded_staging_ = static_cast<uint8_t*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        Roundup<64>(cfg_->UlDecodedCbStride()), scratch_policy_));
+  }
 }
 
-DoDecode::~DoDecode() { std::free(resp_var_nodes_); }
+DoDecode::~DoDecode() {
+  Agora_memory::PaddedAlignedFree(resp_var_nodes_);
+  Agora_memory::PaddedAlignedFree(llr_unpacked_);
+  Agora_memory::PaddedAlignedFree(decoded_staging_);
+}
+
+int16_t DoDecode::DecoderIterations(const LDPCconfig& ldpc_config,
+                                    size_t frame_id, size_t ue_id) const {
+  const int16_t max_iter = ldpc_config.MaxDecoderIter();
+  if (cfg_->AdaptiveDecodeIter() == false) {
+    return max_iter;
+  }
+  const auto min_iter = static_cast<int16_t>(std::min(
+      cfg_->MinDecoderIter(), static_cast<size_t>(max_iter)));
+  // A late frame gets the smallest budget, to catch up with the next ones
+  if ((cfg_->DecodeOverloadUs() > 0) &&
+      (stats_->MasterGetUsSince(TsType::kFirstSymbolRX, frame_id) >
+       cfg_->DecodeOverloadUs())) {
+    return min_iter;
+  }
+  const float snr = phy_stats_->LatestSnr(ue_id);
+  const float snr_low = cfg_->DecodeIterSnrLowDb();
+  const float snr_high = cfg_->DecodeIterSnrHighDb();
+  // No SNR yet (NaN) takes the full budget
+  if ((std::isnan(snr) == true) || (snr <= snr_low)) {
+    return max_iter;
+  }
+  if (snr >= snr_high) {
+    return min_iter;
+  }
+  const float fraction = (snr - snr_low) / (snr_high - snr_low);
+  return static_cast<int16_t>(
+      max_iter -
+      std::lround(fraction * static_cast<float>(max_iter - min_iter)));
+}
+
+EventData DoDecode::Launch(size_t tag) { return LaunchBatch(&tag, 1); }
+
+EventData DoDecode::LaunchBatch(const size_t* tags, size_t num_tags) {
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  SymbolSetup setup{};
+  setup.frame_id_ = gen_tag_t(tags[0]).frame_id_;
+  setup.symbol_id_ = gen_tag_t(tags[0]).symbol_id_;
+  // The coding parameters of the frame's MCS, precomputed by Config
+  setup.mcs_index_ = mac_sched_->Schedule(setup.frame_id_).phy_ul_mcs_;
+  setup.mcs_ = &cfg_->Mcs(Direction::kUplink, setup.mcs_index_);
+  const LDPCconfig& ldpc_config = setup.mcs_->ldpc_config_;
+  setup.symbol_idx_ul_ = cfg_->Frame().GetULSymbolIdx(setup.symbol_id_);
+  setup.symbol_offset_ =
+      cfg_->GetTotalDataSymbolIdxUl(setup.frame_id_, setup.symbol_idx_ul_);
+  setup.frame_slot_ = (setup.frame_id_ % cfg_->FrameWindow());
+
+  // Decoder setup
+  int16_t num_filler_bits = 0;
+  int16_t num_channel_llrs = ldpc_config.NumCbCodewLen();
+
+  setup.request_.numChannelLlrs = num_channel_llrs;
+  setup.request_.numFillerBits = num_filler_bits;
+  // A reduced budget only pays off if the decoder stops once the parity
+  // checks pass. HARQ needs the parity check result, and the blind link
+  // quality the iterations actually run.
+  setup.request_.enableEarlyTermination =
+      ldpc_config.EarlyTermination() || cfg_->AdaptiveDecodeIter() ||
+      cfg_->BlindLinkQuality() || (harq_buffer_ != nullptr);
+  setup.request_.Zc = ldpc_config.ExpansionFactor();
+  setup.request_.baseGraph = ldpc_config.BaseGraph();
+  setup.request_.nRows = ldpc_config.NumRows();
 
-EventData DoDecode::Launch(size_t tag) {
-  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
+  int num_msg_bits = ldpc_config.NumCbLen() - num_filler_bits;
+  setup.response_.numMsgBits = num_msg_bits;
+  setup.response_.varNodes = resp_var_nodes_;
+
+  EventData resp_event;
+  resp_event.event_type_ = EventType::kDecode;
+  resp_event.num_tags_ = num_tags;
+  for (size_t i = 0; i < num_tags; i++) {
+    DecodeBlock(tags[i], setup, (i == 0) ? start_tsc : GetTime::WorkerRdtsc());
+    resp_event.tags_.at(i) = tags[i];
+  }
+  if (decoded_staging_ != nullptr) {
+    StreamingStore::Fence();
+  }
+  return resp_event;
+}
+
+void DoDecode::PrefetchTask(size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
-  const size_t symbol_id = gen_tag_t(tag).symbol_id_;
-  const size_t symbol_idx_ul = cfg_->Frame().GetULSymbolIdx(symbol_id);
+  const size_t symbol_idx_ul =
+      cfg_->Frame().GetULSymbolIdx(gen_tag_t(tag).symbol_id_);
   const size_t cb_id = gen_tag_t(tag).cb_id_;
-  const size_t symbol_offset =
-      cfg_->GetTotalDataSymbolIdxUl(frame_id, symbol_idx_ul);
+  const ScheduleSnapshot& schedule = mac_sched_->Schedule(frame_id);
+  const McsParams& mcs = cfg_->Mcs(Direction::kUplink, schedule.phy_ul_mcs_);
+  const LDPCconfig& ldpc_config = mcs.ldpc_config_;
   const size_t cur_cb_id = (cb_id % ldpc_config.NumBlocksInSymbol());
   const size_t sched_ue_id = (cb_id / ldpc_config.NumBlocksInSymbol());
-  const size_t ue_id = mac_sched_->ScheduledUeIndex(frame_id, 0, sched_ue_id);
-  const size_t frame_slot = (frame_id % kFrameWnd);
-  const size_t num_bytes_per_cb = cfg_->NumBytesPerCb(Direction::kUplink);
+  const size_t ue_id = schedule.ue_list_[sched_ue_id];
+  // DecodeBlock() reads no LLRs past the grant of the UE
+  if (cur_cb_id >= schedule.ul_num_cbs_[ue_id]) {
+    return;
+  }
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t llr_offset =
+      mcs.mod_order_bits_ * (ldpc_config.NumCbCodewLen() * cur_cb_id);
+  const size_t num_llrs = ldpc_config.NumCbCodewLen();
+  const auto* llrs = reinterpret_cast<const uint8_t*>(
+      demod_buffers_[frame_slot][symbol_idx_ul][sched_ue_id]);
+  if (llr_unpacked_ == nullptr) {
+    PrefetchRange(llrs + llr_offset, num_llrs, false);
+  } else {
+    // The chunks that hold the LLRs of the code block
+    const size_t llr_bits = cfg_->DemodLlrBits();
+    PrefetchRange(llrs + ((llr_offset / kPackedLlrChunk) *
+                          PackedLlrChunkBytes(llr_bits)),
+                  PackedLlrBytes(num_llrs + kPackedLlrChunk, llr_bits), false);
+  }
+  // Streamed bytes do not go through the cache
+  if (decoded_staging_ == nullptr) {
+    PrefetchRange(decoded_buffers_[frame_slot][symbol_idx_ul][ue_id] +
+                      (cur_cb_id * cfg_->UlDecodedCbStride()),
+                  mcs.num_bytes_per_cb_, true);
+  }
+}
+
+void DoDecode::DecodeBlock(size_t tag, SymbolSetup& setup, size_t start_tsc) {
+  const size_t frame_id = setup.frame_id_;
+  const McsParams& mcs = *setup.mcs_;
+  const LDPCconfig& ldpc_config = mcs.ldpc_config_;
+  const size_t symbol_id = setup.symbol_id_;
+  const size_t symbol_idx_ul = setup.symbol_idx_ul_;
+  RtAssert((gen_tag_t(tag).frame_id_ == frame_id) &&
+               (gen_tag_t(tag).symbol_id_ == symbol_id),
+           "DoDecode: the code blocks of a batch are of different symbols");
+  const size_t cb_id = gen_tag_t(tag).cb_id_;
+  const size_t symbol_offset = setup.symbol_offset_;
+  const size_t cur_cb_id = (cb_id % ldpc_config.NumBlocksInSymbol());
+  const size_t sched_ue_id = (cb_id / ldpc_config.NumBlocksInSymbol());
+  const ScheduleSnapshot& schedule = mac_sched_->Schedule(frame_id);
+  const size_t ue_id = schedule.ue_list_[sched_ue_id];
+  const size_t frame_slot = setup.frame_slot_;
+  const size_t num_bytes_per_cb = mcs.num_bytes_per_cb_;
   if (kDebugPrintInTask == true) {
     std::printf(
         "In doDecode thread %d: frame: %zu, symbol: %zu, code block: "
@@ -51,48 +197,63 @@ EventData DoDecode::Launch(size_t tag) {
         tid_, frame_id, symbol_id, cur_cb_id, ue_id, symbol_offset);
   }
 
-  size_t start_tsc = GetTime::WorkerRdtsc();
-
-  struct bblib_ldpc_decoder_5gnr_request ldpc_decoder_5gnr_request {};
-  struct bblib_ldpc_decoder_5gnr_response ldpc_decoder_5gnr_response {};
+  setup.request_.maxIterations =
+      DecoderIterations(ldpc_config, frame_id, ue_id);
 
-  // Decoder setup
-  int16_t num_filler_bits = 0;
-  int16_t num_channel_llrs = ldpc_config.NumCbCodewLen();
-
-  ldpc_decoder_5gnr_request.numChannelLlrs = num_channel_llrs;
-  ldpc_decoder_5gnr_request.numFillerBits = num_filler_bits;
-  ldpc_decoder_5gnr_request.maxIterations = ldpc_config.MaxDecoderIter();
-  ldpc_decoder_5gnr_request.enableEarlyTermination =
-      ldpc_config.EarlyTermination();
-  ldpc_decoder_5gnr_request.Zc = ldpc_config.ExpansionFactor();
-  ldpc_decoder_5gnr_request.baseGraph = ldpc_config.BaseGraph();
-  ldpc_decoder_5gnr_request.nRows = ldpc_config.NumRows();
+  uint8_t* decoded_buffer_ptr =
+      (uint8_t*)decoded_buffers_[frame_slot][symbol_idx_ul][ue_id] +
+      (cur_cb_id * cfg_->UlDecodedCbStride());
 
-  int num_msg_bits = ldpc_config.NumCbLen() - num_filler_bits;
-  ldpc_decoder_5gnr_response.numMsgBits = num_msg_bits;
-  ldpc_decoder_5gnr_response.varNodes = resp_var_nodes_;
+  // Past the UE's grant, demul left no LLRs and the MAC gets no data
+  if (cur_cb_id >= schedule.ul_num_cbs_[ue_id]) {
+    std::memset(decoded_buffer_ptr, 0, num_bytes_per_cb);
+    return;
+  }
 
+  const size_t llr_offset =
+      mcs.mod_order_bits_ * (ldpc_config.NumCbCodewLen() * cur_cb_id);
   int8_t* llr_buffer_ptr =
-      demod_buffers_[frame_slot][symbol_idx_ul][sched_ue_id] +
-      (cfg_->ModOrderBits(Direction::kUplink) *
-       (ldpc_config.NumCbCodewLen() * cur_cb_id));
+      demod_buffers_[frame_slot][symbol_idx_ul][sched_ue_id] + llr_offset;
+  if (llr_unpacked_ != nullptr) {
+    UnpackLlrs(reinterpret_cast<const uint8_t*>(
+                   demod_buffers_[frame_slot][symbol_idx_ul][sched_ue_id]),
+               llr_offset, ldpc_config.NumCbCodewLen(), cfg_->DemodLlrBits(),
+               llr_unpacked_);
+    llr_buffer_ptr = llr_unpacked_;
+  }
 
-  uint8_t* decoded_buffer_ptr =
-      (uint8_t*)decoded_buffers_[frame_slot][symbol_idx_ul][ue_id] +
-      (cur_cb_id * Roundup<64>(num_bytes_per_cb));
+  const size_t harq_cb_index =
+      (symbol_idx_ul * ldpc_config.NumBlocksInSymbol()) + cur_cb_id;
+  if (harq_buffer_ != nullptr) {
+    harq_buffer_->Combine(ue_id, frame_id, harq_cb_index, llr_buffer_ptr);
+  }
 
-  ldpc_decoder_5gnr_request.varNodes = llr_buffer_ptr;
-  ldpc_decoder_5gnr_response.compactedMessageBytes = decoded_buffer_ptr;
+  // With nt_stores, the code block is decoded, descrambled and checked in
+  // the staging buffer, then streamed to decoded_buffers_
+  uint8_t* decoded_out = (decoded_staging_ != nullptr) ? decoded_staging_
+                                                       : decoded_buffer_ptr;
+  setup.request_.varNodes = llr_buffer_ptr;
+  setup.response_.compactedMessageBytes = decoded_out;
 
   size_t start_tsc1 = GetTime::WorkerRdtsc();
   duration_stat_->task_duration_[1] += start_tsc1 - start_tsc;
 
-  bblib_ldpc_decoder_5gnr(&ldpc_decoder_5gnr_request,
-                          &ldpc_decoder_5gnr_response);
+  bblib_ldpc_decoder_5gnr(&setup.request_, &setup.response_);
+  if (harq_buffer_ != nullptr) {
+    harq_buffer_->Update(ue_id, frame_id, harq_cb_index, llr_buffer_ptr,
+                         setup.response_.parityPassedAtTermination != 0);
+  }
+  if (cfg_->AdaptiveDecodeIter() || cfg_->BlindLinkQuality()) {
+    phy_stats_->RecordDecodeIterations(
+        ue_id, static_cast<size_t>(setup.response_.iterationAtTermination));
+  }
 
   if (cfg_->ScrambleEnabled()) {
-    scrambler_->Descramble(decoded_buffer_ptr, num_bytes_per_cb);
+    scrambler_->Descramble(decoded_out, num_bytes_per_cb);
+  }
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kDecoded, frame_id)) {
+    taps_->Publish(TapPoint::kDecoded, frame_id, symbol_id, ue_id, cur_cb_id,
+                   decoded_out, num_bytes_per_cb);
   }
 
   size_t start_tsc2 = GetTime::WorkerRdtsc();
@@ -109,32 +270,32 @@ EventData DoDecode::Launch(size_t tag) {
   if (kPrintDecodedData) {
     std::printf("Decoded data\n");
     for (size_t i = 0; i < (ldpc_config.NumCbLen() >> 3); i++) {
-      std::printf("%u ", *(decoded_buffer_ptr + i));
+      std::printf("%u ", *(decoded_out + i));
     }
     std::printf("\n");
   }
 
+  // The generated uplink bits are those of the configured MCS
   if ((kEnableMac == false) && (kPrintPhyStats == true) &&
-      (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols())) {
+      (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols()) &&
+      (setup.mcs_index_ == cfg_->McsIndex(Direction::kUplink))) {
     phy_stats_->UpdateDecodedBits(ue_id, symbol_offset, frame_slot,
                                   num_bytes_per_cb * 8);
     phy_stats_->IncrementDecodedBlocks(ue_id, symbol_offset, frame_slot);
-    size_t block_error(0);
-    for (size_t i = 0; i < num_bytes_per_cb; i++) {
-      uint8_t rx_byte = decoded_buffer_ptr[i];
-      auto tx_byte = static_cast<uint8_t>(
-          cfg_->GetInfoBits(cfg_->UlBits(), Direction::kUplink, symbol_idx_ul,
-                            ue_id, cur_cb_id)[i]);
-      phy_stats_->UpdateBitErrors(ue_id, symbol_offset, frame_slot, tx_byte,
-                                  rx_byte);
-      if (rx_byte != tx_byte) {
-        block_error++;
-      }
-    }
+    const size_t block_error = phy_stats_->UpdateBitErrors(
+        ue_id, symbol_offset, frame_slot,
+        reinterpret_cast<const uint8_t*>(
+            cfg_->GetInfoBits(cfg_->UlBits(numa_node_), Direction::kUplink,
+                              symbol_idx_ul, ue_id, cur_cb_id)),
+        decoded_out, num_bytes_per_cb);
     phy_stats_->UpdateBlockErrors(ue_id, symbol_offset, frame_slot,
                                   block_error);
   }
 
+  if (decoded_staging_ != nullptr) {
+    StreamingStore::Copy(decoded_buffer_ptr, decoded_out, num_bytes_per_cb);
+  }
+
   size_t duration = GetTime::WorkerRdtsc() - start_tsc;
   duration_stat_->task_duration_[0] += duration;
   duration_stat_->task_count_++;
@@ -142,6 +303,4 @@ EventData DoDecode::Launch(size_t tag) {
     std::printf("Thread %d Decode takes %.2f\n", tid_,
                 GetTime::CyclesToUs(duration, cfg_->FreqGhz()));
   }
-
-  return EventData(EventType::kDecode, tag);
 }
@@ -11,9 +11,11 @@
 
 #include "config.h"
 #include "doer.h"
+#include "harq_buffer.h"
 #include "mac_scheduler.h"
 #include "memory_manage.h"
 #include "message.h"
+#include "phy_ldpc_decoder_5gnr.h"
 #include "phy_stats.h"
 #include "scrambler.h"
 #include "stats.h"
@@ -24,17 +26,52 @@ class DoDecode : public Doer {
            PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
            PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
            MacScheduler* mac_sched, PhyStats* in_phy_stats,
-           Stats* in_stats_manager);
+           Stats* in_stats_manager, HarqBuffer* harq_buffer);
   ~DoDecode() override;
 
   EventData Launch(size_t tag) override;
+  EventData LaunchBatch(const size_t* tags, size_t num_tags) override;
+  /// Prefetch the LLRs of the code block of tag
+  void PrefetchTask(size_t tag) override;
 
  private:
+  // The schedule, coding parameters and decoder request shared by the code
+  // blocks of one symbol
+  struct SymbolSetup {
+    size_t frame_id_;
+    size_t symbol_id_;
+    size_t symbol_idx_ul_;
+    size_t symbol_offset_;
+    size_t frame_slot_;
+    size_t mcs_index_;
+    const McsParams* mcs_;
+    bblib_ldpc_decoder_5gnr_request request_;
+    bblib_ldpc_decoder_5gnr_response response_;
+  };
+
+  // Decode one code block of the symbol of setup. start_tsc is when its
+  // task started, the setup of the symbol included for the first block.
+  void DecodeBlock(size_t tag, SymbolSetup& setup, size_t start_tsc);
+
+  // Maximum decoder iterations for a code block of a UE, from
+  // Config::AdaptiveDecodeIter()
+  int16_t DecoderIterations(const LDPCconfig& ldpc_config, size_t frame_id,
+                            size_t ue_id) const;
+
   int16_t* resp_var_nodes_;
-  PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers_;
-  PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers_;
+  // The int8 LLRs of a code block, unpacked from demod_buffers_. nullptr
+  // unless Config::DemodLlrBits() packs them.
+  int8_t* llr_unpacked_ = nullptr;
+  // A decoded code block, streamed to decoded_buffers_ once checked. nullptr
+  // unless Config::NtStores() holds decode.
+  uint8_t* decoded_staging_ = nullptr;
+  FlatCube<int8_t> demod_buffers_;
+  FlatCube<int8_t> decoded_buffers_;
   MacScheduler* mac_sched_;
   PhyStats* phy_stats_;
+  Stats* stats_;
+  // Soft buffers of the failed code blocks, nullptr if HARQ is off
+  HarqBuffer* harq_buffer_;
   DurationStat* duration_stat_;
   std::unique_ptr<AgoraScrambler::Scrambler> scrambler_;
 };
@@ -9,12 +9,12 @@
 #include "rte_bbdev.h"
 #include "rte_bbdev_op.h"
 #include "rte_bus_vdev.h"
+#include "rte_dev.h"
+#include "rte_memory.h"
 
 #define GET_SOCKET(socket_id) (((socket_id) == SOCKET_ID_ANY) ? 0 : (socket_id))
 #define MAX_RX_BYTE_SIZE 1500
 #define CACHE_SIZE 128
-#define NUM_QUEUES 4
-#define LCORE_ID 36
 #define NUM_ELEMENTS_IN_POOL 2047
 #define NUM_ELEMENTS_IN_MEMPOOL 16383
 #define DATA_ROOM_SIZE 45488
@@ -25,46 +25,12 @@ static constexpr bool kPrintTxByte = false;
 static constexpr bool kPrintMbufData = false;
 static constexpr bool kMubfLLRCheck = false;
 
-static void
-ldpc_input_llr_scaling(struct rte_bbdev_op_data *input_ops,  const int8_t llr_size,
-		const int8_t llr_decimals)
-{
-	if (input_ops == NULL)
-		return;
-
-	uint16_t i = 0, byte_idx;
-	int16_t llr_max, llr_min, llr_tmp;
-  // std::cout << "in ldpc_input_llr_scaling input_ops is not null !!!!!!!!!\n";
-	llr_max = (1 << (llr_size - 1)) - 1;
-	llr_min = -llr_max;
-		struct rte_mbuf *m = input_ops[i].data;
-		while (m != NULL) {
-			int8_t *llr = rte_pktmbuf_mtod_offset(m, int8_t *,
-					input_ops[i].offset);
-			for (byte_idx = 0; byte_idx < rte_pktmbuf_data_len(m);
-					++byte_idx) {
-
-				llr_tmp = llr[byte_idx];
-				if (llr_decimals == 4)
-					llr_tmp *= 8;
-				else if (llr_decimals == 2)
-					llr_tmp *= 2;
-				else if (llr_decimals == 0)
-					llr_tmp /= 2;
-				llr_tmp = RTE_MIN(llr_max,
-						RTE_MAX(llr_min, llr_tmp));
-				llr[byte_idx] = (int8_t) llr_tmp;
-			}
-
-			m = m->next;
-		}
-}
-
 static constexpr size_t kVarNodesSize = 1024 * 1024 * sizeof(int16_t);
+// Ops over which the op latency is averaged
+static constexpr double kOpLatencyAvgOps = 16.0;
 
-static unsigned int optimal_mempool_size(unsigned int val) {
-  return rte_align32pow2(val + 1) - 1;
-}
+// The external buffers of the code block mbufs are owned by AgoraBuffer
+static void NoOpExtBufFree(void * /*addr*/, void * /*opaque*/) {}
 
 void print_uint32(const uint32_t* array, size_t totalByteLength) {
   size_t totalWordLength = (totalByteLength + 3) / 4;
@@ -88,75 +54,44 @@ DoDecode_ACC::DoDecode_ACC(
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t> &demod_buffers,
     // PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, uint32_t> &llr_buffers,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t> &decoded_buffers,
-    PhyStats *in_phy_stats, Stats *in_stats_manager)
+    PhyStats *in_phy_stats, Stats *in_stats_manager, MessageInfo *message,
+    HarqBuffer *harq_buffer)
     : Doer(in_config, in_tid),
       demod_buffers_(demod_buffers),
       // llr_buffers_(llr_buffers),
       decoded_buffers_(decoded_buffers),
       phy_stats_(in_phy_stats),
-      scrambler_(std::make_unique<AgoraScrambler::Scrambler>()) {
+      stats_(in_stats_manager),
+      scrambler_(std::make_unique<AgoraScrambler::Scrambler>()),
+      harq_buffer_(harq_buffer),
+      message_(message) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kDecode, in_tid);
+  alloc_stat_ = duration_stat_;
   resp_var_nodes_ = static_cast<int16_t *>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64, kVarNodesSize));
-  std::string core_list = std::to_string(LCORE_ID);  // this is hard set to core 36
+      Agora_memory::Alignment_t::kAlign64, kVarNodesSize, scratch_policy_));
   const size_t num_ul_syms = cfg_->Frame().NumULSyms(); 
   const size_t num_ue = cfg_->UeAntNum();
 
-  const char *rte_argv[] = {"txrx",        "-l",           core_list.c_str(),
-                            "--log-level", "lib.eal:info", nullptr};
-  int rte_argc = static_cast<int>(sizeof(rte_argv) / sizeof(rte_argv[0])) - 1;
-
-  // Initialize DPDK environment
-  int ret = rte_eal_init(rte_argc, const_cast<char **>(rte_argv));
-  RtAssert(
-      ret >= 0,
-      "Failed to initialize DPDK.  Are you running with root permissions?");
-
-  int nb_bbdevs = rte_bbdev_count();
-  std::cout << "num bbdevs: " << nb_bbdevs << std::endl;
-
-  if (nb_bbdevs == 0) rte_exit(EXIT_FAILURE, "No bbdevs detected!\n");
-  dev_id = 0;
+  // The EAL and the device are shared, each decoder owns the bbdev decode
+  // queue of its worker thread
+  Bbdev::Setup(cfg_);
+  dev_id = cfg_->BbdevDevId();
+  queue_ = Bbdev::DecodeQueue(dev_id, tid_);
   struct rte_bbdev_info info;
-  // rte_bbdev_info_get(dev_id, &info);
-  rte_bbdev_intr_enable(dev_id);
   rte_bbdev_info_get(dev_id, &info);
 
-  bbdev_op_pool =
-      rte_bbdev_op_pool_create("bbdev_op_pool_dec", RTE_BBDEV_OP_LDPC_DEC,
-                               NB_MBUF, CACHE_SIZE , rte_socket_id());
-  ret = rte_bbdev_setup_queues(dev_id, NUM_QUEUES, info.socket_id);
-
-  if (ret < 0) {
-    printf("rte_bbdev_setup_queues(%u, %u, %d) ret %i\n", dev_id, NUM_QUEUES,
-           rte_socket_id(), ret);
-  }
-
-  ret = rte_bbdev_intr_enable(dev_id);
-
-  struct rte_bbdev_queue_conf qconf;
-  qconf.socket = info.socket_id;
-  qconf.queue_size = info.drv.queue_size_lim;
-  qconf.op_type = RTE_BBDEV_OP_LDPC_DEC;
-  qconf.priority = 0;
-
-  std::cout << "device id is: " << static_cast<int>(dev_id) << std::endl;
-
-  for (int q_id = 0; q_id < NUM_QUEUES; q_id++) {
-    /* Configure all queues belonging to this bbdev device */
-    ret = rte_bbdev_queue_configure(dev_id, q_id, &qconf);
-    if (ret < 0)
-      rte_exit(EXIT_FAILURE,
-               "ERROR(%d): BBDEV %u queue %u not configured properly\n", ret,
-               dev_id, q_id);
-  }
-
-  ret = rte_bbdev_start(dev_id);
+  // Pool names must be unique in the process
+  const std::string pool_suffix =
+      "_" + std::to_string(dev_id) + "_" + std::to_string(tid_);
+  int ret;
+  bbdev_op_pool = rte_bbdev_op_pool_create(
+      ("bbdev_op_pool_dec" + pool_suffix).c_str(), RTE_BBDEV_OP_LDPC_DEC,
+      NB_MBUF, CACHE_SIZE, rte_socket_id());
   int socket_id = GET_SOCKET(info.socket_id);
 
-  ops_mp = rte_bbdev_op_pool_create("RTE_BBDEV_OP_LDPC_DEC_poo",
-                                    RTE_BBDEV_OP_LDPC_DEC, NUM_ELEMENTS_IN_POOL, OPS_CACHE_SIZE,
-                                    socket_id);
+  ops_mp = rte_bbdev_op_pool_create(
+      ("ldpc_dec_op_pool" + pool_suffix).c_str(), RTE_BBDEV_OP_LDPC_DEC,
+      NUM_ELEMENTS_IN_POOL, OPS_CACHE_SIZE, socket_id);
   if (ops_mp == nullptr) {
     std::cerr << "Error: Failed to create memory pool for bbdev operations."
               << std::endl;
@@ -165,33 +100,17 @@ DoDecode_ACC::DoDecode_ACC(
               << std::endl;
   }
 
-  in_mbuf_pool = rte_pktmbuf_pool_create("in_pool_0", NUM_ELEMENTS_IN_MEMPOOL, 0, 0, DATA_ROOM_SIZE, 0);
-  out_mbuf_pool =
-      rte_pktmbuf_pool_create("hard_out_pool_0", NUM_ELEMENTS_IN_MEMPOOL, 0, 0, DATA_ROOM_SIZE, 0);
-
-  if (in_mbuf_pool == nullptr or out_mbuf_pool == nullptr) {
-    std::cerr << "Error: Unable to create mbuf pool: "
-              << rte_strerror(rte_errno) << std::endl;
-  }
+  // The mbufs only carry external buffers, so they need no data room. There
+  // is one input and one hard output mbuf per code block and frame slot, from
+  // the pool the worker shares with its encoder.
+  in_mbuf_pool = Bbdev::WorkerMbufPool(dev_id, tid_);
+  out_mbuf_pool = in_mbuf_pool;
 
   int rte_alloc_ref = rte_bbdev_dec_op_alloc_bulk(ops_mp, ref_dec_op, num_ul_syms * num_ue);
   if (rte_alloc_ref != TEST_SUCCESS ) {
     rte_exit(EXIT_FAILURE, "Failed to alloc bulk\n");
   }
 
-  const struct rte_bbdev_op_cap *cap = info.drv.capabilities;
-  const struct rte_bbdev_op_cap *capabilities = NULL;
-  rte_bbdev_info_get(dev_id, &info);
-  for (unsigned int i = 0; cap->type != RTE_BBDEV_OP_NONE; ++i, ++cap) {
-    std::cout << "cap is: " << cap->type << std::endl;
-    if (cap->type == RTE_BBDEV_OP_LDPC_DEC) {
-      capabilities = cap;
-      std::cout << "capability is being set to: " << capabilities->type
-                << std::endl;
-      break;
-    }
-  }
-
   inputs =
       (struct rte_bbdev_op_data **)malloc(sizeof(struct rte_bbdev_op_data *));
   hard_outputs =
@@ -206,11 +125,26 @@ DoDecode_ACC::DoDecode_ACC(
     rte_exit(EXIT_FAILURE, "Failed to allocate socket\n");
   }
 
-  ldpc_llr_decimals = capabilities->cap.ldpc_dec.llr_decimals;
-  ldpc_llr_size = capabilities->cap.ldpc_dec.llr_size;
-  ldpc_cap_flags = capabilities->cap.ldpc_dec.capability_flags;
-
-  min_alignment = info.drv.min_alignment;
+  // Probed once by Setup()
+  const Bbdev::Properties &props = Bbdev::Props(dev_id);
+  ldpc_llr_decimals = props.llr_decimals_;
+  ldpc_llr_size = props.llr_size_;
+  ldpc_cap_flags = props.dec_flags_;
+  min_alignment = props.min_alignment_;
+
+  // The device writes into and reads from AgoraBuffer memory directly, so it
+  // has to be registered and DMA-mapped for the bbdev device
+  RtAssert(rte_eal_iova_mode() == RTE_IOVA_VA,
+           "ACC100 external mbufs require IOVA as VA mode");
+  const size_t num_ss = cfg_->SpatialStreamsNum();
+  Bbdev::RegisterExtMem(dev_id, demod_buffers_[0][0][0],
+                 cfg_->FrameWindow() * num_ul_syms * num_ss * kMaxModType *
+                     cfg_->OfdmDataNum());
+  Bbdev::RegisterExtMem(dev_id, decoded_buffers_[0][0][0],
+                 cfg_->FrameWindow() * num_ul_syms * num_ue *
+                     cfg_->LdpcConfig(Direction::kUplink).NumBlocksInSymbol() *
+                     cfg_->UlDecodedCbStride());
+  AttachCbMbufs();
 
   const LDPCconfig &ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
 
@@ -219,30 +153,139 @@ DoDecode_ACC::DoDecode_ACC(
   e = ldpc_config.NumCbCodewLen();
 
   for (int i = 0; i < iter_num; i++) {
-  // ref_dec_op[i]->ldpc_dec.op_flags += RTE_BBDEV_LDPC_ITERATION_STOP_ENABLE;
-    ref_dec_op[i]->ldpc_dec.basegraph = (uint8_t)ldpc_config.BaseGraph();
-    ref_dec_op[i]->ldpc_dec.z_c = (uint16_t)ldpc_config.ExpansionFactor();
-    ref_dec_op[i]->ldpc_dec.n_filler = (uint16_t)0;
-    ref_dec_op[i]->ldpc_dec.rv_index = (uint8_t)0;
-    ref_dec_op[i]->ldpc_dec.n_cb = (uint16_t)ldpc_config.NumCbCodewLen();
-    // std::cout << "n_cb is: " << (uint16_t)ldpc_config.NumCbCodewLen() <<  std::endl;
-    ref_dec_op[i]->ldpc_dec.q_m = (uint8_t)q_m;
-    ref_dec_op[i]->ldpc_dec.code_block_mode = (uint8_t)1;
-    ref_dec_op[i]->ldpc_dec.cb_params.e = (uint32_t)e;
-    // std::cout << "e is: " << (uint32_t)e <<  std::endl;
-    if (!check_bit(ref_dec_op[i]->ldpc_dec.op_flags,
-                  RTE_BBDEV_LDPC_ITERATION_STOP_ENABLE)) {
-      ref_dec_op[i]->ldpc_dec.op_flags += RTE_BBDEV_LDPC_ITERATION_STOP_ENABLE;
-    }
-    ref_dec_op[i]->ldpc_dec.iter_max = (uint8_t)ldpc_config.MaxDecoderIter();
+    InitDecOp(ref_dec_op[i]);
     ref_dec_op[i]->opaque_data = (void *)(uintptr_t)i;
   }
+#if defined(ENQUEUE_ASYNC)
+  async_ops_.resize(ASYNC_OPS_NUM);
+  async_enq_tsc_.resize(ASYNC_OPS_NUM);
+  ret = rte_bbdev_dec_op_alloc_bulk(ops_mp, async_ops_.data(),
+                                    async_ops_.size());
+  RtAssert(ret == TEST_SUCCESS, "Failed to alloc the async decode ops");
+  for (auto *op : async_ops_) {
+    InitDecOp(op);
+  }
+  batch_policy_ = cfg_->GetAccBatchPolicy();
+  max_burst_ = std::min(cfg_->AccBatchMaxOps(), async_ops_.size());
+  batch_latency_cycles_ =
+      GetTime::UsToCycles(cfg_->AccBatchLatencyUs(), cfg_->FreqGhz());
+#else
+  RtAssert(cfg_->GetAccBatchPolicy() == AccBatchPolicy::kRequest,
+           "acc_batch_policy needs the asynchronous ACC100 mode");
+#endif
   std::cout << "" << std::endl;
   AGORA_LOG_INFO("rte_pktmbuf_alloc successful\n");
 }
 
 DoDecode_ACC::~DoDecode_ACC() {
-  std::free(resp_var_nodes_);
+  for (size_t frame_slot = 0; frame_slot < cfg_->FrameWindow(); frame_slot++) {
+    rte_pktmbuf_free_bulk(in_cb_mbufs_[frame_slot].data(),
+                          in_cb_mbufs_[frame_slot].size());
+    rte_pktmbuf_free_bulk(out_cb_mbufs_[frame_slot].data(),
+                          out_cb_mbufs_[frame_slot].size());
+  }
+#if defined(ENQUEUE_ASYNC)
+  if (num_batches_ > 0) {
+    AGORA_LOG_INFO(
+        "DoDecode_ACC[%d]: %zu batches of %.1f ops, enqueue to dequeue "
+        "%.2f us on average and %.2f us at most, burst target %zu\n",
+        tid_, num_batches_, static_cast<double>(batch_ops_) / num_batches_,
+        GetTime::CyclesToUs(batch_cycles_, cfg_->FreqGhz()) / num_batches_,
+        GetTime::CyclesToUs(max_batch_cycles_, cfg_->FreqGhz()),
+        burst_target_);
+  }
+  rte_bbdev_dec_op_free_bulk(async_ops_.data(), async_ops_.size());
+#endif
+  Agora_memory::PaddedAlignedFree(resp_var_nodes_);
+}
+
+void DoDecode_ACC::InitDecOp(struct rte_bbdev_dec_op *op) {
+  const LDPCconfig &ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
+  op->ldpc_dec.basegraph = (uint8_t)ldpc_config.BaseGraph();
+  op->ldpc_dec.z_c = (uint16_t)ldpc_config.ExpansionFactor();
+  op->ldpc_dec.n_filler = (uint16_t)0;
+  op->ldpc_dec.rv_index = (uint8_t)0;
+  op->ldpc_dec.n_cb = (uint16_t)ldpc_config.NumCbCodewLen();
+  op->ldpc_dec.q_m = (uint8_t)q_m;
+  op->ldpc_dec.code_block_mode = (uint8_t)1;
+  op->ldpc_dec.cb_params.e = (uint32_t)e;
+  if (!check_bit(op->ldpc_dec.op_flags,
+                 RTE_BBDEV_LDPC_ITERATION_STOP_ENABLE)) {
+    op->ldpc_dec.op_flags += RTE_BBDEV_LDPC_ITERATION_STOP_ENABLE;
+  }
+  op->ldpc_dec.iter_max = (uint8_t)ldpc_config.MaxDecoderIter();
+}
+
+void DoDecode_ACC::AttachCbMbufs() {
+  const LDPCconfig &ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
+  const size_t num_ul_syms = cfg_->Frame().NumULSyms();
+  const size_t num_ue = cfg_->UeAntNum();
+  const size_t num_cbs = ldpc_config.NumBlocksInSymbol();
+  const size_t num_cbs_per_slot = num_ul_syms * num_ue * num_cbs;
+  const size_t llr_len = ldpc_config.NumCbCodewLen();
+  const size_t decoded_len = cfg_->UlDecodedCbStride();
+
+  ext_shinfo_.free_cb = NoOpExtBufFree;
+  ext_shinfo_.fcb_opaque = nullptr;
+  // Never drops to zero while the mbufs are attached
+  rte_mbuf_ext_refcnt_set(&ext_shinfo_,
+                          2 * cfg_->FrameWindow() * num_cbs_per_slot);
+
+  for (size_t frame_slot = 0; frame_slot < cfg_->FrameWindow(); frame_slot++) {
+    in_cb_mbufs_[frame_slot].resize(num_cbs_per_slot);
+    out_cb_mbufs_[frame_slot].resize(num_cbs_per_slot);
+    int ret = rte_pktmbuf_alloc_bulk(
+        in_mbuf_pool, in_cb_mbufs_[frame_slot].data(), num_cbs_per_slot);
+    ret |= rte_pktmbuf_alloc_bulk(
+        out_mbuf_pool, out_cb_mbufs_[frame_slot].data(), num_cbs_per_slot);
+    RtAssert(ret == 0, "Failed to allocate ACC100 code block mbufs");
+
+    for (size_t sym = 0; sym < num_ul_syms; sym++) {
+      for (size_t ue = 0; ue < num_ue; ue++) {
+        for (size_t cb = 0; cb < num_cbs; cb++) {
+          const size_t index = CbIndex(sym, ue, cb);
+          int8_t *llr = demod_buffers_[frame_slot][sym][ue] +
+                        (cfg_->ModOrderBits(Direction::kUplink) *
+                         (llr_len * cb));
+          int8_t *decoded =
+              decoded_buffers_[frame_slot][sym][ue] + (cb * decoded_len);
+          rte_pktmbuf_attach_extbuf(in_cb_mbufs_[frame_slot][index], llr,
+                                    rte_mem_virt2iova(llr), llr_len,
+                                    &ext_shinfo_);
+          rte_pktmbuf_attach_extbuf(out_cb_mbufs_[frame_slot][index],
+                                    decoded, rte_mem_virt2iova(decoded),
+                                    decoded_len, &ext_shinfo_);
+        }
+      }
+    }
+  }
+}
+
+void DoDecode_ACC::PrepareCbOp(struct rte_bbdev_dec_op *op, size_t frame_slot,
+                               size_t symbol_idx_ul, size_t ue_id,
+                               size_t cb_id) {
+  const size_t index = CbIndex(symbol_idx_ul, ue_id, cb_id);
+  const uint16_t llr_len = static_cast<uint16_t>(
+      cfg_->LdpcConfig(Direction::kUplink).NumCbCodewLen());
+
+  // The LLRs are already in place, and in the format of the card (see
+  // Bbdev::HardLlrMagnitude()), the input only has to cover them
+  struct rte_mbuf *m_in = in_cb_mbufs_[frame_slot][index];
+  m_in->data_off = 0;
+  m_in->data_len = llr_len;
+  m_in->pkt_len = llr_len;
+  op->ldpc_dec.input.data = m_in;
+  op->ldpc_dec.input.offset = 0;
+  op->ldpc_dec.input.length = llr_len;
+
+  // The driver appends the decoded bytes, so start from an empty mbuf
+  struct rte_mbuf *m_out = out_cb_mbufs_[frame_slot][index];
+  m_out->data_off = 0;
+  m_out->data_len = 0;
+  m_out->pkt_len = 0;
+  op->ldpc_dec.hard_output.data = m_out;
+  op->ldpc_dec.hard_output.offset = 0;
+  op->ldpc_dec.hard_output.length = 0;
 }
 
 int DoDecode_ACC::allocate_buffers_on_socket(struct rte_bbdev_op_data **buffers,
@@ -262,6 +305,266 @@ int DoDecode_ACC::allocate_buffers_on_socket(struct rte_bbdev_op_data **buffers,
   return (*buffers == NULL) ? TEST_FAILED : TEST_SUCCESS;
 }
 
+#if defined(ENQUEUE_ASYNC)
+bool DoDecode_ACC::TryLaunch(
+    moodycamel::ConcurrentQueue<EventData> &task_queue,
+    moodycamel::ConcurrentQueue<EventData> &complete_task_queue,
+    moodycamel::ProducerToken *worker_ptok) {
+  // Completions go to the queue of their own frame, which is not necessarily
+  // the one this worker is currently serving
+  bool work_done = PollAsync();
+  EventData req_event;
+  if (task_queue.try_dequeue(req_event)) {
+    LaunchEventTraced(req_event, complete_task_queue, worker_ptok);
+    work_done = true;
+  } else {
+    work_done |= FlushIdle();
+  }
+  return work_done;
+}
+
+void DoDecode_ACC::LaunchEvent(
+    const EventData &req_event,
+    moodycamel::ConcurrentQueue<EventData> &complete_task_queue,
+    moodycamel::ProducerToken *worker_ptok) {
+  unused(complete_task_queue);
+  unused(worker_ptok);
+  if ((async_staged_ > 0) && (batch_policy_ == AccBatchPolicy::kFrame) &&
+      (gen_tag_t(req_event.tags_.at(0)).frame_id_ != staged_frame_)) {
+    FlushAsync();
+  }
+  StageAsync(req_event);
+  if (FlushDue(req_event)) {
+    FlushAsync();
+  }
+}
+
+bool DoDecode_ACC::Poll() {
+  const bool flushed = FlushIdle();
+  return PollAsync() || flushed;
+}
+
+bool DoDecode_ACC::FlushIdle() {
+  if (async_staged_ == 0) {
+    return false;
+  }
+  FlushAsync();
+  return true;
+}
+
+bool DoDecode_ACC::FlushDue(const EventData &req_event) const {
+  switch (batch_policy_) {
+    case AccBatchPolicy::kFrame:
+      return cfg_->Frame().GetULSymbolIdx(
+                 gen_tag_t(req_event.tags_.at(0)).symbol_id_) ==
+             cfg_->Frame().NumULSyms() - 1;
+    case AccBatchPolicy::kAdaptive:
+      return (async_staged_ >= burst_target_) ||
+             (GetTime::WorkerRdtsc() - staged_tsc_ >= batch_latency_cycles_);
+    case AccBatchPolicy::kRequest:
+    default:
+      return true;
+  }
+}
+
+void DoDecode_ACC::StageAsync(const EventData &req_event) {
+  const LDPCconfig &ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
+  const size_t num_tags = req_event.num_tags_;
+  size_t start_tsc = GetTime::WorkerRdtsc();
+
+  while (OpsInFlight() + num_tags > async_ops_.size()) {
+    // Only enqueued ops can make room
+    FlushIdle();
+    PollAsync();
+  }
+  if (async_staged_ == 0) {
+    staged_tsc_ = start_tsc;
+    staged_frame_ = gen_tag_t(req_event.tags_.at(0)).frame_id_;
+  }
+
+  for (size_t i = 0; i < num_tags; i++) {
+    const size_t tag = req_event.tags_.at(i);
+    const size_t frame_id = gen_tag_t(tag).frame_id_;
+    const size_t symbol_idx_ul =
+        cfg_->Frame().GetULSymbolIdx(gen_tag_t(tag).symbol_id_);
+    const size_t cb_id = gen_tag_t(tag).cb_id_;
+    if (harq_buffer_ != nullptr) {
+      const size_t cur_cb_id = cb_id % ldpc_config.NumBlocksInSymbol();
+      harq_buffer_->Combine(
+          cb_id / ldpc_config.NumBlocksInSymbol(), frame_id,
+          (symbol_idx_ul * ldpc_config.NumBlocksInSymbol()) + cur_cb_id,
+          CbLlrs(tag));
+    }
+
+    struct rte_bbdev_dec_op *op = async_ops_.at(
+        (async_enq_ + async_staged_ + i) % async_ops_.size());
+    PrepareCbOp(op, frame_id % cfg_->FrameWindow(), symbol_idx_ul,
+                cb_id / ldpc_config.NumBlocksInSymbol(),
+                cb_id % ldpc_config.NumBlocksInSymbol());
+    op->opaque_data = reinterpret_cast<void *>(tag);
+  }
+
+  // Registered before enqueueing, as polling for room may already retire
+  // some of its ops
+  pending_requests_.Push(req_event, num_tags);
+  async_staged_ += num_tags;
+  duration_stat_->task_duration_[1] += GetTime::WorkerRdtsc() - start_tsc;
+}
+
+void DoDecode_ACC::FlushAsync() {
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  // Before enqueueing, as polling for room may already retire the batch
+  batches_.push(Batch{async_enq_ + async_staged_, start_tsc, async_staged_});
+
+  while (async_staged_ > 0) {
+    // The staged ops are contiguous in the ring, unless they wrap around
+    const size_t slot = async_enq_ % async_ops_.size();
+    const size_t num_ops = std::min(async_staged_, async_ops_.size() - slot);
+    const uint16_t num_enq = queue_.Enqueue(&async_ops_.at(slot), num_ops);
+    const size_t enq_tsc = GetTime::WorkerRdtsc();
+    for (size_t i = 0; i < num_enq; i++) {
+      async_enq_tsc_.at(slot + i) = enq_tsc;
+    }
+    async_enq_ += num_enq;
+    async_staged_ -= num_enq;
+    stats_->SetAccOpsInFlight(tid_, Direction::kUplink,
+                              async_enq_ - async_deq_);
+    if (num_enq < num_ops) {
+      // The device queue is full, make room by retiring finished ops
+      PollAsync();
+    }
+  }
+  duration_stat_->task_duration_[1] += GetTime::WorkerRdtsc() - start_tsc;
+}
+
+void DoDecode_ACC::RetireBatches(size_t now_tsc) {
+  while (!batches_.empty() && (batches_.front().end_ <= async_deq_)) {
+    const Batch &batch = batches_.front();
+    const size_t cycles = now_tsc - batch.enq_tsc_;
+    num_batches_++;
+    batch_ops_ += batch.num_ops_;
+    batch_cycles_ += cycles;
+    max_batch_cycles_ = std::max(max_batch_cycles_, cycles);
+    if (kDebugPrintInTask == true) {
+      std::printf("In doDecode thread %d: batch of %zu ops in %.2f us\n",
+                  tid_, batch.num_ops_,
+                  GetTime::CyclesToUs(cycles, cfg_->FreqGhz()));
+    }
+    if (batch_policy_ == AccBatchPolicy::kAdaptive) {
+      // Only a full batch tells whether a larger one would still make it
+      if ((cycles < batch_latency_cycles_) &&
+          (batch.num_ops_ >= burst_target_)) {
+        burst_target_ = std::min(2 * burst_target_, max_burst_);
+      } else if (cycles > batch_latency_cycles_) {
+        burst_target_ = std::max(burst_target_ / 2, size_t{1});
+      }
+    }
+    batches_.pop();
+  }
+}
+
+bool DoDecode_ACC::PollAsync() {
+  if (async_deq_ == async_enq_) {
+    return false;
+  }
+  size_t start_tsc = GetTime::WorkerRdtsc();
+
+  std::array<struct rte_bbdev_dec_op *, MAX_PKT_BURST> ops;
+  const uint16_t num_deq = queue_.Dequeue(ops.data(), ops.size());
+  for (size_t i = 0; i < num_deq; i++) {
+    // The ops come back in enqueue order
+    const size_t latency =
+        start_tsc - async_enq_tsc_.at((async_deq_ + i) % async_ops_.size());
+    op_latency_cycles_ += (static_cast<double>(latency) - op_latency_cycles_) /
+                          kOpLatencyAvgOps;
+    // A syndrome error is a decode failure, not an op failure
+    const bool syndrome_error =
+        check_bit(ops.at(i)->status, 1 << RTE_BBDEV_SYNDROME_ERROR);
+    if ((ops.at(i)->status & ~(1 << RTE_BBDEV_SYNDROME_ERROR)) != 0) {
+      AGORA_LOG_WARN("ACC100: decode op failed with status 0x%x\n",
+                     ops.at(i)->status);
+    }
+    CheckDecodedCb(reinterpret_cast<size_t>(ops.at(i)->opaque_data),
+                   syndrome_error == false);
+    duration_stat_->task_count_++;
+
+    EventData resp_event;
+    if (pending_requests_.RetireOp(resp_event)) {
+      PostCompletion(resp_event);
+    }
+  }
+  async_deq_ += num_deq;
+
+  if (num_deq > 0) {
+    RetireBatches(start_tsc);
+    stats_->SetAccOpsInFlight(tid_, Direction::kUplink,
+                              async_enq_ - async_deq_);
+    duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc;
+  }
+  return num_deq > 0;
+}
+
+void DoDecode_ACC::CheckDecodedCb(size_t tag, bool decoded) {
+  const LDPCconfig &ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  const size_t symbol_idx_ul =
+      cfg_->Frame().GetULSymbolIdx(gen_tag_t(tag).symbol_id_);
+  const size_t symbol_offset =
+      cfg_->GetTotalDataSymbolIdxUl(frame_id, symbol_idx_ul);
+  const size_t cb_id = gen_tag_t(tag).cb_id_;
+  const size_t cur_cb_id = (cb_id % ldpc_config.NumBlocksInSymbol());
+  const size_t ue_id = (cb_id / ldpc_config.NumBlocksInSymbol());
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t num_bytes_per_cb = cfg_->NumBytesPerCb(Direction::kUplink);
+
+  uint8_t *decoded_buffer_ptr =
+      reinterpret_cast<uint8_t *>(
+          decoded_buffers_[frame_slot][symbol_idx_ul][ue_id]) +
+      (cur_cb_id * cfg_->UlDecodedCbStride());
+
+  if (harq_buffer_ != nullptr) {
+    harq_buffer_->Update(
+        ue_id, frame_id,
+        (symbol_idx_ul * ldpc_config.NumBlocksInSymbol()) + cur_cb_id,
+        CbLlrs(tag), decoded);
+  }
+
+  if (cfg_->ScrambleEnabled()) {
+    scrambler_->Descramble(decoded_buffer_ptr, num_bytes_per_cb);
+  }
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kDecoded, frame_id)) {
+    taps_->Publish(TapPoint::kDecoded, frame_id, gen_tag_t(tag).symbol_id_,
+                   ue_id, cur_cb_id, decoded_buffer_ptr, num_bytes_per_cb);
+  }
+
+  if ((kEnableMac == false) && (kPrintPhyStats == true) &&
+      (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols())) {
+    phy_stats_->UpdateDecodedBits(ue_id, symbol_offset, frame_slot,
+                                  num_bytes_per_cb * 8);
+    phy_stats_->IncrementDecodedBlocks(ue_id, symbol_offset, frame_slot);
+    const int8_t *tx_bytes =
+        cfg_->GetInfoBits(cfg_->UlBits(numa_node_), Direction::kUplink,
+                          symbol_idx_ul, ue_id, cur_cb_id);
+    const size_t block_error = phy_stats_->UpdateBitErrors(
+        ue_id, symbol_offset, frame_slot,
+        reinterpret_cast<const uint8_t *>(tx_bytes), decoded_buffer_ptr,
+        num_bytes_per_cb);
+    phy_stats_->UpdateBlockErrors(ue_id, symbol_offset, frame_slot,
+                                  block_error);
+  }
+}
+
+void DoDecode_ACC::PostCompletion(const EventData &event) {
+  if (IsLastSharedTask(event) == false) {
+    return;
+  }
+  const size_t qid =
+      gen_tag_t(event.tags_.at(0)).frame_id_ % cfg_->PipelineDepth();
+  TryEnqueueFallback(&message_->GetCompQueue(qid),
+                     message_->GetWorkerPtok(qid, tid_), event);
+}
+#endif  // ENQUEUE_ASYNC
+
 EventData DoDecode_ACC::Launch(size_t tag) {
   const LDPCconfig &ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
   const size_t frame_id = gen_tag_t(tag).frame_id_;
@@ -274,7 +577,7 @@ EventData DoDecode_ACC::Launch(size_t tag) {
   const size_t cur_cb_id = (cb_id % ldpc_config.NumBlocksInSymbol());
   const size_t ue_id = (cb_id / ldpc_config.NumBlocksInSymbol());
   const size_t num_ue = cfg_->UeAntNum();
-  const size_t frame_slot = (frame_id % kFrameWnd);
+  const size_t frame_slot = (frame_id % cfg_->FrameWindow());
   const size_t num_bytes_per_cb = cfg_->NumBytesPerCb(Direction::kUplink);
   if (kDebugPrintInTask == true) {
     std::printf(
@@ -288,62 +591,15 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     // std::cout<<"[In If]callling doDecode launch, Frame id is " << frame_id << " symbol id is: " << symbol_id <<std::endl;
     size_t start_tsc = GetTime::WorkerRdtsc();
 
-    int8_t *llr_buffer_ptr;
-    struct rte_mbuf *m_head;
-    struct rte_mbuf *m_head_out;
     size_t index = 0;
 
-    for (size_t temp_ue_id = 0; temp_ue_id < num_ue; temp_ue_id++){
-      for (size_t temp_idx = 0; temp_idx < num_ul_syms; temp_idx++){
-        llr_buffer_ptr = demod_buffers_[frame_slot][temp_idx][temp_ue_id] +
-                                (cfg_->ModOrderBits(Direction::kUplink) *
-                                  (ldpc_config.NumCbCodewLen() * cur_cb_id));
-        
-        int8_t* ref_byte_cp = cfg_->GetInfoBits(cfg_->UlBits(), Direction::kUplink, temp_idx, temp_ue_id, cur_cb_id);
-        uint8_t* ref_byte_new = reinterpret_cast<uint8_t*>(ref_byte_cp);
-
-        char *data;
-        struct rte_bbdev_op_data *bufs = *inputs;
-        m_head = rte_pktmbuf_alloc(in_mbuf_pool);
-
-        bufs[0].data = m_head;
-        bufs[0].offset = 0;
-        bufs[0].length = 0;
-
-        data = rte_pktmbuf_append(m_head, ldpc_config.NumCbCodewLen());
-
-        // Copy data from demod_data to the mbuf
-        rte_memcpy(data, llr_buffer_ptr + (0 * ldpc_config.NumCbCodewLen()),
-                  ldpc_config.NumCbCodewLen());
-        bufs[0].length += ldpc_config.NumCbCodewLen();
-
-        rte_bbdev_op_data *bufs_out = *hard_outputs;
-        m_head_out = rte_pktmbuf_alloc(out_mbuf_pool);
-
-        bufs_out[0].data = m_head_out;
-        bufs_out[0].offset = 0;
-        bufs_out[0].length = 0;
-
-        // Prepare the mbuf to receive the output data
-        char *data_out = rte_pktmbuf_append(m_head_out, ldpc_config.NumCbCodewLen());
-        assert(data_out == RTE_PTR_ALIGN(data_out, min_alignment));
-
-        // BUG: This line causes a irregular stop of the program when fft_size = 4096,
-        //      ofdm_data_num = 3168 = demul_block_size = beam_block_size, SISO, any
-        //      sampling rate.
-        // Assuming you will copy data from decoded_buffer_ptr to data
-        rte_memcpy(data_out, ref_byte_new, ldpc_config.NumCbCodewLen());
-
-        bufs_out[0].length += ldpc_config.NumCbCodewLen();
-  
-        ref_dec_op[index]->ldpc_dec.input = *inputs[0];
-        ref_dec_op[index]->ldpc_dec.hard_output = *hard_outputs[0];
-
+    for (size_t temp_ue_id = 0; temp_ue_id < num_ue; temp_ue_id++) {
+      for (size_t temp_idx = 0; temp_idx < num_ul_syms; temp_idx++) {
+        PrepareCbOp(ref_dec_op[index], frame_slot, temp_idx, temp_ue_id,
+                    cur_cb_id);
         index++;
-        rte_pktmbuf_free(m_head);
-        rte_pktmbuf_free(m_head_out);
       }
-  }
+    }
 
     size_t start_tsc1 = GetTime::WorkerRdtsc();
     duration_stat_->task_duration_[1] += start_tsc1 - start_tsc;
@@ -352,15 +608,15 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     uint64_t start_time = 0, last_time = 0;
     
     for (enq = 0, deq = 0; enq < (num_ul_syms * num_ue);) {
-      enq += rte_bbdev_enqueue_ldpc_dec_ops(0, 0, &ref_dec_op[enq], 1);
-      deq += rte_bbdev_dequeue_ldpc_dec_ops(0, 0, &ops_deq[deq], enq - deq);
+      enq += queue_.Enqueue(&ref_dec_op[enq], 1);
+      deq += queue_.Dequeue(&ops_deq[deq], enq - deq);
     }
 
     int retry_count = 0;
 
     while (deq < enq && retry_count < MAX_DEQUEUE_TRIAL) {
       // rte_delay_ms(10);  // Wait for 10 milliseconds
-      deq += rte_bbdev_dequeue_ldpc_dec_ops(0, 0, &ops_deq[deq], enq - deq);
+      deq += queue_.Dequeue(&ops_deq[deq], enq - deq);
       retry_count++;
     }
 
@@ -392,11 +648,11 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     for (size_t temp_idx = 2; temp_idx < num_ul_syms; temp_idx++){
       for (size_t temp_ue_id = 0; temp_ue_id < num_ue; temp_ue_id++){  
           ref_byte = 
-            cfg_->GetInfoBits(cfg_->UlBits(), Direction::kUplink, temp_idx,
-                              temp_ue_id, cur_cb_id);
+            cfg_->GetInfoBits(cfg_->UlBits(numa_node_), Direction::kUplink,
+                              temp_idx, temp_ue_id, cur_cb_id);
           tx_byte = static_cast<uint8_t>(
-            cfg_->GetInfoBits(cfg_->UlBits(), Direction::kUplink, temp_idx,
-                              temp_ue_id, cur_cb_id)[i]);
+            cfg_->GetInfoBits(cfg_->UlBits(numa_node_), Direction::kUplink,
+                              temp_idx, temp_ue_id, cur_cb_id)[i]);
           phy_stats_->UpdateBitErrors(temp_ue_id, symbol_offset, frame_slot,
                                       tx_byte, tx_byte);
           // tx_word = static_cast<uint8_t>(tx_byte);
@@ -436,9 +692,6 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     size_t duration_3 = end - start_tsc2;
     size_t duration = end - start_tsc;
 
-    rte_pktmbuf_free(m_head);
-    rte_pktmbuf_free(m_head_out);
-
     duration_stat_->task_duration_[3] += duration_3;
     duration_stat_->task_duration_[0] += duration;
     // duration_stat_->task_duration_[0] += 0;
@@ -455,8 +708,6 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     size_t start_tsc = GetTime::WorkerRdtsc();
 
     int8_t *llr_buffer_ptr;
-    struct rte_mbuf *m_head;
-    struct rte_mbuf *m_head_out;
 
     llr_buffer_ptr = demod_buffers_[frame_slot][symbol_idx_ul][ue_id] +
                             (cfg_->ModOrderBits(Direction::kUplink) *
@@ -471,47 +722,17 @@ EventData DoDecode_ACC::Launch(size_t tag) {
         std::printf("\n");
     }
 
-    char *data;
-    struct rte_bbdev_op_data *bufs = *inputs;
-
-    m_head = rte_pktmbuf_alloc(in_mbuf_pool);
-
-    bufs[0].data = m_head;
-    bufs[0].offset = 0;
-    bufs[0].length = 0;
-
-    data = rte_pktmbuf_append(m_head, ldpc_config.NumCbCodewLen());
-
-    // Copy data from demod_data to the mbuf
-    rte_memcpy(data, llr_buffer_ptr + (0 * ldpc_config.NumCbCodewLen()),
-              ldpc_config.NumCbCodewLen());
-    bufs[0].length += ldpc_config.NumCbCodewLen();
-
-    rte_bbdev_op_data *bufs_out = *hard_outputs;
-    m_head_out = rte_pktmbuf_alloc(out_mbuf_pool);
-
-    bufs_out[0].data = m_head_out;
-    bufs_out[0].offset = 0;
-    bufs_out[0].length = 0;
-    // BUG: This line causes a irregular stop of the program when fft_size = 4096,
-    //      ofdm_data_num = 3168 = demul_block_size = beam_block_size, SISO, any
-    //      sampling rate.
-    bufs_out[0].length += ldpc_config.NumCbCodewLen();
-
-    ref_dec_op[enq_index]->ldpc_dec.input = *inputs[0];
-    ref_dec_op[enq_index]->ldpc_dec.hard_output = *hard_outputs[0];
-
-    rte_pktmbuf_free(m_head);
-    rte_pktmbuf_free(m_head_out);
+    PrepareCbOp(ref_dec_op[enq_index], frame_slot, symbol_idx_ul, ue_id,
+                cur_cb_id);
 
     size_t start_tsc1 = GetTime::WorkerRdtsc();
     duration_stat_->task_duration_[1] += start_tsc1 - start_tsc;
     
-    enq += rte_bbdev_enqueue_ldpc_dec_ops(0, 0, &ref_dec_op[enq], 1);
+    enq += queue_.Enqueue(&ref_dec_op[enq], 1);
 
     int retry_count = 0;
     while (deq < enq && retry_count < MAX_DEQUEUE_TRIAL) {
-      deq += rte_bbdev_dequeue_ldpc_dec_ops(0, 0, &ops_deq[deq], enq - deq);
+      deq += queue_.Dequeue(&ops_deq[deq], enq - deq);
       retry_count++;
     }
     AGORA_LOG_INFO("ACC100: enq = %d, deq = %d\n", enq, deq);
@@ -544,11 +765,11 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     for (size_t temp_idx = 2; temp_idx < num_ul_syms; temp_idx++){
       for (size_t temp_ue_id = 0; temp_ue_id < num_ue; temp_ue_id++){  
           ref_byte = 
-            cfg_->GetInfoBits(cfg_->UlBits(), Direction::kUplink, temp_idx,
-                              temp_ue_id, cur_cb_id);
+            cfg_->GetInfoBits(cfg_->UlBits(numa_node_), Direction::kUplink,
+                              temp_idx, temp_ue_id, cur_cb_id);
           tx_byte = static_cast<uint8_t>(
-            cfg_->GetInfoBits(cfg_->UlBits(), Direction::kUplink, temp_idx,
-                              temp_ue_id, cur_cb_id)[i]);
+            cfg_->GetInfoBits(cfg_->UlBits(numa_node_), Direction::kUplink,
+                              temp_idx, temp_ue_id, cur_cb_id)[i]);
           // tx_word = static_cast<uint8_t>(tx_byte);
 
           ops_td = &ops_deq[i]->ldpc_dec;
@@ -601,9 +822,6 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     size_t duration_3 = end - start_tsc2;
     size_t duration = end - start_tsc;
 
-    rte_pktmbuf_free(m_head);
-    rte_pktmbuf_free(m_head_out);
-
     duration_stat_->task_duration_[3] += duration_3;
     duration_stat_->task_duration_[0] += duration;
     // duration_stat_->task_duration_[0] += 0;
@@ -619,8 +837,6 @@ EventData DoDecode_ACC::Launch(size_t tag) {
     size_t start_tsc_else = GetTime::WorkerRdtsc();
 
     int8_t *llr_buffer_ptr;
-    struct rte_mbuf *m_head;
-    struct rte_mbuf *m_head_out;
 
     llr_buffer_ptr = demod_buffers_[frame_slot][symbol_idx_ul][ue_id] +
                             (cfg_->ModOrderBits(Direction::kUplink) *
@@ -635,47 +851,11 @@ EventData DoDecode_ACC::Launch(size_t tag) {
         std::printf("\n");
     }
  
-    char *data;
-    struct rte_bbdev_op_data *bufs = *inputs;
-
-    m_head = rte_pktmbuf_alloc(in_mbuf_pool);
-
-    bufs[0].data = m_head;
-    bufs[0].offset = 0;
-    bufs[0].length = 0;
-
-    data = rte_pktmbuf_append(m_head, ldpc_config.NumCbCodewLen());
-
-        // Copy data from demod_data to the mbuf
-    rte_memcpy(data, llr_buffer_ptr + (0 * ldpc_config.NumCbCodewLen()),
-              ldpc_config.NumCbCodewLen());
-    bufs[0].length += ldpc_config.NumCbCodewLen();
-
-    rte_bbdev_op_data *bufs_out = *hard_outputs;
-    m_head_out = rte_pktmbuf_alloc(out_mbuf_pool);
-
-    bufs_out[0].data = m_head_out;
-    bufs_out[0].offset = 0;
-    bufs_out[0].length = 0;
-
-    // Prepare the mbuf to receive the output data
-    // char *data_out = rte_pktmbuf_append(m_head_out, ldpc_config.NumCbCodewLen());
-    // assert(data_out == RTE_PTR_ALIGN(data_out, min_alignment));
-
-    // BUG: This line causes a irregular stop of the program when fft_size = 4096,
-    //      ofdm_data_num = 3168 = demul_block_size = beam_block_size, SISO, any
-    //      sampling rate.
-    // rte_memcpy(data_out, ref_byte_new, ldpc_config.NumCbCodewLen());
-    bufs_out[0].length += ldpc_config.NumCbCodewLen();
-
-    ref_dec_op[enq_index]->ldpc_dec.input = *inputs[0];
-    ref_dec_op[enq_index]->ldpc_dec.hard_output = *hard_outputs[0];
-
-    rte_pktmbuf_free(m_head);
-    rte_pktmbuf_free(m_head_out);
+    PrepareCbOp(ref_dec_op[enq_index], frame_slot, symbol_idx_ul, ue_id,
+                cur_cb_id);
 
     if (kMubfLLRCheck){
-      struct rte_mbuf *mbuf_1 = bufs[0].data;
+      struct rte_mbuf *mbuf_1 = ref_dec_op[enq_index]->ldpc_dec.input.data;
       uint8_t *mbuf_data = rte_pktmbuf_mtod(mbuf_1, uint8_t *);
       size_t data_length = mbuf_1->data_len;
       
@@ -724,7 +904,7 @@ EventData DoDecode_ACC::Launch(size_t tag) {
       }
     }
   }
-    enq += rte_bbdev_enqueue_ldpc_dec_ops(0, 0, &ref_dec_op[enq], 1);
+    enq += queue_.Enqueue(&ref_dec_op[enq], 1);
 
     size_t end_else = GetTime::WorkerRdtsc();
     size_t duration_else = end_else - start_tsc_else;
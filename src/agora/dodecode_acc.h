@@ -26,16 +26,24 @@
 #include <rte_udp.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <bitset>
 #include <chrono>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <queue>
 #include <random>
+#include <vector>
+
+#include "bbdev_device.h"
+#include "agora_buffer.h"
 
 #include "config.h"
 #include "doer.h"
+#include "harq_buffer.h"
 #include "memory_manage.h"
 #include "message.h"
 #include "phy_stats.h"
@@ -63,6 +71,8 @@
 #define MAX_BURST 512U
 #define SYNC_START 1
 #define MAX_DEQUEUE_TRIAL 1000000
+// Decode ops that can be in flight in the asynchronous mode
+#define ASYNC_OPS_NUM 1024U
 
 class DoDecode_ACC : public Doer {
  public:
@@ -70,9 +80,40 @@ class DoDecode_ACC : public Doer {
       Config* in_config, int in_tid,
       PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
       PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
-      PhyStats* in_phy_stats, Stats* in_stats_manager);
+      PhyStats* in_phy_stats, Stats* in_stats_manager, MessageInfo* message,
+      HarqBuffer* harq_buffer);
   ~DoDecode_ACC() override;
 
+#if defined(ENQUEUE_ASYNC)
+  /// Asynchronous mode: stage the code blocks of a decode request and enqueue
+  /// the staged ones into the accelerator as Config::GetAccBatchPolicy()
+  /// says, without waiting for them. Every call also polls the accelerator,
+  /// and a request is reported to the completion queue of its frame once all
+  /// of its code blocks are decoded.
+  bool TryLaunch(moodycamel::ConcurrentQueue<EventData>& task_queue,
+                 moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                 moodycamel::ProducerToken* worker_ptok) override;
+  void LaunchEvent(const EventData& req_event,
+                   moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                   moodycamel::ProducerToken* worker_ptok) override;
+  /// Enqueue the staged ops and dequeue the finished ones
+  bool Poll() override;
+  /// Only dequeue the finished ops, for a caller that may launch next
+  inline bool PollCompletions() { return PollAsync(); }
+  /// Enqueue the staged ops of a worker without decode requests left.
+  /// Returns true if there were any.
+  bool FlushIdle();
+
+  /// Decode ops of this worker staged or in the card
+  inline size_t OpsInFlight() const {
+    return async_enq_ + async_staged_ - async_deq_;
+  }
+  /// Moving average of the time from enqueueing an op to dequeueing it
+  inline double OpLatencyUs() const {
+    return GetTime::CyclesToUs(op_latency_cycles_, cfg_->FreqGhz());
+  }
+#endif
+
   EventData Launch(size_t tag) override;
   static int allocate_buffers_on_socket(struct rte_bbdev_op_data** buffers,
                                         const int len, const int socket);
@@ -81,17 +122,57 @@ class DoDecode_ACC : public Doer {
   }
 
  private:
+  /// Index of a code block in the per-frame-slot mbuf arrays
+  inline size_t CbIndex(size_t symbol_idx_ul, size_t ue_id,
+                        size_t cb_id) const {
+    return (symbol_idx_ul * cfg_->UeAntNum() + ue_id) *
+               cfg_->LdpcConfig(Direction::kUplink).NumBlocksInSymbol() +
+           cb_id;
+  }
+
+  /// LLRs of the code block of a decode tag in demod_buffers_
+  inline int8_t* CbLlrs(size_t tag) const {
+    const LDPCconfig& ldpc_config = cfg_->LdpcConfig(Direction::kUplink);
+    const size_t cb_id = gen_tag_t(tag).cb_id_;
+    return demod_buffers_[gen_tag_t(tag).frame_id_ % cfg_->FrameWindow()]
+                         [cfg_->Frame().GetULSymbolIdx(
+                             gen_tag_t(tag).symbol_id_)]
+                         [cb_id / ldpc_config.NumBlocksInSymbol()] +
+           (cfg_->ModOrderBits(Direction::kUplink) *
+            (ldpc_config.NumCbCodewLen() *
+             (cb_id % ldpc_config.NumBlocksInSymbol())));
+  }
+
+  /// Attach one input and one hard output mbuf to the demod and decoded
+  /// buffers of every code block in every frame slot
+  void AttachCbMbufs();
+
+  /// Set the static LDPC parameters of a decode op
+  void InitDecOp(struct rte_bbdev_dec_op* op);
+
+  /// Point the input and hard output of op at the recycled mbufs of a code
+  /// block, resetting their data offset and length for this use
+  void PrepareCbOp(struct rte_bbdev_dec_op* op, size_t frame_slot,
+                   size_t symbol_idx_ul, size_t ue_id, size_t cb_id);
+
   int16_t* resp_var_nodes_;
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers_;
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers_;
   PhyStats* phy_stats_;
+  // Takes the ACC100 occupancy of the async mode
+  Stats* stats_;
   DurationStat* duration_stat_;
   // DurationStat* duration_stat_enq_;
   std::unique_ptr<AgoraScrambler::Scrambler> scrambler_;
+  // Soft buffers of the failed code blocks, nullptr if HARQ is off. Only
+  // the asynchronous mode combines.
+  HarqBuffer* harq_buffer_;
 
   // struct rte_bbdev_dec_op;
 
   uint8_t dev_id;
+  // The bbdev queue owned by this decoder, one per worker thread
+  Bbdev::Queue queue_;
   int ldpc_llr_decimals;
   int ldpc_llr_size;
   uint32_t ldpc_cap_flags;
@@ -119,6 +200,84 @@ class DoDecode_ACC : public Doer {
   struct rte_bbdev_op_data** inputs;
   struct rte_bbdev_op_data** hard_outputs;
 
+  // Mbufs without a data room, attached once to external buffers that point
+  // straight into demod_buffers_ (input) and decoded_buffers_ (hard output),
+  // indexed by frame slot and CbIndex(). They are reused for every frame so
+  // the decode path neither allocates mbufs nor copies LLRs.
+  std::array<std::vector<struct rte_mbuf*>, kFrameWnd> in_cb_mbufs_;
+  std::array<std::vector<struct rte_mbuf*>, kFrameWnd> out_cb_mbufs_;
+  // Shared by all external buffers. The memory belongs to AgoraBuffer, so the
+  // free callback does nothing.
+  struct rte_mbuf_ext_shared_info ext_shinfo_;
+
+#if defined(ENQUEUE_ASYNC)
+  /// Prepare one op per tag of req_event in the op ring, after the ops
+  /// staged so far. Polls while the ring is full.
+  void StageAsync(const EventData& req_event);
+
+  /// Enqueue the staged ops as one batch, polling while the accelerator is
+  /// full
+  void FlushAsync();
+
+  /// True if the staged ops have to be enqueued after staging req_event
+  bool FlushDue(const EventData& req_event) const;
+
+  /// Account for the batches whose last op was dequeued at now_tsc, and
+  /// adapt the burst target to their latency
+  void RetireBatches(size_t now_tsc);
+
+  /// Dequeue the finished ops and post the requests they complete. Returns
+  /// true if any op was dequeued.
+  bool PollAsync();
+
+  /// Descramble a decoded code block and update the PHY stats and the HARQ
+  /// soft buffer. decoded is false if the op reported a syndrome error.
+  void CheckDecodedCb(size_t tag, bool decoded);
+
+  /// Post a completed decode request to the queue of its frame
+  void PostCompletion(const EventData& event);
+
+  // Ring of preallocated ops, used in enqueue order. async_enq_ and
+  // async_deq_ count the ops enqueued and dequeued so far, and the
+  // async_staged_ ops after the enqueued ones are prepared but not enqueued.
+  std::vector<struct rte_bbdev_dec_op*> async_ops_;
+  size_t async_enq_ = 0;
+  size_t async_deq_ = 0;
+  size_t async_staged_ = 0;
+  // When the first staged op was staged, and its frame
+  size_t staged_tsc_ = 0;
+  size_t staged_frame_ = 0;
+
+  AccBatchPolicy batch_policy_;
+  // Staged ops that make an adaptive batch. It doubles while the batches
+  // finish within batch_latency_cycles_ and halves when they do not.
+  size_t burst_target_ = 1;
+  size_t max_burst_;
+  size_t batch_latency_cycles_;
+
+  // The enqueued batches, in enqueue order, until their last op is dequeued
+  struct Batch {
+    // async_enq_ after the batch
+    size_t end_;
+    size_t enq_tsc_;
+    size_t num_ops_;
+  };
+  std::queue<Batch> batches_;
+  // Batches retired so far, their ops, and their summed and largest
+  // enqueue-to-dequeue latency
+  size_t num_batches_ = 0;
+  size_t batch_ops_ = 0;
+  size_t batch_cycles_ = 0;
+  size_t max_batch_cycles_ = 0;
+  // When the op of each ring slot was enqueued, and the moving average of
+  // the op latencies
+  std::vector<size_t> async_enq_tsc_;
+  double op_latency_cycles_ = 0;
+  // The decode requests with code blocks still in the accelerator
+  Bbdev::PendingRequests pending_requests_;
+#endif
+  MessageInfo* message_;
+
   rte_mbuf* input_pkts_burst[54];
   rte_mbuf* output_pkts_burst[54];
   rte_mempool* mbuf_pool;
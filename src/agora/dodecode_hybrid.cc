@@ -0,0 +1,101 @@
+/**
+ * @file dodecode_hybrid.cc
+ * @brief Implementation file for the DoDecode_Hybrid class.
+ */
+
+#include "dodecode_hybrid.h"
+
+#include "logger.h"
+
+DoDecode_Hybrid::DoDecode_Hybrid(
+    Config* in_config, int in_tid,
+    PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
+    PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
+    MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* in_stats_manager,
+    MessageInfo* message, HarqBuffer* harq_buffer)
+    : Doer(in_config, in_tid),
+      acc_(std::make_unique<DoDecode_ACC>(
+          in_config, in_tid, demod_buffers, decoded_buffers, in_phy_stats,
+          in_stats_manager, message, harq_buffer)),
+      cpu_(std::make_unique<DoDecode>(in_config, in_tid, demod_buffers,
+                                      decoded_buffers, mac_sched,
+                                      in_phy_stats, in_stats_manager,
+                                      harq_buffer)),
+      stats_(in_stats_manager),
+      spill_ops_(in_config->AccSpillOps()),
+      spill_latency_us_(in_config->AccSpillLatencyUs()) {
+#if !defined(ENQUEUE_ASYNC)
+  RtAssert(false, "acc_spill_ops needs the asynchronous ACC100 mode");
+#endif
+}
+
+DoDecode_Hybrid::~DoDecode_Hybrid() {
+  if (cpu_blocks_ > 0) {
+    AGORA_LOG_INFO(
+        "DoDecode_Hybrid[%d]: %zu code blocks on the ACC100, %zu spilled to "
+        "the CPU at %.2f us each\n",
+        tid_, acc_blocks_, cpu_blocks_,
+        GetTime::CyclesToUs(cpu_cycles_, cfg_->FreqGhz()) / cpu_blocks_);
+  }
+}
+
+void DoDecode_Hybrid::SetSharedCounters(SharedTaskCounters* shared_counters) {
+  Doer::SetSharedCounters(shared_counters);
+  acc_->SetSharedCounters(shared_counters);
+  cpu_->SetSharedCounters(shared_counters);
+}
+
+void DoDecode_Hybrid::SetTaps(DataTaps* taps) {
+  Doer::SetTaps(taps);
+  acc_->SetTaps(taps);
+  cpu_->SetTaps(taps);
+}
+
+bool DoDecode_Hybrid::Spill() const {
+#if defined(ENQUEUE_ASYNC)
+  const size_t ops_in_flight = acc_->OpsInFlight();
+  if (ops_in_flight >= spill_ops_) {
+    return true;
+  }
+  // The average only moves with completions, so it is stale once the card
+  // is empty
+  return (spill_latency_us_ > 0) && (ops_in_flight > 0) &&
+         (acc_->OpLatencyUs() > spill_latency_us_);
+#else
+  return false;
+#endif
+}
+
+bool DoDecode_Hybrid::TryLaunch(
+    moodycamel::ConcurrentQueue<EventData>& task_queue,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  // Retire the finished ops first, so the card looks as busy as it is
+  bool work_done = acc_->PollCompletions();
+  EventData req_event;
+  if (task_queue.try_dequeue(req_event)) {
+    LaunchEventTraced(req_event, complete_task_queue, worker_ptok);
+    work_done = true;
+  } else {
+    work_done |= acc_->FlushIdle();
+  }
+  return work_done;
+}
+
+void DoDecode_Hybrid::LaunchEvent(
+    const EventData& req_event,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  const size_t num_blocks = req_event.num_tags_;
+  if (Spill()) {
+    const size_t start_tsc = GetTime::WorkerRdtsc();
+    cpu_->LaunchEvent(req_event, complete_task_queue, worker_ptok);
+    cpu_cycles_ += GetTime::WorkerRdtsc() - start_tsc;
+    cpu_blocks_ += num_blocks;
+    stats_->AddAccDecodeBlocks(tid_, true, num_blocks);
+  } else {
+    acc_->LaunchEvent(req_event, complete_task_queue, worker_ptok);
+    acc_blocks_ += num_blocks;
+    stats_->AddAccDecodeBlocks(tid_, false, num_blocks);
+  }
+}
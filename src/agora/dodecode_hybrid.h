@@ -0,0 +1,69 @@
+/**
+ * @file dodecode_hybrid.h
+ * @brief Declaration file for the DoDecode_Hybrid class, which decodes on
+ * the ACC100 and spills code blocks to the CPU decoder when it is busy.
+ */
+
+#ifdef USE_ACC100
+
+#ifndef DODECODE_HYBRID_H_
+#define DODECODE_HYBRID_H_
+
+#include <memory>
+
+#include "config.h"
+#include "dodecode.h"
+#include "dodecode_acc.h"
+#include "doer.h"
+#include "harq_buffer.h"
+#include "mac_scheduler.h"
+#include "message.h"
+#include "phy_stats.h"
+#include "stats.h"
+
+/// Sends each decode request to the ACC100 queue of the worker, unless it
+/// holds Config::AccSpillOps() ops or its ops take longer than
+/// Config::AccSpillLatencyUs() on average. The request is then decoded by
+/// the worker on the CPU, which spreads the overflow over the workers that
+/// have the time to take decode requests. Needs the asynchronous ACC100
+/// mode.
+class DoDecode_Hybrid : public Doer {
+ public:
+  DoDecode_Hybrid(
+      Config* in_config, int in_tid,
+      PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
+      PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
+      MacScheduler* mac_sched, PhyStats* in_phy_stats,
+      Stats* in_stats_manager, MessageInfo* message, HarqBuffer* harq_buffer);
+  ~DoDecode_Hybrid() override;
+
+  bool TryLaunch(moodycamel::ConcurrentQueue<EventData>& task_queue,
+                 moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                 moodycamel::ProducerToken* worker_ptok) override;
+  void LaunchEvent(const EventData& req_event,
+                   moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                   moodycamel::ProducerToken* worker_ptok) override;
+  bool Poll() override { return acc_->Poll(); }
+
+  void SetSharedCounters(SharedTaskCounters* shared_counters) override;
+  void SetTaps(DataTaps* taps) override;
+
+ private:
+  /// True if the next request goes to the CPU
+  bool Spill() const;
+
+  std::unique_ptr<DoDecode_ACC> acc_;
+  std::unique_ptr<DoDecode> cpu_;
+  Stats* stats_;
+  size_t spill_ops_;
+  double spill_latency_us_;
+
+  // Per path code blocks, and the CPU cycles of the spilled ones
+  size_t acc_blocks_ = 0;
+  size_t cpu_blocks_ = 0;
+  size_t cpu_cycles_ = 0;
+};
+
+#endif  // DODECODE_HYBRID_H_
+
+#endif  // USE_ACC100
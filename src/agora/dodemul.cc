@@ -6,92 +6,158 @@
 
 #include "comms-lib.h"
 #include "concurrent_queue_wrapper.h"
+#include "fixed_equalizer.h"
 #include "modulation.h"
+#include "packed_llr.h"
+#include "small_mimo_kernels.h"
+#include "tile_layout.h"
+#if defined(CELL_PROFILE)
+#include "cell_profile.h"
+#endif
+#if defined(USE_ACC100)
+#include "bbdev_device.h"
+#endif
 
 static constexpr bool kUseSIMDGather = true;
 static constexpr bool kCheckData = false;
 
+#if defined(__AVX512F__) && defined(__AVX512BW__) && \
+    defined(SIMD_MATOP) && !defined(USE_ACC100)
+// Equalize and soft-demodulate the 2x2/4x4 small-MIMO data symbols in one
+// pass, without writing the equalized symbols to memory
+static constexpr bool kUseFusedDemod =
+    (kExportConstellation == false) && (kUplinkHardDemod == false);
+
+/// Equalize (kAntNum x kAntNum) uplink data 8 subcarriers per register, apply
+/// the per-stream phase correction and write the soft-demodulated LLRs of
+/// stream i to demod_ptrs[i]. Reads the data in the tiles of TileLayout and
+/// the beams in the split layout of the small-MIMO path, beam (i, j) at
+/// ul_beam[(i * kAntNum + j) * sc_num].
+template <size_t kAntNum, size_t kModOrderBits>
+static void EqualizeDemodAvx512(const complex_float* data,
+                                const complex_float* ul_beam,
+                                const std::complex<float>* phase_correct,
+                                size_t sc_num, int8_t* const* demod_ptrs) {
+  std::array<__m512, kAntNum> ph;
+  for (size_t i = 0; i < kAntNum; i++) {
+    ph[i] = CommsLib::M512ComplexCf32Set1(phase_correct[i]);
+  }
+  for (size_t sc_idx = 0; sc_idx < sc_num; sc_idx += kSCsPerCacheline) {
+    std::array<__m512, kAntNum> b;
+    for (size_t j = 0; j < kAntNum; j++) {
+      b[j] = _mm512_loadu_ps(data +
+                             TileLayout::Index(sc_idx, j, kAntNum, sc_num));
+    }
+    for (size_t i = 0; i < kAntNum; i++) {
+      std::array<__m512, kAntNum> temp;
+      for (size_t j = 0; j < kAntNum; j++) {
+        temp[j] = CommsLib::M512ComplexCf32Mult(
+            _mm512_loadu_ps(ul_beam + (i * kAntNum + j) * sc_num + sc_idx),
+            b[j], false);
+      }
+      // Pairwise sum, in the same order as the unfused equalization
+      for (size_t step = 1; step < kAntNum; step *= 2) {
+        for (size_t j = 0; j + step < kAntNum; j += 2 * step) {
+          temp[j] = _mm512_add_ps(temp[j], temp[j + step]);
+        }
+      }
+      const __m512 c =
+          CommsLib::M512ComplexCf32Mult(temp[0], ph[i], false);
+      DemodSoftAvx512x8<kModOrderBits>(c,
+                                       demod_ptrs[i] + sc_idx * kModOrderBits);
+    }
+  }
+}
 
-#include <immintrin.h>
-#include <stddef.h>
-#include <stdint.h>
-
-// void TranslateToLLR_AVX512(const uint8_t* encoded_bits, int8_t* LLR, size_t bit_len) {
-//   size_t num_bytes = (bit_len + 7) / 8;  // Total number of bytes
-//   size_t full_chunks = num_bytes / 64;   // Process 64 bytes (512 bits) at a time
-//   size_t remaining_bytes = num_bytes % 64; // Bytes left after full 64-byte chunks
-
-//   // AVX512 constants
-//   __m512i bit_1_mask = _mm512_set1_epi8(0x01);  // Mask to extract bits
-//   __m512i llr_one = _mm512_set1_epi8(0x81);     // LLR value for bit 1
-//   __m512i llr_zero = _mm512_set1_epi8(0x7F);    // LLR value for bit 0
-
-//   // Process full 64-byte chunks
-//   for (size_t chunk = 0; chunk < full_chunks; ++chunk) {
-//     // Load 64 bytes from encoded_bits into a 512-bit AVX512 register
-//     __m512i byte_chunk = _mm512_loadu_si512((__m512i*)&encoded_bits[chunk * 64]);
-
-//     // Process each bit in the byte by comparing against 0x80, 0x40, 0x20, ..., 0x01
-//     for (int bit_shift = 7; bit_shift >= 0; --bit_shift) {
-//       // Create a mask for the current bit (shifting byte_chunk right by bit_shift)
-//       __m512i shifted_chunk = _mm512_srli_epi16(byte_chunk, bit_shift);
-//       __m512i bit_mask = _mm512_and_si512(shifted_chunk, bit_1_mask);
-
-//       // Use AVX512 mask compare to select 0x81 (LLR for bit 1) or 0x7F (LLR for bit 0)
-//       __m512i llr_result = _mm512_mask_blend_epi8(_mm512_cmp_epi8_mask(bit_mask, bit_1_mask, _MM_CMPINT_EQ), llr_zero, llr_one);
-
-//       // Store the result LLR values
-//       _mm512_storeu_si512((__m512i*)&LLR[(chunk * 64 * 8) + (7 - bit_shift) * 64], llr_result);
-//     }
-//   }
-
-//   // Handle remaining bytes (less than 64)
-//   if (remaining_bytes > 0) {
-//     // Process each remaining byte in a scalar loop (like the original implementation)
-//     size_t base_idx = full_chunks * 64;
-//     for (size_t byte_idx = 0; byte_idx < remaining_bytes; ++byte_idx) {
-//       uint8_t byte = encoded_bits[base_idx + byte_idx];
-
-//       LLR[base_idx * 8 + byte_idx * 8 + 0] = (byte & 0x80) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 1] = (byte & 0x40) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 2] = (byte & 0x20) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 3] = (byte & 0x10) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 4] = (byte & 0x08) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 5] = (byte & 0x04) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 6] = (byte & 0x02) ? 0x81 : 0x7F;
-//       LLR[base_idx * 8 + byte_idx * 8 + 7] = (byte & 0x01) ? 0x81 : 0x7F;
-//     }
-//   }
-// }
-
-
-void TranslateToLLR(const uint8_t* encoded_bits, int8_t* LLR, size_t bit_len) {
-  size_t num_full_bytes = bit_len / 8;  // Process full bytes
-  size_t remaining_bits = bit_len % 8;  // Handle remaining bits separately
-
-  // Process full bytes
-  for (size_t byte_idx = 0; byte_idx < num_full_bytes; ++byte_idx) {
-    uint8_t byte = encoded_bits[byte_idx];
-
-    LLR[byte_idx * 8 + 0] = (byte & 0x80) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 1] = (byte & 0x40) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 2] = (byte & 0x20) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 3] = (byte & 0x10) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 4] = (byte & 0x08) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 5] = (byte & 0x04) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 6] = (byte & 0x02) ? 0x81 : 0x7F;
-    LLR[byte_idx * 8 + 7] = (byte & 0x01) ? 0x81 : 0x7F;
+/// Dispatch EqualizeDemodAvx512 on the modulation order
+template <size_t kAntNum>
+static void EqualizeDemod(size_t mod_order_bits, const complex_float* data,
+                          const complex_float* ul_beam,
+                          const std::complex<float>* phase_correct,
+                          size_t sc_num, int8_t* const* demod_ptrs) {
+  switch (mod_order_bits) {
+    case CommsLib::kQpsk:
+      EqualizeDemodAvx512<kAntNum, CommsLib::kQpsk>(
+          data, ul_beam, phase_correct, sc_num, demod_ptrs);
+      break;
+    case CommsLib::kQaM16:
+      EqualizeDemodAvx512<kAntNum, CommsLib::kQaM16>(
+          data, ul_beam, phase_correct, sc_num, demod_ptrs);
+      break;
+    case CommsLib::kQaM64:
+      EqualizeDemodAvx512<kAntNum, CommsLib::kQaM64>(
+          data, ul_beam, phase_correct, sc_num, demod_ptrs);
+      break;
+    case CommsLib::kQaM256:
+      EqualizeDemodAvx512<kAntNum, CommsLib::kQaM256>(
+          data, ul_beam, phase_correct, sc_num, demod_ptrs);
+      break;
+    default:
+      std::printf("Demodulation: modulation type %s not supported!\n",
+                  MapModToStr(mod_order_bits).c_str());
   }
+}
+#else
+static constexpr bool kUseFusedDemod = false;
+#endif
 
-  // Handle remaining bits in the last byte, if any
-  if (remaining_bits > 0) {
-    uint8_t byte = encoded_bits[num_full_bytes];
-    for (size_t bit_idx = 0; bit_idx < remaining_bits; ++bit_idx) {
-      LLR[num_full_bytes * 8 + bit_idx] = (byte & (0x80 >> bit_idx)) ? 0x81 : 0x7F;
-    }
+/// Multiply the equalized symbols of kSCsPerCacheline subcarriers, interleaved
+/// by stream, by the phase correction of their stream. phase_pattern holds
+/// the correction of element e of equal, as filled by UpdatePhaseCorrection.
+static inline void DerotateStreams(complex_float* equal,
+                                   const complex_float* phase_pattern,
+                                   size_t num_streams) {
+#ifdef __AVX512F__
+  // kSCsPerCacheline complex floats per register, so one register per stream
+  for (size_t r = 0; r < num_streams; r++) {
+    const size_t offset = r * kSCsPerCacheline;
+    const __m512 rotated = CommsLib::M512ComplexCf32Mult(
+        _mm512_loadu_ps(equal + offset),
+        _mm512_load_ps(phase_pattern + offset), false);
+    _mm512_storeu_ps(equal + offset, rotated);
   }
+#else
+  for (size_t e = 0; e < kSCsPerCacheline * num_streams; e++) {
+    const std::complex<float> rotated =
+        std::complex<float>(equal[e].re, equal[e].im) *
+        std::complex<float>(phase_pattern[e].re, phase_pattern[e].im);
+    equal[e] = {rotated.real(), rotated.imag()};
+  }
+#endif
 }
 
+/// Add sign(equal * conj(pilot)) of kSCsPerCacheline subcarriers, interleaved
+/// by stream, to the per-element pilot correlation sums pilot_corr, with
+/// 1 / |equal * conj(pilot)| to precision
+static inline void AccumulatePilotCorr(const complex_float* equal,
+                                       const complex_float* pilot,
+                                       complex_float* pilot_corr,
+                                       size_t num_streams,
+                                       FastMath::Precision precision) {
+#ifdef __AVX512F__
+  for (size_t r = 0; r < num_streams; r++) {
+    const size_t offset = r * kSCsPerCacheline;
+    // conj(pilot) * equal
+    const __m512 corr = CommsLib::M512ComplexCf32Mult(
+        _mm512_load_ps(pilot + offset), _mm512_loadu_ps(equal + offset), true);
+    _mm512_store_ps(pilot_corr + offset,
+                    _mm512_add_ps(_mm512_load_ps(pilot_corr + offset),
+                                  CommsLib::M512ComplexCf32Sign(corr,
+                                                                precision)));
+  }
+#else
+  for (size_t e = 0; e < kSCsPerCacheline * num_streams; e++) {
+    const std::complex<float> corr =
+        std::complex<float>(equal[e].re, equal[e].im) *
+        std::conj(std::complex<float>(pilot[e].re, pilot[e].im));
+    const float corr_abs = std::abs(corr);
+    if (corr_abs > 0.0f) {
+      pilot_corr[e].re += corr.real() / corr_abs;
+      pilot_corr[e].im += corr.imag() / corr_abs;
+    }
+  }
+#endif
+}
 
 DoDemul::DoDemul(
     Config* config, int tid, Table<complex_float>& data_buffer,
@@ -104,47 +170,112 @@ DoDemul::DoDemul(
     MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* stats_manager)
     : Doer(config, tid),
       data_buffer_(data_buffer),
-      ul_beam_matrices_(ul_beam_matrices),
+      ul_beam_matrices_(ul_beam_matrices.Flat()),
       ue_spec_pilot_buffer_(ue_spec_pilot_buffer),
       equal_buffer_(equal_buffer),
-      demod_buffers_(demod_buffers),
+      demod_buffers_(demod_buffers.Flat()),
       ul_phase_base_(ul_phase_base),
       ul_phase_shift_per_symbol_(ul_phase_shift_per_symbol),
       mac_sched_(mac_sched),
-      phy_stats_(in_phy_stats) {
+      phy_stats_(in_phy_stats),
+      // The beamweights and UE pilots of a block in the 1x1 path
+      arena_(2 * Roundup<64>(config->DemulBlockSize() * sizeof(complex_float)),
+             scratch_policy_) {
   duration_stat_equal_ = stats_manager->GetDurationStat(DoerType::kEqual, tid);
   duration_stat_demul_ = stats_manager->GetDurationStat(DoerType::kDemul, tid);
+  alloc_stat_ = duration_stat_demul_;
 
   // Allocate memory for data_gather_buffer_. For general case (SIMD gather),
   // data_gather_buffer_ is refreshed for each subcarrier block (iteration).
   // Thus, size will be kSCsPerCacheline * kMaxAntennas.
   // For specialized (2x2/4x4) cases, we gather all subcarriers once and perform
   // vectorized operations. This will be faster for small, square MIMO matrices.
-  if (cfg_->SmallMimoAcc() &&  // enables special case acceleration
+  const bool small_mimo_batch =
+      cfg_->SmallMimoAcc() &&  // enables special case acceleration
       ((cfg_->UeAntNum() == 2 && cfg_->BsAntNum() == 2) ||
-       (cfg_->UeAntNum() == 4 && cfg_->BsAntNum() == 4))) {
+       (cfg_->UeAntNum() == 4 && cfg_->BsAntNum() == 4));
+  // The general path equalizes with one batch GEMM per block, from the
+  // beamweights in place
+  if (cfg_->GemmBatch() && (cfg_->SmallMimoAcc() == false) &&
+      (cfg_->BeamInterpolation() == false)) {
+    gemv_batch_ = std::make_unique<CgemvBatch>(
+        cfg_->SpatialStreamsNum(), cfg_->BsAntNum(), cfg_->DemulBlockSize());
+    beam_ptrs_.resize(cfg_->DemulBlockSize());
+    beam_group_sizes_.resize(cfg_->DemulBlockSize());
+    beam_stride_ = ul_beam_matrices_.CellStride();
+  }
+  if (small_mimo_batch || (gemv_batch_ != nullptr)) {
     data_gather_buffer_ =
         static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
             Agora_memory::Alignment_t::kAlign64,
-            cfg_->DemulBlockSize() * kMaxAntennas * sizeof(complex_float)));
+            cfg_->DemulBlockSize() * kMaxAntennas * sizeof(complex_float),
+            scratch_policy_));
   } else {
     data_gather_buffer_ =
         static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
             Agora_memory::Alignment_t::kAlign64,
-            kSCsPerCacheline * kMaxAntennas * sizeof(complex_float)));
+            kSCsPerCacheline * kMaxAntennas * sizeof(complex_float),
+            scratch_policy_));
   }
   equaled_buffer_temp_ =
       static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
           Agora_memory::Alignment_t::kAlign64,
-          cfg_->DemulBlockSize() * kMaxUEs * sizeof(complex_float)));
+          cfg_->DemulBlockSize() * kMaxUEs * sizeof(complex_float),
+          scratch_policy_));
   equaled_buffer_temp_transposed_ =
       static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
           Agora_memory::Alignment_t::kAlign64,
-          cfg_->DemulBlockSize() * kMaxUEs * sizeof(complex_float)));
+          cfg_->DemulBlockSize() * kMaxUEs * sizeof(complex_float),
+          scratch_policy_));
+#if defined(CELL_PROFILE)
+  cell_profile_match_ =
+      (cfg_->BsAntNum() == CellProfile::kBsAntNum) &&
+      (cfg_->SpatialStreamsNum() == CellProfile::kSpatialStreams);
+  if ((cell_profile_match_ == false) && (tid == 0)) {
+    AGORA_LOG_WARN(
+        "DoDemul: the config (%zu antennas, %zu streams) does not match the "
+        "cell profile of this build (%zu antennas, %zu streams). Using the "
+        "generic equalizer\n",
+        cfg_->BsAntNum(), cfg_->SpatialStreamsNum(), CellProfile::kBsAntNum,
+        CellProfile::kSpatialStreams);
+  }
+#endif
+
+#if defined(USE_ACC100)
+  // Probes the card once per device, usually already done for the coders
+  Bbdev::Setup(cfg_);
+  hard_llr_magnitude_ = Bbdev::HardLlrMagnitude(cfg_->BbdevDevId());
+#else
+  hard_llr_magnitude_ = kHardLlrMagnitude;
+#endif
+
+  interp_beam_ = nullptr;
+  if (cfg_->DemodLlrBits() != 8) {
+    llr_scratch_stride_ = Roundup<64>(kMaxModType * cfg_->DemulBlockSize());
+    llr_scratch_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        cfg_->SpatialStreamsNum() * llr_scratch_stride_, scratch_policy_));
+  }
+  if (cfg_->BeamInterpolation()) {
+    interp_beam_ =
+        static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            cfg_->BsAntNum() * cfg_->SpatialStreamsNum() *
+                sizeof(complex_float),
+            scratch_policy_));
+  }
+  const size_t phase_buffer_size =
+      kSCsPerCacheline * cfg_->SpatialStreamsNum() * sizeof(complex_float);
+  phase_pattern_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, phase_buffer_size, scratch_policy_));
+  pilot_gather_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, phase_buffer_size, scratch_policy_));
+  pilot_corr_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, phase_buffer_size, scratch_policy_));
 
   // phase offset calibration data
   arma::cx_float* ue_pilot_ptr =
-      reinterpret_cast<arma::cx_float*>(cfg_->UeSpecificPilot()[0]);
+      reinterpret_cast<arma::cx_float*>(cfg_->UeSpecificPilot(numa_node_)[0]);
   arma::cx_fmat mat_pilot_data(ue_pilot_ptr, cfg_->OfdmDataNum(),
                                cfg_->UeAntNum(), false);
   ue_pilot_data_ = mat_pilot_data.st();
@@ -172,9 +303,14 @@ DoDemul::DoDemul(
 }
 
 DoDemul::~DoDemul() {
-  std::free(data_gather_buffer_);
-  std::free(equaled_buffer_temp_);
-  std::free(equaled_buffer_temp_transposed_);
+  Agora_memory::PaddedAlignedFree(data_gather_buffer_);
+  Agora_memory::PaddedAlignedFree(equaled_buffer_temp_);
+  Agora_memory::PaddedAlignedFree(equaled_buffer_temp_transposed_);
+  Agora_memory::PaddedAlignedFree(phase_pattern_);
+  Agora_memory::PaddedAlignedFree(pilot_gather_);
+  Agora_memory::PaddedAlignedFree(pilot_corr_);
+  Agora_memory::PaddedAlignedFree(interp_beam_);
+  Agora_memory::PaddedAlignedFree(llr_scratch_);
 
 #if defined(USE_MKL_JIT)
   mkl_jit_status_t status = mkl_jit_destroy(jitter_);
@@ -184,6 +320,238 @@ DoDemul::~DoDemul() {
 #endif
 }
 
+complex_float* DoDemul::InterpolateUlBeam(size_t frame_slot, size_t sc_id) {
+  const size_t low_sc_id = cfg_->GetBeamScId(sc_id);
+  const size_t high_sc_id = low_sc_id + cfg_->BeamScStride();
+  complex_float* low_beam = ul_beam_matrices_[frame_slot][low_sc_id];
+  // The subcarriers after the last beam grid subcarrier keep its beamweights
+  if ((interp_beam_ == nullptr) || (sc_id == low_sc_id) ||
+      (high_sc_id >= cfg_->OfdmDataNum())) {
+    return low_beam;
+  }
+  const complex_float* high_beam = ul_beam_matrices_[frame_slot][high_sc_id];
+  const float frac = static_cast<float>(sc_id - low_sc_id) /
+                     static_cast<float>(cfg_->BeamScStride());
+  const size_t mat_size = cfg_->BsAntNum() * cfg_->SpatialStreamsNum();
+  for (size_t i = 0; i < mat_size; i++) {
+    interp_beam_[i].re =
+        low_beam[i].re + (frac * (high_beam[i].re - low_beam[i].re));
+    interp_beam_[i].im =
+        low_beam[i].im + (frac * (high_beam[i].im - low_beam[i].im));
+  }
+  return interp_beam_;
+}
+
+int8_t* DoDemul::LlrOut(size_t frame_slot, size_t symbol_idx_ul, size_t ss_id,
+                        size_t base_sc_id, size_t mod_order_bits) {
+  if (llr_scratch_ != nullptr) {
+    return llr_scratch_ + (ss_id * llr_scratch_stride_);
+  }
+  return demod_buffers_[frame_slot][symbol_idx_ul][ss_id] +
+         (mod_order_bits * base_sc_id);
+}
+
+void DoDemul::PackBlockLlrs(size_t frame_slot, size_t symbol_idx_ul,
+                            size_t base_sc_id, size_t num_scs,
+                            size_t mod_order_bits) {
+  // base_sc_id is a multiple of demul_block_size, so the block starts on a
+  // chunk
+  const size_t packed_offset =
+      PackedLlrBytes(mod_order_bits * base_sc_id, cfg_->DemodLlrBits());
+  for (size_t ss_id = 0; ss_id < cfg_->SpatialStreamsNum(); ss_id++) {
+    PackLlrs(llr_scratch_ + (ss_id * llr_scratch_stride_),
+             reinterpret_cast<uint8_t*>(
+                 demod_buffers_[frame_slot][symbol_idx_ul][ss_id]) +
+                 packed_offset,
+             num_scs * mod_order_bits, cfg_->DemodLlrBits());
+  }
+}
+
+void DoDemul::UpdatePhaseCorrection(size_t frame_slot, size_t symbol_idx_ul) {
+  const size_t num_streams = cfg_->SpatialStreamsNum();
+  const size_t num_pilots = cfg_->Frame().ClientUlPilotSymbols();
+  // Column s holds the pilot correlation of each stream in pilot symbol s
+  const complex_float* pilot_corr = ue_spec_pilot_buffer_[frame_slot];
+  std::array<complex_float, kMaxUEs> phase_correct;
+  for (size_t ss = 0; ss < num_streams; ss++) {
+    const float theta_first =
+        std::atan2(pilot_corr[ss].im, pilot_corr[ss].re);
+    const complex_float last = pilot_corr[(num_pilots - 1) * num_streams + ss];
+    // The mean phase increment between consecutive pilot symbols
+    const float theta_inc = (std::atan2(last.im, last.re) - theta_first) /
+                            static_cast<float>(std::max<size_t>(
+                                1, num_pilots - 1));
+    const float cur_theta = theta_first + (symbol_idx_ul * theta_inc);
+    phase_correct.at(ss) = {std::cos(-cur_theta), std::sin(-cur_theta)};
+  }
+  for (size_t e = 0; e < kSCsPerCacheline * num_streams; e++) {
+    phase_pattern_[e] = phase_correct.at(e % num_streams);
+  }
+}
+
+void DoDemul::EqualizeBatch(size_t frame_slot, size_t base_sc_id,
+                            size_t num_scs, complex_float* equal) {
+  if (cfg_->BeamScStride() == 1) {
+    // Every subcarrier has its own beam matrix, evenly spaced in the backing
+    // buffer
+    gemv_batch_->RunStrided(ul_beam_matrices_[frame_slot][base_sc_id],
+                            beam_stride_, data_gather_buffer_, equal,
+                            num_scs);
+    return;
+  }
+  // One GEMM per group of subcarriers sharing a beam matrix, instead of
+  // one gathered beam pointer per subcarrier
+  size_t num_groups = 0;
+  for (size_t k = 0; k < num_scs; num_groups++) {
+    const size_t beam_sc_id = cfg_->GetBeamScId(base_sc_id + k);
+    const size_t group_scs = std::min(
+        beam_sc_id + cfg_->BeamScStride() - (base_sc_id + k), num_scs - k);
+    beam_ptrs_[num_groups] = ul_beam_matrices_[frame_slot][beam_sc_id];
+    beam_group_sizes_[num_groups] = group_scs;
+    k += group_scs;
+  }
+  gemv_batch_->RunGroups(beam_ptrs_.data(), beam_group_sizes_.data(),
+                         num_groups, data_gather_buffer_, equal);
+}
+
+void DoDemul::GatherData(const complex_float* data_buf, size_t sc_id,
+                         complex_float* gather) {
+  // Since kSCsPerCacheline divides demul_block_size and
+  // kTransposeBlockSize, the subcarriers lie in the same partial transpose
+  // block.
+  const size_t partial_transpose_block_base =
+      TileLayout::TileBase(sc_id, cfg_->BsAntNum());
+
+#ifdef __AVX512F__
+  static constexpr size_t kAntNumPerSimd = 8;
+#else
+  static constexpr size_t kAntNumPerSimd = 4;
+#endif
+
+  size_t ant_start = 0;
+  if (kUseSIMDGather && kUsePartialTrans &&
+      (cfg_->BsAntNum() % kAntNumPerSimd) == 0) {
+    // Gather data for all antennas and 8 subcarriers in the same cache
+    // line, 1 subcarrier and 4 (AVX2) or 8 (AVX512) ants per iteration
+    size_t cur_sc_offset =
+        partial_transpose_block_base + sc_id % kTransposeBlockSize;
+    const float* src =
+        reinterpret_cast<const float*>(&data_buf[cur_sc_offset]);
+    float* dst = reinterpret_cast<float*>(gather);
+#ifdef __AVX512F__
+    __m512i index = _mm512_setr_epi32(
+        0, 1, kTransposeBlockSize * 2, kTransposeBlockSize * 2 + 1,
+        kTransposeBlockSize * 4, kTransposeBlockSize * 4 + 1,
+        kTransposeBlockSize * 6, kTransposeBlockSize * 6 + 1,
+        kTransposeBlockSize * 8, kTransposeBlockSize * 8 + 1,
+        kTransposeBlockSize * 10, kTransposeBlockSize * 10 + 1,
+        kTransposeBlockSize * 12, kTransposeBlockSize * 12 + 1,
+        kTransposeBlockSize * 14, kTransposeBlockSize * 14 + 1);
+    for (size_t ant_i = 0; ant_i < cfg_->BsAntNum();
+         ant_i += kAntNumPerSimd) {
+      for (size_t j = 0; j < kSCsPerCacheline; j++) {
+        __m512 data_rx =
+            kTransposeBlockSize == 1
+                ? _mm512_load_ps(&src[j * cfg_->BsAntNum() * 2])
+                : _mm512_i32gather_ps(index, &src[j * 2], 4);
+
+        assert((reinterpret_cast<intptr_t>(&dst[j * cfg_->BsAntNum() * 2]) %
+                (kAntNumPerSimd * sizeof(float) * 2)) == 0);
+        assert((reinterpret_cast<intptr_t>(&src[j * cfg_->BsAntNum() * 2]) %
+                (kAntNumPerSimd * sizeof(float) * 2)) == 0);
+        _mm512_store_ps(&dst[j * cfg_->BsAntNum() * 2], data_rx);
+      }
+      src += kAntNumPerSimd * kTransposeBlockSize * 2;
+      dst += kAntNumPerSimd * 2;
+    }
+#else
+    __m256i index = _mm256_setr_epi32(
+        0, 1, kTransposeBlockSize * 2, kTransposeBlockSize * 2 + 1,
+        kTransposeBlockSize * 4, kTransposeBlockSize * 4 + 1,
+        kTransposeBlockSize * 6, kTransposeBlockSize * 6 + 1);
+    for (size_t ant_i = 0; ant_i < cfg_->BsAntNum();
+         ant_i += kAntNumPerSimd) {
+      for (size_t j = 0; j < kSCsPerCacheline; j++) {
+        assert((reinterpret_cast<intptr_t>(&dst[j * cfg_->BsAntNum() * 2]) %
+                (kAntNumPerSimd * sizeof(float) * 2)) == 0);
+        __m256 data_rx = _mm256_i32gather_ps(&src[j * 2], index, 4);
+        _mm256_store_ps(&dst[j * cfg_->BsAntNum() * 2], data_rx);
+      }
+      src += kAntNumPerSimd * kTransposeBlockSize * 2;
+      dst += kAntNumPerSimd * 2;
+    }
+#endif
+    // Set the remaining number of antennas for non-SIMD gather
+    ant_start = cfg_->BsAntNum() - (cfg_->BsAntNum() % kAntNumPerSimd);
+  }
+  if (ant_start < cfg_->BsAntNum()) {
+    complex_float* dst = gather + ant_start;
+    for (size_t j = 0; j < kSCsPerCacheline; j++) {
+      for (size_t ant_i = ant_start; ant_i < cfg_->BsAntNum(); ant_i++) {
+        *dst++ = data_buf[TileLayout::Index(sc_id + j, ant_i, cfg_->BsAntNum(),
+                                            cfg_->OfdmDataNum())];
+      }
+    }
+  }
+}
+
+void DoDemul::PrefetchTask(size_t tag) {
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  const size_t symbol_idx_ul =
+      cfg_->Frame().GetULSymbolIdx(gen_tag_t(tag).symbol_id_);
+  const size_t base_sc_id = gen_tag_t(tag).sc_id_;
+  const ScheduleSnapshot& schedule = mac_sched_->Schedule(frame_id);
+  // Launch() skips the block
+  if ((base_sc_id >= schedule.ul_num_sc_) &&
+      (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols())) {
+    return;
+  }
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t num_scs =
+      std::min(cfg_->DemulBlockSize(), cfg_->OfdmDataNum() - base_sc_id);
+  const size_t num_ants = cfg_->BsAntNum();
+  const complex_float* data_buf =
+      data_buffer_[cfg_->GetTotalDataSymbolIdxUl(frame_id, symbol_idx_ul)];
+  if (kUsePartialTrans) {
+    // The tiles of the block are contiguous
+    const size_t first = TileLayout::TileBase(base_sc_id, num_ants);
+    const size_t end =
+        TileLayout::TileBase(base_sc_id + num_scs - 1, num_ants) +
+        (TileLayout::kTileScs * num_ants);
+    PrefetchRange(data_buf + first, (end - first) * sizeof(complex_float),
+                  false);
+  } else {
+    for (size_t ant = 0; ant < num_ants; ant++) {
+      PrefetchRange(data_buf + (ant * cfg_->OfdmDataNum()) + base_sc_id,
+                    num_scs * sizeof(complex_float), false);
+    }
+  }
+
+  // The beam matrices of the general path, one cell per beam subcarrier.
+  // The small_mimo_acc paths keep their own layout of the beamweights.
+  if ((cfg_->SmallMimoAcc() == false) && (ul_beam_int16_ == nullptr)) {
+    const complex_float* first_beam =
+        ul_beam_matrices_[frame_slot][cfg_->GetBeamScId(base_sc_id)];
+    const complex_float* end_beam =
+        ul_beam_matrices_[frame_slot]
+                         [cfg_->GetBeamScId(base_sc_id + num_scs - 1)] +
+        (num_ants * cfg_->SpatialStreamsNum());
+    PrefetchRange(first_beam,
+                  (end_beam - first_beam) * sizeof(complex_float), false);
+  }
+
+  // Packed LLRs go through llr_scratch_, which the current task keeps hot
+  if (llr_scratch_ == nullptr) {
+    const size_t mod_order_bits =
+        cfg_->Mcs(Direction::kUplink, schedule.phy_ul_mcs_).mod_order_bits_;
+    for (size_t ss_id = 0; ss_id < cfg_->SpatialStreamsNum(); ss_id++) {
+      PrefetchRange(
+          LlrOut(frame_slot, symbol_idx_ul, ss_id, base_sc_id, mod_order_bits),
+          num_scs * mod_order_bits, true);
+    }
+  }
+}
+
 EventData DoDemul::Launch(size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
@@ -194,7 +562,12 @@ EventData DoDemul::Launch(size_t tag) {
       cfg_->GetTotalDataSymbolIdxUl(frame_id, symbol_idx_ul);
   const complex_float* data_buf = data_buffer_[total_data_symbol_idx_ul];
 
-  const size_t frame_slot = frame_id % kFrameWnd;
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  arena_.Reset();
+  // The modulation of the frame's MCS, from the precomputed MCS parameters
+  const size_t mod_order_bits =
+      cfg_->Mcs(Direction::kUplink, mac_sched_->Schedule(frame_id).phy_ul_mcs_)
+          .mod_order_bits_;
   size_t start_equal_tsc = GetTime::WorkerRdtsc();
 
   if (kDebugPrintInTask == true) {
@@ -205,10 +578,32 @@ EventData DoDemul::Launch(size_t tag) {
         total_data_symbol_idx_ul);
   }
 
+  // No code block of the frame's grants is past its uplink subcarriers. The
+  // pilot symbols are equalized in full for the phase tracking.
+  if ((base_sc_id >= mac_sched_->Schedule(frame_id).ul_num_sc_) &&
+      (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols())) {
+    return EventData(EventType::kDemul, tag);
+  }
+
   size_t max_sc_ite =
       std::min(cfg_->DemulBlockSize(), cfg_->OfdmDataNum() - base_sc_id);
   assert(max_sc_ite % kSCsPerCacheline == 0);
 
+  // The data symbols of the vectorized 2x2/4x4 paths are equalized and
+  // demodulated in one pass (pilot symbols still need the equalized data)
+  const bool demod_fused =
+      kUseFusedDemod && cfg_->SmallMimoAcc() &&
+      ((cfg_->UeAntNum() == 2 && cfg_->BsAntNum() == 2) ||
+       (cfg_->UeAntNum() == 4 && cfg_->BsAntNum() == 4)) &&
+      (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols());
+  std::array<int8_t*, kMaxUEs> demod_ptrs;
+  if (demod_fused) {
+    for (size_t ss_id = 0; ss_id < cfg_->SpatialStreamsNum(); ss_id++) {
+      demod_ptrs[ss_id] = LlrOut(frame_slot, symbol_idx_ul, ss_id,
+                                 base_sc_id, mod_order_bits);
+    }
+  }
+
   if (cfg_->SmallMimoAcc()) {  // enables special case acceleration
     // Accelerate (vectorized computation) 1x1 antenna config
     if (cfg_->UeAntNum() == 1 && cfg_->BsAntNum() == 1) {
@@ -231,26 +626,41 @@ EventData DoDemul::Launch(size_t tag) {
 
       // assuming cfg->BsAntNum() == 1, reducing a dimension
       arma::cx_fvec vec_data(data_ptr, max_sc_ite, false);
-      arma::cx_fvec vec_ul_beam(max_sc_ite);  // init empty vec
-      for (size_t i = 0; i < max_sc_ite; ++i) {
-        vec_ul_beam(i) = ul_beam_ptr[cfg_->GetBeamScId(base_sc_id + i)];
-      }
 
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
+#if defined(SIMD_MATOP)
       const complex_float* ptr_data =
           reinterpret_cast<const complex_float*>(data_ptr);
       const complex_float* ptr_ul_beam =
-          reinterpret_cast<const complex_float*>(vec_ul_beam.memptr());
+          reinterpret_cast<const complex_float*>(ul_beam_ptr);
       complex_float* ptr_equaled = reinterpret_cast<complex_float*>(equal_ptr);
-      for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
-        __m512 reg_data = _mm512_loadu_ps(ptr_data + i);
-        __m512 reg_ul_beam = _mm512_loadu_ps(ptr_ul_beam + i);
-        __m512 reg_equaled =
-            CommsLib::M512ComplexCf32Mult(reg_data, reg_ul_beam, false);
-        _mm512_storeu_ps(ptr_equaled + i, reg_equaled);
+      if (cfg_->BeamScStride() == 1) {
+        const complex_float* ptr_beam = ptr_ul_beam + base_sc_id;
+        SmallMimo::Get().equalize_[SmallMimo::DimIndex(1)](
+            ptr_beam, ptr_data, SmallMimo::TileChunks(1, max_sc_ite),
+            &ptr_equaled, max_sc_ite);
+      } else {
+        // One broadcast beam per group of subcarriers
+        for (size_t i = 0; i < max_sc_ite;) {
+          const size_t beam_sc_id = cfg_->GetBeamScId(base_sc_id + i);
+          const size_t group_scs =
+              std::min(beam_sc_id + cfg_->BeamScStride() - (base_sc_id + i),
+                       max_sc_ite - i);
+          SmallMimo::Get().equalize_group_(ptr_ul_beam[beam_sc_id],
+                                           ptr_data + i, ptr_equaled + i,
+                                           group_scs);
+          i += group_scs;
+        }
       }
 #else
-      vec_equaled = vec_ul_beam % vec_data;
+      for (size_t i = 0; i < max_sc_ite;) {
+        const size_t beam_sc_id = cfg_->GetBeamScId(base_sc_id + i);
+        const size_t group_scs =
+            std::min(beam_sc_id + cfg_->BeamScStride() - (base_sc_id + i),
+                     max_sc_ite - i);
+        vec_equaled.subvec(i, i + group_scs - 1) =
+            ul_beam_ptr[beam_sc_id] * vec_data.subvec(i, i + group_scs - 1);
+        i += group_scs;
+      }
 #endif
 
       size_t start_equal_tsc2 = GetTime::WorkerRdtsc();
@@ -264,7 +674,7 @@ EventData DoDemul::Launch(size_t tag) {
         // Reset previous frame
         if (symbol_idx_ul == 0 && base_sc_id == 0) {
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[(frame_id - 1) % kFrameWnd]);
+              ue_spec_pilot_buffer_[(frame_id - 1) % cfg_->FrameWindow()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(),
                                         cfg_->Frame().ClientUlPilotSymbols(),
                                         false);
@@ -274,11 +684,14 @@ EventData DoDemul::Launch(size_t tag) {
         // Calc new phase shift
         if (symbol_idx_ul < cfg_->Frame().ClientUlPilotSymbols()) {
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
-          arma::cx_fvec vec_ue_pilot_data_ =
+          arma::cx_fvec vec_ue_pilot_data_(
+              arena_.Alloc<arma::cx_float>(max_sc_ite), max_sc_ite, false,
+              true);
+          vec_ue_pilot_data_ =
               vec_pilot_data.subvec(base_sc_id, base_sc_id + max_sc_ite - 1);
 
           mat_phase_shift += sum(vec_equaled % conj(vec_ue_pilot_data_));
@@ -293,7 +706,7 @@ EventData DoDemul::Launch(size_t tag) {
         if (symbol_idx_ul == cfg_->Frame().ClientUlPilotSymbols() &&
             base_sc_id == 0) {
           arma::cx_float* pilot_corr_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[frame_id % kFrameWnd]);
+              ue_spec_pilot_buffer_[frame_slot]);
           arma::cx_fvec pilot_corr_vec(
               pilot_corr_ptr, cfg_->Frame().ClientUlPilotSymbols(), false);
           theta_vec = arg(pilot_corr_vec);
@@ -301,8 +714,8 @@ EventData DoDemul::Launch(size_t tag) {
                         theta_vec(0);
           // theta_inc /= (float)std::max(
           //     1, static_cast<int>(cfg_->Frame().ClientUlPilotSymbols() - 1));
-          ul_phase_base_[frame_id % kFrameWnd] = theta_vec.t();
-          ul_phase_shift_per_symbol_[frame_id % kFrameWnd](0, 0) = theta_inc_f;
+          ul_phase_base_[frame_slot] = theta_vec.t();
+          ul_phase_shift_per_symbol_[frame_slot](0, 0) = theta_inc_f;
         }
 
         // Apply previously calc'ed phase shift to data
@@ -313,14 +726,13 @@ EventData DoDemul::Launch(size_t tag) {
           vec_equaled *= arma::cx_float(cos(-cur_theta_f), sin(-cur_theta_f));
 
 #if !defined(TIME_EXCLUSIVE)
-          auto ue_list = mac_sched_->ScheduledUeList(frame_id, base_sc_id);
           const size_t data_symbol_idx_ul =
               symbol_idx_ul - this->cfg_->Frame().ClientUlPilotSymbols();
-          // Measure EVM from ground truth
-          for (size_t i = 0; i < max_sc_ite; i++) {
-            phy_stats_->UpdateEvm(frame_id, data_symbol_idx_ul, i,
-                                  vec_equaled.subvec(i, i), ue_list);
-          }
+          // Measure EVM from ground truth, of the single stream
+          phy_stats_->UpdateEvmBlock(
+              frame_id, data_symbol_idx_ul, base_sc_id, max_sc_ite,
+              reinterpret_cast<const complex_float*>(vec_equaled.memptr()),
+              mac_sched_->Schedule(frame_id).ue_list_.data(), 1, numa_node_);
 #endif
         }
       }
@@ -342,52 +754,32 @@ EventData DoDemul::Launch(size_t tag) {
                                  false);
       // cub_equaled.print("cub_equaled");
 
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
+#if defined(SIMD_MATOP)
       // Step 0: Prepare pointers
       arma::cx_frowvec vec_equal_0 = arma::zeros<arma::cx_frowvec>(max_sc_ite);
       arma::cx_frowvec vec_equal_1 = arma::zeros<arma::cx_frowvec>(max_sc_ite);
-      complex_float* ptr_equal_0 =
-          reinterpret_cast<complex_float*>(vec_equal_0.memptr());
-      complex_float* ptr_equal_1 =
-          reinterpret_cast<complex_float*>(vec_equal_1.memptr());
+      complex_float* const equal_ptrs[2] = {
+          reinterpret_cast<complex_float*>(vec_equal_0.memptr()),
+          reinterpret_cast<complex_float*>(vec_equal_1.memptr())};
+      // Phase correction of the fused demodulation (identity without pilots)
+      std::array<std::complex<float>, 2> fused_ph_corr;
+      fused_ph_corr.fill({1.0f, 0.0f});
 
       complex_float* ul_beam_ptr = ul_beam_matrices_[frame_slot][0];
-      const complex_float* ptr_a_1_1 = ul_beam_ptr;
-      const complex_float* ptr_a_1_2 = ul_beam_ptr + max_sc_ite;
-      const complex_float* ptr_a_2_1 = ul_beam_ptr + 2 * max_sc_ite;
-      const complex_float* ptr_a_2_2 = ul_beam_ptr + 3 * max_sc_ite;
-
-      const complex_float* data_ptr = data_buf;
-      const complex_float* ptr_b_1 = data_ptr;
-      const complex_float* ptr_b_2 = data_ptr + max_sc_ite;
-
-      complex_float* ptr_c_1 = ptr_equal_0;
-      complex_float* ptr_c_2 = ptr_equal_1;
+      const SmallMimo::Kernels& small_mimo = SmallMimo::Get();
 
       size_t start_equal_tsc1 = GetTime::WorkerRdtsc();
       duration_stat_equal_->task_duration_[1] +=
           start_equal_tsc1 - start_equal_tsc0;
 
       // Step 1: Equalization
-      for (size_t sc_idx = 0; sc_idx < max_sc_ite; sc_idx += kSCsPerCacheline) {
-        // vec_equal_0 (vec_c_1) = vec_a_1_1 % vec_b_1 + vec_a_1_2 % vec_b_2;
-        // vec_equal_1 (vec_c_2) = vec_a_2_1 % vec_b_1 + vec_a_2_2 % vec_b_2;
-        __m512 b_1 = _mm512_loadu_ps(ptr_b_1 + sc_idx);
-        __m512 b_2 = _mm512_loadu_ps(ptr_b_2 + sc_idx);
-
-        __m512 a_1_1 = _mm512_loadu_ps(ptr_a_1_1 + sc_idx);
-        __m512 a_1_2 = _mm512_loadu_ps(ptr_a_1_2 + sc_idx);
-        __m512 c_1 = CommsLib::M512ComplexCf32Mult(a_1_1, b_1, false);
-        __m512 temp = CommsLib::M512ComplexCf32Mult(a_1_2, b_2, false);
-        c_1 = _mm512_add_ps(c_1, temp);
-        _mm512_storeu_ps(ptr_c_1 + sc_idx, c_1);
-
-        __m512 a_2_1 = _mm512_loadu_ps(ptr_a_2_1 + sc_idx);
-        __m512 a_2_2 = _mm512_loadu_ps(ptr_a_2_2 + sc_idx);
-        __m512 c_2 = CommsLib::M512ComplexCf32Mult(a_2_1, b_1, false);
-        temp = CommsLib::M512ComplexCf32Mult(a_2_2, b_2, false);
-        c_2 = _mm512_add_ps(c_2, temp);
-        _mm512_storeu_ps(ptr_c_2 + sc_idx, c_2);
+      // (done together with the demodulation when fused)
+      if (demod_fused == false) {
+        // vec_equal_0 = vec_a_1_1 % vec_b_1 + vec_a_1_2 % vec_b_2;
+        // vec_equal_1 = vec_a_2_1 % vec_b_1 + vec_a_2_2 % vec_b_2;
+        small_mimo.equalize_[SmallMimo::DimIndex(2)](
+            ul_beam_ptr, data_buf, SmallMimo::TileChunks(2, max_sc_ite),
+            equal_ptrs, max_sc_ite);
       }
       // delay storing to cub_equaled to avoid frequent avx512-armadillo conversion
 #elif defined(ARMA_VEC_MATOP)
@@ -420,17 +812,12 @@ EventData DoDemul::Launch(size_t tag) {
       // Step 0: Re-arrange data
       complex_float* dst = data_gather_buffer_;
       for (size_t i = 0; i < max_sc_ite; i++) {
-        const size_t partial_transpose_block_base =
-            ((base_sc_id + i) / kTransposeBlockSize) *
-            (kTransposeBlockSize * cfg_->BsAntNum());
         // Populate data_gather_buffer as a row-major matrix with max_sc_ite rows
         // and BsAntNum() columns
         for (size_t ant_i = 0; ant_i < cfg_->BsAntNum(); ant_i++) {
-          *dst++ = kUsePartialTrans
-                       ? data_buf[partial_transpose_block_base +
-                                  (ant_i * kTransposeBlockSize) +
-                                  ((base_sc_id + i) % kTransposeBlockSize)]
-                       : data_buf[ant_i * cfg_->OfdmDataNum() + base_sc_id + i];
+          *dst++ = data_buf[TileLayout::Index(base_sc_id + i, ant_i,
+                                              cfg_->BsAntNum(),
+                                              cfg_->OfdmDataNum())];
         }
       }
       arma::cx_float* data_ptr =
@@ -499,7 +886,7 @@ EventData DoDemul::Launch(size_t tag) {
         if (symbol_idx_ul == 0 && base_sc_id == 0) {
           // Reset previous frame
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[(frame_id - 1) % kFrameWnd]);
+              ue_spec_pilot_buffer_[(frame_id - 1) % cfg_->FrameWindow()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(),
                                         cfg_->Frame().ClientUlPilotSymbols(),
                                         false);
@@ -508,37 +895,24 @@ EventData DoDemul::Launch(size_t tag) {
 
         // Calc new phase shift
         if (symbol_idx_ul < cfg_->Frame().ClientUlPilotSymbols()) {
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
-          complex_float* ue_pilot_ptr =
-              reinterpret_cast<complex_float*>(cfg_->UeSpecificPilot()[0]);
-          complex_float* ptr_ue_pilot_0 = ue_pilot_ptr;
-          complex_float* ptr_ue_pilot_1 = ue_pilot_ptr + max_sc_ite;
-
-          __m512 sum_0 = _mm512_setzero_ps();
-          __m512 sum_1 = _mm512_setzero_ps();
-          for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
-            __m512 ue_0 = _mm512_loadu_ps(ptr_ue_pilot_0 + i);
-            __m512 eq_0 = _mm512_loadu_ps(ptr_equal_0 + i);
-            __m512 temp = CommsLib::M512ComplexCf32Conj(ue_0);
-            temp = CommsLib::M512ComplexCf32Mult(temp, eq_0, false);
-            sum_0 = _mm512_add_ps(sum_0, temp);
-
-            __m512 ue_1 = _mm512_loadu_ps(ptr_ue_pilot_1 + i);
-            __m512 eq_1 = _mm512_loadu_ps(ptr_equal_1 + i);
-            temp = CommsLib::M512ComplexCf32Conj(ue_1);
-            temp = CommsLib::M512ComplexCf32Mult(temp, eq_1, false);
-            sum_1 = _mm512_add_ps(sum_1, temp);
-          }
+#if defined(SIMD_MATOP)
+          const complex_float* ue_pilot_ptr =
+              reinterpret_cast<const complex_float*>(
+                  cfg_->UeSpecificPilot(numa_node_)[0]);
 
           std::complex<float>* phase_shift_ptr =
               reinterpret_cast<std::complex<float>*>(
-                  &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+                  &ue_spec_pilot_buffer_[frame_slot]
                                         [symbol_idx_ul * cfg_->UeAntNum()]);
-          *phase_shift_ptr += CommsLib::M512ComplexCf32Sum(sum_0);
-          *(phase_shift_ptr + 1) += CommsLib::M512ComplexCf32Sum(sum_1);
+          for (size_t i = 0; i < 2; i++) {
+            // sum(vec_equal_i % conj(vec_ue_pilot_i))
+            const complex_float sum = small_mimo.pilot_corr_(
+                equal_ptrs[i], ue_pilot_ptr + i * max_sc_ite, max_sc_ite);
+            phase_shift_ptr[i] += std::complex<float>(sum.re, sum.im);
+          }
 #elif defined(ARMA_VEC_MATOP)
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
@@ -555,7 +929,7 @@ EventData DoDemul::Launch(size_t tag) {
               vec_equal_1 % arma::conj(mat_ue_pilot_data_.row(1).st()));
 #elif defined(ARMA_CUBE_MATOP)
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
@@ -573,7 +947,7 @@ EventData DoDemul::Launch(size_t tag) {
               vec_tube_equal_1 % arma::conj(mat_ue_pilot_data_.row(1)));
 #else
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
@@ -616,7 +990,7 @@ EventData DoDemul::Launch(size_t tag) {
         if (symbol_idx_ul == cfg_->Frame().ClientUlPilotSymbols() &&
             base_sc_id == 0) {
           arma::cx_float* pilot_corr_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[frame_id % kFrameWnd]);
+              ue_spec_pilot_buffer_[frame_slot]);
           arma::cx_fmat pilot_corr_mat(pilot_corr_ptr, cfg_->UeAntNum(),
                                        cfg_->Frame().ClientUlPilotSymbols(),
                                        false);
@@ -625,33 +999,28 @@ EventData DoDemul::Launch(size_t tag) {
                       theta_mat.col(0);
           // theta_inc /= (float)std::max(
           //     1, static_cast<int>(cfg_->Frame().ClientUlPilotSymbols() - 1));
-          ul_phase_base_[frame_id % kFrameWnd] = theta_mat;
-          ul_phase_shift_per_symbol_[frame_id % kFrameWnd] = theta_inc;
+          ul_phase_base_[frame_slot] = theta_mat;
+          ul_phase_shift_per_symbol_[frame_slot] = theta_inc;
         }
 
         // Apply previously calc'ed phase shift to data
         if (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols()) {
-          theta_mat = ul_phase_base_[frame_id % kFrameWnd];
-          theta_inc = ul_phase_shift_per_symbol_[frame_id % kFrameWnd];
+          theta_mat = ul_phase_base_[frame_slot];
+          theta_inc = ul_phase_shift_per_symbol_[frame_slot];
           arma::fmat cur_theta = theta_mat.col(0) + (symbol_idx_ul * theta_inc);
           arma::cx_fmat mat_phase_correct =
               arma::cx_fmat(cos(-cur_theta), sin(-cur_theta));
 
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
-          __m512 ph_corr_0 =
-              CommsLib::M512ComplexCf32Set1(mat_phase_correct(0, 0));
-          __m512 ph_corr_1 =
-              CommsLib::M512ComplexCf32Set1(mat_phase_correct(1, 0));
-
-          // CommsLib::PrintM512ComplexCf32(ph_corr_0);
-          // CommsLib::PrintM512ComplexCf32(ph_corr_1);
-          for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
-            __m512 eq_0 = _mm512_loadu_ps(ptr_equal_0 + i);
-            __m512 eq_1 = _mm512_loadu_ps(ptr_equal_1 + i);
-            eq_0 = CommsLib::M512ComplexCf32Mult(eq_0, ph_corr_0, false);
-            eq_1 = CommsLib::M512ComplexCf32Mult(eq_1, ph_corr_1, false);
-            _mm512_storeu_ps(ptr_equal_0 + i, eq_0);
-            _mm512_storeu_ps(ptr_equal_1 + i, eq_1);
+#if defined(SIMD_MATOP)
+          for (size_t i = 0; i < 2; i++) {
+            const std::complex<float> ph_corr = mat_phase_correct(i, 0);
+            if (demod_fused) {
+              fused_ph_corr[i] = ph_corr;
+            } else {
+              small_mimo.rotate_(equal_ptrs[i],
+                                 {ph_corr.real(), ph_corr.imag()},
+                                 max_sc_ite);
+            }
           }
 #elif defined(ARMA_VEC_MATOP)
           vec_equal_0 *= mat_phase_correct(0, 0);
@@ -666,10 +1035,20 @@ EventData DoDemul::Launch(size_t tag) {
         }
       }
 
-#if (defined(__AVX512F__) && defined(AVX512_MATOP)) || defined(ARMA_VEC_MATOP)
-      // store back to Armadillo matrix
-      cub_equaled.tube(0, 0) = vec_equal_0;
-      cub_equaled.tube(1, 0) = vec_equal_1;
+#if defined(__AVX512F__) && defined(__AVX512BW__) && \
+    defined(SIMD_MATOP) && !defined(USE_ACC100)
+      if (demod_fused) {
+        EqualizeDemod<2>(mod_order_bits, data_buf,
+                          ul_beam_ptr, fused_ph_corr.data(), max_sc_ite,
+                          demod_ptrs.data());
+      }
+#endif
+#if defined(SIMD_MATOP) || defined(ARMA_VEC_MATOP)
+      if (demod_fused == false) {
+        // store back to Armadillo matrix
+        cub_equaled.tube(0, 0) = vec_equal_0;
+        cub_equaled.tube(1, 0) = vec_equal_1;
+      }
 #endif
       duration_stat_equal_->task_count_++;
       duration_stat_equal_->task_duration_[3] +=
@@ -690,115 +1069,35 @@ EventData DoDemul::Launch(size_t tag) {
                                  false);
       // cub_equaled.print("cub_equaled");
 
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
+#if defined(SIMD_MATOP)
       // Step 0: Prepare pointers
       arma::cx_frowvec vec_equal_0 = arma::zeros<arma::cx_frowvec>(max_sc_ite);
       arma::cx_frowvec vec_equal_1 = arma::zeros<arma::cx_frowvec>(max_sc_ite);
       arma::cx_frowvec vec_equal_2 = arma::zeros<arma::cx_frowvec>(max_sc_ite);
       arma::cx_frowvec vec_equal_3 = arma::zeros<arma::cx_frowvec>(max_sc_ite);
-      complex_float* ptr_equal_0 =
-          reinterpret_cast<complex_float*>(vec_equal_0.memptr());
-      complex_float* ptr_equal_1 =
-          reinterpret_cast<complex_float*>(vec_equal_1.memptr());
-      complex_float* ptr_equal_2 =
-          reinterpret_cast<complex_float*>(vec_equal_2.memptr());
-      complex_float* ptr_equal_3 =
-          reinterpret_cast<complex_float*>(vec_equal_3.memptr());
-
-      // Prepare operand pointers for core equalization
+      complex_float* const equal_ptrs[4] = {
+          reinterpret_cast<complex_float*>(vec_equal_0.memptr()),
+          reinterpret_cast<complex_float*>(vec_equal_1.memptr()),
+          reinterpret_cast<complex_float*>(vec_equal_2.memptr()),
+          reinterpret_cast<complex_float*>(vec_equal_3.memptr())};
+      // Phase correction of the fused demodulation (identity without pilots)
+      std::array<std::complex<float>, 4> fused_ph_corr;
+      fused_ph_corr.fill({1.0f, 0.0f});
+
       complex_float* ul_beam_ptr = ul_beam_matrices_[frame_slot][0];
-      const complex_float* ptr_a_1_1 = ul_beam_ptr;
-      const complex_float* ptr_a_1_2 = ul_beam_ptr + max_sc_ite;
-      const complex_float* ptr_a_1_3 = ul_beam_ptr + 2 * max_sc_ite;
-      const complex_float* ptr_a_1_4 = ul_beam_ptr + 3 * max_sc_ite;
-      const complex_float* ptr_a_2_1 = ul_beam_ptr + 4 * max_sc_ite;
-      const complex_float* ptr_a_2_2 = ul_beam_ptr + 5 * max_sc_ite;
-      const complex_float* ptr_a_2_3 = ul_beam_ptr + 6 * max_sc_ite;
-      const complex_float* ptr_a_2_4 = ul_beam_ptr + 7 * max_sc_ite;
-      const complex_float* ptr_a_3_1 = ul_beam_ptr + 8 * max_sc_ite;
-      const complex_float* ptr_a_3_2 = ul_beam_ptr + 9 * max_sc_ite;
-      const complex_float* ptr_a_3_3 = ul_beam_ptr + 10 * max_sc_ite;
-      const complex_float* ptr_a_3_4 = ul_beam_ptr + 11 * max_sc_ite;
-      const complex_float* ptr_a_4_1 = ul_beam_ptr + 12 * max_sc_ite;
-      const complex_float* ptr_a_4_2 = ul_beam_ptr + 13 * max_sc_ite;
-      const complex_float* ptr_a_4_3 = ul_beam_ptr + 14 * max_sc_ite;
-      const complex_float* ptr_a_4_4 = ul_beam_ptr + 15 * max_sc_ite;
-
-      const complex_float* data_ptr = data_buf;
-      const complex_float* ptr_b_1 = data_ptr;
-      const complex_float* ptr_b_2 = data_ptr + max_sc_ite;
-      const complex_float* ptr_b_3 = data_ptr + 2 * max_sc_ite;
-      const complex_float* ptr_b_4 = data_ptr + 3 * max_sc_ite;
-
-      complex_float* ptr_c_1 = ptr_equal_0;
-      complex_float* ptr_c_2 = ptr_equal_1;
-      complex_float* ptr_c_3 = ptr_equal_2;
-      complex_float* ptr_c_4 = ptr_equal_3;
+      const SmallMimo::Kernels& small_mimo = SmallMimo::Get();
 
       size_t start_equal_tsc1 = GetTime::WorkerRdtsc();
       duration_stat_equal_->task_duration_[1] +=
           start_equal_tsc1 - start_equal_tsc0;
 
       // Step 1: Equalization
-      // Each AVX512 register can hold
-      //   16 floats = 8 complex floats = 1 kSCsPerCacheline
-      for (size_t sc_idx = 0; sc_idx < max_sc_ite; sc_idx += kSCsPerCacheline) {
-        __m512 b_1 = _mm512_loadu_ps(ptr_b_1 + sc_idx);
-        __m512 b_2 = _mm512_loadu_ps(ptr_b_2 + sc_idx);
-        __m512 b_3 = _mm512_loadu_ps(ptr_b_3 + sc_idx);
-        __m512 b_4 = _mm512_loadu_ps(ptr_b_4 + sc_idx);
-
-        __m512 a_1_1 = _mm512_loadu_ps(ptr_a_1_1 + sc_idx);
-        __m512 a_1_2 = _mm512_loadu_ps(ptr_a_1_2 + sc_idx);
-        __m512 a_1_3 = _mm512_loadu_ps(ptr_a_1_3 + sc_idx);
-        __m512 a_1_4 = _mm512_loadu_ps(ptr_a_1_4 + sc_idx);
-        __m512 temp_1 = CommsLib::M512ComplexCf32Mult(a_1_1, b_1, false);
-        __m512 temp_2 = CommsLib::M512ComplexCf32Mult(a_1_2, b_2, false);
-        __m512 temp_3 = CommsLib::M512ComplexCf32Mult(a_1_3, b_3, false);
-        __m512 temp_4 = CommsLib::M512ComplexCf32Mult(a_1_4, b_4, false);
-        temp_1 = _mm512_add_ps(temp_1, temp_2);
-        temp_3 = _mm512_add_ps(temp_3, temp_4);
-        __m512 c_1 = _mm512_add_ps(temp_1, temp_3);
-        _mm512_storeu_ps(ptr_c_1 + sc_idx, c_1);
-
-        __m512 a_2_1 = _mm512_loadu_ps(ptr_a_2_1 + sc_idx);
-        __m512 a_2_2 = _mm512_loadu_ps(ptr_a_2_2 + sc_idx);
-        __m512 a_2_3 = _mm512_loadu_ps(ptr_a_2_3 + sc_idx);
-        __m512 a_2_4 = _mm512_loadu_ps(ptr_a_2_4 + sc_idx);
-        temp_1 = CommsLib::M512ComplexCf32Mult(a_2_1, b_1, false);
-        temp_2 = CommsLib::M512ComplexCf32Mult(a_2_2, b_2, false);
-        temp_3 = CommsLib::M512ComplexCf32Mult(a_2_3, b_3, false);
-        temp_4 = CommsLib::M512ComplexCf32Mult(a_2_4, b_4, false);
-        temp_1 = _mm512_add_ps(temp_1, temp_2);
-        temp_3 = _mm512_add_ps(temp_3, temp_4);
-        __m512 c_2 = _mm512_add_ps(temp_1, temp_3);
-        _mm512_storeu_ps(ptr_c_2 + sc_idx, c_2);
-
-        __m512 a_3_1 = _mm512_loadu_ps(ptr_a_3_1 + sc_idx);
-        __m512 a_3_2 = _mm512_loadu_ps(ptr_a_3_2 + sc_idx);
-        __m512 a_3_3 = _mm512_loadu_ps(ptr_a_3_3 + sc_idx);
-        __m512 a_3_4 = _mm512_loadu_ps(ptr_a_3_4 + sc_idx);
-        temp_1 = CommsLib::M512ComplexCf32Mult(a_3_1, b_1, false);
-        temp_2 = CommsLib::M512ComplexCf32Mult(a_3_2, b_2, false);
-        temp_3 = CommsLib::M512ComplexCf32Mult(a_3_3, b_3, false);
-        temp_4 = CommsLib::M512ComplexCf32Mult(a_3_4, b_4, false);
-        temp_1 = _mm512_add_ps(temp_1, temp_2);
-        temp_3 = _mm512_add_ps(temp_3, temp_4);
-        __m512 c_3 = _mm512_add_ps(temp_1, temp_3);
-        _mm512_storeu_ps(ptr_c_3 + sc_idx, c_3);
-
-        __m512 a_4_1 = _mm512_loadu_ps(ptr_a_4_1 + sc_idx);
-        __m512 a_4_2 = _mm512_loadu_ps(ptr_a_4_2 + sc_idx);
-        __m512 a_4_3 = _mm512_loadu_ps(ptr_a_4_3 + sc_idx);
-        __m512 a_4_4 = _mm512_loadu_ps(ptr_a_4_4 + sc_idx);
-        temp_1 = CommsLib::M512ComplexCf32Mult(a_4_1, b_1, false);
-        temp_2 = CommsLib::M512ComplexCf32Mult(a_4_2, b_2, false);
-        temp_3 = CommsLib::M512ComplexCf32Mult(a_4_3, b_3, false);
-        temp_4 = CommsLib::M512ComplexCf32Mult(a_4_4, b_4, false);
-        temp_1 = _mm512_add_ps(temp_1, temp_2);
-        temp_3 = _mm512_add_ps(temp_3, temp_4);
-        __m512 c_4 = _mm512_add_ps(temp_1, temp_3);
-        _mm512_storeu_ps(ptr_c_4 + sc_idx, c_4);
+      // (done together with the demodulation when fused)
+      if (demod_fused == false) {
+        // vec_equal_i = sum_j vec_a_i_j % vec_b_j
+        small_mimo.equalize_[SmallMimo::DimIndex(4)](
+            ul_beam_ptr, data_buf, SmallMimo::TileChunks(4, max_sc_ite),
+            equal_ptrs, max_sc_ite);
       }
 #elif defined(ARMA_VEC_MATOP)
       // Step 0: Re-arrange data
@@ -864,17 +1163,12 @@ EventData DoDemul::Launch(size_t tag) {
       // Step 0: Re-arrange data
       complex_float* dst = data_gather_buffer_;
       for (size_t i = 0; i < max_sc_ite; i++) {
-        const size_t partial_transpose_block_base =
-            ((base_sc_id + i) / kTransposeBlockSize) *
-            (kTransposeBlockSize * cfg_->BsAntNum());
         // Populate data_gather_buffer as a row-major matrix with max_sc_ite rows
         // and BsAntNum() columns
         for (size_t ant_i = 0; ant_i < cfg_->BsAntNum(); ant_i++) {
-          *dst++ = kUsePartialTrans
-                       ? data_buf[partial_transpose_block_base +
-                                  (ant_i * kTransposeBlockSize) +
-                                  ((base_sc_id + i) % kTransposeBlockSize)]
-                       : data_buf[ant_i * cfg_->OfdmDataNum() + base_sc_id + i];
+          *dst++ = data_buf[TileLayout::Index(base_sc_id + i, ant_i,
+                                              cfg_->BsAntNum(),
+                                              cfg_->OfdmDataNum())];
         }
       }
       arma::cx_float* data_ptr =
@@ -970,7 +1264,7 @@ EventData DoDemul::Launch(size_t tag) {
         if (symbol_idx_ul == 0 && base_sc_id == 0) {
           // Reset previous frame
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[(frame_id - 1) % kFrameWnd]);
+              ue_spec_pilot_buffer_[(frame_id - 1) % cfg_->FrameWindow()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(),
                                         cfg_->Frame().ClientUlPilotSymbols(),
                                         false);
@@ -979,55 +1273,24 @@ EventData DoDemul::Launch(size_t tag) {
 
         // Calc new phase shift
         if (symbol_idx_ul < cfg_->Frame().ClientUlPilotSymbols()) {
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
-          complex_float* ue_pilot_ptr =
-              reinterpret_cast<complex_float*>(cfg_->UeSpecificPilot()[0]);
-          complex_float* ptr_ue_pilot_0 = ue_pilot_ptr;
-          complex_float* ptr_ue_pilot_1 = ue_pilot_ptr + max_sc_ite;
-          complex_float* ptr_ue_pilot_2 = ue_pilot_ptr + 2 * max_sc_ite;
-          complex_float* ptr_ue_pilot_3 = ue_pilot_ptr + 3 * max_sc_ite;
-
-          __m512 sum_0 = _mm512_setzero_ps();
-          __m512 sum_1 = _mm512_setzero_ps();
-          __m512 sum_2 = _mm512_setzero_ps();
-          __m512 sum_3 = _mm512_setzero_ps();
-          for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
-            __m512 ue_0 = _mm512_loadu_ps(ptr_ue_pilot_0 + i);
-            __m512 eq_0 = _mm512_loadu_ps(ptr_equal_0 + i);
-            __m512 temp = CommsLib::M512ComplexCf32Conj(ue_0);
-            temp = CommsLib::M512ComplexCf32Mult(temp, eq_0, false);
-            sum_0 = _mm512_add_ps(sum_0, temp);
-
-            __m512 ue_1 = _mm512_loadu_ps(ptr_ue_pilot_1 + i);
-            __m512 eq_1 = _mm512_loadu_ps(ptr_equal_1 + i);
-            temp = CommsLib::M512ComplexCf32Conj(ue_1);
-            temp = CommsLib::M512ComplexCf32Mult(temp, eq_1, false);
-            sum_1 = _mm512_add_ps(sum_1, temp);
-
-            __m512 ue_2 = _mm512_loadu_ps(ptr_ue_pilot_2 + i);
-            __m512 eq_2 = _mm512_loadu_ps(ptr_equal_2 + i);
-            temp = CommsLib::M512ComplexCf32Conj(ue_2);
-            temp = CommsLib::M512ComplexCf32Mult(temp, eq_2, false);
-            sum_2 = _mm512_add_ps(sum_2, temp);
-
-            __m512 ue_3 = _mm512_loadu_ps(ptr_ue_pilot_3 + i);
-            __m512 eq_3 = _mm512_loadu_ps(ptr_equal_3 + i);
-            temp = CommsLib::M512ComplexCf32Conj(ue_3);
-            temp = CommsLib::M512ComplexCf32Mult(temp, eq_3, false);
-            sum_3 = _mm512_add_ps(sum_3, temp);
-          }
+#if defined(SIMD_MATOP)
+          const complex_float* ue_pilot_ptr =
+              reinterpret_cast<const complex_float*>(
+                  cfg_->UeSpecificPilot(numa_node_)[0]);
 
           std::complex<float>* phase_shift_ptr =
               reinterpret_cast<std::complex<float>*>(
-                  &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+                  &ue_spec_pilot_buffer_[frame_slot]
                                         [symbol_idx_ul * cfg_->UeAntNum()]);
-          *phase_shift_ptr += CommsLib::M512ComplexCf32Sum(sum_0);
-          *(phase_shift_ptr + 1) += CommsLib::M512ComplexCf32Sum(sum_1);
-          *(phase_shift_ptr + 2) += CommsLib::M512ComplexCf32Sum(sum_2);
-          *(phase_shift_ptr + 3) += CommsLib::M512ComplexCf32Sum(sum_3);
+          for (size_t i = 0; i < 4; i++) {
+            // sum(vec_equal_i % conj(vec_ue_pilot_i))
+            const complex_float sum = small_mimo.pilot_corr_(
+                equal_ptrs[i], ue_pilot_ptr + i * max_sc_ite, max_sc_ite);
+            phase_shift_ptr[i] += std::complex<float>(sum.re, sum.im);
+          }
 #elif defined(ARMA_VEC_MATOP)
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
@@ -1048,7 +1311,7 @@ EventData DoDemul::Launch(size_t tag) {
               vec_equal_3 % arma::conj(mat_ue_pilot_data_.row(3).st()));
 #elif defined(ARMA_CUBE_MATOP)
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
@@ -1072,7 +1335,7 @@ EventData DoDemul::Launch(size_t tag) {
               vec_tube_equal_3 % arma::conj(mat_ue_pilot_data_.row(3)));
 #else
           arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
+              &ue_spec_pilot_buffer_[frame_slot]
                                     [symbol_idx_ul * cfg_->UeAntNum()]);
           arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
                                         false);
@@ -1111,7 +1374,7 @@ EventData DoDemul::Launch(size_t tag) {
         if (symbol_idx_ul == cfg_->Frame().ClientUlPilotSymbols() &&
             base_sc_id == 0) {
           arma::cx_float* pilot_corr_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[frame_id % kFrameWnd]);
+              ue_spec_pilot_buffer_[frame_slot]);
           arma::cx_fmat pilot_corr_mat(pilot_corr_ptr, cfg_->UeAntNum(),
                                        cfg_->Frame().ClientUlPilotSymbols(),
                                        false);
@@ -1120,41 +1383,28 @@ EventData DoDemul::Launch(size_t tag) {
                       theta_mat.col(0);
           // theta_inc /= (float)std::max(
           //     1, static_cast<int>(cfg_->Frame().ClientUlPilotSymbols() - 1));
-          ul_phase_base_[frame_id % kFrameWnd] = theta_mat;
-          ul_phase_shift_per_symbol_[frame_id % kFrameWnd] = theta_inc;
+          ul_phase_base_[frame_slot] = theta_mat;
+          ul_phase_shift_per_symbol_[frame_slot] = theta_inc;
         }
 
         // Apply previously calc'ed phase shift to data
         if (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols()) {
-          theta_mat = ul_phase_base_[frame_id % kFrameWnd];
-          theta_inc = ul_phase_shift_per_symbol_[frame_id % kFrameWnd];
+          theta_mat = ul_phase_base_[frame_slot];
+          theta_inc = ul_phase_shift_per_symbol_[frame_slot];
           arma::fmat cur_theta = theta_mat.col(0) + (symbol_idx_ul * theta_inc);
           arma::cx_fmat mat_phase_correct =
               arma::cx_fmat(cos(-cur_theta), sin(-cur_theta));
 
-#if defined(__AVX512F__) && defined(AVX512_MATOP)
-          __m512 ph_corr_0 =
-              CommsLib::M512ComplexCf32Set1(mat_phase_correct(0, 0));
-          __m512 ph_corr_1 =
-              CommsLib::M512ComplexCf32Set1(mat_phase_correct(1, 0));
-          __m512 ph_corr_2 =
-              CommsLib::M512ComplexCf32Set1(mat_phase_correct(2, 0));
-          __m512 ph_corr_3 =
-              CommsLib::M512ComplexCf32Set1(mat_phase_correct(3, 0));
-
-          for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
-            __m512 eq_0 = _mm512_loadu_ps(ptr_equal_0 + i);
-            __m512 eq_1 = _mm512_loadu_ps(ptr_equal_1 + i);
-            __m512 eq_2 = _mm512_loadu_ps(ptr_equal_2 + i);
-            __m512 eq_3 = _mm512_loadu_ps(ptr_equal_3 + i);
-            eq_0 = CommsLib::M512ComplexCf32Mult(eq_0, ph_corr_0, false);
-            eq_1 = CommsLib::M512ComplexCf32Mult(eq_1, ph_corr_1, false);
-            eq_2 = CommsLib::M512ComplexCf32Mult(eq_2, ph_corr_2, false);
-            eq_3 = CommsLib::M512ComplexCf32Mult(eq_3, ph_corr_3, false);
-            _mm512_storeu_ps(ptr_equal_0 + i, eq_0);
-            _mm512_storeu_ps(ptr_equal_1 + i, eq_1);
-            _mm512_storeu_ps(ptr_equal_2 + i, eq_2);
-            _mm512_storeu_ps(ptr_equal_3 + i, eq_3);
+#if defined(SIMD_MATOP)
+          for (size_t i = 0; i < 4; i++) {
+            const std::complex<float> ph_corr = mat_phase_correct(i, 0);
+            if (demod_fused) {
+              fused_ph_corr[i] = ph_corr;
+            } else {
+              small_mimo.rotate_(equal_ptrs[i],
+                                 {ph_corr.real(), ph_corr.imag()},
+                                 max_sc_ite);
+            }
           }
 #elif defined(ARMA_VEC_MATOP)
           vec_equal_0 *= mat_phase_correct(0, 0);
@@ -1170,12 +1420,22 @@ EventData DoDemul::Launch(size_t tag) {
         }
       }
 
-#if (defined(__AVX512F__) && defined(AVX512_MATOP)) || defined(ARMA_VEC_MATOP)
-      // store back to Armadillo matrix
-      cub_equaled.tube(0, 0) = vec_equal_0;
-      cub_equaled.tube(1, 0) = vec_equal_1;
-      cub_equaled.tube(2, 0) = vec_equal_2;
-      cub_equaled.tube(3, 0) = vec_equal_3;
+#if defined(__AVX512F__) && defined(__AVX512BW__) && \
+    defined(SIMD_MATOP) && !defined(USE_ACC100)
+      if (demod_fused) {
+        EqualizeDemod<4>(mod_order_bits, data_buf,
+                          ul_beam_ptr, fused_ph_corr.data(), max_sc_ite,
+                          demod_ptrs.data());
+      }
+#endif
+#if defined(SIMD_MATOP) || defined(ARMA_VEC_MATOP)
+      if (demod_fused == false) {
+        // store back to Armadillo matrix
+        cub_equaled.tube(0, 0) = vec_equal_0;
+        cub_equaled.tube(1, 0) = vec_equal_1;
+        cub_equaled.tube(2, 0) = vec_equal_2;
+        cub_equaled.tube(3, 0) = vec_equal_3;
+      }
 #endif
 
       duration_stat_equal_->task_count_++;
@@ -1183,95 +1443,60 @@ EventData DoDemul::Launch(size_t tag) {
           GetTime::WorkerRdtsc() - start_equal_tsc2;
     }
   } else {
+    const size_t num_streams = cfg_->SpatialStreamsNum();
+    const size_t num_ul_pilots = cfg_->Frame().ClientUlPilotSymbols();
+    const bool pilot_symbol = (symbol_idx_ul < num_ul_pilots);
+    if (pilot_symbol) {
+      if (symbol_idx_ul == 0 && base_sc_id == 0) {
+        // Reset previous frame
+        std::memset(ue_spec_pilot_buffer_[(frame_id - 1) % cfg_->FrameWindow()],
+                    0, num_streams * num_ul_pilots * sizeof(complex_float));
+      }
+      std::memset(pilot_corr_, 0,
+                  kSCsPerCacheline * num_streams * sizeof(complex_float));
+    } else if (num_ul_pilots > 0) {
+      // The phase correction only depends on the symbol and the stream, so
+      // it is computed once per task instead of once per subcarrier
+      UpdatePhaseCorrection(frame_slot, symbol_idx_ul);
+    }
+
+    // The whole block is gathered and equalized with one batch GEMM, so the
+    // loop below only tracks the phase
+    const bool gemm_batched = (gemv_batch_ != nullptr) &&
+                              (ul_beam_int16_ == nullptr) &&
+                              (cell_profile_match_ == false);
+    if (gemm_batched) {
+      size_t start_equal_tsc0 = GetTime::WorkerRdtsc();
+      for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
+        GatherData(data_buf, base_sc_id + i,
+                   data_gather_buffer_ + i * cfg_->BsAntNum());
+      }
+      size_t start_equal_tsc1 = GetTime::WorkerRdtsc();
+      duration_stat_equal_->task_duration_[1] +=
+          start_equal_tsc1 - start_equal_tsc0;
+      EqualizeBatch(frame_slot, base_sc_id, max_sc_ite,
+                    kExportConstellation
+                        ? &equal_buffer_[total_data_symbol_idx_ul]
+                                        [base_sc_id * num_streams]
+                        : equaled_buffer_temp_);
+      duration_stat_equal_->task_duration_[2] +=
+          GetTime::WorkerRdtsc() - start_equal_tsc1;
+    }
+
+    size_t group_beam_sc_id = 0;
+    size_t next_group_sc_id = 0;
     // Iterate through cache lines
     for (size_t i = 0; i < max_sc_ite; i += kSCsPerCacheline) {
       size_t start_equal_tsc0 = GetTime::WorkerRdtsc();
 
       // Step 1: Populate data_gather_buffer as a row-major matrix with
-      // kSCsPerCacheline rows and BsAntNum() columns
-
-      // Since kSCsPerCacheline divides demul_block_size and
-      // kTransposeBlockSize, all subcarriers (base_sc_id + i) lie in the
-      // same partial transpose block.
-      const size_t partial_transpose_block_base =
-          ((base_sc_id + i) / kTransposeBlockSize) *
-          (kTransposeBlockSize * cfg_->BsAntNum());
-
-#ifdef __AVX512F__
-      static constexpr size_t kAntNumPerSimd = 8;
-#else
-      static constexpr size_t kAntNumPerSimd = 4;
-#endif
-
-      size_t ant_start = 0;
-      if (kUseSIMDGather && kUsePartialTrans &&
-          (cfg_->BsAntNum() % kAntNumPerSimd) == 0) {
-        // Gather data for all antennas and 8 subcarriers in the same cache
-        // line, 1 subcarrier and 4 (AVX2) or 8 (AVX512) ants per iteration
-        size_t cur_sc_offset = partial_transpose_block_base +
-                               (base_sc_id + i) % kTransposeBlockSize;
-        const float* src =
-            reinterpret_cast<const float*>(&data_buf[cur_sc_offset]);
-        float* dst = reinterpret_cast<float*>(data_gather_buffer_);
-#ifdef __AVX512F__
-        __m512i index = _mm512_setr_epi32(
-            0, 1, kTransposeBlockSize * 2, kTransposeBlockSize * 2 + 1,
-            kTransposeBlockSize * 4, kTransposeBlockSize * 4 + 1,
-            kTransposeBlockSize * 6, kTransposeBlockSize * 6 + 1,
-            kTransposeBlockSize * 8, kTransposeBlockSize * 8 + 1,
-            kTransposeBlockSize * 10, kTransposeBlockSize * 10 + 1,
-            kTransposeBlockSize * 12, kTransposeBlockSize * 12 + 1,
-            kTransposeBlockSize * 14, kTransposeBlockSize * 14 + 1);
-        for (size_t ant_i = 0; ant_i < cfg_->BsAntNum();
-             ant_i += kAntNumPerSimd) {
-          for (size_t j = 0; j < kSCsPerCacheline; j++) {
-            __m512 data_rx =
-                kTransposeBlockSize == 1
-                    ? _mm512_load_ps(&src[j * cfg_->BsAntNum() * 2])
-                    : _mm512_i32gather_ps(index, &src[j * 2], 4);
-
-            assert((reinterpret_cast<intptr_t>(&dst[j * cfg_->BsAntNum() * 2]) %
-                    (kAntNumPerSimd * sizeof(float) * 2)) == 0);
-            assert((reinterpret_cast<intptr_t>(&src[j * cfg_->BsAntNum() * 2]) %
-                    (kAntNumPerSimd * sizeof(float) * 2)) == 0);
-            _mm512_store_ps(&dst[j * cfg_->BsAntNum() * 2], data_rx);
-          }
-          src += kAntNumPerSimd * kTransposeBlockSize * 2;
-          dst += kAntNumPerSimd * 2;
-        }
-#else
-        __m256i index = _mm256_setr_epi32(
-            0, 1, kTransposeBlockSize * 2, kTransposeBlockSize * 2 + 1,
-            kTransposeBlockSize * 4, kTransposeBlockSize * 4 + 1,
-            kTransposeBlockSize * 6, kTransposeBlockSize * 6 + 1);
-        for (size_t ant_i = 0; ant_i < cfg_->BsAntNum();
-             ant_i += kAntNumPerSimd) {
-          for (size_t j = 0; j < kSCsPerCacheline; j++) {
-            assert((reinterpret_cast<intptr_t>(&dst[j * cfg_->BsAntNum() * 2]) %
-                    (kAntNumPerSimd * sizeof(float) * 2)) == 0);
-            __m256 data_rx = _mm256_i32gather_ps(&src[j * 2], index, 4);
-            _mm256_store_ps(&dst[j * cfg_->BsAntNum() * 2], data_rx);
-          }
-          src += kAntNumPerSimd * kTransposeBlockSize * 2;
-          dst += kAntNumPerSimd * 2;
-        }
-#endif
-        // Set the remaining number of antennas for non-SIMD gather
-        ant_start = cfg_->BsAntNum() - (cfg_->BsAntNum() % kAntNumPerSimd);
-      }
-      if (ant_start < cfg_->BsAntNum()) {
-        complex_float* dst = data_gather_buffer_ + ant_start;
-        for (size_t j = 0; j < kSCsPerCacheline; j++) {
-          for (size_t ant_i = ant_start; ant_i < cfg_->BsAntNum(); ant_i++) {
-            *dst++ =
-                kUsePartialTrans
-                    ? data_buf[partial_transpose_block_base +
-                               (ant_i * kTransposeBlockSize) +
-                               ((base_sc_id + i + j) % kTransposeBlockSize)]
-                    : data_buf[ant_i * cfg_->OfdmDataNum() + base_sc_id + i +
-                               j];
-          }
-        }
+      // kSCsPerCacheline rows and BsAntNum() columns, unless the block was
+      // gathered for the batch GEMM
+      complex_float* gathered = data_gather_buffer_;
+      if (gemm_batched) {
+        gathered += i * cfg_->BsAntNum();
+      } else {
+        GatherData(data_buf, base_sc_id + i, gathered);
       }
 
       size_t start_equal_tsc1 = GetTime::WorkerRdtsc();
@@ -1299,88 +1524,127 @@ EventData DoDemul::Launch(size_t tag) {
                                   false);
 
         arma::cx_float* data_ptr = reinterpret_cast<arma::cx_float*>(
-            &data_gather_buffer_[j * cfg_->BsAntNum()]);
+            &gathered[j * cfg_->BsAntNum()]);
+        // The beam subcarrier only changes at the start of a group
+        if (cur_sc_id >= next_group_sc_id) {
+          group_beam_sc_id = cfg_->GetBeamScId(cur_sc_id);
+          next_group_sc_id = group_beam_sc_id + cfg_->BeamScStride();
+        }
         arma::cx_float* ul_beam_ptr = reinterpret_cast<arma::cx_float*>(
-            ul_beam_matrices_[frame_slot][cfg_->GetBeamScId(cur_sc_id)]);
-
+            interp_beam_ == nullptr
+                ? ul_beam_matrices_[frame_slot][group_beam_sc_id]
+                : InterpolateUlBeam(frame_slot, cur_sc_id));
+
+        if (ul_beam_int16_ != nullptr) {
+          Int16Equalizer::Equalize(
+              (*ul_beam_int16_)[frame_slot][group_beam_sc_id],
+              (*ul_beam_scales_)[frame_slot][group_beam_sc_id],
+              reinterpret_cast<const float*>(data_ptr), num_streams,
+              cfg_->BsAntNum(), int16_scratch_.data(),
+              reinterpret_cast<float*>(equal_ptr));
+#if defined(CELL_PROFILE)
+        } else if (cell_profile_match_) {
+          FixedEqualizer::Equalize<CellProfile::kSpatialStreams,
+                                   CellProfile::kBsAntNum>(
+              reinterpret_cast<const float*>(ul_beam_ptr),
+              reinterpret_cast<const float*>(data_ptr),
+              reinterpret_cast<float*>(equal_ptr));
+#endif
+        } else if (gemm_batched == false) {
 #if defined(USE_MKL_JIT)
-        mkl_jit_cgemm_(jitter_, (MKL_Complex8*)ul_beam_ptr,
-                       (MKL_Complex8*)data_ptr, (MKL_Complex8*)equal_ptr);
+          mkl_jit_cgemm_(jitter_, (MKL_Complex8*)ul_beam_ptr,
+                         (MKL_Complex8*)data_ptr, (MKL_Complex8*)equal_ptr);
 #else
-        arma::cx_fmat mat_data(data_ptr, cfg_->BsAntNum(), 1, false);
+          arma::cx_fmat mat_data(data_ptr, cfg_->BsAntNum(), 1, false);
 
-        arma::cx_fmat mat_ul_beam(ul_beam_ptr, cfg_->SpatialStreamsNum(),
-                                  cfg_->BsAntNum(), false);
-        mat_equaled = mat_ul_beam * mat_data;
+          arma::cx_fmat mat_ul_beam(ul_beam_ptr, cfg_->SpatialStreamsNum(),
+                                    cfg_->BsAntNum(), false);
+          mat_equaled = mat_ul_beam * mat_data;
 #endif
+        }
         size_t start_equal_tsc3 = GetTime::WorkerRdtsc();
         duration_stat_equal_->task_duration_[2] +=
             start_equal_tsc3 - start_equal_tsc2;
-        auto ue_list = mac_sched_->ScheduledUeList(frame_id, cur_sc_id);
-        if (symbol_idx_ul <
-            cfg_->Frame().ClientUlPilotSymbols()) {  // Calc new phase shift
-          if (symbol_idx_ul == 0 && cur_sc_id == 0) {
-            // Reset previous frame
-            arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-                ue_spec_pilot_buffer_[(frame_id - 1) % kFrameWnd]);
-            arma::cx_fmat mat_phase_shift(
-                phase_shift_ptr, cfg_->SpatialStreamsNum(),
-                cfg_->Frame().ClientUlPilotSymbols(), false);
-            mat_phase_shift.fill(0);
-          }
-          arma::cx_float* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
-              &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
-                                    [symbol_idx_ul *
-                                     cfg_->SpatialStreamsNum()]);
-          arma::cx_fmat mat_phase_shift(phase_shift_ptr,
-                                        cfg_->SpatialStreamsNum(), 1, false);
-
-          arma::cx_fvec cur_sc_pilot_data = ue_pilot_data_.col(cur_sc_id);
-          arma::cx_fmat shift_sc =
-              arma::sign(mat_equaled % conj(cur_sc_pilot_data(ue_list)));
-          mat_phase_shift += shift_sc;
+        if (cfg_->BlindLinkQuality() && (symbol_idx_ul == num_ul_pilots)) {
+          // Once per frame, on its first data symbol
+          phy_stats_->UpdatePostEqNoiseGain(
+              frame_id, cur_sc_id,
+              reinterpret_cast<const complex_float*>(ul_beam_ptr),
+              mac_sched_->Schedule(frame_id).ue_list_.data(), num_streams,
+              cfg_->BsAntNum());
         }
-        // apply previously calc'ed phase shift to data
-        else if (cfg_->Frame().ClientUlPilotSymbols() > 0) {
-          arma::cx_float* pilot_corr_ptr = reinterpret_cast<arma::cx_float*>(
-              ue_spec_pilot_buffer_[frame_id % kFrameWnd]);
-          arma::cx_fmat pilot_corr_mat(
-              pilot_corr_ptr, cfg_->SpatialStreamsNum(),
-              cfg_->Frame().ClientUlPilotSymbols(), false);
-          arma::fmat theta_mat = arg(pilot_corr_mat);
-          arma::fmat theta_inc =
-              arma::zeros<arma::fmat>(cfg_->SpatialStreamsNum(), 1);
-          for (size_t s = 1; s < cfg_->Frame().ClientUlPilotSymbols(); s++) {
-            arma::fmat theta_diff = theta_mat.col(s) - theta_mat.col(s - 1);
-            theta_inc += theta_diff;
+        if (pilot_symbol) {
+          // Gather the pilots of the UEs of the streams of this subcarrier
+          const auto& ue_list = mac_sched_->Schedule(frame_id).ue_list_;
+          for (size_t ss = 0; ss < num_streams; ss++) {
+            pilot_gather_[j * num_streams + ss] =
+                cfg_->UeSpecificPilot(numa_node_)[ue_list[ss]][cur_sc_id];
           }
-          theta_inc /= (float)std::max(
-              1, static_cast<int>(cfg_->Frame().ClientUlPilotSymbols() - 1));
-          arma::fmat cur_theta = theta_mat.col(0) + (symbol_idx_ul * theta_inc);
-          arma::cx_fmat mat_phase_correct =
-              arma::zeros<arma::cx_fmat>(size(cur_theta));
-          mat_phase_correct.set_real(cos(-cur_theta));
-          mat_phase_correct.set_imag(sin(-cur_theta));
-          mat_equaled %= mat_phase_correct;
+        }
+        duration_stat_equal_->task_count_++;
+        duration_stat_equal_->task_duration_[3] +=
+            GetTime::WorkerRdtsc() - start_equal_tsc3;
+      }
+
+      // Step 3: Phase tracking of the kSCsPerCacheline subcarriers, which are
+      // contiguous in the equalized buffer
+      size_t start_equal_tsc4 = GetTime::WorkerRdtsc();
+      complex_float* equal_group =
+          kExportConstellation
+              ? &equal_buffer_[total_data_symbol_idx_ul]
+                              [(base_sc_id + i) * num_streams]
+              : &equaled_buffer_temp_[i * num_streams];
+      if (pilot_symbol) {
+        AccumulatePilotCorr(
+            equal_group, pilot_gather_, pilot_corr_, num_streams,
+            cfg_->FastMathPrecision(FastMath::Family::kPhaseTrack));
+      } else {
+        if (num_ul_pilots > 0) {
+          DerotateStreams(equal_group, phase_pattern_, num_streams);
 
 #if !defined(TIME_EXCLUSIVE)
-          auto ue_list = mac_sched_->ScheduledUeList(frame_id, cur_sc_id);
-          const size_t data_symbol_idx_ul =
-              symbol_idx_ul - this->cfg_->Frame().ClientUlPilotSymbols();
+          const size_t data_symbol_idx_ul = symbol_idx_ul - num_ul_pilots;
           // Measure EVM from ground truth
-          if (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols()) {
-            phy_stats_->UpdateEvm(frame_id, data_symbol_idx_ul, cur_sc_id,
-                                  mat_equaled.col(0), ue_list);
-          }
+          phy_stats_->UpdateEvmBlock(
+              frame_id, data_symbol_idx_ul, base_sc_id + i, kSCsPerCacheline,
+              equal_group, mac_sched_->Schedule(frame_id).ue_list_.data(),
+              num_streams, numa_node_);
 #endif
         }
-        duration_stat_equal_->task_count_++;
-        duration_stat_equal_->task_duration_[3] +=
-            GetTime::WorkerRdtsc() - start_equal_tsc3;
+        if (cfg_->BlindLinkQuality()) {
+          phy_stats_->UpdateBlindEvmBlock(
+              frame_id, base_sc_id + i, kSCsPerCacheline, equal_group,
+              mac_sched_->Schedule(frame_id).ue_list_.data(), num_streams,
+              mod_order_bits);
+        }
+      }
+      duration_stat_equal_->task_duration_[3] +=
+          GetTime::WorkerRdtsc() - start_equal_tsc4;
+    }
+
+    if (pilot_symbol) {
+      // Reduce the per-element sums of this task to one sum per stream
+      complex_float* phase_shift =
+          &ue_spec_pilot_buffer_[frame_slot][symbol_idx_ul * num_streams];
+      for (size_t e = 0; e < kSCsPerCacheline * num_streams; e++) {
+        phase_shift[e % num_streams].re += pilot_corr_[e].re;
+        phase_shift[e % num_streams].im += pilot_corr_[e].im;
       }
     }
   }
 
+  // The fused path never writes the equalized symbols
+  if ((taps_ != nullptr) && (demod_fused == false) &&
+      taps_->Wanted(TapPoint::kEqual, frame_id)) {
+    const complex_float* equal =
+        kExportConstellation
+            ? &equal_buffer_[total_data_symbol_idx_ul]
+                            [base_sc_id * cfg_->SpatialStreamsNum()]
+            : equaled_buffer_temp_;
+    taps_->Publish(
+        TapPoint::kEqual, frame_id, symbol_id, 0, base_sc_id, equal,
+        max_sc_ite * cfg_->SpatialStreamsNum() * sizeof(complex_float));
+  }
   duration_stat_equal_->task_duration_[0] +=
       GetTime::WorkerRdtsc() - start_equal_tsc;
   size_t start_demul_tsc = GetTime::WorkerRdtsc();
@@ -1391,6 +1655,11 @@ EventData DoDemul::Launch(size_t tag) {
       cfg_->SpatialStreamsNum() * 6, cfg_->SpatialStreamsNum() * 6 + 1);
   auto* equal_t_ptr = reinterpret_cast<float*>(equaled_buffer_temp_transposed_);
   for (size_t ss_id = 0; ss_id < cfg_->SpatialStreamsNum(); ss_id++) {
+    if (demod_fused) {
+      // Already demodulated together with the equalization
+      duration_stat_demul_->task_count_++;
+      continue;
+    }
     float* equal_ptr = nullptr;
     if (kExportConstellation) {
       equal_ptr = reinterpret_cast<float*>(
@@ -1407,21 +1676,23 @@ EventData DoDemul::Launch(size_t tag) {
       equal_ptr += cfg_->SpatialStreamsNum() * k_num_double_in_sim_d256 * 2;
     }
     equal_t_ptr = (float*)(equaled_buffer_temp_transposed_);
-    int8_t* demod_ptr = demod_buffers_[frame_slot][symbol_idx_ul][ss_id] +
-                        (cfg_->ModOrderBits(Direction::kUplink) * base_sc_id);
+    int8_t* demod_ptr = LlrOut(frame_slot, symbol_idx_ul, ss_id, base_sc_id,
+                               mod_order_bits);
     size_t start_demul_tsc0 = GetTime::WorkerRdtsc();
 
 #ifdef USE_ACC100
     Demodulate(equal_t_ptr, demod_ptr, max_sc_ite,
-               cfg_->ModOrderBits(Direction::kUplink), true);
+               mod_order_bits, true);
 
-    size_t encoded_bits_size = (max_sc_ite * cfg_->ModOrderBits(Direction::kUplink) + 7) / 8;  // Round up if not divisible by 8
+    size_t encoded_bits_size = (max_sc_ite * mod_order_bits + 7) / 8;  // Round up if not divisible by 8
     uint8_t* encoded_bits = new uint8_t[encoded_bits_size];  // Dynamically allocate the array
       ReverseAdaptBitsForMod(reinterpret_cast<uint8_t*>(demod_ptr), encoded_bits, max_sc_ite,
-                             cfg_->ModOrderBits(Direction::kUplink));
-    size_t bit_len = max_sc_ite * cfg_->ModOrderBits(Direction::kUplink);  // Total number of bits in encoded_bits
+                             mod_order_bits);
+    size_t bit_len = max_sc_ite * mod_order_bits;  // Total number of bits in encoded_bits
     // size_t llr_len = (bit_len + 3) / 4;  // LLR length in terms of uint32_t (4 LLRs per uint32_t)
-    TranslateToLLR(encoded_bits, demod_ptr, bit_len);
+    // Written in the LLR format of the card, so the decoder enqueues them
+    // as they are
+    TranslateToLLR(encoded_bits, demod_ptr, bit_len, hard_llr_magnitude_);
 
     // if (kCheckData && symbol_idx_ul >= 12 && frame_id > 100 && frame_id % 100 == 0) {
     //   std::printf("LLR bits, symbol_offset, symbol_idx is: %zu\n", symbol_idx_ul);
@@ -1441,7 +1712,7 @@ EventData DoDemul::Launch(size_t tag) {
     
 #else
     Demodulate(equal_t_ptr, demod_ptr, max_sc_ite,
-               cfg_->ModOrderBits(Direction::kUplink), kUplinkHardDemod);
+               mod_order_bits, kUplinkHardDemod);
 #endif
 
 
@@ -1451,14 +1722,13 @@ EventData DoDemul::Launch(size_t tag) {
     // if hard demod is enabled calculate BER with modulated bits
     if (((kPrintPhyStats || kEnableCsvLog) && kUplinkHardDemod) &&
         (symbol_idx_ul >= cfg_->Frame().ClientUlPilotSymbols())) {
-      size_t ue_id = mac_sched_->ScheduledUeIndex(frame_id, base_sc_id, ss_id);
+      size_t ue_id = mac_sched_->Schedule(frame_id).ue_list_[ss_id];
       phy_stats_->UpdateDecodedBits(
           ue_id, total_data_symbol_idx_ul, frame_slot,
-          max_sc_ite * cfg_->ModOrderBits(Direction::kUplink));
+          max_sc_ite * mod_order_bits);
       // Each block here is max_sc_ite
       phy_stats_->IncrementDecodedBlocks(ue_id, total_data_symbol_idx_ul,
                                          frame_slot);
-      size_t block_error(0);
       int8_t* tx_bytes =
           cfg_->GetModBitsBuf(cfg_->UlModBits(), Direction::kUplink, 0,
                               symbol_idx_ul, ue_id, base_sc_id);
@@ -1480,15 +1750,10 @@ EventData DoDemul::Launch(size_t tag) {
       }
 
     
-      for (size_t i = 0; i < max_sc_ite; i++) {
-        uint8_t rx_byte = static_cast<uint8_t>(demod_ptr[i]);
-        uint8_t tx_byte = static_cast<uint8_t>(tx_bytes[i]);
-        phy_stats_->UpdateBitErrors(ue_id, total_data_symbol_idx_ul, frame_slot,
-                                    tx_byte, rx_byte);
-        if (rx_byte != tx_byte) {
-          block_error++;
-        }
-      }
+      const size_t block_error = phy_stats_->UpdateBitErrors(
+          ue_id, total_data_symbol_idx_ul, frame_slot,
+          reinterpret_cast<const uint8_t*>(tx_bytes),
+          reinterpret_cast<const uint8_t*>(demod_ptr), max_sc_ite);
       phy_stats_->UpdateBlockErrors(ue_id, total_data_symbol_idx_ul, frame_slot,
                                     block_error);
     }
@@ -1503,6 +1768,19 @@ EventData DoDemul::Launch(size_t tag) {
   }
 
 
+  if (llr_scratch_ != nullptr) {
+    PackBlockLlrs(frame_slot, symbol_idx_ul, base_sc_id, max_sc_ite,
+                  mod_order_bits);
+  }
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kLlr, frame_id)) {
+    for (size_t ss_id = 0; ss_id < cfg_->SpatialStreamsNum(); ss_id++) {
+      taps_->Publish(TapPoint::kLlr, frame_id, symbol_id, ss_id, base_sc_id,
+                     LlrOut(frame_slot, symbol_idx_ul, ss_id, base_sc_id,
+                            mod_order_bits),
+                     max_sc_ite * mod_order_bits);
+    }
+  }
+
   duration_stat_demul_->task_duration_[0] +=
       GetTime::WorkerRdtsc() - start_demul_tsc;
   return EventData(EventType::kDemul, tag);
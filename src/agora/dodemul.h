@@ -6,18 +6,23 @@
 #define DODEMUL_H_
 
 #include <array>
+#include <memory>
+#include <vector>
 
 #include "armadillo"
+#include "cgemv_batch.h"
 #include "common_typedef_sdk.h"
 #include "concurrentqueue.h"
 #include "config.h"
 #include "doer.h"
+#include "int16_equalizer.h"
 #include "mac_scheduler.h"
 #include "memory_manage.h"
 #include "mkl_dfti.h"
 #include "phy_stats.h"
 #include "stats.h"
 #include "symbols.h"
+#include "task_arena.h"
 #include <iomanip>  // For std::hex, std::setw, std::setfill
 #include "utils_ldpc.h"
 
@@ -63,16 +68,87 @@ class DoDemul : public Doer {
    */
   EventData Launch(size_t tag) override;
 
+  /// Prefetch the received samples and the beamweights of the block of tag,
+  /// and its LLR outputs for writing
+  void PrefetchTask(size_t tag) override;
+
+  /// Equalize with the int16 copies of the uplink beamweights that
+  /// DoBeamWeights::EnableInt16Beams() writes
+  void EnableInt16Beams(PtrGrid<kFrameWnd, kMaxDataSCs, int16_t>* ul_beam_int16,
+                        Table<float>* ul_beam_scales) {
+    ul_beam_int16_ = ul_beam_int16;
+    ul_beam_scales_ = ul_beam_scales;
+    int16_scratch_.resize(Int16Equalizer::ScratchSize(cfg_->BsAntNum()));
+  }
+
  private:
+  /// Fill phase_pattern_ with the phase correction of each spatial stream of
+  /// uplink symbol symbol_idx_ul, from the pilot correlations of the frame
+  void UpdatePhaseCorrection(size_t frame_slot, size_t symbol_idx_ul);
+  /// Gather the data of the kSCsPerCacheline subcarriers from sc_id into
+  /// gather, as a row-major matrix with kSCsPerCacheline rows and BsAntNum()
+  /// columns
+  void GatherData(const complex_float* data_buf, size_t sc_id,
+                  complex_float* gather);
+  /// Equalize the num_scs subcarriers from base_sc_id, whose data
+  /// data_gather_buffer_ holds, with one batch GEMM into equal
+  void EqualizeBatch(size_t frame_slot, size_t base_sc_id, size_t num_scs,
+                     complex_float* equal);
+  /// Returns the uplink beamweights of sc_id, linearly interpolated between
+  /// the beam grid subcarriers around it into interp_beam_ if needed
+  complex_float* InterpolateUlBeam(size_t frame_slot, size_t sc_id);
+  /// Where the int8 LLRs of stream ss_id of the block from base_sc_id are
+  /// demodulated to: demod_buffers_, or with packed LLRs llr_scratch_, to be
+  /// packed into it by PackBlockLlrs()
+  int8_t* LlrOut(size_t frame_slot, size_t symbol_idx_ul, size_t ss_id,
+                 size_t base_sc_id, size_t mod_order_bits);
+  /// Pack the LLRs of the num_scs subcarriers of the block from
+  /// llr_scratch_ into demod_buffers_
+  void PackBlockLlrs(size_t frame_slot, size_t symbol_idx_ul,
+                     size_t base_sc_id, size_t num_scs,
+                     size_t mod_order_bits);
+
   Table<complex_float>& data_buffer_;
-  PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_beam_matrices_;
+  FlatGrid<complex_float> ul_beam_matrices_;
+  // nullptr unless ul_beam_int16 is set
+  PtrGrid<kFrameWnd, kMaxDataSCs, int16_t>* ul_beam_int16_ = nullptr;
+  Table<float>* ul_beam_scales_ = nullptr;
+  // Quantized data of one subcarrier for the int16 equalizer
+  std::vector<int16_t> int16_scratch_;
   Table<complex_float>& ue_spec_pilot_buffer_;
   Table<complex_float>& equal_buffer_;
-  PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers_;
+  FlatCube<int8_t> demod_buffers_;
+  // The int8 LLRs of each stream of a block, nullptr unless
+  // Config::DemodLlrBits() packs them
+  int8_t* llr_scratch_ = nullptr;
+  size_t llr_scratch_stride_ = 0;
   MacScheduler* mac_sched_;
   DurationStat* duration_stat_demul_;
   DurationStat* duration_stat_equal_;
   PhyStats* phy_stats_;
+  // Armadillo temporaries of a task
+  TaskArena arena_;
+
+  /// The config matches the cell profile of this build, so the general
+  /// path equalizes with the kernel specialized for it
+  bool cell_profile_match_ = false;
+
+  /// Magnitude of the hard decision LLRs fed to the ACC100, in the LLR
+  /// format of the card
+  int8_t hard_llr_magnitude_;
+
+  /// Set with gemm_batch for the general path, nullptr otherwise. The beam
+  /// matrices of a block are at ul_beam_matrices_ + k * beam_stride_, or if
+  /// subcarriers share them, group g of beam_group_sizes_[g] subcarriers
+  /// uses the one at beam_ptrs_[g].
+  std::unique_ptr<CgemvBatch> gemv_batch_;
+  std::vector<const complex_float*> beam_ptrs_;
+  std::vector<size_t> beam_group_sizes_;
+  size_t beam_stride_ = 0;
+
+  /// Interpolated beamweights of one subcarrier (beam_interpolation), or
+  /// nullptr
+  complex_float* interp_beam_;
 
   /// Intermediate buffer to gather raw data. Size = subcarriers per cacheline
   /// times number of antennas
@@ -81,6 +157,14 @@ class DoDemul : public Doer {
   // Intermediate buffers for equalized data
   complex_float* equaled_buffer_temp_;
   complex_float* equaled_buffer_temp_transposed_;
+
+  // Per-stream phase tracking of the general path. The equalized symbols of
+  // kSCsPerCacheline subcarriers are interleaved by stream, so element e of
+  // these buffers belongs to stream (e % SpatialStreamsNum()). Size =
+  // subcarriers per cacheline times number of spatial streams.
+  complex_float* phase_pattern_;  // Phase correction of the data symbols
+  complex_float* pilot_gather_;   // UE pilots of the streams
+  complex_float* pilot_corr_;     // Pilot correlation sums of this task
   arma::cx_fmat ue_pilot_data_;
   arma::cx_fvec vec_pilot_data;
   int ue_num_simd256_;
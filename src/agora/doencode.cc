@@ -6,9 +6,13 @@
 
 #include "doencode.h"
 
+#include <algorithm>
+#include <array>
+
 #include "concurrent_queue_wrapper.h"
 #include "encoder.h"
 #include "logger.h"
+#include "modulation.h"
 #include "phy_ldpc_decoder_5gnr.h"
 
 static constexpr bool kPrintEncodedData = false;
@@ -23,83 +27,115 @@ DoEncode::DoEncode(Config* in_config, int in_tid, Direction dir,
       raw_data_buffer_(in_raw_data_buffer),
       raw_buffer_rollover_(in_buffer_rollover),
       mod_bits_buffer_(in_mod_bits_buffer),
+      dl_mod_symbols_(nullptr),
+      mod_bits_temp_(nullptr),
+      mod_symbols_temp_(nullptr),
+      mod_temp_stride_(0),
       mac_sched_(mac_sched),
       scrambler_(std::make_unique<AgoraScrambler::Scrambler>()) {
   const auto bg = cfg_->LdpcConfig(dir).BaseGraph();
   const auto zc = cfg_->LdpcConfig(dir).ExpansionFactor();
 
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kEncode, in_tid);
+  alloc_stat_ = duration_stat_;
+  num_lanes_ = cfg_->BatchEncode() ? EventData::kMaxTags : 1;
+  parity_buffer_stride_ = Roundup<64>(LdpcEncodingParityBufSize(bg, zc));
   parity_buffer_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64, LdpcEncodingParityBufSize(bg, zc)));
+      Agora_memory::Alignment_t::kAlign64, num_lanes_ * parity_buffer_stride_,
+      scratch_policy_));
   assert(parity_buffer_ != nullptr);
+  encoded_buffer_stride_ = Roundup<64>(LdpcEncodingEncodedBufSize(bg, zc));
   encoded_buffer_temp_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64, LdpcEncodingEncodedBufSize(bg, zc)));
+      Agora_memory::Alignment_t::kAlign64, num_lanes_ * encoded_buffer_stride_,
+      scratch_policy_));
   assert(encoded_buffer_temp_ != nullptr);
 
   scrambler_buffer_bytes_ =
       cfg_->NumBytesPerCb(dir) + cfg_->NumPaddingBytesPerCb(dir);
+  scrambler_buffer_stride_ = Roundup<64>(scrambler_buffer_bytes_);
 
   scrambler_buffer_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64, scrambler_buffer_bytes_));
-  std::memset(scrambler_buffer_, 0u, scrambler_buffer_bytes_);
-
+      Agora_memory::Alignment_t::kAlign64,
+      num_lanes_ * scrambler_buffer_stride_, scratch_policy_));
   assert(scrambler_buffer_ != nullptr);
+  std::memset(scrambler_buffer_, 0u, num_lanes_ * scrambler_buffer_stride_);
 }
 
 DoEncode::~DoEncode() {
-  std::free(parity_buffer_);
-  std::free(encoded_buffer_temp_);
-  std::free(scrambler_buffer_);
+  Agora_memory::PaddedAlignedFree(parity_buffer_);
+  Agora_memory::PaddedAlignedFree(encoded_buffer_temp_);
+  Agora_memory::PaddedAlignedFree(scrambler_buffer_);
+  Agora_memory::PaddedAlignedFree(mod_bits_temp_);
+  Agora_memory::PaddedAlignedFree(mod_symbols_temp_);
 }
 
-EventData DoEncode::Launch(size_t tag) {
+void DoEncode::EnableModulationFusion(Table<complex_float>* dl_mod_symbols) {
+  RtAssert(dir_ == Direction::kDownlink,
+           "DoEncode: modulation fusion is for the downlink");
+  dl_mod_symbols_ = dl_mod_symbols;
+  mod_temp_stride_ = Roundup<64>(cfg_->SubcarrierPerCodeBlock(dir_));
+  mod_bits_temp_ = static_cast<uint8_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, num_lanes_ * mod_temp_stride_,
+      scratch_policy_));
+  mod_symbols_temp_ =
+      static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+          Agora_memory::Alignment_t::kAlign64,
+          num_lanes_ * mod_temp_stride_ * sizeof(complex_float),
+          scratch_policy_));
+  RtAssert((mod_bits_temp_ != nullptr) && (mod_symbols_temp_ != nullptr),
+           "DoEncode: failed to allocate the modulation buffers");
+}
+
+DoEncode::CodeblockIds DoEncode::GetCodeblockIds(size_t tag) const {
   const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
-  const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t cb_id = gen_tag_t(tag).cb_id_;
-  const size_t cur_cb_id = cb_id % ldpc_config.NumBlocksInSymbol();
-  const size_t sched_ue_id = cb_id / ldpc_config.NumBlocksInSymbol();
+  CodeblockIds ids;
+  ids.frame_id_ = gen_tag_t(tag).frame_id_;
+  ids.cur_cb_id_ = cb_id % ldpc_config.NumBlocksInSymbol();
+  ids.sched_ue_id_ = cb_id / ldpc_config.NumBlocksInSymbol();
 
-  size_t start_tsc = GetTime::WorkerRdtsc();
-
-  size_t symbol_idx;
-  size_t symbol_idx_data;
-  size_t ue_id;
   if (dir_ == Direction::kDownlink) {
-    symbol_idx = cfg_->Frame().GetDLSymbolIdx(symbol_id);
-    assert(symbol_idx >= cfg_->Frame().ClientDlPilotSymbols());
-    symbol_idx_data = symbol_idx - cfg_->Frame().ClientDlPilotSymbols();
-    ue_id = mac_sched_->ScheduledUeIndex(frame_id, 0u, sched_ue_id);
+    ids.symbol_idx_ = cfg_->Frame().GetDLSymbolIdx(symbol_id);
+    assert(ids.symbol_idx_ >= cfg_->Frame().ClientDlPilotSymbols());
+    ids.symbol_idx_data_ =
+        ids.symbol_idx_ - cfg_->Frame().ClientDlPilotSymbols();
+    ids.ue_id_ = mac_sched_->Schedule(ids.frame_id_).ue_list_[ids.sched_ue_id_];
   } else {
-    symbol_idx = cfg_->Frame().GetULSymbolIdx(symbol_id);
-    assert(symbol_idx >= cfg_->Frame().ClientUlPilotSymbols());
-    symbol_idx_data = symbol_idx - cfg_->Frame().ClientUlPilotSymbols();
-    ue_id = sched_ue_id;
+    ids.symbol_idx_ = cfg_->Frame().GetULSymbolIdx(symbol_id);
+    assert(ids.symbol_idx_ >= cfg_->Frame().ClientUlPilotSymbols());
+    ids.symbol_idx_data_ =
+        ids.symbol_idx_ - cfg_->Frame().ClientUlPilotSymbols();
+    ids.ue_id_ = ids.sched_ue_id_;
   }
 
   if (kDebugPrintInTask) {
     std::printf(
         "In doEncode thread %d: frame: %zu, symbol: %zu:%zu:%zu, code block "
         "%zu, ue_id: %zu\n",
-        tid_, frame_id, symbol_id, symbol_idx, symbol_idx_data, cur_cb_id,
-        ue_id);
+        tid_, ids.frame_id_, symbol_id, ids.symbol_idx_, ids.symbol_idx_data_,
+        ids.cur_cb_id_, ids.ue_id_);
   }
+  return ids;
+}
 
+int8_t* DoEncode::LoadCodeblock(const CodeblockIds& ids, size_t lane) {
   int8_t* tx_data_ptr = nullptr;
   ///\todo Make GetMacBits and GetInfoBits
   /// universal with raw_buffer_rollover_ the parameter.
   if (kEnableMac) {
     // All cb's per symbol are included in 1 mac packet
     tx_data_ptr = cfg_->GetMacBits(raw_data_buffer_, dir_,
-                                   (frame_id % raw_buffer_rollover_),
-                                   symbol_idx_data, ue_id, cur_cb_id);
+                                   (ids.frame_id_ % raw_buffer_rollover_),
+                                   ids.symbol_idx_data_, ids.ue_id_,
+                                   ids.cur_cb_id_);
 
     if (kPrintRawMacData) {
       auto* pkt = reinterpret_cast<MacPacketPacked*>(tx_data_ptr);
       std::printf(
           "In doEncode [%d] mac packet frame: %d, symbol: %zu:%d, ue_id: %d, "
           "data length %d, crc %d size %zu:%zu\n",
-          tid_, pkt->Frame(), symbol_idx_data, pkt->Symbol(), pkt->Ue(),
+          tid_, pkt->Frame(), ids.symbol_idx_data_, pkt->Symbol(), pkt->Ue(),
           pkt->PayloadLength(), pkt->Crc(), cfg_->MacPacketLength(dir_),
           cfg_->NumBytesPerCb(dir_));
       std::printf("Data: ");
@@ -109,16 +145,16 @@ EventData DoEncode::Launch(size_t tag) {
       std::printf("\n");
     }
   } else {
-    tx_data_ptr =
-        cfg_->GetInfoBits(raw_data_buffer_, dir_, symbol_idx, ue_id, cur_cb_id);
+    tx_data_ptr = cfg_->GetInfoBits(raw_data_buffer_, dir_, ids.symbol_idx_,
+                                    ids.ue_id_, ids.cur_cb_id_);
   }
 
   int8_t* ldpc_input = tx_data_ptr;
   const size_t num_bytes_per_cb = cfg_->NumBytesPerCb(dir_);
 
   if (this->cfg_->ScrambleEnabled()) {
-    scrambler_->Scramble(scrambler_buffer_, ldpc_input, num_bytes_per_cb);
-    ldpc_input = scrambler_buffer_;
+    scrambler_->Scramble(ScramblerBuffer(lane), ldpc_input, num_bytes_per_cb);
+    ldpc_input = ScramblerBuffer(lane);
   }
   if (scrambler_buffer_bytes_ > num_bytes_per_cb) {
     std::memset(&ldpc_input[num_bytes_per_cb], 0u,
@@ -133,33 +169,40 @@ EventData DoEncode::Launch(size_t tag) {
                 << std::to_integer<int>(
                        reinterpret_cast<std::byte*>(ldpc_input)[i]);
     }
-    AGORA_LOG_INFO("ldpc input (%zu %zu %zu): %s\n", frame_id, symbol_idx,
-                   ue_id, dataprint.str().c_str());
+    AGORA_LOG_INFO("ldpc input (%zu %zu %zu): %s\n", ids.frame_id_,
+                   ids.symbol_idx_, ids.ue_id_, dataprint.str().c_str());
   }
+  return ldpc_input;
+}
 
-  LdpcEncodeHelper(ldpc_config.BaseGraph(), ldpc_config.ExpansionFactor(),
-                   ldpc_config.NumRows(), encoded_buffer_temp_, parity_buffer_,
-                   ldpc_input);
+void DoEncode::StoreCodeblock(const CodeblockIds& ids, size_t lane,
+                              const int8_t* encoded_buffer) {
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
   if (kDebugTxData) {
     std::stringstream dataprint;
     dataprint << std::setfill('0') << std::hex;
     for (size_t i = 0; i < BitsToBytes(ldpc_config.NumCbCodewLen()); i++) {
       dataprint << " " << std::setw(2)
                 << std::to_integer<int>(
-                       reinterpret_cast<std::byte*>(encoded_buffer_temp_)[i]);
+                       reinterpret_cast<const std::byte*>(encoded_buffer)[i]);
     }
-    AGORA_LOG_INFO("ldpc output (%zu %zu %zu): %s\n", frame_id, symbol_idx,
-                   ue_id, dataprint.str().c_str());
+    AGORA_LOG_INFO("ldpc output (%zu %zu %zu): %s\n", ids.frame_id_,
+                   ids.symbol_idx_, ids.ue_id_, dataprint.str().c_str());
+  }
+  if (dl_mod_symbols_ != nullptr) {
+    StoreModulated(ids, lane, encoded_buffer);
+    return;
   }
-  int8_t* mod_buffer_ptr = cfg_->GetModBitsBuf(
-      mod_bits_buffer_, dir_, frame_id, symbol_idx, sched_ue_id, cur_cb_id);
+  int8_t* mod_buffer_ptr =
+      cfg_->GetModBitsBuf(mod_bits_buffer_, dir_, ids.frame_id_,
+                          ids.symbol_idx_, ids.sched_ue_id_, ids.cur_cb_id_);
 
   if (kPrintRawMacData && dir_ == Direction::kUplink) {
     std::printf("Encoded data - placed at location (%zu %zu %zu) %zu\n",
-                frame_id, symbol_idx, ue_id,
+                ids.frame_id_, ids.symbol_idx_, ids.ue_id_,
                 reinterpret_cast<intptr_t>(mod_buffer_ptr));
   }
-  AdaptBitsForMod(reinterpret_cast<uint8_t*>(encoded_buffer_temp_),
+  AdaptBitsForMod(reinterpret_cast<const uint8_t*>(encoded_buffer),
                   reinterpret_cast<uint8_t*>(mod_buffer_ptr),
                   BitsToBytes(ldpc_config.NumCbCodewLen()),
                   cfg_->ModOrderBits(dir_));
@@ -172,13 +215,104 @@ EventData DoEncode::Launch(size_t tag) {
     }
     std::printf("\n");
   }
+}
+
+void DoEncode::StoreModulated(const CodeblockIds& ids, size_t lane,
+                              const int8_t* encoded_buffer) {
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
+  const size_t sp_id = ids.sched_ue_id_;
+  uint8_t* mod_bits = mod_bits_temp_ + lane * mod_temp_stride_;
+  complex_float* mod_symbols = mod_symbols_temp_ + lane * mod_temp_stride_;
+  AdaptBitsForMod(reinterpret_cast<const uint8_t*>(encoded_buffer), mod_bits,
+                  BitsToBytes(ldpc_config.NumCbCodewLen()),
+                  cfg_->ModOrderBits(dir_));
+  const size_t num_data_sc = std::min(cfg_->SubcarrierPerCodeBlock(dir_),
+                                      cfg_->GetOFDMDataNum() - ids.cur_cb_id_);
+  ModSimd(mod_bits, mod_symbols, num_data_sc, cfg_->ModTable(dir_, numa_node_),
+          cfg_->ModOrderBits(dir_));
+
+  const size_t total_data_symbol_idx =
+      cfg_->GetTotalDataSymbolIdxDl(ids.frame_id_, ids.symbol_idx_);
+  complex_float* out = (*dl_mod_symbols_)[total_data_symbol_idx];
+  // The code block starts at the data index GetModBitsBuf() uses for it
+  for (size_t i = 0; i < num_data_sc; i++) {
+    const size_t sc_id = cfg_->GetOFDMDataSc(ids.cur_cb_id_ + i);
+    out[cfg_->DlModSymbolIndex(sc_id, sp_id)] = mod_symbols[i];
+  }
+  // The first code block of a stream also fills in the pilot subcarriers of
+  // the stream, so the precoder reads whole blocks of subcarriers
+  if (ids.cur_cb_id_ == 0) {
+    for (size_t sc_id = 0; sc_id < cfg_->OfdmDataNum(); sc_id++) {
+      if (cfg_->IsDataSubcarrier(sc_id) == false) {
+        out[cfg_->DlModSymbolIndex(sc_id, sp_id)] =
+            cfg_->UeSpecificPilot(numa_node_)[ids.ue_id_][sc_id];
+      }
+    }
+  }
+}
 
+void DoEncode::UpdateStats(size_t start_tsc, size_t num_cbs) {
   const size_t duration = GetTime::WorkerRdtsc() - start_tsc;
   duration_stat_->task_duration_[0] += duration;
-  duration_stat_->task_count_++;
+  duration_stat_->task_count_ += num_cbs;
   if (GetTime::CyclesToUs(duration, cfg_->FreqGhz()) > 500) {
     std::printf("Thread %d Encode takes %.2f\n", tid_,
                 GetTime::CyclesToUs(duration, cfg_->FreqGhz()));
   }
+}
+
+EventData DoEncode::Launch(size_t tag) {
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
+  size_t start_tsc = GetTime::WorkerRdtsc();
+
+  const CodeblockIds ids = GetCodeblockIds(tag);
+  const int8_t* ldpc_input = LoadCodeblock(ids, 0);
+  LdpcEncodeHelper(ldpc_config.BaseGraph(), ldpc_config.ExpansionFactor(),
+                   ldpc_config.NumRows(), EncodedBuffer(0), ParityBuffer(0),
+                   ldpc_input);
+  StoreCodeblock(ids, 0, EncodedBuffer(0));
+
+  UpdateStats(start_tsc, 1);
   return EventData(EventType::kEncode, tag);
 }
+
+void DoEncode::LaunchEvent(
+    const EventData& req_event,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  if (num_lanes_ == 1) {
+    Doer::LaunchEvent(req_event, complete_task_queue, worker_ptok);
+    return;
+  }
+
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  const size_t num_cbs = req_event.num_tags_;
+  RtAssert(num_cbs <= num_lanes_, "DoEncode: more code blocks than lanes");
+
+  // All the code blocks of a direction use the same base graph and Zc
+  std::array<CodeblockIds, EventData::kMaxTags> ids;
+  std::array<const int8_t*, EventData::kMaxTags> ldpc_inputs;
+  std::array<int8_t*, EventData::kMaxTags> encoded_buffers;
+  std::array<int8_t*, EventData::kMaxTags> parity_buffers;
+  for (size_t i = 0; i < num_cbs; i++) {
+    ids.at(i) = GetCodeblockIds(req_event.tags_.at(i));
+    ldpc_inputs.at(i) = LoadCodeblock(ids.at(i), i);
+    encoded_buffers.at(i) = EncodedBuffer(i);
+    parity_buffers.at(i) = ParityBuffer(i);
+  }
+  LdpcEncodeHelperBatch(ldpc_config.BaseGraph(), ldpc_config.ExpansionFactor(),
+                        ldpc_config.NumRows(), num_cbs, encoded_buffers.data(),
+                        parity_buffers.data(), ldpc_inputs.data());
+  for (size_t i = 0; i < num_cbs; i++) {
+    StoreCodeblock(ids.at(i), i, EncodedBuffer(i));
+  }
+  UpdateStats(start_tsc, num_cbs);
+
+  EventData resp_event(EventType::kEncode);
+  resp_event.num_tags_ = num_cbs;
+  resp_event.tags_ = req_event.tags_;
+  if (IsLastSharedTask(resp_event)) {
+    TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
+  }
+}
@@ -28,26 +28,84 @@ class DoEncode : public Doer {
 
   EventData Launch(size_t tag) override;
 
- private:
+  /// With batched encoding, encode all the code blocks of the event with one
+  /// multi-code-block LDPC request instead of one request per code block
+  void LaunchEvent(const EventData& req_event,
+                   moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                   moodycamel::ProducerToken* worker_ptok) override;
+
+  /// Modulate the encoded code blocks of downlink symbols straight into
+  /// dl_mod_symbols, in the layout of Config::DlModSymbolIndex(), instead
+  /// of writing modulation bits
+  void EnableModulationFusion(Table<complex_float>* dl_mod_symbols);
+
+ protected:
+  // Location of the code block of a task
+  struct CodeblockIds {
+    size_t frame_id_;
+    size_t symbol_idx_;
+    size_t symbol_idx_data_;
+    size_t ue_id_;
+    size_t sched_ue_id_;
+    size_t cur_cb_id_;
+  };
+  CodeblockIds GetCodeblockIds(size_t tag) const;
+
+  // Scramble and pad the information bits of a code block into the
+  // scrambler buffer of the lane, and return the LDPC encoder input
+  int8_t* LoadCodeblock(const CodeblockIds& ids, size_t lane);
+  // Copy the encoded bits into the modulation bits buffer, or modulate them
+  // into dl_mod_symbols_ with the buffers of the lane
+  void StoreCodeblock(const CodeblockIds& ids, size_t lane,
+                      const int8_t* encoded);
+  void StoreModulated(const CodeblockIds& ids, size_t lane,
+                      const int8_t* encoded);
+  void UpdateStats(size_t start_tsc, size_t num_cbs);
+
+  inline int8_t* ParityBuffer(size_t lane) const {
+    return parity_buffer_ + lane * parity_buffer_stride_;
+  }
+  inline int8_t* EncodedBuffer(size_t lane) const {
+    return encoded_buffer_temp_ + lane * encoded_buffer_stride_;
+  }
+  inline int8_t* ScramblerBuffer(size_t lane) const {
+    return scrambler_buffer_ + lane * scrambler_buffer_stride_;
+  }
+
   Direction dir_;
+  // Bytes of the LDPC encoder input, the padding included
+  size_t scrambler_buffer_bytes_;
+  DurationStat* duration_stat_;
 
+ private:
   // References to buffers allocated pre-construction
   Table<int8_t>& raw_data_buffer_;
   size_t raw_buffer_rollover_;
   Table<int8_t>& mod_bits_buffer_;
 
+  // Code blocks encoded together, one set of intermediate buffers each
+  size_t num_lanes_;
+
   // Intermediate buffer to hold LDPC encoding parity
   int8_t* parity_buffer_;
+  size_t parity_buffer_stride_;
 
   // Intermediate buffer to hold LDPC encoding output
   int8_t* encoded_buffer_temp_;
+  size_t encoded_buffer_stride_;
 
   // Intermediate buffer to hold pre/post scrambled data
   int8_t* scrambler_buffer_;
-  size_t scrambler_buffer_bytes_;
+  size_t scrambler_buffer_stride_;
+
+  // Set with EnableModulationFusion(), nullptr otherwise
+  Table<complex_float>* dl_mod_symbols_;
+  // Modulation bits and symbols of a code block, for each lane
+  uint8_t* mod_bits_temp_;
+  complex_float* mod_symbols_temp_;
+  size_t mod_temp_stride_;
 
   MacScheduler* mac_sched_;
-  DurationStat* duration_stat_;
   std::unique_ptr<AgoraScrambler::Scrambler> scrambler_;
 };
 
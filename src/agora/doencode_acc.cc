@@ -0,0 +1,282 @@
+/**
+ * @file doencode_acc.cc
+ * @brief Implementation file for the DoEncode class with ACC100 acceleration.
+ */
+
+#include "doencode_acc.h"
+
+#include <cstring>
+#include <string>
+
+#include "concurrent_queue_wrapper.h"
+#include "logger.h"
+#include "rte_malloc.h"
+#include "utils.h"
+
+static constexpr size_t kOpsCacheSize = 256;
+static constexpr size_t kMaxDequeueBurst = 32;
+
+// The external buffers of the slot mbufs are freed by the encoder
+static void NoOpExtBufFree(void* /*addr*/, void* /*opaque*/) {}
+
+DoEncode_ACC::DoEncode_ACC(Config* in_config, int in_tid,
+                           Table<int8_t>& in_raw_data_buffer,
+                           size_t in_buffer_rollover,
+                           Table<int8_t>& in_mod_bits_buffer,
+                           MacScheduler* mac_sched, Stats* in_stats_manager,
+                           MessageInfo* message)
+    : DoEncode(in_config, in_tid, Direction::kDownlink, in_raw_data_buffer,
+               in_buffer_rollover, in_mod_bits_buffer, mac_sched,
+               in_stats_manager),
+      stats_(in_stats_manager),
+      message_(message),
+      op_flags_(0) {
+  // The EAL and the device are shared with the decoders, each encoder owns
+  // the bbdev encode queue of its worker thread
+  Bbdev::Setup(cfg_);
+  const uint8_t dev_id = cfg_->BbdevDevId();
+  queue_ = Bbdev::EncodeQueue(dev_id, tid_);
+  struct rte_bbdev_info info;
+  rte_bbdev_info_get(dev_id, &info);
+  const int socket_id = (info.socket_id == SOCKET_ID_ANY) ? 0 : info.socket_id;
+
+  // With E equal to the codeword length the card's rate matching outputs
+  // the bits of the CPU encoder, so use it whenever it is offered. Skip the
+  // bit interleaver, which the CPU path does not have.
+  const uint32_t enc_flags = Bbdev::Props(dev_id).enc_flags_;
+  if ((enc_flags & RTE_BBDEV_LDPC_RATE_MATCH) != 0) {
+    op_flags_ |= RTE_BBDEV_LDPC_RATE_MATCH;
+    if ((enc_flags & RTE_BBDEV_LDPC_INTERLEAVER_BYPASS) != 0) {
+      op_flags_ |= RTE_BBDEV_LDPC_INTERLEAVER_BYPASS;
+    }
+  }
+
+  ops_mp_ = rte_bbdev_op_pool_create(
+      ("ldpc_enc_op_pool_" + std::to_string(dev_id) + "_" +
+       std::to_string(tid_))
+          .c_str(),
+      RTE_BBDEV_OP_LDPC_ENC, Bbdev::kEncodeOps, kOpsCacheSize, socket_id);
+  RtAssert(ops_mp_ != nullptr, "ACC100: failed to create the encode op pool");
+  ops_.resize(Bbdev::kEncodeOps);
+  int ret = rte_bbdev_enc_op_alloc_bulk(ops_mp_, ops_.data(), ops_.size());
+  RtAssert(ret == 0, "ACC100: failed to allocate the encode ops");
+  for (auto* op : ops_) {
+    InitEncOp(op);
+  }
+
+  // The slot buffers are DPDK memory, so the device can reach them without
+  // registering them
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
+  input_stride_ = Roundup<64>(scrambler_buffer_bytes_);
+  output_stride_ = Roundup<64>(BitsToBytes(ldpc_config.NumCbCodewLen()));
+  slot_inputs_ = static_cast<int8_t*>(rte_zmalloc_socket(
+      nullptr, Bbdev::kEncodeOps * input_stride_, 64, socket_id));
+  slot_outputs_ = static_cast<int8_t*>(rte_zmalloc_socket(
+      nullptr, Bbdev::kEncodeOps * output_stride_, 64, socket_id));
+  RtAssert((slot_inputs_ != nullptr) && (slot_outputs_ != nullptr),
+           "ACC100: failed to allocate the encode buffers");
+
+  ext_shinfo_.free_cb = NoOpExtBufFree;
+  ext_shinfo_.fcb_opaque = nullptr;
+  // Never drops to zero while the mbufs are attached
+  rte_mbuf_ext_refcnt_set(&ext_shinfo_, 2 * Bbdev::kEncodeOps);
+  in_mbufs_.resize(Bbdev::kEncodeOps);
+  out_mbufs_.resize(Bbdev::kEncodeOps);
+  struct rte_mempool* mbuf_pool = Bbdev::WorkerMbufPool(dev_id, tid_);
+  ret = rte_pktmbuf_alloc_bulk(mbuf_pool, in_mbufs_.data(), in_mbufs_.size());
+  ret |=
+      rte_pktmbuf_alloc_bulk(mbuf_pool, out_mbufs_.data(), out_mbufs_.size());
+  RtAssert(ret == 0, "ACC100: failed to allocate the encode mbufs");
+  for (size_t slot = 0; slot < Bbdev::kEncodeOps; slot++) {
+    rte_pktmbuf_attach_extbuf(in_mbufs_.at(slot), SlotInput(slot),
+                              rte_malloc_virt2iova(SlotInput(slot)),
+                              input_stride_, &ext_shinfo_);
+    rte_pktmbuf_attach_extbuf(out_mbufs_.at(slot), SlotOutput(slot),
+                              rte_malloc_virt2iova(SlotOutput(slot)),
+                              output_stride_, &ext_shinfo_);
+  }
+  AGORA_LOG_INFO("DoEncode_ACC[%d]: bbdev queue %u, rate matching %s\n",
+                 tid_, queue_.Id(),
+                 (op_flags_ & RTE_BBDEV_LDPC_RATE_MATCH) != 0 ? "on" : "off");
+}
+
+DoEncode_ACC::~DoEncode_ACC() {
+  // Nothing is left in the card once the workers have stopped
+  rte_pktmbuf_free_bulk(in_mbufs_.data(), in_mbufs_.size());
+  rte_pktmbuf_free_bulk(out_mbufs_.data(), out_mbufs_.size());
+  rte_bbdev_enc_op_free_bulk(ops_.data(), ops_.size());
+  rte_mempool_free(ops_mp_);
+  rte_free(slot_inputs_);
+  rte_free(slot_outputs_);
+}
+
+void DoEncode_ACC::InitEncOp(struct rte_bbdev_enc_op* op) {
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(dir_);
+  op->ldpc_enc.basegraph = static_cast<uint8_t>(ldpc_config.BaseGraph());
+  op->ldpc_enc.z_c = static_cast<uint16_t>(ldpc_config.ExpansionFactor());
+  op->ldpc_enc.n_filler = 0;
+  op->ldpc_enc.rv_index = 0;
+  op->ldpc_enc.n_cb = static_cast<uint16_t>(ldpc_config.NumCbCodewLen());
+  op->ldpc_enc.q_m = static_cast<uint8_t>(cfg_->ModOrderBits(dir_));
+  op->ldpc_enc.code_block_mode = 1;
+  op->ldpc_enc.cb_params.e =
+      static_cast<uint32_t>(ldpc_config.NumCbCodewLen());
+  op->ldpc_enc.op_flags = op_flags_;
+}
+
+void DoEncode_ACC::EnqueueCodeblocks(const EventData& req_event) {
+  const size_t num_tags = req_event.num_tags_;
+  const uint16_t input_len = static_cast<uint16_t>(cfg_->NumBytesPerCb(dir_));
+  while (enq_ + num_tags - deq_ > ops_.size()) {
+    RetireOps();
+  }
+
+  std::array<struct rte_bbdev_enc_op*, EventData::kMaxTags> ops;
+  for (size_t i = 0; i < num_tags; i++) {
+    const size_t tag = req_event.tags_.at(i);
+    const size_t slot = (enq_ + i) % ops_.size();
+    std::memcpy(SlotInput(slot), LoadCodeblock(GetCodeblockIds(tag), 0),
+                input_len);
+
+    struct rte_bbdev_enc_op* op = ops_.at(slot);
+    struct rte_mbuf* m_in = in_mbufs_.at(slot);
+    m_in->data_off = 0;
+    m_in->data_len = input_len;
+    m_in->pkt_len = input_len;
+    op->ldpc_enc.input.data = m_in;
+    op->ldpc_enc.input.offset = 0;
+    op->ldpc_enc.input.length = input_len;
+    // The driver appends the encoded bytes, so start from an empty mbuf
+    struct rte_mbuf* m_out = out_mbufs_.at(slot);
+    m_out->data_off = 0;
+    m_out->data_len = 0;
+    m_out->pkt_len = 0;
+    op->ldpc_enc.output.data = m_out;
+    op->ldpc_enc.output.offset = 0;
+    op->ldpc_enc.output.length = 0;
+    op->opaque_data = reinterpret_cast<void*>(tag);
+    ops.at(i) = op;
+  }
+
+#if defined(ENQUEUE_ASYNC)
+  // Registered before enqueueing, as retiring ops below may already retire
+  // some of its ops
+  pending_requests_.Push(req_event, num_tags);
+#endif
+  size_t enqueued = 0;
+  while (enqueued < num_tags) {
+    const uint16_t num_enq =
+        queue_.Enqueue(&ops.at(enqueued), num_tags - enqueued);
+    enqueued += num_enq;
+    enq_ += num_enq;
+    stats_->SetAccOpsInFlight(tid_, Direction::kDownlink, enq_ - deq_);
+    if (enqueued < num_tags) {
+      // The device queue is full, make room by retiring finished ops
+      RetireOps();
+    }
+  }
+}
+
+size_t DoEncode_ACC::RetireOps() {
+  if (deq_ == enq_) {
+    return 0;
+  }
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  std::array<struct rte_bbdev_enc_op*, kMaxDequeueBurst> ops;
+  const uint16_t num_deq = queue_.Dequeue(ops.data(), ops.size());
+  for (size_t i = 0; i < num_deq; i++) {
+    if (ops.at(i)->status != 0) {
+      AGORA_LOG_WARN("ACC100: encode op failed with status 0x%x\n",
+                     ops.at(i)->status);
+    }
+    // A queue returns its ops in order, so this is the oldest slot
+    const size_t tag = reinterpret_cast<size_t>(ops.at(i)->opaque_data);
+    StoreCodeblock(GetCodeblockIds(tag), 0, SlotOutput(deq_ % ops_.size()));
+    deq_++;
+#if defined(ENQUEUE_ASYNC)
+    duration_stat_->task_count_++;
+    EventData resp_event;
+    if (pending_requests_.RetireOp(resp_event)) {
+      PostCompletion(resp_event);
+    }
+#endif
+  }
+  if (num_deq > 0) {
+    stats_->SetAccOpsInFlight(tid_, Direction::kDownlink, enq_ - deq_);
+#if defined(ENQUEUE_ASYNC)
+    duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc;
+#endif
+  }
+  unused(start_tsc);
+  return num_deq;
+}
+
+#if defined(ENQUEUE_ASYNC)
+bool DoEncode_ACC::TryLaunch(
+    moodycamel::ConcurrentQueue<EventData>& task_queue,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  // Completions go to the queue of their own frame, which is not necessarily
+  // the one this worker is currently serving
+  bool work_done = RetireOps() > 0;
+  EventData req_event;
+  if (task_queue.try_dequeue(req_event)) {
+    LaunchEventTraced(req_event, complete_task_queue, worker_ptok);
+    work_done = true;
+  }
+  return work_done;
+}
+
+void DoEncode_ACC::LaunchEvent(
+    const EventData& req_event,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  unused(complete_task_queue);
+  unused(worker_ptok);
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  EnqueueCodeblocks(req_event);
+  duration_stat_->task_duration_[1] += GetTime::WorkerRdtsc() - start_tsc;
+}
+
+void DoEncode_ACC::PostCompletion(const EventData& event) {
+  EventData resp_event(EventType::kEncode);
+  resp_event.num_tags_ = event.num_tags_;
+  resp_event.tags_ = event.tags_;
+  if (IsLastSharedTask(resp_event) == false) {
+    return;
+  }
+  const size_t qid =
+      gen_tag_t(resp_event.tags_.at(0)).frame_id_ % cfg_->PipelineDepth();
+  TryEnqueueFallback(&message_->GetCompQueue(qid),
+                     message_->GetWorkerPtok(qid, tid_), resp_event);
+}
+#else
+EventData DoEncode_ACC::Launch(size_t tag) {
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  EnqueueCodeblocks(EventData(EventType::kEncode, tag));
+  while (deq_ < enq_) {
+    RetireOps();
+  }
+  UpdateStats(start_tsc, 1);
+  return EventData(EventType::kEncode, tag);
+}
+
+void DoEncode_ACC::LaunchEvent(
+    const EventData& req_event,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  EnqueueCodeblocks(req_event);
+  while (deq_ < enq_) {
+    RetireOps();
+  }
+  UpdateStats(start_tsc, req_event.num_tags_);
+
+  EventData resp_event(EventType::kEncode);
+  resp_event.num_tags_ = req_event.num_tags_;
+  resp_event.tags_ = req_event.tags_;
+  if (IsLastSharedTask(resp_event)) {
+    TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
+  }
+}
+#endif  // ENQUEUE_ASYNC
@@ -0,0 +1,109 @@
+/**
+ * @file doencode_acc.h
+ * @brief Declaration file for the DoEncode class with ACC100 acceleration.
+ */
+
+#ifdef USE_ACC100
+
+#ifndef DOENCODE_ACC_H_
+#define DOENCODE_ACC_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "bbdev_device.h"
+#include "config.h"
+#include "doencode.h"
+#include "mac_scheduler.h"
+#include "memory_manage.h"
+#include "message.h"
+#include "rte_bbdev.h"
+#include "rte_bbdev_op.h"
+#include "rte_mbuf.h"
+#include "stats.h"
+
+/// Downlink LDPC encoder that runs the encoding, and the rate matching when
+/// the card offers it, on the bbdev encode queue of its worker. Scrambling,
+/// the modulation bits and the fused modulation stay those of DoEncode.
+class DoEncode_ACC : public DoEncode {
+ public:
+  DoEncode_ACC(Config* in_config, int in_tid,
+               Table<int8_t>& in_raw_data_buffer, size_t in_buffer_rollover,
+               Table<int8_t>& in_mod_bits_buffer, MacScheduler* mac_sched,
+               Stats* in_stats_manager, MessageInfo* message);
+  ~DoEncode_ACC() override;
+
+#if defined(ENQUEUE_ASYNC)
+  /// Asynchronous mode: enqueue the code blocks of an encode request into the
+  /// accelerator and return without waiting for them. Every call also polls
+  /// the accelerator, and a request is reported to the completion queue of
+  /// its frame once all of its code blocks are stored.
+  bool TryLaunch(moodycamel::ConcurrentQueue<EventData>& task_queue,
+                 moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                 moodycamel::ProducerToken* worker_ptok) override;
+  bool Poll() override { return RetireOps() > 0; }
+#else
+  EventData Launch(size_t tag) override;
+#endif
+
+  /// Encode all the code blocks of the event with one enqueue
+  void LaunchEvent(const EventData& req_event,
+                   moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                   moodycamel::ProducerToken* worker_ptok) override;
+
+ private:
+  /// Set the static LDPC parameters of an encode op
+  void InitEncOp(struct rte_bbdev_enc_op* op);
+
+  /// Scramble the code blocks of req_event into the input buffers of their
+  /// op slots and enqueue them, retiring ops while the card is full
+  void EnqueueCodeblocks(const EventData& req_event);
+
+  /// Dequeue the finished ops and store their code blocks. Returns the
+  /// number of ops dequeued.
+  size_t RetireOps();
+
+#if defined(ENQUEUE_ASYNC)
+  /// Post a completed encode request to the queue of its frame
+  void PostCompletion(const EventData& event);
+
+  // The encode requests with code blocks still in the accelerator
+  Bbdev::PendingRequests pending_requests_;
+#endif
+
+  inline int8_t* SlotInput(size_t slot) const {
+    return slot_inputs_ + slot * input_stride_;
+  }
+  inline int8_t* SlotOutput(size_t slot) const {
+    return slot_outputs_ + slot * output_stride_;
+  }
+
+  Stats* stats_;
+  MessageInfo* message_;
+  // The bbdev queue owned by this encoder, one per worker thread
+  Bbdev::Queue queue_;
+  // RTE_BBDEV_LDPC_* flags of every op
+  uint32_t op_flags_;
+
+  // A ring of kEncodeOps op slots, used in enqueue order. Each has an op, an
+  // input and an output buffer in DPDK memory, and mbufs attached to them
+  // once. enq_ and deq_ count the ops enqueued and dequeued so far.
+  std::vector<struct rte_bbdev_enc_op*> ops_;
+  std::vector<struct rte_mbuf*> in_mbufs_;
+  std::vector<struct rte_mbuf*> out_mbufs_;
+  int8_t* slot_inputs_;
+  int8_t* slot_outputs_;
+  size_t input_stride_;
+  size_t output_stride_;
+  size_t enq_ = 0;
+  size_t deq_ = 0;
+  struct rte_mempool* ops_mp_;
+  // Shared by all external buffers. The buffers are freed with the encoder,
+  // so the free callback does nothing.
+  struct rte_mbuf_ext_shared_info ext_shinfo_;
+};
+
+#endif  // DOENCODE_ACC_H_
+
+#endif  // USE_ACC100
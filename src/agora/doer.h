@@ -6,72 +6,161 @@
 #ifndef DOER_H_
 #define DOER_H_
 
+#include <array>
 #include <cstddef>
-#include <queue>
+#include <cstdint>
 
+#include "analog_beams.h"
 #include "concurrent_queue_wrapper.h"
 #include "concurrentqueue.h"
 #include "config.h"
+#include "data_tap.h"
+#include "event_tracer.h"
+#include "gettime.h"
+#include "heap_counter.h"
 #include "message.h"
+#include "perf_counters.h"
+#include "shared_counters.h"
+#include "stall_monitor.h"
+#include "stats.h"
 #include "utils.h"
 
 class Doer {
  public:
-#ifdef SINGLE_THREAD
-  virtual bool TryLaunch(std::queue<EventData>& task_queue,
-                         std::queue<EventData>& complete_task_queue) {
+  virtual bool TryLaunch(
+      moodycamel::ConcurrentQueue<EventData>& task_queue,
+      moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+      moodycamel::ProducerToken* worker_ptok) {
+    if (cfg_->TaskPrefetch()) {
+      return TryLaunchPrefetched(task_queue, complete_task_queue,
+                                 worker_ptok);
+    }
     EventData req_event;
 
     ///Each event is handled by 1 Doer(Thread) and each tag is processed sequentually
-    if (!task_queue.empty()) {  // TODO: remove try launch but directly launch
-      req_event = task_queue.front();
-      task_queue.pop();
-      // We will enqueue one response event containing results for all
-      // request tags in the request event
-      EventData resp_event;
-      resp_event.num_tags_ = req_event.num_tags_;
-      resp_event.event_type_ = req_event.event_type_;
-
-      for (size_t i = 0; i < req_event.num_tags_; i++) {
-        EventData doer_comp = Launch(req_event.tags_.at(i));
-        RtAssert(doer_comp.num_tags_ == 1, "Invalid num_tags in resp");
-        resp_event.tags_.at(i) = doer_comp.tags_.at(0);
-        RtAssert(resp_event.event_type_ == doer_comp.event_type_,
-                 "Invalid event type in resp");
-      }
-      complete_task_queue.push(resp_event);
+    if (task_queue.try_dequeue(req_event)) {
+      LaunchEventTraced(req_event, complete_task_queue, worker_ptok);
       return true;
     }
     return false;
   }
-#else
-  virtual bool TryLaunch(
+
+  /// TryLaunch() with task_prefetch: take up to kTaskLookahead events of the
+  /// queue at once, and prefetch the inputs of each next event before the
+  /// current one runs, so that they arrive while it runs
+  bool TryLaunchPrefetched(
       moodycamel::ConcurrentQueue<EventData>& task_queue,
       moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
       moodycamel::ProducerToken* worker_ptok) {
-    EventData req_event;
-
-    ///Each event is handled by 1 Doer(Thread) and each tag is processed sequentually
-    if (task_queue.try_dequeue(req_event)) {
-      // We will enqueue one response event containing results for all
-      // request tags in the request event
-      EventData resp_event;
-      resp_event.num_tags_ = req_event.num_tags_;
-      resp_event.event_type_ = req_event.event_type_;
-
-      for (size_t i = 0; i < req_event.num_tags_; i++) {
-        EventData doer_comp = Launch(req_event.tags_.at(i));
-        RtAssert(doer_comp.num_tags_ == 1, "Invalid num_tags in resp");
-        resp_event.tags_.at(i) = doer_comp.tags_.at(0);
-        RtAssert(resp_event.event_type_ == doer_comp.event_type_,
-                 "Invalid event type in resp");
+    std::array<EventData, kTaskLookahead> req_events;
+    const size_t num_events =
+        task_queue.try_dequeue_bulk(req_events.data(), kTaskLookahead);
+    for (size_t i = 0; i < num_events; i++) {
+      if (i + 1 < num_events) {
+        const EventData& next_event = req_events.at(i + 1);
+        for (size_t j = 0; j < next_event.num_tags_; j++) {
+          PrefetchTask(next_event.tags_.at(j));
+        }
       }
+      LaunchEventTraced(req_events.at(i), complete_task_queue, worker_ptok);
+    }
+    return num_events > 0;
+  }
+
+  /// Process all tags of a request event and post one response event
+  /// containing the results for all of them
+  virtual void LaunchEvent(
+      const EventData& req_event,
+      moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+      moodycamel::ProducerToken* worker_ptok) {
+    const EventData resp_event = RunTasks(req_event);
+    if (IsLastSharedTask(resp_event)) {
       TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
-      return true;
     }
-    return false;
   }
-#endif
+
+  /// LaunchEvent(), recorded in the trace ring of the worker if tracing is
+  /// enabled, with its heap allocations counted if COUNT_HEAP_ALLOCS is, and
+  /// with its hardware counters if it is sampled
+  void LaunchEventTraced(
+      const EventData& req_event,
+      moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+      moodycamel::ProducerToken* worker_ptok) {
+    const size_t start_allocs = HeapCounter::ThreadAllocs();
+    const bool perf_sample = (perf_counters_ != nullptr) &&
+                             (alloc_stat_ != nullptr) &&
+                             perf_counters_->Sample();
+    PerfCounters::Counts start_counts{};
+    size_t perf_start_tsc = 0;
+    if (perf_sample) {
+      perf_counters_->Read(start_counts);
+      perf_start_tsc = GetTime::Rdtsc();
+    }
+    if (progress_ != nullptr) {
+      progress_->Begin(req_event);
+    }
+    if (trace_ring_ == nullptr) {
+      LaunchEvent(req_event, complete_task_queue, worker_ptok);
+    } else {
+      const size_t start_tsc = GetTime::Rdtsc();
+      LaunchEvent(req_event, complete_task_queue, worker_ptok);
+      trace_ring_->Record(req_event, start_tsc, GetTime::Rdtsc());
+    }
+    if (progress_ != nullptr) {
+      progress_->End();
+    }
+    if (perf_sample) {
+      alloc_stat_->perf_tsc_ += GetTime::Rdtsc() - perf_start_tsc;
+      PerfCounters::Counts counts;
+      perf_counters_->Read(counts);
+      for (size_t i = 0; i < PerfCounters::kNumEvents; i++) {
+        alloc_stat_->perf_counts_[i] += counts[i] - start_counts[i];
+      }
+      alloc_stat_->perf_events_++;
+    }
+    if (HeapCounter::kEnabled && (alloc_stat_ != nullptr)) {
+      alloc_stat_->heap_allocs_ += HeapCounter::ThreadAllocs() - start_allocs;
+    }
+  }
+
+  /// Record the events of this doer in the trace ring of its worker
+  void SetTraceRing(TraceRing* trace_ring) { trace_ring_ = trace_ring; }
+
+  /// Report the events of this doer in the progress of its worker, which
+  /// the stall monitor watches
+  void SetProgress(WorkerProgress* progress) { progress_ = progress; }
+
+  /// Sample the hardware counters of the worker around the events of this
+  /// doer
+  void SetPerfCounters(PerfCounters* perf_counters) {
+    perf_counters_ = perf_counters;
+  }
+
+  /// Publish the data of this doer to the taps of its cell. Doers that
+  /// delegate to other doers pass them on.
+  virtual void SetTaps(DataTaps* taps) { taps_ = taps; }
+
+  /// Measure the pilot power of the analog beams of the cell
+  void SetAnalogBeams(AnalogBeams* analog_beams) {
+    analog_beams_ = analog_beams;
+  }
+
+  /// Count the tasks of this doer in counters shared with the other workers
+  /// instead of posting every response to the master. Doers that delegate
+  /// to other doers pass them on.
+  virtual void SetSharedCounters(SharedTaskCounters* shared_counters) {
+    shared_counters_ = shared_counters;
+  }
+
+  /// Make progress on work that completes outside of LaunchEvent (e.g. an
+  /// accelerator). Called by workers that do not go through TryLaunch.
+  /// Returns true if anything was done.
+  virtual bool Poll() { return false; }
+
+  /// Do work ahead of the tasks, off the critical path, when the worker
+  /// found no task. Doers with no such work do nothing. Returns true if
+  /// anything was done.
+  virtual bool IdleWork() { return false; }
 
   /// The main event handling function that performs Doer-specific work.
   /// Doers that handle only one event type use this signature.
@@ -90,11 +179,104 @@ class Doer {
     return EventData();
   }
 
+  /// Issue software prefetches for the inputs and outputs of the task of tag,
+  /// which this doer runs next. Doers without a prefetch do nothing.
+  virtual void PrefetchTask(size_t tag) { unused(tag); }
+
+  /// Process the num_tags tags of one request event, all of the same frame
+  /// and symbol, and return the response event with a tag per task. Doers
+  /// override this to share the setup of the tasks of an event; by default
+  /// each tag is launched on its own.
+  virtual EventData LaunchBatch(const size_t* tags, size_t num_tags) {
+    EventData resp_event;
+    resp_event.num_tags_ = num_tags;
+    for (size_t i = 0; i < num_tags; i++) {
+      const EventData doer_comp = Launch(tags[i]);
+      RtAssert(doer_comp.num_tags_ == 1, "Invalid num_tags in resp");
+      RtAssert((i == 0) || (resp_event.event_type_ == doer_comp.event_type_),
+               "Invalid event type in resp");
+      resp_event.event_type_ = doer_comp.event_type_;
+      resp_event.tags_.at(i) = doer_comp.tags_.at(0);
+    }
+    return resp_event;
+  }
+
  protected:
-  Doer(Config* in_config, int in_tid) : cfg_(in_config), tid_(in_tid) {}
+  /// Events a worker takes from a task queue at once with task_prefetch
+  static constexpr size_t kTaskLookahead = 2;
+
+  /// Prefetch the cache lines of bytes from addr into the L2, so that they
+  /// do not evict the lines of the task that runs meanwhile. Lines that are
+  /// written are requested for ownership.
+  static void PrefetchRange(const void* addr, size_t bytes, bool for_write) {
+    static constexpr uintptr_t kLineBytes = 64;
+    const uintptr_t end = reinterpret_cast<uintptr_t>(addr) + bytes;
+    for (uintptr_t line = reinterpret_cast<uintptr_t>(addr) & ~(kLineBytes - 1);
+         line < end; line += kLineBytes) {
+      if (for_write) {
+        __builtin_prefetch(reinterpret_cast<const void*>(line), 1, 2);
+      } else {
+        __builtin_prefetch(reinterpret_cast<const void*>(line), 0, 2);
+      }
+    }
+  }
+
+  Doer(Config* in_config, int in_tid) : cfg_(in_config), tid_(in_tid) {
+    // Doers are created by the pinned thread that runs them
+    if (cfg_->NumaBindBuffers()) {
+      numa_node_ = CurrentNumaNode();
+      scratch_policy_.numa_node_ = numa_node_;
+    }
+  }
   virtual ~Doer() = default;
 
+  /// Process all tags of a request event and return the response event
+  /// containing the results for all of them
+  EventData RunTasks(const EventData& req_event) {
+    const EventData resp_event =
+        LaunchBatch(req_event.tags_.data(), req_event.num_tags_);
+    RtAssert(resp_event.num_tags_ == req_event.num_tags_,
+             "Invalid num_tags in resp");
+    RtAssert(resp_event.event_type_ == req_event.event_type_,
+             "Invalid event type in resp");
+    return resp_event;
+  }
+
+  /// True if the response event must be posted to the master: always without
+  /// shared counters, and only for the last tasks of the symbol with them
+  bool IsLastSharedTask(const EventData& resp_event) {
+    if (shared_counters_ == nullptr) {
+      return true;
+    }
+    // All the tags of a batched event are of the same frame and symbol
+    const gen_tag_t tag(resp_event.tags_[0]);
+    return shared_counters_->CompleteTasks(tag.frame_id_, tag.symbol_id_,
+                                           resp_event.num_tags_);
+  }
+
   Config* cfg_;
   int tid_;  // Thread ID of this Doer
+  // Placement of the per-doer scratch buffers. They are small, so they use
+  // regular pages even if the AgoraBuffer tables use hugepages.
+  Agora_memory::MemoryPolicy scratch_policy_;
+  // NUMA node of the thread with numa_bind_buffers, whose copies of the
+  // read-only Config tables the doer reads. -1 for the master's copies.
+  int numa_node_ = -1;
+  // Shared task counters of the event type of this doer, nullptr if the
+  // master counts the tasks
+  SharedTaskCounters* shared_counters_ = nullptr;
+  // Trace ring of the worker, nullptr if tracing is disabled
+  TraceRing* trace_ring_ = nullptr;
+  // Progress of the worker, nullptr if stalls are not detected
+  WorkerProgress* progress_ = nullptr;
+  // Stat that counts the heap allocations and the sampled hardware counters
+  // of the events of this doer, nullptr to not count them
+  DurationStat* alloc_stat_ = nullptr;
+  // Hardware counters of the worker, nullptr if they are not sampled
+  PerfCounters* perf_counters_ = nullptr;
+  // Taps of the cell, nullptr if nothing is tapped
+  DataTaps* taps_ = nullptr;
+  // Analog beams of the cell, nullptr if they are not managed
+  AnalogBeams* analog_beams_ = nullptr;
 };
 #endif  // DOER_H_
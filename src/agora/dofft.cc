@@ -4,10 +4,17 @@
  */
 #include "dofft.h"
 
+#include <algorithm>
+#include <array>
+
 #include "comms-lib.h"
 #include "concurrent_queue_wrapper.h"
 #include "datatype_conversion.h"
 #include "logger.h"
+#include "oran_fronthaul.h"
+#include "small_mimo_kernels.h"
+#include "streaming_store.h"
+#include "tile_layout.h"
 
 static constexpr bool kPrintFFTInput = false;
 static constexpr bool kPrintInputPilot = false;
@@ -16,108 +23,129 @@ static constexpr bool kPrintPilotCorrStats = false;
 DoFFT::DoFFT(Config* config, size_t tid, Table<complex_float>& data_buffer,
              PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers,
              Table<complex_float>& calib_dl_buffer,
-             Table<complex_float>& calib_ul_buffer, PhyStats* in_phy_stats,
+             Table<complex_float>& calib_ul_buffer,
+             std::vector<RxPacket*>& symbol_packets, PhyStats* in_phy_stats,
              Stats* stats_manager)
     : Doer(config, tid),
       data_buffer_(data_buffer),
-      csi_buffers_(csi_buffers),
+      csi_buffers_(csi_buffers.Flat()),
       calib_dl_buffer_(calib_dl_buffer),
       calib_ul_buffer_(calib_ul_buffer),
+      symbol_packets_(&symbol_packets),
+      shift_in_conversion_((config->ScSliceNodes() > 1) ||
+                           config->OranFronthaul() ||
+                           ((config->FftInRru() == false) &&
+                            (kUse12BitIQ == false) &&
+                            (config->FronthaulBfpBits() == 0) &&
+                            (config->OfdmCaNum() % 2 == 0))),
+      nt_csi_(config->NtStores("csi")),
+      nt_fft_(config->NtStores("fft")),
       phy_stats_(in_phy_stats) {
   duration_stat_fft_ = stats_manager->GetDurationStat(DoerType::kFFT, tid);
   duration_stat_csi_ = stats_manager->GetDurationStat(DoerType::kCSI, tid);
-  DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  DftiCommitDescriptor(mkl_handle_);
+  alloc_stat_ = duration_stat_fft_;
+  fft_plan_ = FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum());
+  if (cfg_->FftInt16()) {
+    int16_fft_ = std::make_unique<Int16Fft>(cfg_->OfdmCaNum());
+  }
 
   // Aligned for SIMD
   fft_inout_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
       Agora_memory::Alignment_t::kAlign64,
-      cfg_->OfdmCaNum() * sizeof(complex_float)));
+      cfg_->OfdmCaNum() * sizeof(complex_float), scratch_policy_));
   fft_shift_tmp_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
       Agora_memory::Alignment_t::kAlign64,
-      cfg_->OfdmCaNum() * sizeof(complex_float)));
-  temp_16bits_iq_ = static_cast<uint16_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64, 32 * sizeof(uint16_t)));
+      cfg_->OfdmCaNum() * sizeof(complex_float), scratch_policy_));
   rx_samps_tmp_ =
       static_cast<std::complex<float>*>(Agora_memory::PaddedAlignedAlloc(
           Agora_memory::Alignment_t::kAlign64,
-          cfg_->SampsPerSymbol() * sizeof(std::complex<float>)));
-}
+          cfg_->SampsPerSymbol() * sizeof(std::complex<float>),
+          scratch_policy_));
 
-DoFFT::~DoFFT() {
-  DftiFreeDescriptor(&mkl_handle_);
-  std::free(fft_inout_);
-  std::free(fft_shift_tmp_);
-  std::free(rx_samps_tmp_);
-  std::free(temp_16bits_iq_);
+  if (cfg_->FftBatchSymbol()) {
+    // Each antenna's row of the batch buffer must stay aligned for SIMD
+    RtAssert(cfg_->OfdmCaNum() % kSCsPerCacheline == 0,
+             "DoFFT: FFT size is not a multiple of the subcarriers per "
+             "cacheline");
+    fft_batch_plan_ =
+        FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum(), cfg_->BsAntNum());
+    fft_batch_inout_ =
+        static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            cfg_->BsAntNum() * cfg_->OfdmCaNum() * sizeof(complex_float),
+            scratch_policy_));
+  }
 }
 
-// @brief
-// @in_vec: input complex data to estimate regression params
-// @x0: value of the first x data (assumed consecutive integers)
-// @out_vec: output complex data with linearly regressed phase
-static inline void CalibRegressionEstimate(const arma::cx_fvec& in_vec,
-                                           arma::cx_fvec& out_vec, size_t x0) {
-  size_t in_len = in_vec.size();
-  size_t out_len = out_vec.size();
-  std::vector<float> scs(out_len, 0);
-  for (size_t i = 0; i < out_len; i++) {
-    scs[i] = i;
+DoFFT::~DoFFT() {
+  Agora_memory::PaddedAlignedFree(fft_inout_);
+  Agora_memory::PaddedAlignedFree(fft_shift_tmp_);
+  Agora_memory::PaddedAlignedFree(rx_samps_tmp_);
+  if (fft_batch_inout_ != nullptr) {
+    Agora_memory::PaddedAlignedFree(fft_batch_inout_);
   }
-  arma::fvec x_vec((float*)scs.data() + x0, in_len, false);
-  arma::fvec in_phase = arg(in_vec);
-  arma::fvec in_mag = abs(in_vec);
-
-  // finding regression parameters from the input vector
-  // https://www.cse.wustl.edu/~jain/iucee/ftp/k_14slr.pdf
-  arma::fvec xy = in_phase % x_vec;
-  float xbar = arma::mean(x_vec);
-  float ybar = arma::mean(in_phase);
-  float coeff = (arma::sum(xy) - in_len * xbar * ybar) /
-                (arma::sum(arma::square(x_vec)) - in_len * xbar * xbar);
-  float intercept = ybar - coeff * xbar;
-
-  // extrapolating phase for the target subcarrier using regression
-  arma::fvec x_vec_all((float*)scs.data(), out_len, false);
-  arma::fvec tar_angle = coeff * x_vec_all + intercept;
-  out_vec.set_real(arma::cos(tar_angle));
-  out_vec.set_imag(arma::sin(tar_angle));
-  out_vec *= arma::mean(in_mag);
 }
 
-EventData DoFFT::Launch(size_t tag) {
-  const size_t start_tsc = GetTime::WorkerRdtsc();
-  Packet* pkt = fft_req_tag_t(tag).rx_packet_->RawPacket();
+void DoFFT::ConvertSamples(const Packet* pkt, const short* samples,
+                           SymbolType sym_type, complex_float* fft_in) {
   const size_t frame_id = pkt->frame_id_;
-  const size_t frame_slot = frame_id % kFrameWnd;
   const size_t symbol_id = pkt->symbol_id_;
   const size_t ant_id = pkt->ant_id_;
-  const size_t radio_id = ant_id / cfg_->NumChannels();
   const size_t cell_id = pkt->cell_id_;
-  const SymbolType sym_type = cfg_->GetSymbolType(symbol_id);
 
-  if (cfg_->FftInRru() == true) {
+  if (cfg_->OranFronthaul()) {
+    // The PRBs of the data subcarriers from the RU, lowest first
+    OranDecompress(reinterpret_cast<const uint8_t*>(samples),
+                   &fft_in[cfg_->OfdmDataStart()],
+                   cfg_->OfdmDataNum() / kOranPrbSubcarriers,
+                   cfg_->OranBfpBits());
+  } else if (cfg_->ScSliceNodes() > 1) {
+    // The packet holds only this node's slice, already FFT-shifted
     SimdConvertFloat16ToFloat32(
-        reinterpret_cast<float*>(fft_inout_),
-        reinterpret_cast<float*>(&pkt->data_[2 * cfg_->OfdmRxZeroPrefixBs()]),
+        reinterpret_cast<float*>(&fft_in[cfg_->OfdmDataStart()]),
+        reinterpret_cast<const float*>(samples), cfg_->OfdmDataNum() * 2);
+  } else if (cfg_->FftInRru() == true) {
+    SimdConvertFloat16ToFloat32(
+        reinterpret_cast<float*>(fft_in),
+        reinterpret_cast<const float*>(
+            &samples[2 * cfg_->OfdmRxZeroPrefixBs()]),
         cfg_->OfdmCaNum() * 2);
   } else {
+    const size_t sample_offset = SampleOffset(sym_type);
     if (kUse12BitIQ) {
       SimdConvert12bitIqToFloat(
-          (uint8_t*)pkt->data_ + 3 * cfg_->OfdmRxZeroPrefixBs(),
-          reinterpret_cast<float*>(fft_inout_), temp_16bits_iq_,
-          cfg_->OfdmCaNum() * 3);
+          (const uint8_t*)samples + 3 * cfg_->OfdmRxZeroPrefixBs(),
+          reinterpret_cast<float*>(fft_in), cfg_->OfdmCaNum() * 3);
+    } else if (cfg_->FronthaulBfpBits() != 0) {
+      // Decompress the FFT window straight into the FFT input
+      BfpDecompressToFloat(reinterpret_cast<const uint8_t*>(samples),
+                           reinterpret_cast<float*>(fft_in), sample_offset,
+                           cfg_->OfdmCaNum(), cfg_->FronthaulBfpBits());
+    } else if (cfg_->CfoCorrection() && ((sym_type == SymbolType::kPilot) ||
+                                         (sym_type == SymbolType::kUL))) {
+      // Derotate the FFT window by the offset of its own cyclic prefix, in
+      // the conversion, together with the FFT shift
+      const short* window = &samples[2 * sample_offset];
+      const float cfo = CommsLib::EstimateCfoCp(
+          window - (2 * cfg_->CpLen()), cfg_->CpLen(), cfg_->OfdmCaNum());
+      SimdConvertShortToFloatRotate(window, reinterpret_cast<float*>(fft_in),
+                                    cfg_->OfdmCaNum() * 2, -cfo,
+                                    shift_in_conversion_);
+      AGORA_LOG_TRACE(
+          "DoFFT[%d]: (Frame %zu, Symbol %zu, Ant %zu) - CFO of %.3f "
+          "subcarriers\n",
+          tid_, frame_id, symbol_id, ant_id,
+          cfo * cfg_->OfdmCaNum() / (2 * M_PI));
     } else {
-      size_t sample_offset = cfg_->OfdmRxZeroPrefixBs();
-      if (sym_type == SymbolType::kCalDL) {
-        sample_offset = cfg_->OfdmRxZeroPrefixCalDl();
-      } else if (sym_type == SymbolType::kCalUL) {
-        sample_offset = cfg_->OfdmRxZeroPrefixCalUl();
+      if (shift_in_conversion_) {
+        SimdConvertShortToFloatFftShift(&samples[2 * sample_offset],
+                                        reinterpret_cast<float*>(fft_in),
+                                        cfg_->OfdmCaNum() * 2);
+      } else {
+        SimdConvertShortToFloat(&samples[2 * sample_offset],
+                                reinterpret_cast<float*>(fft_in),
+                                cfg_->OfdmCaNum() * 2);
       }
-      SimdConvertShortToFloat(&pkt->data_[2 * sample_offset],
-                              reinterpret_cast<float*>(fft_inout_),
-                              cfg_->OfdmCaNum() * 2);
     }
     if (kDebugPrintInTask) {
       std::printf("In doFFT thread %d: frame: %zu, symbol: %zu, ant: %zu\n",
@@ -128,7 +156,7 @@ EventData DoFFT::Launch(size_t tag) {
         ((sym_type == SymbolType::kPilot) || (sym_type == SymbolType::kCalUL) ||
          ((sym_type == SymbolType::kCalDL) &&
           (ant_id == cfg_->RefAnt(cell_id))))) {
-      SimdConvertShortToFloat(pkt->data_,
+      SimdConvertShortToFloat(samples,
                               reinterpret_cast<float*>(rx_samps_tmp_),
                               2 * cfg_->SampsPerSymbol());
       std::vector<std::complex<float>> samples_vec(
@@ -151,7 +179,7 @@ EventData DoFFT::Launch(size_t tag) {
       std::stringstream ss;
       ss << "FFT_input_" << symbol_id << "_" << ant_id << "=[";
       for (size_t i = 0; i < cfg_->SampsPerSymbol(); i++) {
-        ss << pkt->data_[2 * i] << "+1j*" << pkt->data_[2 * i + 1] << " ";
+        ss << samples[2 * i] << "+1j*" << samples[2 * i + 1] << " ";
       }
       ss << "];" << std::endl;
       std::cout << ss.str();
@@ -161,58 +189,84 @@ EventData DoFFT::Launch(size_t tag) {
       ss << "FFT_input_" << symbol_id << "_" << ant_id << "=[";
       for (size_t i = 0; i < cfg_->OfdmCaNum(); i++) {
         ss << std::fixed << std::setw(5) << std::setprecision(3)
-           << fft_inout_[i].re << "+1j*" << fft_inout_[i].im << " ";
+           << fft_in[i].re << "+1j*" << fft_in[i].im << " ";
       }
       ss << "];" << std::endl;
       std::cout << ss.str();
     }
   }
+}
 
-  DurationStat dummy_duration_stat;  // TODO: timing for calibration symbols
-  DurationStat* duration_stat = nullptr;
-  if (sym_type == SymbolType::kUL) {
-    duration_stat = duration_stat_fft_;
-  } else if (sym_type == SymbolType::kPilot) {
-    duration_stat = duration_stat_csi_;
-  } else {
-    duration_stat = &dummy_duration_stat;  // For calibration symbols
+size_t DoFFT::SampleOffset(SymbolType sym_type) const {
+  if (sym_type == SymbolType::kCalDL) {
+    return cfg_->OfdmRxZeroPrefixCalDl();
+  } else if (sym_type == SymbolType::kCalUL) {
+    return cfg_->OfdmRxZeroPrefixCalUl();
   }
+  return cfg_->OfdmRxZeroPrefixBs();
+}
 
-  size_t start_tsc1 = GetTime::WorkerRdtsc();
-  duration_stat->task_duration_.at(1) += start_tsc1 - start_tsc;
-
-  if (!cfg_->FftInRru() == true) {
-    DftiComputeForward(
-        mkl_handle_,
-        reinterpret_cast<float*>(fft_inout_));  // Compute FFT in-place
+void DoFFT::Int16Forward(const short* samples, SymbolType sym_type,
+                         complex_float* fft_out) {
+  int16_fft_->Forward(&samples[2 * SampleOffset(sym_type)]);
+  // Only the subcarriers of the uplink data are read, while the SNR of the
+  // pilots and calibration symbols is measured over the whole band
+  if (sym_type == SymbolType::kUL) {
+    int16_fft_->ToFloatShifted(fft_out, cfg_->OfdmDataStart(),
+                               cfg_->OfdmDataNum());
+  } else {
+    int16_fft_->ToFloatShifted(fft_out, 0, cfg_->OfdmCaNum());
   }
+}
 
-  //// FFT shift the buffer
-  std::memcpy(fft_shift_tmp_, fft_inout_, sizeof(float) * cfg_->OfdmCaNum());
-  std::memcpy(fft_inout_, fft_inout_ + cfg_->OfdmCaNum() / 2,
+void DoFFT::FftShift(complex_float* fft_buf) {
+  std::memcpy(fft_shift_tmp_, fft_buf, sizeof(float) * cfg_->OfdmCaNum());
+  std::memcpy(fft_buf, fft_buf + cfg_->OfdmCaNum() / 2,
               sizeof(float) * cfg_->OfdmCaNum());
-  std::memcpy(fft_inout_ + cfg_->OfdmCaNum() / 2, fft_shift_tmp_,
+  std::memcpy(fft_buf + cfg_->OfdmCaNum() / 2, fft_shift_tmp_,
               sizeof(float) * cfg_->OfdmCaNum());
+}
 
-  size_t start_tsc2 = GetTime::WorkerRdtsc();
-  duration_stat->task_duration_.at(2) += start_tsc2 - start_tsc1;
-
+void DoFFT::FillSymbolOutput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                             SymbolType sym_type, complex_float* fft_out) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kFftIq, frame_id)) {
+    taps_->Publish(TapPoint::kFftIq, frame_id, symbol_id, ant_id, 0,
+                   &fft_out[cfg_->OfdmDataStart()],
+                   cfg_->OfdmDataNum() * sizeof(complex_float));
+  }
   if (sym_type == SymbolType::kPilot) {
     const size_t pilot_symbol_id = cfg_->Frame().GetPilotSymbolIdx(symbol_id);
+    if (analog_beams_ != nullptr) {
+      analog_beams_->AddPilotPower(
+          frame_id, AnalogBeams::Power(&fft_out[cfg_->OfdmDataStart()],
+                                       cfg_->OfdmDataNum()));
+    }
 #if !defined(TIME_EXCLUSIVE)
     if (kCollectPhyStats) {
       if (cfg_->FreqOrthogonalPilot()) {
         for (size_t ue_id = 0; ue_id < cfg_->UeAntNum(); ue_id++) {
-          phy_stats_->UpdatePilotSnr(frame_id, ue_id, ant_id, fft_inout_);
+          phy_stats_->UpdatePilotSnr(frame_id, ue_id, ant_id, fft_out);
         }
       } else {
         phy_stats_->UpdatePilotSnr(frame_id, pilot_symbol_id, ant_id,
-                                   fft_inout_);
+                                   fft_out);
       }
     }
 #endif
-    FillOutputBuffer(csi_buffers_[frame_slot][pilot_symbol_id], ant_id,
-                     SymbolType::kPilot);
+    FillOutputBuffer(csi_buffers_[frame_slot][pilot_symbol_id], fft_out,
+                     ant_id, SymbolType::kPilot);
+    if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kCsi, frame_id)) {
+      // The CSI of the antenna in subcarrier order, in the shift buffer that
+      // is free once the FFT output is shifted
+      SmallMimo::Get().fill_output_(&fft_out[cfg_->OfdmDataStart()],
+                                    cfg_->PilotsSgn(), fft_shift_tmp_,
+                                    kSCsPerCacheline, cfg_->OfdmDataNum(),
+                                    false);
+      taps_->Publish(TapPoint::kCsi, frame_id, symbol_id, ant_id, 0,
+                     fft_shift_tmp_,
+                     cfg_->OfdmDataNum() * sizeof(complex_float));
+    }
 
     // Expand partial CSI from freq-orth pilot to full CSI per UE
     // TODO 1. allow pilot sc group size different than kTransposeBlockSize
@@ -239,9 +293,60 @@ EventData DoFFT::Launch(size_t tag) {
         }
       }
     }
-  } else if (sym_type == SymbolType::kUL) {
+  } else {
     FillOutputBuffer(cfg_->GetDataBuf(data_buffer_, frame_id, symbol_id),
-                     ant_id, SymbolType::kUL);
+                     fft_out, ant_id, SymbolType::kUL);
+  }
+}
+
+EventData DoFFT::Launch(size_t tag) {
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  RxPacket* rx_packet = fft_req_tag_t(tag).rx_packet_;
+  Packet* pkt = rx_packet->RawPacket();
+  const size_t frame_id = pkt->frame_id_;
+  const size_t symbol_id = pkt->symbol_id_;
+  const size_t ant_id = pkt->ant_id_;
+  const size_t radio_id = ant_id / cfg_->NumChannels();
+  const size_t cell_id = pkt->cell_id_;
+  const SymbolType sym_type = cfg_->GetSymbolType(symbol_id);
+
+  if (int16_fft_ == nullptr) {
+    ConvertSamples(pkt, rx_packet->Samples(), sym_type, fft_inout_);
+  }
+
+  DurationStat dummy_duration_stat;  // TODO: timing for calibration symbols
+  DurationStat* duration_stat = nullptr;
+  if (sym_type == SymbolType::kUL) {
+    duration_stat = duration_stat_fft_;
+  } else if (sym_type == SymbolType::kPilot) {
+    duration_stat = duration_stat_csi_;
+  } else {
+    duration_stat = &dummy_duration_stat;  // For calibration symbols
+  }
+
+  size_t start_tsc1 = GetTime::WorkerRdtsc();
+  duration_stat->task_duration_.at(1) += start_tsc1 - start_tsc;
+
+  if (int16_fft_ != nullptr) {
+    // The int16 samples are transformed as they arrive, and only the FFT
+    // output is converted to float
+    Int16Forward(rx_packet->Samples(), sym_type, fft_inout_);
+  } else {
+    if ((cfg_->FftInRru() == false) && (cfg_->OranFronthaul() == false)) {
+      fft_plan_->Forward(fft_inout_);  // Compute FFT in-place
+    }
+
+    //// FFT shift the buffer, unless the conversion already did
+    if (shift_in_conversion_ == false) {
+      FftShift(fft_inout_);
+    }
+  }
+
+  size_t start_tsc2 = GetTime::WorkerRdtsc();
+  duration_stat->task_duration_.at(2) += start_tsc2 - start_tsc1;
+
+  if ((sym_type == SymbolType::kPilot) || (sym_type == SymbolType::kUL)) {
+    FillSymbolOutput(frame_id, symbol_id, ant_id, sym_type, fft_inout_);
   } else if (sym_type == SymbolType::kCalUL) {
     // Only process uplink for antennas that also do downlink in this frame
     // for consistency with calib downlink processing.
@@ -255,7 +360,7 @@ EventData DoFFT::Launch(size_t tag) {
       complex_float* calib_ul_ptr =
           &calib_ul_buffer_[cal_index][ant_id * cfg_->OfdmDataNum()];
 
-      FillOutputBuffer(calib_ul_ptr, ant_id, sym_type);
+      FillOutputBuffer(calib_ul_ptr, fft_inout_, ant_id, sym_type);
 #if !defined(TIME_EXCLUSIVE)
       phy_stats_->UpdateCalibPilotSnr(cal_index, 1, ant_id, fft_inout_);
 #endif
@@ -276,7 +381,7 @@ EventData DoFFT::Launch(size_t tag) {
 
       complex_float* calib_dl_ptr =
           &calib_dl_buffer_[cal_index][pilot_tx_ant * cfg_->OfdmDataNum()];
-      FillOutputBuffer(calib_dl_ptr, pilot_tx_ant, sym_type);
+      FillOutputBuffer(calib_dl_ptr, fft_inout_, pilot_tx_ant, sym_type);
 #if !defined(TIME_EXCLUSIVE)
       phy_stats_->UpdateCalibPilotSnr(cal_index, 0, pilot_tx_ant, fft_inout_);
 #endif
@@ -297,98 +402,178 @@ EventData DoFFT::Launch(size_t tag) {
   duration_stat->task_duration_[3] += GetTime::WorkerRdtsc() - start_tsc2;
 
   fft_req_tag_t(tag).rx_packet_->Free();
+  StreamingStore::Fence();
   duration_stat->task_count_++;
   duration_stat->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
   return EventData(EventType::kFFT,
                    gen_tag_t::FrmSym(pkt->frame_id_, pkt->symbol_id_).tag_);
 }
 
-void DoFFT::FillOutputBuffer(complex_float* out_buf, size_t ant_id,
-                             SymbolType symbol_type) const {
-  bool partial_transpose = kUsePartialTrans;
-  if (cfg_->SmallMimoAcc()) {  // enables special case acceleration
-    // In special case of 2x2/4x4 MIMO, disable partial transpose to store
-    // desired data orders: for each (antenna, ue) pair, store subcarriers
-    // continuously. This reduces the data gathering time for CSI estimation.
-    if ((cfg_->BsAntNum() == 2 && cfg_->UeAntNum() == 2) ||
-        (cfg_->BsAntNum() == 4 && cfg_->UeAntNum() == 4)) {
-      if (symbol_type == SymbolType::kPilot || symbol_type == SymbolType::kUL) {
-#if defined(ARMA_CUBE_MATOP)
-        partial_transpose = kUsePartialTrans;
-#else  //  defined(AVX512_MATOP) || defined(ARMA_VEC_MATOP) || not defined
-        partial_transpose = false;
-#endif
-      }
+EventData DoFFT::LaunchSymbol(size_t tag) {
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+  const SymbolType sym_type = cfg_->GetSymbolType(symbol_id);
+  RtAssert((sym_type == SymbolType::kPilot) || (sym_type == SymbolType::kUL),
+           "DoFFT: symbol FFT task for a symbol that is not pilot or uplink");
+  RxPacket* const* rx_packets =
+      &symbol_packets_->at((((frame_id % cfg_->FrameWindow()) *
+                             cfg_->Frame().NumTotalSyms()) +
+                            symbol_id) *
+                           cfg_->BsAntNum());
+
+  // Antenna i of the symbol goes to row i of the batch buffer
+  if (int16_fft_ == nullptr) {
+    for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+      ConvertSamples(rx_packets[ant_id]->RawPacket(),
+                     rx_packets[ant_id]->Samples(), sym_type,
+                     &fft_batch_inout_[ant_id * cfg_->OfdmCaNum()]);
     }
   }
 
-  // We have OfdmDataNum() % kTransposeBlockSize == 0
-  const size_t num_sc_blocks = cfg_->OfdmDataNum() / kTransposeBlockSize;
-
-  for (size_t sc_block_idx = 0; sc_block_idx < num_sc_blocks; sc_block_idx++) {
-    const size_t sc_block_base_offset =
-        sc_block_idx * (kTransposeBlockSize * cfg_->BsAntNum());
-    // We have kTransposeBlockSize % kSCsPerCacheline == 0
-    for (size_t sc_j = 0; sc_j < kTransposeBlockSize;
-         sc_j += kSCsPerCacheline) {
-      const size_t sc_idx = (sc_block_idx * kTransposeBlockSize) + sc_j;
-      const complex_float* src = &fft_inout_[sc_idx + cfg_->OfdmDataStart()];
-
-      complex_float* dst = nullptr;
-      if ((symbol_type == SymbolType::kCalDL) ||
-          (symbol_type == SymbolType::kCalUL)) {
-        dst = &out_buf[sc_idx];
-      } else {
-        dst = partial_transpose
-                  ? &out_buf[sc_block_base_offset +
-                             (ant_id * kTransposeBlockSize) + sc_j]
-                  : &out_buf[(cfg_->OfdmDataNum() * ant_id) + sc_j +
-                             sc_block_idx * kTransposeBlockSize];
-      }
+  DurationStat* duration_stat =
+      (sym_type == SymbolType::kUL) ? duration_stat_fft_ : duration_stat_csi_;
+  size_t start_tsc1 = GetTime::WorkerRdtsc();
+  duration_stat->task_duration_.at(1) += start_tsc1 - start_tsc;
 
-      // With either of AVX-512 or AVX2, load one cacheline =
-      // 16 float values = 8 subcarriers = kSCsPerCacheline
-
-#ifdef __AVX512F__
-      // AVX-512.
-      __m512 fft_result = _mm512_load_ps(reinterpret_cast<const float*>(src));
-      if (symbol_type == SymbolType::kPilot) {
-        __m512 pilot_tx = _mm512_set_ps(
-            cfg_->PilotsSgn()[sc_idx + 7].im, cfg_->PilotsSgn()[sc_idx + 7].re,
-            cfg_->PilotsSgn()[sc_idx + 6].im, cfg_->PilotsSgn()[sc_idx + 6].re,
-            cfg_->PilotsSgn()[sc_idx + 5].im, cfg_->PilotsSgn()[sc_idx + 5].re,
-            cfg_->PilotsSgn()[sc_idx + 4].im, cfg_->PilotsSgn()[sc_idx + 4].re,
-            cfg_->PilotsSgn()[sc_idx + 3].im, cfg_->PilotsSgn()[sc_idx + 3].re,
-            cfg_->PilotsSgn()[sc_idx + 2].im, cfg_->PilotsSgn()[sc_idx + 2].re,
-            cfg_->PilotsSgn()[sc_idx + 1].im, cfg_->PilotsSgn()[sc_idx + 1].re,
-            cfg_->PilotsSgn()[sc_idx].im, cfg_->PilotsSgn()[sc_idx].re);
-        fft_result = CommsLib::M512ComplexCf32Mult(fft_result, pilot_tx, true);
-      }
-      _mm512_stream_ps(reinterpret_cast<float*>(dst), fft_result);
-#else
-      __m256 fft_result0 = _mm256_load_ps(reinterpret_cast<const float*>(src));
-      __m256 fft_result1 =
-          _mm256_load_ps(reinterpret_cast<const float*>(src + 4));
-      if (symbol_type == SymbolType::kPilot) {
-        __m256 pilot_tx0 = _mm256_set_ps(
-            cfg_->PilotsSgn()[sc_idx + 3].im, cfg_->PilotsSgn()[sc_idx + 3].re,
-            cfg_->PilotsSgn()[sc_idx + 2].im, cfg_->PilotsSgn()[sc_idx + 2].re,
-            cfg_->PilotsSgn()[sc_idx + 1].im, cfg_->PilotsSgn()[sc_idx + 1].re,
-            cfg_->PilotsSgn()[sc_idx].im, cfg_->PilotsSgn()[sc_idx].re);
-        fft_result0 =
-            CommsLib::M256ComplexCf32Mult(fft_result0, pilot_tx0, true);
-
-        __m256 pilot_tx1 = _mm256_set_ps(
-            cfg_->PilotsSgn()[sc_idx + 7].im, cfg_->PilotsSgn()[sc_idx + 7].re,
-            cfg_->PilotsSgn()[sc_idx + 6].im, cfg_->PilotsSgn()[sc_idx + 6].re,
-            cfg_->PilotsSgn()[sc_idx + 5].im, cfg_->PilotsSgn()[sc_idx + 5].re,
-            cfg_->PilotsSgn()[sc_idx + 4].im, cfg_->PilotsSgn()[sc_idx + 4].re);
-        fft_result1 =
-            CommsLib::M256ComplexCf32Mult(fft_result1, pilot_tx1, true);
+  if (int16_fft_ != nullptr) {
+    // The int16 transform is one antenna at a time
+    for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+      Int16Forward(rx_packets[ant_id]->Samples(), sym_type,
+                   &fft_batch_inout_[ant_id * cfg_->OfdmCaNum()]);
+    }
+  } else if ((cfg_->FftInRru() == false) &&
+             (cfg_->OranFronthaul() == false)) {
+    // One call for the FFTs of all the antennas, in-place
+    fft_batch_plan_->Forward(fft_batch_inout_);
+  }
+  if ((int16_fft_ == nullptr) && (shift_in_conversion_ == false)) {
+    for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+      FftShift(&fft_batch_inout_[ant_id * cfg_->OfdmCaNum()]);
+    }
+  }
+
+  size_t start_tsc2 = GetTime::WorkerRdtsc();
+  duration_stat->task_duration_.at(2) += start_tsc2 - start_tsc1;
+
+  for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+    FillSymbolOutput(frame_id, symbol_id, ant_id, sym_type,
+                     &fft_batch_inout_[ant_id * cfg_->OfdmCaNum()]);
+  }
+
+  duration_stat->task_duration_[3] += GetTime::WorkerRdtsc() - start_tsc2;
+
+  for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+    rx_packets[ant_id]->Free();
+  }
+  StreamingStore::Fence();
+  duration_stat->task_count_ += cfg_->BsAntNum();
+  duration_stat->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+  return EventData(EventType::kFFTSymbol, tag);
+}
+
+void DoFFT::LaunchEvent(
+    const EventData& req_event,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  const bool symbol_event = (req_event.event_type_ == EventType::kFFTSymbol);
+  if ((fusion_ == nullptr) && (symbol_event == false)) {
+    Doer::LaunchEvent(req_event, complete_task_queue, worker_ptok);
+    return;
+  }
+
+  EventData resp_event;
+  if (symbol_event) {
+    resp_event = EventData(EventType::kFFTSymbol);
+    resp_event.num_tags_ = req_event.num_tags_;
+    for (size_t i = 0; i < req_event.num_tags_; i++) {
+      resp_event.tags_.at(i) = LaunchSymbol(req_event.tags_.at(i)).tags_[0];
+    }
+  } else {
+    resp_event = RunTasks(req_event);
+  }
+  if (fusion_ == nullptr) {
+    TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
+    return;
+  }
+
+  // A task of a symbol event is the FFT of all the antennas of the symbol
+  const size_t antennas_per_tag = symbol_event ? cfg_->BsAntNum() : 1;
+  // The tags of a batched FFT event may be of different symbols
+  std::array<size_t, EventData::kMaxTags> fused_tags;
+  size_t num_fused = 0;
+  for (size_t i = 0; i < resp_event.num_tags_; i++) {
+    const gen_tag_t tag(resp_event.tags_.at(i));
+    if ((cfg_->GetSymbolType(tag.symbol_id_) == SymbolType::kUL) &&
+        fusion_->CompleteFft(tag.frame_id_, tag.symbol_id_,
+                             antennas_per_tag)) {
+      fused_tags.at(num_fused) = resp_event.tags_.at(i);
+      num_fused++;
+    }
+  }
+  // Post the FFT response first, the master handles it before the demul
+  // responses of this worker
+  TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
+
+  // The worker runs all the blocks, so they are batched as much as possible
+  EventData demul_event;
+  demul_event.event_type_ = EventType::kDemul;
+  for (size_t f = 0; f < num_fused; f++) {
+    const gen_tag_t fused_tag(fused_tags.at(f));
+    auto base_tag =
+        gen_tag_t::FrmSymSc(fused_tag.frame_id_, fused_tag.symbol_id_, 0);
+    const size_t num_events = cfg_->DemulEventsPerSymbol();
+    for (size_t i = 0; i < num_events; i += EventData::kMaxTags) {
+      demul_event.num_tags_ = std::min(EventData::kMaxTags, num_events - i);
+      for (size_t j = 0; j < demul_event.num_tags_; j++) {
+        demul_event.tags_.at(j) = base_tag.tag_;
+        base_tag.sc_id_ += cfg_->DemulBlockSize();
       }
-      _mm256_stream_ps(reinterpret_cast<float*>(dst), fft_result0);
-      _mm256_stream_ps(reinterpret_cast<float*>(dst + 4), fft_result1);
-#endif
+      demul_->LaunchEvent(demul_event, complete_task_queue, worker_ptok);
     }
   }
 }
+
+void DoFFT::FillOutputBuffer(complex_float* out_buf,
+                             const complex_float* fft_out, size_t ant_id,
+                             SymbolType symbol_type) const {
+  // The Armadillo vector kernels of 2x2/4x4 small_mimo_acc view each
+  // (antenna, ue) pair as one vector of all its subcarriers, so store the
+  // pilots and uplink data of every antenna as one plane for them. The
+  // SIMD and cube kernels read the tiles.
+  bool antenna_planes = false;
+#if !defined(ARMA_CUBE_MATOP) && !defined(SIMD_MATOP)
+  if (cfg_->SmallMimoAcc() &&
+      ((cfg_->BsAntNum() == 2 && cfg_->UeAntNum() == 2) ||
+       (cfg_->BsAntNum() == 4 && cfg_->UeAntNum() == 4)) &&
+      (symbol_type == SymbolType::kPilot || symbol_type == SymbolType::kUL)) {
+    antenna_planes = true;
+  }
+#endif
+
+  // We have OfdmDataNum() % kTransposeBlockSize == 0 and
+  // kTransposeBlockSize % kSCsPerCacheline == 0, so the output is written
+  // kSCsPerCacheline subcarriers = one cacheline at a time
+  complex_float* dst = nullptr;
+  size_t dst_chunk_stride = kSCsPerCacheline;
+  if ((symbol_type == SymbolType::kCalDL) ||
+      (symbol_type == SymbolType::kCalUL)) {
+    dst = out_buf;
+  } else if (antenna_planes) {
+    dst = &out_buf[cfg_->OfdmDataNum() * ant_id];
+  } else {
+    dst = &out_buf[TileLayout::Index(0, ant_id, cfg_->BsAntNum(),
+                                     cfg_->OfdmDataNum())];
+    dst_chunk_stride =
+        SmallMimo::TileChunks(cfg_->BsAntNum(), cfg_->OfdmDataNum())
+            .chunk_stride_;
+  }
+
+  // The pilot signs are stored as {re, im} pairs, like the FFT output
+  const complex_float* pilot_sgn =
+      (symbol_type == SymbolType::kPilot) ? cfg_->PilotsSgn() : nullptr;
+  SmallMimo::Get().fill_output_(
+      &fft_out[cfg_->OfdmDataStart()], pilot_sgn, dst, dst_chunk_stride,
+      cfg_->OfdmDataNum(),
+      (symbol_type == SymbolType::kUL) ? nt_fft_ : nt_csi_);
+}
@@ -7,13 +7,16 @@
 
 #include <complex>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "common_typedef_sdk.h"
 #include "config.h"
 #include "doer.h"
+#include "fft_backend.h"
+#include "int16_fft.h"
 #include "memory_manage.h"
 #include "message.h"
-#include "mkl_dfti.h"
 #include "phy_stats.h"
 #include "stats.h"
 #include "symbols.h"
@@ -23,7 +26,8 @@ class DoFFT : public Doer {
   DoFFT(Config* config, size_t tid, Table<complex_float>& data_buffer,
         PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers,
         Table<complex_float>& calib_dl_buffer,
-        Table<complex_float>& calib_ul_buffer, PhyStats* in_phy_stats,
+        Table<complex_float>& calib_ul_buffer,
+        std::vector<RxPacket*>& symbol_packets, PhyStats* in_phy_stats,
         Stats* stats_manager);
   ~DoFFT() override;
 
@@ -62,8 +66,31 @@ class DoFFT : public Doer {
   EventData Launch(size_t tag) override;
 
   /**
-   * Fill-in the partial transpose of the computed FFT for this antenna into
-   * out_buf.
+   * Do the FFT of all the antennas of one pilot or uplink symbol, with one
+   * batched MKL descriptor over the contiguous FFT inputs of the antennas
+   *
+   * @param tag is a gen_tag_t::FrmSym tag. The received packets of the
+   * symbol are in the FFT symbol packet table of the AgoraBuffer.
+   */
+  EventData LaunchSymbol(size_t tag);
+
+  /// Run the FFT tasks of req_event and post their response. With FFT-demul
+  /// fusion, then run the demul of each uplink symbol whose FFT this worker
+  /// completed, if the beamweights of the frame are ready.
+  void LaunchEvent(const EventData& req_event,
+                   moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                   moodycamel::ProducerToken* worker_ptok) override;
+
+  /// Fuse the demul of the uplink symbols into the FFT of this worker, run by
+  /// demul, the demul doer of the same worker
+  void EnableDemulFusion(FftDemulFusion* fusion, Doer* demul) {
+    fusion_ = fusion;
+    demul_ = demul;
+  }
+
+  /**
+   * Fill-in the partial transpose of the computed FFT fft_out of this antenna
+   * into out_buf.
    *
    * The fully-transposed matrix after FFT is a subcarriers x antennas matrix
    * that should look like so (using the notation subcarrier/antenna, and
@@ -89,24 +116,64 @@ class DoFFT : public Doer {
    *
    * Each partially-transposed block is identical to the corresponding block
    * of the fully-transposed matrix, but laid out in memory in column-major
-   * order.
+   * order. These blocks are the tiles of TileLayout, which the beamweight and
+   * demul kernels index with TileLayout::Index.
    */
-  void FillOutputBuffer(complex_float* out_buf, size_t ant_id,
-                        SymbolType symbol_type) const;
+  void FillOutputBuffer(complex_float* out_buf, const complex_float* fft_out,
+                        size_t ant_id, SymbolType symbol_type) const;
 
  private:
+  /// Convert the received samples of pkt, which are at samples, to the FFT
+  /// input fft_in
+  void ConvertSamples(const Packet* pkt, const short* samples,
+                      SymbolType sym_type, complex_float* fft_in);
+  /// Offset of the FFT window in the received samples of a symbol
+  size_t SampleOffset(SymbolType sym_type) const;
+  /// FFT of the int16 samples of one antenna with int16_fft_, written as
+  /// floats to the FFT-shifted output fft_out
+  void Int16Forward(const short* samples, SymbolType sym_type,
+                    complex_float* fft_out);
+  /// Swap the two halves of the FFT output fft_buf in-place
+  void FftShift(complex_float* fft_buf);
+  /// Write the FFT output of one antenna of a pilot or uplink symbol to the
+  /// CSI or the data buffer
+  void FillSymbolOutput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                        SymbolType sym_type, complex_float* fft_out);
+
   Table<complex_float>& data_buffer_;
-  PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers_;
+  FlatGrid<complex_float> csi_buffers_;
   Table<complex_float>& calib_dl_buffer_;
   Table<complex_float>& calib_ul_buffer_;
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> fft_plan_;
+  // Block floating point FFT of the int16 samples with FftInt16, nullptr
+  // otherwise
+  std::unique_ptr<Int16Fft> int16_fft_;
   complex_float* fft_inout_;      // Buffer for both FFT input and output
   complex_float* fft_shift_tmp_;  // Buffer for both FFT input and output
 
-  // Buffer for store 16-bit IQ converted from 12-bit IQ
-  uint16_t* temp_16bits_iq_;
   std::complex<float>* rx_samps_tmp_;  // Temp buffer for received samples
 
+  // Received packets of the symbols FFTed in one task
+  std::vector<RxPacket*>* symbol_packets_;
+  // True if the int16 to float conversion also FFT-shifts, by negating every
+  // other input sample, so that the FFT output needs no shift pass. Also true
+  // for the slice of a split carrier, which arrives shifted.
+  const bool shift_in_conversion_;
+  // Write the CSI (and calibration symbols) and the uplink data with
+  // non-temporal stores, from Config::NtStores()
+  const bool nt_csi_;
+  const bool nt_fft_;
+  // Batched plan and buffer for the FFT of all the antennas of a symbol,
+  // with antenna i at offset i * OfdmCaNum(). Only with FftBatchSymbol,
+  // fft_batch_inout_ is nullptr otherwise.
+  std::unique_ptr<FftPlan> fft_batch_plan_;
+  complex_float* fft_batch_inout_ = nullptr;
+
+  // FFT-demul fusion state and the demul doer running the fused tasks,
+  // nullptr if the master schedules all demul
+  FftDemulFusion* fusion_ = nullptr;
+  Doer* demul_ = nullptr;
+
   DurationStat* duration_stat_fft_;
   DurationStat* duration_stat_csi_;
   PhyStats* phy_stats_;
@@ -4,49 +4,70 @@
  */
 #include "doifft.h"
 
+#include <cmath>
+
 #include "comms-lib.h"
 #include "concurrent_queue_wrapper.h"
 #include "datatype_conversion.h"
+#include "doprecode.h"
 #include "logger.h"
+#include "oran_fronthaul.h"
+#include "streaming_store.h"
 
 static constexpr bool kPrintIFFTOutput = false;
 static constexpr bool kPrintSocketOutput = false;
-static constexpr bool kUseOutOfPlaceIFFT = false;
-static constexpr bool kMemcpyBeforeIFFT = true;
 static constexpr bool kPrintIfftStats = false;
 
 DoIFFT::DoIFFT(Config* in_config, int in_tid,
                Table<complex_float>& in_dl_ifft_buffer,
-               char* in_dl_socket_buffer, Stats* in_stats_manager)
+               char* in_dl_socket_buffer, MacScheduler* mac_sched,
+               Stats* in_stats_manager)
     : Doer(in_config, in_tid),
       dl_ifft_buffer_(in_dl_ifft_buffer),
-      dl_socket_buffer_(in_dl_socket_buffer) {
+      dl_socket_buffer_(in_dl_socket_buffer),
+      mac_sched_(mac_sched),
+      precode_(nullptr) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kIFFT, in_tid);
-  DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  if (kUseOutOfPlaceIFFT) {
-    DftiSetValue(mkl_handle_, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
-  }
-  DftiCommitDescriptor(mkl_handle_);
+  alloc_stat_ = duration_stat_;
+  // Out of place, so that dl_ifft_buffer_ keeps its zero guard subcarriers
+  ifft_plan_ = FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum(), 1, true);
 
   // Aligned for SIMD
   ifft_out_ = static_cast<float*>(
       Agora_memory::PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign64,
-                                       2 * cfg_->OfdmCaNum() * sizeof(float)));
-
-  ifft_shift_tmp_ = static_cast<complex_float*>(
-      Agora_memory::PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign64,
-                                       2 * cfg_->OfdmCaNum() * sizeof(float)));
+                                       2 * cfg_->OfdmCaNum() * sizeof(float),
+                                       scratch_policy_));
   ifft_scale_factor_ = cfg_->OfdmCaNum();
+  nt_ifft_ = cfg_->NtStores("ifft");
+  // The O-RAN PRBs keep the power of the int16 samples of the IFFT
+  oran_scale_ = 32768.0f / std::sqrt(static_cast<float>(cfg_->OfdmCaNum()));
+
+  if (cfg_->IfftBatchSymbol()) {
+    // Each antenna's row of the batch buffer must stay aligned for SIMD
+    RtAssert(cfg_->OfdmCaNum() % kSCsPerCacheline == 0,
+             "DoIFFT: FFT size is not a multiple of the subcarriers per "
+             "cacheline");
+    ifft_batch_plan_ = FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum(),
+                                              cfg_->BsAntNum(), true);
+    ifft_batch_out_ =
+        static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            cfg_->BsAntNum() * cfg_->OfdmCaNum() * sizeof(complex_float),
+            scratch_policy_));
+  }
 }
 
 DoIFFT::~DoIFFT() {
-  DftiFreeDescriptor(&mkl_handle_);
-  std::free(ifft_out_);
-  std::free(ifft_shift_tmp_);
+  Agora_memory::PaddedAlignedFree(ifft_out_);
+  if (ifft_batch_out_ != nullptr) {
+    Agora_memory::PaddedAlignedFree(ifft_batch_out_);
+  }
 }
 
 EventData DoIFFT::Launch(size_t tag) {
+  if (ifft_batch_plan_ != nullptr) {
+    return LaunchSymbol(tag);
+  }
   size_t start_tsc = GetTime::WorkerRdtsc();
 
   const size_t frame_id = gen_tag_t(tag).frame_id_;
@@ -62,90 +83,54 @@ EventData DoIFFT::Launch(size_t tag) {
   const size_t total_symbol_idx_dl =
       cfg_->GetTotalDataSymbolIdxDl(frame_id, dl_symbol_idx);
   const size_t in_offset = (total_symbol_idx_dl * cfg_->BsAntNum()) + ant_id;
+  short* socket_ptr = SocketSamples(frame_id, symbol_id, ant_id);
 
-  const size_t total_symbol_idx =
-      cfg_->GetTotalSymbolIdxDl(frame_id, symbol_id);
-  const size_t out_offset = (total_symbol_idx * cfg_->BsAntNum()) + ant_id;
+  if (EmptySymbol(frame_id, dl_symbol_idx)) {
+    std::memset(socket_ptr, 0, SocketBytes());
+    duration_stat_->task_count_++;
+    duration_stat_->task_duration_[0u] += GetTime::WorkerRdtsc() - start_tsc;
+    return EventData(EventType::kIFFT, tag);
+  }
+  if (cfg_->OranFronthaul()) {
+    // The RU does the IFFT
+    OranOutput(frame_id, symbol_id, ant_id, in_offset, socket_ptr);
+    duration_stat_->task_count_++;
+    duration_stat_->task_duration_[0u] += GetTime::WorkerRdtsc() - start_tsc;
+    return EventData(EventType::kIFFT, tag);
+  }
 
   const size_t start_tsc1 = GetTime::WorkerRdtsc();
   duration_stat_->task_duration_[1u] += start_tsc1 - start_tsc;
 
-  auto* ifft_in_ptr = reinterpret_cast<float*>(dl_ifft_buffer_[in_offset]);
-  auto* ifft_out_ptr =
-      (kUseOutOfPlaceIFFT || kMemcpyBeforeIFFT) ? ifft_out_ : ifft_in_ptr;
-
-  std::memset(ifft_in_ptr, 0, sizeof(float) * cfg_->OfdmDataStart() * 2);
-  std::memset(ifft_in_ptr + (cfg_->OfdmDataStop()) * 2, 0,
-              sizeof(float) * cfg_->OfdmDataStart() * 2);
-  CommsLib::FFTShift(reinterpret_cast<complex_float*>(ifft_in_ptr),
-                     ifft_shift_tmp_, cfg_->OfdmCaNum());
-  if (kMemcpyBeforeIFFT) {
-    std::memcpy(ifft_out_ptr, ifft_in_ptr,
-                sizeof(float) * cfg_->OfdmCaNum() * 2);
-    DftiComputeBackward(mkl_handle_, ifft_out_ptr);
+  if (precode_ != nullptr) {
+    // Precode straight into the IFFT input, without dl_ifft_buffer_
+    PrecodeInput(frame_id, symbol_id, ant_id,
+                 reinterpret_cast<complex_float*>(ifft_out_));
+    ifft_plan_->Backward(reinterpret_cast<complex_float*>(ifft_out_));
   } else {
-    if (kUseOutOfPlaceIFFT) {
-      // Use out-of-place IFFT here is faster than in place IFFT
-      // There is no need to reset non-data subcarriers in ifft input
-      // to 0 since their values are not changed after IFFT
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr, ifft_out_ptr);
-    } else {
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr);
-    }
+    // The guard subcarriers of dl_ifft_buffer_ are never written, so they
+    // are still zero, and the FFT shift is done by the conversion below
+    ifft_plan_->Backward(dl_ifft_buffer_[in_offset],
+                         reinterpret_cast<complex_float*>(ifft_out_));
   }
 
-  bool clipping = false;
-  float max_abs = 0;
-  for (size_t i = 0; i < 2 * cfg_->OfdmCaNum(); i++) {
-    float sample_val = ifft_out_ptr[i] / ifft_scale_factor_;
-    if (sample_val >= 1) {
-      clipping = true;
-      break;
-    }
-    if (std::abs(sample_val) > max_abs) {
-      max_abs = std::abs(sample_val);
-    }
-  }
-  if (clipping) {
-    AGORA_LOG_WARN(
-        "Clipping occured in Frame %zu, Symbol %zu, Antenna "
-        "%zu\n",
-        frame_id, symbol_id, ant_id);
-  }
-  if (ant_id < cfg_->BfAntNum() && max_abs < 1e-4) {
-    AGORA_LOG_WARN(
-        "Possibly bad antenna %zu with max sample value "
-        "%2.2f\n",
-        ant_id, max_abs);
-  }
-  if (kPrintIfftStats) {
-    std::printf("%2.3f\n", max_abs);
-  }
+  const size_t start_tsc2 = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[2u] += start_tsc2 - start_tsc1;
+
+  ConvertOutput(frame_id, symbol_id, ant_id, ifft_out_, socket_ptr);
+  StreamingStore::Fence();
 
   if (kPrintIFFTOutput) {
     std::stringstream ss;
     ss << "IFFT_output" << ant_id << "=[";
     for (size_t i = 0; i < cfg_->OfdmCaNum(); i++) {
       ss << std::fixed << std::setw(5) << std::setprecision(3)
-         << dl_ifft_buffer_[in_offset][i].re << "+1j*"
-         << dl_ifft_buffer_[in_offset][i].im << " ";
+         << ifft_out_[2 * i] << "+1j*" << ifft_out_[2 * i + 1] << " ";
     }
     ss << "];" << std::endl;
     std::cout << ss.str();
   }
 
-  const size_t start_tsc2 = GetTime::WorkerRdtsc();
-  duration_stat_->task_duration_[2u] += start_tsc2 - start_tsc1;
-
-  auto* pkt = reinterpret_cast<Packet*>(
-      &dl_socket_buffer_[out_offset * cfg_->DlPacketLength()]);
-  short* socket_ptr = &pkt->data_[2u * cfg_->OfdmTxZeroPrefix()];
-
-  // IFFT scaled results by OfdmCaNum(), we scale down IFFT results
-  // during data type coversion.  * 2 complex float -> float
-  SimdConvertFloatToShort(ifft_out_ptr, socket_ptr, cfg_->OfdmCaNum() * 2,
-                          cfg_->CpLen() * 2, ifft_scale_factor_);
-
   duration_stat_->task_duration_[3u] += GetTime::WorkerRdtsc() - start_tsc2;
 
   if (kPrintSocketOutput) {
@@ -162,3 +147,146 @@ EventData DoIFFT::Launch(size_t tag) {
   duration_stat_->task_duration_[0u] += GetTime::WorkerRdtsc() - start_tsc;
   return EventData(EventType::kIFFT, tag);
 }
+
+EventData DoIFFT::LaunchSymbol(size_t tag) {
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+  const size_t fft_size = cfg_->OfdmCaNum();
+  const size_t dl_symbol_idx = cfg_->Frame().GetDLSymbolIdx(symbol_id);
+  const size_t total_symbol_idx_dl =
+      cfg_->GetTotalDataSymbolIdxDl(frame_id, dl_symbol_idx);
+  const bool empty = EmptySymbol(frame_id, dl_symbol_idx);
+
+  const size_t start_tsc1 = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[1u] += start_tsc1 - start_tsc;
+  if ((empty == false) && cfg_->OranFronthaul()) {
+    // The RU does the IFFT
+    for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+      OranOutput(frame_id, symbol_id, ant_id,
+                 (total_symbol_idx_dl * cfg_->BsAntNum()) + ant_id,
+                 SocketSamples(frame_id, symbol_id, ant_id));
+    }
+    duration_stat_->task_count_ += cfg_->BsAntNum();
+    duration_stat_->task_duration_[0u] += GetTime::WorkerRdtsc() - start_tsc;
+    return EventData(EventType::kIFFT, tag);
+  } else if ((empty == false) && (precode_ != nullptr)) {
+    // Antenna i of the symbol goes to row i of the batch buffer
+    for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+      PrecodeInput(frame_id, symbol_id, ant_id,
+                   &ifft_batch_out_[ant_id * fft_size]);
+    }
+    // One call for the IFFTs of all the antennas, in place
+    ifft_batch_plan_->Backward(ifft_batch_out_);
+  } else if (empty == false) {
+    // The antennas of a symbol are consecutive rows of dl_ifft_buffer_
+    ifft_batch_plan_->Backward(
+        dl_ifft_buffer_[total_symbol_idx_dl * cfg_->BsAntNum()],
+        ifft_batch_out_);
+  }
+
+  const size_t start_tsc2 = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[2u] += start_tsc2 - start_tsc1;
+
+  for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+    short* socket_ptr = SocketSamples(frame_id, symbol_id, ant_id);
+    if (empty) {
+      std::memset(socket_ptr, 0, SocketBytes());
+    } else {
+      ConvertOutput(
+          frame_id, symbol_id, ant_id,
+          reinterpret_cast<const float*>(&ifft_batch_out_[ant_id * fft_size]),
+          socket_ptr);
+    }
+  }
+  StreamingStore::Fence();
+
+  duration_stat_->task_duration_[3u] += GetTime::WorkerRdtsc() - start_tsc2;
+  duration_stat_->task_count_ += cfg_->BsAntNum();
+  duration_stat_->task_duration_[0u] += GetTime::WorkerRdtsc() - start_tsc;
+  return EventData(EventType::kIFFT, tag);
+}
+
+bool DoIFFT::EmptySymbol(size_t frame_id, size_t dl_symbol_idx) const {
+  // A data symbol with no downlink allocation is all zeros, with its cyclic
+  // prefix, on every antenna. Precode did not write it.
+  return (dl_symbol_idx >= cfg_->Frame().ClientDlPilotSymbols()) &&
+         (mac_sched_->Schedule(frame_id).dl_num_sc_ == 0);
+}
+
+short* DoIFFT::SocketSamples(size_t frame_id, size_t symbol_id,
+                             size_t ant_id) const {
+  const size_t total_symbol_idx =
+      cfg_->GetTotalSymbolIdxDl(frame_id, symbol_id);
+  const size_t out_offset = (total_symbol_idx * cfg_->BsAntNum()) + ant_id;
+  auto* pkt = reinterpret_cast<Packet*>(
+      &dl_socket_buffer_[out_offset * cfg_->DlPacketLength()]);
+  if (cfg_->OranFronthaul()) {
+    return pkt->data_;
+  }
+  return &pkt->data_[2u * cfg_->OfdmTxZeroPrefix()];
+}
+
+size_t DoIFFT::SocketBytes() const {
+  if (cfg_->OranFronthaul()) {
+    return (cfg_->OfdmDataNum() / kOranPrbSubcarriers) *
+           OranPrbBytes(cfg_->OranBfpBits());
+  }
+  return sizeof(short) * 2u * (cfg_->CpLen() + cfg_->OfdmCaNum());
+}
+
+void DoIFFT::OranOutput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                        size_t in_offset, short* socket_ptr) {
+  const complex_float* data_sc;
+  if (precode_ != nullptr) {
+    // Precode only the data subcarriers, into the scratch of the IFFT
+    auto* precoded = reinterpret_cast<complex_float*>(ifft_out_);
+    precode_->PrecodeAntenna(frame_id, symbol_id, ant_id, precoded);
+    data_sc = precoded;
+  } else {
+    data_sc = &dl_ifft_buffer_[in_offset][cfg_->OfdmDataStart()];
+  }
+  OranCompress(data_sc, reinterpret_cast<uint8_t*>(socket_ptr),
+               cfg_->OfdmDataNum() / kOranPrbSubcarriers, cfg_->OranBfpBits(),
+               oran_scale_);
+}
+
+void DoIFFT::ConvertOutput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                           const float* ifft_out, short* socket_ptr) {
+  // IFFT scaled results by OfdmCaNum(), we scale down IFFT results
+  // during data type coversion.  * 2 complex float -> float
+  // The clipping check and the peak tracking are done in the same pass, and
+  // so is the FFT shift of the IFFT input
+  float max_val;
+  float max_abs;
+  SimdConvertFloatToShortPeak(ifft_out, socket_ptr, cfg_->OfdmCaNum() * 2,
+                              cfg_->CpLen() * 2, ifft_scale_factor_, max_val,
+                              max_abs, true, nt_ifft_);
+
+  if (max_val >= 1) {
+    AGORA_LOG_WARN(
+        "Clipping occured in Frame %zu, Symbol %zu, Antenna "
+        "%zu\n",
+        frame_id, symbol_id, ant_id);
+  }
+  if (ant_id < cfg_->BfAntNum() && max_abs < 1e-4) {
+    AGORA_LOG_WARN(
+        "Possibly bad antenna %zu with max sample value "
+        "%2.2f\n",
+        ant_id, max_abs);
+  }
+  if (kPrintIfftStats) {
+    std::printf("%2.3f\n", max_abs);
+  }
+}
+
+void DoIFFT::PrecodeInput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                          complex_float* ifft_in) {
+  // In subcarrier order: the FFT shift is done by ConvertOutput()
+  const size_t data_start = cfg_->OfdmDataStart();
+  const size_t data_stop = data_start + cfg_->OfdmDataNum();
+  precode_->PrecodeAntenna(frame_id, symbol_id, ant_id, ifft_in + data_start);
+  std::memset(ifft_in, 0, sizeof(complex_float) * data_start);
+  std::memset(ifft_in + data_stop, 0,
+              sizeof(complex_float) * (cfg_->OfdmCaNum() - data_stop));
+}
@@ -7,15 +7,21 @@
 
 #include "common_typedef_sdk.h"
 #include "config.h"
+#include <memory>
+
 #include "doer.h"
+#include "fft_backend.h"
+#include "mac_scheduler.h"
 #include "memory_manage.h"
-#include "mkl_dfti.h"
 #include "stats.h"
 
+class DoPrecode;
+
 class DoIFFT : public Doer {
  public:
   DoIFFT(Config* in_config, int in_tid, Table<complex_float>& in_dl_ifft_buffer,
-         char* in_dl_socket_buffer, Stats* in_stats_manager);
+         char* in_dl_socket_buffer, MacScheduler* mac_sched,
+         Stats* in_stats_manager);
   ~DoIFFT() override;
 
   /**
@@ -43,16 +49,51 @@ class DoIFFT : public Doer {
    */
   EventData Launch(size_t tag) override;
 
+  /// Fuse the precoding of each antenna into its IFFT task, run by precode,
+  /// the precode doer of the same worker
+  void EnablePrecodeFusion(DoPrecode* precode) { precode_ = precode; }
+
  private:
+  // The IFFT of all the antennas of a symbol, with IfftBatchSymbol()
+  EventData LaunchSymbol(size_t tag);
+  // True if the symbol is a downlink data symbol with no allocation
+  bool EmptySymbol(size_t frame_id, size_t dl_symbol_idx) const;
+  // The TX samples of an antenna in dl_socket_buffer_, after the zero prefix
+  short* SocketSamples(size_t frame_id, size_t symbol_id, size_t ant_id) const;
+  // Bytes of the TX samples of an antenna
+  size_t SocketBytes() const;
+  // With OranFronthaul(), compress the data subcarriers of an antenna, at
+  // in_offset of dl_ifft_buffer_ unless precoded here, to its TX PRBs
+  void OranOutput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                  size_t in_offset, short* socket_ptr);
+  // Convert the IFFT output of an antenna to its TX samples, FFT-shifting
+  // the input of the IFFT at the same time
+  void ConvertOutput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                     const float* ifft_out, short* socket_ptr);
+  // Precode the symbol of an antenna into the OfdmCaNum() subcarriers of
+  // ifft_in, with zero guard subcarriers
+  void PrecodeInput(size_t frame_id, size_t symbol_id, size_t ant_id,
+                    complex_float* ifft_in);
+
   Table<complex_float>& dl_ifft_buffer_;
   char* dl_socket_buffer_;
+  MacScheduler* mac_sched_;
   DurationStat* duration_stat_;
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> ifft_plan_;
   // Buffer for IFFT output
   float* ifft_out_;
-  // scratch buffer to reduce memory allocation
-  complex_float* ifft_shift_tmp_;
   float ifft_scale_factor_;
+  // Write the socket samples with non-temporal stores, from
+  // Config::NtStores()
+  bool nt_ifft_;
+  // Scale of the O-RAN PRBs of the data subcarriers
+  float oran_scale_;
+  // Set with precode-IFFT fusion
+  DoPrecode* precode_;
+  // With IfftBatchSymbol(), the plan of BsAntNum() IFFTs and its output, by
+  // antenna
+  std::unique_ptr<FftPlan> ifft_batch_plan_;
+  complex_float* ifft_batch_out_ = nullptr;
 };
 
 #endif  // DOIFFT_H_
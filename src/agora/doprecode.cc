@@ -4,6 +4,12 @@
  */
 #include "doprecode.h"
 
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstring>
+
+#include "comms-lib.h"
 #include "concurrent_queue_wrapper.h"
 #include "modulation.h"
 
@@ -16,19 +22,37 @@ DoPrecode::DoPrecode(
     Table<int8_t>& dl_encoded_or_raw_data /* Encoded if LDPC is enabled */,
     MacScheduler* mac_sched, Stats* in_stats_manager)
     : Doer(in_config, in_tid),
-      dl_beam_matrices_(dl_beam_matrices),
+      dl_beam_matrices_(dl_beam_matrices.Flat()),
       dl_ifft_buffer_(in_dl_ifft_buffer),
       dl_raw_data_(dl_encoded_or_raw_data),
+      dl_mod_symbols_(nullptr),
       mac_sched_(mac_sched) {
   duration_stat_ =
       in_stats_manager->GetDurationStat(DoerType::kPrecode, in_tid);
+  alloc_stat_ = duration_stat_;
+#ifdef __AVX512F__
+  batched_precode_ = kUseSpatialLocality && cfg_->SmallMimoAcc();
+#else
+  batched_precode_ = false;
+#endif
+  // The general path precodes a block with one batch GEMM, from the
+  // symbols of all of its subcarriers
+  if (kUseSpatialLocality && cfg_->GemmBatch() &&
+      (batched_precode_ == false)) {
+    gemv_batch_ = std::make_unique<CgemvBatch>(
+        cfg_->BsAntNum(), cfg_->SpatialStreamsNum(), cfg_->DemulBlockSize());
+    precoder_ptrs_.resize(cfg_->DemulBlockSize());
+    precoder_stride_ = dl_beam_matrices_.CellStride();
+  }
 
   AllocBuffer1d(&modulated_buffer_temp_,
-                kSCsPerCacheline * cfg_->SpatialStreamsNum(),
-                Agora_memory::Alignment_t::kAlign64, 0);
+                ((gemv_batch_ != nullptr) ? cfg_->DemulBlockSize()
+                                          : kSCsPerCacheline) *
+                    cfg_->SpatialStreamsNum(),
+                Agora_memory::Alignment_t::kAlign64, 0, scratch_policy_);
   AllocBuffer1d(&precoded_buffer_temp_,
                 cfg_->DemulBlockSize() * cfg_->BsAntNum(),
-                Agora_memory::Alignment_t::kAlign64, 0);
+                Agora_memory::Alignment_t::kAlign64, 0, scratch_policy_);
 
 #if defined(USE_MKL_JIT)
   MKL_Complex8 alpha = {1, 0};
@@ -72,7 +96,7 @@ EventData DoPrecode::Launch(size_t tag) {
   const size_t symbol_idx_dl = cfg_->Frame().GetDLSymbolIdx(symbol_id);
   const size_t total_data_symbol_idx =
       cfg_->GetTotalDataSymbolIdxDl(frame_id, symbol_idx_dl);
-  const size_t frame_slot = frame_id % kFrameWnd;
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
 
   // Mark pilot subcarriers in this block
   // In downlink pilot symbols, all subcarriers are used as pilots
@@ -101,26 +125,67 @@ EventData DoPrecode::Launch(size_t tag) {
   size_t max_sc_ite =
       std::min(cfg_->DemulBlockSize(), cfg_->OfdmDataNum() - base_sc_id);
 
-  auto ue_list = mac_sched_->ScheduledUeList(frame_id, base_sc_id);
+  const ScheduleSnapshot& schedule = mac_sched_->Schedule(frame_id);
+  if ((base_sc_id >= schedule.dl_num_sc_) &&
+      (symbol_idx_dl >= cfg_->Frame().ClientDlPilotSymbols())) {
+    // Past the downlink allocation. The IFFT sends a symbol with no
+    // allocation as zeros without reading it.
+    if (schedule.dl_num_sc_ > 0) {
+      for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
+        std::memset(
+            &dl_ifft_buffer_[ant_id + cfg_->BsAntNum() * total_data_symbol_idx]
+                            [base_sc_id + cfg_->OfdmDataStart()],
+            0, sizeof(complex_float) * max_sc_ite);
+      }
+    }
+    duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+    return EventData(EventType::kPrecode, tag);
+  }
+
+  const auto& ue_list = schedule.ue_list_;
   if (kUseSpatialLocality) {
+    // The encoder has already laid out the symbols of a data symbol for
+    // the batched precoder
+    const bool read_fused_symbols =
+        batched_precode_ && (dl_mod_symbols_ != nullptr) &&
+        (symbol_idx_dl >= cfg_->Frame().ClientDlPilotSymbols());
     for (size_t i = 0; i < max_sc_ite; i = i + kSCsPerCacheline) {
       size_t start_tsc1 = GetTime::WorkerRdtsc();
-      for (size_t sp_id = 0; sp_id < cfg_->SpatialStreamsNum(); sp_id++) {
-        for (size_t j = 0; j < kSCsPerCacheline; j++) {
-          LoadInputData(symbol_idx_dl, total_data_symbol_idx, sp_id,
-                        ue_list.at(sp_id), base_sc_id + i + j, j);
+      if (read_fused_symbols == false) {
+        // The batch GEMM takes the symbols of the whole block
+        const size_t load_offset = (gemv_batch_ != nullptr) ? i : 0;
+        for (size_t sp_id = 0; sp_id < cfg_->SpatialStreamsNum(); sp_id++) {
+          for (size_t j = 0; j < kSCsPerCacheline; j++) {
+            LoadInputData(symbol_idx_dl, total_data_symbol_idx, sp_id,
+                          ue_list.at(sp_id), base_sc_id + i + j,
+                          load_offset + j);
+          }
         }
       }
 
       size_t start_tsc2 = GetTime::WorkerRdtsc();
       duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
-      for (size_t j = 0; j < kSCsPerCacheline; j++) {
-        PrecodingPerSc(frame_slot, base_sc_id + i + j, i + j);
+      if (batched_precode_) {
+        const complex_float* mod_data =
+            read_fused_symbols
+                ? (*dl_mod_symbols_)[total_data_symbol_idx] +
+                      (base_sc_id + i) * cfg_->SpatialStreamsNum()
+                : modulated_buffer_temp_;
+        PrecodingBatch(frame_slot, base_sc_id, i, mod_data);
+      } else if (gemv_batch_ == nullptr) {
+        for (size_t j = 0; j < kSCsPerCacheline; j++) {
+          PrecodingPerSc(frame_slot, base_sc_id + i + j, i + j);
+        }
       }
       duration_stat_->task_count_ =
           duration_stat_->task_count_ + kSCsPerCacheline;
       duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc2;
     }
+    if (gemv_batch_ != nullptr) {
+      size_t start_tsc2 = GetTime::WorkerRdtsc();
+      PrecodingGemmBatch(frame_slot, base_sc_id, max_sc_ite);
+      duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc2;
+    }
   } else {
     for (size_t i = 0; i < max_sc_ite; i++) {
       size_t start_tsc1 = GetTime::WorkerRdtsc();
@@ -143,12 +208,25 @@ EventData DoPrecode::Launch(size_t tag) {
   __m256i index = _mm256_setr_epi64x(0, cfg_->BsAntNum(), cfg_->BsAntNum() * 2,
                                      cfg_->BsAntNum() * 3);
   auto* precoded_ptr = reinterpret_cast<float*>(precoded_buffer_temp_);
+  // Only the subcarriers of the block: the guard subcarriers after the last
+  // block stay zero for the IFFT
   for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
     int ifft_buffer_offset = ant_id + cfg_->BsAntNum() * total_data_symbol_idx;
     auto* ifft_ptr = reinterpret_cast<float*>(
         &dl_ifft_buffer_[ifft_buffer_offset]
                         [base_sc_id + cfg_->OfdmDataStart()]);
-    for (size_t i = 0; i < cfg_->DemulBlockSize() / 4; i++) {
+    if (batched_precode_) {
+      // The subcarriers of an antenna are already contiguous
+      const float* input_ptr =
+          precoded_ptr + ant_id * cfg_->DemulBlockSize() * 2;
+      for (size_t i = 0; i < max_sc_ite / 4; i++) {
+        const __m256d t_data =
+            _mm256_loadu_pd(reinterpret_cast<const double*>(input_ptr + i * 8));
+        _mm256_stream_pd(reinterpret_cast<double*>(ifft_ptr + i * 8), t_data);
+      }
+      continue;
+    }
+    for (size_t i = 0; i < max_sc_ite / 4; i++) {
       float* input_shifted_ptr =
           precoded_ptr + 4 * i * 2 * cfg_->BsAntNum() + ant_id * 2;
       __m256d t_data = _mm256_i64gather_pd(
@@ -171,19 +249,35 @@ void DoPrecode::LoadInputData(size_t symbol_idx_dl,
                               size_t total_data_symbol_idx, size_t sp_id,
                               size_t user_id, size_t sc_id,
                               size_t sc_id_in_block) {
-  complex_float* data_ptr =
-      modulated_buffer_temp_ + sc_id_in_block * cfg_->SpatialStreamsNum();
-  if ((symbol_idx_dl < cfg_->Frame().ClientDlPilotSymbols()) ||
-      (cfg_->IsDataSubcarrier(sc_id) == false)) {
-    data_ptr[sp_id] = cfg_->UeSpecificPilot()[user_id][sc_id];
-  } else {
-    int8_t* raw_data_ptr =
-        &dl_raw_data_[total_data_symbol_idx]
-                     [cfg_->GetOFDMDataIndex(sc_id) +
-                      Roundup<64>(cfg_->GetOFDMDataNum()) * sp_id];
-    data_ptr[sp_id] = ModSingleUint8((uint8_t)(*raw_data_ptr),
-                                     cfg_->ModTable(Direction::kDownlink));
+  complex_float& data =
+      batched_precode_
+          ? modulated_buffer_temp_[sp_id * kSCsPerCacheline + sc_id_in_block]
+          : modulated_buffer_temp_[sc_id_in_block * cfg_->SpatialStreamsNum() +
+                                   sp_id];
+  data = ModulatedSymbol(symbol_idx_dl, total_data_symbol_idx, sp_id, user_id,
+                         sc_id);
+}
+
+complex_float DoPrecode::ModulatedSymbol(size_t symbol_idx_dl,
+                                         size_t total_data_symbol_idx,
+                                         size_t sp_id, size_t user_id,
+                                         size_t sc_id) const {
+  if (symbol_idx_dl < cfg_->Frame().ClientDlPilotSymbols()) {
+    return cfg_->UeSpecificPilot(numa_node_)[user_id][sc_id];
+  }
+  if (dl_mod_symbols_ != nullptr) {
+    return (*dl_mod_symbols_)[total_data_symbol_idx]
+                             [cfg_->DlModSymbolIndex(sc_id, sp_id)];
   }
+  if (cfg_->IsDataSubcarrier(sc_id) == false) {
+    return cfg_->UeSpecificPilot(numa_node_)[user_id][sc_id];
+  }
+  const int8_t* raw_data_ptr =
+      &dl_raw_data_[total_data_symbol_idx]
+                   [cfg_->GetOFDMDataIndex(sc_id) +
+                    Roundup<64>(cfg_->GetOFDMDataNum()) * sp_id];
+  return ModSingleUint8((uint8_t)(*raw_data_ptr),
+                        cfg_->ModTable(Direction::kDownlink, numa_node_));
 }
 
 void DoPrecode::PrecodingPerSc(size_t frame_slot, size_t sc_id,
@@ -211,3 +305,105 @@ void DoPrecode::PrecodingPerSc(size_t frame_slot, size_t sc_id,
   // cout << "Precoded data: \n" << mat_precoded << endl;
 #endif
 }
+
+void DoPrecode::PrecodingGemmBatch(size_t frame_slot, size_t base_sc_id,
+                                   size_t num_scs) {
+  if (cfg_->BeamScStride() == 1) {
+    // Every subcarrier has its own precoder, evenly spaced in the backing
+    // buffer
+    gemv_batch_->RunStrided(dl_beam_matrices_[frame_slot][base_sc_id],
+                            precoder_stride_, modulated_buffer_temp_,
+                            precoded_buffer_temp_, num_scs);
+    return;
+  }
+  for (size_t k = 0; k < num_scs; k++) {
+    precoder_ptrs_[k] =
+        dl_beam_matrices_[frame_slot][cfg_->GetBeamScId(base_sc_id + k)];
+  }
+  gemv_batch_->Run(precoder_ptrs_.data(), modulated_buffer_temp_,
+                   precoded_buffer_temp_, num_scs);
+}
+
+void DoPrecode::PrecodeAntenna(size_t frame_id, size_t symbol_id,
+                               size_t ant_id, complex_float* out) {
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  const size_t symbol_idx_dl = cfg_->Frame().GetDLSymbolIdx(symbol_id);
+  const size_t total_data_symbol_idx =
+      cfg_->GetTotalDataSymbolIdxDl(frame_id, symbol_idx_dl);
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  const size_t num_streams = cfg_->SpatialStreamsNum();
+
+  const ScheduleSnapshot& schedule = mac_sched_->Schedule(frame_id);
+  const auto& ue_list = schedule.ue_list_;
+  // The data subcarriers past the downlink allocation are zeros
+  const size_t num_sc = (symbol_idx_dl < cfg_->Frame().ClientDlPilotSymbols())
+                            ? cfg_->OfdmDataNum()
+                            : schedule.dl_num_sc_;
+  for (size_t sc_id = 0; sc_id < num_sc; sc_id++) {
+    // Row ant_id of the column-major BsAntNum() x SpatialStreamsNum()
+    // precoder
+    const complex_float* precoder =
+        dl_beam_matrices_[frame_slot][cfg_->GetBeamScId(sc_id)] + ant_id;
+    std::complex<float> precoded(0.0f, 0.0f);
+    for (size_t sp_id = 0; sp_id < num_streams; sp_id++) {
+      const complex_float data =
+          ModulatedSymbol(symbol_idx_dl, total_data_symbol_idx, sp_id,
+                          ue_list.at(sp_id), sc_id);
+      const complex_float& weight = precoder[sp_id * bs_ant_num];
+      precoded += std::complex<float>(weight.re, weight.im) *
+                  std::complex<float>(data.re, data.im);
+    }
+    out[sc_id] = {precoded.real(), precoded.imag()};
+  }
+  std::fill(out + num_sc, out + cfg_->OfdmDataNum(), complex_float{0, 0});
+  duration_stat_->task_count_++;
+  duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+}
+
+void DoPrecode::EnableModulationFusion(Table<complex_float>* dl_mod_symbols) {
+  dl_mod_symbols_ = dl_mod_symbols;
+}
+
+void DoPrecode::PrecodingBatch(size_t frame_slot, size_t base_sc_id, size_t i,
+                               const complex_float* mod_data) {
+#ifdef __AVX512F__
+  const size_t bs_ant_num = cfg_->BsAntNum();
+  const size_t num_streams = cfg_->SpatialStreamsNum();
+  // The precoders of the subcarriers are in one backing buffer, so each lane
+  // gathers its precoder at an offset from the precoder of the first lane
+  const complex_float* precoder_base =
+      dl_beam_matrices_[frame_slot][cfg_->GetBeamScId(base_sc_id + i)];
+  std::array<int64_t, kSCsPerCacheline> lane_offsets;
+  for (size_t j = 0; j < kSCsPerCacheline; j++) {
+    lane_offsets[j] =
+        dl_beam_matrices_[frame_slot][cfg_->GetBeamScId(base_sc_id + i + j)] -
+        precoder_base;
+  }
+  const __m512i lane_index = _mm512_loadu_si512(lane_offsets.data());
+
+  // precoded(ant) = sum over the streams of precoder(ant, ss) * data(ss), for
+  // the kSCsPerCacheline subcarriers at once
+  for (size_t ant_i = 0; ant_i < bs_ant_num; ant_i++) {
+    __m512 precoded = _mm512_setzero_ps();
+    for (size_t ss = 0; ss < num_streams; ss++) {
+      // Column-major BsAntNum() x SpatialStreamsNum() precoder
+      const __m512 precoder = _mm512_castpd_ps(_mm512_i64gather_pd(
+          lane_index, precoder_base + ss * bs_ant_num + ant_i,
+          sizeof(complex_float)));
+      const __m512 data =
+          _mm512_load_ps(mod_data + ss * kSCsPerCacheline);
+      precoded = _mm512_add_ps(
+          precoded, CommsLib::M512ComplexCf32Mult(precoder, data, false));
+    }
+    _mm512_storeu_ps(
+        precoded_buffer_temp_ + ant_i * cfg_->DemulBlockSize() + i, precoded);
+  }
+#else
+  unused(frame_slot);
+  unused(base_sc_id);
+  unused(i);
+  unused(mod_data);
+  throw std::runtime_error("DoPrecode: batched precoding needs AVX512");
+#endif
+}
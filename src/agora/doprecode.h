@@ -7,8 +7,10 @@
 
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "cgemv_batch.h"
 #include "common_typedef_sdk.h"
 #include "config.h"
 #include "doer.h"
@@ -62,15 +64,58 @@ class DoPrecode : public Doer {
                      size_t sc_id_in_block);
   void PrecodingPerSc(size_t frame_slot, size_t sc_id, size_t sc_id_in_block);
 
+  /**
+   * Precode all the data subcarriers of one downlink symbol for one antenna,
+   * for the IFFT task of the antenna when precoding is fused into the IFFT
+   *
+   * @param out holds OfdmDataNum() precoded samples, by data subcarrier
+   */
+  void PrecodeAntenna(size_t frame_id, size_t symbol_id, size_t ant_id,
+                      complex_float* out);
+
+  /// Read the modulated symbols of downlink data symbols from
+  /// dl_mod_symbols, written by DoEncode::EnableModulationFusion(), instead
+  /// of modulating the bits on each subcarrier
+  void EnableModulationFusion(Table<complex_float>* dl_mod_symbols);
+
  private:
-  PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_beam_matrices_;
+  // Precode the kSCsPerCacheline subcarriers starting at base_sc_id + i, with
+  // one subcarrier per complex lane instead of one matrix product per
+  // subcarrier. mod_data holds the symbols of the subcarriers by
+  // [stream][subcarrier in the cache line].
+  void PrecodingBatch(size_t frame_slot, size_t base_sc_id, size_t i,
+                      const complex_float* mod_data);
+  // Precode the num_scs subcarriers from base_sc_id with one batch GEMM.
+  // modulated_buffer_temp_ holds the symbols of the subcarriers by
+  // [subcarrier in the block][stream].
+  void PrecodingGemmBatch(size_t frame_slot, size_t base_sc_id,
+                          size_t num_scs);
+  // The modulated symbol (or pilot) of a stream on a subcarrier
+  complex_float ModulatedSymbol(size_t symbol_idx_dl,
+                                size_t total_data_symbol_idx, size_t sp_id,
+                                size_t user_id, size_t sc_id) const;
+
+  FlatGrid<complex_float> dl_beam_matrices_;
   Table<complex_float>& dl_ifft_buffer_;
   Table<int8_t>& dl_raw_data_;
+  // Set with EnableModulationFusion(), nullptr otherwise
+  Table<complex_float>* dl_mod_symbols_;
   MacScheduler* mac_sched_;
   Table<float> qam_table_;
   DurationStat* duration_stat_;
   complex_float* modulated_buffer_temp_;
   complex_float* precoded_buffer_temp_;
+  // Set for small_mimo_acc with AVX-512. modulated_buffer_temp_ is then
+  // indexed by [stream][subcarrier in the cache line], and
+  // precoded_buffer_temp_ by [antenna][subcarrier in the block], so that the
+  // subcarriers of a stream or an antenna fill the lanes of a register.
+  bool batched_precode_;
+  // Set with gemm_batch unless batched_precode_, nullptr otherwise. The
+  // precoders of a block are at dl_beam_matrices_ + k * precoder_stride_, or
+  // at precoder_ptrs_[k] if subcarriers share them.
+  std::unique_ptr<CgemvBatch> gemv_batch_;
+  std::vector<const complex_float*> precoder_ptrs_;
+  size_t precoder_stride_ = 0;
 #if defined(USE_MKL_JIT)
   void* jitter_;
   cgemm_jit_kernel_t my_cgemm_;
@@ -0,0 +1,137 @@
+/**
+ * @file douplink_gpu.cc
+ * @brief Implementation file for the DoUplinkGpu class
+ */
+#include "douplink_gpu.h"
+
+#include <string>
+
+#include "comms-lib.h"
+#include "concurrent_queue_wrapper.h"
+#include "logger.h"
+
+DoUplinkGpu::DoUplinkGpu(Config* in_config, int in_tid, GpuUplink* gpu_uplink,
+                         MacScheduler* mac_sched, PhyStats* in_phy_stats,
+                         Stats* in_stats_manager, MessageInfo* message)
+    : Doer(in_config, in_tid),
+      gpu_uplink_(gpu_uplink),
+      handles_(gpu_uplink->CreateHandles()),
+      mac_sched_(mac_sched),
+      phy_stats_(in_phy_stats),
+      message_(message) {
+  duration_stat_beam_ =
+      in_stats_manager->GetDurationStat(DoerType::kBeam, in_tid);
+  duration_stat_demul_ =
+      in_stats_manager->GetDurationStat(DoerType::kDemul, in_tid);
+  alloc_stat_ = duration_stat_demul_;
+}
+
+DoUplinkGpu::~DoUplinkGpu() {
+  // The streams are synchronized when GpuUplink frees them
+  while (pending_.empty() == false) {
+    cudaEventSynchronize(pending_.front().done_);
+    free_events_.push_back(pending_.front().done_);
+    pending_.pop();
+  }
+  for (cudaEvent_t done : free_events_) {
+    cudaEventDestroy(done);
+  }
+  GpuUplink::DestroyHandles(handles_);
+}
+
+bool DoUplinkGpu::TryLaunch(
+    moodycamel::ConcurrentQueue<EventData>& task_queue,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  // Completions go to the queue of their own frame, which is not necessarily
+  // the one this worker is currently serving
+  bool work_done = PollAsync();
+  EventData req_event;
+  if (task_queue.try_dequeue(req_event)) {
+    LaunchEventTraced(req_event, complete_task_queue, worker_ptok);
+    work_done = true;
+  }
+  return work_done;
+}
+
+void DoUplinkGpu::LaunchEvent(
+    const EventData& req_event,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  unused(complete_task_queue);
+  unused(worker_ptok);
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  const size_t frame_id = gen_tag_t(req_event.tags_.at(0)).frame_id_;
+  const ScheduleSnapshot& schedule = mac_sched_->Schedule(frame_id);
+
+  cudaStream_t stream;
+  DurationStat* duration_stat;
+  if (req_event.event_type_ == EventType::kBeam) {
+    float noise = 0;
+    if (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kMMSE) {
+      noise = phy_stats_->GetNoise(frame_id,
+                                   mac_sched_->ScheduledUeList(frame_id, 0));
+    }
+    stream = gpu_uplink_->EnqueueBeams(handles_, frame_id,
+                                       schedule.ue_list_.data(), noise);
+    duration_stat = duration_stat_beam_;
+  } else {
+    RtAssert(req_event.event_type_ == EventType::kDemul,
+             "DoUplinkGpu: invalid event type");
+    const size_t symbol_idx_ul = cfg_->Frame().GetULSymbolIdx(
+        gen_tag_t(req_event.tags_.at(0)).symbol_id_);
+    stream = gpu_uplink_->EnqueueDemul(
+        handles_, frame_id, symbol_idx_ul, schedule.ue_list_.data(),
+        cfg_->Mcs(Direction::kUplink, schedule.phy_ul_mcs_).mod_order_bits_);
+    duration_stat = duration_stat_demul_;
+  }
+
+  Pending pending;
+  if (free_events_.empty()) {
+    const cudaError_t err =
+        cudaEventCreateWithFlags(&pending.done_, cudaEventDisableTiming);
+    RtAssert(err == cudaSuccess, std::string("DoUplinkGpu: ") +
+                                     cudaGetErrorString(err));
+  } else {
+    pending.done_ = free_events_.back();
+    free_events_.pop_back();
+  }
+  cudaEventRecord(pending.done_, stream);
+  pending.event_ = req_event;
+  pending_.push(pending);
+  duration_stat->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+}
+
+bool DoUplinkGpu::PollAsync() {
+  bool work_done = false;
+  // The tasks of a stream complete in order, and those of different frames
+  // rarely overtake each other, so a blocked head is simply waited for
+  while (pending_.empty() == false) {
+    Pending& pending = pending_.front();
+    const cudaError_t err = cudaEventQuery(pending.done_);
+    if (err == cudaErrorNotReady) {
+      break;
+    }
+    RtAssert(err == cudaSuccess, std::string("DoUplinkGpu: ") +
+                                     cudaGetErrorString(err));
+    DurationStat* duration_stat =
+        (pending.event_.event_type_ == EventType::kBeam) ? duration_stat_beam_
+                                                         : duration_stat_demul_;
+    duration_stat->task_count_++;
+    PostCompletion(pending.event_);
+    free_events_.push_back(pending.done_);
+    pending_.pop();
+    work_done = true;
+  }
+  return work_done;
+}
+
+void DoUplinkGpu::PostCompletion(const EventData& event) {
+  if (IsLastSharedTask(event) == false) {
+    return;
+  }
+  const size_t qid =
+      gen_tag_t(event.tags_.at(0)).frame_id_ % cfg_->PipelineDepth();
+  TryEnqueueFallback(&message_->GetCompQueue(qid),
+                     message_->GetWorkerPtok(qid, tid_), event);
+}
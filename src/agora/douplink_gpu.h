@@ -0,0 +1,73 @@
+/**
+ * @file douplink_gpu.h
+ * @brief Declaration file for the DoUplinkGpu class, the doer of the CUDA
+ * uplink backend (gpu_uplink)
+ */
+#ifndef DOUPLINK_GPU_H_
+#define DOUPLINK_GPU_H_
+
+#include <cuda_runtime.h>
+
+#include <queue>
+#include <vector>
+
+#include "agora_buffer.h"
+#include "config.h"
+#include "doer.h"
+#include "gpu_uplink.h"
+#include "mac_scheduler.h"
+#include "phy_stats.h"
+#include "stats.h"
+
+/**
+ * Runs the beamweight (kBeam) and demodulation (kDemul) events of the uplink
+ * on the GPU, in place of DoBeamWeights and DoDemul. With gpu_uplink the
+ * master schedules one task per frame and per symbol. LaunchEvent() only
+ * enqueues the work of a task on the stream of its frame and records a CUDA
+ * event after it; the task is posted to the completion queue of its frame
+ * once the event has completed, so the worker keeps running other doers
+ * while the GPU computes.
+ */
+class DoUplinkGpu : public Doer {
+ public:
+  DoUplinkGpu(Config* in_config, int in_tid, GpuUplink* gpu_uplink,
+              MacScheduler* mac_sched, PhyStats* in_phy_stats,
+              Stats* in_stats_manager, MessageInfo* message);
+  ~DoUplinkGpu() override;
+
+  /// Post the completed tasks, then enqueue the next one
+  bool TryLaunch(moodycamel::ConcurrentQueue<EventData>& task_queue,
+                 moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                 moodycamel::ProducerToken* worker_ptok) override;
+  void LaunchEvent(const EventData& req_event,
+                   moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                   moodycamel::ProducerToken* worker_ptok) override;
+  bool Poll() override { return PollAsync(); }
+
+ private:
+  struct Pending {
+    cudaEvent_t done_;
+    EventData event_;
+  };
+
+  /// Post the tasks whose CUDA event has completed, in enqueue order.
+  /// Returns true if any was posted.
+  bool PollAsync();
+
+  /// Post a completed task to the queue of its frame
+  void PostCompletion(const EventData& event);
+
+  GpuUplink* gpu_uplink_;
+  GpuUplink::Handles handles_;
+  MacScheduler* mac_sched_;
+  PhyStats* phy_stats_;
+  DurationStat* duration_stat_beam_;
+  DurationStat* duration_stat_demul_;
+  MessageInfo* message_;
+
+  // The tasks in flight, and the CUDA events to reuse
+  std::queue<Pending> pending_;
+  std::vector<cudaEvent_t> free_events_;
+};
+
+#endif  // DOUPLINK_GPU_H_
@@ -0,0 +1,175 @@
+/**
+ * @file event_tracer.cc
+ * @brief Implementation file for the EventTracer class
+ */
+#include "event_tracer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <limits>
+#include <utility>
+
+#include "gettime.h"
+#include "logger.h"
+#include "utils.h"
+
+// Indexed by EventType
+static const std::array<const char*, kNumEventTypes> kEventTypeNames = {
+    "packet_rx",
+    "fft",
+    "beam",
+    "demul",
+    "ifft",
+    "precode",
+    "packet_tx",
+    "packet_pilot_tx",
+    "decode",
+    "encode",
+    "modul",
+    "packet_from_mac",
+    "packet_to_mac",
+    "fft_pilot",
+    "snr_report",
+    "ran_update",
+    "rb_indicator",
+    "broadcast",
+    "fft_symbol",
+    "capture_frame",
+    "capture_trigger",
+    "frame_start",
+    "thread_termination",
+};
+
+TraceRing::TraceRing(std::string thread_name, size_t capacity)
+    : thread_name_(std::move(thread_name)),
+      records_(capacity),
+      num_recorded_(0) {
+  RtAssert(capacity > 0, "TraceRing: capacity must be positive");
+}
+
+void TraceRing::Record(const EventData& event, size_t start_tsc,
+                       size_t end_tsc) {
+  TraceRecord& record = records_[num_recorded_ % records_.size()];
+  record.start_tsc_ = start_tsc;
+  record.end_tsc_ = end_tsc;
+  record.event_type_ = static_cast<uint8_t>(event.event_type_);
+  record.num_tags_ = static_cast<uint8_t>(event.num_tags_);
+  record.frame_id_ = UINT32_MAX;
+  record.symbol_id_ = kNoSymbol;
+
+  // Decoded now, a received packet is reused once the event is handled
+  switch (event.event_type_) {
+    case EventType::kPacketRX: {
+      const Packet* pkt = rx_tag_t(event.tags_[0]).rx_packet_->RawPacket();
+      record.frame_id_ = pkt->frame_id_;
+      record.symbol_id_ = pkt->symbol_id_;
+      break;
+    }
+    case EventType::kPacketFromMac:
+    case EventType::kRANUpdate:
+    case EventType::kRBIndicator:
+    case EventType::kCaptureTrigger:
+    case EventType::kThreadTermination:
+      // Not tagged by frame and symbol
+      break;
+    default: {
+      const gen_tag_t tag(event.tags_[0]);
+      record.frame_id_ = tag.frame_id_;
+      record.symbol_id_ = tag.symbol_id_;
+      break;
+    }
+  }
+  num_recorded_++;
+}
+
+std::vector<TraceRecord> TraceRing::Records() const {
+  const size_t num_kept = std::min(num_recorded_, records_.size());
+  std::vector<TraceRecord> records;
+  records.reserve(num_kept);
+  for (size_t i = num_recorded_ - num_kept; i < num_recorded_; i++) {
+    records.push_back(records_.at(i % records_.size()));
+  }
+  return records;
+}
+
+EventTracer::EventTracer(size_t ring_size, double freq_ghz,
+                         size_t num_txrx_threads, size_t num_worker_threads)
+    : freq_ghz_(freq_ghz), num_txrx_threads_(num_txrx_threads) {
+  rings_.push_back(std::make_unique<TraceRing>("master", ring_size));
+  for (size_t i = 0; i < num_txrx_threads; i++) {
+    rings_.push_back(
+        std::make_unique<TraceRing>("txrx " + std::to_string(i), ring_size));
+  }
+  for (size_t i = 0; i < num_worker_threads; i++) {
+    rings_.push_back(
+        std::make_unique<TraceRing>("worker " + std::to_string(i), ring_size));
+  }
+}
+
+const char* EventTracer::EventTypeName(EventType event_type) {
+  return kEventTypeNames.at(static_cast<size_t>(event_type));
+}
+
+void EventTracer::WriteJson(const std::string& filename) const {
+  std::vector<std::vector<TraceRecord>> records;
+  size_t base_tsc = std::numeric_limits<size_t>::max();
+  for (const auto& ring : rings_) {
+    records.push_back(ring->Records());
+    for (const TraceRecord& record : records.back()) {
+      base_tsc = std::min(base_tsc, record.start_tsc_);
+    }
+  }
+
+  AGORA_LOG_INFO("EventTracer: Saving the event trace to %s\n",
+                 filename.c_str());
+  FILE* fp = std::fopen(filename.c_str(), "w");
+  RtAssert(fp != nullptr,
+           std::string("Open file failed ") + std::to_string(errno));
+
+  std::fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  for (size_t tid = 0; tid < rings_.size(); tid++) {
+    std::fprintf(fp,
+                 "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+                 "\"tid\": %zu, \"args\": {\"name\": \"%s\"}},\n"
+                 "{\"name\": \"thread_sort_index\", \"ph\": \"M\", "
+                 "\"pid\": 0, \"tid\": %zu, \"args\": {\"sort_index\": %zu}}",
+                 tid, rings_.at(tid)->ThreadName().c_str(), tid, tid);
+    std::fputs((tid + 1 < rings_.size()) ? ",\n" : "", fp);
+  }
+
+  for (size_t tid = 0; tid < rings_.size(); tid++) {
+    if (rings_.at(tid)->NumRecorded() > records.at(tid).size()) {
+      AGORA_LOG_WARN("EventTracer: %s kept its last %zu of %zu events\n",
+                     rings_.at(tid)->ThreadName().c_str(),
+                     records.at(tid).size(), rings_.at(tid)->NumRecorded());
+    }
+    for (const TraceRecord& record : records.at(tid)) {
+      const double ts_us =
+          GetTime::CyclesToUs(record.start_tsc_ - base_tsc, freq_ghz_);
+      std::fprintf(fp, ",\n{\"name\": \"%s\", \"pid\": 0, \"tid\": %zu, ",
+                   kEventTypeNames.at(record.event_type_), tid);
+      if (record.end_tsc_ == record.start_tsc_) {
+        std::fprintf(fp, "\"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, ",
+                     ts_us);
+      } else {
+        std::fprintf(
+            fp, "\"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, ", ts_us,
+            GetTime::CyclesToUs(record.end_tsc_ - record.start_tsc_,
+                                freq_ghz_));
+      }
+      std::fprintf(fp, "\"args\": {\"tags\": %u",
+                   static_cast<unsigned>(record.num_tags_));
+      if (record.frame_id_ != UINT32_MAX) {
+        std::fprintf(fp, ", \"frame\": %u", record.frame_id_);
+      }
+      if (record.symbol_id_ != TraceRing::kNoSymbol) {
+        std::fprintf(fp, ", \"symbol\": %u",
+                     static_cast<unsigned>(record.symbol_id_));
+      }
+      std::fprintf(fp, "}}");
+    }
+  }
+  std::fprintf(fp, "\n]}\n");
+  std::fclose(fp);
+}
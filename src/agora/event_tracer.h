@@ -0,0 +1,85 @@
+/**
+ * @file event_tracer.h
+ * @brief Declaration file for the EventTracer class, which records the
+ * timeline of the events handled by the master, TxRx and worker threads and
+ * writes it in the Chrome trace format (chrome://tracing, ui.perfetto.dev).
+ */
+#ifndef EVENT_TRACER_H_
+#define EVENT_TRACER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "message.h"
+#include "symbols.h"
+
+/// One handled event. Zero-length records are instant events, e.g. a packet
+/// received by a TxRx thread.
+struct TraceRecord {
+  size_t start_tsc_;
+  size_t end_tsc_;
+  uint32_t frame_id_;
+  uint16_t symbol_id_;
+  uint8_t event_type_;
+  uint8_t num_tags_;
+};
+
+/// Fixed-capacity ring of the records of one thread, which overwrites its
+/// oldest records when full. Only its thread writes to it, and it is read
+/// after the thread is joined.
+class TraceRing {
+ public:
+  static constexpr uint16_t kNoSymbol = UINT16_MAX;
+
+  TraceRing(std::string thread_name, size_t capacity);
+
+  /// Record an event handled between the two TSC values. Never blocks or
+  /// allocates.
+  void Record(const EventData& event, size_t start_tsc, size_t end_tsc);
+
+  inline const std::string& ThreadName() const { return thread_name_; }
+  /// Records written so far, including the overwritten ones
+  inline size_t NumRecorded() const { return num_recorded_; }
+  /// The records still in the ring, oldest first
+  std::vector<TraceRecord> Records() const;
+
+ private:
+  const std::string thread_name_;
+  std::vector<TraceRecord> records_;
+  size_t num_recorded_;
+};
+
+class EventTracer {
+ public:
+  /**
+   * @brief Create the rings of the master, TxRx and worker threads
+   *
+   * @param ring_size Records kept per thread
+   * @param freq_ghz TSC frequency, to convert the records to microseconds
+   */
+  EventTracer(size_t ring_size, double freq_ghz, size_t num_txrx_threads,
+              size_t num_worker_threads);
+
+  inline TraceRing* MasterRing() { return rings_.at(0).get(); }
+  inline TraceRing* TxRxRing(size_t tid) { return rings_.at(1 + tid).get(); }
+  inline TraceRing* WorkerRing(size_t tid) {
+    return rings_.at(1 + num_txrx_threads_ + tid).get();
+  }
+
+  /// Name of an event type in the trace, e.g. "decode"
+  static const char* EventTypeName(EventType event_type);
+
+  /// Write the rings in the Chrome trace JSON format. Only call it once the
+  /// threads writing to the rings are stopped.
+  void WriteJson(const std::string& filename) const;
+
+ private:
+  const double freq_ghz_;
+  const size_t num_txrx_threads_;
+  std::vector<std::unique_ptr<TraceRing>> rings_;
+};
+
+#endif  // EVENT_TRACER_H_
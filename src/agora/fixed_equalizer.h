@@ -0,0 +1,37 @@
+/**
+ * @file fixed_equalizer.h
+ * @brief Declaration file for the uplink equalizer specialized at compile
+ * time for the antenna and stream counts of a cell profile, which the
+ * compiler fully unrolls.
+ */
+#ifndef FIXED_EQUALIZER_H_
+#define FIXED_EQUALIZER_H_
+
+#include <cstddef>
+
+namespace FixedEqualizer {
+
+/// Write beam * data to equal, for a kStreams x kAnts complex beam matrix
+/// (interleaved, column-major) and kAnts complex data samples (interleaved)
+template <size_t kStreams, size_t kAnts>
+inline void Equalize(const float* beam, const float* data, float* equal) {
+  float acc_re[kStreams] = {};
+  float acc_im[kStreams] = {};
+  for (size_t ant = 0; ant < kAnts; ant++) {
+    const float data_re = data[2 * ant];
+    const float data_im = data[2 * ant + 1];
+    const float* col = &beam[2 * kStreams * ant];
+    for (size_t ss = 0; ss < kStreams; ss++) {
+      acc_re[ss] += (col[2 * ss] * data_re) - (col[2 * ss + 1] * data_im);
+      acc_im[ss] += (col[2 * ss] * data_im) + (col[2 * ss + 1] * data_re);
+    }
+  }
+  for (size_t ss = 0; ss < kStreams; ss++) {
+    equal[2 * ss] = acc_re[ss];
+    equal[2 * ss + 1] = acc_im[ss];
+  }
+}
+
+}  // namespace FixedEqualizer
+
+#endif  // FIXED_EQUALIZER_H_
@@ -0,0 +1,125 @@
+/**
+ * @file frame_log.cc
+ * @brief Implementation file for the FrameLog class
+ */
+#include "frame_log.h"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.h"
+
+static constexpr std::array<char, 8> kFileMagic = {'A', 'G', 'F', 'R',
+                                                   'L', 'O', 'G', '1'};
+static constexpr std::array<char, 4> kBlockMagic = {'B', 'L', 'C', 'K'};
+// Time the writer sleeps once the ring is empty
+static constexpr auto kWriterIdle = std::chrono::milliseconds(10);
+
+static size_t ValueBytes(FrameLog::ColumnType type) {
+  return (type == FrameLog::ColumnType::kU64) ? sizeof(uint64_t)
+                                              : sizeof(float);
+}
+
+FrameLog::FrameLog(const std::string& filename, std::vector<Column> columns,
+                   size_t ring_rows)
+    : filename_(filename),
+      columns_(std::move(columns)),
+      ring_rows_(ring_rows),
+      ring_(ring_rows * columns_.size()),
+      block_(columns_.size()) {
+  fp_ = std::fopen(filename_.c_str(), "wb");
+  if (fp_ == nullptr) {
+    throw std::runtime_error("FrameLog: failed to open " + filename_);
+  }
+  const uint32_t num_columns = columns_.size();
+  const uint32_t block_rows = kBlockRows;
+  std::fwrite(kFileMagic.data(), 1, kFileMagic.size(), fp_);
+  std::fwrite(&num_columns, sizeof(num_columns), 1, fp_);
+  std::fwrite(&block_rows, sizeof(block_rows), 1, fp_);
+  for (size_t i = 0; i < columns_.size(); i++) {
+    const Column& column = columns_.at(i);
+    if (column.name_.size() >= kNameBytes) {
+      throw std::runtime_error("FrameLog: column name too long " +
+                               column.name_);
+    }
+    std::array<char, kNameBytes> name{};
+    std::memcpy(name.data(), column.name_.data(), column.name_.size());
+    const auto type = static_cast<uint32_t>(column.type_);
+    const uint32_t bytes = ValueBytes(column.type_);
+    std::fwrite(name.data(), 1, name.size(), fp_);
+    std::fwrite(&type, sizeof(type), 1, fp_);
+    std::fwrite(&bytes, sizeof(bytes), 1, fp_);
+    block_.at(i).resize(kBlockRows * bytes);
+  }
+  std::fflush(fp_);
+  writer_ = std::thread(&FrameLog::WriterThread, this);
+  AGORA_LOG_INFO("FrameLog: writing %zu columns to %s\n", columns_.size(),
+                 filename_.c_str());
+}
+
+FrameLog::~FrameLog() {
+  running_.store(false);
+  writer_.join();
+  std::fclose(fp_);
+  if (dropped_rows_ > 0) {
+    AGORA_LOG_WARN("FrameLog: dropped %zu rows, the writer fell behind\n",
+                   dropped_rows_);
+  }
+}
+
+void FrameLog::WriterThread() {
+  while (running_.load() == true) {
+    if (Drain(false) == 0) {
+      std::this_thread::sleep_for(kWriterIdle);
+    }
+  }
+  // The master is done with the ring
+  Drain(true);
+}
+
+size_t FrameLog::Drain(bool flush) {
+  const size_t head = head_.load(std::memory_order_acquire);
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  const size_t num_rows = head - tail;
+  for (; tail != head; tail++) {
+    const Value* row = &ring_.at((tail % ring_rows_) * columns_.size());
+    for (size_t i = 0; i < columns_.size(); i++) {
+      uint8_t* dst = block_.at(i).data();
+      if (columns_.at(i).type_ == ColumnType::kU64) {
+        std::memcpy(dst + (block_num_rows_ * sizeof(uint64_t)), &row[i].u_,
+                    sizeof(uint64_t));
+      } else {
+        const auto value = static_cast<float>(row[i].f_);
+        std::memcpy(dst + (block_num_rows_ * sizeof(float)), &value,
+                    sizeof(float));
+      }
+    }
+    tail_.store(tail + 1, std::memory_order_release);
+    block_num_rows_++;
+    if (block_num_rows_ == kBlockRows) {
+      WriteBlock();
+    }
+  }
+  if (flush && (block_num_rows_ > 0)) {
+    WriteBlock();
+  }
+  return num_rows;
+}
+
+void FrameLog::WriteBlock() {
+  static constexpr std::array<uint8_t, 8> kPadding{};
+  const uint32_t num_rows = block_num_rows_;
+  std::fwrite(kBlockMagic.data(), 1, kBlockMagic.size(), fp_);
+  std::fwrite(&num_rows, sizeof(num_rows), 1, fp_);
+  for (size_t i = 0; i < columns_.size(); i++) {
+    const size_t bytes = num_rows * ValueBytes(columns_.at(i).type_);
+    std::fwrite(block_.at(i).data(), 1, bytes, fp_);
+    std::fwrite(kPadding.data(), 1, (8 - (bytes % 8)) % 8, fp_);
+  }
+  // Whole blocks are readable while the log runs
+  std::fflush(fp_);
+  block_num_rows_ = 0;
+}
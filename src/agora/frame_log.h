@@ -0,0 +1,101 @@
+/**
+ * @file frame_log.h
+ * @brief Declaration file for the FrameLog class, a columnar binary log of
+ * one row per frame (timestamps, stage times, link quality, drops) that a
+ * background thread appends to a file.
+ *
+ * The file starts with a header: the magic "AGFRLOG1", the number of
+ * columns and the rows per block (uint32 each), then a 64-byte descriptor
+ * per column: its name (56 bytes, zero padded), its type (uint32, a
+ * FrameLog::ColumnType) and the bytes of a value (uint32). Blocks of rows
+ * follow, each with the magic "BLCK" and its number of rows (uint32 each),
+ * then the values of every column of the block in turn, each column padded
+ * to 8 bytes. All of it is little endian. tools/python/frame_log.py reads
+ * it.
+ */
+#ifndef FRAME_LOG_H_
+#define FRAME_LOG_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FrameLog {
+ public:
+  enum class ColumnType : uint32_t { kU64, kF32 };
+  struct Column {
+    std::string name_;
+    ColumnType type_;
+  };
+  /// A value of a row, read as the type of its column
+  union Value {
+    uint64_t u_;
+    double f_;
+  };
+
+  static constexpr size_t kNameBytes = 56;
+  /// Rows written to the file at once
+  static constexpr size_t kBlockRows = 1024;
+
+  /**
+   * @brief Create the file and start the writer thread
+   *
+   * @param ring_rows Rows the master can be ahead of the writer. Once the
+   * ring is full, new rows are dropped instead of waiting for the writer.
+   */
+  FrameLog(const std::string& filename, std::vector<Column> columns,
+           size_t ring_rows = 4 * kBlockRows);
+  /// Write the rows left and close the file
+  ~FrameLog();
+
+  FrameLog(const FrameLog&) = delete;
+  FrameLog& operator=(const FrameLog&) = delete;
+
+  /// The row to fill in, one value per column, or nullptr if the ring is
+  /// full. Single producer.
+  inline Value* BeginRow() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == ring_rows_) {
+      dropped_rows_++;
+      return nullptr;
+    }
+    return &ring_.at((head % ring_rows_) * columns_.size());
+  }
+  /// Hand the row of BeginRow() to the writer
+  inline void CommitRow() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  inline size_t NumColumns() const { return columns_.size(); }
+  /// Rows dropped because the writer fell behind
+  inline size_t DroppedRows() const { return dropped_rows_; }
+
+ private:
+  void WriterThread();
+  /// Move the rows in the ring to the block, and write the block once full
+  /// (or, with flush, if it has any rows). Returns the rows moved.
+  size_t Drain(bool flush);
+  void WriteBlock();
+
+  const std::string filename_;
+  const std::vector<Column> columns_;
+  const size_t ring_rows_;
+  std::vector<Value> ring_;
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t dropped_rows_ = 0;
+
+  // Writer thread only: the columns of the block being filled
+  std::vector<std::vector<uint8_t>> block_;
+  size_t block_num_rows_ = 0;
+  std::FILE* fp_;
+  std::atomic<bool> running_{true};
+  std::thread writer_;
+};
+
+#endif  // FRAME_LOG_H_
@@ -0,0 +1,333 @@
+/**
+ * @file gpu_uplink.cc
+ * @brief Implementation file for the GpuUplink class
+ */
+#include "gpu_uplink.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "agora_buffer.h"
+#include "comms-lib.h"
+#include "logger.h"
+#include "modulation.h"
+#include "tile_layout.h"
+#include "utils.h"
+
+static_assert(GpuUplinkKernels::kMaxStreams == kMaxUEs,
+              "The UE list of the kernels must hold kMaxUEs streams");
+static_assert(sizeof(cuFloatComplex) == sizeof(complex_float),
+              "cuFloatComplex must be layout compatible with complex_float");
+
+static void CudaCheck(cudaError_t err, const char* what) {
+  RtAssert(err == cudaSuccess, std::string("GpuUplink: ") + what + ": " +
+                                   cudaGetErrorString(err));
+}
+
+static void BlasCheck(cublasStatus_t status, const char* what) {
+  RtAssert(status == CUBLAS_STATUS_SUCCESS,
+           std::string("GpuUplink: ") + what + " failed with cuBLAS status " +
+               std::to_string(static_cast<int>(status)));
+}
+
+static void SolverCheck(cusolverStatus_t status, const char* what) {
+  RtAssert(status == CUSOLVER_STATUS_SUCCESS,
+           std::string("GpuUplink: ") + what +
+               " failed with cuSOLVER status " +
+               std::to_string(static_cast<int>(status)));
+}
+
+template <class T>
+static T* DeviceAlloc(size_t num_elems) {
+  void* ptr = nullptr;
+  CudaCheck(cudaMalloc(&ptr, num_elems * sizeof(T)), "cudaMalloc");
+  return static_cast<T*>(ptr);
+}
+
+static inline cuFloatComplex* Cx(complex_float* ptr) {
+  return reinterpret_cast<cuFloatComplex*>(ptr);
+}
+
+/// The scaling of the CPU soft demodulators, as in DemodSoftPortableX2
+static GpuUplinkKernels::DemodParams MakeDemodParams(size_t mod_order_bits) {
+  GpuUplinkKernels::DemodParams params{};
+  params.mod_order_bits_ = mod_order_bits;
+  switch (mod_order_bits) {
+    case 2:
+      params.scale_ = -SCALE_BYTE_CONV_QPSK * M_SQRT2;
+      break;
+    case 4:
+      params.scale_ = SCALE_BYTE_CONV_QAM16;
+      params.offset_[0] =
+          static_cast<int8_t>(2 * SCALE_BYTE_CONV_QAM16 / sqrt(10));
+      break;
+    case 6:
+      params.scale_ = SCALE_BYTE_CONV_QAM64;
+      params.offset_[0] =
+          static_cast<int8_t>(4 * SCALE_BYTE_CONV_QAM64 / sqrt(42));
+      params.offset_[1] =
+          static_cast<int8_t>(2 * SCALE_BYTE_CONV_QAM64 / sqrt(42));
+      break;
+    case 8:
+      params.scale_ = SCALE_BYTE_CONV_QAM256;
+      params.offset_[0] =
+          static_cast<int8_t>(QAM256_THRESHOLD_4 * SCALE_BYTE_CONV_QAM256);
+      params.offset_[1] =
+          static_cast<int8_t>(QAM256_THRESHOLD_2 * SCALE_BYTE_CONV_QAM256);
+      params.offset_[2] =
+          static_cast<int8_t>(QAM256_THRESHOLD_1 * SCALE_BYTE_CONV_QAM256);
+      break;
+    default:
+      RtAssert(false, "GpuUplink: unsupported modulation order " +
+                          std::to_string(mod_order_bits));
+  }
+  return params;
+}
+
+GpuUplink::GpuUplink(Config* cfg, AgoraBuffer* buffer)
+    : cfg_(cfg),
+      buffer_(buffer),
+      dims_{cfg->BsAntNum(), cfg->SpatialStreamsNum(), cfg->OfdmDataNum(),
+            kUsePartialTrans ? TileLayout::kTileScs : 0},
+      llr_stride_(kMaxModType * cfg->OfdmDataNum()) {
+  int num_devices = 0;
+  CudaCheck(cudaGetDeviceCount(&num_devices), "cudaGetDeviceCount");
+  RtAssert(num_devices > 0, "GpuUplink: no CUDA device");
+  cudaDeviceProp prop;
+  CudaCheck(cudaGetDeviceProperties(&prop, 0), "cudaGetDeviceProperties");
+  AGORA_LOG_INFO("GpuUplink: computing the uplink on %s\n", prop.name);
+
+  const size_t frame_window = cfg_->FrameWindow();
+  RegisterHost(buffer_->GetCsi()[0][0], frame_window * cfg_->UeAntNum() *
+                                            cfg_->BsAntNum() *
+                                            cfg_->OfdmDataNum() *
+                                            sizeof(complex_float));
+  RegisterHost(buffer_->GetFft().get_data_ptr(),
+               buffer_->GetFft().SizeBytes());
+  RegisterHost(buffer_->GetEqual().get_data_ptr(),
+               buffer_->GetEqual().SizeBytes());
+  RegisterHost(buffer_->GetDemod()[0][0][0],
+               frame_window * cfg_->Frame().NumULSyms() *
+                   cfg_->SpatialStreamsNum() * llr_stride_);
+
+  for (size_t i = 0; i < frame_window; i++) {
+    AllocSlot(slots_.at(i));
+  }
+
+  const size_t pilots_size = cfg_->UeAntNum() * cfg_->OfdmDataNum();
+  pilots_ = DeviceAlloc<cuFloatComplex>(pilots_size);
+  CudaCheck(cudaMemcpy(pilots_, cfg_->UeSpecificPilot()[0],
+                       pilots_size * sizeof(cuFloatComplex),
+                       cudaMemcpyHostToDevice),
+            "pilot copy");
+}
+
+GpuUplink::~GpuUplink() {
+  for (size_t i = 0; i < cfg_->FrameWindow(); i++) {
+    FreeSlot(slots_.at(i));
+  }
+  cudaFree(pilots_);
+  for (void* ptr : registered_) {
+    cudaHostUnregister(ptr);
+  }
+}
+
+void GpuUplink::RegisterHost(void* ptr, size_t size) {
+  if ((ptr == nullptr) || (size == 0)) {
+    return;
+  }
+  CudaCheck(cudaHostRegister(ptr, size, cudaHostRegisterDefault),
+            "cudaHostRegister");
+  registered_.push_back(ptr);
+}
+
+void GpuUplink::AllocSlot(Slot& slot) {
+  const size_t bs_ant_num = dims_.bs_ant_num_;
+  const size_t num_streams = dims_.num_streams_;
+  const size_t sc_num = dims_.ofdm_data_num_;
+  CudaCheck(cudaStreamCreateWithFlags(&slot.stream_, cudaStreamNonBlocking),
+            "cudaStreamCreate");
+  slot.csi_ = DeviceAlloc<cuFloatComplex>(num_streams * bs_ant_num * sc_num);
+  slot.h_ = DeviceAlloc<cuFloatComplex>(bs_ant_num * num_streams * sc_num);
+  slot.gram_ = DeviceAlloc<cuFloatComplex>(num_streams * num_streams * sc_num);
+  slot.beam_ = DeviceAlloc<cuFloatComplex>(num_streams * bs_ant_num * sc_num);
+  slot.info_ = DeviceAlloc<int>(sc_num);
+  slot.gram_ptrs_ = DeviceAlloc<cuFloatComplex*>(sc_num);
+  slot.beam_ptrs_ = DeviceAlloc<cuFloatComplex*>(sc_num);
+  slot.data_ = DeviceAlloc<cuFloatComplex>(bs_ant_num * sc_num);
+  slot.y_ = DeviceAlloc<cuFloatComplex>(bs_ant_num * sc_num);
+  slot.equal_ = DeviceAlloc<cuFloatComplex>(num_streams * sc_num);
+  slot.corr_ = DeviceAlloc<cuFloatComplex>(
+      std::max<size_t>(1, cfg_->Frame().ClientUlPilotSymbols()) *
+      num_streams);
+  slot.llr_ = DeviceAlloc<int8_t>(num_streams * llr_stride_);
+
+  std::vector<cuFloatComplex*> gram_ptrs(sc_num);
+  std::vector<cuFloatComplex*> beam_ptrs(sc_num);
+  for (size_t sc = 0; sc < sc_num; sc++) {
+    gram_ptrs.at(sc) = slot.gram_ + (sc * num_streams * num_streams);
+    beam_ptrs.at(sc) = slot.beam_ + (sc * num_streams * bs_ant_num);
+  }
+  CudaCheck(cudaMemcpy(slot.gram_ptrs_, gram_ptrs.data(),
+                       sc_num * sizeof(cuFloatComplex*),
+                       cudaMemcpyHostToDevice),
+            "pointer array copy");
+  CudaCheck(cudaMemcpy(slot.beam_ptrs_, beam_ptrs.data(),
+                       sc_num * sizeof(cuFloatComplex*),
+                       cudaMemcpyHostToDevice),
+            "pointer array copy");
+}
+
+void GpuUplink::FreeSlot(Slot& slot) {
+  if (slot.stream_ == nullptr) {
+    return;
+  }
+  cudaStreamSynchronize(slot.stream_);
+  cudaStreamDestroy(slot.stream_);
+  for (void* ptr :
+       {static_cast<void*>(slot.csi_), static_cast<void*>(slot.h_),
+        static_cast<void*>(slot.gram_), static_cast<void*>(slot.beam_),
+        static_cast<void*>(slot.info_), static_cast<void*>(slot.gram_ptrs_),
+        static_cast<void*>(slot.beam_ptrs_), static_cast<void*>(slot.data_),
+        static_cast<void*>(slot.y_), static_cast<void*>(slot.equal_),
+        static_cast<void*>(slot.corr_), static_cast<void*>(slot.llr_)}) {
+    cudaFree(ptr);
+  }
+  slot = Slot{};
+}
+
+GpuUplink::Handles GpuUplink::CreateHandles() const {
+  Handles handles;
+  BlasCheck(cublasCreate(&handles.blas_), "cublasCreate");
+  SolverCheck(cusolverDnCreate(&handles.solver_), "cusolverDnCreate");
+  return handles;
+}
+
+void GpuUplink::DestroyHandles(Handles& handles) {
+  cusolverDnDestroy(handles.solver_);
+  cublasDestroy(handles.blas_);
+}
+
+cudaStream_t GpuUplink::EnqueueBeams(const Handles& handles, size_t frame_id,
+                                     const size_t* ue_list, float noise) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  Slot& slot = slots_.at(frame_slot);
+  const size_t csi_elems = dims_.bs_ant_num_ * dims_.ofdm_data_num_;
+  for (size_t ss = 0; ss < dims_.num_streams_; ss++) {
+    CudaCheck(cudaMemcpyAsync(slot.csi_ + (ss * csi_elems),
+                              buffer_->GetCsi()[frame_slot][ue_list[ss]],
+                              csi_elems * sizeof(cuFloatComplex),
+                              cudaMemcpyHostToDevice, slot.stream_),
+              "CSI copy");
+  }
+  // beam_ starts as H', the MRC beamweights
+  GpuUplinkKernels::GatherCsi(dims_, slot.csi_, slot.h_, slot.beam_,
+                              slot.stream_);
+  if (cfg_->BeamformingAlgo() == CommsLib::BeamformingAlgorithm::kMRC) {
+    return slot.stream_;
+  }
+
+  // ZF and MMSE: beam = inv(H' * H + noise * I) * H', with the Cholesky
+  // factor L of the Gram matrix as L * (L' * beam) = H'
+  const int bs_ant_num = static_cast<int>(dims_.bs_ant_num_);
+  const int num_streams = static_cast<int>(dims_.num_streams_);
+  const int batch = static_cast<int>(dims_.ofdm_data_num_);
+  const auto mat_size = static_cast<long long>(bs_ant_num * num_streams);
+  const cuFloatComplex one = make_cuFloatComplex(1.0f, 0.0f);
+  const cuFloatComplex zero = make_cuFloatComplex(0.0f, 0.0f);
+  BlasCheck(cublasSetStream(handles.blas_, slot.stream_), "cublasSetStream");
+  SolverCheck(cusolverDnSetStream(handles.solver_, slot.stream_),
+              "cusolverDnSetStream");
+  BlasCheck(cublasCgemmStridedBatched(
+                handles.blas_, CUBLAS_OP_C, CUBLAS_OP_N, num_streams,
+                num_streams, bs_ant_num, &one, slot.h_, bs_ant_num, mat_size,
+                slot.h_, bs_ant_num, mat_size, &zero, slot.gram_, num_streams,
+                static_cast<long long>(num_streams * num_streams), batch),
+            "Gram matrices");
+  GpuUplinkKernels::LoadDiagonal(dims_, slot.gram_, noise, slot.stream_);
+  // The diagonal loading keeps every Gram matrix positive definite, so
+  // info_ is not read back
+  SolverCheck(cusolverDnCpotrfBatched(handles.solver_, CUBLAS_FILL_MODE_LOWER,
+                                      num_streams, slot.gram_ptrs_,
+                                      num_streams, slot.info_, batch),
+              "Cholesky factorization");
+  for (cublasOperation_t op : {CUBLAS_OP_N, CUBLAS_OP_C}) {
+    BlasCheck(cublasCtrsmBatched(handles.blas_, CUBLAS_SIDE_LEFT,
+                                 CUBLAS_FILL_MODE_LOWER, op,
+                                 CUBLAS_DIAG_NON_UNIT, num_streams,
+                                 bs_ant_num, &one, slot.gram_ptrs_,
+                                 num_streams, slot.beam_ptrs_, num_streams,
+                                 batch),
+              "triangular solve");
+  }
+  return slot.stream_;
+}
+
+cudaStream_t GpuUplink::EnqueueDemul(const Handles& handles, size_t frame_id,
+                                     size_t symbol_idx_ul,
+                                     const size_t* ue_list,
+                                     size_t mod_order_bits) {
+  const size_t frame_slot = frame_id % cfg_->FrameWindow();
+  const size_t total_data_symbol_idx_ul =
+      cfg_->GetTotalDataSymbolIdxUl(frame_id, symbol_idx_ul);
+  Slot& slot = slots_.at(frame_slot);
+
+  CudaCheck(cudaMemcpyAsync(
+                slot.data_, buffer_->GetFft()[total_data_symbol_idx_ul],
+                dims_.bs_ant_num_ * dims_.ofdm_data_num_ *
+                    sizeof(cuFloatComplex),
+                cudaMemcpyHostToDevice, slot.stream_),
+            "data copy");
+  GpuUplinkKernels::GatherData(dims_, slot.data_, slot.y_, slot.stream_);
+
+  // equal = beam * y of each subcarrier
+  const int bs_ant_num = static_cast<int>(dims_.bs_ant_num_);
+  const int num_streams = static_cast<int>(dims_.num_streams_);
+  const cuFloatComplex one = make_cuFloatComplex(1.0f, 0.0f);
+  const cuFloatComplex zero = make_cuFloatComplex(0.0f, 0.0f);
+  BlasCheck(cublasSetStream(handles.blas_, slot.stream_), "cublasSetStream");
+  BlasCheck(cublasCgemmStridedBatched(
+                handles.blas_, CUBLAS_OP_N, CUBLAS_OP_N, num_streams, 1,
+                bs_ant_num, &one, slot.beam_, num_streams,
+                static_cast<long long>(num_streams * bs_ant_num), slot.y_,
+                bs_ant_num, bs_ant_num, &zero, slot.equal_, num_streams,
+                num_streams, static_cast<int>(dims_.ofdm_data_num_)),
+            "equalization");
+
+  // The pilot symbols come first in the frame's stream, as they do in the
+  // schedule of DoDemul
+  const size_t num_pilots = cfg_->Frame().ClientUlPilotSymbols();
+  if (symbol_idx_ul < num_pilots) {
+    GpuUplinkKernels::UeList ues;
+    for (size_t ss = 0; ss < dims_.num_streams_; ss++) {
+      ues.ue_[ss] = static_cast<uint16_t>(ue_list[ss]);
+    }
+    GpuUplinkKernels::PilotCorr(
+        dims_, slot.equal_, pilots_, ues,
+        slot.corr_ + (symbol_idx_ul * dims_.num_streams_), slot.stream_);
+  } else if (num_pilots > 0) {
+    GpuUplinkKernels::Derotate(dims_, slot.equal_, slot.corr_, num_pilots,
+                               symbol_idx_ul, slot.stream_);
+  }
+  if (kExportConstellation) {
+    CudaCheck(cudaMemcpyAsync(
+                  Cx(buffer_->GetEqual()[total_data_symbol_idx_ul]),
+                  slot.equal_,
+                  dims_.num_streams_ * dims_.ofdm_data_num_ *
+                      sizeof(cuFloatComplex),
+                  cudaMemcpyDeviceToHost, slot.stream_),
+              "equalized data copy");
+  }
+
+  GpuUplinkKernels::DemodSoft(dims_, slot.equal_,
+                              MakeDemodParams(mod_order_bits), slot.llr_,
+                              llr_stride_, slot.stream_);
+  CudaCheck(cudaMemcpy2DAsync(
+                buffer_->GetDemod()[frame_slot][symbol_idx_ul][0],
+                llr_stride_, slot.llr_, llr_stride_,
+                mod_order_bits * dims_.ofdm_data_num_, dims_.num_streams_,
+                cudaMemcpyDeviceToHost, slot.stream_),
+            "LLR copy");
+  return slot.stream_;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file gpu_uplink.h
+ * @brief Declaration file for the GpuUplink class, the device state of the
+ * CUDA uplink backend (gpu_uplink) shared by the DoUplinkGpu doers of all
+ * workers
+ */
+#ifndef GPU_UPLINK_H_
+#define GPU_UPLINK_H_
+
+#include <cublas_v2.h>
+#include <cuda_runtime.h>
+#include <cusolverDn.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "config.h"
+#include "gpu_uplink_kernels.h"
+#include "symbols.h"
+
+class AgoraBuffer;
+
+/**
+ * Computes the uplink beamweights of a frame and the equalized symbols and
+ * LLRs of its uplink symbols on the GPU, reading the CSI and FFT output from
+ * the AgoraBuffer tables and writing the LLRs back to its demod buffer. The
+ * tables are page-locked with cudaHostRegister, so the copies are
+ * asynchronous.
+ *
+ * All the work of a frame goes to the CUDA stream of its frame slot, in the
+ * order the master schedules it: the beamweights first, then the symbols as
+ * their FFT completes. The copies of a frame thus overlap the kernels of the
+ * frames before it, and the device buffers of a slot are reused by each of
+ * its symbols in turn.
+ */
+class GpuUplink {
+ public:
+  /// The cuBLAS and cuSOLVER handles of one worker, as they must not be used
+  /// by several threads at once
+  struct Handles {
+    cublasHandle_t blas_;
+    cusolverDnHandle_t solver_;
+  };
+
+  GpuUplink(Config* cfg, AgoraBuffer* buffer);
+  ~GpuUplink();
+
+  // Delete copy constructor and copy assignment
+  GpuUplink(GpuUplink const&) = delete;
+  GpuUplink& operator=(GpuUplink const&) = delete;
+
+  Handles CreateHandles() const;
+  static void DestroyHandles(Handles& handles);
+
+  /// Enqueue the uplink beamweights of frame_id for the UEs of ue_list (one
+  /// per spatial stream) with the MMSE noise, and return the stream they
+  /// run on
+  cudaStream_t EnqueueBeams(const Handles& handles, size_t frame_id,
+                            const size_t* ue_list, float noise);
+
+  /// Enqueue the equalization, phase tracking and soft demodulation of
+  /// uplink symbol symbol_idx_ul of frame_id, after its beamweights, and
+  /// return the stream they run on
+  cudaStream_t EnqueueDemul(const Handles& handles, size_t frame_id,
+                            size_t symbol_idx_ul, const size_t* ue_list,
+                            size_t mod_order_bits);
+
+ private:
+  /// The device buffers of one frame slot
+  struct Slot {
+    cudaStream_t stream_;
+    cuFloatComplex* csi_;   // CSI of each stream, as in csi_buffer_
+    cuFloatComplex* h_;     // BsAnt x Streams channel matrix per subcarrier
+    cuFloatComplex* gram_;  // Streams x Streams per subcarrier
+    cuFloatComplex* beam_;  // Streams x BsAnt per subcarrier
+    int* info_;             // potrf status per subcarrier
+    // Per-subcarrier matrices for the batched potrf and trsm
+    cuFloatComplex** gram_ptrs_;
+    cuFloatComplex** beam_ptrs_;
+    cuFloatComplex* data_;   // One symbol as in fft_buffer_
+    cuFloatComplex* y_;      // BsAnt vector per subcarrier
+    cuFloatComplex* equal_;  // Streams per subcarrier
+    cuFloatComplex* corr_;   // Pilot correlations, as ue_spec_pilot_buffer_
+    int8_t* llr_;            // One symbol as in demod_buffer_
+  };
+
+  /// Page-lock a host table so its copies are asynchronous
+  void RegisterHost(void* ptr, size_t size);
+  void AllocSlot(Slot& slot);
+  static void FreeSlot(Slot& slot);
+
+  Config* const cfg_;
+  AgoraBuffer* const buffer_;
+  const GpuUplinkKernels::Dims dims_;
+  // LLRs of each stream in a symbol of demod_buffer_
+  const size_t llr_stride_;
+  std::vector<void*> registered_;
+  std::array<Slot, kFrameWnd> slots_{};
+  // UeSpecificPilot(), UeAntNum x OfdmDataNum
+  cuFloatComplex* pilots_ = nullptr;
+};
+
+#endif  // GPU_UPLINK_H_
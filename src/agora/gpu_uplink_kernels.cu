@@ -0,0 +1,213 @@
+/**
+ * @file gpu_uplink_kernels.cu
+ * @brief Implementation file for the CUDA kernels of GpuUplink
+ */
+#include "gpu_uplink_kernels.h"
+
+namespace GpuUplinkKernels {
+
+static constexpr unsigned kThreadsPerBlock = 256;
+// Loading of the Gram diagonal, relative to its mean
+static constexpr float kGramLoading = 1e-6f;
+
+static inline unsigned NumBlocks(size_t num_threads) {
+  return static_cast<unsigned>((num_threads + kThreadsPerBlock - 1) /
+                               kThreadsPerBlock);
+}
+
+// TileLayout::Index on the GPU
+__device__ static inline size_t TileIndex(const Dims& dims, size_t sc,
+                                          size_t ant) {
+  if (dims.tile_scs_ == 0) {
+    return (ant * dims.ofdm_data_num_) + sc;
+  }
+  return ((sc / dims.tile_scs_) * dims.tile_scs_ * dims.bs_ant_num_) +
+         (ant * dims.tile_scs_) + (sc % dims.tile_scs_);
+}
+
+__global__ static void GatherCsiKernel(Dims dims, const cuFloatComplex* csi,
+                                       cuFloatComplex* h,
+                                       cuFloatComplex* beam) {
+  const size_t idx = (blockIdx.x * blockDim.x) + threadIdx.x;
+  const size_t mat_size = dims.bs_ant_num_ * dims.num_streams_;
+  if (idx >= mat_size * dims.ofdm_data_num_) {
+    return;
+  }
+  const size_t sc = idx / mat_size;
+  const size_t stream = (idx % mat_size) / dims.bs_ant_num_;
+  const size_t ant = idx % dims.bs_ant_num_;
+  const cuFloatComplex v =
+      csi[(stream * dims.bs_ant_num_ * dims.ofdm_data_num_) +
+          TileIndex(dims, sc, ant)];
+  h[(sc * mat_size) + (stream * dims.bs_ant_num_) + ant] = v;
+  beam[(sc * mat_size) + (ant * dims.num_streams_) + stream] = cuConjf(v);
+}
+
+__global__ static void LoadDiagonalKernel(Dims dims, cuFloatComplex* gram,
+                                          float noise) {
+  const size_t sc = (blockIdx.x * blockDim.x) + threadIdx.x;
+  if (sc >= dims.ofdm_data_num_) {
+    return;
+  }
+  const size_t n = dims.num_streams_;
+  cuFloatComplex* mat = gram + (sc * n * n);
+  float trace = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    trace += cuCrealf(mat[(i * n) + i]);
+  }
+  const float load = noise + (kGramLoading * trace / static_cast<float>(n));
+  for (size_t i = 0; i < n; i++) {
+    mat[(i * n) + i].x += load;
+  }
+}
+
+__global__ static void GatherDataKernel(Dims dims, const cuFloatComplex* data,
+                                        cuFloatComplex* y) {
+  const size_t idx = (blockIdx.x * blockDim.x) + threadIdx.x;
+  if (idx >= dims.bs_ant_num_ * dims.ofdm_data_num_) {
+    return;
+  }
+  const size_t sc = idx / dims.bs_ant_num_;
+  const size_t ant = idx % dims.bs_ant_num_;
+  y[idx] = data[TileIndex(dims, sc, ant)];
+}
+
+// One block per stream
+__global__ static void PilotCorrKernel(Dims dims, const cuFloatComplex* equal,
+                                       const cuFloatComplex* pilots,
+                                       UeList ue_list, cuFloatComplex* corr) {
+  __shared__ cuFloatComplex partial[kThreadsPerBlock];
+  const size_t stream = blockIdx.x;
+  const cuFloatComplex* pilot =
+      pilots + (ue_list.ue_[stream] * dims.ofdm_data_num_);
+  cuFloatComplex sum = make_cuFloatComplex(0.0f, 0.0f);
+  for (size_t sc = threadIdx.x; sc < dims.ofdm_data_num_; sc += blockDim.x) {
+    sum = cuCaddf(sum, cuCmulf(equal[(sc * dims.num_streams_) + stream],
+                               cuConjf(pilot[sc])));
+  }
+  partial[threadIdx.x] = sum;
+  __syncthreads();
+  for (unsigned half = blockDim.x / 2; half > 0; half /= 2) {
+    if (threadIdx.x < half) {
+      partial[threadIdx.x] =
+          cuCaddf(partial[threadIdx.x], partial[threadIdx.x + half]);
+    }
+    __syncthreads();
+  }
+  if (threadIdx.x == 0) {
+    corr[stream] = partial[0];
+  }
+}
+
+__global__ static void DerotateKernel(Dims dims, cuFloatComplex* equal,
+                                      const cuFloatComplex* corr,
+                                      size_t num_pilots,
+                                      size_t symbol_idx_ul) {
+  const size_t idx = (blockIdx.x * blockDim.x) + threadIdx.x;
+  if (idx >= dims.num_streams_ * dims.ofdm_data_num_) {
+    return;
+  }
+  // The same phase correction as DoDemul::UpdatePhaseCorrection
+  const size_t stream = idx % dims.num_streams_;
+  const cuFloatComplex first = corr[stream];
+  const cuFloatComplex last =
+      corr[((num_pilots - 1) * dims.num_streams_) + stream];
+  const float theta_first = atan2f(cuCimagf(first), cuCrealf(first));
+  const float theta_inc =
+      (atan2f(cuCimagf(last), cuCrealf(last)) - theta_first) /
+      static_cast<float>(num_pilots > 1 ? num_pilots - 1 : 1);
+  const float cur_theta = theta_first + (symbol_idx_ul * theta_inc);
+  float sin_theta;
+  float cos_theta;
+  sincosf(-cur_theta, &sin_theta, &cos_theta);
+  equal[idx] = cuCmulf(equal[idx], make_cuFloatComplex(cos_theta, sin_theta));
+}
+
+__device__ static inline int SaturateInt8(int v) {
+  return min(max(v, -128), 127);
+}
+
+// One thread per subcarrier and stream, with the LLR definitions and
+// rounding of the CPU kernels
+__global__ static void DemodSoftKernel(Dims dims, const cuFloatComplex* equal,
+                                       DemodParams params, int8_t* llr,
+                                       size_t llr_stride) {
+  const size_t idx = (blockIdx.x * blockDim.x) + threadIdx.x;
+  if (idx >= dims.num_streams_ * dims.ofdm_data_num_) {
+    return;
+  }
+  const size_t sc = idx / dims.num_streams_;
+  const size_t stream = idx % dims.num_streams_;
+  const cuFloatComplex symbol = equal[idx];
+  int8_t* out =
+      llr + (stream * llr_stride) + (sc * params.mod_order_bits_);
+
+  if (params.mod_order_bits_ == 2) {
+    // Truncated, as the SSE kernel
+    out[0] = static_cast<int8_t>(static_cast<int>(
+        fminf(fmaxf(cuCrealf(symbol) * params.scale_, -128.0f), 127.0f)));
+    out[1] = static_cast<int8_t>(static_cast<int>(
+        fminf(fmaxf(cuCimagf(symbol) * params.scale_, -128.0f), 127.0f)));
+    return;
+  }
+  // Each level is (offset - |previous level|)
+  int level_re =
+      SaturateInt8(__float2int_rn(cuCrealf(symbol) * params.scale_));
+  int level_im =
+      SaturateInt8(__float2int_rn(cuCimagf(symbol) * params.scale_));
+  out[0] = static_cast<int8_t>(level_re);
+  out[1] = static_cast<int8_t>(level_im);
+  for (size_t k = 1; k < params.mod_order_bits_ / 2; k++) {
+    level_re = params.offset_[k - 1] - abs(level_re);
+    level_im = params.offset_[k - 1] - abs(level_im);
+    out[2 * k] = static_cast<int8_t>(level_re);
+    out[(2 * k) + 1] = static_cast<int8_t>(level_im);
+  }
+}
+
+void GatherCsi(const Dims& dims, const cuFloatComplex* csi, cuFloatComplex* h,
+               cuFloatComplex* beam, cudaStream_t stream) {
+  const size_t num_threads =
+      dims.bs_ant_num_ * dims.num_streams_ * dims.ofdm_data_num_;
+  GatherCsiKernel<<<NumBlocks(num_threads), kThreadsPerBlock, 0, stream>>>(
+      dims, csi, h, beam);
+}
+
+void LoadDiagonal(const Dims& dims, cuFloatComplex* gram, float noise,
+                  cudaStream_t stream) {
+  LoadDiagonalKernel<<<NumBlocks(dims.ofdm_data_num_), kThreadsPerBlock, 0,
+                       stream>>>(dims, gram, noise);
+}
+
+void GatherData(const Dims& dims, const cuFloatComplex* data,
+                cuFloatComplex* y, cudaStream_t stream) {
+  const size_t num_threads = dims.bs_ant_num_ * dims.ofdm_data_num_;
+  GatherDataKernel<<<NumBlocks(num_threads), kThreadsPerBlock, 0, stream>>>(
+      dims, data, y);
+}
+
+void PilotCorr(const Dims& dims, const cuFloatComplex* equal,
+               const cuFloatComplex* pilots, UeList ue_list,
+               cuFloatComplex* corr, cudaStream_t stream) {
+  PilotCorrKernel<<<static_cast<unsigned>(dims.num_streams_),
+                    kThreadsPerBlock, 0, stream>>>(dims, equal, pilots,
+                                                   ue_list, corr);
+}
+
+void Derotate(const Dims& dims, cuFloatComplex* equal,
+              const cuFloatComplex* corr, size_t num_pilots,
+              size_t symbol_idx_ul, cudaStream_t stream) {
+  const size_t num_threads = dims.num_streams_ * dims.ofdm_data_num_;
+  DerotateKernel<<<NumBlocks(num_threads), kThreadsPerBlock, 0, stream>>>(
+      dims, equal, corr, num_pilots, symbol_idx_ul);
+}
+
+void DemodSoft(const Dims& dims, const cuFloatComplex* equal,
+               const DemodParams& params, int8_t* llr, size_t llr_stride,
+               cudaStream_t stream) {
+  const size_t num_threads = dims.num_streams_ * dims.ofdm_data_num_;
+  DemodSoftKernel<<<NumBlocks(num_threads), kThreadsPerBlock, 0, stream>>>(
+      dims, equal, params, llr, llr_stride);
+}
+
+}  // namespace GpuUplinkKernels
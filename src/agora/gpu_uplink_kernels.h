@@ -0,0 +1,85 @@
+/**
+ * @file gpu_uplink_kernels.h
+ * @brief The CUDA kernels of GpuUplink that cuBLAS and cuSOLVER do not
+ * cover: the gathers out of the tile layout of dofft, the diagonal loading
+ * of the Gram matrices, the phase tracking and the soft demodulation. Plain
+ * host functions that launch them on a stream, so that only
+ * gpu_uplink_kernels.cu is compiled by nvcc.
+ */
+#ifndef GPU_UPLINK_KERNELS_H_
+#define GPU_UPLINK_KERNELS_H_
+
+#include <cuComplex.h>
+#include <cuda_runtime.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GpuUplinkKernels {
+
+/// Largest number of spatial streams, the same as kMaxUEs
+static constexpr size_t kMaxStreams = 64;
+
+/// The scheduled UE of each spatial stream, passed by value to the kernels
+struct UeList {
+  uint16_t ue_[kMaxStreams];
+};
+
+struct Dims {
+  size_t bs_ant_num_;
+  size_t num_streams_;
+  size_t ofdm_data_num_;
+  /// Subcarriers per tile of TileLayout, 0 if each antenna is a plane of all
+  /// its subcarriers
+  size_t tile_scs_;
+};
+
+/// The LLR scaling of the CPU soft demodulators (modulation.cc)
+struct DemodParams {
+  size_t mod_order_bits_;
+  float scale_;
+  /// Offset of each level after the first, 16QAM and up
+  int offset_[3];
+};
+
+/// Gather the CSI of the streams, one TileLayout buffer of each at
+/// csi + stream * bs_ant_num * ofdm_data_num, into the (BsAnt x Streams)
+/// column-major matrix h of each subcarrier, and its conjugate transpose into
+/// beam
+void GatherCsi(const Dims& dims, const cuFloatComplex* csi, cuFloatComplex* h,
+               cuFloatComplex* beam, cudaStream_t stream);
+
+/// Add noise, plus a small loading relative to the mean of the diagonal that
+/// keeps the Cholesky factorization of ill-conditioned channels defined, to
+/// the diagonal of the (Streams x Streams) Gram matrix of each subcarrier
+void LoadDiagonal(const Dims& dims, cuFloatComplex* gram, float noise,
+                  cudaStream_t stream);
+
+/// Gather the data of one symbol in TileLayout into a BsAnt vector per
+/// subcarrier
+void GatherData(const Dims& dims, const cuFloatComplex* data,
+                cuFloatComplex* y, cudaStream_t stream);
+
+/// Correlate the equalized pilot symbol (Streams per subcarrier) with the
+/// pilots of the UE of each stream (UeAntNum x OfdmDataNum) into the sum of
+/// each stream, corr[stream]
+void PilotCorr(const Dims& dims, const cuFloatComplex* equal,
+               const cuFloatComplex* pilots, UeList ue_list,
+               cuFloatComplex* corr, cudaStream_t stream);
+
+/// Derotate the equalized data symbol symbol_idx_ul with the phase drift of
+/// each stream between the first and last of the num_pilots pilot symbols
+/// whose correlations corr holds (pilot symbol after pilot symbol)
+void Derotate(const Dims& dims, cuFloatComplex* equal,
+              const cuFloatComplex* corr, size_t num_pilots,
+              size_t symbol_idx_ul, cudaStream_t stream);
+
+/// Soft-demodulate the equalized symbol into the LLRs of each stream, at
+/// llr + stream * llr_stride
+void DemodSoft(const Dims& dims, const cuFloatComplex* equal,
+               const DemodParams& params, int8_t* llr, size_t llr_stride,
+               cudaStream_t stream);
+
+}  // namespace GpuUplinkKernels
+
+#endif  // GPU_UPLINK_KERNELS_H_
@@ -0,0 +1,141 @@
+/**
+ * @file harq_buffer.cc
+ * @brief Implementation file for the HarqBuffer class.
+ */
+#include "harq_buffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "logger.h"
+#include "utils.h"
+
+// The decoders take symmetric LLRs
+static constexpr int kLlrMax = 127;
+static constexpr int kLlr4Max = 7;
+static constexpr int kLlr4Min = -8;
+
+thread_local std::vector<int8_t> HarqBuffer::stored_llrs_;
+
+HarqBuffer::HarqBuffer(size_t num_ues, size_t num_processes,
+                       size_t cbs_per_frame, size_t llrs_per_cb,
+                       size_t llr_bits, size_t max_tx)
+    : num_processes_(num_processes),
+      cbs_per_frame_(cbs_per_frame),
+      llrs_per_cb_(llrs_per_cb),
+      llr_bits_(llr_bits),
+      max_tx_(max_tx),
+      bytes_per_cb_((llr_bits == 8) ? llrs_per_cb : (llrs_per_cb + 1) / 2),
+      entries_(num_ues * num_processes * cbs_per_frame),
+      soft_bits_(entries_.size() * bytes_per_cb_) {
+  RtAssert((llr_bits == 8) || (llr_bits == 4),
+           "HarqBuffer: LLRs are stored with 8 or 4 bits");
+  RtAssert(max_tx > 0, "HarqBuffer: max_tx must be at least 1");
+}
+
+size_t HarqBuffer::EntryIndex(size_t ue_id, size_t frame_id,
+                              size_t cb_index) const {
+  const size_t process = frame_id % num_processes_;
+  return (((ue_id * num_processes_) + process) * cbs_per_frame_) + cb_index;
+}
+
+size_t HarqBuffer::Combine(size_t ue_id, size_t frame_id, size_t cb_index,
+                           int8_t* llrs) {
+  const size_t index = EntryIndex(ue_id, frame_id, cb_index);
+  Entry& entry = entries_.at(index);
+  // Only a failed code block of the previous frame of the process is resent
+  if ((entry.pending_ == false) ||
+      ((entry.frame_id_ + num_processes_) != frame_id)) {
+    entry.pending_ = false;
+    entry.frame_id_ = frame_id;
+    entry.num_tx_ = 1;
+    return entry.num_tx_;
+  }
+
+  stored_llrs_.resize(llrs_per_cb_);
+  Load(index, stored_llrs_.data());
+  for (size_t i = 0; i < llrs_per_cb_; i++) {
+    const int sum = static_cast<int>(llrs[i]) + stored_llrs_[i];
+    llrs[i] = static_cast<int8_t>(std::clamp(sum, -kLlrMax, kLlrMax));
+  }
+  entry.frame_id_ = frame_id;
+  entry.num_tx_++;
+  combined_cbs_++;
+  return entry.num_tx_;
+}
+
+void HarqBuffer::Update(size_t ue_id, size_t frame_id, size_t cb_index,
+                        const int8_t* llrs, bool decoded) {
+  const size_t index = EntryIndex(ue_id, frame_id, cb_index);
+  Entry& entry = entries_.at(index);
+  if (decoded) {
+    if (entry.num_tx_ > 1) {
+      recovered_cbs_++;
+    }
+    entry.pending_ = false;
+  } else if (entry.num_tx_ >= max_tx_) {
+    dropped_cbs_++;
+    entry.pending_ = false;
+  } else {
+    Store(index, llrs);
+    entry.frame_id_ = frame_id;
+    entry.pending_ = true;
+  }
+}
+
+void HarqBuffer::Store(size_t index, const int8_t* llrs) {
+  uint8_t* out = &soft_bits_.at(index * bytes_per_cb_);
+  if (llr_bits_ == 8) {
+    std::memcpy(out, llrs, llrs_per_cb_);
+    return;
+  }
+
+  // Smallest shift that fits the largest LLR of the code block in 4 bits
+  int max_abs = 0;
+  for (size_t i = 0; i < llrs_per_cb_; i++) {
+    max_abs = std::max(max_abs, std::abs(static_cast<int>(llrs[i])));
+  }
+  uint8_t shift = 0;
+  while ((max_abs >> shift) > kLlr4Max) {
+    shift++;
+  }
+  entries_.at(index).shift_ = shift;
+  const int round = (shift > 0) ? (1 << (shift - 1)) : 0;
+  for (size_t i = 0; i < llrs_per_cb_; i++) {
+    const int scaled = (static_cast<int>(llrs[i]) + round) >> shift;
+    const int quantized = std::clamp(scaled, kLlr4Min, kLlr4Max);
+    const auto nibble = static_cast<uint8_t>(quantized & 0xF);
+    if ((i % 2) == 0) {
+      out[i / 2] = nibble;
+    } else {
+      out[i / 2] |= static_cast<uint8_t>(nibble << 4);
+    }
+  }
+}
+
+void HarqBuffer::Load(size_t index, int8_t* llrs) const {
+  const uint8_t* in = &soft_bits_.at(index * bytes_per_cb_);
+  if (llr_bits_ == 8) {
+    std::memcpy(llrs, in, llrs_per_cb_);
+    return;
+  }
+
+  const uint8_t shift = entries_.at(index).shift_;
+  for (size_t i = 0; i < llrs_per_cb_; i++) {
+    const uint8_t nibble =
+        ((i % 2) == 0) ? (in[i / 2] & 0xF) : (in[i / 2] >> 4);
+    // Sign extend the 4-bit value
+    const int quantized = static_cast<int8_t>(nibble << 4) >> 4;
+    llrs[i] = static_cast<int8_t>(
+        std::clamp(quantized * (1 << shift), -kLlrMax, kLlrMax));
+  }
+}
+
+void HarqBuffer::PrintSummary() const {
+  AGORA_LOG_INFO(
+      "HarqBuffer: %zu code blocks retransmitted, %zu recovered, %zu dropped "
+      "after %zu transmissions (%zu-bit soft buffers, %.3f MB)\n",
+      CombinedCbs(), RecoveredCbs(), DroppedCbs(), max_tx_, llr_bits_,
+      SizeBytes() / (1024.0 * 1024.0));
+}
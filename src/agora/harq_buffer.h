@@ -0,0 +1,80 @@
+/**
+ * @file harq_buffer.h
+ * @brief Declaration file for the HarqBuffer class, the uplink HARQ soft
+ * buffers of the basestation.
+ */
+#ifndef HARQ_BUFFER_H_
+#define HARQ_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Soft buffers of the uplink code blocks whose decode failed, one per UE,
+/// HARQ process and code block of a frame. The process of a frame is
+/// frame_id % num_processes, so a failed code block is retransmitted in the
+/// frame num_processes later. Retransmissions are chase combined with the
+/// stored LLRs before the decode. The LLRs are stored with llr_bits of 8 or
+/// 4 bits, the latter with a scale per code block.
+///
+/// Combine() and Update() of a code block must not run concurrently with
+/// those of the same code block in another frame, which holds when
+/// num_processes is at least the frame window.
+class HarqBuffer {
+ public:
+  HarqBuffer(size_t num_ues, size_t num_processes, size_t cbs_per_frame,
+             size_t llrs_per_cb, size_t llr_bits, size_t max_tx);
+
+  /// Combine the llrs of a code block in place with the soft bits of the
+  /// earlier failed transmissions of its process. Returns the transmission
+  /// number of the code block, 1 for new data.
+  size_t Combine(size_t ue_id, size_t frame_id, size_t cb_index,
+                 int8_t* llrs);
+
+  /// Record the decode result of the (combined) llrs of a code block. A
+  /// failed code block keeps its soft bits for the next transmission unless
+  /// it reached max_tx transmissions.
+  void Update(size_t ue_id, size_t frame_id, size_t cb_index,
+              const int8_t* llrs, bool decoded);
+
+  inline size_t SizeBytes() const { return soft_bits_.size(); }
+  /// Code blocks decoded after a retransmission
+  inline size_t RecoveredCbs() const { return recovered_cbs_.load(); }
+  /// Code blocks given up on after max_tx transmissions
+  inline size_t DroppedCbs() const { return dropped_cbs_.load(); }
+  /// Retransmitted code blocks, combined or not
+  inline size_t CombinedCbs() const { return combined_cbs_.load(); }
+
+  void PrintSummary() const;
+
+ private:
+  struct Entry {
+    size_t frame_id_ = 0;
+    size_t num_tx_ = 0;
+    // Right shift of the 4-bit LLRs
+    uint8_t shift_ = 0;
+    bool pending_ = false;
+  };
+
+  size_t EntryIndex(size_t ue_id, size_t frame_id, size_t cb_index) const;
+  void Store(size_t index, const int8_t* llrs);
+  void Load(size_t index, int8_t* llrs) const;
+
+  const size_t num_processes_;
+  const size_t cbs_per_frame_;
+  const size_t llrs_per_cb_;
+  const size_t llr_bits_;
+  const size_t max_tx_;
+  const size_t bytes_per_cb_;
+  std::vector<Entry> entries_;
+  std::vector<uint8_t> soft_bits_;
+  // Scratch of the stored LLRs, one code block per thread
+  static thread_local std::vector<int8_t> stored_llrs_;
+
+  std::atomic<size_t> combined_cbs_{0};
+  std::atomic<size_t> recovered_cbs_{0};
+  std::atomic<size_t> dropped_cbs_{0};
+};
+
+#endif  // HARQ_BUFFER_H_
@@ -0,0 +1,109 @@
+/**
+ * @file int16_equalizer.cc
+ * @brief Implementation file for the reduced-precision uplink equalizer.
+ */
+#include "int16_equalizer.h"
+
+#include <immintrin.h>
+
+#include <cmath>
+#include <cstring>
+
+namespace Int16Equalizer {
+
+#if defined(__AVX512VNNI__)
+// Complex entries per 512-bit register of interleaved int16 values
+static constexpr size_t kEntriesPerSimd = 16;
+#endif
+
+static inline int16_t ToInt16(float value) {
+  return static_cast<int16_t>(std::lrint(value));
+}
+
+float QuantizeBeam(const float* beam, size_t num_streams, size_t num_ants,
+                   int16_t* out) {
+  float max_norm_sq = 0;
+  for (size_t ss = 0; ss < num_streams; ss++) {
+    float norm_sq = 0;
+    for (size_t ant = 0; ant < num_ants; ant++) {
+      const float* w = &beam[kValuesPerEntry * ((ant * num_streams) + ss)];
+      norm_sq += (w[0] * w[0]) + (w[1] * w[1]);
+    }
+    max_norm_sq = std::fmax(max_norm_sq, norm_sq);
+  }
+  if (max_norm_sq == 0) {
+    std::memset(out, 0,
+                kValuesPerEntry * num_streams * num_ants * sizeof(int16_t));
+    return 0;
+  }
+
+  const float scale = kNormLimit / std::sqrt(max_norm_sq);
+  for (size_t ss = 0; ss < num_streams; ss++) {
+    for (size_t ant = 0; ant < num_ants; ant++) {
+      const float* w = &beam[kValuesPerEntry * ((ant * num_streams) + ss)];
+      int16_t* q = &out[kValuesPerEntry * ((ss * num_ants) + ant)];
+      q[0] = ToInt16(w[0] * scale);
+      q[1] = ToInt16(w[1] * scale);
+    }
+  }
+  return scale;
+}
+
+void Equalize(const int16_t* beam, float beam_scale, const float* data,
+              size_t num_streams, size_t num_ants, int16_t* scratch,
+              float* equal) {
+  float norm_sq = 0;
+  for (size_t ant = 0; ant < num_ants; ant++) {
+    norm_sq += (data[2 * ant] * data[2 * ant]) +
+               (data[2 * ant + 1] * data[2 * ant + 1]);
+  }
+  if ((norm_sq == 0) || (beam_scale == 0)) {
+    std::memset(equal, 0, kValuesPerEntry * num_streams * sizeof(float));
+    return;
+  }
+
+  // Re(w * d) = (w_re, w_im) . (d_re, -d_im) and
+  // Im(w * d) = (w_re, w_im) . (d_im, d_re), one int16 pair per antenna
+  const float data_scale = kNormLimit / std::sqrt(norm_sq);
+  int16_t* data_re = scratch;
+  int16_t* data_im = scratch + (kValuesPerEntry * num_ants);
+  for (size_t ant = 0; ant < num_ants; ant++) {
+    const int16_t d_re = ToInt16(data[2 * ant] * data_scale);
+    const int16_t d_im = ToInt16(data[2 * ant + 1] * data_scale);
+    data_re[2 * ant] = d_re;
+    data_re[2 * ant + 1] = static_cast<int16_t>(-d_im);
+    data_im[2 * ant] = d_im;
+    data_im[2 * ant + 1] = d_re;
+  }
+
+  const float inv_scale = 1.0f / (beam_scale * data_scale);
+  for (size_t ss = 0; ss < num_streams; ss++) {
+    const int16_t* row = &beam[kValuesPerEntry * ss * num_ants];
+    int32_t sum_re = 0;
+    int32_t sum_im = 0;
+    size_t ant = 0;
+#if defined(__AVX512VNNI__)
+    __m512i acc_re = _mm512_setzero_si512();
+    __m512i acc_im = _mm512_setzero_si512();
+    for (; ant + kEntriesPerSimd <= num_ants; ant += kEntriesPerSimd) {
+      const __m512i w = _mm512_loadu_si512(&row[2 * ant]);
+      acc_re = _mm512_dpwssd_epi32(acc_re, w,
+                                   _mm512_loadu_si512(&data_re[2 * ant]));
+      acc_im = _mm512_dpwssd_epi32(acc_im, w,
+                                   _mm512_loadu_si512(&data_im[2 * ant]));
+    }
+    sum_re = _mm512_reduce_add_epi32(acc_re);
+    sum_im = _mm512_reduce_add_epi32(acc_im);
+#endif
+    for (; ant < num_ants; ant++) {
+      sum_re += (row[2 * ant] * data_re[2 * ant]) +
+                (row[2 * ant + 1] * data_re[2 * ant + 1]);
+      sum_im += (row[2 * ant] * data_im[2 * ant]) +
+                (row[2 * ant + 1] * data_im[2 * ant + 1]);
+    }
+    equal[2 * ss] = static_cast<float>(sum_re) * inv_scale;
+    equal[2 * ss + 1] = static_cast<float>(sum_im) * inv_scale;
+  }
+}
+
+}  // namespace Int16Equalizer
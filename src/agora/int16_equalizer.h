@@ -0,0 +1,46 @@
+/**
+ * @file int16_equalizer.h
+ * @brief Declaration file for the reduced-precision uplink equalizer, which
+ * keeps the beamweights as int16 and equalizes with int16 dot products
+ * accumulated in int32 (AVX-512 VNNI VPDPWSSD where available).
+ */
+#ifndef INT16_EQUALIZER_H_
+#define INT16_EQUALIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Int16Equalizer {
+
+/// Largest L2 norm of a quantized beam row or data vector. A dot product of
+/// two vectors is bounded by the product of their norms, so no partial sum
+/// overflows int32.
+static constexpr float kNormLimit = 32000.0f;
+
+/// int16 values of one quantized beam matrix (or data vector) entry
+static constexpr size_t kValuesPerEntry = 2;
+
+/// int16 values of the scratch that Equalize() needs for num_ants
+/// antennas
+inline size_t ScratchSize(size_t num_ants) {
+  return 2 * kValuesPerEntry * num_ants;
+}
+
+/// Quantize a num_streams x num_ants complex beam matrix, interleaved and
+/// column-major as the float beam matrices, to a row-major interleaved int16
+/// matrix in out. Returns the scale the beamweights were multiplied with, 0
+/// if the matrix is zero.
+float QuantizeBeam(const float* beam, size_t num_streams, size_t num_ants,
+                   int16_t* out);
+
+/// Equalize the num_ants complex data samples (interleaved) of one
+/// subcarrier with a beam matrix of QuantizeBeam(), writing num_streams
+/// interleaved complex samples to equal. scratch holds ScratchSize(num_ants)
+/// int16 values.
+void Equalize(const int16_t* beam, float beam_scale, const float* data,
+              size_t num_streams, size_t num_ants, int16_t* scratch,
+              float* equal);
+
+}  // namespace Int16Equalizer
+
+#endif  // INT16_EQUALIZER_H_
@@ -0,0 +1,64 @@
+/**
+ * @file latency_histogram.cc
+ * @brief Implementation file for the LatencyHistogram class
+ */
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::Reset() {
+  counts_.fill(0);
+  count_ = 0;
+  max_ns_ = 0;
+}
+
+size_t LatencyHistogram::BucketIndex(size_t ns) {
+  if (ns < (1ul << kLinearBits)) {
+    return ns;
+  }
+  const size_t msb =
+      std::min(static_cast<size_t>(63 - __builtin_clzl(ns)), kMaxBits - 1);
+  const size_t shift = msb - kSubBucketBits;
+  const size_t sub_bucket =
+      std::min(ns >> shift, (2ul << kSubBucketBits) - 1) -
+      (1ul << kSubBucketBits);
+  return (1ul << kLinearBits) +
+         (msb - kLinearBits) * (1ul << kSubBucketBits) + sub_bucket;
+}
+
+size_t LatencyHistogram::BucketUpperNs(size_t index) {
+  if (index < (1ul << kLinearBits)) {
+    return index;
+  }
+  const size_t log_index = index - (1ul << kLinearBits);
+  const size_t msb = kLinearBits + (log_index >> kSubBucketBits);
+  const size_t sub_bucket = log_index & ((1ul << kSubBucketBits) - 1);
+  const size_t shift = msb - kSubBucketBits;
+  return ((((1ul << kSubBucketBits) + sub_bucket + 1) << shift) - 1);
+}
+
+void LatencyHistogram::Record(double us) {
+  const size_t ns = (us > 0.0) ? static_cast<size_t>(us * 1e3) : 0;
+  counts_.at(BucketIndex(ns))++;
+  count_++;
+  max_ns_ = std::max(max_ns_, ns);
+}
+
+double LatencyHistogram::PercentileUs(double percentile) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  // Rank of the sample at the percentile, starting from 1
+  const auto rank = std::max(
+      static_cast<size_t>(std::ceil(percentile / 100.0 * count_)), 1ul);
+  size_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    seen += counts_.at(i);
+    if (seen >= rank) {
+      // The maximum is exact, and tighter than the last bucket's bound
+      return static_cast<double>(std::min(BucketUpperNs(i), max_ns_)) / 1e3;
+    }
+  }
+  return MaxUs();
+}
@@ -0,0 +1,49 @@
+/**
+ * @file latency_histogram.h
+ * @brief Declaration file for the LatencyHistogram class, a fixed-size
+ * log-linear histogram of latencies for tail percentiles at runtime.
+ */
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <cstddef>
+
+/// Histogram of latencies with a relative error below 1/32 for any value up
+/// to about 18 minutes. Recording is O(1) and percentiles are O(buckets), so
+/// it can be updated and read once per frame by the master thread.
+class LatencyHistogram {
+ public:
+  LatencyHistogram() { Reset(); }
+
+  void Reset();
+
+  /// Add one latency sample, in microseconds. Negative samples count as 0.
+  void Record(double us);
+
+  /// Latency that percentile % of the samples do not exceed, in
+  /// microseconds (upper bound of its bucket). 0 if there are no samples.
+  double PercentileUs(double percentile) const;
+
+  inline size_t Count() const { return count_; }
+  inline double MaxUs() const { return static_cast<double>(max_ns_) / 1e3; }
+
+ private:
+  // Values below 2^kLinearBits ns have their own bucket. Above, each power of
+  // two is split in 2^kSubBucketBits buckets.
+  static constexpr size_t kLinearBits = 6;
+  static constexpr size_t kSubBucketBits = 5;
+  static constexpr size_t kMaxBits = 40;
+  static constexpr size_t kNumBuckets =
+      (1ul << kLinearBits) +
+      (kMaxBits - kLinearBits) * (1ul << kSubBucketBits);
+
+  static size_t BucketIndex(size_t ns);
+  static size_t BucketUpperNs(size_t index);
+
+  std::array<size_t, kNumBuckets> counts_;
+  size_t count_;
+  size_t max_ns_;
+};
+
+#endif  // LATENCY_HISTOGRAM_H_
@@ -2,16 +2,22 @@
  * @file main.cc
  * @brief Main file for the agora server
  */
+#include <sstream>
+
 #include "agora.h"
 #include "gflags/gflags.h"
 #include "logger.h"
+#include "multi_cell_agora.h"
+#include "resctrl.h"
 #include "signal_handler.h"
 #include "version_config.h"
 
 DEFINE_string(
     conf_file,
     TOSTRING(PROJECT_DIRECTORY) "/files/config/ci/tddconfig-sim-both.json",
-    "Config filename");
+    "Config filename, or a comma-separated list of the config files of "
+    "several cells sharing one pool of worker threads, or each running on its "
+    "own core if they all use the single_core execution model");
 
 int main(int argc, char* argv[]) {
   gflags::SetUsageMessage("conf_file : set the configuration filename");
@@ -30,8 +36,19 @@ int main(int argc, char* argv[]) {
     conf_file = FLAGS_conf_file;
   }
 
-  std::unique_ptr<Config> cfg = std::make_unique<Config>(conf_file.c_str());
-  cfg->GenData();
+  std::vector<std::unique_ptr<Config>> cfgs;
+  std::stringstream conf_files(conf_file);
+  std::string cell_conf_file;
+  while (std::getline(conf_files, cell_conf_file, ',')) {
+    cfgs.push_back(std::make_unique<Config>(cell_conf_file.c_str()));
+    cfgs.back()->GenData();
+  }
+
+  // The cache and memory bandwidth of the thread classes, before any thread
+  // is pinned. The cells share the threads, so the first config sets them.
+  if (cfgs.at(0)->ResctrlClasses().empty() == false) {
+    Resctrl::Setup(cfgs.at(0)->ResctrlClasses());
+  }
 
   int ret;
   try {
@@ -39,8 +56,18 @@ int main(int argc, char* argv[]) {
 
     // Register signal handler to handle kill signal
     signal_handler.SetupSignalHandlers();
-    std::unique_ptr<Agora> agora_cli = std::make_unique<Agora>(cfg.get());
-    agora_cli->Start();
+    if (cfgs.size() == 1) {
+      std::unique_ptr<Agora> agora_cli =
+          std::make_unique<Agora>(cfgs.at(0).get());
+      agora_cli->Start();
+    } else {
+      std::vector<Config*> cell_cfgs;
+      for (auto& cfg : cfgs) {
+        cell_cfgs.push_back(cfg.get());
+      }
+      auto cells = std::make_unique<MultiCellAgora>(cell_cfgs);
+      cells->Start();
+    }
     ret = EXIT_SUCCESS;
   } catch (SignalException& e) {
     std::cerr << "SignalException: " << e.what() << std::endl;
@@ -48,6 +75,8 @@ int main(int argc, char* argv[]) {
   }
 
   PrintCoreAssignmentSummary();
+  Resctrl::PrintOccupancy();
+  Resctrl::Teardown();
   gflags::ShutDownCommandLineFlags();
   AGORA_LOG_SHUTDOWN();
 
@@ -0,0 +1,91 @@
+/**
+ * @file mkl_dft_cache.cc
+ * @brief Implementation file for the MKL DFTI descriptor cache.
+ */
+#include "mkl_dft_cache.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "logger.h"
+#include "utils.h"
+
+namespace MklDftCache {
+
+// FFT size, number of transforms, in place
+using Key = std::tuple<size_t, size_t, bool>;
+
+struct Entry {
+  DFTI_DESCRIPTOR_HANDLE handle_;
+  size_t refs_;
+};
+
+// Only touched when doers are created or destroyed, not on the data path
+static std::mutex cache_mutex;
+static std::map<Key, Entry> cache;
+static size_t num_committed = 0;
+
+DFTI_DESCRIPTOR_HANDLE Acquire(size_t fft_size, size_t num_transforms,
+                               bool in_place) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  const Key key(fft_size, num_transforms, in_place);
+  auto cached = cache.find(key);
+  if (cached != cache.end()) {
+    cached->second.refs_++;
+    return cached->second.handle_;
+  }
+
+  DFTI_DESCRIPTOR_HANDLE handle = nullptr;
+  MKL_LONG status = DftiCreateDescriptor(&handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
+                                         static_cast<MKL_LONG>(fft_size));
+  if ((status == DFTI_NO_ERROR) && (num_transforms > 1)) {
+    status = DftiSetValue(handle, DFTI_NUMBER_OF_TRANSFORMS,
+                          static_cast<MKL_LONG>(num_transforms));
+    if (status == DFTI_NO_ERROR) {
+      status = DftiSetValue(handle, DFTI_INPUT_DISTANCE,
+                            static_cast<MKL_LONG>(fft_size));
+    }
+    if (status == DFTI_NO_ERROR) {
+      status = DftiSetValue(handle, DFTI_OUTPUT_DISTANCE,
+                            static_cast<MKL_LONG>(fft_size));
+    }
+  }
+  if ((status == DFTI_NO_ERROR) && (in_place == false)) {
+    status = DftiSetValue(handle, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
+  }
+  if (status == DFTI_NO_ERROR) {
+    status = DftiCommitDescriptor(handle);
+  }
+  if (status != DFTI_NO_ERROR) {
+    AGORA_LOG_ERROR("MklDftCache: %zu x %zu-point descriptor: %s\n",
+                    num_transforms, fft_size, DftiErrorMessage(status));
+  }
+  RtAssert(status == DFTI_NO_ERROR, "MklDftCache: failed to commit descriptor");
+
+  cache.emplace(key, Entry{handle, 1});
+  num_committed++;
+  return handle;
+}
+
+void Release(DFTI_DESCRIPTOR_HANDLE handle) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  for (auto entry = cache.begin(); entry != cache.end(); ++entry) {
+    if (entry->second.handle_ == handle) {
+      entry->second.refs_--;
+      if (entry->second.refs_ == 0) {
+        DftiFreeDescriptor(&entry->second.handle_);
+        cache.erase(entry);
+      }
+      return;
+    }
+  }
+  RtAssert(false, "MklDftCache: released a descriptor not from Acquire");
+}
+
+size_t NumCommitted() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  return num_committed;
+}
+
+}  // namespace MklDftCache
@@ -0,0 +1,32 @@
+/**
+ * @file mkl_dft_cache.h
+ * @brief Declaration file for the process-wide cache of committed MKL DFTI
+ * descriptors. Committing a descriptor plans the transform, which is slow;
+ * the doers of every worker share one descriptor per transform instead.
+ * A committed descriptor may be used by several threads at once.
+ */
+#ifndef MKL_DFT_CACHE_H_
+#define MKL_DFT_CACHE_H_
+
+#include <cstddef>
+
+#include "mkl_dfti.h"
+
+namespace MklDftCache {
+
+/// Returns the committed single precision complex descriptor of
+/// num_transforms fft_size-point transforms, each fft_size entries apart.
+/// Commits it on the first request. Each Acquire must be matched by a
+/// Release.
+DFTI_DESCRIPTOR_HANDLE Acquire(size_t fft_size, size_t num_transforms = 1,
+                               bool in_place = true);
+
+/// Drop one reference to a descriptor from Acquire, freeing it with the last
+void Release(DFTI_DESCRIPTOR_HANDLE handle);
+
+/// Number of descriptors committed since startup
+size_t NumCommitted();
+
+}  // namespace MklDftCache
+
+#endif  // MKL_DFT_CACHE_H_
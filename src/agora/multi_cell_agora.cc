@@ -0,0 +1,125 @@
+/**
+ * @file multi_cell_agora.cc
+ * @brief Implementation file for the MultiCellAgora class.
+ */
+#include "multi_cell_agora.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "logger.h"
+
+// True if every cell runs its tasks on its master thread
+static bool AllSingleCore(const std::vector<Config*>& cfgs) {
+  return std::all_of(cfgs.begin(), cfgs.end(), [](const Config* cfg) {
+    return cfg->GetExecutionModel() == ExecutionModel::kSingleCore;
+  });
+}
+
+MultiCellAgora::MultiCellAgora(const std::vector<Config*>& cfgs)
+    : cfgs_(cfgs),
+      cells_(cfgs.size()),
+      independent_(AllSingleCore(cfgs)),
+      run_future_(run_.get_future()) {
+  RtAssert(cfgs_.empty() == false, "MultiCellAgora: no cells");
+  if (independent_) {
+    AGORA_LOG_INFO("MultiCellAgora: hosting %zu independent cells\n",
+                   cfgs_.size());
+    // The master core and the TX/RX cores of each cell
+    for (size_t i = 0; i < cfgs_.size(); i++) {
+      for (size_t j = i + 1; j < cfgs_.size(); j++) {
+        const Config* a = cfgs_.at(i);
+        const Config* b = cfgs_.at(j);
+        RtAssert(
+            (a->CoreOffset() + 1 + a->SocketThreadNum() <= b->CoreOffset()) ||
+                (b->CoreOffset() + 1 + b->SocketThreadNum() <=
+                 a->CoreOffset()),
+            "MultiCellAgora: independent cells " + std::to_string(i) +
+                " and " + std::to_string(j) + " share cores");
+      }
+    }
+  } else {
+    AGORA_LOG_INFO("MultiCellAgora: hosting %zu cells on %zu shared workers\n",
+                   cfgs_.size(), cfgs_.at(0)->WorkerThreadNum());
+  }
+  // Agora pins the thread creating it to the cell's master core
+  for (size_t i = 0; i < cfgs_.size(); i++) {
+    masters_.emplace_back(&MultiCellAgora::MasterThread, this, i);
+  }
+  while (num_created_.load() < cfgs_.size()) {
+    std::this_thread::yield();
+  }
+  if (independent_) {
+    return;
+  }
+
+  std::vector<AgoraWorker::Cell> worker_cells;
+  for (auto& cell : cells_) {
+    worker_cells.push_back(cell->WorkerCell());
+  }
+  worker_pool_ = std::make_unique<AgoraWorker>(std::move(worker_cells));
+  for (auto& cell : cells_) {
+    cell->SetWorkerPool(worker_pool_.get());
+  }
+}
+
+MultiCellAgora::~MultiCellAgora() {
+  if (started_ == false) {
+    run_.set_value(false);
+  }
+  for (auto& master : masters_) {
+    if (master.joinable()) {
+      master.join();
+    }
+  }
+  // Stops the shared workers before the buffers of the cells go away
+  for (Config* cfg : cfgs_) {
+    cfg->Running(false);
+  }
+  worker_pool_.reset();
+  cells_.clear();
+}
+
+void MultiCellAgora::Start() {
+  started_ = true;
+  const auto start = std::chrono::steady_clock::now();
+  run_.set_value(true);
+  for (auto& master : masters_) {
+    master.join();
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  AGORA_LOG_INFO("MultiCellAgora: all %zu cells finished\n", cfgs_.size());
+  PrintAggregateSummary(elapsed.count());
+}
+
+void MultiCellAgora::PrintAggregateSummary(double elapsed_sec) const {
+  size_t total_frames = 0;
+  double total_bench_fps = 0;
+  for (size_t i = 0; i < cells_.size(); i++) {
+    const size_t frames = cells_.at(i)->FramesDone();
+    const double bench_fps = cells_.at(i)->BenchFramesPerSec();
+    total_frames += frames;
+    total_bench_fps += bench_fps;
+    AGORA_LOG_INFO(
+        "MultiCellAgora:   cell %zu (core %zu): %zu frames, %.1f frames/s, "
+        "%.1f frames/s in bench mode\n",
+        i, cfgs_.at(i)->CoreOffset(), frames, frames / elapsed_sec,
+        bench_fps);
+  }
+  AGORA_LOG_INFO(
+      "MultiCellAgora: %zu cells processed %zu frames in %.2f s: %.1f "
+      "frames/s, %.1f frames/s in bench mode\n",
+      cells_.size(), total_frames, elapsed_sec, total_frames / elapsed_sec,
+      total_bench_fps);
+}
+
+void MultiCellAgora::MasterThread(size_t cell_id) {
+  // An independent cell runs its tasks on its own master thread
+  cells_.at(cell_id) = std::make_unique<Agora>(cfgs_.at(cell_id),
+                                               independent_ /* own_workers */);
+  num_created_++;
+  if (run_future_.get()) {
+    cells_.at(cell_id)->Start();
+  }
+}
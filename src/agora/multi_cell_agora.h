@@ -0,0 +1,68 @@
+/**
+ * @file multi_cell_agora.h
+ * @brief Declaration file for the MultiCellAgora class, which hosts several
+ * cells in one process, on one pool of worker threads or each on its own
+ * core.
+ */
+#ifndef MULTI_CELL_AGORA_H_
+#define MULTI_CELL_AGORA_H_
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "agora.h"
+#include "agora_worker.h"
+#include "config.h"
+
+/**
+ * @brief Several cells, each an Agora with its own configuration, buffers,
+ * counters, master thread, TX/RX threads and MAC, whose tasks run on one
+ * AgoraWorker shared between them.
+ *
+ * The shared workers run on the worker cores of the first cell, and all the
+ * cells must configure the same worker_thread_num and the multi_core
+ * execution model. The cores of the other cells' own workers are unused, so
+ * their core_offset can leave only room for their master, TX/RX and MAC
+ * threads.
+ *
+ * If all the cells use the single_core execution model, each cell is an
+ * independent pipeline instead: its master thread runs its own tasks on its
+ * own core, with its own TX/RX threads, bbdev device (bbdev_dev_id, e.g. a
+ * VF of the card) and DPDK ports, so that the carriers of a host scale with
+ * its cores. The cells must then have disjoint cores.
+ */
+class MultiCellAgora {
+ public:
+  /// Create the cells on their master threads, then the shared workers
+  explicit MultiCellAgora(const std::vector<Config*>& cfgs);
+  ~MultiCellAgora();
+
+  /// Run the cells until all of them finish, then log the frames and the
+  /// frame rate of each cell and of all of them
+  void Start();
+
+ private:
+  /// Master thread of cell_id: create the cell, then run it once Start()
+  /// is called
+  void MasterThread(size_t cell_id);
+  void PrintAggregateSummary(double elapsed_sec) const;
+
+  const std::vector<Config*> cfgs_;
+  std::vector<std::unique_ptr<Agora>> cells_;
+  std::vector<std::thread> masters_;
+  std::unique_ptr<AgoraWorker> worker_pool_;
+  // True if each cell runs its tasks on its master thread
+  const bool independent_;
+
+  // Cells whose Agora is created
+  std::atomic<size_t> num_created_{0};
+  // True to run the cells, false to tear them down without running
+  std::promise<bool> run_;
+  std::shared_future<bool> run_future_;
+  bool started_ = false;
+};
+
+#endif  // MULTI_CELL_AGORA_H_
@@ -0,0 +1,144 @@
+/**
+ * @file recip_calib.cc
+ * @brief Implementation file for the reciprocity calibration kernels.
+ */
+#include "recip_calib.h"
+
+#include <immintrin.h>
+
+#include <cmath>
+
+namespace RecipCalib {
+
+// num * conj(den) / |den|^2, the same expression as the SIMD paths
+static inline complex_float DivideScalar(const complex_float& num,
+                                         const complex_float& den) {
+  const float norm = (den.re * den.re) + (den.im * den.im);
+  return {((num.re * den.re) + (num.im * den.im)) / norm,
+          ((num.im * den.re) - (num.re * den.im)) / norm};
+}
+
+void UpdateMovingSum(const complex_float* prev_msum,
+                     const complex_float* newest, const complex_float* oldest,
+                     complex_float* msum, size_t len) {
+  const auto* prev = reinterpret_cast<const float*>(prev_msum);
+  const auto* add = reinterpret_cast<const float*>(newest);
+  const auto* sub = reinterpret_cast<const float*>(oldest);
+  auto* out = reinterpret_cast<float*>(msum);
+  const size_t num_floats = 2 * len;
+  size_t i = 0;
+#if defined(__AVX512F__)
+  for (; i < num_floats; i += 16) {
+    const __mmask16 mask = (num_floats - i >= 16)
+                               ? static_cast<__mmask16>(0xFFFF)
+                               : static_cast<__mmask16>(
+                                     (1u << (num_floats - i)) - 1);
+    const __m512 delta = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, add + i),
+                                       _mm512_maskz_loadu_ps(mask, sub + i));
+    _mm512_mask_storeu_ps(
+        out + i, mask,
+        _mm512_add_ps(_mm512_maskz_loadu_ps(mask, prev + i), delta));
+  }
+#elif defined(__AVX2__)
+  for (; i + 8 <= num_floats; i += 8) {
+    const __m256 delta =
+        _mm256_sub_ps(_mm256_loadu_ps(add + i), _mm256_loadu_ps(sub + i));
+    _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(prev + i), delta));
+  }
+#endif
+  for (; i < num_floats; i++) {
+    out[i] = prev[i] + (add[i] - sub[i]);
+  }
+}
+
+void Ratio(const complex_float* num, const complex_float* den,
+           complex_float* out, size_t len, size_t out_stride) {
+  size_t i = 0;
+#if defined(__AVX512F__)
+  // Offsets of 8 complex outputs, in units of a complex_float
+  const auto stride = static_cast<long long>(out_stride);
+  const __m512i scatter_index =
+      _mm512_setr_epi64(0, stride, 2 * stride, 3 * stride, 4 * stride,
+                        5 * stride, 6 * stride, 7 * stride);
+  for (; i < len; i += 8) {
+    const __mmask16 mask = (len - i >= 8)
+                               ? static_cast<__mmask16>(0xFFFF)
+                               : static_cast<__mmask16>(
+                                     (1u << (2 * (len - i))) - 1);
+    const __m512 a = _mm512_maskz_loadu_ps(
+        mask, reinterpret_cast<const float*>(num + i));
+    // Masked-off lanes divide 1 by 1 instead of 0 by 0
+    const __m512 b = _mm512_mask_loadu_ps(
+        _mm512_set1_ps(1.0f), mask, reinterpret_cast<const float*>(den + i));
+    // (a.re * b.re + a.im * b.im, a.im * b.re - a.re * b.im)
+    const __m512 cross =
+        _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), _mm512_movehdup_ps(b));
+    const __m512 prod = _mm512_fmsubadd_ps(a, _mm512_moveldup_ps(b), cross);
+    const __m512 b_sq = _mm512_mul_ps(b, b);
+    const __m512 norm = _mm512_add_ps(b_sq, _mm512_permute_ps(b_sq, 0xB1));
+    const __m512 ratio = _mm512_div_ps(prod, norm);
+    if (out_stride == 1) {
+      _mm512_mask_storeu_ps(reinterpret_cast<float*>(out + i), mask, ratio);
+    } else {
+      const auto lanes = static_cast<__mmask8>(
+          (len - i >= 8) ? 0xFF : ((1u << (len - i)) - 1));
+      _mm512_mask_i64scatter_pd(out + (i * out_stride), lanes, scatter_index,
+                                _mm512_castps_pd(ratio), 8);
+    }
+  }
+#elif defined(__AVX2__)
+  for (; i + 4 <= len; i += 4) {
+    const __m256 a = _mm256_loadu_ps(reinterpret_cast<const float*>(num + i));
+    const __m256 b = _mm256_loadu_ps(reinterpret_cast<const float*>(den + i));
+    const __m256 cross =
+        _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(b));
+    // fmsubadd: even (real) lanes add, odd (imaginary) lanes subtract
+    const __m256 prod = _mm256_fmsubadd_ps(a, _mm256_moveldup_ps(b), cross);
+    const __m256 b_sq = _mm256_mul_ps(b, b);
+    const __m256 norm = _mm256_add_ps(b_sq, _mm256_permute_ps(b_sq, 0xB1));
+    const __m256 ratio = _mm256_div_ps(prod, norm);
+    if (out_stride == 1) {
+      _mm256_storeu_ps(reinterpret_cast<float*>(out + i), ratio);
+    } else {
+      alignas(32) complex_float lanes[4];
+      _mm256_store_ps(reinterpret_cast<float*>(lanes), ratio);
+      for (size_t j = 0; j < 4; j++) {
+        out[(i + j) * out_stride] = lanes[j];
+      }
+    }
+  }
+#endif
+  for (; i < len; i++) {
+    out[i * out_stride] = DivideScalar(num[i], den[i]);
+  }
+}
+
+void RegressPhase(const complex_float* in, size_t len_in, size_t x0,
+                  complex_float* out, size_t len_out) {
+  // Least squares line through (x0 + i, arg(in[i])), see
+  // https://www.cse.wustl.edu/~jain/iucee/ftp/k_14slr.pdf. The x are
+  // consecutive integers, so their mean and variance have closed forms.
+  const auto n = static_cast<float>(len_in);
+  const float xbar = static_cast<float>(x0) + ((n - 1.0f) / 2.0f);
+  float sum_y = 0;
+  float sum_dx_y = 0;
+  float sum_mag = 0;
+  for (size_t i = 0; i < len_in; i++) {
+    const float y = std::atan2(in[i].im, in[i].re);
+    sum_y += y;
+    sum_dx_y += (static_cast<float>(i + x0) - xbar) * y;
+    sum_mag += std::sqrt((in[i].re * in[i].re) + (in[i].im * in[i].im));
+  }
+  // sum((x - xbar)^2) of n consecutive integers
+  const float sxx = n * ((n * n) - 1.0f) / 12.0f;
+  const float coeff = (sxx > 0) ? (sum_dx_y / sxx) : 0.0f;
+  const float intercept = (sum_y / n) - (coeff * xbar);
+  const float mag = sum_mag / n;
+
+  for (size_t i = 0; i < len_out; i++) {
+    const float angle = (coeff * static_cast<float>(i)) + intercept;
+    out[i] = {mag * std::cos(angle), mag * std::sin(angle)};
+  }
+}
+
+}  // namespace RecipCalib
@@ -0,0 +1,38 @@
+/**
+ * @file recip_calib.h
+ * @brief Declaration file for the reciprocity calibration kernels, which
+ * update the calibration moving sums, compute the calibration ratios and
+ * regress the calibration phase over runs of subcarriers at once.
+ */
+#ifndef RECIP_CALIB_H_
+#define RECIP_CALIB_H_
+
+#include <cstddef>
+
+#include "common_typedef_sdk.h"
+
+namespace RecipCalib {
+
+/// msum[i] = prev_msum[i] + newest[i] - oldest[i] for i < len. msum may
+/// alias prev_msum.
+void UpdateMovingSum(const complex_float* prev_msum,
+                     const complex_float* newest, const complex_float* oldest,
+                     complex_float* msum, size_t len);
+
+/// out[i * out_stride] = num[i] / den[i] for i < len, so that a run of
+/// subcarriers of one antenna can be written straight into a subcarrier-major
+/// buffer
+void Ratio(const complex_float* num, const complex_float* den,
+           complex_float* out, size_t len, size_t out_stride = 1);
+
+/**
+ * @brief Fit a line to the phase of in (len_in points at x = x0, x0 + 1, ...)
+ * and set out (len_out points at x = 0, 1, ...) to the extrapolated phase
+ * with the mean magnitude of in
+ */
+void RegressPhase(const complex_float* in, size_t len_in, size_t x0,
+                  complex_float* out, size_t len_out);
+
+}  // namespace RecipCalib
+
+#endif  // RECIP_CALIB_H_
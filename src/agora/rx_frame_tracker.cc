@@ -0,0 +1,114 @@
+/**
+ * @file rx_frame_tracker.cc
+ * @brief Implementation file for the RxFrameTracker class.
+ */
+#include "rx_frame_tracker.h"
+
+#include <algorithm>
+
+#include "utils.h"
+
+RxFrameTracker::RxFrameTracker(size_t frame_window,
+                               const std::vector<bool>& fill_symbols,
+                               size_t num_antennas, size_t num_counted_pkts,
+                               size_t timeout_cycles)
+    : frame_window_(frame_window),
+      fill_symbols_(fill_symbols),
+      num_antennas_(num_antennas),
+      num_counted_pkts_(num_counted_pkts),
+      pkts_per_frame_((static_cast<size_t>(std::count(
+                           fill_symbols.begin(), fill_symbols.end(), true)) *
+                       num_antennas) +
+                      num_counted_pkts),
+      timeout_cycles_(timeout_cycles),
+      received_(frame_window * fill_symbols.size() * num_antennas, 0),
+      num_received_(frame_window, 0),
+      num_counted_(frame_window, 0),
+      first_tsc_(frame_window, 0) {
+  RtAssert(pkts_per_frame_ > 0, "RxFrameTracker: no packets per frame");
+}
+
+RxFrameTracker::RxStatus RxFrameTracker::Receive(size_t frame_id,
+                                                 size_t symbol_id,
+                                                 size_t ant_id, size_t tsc) {
+  if (frame_id < open_frame_) {
+    late_packets_++;
+    return RxStatus::kLate;
+  }
+  uint8_t& received = received_.at(PacketIndex(frame_id, symbol_id, ant_id));
+  if (received != 0) {
+    duplicate_packets_++;
+    return RxStatus::kDuplicate;
+  }
+  received = 1;
+
+  const size_t frame_slot = frame_id % frame_window_;
+  if (num_received_.at(frame_slot) == 0) {
+    first_tsc_.at(frame_slot) = tsc;
+  }
+  num_received_.at(frame_slot)++;
+  if (fill_symbols_.at(symbol_id) == false) {
+    num_counted_.at(frame_slot)++;
+  }
+  newest_frame_ = std::max(newest_frame_, frame_id);
+  // A packet of a later frame also starts the timeout of an open frame that
+  // lost all of its packets
+  if (open_started_ == false) {
+    open_started_ = true;
+    open_start_tsc_ = tsc;
+  }
+  while (num_received_.at(open_frame_ % frame_window_) == pkts_per_frame_) {
+    NextOpenFrame(tsc);
+  }
+  return RxStatus::kNew;
+}
+
+size_t RxFrameTracker::CloseOpenFrame(size_t now_tsc,
+                                      std::vector<MissingPacket>& missing) {
+  const size_t frame_slot = open_frame_ % frame_window_;
+  size_t num_missing = 0;
+  for (size_t symbol_id = 0; symbol_id < fill_symbols_.size(); symbol_id++) {
+    if (fill_symbols_.at(symbol_id) == false) {
+      continue;
+    }
+    for (size_t ant_id = 0; ant_id < num_antennas_; ant_id++) {
+      if (received_.at(PacketIndex(open_frame_, symbol_id, ant_id)) == 0) {
+        missing.push_back({symbol_id, ant_id});
+        num_missing++;
+      }
+    }
+  }
+  const size_t num_missing_counted =
+      num_counted_pkts_ -
+      std::min(num_counted_pkts_, num_counted_.at(frame_slot));
+  lost_packets_ += num_missing + num_missing_counted;
+  partial_frames_++;
+
+  NextOpenFrame(now_tsc);
+  while (num_received_.at(open_frame_ % frame_window_) == pkts_per_frame_) {
+    NextOpenFrame(now_tsc);
+  }
+  return num_missing_counted;
+}
+
+void RxFrameTracker::NextOpenFrame(size_t tsc) {
+  const size_t frame_slot = open_frame_ % frame_window_;
+  const auto slot_begin =
+      received_.begin() + (frame_slot * fill_symbols_.size() * num_antennas_);
+  std::fill(slot_begin, slot_begin + (fill_symbols_.size() * num_antennas_),
+            0);
+  num_received_.at(frame_slot) = 0;
+  num_counted_.at(frame_slot) = 0;
+  open_frame_++;
+
+  const size_t next_slot = open_frame_ % frame_window_;
+  if (num_received_.at(next_slot) > 0) {
+    open_started_ = true;
+    open_start_tsc_ = first_tsc_.at(next_slot);
+  } else if (newest_frame_ > open_frame_) {
+    open_started_ = true;
+    open_start_tsc_ = tsc;
+  } else {
+    open_started_ = false;
+  }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file rx_frame_tracker.h
+ * @brief Declaration file for the RxFrameTracker class, which closes the
+ * reception of the frames that lose packets on the fronthaul after a timeout.
+ */
+#ifndef RX_FRAME_TRACKER_H_
+#define RX_FRAME_TRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Tracks the packets received for each frame in the window, by symbol and
+/// antenna. The oldest frame that still misses packets is the open frame.
+/// Once timeout_cycles have passed since its first packet, or since it became
+/// the open frame if it had none while later frames got theirs, it times out
+/// and is closed with the packets it has. The packets that arrive for a
+/// closed frame are late.
+///
+/// Used by the master thread only.
+class RxFrameTracker {
+ public:
+  enum class RxStatus {
+    kNew,       // First copy of a packet of a frame that is not closed
+    kLate,      // Packet of a frame closed without it
+    kDuplicate  // Second copy of a packet
+  };
+
+  /// A packet missing from a closed frame
+  struct MissingPacket {
+    size_t symbol_id_;
+    size_t ant_id_;
+  };
+
+  /// fill_symbols has one entry per symbol of the frame, true for the
+  /// symbols received on every antenna (pilots and uplink data), whose
+  /// missing packets are returned by CloseOpenFrame(). The packets of the
+  /// other received symbols (calibration) are only counted, with
+  /// num_counted_pkts of them per frame.
+  RxFrameTracker(size_t frame_window, const std::vector<bool>& fill_symbols,
+                 size_t num_antennas, size_t num_counted_pkts,
+                 size_t timeout_cycles);
+
+  /// Record a packet received at tsc, for a frame within the frame window of
+  /// the open frame. The packets that are not kNew are to be dropped.
+  RxStatus Receive(size_t frame_id, size_t symbol_id, size_t ant_id,
+                   size_t tsc);
+
+  /// True if the open frame timed out at now_tsc
+  inline bool Expired(size_t now_tsc) const {
+    return open_started_ && (now_tsc - open_start_tsc_ >= timeout_cycles_);
+  }
+
+  /// Close the open frame at now_tsc and move to the next one. The missing
+  /// packets of its fill symbols are appended to missing. Returns the number
+  /// of its missing counted packets.
+  size_t CloseOpenFrame(size_t now_tsc, std::vector<MissingPacket>& missing);
+
+  inline size_t OpenFrame() const { return open_frame_; }
+  /// Packets missing from the closed frames
+  inline size_t LostPackets() const { return lost_packets_; }
+  inline size_t LatePackets() const { return late_packets_; }
+  inline size_t DuplicatePackets() const { return duplicate_packets_; }
+  /// Frames closed with missing packets
+  inline size_t PartialFrames() const { return partial_frames_; }
+
+ private:
+  inline size_t PacketIndex(size_t frame_id, size_t symbol_id,
+                            size_t ant_id) const {
+    return ((((frame_id % frame_window_) * fill_symbols_.size()) +
+             symbol_id) *
+            num_antennas_) +
+           ant_id;
+  }
+  /// Move past the open frame, at tsc
+  void NextOpenFrame(size_t tsc);
+
+  const size_t frame_window_;
+  const std::vector<bool> fill_symbols_;
+  const size_t num_antennas_;
+  const size_t num_counted_pkts_;
+  const size_t pkts_per_frame_;
+  const size_t timeout_cycles_;
+
+  // Per frame slot, symbol and antenna: 1 if the packet was received
+  std::vector<uint8_t> received_;
+  // Per frame slot: the packets received, the counted ones among them and
+  // the arrival of the first one
+  std::vector<size_t> num_received_;
+  std::vector<size_t> num_counted_;
+  std::vector<size_t> first_tsc_;
+
+  size_t open_frame_ = 0;
+  // The timeout of the open frame runs from open_start_tsc_ once started
+  bool open_started_ = false;
+  size_t open_start_tsc_ = 0;
+  // Newest frame with a received packet
+  size_t newest_frame_ = 0;
+
+  size_t lost_packets_ = 0;
+  size_t late_packets_ = 0;
+  size_t duplicate_packets_ = 0;
+  size_t partial_frames_ = 0;
+};
+
+#endif  // RX_FRAME_TRACKER_H_
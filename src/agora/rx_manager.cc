@@ -0,0 +1,237 @@
+/**
+ * @file rx_manager.cc
+ * @brief Implementation file for the RxManager class
+ */
+#include "rx_manager.h"
+
+#include <algorithm>
+
+#include "concurrent_queue_wrapper.h"
+#include "idle_policy.h"
+#include "logger.h"
+#include "signal_handler.h"
+#include "utils.h"
+
+RxManager::RxManager(Config* cfg, MessageInfo* message, Stats* stats,
+                     std::vector<RxPacket*>& fft_symbol_packets,
+                     size_t num_pilot_pkts_per_frame,
+                     size_t num_reciprocity_pkts_per_frame,
+                     size_t num_rx_pkts_per_frame)
+    : cfg_(cfg),
+      message_(message),
+      stats_(stats),
+      fft_symbol_packets_(fft_symbol_packets),
+      master_ptok_(master_queue_) {
+  rx_counters_.Init(num_pilot_pkts_per_frame, num_reciprocity_pkts_per_frame,
+                    num_rx_pkts_per_frame);
+  if (cfg->FftBatchSymbol()) {
+    fft_symbol_ant_count_ = std::vector<size_t>(
+        cfg->FrameWindow() * cfg->Frame().NumTotalSyms(), 0);
+  }
+  for (auto& started : started_frame_) {
+    started.store(SIZE_MAX, std::memory_order_relaxed);
+  }
+}
+
+RxManager::~RxManager() { Stop(); }
+
+uint32_t RxManager::CountPacket(size_t frame_id, size_t symbol_id) {
+  RxPacketKind kind = RxPacketKind::kOther;
+  if (cfg_->IsPilot(frame_id, symbol_id)) {
+    kind = RxPacketKind::kPilot;
+  } else if (cfg_->IsCalDlPilot(frame_id, symbol_id) ||
+             cfg_->IsCalUlPilot(frame_id, symbol_id)) {
+    kind = RxPacketKind::kReciprocity;
+  }
+  const uint32_t events = rx_counters_.CountPacket(frame_id, kind);
+
+  if ((events & kRxPilotsDone) != 0) {
+    this->stats_->MasterSetTsc(TsType::kPilotAllRX, frame_id);
+    stats_->PrintPerFrameDone(PrintType::kPacketRXPilots, frame_id);
+  }
+  if ((events & kRxReciprocityDone) != 0) {
+    this->stats_->MasterSetTsc(TsType::kRCAllRX, frame_id);
+  }
+  if ((events & kRxFrameDone) != 0) {
+    this->stats_->MasterSetTsc(TsType::kRXDone, frame_id);
+    stats_->PrintPerFrameDone(PrintType::kPacketRX, frame_id);
+  }
+  return events;
+}
+
+bool RxManager::InFrameWindow(size_t frame_id, const FrameInfo& frames) const {
+  // The frames before the scheduled one may still be in processing
+  const size_t window_start = std::min(frames.cur_sche_frame_id_,
+                                       frames.cur_proc_frame_id_ + 1);
+  if (frame_id >= (window_start + cfg_->FrameWindow())) {
+    AGORA_LOG_ERROR(
+        "Error: Received packet for future frame %zu beyond "
+        "frame window (= %zu + %zu). This can happen if "
+        "Agora is running slowly, e.g., in debug mode\n",
+        frame_id, window_start, cfg_->FrameWindow());
+    return false;
+  }
+  return true;
+}
+
+bool RxManager::TryScheduleFft(const FrameInfo& frames) {
+  const size_t frame_id = frames.cur_sche_frame_id_;
+  // A frame starts once it is within the pipeline depth of the oldest frame
+  // in processing
+  if (frame_id >= (frames.cur_proc_frame_id_ + cfg_->PipelineDepth())) {
+    return false;
+  }
+  if (cfg_->FftBatchSymbol()) {
+    return TryScheduleFftSymbols(frame_id);
+  }
+  std::queue<fft_req_tag_t>& cur_fftq =
+      fft_queue_arr_.at(frame_id % kFrameWnd);
+  const size_t qid = frame_id % cfg_->PipelineDepth();
+  bool frame_done = false;
+
+  const size_t num_fft_blocks = cur_fftq.size() / cfg_->FftBlockSize();
+  for (size_t i = 0; i < num_fft_blocks; i++) {
+    EventData do_fft_task;
+    do_fft_task.num_tags_ = cfg_->FftBlockSize();
+    do_fft_task.event_type_ = EventType::kFFT;
+
+    for (size_t j = 0; j < cfg_->FftBlockSize(); j++) {
+      RtAssert(!cur_fftq.empty(),
+               "Using front element cur_fftq when it is empty");
+      do_fft_task.tags_[j] = cur_fftq.front().tag_;
+      cur_fftq.pop();
+      frame_done |= CountCreatedFft(frame_id);
+    }
+    message_->EnqueueEventTaskQueue(EventType::kFFT, qid, do_fft_task);
+  }
+  return frame_done;
+}
+
+bool RxManager::TryScheduleFftSymbols(size_t frame_id) {
+  std::queue<fft_req_tag_t>& cur_fftq =
+      fft_queue_arr_.at(frame_id % kFrameWnd);
+  const size_t qid = frame_id % cfg_->PipelineDepth();
+  bool frame_done = false;
+
+  while (cur_fftq.empty() == false) {
+    RxPacket* rx_packet = cur_fftq.front().rx_packet_;
+    cur_fftq.pop();
+    const Packet* pkt = rx_packet->RawPacket();
+    const SymbolType sym_type = cfg_->GetSymbolType(pkt->symbol_id_);
+    frame_done |= CountCreatedFft(frame_id);
+
+    if ((sym_type != SymbolType::kPilot) && (sym_type != SymbolType::kUL)) {
+      // Calibration symbols are not received on all the antennas
+      message_->EnqueueEventTaskQueue(
+          EventType::kFFT, qid,
+          EventData(EventType::kFFT, fft_req_tag_t(rx_packet).tag_));
+      continue;
+    }
+    const size_t row = ((pkt->frame_id_ % cfg_->FrameWindow()) *
+                        cfg_->Frame().NumTotalSyms()) +
+                       pkt->symbol_id_;
+    fft_symbol_packets_.at((row * cfg_->BsAntNum()) + pkt->ant_id_) =
+        rx_packet;
+    fft_symbol_ant_count_.at(row)++;
+    if (fft_symbol_ant_count_.at(row) == cfg_->BsAntNum()) {
+      fft_symbol_ant_count_.at(row) = 0;
+      message_->EnqueueEventTaskQueue(
+          EventType::kFFTSymbol, qid,
+          EventData(EventType::kFFTSymbol,
+                    gen_tag_t::FrmSym(pkt->frame_id_, pkt->symbol_id_).tag_));
+    }
+  }
+  return frame_done;
+}
+
+bool RxManager::CountCreatedFft(size_t frame_id) {
+  if (this->fft_created_count_ == 0) {
+    this->stats_->MasterSetTsc(TsType::kProcessingStarted, frame_id);
+    stats_->PrintPerFrameDone(PrintType::kProcessingStart, frame_id);
+  }
+  this->fft_created_count_++;
+  if (this->fft_created_count_ == rx_counters_.PacketsPerFrame()) {
+    this->fft_created_count_ = 0;
+    return true;
+  }
+  return false;
+}
+
+void RxManager::Start(size_t core_offset) {
+  const size_t min_bulk = kDequeueBulkSizeTXRX;
+  const size_t max_bulk = cfg_->AdaptiveDequeue()
+                              ? (min_bulk * kDequeueBulkMaxGrowth)
+                              : min_bulk;
+  rx_bulks_.assign(cfg_->SocketThreadNum(), AdaptiveBulk(min_bulk, max_bulk));
+  events_list_.resize(max_bulk);
+  threaded_ = true;
+  thread_ = std::thread(&RxManager::Run, this, core_offset);
+}
+
+void RxManager::Stop() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+size_t RxManager::HandlePackets() {
+  const FrameInfo frames = {sche_frame_.load(std::memory_order_acquire),
+                            proc_frame_.load(std::memory_order_relaxed)};
+  size_t total_events = 0;
+  for (size_t i = 0; i < cfg_->SocketThreadNum(); i++) {
+    AdaptiveBulk& bulk = rx_bulks_.at(i);
+    const size_t new_events =
+        message_->DequeueRxEvents(i, events_list_.data(), bulk.Size());
+    bulk.Update(bulk.Size(), new_events);
+    total_events += new_events;
+
+    for (size_t ev_i = 0; ev_i < new_events; ev_i++) {
+      const EventData& event = events_list_.at(ev_i);
+      if (event.event_type_ != EventType::kPacketRX) {
+        // The TX completions share the queues of the received packets
+        TryEnqueueFallback(&master_queue_, &master_ptok_, event);
+        continue;
+      }
+      const Packet* pkt = rx_tag_t(event.tags_[0u]).rx_packet_->RawPacket();
+      if (InFrameWindow(pkt->frame_id_, frames) == false) {
+        cfg_->Running(false);
+        return total_events;
+      }
+      if ((CountPacket(pkt->frame_id_, pkt->symbol_id_) & kRxFirstPacket) !=
+          0) {
+        TryEnqueueFallback(
+            &master_queue_, &master_ptok_,
+            EventData(EventType::kFrameStart,
+                      gen_tag_t::FrmSym(pkt->frame_id_, pkt->symbol_id_)
+                          .tag_));
+      }
+      QueueFft(pkt->frame_id_, fft_req_tag_t(event.tags_[0]));
+    }
+  }
+  return total_events;
+}
+
+void RxManager::Run(size_t core_offset) {
+  PinToCoreWithOffset(ThreadType::kMasterRX, core_offset, 0,
+                      kEnableCoreReuse, false /* quiet */);
+  IdlePolicy idle(cfg_);
+  while ((cfg_->Running() == true) &&
+         (SignalHandler::GotExitSignal() == false)) {
+    const size_t num_events = HandlePackets();
+
+    const FrameInfo frames = {sche_frame_.load(std::memory_order_acquire),
+                              proc_frame_.load(std::memory_order_relaxed)};
+    // The FFTs of a frame wait for the master to handle its kFrameStart
+    if (started_frame_.at(frames.cur_sche_frame_id_ % kFrameWnd)
+            .load(std::memory_order_acquire) == frames.cur_sche_frame_id_) {
+      TryScheduleFft(frames);
+    }
+
+    if (num_events > 0) {
+      idle.Busy();
+    } else {
+      idle.Idle();
+    }
+  }
+  idle.PrintSummary("RX manager");
+}
@@ -0,0 +1,142 @@
+/**
+ * @file rx_manager.h
+ * @brief Declaration file for the RxManager class, the RX bookkeeping of
+ * Agora: the received packet counts and the FFT scheduling
+ */
+#ifndef RX_MANAGER_H_
+#define RX_MANAGER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "adaptive_bulk.h"
+#include "agora_buffer.h"
+#include "concurrentqueue.h"
+#include "config.h"
+#include "message.h"
+#include "shared_counters.h"
+#include "stats.h"
+#include "symbols.h"
+
+/**
+ * Owns the received packet counts of each frame (RxCounters) and the packets
+ * waiting for their FFT, which it hands to the workers as kFFT or kFFTSymbol
+ * tasks once their frame is within the pipeline depth. The frame progress
+ * and all the other FrameCounters belong to the master.
+ *
+ * Without rx_manager, the master calls it for each packet it dequeues. With
+ * rx_manager, Start() runs it on a thread of its own, which dequeues the
+ * events of the TXRX threads and passes the master their TX completions,
+ * and a kFrameStart event on the first packet of each frame. The master
+ * publishes its frame progress to the thread with PublishFrames(), and
+ * marks each frame started once it has handled its kFrameStart: the FFTs of
+ * a frame wait for that, so the MAC schedule of the frame is set before any
+ * of its tasks completes.
+ */
+class RxManager {
+ public:
+  RxManager(Config* cfg, MessageInfo* message, Stats* stats,
+            std::vector<RxPacket*>& fft_symbol_packets,
+            size_t num_pilot_pkts_per_frame,
+            size_t num_reciprocity_pkts_per_frame,
+            size_t num_rx_pkts_per_frame);
+  ~RxManager();
+
+  // Delete copy constructor and copy assignment
+  RxManager(RxManager const&) = delete;
+  RxManager& operator=(RxManager const&) = delete;
+
+  /// Count a received packet of symbol_id in frame_id and record the RX
+  /// timestamps of the frame. Returns the RxCountEvent bits it triggers.
+  uint32_t CountPacket(size_t frame_id, size_t symbol_id);
+
+  /// Queue the FFT of a packet of frame_id, received or standing in for a
+  /// lost one
+  inline void QueueFft(size_t frame_id, fft_req_tag_t tag) {
+    this->fft_queue_arr_.at(frame_id % kFrameWnd).push(tag);
+  }
+
+  /// Schedule the queued FFTs of the frames. Returns true if all the
+  /// packets of frames.cur_sche_frame_id_ are now scheduled.
+  bool TryScheduleFft(const FrameInfo& frames);
+
+  /// True if a packet of frame_id fits in the frame window of frames
+  bool InFrameWindow(size_t frame_id, const FrameInfo& frames) const;
+
+  inline const RxCounters& Counters() const { return this->rx_counters_; }
+
+  /// Start the RX thread on core_offset. The master then no longer
+  /// dequeues the packets nor calls the functions above.
+  void Start(size_t core_offset);
+  /// Wait for the RX thread to end once Agora stops running
+  void Stop();
+  inline bool Threaded() const { return this->threaded_; }
+
+  /// From the master, the progress of its frames after each event
+  inline void PublishFrames(const FrameInfo& frames) {
+    this->proc_frame_.store(frames.cur_proc_frame_id_,
+                            std::memory_order_relaxed);
+    this->sche_frame_.store(frames.cur_sche_frame_id_,
+                            std::memory_order_release);
+  }
+
+  /// From the master, once frame_id is scheduled by the MAC
+  inline void FrameStarted(size_t frame_id) {
+    this->started_frame_.at(frame_id % kFrameWnd)
+        .store(frame_id, std::memory_order_release);
+  }
+
+  /// The events of the RX thread for the master: kFrameStart, and the
+  /// events of the TXRX threads other than received packets
+  inline moodycamel::ConcurrentQueue<EventData>* MasterQueue() {
+    return &this->master_queue_;
+  }
+
+ private:
+  /// The loop of the RX thread, until Agora stops running
+  void Run(size_t core_offset);
+  /// Dequeue and handle the packets of each TXRX thread. Returns the number
+  /// of packets.
+  size_t HandlePackets();
+  /// Schedule one kFFTSymbol task per pilot or uplink symbol of frame_id
+  /// whose packets of all the antennas are received. Returns true if all
+  /// the packets of frame_id are now scheduled.
+  bool TryScheduleFftSymbols(size_t frame_id);
+  /// Account for one more FFT packet of frame_id. Returns true for its last.
+  bool CountCreatedFft(size_t frame_id);
+
+  Config* const cfg_;
+  MessageInfo* const message_;
+  Stats* const stats_;
+  std::vector<RxPacket*>& fft_symbol_packets_;
+
+  RxCounters rx_counters_;
+  size_t fft_created_count_ = 0;
+  // Per-frame queues of delayed FFT tasks. The queue contains offsets into
+  // TX/RX buffers.
+  std::array<std::queue<fft_req_tag_t>, kFrameWnd> fft_queue_arr_;
+  // With FftBatchSymbol, the number of packets of each (frame slot, symbol)
+  // stored in the AgoraBuffer FFT symbol packet table
+  std::vector<size_t> fft_symbol_ant_count_;
+
+  // Written by the master, read by the RX thread
+  std::atomic<size_t> sche_frame_{0};
+  std::atomic<size_t> proc_frame_{0};
+  std::array<std::atomic<size_t>, kFrameWnd> started_frame_;
+
+  // RX thread to master
+  moodycamel::ConcurrentQueue<EventData> master_queue_;
+  moodycamel::ProducerToken master_ptok_;
+  // Dequeue bulk size of each TXRX thread's packets
+  std::vector<AdaptiveBulk> rx_bulks_;
+  std::vector<EventData> events_list_;
+  bool threaded_ = false;
+  std::thread thread_;
+};
+
+#endif  // RX_MANAGER_H_
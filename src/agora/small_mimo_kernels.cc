@@ -0,0 +1,115 @@
+/**
+ * @file small_mimo_kernels.cc
+ * @brief Implementation file for the runtime selection of the small-MIMO
+ * kernels, and their plain C++ version.
+ */
+#include "small_mimo_kernels.h"
+
+#include "logger.h"
+#include "small_mimo_kernels_impl.h"
+#include "tile_layout.h"
+
+namespace SmallMimo {
+
+namespace {
+struct ScalarVec {
+  using T = complex_float;
+  static constexpr size_t kScs = 1;
+
+  static inline T Load(const complex_float* src) { return *src; }
+  static inline T LoadAligned(const complex_float* src) { return *src; }
+  static inline void Store(complex_float* dst, T v) { *dst = v; }
+  static inline void Stream(complex_float* dst, T v) { *dst = v; }
+  static inline T Zero() { return {0.0f, 0.0f}; }
+  static inline T Set1(complex_float v) { return v; }
+  static inline T Add(T a, T b) { return {a.re + b.re, a.im + b.im}; }
+  static inline T Sub(T a, T b) { return {a.re - b.re, a.im - b.im}; }
+  static inline T Mul(T a, T b) {
+    return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+  }
+  static inline T MulConj(T a, T b) {
+    return {a.re * b.re + a.im * b.im, a.im * b.re - a.re * b.im};
+  }
+  template <FastMath::Precision kPrecision>
+  static inline T Recip(T a) {
+    const float norm = a.re * a.re + a.im * a.im;
+    return {a.re / norm, -a.im / norm};
+  }
+  static inline bool AnyNearZero(T a, float threshold) {
+    return a.re * a.re + a.im * a.im < threshold * threshold;
+  }
+  static inline complex_float Sum(T a) { return a; }
+};
+}  // namespace
+
+const Kernels* ScalarKernels(FastMath::Precision precision) {
+  static const auto kKernels = MakeKernelTiers<ScalarVec>(Isa::kScalar);
+  return &kKernels.at(static_cast<size_t>(precision));
+}
+
+ChunkLayout TileChunks(size_t num_ants, size_t num_scs) {
+  const size_t base = TileLayout::Index(0, 0, num_ants, num_scs);
+  return {TileLayout::Index(kSCsPerCacheline, 0, num_ants, num_scs) - base,
+          TileLayout::Index(0, 1, num_ants, num_scs) - base};
+}
+
+const char* IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kAvx512:
+      return "AVX-512";
+    case Isa::kAvx2:
+      return "AVX2";
+    case Isa::kPortable:
+#if defined(__aarch64__)
+      return "NEON";
+#else
+      return "128-bit";
+#endif
+    case Isa::kScalar:
+      return "scalar";
+  }
+  return "unknown";
+}
+
+const Kernels* ForIsa(Isa isa, FastMath::Precision precision) {
+  switch (isa) {
+#if defined(__x86_64__)
+    case Isa::kAvx512:
+      return (__builtin_cpu_supports("avx512f") &&
+              __builtin_cpu_supports("avx512dq"))
+                 ? Avx512Kernels(precision)
+                 : nullptr;
+    case Isa::kAvx2:
+      return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                 ? Avx2Kernels(precision)
+                 : nullptr;
+#else
+    case Isa::kAvx512:
+    case Isa::kAvx2:
+      return nullptr;
+#endif
+    case Isa::kPortable:
+      return PortableKernels(precision);
+    case Isa::kScalar:
+      return ScalarKernels(precision);
+  }
+  return nullptr;
+}
+
+static Isa Probe() {
+  Isa isa = Isa::kPortable;
+  if (ForIsa(Isa::kAvx512) != nullptr) {
+    isa = Isa::kAvx512;
+  } else if (ForIsa(Isa::kAvx2) != nullptr) {
+    isa = Isa::kAvx2;
+  }
+  AGORA_LOG_INFO("SmallMimo: using the %s kernels\n", IsaName(isa));
+  return isa;
+}
+
+const Kernels& Get(FastMath::Precision precision) {
+  static const Isa kIsa = Probe();
+  return *ForIsa(kIsa, precision);
+}
+
+}  // namespace SmallMimo
@@ -0,0 +1,108 @@
+/**
+ * @file small_mimo_kernels.h
+ * @brief Declaration file for the SIMD kernels of the small_mimo_acc path
+ * (1x1, 2x2 and 4x4 antennas): beamweights, equalization, phase tracking and
+ * the CSI/data output of the FFT. Every kernel is built for AVX-512, AVX2/FMA,
+ * portable 128-bit vectors (NEON on aarch64) and plain C++, and the widest set
+ * the CPU supports is picked at runtime.
+ */
+#ifndef SMALL_MIMO_KERNELS_H_
+#define SMALL_MIMO_KERNELS_H_
+
+#include <cstddef>
+
+#include "fast_math.h"
+#include "symbols.h"
+
+namespace SmallMimo {
+
+enum class Isa { kScalar, kPortable, kAvx2, kAvx512 };
+
+/// Antenna (and stream) counts of the kernels, 1, 2 or 4
+static constexpr size_t kNumDims = 3;
+static constexpr size_t kMaxDim = 4;
+/// |det| of a channel matrix below which it is reported as not invertible
+static constexpr float kNearZeroDet = 1e-10f;
+
+/// Index of the kernels of dim x dim antennas in Kernels
+inline size_t DimIndex(size_t dim) { return dim == 4 ? 2 : dim - 1; }
+
+/// Where the chunks of kSCsPerCacheline subcarriers of a buffer are: chunk k
+/// of antenna ant at k * chunk_stride_ + ant * ant_stride_. The kernels take
+/// the layout instead of calling TileLayout, so that no inline function of
+/// the rest of Agora is built with the flags of an instruction set.
+struct ChunkLayout {
+  size_t chunk_stride_;
+  size_t ant_stride_;
+};
+
+/// The layout of a TileLayout buffer of num_ants antennas
+ChunkLayout TileChunks(size_t num_ants, size_t num_scs);
+
+/// The kernels of one instruction set, over num_scs subcarriers, a multiple
+/// of kSCsPerCacheline. The beam matrices are in the split layout of the
+/// small-MIMO path, beam (i, j) of subcarrier sc at
+/// beam[(i * dim + j) * num_scs + sc].
+struct Kernels {
+  Isa isa_;
+  /// Of the reciprocals of the inversion. The scalar and 128-bit kernels
+  /// have no estimate instructions and are exact in every tier.
+  FastMath::Precision precision_;
+
+  /// beam = inv(H) per subcarrier, with H(ant, ue) at antenna ant of csi[ue].
+  /// Returns false if det(H) is near zero for some subcarrier.
+  bool (*invert_[kNumDims])(const complex_float* const* csi,
+                            ChunkLayout csi_layout, complex_float* beam,
+                            size_t num_scs);
+
+  /// equal[i][sc] = sum_j beam(i, j) * data(j) of every subcarrier
+  void (*equalize_[kNumDims])(const complex_float* beam,
+                              const complex_float* data,
+                              ChunkLayout data_layout,
+                              complex_float* const* equal, size_t num_scs);
+
+  /// equal[sc] = beam * data[sc], the 1x1 equalization of a group of
+  /// subcarriers sharing one beam. num_scs need not be a multiple of
+  /// kSCsPerCacheline.
+  void (*equalize_group_)(complex_float beam, const complex_float* data,
+                          complex_float* equal, size_t num_scs);
+
+  /// sum(equal * conj(pilot)) over num_scs subcarriers
+  complex_float (*pilot_corr_)(const complex_float* equal,
+                               const complex_float* pilot, size_t num_scs);
+
+  /// equal *= phase, in place
+  void (*rotate_)(complex_float* equal, complex_float phase, size_t num_scs);
+
+  /// dst = src * conj(pilot_sgn), or a copy of src without pilot_sgn, with
+  /// non-temporal stores if non_temporal. Chunk k of dst is at
+  /// dst + k * dst_chunk_stride. src and dst are 64-byte aligned.
+  void (*fill_output_)(const complex_float* src,
+                       const complex_float* pilot_sgn, complex_float* dst,
+                       size_t dst_chunk_stride, size_t num_scs,
+                       bool non_temporal);
+};
+
+const char* IsaName(Isa isa);
+
+/// The kernels of the widest instruction set of this CPU, probed once, with
+/// the reciprocals of precision
+const Kernels& Get(
+    FastMath::Precision precision = FastMath::Precision::kExact);
+
+/// The kernels of isa, or nullptr if they are not built in or this CPU lacks
+/// the instructions
+const Kernels* ForIsa(
+    Isa isa, FastMath::Precision precision = FastMath::Precision::kExact);
+
+// Per instruction set tables of each precision, each in its own translation
+// unit built with the flags of its instruction set. nullptr if the compiler
+// could not build it.
+const Kernels* ScalarKernels(FastMath::Precision precision);
+const Kernels* PortableKernels(FastMath::Precision precision);
+const Kernels* Avx2Kernels(FastMath::Precision precision);
+const Kernels* Avx512Kernels(FastMath::Precision precision);
+
+}  // namespace SmallMimo
+
+#endif  // SMALL_MIMO_KERNELS_H_
@@ -0,0 +1,98 @@
+/**
+ * @file small_mimo_kernels_avx2.cc
+ * @brief The AVX2/FMA version of the small-MIMO kernels. Built with -mavx2
+ * -mfma, and only called on CPUs that have them.
+ */
+#include "small_mimo_kernels.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "small_mimo_kernels_impl.h"
+
+namespace SmallMimo {
+
+namespace {
+struct Avx2Vec {
+  using T = __m256;
+  static constexpr size_t kScs = 4;
+
+  static inline T Load(const complex_float* src) {
+    return _mm256_loadu_ps(reinterpret_cast<const float*>(src));
+  }
+  static inline T LoadAligned(const complex_float* src) {
+    return _mm256_load_ps(reinterpret_cast<const float*>(src));
+  }
+  static inline void Store(complex_float* dst, T v) {
+    _mm256_storeu_ps(reinterpret_cast<float*>(dst), v);
+  }
+  static inline void Stream(complex_float* dst, T v) {
+    _mm256_stream_ps(reinterpret_cast<float*>(dst), v);
+  }
+  static inline T Zero() { return _mm256_setzero_ps(); }
+  static inline T Set1(complex_float v) {
+    double pair;
+    std::memcpy(&pair, &v, sizeof(pair));
+    return _mm256_castpd_ps(_mm256_set1_pd(pair));
+  }
+  static inline T Add(T a, T b) { return _mm256_add_ps(a, b); }
+  static inline T Sub(T a, T b) { return _mm256_sub_ps(a, b); }
+  // {a.re * b.re - a.im * b.im, a.im * b.re + a.re * b.im}
+  static inline T Mul(T a, T b) {
+    const T a_swap = _mm256_permute_ps(a, 0xB1);
+    return _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(b),
+                              _mm256_mul_ps(a_swap, _mm256_movehdup_ps(b)));
+  }
+  // {a.re * b.re + a.im * b.im, a.im * b.re - a.re * b.im}
+  static inline T MulConj(T a, T b) {
+    const T a_swap = _mm256_permute_ps(a, 0xB1);
+    return _mm256_fmsubadd_ps(a, _mm256_moveldup_ps(b),
+                              _mm256_mul_ps(a_swap, _mm256_movehdup_ps(b)));
+  }
+  // |a|^2 in both floats of each element
+  static inline T Norm(T a) {
+    const T sq = _mm256_mul_ps(a, a);
+    return _mm256_add_ps(sq, _mm256_permute_ps(sq, 0xB1));
+  }
+  template <FastMath::Precision kPrecision>
+  static inline T Recip(T a) {
+    const T conj = _mm256_mul_ps(
+        a, _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f));
+    if constexpr (kPrecision == FastMath::Precision::kExact) {
+      return _mm256_div_ps(conj, Norm(a));
+    } else {
+      return _mm256_mul_ps(conj, FastMath::Rcp<kPrecision>(Norm(a)));
+    }
+  }
+  static inline bool AnyNearZero(T a, float threshold) {
+    const T below = _mm256_cmp_ps(
+        Norm(a), _mm256_set1_ps(threshold * threshold), _CMP_LT_OQ);
+    return _mm256_movemask_ps(below) != 0;
+  }
+  static inline complex_float Sum(T a) {
+    // {re0 + re2, im0 + im2, re1 + re3, im1 + im3}
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(a),
+                                   _mm256_extractf128_ps(a, 1));
+    const __m128 sum = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    return {_mm_cvtss_f32(sum), _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1))};
+  }
+};
+}  // namespace
+
+const Kernels* Avx2Kernels(FastMath::Precision precision) {
+  static const auto kKernels = MakeKernelTiers<Avx2Vec>(Isa::kAvx2);
+  return &kKernels.at(static_cast<size_t>(precision));
+}
+
+}  // namespace SmallMimo
+
+#else
+
+const SmallMimo::Kernels* SmallMimo::Avx2Kernels(
+    FastMath::Precision /*precision*/) {
+  return nullptr;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file small_mimo_kernels_avx512.cc
+ * @brief The AVX-512 version of the small-MIMO kernels. Built with -mavx512f
+ * -mavx512dq, and only called on CPUs that have them.
+ */
+#include "small_mimo_kernels.h"
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "small_mimo_kernels_impl.h"
+
+namespace SmallMimo {
+
+namespace {
+struct Avx512Vec {
+  using T = __m512;
+  static constexpr size_t kScs = 8;
+
+  static inline T Load(const complex_float* src) {
+    return _mm512_loadu_ps(reinterpret_cast<const float*>(src));
+  }
+  static inline T LoadAligned(const complex_float* src) {
+    return _mm512_load_ps(reinterpret_cast<const float*>(src));
+  }
+  static inline void Store(complex_float* dst, T v) {
+    _mm512_storeu_ps(reinterpret_cast<float*>(dst), v);
+  }
+  static inline void Stream(complex_float* dst, T v) {
+    _mm512_stream_ps(reinterpret_cast<float*>(dst), v);
+  }
+  static inline T Zero() { return _mm512_setzero_ps(); }
+  static inline T Set1(complex_float v) {
+    double pair;
+    std::memcpy(&pair, &v, sizeof(pair));
+    return _mm512_castpd_ps(_mm512_set1_pd(pair));
+  }
+  static inline T Add(T a, T b) { return _mm512_add_ps(a, b); }
+  static inline T Sub(T a, T b) { return _mm512_sub_ps(a, b); }
+  // The maskz forms of the shuffles keep GCC from warning about the
+  // undefined pass-through operand of the plain ones
+  static constexpr __mmask16 kAll = 0xFFFF;
+  static inline T Swap(T a) { return _mm512_maskz_permute_ps(kAll, a, 0xB1); }
+  static inline T Real(T a) { return _mm512_maskz_moveldup_ps(kAll, a); }
+  static inline T Imag(T a) { return _mm512_maskz_movehdup_ps(kAll, a); }
+  // {a.re * b.re - a.im * b.im, a.im * b.re + a.re * b.im}
+  static inline T Mul(T a, T b) {
+    return _mm512_fmaddsub_ps(a, Real(b), _mm512_mul_ps(Swap(a), Imag(b)));
+  }
+  // {a.re * b.re + a.im * b.im, a.im * b.re - a.re * b.im}
+  static inline T MulConj(T a, T b) {
+    return _mm512_fmsubadd_ps(a, Real(b), _mm512_mul_ps(Swap(a), Imag(b)));
+  }
+  // |a|^2 in both floats of each element
+  static inline T Norm(T a) {
+    const T sq = _mm512_mul_ps(a, a);
+    return _mm512_add_ps(sq, Swap(sq));
+  }
+  template <FastMath::Precision kPrecision>
+  static inline T Recip(T a) {
+    // Flip the sign bit of the imaginary parts
+    const T conj = _mm512_xor_ps(
+        a, _mm512_castsi512_ps(_mm512_set1_epi64(0x8000000000000000)));
+    if constexpr (kPrecision == FastMath::Precision::kExact) {
+      return _mm512_div_ps(conj, Norm(a));
+    } else {
+      return _mm512_mul_ps(conj, FastMath::Rcp<kPrecision>(Norm(a)));
+    }
+  }
+  static inline bool AnyNearZero(T a, float threshold) {
+    return _mm512_cmp_ps_mask(Norm(a), _mm512_set1_ps(threshold * threshold),
+                              _CMP_LT_OQ) != 0;
+  }
+  static inline complex_float Sum(T a) {
+    const __m256 half =
+        _mm256_add_ps(_mm512_maskz_extractf32x8_ps(0xFF, a, 0),
+                      _mm512_maskz_extractf32x8_ps(0xFF, a, 1));
+    const __m128 quarter = _mm_add_ps(_mm256_castps256_ps128(half),
+                                      _mm256_extractf128_ps(half, 1));
+    const __m128 sum = _mm_add_ps(quarter, _mm_movehl_ps(quarter, quarter));
+    return {_mm_cvtss_f32(sum), _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1))};
+  }
+};
+}  // namespace
+
+const Kernels* Avx512Kernels(FastMath::Precision precision) {
+  static const auto kKernels = MakeKernelTiers<Avx512Vec>(Isa::kAvx512);
+  return &kKernels.at(static_cast<size_t>(precision));
+}
+
+}  // namespace SmallMimo
+
+#else
+
+const SmallMimo::Kernels* SmallMimo::Avx512Kernels(
+    FastMath::Precision /*precision*/) {
+  return nullptr;
+}
+
+#endif
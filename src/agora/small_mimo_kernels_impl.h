@@ -0,0 +1,241 @@
+/**
+ * @file small_mimo_kernels_impl.h
+ * @brief The small-MIMO kernels, templated on a vector of interleaved complex
+ * floats. Only included by the translation unit of each instruction set,
+ * which defines the vector type and builds its Kernels table with
+ * MakeKernels(). Everything here has internal linkage, so no code built for
+ * one instruction set can be picked by the linker for another.
+ */
+#ifndef SMALL_MIMO_KERNELS_IMPL_H_
+#define SMALL_MIMO_KERNELS_IMPL_H_
+
+#include <array>
+
+#include "small_mimo_kernels.h"
+
+namespace SmallMimo {
+namespace {
+
+// V is a vector of V::kScs complex floats, {re, im} interleaved as in
+// complex_float, with:
+//   T Load(const complex_float*)        unaligned load
+//   T LoadAligned(const complex_float*) 64-byte aligned load
+//   void Store(complex_float*, T)       unaligned store
+//   void Stream(complex_float*, T)      aligned non-temporal store
+//   T Zero(), T Set1(complex_float)
+//   T Add(T, T), T Sub(T, T)
+//   T Mul(T a, T b)                     a * b
+//   T MulConj(T a, T b)                 a * conj(b)
+//   T Recip<kPrecision>(T a)            1 / a, to FastMath::Precision
+//   bool AnyNearZero(T a, float t)      |a| < t for some element
+//   complex_float Sum(T)                sum of the elements
+
+// Offset of subcarrier sc (a multiple of V::kScs) of antenna ant
+inline size_t ChunkOffset(const ChunkLayout& layout, size_t sc, size_t ant) {
+  return (sc / kSCsPerCacheline) * layout.chunk_stride_ +
+         ant * layout.ant_stride_ + (sc % kSCsPerCacheline);
+}
+
+// inv = adj(h), det = det(h), so that inv(h) = inv / det
+template <class V>
+inline void Adjugate2x2(const typename V::T (&h)[2][2],
+                        typename V::T (&adj)[2][2], typename V::T& det) {
+  det = V::Sub(V::Mul(h[0][0], h[1][1]), V::Mul(h[0][1], h[1][0]));
+  const typename V::T zero = V::Zero();
+  adj[0][0] = h[1][1];
+  adj[0][1] = V::Sub(zero, h[0][1]);
+  adj[1][0] = V::Sub(zero, h[1][0]);
+  adj[1][1] = h[0][0];
+}
+
+// The adjugate by the 2x2 minors of the top two rows (s) and the bottom two
+// rows (c)
+template <class V>
+inline void Adjugate4x4(const typename V::T (&a)[4][4],
+                        typename V::T (&adj)[4][4], typename V::T& det) {
+  using T = typename V::T;
+  auto minor = [&a](size_t r, size_t c0, size_t c1) {
+    return V::Sub(V::Mul(a[r][c0], a[r + 1][c1]),
+                  V::Mul(a[r + 1][c0], a[r][c1]));
+  };
+  const T s0 = minor(0, 0, 1);
+  const T s1 = minor(0, 0, 2);
+  const T s2 = minor(0, 0, 3);
+  const T s3 = minor(0, 1, 2);
+  const T s4 = minor(0, 1, 3);
+  const T s5 = minor(0, 2, 3);
+  const T c0 = minor(2, 0, 1);
+  const T c1 = minor(2, 0, 2);
+  const T c2 = minor(2, 0, 3);
+  const T c3 = minor(2, 1, 2);
+  const T c4 = minor(2, 1, 3);
+  const T c5 = minor(2, 2, 3);
+
+  det = V::Add(V::Sub(V::Mul(s0, c5), V::Mul(s1, c4)),
+               V::Add(V::Mul(s2, c3), V::Mul(s3, c2)));
+  det = V::Add(V::Sub(det, V::Mul(s4, c1)), V::Mul(s5, c0));
+
+  // x * p - y * q + z * r
+  auto term = [](T x, T p, T y, T q, T z, T r) {
+    return V::Add(V::Sub(V::Mul(x, p), V::Mul(y, q)), V::Mul(z, r));
+  };
+  const T zero = V::Zero();
+  adj[0][0] = term(a[1][1], c5, a[1][2], c4, a[1][3], c3);
+  adj[0][1] = V::Sub(zero, term(a[0][1], c5, a[0][2], c4, a[0][3], c3));
+  adj[0][2] = term(a[3][1], s5, a[3][2], s4, a[3][3], s3);
+  adj[0][3] = V::Sub(zero, term(a[2][1], s5, a[2][2], s4, a[2][3], s3));
+  adj[1][0] = V::Sub(zero, term(a[1][0], c5, a[1][2], c2, a[1][3], c1));
+  adj[1][1] = term(a[0][0], c5, a[0][2], c2, a[0][3], c1);
+  adj[1][2] = V::Sub(zero, term(a[3][0], s5, a[3][2], s2, a[3][3], s1));
+  adj[1][3] = term(a[2][0], s5, a[2][2], s2, a[2][3], s1);
+  adj[2][0] = term(a[1][0], c4, a[1][1], c2, a[1][3], c0);
+  adj[2][1] = V::Sub(zero, term(a[0][0], c4, a[0][1], c2, a[0][3], c0));
+  adj[2][2] = term(a[3][0], s4, a[3][1], s2, a[3][3], s0);
+  adj[2][3] = V::Sub(zero, term(a[2][0], s4, a[2][1], s2, a[2][3], s0));
+  adj[3][0] = V::Sub(zero, term(a[1][0], c3, a[1][1], c1, a[1][2], c0));
+  adj[3][1] = term(a[0][0], c3, a[0][1], c1, a[0][2], c0);
+  adj[3][2] = V::Sub(zero, term(a[3][0], s3, a[3][1], s1, a[3][2], s0));
+  adj[3][3] = term(a[2][0], s3, a[2][1], s1, a[2][2], s0);
+}
+
+template <class V, size_t kDim, FastMath::Precision kPrecision>
+bool Invert(const complex_float* const* csi, ChunkLayout csi_layout,
+            complex_float* beam, size_t num_scs) {
+  using T = typename V::T;
+  bool invertible = true;
+  for (size_t sc = 0; sc < num_scs; sc += V::kScs) {
+    T h[kDim][kDim];
+    for (size_t ant = 0; ant < kDim; ant++) {
+      for (size_t ue = 0; ue < kDim; ue++) {
+        h[ant][ue] = V::Load(csi[ue] + ChunkOffset(csi_layout, sc, ant));
+      }
+    }
+    if constexpr (kDim == 1) {
+      invertible &= (V::AnyNearZero(h[0][0], kNearZeroDet) == false);
+      V::Store(beam + sc, V::template Recip<kPrecision>(h[0][0]));
+    } else {
+      T adj[kDim][kDim];
+      T det;
+      if constexpr (kDim == 2) {
+        Adjugate2x2<V>(h, adj, det);
+      } else {
+        static_assert(kDim == 4, "Unsupported small-MIMO dimension");
+        Adjugate4x4<V>(h, adj, det);
+      }
+      invertible &= (V::AnyNearZero(det, kNearZeroDet) == false);
+      const T inv_det = V::template Recip<kPrecision>(det);
+      for (size_t i = 0; i < kDim; i++) {
+        for (size_t j = 0; j < kDim; j++) {
+          V::Store(beam + (i * kDim + j) * num_scs + sc,
+                   V::Mul(adj[i][j], inv_det));
+        }
+      }
+    }
+  }
+  return invertible;
+}
+
+template <class V, size_t kDim>
+void Equalize(const complex_float* beam, const complex_float* data,
+              ChunkLayout data_layout, complex_float* const* equal,
+              size_t num_scs) {
+  using T = typename V::T;
+  for (size_t sc = 0; sc < num_scs; sc += V::kScs) {
+    T b[kDim];
+    for (size_t j = 0; j < kDim; j++) {
+      b[j] = V::Load(data + ChunkOffset(data_layout, sc, j));
+    }
+    for (size_t i = 0; i < kDim; i++) {
+      T temp[kDim];
+      for (size_t j = 0; j < kDim; j++) {
+        temp[j] = V::Mul(V::Load(beam + (i * kDim + j) * num_scs + sc), b[j]);
+      }
+      // Pairwise sum, in the order of the fused equalization and demodulation
+      for (size_t step = 1; step < kDim; step *= 2) {
+        for (size_t j = 0; j + step < kDim; j += 2 * step) {
+          temp[j] = V::Add(temp[j], temp[j + step]);
+        }
+      }
+      V::Store(equal[i] + sc, temp[0]);
+    }
+  }
+}
+
+template <class V>
+void EqualizeGroup(complex_float beam, const complex_float* data,
+                   complex_float* equal, size_t num_scs) {
+  const typename V::T b = V::Set1(beam);
+  size_t sc = 0;
+  for (; sc + V::kScs <= num_scs; sc += V::kScs) {
+    V::Store(equal + sc, V::Mul(b, V::Load(data + sc)));
+  }
+  for (; sc < num_scs; sc++) {
+    equal[sc] = {beam.re * data[sc].re - beam.im * data[sc].im,
+                 beam.re * data[sc].im + beam.im * data[sc].re};
+  }
+}
+
+template <class V>
+complex_float PilotCorr(const complex_float* equal, const complex_float* pilot,
+                        size_t num_scs) {
+  typename V::T sum = V::Zero();
+  for (size_t sc = 0; sc < num_scs; sc += V::kScs) {
+    sum = V::Add(sum, V::MulConj(V::Load(equal + sc), V::Load(pilot + sc)));
+  }
+  return V::Sum(sum);
+}
+
+template <class V>
+void Rotate(complex_float* equal, complex_float phase, size_t num_scs) {
+  const typename V::T ph = V::Set1(phase);
+  for (size_t sc = 0; sc < num_scs; sc += V::kScs) {
+    V::Store(equal + sc, V::Mul(V::Load(equal + sc), ph));
+  }
+}
+
+template <class V>
+void FillOutput(const complex_float* src, const complex_float* pilot_sgn,
+                complex_float* dst, size_t dst_chunk_stride, size_t num_scs,
+                bool non_temporal) {
+  for (size_t sc = 0; sc < num_scs; sc += kSCsPerCacheline) {
+    complex_float* dst_chunk = dst + (sc / kSCsPerCacheline) * dst_chunk_stride;
+    for (size_t i = 0; i < kSCsPerCacheline; i += V::kScs) {
+      typename V::T v = V::LoadAligned(src + sc + i);
+      if (pilot_sgn != nullptr) {
+        v = V::MulConj(v, V::Load(pilot_sgn + sc + i));
+      }
+      if (non_temporal) {
+        V::Stream(dst_chunk + i, v);
+      } else {
+        V::Store(dst_chunk + i, v);
+      }
+    }
+  }
+}
+
+template <class V, FastMath::Precision kPrecision>
+Kernels MakeKernels(Isa isa) {
+  static_assert(kSCsPerCacheline % V::kScs == 0);
+  return Kernels{isa,
+                 kPrecision,
+                 {&Invert<V, 1, kPrecision>, &Invert<V, 2, kPrecision>,
+                  &Invert<V, 4, kPrecision>},
+                 {&Equalize<V, 1>, &Equalize<V, 2>, &Equalize<V, 4>},
+                 &EqualizeGroup<V>,
+                 &PilotCorr<V>,
+                 &Rotate<V>,
+                 &FillOutput<V>};
+}
+
+// The kernels of every precision, indexed by FastMath::Precision
+template <class V>
+std::array<Kernels, FastMath::kNumPrecisions> MakeKernelTiers(Isa isa) {
+  return {MakeKernels<V, FastMath::Precision::kExact>(isa),
+          MakeKernels<V, FastMath::Precision::kRefined>(isa),
+          MakeKernels<V, FastMath::Precision::kApprox>(isa)};
+}
+
+}  // namespace
+}  // namespace SmallMimo
+
+#endif  // SMALL_MIMO_KERNELS_IMPL_H_
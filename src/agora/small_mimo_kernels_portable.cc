@@ -0,0 +1,60 @@
+/**
+ * @file small_mimo_kernels_portable.cc
+ * @brief The 128-bit version of the small-MIMO kernels, on the portable
+ * vectors of simd_portable.h: NEON on aarch64, SSE on x86.
+ */
+#include "small_mimo_kernels.h"
+
+#include "simd_portable.h"
+#include "small_mimo_kernels_impl.h"
+
+namespace SmallMimo {
+
+namespace {
+struct PortableVec {
+  using T = PortableSimd::F32x4;
+  static constexpr size_t kScs = PortableSimd::kCxPerVec;
+
+  static inline T Load(const complex_float* src) {
+    return PortableSimd::Load<T>(src);
+  }
+  static inline T LoadAligned(const complex_float* src) {
+    return PortableSimd::Load<T>(src);
+  }
+  static inline void Store(complex_float* dst, T v) {
+    PortableSimd::Store(dst, v);
+  }
+  // No portable non-temporal store
+  static inline void Stream(complex_float* dst, T v) {
+    PortableSimd::Store(dst, v);
+  }
+  static inline T Zero() { return T{}; }
+  static inline T Set1(complex_float v) {
+    return PortableSimd::Set1(std::complex<float>(v.re, v.im));
+  }
+  static inline T Add(T a, T b) { return a + b; }
+  static inline T Sub(T a, T b) { return a - b; }
+  static inline T Mul(T a, T b) { return PortableSimd::ComplexCf32Mult(a, b); }
+  static inline T MulConj(T a, T b) {
+    return PortableSimd::ComplexCf32MultConj(a, b);
+  }
+  template <FastMath::Precision kPrecision>
+  static inline T Recip(T a) {
+    return PortableSimd::ComplexCf32Reciprocal(a);
+  }
+  static inline bool AnyNearZero(T a, float threshold) {
+    return PortableSimd::ComplexCf32NearZeros(a, threshold);
+  }
+  static inline complex_float Sum(T a) {
+    const std::complex<float> sum = PortableSimd::ComplexCf32Sum(a);
+    return {sum.real(), sum.imag()};
+  }
+};
+}  // namespace
+
+const Kernels* PortableKernels(FastMath::Precision precision) {
+  static const auto kKernels = MakeKernelTiers<PortableVec>(Isa::kPortable);
+  return &kKernels.at(static_cast<size_t>(precision));
+}
+
+}  // namespace SmallMimo
@@ -0,0 +1,153 @@
+/**
+ * @file stall_monitor.cc
+ * @brief Implementation file for the StallMonitor class
+ */
+#include "stall_monitor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#include "event_tracer.h"
+#include "logger.h"
+
+// Time between two checks of the monitor thread
+static constexpr auto kCheckInterval = std::chrono::milliseconds(1);
+
+WorkerProgress::Snapshot WorkerProgress::Read() const {
+  Snapshot task;
+  task.tasks_ = tasks_.load(std::memory_order_acquire);
+  task.start_tsc_ = start_tsc_.load(std::memory_order_acquire);
+  task.event_type_ =
+      static_cast<EventType>(event_type_.load(std::memory_order_relaxed));
+  task.tag_ = tag_.load(std::memory_order_relaxed);
+  // The worker went on to another task while it was read
+  if (tasks_.load(std::memory_order_acquire) != task.tasks_) {
+    task.start_tsc_ = 0;
+  }
+  return task;
+}
+
+void WorkerProgress::AddDurations(EventType event_type,
+                                  Durations& durations) const {
+  const auto& counts = durations_.at(static_cast<size_t>(event_type));
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    durations.at(i) += counts.at(i).load(std::memory_order_relaxed);
+  }
+}
+
+StallMonitor::StallMonitor(size_t num_workers, double factor, double min_us,
+                           double freq_ghz,
+                           std::function<std::string()> describe)
+    : num_workers_(num_workers),
+      factor_(factor),
+      freq_ghz_(freq_ghz),
+      min_cycles_(GetTime::UsToCycles(min_us, freq_ghz)),
+      describe_(std::move(describe)),
+      workers_(std::make_unique<WorkerProgress[]>(num_workers)),
+      reported_task_(std::make_unique<size_t[]>(num_workers)) {
+  for (size_t i = 0; i < num_workers_; i++) {
+    reported_task_[i] = SIZE_MAX;
+  }
+}
+
+StallMonitor::~StallMonitor() {
+  running_.store(false);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void StallMonitor::Start() {
+  running_.store(true);
+  thread_ = std::thread(&StallMonitor::MonitorThread, this);
+}
+
+void StallMonitor::MonitorThread() {
+  while (running_.load() == true) {
+    Check();
+    std::this_thread::sleep_for(kCheckInterval);
+  }
+}
+
+size_t StallMonitor::StallCycles(EventType event_type) const {
+  WorkerProgress::Durations durations{};
+  size_t num_tasks = 0;
+  for (size_t i = 0; i < num_workers_; i++) {
+    workers_[i].AddDurations(event_type, durations);
+  }
+  for (const size_t count : durations) {
+    num_tasks += count;
+  }
+  if (num_tasks < kMinSamples) {
+    return min_cycles_;
+  }
+  // Upper end of the bucket of the 99th percentile
+  const size_t target = num_tasks - (num_tasks / 100);
+  size_t seen = 0;
+  size_t bucket = 0;
+  for (; bucket < WorkerProgress::kNumBuckets - 1; bucket++) {
+    seen += durations.at(bucket);
+    if (seen >= target) {
+      break;
+    }
+  }
+  const auto p99_cycles = static_cast<double>(2ul << bucket);
+  return std::max(min_cycles_, static_cast<size_t>(factor_ * p99_cycles));
+}
+
+size_t StallMonitor::Check() {
+  const size_t now_tsc = GetTime::Rdtsc();
+  size_t num_stalls = 0;
+  for (size_t i = 0; i < num_workers_; i++) {
+    const WorkerProgress::Snapshot task = workers_[i].Read();
+    if ((task.start_tsc_ == 0) || (task.start_tsc_ > now_tsc) ||
+        (reported_task_[i] == task.tasks_) ||
+        (now_tsc - task.start_tsc_ < min_cycles_)) {
+      continue;
+    }
+    const size_t stall_cycles = StallCycles(task.event_type_);
+    if (now_tsc - task.start_tsc_ < stall_cycles) {
+      continue;
+    }
+    reported_task_[i] = task.tasks_;
+    num_stalls++;
+    Report(i, task, now_tsc, stall_cycles);
+  }
+  stalls_.store(stalls_.load(std::memory_order_relaxed) + num_stalls,
+                std::memory_order_relaxed);
+  return num_stalls;
+}
+
+void StallMonitor::Report(size_t tid, const WorkerProgress::Snapshot& task,
+                          size_t now_tsc, size_t stall_cycles) const {
+  std::string report;
+  char line[256];
+  std::snprintf(line, sizeof(line),
+                "StallMonitor: worker %zu stalled in %s %s for %.1f us "
+                "(stall after %.1f us)\n",
+                tid, EventTracer::EventTypeName(task.event_type_),
+                gen_tag_t(task.tag_).ToString().c_str(),
+                GetTime::CyclesToUs(now_tsc - task.start_tsc_, freq_ghz_),
+                GetTime::CyclesToUs(stall_cycles, freq_ghz_));
+  report += line;
+  for (size_t i = 0; i < num_workers_; i++) {
+    const WorkerProgress::Snapshot other = workers_[i].Read();
+    if ((other.start_tsc_ == 0) || (other.start_tsc_ > now_tsc)) {
+      std::snprintf(line, sizeof(line),
+                    "  worker %-3zu %10zu tasks, between tasks\n", i,
+                    other.tasks_);
+    } else {
+      std::snprintf(line, sizeof(line),
+                    "  worker %-3zu %10zu tasks, in %s %s for %.1f us\n", i,
+                    other.tasks_, EventTracer::EventTypeName(other.event_type_),
+                    gen_tag_t(other.tag_).ToString().c_str(),
+                    GetTime::CyclesToUs(now_tsc - other.start_tsc_, freq_ghz_));
+    }
+    report += line;
+  }
+  if (describe_) {
+    report += "  " + describe_() + "\n";
+  }
+  AGORA_LOG_ERROR("%s", report.c_str());
+}
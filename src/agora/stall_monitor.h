@@ -0,0 +1,139 @@
+/**
+ * @file stall_monitor.h
+ * @brief Declaration file for the StallMonitor class, whose thread watches
+ * the progress of the worker threads and reports the tasks that run for far
+ * longer than usual.
+ */
+#ifndef STALL_MONITOR_H_
+#define STALL_MONITOR_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gettime.h"
+#include "message.h"
+#include "symbols.h"
+
+/// Progress of one worker thread: the tasks it ran, the task it runs and the
+/// durations of its tasks by event type. Only the worker writes it, and the
+/// monitor thread reads it at any time.
+class alignas(64) WorkerProgress {
+ public:
+  /// Log2 buckets of the task durations in TSC cycles
+  static constexpr size_t kNumBuckets = 40;
+  using Durations = std::array<size_t, kNumBuckets>;
+
+  /// Before the worker runs event
+  inline void Begin(const EventData& event) {
+    event_type_.store(static_cast<size_t>(event.event_type_),
+                      std::memory_order_relaxed);
+    tag_.store(event.tags_[0], std::memory_order_relaxed);
+    start_tsc_.store(GetTime::Rdtsc(), std::memory_order_release);
+  }
+
+  /// After the worker ran the event of Begin()
+  inline void End() {
+    const size_t cycles =
+        GetTime::Rdtsc() - start_tsc_.load(std::memory_order_relaxed);
+    const size_t bucket = std::min(
+        (cycles == 0) ? 0 : static_cast<size_t>(63 - __builtin_clzl(cycles)),
+        kNumBuckets - 1);
+    std::atomic<size_t>& count =
+        durations_[event_type_.load(std::memory_order_relaxed)][bucket];
+    // There is a single writer, so no read-modify-write is needed
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    start_tsc_.store(0, std::memory_order_relaxed);
+    tasks_.store(tasks_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  }
+
+  /// The task in progress, as read by another thread
+  struct Snapshot {
+    size_t tasks_;
+    // 0 if the worker is between tasks
+    size_t start_tsc_;
+    EventType event_type_;
+    size_t tag_;
+  };
+  Snapshot Read() const;
+
+  /// Add the task durations of event_type to durations
+  void AddDurations(EventType event_type, Durations& durations) const;
+
+ private:
+  std::atomic<size_t> tasks_{0};
+  std::atomic<size_t> start_tsc_{0};
+  std::atomic<size_t> event_type_{0};
+  std::atomic<size_t> tag_{0};
+  std::array<std::array<std::atomic<size_t>, kNumBuckets>, kNumEventTypes>
+      durations_{};
+};
+
+/**
+ * @brief The progress of every worker thread, and a thread that checks it
+ * every millisecond. A task stalls once it runs for factor times the 99th
+ * percentile of the tasks of its event type over all workers, and for at
+ * least min_us. The monitor logs each stalled task once, with the state of
+ * every worker and the description of the queues from its caller.
+ */
+class StallMonitor {
+ public:
+  /// Tasks of an event type before its percentile counts, min_us before
+  static constexpr size_t kMinSamples = 100;
+
+  /**
+   * @param describe Called by the monitor thread for the state of the
+   * queues in a report. Must be safe to call from any thread.
+   */
+  StallMonitor(size_t num_workers, double factor, double min_us,
+               double freq_ghz, std::function<std::string()> describe);
+  /// Stop the monitor thread
+  ~StallMonitor();
+
+  StallMonitor(const StallMonitor&) = delete;
+  StallMonitor& operator=(const StallMonitor&) = delete;
+
+  inline WorkerProgress* Worker(size_t tid) { return &workers_[tid]; }
+
+  /// Run the checks of the monitor thread from this thread, which must not
+  /// be started. Returns the stalls found.
+  size_t Check();
+  /// Start the thread that checks every millisecond
+  void Start();
+
+  /// Stalled tasks found so far
+  inline size_t Stalls() const {
+    return stalls_.load(std::memory_order_relaxed);
+  }
+  /// Time after which a task of event_type stalls, in TSC cycles
+  size_t StallCycles(EventType event_type) const;
+
+ private:
+  void MonitorThread();
+  /// Log a stalled task of worker tid, with the state of all the workers
+  void Report(size_t tid, const WorkerProgress::Snapshot& task,
+              size_t now_tsc, size_t stall_cycles) const;
+
+  const size_t num_workers_;
+  const double factor_;
+  const double freq_ghz_;
+  const size_t min_cycles_;
+  const std::function<std::string()> describe_;
+  std::unique_ptr<WorkerProgress[]> workers_;
+  // Monitor thread only: the task count of each worker at its last report,
+  // so that a task is reported once
+  std::unique_ptr<size_t[]> reported_task_;
+  std::atomic<size_t> stalls_{0};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+#endif  // STALL_MONITOR_H_
@@ -4,9 +4,13 @@
  */
 #include "stats.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <typeinfo>
 
 #include "gettime.h"
+#include "heap_counter.h"
 #include "logger.h"
 
 static const std::string kProjectDir = TOSTRING(PROJECT_DIRECTORY);
@@ -17,6 +21,36 @@ static const std::string kStatsDataFilename =
 static const std::string kStatsDetailedDataFilename =
     kStatsOutputFilePath + "timeresult_detail.txt";
 
+// A node of a split carrier tags its results with its node id
+static std::string NodeFilename(const std::string& filename,
+                                const Config* cfg) {
+  if (cfg->ScSliceNodes() == 1) {
+    return filename;
+  }
+  const size_t dot = filename.rfind('.');
+  return filename.substr(0, dot) + "_node" +
+         std::to_string(cfg->ScSliceNode()) + filename.substr(dot);
+}
+
+// Names of the timestamp types, as used by "stage_deadlines_us"
+static const std::array<std::string, kNumTimestampTypes> kTsTypeNames = {
+    "first_symbol_rx", "processing_started", "pilot_all_rx",
+    "rc_all_rx",       "fft_pilots_done",    "beam_done",
+    "demul_done",      "rx_done",            "rc_done",
+    "encode_done",     "decode_done",        "precode_done",
+    "ifft_done",       "broadcast_done",     "tx_processed_first",
+    "tx_done",         "modul_done",         "fft_done",
+    "mac_delivered"};
+
+// Stages timed against the end of the last uplink symbol on air, and
+// against the end of the last downlink symbol on air
+static constexpr std::array<TsType, 4> kAirUlStages = {
+    TsType::kRXDone, TsType::kDemulDone, TsType::kDecodeDone,
+    TsType::kMacDelivered};
+static constexpr std::array<TsType, 4> kAirDlStages = {
+    TsType::kEncodeDone, TsType::kPrecodeDone, TsType::kIFFTDone,
+    TsType::kTXDone};
+
 Stats::Stats(const Config* const cfg)
     : config_(cfg),
       task_thread_num_(cfg->WorkerThreadNum()),
@@ -25,13 +59,32 @@ Stats::Stats(const Config* const cfg)
       demul_thread_num_(cfg->DemulThreadNum()),
       decode_thread_num_(cfg->DecodeThreadNum()),
       freq_ghz_(cfg->FreqGhz()),
-      creation_tsc_(GetTime::Rdtsc()) {
+      creation_tsc_(GetTime::Rdtsc()),
+      task_hists_(
+          std::make_unique<WorkerTaskHistograms[]>(cfg->WorkerThreadNum())),
+      cycles_per_sample_(cfg->FreqGhz() * 1e9 / cfg->Rate()) {
   frame_start_.Calloc(config_->SocketThreadNum(), kNumStatsFrames,
                       Agora_memory::Alignment_t::kAlign64);
+
+  for (const auto& deadline : config_->StageDeadlinesUs()) {
+    const auto name = std::find(kTsTypeNames.begin(), kTsTypeNames.end(),
+                                deadline.first);
+    RtAssert(name != kTsTypeNames.end(),
+             "Unknown stage " + deadline.first + " in stage_deadlines_us");
+    RtAssert(deadline.second > 0.0, "Stage deadlines must be positive");
+    deadlines_us_.at(name - kTsTypeNames.begin()) = deadline.second;
+  }
+  if (config_->UlMiniSlotSymbols() > 0) {
+    mini_slot_latency_hists_.resize(config_->UlMiniSlots());
+  }
 }
 
 Stats::~Stats() { frame_start_.Free(); }
 
+const std::string& Stats::TsTypeName(TsType timestamp_type) {
+  return kTsTypeNames.at(static_cast<size_t>(timestamp_type));
+}
+
 void Stats::PopulateSummary(FrameSummary* frame_summary, size_t thread_id,
                             DoerType doer_type) {
   DurationStat* ds = GetDurationStat(doer_type, thread_id);
@@ -120,6 +173,15 @@ void Stats::UpdateStats(size_t frame_id) {
       ComputeAvgOverThreads(&summary, task_thread_num_, break_down_num_);
     }
 
+    for (size_t j = 0u; j < kAllDoerTypes.size(); j++) {
+      const FrameSummary& summary = work_summary.at(j);
+      this->task_us_.at(static_cast<size_t>(kAllDoerTypes.at(j))) =
+          (summary.count_all_threads_ > 0)
+              ? (summary.us_avg_threads_.at(0u) * task_thread_num_) /
+                    summary.count_all_threads_
+              : 0.0;
+    }
+
     double sum_us = 0.0f;
     for (size_t i = 0u; i < this->doer_us_.size(); i++) {
       double us_avg = work_summary.at(i).us_avg_threads_.at(0u);
@@ -149,9 +211,9 @@ void Stats::UpdateStats(size_t frame_id) {
 }
 
 void Stats::SaveToFile() {
-  AGORA_LOG_INFO("Stats: Saving master timestamps to %s\n",
-                 kStatsDataFilename.c_str());
-  FILE* fp_debug = std::fopen(kStatsDataFilename.c_str(), "w");
+  const std::string filename = NodeFilename(kStatsDataFilename, config_);
+  AGORA_LOG_INFO("Stats: Saving master timestamps to %s\n", filename.c_str());
+  FILE* fp_debug = std::fopen(filename.c_str(), "w");
   RtAssert(fp_debug != nullptr,
            std::string("Open file failed ") + std::to_string(errno));
 
@@ -269,11 +331,12 @@ void Stats::SaveToFile() {
   std::fclose(fp_debug);
 
   if (kIsWorkerTimingEnabled == true) {
+    const std::string detailed_filename =
+        NodeFilename(kStatsDetailedDataFilename, config_);
     AGORA_LOG_INFO("Stats: Printing detailed results to %s\n",
-                   kStatsDetailedDataFilename.c_str());
+                   detailed_filename.c_str());
 
-    FILE* fp_debug_detailed =
-        std::fopen(kStatsDetailedDataFilename.c_str(), "w");
+    FILE* fp_debug_detailed = std::fopen(detailed_filename.c_str(), "w");
     RtAssert(fp_debug_detailed != nullptr,
              std::string("Open file failed ") + std::to_string(errno));
     // Print the header
@@ -345,6 +408,301 @@ size_t Stats::GetTotalTaskCount(DoerType doer_type, size_t thread_num) {
   return total_count;
 }
 
+void Stats::RecordTaskDurations(size_t thread_id) {
+  WorkerTaskHistograms& worker = task_hists_[thread_id];
+  for (size_t i = 0; i < kNumDoerTypes; i++) {
+    const DurationStat& cur = worker_durations_[thread_id].duration_stat_[i];
+    DurationStat& last = worker.last_.at(i);
+    if (cur.task_count_ <= last.task_count_) {
+      continue;
+    }
+    const size_t num_tasks = cur.task_count_ - last.task_count_;
+    for (size_t j = 0; j < kMaxStatBreakdown; j++) {
+      // Some doers overwrite instead of accumulate a breakdown
+      if (cur.task_duration_.at(j) > last.task_duration_.at(j)) {
+        worker.hists_.at(i).at(j).Record(
+            (cur.task_duration_.at(j) - last.task_duration_.at(j)) /
+            num_tasks);
+      }
+    }
+    last = cur;
+  }
+}
+
+TaskHistogramSnapshot Stats::SnapshotTaskHistograms() const {
+  TaskHistogramSnapshot snapshot{};
+  for (size_t tid = 0; tid < task_thread_num_; tid++) {
+    for (size_t i = 0; i < kNumDoerTypes; i++) {
+      for (size_t j = 0; j < kMaxStatBreakdown; j++) {
+        const CycleHistogram& hist = task_hists_[tid].hists_.at(i).at(j);
+        for (size_t b = 0; b < CycleHistogram::kNumBuckets; b++) {
+          snapshot.at(i).at(j).at(b) +=
+              hist.counts_.at(b).load(std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+  return snapshot;
+}
+
+size_t Stats::AccOpsInFlight() const {
+  size_t num_ops = 0;
+  for (size_t tid = 0; tid < task_thread_num_; tid++) {
+    for (const auto& dir_ops : task_hists_[tid].acc_ops_in_flight_) {
+      num_ops += dir_ops.load(std::memory_order_relaxed);
+    }
+  }
+  return num_ops;
+}
+
+size_t Stats::AccDecodeBlocks(bool spilled) const {
+  size_t num_blocks = 0;
+  for (size_t tid = 0; tid < task_thread_num_; tid++) {
+    num_blocks += task_hists_[tid].acc_decode_blocks_[spilled ? 1 : 0].load(
+        std::memory_order_relaxed);
+  }
+  return num_blocks;
+}
+
+// Upper bound of the bucket holding the percentile of a cycle histogram, in
+// microseconds. 0 if there are no samples.
+static double CycleHistogramPercentileUs(
+    const std::array<size_t, CycleHistogram::kNumBuckets>& counts,
+    size_t num_samples, double percentile, double freq_ghz) {
+  const auto rank = std::max(
+      static_cast<size_t>(std::ceil(percentile / 100.0 * num_samples)), 1ul);
+  size_t seen = 0;
+  for (size_t b = 0; b < counts.size(); b++) {
+    seen += counts.at(b);
+    if (seen >= rank) {
+      return GetTime::CyclesToUs(2ul << b, freq_ghz);
+    }
+  }
+  return 0.0;
+}
+
+void Stats::PrintTaskDurationReport() const {
+  const TaskHistogramSnapshot snapshot = SnapshotTaskHistograms();
+  std::string report =
+      "Stats: task durations (p50/p99/p99.9/max us, upper bucket bounds)\n";
+  for (const auto& doer_name : kDoerNames) {
+    const auto& counts =
+        snapshot.at(static_cast<size_t>(doer_name.first)).at(0);
+    size_t num_samples = 0;
+    size_t max_bucket = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+      num_samples += counts.at(b);
+      if (counts.at(b) > 0) {
+        max_bucket = b;
+      }
+    }
+    if (num_samples == 0) {
+      continue;
+    }
+    char line[256];
+    std::snprintf(
+        line, sizeof(line), "  %-12s %9.2f %9.2f %9.2f %9.2f (%zu tasks)\n",
+        doer_name.second.c_str(),
+        CycleHistogramPercentileUs(counts, num_samples, 50.0, freq_ghz_),
+        CycleHistogramPercentileUs(counts, num_samples, 99.0, freq_ghz_),
+        CycleHistogramPercentileUs(counts, num_samples, 99.9, freq_ghz_),
+        GetTime::CyclesToUs(2ul << max_bucket, freq_ghz_), num_samples);
+    report += line;
+  }
+  AGORA_LOG_INFO("%s", report.c_str());
+}
+
+double Stats::MasterFrameLatencyUs(TsType timestamp_type,
+                                   size_t frame_id) const {
+  // The timestamps this frame did not take are still those of an older frame
+  if (MasterGetTsc(timestamp_type, frame_id) <
+      MasterGetTsc(TsType::kFirstSymbolRX, frame_id)) {
+    return NAN;
+  }
+  return MasterGetDeltaUs(timestamp_type, TsType::kFirstSymbolRX, frame_id);
+}
+
+void Stats::MasterSetAirTsc(size_t frame_id, size_t symbol_id,
+                            size_t air_tsc) {
+  FrameTsc& start = air_start_tsc_.at(frame_id % kNumStatsFrames);
+  if (start.frame_id_ == frame_id) {
+    return;
+  }
+  start.frame_id_ = frame_id;
+  // air_tsc is the end of the symbol
+  start.tsc_ = static_cast<double>(air_tsc) -
+               (cycles_per_sample_ *
+                static_cast<double>(config_->SymbolTimeOffset(0, symbol_id) +
+                                    config_->SampsPerSymbol()));
+}
+
+double Stats::AirEndTsc(size_t frame_id, size_t symbol_id,
+                        size_t frame_delta) const {
+  const FrameTsc& start = air_start_tsc_.at(frame_id % kNumStatsFrames);
+  if ((start.frame_id_ != frame_id) || (symbol_id == SIZE_MAX)) {
+    return NAN;
+  }
+  const long long end_offset =
+      config_->SymbolTimeOffset(frame_id + frame_delta, symbol_id) -
+      config_->SymbolTimeOffset(frame_id, 0) + config_->SampsPerSymbol();
+  return start.tsc_ + (cycles_per_sample_ * static_cast<double>(end_offset));
+}
+
+double Stats::MasterUsFromAir(TsType timestamp_type, size_t frame_id,
+                              double air_tsc) const {
+  if (std::isnan(MasterFrameLatencyUs(timestamp_type, frame_id))) {
+    return NAN;
+  }
+  return (static_cast<double>(MasterGetTsc(timestamp_type, frame_id)) -
+          air_tsc) /
+         (freq_ghz_ * 1e3);
+}
+
+double Stats::MasterAirToMacUs(size_t frame_id) const {
+  return MasterUsFromAir(
+      kEnableMac ? TsType::kMacDelivered : TsType::kDecodeDone, frame_id,
+      AirEndTsc(frame_id, config_->Frame().GetULSymbolLast(), 0));
+}
+
+double Stats::MasterMacToAirUs(size_t frame_id) const {
+  const FrameTsc& ready = mac_dl_ready_tsc_.at(frame_id % kNumStatsFrames);
+  if ((ready.frame_id_ != frame_id) ||
+      std::isnan(MasterFrameLatencyUs(TsType::kTXDone, frame_id))) {
+    return NAN;
+  }
+  // The radios transmit the downlink TX_FRAME_DELTA frames after its uplink
+  return (AirEndTsc(frame_id, config_->Frame().GetDLSymbolLast(),
+                    TX_FRAME_DELTA) -
+          ready.tsc_) /
+         (freq_ghz_ * 1e3);
+}
+
+void Stats::MasterRecordFrameLatency(size_t frame_id) {
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    const auto timestamp_type = static_cast<TsType>(i);
+    if (timestamp_type == TsType::kFirstSymbolRX) {
+      continue;
+    }
+    const double latency_us = MasterFrameLatencyUs(timestamp_type, frame_id);
+    if (std::isnan(latency_us)) {
+      continue;
+    }
+    latency_hists_.at(i).Record(latency_us);
+    if ((deadlines_us_.at(i) > 0.0) && (latency_us > deadlines_us_.at(i))) {
+      deadline_misses_.at(i)++;
+    }
+  }
+
+  // NaN without hardware timestamps, or without uplink or downlink symbols
+  const double ul_air_tsc =
+      AirEndTsc(frame_id, config_->Frame().GetULSymbolLast(), 0);
+  const double dl_air_tsc = AirEndTsc(
+      frame_id, config_->Frame().GetDLSymbolLast(), TX_FRAME_DELTA);
+  for (const TsType stage : kAirUlStages) {
+    const double us = MasterUsFromAir(stage, frame_id, ul_air_tsc);
+    if (std::isnan(us) == false) {
+      air_ul_hists_.at(static_cast<size_t>(stage)).Record(us);
+    }
+  }
+  for (const TsType stage : kAirDlStages) {
+    const double us = MasterUsFromAir(stage, frame_id, dl_air_tsc);
+    if (std::isnan(us) == false) {
+      air_dl_hists_.at(static_cast<size_t>(stage)).Record(-us);
+    }
+  }
+  const double mac_to_air_us = MasterMacToAirUs(frame_id);
+  if (std::isnan(mac_to_air_us) == false) {
+    mac_to_air_hist_.Record(mac_to_air_us);
+  }
+
+  const size_t report_interval = config_->LatencyReportInterval();
+  if ((report_interval > 0) && (((frame_id + 1) % report_interval) == 0)) {
+    PrintLatencyReport();
+    if (kIsWorkerTimingEnabled) {
+      PrintTaskDurationReport();
+    }
+    PrintPageFaultReport();
+  }
+}
+
+void Stats::PrintLatencyReport() const {
+  std::string report = "Stats: latency from first RX (p50/p99/p99.9/max us";
+  report += ", deadline misses)\n";
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    const LatencyHistogram& hist = latency_hists_.at(i);
+    if (hist.Count() == 0) {
+      continue;
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "  %-20s %9.1f %9.1f %9.1f %9.1f", kTsTypeNames.at(i).c_str(),
+                  hist.PercentileUs(50.0), hist.PercentileUs(99.0),
+                  hist.PercentileUs(99.9), hist.MaxUs());
+    report += line;
+    if (deadlines_us_.at(i) > 0.0) {
+      std::snprintf(line, sizeof(line), "  %zu of %zu over %.1f us",
+                    deadline_misses_.at(i), hist.Count(), deadlines_us_.at(i));
+      report += line;
+    }
+    report += "\n";
+  }
+  for (size_t i = 0; i < mini_slot_latency_hists_.size(); i++) {
+    const LatencyHistogram& hist = mini_slot_latency_hists_.at(i);
+    if (hist.Count() == 0) {
+      continue;
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "  ul_mini_slot_%-7zu %9.1f %9.1f %9.1f %9.1f\n", i,
+                  hist.PercentileUs(50.0), hist.PercentileUs(99.0),
+                  hist.PercentileUs(99.9), hist.MaxUs());
+    report += line;
+  }
+  AGORA_LOG_INFO("%s", report.c_str());
+  PrintAirLatencyReport();
+}
+
+// A line of the percentiles of a histogram, if it has samples
+static void AppendAirLatency(std::string& report, const std::string& name,
+                             const LatencyHistogram& hist) {
+  if (hist.Count() == 0) {
+    return;
+  }
+  char line[256];
+  std::snprintf(line, sizeof(line), "  %-20s %9.1f %9.1f %9.1f %9.1f\n",
+                name.c_str(), hist.PercentileUs(50.0),
+                hist.PercentileUs(99.0), hist.PercentileUs(99.9),
+                hist.MaxUs());
+  report += line;
+}
+
+void Stats::PrintAirLatencyReport() const {
+  std::string ul_report;
+  for (const TsType stage : kAirUlStages) {
+    AppendAirLatency(ul_report, TsTypeName(stage),
+                     air_ul_hists_.at(static_cast<size_t>(stage)));
+  }
+  std::string dl_report;
+  AppendAirLatency(dl_report, "mac_dl_ready", mac_to_air_hist_);
+  for (const TsType stage : kAirDlStages) {
+    AppendAirLatency(dl_report, TsTypeName(stage),
+                     air_dl_hists_.at(static_cast<size_t>(stage)));
+  }
+  // Only with hardware timestamps
+  if (ul_report.empty() == false) {
+    AGORA_LOG_INFO(
+        "Stats: latency from the end of the last uplink symbol on air "
+        "(p50/p99/p99.9/max us)\n%s",
+        ul_report.c_str());
+  }
+  if (dl_report.empty() == false) {
+    AGORA_LOG_INFO(
+        "Stats: latency to the end of the last downlink symbol on air "
+        "(p50/p99/p99.9/max us)\n%s",
+        dl_report.c_str());
+  }
+}
+
 void Stats::PrintSummary() {
   AGORA_LOG_INFO("Stats: total processed frames %zu\n",
                  this->last_frame_id_ + 1);
@@ -448,6 +806,175 @@ void Stats::PrintSummary() {
       std::printf("\n");
     }
   }  // kIsWorkerTimingEnabled == true
+
+  if (config_->WorkStealing()) {
+    size_t total_steals = 0;
+    std::printf("Stolen tasks per thread: ");
+    for (size_t i = 0; i < task_thread_num_; i++) {
+      std::printf("%zu ", worker_durations_[i].steal_count_);
+      total_steals += worker_durations_[i].steal_count_;
+    }
+    std::printf("(total %zu)\n", total_steals);
+  }
+  if (config_->DlDeadlineMarginUs() > 0.0) {
+    std::printf("Downlink frames dropped before their TX slot: %zu\n",
+                dl_dropped_frames_);
+  }
+  PrintLatencyReport();
+  if (kIsWorkerTimingEnabled) {
+    PrintTaskDurationReport();
+  }
+  if (HeapCounter::kEnabled) {
+    PrintHeapAllocReport();
+  }
+  if (config_->PerfSampleInterval() > 0) {
+    PrintPerfCounterReport();
+  }
+  PrintPageFaultReport();
+}
+
+void Stats::PrintPageFaultReport() {
+  const std::vector<PageFaults::ThreadCounts> threads =
+      PageFaults::Registered();
+  std::string report;
+  PageFaults::Counts total;
+  // The threads keep their position in the registration order
+  last_page_faults_.resize(threads.size());
+  for (size_t i = 0; i < threads.size(); i++) {
+    const PageFaults::ThreadCounts& thread = threads.at(i);
+    PageFaults::Counts& last = last_page_faults_.at(i);
+    const size_t minor = thread.counts_.minor_ - last.minor_;
+    const size_t major = thread.counts_.major_ - last.major_;
+    last = thread.counts_;
+    if ((minor == 0) && (major == 0)) {
+      continue;
+    }
+    total.minor_ += minor;
+    total.major_ += major;
+    char line[256];
+    std::snprintf(line, sizeof(line), "  %-24s %9zu %9zu\n",
+                  thread.name_.c_str(), minor, major);
+    report += line;
+  }
+  if (report.empty()) {
+    AGORA_LOG_INFO("Stats: no page faults in %zu threads since the last "
+                   "report\n",
+                   threads.size());
+    return;
+  }
+  AGORA_LOG_INFO(
+      "Stats: page faults since the last report (minor, major), %zu and "
+      "%zu in total\n%s",
+      total.minor_, total.major_, report.c_str());
+}
+
+void Stats::PrintHeapAllocReport() {
+  std::string report = "Stats: heap allocations by stage\n";
+  for (size_t i = 0; i < kNumDoerTypes; i++) {
+    size_t allocs = 0;
+    size_t tasks = 0;
+    for (size_t thread = 0; thread < task_thread_num_; thread++) {
+      const DurationStat* stat = GetDurationStat(kAllDoerTypes.at(i), thread);
+      allocs += stat->heap_allocs_;
+      tasks += stat->task_count_;
+    }
+    if ((tasks == 0) && (allocs == 0)) {
+      continue;
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line), "  %-12s %12zu (%.3f per task)\n",
+                  kDoerNames.at(kAllDoerTypes.at(i)).c_str(), allocs,
+                  static_cast<double>(allocs) / std::max<size_t>(tasks, 1));
+    report += line;
+  }
+  AGORA_LOG_INFO("%s", report.c_str());
+}
+
+void Stats::PrintPerfCounterReport() {
+  // One line of the report for the sampled events of a stat
+  const auto format = [this](const char* name, const DurationStat& stat) {
+    const auto count = [&stat](PerfCounters::Event event) {
+      return static_cast<double>(
+          stat.perf_counts_.at(static_cast<size_t>(event)));
+    };
+    const double events = static_cast<double>(stat.perf_events_);
+    const double cycles = std::max(count(PerfCounters::Event::kCycles), 1.0);
+    // Each miss of the last level cache brings a cache line from memory
+    const double miss_bytes = count(PerfCounters::Event::kLlcMisses) * 64.0;
+    const double ns = std::max(stat.perf_tsc_ / freq_ghz_, 1.0);
+    char stalls[32] = "n/a";
+    if (count(PerfCounters::Event::kFrontendStalls) > 0) {
+      std::snprintf(
+          stalls, sizeof(stalls), "%.1f%%",
+          count(PerfCounters::Event::kFrontendStalls) * 100.0 / cycles);
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "  %-12s %8zu events: IPC %.2f, %.0f instructions and "
+                  "%.1f LLC misses per event, LLC misses %.2f GB/s, "
+                  "frontend stalls %s\n",
+                  name, stat.perf_events_,
+                  count(PerfCounters::Event::kInstructions) / cycles,
+                  count(PerfCounters::Event::kInstructions) / events,
+                  count(PerfCounters::Event::kLlcMisses) / events,
+                  miss_bytes / ns, stalls);
+    return std::string(line);
+  };
+
+  std::string report =
+      "Stats: hardware counters by stage, 1 in " +
+      std::to_string(config_->PerfSampleInterval()) + " events sampled\n";
+  for (size_t i = 0; i < kNumDoerTypes; i++) {
+    DurationStat total;
+    std::string thread_lines;
+    for (size_t thread = 0; thread < task_thread_num_; thread++) {
+      const DurationStat* stat = GetDurationStat(kAllDoerTypes.at(i), thread);
+      if (stat->perf_events_ == 0) {
+        continue;
+      }
+      for (size_t j = 0; j < PerfCounters::kNumEvents; j++) {
+        total.perf_counts_.at(j) += stat->perf_counts_.at(j);
+      }
+      total.perf_events_ += stat->perf_events_;
+      total.perf_tsc_ += stat->perf_tsc_;
+      thread_lines +=
+          "  " + format(("thread " + std::to_string(thread)).c_str(), *stat);
+    }
+    if (total.perf_events_ > 0) {
+      report +=
+          format(kDoerNames.at(kAllDoerTypes.at(i)).c_str(), total) +
+          thread_lines;
+    }
+  }
+  AGORA_LOG_INFO("%s", report.c_str());
+}
+
+void Stats::PrintCyclesPerFrame(size_t num_frames) {
+  if ((kIsWorkerTimingEnabled == false) || (num_frames == 0)) {
+    return;
+  }
+  std::array<size_t, kNumDoerTypes> cycles{};
+  size_t total_cycles = 0;
+  for (size_t i = 0; i < kNumDoerTypes; i++) {
+    for (size_t thread = 0; thread < task_thread_num_; thread++) {
+      cycles.at(i) +=
+          GetDurationStat(kAllDoerTypes.at(i), thread)->task_duration_.at(0);
+    }
+    total_cycles += cycles.at(i);
+  }
+  std::string report = "Stats: worker kcycles per frame by stage\n";
+  for (size_t i = 0; i < kNumDoerTypes; i++) {
+    if (cycles.at(i) == 0) {
+      continue;
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line), "  %-12s %12.1f (%.1f%%)\n",
+                  kDoerNames.at(kAllDoerTypes.at(i)).c_str(),
+                  static_cast<double>(cycles.at(i)) / (num_frames * 1000.0),
+                  (static_cast<double>(cycles.at(i)) * 100.0) / total_cycles);
+    report += line;
+  }
+  AGORA_LOG_INFO("%s", report.c_str());
 }
 
 void Stats::PrintPerFrameDone(PrintType print_type, size_t frame_id) const {
@@ -6,14 +6,22 @@
 #ifndef STATS_H_
 #define STATS_H_
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "config.h"
 #include "gettime.h"
+#include "latency_histogram.h"
 #include "memory_manage.h"
 #include "message.h"
+#include "page_faults.h"
+#include "perf_counters.h"
 #include "symbols.h"
 
 static constexpr size_t kMaxStatBreakdown = 4;
@@ -22,10 +30,40 @@ static constexpr size_t kMaxStatBreakdown = 4;
 struct DurationStat {
   std::array<size_t, kMaxStatBreakdown> task_duration_;  // Unit = TSC cycles
   size_t task_count_;
+  // Heap allocations made by the tasks, counted with COUNT_HEAP_ALLOCS
+  size_t heap_allocs_;
+  // Hardware counters of the events sampled with perf_sample_interval, by
+  // PerfCounters::Event, with their number and TSC cycles
+  PerfCounters::Counts perf_counts_;
+  size_t perf_events_;
+  size_t perf_tsc_;
   DurationStat() { Reset(); }
   void Reset() { std::memset(this, 0, sizeof(DurationStat)); }
 };
 
+// Log-scale histogram of task durations: bucket i counts the tasks that took
+// [2^i, 2^(i+1)) TSC cycles. Written by one worker thread without locks, and
+// read by any thread while the worker runs.
+struct CycleHistogram {
+  static constexpr size_t kNumBuckets = 40;
+  std::array<std::atomic<size_t>, kNumBuckets> counts_{};
+
+  void Record(size_t cycles) {
+    const size_t log2_cycles =
+        (cycles == 0) ? 0 : static_cast<size_t>(63 - __builtin_clzl(cycles));
+    const size_t bucket = std::min(log2_cycles, kNumBuckets - 1);
+    // There is a single writer, so no read-modify-write is needed
+    counts_[bucket].store(counts_[bucket].load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+  }
+};
+
+// Task duration histograms of all workers, by doer type and breakdown index
+using TaskHistogramSnapshot =
+    std::array<std::array<std::array<size_t, CycleHistogram::kNumBuckets>,
+                          kMaxStatBreakdown>,
+               kNumDoerTypes>;
+
 // Temporary summary statistics assembled from per-thread runtime stats
 struct FrameSummary {
   std::array<double, kMaxStatBreakdown> us_this_thread_;
@@ -56,6 +94,7 @@ enum class TsType : size_t {
   kTXDone,
   kModulDone,
   kFFTDone,
+  kMacDelivered,  // Decoded data of all the UEs handed to the MAC
   kTsTypeEnd
 };
 static constexpr size_t kNumTimestampTypes =
@@ -173,6 +212,168 @@ class Stats {
                 .duration_stat_[static_cast<size_t>(doer_type)];
   }
 
+  /// Number of tasks worker thread_id took from the deques of other workers,
+  /// only updated by thread thread_id
+  size_t& StealCount(size_t thread_id) {
+    return this->worker_durations_[thread_id].steal_count_;
+  }
+
+  /// Mean time of one task of doer_type in the frame of the last
+  /// UpdateStats call, 0 if it ran none. Needs kIsWorkerTimingEnabled.
+  inline double TaskUs(DoerType doer_type) const {
+    return this->task_us_.at(static_cast<size_t>(doer_type));
+  }
+
+  /// From the master, count a frame whose downlink was dropped because it
+  /// could not meet its TX slot
+  void MasterDlFrameDropped() { this->dl_dropped_frames_++; }
+  inline size_t DlDroppedFrames() const { return this->dl_dropped_frames_; }
+
+  /// From worker thread_id after it ran an event, add the per-task duration
+  /// of each breakdown since its previous call to the histograms of the doer
+  /// types that completed tasks
+  void RecordTaskDurations(size_t thread_id);
+
+  /// Copy of the task duration histograms summed over all workers. Can be
+  /// taken from any thread without stopping the workers.
+  TaskHistogramSnapshot SnapshotTaskHistograms() const;
+
+  /// Log the task duration percentiles of every doer type with samples
+  void PrintTaskDurationReport() const;
+
+  /// Log the heap allocations of every doer type with tasks, counted with
+  /// COUNT_HEAP_ALLOCS
+  void PrintHeapAllocReport();
+
+  /// Log the hardware counters of every doer type with sampled events, and
+  /// of each of its worker threads, counted with perf_sample_interval
+  void PrintPerfCounterReport();
+
+  /// Log the minor and major page faults of every thread pinned with
+  /// PinToCoreWithOffset() since the last report, to check that the threads
+  /// are fault free once warmed up
+  void PrintPageFaultReport();
+
+  /// Log the worker cycles per frame spent in each doer type, summed over the
+  /// workers and averaged over num_frames frames
+  void PrintCyclesPerFrame(size_t num_frames);
+
+  /// From the master, the latency from the first received symbol of a frame
+  /// to timestamp_type in microseconds, NaN if the frame did not take it
+  /// (e.g. no downlink)
+  double MasterFrameLatencyUs(TsType timestamp_type, size_t frame_id) const;
+
+  /// From the master, the time from the creation of the stats to the first
+  /// received symbol of a frame in microseconds
+  double MasterFrameStartUs(size_t frame_id) const {
+    return MasterGetUsFromRef(TsType::kFirstSymbolRX, frame_id,
+                              this->creation_tsc_);
+  }
+
+  /// Mean time of the workers in doer_type in a frame of the last
+  /// kNumStatsFrames, in microseconds. Needs kIsWorkerTimingEnabled.
+  inline double DoerUs(DoerType doer_type, size_t frame_id) const {
+    return this->doer_us_.at(static_cast<size_t>(doer_type))
+        .at(frame_id % kNumStatsFrames);
+  }
+
+  /// From the master, add the latency from the first received symbol to
+  /// every timestamp of a completed frame to the latency histograms, and
+  /// count the stages that missed their deadline
+  void MasterRecordFrameLatency(size_t frame_id);
+
+  /// From the master, add the latency from the first received symbol of
+  /// frame_id to now to the histogram of mini_slot, once all its uplink data
+  /// symbols are decoded
+  void MasterRecordMiniSlotLatency(size_t frame_id, size_t mini_slot) {
+    this->mini_slot_latency_hists_.at(mini_slot).Record(
+        MasterGetUsSince(TsType::kFirstSymbolRX, frame_id));
+  }
+
+  /// From the master, take the time on air of a frame from a received
+  /// packet of symbol_id with a hardware timestamp (Packet::air_tsc_). The
+  /// first one of the frame counts.
+  void MasterSetAirTsc(size_t frame_id, size_t symbol_id, size_t air_tsc);
+
+  /// From the master, once the MAC handed over the downlink data of all the
+  /// UEs of a frame
+  void MasterSetMacDlReady(size_t frame_id) {
+    this->mac_dl_ready_tsc_.at(frame_id % kNumStatsFrames) = {
+        frame_id, static_cast<double>(GetTime::Rdtsc())};
+  }
+
+  /// Air-to-MAC latency of a frame: from the end of its last uplink symbol
+  /// on air to the delivery of its data to the MAC (to kDecodeDone without
+  /// the MAC), in microseconds. NaN if the frame has no uplink symbol or no
+  /// hardware timestamp.
+  double MasterAirToMacUs(size_t frame_id) const;
+
+  /// MAC-to-air latency of a frame: from MasterSetMacDlReady() to the end
+  /// of its last downlink symbol on air, in microseconds. NaN if the frame
+  /// has no downlink symbol, no hardware timestamp or no data from the MAC.
+  double MasterMacToAirUs(size_t frame_id) const;
+
+  /// Log the latency percentiles and deadline misses of every stage with
+  /// samples so far, and the stages against the time on air of the frames
+  /// with hardware timestamps
+  void PrintLatencyReport() const;
+
+  /// Latency from the first received symbol of a frame to timestamp_type
+  /// that percentile % of the frames do not exceed, in microseconds
+  double LatencyPercentileUs(TsType timestamp_type, double percentile) const {
+    return this->latency_hists_.at(static_cast<size_t>(timestamp_type))
+        .PercentileUs(percentile);
+  }
+
+  /// Frames that reached timestamp_type after its deadline
+  size_t DeadlineMisses(TsType timestamp_type) const {
+    return this->deadline_misses_.at(static_cast<size_t>(timestamp_type));
+  }
+
+  /// Latency from the first received symbol of a frame to the decode of
+  /// mini_slot that percentile % of the frames do not exceed, in microseconds
+  double MiniSlotLatencyPercentileUs(size_t mini_slot,
+                                     double percentile) const {
+    return this->mini_slot_latency_hists_.at(mini_slot).PercentileUs(
+        percentile);
+  }
+
+  /// Frames in the latency histogram of timestamp_type
+  size_t LatencyCount(TsType timestamp_type) const {
+    return this->latency_hists_.at(static_cast<size_t>(timestamp_type))
+        .Count();
+  }
+
+  /// Name of a timestamp type, as used by "stage_deadlines_us"
+  static const std::string& TsTypeName(TsType timestamp_type);
+
+  /// From worker thread_id, set the number of code blocks its decoder
+  /// (uplink) or encoder (downlink) has enqueued to the ACC100 and not
+  /// dequeued yet
+  void SetAccOpsInFlight(size_t thread_id, Direction dir, size_t num_ops) {
+    this->task_hists_[thread_id]
+        .acc_ops_in_flight_[static_cast<size_t>(dir)]
+        .store(num_ops, std::memory_order_relaxed);
+  }
+
+  /// Code blocks in the ACC100 over all the workers. Can be taken from any
+  /// thread.
+  size_t AccOpsInFlight() const;
+
+  /// From worker thread_id, count uplink code blocks sent to the ACC100 or,
+  /// spilled, to the CPU decoder
+  void AddAccDecodeBlocks(size_t thread_id, bool spilled, size_t num_blocks) {
+    std::atomic<size_t>& blocks =
+        this->task_hists_[thread_id].acc_decode_blocks_[spilled ? 1 : 0];
+    // Only the worker writes its counters
+    blocks.store(blocks.load(std::memory_order_relaxed) + num_blocks,
+                 std::memory_order_relaxed);
+  }
+
+  /// Uplink code blocks sent to the ACC100, or spilled to the CPU decoder,
+  /// over all the workers. Can be taken from any thread.
+  size_t AccDecodeBlocks(bool spilled) const;
+
   inline size_t LastFrameId() const { return this->last_frame_id_; }
   /// Dimensions = number of packet RX threads x kNumStatsFrames.
   /// frame_start[i][j] is the RDTSC timestamp taken by thread i when it
@@ -194,6 +395,21 @@ class Stats {
 
   size_t GetTotalTaskCount(DoerType doer_type, size_t thread_num);
 
+  /// TSC at which symbol_id of frame_id + frame_delta ends on air, from the
+  /// time on air of frame_id. NaN if frame_id has none or symbol_id is
+  /// SIZE_MAX.
+  double AirEndTsc(size_t frame_id, size_t symbol_id,
+                   size_t frame_delta) const;
+
+  /// Microseconds from air_tsc to the timestamp of timestamp_type of a
+  /// frame, NaN if the frame did not take it
+  double MasterUsFromAir(TsType timestamp_type, size_t frame_id,
+                         double air_tsc) const;
+
+  /// Log the stages against the time on air, if any frame had hardware
+  /// timestamps
+  void PrintAirLatencyReport() const;
+
   const Config* const config_;
 
   const size_t task_thread_num_;
@@ -215,6 +431,7 @@ class Stats {
   /// ("old") copies of all DurationStat objects.
   struct TimeDurationsStats {
     std::array<DurationStat, kNumDoerTypes> duration_stat_;
+    size_t steal_count_ = 0;
     std::array<uint8_t, 64> false_sharing_padding_;
   };
 
@@ -226,7 +443,52 @@ class Stats {
              kNumDoerTypes>
       doer_breakdown_us_;
 
+  std::array<double, kNumDoerTypes> task_us_{};
+
   size_t last_frame_id_;
+  size_t dl_dropped_frames_ = 0;
+
+  /// Task duration histograms of each worker, and the DurationStats at its
+  /// previous RecordTaskDurations, only used by that worker
+  struct WorkerTaskHistograms {
+    std::array<std::array<CycleHistogram, kMaxStatBreakdown>, kNumDoerTypes>
+        hists_;
+    std::array<DurationStat, kNumDoerTypes> last_;
+    // By Direction
+    std::array<std::atomic<size_t>, 2> acc_ops_in_flight_{};
+    // Sent to the ACC100, spilled to the CPU
+    std::array<std::atomic<size_t>, 2> acc_decode_blocks_{};
+  };
+  std::unique_ptr<WorkerTaskHistograms[]> task_hists_;
+
+  /// Latency from kFirstSymbolRX to each timestamp type, over all frames
+  std::array<LatencyHistogram, kNumTimestampTypes> latency_hists_;
+  /// Deadline of each timestamp type from kFirstSymbolRX in microseconds, 0
+  /// if the stage has none
+  std::array<double, kNumTimestampTypes> deadlines_us_{};
+  std::array<size_t, kNumTimestampTypes> deadline_misses_{};
+  /// Page faults of each registered thread at the last report, in the order
+  /// of PageFaults::Registered()
+  std::vector<PageFaults::Counts> last_page_faults_;
+  /// Latency from kFirstSymbolRX to the decode of each uplink mini-slot,
+  /// empty without mini-slots
+  std::vector<LatencyHistogram> mini_slot_latency_hists_;
+
+  /// A TSC of a frame, valid while frame_id_ is that frame
+  struct FrameTsc {
+    size_t frame_id_ = SIZE_MAX;
+    double tsc_ = 0.0;
+  };
+  /// Start of each frame on air, from the hardware timestamps
+  std::array<FrameTsc, kNumStatsFrames> air_start_tsc_{};
+  std::array<FrameTsc, kNumStatsFrames> mac_dl_ready_tsc_{};
+  const double cycles_per_sample_;
+  /// From the end of the last uplink symbol on air to each uplink stage,
+  /// and from each downlink stage to the end of the last downlink symbol on
+  /// air
+  std::array<LatencyHistogram, kNumTimestampTypes> air_ul_hists_;
+  std::array<LatencyHistogram, kNumTimestampTypes> air_dl_hists_;
+  LatencyHistogram mac_to_air_hist_;
 
   /// Dimensions = number of packet RX threads x kNumStatsFrames.
   /// frame_start[i][j] is the RDTSC timestamp taken by thread i when it
@@ -0,0 +1,58 @@
+/**
+ * @file task_arena.h
+ * @brief Declaration file for the TaskArena class, the bump allocator for
+ * the temporaries of a doer's task.
+ */
+#ifndef TASK_ARENA_H_
+#define TASK_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_manage.h"
+#include "utils.h"
+
+/**
+ * @brief A fixed block of memory handed out in 64-byte aligned pieces and
+ * reclaimed all at once when the task is done.
+ *
+ * Each doer owns one, and its thread is the only user, so allocation is a
+ * pointer bump without locks. Armadillo temporaries use it through their
+ * aux_mem constructors, e.g.
+ * arma::cx_fmat mat(arena.Alloc<arma::cx_float>(n * m), n, m, false, false).
+ * An assignment of another size reallocates on the heap, which the heap
+ * allocation count of DurationStat shows.
+ */
+class TaskArena {
+ public:
+  TaskArena(size_t size, const Agora_memory::MemoryPolicy& policy =
+                             Agora_memory::MemoryPolicy())
+      : size_(size),
+        base_(static_cast<uint8_t*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64, size, policy))) {}
+  ~TaskArena() { Agora_memory::PaddedAlignedFree(base_); }
+  TaskArena(const TaskArena&) = delete;
+  TaskArena& operator=(const TaskArena&) = delete;
+
+  /// Uninitialized memory for num elements of T, valid until Reset()
+  template <typename T>
+  inline T* Alloc(size_t num) {
+    const size_t offset = used_;
+    const size_t used = offset + Roundup<64>(num * sizeof(T));
+    RtAssert(used <= size_, "TaskArena: out of memory");
+    used_ = used;
+    return reinterpret_cast<T*>(base_ + offset);
+  }
+
+  /// Release everything allocated since the last reset
+  inline void Reset() { used_ = 0; }
+
+  inline size_t Used() const { return used_; }
+
+ private:
+  const size_t size_;
+  uint8_t* const base_;
+  size_t used_ = 0;
+};
+
+#endif  // TASK_ARENA_H_
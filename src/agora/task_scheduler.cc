@@ -0,0 +1,115 @@
+/**
+ * @file task_scheduler.cc
+ * @brief Implementation file for the work-stealing task scheduler
+ */
+#include "task_scheduler.h"
+
+#include <cstdint>
+
+#include "utils.h"
+
+WorkStealingScheduler::WorkStealingScheduler(size_t num_workers)
+    : next_worker_(0), affinity_width_(0) {
+  RtAssert(num_workers > 0, "Work stealing needs at least one worker");
+  for (size_t i = 0; i < num_workers; i++) {
+    deques_.push_back(std::make_unique<WorkerDeques>());
+  }
+}
+
+void WorkStealingScheduler::Push(const EventData& event, size_t qid,
+                                 TaskPriority priority) {
+  WorkerDeques& deques = *deques_.at(next_worker_);
+  next_worker_ = (next_worker_ + 1) % deques_.size();
+  PushTo(deques, event, qid, static_cast<size_t>(priority));
+}
+
+void WorkStealingScheduler::PushAffine(const EventData& event, size_t qid,
+                                       TaskPriority priority, size_t key) {
+  if (affinity_width_ == 0) {
+    Push(event, qid, priority);
+    return;
+  }
+  const auto level = static_cast<size_t>(priority);
+  const size_t num_workers = deques_.size();
+  const size_t first = (key * affinity_width_) % num_workers;
+  size_t target = first;
+  size_t target_size = SIZE_MAX;
+  for (size_t i = 0; i < affinity_width_; i++) {
+    const size_t worker = (first + i) % num_workers;
+    const size_t size =
+        deques_.at(worker)->sizes_.at(level).load(std::memory_order_acquire);
+    if (size < target_size) {
+      target = worker;
+      target_size = size;
+    }
+  }
+  PushTo(*deques_.at(target), event, qid, level);
+}
+
+void WorkStealingScheduler::SetAffinityWidth(size_t affinity_width) {
+  RtAssert(affinity_width <= deques_.size(),
+           "Work stealing: more affine workers than workers");
+  affinity_width_ = affinity_width;
+}
+
+void WorkStealingScheduler::PushTo(WorkerDeques& deques, const EventData& event,
+                                   size_t qid, size_t level) {
+  std::lock_guard<std::mutex> lock(deques.mutex_);
+  deques.tasks_.at(level).push_back(Task{event, qid});
+  deques.sizes_.at(level).store(deques.tasks_.at(level).size(),
+                                std::memory_order_release);
+}
+
+bool WorkStealingScheduler::PopOwn(WorkerDeques& deques, size_t priority,
+                                   Task& task) {
+  if (deques.sizes_.at(priority).load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(deques.mutex_);
+  auto& tasks = deques.tasks_.at(priority);
+  if (tasks.empty()) {
+    return false;
+  }
+  // Oldest first, to keep the frame order on the owner
+  task = tasks.front();
+  tasks.pop_front();
+  deques.sizes_.at(priority).store(tasks.size(), std::memory_order_release);
+  return true;
+}
+
+bool WorkStealingScheduler::Steal(WorkerDeques& deques, size_t priority,
+                                  Task& task) {
+  if (deques.sizes_.at(priority).load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(deques.mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // The victim is busy, try another one
+    return false;
+  }
+  auto& tasks = deques.tasks_.at(priority);
+  if (tasks.empty()) {
+    return false;
+  }
+  task = tasks.back();
+  tasks.pop_back();
+  deques.sizes_.at(priority).store(tasks.size(), std::memory_order_release);
+  return true;
+}
+
+bool WorkStealingScheduler::Pop(size_t tid, Task& task, bool& stolen) {
+  const size_t num_workers = deques_.size();
+  for (size_t priority = 0; priority < kNumTaskPriorities; priority++) {
+    if (PopOwn(*deques_.at(tid), priority, task)) {
+      stolen = false;
+      return true;
+    }
+    for (size_t i = 1; i < num_workers; i++) {
+      if (Steal(*deques_.at((tid + i) % num_workers), priority, task)) {
+        stolen = true;
+        return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file task_scheduler.h
+ * @brief Declaration file for the work-stealing task scheduler. Each worker
+ * owns a set of task deques, one per priority level, and steals from the
+ * other workers when its own deques are empty.
+ */
+#ifndef TASK_SCHEDULER_H_
+#define TASK_SCHEDULER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "message.h"
+
+/// Scheduling priority of a task. Critical tasks are on the critical path of
+/// a frame (e.g. decode of the oldest frame, IFFT before its TX deadline) and
+/// are run before any normal task, stolen or not.
+enum class TaskPriority : size_t { kCritical, kNormal };
+static constexpr size_t kNumTaskPriorities = 2;
+
+class WorkStealingScheduler {
+ public:
+  /// A task and the index of the completion queue its response goes to
+  struct Task {
+    EventData event_;
+    size_t qid_;
+  };
+
+  explicit WorkStealingScheduler(size_t num_workers);
+
+  /// Add a task to the deques of the next worker in round-robin order. Only
+  /// called by the master thread.
+  void Push(const EventData& event, size_t qid, TaskPriority priority);
+
+  /// Add a task to the deques of one of the workers that key (e.g. a UE) is
+  /// affine to: the affinity_width workers from (key * affinity_width) on,
+  /// the one with the fewest queued tasks of the priority level. The tasks of
+  /// an overloaded subset are still stolen by idle workers. Only called by
+  /// the master thread.
+  void PushAffine(const EventData& event, size_t qid, TaskPriority priority,
+                  size_t key);
+
+  /// Get the next task for worker tid: the oldest task of its own deques, or
+  /// the newest task of another worker, for each priority level in turn.
+  /// Returns false if no worker has a pending task. stolen is set if the
+  /// task came from another worker.
+  bool Pop(size_t tid, Task& task, bool& stolen);
+
+  inline size_t NumWorkers() const { return deques_.size(); }
+
+  /// Set the number of workers of each key of PushAffine(), 0 to spread its
+  /// tasks round-robin as Push() does
+  void SetAffinityWidth(size_t affinity_width);
+  inline size_t AffinityWidth() const { return affinity_width_; }
+
+ private:
+  struct alignas(64) WorkerDeques {
+    std::mutex mutex_;
+    std::array<std::deque<Task>, kNumTaskPriorities> tasks_;
+    // Lock-free hint of the deque sizes, so that idle workers do not lock
+    // empty deques
+    std::array<std::atomic<size_t>, kNumTaskPriorities> sizes_{};
+  };
+
+  void PushTo(WorkerDeques& deques, const EventData& event, size_t qid,
+              size_t level);
+  bool PopOwn(WorkerDeques& deques, size_t priority, Task& task);
+  bool Steal(WorkerDeques& deques, size_t priority, Task& task);
+
+  std::vector<std::unique_ptr<WorkerDeques>> deques_;
+  size_t next_worker_;
+  // Workers per key of PushAffine(), 0 for none
+  size_t affinity_width_;
+};
+
+#endif  // TASK_SCHEDULER_H_
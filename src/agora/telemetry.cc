@@ -0,0 +1,346 @@
+/**
+ * @file telemetry.cc
+ * @brief Implementation file for the TelemetryServer class
+ */
+#include "telemetry.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.h"
+#include "utils.h"
+
+// Time the HTTP thread waits for a connection before it checks for exit
+static constexpr int kPollTimeoutMs = 200;
+// Time a client has to send its request
+static constexpr long kRecvTimeoutMs = 1000;
+static constexpr size_t kMaxRequestBytes = 4096;
+
+TelemetryServer::TelemetryServer(std::string prefix, const std::string& addr,
+                                 uint16_t port,
+                                 std::vector<std::string> queue_names,
+                                 double interval_ms, double freq_ghz)
+    : prefix_(std::move(prefix)),
+      queue_names_(std::move(queue_names)),
+      interval_cycles_(static_cast<size_t>(interval_ms * 1e6 * freq_ghz)),
+      freq_ghz_(freq_ghz),
+      start_tsc_(GetTime::Rdtsc()),
+      next_publish_tsc_(start_tsc_),
+      staging_(),
+      seq_(0),
+      published_(),
+      running_(true) {
+  RtAssert(queue_names_.size() <= TelemetrySnapshot::kMaxQueues,
+           "TelemetryServer: too many queues");
+
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  RtAssert(::inet_pton(AF_INET, addr.c_str(), &local.sin_addr) == 1,
+           "TelemetryServer: invalid telemetry_addr " + addr);
+
+  listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  const int reuse = 1;
+  ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  if ((listen_fd_ == -1) ||
+      (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&local),
+              sizeof(local)) != 0) ||
+      (::listen(listen_fd_, SOMAXCONN) != 0)) {
+    AGORA_LOG_ERROR("TelemetryServer: failed to listen on %s:%u. errno = %s\n",
+                    addr.c_str(), port, std::strerror(errno));
+    if (listen_fd_ != -1) {
+      ::close(listen_fd_);
+    }
+    throw std::runtime_error("TelemetryServer: failed to listen");
+  }
+  AGORA_LOG_INFO("TelemetryServer: serving %s metrics on %s:%u/metrics\n",
+                 prefix_.c_str(), addr.c_str(), port);
+
+  // Not pinned, the OS keeps it off the cores of the busy-polling threads
+  thread_ = std::thread(&TelemetryServer::Serve, this);
+}
+
+TelemetryServer::~TelemetryServer() {
+  running_ = false;
+  thread_.join();
+  ::close(listen_fd_);
+}
+
+void TelemetryServer::Publish() {
+  const size_t seq = seq_.load(std::memory_order_relaxed);
+  seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  published_ = staging_;
+  seq_.store(seq + 2, std::memory_order_release);
+  next_publish_tsc_ = GetTime::Rdtsc() + interval_cycles_;
+}
+
+bool TelemetryServer::ReadPublished(TelemetrySnapshot& snapshot) const {
+  while (true) {
+    const size_t seq = seq_.load(std::memory_order_acquire);
+    if ((seq & 1) == 0) {
+      snapshot = published_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == seq) {
+        return seq != 0;
+      }
+    }
+    std::this_thread::yield();
+  }
+}
+
+void TelemetryServer::Serve() {
+  pollfd listen_poll{};
+  listen_poll.fd = listen_fd_;
+  listen_poll.events = POLLIN;
+  while (running_) {
+    if (::poll(&listen_poll, 1, kPollTimeoutMs) <= 0) {
+      continue;
+    }
+    const int conn_fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (conn_fd == -1) {
+      continue;
+    }
+    HandleConnection(conn_fd);
+    ::close(conn_fd);
+  }
+}
+
+void TelemetryServer::HandleConnection(int conn_fd) {
+  timeval timeout{};
+  timeout.tv_sec = kRecvTimeoutMs / 1000;
+  timeout.tv_usec = (kRecvTimeoutMs % 1000) * 1000;
+  ::setsockopt(conn_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  // Only the request line matters, the headers are skipped
+  std::string request;
+  std::array<char, 1024> buf;
+  while ((request.find("\r\n\r\n") == std::string::npos) &&
+         (request.size() < kMaxRequestBytes)) {
+    const ssize_t rx_bytes = ::recv(conn_fd, buf.data(), buf.size(), 0);
+    if (rx_bytes <= 0) {
+      return;
+    }
+    request.append(buf.data(), rx_bytes);
+  }
+
+  std::string status = "404 Not Found";
+  std::string body = "Only /metrics is served\n";
+  if ((request.rfind("GET /metrics ", 0) == 0) ||
+      (request.rfind("GET /metrics?", 0) == 0)) {
+    TelemetrySnapshot snapshot;
+    status = "200 OK";
+    body = ReadPublished(snapshot) ? Render(snapshot) : std::string();
+  }
+  const std::string response =
+      "HTTP/1.1 " + status +
+      "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+      std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+  size_t sent = 0;
+  while (sent < response.size()) {
+    const ssize_t tx_bytes = ::send(conn_fd, response.data() + sent,
+                                    response.size() - sent, MSG_NOSIGNAL);
+    if (tx_bytes <= 0) {
+      return;
+    }
+    sent += tx_bytes;
+  }
+}
+
+static std::string StageLabel(size_t ts_type) {
+  return "{stage=\"" + Stats::TsTypeName(static_cast<TsType>(ts_type)) +
+         "\"}";
+}
+
+static std::string UeLabel(size_t ue_id) {
+  return "{ue=\"" + std::to_string(ue_id) + "\"}";
+}
+
+std::string TelemetryServer::Render(const TelemetrySnapshot& snapshot) const {
+  std::string out;
+  char line[256];
+  const auto add_header = [&](const char* name, const char* type,
+                              const char* help) {
+    std::snprintf(line, sizeof(line), "# HELP %s_%s %s\n# TYPE %s_%s %s\n",
+                  prefix_.c_str(), name, help, prefix_.c_str(), name, type);
+    out += line;
+  };
+  const auto add_value = [&](const char* name, const std::string& labels,
+                             double value) {
+    if (std::isnan(value)) {
+      std::snprintf(line, sizeof(line), "%s_%s%s NaN\n", prefix_.c_str(),
+                    name, labels.c_str());
+    } else {
+      std::snprintf(line, sizeof(line), "%s_%s%s %.17g\n", prefix_.c_str(),
+                    name, labels.c_str(), value);
+    }
+    out += line;
+  };
+  const auto add_metric = [&](const char* name, const char* type,
+                              const char* help, double value) {
+    add_header(name, type, help);
+    add_value(name, std::string(), value);
+  };
+
+  add_metric("uptime_seconds", "gauge", "Time since the start",
+             GetTime::CyclesToMs(GetTime::Rdtsc() - start_tsc_, freq_ghz_) /
+                 1e3);
+  add_metric("frames_total", "counter", "Frames fully processed",
+             snapshot.frames_);
+  add_metric("ul_bits_total", "counter",
+             "Uplink payload bits of the processed frames", snapshot.ul_bits_);
+  add_metric("dl_bits_total", "counter",
+             "Downlink payload bits of the processed frames",
+             snapshot.dl_bits_);
+  add_metric("dl_dropped_frames_total", "counter",
+             "Frames whose downlink was dropped to meet a later TX slot",
+             snapshot.dl_dropped_frames_);
+  add_metric("rx_dropped_packets_total", "counter",
+             "Packets the TxRx workers received and discarded",
+             snapshot.rx_dropped_packets_);
+  add_metric("acc100_ops_in_flight", "gauge",
+             "Code blocks enqueued to the ACC100 and not dequeued yet",
+             snapshot.acc_ops_in_flight_);
+  add_header("acc100_decode_blocks_total", "counter",
+             "Uplink code blocks sent to the ACC100 or spilled to the CPU "
+             "decoder");
+  add_value("acc100_decode_blocks_total", "{path=\"acc100\"}",
+            snapshot.acc_decode_blocks_);
+  add_value("acc100_decode_blocks_total", "{path=\"cpu\"}",
+            snapshot.acc_spilled_blocks_);
+
+  add_header("queue_depth", "gauge", "Approximate number of queued events");
+  for (size_t i = 0; i < queue_names_.size(); i++) {
+    add_value("queue_depth", "{queue=\"" + queue_names_.at(i) + "\"}",
+              snapshot.queue_depths_.at(i));
+  }
+
+  add_header("stage_latency_us", "gauge",
+             "Latency percentile from the first received symbol of a frame "
+             "to a stage");
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    if (snapshot.latency_frames_.at(i) == 0) {
+      continue;
+    }
+    const std::string& stage = Stats::TsTypeName(static_cast<TsType>(i));
+    for (size_t p = 0; p < TelemetrySnapshot::kPercentiles.size(); p++) {
+      std::snprintf(line, sizeof(line), "{stage=\"%s\",quantile=\"%g\"}",
+                    stage.c_str(),
+                    TelemetrySnapshot::kPercentiles.at(p) / 100.0);
+      add_value("stage_latency_us", line, snapshot.latency_us_.at(i).at(p));
+    }
+  }
+  // The samples of a metric follow its header
+  add_header("stage_frames_total", "counter",
+             "Frames in the latency percentiles of a stage");
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    if (snapshot.latency_frames_.at(i) != 0) {
+      add_value("stage_frames_total", StageLabel(i),
+                snapshot.latency_frames_.at(i));
+    }
+  }
+  add_header("stage_deadline_misses_total", "counter",
+             "Frames that reached a stage after its deadline");
+  for (size_t i = 0; i < kNumTimestampTypes; i++) {
+    if (snapshot.latency_frames_.at(i) != 0) {
+      add_value("stage_deadline_misses_total", StageLabel(i),
+                snapshot.deadline_misses_.at(i));
+    }
+  }
+
+  if (snapshot.radio_timing_) {
+    // One metric of each kind over the symbol types of a direction
+    const auto add_radio_timing =
+        [&](const char* dir, const char* help, double tail,
+            const RadioTiming::Summary* summaries, size_t num_types,
+            std::string (*type_name)(size_t)) {
+          std::string name = std::string("radio_") + dir + "_us";
+          add_header(name.c_str(), "gauge", help);
+          for (size_t i = 0; i < num_types; i++) {
+            if (summaries[i].count_ == 0) {
+              continue;
+            }
+            const std::string type = type_name(i);
+            std::snprintf(line, sizeof(line), "{type=\"%s\",quantile=\"0.5\"}",
+                          type.c_str());
+            add_value(name.c_str(), line, summaries[i].p50_us_);
+            std::snprintf(line, sizeof(line), "{type=\"%s\",quantile=\"%g\"}",
+                          type.c_str(), tail);
+            add_value(name.c_str(), line, summaries[i].tail_us_);
+          }
+          name = std::string("radio_") + dir + "_symbols_total";
+          add_header(name.c_str(), "counter",
+                     "Symbols in the percentiles of a symbol type");
+          for (size_t i = 0; i < num_types; i++) {
+            if (summaries[i].count_ != 0) {
+              add_value(name.c_str(), "{type=\"" + type_name(i) + "\"}",
+                        summaries[i].count_);
+            }
+          }
+          name = std::string("radio_") + dir + "_worst_radio";
+          add_header(name.c_str(), "gauge",
+                     "Radio with the worst tail percentile of a symbol type");
+          for (size_t i = 0; i < num_types; i++) {
+            if (summaries[i].count_ != 0) {
+              add_value(name.c_str(), "{type=\"" + type_name(i) + "\"}",
+                        summaries[i].worst_radio_);
+            }
+          }
+        };
+    add_radio_timing(
+        "rx_arrival",
+        "Percentile of the time from the last sample of a symbol on the radio "
+        "to its reception",
+        0.99, snapshot.rx_arrival_.data(), RadioTiming::kNumRxTypes,
+        [](size_t i) {
+          return RadioTiming::RxTypeName(static_cast<RadioTiming::RxType>(i));
+        });
+    add_radio_timing(
+        "tx_lead",
+        "Percentile of the time from the handoff of a symbol to the radio to "
+        "its transmission",
+        0.01, snapshot.tx_lead_.data(), RadioTiming::kNumTxTypes,
+        [](size_t i) {
+          return RadioTiming::TxTypeName(static_cast<RadioTiming::TxType>(i));
+        });
+  }
+
+  add_header("ue_snr_db", "gauge", "Latest EVM SNR of a UE");
+  for (size_t ue = 0; ue < snapshot.num_ues_; ue++) {
+    add_value("ue_snr_db", UeLabel(ue), snapshot.snr_db_.at(ue));
+  }
+  add_header("ue_sinr_db", "gauge",
+             "Latest post-equalization SINR of a UE, from its beamweights");
+  for (size_t ue = 0; ue < snapshot.num_ues_; ue++) {
+    add_value("ue_sinr_db", UeLabel(ue), snapshot.sinr_db_.at(ue));
+  }
+  add_header("ue_decode_iterations", "gauge",
+             "Mean LDPC decoder iterations of the code blocks of a UE");
+  for (size_t ue = 0; ue < snapshot.num_ues_; ue++) {
+    add_value("ue_decode_iterations", UeLabel(ue),
+              snapshot.decode_iters_.at(ue));
+  }
+  add_header("ue_decoded_blocks_total", "counter",
+             "Code blocks of a UE decoded with a known reference");
+  for (size_t ue = 0; ue < snapshot.num_ues_; ue++) {
+    add_value("ue_decoded_blocks_total", UeLabel(ue),
+              snapshot.decoded_blocks_.at(ue));
+  }
+  add_header("ue_block_errors_total", "counter",
+             "Code blocks of a UE decoded with errors");
+  for (size_t ue = 0; ue < snapshot.num_ues_; ue++) {
+    add_value("ue_block_errors_total", UeLabel(ue),
+              snapshot.block_errors_.at(ue));
+  }
+  return out;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file telemetry.h
+ * @brief Declaration file for the TelemetryServer class, which serves live
+ * metrics of Agora or PhyUe over HTTP in the Prometheus text format.
+ */
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gettime.h"
+#include "radio_timing.h"
+#include "stats.h"
+#include "symbols.h"
+
+/// Metrics of one point in time. The master thread fills them in
+/// TelemetryServer::Staging() and publishes them, the HTTP thread only
+/// reads published copies.
+struct TelemetrySnapshot {
+  static constexpr size_t kMaxQueues = 8;
+  // Latency percentiles of every stage
+  static constexpr std::array<double, 3> kPercentiles = {50.0, 99.0, 99.9};
+
+  // Frames fully processed, and the payload bits they carried
+  size_t frames_;
+  size_t ul_bits_;
+  size_t dl_bits_;
+  size_t dl_dropped_frames_;
+  size_t rx_dropped_packets_;
+  // Code blocks in the ACC100, 0 without it
+  size_t acc_ops_in_flight_;
+  // Uplink code blocks sent to the ACC100 and spilled to the CPU, 0 without
+  // the spillover
+  size_t acc_decode_blocks_;
+  size_t acc_spilled_blocks_;
+  // Approximate depth of each queue named at the server construction
+  std::array<size_t, kMaxQueues> queue_depths_;
+
+  // Latency from the first received symbol of a frame to each timestamp
+  // type, for the types with frames
+  std::array<size_t, kNumTimestampTypes> latency_frames_;
+  std::array<std::array<double, kPercentiles.size()>, kNumTimestampTypes>
+      latency_us_;
+  std::array<size_t, kNumTimestampTypes> deadline_misses_;
+
+  // Symbol RX arrival and TX lead times of the radios, if measured by the
+  // TxRx workers
+  bool radio_timing_;
+  std::array<RadioTiming::Summary, RadioTiming::kNumRxTypes> rx_arrival_;
+  std::array<RadioTiming::Summary, RadioTiming::kNumTxTypes> tx_lead_;
+
+  // Latest EVM SNR of each UE, and its code blocks decoded so far
+  size_t num_ues_;
+  std::array<float, kMaxUEs> snr_db_;
+  // Latest post-equalization SINR and mean decoder iterations of each UE,
+  // NaN if not measured
+  std::array<float, kMaxUEs> sinr_db_;
+  std::array<float, kMaxUEs> decode_iters_;
+  std::array<size_t, kMaxUEs> decoded_blocks_;
+  std::array<size_t, kMaxUEs> block_errors_;
+};
+
+class TelemetryServer {
+ public:
+  /**
+   * @brief Start the HTTP thread, which answers "GET /metrics" on addr:port
+   *
+   * @param prefix Prefix of the metric names, e.g. "agora"
+   * @param queue_names Names of the queues of
+   * TelemetrySnapshot::queue_depths_, at most kMaxQueues
+   * @param interval_ms Minimum time between two publications
+   */
+  TelemetryServer(std::string prefix, const std::string& addr, uint16_t port,
+                  std::vector<std::string> queue_names, double interval_ms,
+                  double freq_ghz);
+  ~TelemetryServer();
+
+  /// From the master, true if the last publication is older than the
+  /// interval. Costs a TSC read.
+  inline bool PublishDue() const {
+    return GetTime::Rdtsc() >= this->next_publish_tsc_;
+  }
+
+  /// From the master, the snapshot to fill before Publish()
+  inline TelemetrySnapshot& Staging() { return this->staging_; }
+
+  /// From the master, publish Staging() to the HTTP thread. Never blocks or
+  /// allocates.
+  void Publish();
+
+ private:
+  // Serve the HTTP requests until the destructor
+  void Serve();
+  // Answer one connection
+  void HandleConnection(int conn_fd);
+  // Copy the published snapshot, false before the first one
+  bool ReadPublished(TelemetrySnapshot& snapshot) const;
+  // Metrics of a snapshot in the Prometheus text format
+  std::string Render(const TelemetrySnapshot& snapshot) const;
+
+  const std::string prefix_;
+  const std::vector<std::string> queue_names_;
+  const size_t interval_cycles_;
+  const double freq_ghz_;
+  const size_t start_tsc_;
+  size_t next_publish_tsc_;
+
+  TelemetrySnapshot staging_;
+  // Sequence lock of published_: odd while the master writes it
+  std::atomic<size_t> seq_;
+  TelemetrySnapshot published_;
+
+  int listen_fd_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+#endif  // TELEMETRY_H_
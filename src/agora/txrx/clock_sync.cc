@@ -0,0 +1,48 @@
+/**
+ * @file clock_sync.cc
+ * @brief Implementation file for the ClockSync class
+ */
+#include "clock_sync.h"
+
+#include <algorithm>
+
+ClockSync::ClockSync(double freq_ghz) : cycles_per_us_(freq_ghz * 1e3) {}
+
+void ClockSync::Update(double hw_us, size_t host_tsc) {
+  const double offset =
+      static_cast<double>(host_tsc) - (hw_us * this->cycles_per_us_);
+  if (this->synced_ == false) {
+    this->synced_ = true;
+    this->offset_ = offset;
+    this->ref_hw_us_ = hw_us;
+  } else if (offset <
+             this->offset_ + (this->drift_ * (hw_us - this->ref_hw_us_))) {
+    // Seen with less delay than any pair so far
+    this->offset_ = offset;
+    this->ref_hw_us_ = hw_us;
+  }
+
+  if ((this->window_samples_ == 0) || (offset < this->window_offset_)) {
+    this->window_offset_ = offset;
+    this->window_hw_us_ = hw_us;
+  }
+  this->window_samples_++;
+  if (this->window_samples_ < kWindowSamples) {
+    return;
+  }
+  if (this->has_last_window_ &&
+      (this->window_hw_us_ > this->last_window_hw_us_)) {
+    const double max_drift = kMaxDriftPpm * 1e-6 * this->cycles_per_us_;
+    this->drift_ =
+        std::clamp((this->window_offset_ - this->last_window_offset_) /
+                       (this->window_hw_us_ - this->last_window_hw_us_),
+                   -max_drift, max_drift);
+  }
+  // Follow the envelope up as well, if the clocks drift apart
+  this->offset_ = this->window_offset_;
+  this->ref_hw_us_ = this->window_hw_us_;
+  this->has_last_window_ = true;
+  this->last_window_offset_ = this->window_offset_;
+  this->last_window_hw_us_ = this->window_hw_us_;
+  this->window_samples_ = 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file clock_sync.h
+ * @brief Declaration file for the ClockSync class, which maps the hardware
+ * time of a radio to the TSC of the host.
+ */
+#ifndef CLOCK_SYNC_H_
+#define CLOCK_SYNC_H_
+
+#include <cstddef>
+
+/// Map from the hardware time of a radio (or NIC) to the host TSC, fitted to
+/// pairs of a hardware timestamp and the TSC at which the host saw it. The
+/// host always sees an event after its timestamp, by a varying delay, so the
+/// map follows the lower envelope of the pairs: the least offset of each
+/// window of kWindowSamples pairs, with the drift of the two clocks from
+/// consecutive windows. A pair below the map moves it down at once. Used by
+/// a single thread.
+class ClockSync {
+ public:
+  static constexpr size_t kWindowSamples = 1024;
+  /// Largest drift of the hardware clock from the TSC taken from the
+  /// windows, in parts per million
+  static constexpr double kMaxDriftPpm = 200.0;
+
+  explicit ClockSync(double freq_ghz);
+
+  /// Add a pair: the host saw hardware time hw_us at host_tsc
+  void Update(double hw_us, size_t host_tsc);
+
+  /// True once a pair was added
+  inline bool Synced() const { return this->synced_; }
+
+  /// TSC at which the hardware clock read hw_us. Only once Synced().
+  inline double ToHostTsc(double hw_us) const {
+    return (hw_us * this->cycles_per_us_) + this->offset_ +
+           (this->drift_ * (hw_us - this->ref_hw_us_));
+  }
+
+ private:
+  const double cycles_per_us_;
+  bool synced_ = false;
+  // TSC minus the hardware time in cycles at ref_hw_us_, and its change per
+  // microsecond of hardware time
+  double offset_ = 0.0;
+  double ref_hw_us_ = 0.0;
+  double drift_ = 0.0;
+
+  // Least offset of the current window and of the one before
+  size_t window_samples_ = 0;
+  double window_offset_ = 0.0;
+  double window_hw_us_ = 0.0;
+  bool has_last_window_ = false;
+  double last_window_offset_ = 0.0;
+  double last_window_hw_us_ = 0.0;
+};
+
+#endif  // CLOCK_SYNC_H_
@@ -147,6 +147,18 @@ bool PacketTxRx::StartTxRx(Table<complex_float>& calib_dl_buffer,
   AGORA_LOG_FRAME("PacketTxRx: StartTxRx threads %zu\n",
                   worker_threads_.size());
   for (auto& worker : worker_threads_) {
+    if (tracer_ != nullptr) {
+      worker->SetTraceRing(tracer_->TxRxRing(worker->Id()));
+    }
+    if (notify_rings_.empty() == false) {
+      worker->SetNotifyRing(notify_rings_.at(worker->Id()));
+    }
+    worker->SetAnalogBeams(analog_beams_);
+    if (cfg_->InlineTxRx()) {
+      RtAssert(worker->StartInline(),
+               "PacketTxRx: inline_txrx is not supported by this transport");
+      continue;
+    }
     worker->Start();
     size_t waited_ms = 0;
     while (worker->Started() == false) {
@@ -160,16 +172,38 @@ bool PacketTxRx::StartTxRx(Table<complex_float>& calib_dl_buffer,
     }
     AGORA_LOG_TRACE("PacketTxRx: worker %zu has started \n", worker->Id());
   }
+  if (cfg_->InlineTxRx()) {
+    proceed_ = true;
+    AGORA_LOG_INFO("PacketTxRx: %zu workers polled inline\n",
+                   worker_threads_.size());
+    return true;
+  }
   AGORA_LOG_TRACE("PacketTxRx: notifying workers\n");
   NotifyWorkers();
   AGORA_LOG_INFO("PacketTxRx: workers synchronized\n");
   return true;
 }
 
+bool PacketTxRx::PollInline() {
+  bool work_done = false;
+  for (auto& worker : worker_threads_) {
+    work_done = worker->PollOnce() || work_done;
+  }
+  return work_done;
+}
+
 size_t PacketTxRx::AntNumToWorkerId(size_t ant_num) const {
   return (interface_to_worker_.at(ant_num / num_channels_));
 }
 
+size_t PacketTxRx::RxDropped() const {
+  size_t rx_dropped = 0;
+  for (const auto& worker : worker_threads_) {
+    rx_dropped += worker->RxDropped();
+  }
+  return rx_dropped;
+}
+
 void PacketTxRx::NotifyWorkers() {  //Sync the workers
   if (proceed_ == false) {
     std::this_thread::sleep_for(std::chrono::milliseconds(kNotifyWaitMs));
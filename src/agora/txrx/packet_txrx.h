@@ -7,12 +7,15 @@
 #ifndef PACKETTXRX_H_
 #define PACKETTXRX_H_
 
+#include <utility>
 #include <vector>
 
 #include "common_typedef_sdk.h"
 #include "concurrentqueue.h"
 #include "config.h"
 #include "message.h"
+#include "radio_timing.h"
+#include "spsc_event_ring.h"
 #include "txrx_worker.h"
 
 namespace AgoraTxRx {
@@ -51,6 +54,14 @@ class PacketTxRx {
   virtual bool StartTxRx(Table<complex_float>& calib_dl_buffer,
                          Table<complex_float>& calib_ul_buffer);
 
+  /**
+   * @brief Run one pass of every worker on the calling thread, with
+   * inline_txrx. Only call it after StartTxRx().
+   *
+   * @return True if any packet was sent or received
+   */
+  bool PollInline();
+
   /**
    * @brief Convert the antenna id to txrx worker id
    *
@@ -60,6 +71,30 @@ class PacketTxRx {
    */
   size_t AntNumToWorkerId(size_t ant_num) const;
 
+  /// Packets the TxRx workers received and discarded, e.g. traffic from
+  /// other hosts. Can be read from any thread.
+  size_t RxDropped() const;
+
+  /// Symbol timing of the radios, nullptr if the workers do not measure it.
+  /// Can be read from any thread.
+  virtual const RadioTiming* Timing() const { return nullptr; }
+
+  /// Record the events of the TxRx workers in the rings of tracer. Only
+  /// call it before StartTxRx().
+  inline void SetTracer(EventTracer* tracer) { tracer_ = tracer; }
+
+  /// Point the analog beams of the radios as analog_beams selects. Only call
+  /// it before StartTxRx().
+  inline void SetAnalogBeams(AnalogBeams* analog_beams) {
+    analog_beams_ = analog_beams;
+  }
+
+  /// Post the events of TxRx thread i to notify_rings[i] instead of the
+  /// notify queue. Only call it before StartTxRx().
+  inline void SetNotifyRings(std::vector<SpscEventRing*> notify_rings) {
+    notify_rings_ = std::move(notify_rings);
+  }
+
  protected:
   bool StopTxRx();
   //Align all worker threads to common start event (this call)
@@ -106,6 +141,12 @@ class PacketTxRx {
   std::vector<size_t> interface_to_worker_;
   const AgoraTxRx::TxRxTypes type_;
   size_t num_channels_;
+  // nullptr if tracing is disabled
+  EventTracer* tracer_ = nullptr;
+  // Empty if the workers post to the notify queue
+  std::vector<SpscEventRing*> notify_rings_;
+  // nullptr if the analog beams are not managed
+  AnalogBeams* analog_beams_ = nullptr;
 };
 
 #endif  // PACKETTXRX_H_
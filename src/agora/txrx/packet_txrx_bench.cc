@@ -0,0 +1,120 @@
+/**
+ * @file packet_txrx_bench.cc
+ * @brief Implementation of PacketTxRxBench initialization functions
+ */
+
+#include "packet_txrx_bench.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "datatype_conversion.h"
+#include "logger.h"
+#include "txrx_worker_bench.h"
+
+PacketTxRxBench::PacketTxRxBench(
+    Config* const cfg, size_t core_offset,
+    moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+    moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+    moodycamel::ProducerToken** notify_producer_tokens,
+    moodycamel::ProducerToken** tx_producer_tokens, Table<char>& rx_buffer,
+    size_t packet_num_in_buffer, Table<size_t>& frame_start, char* tx_buffer,
+    const std::atomic<size_t>& frames_done)
+    : PacketTxRx(AgoraTxRx::TxRxTypes::kBaseStation, cfg, core_offset,
+                 event_notify_q, tx_pending_q, notify_producer_tokens,
+                 tx_producer_tokens, rx_buffer, packet_num_in_buffer,
+                 frame_start, tx_buffer),
+      frames_done_(frames_done) {
+  // The packets hold time-domain samples and no calibration symbols
+  RtAssert((cfg->FftInRru() == false) &&
+               (cfg->Frame().NumULCalSyms() == 0) &&
+               (cfg->Frame().NumDLCalSyms() == 0),
+           "PacketTxRxBench: fft_in_rru and calibration symbols are not "
+           "supported in bench mode");
+  LoadPackets(std::string(TOSTRING(PROJECT_DIRECTORY)) +
+              "/files/experiment/LDPC_rx_data_" +
+              std::to_string(cfg->OfdmCaNum()) + "_ant" +
+              std::to_string(cfg->BsAntNum()) + ".bin");
+}
+
+PacketTxRxBench::~PacketTxRxBench() {
+  // Stop the workers before the packets they copy from are freed
+  StopTxRx();
+  packets_.Free();
+}
+
+void PacketTxRxBench::LoadPackets(const std::string& filename) {
+  const size_t num_packets = cfg_->Frame().NumTotalSyms() * cfg_->BsAntNum();
+  const size_t num_samples = cfg_->SampsPerSymbol() * 2;
+  const size_t ant_per_cell = cfg_->BsAntNum() / cfg_->NumCells();
+  packets_.Calloc(num_packets, cfg_->PacketLength(),
+                  Agora_memory::Alignment_t::kAlign64);
+
+  // The conversions load and store aligned vectors
+  Table<float> iq_float;
+  Table<short> iq_short;
+  iq_float.Calloc(1, num_samples, Agora_memory::Alignment_t::kAlign64);
+  iq_short.Calloc(1, num_samples, Agora_memory::Alignment_t::kAlign64);
+  FILE* fp = std::fopen(filename.c_str(), "rb");
+  RtAssert(fp != nullptr, "PacketTxRxBench: Failed to open IQ data file " +
+                              filename + ", run the data generator first");
+  for (size_t i = 0; i < num_packets; i++) {
+    const size_t read_count =
+        std::fread(iq_float[0], sizeof(float), num_samples, fp);
+    if (read_count != num_samples) {
+      AGORA_LOG_ERROR(
+          "PacketTxRxBench: Failed to read IQ data file %s. Packet %zu: "
+          "expected %zu I/Q samples but read %zu. Errno %s\n",
+          filename.c_str(), i, num_samples, read_count, strerror(errno));
+      throw std::runtime_error("PacketTxRxBench: Failed to read IQ data file");
+    }
+    const size_t symbol_id = i / cfg_->BsAntNum();
+    const SymbolType symbol_type = cfg_->GetSymbolType(symbol_id);
+    if ((symbol_type != SymbolType::kPilot) &&
+        (symbol_type != SymbolType::kUL)) {
+      continue;
+    }
+    // The antenna ids of the cells are combined, as the sim workers do
+    const size_t ant_id = i % cfg_->BsAntNum();
+    auto* pkt = new (packets_[i])
+        Packet(0, symbol_id, ant_id / ant_per_cell, ant_id);
+    if (cfg_->FronthaulBfpBits() != 0) {
+      SimdConvertFloatToShort(iq_float[0], iq_short[0], num_samples);
+      BfpCompress(iq_short[0], reinterpret_cast<uint8_t*>(pkt->data_),
+                  cfg_->SampsPerSymbol(), cfg_->FronthaulBfpBits());
+    } else if (kUse12BitIQ) {
+      ConvertFloatTo12bitIq(iq_float[0], reinterpret_cast<uint8_t*>(pkt->data_),
+                            num_samples);
+    } else {
+      SimdConvertFloatToShort(iq_float[0], iq_short[0], num_samples);
+      std::memcpy(pkt->data_, iq_short[0], num_samples * sizeof(short));
+    }
+  }
+  std::fclose(fp);
+  iq_float.Free();
+  iq_short.Free();
+  AGORA_LOG_INFO("PacketTxRxBench: Loaded %zu packets per frame from %s\n",
+                 num_packets, filename.c_str());
+}
+
+bool PacketTxRxBench::CreateWorker(size_t tid, size_t interface_count,
+                                   size_t interface_offset,
+                                   size_t* rx_frame_start,
+                                   std::vector<RxPacket>& rx_memory,
+                                   std::byte* const tx_memory) {
+  const size_t num_channels = NumChannels();
+
+  AGORA_LOG_INFO(
+      "PacketTxRxBench[%zu]: Creating worker handling %zu interfaces starting "
+      "at %zu - antennas %zu:%zu\n",
+      tid, interface_count, interface_offset, interface_offset * num_channels,
+      ((interface_offset * num_channels) + (interface_count * num_channels) -
+       1));
+
+  worker_threads_.emplace_back(std::make_unique<TxRxWorkerBench>(
+      core_offset_, tid, interface_count, interface_offset, cfg_,
+      rx_frame_start, event_notify_q_, tx_pending_q_, *tx_producer_tokens_[tid],
+      *notify_producer_tokens_[tid], rx_memory, tx_memory, mutex_, cond_,
+      proceed_, packets_, frames_done_));
+  return true;
+}
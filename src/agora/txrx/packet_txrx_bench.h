@@ -0,0 +1,48 @@
+/**
+ * @file packet_txrx_bench.h
+ * @brief Common definations for PacketTxRxBench, the offline packet source of
+ * the bench mode.
+ */
+
+#ifndef PACKETTXRX_BENCH_H_
+#define PACKETTXRX_BENCH_H_
+
+#include <atomic>
+#include <string>
+
+#include "packet_txrx.h"
+
+/**
+ * @brief Packet I/O of the bench mode, without a network or a sender.
+ *
+ * The uplink packets of a frame are built once from the generated rx data,
+ * and the workers copy them into the rx buffer as fast as Agora frees it, at
+ * most a frame window ahead of the frames Agora has completed. Downlink
+ * packets are completed without being sent.
+ */
+class PacketTxRxBench : public PacketTxRx {
+ public:
+  PacketTxRxBench(Config* const cfg, size_t core_offset,
+                  moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+                  moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+                  moodycamel::ProducerToken** notify_producer_tokens,
+                  moodycamel::ProducerToken** tx_producer_tokens,
+                  Table<char>& rx_buffer, size_t packet_num_in_buffer,
+                  Table<size_t>& frame_start, char* tx_buffer,
+                  const std::atomic<size_t>& frames_done);
+  ~PacketTxRxBench() final;
+
+ private:
+  bool CreateWorker(size_t tid, size_t interface_count, size_t interface_offset,
+                    size_t* rx_frame_start, std::vector<RxPacket>& rx_memory,
+                    std::byte* const tx_memory) final;
+  void LoadPackets(const std::string& filename);
+
+  // The packet of each symbol and antenna of frame 0, the rows of the pilot
+  // and uplink symbols are filled
+  Table<uint8_t> packets_;
+  // Frames Agora has completed, set by the master
+  const std::atomic<size_t>& frames_done_;
+};
+
+#endif  // PACKETTXRX_BENCH_H_
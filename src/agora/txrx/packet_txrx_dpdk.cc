@@ -8,6 +8,8 @@
 
 #include <arpa/inet.h>
 
+#include <algorithm>
+
 #include "logger.h"
 #include "txrx_worker_dpdk.h"
 
@@ -21,7 +23,9 @@ PacketTxRxDpdk::PacketTxRxDpdk(
     : PacketTxRx(AgoraTxRx::TxRxTypes::kBaseStation, cfg, core_offset,
                  event_notify_q, tx_pending_q, notify_producer_tokens,
                  tx_producer_tokens, rx_buffer, packet_num_in_buffer,
-                 frame_start, tx_buffer) {
+                 frame_start, tx_buffer),
+      tx_ext_mem_(nullptr),
+      tx_ext_mem_len_(0) {
   const size_t num_dpdk_eth_dev = cfg_->DpdkNumPorts();
   const size_t worker_threads = NumberTotalWorkers();
   DpdkTransport::DpdkInit(core_offset_ - 1, worker_threads);
@@ -34,7 +38,9 @@ PacketTxRxDpdk::PacketTxRxDpdk(
       (num_dpdk_eth_dev + cfg_->DpdkPortOffset()) <= rte_eth_dev_count_avail(),
       "Too few eth devices available compared to the requested number "
       "(DpdkNumPorts)");
-  mbuf_pool_ = DpdkTransport::CreateMempool(num_dpdk_eth_dev);
+  RtAssert(cfg_->AggregatePacketLength() <= kJumboFrameMaxSize,
+           "PacketTxRxDpdk: fronthaul_aggregation makes a packet longer than "
+           "a jumbo frame");
 
   // Assuming that all devices / ports have the same IP address?
   int ret = inet_pton(AF_INET, cfg_->BsRruAddr().c_str(), &bs_rru_addr_);
@@ -56,36 +62,90 @@ PacketTxRxDpdk::PacketTxRxDpdk(
   const size_t total_interfaces = NumberTotalInterfaces();
   const size_t total_queues = total_interfaces;
   const size_t total_eth_devices = eth_dev_ids.size();
-  size_t queues_per_nic = total_queues / total_eth_devices;
-  if ((total_queues % total_eth_devices) != 0) {
-    queues_per_nic++;
+  // Zero-copy rx packets hold on to their mbufs until the FFT is done, on
+  // top of the mbufs posted to the rx rings
+  RtAssert((cfg_->DpdkZeroCopyRx() == false) ||
+               (packet_num_in_buffer + (total_queues * kRxRingSize) <=
+                kNumMBufs * num_dpdk_eth_dev),
+           "Too few mbufs for dpdk_zero_copy_rx, reduce the rx buffer size");
+  std::vector<size_t> port_interfaces = cfg_->DpdkPortInterfaces();
+  if (port_interfaces.empty()) {
+    size_t queues_per_nic = total_queues / total_eth_devices;
+    if ((total_queues % total_eth_devices) != 0) {
+      queues_per_nic++;
+    }
+    RtAssert((worker_threads % total_eth_devices) == 0,
+             "Number of socket treads must be divisible by the number of Dpdk "
+             "ethernet devices");
+    for (size_t port = 0; port < total_eth_devices; port++) {
+      port_interfaces.push_back(
+          std::min(queues_per_nic,
+                   total_interfaces - std::min(total_interfaces,
+                                               port * queues_per_nic)));
+    }
+  } else {
+    size_t port_interface_sum = 0;
+    for (size_t interfaces : port_interfaces) {
+      RtAssert(interfaces > 0, "dpdk_port_interfaces: a port without radios");
+      port_interface_sum += interfaces;
+    }
+    RtAssert(port_interface_sum == total_interfaces,
+             "dpdk_port_interfaces must add up to the number of radios");
   }
-  RtAssert((worker_threads % total_eth_devices) == 0,
-           "Number of socket treads must be divisible by the number of Dpdk "
-           "ethernet devices");
   size_t interface_id = 0;
   worker_dev_queue_assignment_.resize(NumberTotalWorkers());
-  for (auto& eth_device : eth_dev_ids) {
+  for (size_t port = 0; port < total_eth_devices; port++) {
+    const uint16_t eth_device = eth_dev_ids.at(port);
+    // Each port receives into a pool on its own NUMA node
+    mbuf_pools_.push_back(DpdkTransport::CreateMempool(
+        1, kJumboFrameMaxSize, rte_eth_dev_socket_id(eth_device)));
+    const size_t queues_per_nic = std::max(port_interfaces.at(port), 1ul);
     const int init_status =
-        DpdkTransport::NicInit(eth_device, mbuf_pool_, queues_per_nic);
+        DpdkTransport::NicInit(eth_device, mbuf_pools_.back(), queues_per_nic,
+                               kJumboFrameMaxSize, cfg_->DpdkZeroCopyTx());
     if (init_status != 0) {
       rte_exit(EXIT_FAILURE, "Cannot init nic with id %u\n", eth_device);
     }
+    if (cfg_->DpdkDropUnmatched()) {
+      // Below the per-interface rules of the workers, so that no other
+      // traffic lands on the queues of the workers
+      DpdkTransport::InstallFlowRuleDropAll(eth_device);
+    }
 
     // Previously, Assigned all of the interfaces to workers
     // Now assign dev / queues to each worker.
-    for (size_t queue = 0; queue < queues_per_nic; queue++) {
+    for (size_t queue = 0; queue < port_interfaces.at(port); queue++) {
       //Assign 1 queue to each interface
       const size_t worker_id = InterfaceToWorker(interface_id);
-      worker_dev_queue_assignment_.at(worker_id).push_back(
-          std::make_pair(eth_device, queue));
+      auto& assignment = worker_dev_queue_assignment_.at(worker_id);
+      if ((assignment.empty() == false) &&
+          (assignment.front().first != eth_device)) {
+        // The worker sends from the pool of its first port
+        AGORA_LOG_WARN(
+            "PacketTxRxDpdk: worker %zu serves dev %u and %u, align the "
+            "radios of the workers with dpdk_port_interfaces\n",
+            worker_id, assignment.front().first, eth_device);
+      }
+      assignment.push_back(std::make_pair(eth_device, queue));
+      AGORA_LOG_INFO(
+          "PacketTxRxDpdk: interface %zu (antennas %zu:%zu) on dev %u queue "
+          "%zu, owned by worker %zu\n",
+          interface_id, interface_id * NumChannels(),
+          ((interface_id + 1) * NumChannels()) - 1, eth_device, queue,
+          worker_id);
 
       interface_id++;
-      if (interface_id == total_interfaces) {
-        break;
-      }
     }
   }
+  eth_dev_ids_ = eth_dev_ids;
+  if (cfg_->DpdkZeroCopyTx()) {
+    // The NICs send the payloads straight from the downlink socket buffer
+    tx_ext_mem_ = tx_buffer;
+    tx_ext_mem_len_ =
+        cfg_->DlPacketLength() * cfg_->BsAntNum() * cfg_->FrameWindow() *
+        (cfg_->Frame().NumDlControlSyms() + cfg_->Frame().NumDLSyms());
+    DpdkTransport::RegisterExtMem(tx_ext_mem_, tx_ext_mem_len_, eth_dev_ids_);
+  }
   AGORA_LOG_INFO("DPDK main core id %d, worker lcores (worker + main): %d\n",
                  rte_get_main_lcore(), rte_lcore_count());
 }
@@ -95,40 +155,70 @@ PacketTxRxDpdk::~PacketTxRxDpdk() {
 
   rte_flow_error flow_error;
   AGORA_LOG_FRAME("~PacketTxRxDpdk: dpdk eal cleanup\n");
-  rte_mempool_free(mbuf_pool_);
-
-  uint16_t eth_port = UINT16_MAX;
-  for (auto& worker_devices : worker_dev_queue_assignment_) {
-    for (auto& device_queue : worker_devices) {
-      const auto check_port = device_queue.first;
-      if (eth_port != check_port) {
-        eth_port = check_port;
-        // All workers should have exited, shutdown the resources nicely
-        auto ret_status = rte_flow_flush(eth_port, &flow_error);
-        if (ret_status != 0) {
-          AGORA_LOG_ERROR(
-              "Flow cannot be flushed %d message: %s\n", flow_error.type,
-              flow_error.message ? flow_error.message : "(no stated reason)");
-        }
-
-        ret_status = rte_eth_dev_stop(eth_port);
-        if (ret_status < 0) {
-          AGORA_LOG_ERROR("Failed to stop port %u: %s", eth_port,
-                          rte_strerror(-ret_status));
-        }
-        ret_status = rte_eth_dev_close(eth_port);
-        if (ret_status < 0) {
-          AGORA_LOG_ERROR("Failed to close device %u: %s", eth_port,
-                          rte_strerror(-ret_status));
-        }
-        AGORA_LOG_INFO("PacketTxRxDpdk::Shutdown down dev port %d\n", eth_port);
-      }
+
+  for (const uint16_t eth_port : eth_dev_ids_) {
+    DpdkTransport::PrintPortStats(eth_port);
+    // All workers should have exited, shutdown the resources nicely
+    auto ret_status = rte_flow_flush(eth_port, &flow_error);
+    if (ret_status != 0) {
+      AGORA_LOG_ERROR(
+          "Flow cannot be flushed %d message: %s\n", flow_error.type,
+          flow_error.message ? flow_error.message : "(no stated reason)");
     }
+
+    ret_status = rte_eth_dev_stop(eth_port);
+    if (ret_status < 0) {
+      AGORA_LOG_ERROR("Failed to stop port %u: %s", eth_port,
+                      rte_strerror(-ret_status));
+    }
+    ret_status = rte_eth_dev_close(eth_port);
+    if (ret_status < 0) {
+      AGORA_LOG_ERROR("Failed to close device %u: %s", eth_port,
+                      rte_strerror(-ret_status));
+    }
+    AGORA_LOG_INFO("PacketTxRxDpdk::Shutdown down dev port %d\n", eth_port);
+  }
+  // The closed ports no longer hold any mbufs
+  for (rte_mempool* mbuf_pool : mbuf_pools_) {
+    rte_mempool_free(mbuf_pool);
+  }
+  if (tx_ext_mem_ != nullptr) {
+    DpdkTransport::UnregisterExtMem(tx_ext_mem_, tx_ext_mem_len_,
+                                    eth_dev_ids_);
   }
   rte_delay_ms(100);
   rte_eal_cleanup();
 }
 
+rte_mempool* PacketTxRxDpdk::PortPool(size_t tid) const {
+  const auto& assignment = worker_dev_queue_assignment_.at(tid);
+  RtAssert(assignment.empty() == false,
+           "PacketTxRxDpdk: a worker without dpdk queues");
+  for (size_t port = 0; port < eth_dev_ids_.size(); port++) {
+    if (eth_dev_ids_.at(port) == assignment.front().first) {
+      return mbuf_pools_.at(port);
+    }
+  }
+  throw std::runtime_error("PacketTxRxDpdk: worker " + std::to_string(tid) +
+                           " is on an unknown dev");
+}
+
+unsigned int PacketTxRxDpdk::WorkerLcore(size_t tid) const {
+  unsigned int thread_l_core = tid;
+  for (size_t lcore_idx = 0; lcore_idx <= tid; lcore_idx++) {
+    // 1 to skip main core, 0 to disable wrap
+    thread_l_core = rte_get_next_lcore(thread_l_core, 1, 0);
+  }
+
+  // Verify the lcore id is enabled (should have be inited with proper id)
+  const int enabled = rte_lcore_is_enabled(thread_l_core);
+  if (enabled == false) {
+    throw std::runtime_error("The lcore " + std::to_string(thread_l_core) +
+                             " tid passed to CreateWorker is not enabled");
+  }
+  return thread_l_core;
+}
+
 bool PacketTxRxDpdk::CreateWorker(size_t tid, size_t interface_count,
                                   size_t interface_offset,
                                   size_t* rx_frame_start,
@@ -146,25 +236,14 @@ bool PacketTxRxDpdk::CreateWorker(size_t tid, size_t interface_count,
 
   //interface_count = number of ports (logical) to monitor
   //interface_offset = starting port (logical)
-  unsigned int thread_l_core = tid;
-  for (size_t lcore_idx = 0; lcore_idx <= tid; lcore_idx++) {
-    // 1 to skip main core, 0 to disable wrap
-    thread_l_core = rte_get_next_lcore(thread_l_core, 1, 0);
-  }
-
-  // Verify the lcore id is enabled (should have be inited with proper id)
-  const int enabled = rte_lcore_is_enabled(thread_l_core);
-  if (enabled == false) {
-    throw std::runtime_error("The lcore " + std::to_string(thread_l_core) +
-                             " tid passed to CreateWorker is not enabled");
-  }
+  const unsigned int thread_l_core = WorkerLcore(tid);
 
   // launch communication and task thread onto specific core
   worker_threads_.emplace_back(std::make_unique<TxRxWorkerDpdk>(
       core_offset_, thread_l_core, interface_count, interface_offset, cfg_,
       rx_frame_start, event_notify_q_, tx_pending_q_, *tx_producer_tokens_[tid],
       *notify_producer_tokens_[tid], rx_memory, tx_memory, mutex_, cond_,
-      proceed_, worker_dev_queue_assignment_.at(tid), mbuf_pool_));
+      proceed_, worker_dev_queue_assignment_.at(tid), PortPool(tid)));
   AGORA_LOG_INFO("PacketTxRxDpdk: worker %zu assigned to lcore %d \n", tid,
                  thread_l_core);
 
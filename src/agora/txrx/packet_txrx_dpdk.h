@@ -14,32 +14,6 @@ static_assert(false, "Packet tx rx dpdk defined but DPDK is not enabled");
 #include "dpdk_transport.h"
 #include "packet_txrx.h"
 
-//Removed support for copy free dpdk memory due to slowdown issue.
-//#define USE_DPDK_MEMORY
-
-#if defined(USE_DPDK_MEMORY)
-class DPDKRxPacket : public RxPacket {
- public:
-  DPDKRxPacket() : RxPacket() { mem_ = nullptr; }
-  explicit DPDKRxPacket(const DPDKRxPacket& copy) : RxPacket(copy) {
-    mem_ = copy.mem_;
-  }
-  ~DPDKRxPacket() = default;
-  inline bool Set(rte_mbuf* mem, Packet* in_pkt) {
-    mem_ = mem;
-    return RxPacket::Set(in_pkt);
-  }
-
- private:
-  rte_mbuf* mem_;
-  inline void GcPacket() override {
-    //std::printf("Garbage collecting the memory for DPDKRxPacket\n");
-    rte_pktmbuf_free(mem_);
-    this->Set(nullptr, nullptr);
-  }
-};
-#endif  // defined(USE_DPDK_MEMORY)
-
 /**
  * @brief Implementations of this class provide packet I/O for Agora using dpdk accelerations.
  */
@@ -52,28 +26,33 @@ class PacketTxRxDpdk : public PacketTxRx {
                  moodycamel::ProducerToken** tx_producer_tokens,
                  Table<char>& rx_buffer, size_t packet_num_in_buffer,
                  Table<size_t>& frame_start, char* tx_buffer);
-  ~PacketTxRxDpdk() final;
+  ~PacketTxRxDpdk() override;
+
+ protected:
+  // The lcore of worker [tid]
+  unsigned int WorkerLcore(size_t tid) const;
+  // The mbuf pool of the first port of worker [tid]
+  rte_mempool* PortPool(size_t tid) const;
+
+  // Worker x (dpdk dev : queueid)
+  std::vector<std::vector<std::pair<uint16_t, uint16_t>>>
+      worker_dev_queue_assignment_;
 
  private:
   void DoTxRx(size_t tid);  // The thread function for thread [tid]
 
   bool CreateWorker(size_t tid, size_t interface_count, size_t interface_offset,
                     size_t* rx_frame_start, std::vector<RxPacket>& rx_memory,
-                    std::byte* const tx_memory) final;
+                    std::byte* const tx_memory) override;
 
   uint32_t bs_rru_addr_;     // IPv4 address of the simulator sender
   uint32_t bs_server_addr_;  // IPv4 address of the Agora server
-  rte_mempool* mbuf_pool_;
-
-  // Worker x (dpdk dev : queueid)
-  std::vector<std::vector<std::pair<uint16_t, uint16_t>>>
-      worker_dev_queue_assignment_;
-
-  // Dimension 1: socket_thread
-  // Dimension 2: rx_packet
-#if defined(USE_DPDK_MEMORY)
-  std::vector<std::vector<DPDKRxPacket>> rx_packets_dpdk_;
-#endif
+  // One pool per port in eth_dev_ids_, on the NUMA node of the port
+  std::vector<rte_mempool*> mbuf_pools_;
+  // Downlink socket buffer registered for zero-copy TX, nullptr otherwise
+  char* tx_ext_mem_;
+  size_t tx_ext_mem_len_;
+  std::vector<uint16_t> eth_dev_ids_;
 };
 
 #endif  // PACKETTXRX_DPDK_H_
\ No newline at end of file
@@ -0,0 +1,75 @@
+/**
+ * @file packet_txrx_oran.cc
+ * @brief Implementation of PacketTxRxOran, the packet I/O of Agora with
+ * O-RAN 7.2x radio units over DPDK
+ */
+
+#include "packet_txrx_oran.h"
+
+#include <ctime>
+
+#include "gettime.h"
+#include "logger.h"
+#include "txrx_worker_oran.h"
+
+// The GPS epoch on the TAI clock of the host: 1980-01-06 in Unix time, and
+// the 19 seconds that TAI was then ahead of GPS
+static constexpr int64_t kGpsEpochTaiNs = 315964819000000000;
+
+PacketTxRxOran::PacketTxRxOran(
+    Config* const cfg, size_t core_offset,
+    moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+    moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+    moodycamel::ProducerToken** notify_producer_tokens,
+    moodycamel::ProducerToken** tx_producer_tokens, Table<char>& rx_buffer,
+    size_t packet_num_in_buffer, Table<size_t>& frame_start, char* tx_buffer)
+    : PacketTxRxDpdk(cfg, core_offset, event_notify_q, tx_pending_q,
+                     notify_producer_tokens, tx_producer_tokens, rx_buffer,
+                     packet_num_in_buffer, frame_start, tx_buffer),
+      timing_(cfg->OranNumerology(), cfg->Frame().NumTotalSyms()) {
+  RtAssert(cfg_->OranFronthaul(),
+           "PacketTxRxOran: the config has no oran_fronthaul");
+  RtAssert(cfg_->PacketLength() + sizeof(rte_ether_hdr) + sizeof(rte_vlan_hdr) +
+                   kOranUplaneHeaderBytes <=
+               kJumboFrameMaxSize,
+           "PacketTxRxOran: the PRBs of a symbol do not fit a jumbo frame");
+}
+
+PacketTxRxOran::~PacketTxRxOran() {
+  // The workers read timing_, which goes before ~PacketTxRxDpdk() stops them
+  StopTxRx();
+}
+
+bool PacketTxRxOran::StartTxRx(Table<complex_float>& calib_dl_buffer,
+                               Table<complex_float>& calib_ul_buffer) {
+  timespec tai;
+  const int ret = clock_gettime(CLOCK_TAI, &tai);
+  RtAssert(ret == 0, "PacketTxRxOran: no TAI clock");
+  const size_t host_tsc = GetTime::Rdtsc();
+  const int64_t gps_ns = (static_cast<int64_t>(tai.tv_sec) * 1000000000) +
+                         tai.tv_nsec - kGpsEpochTaiNs;
+  timing_.Start(gps_ns, host_tsc, GetTime::MeasureRdtscFreq(), kStartLeadNs);
+  AGORA_LOG_INFO(
+      "PacketTxRxOran: frame 0 starts at GPS symbol %zu, %.3f ms from now\n",
+      timing_.FirstSymbol(),
+      static_cast<double>(timing_.SymbolNs(timing_.FirstSymbol()) - gps_ns) /
+          1e6);
+  return PacketTxRxDpdk::StartTxRx(calib_dl_buffer, calib_ul_buffer);
+}
+
+bool PacketTxRxOran::CreateWorker(size_t tid, size_t interface_count,
+                                  size_t interface_offset,
+                                  size_t* rx_frame_start,
+                                  std::vector<RxPacket>& rx_memory,
+                                  std::byte* const tx_memory) {
+  const unsigned int thread_l_core = WorkerLcore(tid);
+  worker_threads_.emplace_back(std::make_unique<TxRxWorkerOran>(
+      core_offset_, thread_l_core, interface_count, interface_offset, cfg_,
+      rx_frame_start, event_notify_q_, tx_pending_q_, *tx_producer_tokens_[tid],
+      *notify_producer_tokens_[tid], rx_memory, tx_memory, mutex_, cond_,
+      proceed_, worker_dev_queue_assignment_.at(tid), PortPool(tid), timing_));
+  AGORA_LOG_INFO(
+      "PacketTxRxOran: worker %zu assigned to lcore %d, RUs %zu:%zu\n", tid,
+      thread_l_core, interface_offset, interface_offset + interface_count - 1);
+  return true;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file packet_txrx_oran.h
+ * @brief Declaration of PacketTxRxOran, the packet I/O of Agora with O-RAN
+ * 7.2x radio units over DPDK
+ */
+
+#ifndef PACKETTXRX_ORAN_H_
+#define PACKETTXRX_ORAN_H_
+
+#include "oran_fronthaul.h"
+#include "packet_txrx_dpdk.h"
+
+/**
+ * @brief Packet I/O with O-RAN 7.2x radio units (RUs): the NICs are set up
+ * as for PacketTxRxDpdk, one RU per interface, and the workers exchange the
+ * eCPRI U-plane and C-plane messages of the RUs. Agora frame 0 starts on a
+ * radio frame of the GPS time of the host clock, which must be synchronized
+ * to the RUs (e.g., with PTP).
+ */
+class PacketTxRxOran : public PacketTxRxDpdk {
+ public:
+  /// Nanoseconds from StartTxRx() to the start of Agora frame 0, for the
+  /// workers to start and the first C-plane messages to go out
+  static constexpr int64_t kStartLeadNs = 200000000;
+
+  PacketTxRxOran(Config* const cfg, size_t core_offset,
+                 moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+                 moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+                 moodycamel::ProducerToken** notify_producer_tokens,
+                 moodycamel::ProducerToken** tx_producer_tokens,
+                 Table<char>& rx_buffer, size_t packet_num_in_buffer,
+                 Table<size_t>& frame_start, char* tx_buffer);
+  ~PacketTxRxOran() final;
+
+  bool StartTxRx(Table<complex_float>& calib_dl_buffer,
+                 Table<complex_float>& calib_ul_buffer) final;
+
+ private:
+  bool CreateWorker(size_t tid, size_t interface_count, size_t interface_offset,
+                    size_t* rx_frame_start, std::vector<RxPacket>& rx_memory,
+                    std::byte* const tx_memory) final;
+
+  // Started by StartTxRx(), before the workers are created
+  OranTiming timing_;
+};
+
+#endif  // PACKETTXRX_ORAN_H_
@@ -30,7 +30,8 @@ PacketTxRxRadio::PacketTxRxRadio(
     : PacketTxRx(AgoraTxRx::TxRxTypes::kBaseStation, cfg, core_offset,
                  event_notify_q, tx_pending_q, notify_producer_tokens,
                  tx_producer_tokens, rx_buffer, packet_num_in_buffer,
-                 frame_start, tx_buffer) {
+                 frame_start, tx_buffer),
+      radio_timing_(std::make_unique<RadioTiming>(cfg->NumRadios())) {
 #if defined(USE_PURE_UHD)
   AGORA_LOG_INFO("Using UHD");
   radio_config_ = std::make_unique<RadioSetUhd>(cfg, kRadioType);
@@ -48,6 +49,7 @@ PacketTxRxRadio::~PacketTxRxRadio() {
   AGORA_LOG_INFO("PacketTxRxRadio: shutting down radios\n");
   radio_config_->RadioStop();
   radio_config_.reset();
+  radio_timing_->PrintSummary();
 }
 
 bool PacketTxRxRadio::StartTxRx(Table<complex_float>& calib_dl_buffer,
@@ -59,10 +61,10 @@ bool PacketTxRxRadio::StartTxRx(Table<complex_float>& calib_dl_buffer,
   //RadioStart creates the following: radio_config_->GetCalibDl() and radio_config_->GetCalibUl();
   if (cfg_->Frame().NumDLSyms() > 0) {
     std::memset(
-        calib_dl_buffer[kFrameWnd - 1], 0,
+        calib_dl_buffer[cfg_->FrameWindow() - 1], 0,
         cfg_->OfdmDataNum() * cfg_->BfAntNum() * sizeof(arma::cx_float));
     std::memset(
-        calib_ul_buffer[kFrameWnd - 1], 0,
+        calib_ul_buffer[cfg_->FrameWindow() - 1], 0,
         cfg_->OfdmDataNum() * cfg_->BfAntNum() * sizeof(arma::cx_float));
   }
 
@@ -97,7 +99,8 @@ bool PacketTxRxRadio::CreateWorker(size_t tid, size_t interface_count,
         core_offset_, tid, interface_count, interface_offset, cfg_,
         rx_frame_start, event_notify_q_, tx_pending_q_,
         *tx_producer_tokens_[tid], *notify_producer_tokens_[tid], rx_memory,
-        tx_memory, mutex_, cond_, proceed_, *radio_config_.get()));
+        tx_memory, mutex_, cond_, proceed_, *radio_config_.get(),
+        radio_timing_.get()));
   } else if (kUseUHD) {
 #if defined(USE_PURE_UHD)
     worker_threads_.emplace_back(std::make_unique<TxRxWorkerUsrp>(
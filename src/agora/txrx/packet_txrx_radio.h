@@ -10,6 +10,7 @@
 #include "common_typedef_sdk.h"
 #include "packet_txrx.h"
 #include "radio_set.h"
+#include "radio_timing.h"
 
 /**
  * @brief Implementations of this class provide packet I/O for Agora.
@@ -32,6 +33,9 @@ class PacketTxRxRadio : public PacketTxRx {
   ~PacketTxRxRadio() final;
   bool StartTxRx(Table<complex_float>& calib_dl_buffer,
                  Table<complex_float>& calib_ul_buffer) final;
+  inline const RadioTiming* Timing() const final {
+    return radio_timing_.get();
+  }
 
  private:
   bool CreateWorker(size_t tid, size_t interface_count, size_t interface_offset,
@@ -39,6 +43,7 @@ class PacketTxRxRadio : public PacketTxRx {
                     std::byte* const tx_memory) final;
 
   std::unique_ptr<RadioSet> radio_config_;
+  std::unique_ptr<RadioTiming> radio_timing_;
 };
 
 #endif  // PACKETTXRX_RADIO_H_
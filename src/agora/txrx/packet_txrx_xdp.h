@@ -0,0 +1,38 @@
+/**
+ * @file packet_txrx_xdp.h
+ * @brief Implementation of PacketTxRxXdp datapath functions for communicating
+ * over AF_XDP sockets
+ */
+
+#ifndef PACKETTXRX_XDP_H_
+#define PACKETTXRX_XDP_H_
+
+#if !defined(USE_XDP)
+static_assert(false, "Packet tx rx xdp defined but XDP is not enabled");
+#endif
+
+#include "packet_txrx.h"
+
+/**
+ * @brief Implementations of this class provide packet I/O for Agora using
+ * AF_XDP sockets. The NIC stays with the kernel driver, and each worker owns
+ * one queue of it through its own socket.
+ */
+class PacketTxRxXdp : public PacketTxRx {
+ public:
+  PacketTxRxXdp(Config* const cfg, size_t core_offset,
+                moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+                moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+                moodycamel::ProducerToken** notify_producer_tokens,
+                moodycamel::ProducerToken** tx_producer_tokens,
+                Table<char>& rx_buffer, size_t packet_num_in_buffer,
+                Table<size_t>& frame_start, char* tx_buffer);
+  ~PacketTxRxXdp() final = default;
+
+ private:
+  bool CreateWorker(size_t tid, size_t interface_count, size_t interface_offset,
+                    size_t* rx_frame_start, std::vector<RxPacket>& rx_memory,
+                    std::byte* const tx_memory) final;
+};
+
+#endif  // PACKETTXRX_XDP_H_
@@ -0,0 +1,173 @@
+/**
+ * @file radio_timing.cc
+ * @brief Implementation file for the TimingHistogram and RadioTiming classes.
+ */
+#include "radio_timing.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.h"
+
+size_t TimingHistogram::Bucket(double us) {
+  const size_t magnitude = static_cast<size_t>(
+      std::min(std::fabs(us), static_cast<double>(kMaxUs - 1)));
+  size_t bucket = magnitude;
+  if (magnitude >= kLinearUs) {
+    const size_t exponent = 63 - __builtin_clzll(magnitude);
+    const size_t sub = (magnitude >> (exponent - 3)) & (kSubBuckets - 1);
+    bucket = kLinearUs + ((exponent - 4) * kSubBuckets) + sub;
+  }
+  return (us < 0) ? (kNumBuckets - 1 - bucket) : (kNumBuckets + bucket);
+}
+
+double TimingHistogram::BucketMidUs(size_t bucket) {
+  const bool negative = bucket < kNumBuckets;
+  const size_t magnitude_bucket =
+      negative ? (kNumBuckets - 1 - bucket) : (bucket - kNumBuckets);
+  double mid_us = magnitude_bucket + 0.5;
+  if (magnitude_bucket >= kLinearUs) {
+    const size_t exponent = 4 + ((magnitude_bucket - kLinearUs) / kSubBuckets);
+    const size_t sub = (magnitude_bucket - kLinearUs) % kSubBuckets;
+    const double width = static_cast<double>(size_t{1} << (exponent - 3));
+    mid_us = static_cast<double>(size_t{1} << exponent) + (sub * width) +
+             (width / 2);
+  }
+  return negative ? -mid_us : mid_us;
+}
+
+void TimingHistogram::Record(double us) {
+  // Single writer, so a load and a store are enough
+  auto& count = this->buckets_[Bucket(us)];
+  count.store(count.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+  this->total_.store(this->total_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+}
+
+TimingHistogram::Counts TimingHistogram::Snapshot() const {
+  Counts counts;
+  for (size_t i = 0; i < counts.buckets_.size(); i++) {
+    counts.buckets_[i] = this->buckets_[i].load(std::memory_order_relaxed);
+    counts.total_ += counts.buckets_[i];
+  }
+  return counts;
+}
+
+void TimingHistogram::Counts::Add(const Counts& other) {
+  for (size_t i = 0; i < this->buckets_.size(); i++) {
+    this->buckets_[i] += other.buckets_[i];
+  }
+  this->total_ += other.total_;
+}
+
+double TimingHistogram::Counts::PercentileUs(double fraction) const {
+  if (this->total_ == 0) {
+    return 0;
+  }
+  const size_t rank = std::min(
+      this->total_ - 1,
+      static_cast<size_t>(std::max(0.0, fraction) * this->total_));
+  size_t below = 0;
+  for (size_t i = 0; i < this->buckets_.size(); i++) {
+    below += this->buckets_[i];
+    if (below > rank) {
+      return BucketMidUs(i);
+    }
+  }
+  return BucketMidUs(this->buckets_.size() - 1);
+}
+
+RadioTiming::RadioTiming(size_t num_radios)
+    : num_radios_(num_radios),
+      rx_(std::make_unique<TimingHistogram[]>(num_radios * kNumRxTypes)),
+      tx_(std::make_unique<TimingHistogram[]>(num_radios * kNumTxTypes)) {}
+
+RadioTiming::Summary RadioTiming::Summarize(
+    const std::unique_ptr<TimingHistogram[]>& histograms, size_t num_types,
+    size_t type, double tail, bool worst_is_high) const {
+  Summary summary{};
+  TimingHistogram::Counts all;
+  bool have_worst = false;
+  for (size_t radio = 0; radio < this->num_radios_; radio++) {
+    const TimingHistogram::Counts counts =
+        histograms[(radio * num_types) + type].Snapshot();
+    if (counts.total_ == 0) {
+      continue;
+    }
+    const double radio_tail = counts.PercentileUs(tail);
+    if ((have_worst == false) ||
+        (worst_is_high ? (radio_tail > summary.worst_tail_us_)
+                       : (radio_tail < summary.worst_tail_us_))) {
+      have_worst = true;
+      summary.worst_radio_ = radio;
+      summary.worst_tail_us_ = radio_tail;
+    }
+    all.Add(counts);
+  }
+  summary.count_ = all.total_;
+  summary.p50_us_ = all.PercentileUs(0.5);
+  summary.tail_us_ = all.PercentileUs(tail);
+  return summary;
+}
+
+RadioTiming::Summary RadioTiming::RxSummary(RxType type) const {
+  return Summarize(this->rx_, kNumRxTypes, static_cast<size_t>(type), 0.99,
+                   true);
+}
+
+RadioTiming::Summary RadioTiming::TxSummary(TxType type) const {
+  return Summarize(this->tx_, kNumTxTypes, static_cast<size_t>(type), 0.01,
+                   false);
+}
+
+void RadioTiming::PrintSummary() const {
+  for (size_t i = 0; i < kNumRxTypes; i++) {
+    const auto type = static_cast<RxType>(i);
+    const Summary summary = RxSummary(type);
+    if (summary.count_ > 0) {
+      AGORA_LOG_INFO(
+          "RadioTiming: %s rx arrival of %zu symbols - p50 %.1f us, p99 %.1f "
+          "us, worst radio %zu p99 %.1f us\n",
+          RxTypeName(type).c_str(), summary.count_, summary.p50_us_,
+          summary.tail_us_, summary.worst_radio_, summary.worst_tail_us_);
+    }
+  }
+  for (size_t i = 0; i < kNumTxTypes; i++) {
+    const auto type = static_cast<TxType>(i);
+    const Summary summary = TxSummary(type);
+    if (summary.count_ > 0) {
+      AGORA_LOG_INFO(
+          "RadioTiming: %s tx lead of %zu symbols - p50 %.1f us, p1 %.1f us, "
+          "worst radio %zu p1 %.1f us\n",
+          TxTypeName(type).c_str(), summary.count_, summary.p50_us_,
+          summary.tail_us_, summary.worst_radio_, summary.worst_tail_us_);
+    }
+  }
+}
+
+std::string RadioTiming::RxTypeName(RxType type) {
+  switch (type) {
+    case RxType::kPilot:
+      return "pilot";
+    case RxType::kUplink:
+      return "uplink";
+    case RxType::kCalibration:
+      return "calibration";
+  }
+  return "unknown";
+}
+
+std::string RadioTiming::TxTypeName(TxType type) {
+  switch (type) {
+    case TxType::kBeacon:
+      return "beacon";
+    case TxType::kControl:
+      return "control";
+    case TxType::kDownlink:
+      return "downlink";
+    case TxType::kCalibration:
+      return "calibration";
+  }
+  return "unknown";
+}
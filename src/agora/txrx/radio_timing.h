@@ -0,0 +1,110 @@
+/**
+ * @file radio_timing.h
+ * @brief Declaration file for the RadioTiming class, which keeps histograms
+ * of the symbol RX arrival and TX lead times of the radios against their
+ * hardware timestamps.
+ */
+#ifndef RADIO_TIMING_H_
+#define RADIO_TIMING_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/// Histogram of signed times in microseconds, in log-linear buckets of the
+/// magnitude: 1 us wide up to kLinearUs, then kSubBuckets per power of two
+/// up to kMaxUs, where the larger times are clamped. Recorded by a single
+/// thread, read by any thread.
+class TimingHistogram {
+ public:
+  static constexpr size_t kLinearUs = 16;
+  static constexpr size_t kSubBuckets = 8;
+  static constexpr size_t kMaxUs = size_t{1} << 24;
+  // Buckets of each sign
+  static constexpr size_t kNumBuckets = kLinearUs + (20 * kSubBuckets);
+
+  /// Plain copy of the buckets, from the most negative to the most positive
+  struct Counts {
+    std::array<size_t, 2 * kNumBuckets> buckets_{};
+    size_t total_ = 0;
+
+    void Add(const Counts& other);
+    /// Time below which fraction (0 to 1) of the samples lie, at the middle
+    /// of its bucket. 0 if empty.
+    double PercentileUs(double fraction) const;
+  };
+
+  /// From the recording thread
+  void Record(double us);
+  inline size_t Count() const {
+    return this->total_.load(std::memory_order_relaxed);
+  }
+  Counts Snapshot() const;
+
+  /// Bucket of the counts, and the middle time of a bucket
+  static size_t Bucket(double us);
+  static double BucketMidUs(size_t bucket);
+
+ private:
+  std::array<std::atomic<size_t>, 2 * kNumBuckets> buckets_{};
+  std::atomic<size_t> total_{0};
+};
+
+/// Timing of the symbols of each radio. The RX arrival is the time from the
+/// last sample of a symbol on the radio to its reception by the host, and
+/// the TX lead is the time from the handoff of a symbol to the driver to its
+/// transmission. Each radio is recorded by the TxRx worker thread that owns
+/// it.
+class RadioTiming {
+ public:
+  enum class RxType { kPilot, kUplink, kCalibration };
+  enum class TxType { kBeacon, kControl, kDownlink, kCalibration };
+  static constexpr size_t kNumRxTypes = 3;
+  static constexpr size_t kNumTxTypes = 4;
+
+  /// Of one symbol type over all radios. The tail is the 99th percentile
+  /// for the RX arrival, and the 1st percentile (the closest to the
+  /// deadline) for the TX lead.
+  struct Summary {
+    size_t count_;
+    double p50_us_;
+    double tail_us_;
+    // The radio with the worst tail
+    size_t worst_radio_;
+    double worst_tail_us_;
+  };
+
+  explicit RadioTiming(size_t num_radios);
+
+  inline void RecordRx(size_t radio_id, RxType type, double us) {
+    this->rx_[(radio_id * kNumRxTypes) + static_cast<size_t>(type)].Record(
+        us);
+  }
+  inline void RecordTx(size_t radio_id, TxType type, double us) {
+    this->tx_[(radio_id * kNumTxTypes) + static_cast<size_t>(type)].Record(
+        us);
+  }
+
+  /// From any thread
+  Summary RxSummary(RxType type) const;
+  Summary TxSummary(TxType type) const;
+  /// Log the summary of each symbol type
+  void PrintSummary() const;
+
+  static std::string RxTypeName(RxType type);
+  static std::string TxTypeName(TxType type);
+
+ private:
+  Summary Summarize(const std::unique_ptr<TimingHistogram[]>& histograms,
+                    size_t num_types, size_t type, double tail,
+                    bool worst_is_high) const;
+
+  const size_t num_radios_;
+  // Per radio, then symbol type
+  std::unique_ptr<TimingHistogram[]> rx_;
+  std::unique_ptr<TimingHistogram[]> tx_;
+};
+
+#endif  // RADIO_TIMING_H_
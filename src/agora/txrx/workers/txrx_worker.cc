@@ -6,6 +6,7 @@
 
 #include "txrx_worker.h"
 
+#include "gettime.h"
 #include "logger.h"
 
 TxRxWorker::TxRxWorker(size_t core_offset, size_t tid, size_t interface_count,
@@ -73,6 +74,19 @@ void TxRxWorker::WaitSync() {
 }
 
 bool TxRxWorker::NotifyComplete(const EventData& complete_event) {
+  if (trace_ring_ != nullptr) {
+    const size_t tsc = GetTime::Rdtsc();
+    trace_ring_->Record(complete_event, tsc, tsc);
+  }
+  if (notify_ring_ != nullptr) {
+    // The master drains the ring every loop, so it is never full for long
+    while (notify_ring_->TryPush(complete_event) == false) {
+      if (cfg_->Running() == false) {
+        return false;
+      }
+    }
+    return true;
+  }
   auto enqueue_status =
       event_notify_q_->enqueue(notify_producer_token_, complete_event);
   if (enqueue_status == false) {
@@ -122,6 +136,25 @@ RxPacket& TxRxWorker::GetRxPacket() {
   return new_packet;
 }
 
+void TxRxWorker::NotifyAggregate(const AggregatePacket& agg,
+                                 size_t num_entries, void* mem,
+                                 RxPacket::ReleaseFn release,
+                                 std::vector<Packet*>& rx_packets) {
+  const size_t payload_bytes = cfg_->PacketLength() - Packet::kOffsetOfData;
+  const size_t ant_num_per_cell = cfg_->BsAntNum() / cfg_->NumCells();
+  for (size_t i = 0; i < num_entries; i++) {
+    const AggregatePacket::Entry& entry = agg.entries_[i];
+    // The header goes to the packet's own memory, the samples stay in agg
+    RxPacket& rx = GetRxPacket();
+    Packet* pkt = rx.RawPacket();
+    new (pkt) Packet(agg.frame_id_, entry.symbol_id_,
+                     entry.ant_id_ / ant_num_per_cell, entry.ant_id_);
+    rx.SetExternalSamples(agg.Samples(i, payload_bytes), mem, release);
+    NotifyComplete(EventData(EventType::kPacketRX, rx_tag_t(rx).tag_));
+    rx_packets.push_back(pkt);
+  }
+}
+
 //Rx memory management
 // Assumes you are returning the last RxPacket obtained by GetRxPacket
 // Could be dangerous if you call this on memory that has been passed to another object
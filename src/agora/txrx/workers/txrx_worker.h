@@ -11,9 +11,12 @@
 #include <thread>
 #include <vector>
 
+#include "analog_beams.h"
 #include "concurrentqueue.h"
 #include "config.h"
+#include "event_tracer.h"
 #include "message.h"
+#include "spsc_event_ring.h"
 
 class TxRxWorker {
  public:
@@ -36,18 +39,58 @@ class TxRxWorker {
   virtual void Start();
   virtual void Stop();
   virtual void DoTxRx() = 0;
+  /// Prepare the worker to be polled with PollOnce() by the calling thread
+  /// instead of running DoTxRx() on a thread of its own. Returns false if
+  /// the worker cannot be polled.
+  virtual bool StartInline() { return false; }
+  /// One pass of the DoTxRx() loop: send the pending TX, else receive once.
+  /// Returns true if any packet was sent or received.
+  virtual bool PollOnce() { return false; }
 
   inline size_t Id() const { return tid_; }
   inline bool Started() const { return started_; }
   inline bool Running() const { return running_; }
+  /// Packets this worker received and discarded. Can be read from any
+  /// thread.
+  inline size_t RxDropped() const {
+    return rx_dropped_.load(std::memory_order_relaxed);
+  }
+  /// Record the events posted by this worker in trace_ring. Only call it
+  /// before Start().
+  inline void SetTraceRing(TraceRing* trace_ring) { trace_ring_ = trace_ring; }
+  /// Post the events of this worker to notify_ring instead of the notify
+  /// queue. Only call it before Start().
+  inline void SetNotifyRing(SpscEventRing* notify_ring) {
+    notify_ring_ = notify_ring;
+  }
+  /// Point the analog beams of the radios of this worker as analog_beams
+  /// selects, if the worker drives radios. Only call it before Start().
+  inline void SetAnalogBeams(AnalogBeams* analog_beams) {
+    analog_beams_ = analog_beams;
+  }
 
  protected:
   void WaitSync();
   inline Config* Configuration() { return cfg_; }
   bool NotifyComplete(const EventData& complete_event);
   std::vector<EventData> GetPendingTxEvents(size_t max_events = 0);
+  // Notify the first num_entries payloads of agg as packets whose samples
+  // stay in agg, and add them to rx_packets. The caller holds a reference
+  // of mem per payload, which release(mem) drops once its packet is freed.
+  void NotifyAggregate(const AggregatePacket& agg, size_t num_entries,
+                       void* mem, RxPacket::ReleaseFn release,
+                       std::vector<Packet*>& rx_packets);
   RxPacket& GetRxPacket();
+  // True if the next GetRxPacket() call would not overrun the rx buffer
+  inline bool RxPacketAvailable() const {
+    return rx_memory_.at(rx_memory_idx_).Empty();
+  }
   void ReturnRxPacket(RxPacket& unused_packet);
+  // The worker is the only writer, so no read-modify-write is needed
+  inline void CountRxDropped() {
+    rx_dropped_.store(rx_dropped_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+  }
   Packet* GetTxPacket(size_t frame, size_t symbol, size_t ant);
   Packet* GetUlTxPacket(size_t frame, size_t symbol, size_t ant);
 
@@ -80,5 +123,12 @@ class TxRxWorker {
   moodycamel::ProducerToken& notify_producer_token_;
 
   bool started_;
+  std::atomic<size_t> rx_dropped_{0};
+  // nullptr if tracing is disabled
+  TraceRing* trace_ring_ = nullptr;
+  // nullptr if the events go to event_notify_q_
+  SpscEventRing* notify_ring_ = nullptr;
+  // nullptr if the analog beams are not managed
+  AnalogBeams* analog_beams_ = nullptr;
 };
 #endif  // TXRX_WORKER_H_
@@ -0,0 +1,140 @@
+/**
+ * @file txrx_worker_bench.cc
+ * @brief Implementation of the bench mode txrx worker, which produces the rx
+ * packets in process instead of receiving them.
+ */
+
+#include "txrx_worker_bench.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "gettime.h"
+#include "logger.h"
+
+// Max packets per ProduceEnqueue() call
+static constexpr size_t kProduceBatchSize = 16;
+
+TxRxWorkerBench::TxRxWorkerBench(
+    size_t core_offset, size_t tid, size_t interface_count,
+    size_t interface_offset, Config* const config, size_t* rx_frame_start,
+    moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+    moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+    moodycamel::ProducerToken& tx_producer,
+    moodycamel::ProducerToken& notify_producer,
+    std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
+    std::mutex& sync_mutex, std::condition_variable& sync_cond,
+    std::atomic<bool>& can_proceed, Table<uint8_t>& packets,
+    const std::atomic<size_t>& frames_done)
+    : TxRxWorker(core_offset, tid, interface_count, interface_offset,
+                 config->NumChannels(), config, rx_frame_start, event_notify_q,
+                 tx_pending_q, tx_producer, notify_producer, rx_memory,
+                 tx_memory, sync_mutex, sync_cond, can_proceed),
+      packets_(packets),
+      frames_done_(frames_done),
+      frame_cycles_(0),
+      start_tsc_(0),
+      frame_id_(0),
+      symbol_idx_(0),
+      ant_idx_(0) {
+  for (size_t symbol = 0; symbol < config->Frame().NumTotalSyms(); symbol++) {
+    const SymbolType symbol_type = config->GetSymbolType(symbol);
+    if ((symbol_type == SymbolType::kPilot) ||
+        (symbol_type == SymbolType::kUL)) {
+      rx_symbols_.push_back(symbol);
+    }
+  }
+  RtAssert(rx_symbols_.empty() == false,
+           "TxRxWorkerBench: The frame has no pilot or uplink symbols");
+
+  // Each symbol is released when it would have been received
+  if (config->BenchFrameDurationUs() > 0.0) {
+    const double cycles_per_us = config->FreqGhz() * 1e3;
+    frame_cycles_ =
+        static_cast<size_t>(config->BenchFrameDurationUs() * cycles_per_us);
+    for (const size_t symbol : rx_symbols_) {
+      symbol_release_cycles_.push_back(
+          ((symbol + 1) * frame_cycles_) / config->Frame().NumTotalSyms());
+    }
+  }
+}
+
+TxRxWorkerBench::~TxRxWorkerBench() = default;
+
+//Main Thread Execution loop
+void TxRxWorkerBench::DoTxRx() {
+  PinToCoreWithOffset(ThreadType::kWorkerTXRX, core_offset_, tid_);
+  running_ = true;
+  WaitSync();
+  start_tsc_ = GetTime::Rdtsc();
+
+  size_t prev_frame_id = SIZE_MAX;
+  while (Configuration()->Running() == true) {
+    if (0 == DequeueSend()) {
+      const size_t frame_id = frame_id_;
+      const size_t num_produced = ProduceEnqueue();
+      if (kIsWorkerTimingEnabled && (num_produced > 0) &&
+          (frame_id != prev_frame_id)) {
+        rx_frame_start_[frame_id % kNumStatsFrames] = GetTime::Rdtsc();
+        prev_frame_id = frame_id;
+      }
+    }
+  }
+  running_ = false;
+}
+
+size_t TxRxWorkerBench::ProduceEnqueue() {
+  const size_t packet_length = Configuration()->PacketLength();
+  const size_t num_ants = num_interfaces_ * channels_per_interface_;
+  const size_t ant_offset = interface_offset_ * channels_per_interface_;
+  // Agora only accepts the frames of its window
+  const size_t frame_end =
+      std::min(Configuration()->FramesToTest(),
+               frames_done_.load() + Configuration()->FrameWindow());
+
+  size_t num_produced = 0;
+  while ((num_produced < kProduceBatchSize) && (frame_id_ < frame_end) &&
+         RxPacketAvailable()) {
+    if ((symbol_release_cycles_.empty() == false) &&
+        (GetTime::Rdtsc() - start_tsc_ <
+         (frame_id_ * frame_cycles_) +
+             symbol_release_cycles_.at(symbol_idx_))) {
+      break;
+    }
+    const size_t symbol_id = rx_symbols_.at(symbol_idx_);
+    const size_t ant_id = ant_offset + ant_idx_;
+    RxPacket& rx_placement = GetRxPacket();
+    Packet* pkt = rx_placement.RawPacket();
+    std::memcpy(pkt,
+                packets_[(symbol_id * Configuration()->BsAntNum()) + ant_id],
+                packet_length);
+    pkt->frame_id_ = frame_id_;
+
+    EventData rx_message(EventType::kPacketRX, rx_tag_t(rx_placement).tag_);
+    NotifyComplete(rx_message);
+    num_produced++;
+
+    // Antennas of a symbol, then the symbols of a frame
+    ant_idx_++;
+    if (ant_idx_ == num_ants) {
+      ant_idx_ = 0;
+      symbol_idx_++;
+      if (symbol_idx_ == rx_symbols_.size()) {
+        symbol_idx_ = 0;
+        frame_id_++;
+      }
+    }
+  }
+  return num_produced;
+}
+
+// Downlink packets are completed without being sent
+size_t TxRxWorkerBench::DequeueSend() {
+  const auto tx_events = GetPendingTxEvents();
+  for (const EventData& current_event : tx_events) {
+    assert(current_event.event_type_ == EventType::kPacketTX);
+    NotifyComplete(EventData(EventType::kPacketTX, current_event.tags_[0]));
+  }
+  return tx_events.size();
+}
@@ -0,0 +1,58 @@
+/**
+ * @file txrx_worker_bench.h
+ * @brief txrx worker thread definition.  This is the bench mode declaration
+ */
+
+#ifndef TXRX_WORKER_BENCH_H_
+#define TXRX_WORKER_BENCH_H_
+
+#include <atomic>
+#include <vector>
+
+#include "message.h"
+#include "txrx_worker.h"
+
+class TxRxWorkerBench : public TxRxWorker {
+ public:
+  TxRxWorkerBench(size_t core_offset, size_t tid, size_t interface_count,
+                  size_t interface_offset, Config* const config,
+                  size_t* rx_frame_start,
+                  moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+                  moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+                  moodycamel::ProducerToken& tx_producer,
+                  moodycamel::ProducerToken& notify_producer,
+                  std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
+                  std::mutex& sync_mutex, std::condition_variable& sync_cond,
+                  std::atomic<bool>& can_proceed, Table<uint8_t>& packets,
+                  const std::atomic<size_t>& frames_done);
+  TxRxWorkerBench() = delete;
+  ~TxRxWorkerBench() final;
+
+  void DoTxRx() final;
+
+ private:
+  size_t DequeueSend();
+  // Copy the next packets of the worker's antennas into the rx buffer, as
+  // many as it has free and the frame window allows. Returns the number of
+  // packets enqueued.
+  size_t ProduceEnqueue();
+
+  // Packets of frame 0 of PacketTxRxBench, [symbol * antennas + antenna]
+  Table<uint8_t>& packets_;
+  const std::atomic<size_t>& frames_done_;
+  // Pilot and uplink symbols of a frame
+  std::vector<size_t> rx_symbols_;
+
+  // Cycles from the start of the worker to the release of each pilot and
+  // uplink symbol of frame 0, and between frames. Empty if the frames are
+  // not paced.
+  std::vector<size_t> symbol_release_cycles_;
+  size_t frame_cycles_;
+  size_t start_tsc_;
+
+  // Next packet to produce
+  size_t frame_id_;
+  size_t symbol_idx_;
+  size_t ant_idx_;
+};
+#endif  // TXRX_WORKER_BENCH_H_
@@ -8,16 +8,23 @@
 
 #include <arpa/inet.h>
 
+#include <algorithm>
 #include <cassert>
 #include <utility>
 
 #include "dpdk_transport.h"
 #include "gettime.h"
+#include "idle_policy.h"
 #include "logger.h"
 #include "message.h"
 
 static constexpr bool kDebugDPDK = false;
 
+// RxPacket::ReleaseFn of the zero-copy packets
+static void FreeRxMbuf(void* mem) {
+  rte_pktmbuf_free(static_cast<rte_mbuf*>(mem));
+}
+
 TxRxWorkerDpdk::TxRxWorkerDpdk(
     size_t core_offset, size_t tid, size_t interface_count,
     size_t interface_offset, Config* const config, size_t* rx_frame_start,
@@ -34,7 +41,10 @@ TxRxWorkerDpdk::TxRxWorkerDpdk(
                  tx_pending_q, tx_producer, notify_producer, rx_memory,
                  tx_memory, sync_mutex, sync_cond, can_proceed),
       dpdk_phy_port_queues_(std::move(dpdk_phy)),
-      mbuf_pool_(mbuf_pool) {
+      mbuf_pool_(mbuf_pool),
+      rx_index_(0),
+      prev_frame_id_(SIZE_MAX),
+      tx_in_flight_(0) {
   int ret = inet_pton(AF_INET, config->BsRruAddr().c_str(), &bs_rru_addr_);
   RtAssert(ret == 1, "Invalid sender IP address");
   ret = inet_pton(AF_INET, config->BsServerAddr().c_str(), &bs_server_addr_);
@@ -43,6 +53,10 @@ TxRxWorkerDpdk::TxRxWorkerDpdk(
   RtAssert(dpdk_phy_port_queues_.size() == num_interfaces_,
            "The dev / queue id's list is not long enough to support the number "
            "of requested interfaces");
+  RtAssert((config->DpdkRxBurst() >= kMinRxBatchSize) &&
+               (config->DpdkRxBurst() <= kMaxRxBatchSize),
+           "dpdk_rx_burst is out of range");
+  rx_burst_.resize(num_interfaces_, config->DpdkRxBurst());
 
   //A worker should support multiple dpdk eth devices (ports)
   // and multi radios (interfaces, local ports) per device
@@ -51,6 +65,11 @@ TxRxWorkerDpdk::TxRxWorkerDpdk(
   src_mac_.resize(num_interfaces_);
   dest_mac_.reserve(num_interfaces_);
   dest_mac_.resize(num_interfaces_);
+  tx_headers_.resize(num_interfaces_);
+  rx_clock_sync_.resize(num_interfaces_,
+                        ClockSync(GetTime::MeasureRdtscFreq()));
+  rx_clock_mhz_.resize(num_interfaces_);
+  rx_timestamp_base_.resize(num_interfaces_, 0);
   for (size_t interface = 0; interface < num_interfaces_; interface++) {
     const uint16_t dest_port =
         config->BsServerPort() + (interface + interface_offset_);
@@ -65,6 +84,11 @@ TxRxWorkerDpdk::TxRxWorkerDpdk(
     //addr.addr_bytes
     dest_mac_.at(interface) = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
     RtAssert(status == 0, "Could not retreive mac address");
+    tx_headers_.at(interface) = DpdkTransport::BuildUdpHeader(
+        src_mac_.at(interface), dest_mac_.at(interface), bs_server_addr_,
+        bs_rru_addr_, dest_port, src_port, config->DlPacketLength(), 1,
+        DpdkTransport::TxOffloads(port_id));
+    rx_clock_mhz_.at(interface) = DpdkTransport::RxClockMhz(port_id);
 
     AGORA_LOG_INFO(
         "Adding steering rule for src IP %s, dest IP %s, src port: "
@@ -74,6 +98,21 @@ TxRxWorkerDpdk::TxRxWorkerDpdk(
     DpdkTransport::InstallFlowRule(port_id, queue_id, bs_rru_addr_,
                                    bs_server_addr_, src_port, dest_port);
   }
+
+  if (config->DpdkZeroCopyTx()) {
+    RtAssert(config->DlPacketLength() <= UINT16_MAX,
+             "DlPacketLength is too large for an external mbuf buffer");
+    tx_slots_.resize(config->BsAntNum() * config->FrameWindow() *
+                     (config->Frame().NumDlControlSyms() +
+                      config->Frame().NumDLSyms()));
+    for (auto& slot : tx_slots_) {
+      slot.shinfo_.free_cb = TxPayloadSent;
+      slot.shinfo_.fcb_opaque = &slot;
+      slot.worker_ = this;
+      slot.in_flight_ = false;
+    }
+    tx_sent_tags_.reserve(tx_slots_.size());
+  }
 }
 
 TxRxWorkerDpdk::~TxRxWorkerDpdk() { Stop(); };
@@ -103,8 +142,58 @@ void TxRxWorkerDpdk::Stop() {
 }
 
 void TxRxWorkerDpdk::DoTxRx() {
-  size_t prev_frame_id = SIZE_MAX;
-  size_t rx_index = 0;
+  CheckSocket();
+  running_ = true;
+  WaitSync();
+  AGORA_LOG_TRACE("TxRxWorkerDpdk[%zu]: synced\n", tid_);
+
+  IdlePolicy idle(Configuration());
+  while (Configuration()->Running()) {
+    if (PollOnce()) {
+      idle.Busy();
+    } else {
+      idle.Idle();
+    }
+  }  // running
+  idle.PrintSummary("TxRxWorkerDpdk[" + std::to_string(tid_) + "]");
+  running_ = false;
+}
+
+bool TxRxWorkerDpdk::StartInline() {
+  AGORA_LOG_INFO("TxRxWorkerDpdk[%zu]: polled inline by the calling thread\n",
+                 tid_);
+  CheckSocket();
+  running_ = true;
+  return true;
+}
+
+bool TxRxWorkerDpdk::PollOnce() {
+  const size_t send_result = DequeueSend();
+  if (send_result > 0) {
+    return true;
+  }
+  const auto& port_queue_id = dpdk_phy_port_queues_.at(rx_index_);
+  auto rx_result = RecvEnqueue(port_queue_id.first, port_queue_id.second,
+                               rx_burst_.at(rx_index_));
+  for (auto& rx_packet : rx_result) {
+    //Could move this to the Recv function
+    if (kIsWorkerTimingEnabled) {
+      const size_t& rx_frame_id = rx_packet->frame_id_;
+      if ((prev_frame_id_ == SIZE_MAX) || (rx_frame_id > prev_frame_id_)) {
+        rx_frame_start_[rx_frame_id % kNumStatsFrames] = GetTime::Rdtsc();
+        prev_frame_id_ = rx_frame_id;
+      }
+    }  // end kIsWorkerTimingEnabled
+  }
+  //Cycle through all ports / queues.  Don't wait for successful rx on any given config
+  rx_index_++;
+  if (rx_index_ == dpdk_phy_port_queues_.size()) {
+    rx_index_ = 0;
+  }
+  return (rx_result.empty() == false);
+}
+
+void TxRxWorkerDpdk::CheckSocket() const {
   const unsigned int thread_socket = rte_socket_id();
 
   AGORA_LOG_INFO("TxRxWorkerDpdk[%zu]: running on socket %u\n", tid_,
@@ -121,41 +210,26 @@ void TxRxWorkerDpdk::DoTxRx() {
     }
     dev_id = current_dev_id;
   }
-  running_ = true;
-  WaitSync();
-  AGORA_LOG_TRACE("TxRxWorkerDpdk[%zu]: synced\n", tid_);
-
-  while (Configuration()->Running()) {
-    const size_t send_result = DequeueSend();
-    if (0 == send_result) {
-      const auto& port_queue_id = dpdk_phy_port_queues_.at(rx_index);
-      auto rx_result = RecvEnqueue(port_queue_id.first, port_queue_id.second);
-      for (auto& rx_packet : rx_result) {
-        //Could move this to the Recv function
-        if (kIsWorkerTimingEnabled) {
-          const size_t& rx_frame_id = rx_packet->frame_id_;
-          if ((prev_frame_id == SIZE_MAX) || (rx_frame_id > prev_frame_id)) {
-            rx_frame_start_[rx_frame_id % kNumStatsFrames] = GetTime::Rdtsc();
-            prev_frame_id = rx_frame_id;
-          }
-        }  // end kIsWorkerTimingEnabled
-      }
-      //Cycle through all ports / queues.  Don't wait for successful rx on any given config
-      rx_index++;
-      if (rx_index == dpdk_phy_port_queues_.size()) {
-        rx_index = 0;
-      }
-    }  // send_result == 0
-  }    // running
-  running_ = false;
 }
 
 std::vector<Packet*> TxRxWorkerDpdk::RecvEnqueue(uint16_t port_id,
-                                                 uint16_t queue_id) {
+                                                 uint16_t queue_id,
+                                                 size_t& rx_burst) {
   std::vector<Packet*> rx_packets;
-  std::array<rte_mbuf*, kRxBatchSize> rx_bufs;
-  uint16_t nb_rx =
-      rte_eth_rx_burst(port_id, queue_id, rx_bufs.data(), kRxBatchSize);
+  std::array<rte_mbuf*, kMaxRxBatchSize> rx_bufs;
+  const uint16_t nb_rx =
+      rte_eth_rx_burst(port_id, queue_id, rx_bufs.data(), rx_burst);
+  const size_t rx_tsc = GetTime::Rdtsc();
+  if (Configuration()->DpdkAdaptiveRxBurst()) {
+    // Grow the burst while the queue has a backlog, and shrink it when the
+    // queue is mostly empty, so that a burst does not hold up the pending
+    // TX of this worker at low load
+    if (nb_rx == rx_burst) {
+      rx_burst = std::min(rx_burst * 2, Configuration()->DpdkRxBurst());
+    } else if (nb_rx < rx_burst / 4) {
+      rx_burst = std::max(rx_burst / 2, kMinRxBatchSize);
+    }
+  }
 
   for (size_t i = 0; i < nb_rx; i++) {
     rte_mbuf* dpdk_pkt = rx_bufs.at(i);
@@ -172,6 +246,16 @@ std::vector<Packet*> TxRxWorkerDpdk::RecvEnqueue(uint16_t port_id,
 
     /// \todo Add support / detection of fragmented packets
 
+    // Checked by the NIC if it has the rx checksum offloads
+    if (((dpdk_pkt->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK) ==
+         RTE_MBUF_F_RX_IP_CKSUM_BAD) ||
+        ((dpdk_pkt->ol_flags & RTE_MBUF_F_RX_L4_CKSUM_MASK) ==
+         RTE_MBUF_F_RX_L4_CKSUM_BAD)) {
+      rte_pktmbuf_free(dpdk_pkt);
+      CountRxDropped();
+      continue;
+    }
+
     // This function will free the rx packet if returning true
     bool discard_rx = Filter(dpdk_pkt, port_id, queue_id);
     if (discard_rx == false) {
@@ -193,16 +277,27 @@ std::vector<Packet*> TxRxWorkerDpdk::RecvEnqueue(uint16_t port_id,
       }
 
       auto* payload = reinterpret_cast<uint8_t*>(eth_hdr) + kPayloadOffset;
+      if (Configuration()->FronthaulAggregation() > 1) {
+        RecvAggregate(dpdk_pkt, payload, rx_packets);
+        continue;
+      }
+      const uint64_t air_tsc = RxAirTsc(dpdk_pkt, rx_tsc);
       auto& rx = GetRxPacket();
-      Packet* pkt = rx.RawPacket();
-
-#if defined(USE_DPDK_MEMORY)
-      rx.Set(dpdk_pkt, reinterpret_cast<Packet*>(payload));
-#else
-      rte_memcpy(reinterpret_cast<uint8_t*>(pkt), payload,
-                 Configuration()->PacketLength());
-      rte_pktmbuf_free(dpdk_pkt);
-#endif
+      Packet* pkt;
+      if (Configuration()->DpdkZeroCopyRx()) {
+        // The FFT reads the samples from the mbuf, which is freed with the
+        // last reference to the packet
+        RtAssert(dpdk_pkt->nb_segs == 1,
+                 "TxRxWorkerDpdk: zero-copy rx needs single-segment mbufs");
+        pkt = reinterpret_cast<Packet*>(payload);
+        rx.SetExternal(pkt, dpdk_pkt, FreeRxMbuf);
+      } else {
+        pkt = rx.RawPacket();
+        rte_memcpy(reinterpret_cast<uint8_t*>(pkt), payload,
+                   Configuration()->PacketLength());
+        rte_pktmbuf_free(dpdk_pkt);
+      }
+      pkt->air_tsc_ = air_tsc;
 
       AGORA_LOG_FRAME(
           "TxRxWorkerDpdk[%zu]::RecvEnqueue received pkt (frame %d, symbol "
@@ -214,12 +309,103 @@ std::vector<Packet*> TxRxWorkerDpdk::RecvEnqueue(uint16_t port_id,
       const EventData rx_message(EventType::kPacketRX, rx_tag_t(rx).tag_);
       NotifyComplete(rx_message);
       rx_packets.push_back(pkt);
+    } else {
+      CountRxDropped();
     }
   }
   return rx_packets;
 }
 
+uint64_t TxRxWorkerDpdk::RxAirTsc(const rte_mbuf* dpdk_pkt, size_t rx_tsc) {
+  const uint64_t timestamp = DpdkTransport::RxTimestamp(dpdk_pkt);
+  const double clock_mhz = rx_clock_mhz_.at(rx_index_);
+  if ((timestamp == 0) || (clock_mhz == 0.0)) {
+    return 0;
+  }
+  // From the first timestamp, so that the microseconds keep their precision
+  uint64_t& base = rx_timestamp_base_.at(rx_index_);
+  if (base == 0) {
+    base = timestamp;
+  }
+  const double hw_us =
+      static_cast<double>(static_cast<int64_t>(timestamp - base)) / clock_mhz;
+  ClockSync& clock_sync = rx_clock_sync_.at(rx_index_);
+  clock_sync.Update(hw_us, rx_tsc);
+  return static_cast<uint64_t>(clock_sync.ToHostTsc(hw_us));
+}
+
+void TxRxWorkerDpdk::RecvAggregate(rte_mbuf* dpdk_pkt, uint8_t* payload,
+                                   std::vector<Packet*>& rx_packets) {
+  // The packets of the payloads read their samples from the mbuf, which is
+  // freed with the last reference to them
+  RtAssert(dpdk_pkt->nb_segs == 1,
+           "TxRxWorkerDpdk: aggregate packets need single-segment mbufs");
+  const auto* agg = reinterpret_cast<const AggregatePacket*>(payload);
+  const size_t num_entries = agg->NumEntries(
+      dpdk_pkt->data_len - kPayloadOffset,
+      Configuration()->PacketLength() - Packet::kOffsetOfData);
+  if (num_entries == 0) {
+    AGORA_LOG_WARN("TxRxWorkerDpdk[%zu]: dropped a malformed aggregate\n",
+                   tid_);
+    rte_pktmbuf_free(dpdk_pkt);
+    CountRxDropped();
+    return;
+  }
+  // One reference per payload, set before the master can free any
+  rte_mbuf_refcnt_update(dpdk_pkt, static_cast<int16_t>(num_entries - 1));
+  NotifyAggregate(*agg, num_entries, dpdk_pkt, FreeRxMbuf, rx_packets);
+}
+
+rte_mbuf* TxRxWorkerDpdk::AttachTxPayload(Packet* pkt, size_t frame_id,
+                                          size_t symbol_id, size_t ant_id,
+                                          size_t tag) {
+  const size_t slot_id =
+      (Configuration()->GetTotalSymbolIdxDl(frame_id, symbol_id) *
+       Configuration()->BsAntNum()) +
+      ant_id;
+  TxSlot& slot = tx_slots_.at(slot_id);
+  RtAssert(slot.in_flight_ == false,
+           "TxRxWorkerDpdk: tx memory reused before the NIC has sent it");
+  slot.in_flight_ = true;
+  slot.tag_ = tag;
+  rte_mbuf_ext_refcnt_set(&slot.shinfo_, 1);
+
+  rte_mbuf* payload = rte_pktmbuf_alloc(mbuf_pool_);
+  RtAssert(payload != nullptr, "TxRxWorkerDpdk: mbuf pool is empty");
+  const auto length = static_cast<uint16_t>(Configuration()->DlPacketLength());
+  // IOVA as VA, see DpdkTransport::RegisterExtMem()
+  rte_pktmbuf_attach_extbuf(payload, pkt, reinterpret_cast<rte_iova_t>(pkt),
+                            length, &slot.shinfo_);
+  payload->data_len = length;
+  payload->pkt_len = length;
+  tx_in_flight_++;
+  return payload;
+}
+
+void TxRxWorkerDpdk::TxPayloadSent(void* /*addr*/, void* opaque) {
+  // Called by the NIC driver on this worker's lcore, when it frees the mbuf
+  auto* slot = static_cast<TxSlot*>(opaque);
+  slot->in_flight_ = false;
+  slot->worker_->tx_in_flight_--;
+  slot->worker_->tx_sent_tags_.push_back(slot->tag_);
+}
+
+void TxRxWorkerDpdk::ReclaimTxPayloads() {
+  if (tx_in_flight_ > 0) {
+    for (const auto& port_queue_id : dpdk_phy_port_queues_) {
+      rte_eth_tx_done_cleanup(port_queue_id.first, port_queue_id.second, 0);
+    }
+  }
+  for (const size_t tag : tx_sent_tags_) {
+    NotifyComplete(EventData(EventType::kPacketTX, tag));
+  }
+  tx_sent_tags_.clear();
+}
+
 size_t TxRxWorkerDpdk::DequeueSend() {
+  if (Configuration()->DpdkZeroCopyTx()) {
+    ReclaimTxPayloads();
+  }
   auto tx_events = GetPendingTxEvents();
 
   //Process each pending tx event
@@ -249,34 +435,43 @@ size_t TxRxWorkerDpdk::DequeueSend() {
 
     const size_t local_interface_idx = interface_id - interface_offset_;
 
+    const auto& tx_info = dpdk_phy_port_queues_.at(local_interface_idx);
     rte_mbuf* tx_bufs __attribute__((aligned(64)));
     tx_bufs = DpdkTransport::AllocUdp(
-        mbuf_pool_, src_mac_.at(local_interface_idx),
-        dest_mac_.at(local_interface_idx), bs_server_addr_, bs_rru_addr_,
-        Configuration()->BsServerPort() + interface_id,
-        Configuration()->BsRruPort() + interface_id,
-        Configuration()->DlPacketLength(), 1);
+        mbuf_pool_, tx_headers_.at(local_interface_idx),
+        Configuration()->DlPacketLength(),
+        DpdkTransport::TxOffloads(tx_info.first));
 
     static_assert(
         kTxBatchSize == 1,
         "kTxBatchSize must equal 1 - correct logic or set the value to 1");
-    rte_ether_hdr* eth_hdr = rte_pktmbuf_mtod(tx_bufs, rte_ether_hdr*);
-    auto* payload = reinterpret_cast<char*>(eth_hdr) + kPayloadOffset;
-
-    rte_memcpy(payload, pkt, Configuration()->DlPacketLength());
+    if (Configuration()->DpdkZeroCopyTx()) {
+      // The header mbuf only keeps the headers, and the payload stays in
+      // the tx memory until the NIC has sent it
+      tx_bufs->data_len = kPayloadOffset;
+      tx_bufs->next = AttachTxPayload(pkt, frame_id, symbol_id, ant_id,
+                                      current_event.tags_[0]);
+      tx_bufs->nb_segs = 2;
+    } else {
+      rte_ether_hdr* eth_hdr = rte_pktmbuf_mtod(tx_bufs, rte_ether_hdr*);
+      auto* payload = reinterpret_cast<char*>(eth_hdr) + kPayloadOffset;
+      rte_memcpy(payload, pkt, Configuration()->DlPacketLength());
+    }
 
     // Send data (one OFDM symbol)
     // Must send this out the correct port (dev) + queue that is assigned to this interface (convert global to local index)
-    const auto& tx_info = dpdk_phy_port_queues_.at(local_interface_idx);
     size_t nb_tx_new =
         rte_eth_tx_burst(tx_info.first, tx_info.second, &tx_bufs, kTxBatchSize);
     if (unlikely(nb_tx_new != kTxBatchSize)) {
       AGORA_LOG_ERROR("TxRxWorkerDpdk[%zu]: rte_eth_tx_burst() failed\n", tid_);
       throw std::runtime_error("TxRxWorkerDpdk: rte_eth_tx_burst() failed");
     }
-    const auto complete_event =
-        EventData(EventType::kPacketTX, current_event.tags_[0]);
-    NotifyComplete(complete_event);
+    // Zero-copy packets are reported by ReclaimTxPayloads() once sent
+    if (Configuration()->DpdkZeroCopyTx() == false) {
+      const auto complete_event =
+          EventData(EventType::kPacketTX, current_event.tags_[0]);
+      NotifyComplete(complete_event);
+    }
   }
   return tx_events.size();
 }
@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <vector>
 
+#include "clock_sync.h"
 #include "dpdk_transport.h"
 #include "txrx_worker.h"
 
@@ -32,10 +33,40 @@ class TxRxWorkerDpdk : public TxRxWorker {
   void DoTxRx() final;
   void Start() final;
   void Stop() final;
+  bool StartInline() final;
+  bool PollOnce() final;
 
  private:
-  std::vector<Packet*> RecvEnqueue(uint16_t port_id, uint16_t queue_id);
+  // A downlink packet of the tx memory, attached to an mbuf for zero-copy
+  // TX. The NIC driver calls the free callback of shinfo_ once it is done
+  // with the payload.
+  struct TxSlot {
+    rte_mbuf_ext_shared_info shinfo_;
+    TxRxWorkerDpdk* worker_;
+    size_t tag_;
+    bool in_flight_;
+  };
+
+  // Warn if the calling thread is not on the socket of the ethernet devices
+  void CheckSocket() const;
+  // Receive up to rx_burst packets, and adapt rx_burst to the load if
+  // Config::DpdkAdaptiveRxBurst()
+  std::vector<Packet*> RecvEnqueue(uint16_t port_id, uint16_t queue_id,
+                                   size_t& rx_burst);
+  // The TSC at which dpdk_pkt reached the NIC of the interface being
+  // received, from its hardware rx timestamp, and 0 without one
+  uint64_t RxAirTsc(const rte_mbuf* dpdk_pkt, size_t rx_tsc);
+  // Notify the payloads of the AggregatePacket at payload, in dpdk_pkt
+  void RecvAggregate(rte_mbuf* dpdk_pkt, uint8_t* payload,
+                     std::vector<Packet*>& rx_packets);
   size_t DequeueSend();
+  // Returns an mbuf with the payload of pkt as its external buffer
+  rte_mbuf* AttachTxPayload(Packet* pkt, size_t frame_id, size_t symbol_id,
+                            size_t ant_id, size_t tag);
+  static void TxPayloadSent(void* addr, void* opaque);
+  // Let the NICs free the sent mbufs, and report the zero-copy packets
+  // whose payloads have been sent
+  void ReclaimTxPayloads();
   // Returns true if packet should be ignored - will garbage collect.  Handles arp requests
   bool Filter(rte_mbuf* packet, uint16_t port_id, uint16_t queue_id);
 
@@ -43,9 +74,28 @@ class TxRxWorkerDpdk : public TxRxWorker {
   uint32_t bs_server_addr_;  // IPv4 address of the Agora server
   // dpdk port_id / device : queue_id
   const std::vector<std::pair<uint16_t, uint16_t>> dpdk_phy_port_queues_;
-  // Shared memory pool for rx and tx
+  // Pool on the NUMA node of the first port of the worker, for tx
   rte_mempool* mbuf_pool_;
   std::vector<rte_ether_addr> src_mac_;
   std::vector<rte_ether_addr> dest_mac_;
+  // Prebuilt headers of the downlink packets of each interface
+  std::vector<DpdkTransport::UdpHeader> tx_headers_;
+  // Map from the rx timestamps of the NIC of each interface to the TSC, and
+  // the clock rate and first timestamp of the NIC
+  std::vector<ClockSync> rx_clock_sync_;
+  std::vector<double> rx_clock_mhz_;
+  std::vector<uint64_t> rx_timestamp_base_;
+  // Current rx burst size of each port / queue
+  std::vector<size_t> rx_burst_;
+  // Port / queue of the next receive
+  size_t rx_index_;
+  // Newest frame received, for the rx_frame_start timestamps
+  size_t prev_frame_id_;
+
+  // Zero-copy TX state, indexed like the tx memory
+  std::vector<TxSlot> tx_slots_;
+  size_t tx_in_flight_;
+  // Tags of the sent packets to report, filled by TxPayloadSent()
+  std::vector<size_t> tx_sent_tags_;
 };
 #endif  // TXRX_WORKER_DPDK_H_
@@ -6,7 +6,9 @@
 
 #include "txrx_worker_hw.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include "comms-lib.h"
 #include "gettime.h"
@@ -15,6 +17,9 @@
 
 static constexpr bool kSymbolTimingEnabled = false;
 static constexpr bool kBeamsweepData = false;
+// Share of the driver rx buffers that may be held by zero-copy packets, so
+// that the driver always has buffers left to receive into
+static constexpr size_t kDirectRxBufferShare = 2;
 
 TxRxWorkerHw::TxRxWorkerHw(
     size_t core_offset, size_t tid, size_t interface_count,
@@ -25,7 +30,8 @@ TxRxWorkerHw::TxRxWorkerHw(
     moodycamel::ProducerToken& notify_producer,
     std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
     std::mutex& sync_mutex, std::condition_variable& sync_cond,
-    std::atomic<bool>& can_proceed, RadioSet& radio_config)
+    std::atomic<bool>& can_proceed, RadioSet& radio_config,
+    RadioTiming* radio_timing)
     : TxRxWorker(core_offset, tid, interface_count, interface_offset,
                  config->NumChannels(), config, rx_frame_start, event_notify_q,
                  tx_pending_q, tx_producer, notify_producer, rx_memory,
@@ -33,9 +39,22 @@ TxRxWorkerHw::TxRxWorkerHw(
       radio_config_(radio_config),
       program_start_ticks_(0),
       freq_ghz_(GetTime::MeasureRdtscFreq()),
+      radio_timing_(radio_timing),
+      us_per_sample_(1e6 / config->Rate()),
+      clock_sync_(freq_ghz_),
       zeros_(config->SampsPerSymbol(), std::complex<int16_t>(0u, 0u)),
-      first_symbol_(interface_count, true) {
+      first_symbol_(interface_count, true),
+      last_rx_symbol_(interface_count, 0),
+      analog_beam_(interface_count, SIZE_MAX) {
   InitRxStatus();
+  for (size_t interface = 0; interface < interface_count; interface++) {
+    for (size_t symbol = 0; symbol < config->Frame().NumTotalSyms();
+         symbol++) {
+      if (IsRxSymbol(interface, symbol)) {
+        last_rx_symbol_.at(interface) = symbol;
+      }
+    }
+  }
 }
 
 TxRxWorkerHw::~TxRxWorkerHw() = default;
@@ -58,9 +77,14 @@ void TxRxWorkerHw::DoTxRx() {
   }
 
   program_start_ticks_ = GetTime::Rdtsc();
+  InitDirectRx();
 
   long long time0 = 0ul;
   time0 = GetHwTime();
+  // The last symbol read by GetHwTime() ends at time0
+  if (Configuration()->HwFramer() == false) {
+    clock_sync_.Update(0.0, GetTime::Rdtsc());
+  }
   ssize_t prev_frame_id = -1;
 
   TxRxWorkerRx::RxParameters receive_attempt;
@@ -87,8 +111,9 @@ void TxRxWorkerHw::DoTxRx() {
       if (kSymbolTimingEnabled) {
         rx_times.at(receive_attempt.interface_).start_ticks_ = GetTime::Rdtsc();
       }
-      auto pkts =
-          DoRx(receive_attempt.interface_, global_frame_id, global_symbol_id);
+      long long rx_time = 0;
+      auto pkts = DoRx(receive_attempt.interface_, global_frame_id,
+                       global_symbol_id, rx_time);
 
       const size_t rx_time_ticks = GetTime::Rdtsc();
       if (kSymbolTimingEnabled) {
@@ -136,8 +161,12 @@ void TxRxWorkerHw::DoTxRx() {
         }
 
         if (ignore == false) {
+          const size_t air_tsc = RecordRxArrival(
+              receive_attempt.interface_ + interface_offset_, rx_frame_id,
+              rx_symbol_id, rx_time, time0, rx_time_ticks);
           //Publish the symbols to the scheduler
           for (auto* packet : pkts) {
+            packet->RawPacket()->air_tsc_ = air_tsc;
             const EventData rx_message(EventType::kPacketRX,
                                        rx_tag_t(packet).tag_);
             NotifyComplete(rx_message);
@@ -162,6 +191,8 @@ void TxRxWorkerHw::DoTxRx() {
 
           PrintRxSymbolTiming(rx_times, rx_frame_id, successful_receive.symbol_,
                               receive_attempt.symbol_);
+          UpdateAnalogBeam(successful_receive.interface_, rx_frame_id,
+                           rx_symbol_id);
         }  //!ignore
         else {
           //Return the Packets (must be in reverse order)
@@ -180,7 +211,8 @@ void TxRxWorkerHw::DoTxRx() {
 // global_symbol_id will be used and updated
 std::vector<RxPacket*> TxRxWorkerHw::DoRx(size_t interface_id,
                                           size_t& global_frame_id,
-                                          size_t& global_symbol_id) {
+                                          size_t& global_symbol_id,
+                                          long long& rx_time) {
   const size_t radio_id = interface_id + interface_offset_;
 
   //Return value
@@ -192,13 +224,18 @@ std::vector<RxPacket*> TxRxWorkerHw::DoRx(size_t interface_id,
   RtAssert(Configuration()->SampsPerSymbol() > rx_info.SamplesAvailable(),
            "Rx Samples must be > 0");
 
+  ReleaseDirectRxBuffers();
   auto rx_locations = rx_info.GetRxPtrs();
   long long frame_time;
 
   Radio::RxFlags out_flags;
   //Ok to read into sample memory for dummy read
-  const int rx_status = radio_config_.RadioRx(
-      radio_id, rx_locations, request_samples, out_flags, frame_time);
+  const int rx_status =
+      UseDirectRx(interface_id)
+          ? DirectRx(interface_id, rx_locations, request_samples, out_flags,
+                     frame_time)
+          : radio_config_.RadioRx(radio_id, rx_locations, request_samples,
+                                  out_flags, frame_time);
 
   if (rx_status > 0) {
     const size_t new_samples = static_cast<size_t>(rx_status);
@@ -208,6 +245,7 @@ std::vector<RxPacket*> TxRxWorkerHw::DoRx(size_t interface_id,
     if ((new_samples == request_samples) ||
         (out_flags == Radio::RxFlags::kEndReceive)) {
       frame_time = rx_info.StartTime();
+      rx_time = frame_time;
       const size_t ant_id = radio_id * channels_per_interface_;
       const size_t cell_id = Configuration()->CellId().at(radio_id);
 
@@ -267,7 +305,11 @@ std::vector<RxPacket*> TxRxWorkerHw::DoRx(size_t interface_id,
         global_frame_id++;
       }
 
-      if (ignore_rx_data == false) {
+      if (ignore_rx_data) {
+        DropDirectRxBuffer(interface_id);
+      } else {
+        // The packets own the driver buffer from here on, if any
+        rx_direct_buffer_.at(interface_id) = nullptr;
         auto packets = rx_info.GetRxPackets();
         for (size_t ch = 0; ch < channels_per_interface_; ch++) {
           auto* rx_packet = packets.at(ch);
@@ -316,10 +358,10 @@ void TxRxWorkerHw::TxBeaconHw(size_t frame_id, size_t radio_id,
   }
   // assuming beacon is first symbol
   long long frame_time =
-      time0 + (Configuration()->SampsPerSymbol() *
-               ((frame_id * Configuration()->Frame().NumTotalSyms()) +
-                beacon_symbol_id));
+      time0 + Configuration()->SymbolTimeOffset(frame_id, beacon_symbol_id);
 
+  RecordTxLead(radio_id, RadioTiming::TxType::kBeacon, frame_id,
+               beacon_symbol_id);
   const int tx_ret =
       radio_config_.RadioTx(radio_id, tx_buffs.data(),
                             GetTxFlags(radio_id, beacon_symbol_id), frame_time);
@@ -361,12 +403,11 @@ void TxRxWorkerHw::TxBcastSymbolsHw(size_t frame_id, size_t radio_id,
   for (size_t i = 0; i < Configuration()->Frame().NumDlControlSyms(); i++) {
     size_t symbol_id = Configuration()->Frame().GetDLControlSymbol(i);
     long long frame_time =
-        time0 +
-        (Configuration()->SampsPerSymbol() *
-         ((frame_id * Configuration()->Frame().NumTotalSyms()) + symbol_id));
+        time0 + Configuration()->SymbolTimeOffset(frame_id, symbol_id);
     if (bcast_radio == radio_id) {
       tx_buffs.at(bcast_ch) = reinterpret_cast<void*>(ctrl_samp_buffer.at(i));
     }
+    RecordTxLead(radio_id, RadioTiming::TxType::kControl, frame_id, symbol_id);
     int tx_ret = radio_config_.RadioTx(
         radio_id, tx_buffs.data(), GetTxFlags(radio_id, symbol_id), frame_time);
 
@@ -410,9 +451,7 @@ void TxRxWorkerHw::TxReciprocityCalibPilots(size_t frame_id, size_t radio_id,
       long long frame_time = 0;
       if (Configuration()->HwFramer() == false) {
         frame_time =
-            time0 + (Configuration()->SampsPerSymbol() *
-                     ((frame_id * Configuration()->Frame().NumTotalSyms()) +
-                      tx_symbol_id));
+            time0 + Configuration()->SymbolTimeOffset(frame_id, tx_symbol_id);
       } else {
         frame_time = ((long long)(frame_id) << 32) | (tx_symbol_id << 16);
       }
@@ -422,6 +461,8 @@ void TxRxWorkerHw::TxReciprocityCalibPilots(size_t frame_id, size_t radio_id,
           "%zu, Ant %zu) - transmit ref pilot for uplink recip cal\n",
           tid_, frame_id, tx_symbol_id,
           (radio_id * Configuration()->NumChannels()) + ant_idx);
+      RecordTxLead(radio_id, RadioTiming::TxType::kCalibration, frame_id,
+                   tx_symbol_id);
       // Check to see if the next symbol is a Tx symbol for the reference node
       const int tx_ret =
           radio_config_.RadioTx(radio_id, calultxbuf.data(),
@@ -472,12 +513,12 @@ void TxRxWorkerHw::TxReciprocityCalibPilots(size_t frame_id, size_t radio_id,
       long long frame_time = 0;
       if (Configuration()->HwFramer() == false) {
         frame_time =
-            time0 + (Configuration()->SampsPerSymbol() *
-                     ((frame_id * Configuration()->Frame().NumTotalSyms()) +
-                      tx_symbol_id));
+            time0 + Configuration()->SymbolTimeOffset(frame_id, tx_symbol_id);
       } else {
         frame_time = ((long long)(frame_id) << 32) | (tx_symbol_id << 16);
       }
+      RecordTxLead(radio_id, RadioTiming::TxType::kCalibration, frame_id,
+                   tx_symbol_id);
       const int tx_status =
           radio_config_.RadioTx(radio_id, caldltxbuf.data(),
                                 GetTxFlags(radio_id, tx_symbol_id), frame_time);
@@ -597,12 +638,12 @@ size_t TxRxWorkerHw::DoTx(long long time0) {
       long long frame_time = 0;
       if (Configuration()->HwFramer() == false) {
         frame_time =
-            time0 + (Configuration()->SampsPerSymbol() *
-                     ((tx_frame_id * Configuration()->Frame().NumTotalSyms()) +
-                      symbol_id));
+            time0 + Configuration()->SymbolTimeOffset(tx_frame_id, symbol_id);
       } else {
         frame_time = ((long long)(tx_frame_id) << 32) | (symbol_id << 16);
       }
+      RecordTxLead(radio_id, RadioTiming::TxType::kDownlink, tx_frame_id,
+                   symbol_id);
       const int radio_status = radio_config_.RadioTx(
           radio_id, txbuf.data(), GetTxFlags(radio_id, symbol_id), frame_time);
       if (radio_status != static_cast<int>(Configuration()->SampsPerSymbol())) {
@@ -714,6 +755,74 @@ bool TxRxWorkerHw::IsRxSymbol(size_t interface, size_t symbol_id) {
   return is_rx;
 }
 
+size_t TxRxWorkerHw::RecordRxArrival(size_t radio_id, size_t frame_id,
+                                     size_t symbol_id, long long rx_time,
+                                     long long time0, size_t rx_tsc) {
+  // The Hw framer timestamps the symbols with their frame and symbol ids
+  const long long symbol_start =
+      Configuration()->HwFramer()
+          ? Configuration()->SymbolTimeOffset(frame_id, symbol_id)
+          : rx_time - time0;
+  const double symbol_end_us =
+      static_cast<double>(symbol_start + Configuration()->SampsPerSymbol()) *
+      us_per_sample_;
+  clock_sync_.Update(symbol_end_us, rx_tsc);
+  const double air_tsc = clock_sync_.ToHostTsc(symbol_end_us);
+  if (radio_timing_ == nullptr) {
+    return static_cast<size_t>(air_tsc);
+  }
+  RadioTiming::RxType type;
+  switch (Configuration()->GetSymbolType(symbol_id)) {
+    case SymbolType::kPilot:
+      type = RadioTiming::RxType::kPilot;
+      break;
+    case SymbolType::kUL:
+      type = RadioTiming::RxType::kUplink;
+      break;
+    case SymbolType::kCalUL:
+    case SymbolType::kCalDL:
+      type = RadioTiming::RxType::kCalibration;
+      break;
+    default:
+      return static_cast<size_t>(air_tsc);
+  }
+  radio_timing_->RecordRx(
+      radio_id, type,
+      (static_cast<double>(rx_tsc) - air_tsc) / (freq_ghz_ * 1e3));
+  return static_cast<size_t>(air_tsc);
+}
+
+void TxRxWorkerHw::RecordTxLead(size_t radio_id, RadioTiming::TxType type,
+                                size_t frame_id, size_t symbol_id) {
+  if ((radio_timing_ == nullptr) || (clock_sync_.Synced() == false)) {
+    return;
+  }
+  const double symbol_start_us =
+      static_cast<double>(
+          Configuration()->SymbolTimeOffset(frame_id, symbol_id)) *
+      us_per_sample_;
+  radio_timing_->RecordTx(
+      radio_id, type,
+      (clock_sync_.ToHostTsc(symbol_start_us) -
+       static_cast<double>(GetTime::Rdtsc())) /
+          (freq_ghz_ * 1e3));
+}
+
+void TxRxWorkerHw::UpdateAnalogBeam(size_t interface, size_t frame_id,
+                                    size_t symbol_id) {
+  if ((analog_beams_ == nullptr) ||
+      (symbol_id != last_rx_symbol_.at(interface))) {
+    return;
+  }
+  // The array has until the next frame starts to switch, and the master
+  // selects the beam of the frames that have yet to start
+  const size_t beam = analog_beams_->BeamOfFrame(frame_id + 1);
+  if (beam != analog_beam_.at(interface)) {
+    radio_config_.RadioSetAnalogBeam(interface + interface_offset_, beam);
+    analog_beam_.at(interface) = beam;
+  }
+}
+
 void TxRxWorkerHw::PrintRxSymbolTiming(
     std::vector<TxRxWorkerRx::RxTimeTracker>& rx_times, size_t current_frame,
     size_t current_symbol, size_t next_symbol) {
@@ -939,9 +1048,7 @@ void TxRxWorkerHw::TxDownlinkZeros(size_t frame_id, size_t radio_id,
     long long frame_time = 0;
     if (Configuration()->HwFramer() == false) {
       frame_time =
-          time0 + (Configuration()->SampsPerSymbol() *
-                   (((frame_id)*Configuration()->Frame().NumTotalSyms()) +
-                    tx_symbol_id));
+          time0 + Configuration()->SymbolTimeOffset(frame_id, tx_symbol_id);
     } else {
       frame_time =
           (static_cast<long long>(frame_id) << 32) | (tx_symbol_id << 16);
@@ -949,6 +1056,8 @@ void TxRxWorkerHw::TxDownlinkZeros(size_t frame_id, size_t radio_id,
 
     const auto tx_flags = GetTxFlags(radio_id, tx_symbol_id);
 
+    RecordTxLead(radio_id, RadioTiming::TxType::kDownlink, frame_id,
+                 tx_symbol_id);
     const int tx_ret =
         radio_config_.RadioTx(radio_id, tx_buffs.data(), tx_flags, frame_time);
 
@@ -968,6 +1077,7 @@ void TxRxWorkerHw::InitRxStatus() {
   for (auto& status : rx_status_) {
     for (auto& new_packet : rx_packets) {
       new_packet = &GetRxPacket();
+      new_packet->ClearExternal();
       AGORA_LOG_TRACE("InitRxStatus[%zu]: Using Packet at location %d\n", tid_,
                       reinterpret_cast<intptr_t>(new_packet));
     }
@@ -984,8 +1094,131 @@ void TxRxWorkerHw::ResetRxStatus(size_t interface, bool reuse_memory) {
     rx_packets = rx_status_.at(interface).GetRxPackets();
   } else {
     for (size_t packets = 0; packets < prev_status.NumChannels(); packets++) {
-      rx_packets.emplace_back(&GetRxPacket());
+      RxPacket& rx_packet = GetRxPacket();
+      rx_packet.ClearExternal();
+      rx_packets.emplace_back(&rx_packet);
     }
   }
   prev_status.Reset(rx_packets);
 }
+
+void TxRxWorkerHw::InitDirectRx() {
+  max_direct_buffers_.assign(num_interfaces_, 0);
+  direct_buffers_in_use_.assign(num_interfaces_, 0);
+  rx_direct_buffer_.assign(num_interfaces_, nullptr);
+  if (Configuration()->HwZeroCopyRx() == false) {
+    return;
+  }
+
+  size_t total_buffers = 0;
+  for (size_t interface = 0; interface < num_interfaces_; interface++) {
+    const size_t radio_id = interface + interface_offset_;
+    const size_t num_buffers = radio_config_.RadioNumRxDirectBuffers(radio_id);
+    if (num_buffers == 0) {
+      AGORA_LOG_WARN(
+          "TxRxWorkerHw[%zu]: Radio %zu has no direct rx buffer access, "
+          "copying its samples\n",
+          tid_, radio_id);
+    }
+    max_direct_buffers_.at(interface) = num_buffers / kDirectRxBufferShare;
+    total_buffers += max_direct_buffers_.at(interface);
+  }
+  direct_rx_buffers_.resize(total_buffers);
+  for (auto& buffer : direct_rx_buffers_) {
+    buffer = std::make_unique<DirectRxBuffer>();
+    buffer->released_ = &released_direct_rx_buffers_;
+    free_direct_rx_buffers_.push_back(buffer.get());
+  }
+  direct_rx_locs_.resize(channels_per_interface_);
+  AGORA_LOG_INFO("TxRxWorkerHw[%zu]: Zero-copy rx with %zu driver buffers\n",
+                 tid_, total_buffers);
+}
+
+bool TxRxWorkerHw::UseDirectRx(size_t interface_id) const {
+  // Only whole symbols are received in place, a partial symbol is completed
+  // with regular rx calls
+  return (direct_buffers_in_use_.at(interface_id) <
+          max_direct_buffers_.at(interface_id)) &&
+         (rx_status_.at(interface_id).SamplesAvailable() == 0);
+}
+
+int TxRxWorkerHw::DirectRx(size_t interface_id,
+                           std::vector<void*>& rx_locations,
+                           size_t request_samples, Radio::RxFlags& out_flags,
+                           long long& rx_time) {
+  const size_t radio_id = interface_id + interface_offset_;
+  size_t handle;
+  const int rx_status = radio_config_.RadioAcquireRx(
+      radio_id, direct_rx_locs_, handle, out_flags, rx_time);
+  if (rx_status <= 0) {
+    return rx_status;
+  }
+
+  const auto rx_samples = static_cast<size_t>(rx_status);
+  if (rx_samples == request_samples) {
+    // The whole symbol is in one driver buffer, lend it to the packets
+    DirectRxBuffer* buffer = free_direct_rx_buffers_.back();
+    free_direct_rx_buffers_.pop_back();
+    buffer->radio_id_ = radio_id;
+    buffer->handle_ = handle;
+    buffer->references_.store(channels_per_interface_);
+    const auto packets = rx_status_.at(interface_id).GetRxPackets();
+    for (size_t ch = 0; ch < channels_per_interface_; ch++) {
+      packets.at(ch)->SetExternalSamples(
+          static_cast<const short*>(direct_rx_locs_.at(ch)), buffer,
+          &TxRxWorkerHw::ReleaseDirectRxBuffer);
+    }
+    direct_buffers_in_use_.at(interface_id)++;
+    rx_direct_buffer_.at(interface_id) = buffer;
+    return rx_status;
+  }
+
+  // Part of a symbol, copy it out like a regular rx call
+  const size_t copy_samples = std::min(rx_samples, request_samples);
+  if (rx_samples > request_samples) {
+    AGORA_LOG_WARN(
+        "TxRxWorkerHw[%zu]: Radio %zu rx buffers of %zu samples are not "
+        "aligned to symbols, disabling zero-copy rx\n",
+        tid_, radio_id, rx_samples);
+    max_direct_buffers_.at(interface_id) = 0;
+  }
+  for (size_t ch = 0; ch < channels_per_interface_; ch++) {
+    std::memcpy(rx_locations.at(ch), direct_rx_locs_.at(ch),
+                copy_samples * sizeof(std::complex<int16_t>));
+  }
+  radio_config_.RadioReleaseRx(radio_id, handle);
+  return static_cast<int>(copy_samples);
+}
+
+void TxRxWorkerHw::ReleaseDirectRxBuffer(void* mem) {
+  auto* buffer = static_cast<DirectRxBuffer*>(mem);
+  if (buffer->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // Called by the packet consumers, the driver is only called by the
+    // TxRx worker
+    buffer->released_->enqueue(buffer);
+  }
+}
+
+void TxRxWorkerHw::ReleaseDirectRxBuffers() {
+  DirectRxBuffer* buffer;
+  while (released_direct_rx_buffers_.try_dequeue(buffer)) {
+    radio_config_.RadioReleaseRx(buffer->radio_id_, buffer->handle_);
+    direct_buffers_in_use_.at(buffer->radio_id_ - interface_offset_)--;
+    free_direct_rx_buffers_.push_back(buffer);
+  }
+}
+
+void TxRxWorkerHw::DropDirectRxBuffer(size_t interface_id) {
+  DirectRxBuffer* buffer = rx_direct_buffer_.at(interface_id);
+  if (buffer == nullptr) {
+    return;
+  }
+  // The packets are reused for the next symbol
+  for (auto* rx_packet : rx_status_.at(interface_id).GetRxPackets()) {
+    rx_packet->ClearExternal();
+  }
+  radio_config_.RadioReleaseRx(buffer->radio_id_, buffer->handle_);
+  direct_buffers_in_use_.at(interface_id)--;
+  free_direct_rx_buffers_.push_back(buffer);
+  rx_direct_buffer_.at(interface_id) = nullptr;
+}
@@ -7,11 +7,14 @@
 #ifndef TXRX_WORKER_HW_H_
 #define TXRX_WORKER_HW_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
+#include "clock_sync.h"
 #include "message.h"
 #include "radio_set.h"
+#include "radio_timing.h"
 #include "rx_status_tracker.h"
 #include "txrx_worker.h"
 
@@ -38,7 +41,8 @@ class TxRxWorkerHw : public TxRxWorker {
                moodycamel::ProducerToken& notify_producer,
                std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
                std::mutex& sync_mutex, std::condition_variable& sync_cond,
-               std::atomic<bool>& can_proceed, RadioSet& radio_config);
+               std::atomic<bool>& can_proceed, RadioSet& radio_config,
+               RadioTiming* radio_timing);
   TxRxWorkerHw() = delete;
   ~TxRxWorkerHw() final;
   void DoTxRx() final;
@@ -46,7 +50,7 @@ class TxRxWorkerHw : public TxRxWorker {
  private:
   size_t DoTx(long long time0);
   std::vector<RxPacket*> DoRx(size_t interface_id, size_t& global_frame_id,
-                              size_t& global_symbol_id);
+                              size_t& global_symbol_id, long long& rx_time);
 
   void ScheduleTxInit(size_t frames_to_schedule, long long time0);
   void TxDownlinkZeros(size_t frame_id, size_t radio_id, long long time0);
@@ -66,6 +70,25 @@ class TxRxWorkerHw : public TxRxWorker {
   void InitRxStatus();
   void ResetRxStatus(size_t interface, bool reuse_memory);
 
+  // Zero-copy rx (Config::HwZeroCopyRx()): a driver rx buffer lent to the
+  // packets of one symbol, given back to the driver once all are freed
+  struct DirectRxBuffer {
+    size_t radio_id_;
+    size_t handle_;
+    std::atomic<size_t> references_;
+    moodycamel::ConcurrentQueue<DirectRxBuffer*>* released_;
+  };
+  static void ReleaseDirectRxBuffer(void* mem);
+  void InitDirectRx();
+  bool UseDirectRx(size_t interface_id) const;
+  int DirectRx(size_t interface_id, std::vector<void*>& rx_locations,
+               size_t request_samples, Radio::RxFlags& out_flags,
+               long long& rx_time);
+  // Give the buffers of freed packets back to the driver
+  void ReleaseDirectRxBuffers();
+  // Give the buffer of an unused symbol back to the driver
+  void DropDirectRxBuffer(size_t interface_id);
+
   TxRxWorkerRx::RxParameters UpdateRxInterface(
       const TxRxWorkerRx::RxParameters& last_rx);
 
@@ -73,15 +96,45 @@ class TxRxWorkerHw : public TxRxWorker {
                            size_t current_frame, size_t current_symbol,
                            size_t next_symbol);
 
+  // Symbol timing, against the hardware time since frame 0 symbol 0 (time0
+  // or, with the Hw framer, the frame and symbol ids) mapped to the TSC by
+  // clock_sync_. Returns the TSC of the end of the symbol on air.
+  size_t RecordRxArrival(size_t radio_id, size_t frame_id, size_t symbol_id,
+                         long long rx_time, long long time0, size_t rx_tsc);
+  void RecordTxLead(size_t radio_id, RadioTiming::TxType type,
+                    size_t frame_id, size_t symbol_id);
+
+  // Once the last symbol of frame_id is received on interface, point its
+  // analog beam for the next frame, if that beam differs
+  void UpdateAnalogBeam(size_t interface, size_t frame_id, size_t symbol_id);
+
   // This object is created / owned by the parent process
   RadioSet& radio_config_;
   size_t program_start_ticks_;
   const double freq_ghz_;
 
+  // Owned by the parent process, shared by the workers of disjoint radios
+  RadioTiming* const radio_timing_;
+  const double us_per_sample_;
+  ClockSync clock_sync_;
+
   std::vector<std::complex<int16_t>> zeros_;
 
   //For each interface.
   std::vector<TxRxWorkerRx::RxStatusTracker> rx_status_;
   std::vector<bool> first_symbol_;
+  // The last symbol received in a frame, after which the analog beam
+  // changes, and the beam of the interface (SIZE_MAX before the first)
+  std::vector<size_t> last_rx_symbol_;
+  std::vector<size_t> analog_beam_;
+
+  //Zero-copy rx, for each interface
+  std::vector<size_t> max_direct_buffers_;  // 0 if off
+  std::vector<size_t> direct_buffers_in_use_;
+  std::vector<DirectRxBuffer*> rx_direct_buffer_;  // Of the current symbol
+  std::vector<std::unique_ptr<DirectRxBuffer>> direct_rx_buffers_;
+  std::vector<DirectRxBuffer*> free_direct_rx_buffers_;
+  moodycamel::ConcurrentQueue<DirectRxBuffer*> released_direct_rx_buffers_;
+  std::vector<const void*> direct_rx_locs_;
 };
 #endif  // TXRX_WORKER_SIM_H_
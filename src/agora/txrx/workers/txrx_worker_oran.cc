@@ -0,0 +1,434 @@
+/**
+ * @file txrx_worker_oran.cc
+ * @brief Implementation of the txrx worker of the O-RAN 7.2x fronthaul over
+ * dpdk
+ */
+
+#include "txrx_worker_oran.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "gettime.h"
+#include "idle_policy.h"
+#include "logger.h"
+#include "message.h"
+
+// RxPacket::ReleaseFn of the zero-copy packets
+static void FreeRxMbuf(void* mem) {
+  rte_pktmbuf_free(static_cast<rte_mbuf*>(mem));
+}
+
+TxRxWorkerOran::TxRxWorkerOran(
+    size_t core_offset, size_t tid, size_t interface_count,
+    size_t interface_offset, Config* const config, size_t* rx_frame_start,
+    moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+    moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+    moodycamel::ProducerToken& tx_producer,
+    moodycamel::ProducerToken& notify_producer,
+    std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
+    std::mutex& sync_mutex, std::condition_variable& sync_cond,
+    std::atomic<bool>& can_proceed,
+    std::vector<std::pair<uint16_t, uint16_t>> dpdk_phy, rte_mempool* mbuf_pool,
+    const OranTiming& timing)
+    : TxRxWorker(core_offset, tid, interface_count, interface_offset,
+                 config->NumChannels(), config, rx_frame_start, event_notify_q,
+                 tx_pending_q, tx_producer, notify_producer, rx_memory,
+                 tx_memory, sync_mutex, sync_cond, can_proceed),
+      dpdk_phy_port_queues_(std::move(dpdk_phy)),
+      mbuf_pool_(mbuf_pool),
+      timing_(timing),
+      num_prb_(config->OfdmDataNum() / kOranPrbSubcarriers),
+      prb_bytes_(OranPrbBytes(config->OranBfpBits())),
+      freq_ghz_(GetTime::MeasureRdtscFreq()),
+      t1a_min_cycles_(
+          GetTime::UsToCycles(config->OranT1aUpUs().at(0), freq_ghz_)),
+      t1a_max_cycles_(
+          GetTime::UsToCycles(config->OranT1aUpUs().at(1), freq_ghz_)),
+      tcp_adv_cycles_(GetTime::UsToCycles(config->OranTcpAdvDlUs(), freq_ghz_)),
+      next_cplane_slot_(timing.FirstSymbol() / timing.SymbolsPerSlot()),
+      tx_late_(0),
+      rx_index_(0),
+      prev_frame_id_(SIZE_MAX) {
+  RtAssert(dpdk_phy_port_queues_.size() == num_interfaces_,
+           "The dev / queue id's list is not long enough to support the number "
+           "of requested interfaces");
+  RtAssert((config->DpdkRxBurst() >= kMinRxBatchSize) &&
+               (config->DpdkRxBurst() <= kMaxRxBatchSize),
+           "dpdk_rx_burst is out of range");
+  const std::vector<rte_ether_addr> ru_macs =
+      DpdkTransport::ParseMacAddrs(config->NumRadios(), config->OranRuMacs());
+  const bool vlan = (config->OranVlan() != 0);
+  eth_header_bytes_ =
+      sizeof(rte_ether_hdr) + (vlan ? sizeof(rte_vlan_hdr) : 0);
+  eth_headers_.resize(num_interfaces_);
+  uplane_seq_.resize(num_interfaces_ * channels_per_interface_, 0);
+  cplane_seq_.resize(num_interfaces_ * channels_per_interface_, 0);
+
+  for (size_t interface = 0; interface < num_interfaces_; interface++) {
+    const auto& port_queue_id = dpdk_phy_port_queues_.at(interface);
+    const auto& port_id = port_queue_id.first;
+    const auto& queue_id = port_queue_id.second;
+    const rte_ether_addr& ru_mac = ru_macs.at(interface + interface_offset_);
+
+    auto* eth_hdr =
+        reinterpret_cast<rte_ether_hdr*>(eth_headers_.at(interface).data());
+    const auto status = rte_eth_macaddr_get(port_id, &eth_hdr->src_addr);
+    RtAssert(status == 0, "Could not retreive mac address");
+    rte_ether_addr_copy(&ru_mac, &eth_hdr->dst_addr);
+    if (vlan) {
+      eth_hdr->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_VLAN);
+      auto* vlan_hdr = reinterpret_cast<rte_vlan_hdr*>(eth_hdr + 1);
+      vlan_hdr->vlan_tci = rte_cpu_to_be_16(config->OranVlan());
+      vlan_hdr->eth_proto = rte_cpu_to_be_16(kEcpriEtherType);
+    } else {
+      eth_hdr->ether_type = rte_cpu_to_be_16(kEcpriEtherType);
+    }
+
+    AGORA_LOG_INFO(
+        "TxRxWorkerOran[%zu]: steering eCPRI of RU %zu (%02x:%02x:%02x:%02x:"
+        "%02x:%02x) to DPDK dev %d, queue: %d\n",
+        tid_, interface + interface_offset_, ru_mac.addr_bytes[0],
+        ru_mac.addr_bytes[1], ru_mac.addr_bytes[2], ru_mac.addr_bytes[3],
+        ru_mac.addr_bytes[4], ru_mac.addr_bytes[5], port_id, queue_id);
+    DpdkTransport::InstallFlowRuleEth(port_id, queue_id, ru_mac,
+                                      kEcpriEtherType, vlan);
+  }
+}
+
+TxRxWorkerOran::~TxRxWorkerOran() { Stop(); };
+
+template <void (TxRxWorkerOran::*run_thread)()>
+static void ClassFunctioWrapper(TxRxWorkerOran* context) {
+  return (context->*run_thread)();
+}
+
+// DPDK doesn't use c++ std threads but the class still has a 1:1 mapping
+// worker:lcore
+void TxRxWorkerOran::Start() {
+  rte_eal_wait_lcore(tid_);
+  AGORA_LOG_TRACE("TxRxWorkerOran[%zu]: starting\n", tid_);
+  const int status = rte_eal_remote_launch(
+      (lcore_function_t*)(ClassFunctioWrapper<&TxRxWorkerOran::DoTxRx>), this,
+      tid_);
+  AGORA_LOG_INFO("TxRxWorkerOran[%zu]: started on dpdk managed l_core\n", tid_);
+  RtAssert(status == 0, "Lcore cannot launch TxRx function");
+}
+
+void TxRxWorkerOran::Stop() {
+  Configuration()->Running(false);
+  //Wait until the lcore finishes its job (join)
+  rte_eal_wait_lcore(tid_);
+  if (tx_late_ > 0) {
+    AGORA_LOG_WARN(
+        "TxRxWorkerOran[%zu]: %zu downlink symbols missed their U-plane "
+        "window\n",
+        tid_, tx_late_);
+    tx_late_ = 0;
+  }
+}
+
+void TxRxWorkerOran::DoTxRx() {
+  running_ = true;
+  WaitSync();
+  AGORA_LOG_TRACE("TxRxWorkerOran[%zu]: synced\n", tid_);
+
+  IdlePolicy idle(Configuration());
+  while (Configuration()->Running()) {
+    if (PollOnce()) {
+      idle.Busy();
+    } else {
+      idle.Idle();
+    }
+  }  // running
+  idle.PrintSummary("TxRxWorkerOran[" + std::to_string(tid_) + "]");
+  running_ = false;
+}
+
+bool TxRxWorkerOran::StartInline() {
+  AGORA_LOG_INFO("TxRxWorkerOran[%zu]: polled inline by the calling thread\n",
+                 tid_);
+  running_ = true;
+  return true;
+}
+
+bool TxRxWorkerOran::PollOnce() {
+  // The messages on a deadline go first
+  const size_t now_tsc = GetTime::Rdtsc();
+  size_t tx_result = SendCplane(now_tsc);
+  tx_result += DequeueSend();
+  tx_result += SendUplane(now_tsc);
+  if (tx_result > 0) {
+    return true;
+  }
+  const auto& port_queue_id = dpdk_phy_port_queues_.at(rx_index_);
+  auto rx_result = RecvEnqueue(port_queue_id.first, port_queue_id.second);
+  for (auto& rx_packet : rx_result) {
+    if (kIsWorkerTimingEnabled) {
+      const size_t& rx_frame_id = rx_packet->frame_id_;
+      if ((prev_frame_id_ == SIZE_MAX) || (rx_frame_id > prev_frame_id_)) {
+        rx_frame_start_[rx_frame_id % kNumStatsFrames] = GetTime::Rdtsc();
+        prev_frame_id_ = rx_frame_id;
+      }
+    }  // end kIsWorkerTimingEnabled
+  }
+  //Cycle through all ports / queues
+  rx_index_++;
+  if (rx_index_ == dpdk_phy_port_queues_.size()) {
+    rx_index_ = 0;
+  }
+  return (rx_result.empty() == false);
+}
+
+std::vector<Packet*> TxRxWorkerOran::RecvEnqueue(uint16_t port_id,
+                                                 uint16_t queue_id) {
+  std::vector<Packet*> rx_packets;
+  std::array<rte_mbuf*, kMaxRxBatchSize> rx_bufs;
+  const uint16_t nb_rx = rte_eth_rx_burst(port_id, queue_id, rx_bufs.data(),
+                                          Configuration()->DpdkRxBurst());
+  const size_t rx_tsc = GetTime::Rdtsc();
+  for (size_t i = 0; i < nb_rx; i++) {
+    Packet* pkt = RecvUplane(rx_bufs.at(i), rx_tsc);
+    if (pkt != nullptr) {
+      rx_packets.push_back(pkt);
+    }
+  }
+  return rx_packets;
+}
+
+Packet* TxRxWorkerOran::RecvUplane(rte_mbuf* dpdk_pkt, size_t rx_tsc) {
+  auto* frame = rte_pktmbuf_mtod(dpdk_pkt, uint8_t*);
+  size_t eth_bytes = sizeof(rte_ether_hdr);
+  uint16_t eth_type =
+      rte_be_to_cpu_16(reinterpret_cast<rte_ether_hdr*>(frame)->ether_type);
+  if (eth_type == RTE_ETHER_TYPE_VLAN) {
+    eth_type = rte_be_to_cpu_16(
+        reinterpret_cast<rte_vlan_hdr*>(frame + eth_bytes)->eth_proto);
+    eth_bytes += sizeof(rte_vlan_hdr);
+  }
+
+  OranUplaneHeader header;
+  size_t num_sections = 0;
+  if ((eth_type == kEcpriEtherType) && (dpdk_pkt->nb_segs == 1) &&
+      (dpdk_pkt->data_len > eth_bytes)) {
+    num_sections = OranParseUplane(
+        frame + eth_bytes, dpdk_pkt->data_len - eth_bytes, num_prb_,
+        Configuration()->OranBfpBits(), header, sections_);
+  }
+  size_t abs_symbol = 0;
+  size_t frame_id = 0;
+  size_t symbol_id = 0;
+  bool uplink = false;
+  if ((num_sections > 0) && (header.downlink_ == false) &&
+      (header.eaxc_id_ < channels_per_interface_)) {
+    // The ids of the symbol repeat every 256 radio frames, and are taken
+    // nearest to the symbol on air
+    abs_symbol = timing_.FromOran(header.symbol_, timing_.SymbolAt(rx_tsc));
+    if (timing_.ToAgora(abs_symbol, frame_id, symbol_id)) {
+      const SymbolType type = Configuration()->GetSymbolType(symbol_id);
+      uplink = (type == SymbolType::kUL) || (type == SymbolType::kPilot);
+    }
+  }
+  if (uplink == false) {
+    rte_pktmbuf_free(dpdk_pkt);
+    CountRxDropped();
+    return nullptr;
+  }
+  const size_t ant_id = ((interface_offset_ + rx_index_) *
+                         channels_per_interface_) +
+                        header.eaxc_id_;
+
+  auto& rx = GetRxPacket();
+  Packet* pkt = rx.RawPacket();
+  new (pkt) Packet(frame_id, symbol_id, Configuration()->CellId().at(0),
+                   ant_id);
+  // The last sample of the symbol was on air as the next symbol started
+  pkt->air_tsc_ = static_cast<uint64_t>(timing_.SymbolTsc(abs_symbol + 1));
+  const uint8_t* message = frame + eth_bytes;
+  if (Configuration()->DpdkZeroCopyRx() && (num_sections == 1) &&
+      (sections_.at(0).num_prb_ == num_prb_)) {
+    // The FFT decompresses the PRBs straight from the mbuf, which is freed
+    // with the last reference to the packet
+    rx.SetExternalSamples(reinterpret_cast<const short*>(
+                              message + sections_.at(0).data_offset_),
+                          dpdk_pkt, FreeRxMbuf);
+  } else {
+    rx.ClearExternal();
+    auto* prbs = reinterpret_cast<uint8_t*>(pkt->data_);
+    if ((num_sections > 1) || (sections_.at(0).num_prb_ != num_prb_)) {
+      // The PRBs that no section carries are zero
+      std::memset(prbs, 0, num_prb_ * prb_bytes_);
+    }
+    for (size_t i = 0; i < num_sections; i++) {
+      const OranSection& section = sections_.at(i);
+      rte_memcpy(prbs + (section.start_prb_ * prb_bytes_),
+                 message + section.data_offset_,
+                 section.num_prb_ * prb_bytes_);
+    }
+    rte_pktmbuf_free(dpdk_pkt);
+  }
+
+  AGORA_LOG_FRAME(
+      "TxRxWorkerOran[%zu]::RecvUplane received pkt (frame %d, symbol %d, "
+      "ant %d) in %zu sections\n",
+      tid_, pkt->frame_id_, pkt->symbol_id_, pkt->ant_id_, num_sections);
+  const EventData rx_message(EventType::kPacketRX, rx_tag_t(rx).tag_);
+  NotifyComplete(rx_message);
+  return pkt;
+}
+
+size_t TxRxWorkerOran::DequeueSend() {
+  auto tx_events = GetPendingTxEvents();
+  for (const EventData& current_event : tx_events) {
+    assert(current_event.event_type_ == EventType::kPacketTX);
+    const size_t frame_id = gen_tag_t(current_event.tags_[0]).frame_id_;
+    const size_t symbol_id = gen_tag_t(current_event.tags_[0]).symbol_id_;
+    const size_t abs_symbol = timing_.AbsSymbol(frame_id, symbol_id);
+    const auto air_tsc = static_cast<size_t>(timing_.SymbolTsc(abs_symbol));
+    tx_pending_.push({air_tsc - t1a_max_cycles_, abs_symbol,
+                      current_event.tags_[0]});
+  }
+  return tx_events.size();
+}
+
+size_t TxRxWorkerOran::SendUplane(size_t now_tsc) {
+  size_t num_sent = 0;
+  while ((tx_pending_.empty() == false) &&
+         (tx_pending_.top().send_tsc_ <= now_tsc)) {
+    const PendingTx pending = tx_pending_.top();
+    tx_pending_.pop();
+    const size_t frame_id = gen_tag_t(pending.tag_).frame_id_;
+    const size_t symbol_id = gen_tag_t(pending.tag_).symbol_id_;
+    const size_t ant_id = gen_tag_t(pending.tag_).ant_id_;
+    const size_t interface = (ant_id / channels_per_interface_);
+    const size_t local_ant =
+        ant_id - (interface_offset_ * channels_per_interface_);
+    assert((interface >= interface_offset_) &&
+           (interface < (num_interfaces_ + interface_offset_)));
+
+    // The RU discards a symbol that arrives after its window closes
+    const size_t window_close_tsc =
+        pending.send_tsc_ + t1a_max_cycles_ - t1a_min_cycles_;
+    if (now_tsc <= window_close_tsc) {
+      const OranUplaneHeader header = {
+          static_cast<uint16_t>(ant_id % channels_per_interface_),
+          uplane_seq_.at(local_ant)++, true,
+          timing_.ToOran(pending.abs_symbol_)};
+      const size_t prb_bytes = num_prb_ * prb_bytes_;
+      rte_mbuf* tx_buf = AllocEcpri(interface - interface_offset_,
+                                    kOranUplaneHeaderBytes + prb_bytes);
+      auto* message = rte_pktmbuf_mtod_offset(tx_buf, uint8_t*,
+                                              eth_header_bytes_);
+      OranWriteUplane(message, header, num_prb_, prb_bytes_);
+      const auto* pkt = GetTxPacket(frame_id, symbol_id, ant_id);
+      rte_memcpy(message + kOranUplaneHeaderBytes, pkt->data_, prb_bytes);
+      Send(interface - interface_offset_, tx_buf);
+      num_sent++;
+    } else {
+      tx_late_++;
+      AGORA_LOG_TRACE(
+          "TxRxWorkerOran[%zu]: dropped frame %zu, symbol %zu, ant %zu past "
+          "its U-plane window\n",
+          tid_, frame_id, symbol_id, ant_id);
+    }
+    // The symbol is done with either way
+    NotifyComplete(EventData(EventType::kPacketTX, pending.tag_));
+  }
+  return num_sent;
+}
+
+size_t TxRxWorkerOran::SendCplane(size_t now_tsc) {
+  const size_t symbols_per_slot = timing_.SymbolsPerSlot();
+  const size_t advance_cycles = t1a_max_cycles_ + tcp_adv_cycles_;
+  size_t num_sent = 0;
+  while (true) {
+    const auto slot_tsc = static_cast<size_t>(
+        timing_.SymbolTsc(next_cplane_slot_ * symbols_per_slot));
+    if (slot_tsc > now_tsc + advance_cycles) {
+      break;
+    }
+    // Slots already on air are skipped, after a stall of the worker
+    if (slot_tsc > now_tsc) {
+      num_sent += SendCplaneSlot(next_cplane_slot_);
+    }
+    next_cplane_slot_++;
+  }
+  return num_sent;
+}
+
+size_t TxRxWorkerOran::SendCplaneSlot(size_t abs_slot) {
+  static constexpr size_t kSymbolsPerSlot = OranTiming::kSymbolsPerSlot;
+  const size_t first_symbol = abs_slot * kSymbolsPerSlot;
+  size_t frame_id;
+  size_t symbol_id;
+  RtAssert(timing_.ToAgora(first_symbol, frame_id, symbol_id),
+           "TxRxWorkerOran: C-plane of a slot before frame 0");
+
+  // The direction of each symbol of the slot, and none after the slot
+  std::array<Direction, kSymbolsPerSlot + 1> directions;
+  for (size_t symbol = 0; symbol < kSymbolsPerSlot; symbol++) {
+    const SymbolType type = Configuration()->GetSymbolType(symbol_id + symbol);
+    if ((type == SymbolType::kUL) || (type == SymbolType::kPilot)) {
+      directions.at(symbol) = Direction::kUplink;
+    } else if (type == SymbolType::kDL) {
+      directions.at(symbol) = Direction::kDownlink;
+    } else {
+      directions.at(symbol) = Direction::kNone;
+    }
+  }
+  directions.at(kSymbolsPerSlot) = Direction::kNone;
+
+  size_t num_sent = 0;
+  size_t run_start = 0;
+  for (size_t symbol = 1; symbol <= kSymbolsPerSlot; symbol++) {
+    const Direction direction = directions.at(run_start);
+    if (directions.at(symbol) == direction) {
+      continue;
+    }
+    if (direction != Direction::kNone) {
+      for (size_t local_ant = 0; local_ant < cplane_seq_.size(); local_ant++) {
+        const size_t interface = local_ant / channels_per_interface_;
+        const OranCplane cplane = {
+            static_cast<uint16_t>(local_ant % channels_per_interface_),
+            cplane_seq_.at(local_ant)++,
+            (direction == Direction::kDownlink),
+            timing_.ToOran(first_symbol + run_start),
+            static_cast<uint8_t>(symbol - run_start),
+            static_cast<uint16_t>(num_prb_),
+            Configuration()->OranBfpBits(),
+            0};
+        rte_mbuf* tx_buf = AllocEcpri(interface, kOranCplaneBytes);
+        OranWriteCplane(
+            rte_pktmbuf_mtod_offset(tx_buf, uint8_t*, eth_header_bytes_),
+            cplane);
+        Send(interface, tx_buf);
+        num_sent++;
+      }
+    }
+    run_start = symbol;
+  }
+  return num_sent;
+}
+
+rte_mbuf* TxRxWorkerOran::AllocEcpri(size_t interface, size_t ecpri_bytes) {
+  rte_mbuf* tx_buf = rte_pktmbuf_alloc(mbuf_pool_);
+  RtAssert(tx_buf != nullptr, "TxRxWorkerOran: mbuf pool is empty");
+  const auto length = static_cast<uint16_t>(eth_header_bytes_ + ecpri_bytes);
+  rte_memcpy(rte_pktmbuf_mtod(tx_buf, uint8_t*),
+             eth_headers_.at(interface).data(), eth_header_bytes_);
+  tx_buf->data_len = length;
+  tx_buf->pkt_len = length;
+  return tx_buf;
+}
+
+void TxRxWorkerOran::Send(size_t interface, rte_mbuf* tx_buf) {
+  const auto& tx_info = dpdk_phy_port_queues_.at(interface);
+  const size_t nb_tx_new =
+      rte_eth_tx_burst(tx_info.first, tx_info.second, &tx_buf, kTxBatchSize);
+  if (unlikely(nb_tx_new != kTxBatchSize)) {
+    AGORA_LOG_ERROR("TxRxWorkerOran[%zu]: rte_eth_tx_burst() failed\n", tid_);
+    throw std::runtime_error("TxRxWorkerOran: rte_eth_tx_burst() failed");
+  }
+}
@@ -0,0 +1,114 @@
+/**
+ * @file txrx_worker_oran.h
+ * @brief txrx worker of the O-RAN 7.2x fronthaul over dpdk: the eCPRI
+ * U-plane and C-plane messages of the radio units (RUs) of its interfaces
+ */
+
+#ifndef TXRX_WORKER_ORAN_H_
+#define TXRX_WORKER_ORAN_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "dpdk_transport.h"
+#include "oran_fronthaul.h"
+#include "txrx_worker.h"
+
+class TxRxWorkerOran : public TxRxWorker {
+ public:
+  TxRxWorkerOran() = delete;
+  TxRxWorkerOran(size_t core_offset, size_t tid, size_t interface_count,
+                 size_t interface_offset, Config* const config,
+                 size_t* rx_frame_start,
+                 moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+                 moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+                 moodycamel::ProducerToken& tx_producer,
+                 moodycamel::ProducerToken& notify_producer,
+                 std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
+                 std::mutex& sync_mutex, std::condition_variable& sync_cond,
+                 std::atomic<bool>& can_proceed,
+                 std::vector<std::pair<uint16_t, uint16_t>> dpdk_phy,
+                 rte_mempool* mbuf_pool, const OranTiming& timing);
+  ~TxRxWorkerOran() final;
+  void DoTxRx() final;
+  void Start() final;
+  void Stop() final;
+  bool StartInline() final;
+  bool PollOnce() final;
+
+ private:
+  static constexpr size_t kMaxEthHeaderBytes =
+      sizeof(rte_ether_hdr) + sizeof(rte_vlan_hdr);
+
+  // The data direction of a symbol in the C-plane
+  enum class Direction { kNone, kUplink, kDownlink };
+
+  // A downlink symbol of an antenna, held until the U-plane window of its
+  // RU opens
+  struct PendingTx {
+    size_t send_tsc_;
+    size_t abs_symbol_;
+    size_t tag_;
+    inline bool operator>(const PendingTx& other) const {
+      return send_tsc_ > other.send_tsc_;
+    }
+  };
+
+  std::vector<Packet*> RecvEnqueue(uint16_t port_id, uint16_t queue_id);
+  // Notify the U-plane message of dpdk_pkt, received at rx_tsc on the
+  // interface being received. Returns nullptr if it was dropped.
+  Packet* RecvUplane(rte_mbuf* dpdk_pkt, size_t rx_tsc);
+  // Hold the pending downlink symbols until their U-plane window
+  size_t DequeueSend();
+  // Send the held downlink symbols whose U-plane window has opened by
+  // now_tsc, and drop the ones past it
+  size_t SendUplane(size_t now_tsc);
+  // Send the C-plane messages of the slots due by now_tsc
+  size_t SendCplane(size_t now_tsc);
+  // One C-plane message per antenna of each run of uplink or downlink
+  // symbols of the slot
+  size_t SendCplaneSlot(size_t abs_slot);
+  // An mbuf with the Ethernet header of interface, for ecpri_bytes of
+  // message after it
+  rte_mbuf* AllocEcpri(size_t interface, size_t ecpri_bytes);
+  void Send(size_t interface, rte_mbuf* tx_buf);
+
+  // dpdk port_id / device : queue_id
+  const std::vector<std::pair<uint16_t, uint16_t>> dpdk_phy_port_queues_;
+  // Pool on the NUMA node of the first port of the worker, for tx
+  rte_mempool* mbuf_pool_;
+  const OranTiming& timing_;
+  // PRBs of the data subcarriers, and bytes of each
+  const size_t num_prb_;
+  const size_t prb_bytes_;
+  const double freq_ghz_;
+  // The U-plane window and C-plane advance, in TSC cycles
+  const size_t t1a_min_cycles_;
+  const size_t t1a_max_cycles_;
+  const size_t tcp_adv_cycles_;
+
+  // Ethernet (and VLAN) headers of the messages to the RU of each interface
+  std::vector<std::array<uint8_t, kMaxEthHeaderBytes>> eth_headers_;
+  size_t eth_header_bytes_;
+  // Sections of the U-plane message being received
+  std::array<OranSection, kOranMaxSections> sections_;
+  // Sequence ids of the U-plane and C-plane messages of each antenna
+  std::vector<uint8_t> uplane_seq_;
+  std::vector<uint8_t> cplane_seq_;
+  std::priority_queue<PendingTx, std::vector<PendingTx>,
+                      std::greater<PendingTx>>
+      tx_pending_;
+  // Slot since the GPS epoch of the next C-plane messages
+  size_t next_cplane_slot_;
+  // Downlink symbols dropped for missing their U-plane window
+  size_t tx_late_;
+  // Port / queue of the next receive
+  size_t rx_index_;
+  // Newest frame received, for the rx_frame_start timestamps
+  size_t prev_frame_id_;
+};
+#endif  // TXRX_WORKER_ORAN_H_
@@ -6,11 +6,16 @@
 
 #include "txrx_worker_sim.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 
 #include "gettime.h"
+#include "idle_policy.h"
 #include "logger.h"
+#include "memory_manage.h"
 #include "message.h"
+#include "shm_comm.h"
 
 static constexpr bool kEnableSlowStart = true;
 static constexpr bool kDebugPrintBeacon = false;
@@ -21,6 +26,8 @@ static constexpr size_t kSlowStartMulStage1 = 32;
 static constexpr size_t kSlowStartMulStage2 = 8;
 
 static constexpr size_t kSocketRxBufferSize = (1024 * 1024 * 64 * 8) - 1;
+// Max packets per RecvBatch() call
+static constexpr size_t kRxBatchSize = 16;
 
 TxRxWorkerSim::TxRxWorkerSim(
     size_t core_offset, size_t tid, size_t interface_count,
@@ -42,9 +49,9 @@ TxRxWorkerSim::TxRxWorkerSim(
     const uint16_t rem_port_id =
         config->BsRruPort() + interface + interface_offset_;
 
-    udp_comm_.emplace_back(std::make_unique<UDPComm>(
-        config->BsServerAddr(), local_port_id, kSocketRxBufferSize, 0));
-    udp_comm_.back()->Connect(config->BsRruAddr(), rem_port_id);
+    udp_comm_.emplace_back(CreateSimComm(config, config->BsServerAddr(),
+                                         local_port_id, config->BsRruAddr(),
+                                         rem_port_id, kSocketRxBufferSize));
 
     AGORA_LOG_FRAME(
         "TxRxWorkerSim[%zu]: set up UDP socket server listening to %s:%d "
@@ -53,91 +60,138 @@ TxRxWorkerSim::TxRxWorkerSim(
         config->BsRruAddr().c_str(), rem_port_id);
   }
   beacon_buffer_.resize(config->PacketLength());
+  // A batch holds at most one dequeue of tx events
+  tx_batches_.resize(num_interfaces_);
+  for (auto& tx_batch : tx_batches_) {
+    tx_batch.reserve(num_interfaces_ * channels_per_interface_);
+  }
+  tx_lens_.resize(num_interfaces_ * channels_per_interface_,
+                  config->DlPacketLength());
+
+  if (config->FronthaulAggregation() > 1) {
+    // Twice the datagrams that fill the rx packets, so that partly filled
+    // ones rarely hold up the receive
+    const size_t num_aggregates = std::max(
+        kRxBatchSize, (2 * rx_memory.size()) / config->FronthaulAggregation());
+    const size_t stride = Roundup<64>(config->AggregatePacketLength());
+    rx_aggregate_memory_ =
+        static_cast<std::byte*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64, num_aggregates * stride));
+    rx_aggregates_ = std::vector<RxAggregate>(num_aggregates);
+    for (size_t i = 0; i < num_aggregates; i++) {
+      rx_aggregates_.at(i).agg_ = reinterpret_cast<AggregatePacket*>(
+          rx_aggregate_memory_ + (i * stride));
+    }
+  }
 }
 
-TxRxWorkerSim::~TxRxWorkerSim() = default;
+TxRxWorkerSim::~TxRxWorkerSim() {
+  // Stop before freeing the datagrams the thread receives into
+  Stop();
+  if (rx_aggregate_memory_ != nullptr) {
+    Agora_memory::PaddedAlignedFree(rx_aggregate_memory_);
+  }
+}
 
 //Main Thread Execution loop
 void TxRxWorkerSim::DoTxRx() {
   PinToCoreWithOffset(ThreadType::kWorkerTXRX, core_offset_, tid_);
+  InitBeaconTiming();
+  running_ = true;
+  WaitSync();
+  send_time_ = GetTime::Rdtsc() + delay_tsc_;
+
+  // Waits at most idle_sleep_us, so a beacon is late by at most as much
+  IdlePolicy idle(Configuration());
+  while (Configuration()->Running() == true) {
+    if (PollOnce()) {
+      idle.Busy();
+    } else {
+      idle.Idle();
+    }
+  }  // end while
+  idle.PrintSummary("TxRxWorkerSim[" + std::to_string(tid_) + "]");
+  running_ = false;
+}
+
+bool TxRxWorkerSim::StartInline() {
+  AGORA_LOG_INFO("TxRxWorkerSim[%zu]: polled inline by the calling thread\n",
+                 tid_);
+  InitBeaconTiming();
+  running_ = true;
+  send_time_ = GetTime::Rdtsc() + delay_tsc_;
+  return true;
+}
 
+void TxRxWorkerSim::InitBeaconTiming() {
   const double rdtsc_freq = GetTime::MeasureRdtscFreq();
-  const size_t frame_tsc_delta =
-      Configuration()->GetFrameDurationSec() * 1e9f * rdtsc_freq;
+  frame_tsc_delta_ = Configuration()->GetFrameDurationSec() * 1e9f * rdtsc_freq;
   const size_t two_hundred_ms_ticks = (0.2f /* 200 ms */ * 1e9f * rdtsc_freq);
 
   // Slow start variables (Start with no less than 200 ms)
   const size_t slow_start_tsc1 =
-      std::max(kSlowStartMulStage1 * frame_tsc_delta, two_hundred_ms_ticks);
+      std::max(kSlowStartMulStage1 * frame_tsc_delta_, two_hundred_ms_ticks);
 
-  const size_t slow_start_tsc2 = kSlowStartMulStage2 * frame_tsc_delta;
-  size_t delay_tsc = frame_tsc_delta;
+  slow_start_tsc2_ = kSlowStartMulStage2 * frame_tsc_delta_;
+  delay_tsc_ = frame_tsc_delta_;
 
   if (kEnableSlowStart) {
-    delay_tsc = slow_start_tsc1;
+    delay_tsc_ = slow_start_tsc1;
   }
+  prev_frame_id_ = SIZE_MAX;
+  tx_frame_id_ = 0;
+  rx_interface_ = 0;
+}
 
-  size_t prev_frame_id = SIZE_MAX;
-  size_t tx_frame_id = 0;
-  size_t thread_local_interface = 0;
-  running_ = true;
-  WaitSync();
-
-  size_t tx_frame_start = GetTime::Rdtsc();
-  size_t send_time = delay_tsc + tx_frame_start;
-
-  // Send Beacons for the first time to kick off sim
-  // SendBeacon(tid, tx_frame_id++);
-  while (Configuration()->Running() == true) {
-    const size_t rdtsc_now = GetTime::Rdtsc();
-
-    if (rdtsc_now > send_time) {
-      AGORA_LOG_SYMBOL(
-          "TxRxWorkerSim[%zu]: sending beacon for frame %zu at time %zu\n",
-          tid_, tx_frame_id, rdtsc_now);
-      SendBeacon(tx_frame_id++);
-
-      if (kEnableSlowStart) {
-        if (tx_frame_id == kSlowStartThresh1) {
-          delay_tsc = slow_start_tsc2;
-          AGORA_LOG_TRACE(
-              "TxRxWorkerSim[%zu]: increasing beacon rate at frame %zu time "
-              "%zu\n",
-              tid_, kSlowStartThresh1, rdtsc_now);
-        } else if (tx_frame_id == kSlowStartThresh2) {
-          delay_tsc = frame_tsc_delta;
-          AGORA_LOG_TRACE(
-              "TxRxWorkerSim[%zu]: increasing beacon rate to full speed at "
-              "frame %zu time %zu\n",
-              tid_, kSlowStartThresh2, rdtsc_now);
-        }
+bool TxRxWorkerSim::PollOnce() {
+  const size_t rdtsc_now = GetTime::Rdtsc();
+
+  if (rdtsc_now > send_time_) {
+    AGORA_LOG_SYMBOL(
+        "TxRxWorkerSim[%zu]: sending beacon for frame %zu at time %zu\n", tid_,
+        tx_frame_id_, rdtsc_now);
+    SendBeacon(tx_frame_id_++);
+
+    if (kEnableSlowStart) {
+      if (tx_frame_id_ == kSlowStartThresh1) {
+        delay_tsc_ = slow_start_tsc2_;
+        AGORA_LOG_TRACE(
+            "TxRxWorkerSim[%zu]: increasing beacon rate at frame %zu time "
+            "%zu\n",
+            tid_, kSlowStartThresh1, rdtsc_now);
+      } else if (tx_frame_id_ == kSlowStartThresh2) {
+        delay_tsc_ = frame_tsc_delta_;
+        AGORA_LOG_TRACE(
+            "TxRxWorkerSim[%zu]: increasing beacon rate to full speed at "
+            "frame %zu time %zu\n",
+            tid_, kSlowStartThresh2, rdtsc_now);
       }
-      tx_frame_start = send_time;
-      send_time += delay_tsc;
     }
+    send_time_ += delay_tsc_;
+  }
 
-    const size_t send_result = DequeueSend();
-    if (0 == send_result) {
-      // receive data
-      // Need to get NumChannels data here
-      const auto rx_packets = RecvEnqueue(thread_local_interface);
-      for (const auto& packet : rx_packets) {
-        if (kIsWorkerTimingEnabled) {
-          const uint32_t frame_id = packet->frame_id_;
-          if (frame_id != prev_frame_id) {
-            rx_frame_start_[frame_id % kNumStatsFrames] = GetTime::Rdtsc();
-            prev_frame_id = frame_id;
-          }
-        }
+  const size_t send_result = DequeueSend();
+  if (send_result > 0) {
+    return true;
+  }
+  // receive data
+  // Need to get NumChannels data here
+  const auto rx_packets = RecvEnqueue(rx_interface_);
+  for (const auto& packet : rx_packets) {
+    if (kIsWorkerTimingEnabled) {
+      const uint32_t frame_id = packet->frame_id_;
+      if (frame_id != prev_frame_id_) {
+        rx_frame_start_[frame_id % kNumStatsFrames] = GetTime::Rdtsc();
+        prev_frame_id_ = frame_id;
       }
+    }
+  }
 
-      thread_local_interface++;
-      if (thread_local_interface == num_interfaces_) {
-        thread_local_interface = 0;
-      }
-    }  // end if -1 == send_result
-  }    // end while
-  running_ = false;
+  rx_interface_++;
+  if (rx_interface_ == num_interfaces_) {
+    rx_interface_ = 0;
+  }
+  return (rx_packets.empty() == false);
 }
 
 void TxRxWorkerSim::SendBeacon(size_t frame_id) {
@@ -172,16 +226,42 @@ void TxRxWorkerSim::SendBeacon(size_t frame_id) {
 }
 
 std::vector<Packet*> TxRxWorkerSim::RecvEnqueue(size_t interface_id) {
+  if (Configuration()->FronthaulAggregation() > 1) {
+    return RecvEnqueueAggregates(interface_id);
+  }
   std::vector<Packet*> rx_packets;
   const size_t packet_length = Configuration()->PacketLength();
 
-  RxPacket& rx_placement = GetRxPacket();
-  Packet* pkt = rx_placement.RawPacket();
+  // Take as many rx packets as the buffer has free in a row, at least one
+  std::array<RxPacket*, kRxBatchSize> rx_placements;
+  std::array<std::byte*, kRxBatchSize> bufs;
+  std::array<size_t, kRxBatchSize> rx_bytes;
+  size_t num_placements = 0;
+  do {
+    rx_placements.at(num_placements) = &GetRxPacket();
+    bufs.at(num_placements) = reinterpret_cast<std::byte*>(
+        rx_placements.at(num_placements)->RawPacket());
+    num_placements++;
+  } while ((num_placements < kRxBatchSize) && RxPacketAvailable());
+
+  const ssize_t num_rx = udp_comm_.at(interface_id)
+                             ->RecvBatch(bufs.data(), packet_length,
+                                         rx_bytes.data(), num_placements);
+  if (0 > num_rx) {
+    AGORA_LOG_ERROR("RecvEnqueue: Udp Recv failed with error\n");
+    throw std::runtime_error("TxRxWorkerSim: recv failed");
+  }
 
-  ssize_t rx_bytes =
-      udp_comm_.at(interface_id)
-          ->Recv(reinterpret_cast<std::byte*>(pkt), packet_length);
-  if (rx_bytes == static_cast<ssize_t>(packet_length)) {
+  for (ssize_t i = 0; i < num_rx; i++) {
+    if (rx_bytes.at(i) != packet_length) {
+      AGORA_LOG_ERROR(
+          "RecvEnqueue: Udp Recv failed to receive all expected bytes");
+      throw std::runtime_error(
+          "PacketTxRx::RecvEnqueue: Udp Recv failed to receive all expected "
+          "bytes");
+    }
+    RxPacket& rx_placement = *rx_placements.at(i);
+    Packet* pkt = rx_placement.RawPacket();
     if (kDebugPrintInTask) {
       std::printf("TxRxWorkerSim[%zu]: Received frame %d, symbol %d, ant %d\n",
                   tid_, pkt->frame_id_, pkt->symbol_id_, pkt->ant_id_);
@@ -204,19 +284,71 @@ std::vector<Packet*> TxRxWorkerSim::RecvEnqueue(size_t interface_id) {
     EventData rx_message(EventType::kPacketRX, rx_tag_t(rx_placement).tag_);
     NotifyComplete(rx_message);
     rx_packets.push_back(pkt);
-  } else if (0 > rx_bytes) {
+  }
+
+  // Recycle the unused buffers, newest first
+  for (size_t i = num_placements; i > static_cast<size_t>(num_rx); i--) {
+    ReturnRxPacket(*rx_placements.at(i - 1));
+  }
+  return rx_packets;
+}
+
+void TxRxWorkerSim::ReleaseRxAggregate(void* mem) {
+  static_cast<RxAggregate*>(mem)->references_.fetch_sub(
+      1, std::memory_order_release);
+}
+
+std::vector<Packet*> TxRxWorkerSim::RecvEnqueueAggregates(
+    size_t interface_id) {
+  std::vector<Packet*> rx_packets;
+  const size_t payload_bytes =
+      Configuration()->PacketLength() - Packet::kOffsetOfData;
+
+  // Take as many datagram buffers as are free in a row. If none is, the
+  // datagrams wait in the socket until the master frees their packets.
+  std::array<RxAggregate*, kRxBatchSize> rx_placements;
+  std::array<std::byte*, kRxBatchSize> bufs;
+  std::array<size_t, kRxBatchSize> rx_bytes;
+  size_t num_placements = 0;
+  while (num_placements < kRxBatchSize) {
+    RxAggregate& placement = rx_aggregates_.at(
+        (rx_aggregate_idx_ + num_placements) % rx_aggregates_.size());
+    if (placement.references_.load(std::memory_order_acquire) != 0) {
+      break;
+    }
+    rx_placements.at(num_placements) = &placement;
+    bufs.at(num_placements) = reinterpret_cast<std::byte*>(placement.agg_);
+    num_placements++;
+  }
+  if (num_placements == 0) {
+    return rx_packets;
+  }
+
+  const ssize_t num_rx =
+      udp_comm_.at(interface_id)
+          ->RecvBatch(bufs.data(), Configuration()->AggregatePacketLength(),
+                      rx_bytes.data(), num_placements);
+  if (0 > num_rx) {
     AGORA_LOG_ERROR("RecvEnqueue: Udp Recv failed with error\n");
     throw std::runtime_error("TxRxWorkerSim: recv failed");
-  } else if (0 != rx_bytes) {
-    AGORA_LOG_ERROR(
-        "RecvEnqueue: Udp Recv failed to receive all expected bytes");
-    throw std::runtime_error(
-        "PacketTxRx::RecvEnqueue: Udp Recv failed to receive all expected "
-        "bytes");
-  } else {
-    // Received 0 bytes.  Time to recycle the buffer
-    ReturnRxPacket(rx_placement);
   }
+
+  for (ssize_t i = 0; i < num_rx; i++) {
+    RxAggregate& placement = *rx_placements.at(i);
+    const size_t num_entries =
+        placement.agg_->NumEntries(rx_bytes.at(i), payload_bytes);
+    if (num_entries == 0) {
+      AGORA_LOG_ERROR(
+          "RecvEnqueue: Udp Recv received a malformed aggregate packet\n");
+      throw std::runtime_error(
+          "TxRxWorkerSim: malformed aggregate packet received");
+    }
+    // One reference per payload, set before the master can free any
+    placement.references_.store(num_entries, std::memory_order_relaxed);
+    NotifyAggregate(*placement.agg_, num_entries, &placement,
+                    ReleaseRxAggregate, rx_packets);
+  }
+  rx_aggregate_idx_ = (rx_aggregate_idx_ + num_rx) % rx_aggregates_.size();
   return rx_packets;
 }
 
@@ -267,11 +399,20 @@ size_t TxRxWorkerSim::DequeueSend() {
     }
 
     const size_t local_interface_idx = interface_id - interface_offset_;
-    // Send data (one OFDM symbol)
-    udp_comm_.at(local_interface_idx)
-        ->Send(reinterpret_cast<std::byte*>(pkt),
-               Configuration()->DlPacketLength());
+    tx_batches_.at(local_interface_idx)
+        .push_back(reinterpret_cast<std::byte*>(pkt));
+  }
 
+  // Send data (one OFDM symbol per packet), one batch per interface
+  for (size_t interface = 0; interface < num_interfaces_; interface++) {
+    auto& tx_batch = tx_batches_.at(interface);
+    if (tx_batch.empty() == false) {
+      udp_comm_.at(interface)->SendBatch(tx_batch.data(), tx_lens_.data(),
+                                         tx_batch.size());
+      tx_batch.clear();
+    }
+  }
+  for (const EventData& current_event : tx_events) {
     const auto complete_event =
         EventData(EventType::kPacketTX, current_event.tags_[0]);
     NotifyComplete(complete_event);
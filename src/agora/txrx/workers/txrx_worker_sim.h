@@ -6,12 +6,14 @@
 #ifndef TXRX_WORKER_SIM_H_
 #define TXRX_WORKER_SIM_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "message.h"
+#include "packet_comm.h"
 #include "txrx_worker.h"
-#include "udp_comm.h"
 
 class TxRxWorkerSim : public TxRxWorker {
  public:
@@ -29,16 +31,47 @@ class TxRxWorkerSim : public TxRxWorker {
   ~TxRxWorkerSim() final;
 
   void DoTxRx() final;
+  bool StartInline() final;
+  bool PollOnce() final;
 
  private:
+  // Beacon period and slow start, measured on the calling thread
+  void InitBeaconTiming();
   size_t DequeueSend();
   void SendBeacon(size_t frame_id);
   std::vector<Packet*> RecvEnqueue(size_t interface_id);
+  // RecvEnqueue() of AggregatePacket datagrams
+  std::vector<Packet*> RecvEnqueueAggregates(size_t interface_id);
+  static void ReleaseRxAggregate(void* mem);
+
+  // A received AggregatePacket, which the packets of its payloads point into.
+  // It is reused once all of them are freed.
+  struct RxAggregate {
+    std::atomic<unsigned> references_{0};
+    AggregatePacket* agg_ = nullptr;
+  };
 
   //1 for each responsible interface (ie radio)
   //socket for incomming messages (received data)
-  std::vector<std::unique_ptr<UDPComm>> udp_comm_;
+  std::vector<std::unique_ptr<PacketComm>> udp_comm_;
   std::vector<std::byte> beacon_buffer_;
+  // Downlink packets to send on each interface, and their lengths
+  std::vector<std::vector<const std::byte*>> tx_batches_;
+  std::vector<size_t> tx_lens_;
   double beacon_send_time_;
+  // Beacon timing, in TSC cycles
+  size_t frame_tsc_delta_ = 0;
+  size_t slow_start_tsc2_ = 0;
+  size_t delay_tsc_ = 0;
+  size_t send_time_ = 0;
+  size_t tx_frame_id_ = 0;
+  // Newest frame received, for the rx_frame_start timestamps
+  size_t prev_frame_id_ = SIZE_MAX;
+  // Interface of the next receive
+  size_t rx_interface_ = 0;
+  // With fronthaul_aggregation, the datagram buffers in receive order
+  std::vector<RxAggregate> rx_aggregates_;
+  std::byte* rx_aggregate_memory_ = nullptr;
+  size_t rx_aggregate_idx_ = 0;
 };
 #endif  // TXRX_WORKER_SIM_H_
@@ -7,6 +7,7 @@
 #include "txrx_worker_usrp.h"
 
 #include <cassert>
+#include <cstring>
 
 #include "gettime.h"
 #include "logger.h"
@@ -31,6 +32,10 @@ TxRxWorkerUsrp::TxRxWorkerUsrp(
                  config, rx_frame_start, event_notify_q, tx_pending_q,
                  tx_producer, notify_producer, rx_memory, tx_memory, sync_mutex,
                  sync_cond, can_proceed),
+      tx_burst_first_symbol_(0),
+      tx_burst_samples_(0),
+      tx_burst_symbols_(0),
+      tx_time0_(0),
       rx_time_bs_(0),
       tx_time_bs_(0),
       radio_config_(radio_config) {}
@@ -90,6 +95,10 @@ void TxRxWorkerUsrp::DoTxRx() {
                                        Configuration()->SampsPerSymbol() *
                                        Configuration()->Frame().NumTotalSyms());
   AGORA_LOG_INFO("Time0 captured %lld...\n", time0);
+  tx_time0_ = time0;
+  if (Configuration()->UsrpTxBurst()) {
+    InitTxBurst(number_bs_radios);
+  }
   for (size_t i = 0; i < kTxFrameAdvance; i++) {
     TxBeacon(radio_id, tx_frame_number + i, tx_locs, time0);
   }
@@ -112,6 +121,16 @@ void TxRxWorkerUsrp::DoTxRx() {
     }
   }
 
+  if (Configuration()->UsrpRxStreaming()) {
+    // Frame 0 starts right after the last discarded symbol
+    RxStreaming(radio_id, number_bs_radios,
+                last_rx_time +
+                    static_cast<long long>(Configuration()->SampsPerSymbol()),
+                tx_locs, time0);
+    running_ = false;
+    return;
+  }
+
   AGORA_LOG_INFO("USRP: Start BS main recv loop...\n");
 
   size_t rx_frame_id = 0;
@@ -121,6 +140,9 @@ void TxRxWorkerUsrp::DoTxRx() {
   while (Configuration()->Running()) {
     // receive data (assumes we rx samples_per_symbol)
     RecvEnqueue(local_interface, rx_frame_id, rx_symbol_id, rx_locs);
+    if (Configuration()->UsrpTxBurst()) {
+      DequeueSendBurst();
+    }
 
     //if rx is successful than update the counter / times
     // Schedule the next beacon (only on interface 0)
@@ -214,6 +236,122 @@ std::vector<Packet*> TxRxWorkerUsrp::RecvEnqueue(
   return rx_packets;
 }
 
+bool TxRxWorkerUsrp::IsRxPublished(size_t frame_id, size_t symbol_id) {
+  return Configuration()->IsPilot(frame_id, symbol_id) ||
+         Configuration()->IsUplink(frame_id, symbol_id);
+}
+
+void TxRxWorkerUsrp::RxStreaming(size_t radio_id, size_t num_channels,
+                                 long long rx_start_time,
+                                 const std::vector<void*>& tx_locs,
+                                 long long time0) {
+  const size_t samps_per_symbol = Configuration()->SampsPerSymbol();
+  const size_t num_symbols = Configuration()->Frame().NumTotalSyms();
+  const size_t beacon_symbol = Configuration()->Frame().GetBeaconSymbol(0);
+  const auto symbol_len = static_cast<long long>(samps_per_symbol);
+
+  stream_discard_memory_.assign(
+      num_channels,
+      std::vector<std::complex<short>>(samps_per_symbol * num_symbols));
+  stream_rx_locs_.resize(num_channels);
+  stream_packets_.resize(num_channels);
+
+  AGORA_LOG_INFO(
+      "TxRxWorkerUsrp[%zu]: Start BS streaming recv loop at time %lld\n", tid_,
+      rx_start_time);
+
+  long long next_time = rx_start_time;
+  size_t num_resyncs = 0;
+  while (Configuration()->Running()) {
+    if (Configuration()->UsrpTxBurst()) {
+      DequeueSendBurst();
+    }
+    const long long symbol_offset = (next_time - rx_start_time) % symbol_len;
+    const auto symbol_index =
+        static_cast<size_t>((next_time - rx_start_time) / symbol_len);
+    const size_t frame_id = symbol_index / num_symbols;
+    const size_t symbol_id = symbol_index % num_symbols;
+
+    // Published symbols go straight into a packet, one symbol per call.
+    // Everything else up to the next published symbol (or the end of the
+    // frame) is taken in a single call, so a frame needs few recv calls.
+    bool publish = false;
+    size_t rx_size;
+    if (symbol_offset != 0) {
+      // Back to a symbol boundary after lost samples
+      rx_size = samps_per_symbol - symbol_offset;
+    } else if (IsRxPublished(frame_id, symbol_id)) {
+      publish = true;
+      rx_size = samps_per_symbol;
+    } else {
+      size_t run = 1;
+      while ((symbol_id + run < num_symbols) &&
+             (IsRxPublished(frame_id, symbol_id + run) == false)) {
+        run++;
+      }
+      rx_size = run * samps_per_symbol;
+    }
+
+    for (size_t ch = 0; ch < num_channels; ch++) {
+      if (publish) {
+        RxPacket& rx = GetRxPacket();
+        stream_packets_.at(ch) = &rx;
+        stream_rx_locs_.at(ch) = rx.RawPacket()->data_;
+      } else {
+        stream_rx_locs_.at(ch) = stream_discard_memory_.at(ch).data();
+      }
+    }
+
+    Radio::RxFlags rx_flags;
+    long long rx_time;
+    const int rx_status = radio_config_.RadioRx(
+        radio_id, stream_rx_locs_, rx_size, rx_flags, rx_time);
+
+    if ((rx_status != static_cast<int>(rx_size)) || (rx_time != next_time)) {
+      // Overflow or timeout: drop the samples and pick up the stream at the
+      // time it now delivers, instead of shifting every later symbol
+      if (publish) {
+        for (size_t ch = num_channels; ch > 0; ch--) {
+          ReturnRxPacket(*stream_packets_.at(ch - 1));
+        }
+      }
+      if ((rx_status > 0) && (rx_time >= rx_start_time)) {
+        num_resyncs++;
+        AGORA_LOG_WARN(
+            "TxRxWorkerUsrp[%zu]: Rx at time %lld, expected %lld (%zu "
+            "resyncs)\n",
+            tid_, rx_time, next_time, num_resyncs);
+        next_time = rx_time + rx_status;
+      }
+      continue;
+    }
+    next_time += rx_size;
+    if (symbol_offset != 0) {
+      continue;
+    }
+
+    if (publish) {
+      for (size_t ch = 0; ch < num_channels; ch++) {
+        RxPacket& rx = *stream_packets_.at(ch);
+        new (rx.RawPacket())
+            Packet(frame_id, symbol_id, 0, (radio_id * num_channels) + ch);
+        const EventData rx_message(EventType::kPacketRX, rx_tag_t(rx).tag_);
+        NotifyComplete(rx_message);
+      }
+    }
+
+    const size_t rx_symbols = rx_size / samps_per_symbol;
+    if ((beacon_symbol >= symbol_id) &&
+        (beacon_symbol < symbol_id + rx_symbols)) {
+      TxBeacon(radio_id, frame_id + kTxFrameAdvance, tx_locs, time0);
+    }
+    if (kIsWorkerTimingEnabled && (symbol_id == 0)) {
+      rx_frame_start_[frame_id % kNumStatsFrames] = GetTime::Rdtsc();
+    }
+  }
+  rx_time_bs_ = next_time;
+}
+
 //Tx data
 int TxRxWorkerUsrp::DequeueSend() {
   auto events = GetPendingTxEvents(1);
@@ -357,6 +495,77 @@ int TxRxWorkerUsrp::DequeueSend(int frame_id, int symbol_id) {
   return event.tags_[0];
 }
 
+void TxRxWorkerUsrp::InitTxBurst(size_t num_channels) {
+  const auto& frame = Configuration()->Frame();
+  tx_burst_symbols_ = frame.NumDLSyms();
+  if (tx_burst_symbols_ == 0) {
+    return;
+  }
+  tx_burst_first_symbol_ = frame.GetDLSymbol(0);
+  tx_burst_samples_ =
+      ((frame.GetDLSymbolLast() - tx_burst_first_symbol_) + 1) *
+      Configuration()->SampsPerSymbol();
+  const size_t num_slots = Configuration()->FrameWindow();
+  tx_burst_memory_.assign(
+      num_slots,
+      std::vector<std::vector<std::complex<short>>>(
+          num_channels, std::vector<std::complex<short>>(
+                            tx_burst_samples_, std::complex<short>(0, 0))));
+  tx_burst_pending_.assign(num_slots, num_channels * tx_burst_symbols_);
+  tx_burst_locs_.resize(num_channels);
+  AGORA_LOG_INFO(
+      "TxRxWorkerUsrp[%zu]: downlink bursts of %zu samples from symbol %zu\n",
+      tid_, tx_burst_samples_, tx_burst_first_symbol_);
+}
+
+size_t TxRxWorkerUsrp::DequeueSendBurst() {
+  const auto events = GetPendingTxEvents();
+  const size_t samps_per_symbol = Configuration()->SampsPerSymbol();
+  for (const EventData& event : events) {
+    assert(event.event_type_ == EventType::kPacketTX);
+    const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
+    const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
+    const size_t ant_id = gen_tag_t(event.tags_[0]).ant_id_;
+    const size_t slot = frame_id % tx_burst_memory_.size();
+
+    // The tx packet is free again once its samples are in the burst
+    const auto* pkt = GetTxPacket(frame_id, symbol_id, ant_id);
+    std::memcpy(tx_burst_memory_.at(slot).at(ant_id).data() +
+                    ((symbol_id - tx_burst_first_symbol_) * samps_per_symbol),
+                pkt->data_, samps_per_symbol * sizeof(std::complex<short>));
+    NotifyComplete(EventData(EventType::kPacketTX, event.tags_[0]));
+
+    tx_burst_pending_.at(slot)--;
+    if (tx_burst_pending_.at(slot) == 0) {
+      SendBurst(frame_id);
+      tx_burst_pending_.at(slot) =
+          tx_burst_memory_.at(slot).size() * tx_burst_symbols_;
+    }
+  }
+  return events.size();
+}
+
+void TxRxWorkerUsrp::SendBurst(size_t frame_id) {
+  const size_t tx_frame_id = frame_id + TX_FRAME_DELTA;
+  auto& burst = tx_burst_memory_.at(frame_id % tx_burst_memory_.size());
+  for (size_t ch = 0; ch < burst.size(); ch++) {
+    tx_burst_locs_.at(ch) = burst.at(ch).data();
+  }
+  long long tx_time =
+      tx_time0_ +
+      Configuration()->SymbolTimeOffset(tx_frame_id, tx_burst_first_symbol_);
+  const int tx_ret =
+      radio_config_.RadioTx(0, tx_burst_locs_.data(), tx_burst_samples_,
+                            Radio::TxFlags::kStartEndTransmit, tx_time);
+  if (tx_ret != static_cast<int>(tx_burst_samples_)) {
+    AGORA_LOG_ERROR(
+        "TxRxWorkerUsrp[%zu]: BAD burst transmit (%d:%zu) at time %lld for "
+        "frame %zu\n",
+        tid_, tx_ret, tx_burst_samples_, tx_time, tx_frame_id);
+  }
+  tx_time_bs_ = tx_time;
+}
+
 ///add - All radio id support?
 long long TxRxWorkerUsrp::GetRxTime(size_t radio_id,
                                     std::vector<void*>& rx_locs) {
@@ -7,6 +7,7 @@
 #ifndef TXRX_WORKER_USRP_H_
 #define TXRX_WORKER_USRP_H_
 
+#include <complex>
 #include <memory>
 #include <vector>
 
@@ -33,6 +34,12 @@ class TxRxWorkerUsrp : public TxRxWorker {
  private:
   int DequeueSend();
   int DequeueSend(int frame_id, int symbol_id);
+  // Allocate the burst buffers of Config::UsrpTxBurst() for num_channels
+  void InitTxBurst(size_t num_channels);
+  // Copy the pending downlink symbols into the bursts of their frames, and
+  // send the bursts that are complete. Returns the number of symbols taken.
+  size_t DequeueSendBurst();
+  void SendBurst(size_t frame_id);
   std::vector<Packet*> RecvEnqueue(size_t radio_id, size_t frame_id,
                                    size_t symbol_id,
                                    const std::vector<void*>& discard_locs);
@@ -42,6 +49,30 @@ class TxRxWorkerUsrp : public TxRxWorker {
                             std::vector<void*>& rx_locs);
   void TxBeacon(size_t radio_id, size_t tx_frame_number,
                 const std::vector<void*>& tx_locs, long long time0);
+  // Receive loop of Config::UsrpRxStreaming(). The frame and symbol of the
+  // samples come from their rx timestamp relative to rx_start_time.
+  void RxStreaming(size_t radio_id, size_t num_channels,
+                   long long rx_start_time, const std::vector<void*>& tx_locs,
+                   long long time0);
+  bool IsRxPublished(size_t frame_id, size_t symbol_id);
+
+  // Streaming mode: per-channel sink for one frame of unused samples
+  std::vector<std::vector<std::complex<short>>> stream_discard_memory_;
+  std::vector<void*> stream_rx_locs_;
+  std::vector<RxPacket*> stream_packets_;
+
+  // Config::UsrpTxBurst(): the samples of each channel from the first to the
+  // last downlink symbol of a frame, by frame slot. The other symbols in
+  // between are left zero.
+  std::vector<std::vector<std::vector<std::complex<short>>>> tx_burst_memory_;
+  // Symbols of all channels that each frame slot still waits for
+  std::vector<size_t> tx_burst_pending_;
+  std::vector<const void*> tx_burst_locs_;
+  size_t tx_burst_first_symbol_;
+  size_t tx_burst_samples_;
+  size_t tx_burst_symbols_;
+  // Frame 0 of the tx times
+  long long tx_time0_;
 
   long long rx_time_bs_;
   long long tx_time_bs_;
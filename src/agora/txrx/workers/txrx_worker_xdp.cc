@@ -0,0 +1,348 @@
+/**
+ * @file txrx_worker_xdp.cc
+ * @brief Implementation of the datapath functions for communicating with
+ * simulators over AF_XDP sockets.
+ */
+
+#include "txrx_worker_xdp.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "gettime.h"
+#include "idle_policy.h"
+#include "logger.h"
+#include "memory_manage.h"
+#include "message.h"
+
+static constexpr size_t kXdpFrameSize = XSK_UMEM__DEFAULT_FRAME_SIZE;
+static constexpr size_t kXdpRingSize = XSK_RING_CONS__DEFAULT_NUM_DESCS;
+static constexpr size_t kXdpBatchSize = 32;
+// Headroom that the kernel leaves in front of every received frame
+// (XDP_PACKET_HEADROOM)
+static constexpr size_t kXdpRxHeadroom = 256;
+// Extra headroom so that the received Agora packets are 64-byte aligned
+static constexpr size_t kXdpFrameHeadroom = 64 - (kInetHdrsTotSize % 64);
+static_assert(
+    (kXdpRxHeadroom + kXdpFrameHeadroom + kInetHdrsTotSize) % 64 == 0,
+    "The received Agora packets must be 64-byte aligned");
+
+TxRxWorkerXdp::TxRxWorkerXdp(
+    size_t core_offset, size_t tid, size_t interface_count,
+    size_t interface_offset, Config* const config, size_t* rx_frame_start,
+    moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+    moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+    moodycamel::ProducerToken& tx_producer,
+    moodycamel::ProducerToken& notify_producer,
+    std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
+    std::mutex& sync_mutex, std::condition_variable& sync_cond,
+    std::atomic<bool>& can_proceed, size_t queue_id)
+    : TxRxWorker(core_offset, tid, interface_count, interface_offset,
+                 config->NumChannels(), config, rx_frame_start, event_notify_q,
+                 tx_pending_q, tx_producer, notify_producer, rx_memory,
+                 tx_memory, sync_mutex, sync_cond, can_proceed),
+      queue_id_(queue_id),
+      umem_area_(nullptr),
+      umem_(nullptr),
+      xsk_(nullptr),
+      rx_filtered_(0) {
+  bs_rru_addr_ = ipv4_from_str(config->BsRruAddr().c_str());
+  bs_server_addr_ = ipv4_from_str(config->BsServerAddr().c_str());
+
+  const size_t max_packet_length =
+      std::max(config->PacketLength(), config->DlPacketLength());
+  RtAssert(kXdpRxHeadroom + kXdpFrameHeadroom + kInetHdrsTotSize +
+                   max_packet_length <=
+               kXdpFrameSize,
+           "TxRxWorkerXdp: the packets do not fit in a UMEM frame");
+
+  // Every RX packet in use holds a frame, and the fill and RX rings hold the
+  // rest. The fill ring can take all of them, so that refills never fail.
+  const size_t num_rx_frames = rx_memory.size() + kXdpRingSize;
+  size_t fill_size = kXdpRingSize;
+  while (fill_size < num_rx_frames) {
+    fill_size *= 2;
+  }
+  const size_t num_frames = num_rx_frames + kXdpRingSize;
+  const size_t umem_size = num_frames * kXdpFrameSize;
+  umem_area_ = static_cast<uint8_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign4096, umem_size));
+  RtAssert(umem_area_ != nullptr, "TxRxWorkerXdp: UMEM allocation failed");
+
+  xsk_umem_config umem_config{};
+  umem_config.fill_size = fill_size;
+  umem_config.comp_size = kXdpRingSize;
+  umem_config.frame_size = kXdpFrameSize;
+  umem_config.frame_headroom = kXdpFrameHeadroom;
+  umem_config.flags = 0;
+  int ret = xsk_umem__create(&umem_, umem_area_, umem_size, &fill_, &comp_,
+                             &umem_config);
+  RtAssert(ret == 0, std::string("TxRxWorkerXdp: xsk_umem__create failed: ") +
+                         std::strerror(-ret));
+
+  xsk_socket_config xsk_config{};
+  xsk_config.rx_size = kXdpRingSize;
+  xsk_config.tx_size = kXdpRingSize;
+  xsk_config.bind_flags =
+      XDP_USE_NEED_WAKEUP | (config->XdpZeroCopy() ? XDP_ZEROCOPY : XDP_COPY);
+  ret = xsk_socket__create(&xsk_, config->XdpInterface().c_str(), queue_id_,
+                           umem_, &rx_, &tx_, &xsk_config);
+  RtAssert(ret == 0,
+           std::string("TxRxWorkerXdp: xsk_socket__create failed: ") +
+               std::strerror(-ret));
+
+  // All the RX frames start in the fill ring, the TX frames are free
+  rx_frames_.resize(num_rx_frames);
+  uint32_t fill_idx = 0;
+  const size_t reserved =
+      xsk_ring_prod__reserve(&fill_, num_rx_frames, &fill_idx);
+  RtAssert(reserved == num_rx_frames,
+           "TxRxWorkerXdp: could not fill the fill ring");
+  for (size_t i = 0; i < num_rx_frames; i++) {
+    rx_frames_.at(i) = RxFrame{this, i * kXdpFrameSize};
+    *xsk_ring_prod__fill_addr(&fill_, fill_idx + i) = i * kXdpFrameSize;
+  }
+  xsk_ring_prod__submit(&fill_, num_rx_frames);
+  free_tx_frames_.reserve(num_frames - num_rx_frames);
+  for (size_t i = num_rx_frames; i < num_frames; i++) {
+    free_tx_frames_.push_back(i * kXdpFrameSize);
+  }
+
+  // The downlink headers only differ in the ports of each interface. The
+  // destination is broadcast, as in the DPDK worker.
+  uint8_t src_mac[6];
+  fill_interface_mac(config->XdpInterface(), src_mac);
+  const uint8_t dst_mac[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  const auto dl_length = static_cast<uint16_t>(config->DlPacketLength());
+  tx_headers_.resize(num_interfaces_);
+  for (size_t interface = 0; interface < num_interfaces_; ++interface) {
+    auto* eth_hdr =
+        reinterpret_cast<eth_hdr_t*>(tx_headers_.at(interface).data());
+    auto* ipv4_hdr = reinterpret_cast<ipv4_hdr_t*>(&eth_hdr[1]);
+    auto* udp_hdr = reinterpret_cast<udp_hdr_t*>(&ipv4_hdr[1]);
+    gen_eth_header(eth_hdr, src_mac, dst_mac);
+    gen_ipv4_header(ipv4_hdr, ntohl(bs_server_addr_), ntohl(bs_rru_addr_),
+                    dl_length);
+    ipv4_hdr->check = ipv4_checksum(ipv4_hdr);
+    gen_udp_header(
+        udp_hdr, config->BsServerPort() + interface + interface_offset_,
+        config->BsRruPort() + interface + interface_offset_, dl_length);
+  }
+
+  AGORA_LOG_INFO(
+      "TxRxWorkerXdp[%zu]: bound to %s queue %zu (%s), %zu rx frames, %zu tx "
+      "frames\n",
+      tid_, config->XdpInterface().c_str(), queue_id_,
+      config->XdpZeroCopy() ? "zero-copy" : "copy", num_rx_frames,
+      free_tx_frames_.size());
+}
+
+TxRxWorkerXdp::~TxRxWorkerXdp() {
+  Stop();
+  if (rx_filtered_ > 0) {
+    AGORA_LOG_INFO("TxRxWorkerXdp[%zu]: filtered %zu packets\n", tid_,
+                   rx_filtered_);
+  }
+  xsk_socket__delete(xsk_);
+  xsk_umem__delete(umem_);
+  Agora_memory::PaddedAlignedFree(umem_area_);
+}
+
+// RxPacket::ReleaseFn of the received packets. Called by the worker that
+// frees the packet, so the frame only goes back to the fill ring later, on
+// the TxRx thread.
+void TxRxWorkerXdp::ReleaseRxFrame(void* mem) {
+  auto* frame = static_cast<RxFrame*>(mem);
+  frame->worker_->free_rx_frames_.enqueue(frame->addr_);
+}
+
+void TxRxWorkerXdp::DoTxRx() {
+  PinToCoreWithOffset(ThreadType::kWorkerTXRX, core_offset_, tid_);
+
+  size_t prev_frame_id = SIZE_MAX;
+  running_ = true;
+  WaitSync();
+
+  IdlePolicy idle(Configuration());
+  while (Configuration()->Running()) {
+    CompleteTx();
+    const size_t send_result = DequeueSend();
+    bool work_done = (send_result > 0);
+    if (0 == send_result) {
+      RefillRx();
+      const auto rx_packets = RecvEnqueue();
+      work_done = (rx_packets.empty() == false);
+      for (const auto& packet : rx_packets) {
+        if (kIsWorkerTimingEnabled) {
+          const uint32_t frame_id = packet->frame_id_;
+          if (frame_id != prev_frame_id) {
+            rx_frame_start_[frame_id % kNumStatsFrames] = GetTime::Rdtsc();
+            prev_frame_id = frame_id;
+          }
+        }
+      }
+    }
+    if (work_done) {
+      idle.Busy();
+    } else {
+      idle.Idle();
+    }
+  }
+  idle.PrintSummary("TxRxWorkerXdp[" + std::to_string(tid_) + "]");
+  running_ = false;
+}
+
+bool TxRxWorkerXdp::Filter(const uint8_t* frame, size_t len) {
+  const auto* eth_hdr = reinterpret_cast<const eth_hdr_t*>(frame);
+  const auto* ipv4_hdr = reinterpret_cast<const ipv4_hdr_t*>(&eth_hdr[1]);
+  const auto* udp_hdr = reinterpret_cast<const udp_hdr_t*>(&ipv4_hdr[1]);
+  if ((len != kInetHdrsTotSize + Configuration()->PacketLength()) ||
+      (eth_hdr->eth_type != htons(kIPEtherType)) ||
+      (ipv4_hdr->protocol != kIPHdrProtocol) ||
+      (ipv4_hdr->src_ip != bs_rru_addr_) ||
+      (ipv4_hdr->dst_ip != bs_server_addr_)) {
+    return true;
+  }
+  const size_t first_port = static_cast<size_t>(
+      Configuration()->BsServerPort() + interface_offset_);
+  const size_t dst_port = ntohs(udp_hdr->dst_port);
+  return (dst_port < first_port) || (dst_port >= first_port + num_interfaces_);
+}
+
+std::vector<Packet*> TxRxWorkerXdp::RecvEnqueue() {
+  std::vector<Packet*> rx_packets;
+  uint32_t rx_idx = 0;
+  const size_t num_rx = xsk_ring_cons__peek(&rx_, kXdpBatchSize, &rx_idx);
+  if (num_rx == 0) {
+    if (xsk_ring_prod__needs_wakeup(&fill_)) {
+      recvfrom(xsk_socket__fd(xsk_), nullptr, 0, MSG_DONTWAIT, nullptr,
+               nullptr);
+    }
+    return rx_packets;
+  }
+
+  for (size_t i = 0; i < num_rx; i++) {
+    const xdp_desc* desc = xsk_ring_cons__rx_desc(&rx_, rx_idx + i);
+    const uint64_t frame_addr = desc->addr - (desc->addr % kXdpFrameSize);
+    const auto* frame =
+        static_cast<const uint8_t*>(xsk_umem__get_data(umem_area_, desc->addr));
+    if (Filter(frame, desc->len)) {
+      free_rx_frames_.enqueue(frame_addr);
+      rx_filtered_++;
+      continue;
+    }
+
+    RxPacket& rx = GetRxPacket();
+    auto* pkt = reinterpret_cast<Packet*>(
+        const_cast<uint8_t*>(frame + kInetHdrsTotSize));
+    rx.SetExternal(pkt, &rx_frames_.at(frame_addr / kXdpFrameSize),
+                   ReleaseRxFrame);
+
+    AGORA_LOG_FRAME(
+        "TxRxWorkerXdp[%zu]::RecvEnqueue received pkt (frame %d, symbol %d, "
+        "ant %d) on queue %zu\n",
+        tid_, pkt->frame_id_, pkt->symbol_id_, pkt->ant_id_, queue_id_);
+
+    // Push kPacketRX event into the queue.
+    EventData rx_message(EventType::kPacketRX, rx_tag_t(rx).tag_);
+    NotifyComplete(rx_message);
+    rx_packets.push_back(pkt);
+  }
+  xsk_ring_cons__release(&rx_, num_rx);
+  return rx_packets;
+}
+
+void TxRxWorkerXdp::RefillRx() {
+  std::array<uint64_t, kXdpBatchSize> frames;
+  const size_t num_frames =
+      free_rx_frames_.try_dequeue_bulk(frames.data(), frames.size());
+  if (num_frames == 0) {
+    return;
+  }
+  uint32_t fill_idx = 0;
+  const size_t reserved =
+      xsk_ring_prod__reserve(&fill_, num_frames, &fill_idx);
+  RtAssert(reserved == num_frames, "TxRxWorkerXdp: fill ring overflow");
+  for (size_t i = 0; i < num_frames; i++) {
+    *xsk_ring_prod__fill_addr(&fill_, fill_idx + i) = frames.at(i);
+  }
+  xsk_ring_prod__submit(&fill_, num_frames);
+}
+
+void TxRxWorkerXdp::CompleteTx() {
+  uint32_t comp_idx = 0;
+  const size_t num_sent =
+      xsk_ring_cons__peek(&comp_, kXdpBatchSize, &comp_idx);
+  for (size_t i = 0; i < num_sent; i++) {
+    free_tx_frames_.push_back(*xsk_ring_cons__comp_addr(&comp_, comp_idx + i));
+  }
+  xsk_ring_cons__release(&comp_, num_sent);
+}
+
+//Function of the TxRx thread
+size_t TxRxWorkerXdp::DequeueSend() {
+  // Only take the events that have a free TX frame, the others wait in the
+  // queue until the NIC completes some sends
+  if (free_tx_frames_.empty()) {
+    return 0;
+  }
+  auto tx_events = GetPendingTxEvents(std::min(
+      free_tx_frames_.size(), num_interfaces_ * channels_per_interface_));
+  if (tx_events.empty()) {
+    return 0;
+  }
+
+  const size_t dl_packet_length = Configuration()->DlPacketLength();
+  uint32_t tx_idx = 0;
+  const size_t reserved =
+      xsk_ring_prod__reserve(&tx_, tx_events.size(), &tx_idx);
+  RtAssert(reserved == tx_events.size(), "TxRxWorkerXdp: tx ring overflow");
+
+  for (size_t i = 0; i < tx_events.size(); i++) {
+    const EventData& current_event = tx_events.at(i);
+    assert(current_event.event_type_ == EventType::kPacketTX);
+
+    const size_t frame_id = gen_tag_t(current_event.tags_[0u]).frame_id_;
+    const size_t symbol_id = gen_tag_t(current_event.tags_[0u]).symbol_id_;
+    const size_t ant_id = gen_tag_t(current_event.tags_[0u]).ant_id_;
+    const size_t interface_id = ant_id / channels_per_interface_;
+    const size_t local_interface_idx = interface_id - interface_offset_;
+
+    auto* pkt = GetTxPacket(frame_id, symbol_id, ant_id);
+    new (pkt) Packet(frame_id, symbol_id,
+                     Configuration()->CellId().at(interface_id), ant_id);
+
+    const uint64_t frame_addr = free_tx_frames_.back();
+    free_tx_frames_.pop_back();
+    auto* frame = static_cast<uint8_t*>(
+        xsk_umem__get_data(umem_area_, frame_addr));
+    std::memcpy(frame, tx_headers_.at(local_interface_idx).data(),
+                kInetHdrsTotSize);
+    std::memcpy(frame + kInetHdrsTotSize, pkt, dl_packet_length);
+
+    xdp_desc* desc = xsk_ring_prod__tx_desc(&tx_, tx_idx + i);
+    desc->addr = frame_addr;
+    desc->len = kInetHdrsTotSize + dl_packet_length;
+
+    if (kDebugPrintInTask) {
+      std::printf(
+          "TxRxWorkerXdp[%zu]::DequeueSend() Transmitted frame %zu, symbol "
+          "%zu, ant %zu, tag %zu\n",
+          tid_, frame_id, symbol_id, ant_id,
+          gen_tag_t(current_event.tags_[0]).tag_);
+    }
+
+    // The payload is copied out, so the tx memory can be reused
+    const auto complete_event =
+        EventData(EventType::kPacketTX, current_event.tags_[0]);
+    NotifyComplete(complete_event);
+  }
+  xsk_ring_prod__submit(&tx_, tx_events.size());
+  if (xsk_ring_prod__needs_wakeup(&tx_)) {
+    sendto(xsk_socket__fd(xsk_), nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+  }
+  return tx_events.size();
+}
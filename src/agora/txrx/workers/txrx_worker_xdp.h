@@ -0,0 +1,75 @@
+/**
+ * @file txrx_worker_xdp.h
+ * @brief txrx worker definition for AF_XDP sockets. The worker receives into
+ * a UMEM that the RX packets point into, so the FFT reads the samples where
+ * the NIC wrote them.
+ */
+
+#ifndef TXRX_WORKER_XDP_H_
+#define TXRX_WORKER_XDP_H_
+
+#include <xdp/xsk.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "concurrentqueue.h"
+#include "eth_common.h"
+#include "txrx_worker.h"
+
+class TxRxWorkerXdp : public TxRxWorker {
+ public:
+  TxRxWorkerXdp() = delete;
+  TxRxWorkerXdp(size_t core_offset, size_t tid, size_t interface_count,
+                size_t interface_offset, Config* const config,
+                size_t* rx_frame_start,
+                moodycamel::ConcurrentQueue<EventData>* event_notify_q,
+                moodycamel::ConcurrentQueue<EventData>* tx_pending_q,
+                moodycamel::ProducerToken& tx_producer,
+                moodycamel::ProducerToken& notify_producer,
+                std::vector<RxPacket>& rx_memory, std::byte* const tx_memory,
+                std::mutex& sync_mutex, std::condition_variable& sync_cond,
+                std::atomic<bool>& can_proceed, size_t queue_id);
+  ~TxRxWorkerXdp() final;
+  void DoTxRx() final;
+
+ private:
+  // A UMEM frame of the RX half, handed to an RxPacket as its external
+  // memory. It goes back to the fill ring once the packet is freed.
+  struct RxFrame {
+    TxRxWorkerXdp* worker_;
+    uint64_t addr_;
+  };
+
+  std::vector<Packet*> RecvEnqueue();
+  size_t DequeueSend();
+  // Post the frames of the freed RX packets to the fill ring
+  void RefillRx();
+  // Take back the TX frames that the NIC has sent
+  void CompleteTx();
+  // Returns true if the frame is not an uplink packet of this worker
+  bool Filter(const uint8_t* frame, size_t len);
+  static void ReleaseRxFrame(void* mem);
+
+  const size_t queue_id_;
+  uint8_t* umem_area_;
+  xsk_umem* umem_;
+  xsk_socket* xsk_;
+  xsk_ring_prod fill_;
+  xsk_ring_cons comp_;
+  xsk_ring_cons rx_;
+  xsk_ring_prod tx_;
+
+  uint32_t bs_rru_addr_;     // IPv4 address of the simulator sender
+  uint32_t bs_server_addr_;  // IPv4 address of the Agora server
+  std::vector<RxFrame> rx_frames_;
+  // Frames of the freed RX packets, enqueued by the workers that free them
+  moodycamel::ConcurrentQueue<uint64_t> free_rx_frames_;
+  std::vector<uint64_t> free_tx_frames_;
+  // Ethernet, IPv4 and UDP headers of the downlink packets of each interface
+  std::vector<std::array<uint8_t, kInetHdrsTotSize>> tx_headers_;
+  size_t rx_filtered_;
+};
+#endif  // TXRX_WORKER_XDP_H_
@@ -96,6 +96,11 @@ EventData DoDecodeClient::Launch(size_t tag) {
     scrambler_->Descramble(decoded_buffer_ptr,
                            cfg_->NumBytesPerCb(Direction::kDownlink));
   }
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kDecoded, frame_id)) {
+    taps_->Publish(TapPoint::kDecoded, frame_id, symbol_id, ue_id, cur_cb_id,
+                   decoded_buffer_ptr,
+                   cfg_->NumBytesPerCb(Direction::kDownlink));
+  }
 
   size_t start_tsc2 = GetTime::WorkerRdtsc();
   duration_stat_->task_duration_[2] += start_tsc2 - start_tsc1;
@@ -122,18 +127,12 @@ EventData DoDecodeClient::Launch(size_t tag) {
         ue_id, symbol_offset, frame_slot,
         cfg_->NumBytesPerCb(Direction::kDownlink) * 8);
     phy_stats_->IncrementDecodedBlocks(ue_id, symbol_offset, frame_slot);
-    size_t block_error(0);
-    for (size_t i = 0; i < cfg_->NumBytesPerCb(Direction::kDownlink); i++) {
-      uint8_t rx_byte = decoded_buffer_ptr[i];
-      auto tx_byte = static_cast<uint8_t>(
-          cfg_->GetInfoBits(cfg_->DlBits(), Direction::kDownlink, symbol_idx_dl,
-                            kDebugDownlink ? 0 : ue_id, cur_cb_id)[i]);
-      phy_stats_->UpdateBitErrors(ue_id, symbol_offset, frame_slot, tx_byte,
-                                  rx_byte);
-      if (rx_byte != tx_byte) {
-        block_error++;
-      }
-    }
+    const size_t block_error = phy_stats_->UpdateBitErrors(
+        ue_id, symbol_offset, frame_slot,
+        reinterpret_cast<const uint8_t*>(cfg_->GetInfoBits(
+            cfg_->DlBits(), Direction::kDownlink, symbol_idx_dl,
+            kDebugDownlink ? 0 : ue_id, cur_cb_id)),
+        decoded_buffer_ptr, cfg_->NumBytesPerCb(Direction::kDownlink));
     phy_stats_->UpdateBlockErrors(ue_id, symbol_offset, frame_slot,
                                   block_error);
   }
@@ -0,0 +1,269 @@
+/**
+ * @file dodecode_client_acc.cc
+ * @brief Implementation file for the DoDecodeClientAcc class.
+ */
+
+#ifdef USE_ACC100
+
+#include "dodecode_client_acc.h"
+
+#include <cstring>
+#include <string>
+
+#include "gettime.h"
+#include "logger.h"
+#include "message.h"
+#include "rte_malloc.h"
+#include "utils.h"
+
+static constexpr size_t kOpsCacheSize = 0;
+// Polls of the queue before giving up on the ops of a symbol
+static constexpr size_t kMaxDequeueTrials = 1000000;
+
+// The external buffers of the mbufs are freed by the decoder
+static void NoOpExtBufFree(void* /*addr*/, void* /*opaque*/) {}
+
+DoDecodeClientAcc::DoDecodeClientAcc(
+    Config* in_config, int in_tid,
+    PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
+    PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
+    MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* in_stats_manager)
+    : Doer(in_config, in_tid),
+      demod_buffers_(demod_buffers),
+      decoded_buffers_(decoded_buffers),
+      mac_sched_(mac_sched),
+      phy_stats_(in_phy_stats),
+      scrambler_(std::make_unique<AgoraScrambler::Scrambler>()) {
+  duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kDecode, in_tid);
+
+  // The EAL and the device are shared by the UE workers, each decoder owns
+  // the bbdev decode queue of its worker thread
+  Bbdev::SetupUe(cfg_);
+  dev_id_ = cfg_->UeBbdevDevId();
+  queue_ = Bbdev::DecodeQueue(dev_id_, tid_);
+  const Bbdev::Properties& props = Bbdev::Props(dev_id_);
+  llr_size_ = props.llr_size_;
+  llr_decimals_ = props.llr_decimals_;
+  struct rte_bbdev_info info;
+  rte_bbdev_info_get(dev_id_, &info);
+  const int socket_id = (info.socket_id == SOCKET_ID_ANY) ? 0 : info.socket_id;
+
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(Direction::kDownlink);
+  max_ops_ = ldpc_config.NumBlocksInSymbol();
+  ops_mp_ = rte_bbdev_op_pool_create(
+      ("ue_ldpc_dec_op_pool_" + std::to_string(dev_id_) + "_" +
+       std::to_string(tid_))
+          .c_str(),
+      RTE_BBDEV_OP_LDPC_DEC, Bbdev::OptimalMempoolSize(max_ops_),
+      kOpsCacheSize, socket_id);
+  RtAssert(ops_mp_ != nullptr, "ACC100: failed to create the decode op pool");
+  ops_.resize(max_ops_);
+  int ret = rte_bbdev_dec_op_alloc_bulk(ops_mp_, ops_.data(), ops_.size());
+  RtAssert(ret == 0, "ACC100: failed to allocate the decode ops");
+  for (auto* op : ops_) {
+    op->ldpc_dec.basegraph = static_cast<uint8_t>(ldpc_config.BaseGraph());
+    op->ldpc_dec.z_c = static_cast<uint16_t>(ldpc_config.ExpansionFactor());
+    op->ldpc_dec.n_filler = 0;
+    op->ldpc_dec.rv_index = 0;
+    op->ldpc_dec.n_cb = static_cast<uint16_t>(ldpc_config.NumCbCodewLen());
+    op->ldpc_dec.q_m =
+        static_cast<uint8_t>(cfg_->ModOrderBits(Direction::kDownlink));
+    op->ldpc_dec.code_block_mode = 1;
+    op->ldpc_dec.cb_params.e =
+        static_cast<uint32_t>(ldpc_config.NumCbCodewLen());
+    op->ldpc_dec.iter_max = static_cast<uint8_t>(ldpc_config.MaxDecoderIter());
+    op->ldpc_dec.op_flags = RTE_BBDEV_LDPC_ITERATION_STOP_ENABLE;
+  }
+
+  // The staging buffers are DPDK memory, so the device can reach them
+  // without registering them
+  llr_stride_ = Roundup<64>(ldpc_config.NumCbCodewLen());
+  output_stride_ = Roundup<64>(BitsToBytes(ldpc_config.NumCbLen()));
+  llr_staging_ = static_cast<int8_t*>(
+      rte_zmalloc_socket(nullptr, max_ops_ * llr_stride_, 64, socket_id));
+  output_staging_ = static_cast<uint8_t*>(
+      rte_zmalloc_socket(nullptr, max_ops_ * output_stride_, 64, socket_id));
+  RtAssert((llr_staging_ != nullptr) && (output_staging_ != nullptr),
+           "ACC100: failed to allocate the decode buffers");
+
+  ext_shinfo_.free_cb = NoOpExtBufFree;
+  ext_shinfo_.fcb_opaque = nullptr;
+  // Never drops to zero while the mbufs are attached
+  rte_mbuf_ext_refcnt_set(&ext_shinfo_, 2 * max_ops_);
+  in_mbufs_.resize(max_ops_);
+  out_mbufs_.resize(max_ops_);
+  struct rte_mempool* mbuf_pool = Bbdev::WorkerMbufPool(dev_id_, tid_);
+  ret = rte_pktmbuf_alloc_bulk(mbuf_pool, in_mbufs_.data(), in_mbufs_.size());
+  ret |=
+      rte_pktmbuf_alloc_bulk(mbuf_pool, out_mbufs_.data(), out_mbufs_.size());
+  RtAssert(ret == 0, "ACC100: failed to allocate the decode mbufs");
+  for (size_t slot = 0; slot < max_ops_; slot++) {
+    int8_t* llrs = llr_staging_ + (slot * llr_stride_);
+    uint8_t* output = output_staging_ + (slot * output_stride_);
+    rte_pktmbuf_attach_extbuf(in_mbufs_.at(slot), llrs,
+                              rte_malloc_virt2iova(llrs), llr_stride_,
+                              &ext_shinfo_);
+    rte_pktmbuf_attach_extbuf(out_mbufs_.at(slot), output,
+                              rte_malloc_virt2iova(output), output_stride_,
+                              &ext_shinfo_);
+  }
+  pending_.reserve(max_ops_);
+  AGORA_LOG_INFO("DoDecodeClientAcc[%d]: bbdev %u queue %u\n", tid_, dev_id_,
+                 queue_.Id());
+}
+
+DoDecodeClientAcc::~DoDecodeClientAcc() {
+  // Nothing is left in the card once the workers have stopped
+  rte_pktmbuf_free_bulk(in_mbufs_.data(), in_mbufs_.size());
+  rte_pktmbuf_free_bulk(out_mbufs_.data(), out_mbufs_.size());
+  rte_bbdev_dec_op_free_bulk(ops_.data(), ops_.size());
+  rte_mempool_free(ops_mp_);
+  rte_free(llr_staging_);
+  rte_free(output_staging_);
+}
+
+EventData DoDecodeClientAcc::Launch(size_t tag) {
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(Direction::kDownlink);
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+  const size_t cb_id = gen_tag_t(tag).cb_id_;
+  const size_t symbol_idx_dl = cfg_->Frame().GetDLSymbolIdx(symbol_id);
+  const size_t cur_cb_id = (cb_id % ldpc_config.NumBlocksInSymbol());
+  const size_t ue_id = (cb_id / ldpc_config.NumBlocksInSymbol());
+  const size_t frame_slot = (frame_id % kFrameWnd);
+
+  if (kDebugPrintInTask == true) {
+    AGORA_LOG_INFO(
+        "In doDecodeAcc thread %d: frame: %zu, symbol: %zu, code block: "
+        "%zu, ue: %zu\n",
+        tid_, frame_id, symbol_id, cur_cb_id, ue_id);
+  }
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+
+  // Stage the LLRs of the code block in the format of the card
+  const size_t slot = pending_.size();
+  RtAssert(slot < max_ops_, "DoDecodeClientAcc: too many code blocks");
+  const size_t num_llrs = ldpc_config.NumCbCodewLen();
+  const int8_t* llrs = demod_buffers_[frame_slot][symbol_idx_dl][ue_id] +
+                       (cfg_->ModOrderBits(Direction::kDownlink) *
+                        (ldpc_config.NumCbCodewLen() * cur_cb_id));
+  int8_t* staged_llrs = llr_staging_ + (slot * llr_stride_);
+  if ((llr_size_ == Bbdev::kAgoraLlrSize) &&
+      (llr_decimals_ == Bbdev::kAgoraLlrDecimals)) {
+    std::memcpy(staged_llrs, llrs, num_llrs);
+  } else {
+    for (size_t i = 0; i < num_llrs; i++) {
+      staged_llrs[i] = Bbdev::ScaleLlr(llrs[i], llr_size_, llr_decimals_);
+    }
+  }
+
+  struct rte_bbdev_dec_op* op = ops_.at(slot);
+  struct rte_mbuf* m_in = in_mbufs_.at(slot);
+  m_in->data_off = 0;
+  m_in->data_len = static_cast<uint16_t>(num_llrs);
+  m_in->pkt_len = static_cast<uint32_t>(num_llrs);
+  op->ldpc_dec.input.data = m_in;
+  op->ldpc_dec.input.offset = 0;
+  op->ldpc_dec.input.length = static_cast<uint32_t>(num_llrs);
+  // The driver appends the decoded bytes, so start from an empty mbuf
+  struct rte_mbuf* m_out = out_mbufs_.at(slot);
+  m_out->data_off = 0;
+  m_out->data_len = 0;
+  m_out->pkt_len = 0;
+  op->ldpc_dec.hard_output.data = m_out;
+  op->ldpc_dec.hard_output.offset = 0;
+  op->ldpc_dec.hard_output.length = 0;
+
+  while (queue_.Enqueue(&op, 1) == 0) {
+    // The queue is full of the ops of other symbols, which never happens
+    // with one symbol in flight
+  }
+  auto* decoded = reinterpret_cast<uint8_t*>(
+      decoded_buffers_[frame_slot][symbol_idx_dl][ue_id] +
+      (cur_cb_id * Roundup<64>(cfg_->NumBytesPerCb(Direction::kDownlink))));
+  pending_.push_back(PendingCb{tag, decoded});
+
+  const size_t enq_tsc = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[1] += enq_tsc - start_tsc;
+  // The caller launches the code blocks of a symbol in order
+  if (cur_cb_id == ldpc_config.NumBlocksInSymbol() - 1) {
+    Complete();
+  }
+  const size_t duration = GetTime::WorkerRdtsc() - start_tsc;
+  duration_stat_->task_duration_[0] += duration;
+  duration_stat_->task_count_++;
+  return EventData(EventType::kDecode, tag);
+}
+
+void DoDecodeClientAcc::Complete() {
+  const size_t start_tsc = GetTime::WorkerRdtsc();
+  // A queue returns its ops in order
+  std::vector<struct rte_bbdev_dec_op*> deq_ops(pending_.size());
+  size_t num_deq = 0;
+  for (size_t trial = 0;
+       (num_deq < pending_.size()) && (trial < kMaxDequeueTrials); trial++) {
+    num_deq +=
+        queue_.Dequeue(&deq_ops.at(num_deq), pending_.size() - num_deq);
+  }
+  const size_t deq_tsc = GetTime::WorkerRdtsc();
+  duration_stat_->task_duration_[2] += deq_tsc - start_tsc;
+  if (num_deq < pending_.size()) {
+    AGORA_LOG_ERROR("DoDecodeClientAcc[%d]: %zu of %zu ops not dequeued\n",
+                    tid_, pending_.size() - num_deq, pending_.size());
+    throw std::runtime_error("DoDecodeClientAcc: the card lost decode ops");
+  }
+  for (size_t slot = 0; slot < pending_.size(); slot++) {
+    FinishCb(pending_.at(slot), deq_ops.at(slot),
+             output_staging_ + (slot * output_stride_));
+  }
+  pending_.clear();
+  duration_stat_->task_duration_[3] += GetTime::WorkerRdtsc() - deq_tsc;
+}
+
+void DoDecodeClientAcc::FinishCb(const PendingCb& cb,
+                                 const struct rte_bbdev_dec_op* op,
+                                 const uint8_t* hard_output) {
+  const size_t frame_id = gen_tag_t(cb.tag_).frame_id_;
+  const size_t symbol_id = gen_tag_t(cb.tag_).symbol_id_;
+  const size_t cb_id = gen_tag_t(cb.tag_).cb_id_;
+  const LDPCconfig& ldpc_config = cfg_->LdpcConfig(Direction::kDownlink);
+  const size_t symbol_idx_dl = cfg_->Frame().GetDLSymbolIdx(symbol_id);
+  const size_t cur_cb_id = (cb_id % ldpc_config.NumBlocksInSymbol());
+  const size_t ue_id = (cb_id / ldpc_config.NumBlocksInSymbol());
+  const size_t frame_slot = (frame_id % kFrameWnd);
+  const size_t num_bytes_per_cb = cfg_->NumBytesPerCb(Direction::kDownlink);
+
+  if (op->status != 0) {
+    AGORA_LOG_WARN(
+        "DoDecodeClientAcc[%d]: frame %zu symbol %zu code block %zu failed "
+        "with status 0x%x\n",
+        tid_, frame_id, symbol_id, cb_id, op->status);
+  }
+  std::memcpy(cb.decoded_, hard_output, num_bytes_per_cb);
+  if (cfg_->ScrambleEnabled()) {
+    scrambler_->Descramble(cb.decoded_, num_bytes_per_cb);
+  }
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kDecoded, frame_id)) {
+    taps_->Publish(TapPoint::kDecoded, frame_id, symbol_id, ue_id, cur_cb_id,
+                   cb.decoded_, num_bytes_per_cb);
+  }
+
+  if ((kEnableMac == false) && (kPrintPhyStats == true) &&
+      (symbol_idx_dl >= cfg_->Frame().ClientDlPilotSymbols())) {
+    const size_t symbol_offset =
+        cfg_->GetTotalDataSymbolIdxDl(frame_id, symbol_idx_dl);
+    phy_stats_->UpdateDecodedBits(ue_id, symbol_offset, frame_slot,
+                                  num_bytes_per_cb * 8);
+    phy_stats_->IncrementDecodedBlocks(ue_id, symbol_offset, frame_slot);
+    const size_t block_error = phy_stats_->UpdateBitErrors(
+        ue_id, symbol_offset, frame_slot,
+        reinterpret_cast<const uint8_t*>(cfg_->GetInfoBits(
+            cfg_->DlBits(), Direction::kDownlink, symbol_idx_dl,
+            kDebugDownlink ? 0 : ue_id, cur_cb_id)),
+        cb.decoded_, num_bytes_per_cb);
+    phy_stats_->UpdateBlockErrors(ue_id, symbol_offset, frame_slot,
+                                  block_error);
+  }
+}
+
+#endif  // USE_ACC100
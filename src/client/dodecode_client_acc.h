@@ -0,0 +1,88 @@
+/**
+ * @file dodecode_client_acc.h
+ * @brief Declaration file for the DoDecodeClientAcc class, the downlink
+ * decoder of the UE emulator on a bbdev LDPC accelerator.
+ */
+
+#ifdef USE_ACC100
+
+#ifndef DODECODE_CLIENT_ACC_H_
+#define DODECODE_CLIENT_ACC_H_
+
+#include <memory>
+#include <vector>
+
+#include "bbdev_device.h"
+#include "config.h"
+#include "doer.h"
+#include "mac_scheduler.h"
+#include "memory_manage.h"
+#include "phy_stats.h"
+#include "rte_bbdev_op.h"
+#include "rte_mbuf.h"
+#include "scrambler.h"
+#include "stats.h"
+
+/**
+ * @brief DoDecodeClient on the card (Config::UeAccDecode()). Each worker
+ * owns a decode queue of Config::UeBbdevDevId().
+ *
+ * Launch() enqueues the op of a code block, and waits for the ops of the
+ * symbol once it gets its last code block, so that the card decodes the
+ * code blocks of a symbol together. The LLRs are staged in memory of the
+ * card's format, and the decoded bytes copied out of it.
+ */
+class DoDecodeClientAcc : public Doer {
+ public:
+  DoDecodeClientAcc(
+      Config* in_config, int in_tid,
+      PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
+      PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
+      MacScheduler* mac_sched, PhyStats* in_phy_stats, Stats* in_stats_manager);
+  ~DoDecodeClientAcc() override;
+
+  EventData Launch(size_t tag) override;
+
+ private:
+  // A code block in the card
+  struct PendingCb {
+    size_t tag_;
+    uint8_t* decoded_;
+  };
+
+  /// Wait for the ops in the card, and finish their code blocks
+  void Complete();
+  /// Copy out, descramble and count the errors of a decoded code block
+  void FinishCb(const PendingCb& cb, const struct rte_bbdev_dec_op* op,
+                const uint8_t* hard_output);
+
+  PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers_;
+  PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers_;
+  MacScheduler* mac_sched_;
+  PhyStats* phy_stats_;
+  DurationStat* duration_stat_;
+  std::unique_ptr<AgoraScrambler::Scrambler> scrambler_;
+
+  uint8_t dev_id_;
+  Bbdev::Queue queue_;
+  // LLR format of the card
+  int8_t llr_size_;
+  int8_t llr_decimals_;
+
+  // One op, and one slot of the staging memory, per code block of a symbol
+  size_t max_ops_;
+  size_t llr_stride_;
+  size_t output_stride_;
+  int8_t* llr_staging_;
+  uint8_t* output_staging_;
+  struct rte_mempool* ops_mp_;
+  std::vector<struct rte_bbdev_dec_op*> ops_;
+  std::vector<struct rte_mbuf*> in_mbufs_;
+  std::vector<struct rte_mbuf*> out_mbufs_;
+  struct rte_mbuf_ext_shared_info ext_shinfo_;
+  std::vector<PendingCb> pending_;
+};
+
+#endif  // DODECODE_CLIENT_ACC_H_
+
+#endif  // USE_ACC100
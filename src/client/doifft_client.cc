@@ -17,6 +17,8 @@ static constexpr bool kPrintIFFTOutput = false;
 static constexpr bool kPrintSocketOutput = false;
 static constexpr bool kUseOutOfPlaceIFFT = false;
 static constexpr bool kMemcpyBeforeIFFT = true;
+// Alignment of the output of SimdConvertFloatToShort
+static constexpr size_t kSimdAlignment = 64;
 
 DoIFFTClient::DoIFFTClient(Config* in_config, int in_tid,
                            Table<complex_float>& in_ifft_buffer,
@@ -25,12 +27,8 @@ DoIFFTClient::DoIFFTClient(Config* in_config, int in_tid,
       ifft_buffer_(in_ifft_buffer),
       socket_buffer_(in_socket_buffer) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kIFFT, in_tid);
-  DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  if (kUseOutOfPlaceIFFT) {
-    DftiSetValue(mkl_handle_, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
-  }
-  DftiCommitDescriptor(mkl_handle_);
+  ifft_plan_ =
+      FftBackend::CreatePlan(cfg_, cfg_->OfdmCaNum(), 1, kUseOutOfPlaceIFFT);
 
   // Aligned for SIMD
   ifft_out_ = static_cast<float*>(
@@ -40,12 +38,20 @@ DoIFFTClient::DoIFFTClient(Config* in_config, int in_tid,
   ifft_shift_tmp_ = static_cast<complex_float*>(
       Agora_memory::PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign64,
                                        2 * cfg_->OfdmCaNum() * sizeof(float)));
-  // ifft_scale_factor_ = cfg_->Scale();
-  ifft_scale_factor_ = cfg_->OfdmCaNum() / std::sqrt(cfg_->BfAntNum() * 1.f);
+  // The backward dft is not normalized, so scale down by OfdmCaNum() on top
+  // of Scale() to match the samples of CommsLib::IFFT and Ifft2tx
+  ifft_scale_factor_ = cfg_->OfdmCaNum() * cfg_->Scale();
+
+  const size_t first_sample_bytes =
+      Packet::kOffsetOfData + (cfg_->OfdmTxZeroPrefix() * 2 * sizeof(short));
+  simd_convert_ =
+      (((reinterpret_cast<intptr_t>(socket_buffer_) + first_sample_bytes) %
+        kSimdAlignment) == 0) &&
+      ((cfg_->PacketLength() % kSimdAlignment) == 0) &&
+      (((cfg_->CpLen() * 2 * sizeof(short)) % kSimdAlignment) == 0);
 }
 
 DoIFFTClient::~DoIFFTClient() {
-  DftiFreeDescriptor(&mkl_handle_);
   std::free(ifft_out_);
   std::free(ifft_shift_tmp_);
 }
@@ -84,15 +90,16 @@ EventData DoIFFTClient::Launch(size_t tag) {
   if (kMemcpyBeforeIFFT) {
     std::memcpy(ifft_out_ptr, ifft_in_ptr,
                 sizeof(float) * cfg_->OfdmCaNum() * 2);
-    DftiComputeBackward(mkl_handle_, ifft_out_ptr);
+    ifft_plan_->Backward(reinterpret_cast<complex_float*>(ifft_out_ptr));
   } else {
     if (kUseOutOfPlaceIFFT) {
       // Use out-of-place IFFT here is faster than in place IFFT
       // There is no need to reset non-data subcarriers in ifft input
       // to 0 since their values are not changed after IFFT
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr, ifft_out_ptr);
+      ifft_plan_->Backward(reinterpret_cast<complex_float*>(ifft_in_ptr),
+                           reinterpret_cast<complex_float*>(ifft_out_ptr));
     } else {
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr);
+      ifft_plan_->Backward(reinterpret_cast<complex_float*>(ifft_in_ptr));
     }
   }
 
@@ -116,9 +123,15 @@ EventData DoIFFTClient::Launch(size_t tag) {
   short* socket_ptr = &pkt->data_[2 * cfg_->OfdmTxZeroPrefix()];
 
   // IFFT scaled results by OfdmCaNum(), we scale down IFFT results
-  // during data type coversion
-  SimdConvertFloatToShort(ifft_out_ptr, socket_ptr, cfg_->OfdmCaNum() * 2,
-                          cfg_->CpLen() * 2, ifft_scale_factor_);
+  // during data type coversion. The simd conversion streams whole vectors,
+  // which the tx packets of most packet lengths do not align to.
+  if (simd_convert_) {
+    SimdConvertFloatToShort(ifft_out_ptr, socket_ptr, cfg_->OfdmCaNum() * 2,
+                            cfg_->CpLen() * 2, ifft_scale_factor_);
+  } else {
+    ConvertFloatToShort(ifft_out_ptr, socket_ptr, cfg_->OfdmCaNum() * 2,
+                        cfg_->CpLen() * 2, ifft_scale_factor_);
+  }
 
   duration_stat_->task_duration_[3] += GetTime::WorkerRdtsc() - start_tsc2;
 
@@ -5,11 +5,13 @@
 #ifndef DOIFFT_CLIENT_H_
 #define DOIFFT_CLIENT_H_
 
+#include <memory>
+
 #include "common_typedef_sdk.h"
 #include "config.h"
 #include "doer.h"
+#include "fft_backend.h"
 #include "memory_manage.h"
-#include "mkl_dfti.h"
 #include "stats.h"
 #include "symbols.h"
 
@@ -49,12 +51,14 @@ class DoIFFTClient : public Doer {
   Table<complex_float>& ifft_buffer_;
   char* socket_buffer_;
   DurationStat* duration_stat_;
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> ifft_plan_;
   // Buffer for IFFT output
   float* ifft_out_;
   // scratch buffer to reduce memory allocation
   complex_float* ifft_shift_tmp_;
   float ifft_scale_factor_;
+  // True if the tx packet samples are aligned for SimdConvertFloatToShort
+  bool simd_convert_;
 };
 
 #endif  // DOIFFT_CLIENT_H_
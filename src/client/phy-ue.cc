@@ -4,6 +4,7 @@
  */
 #include "phy-ue.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -55,6 +56,10 @@ PhyUe::PhyUe(Config* config)
   // TODO take into account the UeAntOffset to allow for multiple PhyUe
   // instances
   this->config_ = config;
+  // The client buffers always hold kFrameWnd frames, but the shared Config
+  // helpers index them with the configured frame window
+  RtAssert(config_->FrameWindow() == kFrameWnd,
+           "frame_window is not supported by the client");
   InitializeVarsFromCfg();
 
   for (size_t i = config_->OfdmDataStart();
@@ -127,13 +132,27 @@ PhyUe::PhyUe(Config* config)
         std::thread(&MacThreadClient::RunEventLoop, mac_thread_.get());
   }
 
+  std::array<size_t, kNumTapPoints> tap_bytes{};
+  tap_bytes.at(static_cast<size_t>(TapPoint::kFftIq)) =
+      config_->OfdmDataNum() * sizeof(complex_float);
+  tap_bytes.at(static_cast<size_t>(TapPoint::kCsi)) =
+      config_->OfdmDataNum() * sizeof(complex_float);
+  // The client computes no beams
+  tap_bytes.at(static_cast<size_t>(TapPoint::kEqual)) =
+      config_->GetOFDMDataNum() * sizeof(complex_float);
+  tap_bytes.at(static_cast<size_t>(TapPoint::kLlr)) =
+      config_->GetOFDMDataNum() * kMaxModType;
+  tap_bytes.at(static_cast<size_t>(TapPoint::kDecoded)) =
+      Roundup<64>(config_->NumBytesPerCb(Direction::kDownlink));
+  taps_ = std::make_unique<DataTaps>(config_, "user", tap_bytes);
+
   for (size_t i = 0; i < config_->UeWorkerThreadNum(); i++) {
     auto new_worker = std::make_unique<UeWorker>(
         i, *config_, *mac_sched_, *stats_, *phy_stats_, complete_queue_,
         work_queue_, *work_producer_token_.get(), ul_bits_buffer_,
         ul_syms_buffer_, modul_buffer_, ifft_buffer_, tx_buffer_, rx_buffer_,
         csi_buffer_, equal_buffer_, non_null_sc_ind_, fft_buffer_,
-        demod_buffer_, decoded_buffer_, ue_pilot_vec_);
+        demod_buffer_, decoded_buffer_, ue_pilot_vec_, taps_.get());
 
     new_worker->Start(core_offset_worker);
     workers_.push_back(std::move(new_worker));
@@ -175,20 +194,30 @@ PhyUe::PhyUe(Config* config)
     ue.tx_ready_frames_.clear();
   }
 
-  // This usage doesn't effect the user num_reciprocity_pkts_per_frame_;
-  rx_counters_.num_rx_pkts_per_frame_ =
+  // No reciprocity packets at the user
+  rx_counters_.Init(
+      config_->UeAntNum() * config_->Frame().ClientDlPilotSymbols(), 0,
       config_->UeAntNum() *
-      (config_->Frame().NumDLSyms() + config_->Frame().NumBeaconSyms());
-  rx_counters_.num_pilot_pkts_per_frame_ =
-      config_->UeAntNum() * config_->Frame().ClientDlPilotSymbols();
+          (config_->Frame().NumDLSyms() + config_->Frame().NumBeaconSyms()));
 
-  rx_downlink_deferral_.resize(kFrameWnd);
+  rx_downlink_deferral_.resize(
+      kFrameWnd, std::vector<std::queue<EventData>>(config_->UeAntNum()));
+  dl_pilot_ffts_.resize(kFrameWnd,
+                        std::vector<size_t>(config_->UeAntNum(), 0));
 
   // Mac counters for downlink data
   tomac_counters_.Init(config_->Frame().NumDlDataSyms(), config_->UeAntNum());
+
+  if (config_->UeTelemetryPort() != 0) {
+    telemetry_ = std::make_unique<TelemetryServer>(
+        "phy_ue", config_->TelemetryAddr(), config_->UeTelemetryPort(),
+        std::vector<std::string>{"complete", "work", "tx", "mac"},
+        config_->TelemetryIntervalMs(), config_->FreqGhz());
+  }
 }
 
 PhyUe::~PhyUe() {
+  telemetry_.reset();
   for (size_t i = 0; i < config_->UeWorkerThreadNum(); i++) {
     AGORA_LOG_INFO("Joining Phy worker: %zu : %zu\n", i,
                    config_->UeWorkerThreadNum());
@@ -242,40 +271,36 @@ void PhyUe::ScheduleWork(EventData do_task) {
 
 void PhyUe::ReceiveDownlinkSymbol(Packet* rx_packet, size_t tag) {
   const size_t frame_slot = rx_packet->frame_id_ % kFrameWnd;
+  const size_t ant_id = rx_packet->ant_id_;
   const size_t dl_symbol_idx =
       config_->Frame().GetDLSymbolIdx(rx_packet->symbol_id_);
 
-  // if symbol is a pilot or we are finished with all pilot ffts for the given
-  // frame
+  // if symbol is a pilot or we are finished with all pilot ffts of this UE
+  // antenna for the given frame
   if (dl_symbol_idx < config_->Frame().ClientDlPilotSymbols()) {
     ScheduleWork(EventData(EventType::kFFTPilot, tag));
-  } else if (fft_dlpilot_counters_.IsLastSymbol(rx_packet->frame_id_)) {
+  } else if (dl_pilot_ffts_.at(frame_slot).at(ant_id) ==
+             dl_pilot_symbol_perframe_) {
     ScheduleWork(EventData(EventType::kFFT, tag));
   } else {
     std::queue<EventData>* defferal_queue =
-        &rx_downlink_deferral_.at(frame_slot);
+        &rx_downlink_deferral_.at(frame_slot).at(ant_id);
 
     defferal_queue->push(EventData(EventType::kFFT, tag));
   }
 }
 
-void PhyUe::ScheduleDefferedDownlinkSymbols(size_t frame_id) {
+void PhyUe::ScheduleDefferedDownlinkSymbols(size_t frame_id, size_t ant_id) {
   const size_t frame_slot = frame_id % kFrameWnd;
   // Complete the csi offset
-  const size_t csi_offset_base = frame_slot * config_->UeAntNum();
-
-  for (size_t user = 0; user < config_->UeAntNum(); user++) {
-    const size_t csi_offset = csi_offset_base + user;
-
-    for (size_t ofdm_data = 0; ofdm_data < config_->OfdmDataNum();
-         ofdm_data++) {
-      auto* csi_buffer_ptr =
-          reinterpret_cast<arma::cx_float*>(csi_buffer_[csi_offset]);
-
-      csi_buffer_ptr[ofdm_data] /= dl_pilot_symbol_perframe_;
-    }
+  const size_t csi_offset = (frame_slot * config_->UeAntNum()) + ant_id;
+  auto* csi_buffer_ptr =
+      reinterpret_cast<arma::cx_float*>(csi_buffer_[csi_offset]);
+  for (size_t ofdm_data = 0; ofdm_data < config_->OfdmDataNum(); ofdm_data++) {
+    csi_buffer_ptr[ofdm_data] /= dl_pilot_symbol_perframe_;
   }
-  std::queue<EventData>* defferal_queue = &rx_downlink_deferral_.at(frame_slot);
+  std::queue<EventData>* defferal_queue =
+      &rx_downlink_deferral_.at(frame_slot).at(ant_id);
 
   while (!defferal_queue->empty()) {
     ScheduleWork(defferal_queue->front());
@@ -299,8 +324,13 @@ void PhyUe::ClearCsi(size_t frame_id) {
       }
     }
     fft_dlpilot_counters_.Reset(frame_id);
+    std::fill(dl_pilot_ffts_.at(frame_slot).begin(),
+              dl_pilot_ffts_.at(frame_slot).end(), 0);
   }  // Only do work if there are DL pilot symbols
-  assert(rx_downlink_deferral_.at(frame_slot).empty() == true);
+  for (const auto& defferal_queue : rx_downlink_deferral_.at(frame_slot)) {
+    assert(defferal_queue.empty() == true);
+    unused(defferal_queue);
+  }
 }
 
 void PhyUe::Stop() {
@@ -337,7 +367,6 @@ void PhyUe::Start() {
 
   std::array<EventData, kDequeueBulkSizeTXRX> events_list;
   size_t ret = 0;
-  max_equaled_frame_ = 0;
   size_t cur_frame_id = 0;
 
   while ((config_->Running() == true) &&
@@ -350,6 +379,9 @@ void PhyUe::Start() {
       total_count = 0;
       miss_count = 0;
     }
+    if ((telemetry_ != nullptr) && telemetry_->PublishDue()) {
+      PublishTelemetry(cur_frame_id);
+    }
     if (ret == 0) {
       miss_count++;
       continue;
@@ -371,7 +403,6 @@ void PhyUe::Start() {
           const size_t frame_id = pkt->frame_id_;
           const size_t symbol_id = pkt->symbol_id_;
           const size_t ant_id = pkt->ant_id_;
-          const size_t frame_slot = frame_id % kFrameWnd;
           RtAssert(pkt->frame_id_ < (cur_frame_id + kFrameWnd),
                    "Error: Received packet for future frame beyond frame "
                    "window. This can happen if PHY is running "
@@ -379,36 +410,29 @@ void PhyUe::Start() {
 
           PrintPerTaskDone(PrintType::kPacketRX, frame_id, symbol_id, ant_id);
 
-          if (rx_counters_.num_pkts_.at(frame_slot) == 0) {
+          const uint32_t events = rx_counters_.CountPacket(
+              frame_id, config_->IsDlPilot(frame_id, symbol_id)
+                            ? RxPacketKind::kPilot
+                            : RxPacketKind::kOther);
+          if ((events & kRxFirstPacket) != 0) {
             this->stats_->MasterSetTsc(TsType::kFirstSymbolRX, frame_id);
             if (kDebugPrintPerFrameStart) {
-              const size_t prev_frame_slot =
-                  (frame_slot + kFrameWnd - 1) % kFrameWnd;
               AGORA_LOG_INFO(
                   "PhyUe [frame %zu + %.2f ms since last frame]: Received "
                   "first packet. Remaining packets in prev frame: %zu\n",
                   frame_id,
                   this->stats_->MasterGetDeltaMs(TsType::kFirstSymbolRX,
                                                  frame_id, frame_id - 1),
-                  rx_counters_.num_pkts_.at(prev_frame_slot));
+                  rx_counters_.Packets(frame_id + kFrameWnd - 1));
             }
           }
-
-          if (config_->IsDlPilot(frame_id, symbol_id)) {
-            rx_counters_.num_pilot_pkts_.at(frame_slot)++;
-            if (rx_counters_.num_pilot_pkts_.at(frame_slot) ==
-                rx_counters_.num_pilot_pkts_per_frame_) {
-              rx_counters_.num_pilot_pkts_.at(frame_slot) = 0;
-              stats_->MasterSetTsc(TsType::kPilotAllRX, frame_id);
-              PrintPerFrameDone(PrintType::kPacketRXPilots, frame_id);
-            }
+          if ((events & kRxPilotsDone) != 0) {
+            stats_->MasterSetTsc(TsType::kPilotAllRX, frame_id);
+            PrintPerFrameDone(PrintType::kPacketRXPilots, frame_id);
           }
-          rx_counters_.num_pkts_.at(frame_slot)++;
-          if (rx_counters_.num_pkts_.at(frame_slot) ==
-              rx_counters_.num_rx_pkts_per_frame_) {
+          if ((events & kRxFrameDone) != 0) {
             stats_->MasterSetTsc(TsType::kRXDone, frame_id);
             PrintPerFrameDone(PrintType::kPacketRX, frame_id);
-            rx_counters_.num_pkts_.at(frame_slot) = 0;
           }
 
           // Schedule uplink pilots transmission and uplink processing
@@ -426,7 +450,9 @@ void PhyUe::Start() {
               // Schedule the Uplink tasks
               for (size_t symbol_idx = 0;
                    symbol_idx < config_->Frame().NumULSyms(); symbol_idx++) {
-                if (symbol_idx < config_->Frame().ClientUlPilotSymbols()) {
+                // The fused tx task encodes and modulates in the ifft task
+                if (config_->UeFusedUlTx() ||
+                    (symbol_idx < config_->Frame().ClientUlPilotSymbols())) {
                   EventData do_ifft_task(
                       EventType::kIFFT,
                       gen_tag_t::FrmSymUe(
@@ -463,6 +489,12 @@ void PhyUe::Start() {
           const size_t ant_id = gen_tag_t(event.tags_[0]).ant_id_;
 
           PrintPerTaskDone(PrintType::kFFTPilots, frame_id, symbol_id, ant_id);
+          size_t& ue_pilot_ffts =
+              dl_pilot_ffts_.at(frame_id % kFrameWnd).at(ant_id);
+          ue_pilot_ffts++;
+          if (ue_pilot_ffts == dl_pilot_symbol_perframe_) {
+            ScheduleDefferedDownlinkSymbols(frame_id, ant_id);
+          }
           const bool tasks_complete =
               fft_dlpilot_counters_.CompleteTask(frame_id, symbol_id);
           if (tasks_complete) {
@@ -482,7 +514,6 @@ void PhyUe::Start() {
 #endif
               this->stats_->MasterSetTsc(TsType::kFFTPilotsDone, frame_id);
               PrintPerFrameDone(PrintType::kFFTPilots, frame_id);
-              ScheduleDefferedDownlinkSymbols(frame_id);
             }
           }
         } break;
@@ -527,7 +558,6 @@ void PhyUe::Start() {
               demul_counters_.CompleteTask(frame_id, symbol_id);
           if (symbol_complete == true) {
             PrintPerSymbolDone(PrintType::kDemul, frame_id, symbol_id);
-            max_equaled_frame_ = frame_id;
             bool demul_complete = demul_counters_.CompleteSymbol(frame_id);
             if (demul_complete == true) {
               this->stats_->MasterSetTsc(TsType::kDemulDone, frame_id);
@@ -540,6 +570,7 @@ void PhyUe::Start() {
               this->phy_stats_->RecordEvm(frame_id, config_->LogScNum(),
                                           ue_map);
               this->phy_stats_->RecordEvmSnr(frame_id, ue_map);
+              this->phy_stats_->UpdateLatestSnr(frame_id, ue_map);
               this->phy_stats_->ClearEvmBuffer(frame_id);
 
               if (kDownlinkHardDemod) {
@@ -1232,19 +1263,6 @@ void PhyUe::PrintPerFrameDone(PrintType print_type, size_t frame_id) {
   }
 }
 
-void PhyUe::GetDemulData(long long** ptr, int* size) {
-  *ptr = (long long*)&equal_buffer_[max_equaled_frame_ *
-                                    dl_data_symbol_perframe_][0];
-  *size = config_->UeAntNum() * config_->GetOFDMDataNum();
-}
-
-void PhyUe::GetEqualData(float** ptr, int* size, int ue_id) {
-  *ptr = (float*)&equal_buffer_[max_equaled_frame_ * dl_data_symbol_perframe_ *
-                                    config_->UeAntNum() +
-                                ue_id][0];
-  *size = config_->UeAntNum() * config_->GetOFDMDataNum() * 2;
-}
-
 void PhyUe::FrameInit(size_t frame) {
   std::uint8_t initial =
       static_cast<std::uint8_t>(FrameTasksFlags::kNoWorkComplete);
@@ -1259,6 +1277,39 @@ void PhyUe::FrameInit(size_t frame) {
   frame_tasks_.at(frame % kFrameWnd) = initial;
 }
 
+void PhyUe::PublishTelemetry(size_t frames) {
+  TelemetrySnapshot& snapshot = telemetry_->Staging();
+  snapshot.frames_ = frames;
+  // Each frame carries the payload of every antenna of this client
+  snapshot.ul_bits_ = frames * config_->UeAntNum() *
+                      config_->MacDataBytesNumPerframe(Direction::kUplink) *
+                      8;
+  snapshot.dl_bits_ = frames * config_->UeAntNum() *
+                      config_->MacDataBytesNumPerframe(Direction::kDownlink) *
+                      8;
+  snapshot.dl_dropped_frames_ = 0;
+  snapshot.rx_dropped_packets_ = ru_->RxDropped();
+  snapshot.acc_ops_in_flight_ = 0;
+  snapshot.acc_decode_blocks_ = 0;
+  snapshot.acc_spilled_blocks_ = 0;
+  snapshot.queue_depths_ = {
+      complete_queue_.size_approx(), work_queue_.size_approx(),
+      tx_queue_.size_approx(), to_mac_queue_.size_approx()};
+  // The client does not keep latency histograms
+  snapshot.latency_frames_.fill(0);
+  snapshot.radio_timing_ = false;
+
+  snapshot.num_ues_ = config_->UeAntNum();
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    snapshot.snr_db_.at(i) = phy_stats_->LatestSnr(i);
+    snapshot.sinr_db_.at(i) = phy_stats_->LatestSinr(i);
+    snapshot.decode_iters_.at(i) = phy_stats_->MeanDecodeIterations(i);
+    phy_stats_->GetBlockCounts(i, &snapshot.decoded_blocks_.at(i),
+                               &snapshot.block_errors_.at(i));
+  }
+  telemetry_->Publish();
+}
+
 bool PhyUe::FrameComplete(size_t frame, FrameTasksFlags complete) {
   frame_tasks_.at(frame % kFrameWnd) |= static_cast<std::uint8_t>(complete);
   bool is_complete =
@@ -1277,10 +1328,4 @@ EXPORT void PhyUeStop(/*Phy_UE *usr*/) {
   SignalHandler::SetExitSignal(true); /*usr->stop();*/
 }
 EXPORT void PhyUeDestroy(PhyUe* usr) { delete usr; }
-EXPORT void PhyUeGetEqualData(PhyUe* usr, float** ptr, int* size, int ue) {
-  return usr->GetEqualData(ptr, size, ue);
-}
-EXPORT void PhyUeGetDemulData(PhyUe* usr, long long** ptr, int* size) {
-  return usr->GetDemulData(ptr, size);
-}
 }
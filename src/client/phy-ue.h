@@ -17,6 +17,7 @@
 #include "concurrent_queue_wrapper.h"
 #include "concurrentqueue.h"
 #include "config.h"
+#include "data_tap.h"
 #include "datatype_conversion.h"
 #include "mac_scheduler.h"
 #include "mac_thread_client.h"
@@ -25,8 +26,10 @@
 #include "packet_txrx.h"
 #include "phy_stats.h"
 #include "recorder_thread.h"
+#include "shared_counters.h"
 #include "simd_types.h"
 #include "stats.h"
+#include "telemetry.h"
 #include "ue_worker.h"
 
 class PhyUe {
@@ -45,9 +48,6 @@ class PhyUe {
   void Start();
   void Stop();
 
-  void GetEqualData(float** ptr, int* size, int /*ue_id*/);
-  void GetDemulData(long long** ptr, int* size);
-
  private:
   void PrintPerTaskDone(PrintType print_type, size_t frame_id, size_t symbol_id,
                         size_t ant);
@@ -56,13 +56,25 @@ class PhyUe {
   void PrintPerFrameDone(PrintType print_type, size_t frame_id);
 
   void ReceiveDownlinkSymbol(Packet* rx_packet, size_t tag);
-  void ScheduleDefferedDownlinkSymbols(size_t frame_id);
+  /// Schedule the downlink data symbols of ant_id that waited on its pilots
+  void ScheduleDefferedDownlinkSymbols(size_t frame_id, size_t ant_id);
   void ClearCsi(size_t frame_id);
-
-  std::vector<std::queue<EventData>> rx_downlink_deferral_;
+  /// Fill in and publish a telemetry snapshot, with the frames fully
+  /// processed so far
+  void PublishTelemetry(size_t frames);
+
+  // Downlink data symbols waiting on the pilots of their UE antenna, and the
+  // pilot FFTs completed per UE antenna, [frame slot][UE antenna]. Each UE
+  // proceeds on its own pilots, so a slow UE does not hold up the others.
+  std::vector<std::vector<std::queue<EventData>>> rx_downlink_deferral_;
+  std::vector<std::vector<size_t>> dl_pilot_ffts_;
   std::unique_ptr<MacScheduler> mac_sched_;
   std::unique_ptr<Stats> stats_;
   std::unique_ptr<PhyStats> phy_stats_;
+  // Live metrics over HTTP, if ue_telemetry_port is set
+  std::unique_ptr<TelemetryServer> telemetry_;
+  // Shared-memory taps of the downlink data, of Config::TapPoints()
+  std::unique_ptr<DataTaps> taps_;
   RxCounters rx_counters_;
 
   /*****************************************************
@@ -234,7 +246,6 @@ class PhyUe {
 
   FrameCounters tomac_counters_;
 
-  size_t max_equaled_frame_ = 0;
   std::vector<std::unique_ptr<Agora_recorder::RecorderThread>> recorders_;
 };
 #endif  // PHY_UE_H_
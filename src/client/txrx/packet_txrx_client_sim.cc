@@ -6,6 +6,9 @@
 
 #include "packet_txrx_client_sim.h"
 
+#if defined(USE_DPDK)
+#include "dpdk_comm.h"
+#endif
 #include "logger.h"
 #include "txrx_worker_client_sim.h"
 
@@ -19,9 +22,26 @@ PacketTxRxClientSim::PacketTxRxClientSim(
     : PacketTxRx(AgoraTxRx::TxRxTypes::kUserEquiptment, cfg, core_offset,
                  event_notify_q, tx_pending_q, notify_producer_tokens,
                  tx_producer_tokens, rx_buffer, packet_num_in_buffer,
-                 frame_start, tx_buffer) {}
+                 frame_start, tx_buffer) {
+#if defined(USE_DPDK)
+  if (cfg_->SimDpdk()) {
+    // One link per interface, on the first port
+    DpdkComm::InitPorts(cfg_, core_offset_ - 1, NumberTotalWorkers(),
+                        {NumberTotalInterfaces()});
+  }
+#endif
+}
 
-PacketTxRxClientSim::~PacketTxRxClientSim() = default;
+PacketTxRxClientSim::~PacketTxRxClientSim() {
+#if defined(USE_DPDK)
+  if (cfg_->SimDpdk()) {
+    // The links of the workers go before their ports
+    StopTxRx();
+    worker_threads_.clear();
+    DpdkComm::ClosePorts();
+  }
+#endif
+}
 
 bool PacketTxRxClientSim::CreateWorker(size_t tid, size_t interface_count,
                                        size_t interface_offset,
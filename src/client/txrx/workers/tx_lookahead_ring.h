@@ -0,0 +1,94 @@
+/**
+ * @file tx_lookahead_ring.h
+ * @brief Ring of the uplink frames that a client prepared ahead of their
+ * transmit time
+ */
+#ifndef TX_LOOKAHEAD_RING_H_
+#define TX_LOOKAHEAD_RING_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "symbols.h"
+
+class TxLookaheadRing {
+ public:
+  struct PreparedTx {
+    // Hardware time of the first tx symbol of the frame
+    long long tx_time_;
+    size_t frame_id_;
+    size_t radio_id_;
+    // kPacketTX, or kPacketPilotTX for a frame of pilots only
+    EventType event_type_;
+  };
+
+  ///\param num_slots - frames the ring holds at most
+  ///\param samples_per_frame - samples of one frame, the slot of a frame is
+  /// the hardware frame of its tx time
+  ///\param lead_samples - a frame is released to the radio once its tx time
+  /// is at most lead_samples after the radio time
+  ///\param late_guard_samples - a released frame is late if its tx time is
+  /// less than late_guard_samples after the radio time
+  TxLookaheadRing(size_t num_slots, size_t samples_per_frame,
+                  long long lead_samples, long long late_guard_samples)
+      : samples_per_frame_(static_cast<long long>(samples_per_frame)),
+        lead_samples_(lead_samples),
+        late_guard_samples_(late_guard_samples),
+        slots_(num_slots),
+        used_(num_slots, false) {}
+
+  /// Queue a prepared frame. Returns false if its slot still holds the frame
+  /// of an earlier pass around the ring.
+  bool Push(const PreparedTx& prepared) {
+    const size_t slot = Slot(prepared.tx_time_);
+    if (used_.at(slot)) {
+      return false;
+    }
+    slots_.at(slot) = prepared;
+    used_.at(slot) = true;
+    num_queued_++;
+    return true;
+  }
+
+  /// Pop the queued frame with the earliest tx time, if it is due for
+  /// release at the radio time now
+  bool PopReady(long long now, PreparedTx& prepared) {
+    size_t earliest = slots_.size();
+    for (size_t i = 0; i < slots_.size(); i++) {
+      if (used_.at(i) &&
+          ((earliest == slots_.size()) ||
+           (slots_.at(i).tx_time_ < slots_.at(earliest).tx_time_))) {
+        earliest = i;
+      }
+    }
+    if ((earliest == slots_.size()) ||
+        ((slots_.at(earliest).tx_time_ - now) > lead_samples_)) {
+      return false;
+    }
+    prepared = slots_.at(earliest);
+    used_.at(earliest) = false;
+    num_queued_--;
+    return true;
+  }
+
+  /// True if the radio can no longer send prepared in time
+  inline bool IsLate(const PreparedTx& prepared, long long now) const {
+    return (prepared.tx_time_ - now) < late_guard_samples_;
+  }
+
+  inline size_t NumQueued() const { return num_queued_; }
+
+ private:
+  inline size_t Slot(long long tx_time) const {
+    return static_cast<size_t>(tx_time / samples_per_frame_) % slots_.size();
+  }
+
+  const long long samples_per_frame_;
+  const long long lead_samples_;
+  const long long late_guard_samples_;
+  std::vector<PreparedTx> slots_;
+  std::vector<bool> used_;
+  size_t num_queued_ = 0;
+};
+
+#endif  // TX_LOOKAHEAD_RING_H_
@@ -10,9 +10,11 @@
 #include <memory>
 #include <vector>
 
+#include "beacon_correlator.h"
 #include "message.h"
 #include "radio_set.h"
 #include "rx_status_tracker.h"
+#include "tx_lookahead_ring.h"
 #include "txrx_worker.h"
 
 class TxRxWorkerClientHw : public TxRxWorker {
@@ -34,6 +36,14 @@ class TxRxWorkerClientHw : public TxRxWorker {
 
  private:
   size_t DoTx(const long long time0);
+  // Transmit the pilots, and the uplink symbols of a kPacketTX frame
+  void TxFrame(size_t radio_id, size_t frame_id, EventType event_type,
+               long long time0);
+  void NotifyTxComplete(size_t radio_id, size_t frame_id,
+                        EventType event_type);
+  // Transmit the frames of the lookahead ring that are due at the radio time
+  // now, and drop those that are late
+  size_t FlushTxRing(long long now, long long time0);
   std::vector<Packet*> DoRx(size_t interface_id, size_t& global_frame_id,
                             size_t& global_symbol_id, size_t& local_frame_id,
                             long long& receive_time, ssize_t& sample_offset);
@@ -41,6 +51,8 @@ class TxRxWorkerClientHw : public TxRxWorker {
   ssize_t SyncBeacon(size_t local_interface, size_t sample_window);
   ssize_t FindSyncBeacon(const std::complex<int16_t>* check_data,
                          size_t sample_window, float corr_scale);
+  void PrintBeaconSnr(const std::complex<int16_t>* check_data,
+                      ssize_t sync_index, size_t sample_window);
   void AdjustRx(size_t local_interface, size_t discard_samples);
   bool IsRxSymbol(size_t symbol_id);
   void TxUplinkSymbols(size_t radio_id, size_t frame_id, long long time0);
@@ -67,6 +79,9 @@ class TxRxWorkerClientHw : public TxRxWorker {
   std::vector<RxPacket> rx_frame_pkts_;
   std::vector<RxPacket*> rx_pkts_ptrs_;
 
+  // Beacon search over the samples of the sync detect channel
+  BeaconCorrelator beacon_correlator_;
+
   //Resync logic
   bool attempt_resync_ = false;
   size_t resync_success_cnt_ = 0;
@@ -74,5 +89,13 @@ class TxRxWorkerClientHw : public TxRxWorker {
 
   //For each interface.
   std::vector<TxRxWorkerRx::RxStatusTracker> rx_status_;
+
+  // Frames between the rx frame of a tx request and its tx frame
+  const size_t tx_frame_delta_;
+  // First pilot or uplink symbol of a frame
+  size_t first_tx_symbol_;
+  // Uplink frames prepared ahead of their tx time, with ue_tx_lookahead_frames
+  TxLookaheadRing tx_ring_;
+  size_t late_tx_frames_ = 0;
 };
 #endif  // TXRX_WORKER_CLIENT_HW_H_
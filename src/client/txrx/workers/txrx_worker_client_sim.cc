@@ -6,14 +6,22 @@
 
 #include "txrx_worker_client_sim.h"
 
+#include <array>
 #include <cassert>
+#include <utility>
 
+#if defined(USE_DPDK)
+#include "dpdk_comm.h"
+#endif
 #include "gettime.h"
 #include "logger.h"
 #include "message.h"
+#include "shm_comm.h"
 
 static constexpr bool kEnableSlowStart = true;
 static constexpr size_t kSocketRxBufferSize = (1024 * 1024 * 64 * 8) - 1;
+// Max packets per RecvBatch() call
+static constexpr size_t kRxBatchSize = 16;
 
 TxRxWorkerClientSim::TxRxWorkerClientSim(
     size_t core_offset, size_t tid, size_t interface_count,
@@ -39,9 +47,21 @@ TxRxWorkerClientSim::TxRxWorkerClientSim(
     const uint16_t rem_port_id =
         config->UeRruPort() + interface + interface_offset_;
 
-    udp_comm_.emplace_back(std::make_unique<UDPComm>(
-        config->UeServerAddr(), local_port_id, kSocketRxBufferSize, 0));
-    udp_comm_.back()->Connect(config->UeRruAddr(), rem_port_id);
+    std::unique_ptr<PacketComm> comm;
+#if defined(USE_DPDK)
+    // On the first port of PacketTxRxClientSim
+    if (config->SimDpdk()) {
+      comm = std::make_unique<DpdkComm>(0, config->UeServerAddr(),
+                                        local_port_id, config->UeRruAddr(),
+                                        rem_port_id);
+    }
+#endif
+    if (comm == nullptr) {
+      comm = CreateSimComm(config, config->UeServerAddr(), local_port_id,
+                           config->UeRruAddr(), rem_port_id,
+                           kSocketRxBufferSize);
+    }
+    udp_comm_.emplace_back(std::move(comm));
     AGORA_LOG_FRAME(
         "TxRxWorkerClientSim[%zu]: set up UDP socket server listening "
         "to %s:%d sending to %s:%d\n",
@@ -59,6 +79,11 @@ TxRxWorkerClientSim::TxRxWorkerClientSim(
                   config->PacketLength() - Packet::kOffsetOfData);
     }
   }
+
+  const size_t max_batch_size =
+      config->Frame().NumPilotSyms() + config->Frame().NumULSyms();
+  tx_batch_.reserve(max_batch_size);
+  tx_lens_.resize(max_batch_size, config->PacketLength());
 }
 
 TxRxWorkerClientSim::~TxRxWorkerClientSim() = default;
@@ -102,13 +127,36 @@ std::vector<Packet*> TxRxWorkerClientSim::RecvEnqueue(size_t interface_id) {
   std::vector<Packet*> rx_packets;
   const size_t packet_length = Configuration()->PacketLength();
 
-  RxPacket& rx_placement = GetRxPacket();
-  Packet* pkt = rx_placement.RawPacket();
+  // Take as many rx packets as the buffer has free in a row, at least one
+  std::array<RxPacket*, kRxBatchSize> rx_placements;
+  std::array<std::byte*, kRxBatchSize> bufs;
+  std::array<size_t, kRxBatchSize> rx_bytes;
+  size_t num_placements = 0;
+  do {
+    rx_placements.at(num_placements) = &GetRxPacket();
+    bufs.at(num_placements) = reinterpret_cast<std::byte*>(
+        rx_placements.at(num_placements)->RawPacket());
+    num_placements++;
+  } while ((num_placements < kRxBatchSize) && RxPacketAvailable());
+
+  const ssize_t num_rx = udp_comm_.at(interface_id)
+                             ->RecvBatch(bufs.data(), packet_length,
+                                         rx_bytes.data(), num_placements);
+  if (0 > num_rx) {
+    AGORA_LOG_ERROR("RecvEnqueue: Udp Recv failed with error\n");
+    throw std::runtime_error("TxRxWorkerClientSim: recv failed");
+  }
 
-  ssize_t rx_bytes =
-      udp_comm_.at(interface_id)
-          ->Recv(reinterpret_cast<std::byte*>(pkt), packet_length);
-  if (rx_bytes == static_cast<ssize_t>(packet_length)) {
+  for (ssize_t i = 0; i < num_rx; i++) {
+    if (rx_bytes.at(i) != packet_length) {
+      AGORA_LOG_ERROR(
+          "RecvEnqueue: Udp Recv failed to receive all expected bytes");
+      throw std::runtime_error(
+          "PacketTxRx::RecvEnqueue: Udp Recv failed to receive all expected "
+          "bytes");
+    }
+    RxPacket& rx_placement = *rx_placements.at(i);
+    Packet* pkt = rx_placement.RawPacket();
     if (kDebugPrintInTask) {
       AGORA_LOG_INFO(
           "TxRxWorkerClientSim[%zu]: Received frame %d, symbol %d, ant %d\n",
@@ -122,7 +170,8 @@ std::vector<Packet*> TxRxWorkerClientSim::RecvEnqueue(size_t interface_id) {
             "RecvEnqueue: Ctrl channel frame_id mismatch error (%zu/%zu)!\n",
             ctrl_frame_id, pkt->frame_id_);
       }
-      ReturnRxPacket(rx_placement);
+      // Not the last packet taken, so free it in place instead of returning
+      rx_placement.Free();
     } else {
       // Push kPacketRX event into the queue.
       const EventData rx_message(EventType::kPacketRX,
@@ -130,18 +179,11 @@ std::vector<Packet*> TxRxWorkerClientSim::RecvEnqueue(size_t interface_id) {
       NotifyComplete(rx_message);
       rx_packets.push_back(pkt);
     }
-  } else if (0 > rx_bytes) {
-    AGORA_LOG_ERROR("RecvEnqueue: Udp Recv failed with error\n");
-    throw std::runtime_error("TxRxWorkerClientSim: recv failed");
-  } else if (0 != rx_bytes) {
-    AGORA_LOG_ERROR(
-        "RecvEnqueue: Udp Recv failed to receive all expected bytes");
-    throw std::runtime_error(
-        "PacketTxRx::RecvEnqueue: Udp Recv failed to receive all expected "
-        "bytes");
-  } else {
-    // Received 0 bytes.  Time to recycle the buffer
-    ReturnRxPacket(rx_placement);
+  }
+
+  // Recycle the unused buffers, newest first
+  for (size_t i = num_placements; i > static_cast<size_t>(num_rx); i--) {
+    ReturnRxPacket(*rx_placements.at(i - 1));
   }
   return rx_packets;
 }
@@ -180,9 +222,7 @@ size_t TxRxWorkerClientSim::DequeueSend() {
       //Fill out the frame / symbol / cell / ant
       new (tx_packet) Packet(frame_id, symbol_id, 0 /* cell_id */, ue_ant);
 
-      udp_comm_.at(local_interface)
-          ->Send(reinterpret_cast<std::byte*>(tx_packet),
-                 Configuration()->PacketLength());
+      tx_batch_.push_back(reinterpret_cast<std::byte*>(tx_packet));
     }
     if (kDebugPrintInTask) {
       AGORA_LOG_INFO(
@@ -206,13 +246,15 @@ size_t TxRxWorkerClientSim::DequeueSend() {
         auto* tx_packet = GetUlTxPacket(frame_id, symbol_id, ue_ant);
         new (tx_packet) Packet(frame_id, symbol_id, 0 /* cell_id */, ue_ant);
 
-        // Send data (one OFDM symbol)
-        udp_comm_.at(local_interface)
-            ->Send(reinterpret_cast<std::byte*>(tx_packet),
-                   Configuration()->PacketLength());
+        tx_batch_.push_back(reinterpret_cast<std::byte*>(tx_packet));
       }
     }  // event.event_type_ == EventType::kPacketTX
 
+    // Send the pilots, then the data (one OFDM symbol per packet)
+    udp_comm_.at(local_interface)
+        ->SendBatch(tx_batch_.data(), tx_lens_.data(), tx_batch_.size());
+    tx_batch_.clear();
+
     EventData complete_event;
     if (current_event.event_type_ == EventType::kPacketPilotTX) {
       complete_event =
@@ -10,8 +10,8 @@
 #include <vector>
 
 #include "message.h"
+#include "packet_comm.h"
 #include "txrx_worker.h"
-#include "udp_comm.h"
 
 class TxRxWorkerClientSim : public TxRxWorker {
  public:
@@ -36,9 +36,12 @@ class TxRxWorkerClientSim : public TxRxWorker {
   std::vector<Packet*> RecvEnqueue(size_t interface_id);
 
   //1 for each responsible interface (ie radio)
-  std::vector<std::unique_ptr<UDPComm>> udp_comm_;
+  std::vector<std::unique_ptr<PacketComm>> udp_comm_;
 
   //Helper tx vectors
   std::vector<std::vector<std::vector<uint8_t>>> tx_pkt_pilot_;
+  // Pilot and uplink packets of one tx event, and their lengths
+  std::vector<const std::byte*> tx_batch_;
+  std::vector<size_t> tx_lens_;
 };
 #endif  // TXRX_WORKER_CLIENT_SIM_H_
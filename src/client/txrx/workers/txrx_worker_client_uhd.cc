@@ -6,6 +6,7 @@
 
 #include "txrx_worker_client_uhd.h"
 
+#include <algorithm>
 #include <cassert>
 #include <complex>
 
@@ -60,7 +61,16 @@ TxRxWorkerClientUhd::TxRxWorkerClientUhd(
                   (config->SampsPerSymbol() * config->Frame().NumTotalSyms()),
               std::complex<int16_t>(0, 0))),
       rx_frame_pkts_(config->NumUeChannels()),
-      rx_pkts_ptrs_(config->NumUeChannels()) {
+      rx_pkts_ptrs_(config->NumUeChannels()),
+      beacon_correlator_(
+          config->GoldCf32(),
+          config->SampsPerSymbol() * config->Frame().NumTotalSyms()),
+      tx_frame_delta_(TX_FRAME_DELTA + config->UeTxLookaheadFrames()),
+      first_tx_symbol_(config->Frame().NumTotalSyms()),
+      tx_ring_(kFrameWnd, config->SampsPerFrame(),
+               static_cast<long long>(TX_FRAME_DELTA *
+                                      config->SampsPerFrame()),
+               static_cast<long long>(config->SampsPerSymbol())) {
   for (size_t ch = 0; ch < config->NumUeChannels(); ch++) {
     auto* pkt_memory = reinterpret_cast<Packet*>(frame_storage_.at(ch).data());
     auto& scratch_rx_memory = rx_frame_pkts_.at(ch);
@@ -78,6 +88,13 @@ TxRxWorkerClientUhd::TxRxWorkerClientUhd(
            "Interface count must be set to 1 for use with this class");
 
   RtAssert(config->UeHwFramer() == false, "Must have ue hw framer disabled");
+  if (config->Frame().NumPilotSyms() > 0) {
+    first_tx_symbol_ = config->Frame().GetPilotSymbol(0);
+  }
+  if (config->Frame().NumULSyms() > 0) {
+    first_tx_symbol_ =
+        std::min(first_tx_symbol_, config->Frame().GetULSymbol(0));
+  }
   InitRxStatus();
 }
 
@@ -193,6 +210,9 @@ void TxRxWorkerClientUhd::DoTxRx() {
         // std::cout<<"DoTx called"<<std::endl;
         tx_status = DoTx(time0);
         doResync = false;
+        if (tx_ring_.NumQueued() > 0) {
+          tx_status += FlushTxRing(rx_time_ue_, time0);
+        }
       }
     }
     if (tx_status == 0) {
@@ -339,6 +359,12 @@ void TxRxWorkerClientUhd::DoTxRx() {
   if (tx_thread.joinable()) {
     tx_thread.join();
   }
+  if (Configuration()->UeTxLookaheadFrames() > 0) {
+    AGORA_LOG_INFO(
+        "TxRxWorkerClientUhd[%zu]: %zu uplink frames missed their tx time, "
+        "%zu still queued\n",
+        tid_, late_tx_frames_, tx_ring_.NumQueued());
+  }
 }
 
 //RX data, should return channel number of packets || 0
@@ -438,7 +464,10 @@ size_t TxRxWorkerClientUhd::DoTxThread(long long time0) {
 
   //Making GetPendingTxEvents / DoTx event based / sleep wakeup would be preferrable here
   while (Configuration()->Running()) {
-    const auto tx_status = DoTx(time0);
+    auto tx_status = DoTx(time0);
+    if (tx_ring_.NumQueued() > 0) {
+      tx_status += FlushTxRing(rx_time_ue_, time0);
+    }
     if (tx_status == 0) {
       //Sleep or yield here.
       //std::this_thread::yield();
@@ -494,43 +523,83 @@ size_t TxRxWorkerClientUhd::DoTx(long long time0) {
     }
 
     if ((ant_offset + 1) == channels_per_interface_) {
-      // Transmit pilot(s)
-      for (size_t ch = 0; ch < channels_per_interface_; ch++) {
-        const size_t pilot_ant = (interface_id * channels_per_interface_) + ch;
-        //Each pilot will be in a different tx slot (called for each pilot)
-        TxPilot(pilot_ant, frame_id, time0);
-
-        //Pilot transmit complete for pilot ue
-        if (current_event.event_type_ == EventType::kPacketPilotTX) {
-          auto complete_event =
-              EventData(EventType::kPacketPilotTX,
-                        gen_tag_t::FrmSymUe(frame_id, 0, pilot_ant).tag_);
-          NotifyComplete(complete_event);
+      if (Configuration()->UeTxLookaheadFrames() > 0) {
+        const size_t tx_offset =
+            ((frame_id + tx_frame_delta_) * Configuration()->SampsPerFrame()) +
+            (first_tx_symbol_ * Configuration()->SampsPerSymbol());
+        const TxLookaheadRing::PreparedTx prepared = {
+            time0 + static_cast<long long>(tx_offset) -
+                Configuration()->ClTxAdvance().at(interface_id),
+            frame_id, interface_id, current_event.event_type_};
+        if (tx_ring_.Push(prepared) == false) {
+          AGORA_LOG_WARN(
+              "TxRxWorkerClientUhd::DoTx[%zu]: Tx ring slot of frame %zu is "
+              "taken, transmitting it now\n",
+              tid_, frame_id);
+          TxFrame(interface_id, frame_id, current_event.event_type_, time0);
         }
-      }  //For each channel
-
-      if (current_event.event_type_ == EventType::kPacketTX) {
-        // Transmit data for all symbols (each cannel transmits for each symbol)
-        TxUplinkSymbols(interface_id, frame_id, time0);
-        //Notify the tx is complete for all antennas on the interface
-        for (size_t ch = 0; ch < channels_per_interface_; ch++) {
-          const size_t tx_ant = (interface_id * channels_per_interface_) + ch;
-          //Frame transmit complete
-          auto complete_event =
-              EventData(EventType::kPacketTX,
-                        gen_tag_t::FrmSymUe(frame_id, 0, tx_ant).tag_);
-          NotifyComplete(complete_event);
-        }
-        AGORA_LOG_TRACE(
-            "TxRxWorkerClientUhd::DoTx[%zu]: Frame %zu Transmit Complete for "
-            "Ue %zu\n",
-            tid_, frame_id, interface_id);
+      } else {
+        TxFrame(interface_id, frame_id, current_event.event_type_, time0);
       }
     }
   }  // End all events
   return tx_events.size();
 }
 
+void TxRxWorkerClientUhd::TxFrame(size_t interface_id, size_t frame_id,
+                                  EventType event_type, long long time0) {
+  // Transmit pilot(s)
+  for (size_t ch = 0; ch < channels_per_interface_; ch++) {
+    const size_t pilot_ant = (interface_id * channels_per_interface_) + ch;
+    //Each pilot will be in a different tx slot (called for each pilot)
+    TxPilot(pilot_ant, frame_id, time0);
+  }
+
+  if (event_type == EventType::kPacketTX) {
+    // Transmit data for all symbols (each cannel transmits for each symbol)
+    TxUplinkSymbols(interface_id, frame_id, time0);
+    AGORA_LOG_TRACE(
+        "TxRxWorkerClientUhd::DoTx[%zu]: Frame %zu Transmit Complete for "
+        "Ue %zu\n",
+        tid_, frame_id, interface_id);
+  }
+  NotifyTxComplete(interface_id, frame_id, event_type);
+}
+
+//Notify the tx is complete for all antennas on the interface
+void TxRxWorkerClientUhd::NotifyTxComplete(size_t interface_id,
+                                           size_t frame_id,
+                                           EventType event_type) {
+  for (size_t ch = 0; ch < channels_per_interface_; ch++) {
+    const size_t tx_ant = (interface_id * channels_per_interface_) + ch;
+    auto complete_event =
+        EventData(event_type, gen_tag_t::FrmSymUe(frame_id, 0, tx_ant).tag_);
+    NotifyComplete(complete_event);
+  }
+}
+
+size_t TxRxWorkerClientUhd::FlushTxRing(long long now, long long time0) {
+  size_t num_flushed = 0;
+  TxLookaheadRing::PreparedTx prepared;
+  while (tx_ring_.PopReady(now, prepared)) {
+    if (tx_ring_.IsLate(prepared, now)) {
+      // Sending it would underflow the radio, complete it without sending
+      late_tx_frames_++;
+      AGORA_LOG_WARN(
+          "TxRxWorkerClientUhd[%zu]: Frame %zu missed its tx time %lld at "
+          "radio time %lld, dropped\n",
+          tid_, prepared.frame_id_, prepared.tx_time_, now);
+      NotifyTxComplete(prepared.radio_id_, prepared.frame_id_,
+                       prepared.event_type_);
+    } else {
+      TxFrame(prepared.radio_id_, prepared.frame_id_, prepared.event_type_,
+              time0);
+    }
+    num_flushed++;
+  }
+  return num_flushed;
+}
+
 ///\todo for the multi radio case should let this return if not enough data is found
 /// This function blocks untill all the discard_samples are received for a given local_interface
 void TxRxWorkerClientUhd::AdjustRx(size_t local_interface,
@@ -579,6 +648,13 @@ ssize_t TxRxWorkerClientUhd::SyncBeacon(size_t local_interface,
   size_t request_samples = sample_window;
   TxRxWorkerRx::RxStatusTracker rx_tracker(channels_per_interface_);
   rx_tracker.Reset(rx_pkts_ptrs_);
+  const float corr_scale = Configuration()->ClCorrScale().at(tid_);
+  const auto* window_start = reinterpret_cast<const std::complex<int16_t>*>(
+      rx_pkts_ptrs_.at(kSyncDetectChannel)->RawPacket()->data_);
+  // The samples are correlated as they arrive, the beacon is checked once
+  // the window is full
+  ssize_t window_peak = -1;
+  beacon_correlator_.Reset();
 
   while (Configuration()->Running() && (sync_index < 0)) {
     auto rx_locations = rx_tracker.GetRxPtrs();
@@ -599,7 +675,20 @@ ssize_t TxRxWorkerClientUhd::SyncBeacon(size_t local_interface,
             new_samples, rx_tracker.SamplesAvailable(), sample_window);
         //Samples do not align, throw out all old + new samples.
         rx_tracker.DiscardOld(new_samples, rx_time);
+        beacon_correlator_.Reset();
+        window_peak = beacon_correlator_.Process(window_start, new_samples,
+                                                 corr_scale);
       } else {
+        if (new_samples <= request_samples) {
+          const ssize_t peak = beacon_correlator_.Process(
+              reinterpret_cast<const std::complex<int16_t>*>(
+                  rx_locations.at(kSyncDetectChannel)),
+              new_samples, corr_scale);
+          if (peak >= 0) {
+            window_peak =
+                static_cast<ssize_t>(rx_tracker.SamplesAvailable()) + peak;
+          }
+        }
         rx_tracker.Update(new_samples, rx_time);
         if (new_samples == request_samples) {
           AGORA_LOG_TRACE(
@@ -608,11 +697,15 @@ ssize_t TxRxWorkerClientUhd::SyncBeacon(size_t local_interface,
               reinterpret_cast<intptr_t>(
                   rx_pkts_ptrs_.at(kSyncDetectChannel)->RawPacket()->data_));
 
-          sync_index = FindSyncBeacon(
-              reinterpret_cast<std::complex<int16_t>*>(
-                  rx_pkts_ptrs_.at(kSyncDetectChannel)->RawPacket()->data_),
-              sample_window, Configuration()->ClCorrScale().at(tid_));
+          // The beacon may have started in the previous window, which is
+          // gone, so it must end past its length in this one
+          if (window_peak >=
+              static_cast<ssize_t>(Configuration()->BeaconLen())) {
+            sync_index = window_peak;
+            PrintBeaconSnr(window_start, sync_index, sample_window);
+          }
           //Throw out samples until we detect the beacon
+          window_peak = -1;
           request_samples = sample_window;
           rx_tracker.Reset(rx_pkts_ptrs_);
         } else if (new_samples < request_samples) {
@@ -639,10 +732,19 @@ ssize_t TxRxWorkerClientUhd::FindSyncBeacon(
   assert(sample_window <= (Configuration()->SampsPerSymbol() *
                            Configuration()->Frame().NumTotalSyms()));
 
-  sync_index = CommsLib::FindBeaconAvx(check_data, Configuration()->GoldCf32(),
-                                       sample_window, corr_scale);
+  // A window on its own, not the continuation of the previous one
+  beacon_correlator_.Reset();
+  sync_index =
+      beacon_correlator_.Process(check_data, sample_window, corr_scale);
+  PrintBeaconSnr(check_data, sync_index, sample_window);
+  return sync_index;
+}
 
-  if (kPrintClientBeaconSNR && (sync_index >= 0) &&
+void TxRxWorkerClientUhd::PrintBeaconSnr(
+    const std::complex<int16_t>* check_data, ssize_t sync_index,
+    size_t sample_window) {
+  if (kPrintClientBeaconSNR &&
+      (sync_index >= static_cast<ssize_t>(Configuration()->BeaconLen())) &&
       ((sync_index + Configuration()->BeaconLen()) < sample_window)) {
     ///\todo Remove this float conversion to speed up function
     float sig_power = 0;
@@ -666,7 +768,6 @@ ssize_t TxRxWorkerClientUhd::FindSyncBeacon(
     AGORA_LOG_INFO("TxRxWorkerClientUhd: Sync Beacon - SNR %2.1f dB\n",
                    +10 * std::log10(sig_power / noise_power));
   }
-  return sync_index;
 }
 
 bool TxRxWorkerClientUhd::IsRxSymbol(size_t symbol_id) {
@@ -685,7 +786,7 @@ bool TxRxWorkerClientUhd::IsRxSymbol(size_t symbol_id) {
 // All UL symbols
 void TxRxWorkerClientUhd::TxUplinkSymbols(size_t radio_id, size_t frame_id,
                                           long long time0) {
-  const size_t tx_frame_id = frame_id + TX_FRAME_DELTA;
+  const size_t tx_frame_id = frame_id + tx_frame_delta_;
   const size_t samples_per_symbol = Configuration()->SampsPerSymbol();
   const size_t samples_per_frame =
       samples_per_symbol * Configuration()->Frame().NumTotalSyms();
@@ -769,7 +870,7 @@ void TxRxWorkerClientUhd::TxUplinkSymbols(size_t radio_id, size_t frame_id,
 
 void TxRxWorkerClientUhd::TxPilot(size_t pilot_ant, size_t frame_id,
                                   long long time0) {
-  const size_t tx_frame_id = frame_id + TX_FRAME_DELTA;
+  const size_t tx_frame_id = frame_id + tx_frame_delta_;
   const size_t pilot_channel = (pilot_ant % channels_per_interface_);
   const size_t radio = pilot_ant / channels_per_interface_;
   const size_t samples_per_symbol = Configuration()->SampsPerSymbol();
@@ -11,9 +11,11 @@
 #include <memory>
 #include <vector>
 
+#include "beacon_correlator.h"
 #include "message.h"
 #include "radio_set.h"
 #include "rx_status_tracker.h"
+#include "tx_lookahead_ring.h"
 #include "txrx_worker.h"
 
 class TxRxWorkerClientUhd : public TxRxWorker {
@@ -36,12 +38,22 @@ class TxRxWorkerClientUhd : public TxRxWorker {
  private:
   size_t DoTxThread(long long time0);
   size_t DoTx(long long time0);
+  // Transmit the pilots, and the uplink symbols of a kPacketTX frame
+  void TxFrame(size_t interface_id, size_t frame_id, EventType event_type,
+               long long time0);
+  void NotifyTxComplete(size_t interface_id, size_t frame_id,
+                        EventType event_type);
+  // Transmit the frames of the lookahead ring that are due at the radio time
+  // now, and drop those that are late
+  size_t FlushTxRing(long long now, long long time0);
   std::vector<Packet*> DoRx(size_t interface_id, size_t frame_id,
                             size_t symbol_id, long long& receive_time);
 
   ssize_t SyncBeacon(size_t local_interface, size_t sample_window);
   ssize_t FindSyncBeacon(const std::complex<int16_t>* check_data,
                          size_t sample_window, float corr_scale);
+  void PrintBeaconSnr(const std::complex<int16_t>* check_data,
+                      ssize_t sync_index, size_t sample_window);
   void AdjustRx(size_t local_interface, size_t discard_samples);
   bool IsRxSymbol(size_t symbol_id);
   void TxUplinkSymbols(size_t radio_id, size_t frame_id, long long time0);
@@ -61,10 +73,21 @@ class TxRxWorkerClientUhd : public TxRxWorker {
   std::vector<RxPacket> rx_frame_pkts_;
   std::vector<RxPacket*> rx_pkts_ptrs_;
 
+  // Beacon search over the samples of the sync detect channel
+  BeaconCorrelator beacon_correlator_;
+
   //For each interface.
   std::vector<TxRxWorkerRx::RxStatusTracker> rx_status_;
   bool doResync;
   long long adjust_Tx;
   size_t num_ue_stream;
+
+  // Frames between the rx frame of a tx request and its tx frame
+  const size_t tx_frame_delta_;
+  // First pilot or uplink symbol of a frame
+  size_t first_tx_symbol_;
+  // Uplink frames prepared ahead of their tx time, with ue_tx_lookahead_frames
+  TxLookaheadRing tx_ring_;
+  size_t late_tx_frames_ = 0;
 };
 #endif  // TXRX_WORKER_CLIENT_UHD_H_
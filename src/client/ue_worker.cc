@@ -42,7 +42,8 @@ UeWorker::UeWorker(
     std::vector<size_t>& non_null_sc_ind, Table<complex_float>& fft_buffer,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffer,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffer,
-    std::vector<std::vector<std::complex<float>>>& ue_pilot_vec)
+    std::vector<std::vector<std::complex<float>>>& ue_pilot_vec,
+    DataTaps* taps)
     : tid_(tid),
       notify_queue_(notify_queue),
       work_queue_(work_queue),
@@ -63,20 +64,21 @@ UeWorker::UeWorker(
       fft_buffer_(fft_buffer),
       demod_buffer_(demod_buffer),
       decoded_buffer_(decoded_buffer),
-      ue_pilot_vec_(ue_pilot_vec) {
+      ue_pilot_vec_(ue_pilot_vec),
+      taps_(taps) {
   ptok_ = std::make_unique<moodycamel::ProducerToken>(notify_queue);
 
   AllocBuffer1d(&rx_samps_tmp_, config_.SampsPerSymbol(),
                 Agora_memory::Alignment_t::kAlign64, 1);
+  AllocBuffer1d(&equal_tmp_, config_.OfdmDataNum(),
+                Agora_memory::Alignment_t::kAlign64, 1);
 
-  (void)DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                             config_.OfdmCaNum());
-  (void)DftiCommitDescriptor(mkl_handle_);
+  fft_plan_ = FftBackend::CreatePlan(&config_, config_.OfdmCaNum());
 }
 
 UeWorker::~UeWorker() {
-  DftiFreeDescriptor(&mkl_handle_);
   FreeBuffer1d(&rx_samps_tmp_);
+  FreeBuffer1d(&equal_tmp_);
   AGORA_LOG_INFO("UeWorker[%zu] Terminated\n", tid_);
 }
 
@@ -107,9 +109,20 @@ void UeWorker::TaskThread(size_t core_offset) {
   auto iffter = std::make_unique<DoIFFTClient>(
       &config_, (int)tid_, ifft_buffer_, tx_buffer_, &stats_);
 
-  auto decoder = std::make_unique<DoDecodeClient>(
-      &config_, (int)tid_, demod_buffer_, decoded_buffer_, &mac_sched_,
-      &phy_stats_, &stats_);
+  std::unique_ptr<Doer> decoder;
+#if defined(USE_ACC100)
+  if (config_.UeAccDecode()) {
+    decoder = std::make_unique<DoDecodeClientAcc>(
+        &config_, (int)tid_, demod_buffer_, decoded_buffer_, &mac_sched_,
+        &phy_stats_, &stats_);
+  }
+#endif
+  if (decoder == nullptr) {
+    decoder = std::make_unique<DoDecodeClient>(
+        &config_, (int)tid_, demod_buffer_, decoded_buffer_, &mac_sched_,
+        &phy_stats_, &stats_);
+  }
+  decoder->SetTaps(taps_);
 
   EventData event;
   while (config_.Running() == true) {
@@ -123,8 +136,11 @@ void UeWorker::TaskThread(size_t core_offset) {
           DoDemul(event.tags_[0]);
         } break;
         case EventType::kIFFT: {
-          // DoIfftUe(iffter.get(), event.tags_[0]);
-          DoIfft(event.tags_[0]);
+          if (config_.UeFusedUlTx()) {
+            DoUlTxUe(encoder.get(), iffter.get(), event.tags_[0]);
+          } else {
+            DoIfft(event.tags_[0]);
+          }
         } break;
         case EventType::kEncode: {
           DoEncodeUe(encoder.get(), event.tags_[0]);
@@ -208,12 +224,13 @@ void UeWorker::DoFftPilot(size_t tag) {
                             config_.OfdmCaNum() * 2);
 
     // perform fft
-    DftiComputeForward(mkl_handle_, fft_buffer_[fft_buffer_target_id]);
+    fft_plan_->Forward(fft_buffer_[fft_buffer_target_id]);
 
     //// FFT shift the buffer
     auto* fft_buff_complex =
         reinterpret_cast<complex_float*>(fft_buffer_[fft_buffer_target_id]);
     CommsLib::FFTShift(fft_buff_complex, config_.OfdmCaNum());
+    PublishFftIq(frame_id, symbol_id, ant_id, fft_buff_complex);
 
     size_t csi_offset = frame_slot * config_.UeAntNum() + ant_id;
     auto* csi_buffer_ptr =
@@ -233,6 +250,12 @@ void UeWorker::DoFftPilot(size_t tag) {
         csi_buffer_ptr[j] +=
             (fft_buffer_ptr[sc_id] / arma::cx_float(p.re, p.im));
       }
+      // The estimate accumulated over the pilot symbols so far
+      if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kCsi, frame_id)) {
+        taps_->Publish(TapPoint::kCsi, frame_id, symbol_id, ant_id, 0,
+                       csi_buffer_[csi_offset],
+                       config_.OfdmDataNum() * sizeof(complex_float));
+      }
       if (kCollectPhyStats) {
         phy_stats_.UpdateDlPilotSnr(frame_id, dl_symbol_id, ant_id,
                                     fft_buffer_[fft_buffer_target_id]);
@@ -293,12 +316,13 @@ void UeWorker::DoFftData(size_t tag) {
                             config_.OfdmCaNum() * 2);
 
     // perform fft
-    DftiComputeForward(mkl_handle_, fft_buffer_[fft_buffer_target_id]);
+    fft_plan_->Forward(fft_buffer_[fft_buffer_target_id]);
 
     //// FFT shift the buffer
     auto* fft_buff_complex =
         reinterpret_cast<complex_float*>(fft_buffer_[fft_buffer_target_id]);
     CommsLib::FFTShift(fft_buff_complex, config_.OfdmCaNum());
+    PublishFftIq(frame_id, symbol_id, ant_id, fft_buff_complex);
 
     size_t csi_offset = frame_slot * config_.UeAntNum() + ant_id;
     auto* csi_buffer_ptr =
@@ -332,14 +356,19 @@ void UeWorker::DoFftData(size_t tag) {
       theta /= config_.GetOFDMPilotNum();
     }
     auto phc = exp(arma::cx_float(0, -theta));
+
+    // Equalize and phase correct the whole range of data subcarriers, which
+    // non_null_sc_ind_ holds in order, then drop the pilot subcarriers
+    CommsLib::EqualizeSisoCf32(
+        &fft_buff_complex[non_null_sc_ind_.front()], csi_buffer_[csi_offset],
+        {phc.real(), phc.imag()}, equal_tmp_, config_.OfdmDataNum(),
+        config_.FastMathPrecision(FastMath::Family::kSisoEqual));
+    auto* equal_tmp_ptr = reinterpret_cast<arma::cx_float*>(equal_tmp_);
     float evm = 0;
     for (size_t j = 0; j < config_.OfdmDataNum(); j++) {
       if (config_.IsDataSubcarrier(j) == true) {
-        // divide fft output by pilot data to get CSI estimation
-        size_t sc_id = non_null_sc_ind_[j];
         size_t data_sc_id = config_.GetOFDMDataIndex(j);
-        arma::cx_float y = fft_buffer_ptr[sc_id];
-        equ_buffer_ptr[data_sc_id] = (y / csi_buffer_ptr[j]) * phc;
+        equ_buffer_ptr[data_sc_id] = equal_tmp_ptr[j];
         size_t ant = (kDebugDownlink == true) ? 0 : ant_id;
         if (kCollectPhyStats) {
           const size_t dl_data_symbol_id =
@@ -354,6 +383,12 @@ void UeWorker::DoFftData(size_t tag) {
       }
     }
 
+    if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kEqual, frame_id)) {
+      taps_->Publish(TapPoint::kEqual, frame_id, symbol_id, ant_id, 0,
+                     equ_buffer_ptr,
+                     config_.GetOFDMDataNum() * sizeof(complex_float));
+    }
+
     evm = evm / config_.GetOFDMDataNum();
     if (kPrintEqualizedSymbols) {
       complex_float* tx =
@@ -393,6 +428,16 @@ void UeWorker::DoFftData(size_t tag) {
            "UeWorker: FFT message enqueue failed");
 }
 
+void UeWorker::PublishFftIq(size_t frame_id, size_t symbol_id, size_t ant_id,
+                            const complex_float* fft_out) {
+  if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kFftIq, frame_id)) {
+    // non_null_sc_ind_ holds the data subcarriers in order
+    taps_->Publish(TapPoint::kFftIq, frame_id, symbol_id, ant_id, 0,
+                   &fft_out[non_null_sc_ind_.front()],
+                   config_.OfdmDataNum() * sizeof(complex_float));
+  }
+}
+
 void UeWorker::DoDemul(size_t tag) {
   // TODO: We assume one code block per ofdm symbol here
   const size_t start_tsc = GetTime::Rdtsc();
@@ -422,6 +467,12 @@ void UeWorker::DoDemul(size_t tag) {
 
     Demodulate(equal_ptr, demod_ptr, config_.GetOFDMDataNum(),
                config_.ModOrderBits(Direction::kDownlink), kDownlinkHardDemod);
+    if ((taps_ != nullptr) && taps_->Wanted(TapPoint::kLlr, frame_id)) {
+      taps_->Publish(TapPoint::kLlr, frame_id, symbol_id, ant_id, base_sc_id,
+                     demod_ptr,
+                     config_.GetOFDMDataNum() *
+                         config_.ModOrderBits(Direction::kDownlink));
+    }
 
     if (kDownlinkHardDemod && (kPrintPhyStats || kEnableCsvLog) &&
         (dl_symbol_id >= config_.Frame().ClientDlPilotSymbols())) {
@@ -433,16 +484,11 @@ void UeWorker::DoDemul(size_t tag) {
       int8_t* tx_bytes = config_.GetModBitsBuf(
           config_.DlModBits(), Direction::kDownlink, 0, dl_symbol_id,
           kDebugDownlink ? 0 : ant_id, base_sc_id);
-      size_t block_error(0);
-      for (size_t i = 0; i < config_.GetOFDMDataNum(); i++) {
-        uint8_t rx_byte = static_cast<uint8_t>(demod_ptr[i]);
-        uint8_t tx_byte = static_cast<uint8_t>(tx_bytes[i]);
-        phy_stats_.UpdateBitErrors(ant_id, total_dl_symbol_id, frame_slot,
-                                   tx_byte, rx_byte);
-        if (rx_byte != tx_byte) {
-          block_error++;
-        }
-      }
+      const size_t block_error = phy_stats_.UpdateBitErrors(
+          ant_id, total_dl_symbol_id, frame_slot,
+          reinterpret_cast<const uint8_t*>(tx_bytes),
+          reinterpret_cast<const uint8_t*>(demod_ptr),
+          config_.GetOFDMDataNum());
       if (kPrintPhyStats && block_error > 0) {
         AGORA_LOG_INFO("Frame %zu Symbol %zu Ue %zu: %zu symbol errors\n",
                        frame_id, symbol_id, ant_id, block_error);
@@ -473,7 +519,7 @@ void UeWorker::DoDemul(size_t tag) {
       "Demodulation message enqueue failed");
 }
 
-void UeWorker::DoDecodeUe(DoDecodeClient* decoder, size_t tag) {
+void UeWorker::DoDecodeUe(Doer* decoder, size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t ant_id = gen_tag_t(tag).ant_id_;
@@ -565,10 +611,9 @@ void UeWorker::DoModul(size_t tag) {
     }
 
     // TODO place directly into the correct location of the fft buffer
-    for (size_t sc = 0; sc < config_.OfdmDataNum(); sc++) {
-      modul_buf[sc] = ModSingleUint8(static_cast<uint8_t>(ul_bits[sc]),
-                                     config_.ModTable(Direction::kUplink));
-    }
+    ModSimd(reinterpret_cast<const uint8_t*>(ul_bits), modul_buf,
+            config_.OfdmDataNum(), config_.ModTable(Direction::kUplink),
+            config_.ModOrderBits(Direction::kUplink));
   }
 
   if ((kDebugPrintPerTaskDone == true) || (kDebugPrintModul == true)) {
@@ -584,31 +629,46 @@ void UeWorker::DoModul(size_t tag) {
       "Modulation complete message enqueue failed");
 }
 
-void UeWorker::DoIfftUe(DoIFFTClient* iffter, size_t tag) {
+void UeWorker::DoUlTxUe(DoEncode* encoder, DoIFFTClient* iffter, size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t ant_id = gen_tag_t(tag).ue_id_;
+  const size_t ul_symbol_idx = config_.Frame().GetULSymbolIdx(symbol_id);
+  const size_t total_ul_symbol_id =
+      config_.GetTotalDataSymbolIdxUl(frame_id, ul_symbol_idx);
+  const size_t buff_offset = (total_ul_symbol_id * config_.UeAntNum()) + ant_id;
   if (mac_sched_.IsUeScheduled(frame_id, 0u, ant_id)) {
-    // TODO Remove this copy
-    {
-      complex_float const* source_data = nullptr;
-      const size_t ul_symbol_idx = config_.Frame().GetULSymbolIdx(symbol_id);
-      size_t total_ul_symbol_id =
-          config_.GetTotalDataSymbolIdxUl(frame_id, ul_symbol_idx);
-      if (ul_symbol_idx < config_.Frame().ClientUlPilotSymbols()) {
-        source_data = config_.UeSpecificPilot()[ant_id];
-      } else {
-        source_data =
-            &modul_buffer_[total_ul_symbol_id][ant_id * config_.OfdmDataNum()];
+    if (kDebugPrintInTask) {
+      AGORA_LOG_INFO(
+          "UeWorker[%zu]: UlTx   (frame %zu, symbol %zu, user %zu)\n", tid_,
+          frame_id, symbol_id, ant_id);
+    }
+
+    complex_float* ifft_in =
+        ifft_buffer_[buff_offset] + config_.OfdmDataStart();
+    if (ul_symbol_idx < config_.Frame().ClientUlPilotSymbols()) {
+      std::memcpy(ifft_in, config_.UeSpecificPilot()[ant_id],
+                  config_.OfdmDataNum() * sizeof(complex_float));
+    } else {
+      const LDPCconfig& ldpc_config = config_.LdpcConfig(Direction::kUplink);
+      for (size_t cb_id = 0; cb_id < ldpc_config.NumBlocksInSymbol(); cb_id++) {
+        encoder->Launch(gen_tag_t::FrmSymCb(
+                            frame_id, symbol_id,
+                            cb_id + (ant_id * ldpc_config.NumBlocksInSymbol()))
+                            .tag_);
       }
-      const size_t buff_offset =
-          (total_ul_symbol_id * config_.UeAntNum()) + ant_id;
-      complex_float* dest_loc =
-          ifft_buffer_[buff_offset] + (config_.OfdmDataStart());
-      std::memcpy(dest_loc, source_data,
-                  sizeof(complex_float) * config_.OfdmDataNum());
+      // Modulate straight into the data subcarriers of the ifft input
+      auto* ul_bits = config_.GetModBitsBuf(encoded_buffer_, Direction::kUplink,
+                                            frame_id, ul_symbol_idx, ant_id, 0);
+      ModSimd(reinterpret_cast<const uint8_t*>(ul_bits), ifft_in,
+              config_.OfdmDataNum(), config_.ModTable(Direction::kUplink),
+              config_.ModOrderBits(Direction::kUplink));
     }
     iffter->Launch(gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant_id).tag_);
+  } else {
+    auto* pkt = reinterpret_cast<Packet*>(
+        &tx_buffer_[buff_offset * config_.PacketLength()]);
+    std::memset(pkt->data_, 0, 2 * sizeof(short) * config_.SampsPerSymbol());
   }
 
   // Post the completion event (symbol)
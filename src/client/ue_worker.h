@@ -13,12 +13,16 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "csv_logger.h"
+#include "data_tap.h"
 #include "dodecode_client.h"
+#if defined(USE_ACC100)
+#include "dodecode_client_acc.h"
+#endif
 #include "doencode.h"
 #include "doifft_client.h"
+#include "fft_backend.h"
 #include "mac_scheduler.h"
 #include "message.h"
-#include "mkl_dfti.h"
 #include "simd_types.h"
 #include "stats.h"
 
@@ -37,7 +41,8 @@ class UeWorker {
       std::vector<size_t>& non_null_sc_ind, Table<complex_float>& fft_buffer,
       PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffer,
       PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffer,
-      std::vector<std::vector<std::complex<float>>>& ue_pilot_vec);
+      std::vector<std::vector<std::complex<float>>>& ue_pilot_vec,
+      DataTaps* taps = nullptr);
   ~UeWorker();
 
   void Start(size_t core_offset);
@@ -52,7 +57,12 @@ class UeWorker {
    */
   void DoEncodeUe(DoEncode* encoder, size_t tag);
   void DoModul(size_t tag);
-  void DoIfftUe(DoIFFTClient* iffter, size_t tag);
+  /**
+   * Encode and modulate an uplink data symbol into the ifft input, or copy in
+   * the pilot of a pilot symbol, then ifft it into the tx packet, all in one
+   * task
+   */
+  void DoUlTxUe(DoEncode* encoder, DoIFFTClient* iffter, size_t tag);
   void DoIfft(size_t tag);
 
   /**
@@ -89,6 +99,9 @@ class UeWorker {
    */
   void DoFftPilot(size_t tag);
   void DoFftData(size_t tag);
+  /// Publish the data subcarriers of an FFT output to the fft_iq tap
+  void PublishFftIq(size_t frame_id, size_t symbol_id, size_t ant_id,
+                    const complex_float* fft_out);
 
   /**
    * Do demodulation task for a block of subcarriers (demul_block_size)
@@ -115,14 +128,15 @@ class UeWorker {
    * completion of this task
    */
   void DoDemul(size_t tag);
-  void DoDecodeUe(DoDecodeClient* decoder, size_t tag);
+  void DoDecodeUe(Doer* decoder, size_t tag);
 
   size_t tid_;
 
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> fft_plan_;
   std::unique_ptr<moodycamel::ProducerToken> ptok_;
   std::thread thread_;
   std::complex<float>* rx_samps_tmp_;  // Temp buffer for received samples
+  complex_float* equal_tmp_;  // Equalized data and pilot subcarriers
 
   // Shared Queues
   moodycamel::ConcurrentQueue<EventData>& notify_queue_;
@@ -153,5 +167,6 @@ class UeWorker {
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffer_;
 
   std::vector<std::vector<std::complex<float>>>& ue_pilot_vec_;
+  DataTaps* taps_;
 };
 #endif  // UE_WORKER_H_
@@ -0,0 +1,47 @@
+/**
+ * @file adaptive_bulk.h
+ * @brief Declaration file for the AdaptiveBulk class, the dequeue bulk size
+ * of a polled queue that follows its backlog
+ */
+#ifndef ADAPTIVE_BULK_H_
+#define ADAPTIVE_BULK_H_
+
+#include <algorithm>
+#include <cstddef>
+
+/**
+ * @brief The number of events a polling thread asks one queue for at a time.
+ *
+ * A dequeue that comes back full means the queue has a backlog, so the size
+ * doubles to drain it in fewer calls; a dequeue that returns less than half
+ * of what was asked halves it, so a quiet queue does not hold up the other
+ * queues of the thread. The size stays within [min_size, max_size], a fixed
+ * size is min_size == max_size.
+ *
+ * Not thread safe: one object per queue and thread.
+ */
+class AdaptiveBulk {
+ public:
+  AdaptiveBulk(size_t min_size, size_t max_size)
+      : min_size_(min_size), max_size_(std::max(min_size, max_size)),
+        size_(min_size) {}
+
+  inline size_t Size() const { return this->size_; }
+  inline size_t MaxSize() const { return this->max_size_; }
+
+  /// After a dequeue that asked for requested events and got dequeued
+  inline void Update(size_t requested, size_t dequeued) {
+    if ((dequeued == requested) && (requested == this->size_)) {
+      this->size_ = std::min(this->size_ * 2, this->max_size_);
+    } else if ((dequeued * 2) < requested) {
+      this->size_ = std::max(this->size_ / 2, this->min_size_);
+    }
+  }
+
+ private:
+  size_t min_size_;
+  size_t max_size_;
+  size_t size_;
+};
+
+#endif  // ADAPTIVE_BULK_H_
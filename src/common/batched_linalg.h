@@ -0,0 +1,640 @@
+/**
+ * @file batched_linalg.h
+ * @brief Small complex matrix kernels (up to kMaxDim x kMaxDim) that work on a
+ * batch of subcarriers at once, with one subcarrier per SIMD lane. The matrix
+ * dimensions are template parameters, so every loop unrolls and a matrix of a
+ * SIMD group of subcarriers stays in registers.
+ */
+#ifndef BATCHED_LINALG_H_
+#define BATCHED_LINALG_H_
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+
+/**
+ * A batch holds kBatchScs matrices of the same shape in structure-of-arrays
+ * form: separate real and imaginary planes, column-major, with the subcarrier
+ * as the fastest moving dimension, i.e. element (r, c) of subcarrier sc of a
+ * kRows x kCols batch at re_/im_[(r + kRows * c) * kBatchScs + sc].
+ *
+ * The kernels come in two levels. The register level (MatMul, Gram,
+ * Cholesky, Invert, ...) works on CxLanes<L> arrays of one SIMD group of
+ * subcarriers, for callers that chain several steps without a round trip
+ * through memory. The batch level (Gemm, GramBatch, CholeskyBatch, ...) runs
+ * one step over a whole batch.
+ *
+ * L is the backend: Avx512Lanes, Avx2Lanes or ScalarLanes. NativeLanes is the
+ * widest one the build targets. Planes must be 64-byte aligned.
+ *
+ * There is no pivoting. The factorizations fail (return false) if a pivot is
+ * below kPivotThreshold times the scale of the matrix in any subcarrier of
+ * the batch, and their output must then not be used.
+ */
+namespace BatchedLinalg {
+
+/// Subcarriers of a batch, one per float lane of an AVX-512 register
+static constexpr size_t kBatchScs = 16;
+/// Largest matrix dimension of the kernels
+static constexpr size_t kMaxDim = 8;
+/// Size (in floats) of one plane of a kMaxDim x kMaxDim batch
+static constexpr size_t kMaxPlaneSize = kMaxDim * kMaxDim * kBatchScs;
+/// Relative pivot below which a matrix is treated as singular
+static constexpr float kPivotThreshold = 1e-6f;
+
+#if defined(__AVX512F__)
+struct Avx512Lanes {
+  using F = __m512;
+  static constexpr size_t kLanes = 16;
+
+  static inline F Load(const float* src) { return _mm512_load_ps(src); }
+  static inline void Store(float* dst, F v) { _mm512_store_ps(dst, v); }
+  static inline F Set1(float v) { return _mm512_set1_ps(v); }
+  static inline F Add(F a, F b) { return _mm512_add_ps(a, b); }
+  static inline F Sub(F a, F b) { return _mm512_sub_ps(a, b); }
+  static inline F Mul(F a, F b) { return _mm512_mul_ps(a, b); }
+  static inline F Div(F a, F b) { return _mm512_div_ps(a, b); }
+  // a * b + c
+  static inline F Fmadd(F a, F b, F c) { return _mm512_fmadd_ps(a, b, c); }
+  // c - a * b
+  static inline F Fnmadd(F a, F b, F c) { return _mm512_fnmadd_ps(a, b, c); }
+  // The zero-masked forms avoid a false -Wuninitialized in GCC's headers
+  static inline F Sqrt(F a) { return _mm512_maskz_sqrt_ps(0xFFFF, a); }
+  static inline F Max(F a, F b) { return _mm512_maskz_max_ps(0xFFFF, a, b); }
+  // 1 / sqrt(a) where a > 0, 0 elsewhere
+  static inline F SafeRsqrt(F a) {
+    const __mmask16 positive =
+        _mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_GT_OQ);
+    return _mm512_maskz_div_ps(positive, _mm512_set1_ps(1.0f),
+                               _mm512_maskz_sqrt_ps(positive, a));
+  }
+  // a > b in every lane
+  static inline bool AllGreater(F a, F b) {
+    return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ) == 0xFFFF;
+  }
+};
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+struct Avx2Lanes {
+  using F = __m256;
+  static constexpr size_t kLanes = 8;
+
+  static inline F Load(const float* src) { return _mm256_load_ps(src); }
+  static inline void Store(float* dst, F v) { _mm256_store_ps(dst, v); }
+  static inline F Set1(float v) { return _mm256_set1_ps(v); }
+  static inline F Add(F a, F b) { return _mm256_add_ps(a, b); }
+  static inline F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+  static inline F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+  static inline F Div(F a, F b) { return _mm256_div_ps(a, b); }
+  static inline F Fmadd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+  static inline F Fnmadd(F a, F b, F c) { return _mm256_fnmadd_ps(a, b, c); }
+  static inline F Sqrt(F a) { return _mm256_sqrt_ps(a); }
+  static inline F Max(F a, F b) { return _mm256_max_ps(a, b); }
+  static inline F SafeRsqrt(F a) {
+    const __m256 positive = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ);
+    return _mm256_and_ps(
+        positive, _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(a)));
+  }
+  static inline bool AllGreater(F a, F b) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ)) == 0xFF;
+  }
+};
+#endif
+
+/// One subcarrier at a time, for machines without AVX2 and as the reference
+/// of the SIMD backends
+struct ScalarLanes {
+  using F = float;
+  static constexpr size_t kLanes = 1;
+
+  static inline F Load(const float* src) { return *src; }
+  static inline void Store(float* dst, F v) { *dst = v; }
+  static inline F Set1(float v) { return v; }
+  static inline F Add(F a, F b) { return a + b; }
+  static inline F Sub(F a, F b) { return a - b; }
+  static inline F Mul(F a, F b) { return a * b; }
+  static inline F Div(F a, F b) { return a / b; }
+  static inline F Fmadd(F a, F b, F c) { return std::fma(a, b, c); }
+  static inline F Fnmadd(F a, F b, F c) { return std::fma(-a, b, c); }
+  static inline F Sqrt(F a) { return std::sqrt(a); }
+  static inline F Max(F a, F b) { return std::max(a, b); }
+  static inline F SafeRsqrt(F a) { return a > 0.0f ? 1.0f / std::sqrt(a) : 0; }
+  static inline bool AllGreater(F a, F b) { return a > b; }
+};
+
+#if defined(__AVX512F__)
+using NativeLanes = Avx512Lanes;
+#elif defined(__AVX2__) && defined(__FMA__)
+using NativeLanes = Avx2Lanes;
+#else
+using NativeLanes = ScalarLanes;
+#endif
+
+/// A view of the planes of a kRows x kCols batch. T is const float for an
+/// input.
+template <size_t kRows, size_t kCols, typename T = float>
+struct CxPlanes {
+  T* re_;
+  T* im_;
+
+  static constexpr size_t Offset(size_t row, size_t col, size_t sc) {
+    return (row + kRows * col) * kBatchScs + sc;
+  }
+};
+
+/// A kRows x kCols batch that owns its planes
+template <size_t kRows, size_t kCols>
+struct CxBatch {
+  static constexpr size_t kPlaneSize = kRows * kCols * kBatchScs;
+
+  alignas(64) float re_[kPlaneSize];
+  alignas(64) float im_[kPlaneSize];
+
+  inline CxPlanes<kRows, kCols> Planes() { return {re_, im_}; }
+  inline CxPlanes<kRows, kCols, const float> Planes() const {
+    return {re_, im_};
+  }
+  inline std::complex<float> At(size_t row, size_t col, size_t sc) const {
+    const size_t offset = CxPlanes<kRows, kCols>::Offset(row, col, sc);
+    return {re_[offset], im_[offset]};
+  }
+  inline void Set(size_t row, size_t col, size_t sc, std::complex<float> v) {
+    const size_t offset = CxPlanes<kRows, kCols>::Offset(row, col, sc);
+    re_[offset] = v.real();
+    im_[offset] = v.imag();
+  }
+};
+
+/// One complex matrix element of L::kLanes subcarriers
+template <class L>
+struct CxLanes {
+  typename L::F re_;
+  typename L::F im_;
+};
+
+template <class L>
+inline CxLanes<L> CxZero() {
+  return {L::Set1(0.0f), L::Set1(0.0f)};
+}
+
+template <class L>
+inline CxLanes<L> CxOne() {
+  return {L::Set1(1.0f), L::Set1(0.0f)};
+}
+
+template <class L>
+inline CxLanes<L> CxConj(const CxLanes<L>& a) {
+  return {a.re_, L::Mul(a.im_, L::Set1(-1.0f))};
+}
+
+template <class L>
+inline CxLanes<L> CxScale(const CxLanes<L>& a, typename L::F s) {
+  return {L::Mul(a.re_, s), L::Mul(a.im_, s)};
+}
+
+/// |a|^2
+template <class L>
+inline typename L::F CxNorm(const CxLanes<L>& a) {
+  return L::Fmadd(a.re_, a.re_, L::Mul(a.im_, a.im_));
+}
+
+/// a * b
+template <class L>
+inline CxLanes<L> CxMul(const CxLanes<L>& a, const CxLanes<L>& b) {
+  return {L::Fnmadd(a.im_, b.im_, L::Mul(a.re_, b.re_)),
+          L::Fmadd(a.im_, b.re_, L::Mul(a.re_, b.im_))};
+}
+
+/// acc + a * b
+template <class L>
+inline CxLanes<L> CxFmadd(const CxLanes<L>& a, const CxLanes<L>& b,
+                          const CxLanes<L>& acc) {
+  typename L::F re = L::Fmadd(a.re_, b.re_, acc.re_);
+  re = L::Fnmadd(a.im_, b.im_, re);
+  typename L::F im = L::Fmadd(a.re_, b.im_, acc.im_);
+  im = L::Fmadd(a.im_, b.re_, im);
+  return {re, im};
+}
+
+/// acc - a * b
+template <class L>
+inline CxLanes<L> CxFnmadd(const CxLanes<L>& a, const CxLanes<L>& b,
+                           const CxLanes<L>& acc) {
+  typename L::F re = L::Fnmadd(a.re_, b.re_, acc.re_);
+  re = L::Fmadd(a.im_, b.im_, re);
+  typename L::F im = L::Fnmadd(a.re_, b.im_, acc.im_);
+  im = L::Fnmadd(a.im_, b.re_, im);
+  return {re, im};
+}
+
+/// acc + conj(a) * b
+template <class L>
+inline CxLanes<L> CxConjFmadd(const CxLanes<L>& a, const CxLanes<L>& b,
+                              const CxLanes<L>& acc) {
+  typename L::F re = L::Fmadd(a.re_, b.re_, acc.re_);
+  re = L::Fmadd(a.im_, b.im_, re);
+  typename L::F im = L::Fmadd(a.re_, b.im_, acc.im_);
+  im = L::Fnmadd(a.im_, b.re_, im);
+  return {re, im};
+}
+
+/// acc + a * conj(b)
+template <class L>
+inline CxLanes<L> CxFmaddConj(const CxLanes<L>& a, const CxLanes<L>& b,
+                              const CxLanes<L>& acc) {
+  typename L::F re = L::Fmadd(a.re_, b.re_, acc.re_);
+  re = L::Fmadd(a.im_, b.im_, re);
+  typename L::F im = L::Fmadd(a.im_, b.re_, acc.im_);
+  im = L::Fnmadd(a.re_, b.im_, im);
+  return {re, im};
+}
+
+/// acc - conj(a) * b
+template <class L>
+inline CxLanes<L> CxConjFnmadd(const CxLanes<L>& a, const CxLanes<L>& b,
+                               const CxLanes<L>& acc) {
+  typename L::F re = L::Fnmadd(a.re_, b.re_, acc.re_);
+  re = L::Fnmadd(a.im_, b.im_, re);
+  typename L::F im = L::Fnmadd(a.re_, b.im_, acc.im_);
+  im = L::Fmadd(a.im_, b.re_, im);
+  return {re, im};
+}
+
+/// 1 / a
+template <class L>
+inline CxLanes<L> CxRecip(const CxLanes<L>& a) {
+  return CxScale(CxConj(a), L::Div(L::Set1(1.0f), CxNorm(a)));
+}
+
+// ---------------------------------------------------------------------------
+// Register level, on the subcarriers [lane, lane + L::kLanes) of a batch
+// ---------------------------------------------------------------------------
+
+template <class L, size_t kRows, size_t kCols, typename T>
+inline void LoadMat(const CxPlanes<kRows, kCols, T>& src, size_t lane,
+                    CxLanes<L> (&m)[kRows][kCols]) {
+  for (size_t c = 0; c < kCols; c++) {
+    for (size_t r = 0; r < kRows; r++) {
+      const size_t offset = src.Offset(r, c, lane);
+      m[r][c] = {L::Load(src.re_ + offset), L::Load(src.im_ + offset)};
+    }
+  }
+}
+
+template <class L, size_t kRows, size_t kCols>
+inline void StoreMat(const CxLanes<L> (&m)[kRows][kCols], size_t lane,
+                     const CxPlanes<kRows, kCols>& dst) {
+  for (size_t c = 0; c < kCols; c++) {
+    for (size_t r = 0; r < kRows; r++) {
+      const size_t offset = dst.Offset(r, c, lane);
+      L::Store(dst.re_ + offset, m[r][c].re_);
+      L::Store(dst.im_ + offset, m[r][c].im_);
+    }
+  }
+}
+
+/// c = a * b
+template <class L, size_t kM, size_t kK, size_t kN>
+inline void MatMul(const CxLanes<L> (&a)[kM][kK],
+                   const CxLanes<L> (&b)[kK][kN], CxLanes<L> (&c)[kM][kN]) {
+  for (size_t i = 0; i < kM; i++) {
+    for (size_t j = 0; j < kN; j++) {
+      CxLanes<L> acc = CxZero<L>();
+      for (size_t k = 0; k < kK; k++) {
+        acc = CxFmadd(a[i][k], b[k][j], acc);
+      }
+      c[i][j] = acc;
+    }
+  }
+}
+
+/// c = a' * b
+template <class L, size_t kK, size_t kM, size_t kN>
+inline void MatMulAH(const CxLanes<L> (&a)[kK][kM],
+                     const CxLanes<L> (&b)[kK][kN], CxLanes<L> (&c)[kM][kN]) {
+  for (size_t i = 0; i < kM; i++) {
+    for (size_t j = 0; j < kN; j++) {
+      CxLanes<L> acc = CxZero<L>();
+      for (size_t k = 0; k < kK; k++) {
+        acc = CxConjFmadd(a[k][i], b[k][j], acc);
+      }
+      c[i][j] = acc;
+    }
+  }
+}
+
+/// c = a * b'
+template <class L, size_t kM, size_t kK, size_t kN>
+inline void MatMulBH(const CxLanes<L> (&a)[kM][kK],
+                     const CxLanes<L> (&b)[kN][kK], CxLanes<L> (&c)[kM][kN]) {
+  for (size_t i = 0; i < kM; i++) {
+    for (size_t j = 0; j < kN; j++) {
+      CxLanes<L> acc = CxZero<L>();
+      for (size_t k = 0; k < kK; k++) {
+        acc = CxFmaddConj(a[i][k], b[j][k], acc);
+      }
+      c[i][j] = acc;
+    }
+  }
+}
+
+/// g = a' * a + noise * I. g is Hermitian, so only the upper triangle is
+/// computed.
+template <class L, size_t kRows, size_t kCols>
+inline void Gram(const CxLanes<L> (&a)[kRows][kCols], typename L::F noise,
+                 CxLanes<L> (&g)[kCols][kCols]) {
+  for (size_t i = 0; i < kCols; i++) {
+    for (size_t j = i; j < kCols; j++) {
+      CxLanes<L> acc = CxZero<L>();
+      for (size_t r = 0; r < kRows; r++) {
+        acc = CxConjFmadd(a[r][i], a[r][j], acc);
+      }
+      if (j == i) {
+        acc.re_ = L::Add(acc.re_, noise);
+      } else {
+        g[j][i] = CxConj(acc);
+      }
+      g[i][j] = acc;
+    }
+  }
+}
+
+/// Real part of the trace
+template <class L, size_t kN>
+inline typename L::F Trace(const CxLanes<L> (&a)[kN][kN]) {
+  typename L::F trace = a[0][0].re_;
+  for (size_t i = 1; i < kN; i++) {
+    trace = L::Add(trace, a[i][i].re_);
+  }
+  return trace;
+}
+
+/// In-place Gauss-Jordan inversion of a Hermitian positive definite matrix,
+/// whose pivots are real. Returns false if a pivot is below kPivotThreshold *
+/// trace(a).
+template <class L, size_t kN>
+inline bool InvertHermitian(CxLanes<L> (&a)[kN][kN]) {
+  const typename L::F threshold =
+      L::Mul(Trace(a), L::Set1(kPivotThreshold));
+  for (size_t k = 0; k < kN; k++) {
+    const typename L::F pivot = a[k][k].re_;
+    if (L::AllGreater(pivot, threshold) == false) {
+      return false;
+    }
+    const typename L::F inv_pivot = L::Div(L::Set1(1.0f), pivot);
+    a[k][k] = CxOne<L>();
+    for (size_t j = 0; j < kN; j++) {
+      a[k][j] = CxScale(a[k][j], inv_pivot);
+    }
+    for (size_t i = 0; i < kN; i++) {
+      if (i == k) {
+        continue;
+      }
+      const CxLanes<L> factor = a[i][k];
+      a[i][k] = CxZero<L>();
+      for (size_t j = 0; j < kN; j++) {
+        a[i][j] = CxFnmadd(factor, a[k][j], a[i][j]);
+      }
+    }
+  }
+  return true;
+}
+
+/// Squared pivot threshold of a general matrix: kPivotThreshold^2 times its
+/// squared Frobenius norm
+template <class L, size_t kN>
+inline typename L::F PivotThreshold2(const CxLanes<L> (&a)[kN][kN]) {
+  typename L::F norm = L::Set1(0.0f);
+  for (size_t i = 0; i < kN; i++) {
+    for (size_t j = 0; j < kN; j++) {
+      norm = L::Add(norm, CxNorm(a[i][j]));
+    }
+  }
+  return L::Mul(norm, L::Set1(kPivotThreshold * kPivotThreshold));
+}
+
+/// In-place Gauss-Jordan inversion of a general matrix. Returns false if
+/// |pivot| is below kPivotThreshold * ||a||_F.
+template <class L, size_t kN>
+inline bool Invert(CxLanes<L> (&a)[kN][kN]) {
+  const typename L::F threshold = PivotThreshold2(a);
+  for (size_t k = 0; k < kN; k++) {
+    if (L::AllGreater(CxNorm(a[k][k]), threshold) == false) {
+      return false;
+    }
+    const CxLanes<L> inv_pivot = CxRecip(a[k][k]);
+    a[k][k] = CxOne<L>();
+    for (size_t j = 0; j < kN; j++) {
+      a[k][j] = CxMul(a[k][j], inv_pivot);
+    }
+    for (size_t i = 0; i < kN; i++) {
+      if (i == k) {
+        continue;
+      }
+      const CxLanes<L> factor = a[i][k];
+      a[i][k] = CxZero<L>();
+      for (size_t j = 0; j < kN; j++) {
+        a[i][j] = CxFnmadd(factor, a[k][j], a[i][j]);
+      }
+    }
+  }
+  return true;
+}
+
+/// In-place Cholesky factorization a = l * l' of a Hermitian positive
+/// definite matrix. Only the lower triangle of a is read; l is written to the
+/// lower triangle, with a real diagonal, and the upper triangle is zeroed.
+/// Returns false if a pivot is below kPivotThreshold * trace(a).
+template <class L, size_t kN>
+inline bool Cholesky(CxLanes<L> (&a)[kN][kN]) {
+  const typename L::F threshold =
+      L::Mul(Trace(a), L::Set1(kPivotThreshold));
+  for (size_t j = 0; j < kN; j++) {
+    typename L::F d = a[j][j].re_;
+    for (size_t k = 0; k < j; k++) {
+      d = L::Sub(d, CxNorm(a[j][k]));
+    }
+    if (L::AllGreater(d, threshold) == false) {
+      return false;
+    }
+    const typename L::F l_jj = L::Sqrt(d);
+    const typename L::F inv_l_jj = L::Div(L::Set1(1.0f), l_jj);
+    a[j][j] = {l_jj, L::Set1(0.0f)};
+    for (size_t i = j + 1; i < kN; i++) {
+      CxLanes<L> acc = a[i][j];
+      for (size_t k = 0; k < j; k++) {
+        // acc -= l(i, k) * conj(l(j, k))
+        acc = CxFnmadd(a[i][k], CxConj(a[j][k]), acc);
+      }
+      a[i][j] = CxScale(acc, inv_l_jj);
+      a[j][i] = CxZero<L>();
+    }
+  }
+  return true;
+}
+
+/// Solve l * l' * x = b in place of b, with l from Cholesky()
+template <class L, size_t kN, size_t kM>
+inline void CholeskySolve(const CxLanes<L> (&l)[kN][kN],
+                          CxLanes<L> (&b)[kN][kM]) {
+  typename L::F inv_diag[kN];
+  for (size_t i = 0; i < kN; i++) {
+    inv_diag[i] = L::Div(L::Set1(1.0f), l[i][i].re_);
+  }
+  for (size_t col = 0; col < kM; col++) {
+    // l * y = b
+    for (size_t i = 0; i < kN; i++) {
+      CxLanes<L> acc = b[i][col];
+      for (size_t k = 0; k < i; k++) {
+        acc = CxFnmadd(l[i][k], b[k][col], acc);
+      }
+      b[i][col] = CxScale(acc, inv_diag[i]);
+    }
+    // l' * x = y
+    for (size_t i = kN; i-- > 0;) {
+      CxLanes<L> acc = b[i][col];
+      for (size_t k = i + 1; k < kN; k++) {
+        acc = CxConjFnmadd(l[k][i], b[k][col], acc);
+      }
+      b[i][col] = CxScale(acc, inv_diag[i]);
+    }
+  }
+}
+
+/// det(a) of a general matrix by Gaussian elimination, which overwrites a.
+/// Returns false if |pivot| is below kPivotThreshold * ||a||_F, i.e. also
+/// for a (nearly) singular matrix, whose determinant is then taken as 0.
+template <class L, size_t kN>
+inline bool Determinant(CxLanes<L> (&a)[kN][kN], CxLanes<L>& det) {
+  const typename L::F threshold = PivotThreshold2(a);
+  det = CxOne<L>();
+  for (size_t k = 0; k < kN; k++) {
+    if (L::AllGreater(CxNorm(a[k][k]), threshold) == false) {
+      return false;
+    }
+    det = CxMul(det, a[k][k]);
+    const CxLanes<L> inv_pivot = CxRecip(a[k][k]);
+    for (size_t i = k + 1; i < kN; i++) {
+      const CxLanes<L> factor = CxMul(a[i][k], inv_pivot);
+      for (size_t j = k + 1; j < kN; j++) {
+        a[i][j] = CxFnmadd(factor, a[k][j], a[i][j]);
+      }
+    }
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Batch level
+// ---------------------------------------------------------------------------
+
+/// c = a * b
+template <class L = NativeLanes, size_t kM, size_t kK, size_t kN,
+          typename TA, typename TB>
+inline void Gemm(const CxPlanes<kM, kK, TA>& a, const CxPlanes<kK, kN, TB>& b,
+                 const CxPlanes<kM, kN>& c) {
+  static_assert(kBatchScs % L::kLanes == 0);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> ma[kM][kK];
+    CxLanes<L> mb[kK][kN];
+    CxLanes<L> mc[kM][kN];
+    LoadMat(a, lane, ma);
+    LoadMat(b, lane, mb);
+    MatMul(ma, mb, mc);
+    StoreMat(mc, lane, c);
+  }
+}
+
+/// g = a' * a + noise * I
+template <class L = NativeLanes, size_t kRows, size_t kCols, typename T>
+inline void GramBatch(const CxPlanes<kRows, kCols, T>& a, float noise,
+                      const CxPlanes<kCols, kCols>& g) {
+  static_assert(kBatchScs % L::kLanes == 0);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> ma[kRows][kCols];
+    CxLanes<L> mg[kCols][kCols];
+    LoadMat(a, lane, ma);
+    Gram(ma, L::Set1(noise), mg);
+    StoreMat(mg, lane, g);
+  }
+}
+
+/// Cholesky factor l of a Hermitian positive definite a, see Cholesky()
+template <class L = NativeLanes, size_t kN, typename T>
+inline bool CholeskyBatch(const CxPlanes<kN, kN, T>& a,
+                          const CxPlanes<kN, kN>& l) {
+  static_assert(kBatchScs % L::kLanes == 0);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> m[kN][kN];
+    LoadMat(a, lane, m);
+    if (Cholesky(m) == false) {
+      return false;
+    }
+    StoreMat(m, lane, l);
+  }
+  return true;
+}
+
+/// inv(a) of a general matrix, or of a Hermitian positive definite one with
+/// hermitian set, see Invert() and InvertHermitian()
+template <class L = NativeLanes, size_t kN, typename T>
+inline bool InvertBatch(const CxPlanes<kN, kN, T>& a,
+                        const CxPlanes<kN, kN>& inv, bool hermitian = false) {
+  static_assert(kBatchScs % L::kLanes == 0);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> m[kN][kN];
+    LoadMat(a, lane, m);
+    if ((hermitian ? InvertHermitian(m) : Invert(m)) == false) {
+      return false;
+    }
+    StoreMat(m, lane, inv);
+  }
+  return true;
+}
+
+/// x = inv(a) * b of a Hermitian positive definite a, by Cholesky
+template <class L = NativeLanes, size_t kN, size_t kM, typename TA,
+          typename TB>
+inline bool SolveBatch(const CxPlanes<kN, kN, TA>& a,
+                       const CxPlanes<kN, kM, TB>& b,
+                       const CxPlanes<kN, kM>& x) {
+  static_assert(kBatchScs % L::kLanes == 0);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> m[kN][kN];
+    CxLanes<L> mx[kN][kM];
+    LoadMat(a, lane, m);
+    if (Cholesky(m) == false) {
+      return false;
+    }
+    LoadMat(b, lane, mx);
+    CholeskySolve(m, mx);
+    StoreMat(mx, lane, x);
+  }
+  return true;
+}
+
+/// det(a) of every subcarrier, in the det planes of kBatchScs floats each.
+/// See Determinant().
+template <class L = NativeLanes, size_t kN, typename T>
+inline bool DeterminantBatch(const CxPlanes<kN, kN, T>& a,
+                             const CxPlanes<1, 1>& det) {
+  static_assert(kBatchScs % L::kLanes == 0);
+  for (size_t lane = 0; lane < kBatchScs; lane += L::kLanes) {
+    CxLanes<L> m[kN][kN];
+    CxLanes<L> d[1][1];
+    LoadMat(a, lane, m);
+    if (Determinant(m, d[0][0]) == false) {
+      return false;
+    }
+    StoreMat(d, lane, det);
+  }
+  return true;
+}
+
+}  // namespace BatchedLinalg
+
+#endif  // BATCHED_LINALG_H_
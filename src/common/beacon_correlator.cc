@@ -0,0 +1,126 @@
+/**
+ * @file beacon_correlator.cc
+ * @brief Implementation of the streaming beacon correlator
+ */
+#include "beacon_correlator.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "datatype_conversion.h"
+#include "utils.h"
+
+// Number of complex samples per vector of floats
+#if defined(__AVX512F__)
+static constexpr size_t kSamplesPerVector = 8;
+#else
+static constexpr size_t kSamplesPerVector = 4;
+#endif
+
+BeaconCorrelator::BeaconCorrelator(const std::vector<std::complex<float>>& seq,
+                                   size_t max_block_len)
+    : seq_len_(seq.size()),
+      max_block_len_(max_block_len),
+      seq_re_(seq.size()),
+      seq_im_(seq.size()),
+      in_(2 * (seq.size() - 1 + max_block_len + kSamplesPerVector), 0.0f),
+      corr_(2 * (max_block_len + kSamplesPerVector), 0.0f),
+      corr_abs_(seq.size() + max_block_len, 0.0f) {
+  RtAssert(seq_len_ > 0, "BeaconCorrelator: empty sequence");
+  for (size_t i = 0; i < seq_len_; i++) {
+    seq_re_.at(i) = seq.at(i).real();
+    seq_im_.at(i) = seq.at(i).imag();
+  }
+}
+
+void BeaconCorrelator::Reset() {
+  std::fill(in_.begin(), in_.begin() + 2 * (seq_len_ - 1), 0.0f);
+  std::fill(corr_abs_.begin(), corr_abs_.begin() + seq_len_, 0.0f);
+}
+
+void BeaconCorrelator::Correlate(size_t block_len) {
+  // corr[n] = sum_j in[n + j] * conj(seq[j]), the correlation of the window
+  // that ends at sample n of the block. The real and imaginary parts of the
+  // sequence are applied with two FMAs into separate sums, which are combined
+  // once per output vector instead of once per sequence sample.
+#if defined(__AVX512F__)
+  const __m512 neg_im =
+      _mm512_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f,
+                     -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+  for (size_t n = 0; n < block_len; n += kSamplesPerVector) {
+    const float* window = &in_.at(2 * n);
+    __m512 sum_re = _mm512_setzero_ps();
+    __m512 sum_im = _mm512_setzero_ps();
+    for (size_t j = 0; j < seq_len_; j++) {
+      const __m512 data = _mm512_loadu_ps(window + 2 * j);
+      // (i, q) * re(seq)
+      sum_re = _mm512_fmadd_ps(data, _mm512_set1_ps(seq_re_[j]), sum_re);
+      // (q, i) * im(seq)
+      sum_im = _mm512_fmadd_ps(_mm512_permute_ps(data, 0xb1),
+                               _mm512_set1_ps(seq_im_[j]), sum_im);
+    }
+    _mm512_storeu_ps(&corr_.at(2 * n),
+                     _mm512_fmadd_ps(sum_im, neg_im, sum_re));
+  }
+#else
+  const __m256 neg_im =
+      _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+  for (size_t n = 0; n < block_len; n += kSamplesPerVector) {
+    const float* window = &in_.at(2 * n);
+    __m256 sum_re = _mm256_setzero_ps();
+    __m256 sum_im = _mm256_setzero_ps();
+    for (size_t j = 0; j < seq_len_; j++) {
+      const __m256 data = _mm256_loadu_ps(window + 2 * j);
+      sum_re = _mm256_fmadd_ps(data, _mm256_set1_ps(seq_re_[j]), sum_re);
+      sum_im = _mm256_fmadd_ps(_mm256_permute_ps(data, 0xb1),
+                               _mm256_set1_ps(seq_im_[j]), sum_im);
+    }
+    _mm256_storeu_ps(&corr_.at(2 * n),
+                     _mm256_fmadd_ps(sum_im, neg_im, sum_re));
+  }
+#endif
+}
+
+ssize_t BeaconCorrelator::Process(const std::complex<int16_t>* iq,
+                                  size_t block_len, float corr_scale) {
+  RtAssert(block_len <= max_block_len_,
+           "BeaconCorrelator: block larger than the max block length");
+  const size_t overlap = seq_len_ - 1;
+
+  // The block goes after the samples kept from the previous block
+  ConvertShortToFloat(reinterpret_cast<const short*>(iq), &in_.at(2 * overlap),
+                      2 * block_len);
+  Correlate(block_len);
+
+  float* corr_abs = corr_abs_.data();
+  for (size_t n = 0; n < block_len; n++) {
+    const float re = corr_[2 * n];
+    const float im = corr_[2 * n + 1];
+    corr_abs[seq_len_ + n] = (re * re) + (im * im);
+  }
+
+  // The beacon ends at n if the correlation of both repetitions, n and
+  // n - seq_len_, stands out from the moving sum of the correlation power
+  // over the seq_len_ samples before n. The product of the powers is the
+  // power of corr[n] * conj(corr[n - seq_len_]).
+  double thresh = 0;
+  for (size_t n = 0; n < seq_len_; n++) {
+    thresh += corr_abs[n];
+  }
+  ssize_t peak = -1;
+  for (size_t n = 0; n < block_len; n++) {
+    const float power = corr_abs[seq_len_ + n] * corr_abs[n];
+    if (corr_scale * power > static_cast<float>(thresh)) {
+      peak = static_cast<ssize_t>(n);
+    }
+    thresh += corr_abs[seq_len_ + n] - corr_abs[n];
+  }
+
+  // Keep the end of the stream for the next block
+  std::memmove(in_.data(), &in_.at(2 * block_len),
+               2 * overlap * sizeof(float));
+  std::memmove(corr_abs, corr_abs + block_len, seq_len_ * sizeof(float));
+  return peak;
+}
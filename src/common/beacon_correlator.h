@@ -0,0 +1,69 @@
+/**
+ * @file beacon_correlator.h
+ * @brief Streaming correlator that finds a beacon (two repetitions of a
+ * sequence) in int16 radio samples, one block of samples at a time.
+ */
+#ifndef BEACON_CORRELATOR_H_
+#define BEACON_CORRELATOR_H_
+
+#include <sys/types.h>
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Same detection as CommsLib::FindBeaconAvx(), but over a stream of
+ * sample blocks. The last (sequence length - 1) samples and the last
+ * sequence length correlation powers of each block are kept for the next one
+ * (overlap-save), so a block is correlated as if it followed the previous
+ * block without a gap. All memory is allocated by the constructor.
+ */
+class BeaconCorrelator {
+ public:
+  /**
+   * @param seq The sequence to correlate with, repeated twice in the beacon
+   * @param max_block_len Largest number of samples passed to Process()
+   */
+  BeaconCorrelator(const std::vector<std::complex<float>>& seq,
+                   size_t max_block_len);
+
+  /// Forget the previous samples, e.g., when the next block does not follow
+  /// the last one. The next block is correlated as if zeros preceded it.
+  void Reset();
+
+  /**
+   * @brief Correlate the next block of samples
+   * @param iq block_len samples that follow the samples of the previous call
+   * @param corr_scale Threshold scale, as in CommsLib::FindBeaconAvx()
+   * @return Index in the block of the last sample where a detected beacon
+   * ends, or -1 if none does
+   */
+  ssize_t Process(const std::complex<int16_t>* iq, size_t block_len,
+                  float corr_scale);
+
+  inline size_t SeqLen() const { return seq_len_; }
+
+ private:
+  // Correlate in_ with the sequence into corr_, for block_len samples
+  void Correlate(size_t block_len);
+
+  const size_t seq_len_;
+  const size_t max_block_len_;
+
+  // Real and imaginary parts of the sequence
+  std::vector<float> seq_re_;
+  std::vector<float> seq_im_;
+
+  // Interleaved float samples: the last (seq_len_ - 1) samples of the
+  // previous block, then the current block, then padding for vector loads
+  std::vector<float> in_;
+  // Interleaved correlation of the current block, padded for vector stores
+  std::vector<float> corr_;
+  // Correlation power: seq_len_ values of the previous block, then the
+  // current block
+  std::vector<float> corr_abs_;
+};
+
+#endif  // BEACON_CORRELATOR_H_
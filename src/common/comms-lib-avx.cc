@@ -16,6 +16,7 @@
 #include "comms-lib.h"
 #include "datatype_conversion.h"
 #include "simd_types.h"
+#include "symbols.h"
 
 #define USE_AVX
 #define ALIGNMENT (32)
@@ -193,6 +194,80 @@ std::vector<std::complex<int16_t>> CommsLib::ComplexMultAvx(
   return out;
 }
 
+/**
+ * One-stream zero-forcing equalization (y / h) * phase, computed as
+ * y * conj(h) / |h|^2 so that only real divisions are needed. Returns the
+ * subcarriers done, the rest are left to the scalar loop.
+ */
+template <FastMath::Precision kPrecision>
+static size_t EqualizeSisoVectors(const complex_float* y,
+                                  const complex_float* h, complex_float phase,
+                                  complex_float* out, size_t len) {
+  size_t i = 0;
+#ifdef __AVX512F__
+  const __m512 phase512 =
+      CommsLib::M512ComplexCf32Set1(std::complex<float>(phase.re, phase.im));
+  for (; (i + kSCsPerCacheline) <= len; i += kSCsPerCacheline) {
+    const __m512 data = _mm512_loadu_ps(reinterpret_cast<const float*>(y + i));
+    const __m512 csi = _mm512_loadu_ps(reinterpret_cast<const float*>(h + i));
+    /* (a^2, b^2) swapped to (b^2, a^2), so that both lanes get a^2 + b^2 */
+    const __m512 sq = _mm512_mul_ps(csi, csi);
+    const __m512 abs_sq = _mm512_add_ps(sq, _mm512_permute_ps(sq, 0xb1));
+    const __m512 num = CommsLib::M512ComplexCf32Mult(data, csi, true);
+    const __m512 equal =
+        (kPrecision == FastMath::Precision::kExact)
+            ? _mm512_div_ps(num, abs_sq)
+            : _mm512_mul_ps(num, FastMath::Rcp<kPrecision>(abs_sq));
+    _mm512_storeu_ps(reinterpret_cast<float*>(out + i),
+                     CommsLib::M512ComplexCf32Mult(equal, phase512, false));
+  }
+#endif
+  const __m256 phase256 = _mm256_setr_ps(phase.re, phase.im, phase.re,
+                                         phase.im, phase.re, phase.im,
+                                         phase.re, phase.im);
+  for (; (i + (kSCsPerCacheline / 2)) <= len; i += (kSCsPerCacheline / 2)) {
+    const __m256 data = _mm256_loadu_ps(reinterpret_cast<const float*>(y + i));
+    const __m256 csi = _mm256_loadu_ps(reinterpret_cast<const float*>(h + i));
+    const __m256 sq = _mm256_mul_ps(csi, csi);
+    const __m256 abs_sq = _mm256_add_ps(sq, _mm256_permute_ps(sq, 0xb1));
+    const __m256 num = CommsLib::M256ComplexCf32Mult(data, csi, true);
+    const __m256 equal =
+        (kPrecision == FastMath::Precision::kExact)
+            ? _mm256_div_ps(num, abs_sq)
+            : _mm256_mul_ps(num, FastMath::Rcp<kPrecision>(abs_sq));
+    _mm256_storeu_ps(reinterpret_cast<float*>(out + i),
+                     CommsLib::M256ComplexCf32Mult(equal, phase256, false));
+  }
+  return i;
+}
+
+void CommsLib::EqualizeSisoCf32(const complex_float* y, const complex_float* h,
+                                complex_float phase, complex_float* out,
+                                size_t len, FastMath::Precision precision) {
+  size_t i;
+  switch (precision) {
+    case FastMath::Precision::kRefined:
+      i = EqualizeSisoVectors<FastMath::Precision::kRefined>(y, h, phase, out,
+                                                             len);
+      break;
+    case FastMath::Precision::kApprox:
+      i = EqualizeSisoVectors<FastMath::Precision::kApprox>(y, h, phase, out,
+                                                            len);
+      break;
+    default:
+      i = EqualizeSisoVectors<FastMath::Precision::kExact>(y, h, phase, out,
+                                                           len);
+      break;
+  }
+  for (; i < len; i++) {
+    const std::complex<float> equal =
+        (std::complex<float>(y[i].re, y[i].im) /
+         std::complex<float>(h[i].re, h[i].im)) *
+        std::complex<float>(phase.re, phase.im);
+    out[i] = {equal.real(), equal.imag()};
+  }
+}
+
 __m256 CommsLib::M256ComplexCf32Mult(__m256 data1, __m256 data2, bool conj) {
   __m256 prod0 __attribute__((aligned(ALIGNMENT)));
   __m256 prod1 __attribute__((aligned(ALIGNMENT)));
@@ -361,8 +436,11 @@ __m256 CommsLib::M256ComplexCf32Reciprocal(__m256 data) {
  * Perform complex reciprocol of a vector of single precision (32 bit)
  * floats using AVX-512.
  * @param data: vector to reciprocate
+ * @param precision: exact division, or the estimated reciprocal of the
+ * denominator with or without a Newton-Raphson step
  */
-__m512 CommsLib::M512ComplexCf32Reciprocal(__m512 data) {
+__m512 CommsLib::M512ComplexCf32Reciprocal(__m512 data,
+                                           FastMath::Precision precision) {
   // Require that all data is aligned to 64 byte boundaries
   __m512 sq __attribute__((aligned(64)));
   __m512 denom __attribute__((aligned(64)));
@@ -406,7 +484,19 @@ __m512 CommsLib::M512ComplexCf32Reciprocal(__m512 data) {
   denom = _mm512_add_ps(denom, denom_rs);  // (a^2 + b^2, a^2 + b^2, ...)
 
   /* Step 4: divide conj(data) by denominator */
-  res = _mm512_div_ps(numerator, denom);
+  switch (precision) {
+    case FastMath::Precision::kRefined:
+      res = _mm512_mul_ps(numerator,
+                          FastMath::Rcp<FastMath::Precision::kRefined>(denom));
+      break;
+    case FastMath::Precision::kApprox:
+      res = _mm512_mul_ps(numerator,
+                          FastMath::Rcp<FastMath::Precision::kApprox>(denom));
+      break;
+    default:
+      res = _mm512_div_ps(numerator, denom);
+      break;
+  }
   return res;
 }
 #endif
@@ -497,6 +587,36 @@ __m512 CommsLib::M512ComplexCf32Conj(__m512 data) {
 }
 #endif
 
+#ifdef __AVX512F__
+/**
+ * Complex sign z / |z| of a vector of single precision (32 bit) floats
+ * using AVX-512, 0 for z = 0. Complex number version of arma::sign.
+ * @param data: vector of the complex numbers z
+ * @param precision: exact division by |z|, or the estimated 1 / |z| with or
+ * without a Newton-Raphson step
+ */
+__m512 CommsLib::M512ComplexCf32Sign(__m512 data,
+                                     FastMath::Precision precision) {
+  /* (a^2, b^2) swapped to (b^2, a^2), so that both lanes get a^2 + b^2 */
+  const __m512 sq = _mm512_mul_ps(data, data);
+  const __m512 abs_sq = _mm512_add_ps(sq, _mm512_permute_ps(sq, 0xb1));
+  const __mmask16 nonzero =
+      _mm512_cmp_ps_mask(abs_sq, _mm512_setzero_ps(), _CMP_NEQ_OQ);
+  switch (precision) {
+    case FastMath::Precision::kRefined:
+      return _mm512_maskz_mul_ps(
+          nonzero, data,
+          FastMath::Rsqrt<FastMath::Precision::kRefined>(abs_sq));
+    case FastMath::Precision::kApprox:
+      return _mm512_maskz_mul_ps(
+          nonzero, data,
+          FastMath::Rsqrt<FastMath::Precision::kApprox>(abs_sq));
+    default:
+      return _mm512_maskz_div_ps(nonzero, data, _mm512_sqrt_ps(abs_sq));
+  }
+}
+#endif
+
 std::complex<float> CommsLib::M256ComplexCf32Sum(__m256 data) {
   const __m256i real_mask = _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
   const __m256i imag_mask = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
@@ -27,6 +27,7 @@
 #include "comms-constants.inc"
 #include "datatype_conversion.h"
 #include "logger.h"
+#include "mkl_dft_cache.h"
 #include "utils.h"
 
 size_t CommsLib::FindPilotSeq(const std::vector<std::complex<float>>& iq,
@@ -152,6 +153,24 @@ float CommsLib::FindMeanAbs(const Table<complex_float>& in, size_t dim1,
   return mean_val / (dim1 * dim2);
 }
 
+float CommsLib::EstimateCfoCp(const short* iq, size_t cp_len,
+                              size_t fft_size) {
+  // The cyclic prefix repeats the end of the symbol fft_size samples later,
+  // so conj(cp) * end turns by the offset times fft_size. Exact in integers.
+  int64_t corr_re = 0;
+  int64_t corr_im = 0;
+  const short* end = iq + (2 * fft_size);
+  for (size_t i = 0; i < 2 * cp_len; i += 2) {
+    corr_re += (static_cast<int64_t>(iq[i]) * end[i]) +
+               (static_cast<int64_t>(iq[i + 1]) * end[i + 1]);
+    corr_im += (static_cast<int64_t>(iq[i]) * end[i + 1]) -
+               (static_cast<int64_t>(iq[i + 1]) * end[i]);
+  }
+  return static_cast<float>(
+      std::atan2(static_cast<double>(corr_im), static_cast<double>(corr_re)) /
+      static_cast<double>(fft_size));
+}
+
 float CommsLib::FindMeanAbs(const complex_float* in, size_t len) {
   float mean_val = 0;
   for (size_t j = 0; j < len; j++) {
@@ -407,33 +426,19 @@ std::vector<size_t> CommsLib::GetPilotScIdx(size_t fft_size, size_t data_sc_num,
   return pilot_sc;
 }
 
+// A descriptor serves both directions, and every transform here is in place
+CommsLib::DftHold::DftHold(size_t fft_size)
+    : handle_(MklDftCache::Acquire(fft_size)) {}
+
+CommsLib::DftHold::~DftHold() { MklDftCache::Release(handle_); }
+
 MKL_LONG CommsLib::IFFT(std::vector<std::complex<float>>& in_out, int fft_size,
                         bool normalize) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  MKL_LONG status;
-  status =
-      DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, fft_size);
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error creating descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiCommitDescriptor(mkl_handle);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error committing descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiComputeBackward(mkl_handle, in_out.data());
-  }
+  const DftHold dft(fft_size);
+  const MKL_LONG status = DftiComputeBackward(dft.Handle(), in_out.data());
   if (status != DFTI_NO_ERROR) {
     AGORA_LOG_ERROR("Error compute backward in CommsLib::IFFT%s\n",
                     DftiErrorMessage(status));
-  } else {
-    status = DftiFreeDescriptor(&mkl_handle);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error free descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
   } else {
     if (normalize) {
       float max_val = 0;
@@ -458,63 +463,22 @@ MKL_LONG CommsLib::IFFT(std::vector<std::complex<float>>& in_out, int fft_size,
 }
 
 MKL_LONG CommsLib::FFT(std::vector<std::complex<float>>& in_out, int fft_size) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  MKL_LONG status =
-      DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, fft_size);
-
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error creating descriptor in CommsLib::FFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiCommitDescriptor(mkl_handle);
-  }
-
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error committing descriptor in CommsLib::FFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    /* compute FFT */
-    status = DftiComputeForward(mkl_handle, in_out.data());
-  }
+  /* compute FFT */
+  const DftHold dft(fft_size);
+  const MKL_LONG status = DftiComputeForward(dft.Handle(), in_out.data());
   if (status != DFTI_NO_ERROR) {
     AGORA_LOG_ERROR("Error compute forward in CommsLib::FFT%s\n",
                     DftiErrorMessage(status));
-  } else {
-    status = DftiFreeDescriptor(&mkl_handle);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error freeing descriptor in CommsLib::FFT%s\n",
-                    DftiErrorMessage(status));
   }
   return status;
 }
 
 MKL_LONG CommsLib::IFFT(complex_float* in_out, int fft_size, bool normalize) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-
-  MKL_LONG status =
-      DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, fft_size);
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error creating descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiCommitDescriptor(mkl_handle);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error committing descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiComputeBackward(mkl_handle, in_out);
-  }
+  const DftHold dft(fft_size);
+  const MKL_LONG status = DftiComputeBackward(dft.Handle(), in_out);
   if (status != DFTI_NO_ERROR) {
     AGORA_LOG_ERROR("Error compute backward in CommsLib::IFFT%s\n",
                     DftiErrorMessage(status));
-  } else {
-    status = DftiFreeDescriptor(&mkl_handle);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error free descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
   } else {
     if (normalize == true) {
       float max_val = 0;
@@ -543,30 +507,11 @@ MKL_LONG CommsLib::IFFT(complex_float* in_out, int fft_size, bool normalize) {
 }
 
 MKL_LONG CommsLib::FFT(complex_float* in_out, int fft_size) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  MKL_LONG status =
-      DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, fft_size);
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error creating descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiCommitDescriptor(mkl_handle);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error committing descriptor in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    /* compute FFT */
-    status = DftiComputeForward(mkl_handle, in_out);
-  }
-  if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error computing forward in CommsLib::IFFT%s\n",
-                    DftiErrorMessage(status));
-  } else {
-    status = DftiFreeDescriptor(&mkl_handle);
-  }
+  /* compute FFT */
+  const DftHold dft(fft_size);
+  const MKL_LONG status = DftiComputeForward(dft.Handle(), in_out);
   if (status != DFTI_NO_ERROR) {
-    AGORA_LOG_ERROR("Error freeing descriptor in CommsLib::IFFT%s\n",
+    AGORA_LOG_ERROR("Error computing forward in CommsLib::FFT%s\n",
                     DftiErrorMessage(status));
   }
   return status;
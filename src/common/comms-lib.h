@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "common_typedef_sdk.h"
+#include "fast_math.h"
 #include "immintrin.h"
 #include "memory_manage.h"
 #include "mkl_dfti.h"
@@ -101,6 +102,23 @@ class CommsLib {
   static MKL_LONG FFT(complex_float* in_out, int fft_size);
   static MKL_LONG IFFT(complex_float* in_out, int fft_size,
                        bool normalize = true);
+
+  /// Holds the committed descriptor of the fft_size-point FFT() and IFFT()
+  /// in MklDftCache while in scope. FFT() and IFFT() hold it for the call;
+  /// a caller that loops over them holds it around the loop, so that it is
+  /// committed once.
+  class DftHold {
+   public:
+    explicit DftHold(size_t fft_size);
+    ~DftHold();
+    DftHold(const DftHold&) = delete;
+    DftHold& operator=(const DftHold&) = delete;
+
+    inline DFTI_DESCRIPTOR_HANDLE Handle() const { return handle_; }
+
+   private:
+    DFTI_DESCRIPTOR_HANDLE handle_;
+  };
   static std::vector<std::complex<float>> FFTShift(
       const std::vector<std::complex<float>>& in);
   static std::vector<complex_float> FFTShift(
@@ -153,6 +171,12 @@ class CommsLib {
                            size_t dim2);
   static void Ifft2tx(const complex_float* in, std::complex<short>* out,
                       size_t N, size_t prefix, size_t cp, float scale);
+  /// The carrier frequency offset of an OFDM symbol in radians per sample,
+  /// from the correlation of its cyclic prefix with the end of the symbol.
+  /// iq holds the cp_len interleaved int16 samples of the cyclic prefix,
+  /// then the fft_size samples of the symbol. Offsets up to half a
+  /// subcarrier spacing, pi / fft_size, are unambiguous.
+  static float EstimateCfoCp(const short* iq, size_t cp_len, size_t fft_size);
   static float AbsCf(complex_float d) {
     return std::abs(std::complex<float>(d.re, d.im));
   }
@@ -188,6 +212,13 @@ class CommsLib {
   static std::vector<std::complex<int16_t>> CorrelateAvx(
       std::vector<std::complex<int16_t>> const& f,
       std::vector<std::complex<int16_t>> const& g);
+  /// One-stream (1x1) zero-forcing equalization of len subcarriers,
+  /// out = (y / h) * phase, with AVX-512 or AVX2. No alignment is required.
+  /// The vectors take 1 / |h|^2 to precision.
+  static void EqualizeSisoCf32(
+      const complex_float* y, const complex_float* h, complex_float phase,
+      complex_float* out, size_t len,
+      FastMath::Precision precision = FastMath::Precision::kExact);
 
   static __m256 M256ComplexCf32Mult(__m256 data1, __m256 data2, bool conj);
   static __m256 M256ComplexCf32Reciprocal(__m256 data);
@@ -198,8 +229,11 @@ class CommsLib {
   static void PrintM256ComplexCf32(__m256 data);
 #ifdef __AVX512F__
   static __m512 M512ComplexCf32Mult(__m512 data1, __m512 data2, bool conj);
-  static __m512 M512ComplexCf32Reciprocal(__m512 data);
+  static __m512 M512ComplexCf32Reciprocal(
+      __m512 data, FastMath::Precision precision = FastMath::Precision::kExact);
   static __m512 M512ComplexCf32Conj(__m512 data);
+  static __m512 M512ComplexCf32Sign(
+      __m512 data, FastMath::Precision precision = FastMath::Precision::kExact);
   static __m512 M512ComplexCf32Set1(std::complex<float> data);
   static std::complex<float> M512ComplexCf32Sum(__m512 data);
   static bool M512ComplexCf32NearZeros(__m512 data, float threshold);
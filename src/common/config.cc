@@ -9,21 +9,31 @@
 
 #include "config.h"
 
+#include <sys/stat.h>
+
+#include <cstdint>
 #include <ctime>
 #include <filesystem>
+#include <sstream>
 #include <utility>
 
 #include "comms-constants.inc"
 #include "comms-lib.h"
 #include "data_generator.h"
+#include "data_tap.h"
 #include "datatype_conversion.h"
 #include "gettime.h"
+#include "int16_fft.h"
 #include "logger.h"
 #include "message.h"
 #include "modulation.h"
+#include "oran_fronthaul.h"
+#include "packed_iq.h"
+#include "packed_llr.h"
 #include "phy_ldpc_decoder_5gnr.h"
 #include "scrambler.h"
 #include "simd_types.h"
+#include "test_vector_file.h"
 #include "utils_ldpc.h"
 
 using json = nlohmann::json;
@@ -51,6 +61,8 @@ static const std::string kUlEncodedFilePrefix =
 static const std::string kDlDataFilePrefix =
     kExperimentFilepath + "LDPC_orig_dl_data_";
 static const std::string kUlDataFreqPrefix = kExperimentFilepath + "ul_data_f_";
+static const std::string kTestVectorFilePrefix =
+    kExperimentFilepath + "test_vectors_";
 
 Config::Config(std::string jsonfilename)
     : freq_ghz_(GetTime::MeasureRdtscFreq()),
@@ -60,6 +72,7 @@ Config::Config(std::string jsonfilename)
       frame_(""),
       pilot_ifft_(nullptr),
       config_filename_(std::move(jsonfilename)) {
+  const double init_start_us = GetTime::GetTimeUs();
   auto time = std::time(nullptr);
   auto local_time = *std::localtime(&time);
   timestamp_ = std::to_string(1900 + local_time.tm_year) + "-" +
@@ -87,7 +100,18 @@ Config::Config(std::string jsonfilename)
       excluded.at(i) = exclude_cores.at(i);
     }
   }
-  SetCpuLayoutOnNumaNodes(true, excluded);
+  if (tdd_conf.value("auto_core_layout", false)) {
+    // Place the threads near the NIC and accelerator
+    auto devices = tdd_conf.value("core_layout_devices",
+                                  std::vector<std::string>());
+    const std::string xdp_interface = tdd_conf.value("xdp_interface", "");
+    if (xdp_interface.empty() == false) {
+      devices.push_back(xdp_interface);
+    }
+    SetCpuLayoutFromTopology(true, excluded, devices);
+  } else {
+    SetCpuLayoutOnNumaNodes(true, excluded);
+  }
 
   num_cells_ = tdd_conf.value("cells", 1);
   num_radios_ = 0;
@@ -289,17 +313,79 @@ Config::Config(std::string jsonfilename)
   dpdk_num_ports_ = tdd_conf.value("dpdk_num_ports", 1);
   dpdk_port_offset_ = tdd_conf.value("dpdk_port_offset", 0);
   dpdk_mac_addrs_ = tdd_conf.value("dpdk_mac_addrs", "");
+  dpdk_zero_copy_rx_ = tdd_conf.value("dpdk_zero_copy_rx", false);
+  dpdk_zero_copy_tx_ = tdd_conf.value("dpdk_zero_copy_tx", false);
+  dpdk_rx_burst_ = tdd_conf.value("dpdk_rx_burst", 16);
+  dpdk_adaptive_rx_burst_ = tdd_conf.value("dpdk_adaptive_rx_burst", false);
+  dpdk_drop_unmatched_ = tdd_conf.value("dpdk_drop_unmatched", false);
+  // [8, 8]: the interfaces (radios) of each NIC port, in the order of the
+  // ports. Empty splits the interfaces evenly.
+  dpdk_port_interfaces_ = tdd_conf.value("dpdk_port_interfaces",
+                                         std::vector<size_t>());
+  RtAssert(dpdk_port_interfaces_.empty() ||
+               (dpdk_port_interfaces_.size() == dpdk_num_ports_),
+           "dpdk_port_interfaces needs one entry per dpdk_num_ports");
+
+  xdp_interface_ = tdd_conf.value("xdp_interface", "");
+  xdp_queue_offset_ = tdd_conf.value("xdp_queue_offset", 0);
+  xdp_zero_copy_ = tdd_conf.value("xdp_zero_copy", false);
+
+  usrp_rx_streaming_ = tdd_conf.value("usrp_rx_streaming", false);
+  usrp_tx_burst_ = tdd_conf.value("usrp_tx_burst", false);
+  hw_zero_copy_rx_ = tdd_conf.value("hw_zero_copy_rx", false);
 
   ue_mac_tx_port_ = tdd_conf.value("ue_mac_tx_port", kMacUserRemotePort);
   ue_mac_rx_port_ = tdd_conf.value("ue_mac_rx_port", kMacUserLocalPort);
   bs_mac_tx_port_ = tdd_conf.value("bs_mac_tx_port", kMacBaseRemotePort);
   bs_mac_rx_port_ = tdd_conf.value("bs_mac_rx_port", kMacBaseLocalPort);
+  mac_tb_ring_ = tdd_conf.value("mac_tb_ring", false);
+  mac_ring_hugepage_ = tdd_conf.value("mac_ring_hugepage", false);
+  const std::string mac_scheduler =
+      tdd_conf.value("mac_scheduler", std::string("round_robin"));
+  RtAssert(mac_scheduler == "round_robin" ||
+               mac_scheduler == "proportional_fair",
+           "Unknown mac_scheduler " + mac_scheduler +
+               ", valid schedulers are round_robin and proportional_fair");
+  mac_scheduler_pf_ = (mac_scheduler == "proportional_fair");
+  pf_window_frames_ = tdd_conf.value("pf_window_frames", 100);
+  RtAssert(pf_window_frames_ > 0, "pf_window_frames must be positive");
+  ue_grouping_ = tdd_conf.value("ue_grouping", false);
+  ue_grouping_max_corr_ = tdd_conf.value("ue_grouping_max_corr", 0.5f);
+  RtAssert(ue_grouping_max_corr_ >= 0.0f && ue_grouping_max_corr_ <= 1.0f,
+           "ue_grouping_max_corr must be in [0, 1]");
+  ul_offered_load_ = tdd_conf.value("ul_offered_load", 1.0f);
+  dl_offered_load_ = tdd_conf.value("dl_offered_load", 1.0f);
+  RtAssert(ul_offered_load_ >= 0.0f && ul_offered_load_ <= 1.0f &&
+               dl_offered_load_ >= 0.0f && dl_offered_load_ <= 1.0f,
+           "ul_offered_load and dl_offered_load must be in [0, 1]");
 
   log_listener_addr_ = tdd_conf.value("log_listener_addr", "");
   log_listener_port_ = tdd_conf.value("log_listener_port", 33300);
 
+  task_trace_events_ = tdd_conf.value("task_trace_events", 0);
+  frame_log_ = tdd_conf.value("frame_log", false);
+  perf_sample_interval_ = tdd_conf.value("perf_sample_interval", 0);
+  stall_factor_ = tdd_conf.value("stall_factor", 0.0);
+  stall_min_us_ = tdd_conf.value("stall_min_us", 1000.0);
+  RtAssert(stall_factor_ >= 0.0 && stall_min_us_ > 0.0,
+           "stall_factor must not be negative and stall_min_us must be "
+           "positive");
+
+  telemetry_addr_ = tdd_conf.value("telemetry_addr", "127.0.0.1");
+  bs_telemetry_port_ = tdd_conf.value("bs_telemetry_port", 0);
+  ue_telemetry_port_ = tdd_conf.value("ue_telemetry_port", 0);
+  telemetry_interval_ms_ = tdd_conf.value("telemetry_interval_ms", 100.0);
+  RtAssert(telemetry_interval_ms_ > 0.0,
+           "telemetry_interval_ms must be positive");
+
   log_sc_num_ = tdd_conf.value("log_sc_num", 4);
   log_timestamp_ = tdd_conf.value("log_timestamp", false);
+  phy_stats_frame_sampling_ = tdd_conf.value("phy_stats_frame_sampling", 1);
+  phy_stats_sc_sampling_ = tdd_conf.value("phy_stats_sc_sampling", 1);
+  RtAssert(phy_stats_frame_sampling_ > 0 && phy_stats_sc_sampling_ > 0,
+           "phy_stats_frame_sampling and phy_stats_sc_sampling must be "
+           "positive");
+  blind_link_quality_ = tdd_conf.value("blind_link_quality", false);
 
   /* frame configurations */
   cp_len_ = tdd_conf.value("cp_size", 0);
@@ -324,6 +410,20 @@ Config::Config(std::string jsonfilename)
                                         kSCsPerCacheline * kSCsPerCacheline);
   RtAssert(ofdm_data_start_ % kSCsPerCacheline == 0,
            "ofdm_data_start must be a multiple of subcarriers per cacheline");
+  // A carrier too wide for one server is split into equal subcarrier slices,
+  // one per node. This node processes slice sc_slice_node, so from here on
+  // ofdm_data_num and ofdm_data_start describe the slice.
+  sc_slice_nodes_ = tdd_conf.value("sc_slice_nodes", 1);
+  sc_slice_node_ = tdd_conf.value("sc_slice_node", 0);
+  RtAssert((sc_slice_nodes_ > 0) && (sc_slice_node_ < sc_slice_nodes_),
+           "sc_slice_node must be less than sc_slice_nodes");
+  RtAssert(ofdm_data_num_ % (sc_slice_nodes_ * kTransposeBlockSize) == 0,
+           "ofdm_data_num must split into sc_slice_nodes slices of whole "
+           "transpose blocks");
+  carrier_data_num_ = ofdm_data_num_;
+  ofdm_data_num_ = carrier_data_num_ / sc_slice_nodes_;
+  sc_slice_start_ = sc_slice_node_ * ofdm_data_num_;
+  ofdm_data_start_ += sc_slice_start_;
   ofdm_data_stop_ = ofdm_data_start_ + ofdm_data_num_;
 
   // Build subcarrier map for data ofdm symbols
@@ -342,6 +442,7 @@ Config::Config(std::string jsonfilename)
     } else {
       dl_symbol_map_.at(i) = SubcarrierType::kData;
       dl_symbol_data_id_.at(i) = data_idx;
+      dl_data_sc_id_.push_back(i);
       data_idx++;
       if (i % ofdm_pilot_spacing_ == 1) {
         control_symbol_map_.at(i) = SubcarrierType::kPTRS;
@@ -386,6 +487,12 @@ Config::Config(std::string jsonfilename)
            "unsupported in this version of Agora");
   ue_resync_period_ = tdd_conf.value("ue_resync_period", 0);
 
+  analog_beams_ = tdd_conf.value("analog_beams", 0);
+  beam_sweep_interval_ =
+      tdd_conf.value("beam_sweep_interval", 10 * analog_beams_);
+  RtAssert(beam_sweep_interval_ >= analog_beams_,
+           "beam_sweep_interval must be at least analog_beams");
+
   // If frames not specified explicitly, construct default based on frame_type /
   // symbol_num_perframe / pilot_num / ul_symbol_num_perframe /
   // dl_symbol_num_perframe / dl_data_symbol_start
@@ -535,6 +642,10 @@ Config::Config(std::string jsonfilename)
   }
   AGORA_LOG_INFO("Config: Frame schedule %s (%zu symbols)\n",
                  frame_.FrameIdentifier().c_str(), frame_.NumTotalSyms());
+  symbol_types_.clear();
+  for (const char symbol : frame_.FrameIdentifier()) {
+    symbol_types_.push_back(kSymbolMap.at(symbol));
+  }
 
   if (frame_.IsRecCalEnabled()) {
     RtAssert(bf_ant_num_ >= frame_.NumDLCalSyms(),
@@ -618,21 +729,385 @@ Config::Config(std::string jsonfilename)
       "_" + std::to_string(num_cells_) + "_" + std::to_string(BsAntNum()) +
       "x" + std::to_string(UeAntTotal()) + ".hdf5";
   trace_file_ = tdd_conf.value("trace_file", filename);
+  recorder_writer_threads_ = tdd_conf.value("recorder_writer_threads", 0);
+  auto recorder_chunk =
+      tdd_conf.value("recorder_chunk", json::array({1, 1, 1}));
+  RtAssert(recorder_chunk.size() == recorder_chunk_.size(),
+           "recorder_chunk must be [frames, symbols, antennas]");
+  for (size_t i = 0; i < recorder_chunk_.size(); i++) {
+    recorder_chunk_.at(i) = recorder_chunk.at(i).get<size_t>();
+    RtAssert(recorder_chunk_.at(i) > 0,
+             "recorder_chunk dimensions must be greater than 0");
+  }
+  recorder_compression_ = tdd_conf.value("recorder_compression", 0);
+  RtAssert(recorder_compression_ <= 9,
+           "recorder_compression must be a deflate level from 0 to 9");
+  recorder_staging_chunks_ = tdd_conf.value("recorder_staging_chunks", 64);
+  RtAssert(recorder_staging_chunks_ > 0,
+           "recorder_staging_chunks must be greater than 0");
+  recorder_drop_when_full_ = tdd_conf.value("recorder_drop_when_full", false);
+  recorder_direct_io_ = tdd_conf.value("recorder_direct_io", false);
+  recorder_io_depth_ = tdd_conf.value("recorder_io_depth", 32);
+  RtAssert(recorder_io_depth_ > 0, "recorder_io_depth must be greater than 0");
+  recorder_fsync_batch_ = tdd_conf.value("recorder_fsync_batch", 256);
+  recorder_lag_frames_ = tdd_conf.value("recorder_lag_frames", 0);
+  // All antennas by default
+  recorder_antennas_ = {0, SIZE_MAX};
+  if (tdd_conf.contains("recorder_antennas")) {
+    const auto recorder_antennas = tdd_conf.at("recorder_antennas");
+    RtAssert(recorder_antennas.size() == recorder_antennas_.size(),
+             "recorder_antennas must be [first antenna, antennas]");
+    for (size_t i = 0; i < recorder_antennas_.size(); i++) {
+      recorder_antennas_.at(i) = recorder_antennas.at(i).get<size_t>();
+    }
+    RtAssert(recorder_antennas_.at(1) > 0,
+             "recorder_antennas must hold at least one antenna");
+  }
+  static const std::map<std::string, SymbolType> kRecorderSymbolNames = {
+      {"beacon", SymbolType::kBeacon},
+      {"pilot", SymbolType::kPilot},
+      {"ul", SymbolType::kUL},
+      {"dl", SymbolType::kDL}};
+  const auto recorder_symbols = tdd_conf.value(
+      "recorder_symbols",
+      std::vector<std::string>({"beacon", "pilot", "ul", "dl"}));
+  for (const auto& symbol : recorder_symbols) {
+    const auto type = kRecorderSymbolNames.find(symbol);
+    RtAssert(type != kRecorderSymbolNames.end(),
+             "recorder_symbols can only hold beacon, pilot, ul and dl");
+    recorder_symbols_.push_back(type->second);
+  }
+  recorder_frame_decimation_ = tdd_conf.value("recorder_frame_decimation", 1);
+  RtAssert(recorder_frame_decimation_ > 0,
+           "recorder_frame_decimation must be greater than 0");
+  const std::string recorder_sample_format =
+      tdd_conf.value("recorder_sample_format", "int16");
+  recorder_sample_format_ = IqFormat::kInt16;
+  for (const auto format : {IqFormat::kInt8, IqFormat::kBfp}) {
+    if (recorder_sample_format == IqFormatName(format)) {
+      recorder_sample_format_ = format;
+    }
+  }
+  RtAssert(recorder_sample_format == IqFormatName(recorder_sample_format_),
+           "recorder_sample_format must be int16, int8 or bfp");
+  capture_frames_ = tdd_conf.value("capture_frames", 0);
+  capture_tables_ =
+      tdd_conf.value("capture_tables", std::vector<std::string>());
+  for (const auto& table : capture_tables_) {
+    RtAssert((table == "csi") || (table == "equal") || (table == "demod"),
+             "capture_tables can only hold csi, equal and demod");
+  }
+  RtAssert(capture_tables_.empty() || (capture_frames_ > 0),
+           "capture_tables needs capture_frames greater than 0");
+  RtAssert(capture_tables_.empty() || (frame_.NumULSyms() > 0),
+           "capture_tables needs uplink symbols");
+  tap_points_ = tdd_conf.value("tap_points", std::vector<std::string>());
+  for (const auto& point_name : tap_points_) {
+    TapPoint point;
+    RtAssert(TapPointFromName(point_name, point),
+             "tap_points can only hold fft_iq, csi, beams, equal, llr and "
+             "decoded");
+  }
+  tap_subsample_ = tdd_conf.value("tap_subsample", 1);
+  RtAssert(tap_subsample_ > 0, "tap_subsample must be greater than 0");
+  tap_slots_ = tdd_conf.value("tap_slots", 1024);
+  RtAssert(tap_slots_ > 0, "tap_slots must be greater than 0");
+  tap_name_ = tdd_conf.value("tap_name", "");
+  capture_crc_burst_ = tdd_conf.value("capture_crc_burst", 0);
+  capture_evm_drop_ = tdd_conf.value("capture_evm_drop", 0.0f);
+  capture_deadline_miss_ = tdd_conf.value("capture_deadline_miss", false);
 
   // Agora configurations
   frames_to_test_ = tdd_conf.value("max_frame", 9600);
   core_offset_ = tdd_conf.value("core_offset", 0);
   worker_thread_num_ = tdd_conf.value("worker_thread_num", 25);
+#ifdef SINGLE_THREAD
+  const std::string default_execution_model = "single_core";
+#else
+  const std::string default_execution_model = "multi_core";
+#endif
+  const std::string execution_model_str =
+      tdd_conf.value("execution_model", default_execution_model);
+  RtAssert(kExecutionModelStr.count(execution_model_str) > 0,
+           "Unknown execution_model " + execution_model_str +
+               ", valid models are multi_core, single_core and "
+               "master_assisted");
+  execution_model_ = kExecutionModelStr.at(execution_model_str);
+  if (execution_model_ == ExecutionModel::kSingleCore) {
+    RtAssert(worker_thread_num_ == 1,
+             "single_core execution allows only 1 worker thread");
+  } else {
+    RtAssert(worker_thread_num_ >= 1, "worker_thread_num must be at least 1");
+  }
+  const std::string task_scheduler =
+      tdd_conf.value("task_scheduler", std::string("queues"));
+  RtAssert(task_scheduler == "queues" || task_scheduler == "work_stealing",
+           "Unknown task_scheduler " + task_scheduler +
+               ", valid schedulers are queues and work_stealing");
+  work_stealing_ = (task_scheduler == "work_stealing");
+  // Workers that the decode tasks of each UE go to, 0 to spread them over all
+  decode_ue_affinity_ = tdd_conf.value("decode_ue_affinity", 0);
+  RtAssert((decode_ue_affinity_ == 0) || work_stealing_,
+           "decode_ue_affinity needs the work_stealing task_scheduler");
+  RtAssert(decode_ue_affinity_ <= worker_thread_num_,
+           "decode_ue_affinity must not exceed worker_thread_num");
+  // {"fft": [0, 1], "beam+demul": [2, 3]}: the worker threads of each group
+  // of stages
+  const json worker_groups = tdd_conf.value("worker_groups", json::object());
+  for (const auto& group : worker_groups.items()) {
+    const auto workers = group.value().get<std::vector<size_t>>();
+    RtAssert(workers.empty() == false,
+             "worker_groups: no workers for " + group.key());
+    for (size_t worker : workers) {
+      RtAssert(worker < worker_thread_num_,
+               "worker_groups: worker " + std::to_string(worker) +
+                   " of " + group.key() + " is not below worker_thread_num");
+    }
+    std::stringstream stages(group.key());
+    std::string stage;
+    while (std::getline(stages, stage, '+')) {
+      RtAssert(kWorkerGroupStages.count(stage) > 0,
+               "worker_groups: unknown stage " + stage +
+                   ", valid stages are fft, beam, demul, decode, encode, "
+                   "precode and ifft");
+      RtAssert(worker_groups_.emplace(stage, workers).second,
+               "worker_groups: stage " + stage + " is in two groups");
+    }
+  }
+  // The work-stealing deques are per worker, not per task type
+  RtAssert(worker_groups_.empty() || (work_stealing_ == false),
+           "worker_groups needs the queues task_scheduler");
+  // {"txrx": {"l3_mask": "0x00f", "mba": 50}, "worker_decode": {...}}: the
+  // cache ways and memory bandwidth of each thread class
+  const json resctrl = tdd_conf.value("resctrl", json::object());
+  for (const auto& thread_class : resctrl.items()) {
+    const std::string& name = thread_class.key();
+    const bool worker_stage = (name.rfind("worker_", 0) == 0);
+    RtAssert((Resctrl::kClasses.count(name) > 0) || worker_stage,
+             "resctrl: unknown thread class " + name +
+                 ", valid classes are master, txrx, worker, worker_<stage>, "
+                 "mac and recorder");
+    RtAssert((worker_stage == false) ||
+                 (worker_groups_.count(name.substr(7)) > 0),
+             "resctrl: " + name + " needs a worker group for its stage");
+    Resctrl::ClassAllocation allocation;
+    allocation.l3_mask_ = thread_class.value().value("l3_mask", "");
+    allocation.mba_percent_ = thread_class.value().value("mba", 0);
+    RtAssert(allocation.l3_mask_.find_first_not_of(
+                 "0123456789abcdefABCDEFx") == std::string::npos,
+             "resctrl: l3_mask of " + name + " is not a hex mask");
+    RtAssert(allocation.mba_percent_ <= 100,
+             "resctrl: mba of " + name + " is above 100%");
+    resctrl_classes_.emplace(name, allocation);
+  }
+  worker_group_borrow_ = tdd_conf.value("worker_group_borrow", false);
+  idle_spin_us_ = tdd_conf.value("idle_spin_us", 2.0);
+  idle_pause_us_ = tdd_conf.value("idle_pause_us", 20.0);
+  idle_sleep_us_ = tdd_conf.value("idle_sleep_us", 0.0);
+  RtAssert(idle_spin_us_ >= 0.0 && idle_pause_us_ >= idle_spin_us_ &&
+               idle_sleep_us_ >= 0.0,
+           "idle_spin_us, idle_pause_us and idle_sleep_us must not be "
+           "negative, and idle_pause_us must not be below idle_spin_us");
+  dl_deadline_margin_us_ = tdd_conf.value("dl_deadline_margin_us", 0.0);
+  RtAssert(dl_deadline_margin_us_ >= 0.0,
+           "dl_deadline_margin_us must not be negative");
+  master_task_budget_us_ = tdd_conf.value("master_task_budget_us", 0.0);
+  RtAssert(master_task_budget_us_ >= 0.0,
+           "master_task_budget_us must not be negative");
+  RtAssert((master_task_budget_us_ == 0.0) ||
+               (execution_model_ != ExecutionModel::kMultiCore),
+           "master_task_budget_us needs the master thread to run tasks "
+           "(single_core or master_assisted)");
+  rx_frame_timeout_us_ = tdd_conf.value("rx_frame_timeout_us", 0.0);
+  RtAssert(rx_frame_timeout_us_ >= 0.0,
+           "rx_frame_timeout_us must not be negative");
+  // The missing calibration packets skip the FFT counting of bigstation mode
+  RtAssert((rx_frame_timeout_us_ == 0.0) || (bigstation_mode_ == false),
+           "rx_frame_timeout_us needs bigstation_mode off");
+  pipeline_depth_ = tdd_conf.value("pipeline_depth", kScheduleQueues);
+  RtAssert(pipeline_depth_ >= 1 && pipeline_depth_ <= kMaxScheduleQueues,
+           "pipeline_depth must be in [1, " +
+               std::to_string(kMaxScheduleQueues) + "]");
+  frame_window_ = tdd_conf.value("frame_window", kFrameWnd);
+  RtAssert(frame_window_ > pipeline_depth_ && frame_window_ <= kFrameWnd,
+           "frame_window must be in (" + std::to_string(pipeline_depth_) +
+               ", " + std::to_string(kFrameWnd) + "]");
+  // Count the received packets and schedule their FFT on a thread of their
+  // own (RxManager) instead of the master
+  rx_manager_ = tdd_conf.value("rx_manager", false);
+  // The RX timeout and the FFT counting of bigstation mode move the frames
+  // of the master on from the received packets, and only the master pushes
+  // to the work-stealing deques
+  RtAssert((rx_manager_ == false) ||
+               ((rx_frame_timeout_us_ == 0.0) && (bigstation_mode_ == false) &&
+                (work_stealing_ == false)),
+           "rx_manager needs rx_frame_timeout_us 0, bigstation_mode off and "
+           "task_scheduler queues");
+  adaptive_dequeue_ = tdd_conf.value("adaptive_dequeue", false);
+  // One single-producer single-consumer ring per TxRx thread instead of the
+  // shared RX concurrent queue
+  rx_event_rings_ = tdd_conf.value("rx_event_rings", false);
+  // The master polls the fronthaul between its tasks, so that one core runs
+  // the whole cell
+  inline_txrx_ = tdd_conf.value("inline_txrx", false);
+  RtAssert((inline_txrx_ == false) ||
+               ((execution_model_ == ExecutionModel::kSingleCore) &&
+                (rx_event_rings_ == false) && (rx_manager_ == false)),
+           "inline_txrx needs the single_core execution model, with "
+           "rx_event_rings and rx_manager off");
+  const std::string buffer_page_type =
+      tdd_conf.value("buffer_page_type", std::string("default"));
+  if (buffer_page_type == "2M") {
+    buffer_page_type_ = Agora_memory::PageType::kHuge2M;
+  } else if (buffer_page_type == "1G") {
+    buffer_page_type_ = Agora_memory::PageType::kHuge1G;
+  } else {
+    RtAssert(buffer_page_type == "default",
+             "Unknown buffer_page_type " + buffer_page_type +
+                 ", valid page types are default, 2M and 1G");
+    buffer_page_type_ = Agora_memory::PageType::kDefault;
+  }
+  numa_bind_buffers_ = tdd_conf.value("numa_bind_buffers", false);
+  prefault_buffers_ = tdd_conf.value("prefault_buffers", false);
+  lock_memory_ = tdd_conf.value("lock_memory", false);
+  event_batching_ = tdd_conf.value("event_batching", true);
+  adaptive_block_target_us_ =
+      tdd_conf.value("adaptive_block_target_us", 0.0);
+  RtAssert(adaptive_block_target_us_ >= 0.0,
+           "adaptive_block_target_us must not be negative");
+  shared_counters_ = tdd_conf.value("shared_counters", false);
+  bench_mode_ = tdd_conf.value("bench_mode", false);
+  bench_frame_duration_us_ = tdd_conf.value("bench_frame_duration_us", 0.0);
+  RtAssert(bench_frame_duration_us_ >= 0.0,
+           "bench_frame_duration_us must not be negative");
+  fuse_fft_demul_ = tdd_conf.value("fuse_fft_demul", false);
+  fft_batch_symbol_ = tdd_conf.value("fft_batch_symbol", false);
+  fft_backend_ = tdd_conf.value("fft_backend", "mkl");
+  fft_wisdom_file_ =
+      tdd_conf.value("fft_wisdom_file", kExperimentFilepath + "fftw_wisdom");
+  fuse_precode_ifft_ = tdd_conf.value("fuse_precode_ifft", false);
+  ifft_batch_symbol_ = tdd_conf.value("ifft_batch_symbol", false);
+  batch_encode_ = tdd_conf.value("batch_encode", false);
+  fuse_encode_modulation_ = tdd_conf.value("fuse_encode_modulation", false);
+  adaptive_decode_iter_ = tdd_conf.value("adaptive_decode_iter", false);
+  min_decoder_iter_ = tdd_conf.value("min_decoder_iter", 2);
+  decode_iter_snr_low_db_ = tdd_conf.value("decode_iter_snr_low_db", 5.0f);
+  decode_iter_snr_high_db_ = tdd_conf.value("decode_iter_snr_high_db", 20.0f);
+  decode_overload_us_ = tdd_conf.value("decode_overload_us", 0.0);
+  RtAssert(decode_iter_snr_low_db_ < decode_iter_snr_high_db_,
+           "decode_iter_snr_low_db must be below decode_iter_snr_high_db");
+  RtAssert(min_decoder_iter_ > 0, "min_decoder_iter must be positive");
+  ul_beam_int16_ = tdd_conf.value("ul_beam_int16", false);
+  gemm_batch_ = tdd_conf.value("gemm_batch", false);
+  task_prefetch_ = tdd_conf.value("task_prefetch", false);
+  // The output buffers written with non-temporal stores. By default those
+  // that dofft and doifft always streamed.
+  nt_stores_ = tdd_conf.value(
+      "nt_stores", std::vector<std::string>({"csi", "fft", "ifft"}));
+  for (const auto& buffer : nt_stores_) {
+    RtAssert((buffer == "csi") || (buffer == "fft") || (buffer == "ifft") ||
+                 (buffer == "decode") || (buffer == "recorder"),
+             "nt_stores can only hold csi, fft, ifft, decode and recorder");
+  }
+  early_decode_ = tdd_conf.value("early_decode", false);
+  // The code blocks are released by the completions of single demul blocks
+  RtAssert((early_decode_ == false) ||
+               ((shared_counters_ == false) && (bigstation_mode_ == false)),
+           "early_decode needs shared_counters and bigstation_mode off");
+  harq_processes_ = tdd_conf.value("harq_processes", 0);
+  harq_max_tx_ = tdd_conf.value("harq_max_tx", 4);
+  harq_llr_bits_ = tdd_conf.value("harq_llr_bits", 8);
+  if (harq_processes_ > 0) {
+    // A process must not be reused by a frame that is still in flight
+    RtAssert(harq_processes_ >= frame_window_,
+             "harq_processes must be at least the frame window");
+    // The scheduled UEs send new data every frame
+    RtAssert(kEnableMac == false, "harq_processes needs the MAC disabled");
+    RtAssert((harq_llr_bits_ == 8) || (harq_llr_bits_ == 4),
+             "harq_llr_bits must be 8 or 4");
+    RtAssert(harq_max_tx_ > 0, "harq_max_tx must be positive");
+  }
+  acc_spill_ops_ = tdd_conf.value("acc_spill_ops", 0);
+  acc_spill_latency_us_ = tdd_conf.value("acc_spill_latency_us", 0.0);
+  RtAssert(acc_spill_latency_us_ >= 0.0,
+           "acc_spill_latency_us must not be negative");
+  RtAssert((acc_spill_latency_us_ == 0.0) || (acc_spill_ops_ > 0),
+           "acc_spill_latency_us needs acc_spill_ops");
+  const std::string acc_batch_policy_str =
+      tdd_conf.value("acc_batch_policy", "request");
+  RtAssert(kAccBatchPolicyStr.count(acc_batch_policy_str) > 0,
+           "Unknown acc_batch_policy " + acc_batch_policy_str);
+  acc_batch_policy_ = kAccBatchPolicyStr.at(acc_batch_policy_str);
+  acc_batch_latency_us_ = tdd_conf.value("acc_batch_latency_us", 200.0);
+  acc_batch_max_ops_ = tdd_conf.value("acc_batch_max_ops", 256);
+  RtAssert(acc_batch_latency_us_ > 0.0,
+           "acc_batch_latency_us must be positive");
+  RtAssert(acc_batch_max_ops_ > 0, "acc_batch_max_ops must be positive");
+  // An SR-IOV VF of the card is a bbdev device of its own, so cells in one
+  // process can each use their own VF
+  const size_t bbdev_dev_id = tdd_conf.value("bbdev_dev_id", 0);
+  RtAssert(bbdev_dev_id <= UINT8_MAX, "bbdev_dev_id must be below 256");
+  bbdev_dev_id_ = static_cast<uint8_t>(bbdev_dev_id);
+  // The UE emulator decodes the downlink on the card if ue_acc_decode, with
+  // its own device, e.g. a VF that the base station does not use
+  ue_acc_decode_ = tdd_conf.value("ue_acc_decode", false);
+  RtAssert(kUseAcc100 || (ue_acc_decode_ == false),
+           "ue_acc_decode needs a build with LDPC_TYPE=ACC100");
+  const size_t ue_bbdev_dev_id =
+      tdd_conf.value("ue_bbdev_dev_id", bbdev_dev_id);
+  RtAssert(ue_bbdev_dev_id <= UINT8_MAX, "ue_bbdev_dev_id must be below 256");
+  ue_bbdev_dev_id_ = static_cast<uint8_t>(ue_bbdev_dev_id);
+  const json stage_deadlines =
+      tdd_conf.value("stage_deadlines_us", json::object());
+  for (const auto& deadline : stage_deadlines.items()) {
+    stage_deadlines_us_.emplace(deadline.key(), deadline.value().get<double>());
+  }
+  fast_math_.fill(FastMath::Precision::kExact);
+  const json fast_math = tdd_conf.value("fast_math", json::object());
+  for (const auto& tier : fast_math.items()) {
+    const auto family = std::find(FastMath::kFamilyNames.begin(),
+                                  FastMath::kFamilyNames.end(), tier.key());
+    RtAssert(family != FastMath::kFamilyNames.end(),
+             "Unknown kernel family " + tier.key() + " in fast_math");
+    const auto precision = std::find(FastMath::kPrecisionNames.begin(),
+                                     FastMath::kPrecisionNames.end(),
+                                     tier.value().get<std::string>());
+    RtAssert(precision != FastMath::kPrecisionNames.end(),
+             "fast_math tiers must be exact, refined or approx");
+    fast_math_.at(family - FastMath::kFamilyNames.begin()) =
+        static_cast<FastMath::Precision>(precision -
+                                         FastMath::kPrecisionNames.begin());
+  }
+  latency_report_interval_ = tdd_conf.value("latency_report_interval", 0);
+  // Mini-slots of the uplink data symbols, 0 for a single one of the frame
+  ul_mini_slot_symbols_ = tdd_conf.value("ul_mini_slot_symbols", 0);
+  RtAssert((ul_mini_slot_symbols_ == 0) || (ul_mini_slot_symbols_ == 2) ||
+               (ul_mini_slot_symbols_ == 4) || (ul_mini_slot_symbols_ == 7),
+           "ul_mini_slot_symbols must be 0, 2, 4 or 7");
+  ul_mini_slots_ = 1;
+  if ((ul_mini_slot_symbols_ > 0) && (frame_.NumUlDataSyms() > 0)) {
+    ul_mini_slots_ = (frame_.NumUlDataSyms() + ul_mini_slot_symbols_ - 1) /
+                     ul_mini_slot_symbols_;
+  }
   socket_thread_num_ = tdd_conf.value("socket_thread_num", 4);
   ue_core_offset_ = tdd_conf.value("ue_core_offset", 0);
   ue_worker_thread_num_ = tdd_conf.value("ue_worker_thread_num", 25);
   ue_socket_thread_num_ = tdd_conf.value("ue_socket_thread_num", 4);
+  ue_fused_ul_tx_ = tdd_conf.value("ue_fused_ul_tx", false);
+  ue_tx_lookahead_frames_ = tdd_conf.value("ue_tx_lookahead_frames", 0);
+  // The tx buffer of a frame must not be reused before the frame is sent
+  RtAssert(TX_FRAME_DELTA + ue_tx_lookahead_frames_ < kFrameWnd,
+           "ue_tx_lookahead_frames must be less than kFrameWnd - "
+           "TX_FRAME_DELTA");
   fft_thread_num_ = tdd_conf.value("fft_thread_num", 5);
   demul_thread_num_ = tdd_conf.value("demul_thread_num", 5);
   decode_thread_num_ = tdd_conf.value("decode_thread_num", 10);
   beam_thread_num_ = worker_thread_num_ - fft_thread_num_ - demul_thread_num_ -
                      decode_thread_num_;
   small_mimo_acc_ = tdd_conf.value("small_mimo_acc", false);
+  // The small_mimo_acc paths keep their own beamweight layouts
+  RtAssert((ul_beam_int16_ == false) || (small_mimo_acc_ == false),
+           "ul_beam_int16 needs small_mimo_acc off");
   if (small_mimo_acc_) {
     RtAssert((bs_ant_num_ == 1 && ue_ant_num_ == 1) ||
                  (bs_ant_num_ == 2 && ue_ant_num_ == 2) ||
@@ -657,22 +1132,40 @@ Config::Config(std::string jsonfilename)
       "Demodulation block size must be a multiple of transpose block size");
   demul_events_per_symbol_ = 1 + (ofdm_data_num_ - 1) / demul_block_size_;
 
+  // Beamweights are computed on every beam_sc_stride-th subcarrier, and the
+  // uplink equalizer interpolates them in between with beam_interpolation
+  const size_t min_beam_sc_stride =
+      group_pilot_sc_ ? pilot_sc_group_size_ : 1;
+  beam_sc_stride_ = tdd_conf.value("beam_sc_stride", min_beam_sc_stride);
+  beam_interpolation_ = tdd_conf.value("beam_interpolation", false);
+  RtAssert(
+      (beam_sc_stride_ > 0) && (beam_sc_stride_ % min_beam_sc_stride == 0),
+      "beam_sc_stride must be a multiple of pilot_sc_group_size " +
+          std::to_string(min_beam_sc_stride));
+  RtAssert(((beam_sc_stride_ == min_beam_sc_stride) &&
+            (beam_interpolation_ == false)) ||
+               (small_mimo_acc_ == false),
+           "beam_sc_stride and beam_interpolation are not supported with "
+           "small_mimo_acc");
+  RtAssert((beam_interpolation_ == false) || (ul_beam_int16_ == false),
+           "beam_interpolation is not supported with ul_beam_int16");
+
   beam_block_size_ = tdd_conf.value("beam_block_size", 1);
-  if (group_pilot_sc_) {
+  if (beam_sc_stride_ > 1) {
     if (beam_block_size_ == 1) {
-      AGORA_LOG_INFO("Setting beam_block_size to pilot_sc_group_size %zu\n",
-                     pilot_sc_group_size_);
-      beam_block_size_ = pilot_sc_group_size_;
+      AGORA_LOG_INFO("Setting beam_block_size to beam_sc_stride %zu\n",
+                     beam_sc_stride_);
+      beam_block_size_ = beam_sc_stride_;
     }
 
-    // Set beam block size to the pilot sc group size so events arn't generated
+    // Set beam block size to the beam sc stride so events arn't generated
     // for the redundant sc
-    if ((beam_block_size_ % pilot_sc_group_size_) != 0) {
+    if ((beam_block_size_ % beam_sc_stride_) != 0) {
       AGORA_LOG_WARN(
-          "beam_block_size(%zu) is not a multiple of pilot_sc_group_size(%zu). "
+          "beam_block_size(%zu) is not a multiple of beam_sc_stride(%zu). "
           "Efficiency will be decreased.  Please consider updating your "
           "settings\n",
-          beam_block_size_, pilot_sc_group_size_);
+          beam_block_size_, beam_sc_stride_);
     }
   }
   if (small_mimo_acc_ && (beam_block_size_ != ofdm_data_num_)) {
@@ -685,6 +1178,83 @@ Config::Config(std::string jsonfilename)
   }
   beam_events_per_symbol_ = 1 + (ofdm_data_num_ - 1) / beam_block_size_;
 
+  // Reuse the previous frame's beamweights when the CSI of a beam block has
+  // changed by less than this relative amount (0 disables the reuse)
+  beam_reuse_threshold_ = tdd_conf.value("beam_reuse_threshold", 0.0f);
+  beam_reuse_max_frames_ = tdd_conf.value("beam_reuse_max_frames", 10);
+  if ((beam_reuse_threshold_ > 0.0f) && small_mimo_acc_) {
+    AGORA_LOG_WARN(
+        "beam_reuse_threshold is not supported with small_mimo_acc. "
+        "Disabling beamweight reuse\n");
+    beam_reuse_threshold_ = 0.0f;
+  }
+  // Compute the beamweights of the next frame ahead, from CSI extrapolated
+  // over this many frames, on idle workers (0 disables the prediction)
+  beam_prediction_frames_ = tdd_conf.value("beam_prediction_frames", 0);
+  if (beam_prediction_frames_ > 0) {
+    RtAssert(beam_prediction_frames_ >= 2,
+             "beam_prediction_frames must be 0, or 2 or more");
+    RtAssert(beam_prediction_frames_ < frame_window_,
+             "beam_prediction_frames must be less than frame_window");
+    if ((beam_reuse_threshold_ <= 0.0f) || (frame_.NumDLSyms() > 0)) {
+      AGORA_LOG_WARN(
+          "beam_prediction_frames needs beam_reuse_threshold and frames "
+          "without downlink symbols. Disabling beamweight prediction\n");
+      beam_prediction_frames_ = 0;
+    }
+  }
+
+  // Compute the Gram matrices of the ZF/MMSE detectors with AMX-BF16 when
+  // the CPU exposes it, falling back to float for the subcarriers whose
+  // estimated detector error exceeds amx_beam_tolerance
+  amx_beams_ = tdd_conf.value("amx_beams", false);
+  amx_beam_tolerance_ = tdd_conf.value("amx_beam_tolerance", 0.05f);
+
+  // Compute the uplink beamweights, equalization and soft demodulation of
+  // whole frames and symbols on a CUDA GPU (DoUplinkGpu) instead of the
+  // DoBeamWeights and DoDemul blocks
+  gpu_uplink_ = tdd_conf.value("gpu_uplink", false);
+  if (gpu_uplink_) {
+#if !defined(USE_CUDA)
+    RtAssert(false, "gpu_uplink needs a build with USE_CUDA");
+#endif
+#if defined(USE_ACC100)
+    RtAssert(false, "gpu_uplink does not write the LLR format of the ACC100");
+#endif
+    RtAssert(kUplinkHardDemod == false, "gpu_uplink only demodulates soft");
+    // One GPU task completes the whole frame or symbol
+    RtAssert((shared_counters_ == false) && (fuse_fft_demul_ == false) &&
+                 (early_decode_ == false),
+             "gpu_uplink needs shared_counters, fuse_fft_demul and "
+             "early_decode off");
+    RtAssert((small_mimo_acc_ == false) && (ul_beam_int16_ == false),
+             "gpu_uplink needs small_mimo_acc and ul_beam_int16 off");
+    // Every subcarrier gets its own beamweights on the GPU
+    RtAssert(beam_sc_stride_ == 1,
+             "gpu_uplink does not support beam_sc_stride");
+    RtAssert(frame_.NumDLSyms() == 0,
+             "gpu_uplink computes no downlink beamweights, the frame must "
+             "not have downlink symbols");
+  }
+
+  // The uplink LLRs are kept in demod_buffer_ as int8 (8), or packed to 4 or
+  // 6 bits for the decoder to unpack
+  demod_llr_bits_ = tdd_conf.value("demod_llr_bits", 8);
+  RtAssert((demod_llr_bits_ == 4) || (demod_llr_bits_ == 6) ||
+               (demod_llr_bits_ == 8),
+           "demod_llr_bits must be 4, 6 or 8");
+  if (demod_llr_bits_ != 8) {
+#if defined(USE_ACC100)
+    RtAssert(false, "demod_llr_bits: the ACC100 reads int8 LLRs in place");
+#endif
+    RtAssert((gpu_uplink_ == false) && (kUplinkHardDemod == false),
+             "demod_llr_bits needs gpu_uplink and hard demodulation off");
+    // Each demodulation block starts on a chunk, down to BPSK
+    RtAssert(demul_block_size_ % kPackedLlrChunk == 0,
+             "demod_llr_bits needs a demul_block_size that is a multiple of " +
+                 std::to_string(kPackedLlrChunk));
+  }
+
   fft_block_size_ = tdd_conf.value("fft_block_size", 1);
   fft_block_size_ = std::max(fft_block_size_, num_channels_);
   RtAssert(bs_ant_num_ % fft_block_size_ == 0,
@@ -700,21 +1270,176 @@ Config::Config(std::string jsonfilename)
   scramble_enabled_ = tdd_conf.value("wlan_scrambler", true);
 
   // LDPC Coding and Modulation configurations
+  for (size_t mod_order_bits = 2; mod_order_bits <= kMaxModType;
+       mod_order_bits += 2) {
+    InitModulationTable(mod_tables_.at(mod_order_bits), mod_order_bits);
+  }
+  for (size_t i = 0; i < mod_tables_.size(); i++) {
+    mod_table_replicas_.at(i).Wrap(mod_tables_.at(i));
+  }
+  ue_specific_pilot_replica_.Wrap(ue_specific_pilot_);
+  ul_bits_replica_.Wrap(ul_bits_);
   ul_mcs_params_ = this->Parse(tdd_conf, "ul_mcs");
+  this->BuildMcsBank(Direction::kUplink, ul_mcs_params_);
   this->UpdateUlMCS(ul_mcs_params_);
 
   dl_mcs_params_ = this->Parse(tdd_conf, "dl_mcs");
+  this->BuildMcsBank(Direction::kDownlink, dl_mcs_params_);
   this->UpdateDlMCS(dl_mcs_params_);
   this->DumpMcsInfo();
   this->UpdateCtrlMCS();
 
+  // The uplink can switch at runtime to the MCS whose code blocks per symbol
+  // match the task counts, given room for their decoded bytes. The HARQ and
+  // early decode buffers are also sized by the codeword length, and the
+  // ACC100 queues by the configured MCS.
+  const bool fixed_codeword = (harq_processes_ > 0) || early_decode_;
+  ul_decoded_cb_stride_ = 0;
+  for (size_t mcs = 0; mcs < kNumMcs; mcs++) {
+    const McsParams& params = ul_mcs_bank_.at(mcs);
+    ul_mcs_switchable_.at(mcs) =
+        params.valid_ && (params.ldpc_config_.NumBlocksInSymbol() ==
+                          ul_ldpc_config_.NumBlocksInSymbol());
+    if (fixed_codeword) {
+      ul_mcs_switchable_.at(mcs) =
+          ul_mcs_switchable_.at(mcs) && (params.ldpc_config_.NumCbCodewLen() ==
+                                         ul_ldpc_config_.NumCbCodewLen());
+    }
+#if defined(USE_ACC100)
+    ul_mcs_switchable_.at(mcs) = (mcs == ul_mcs_index_);
+#endif
+    if (ul_mcs_switchable_.at(mcs)) {
+      ul_decoded_cb_stride_ = std::max(ul_decoded_cb_stride_,
+                                       Roundup<64>(params.num_bytes_per_cb_));
+    }
+  }
+  ul_decoded_cb_stride_ = std::max(ul_decoded_cb_stride_,
+                                   Roundup<64>(ul_ldpc_config_.NumCbLen() / 8));
+
   fft_in_rru_ = tdd_conf.value("fft_in_rru", false);
+  fronthaul_bfp_bits_ = tdd_conf.value("fronthaul_bfp_bits", 0);
+  RtAssert((fronthaul_bfp_bits_ == 0) ||
+               ((fronthaul_bfp_bits_ >= 8) && (fronthaul_bfp_bits_ <= 16)),
+           "fronthaul_bfp_bits must be 0 (off) or 8-16");
+  RtAssert((fronthaul_bfp_bits_ == 0) || ((fft_in_rru_ == false) &&
+                                          (kUse12BitIQ == false)),
+           "fronthaul_bfp_bits does not support fft_in_rru or 12-bit IQ");
+  // The time-domain samples of an antenna cannot be split by subcarrier, and
+  // the downlink IFFT needs the whole carrier
+  RtAssert((sc_slice_nodes_ == 1) ||
+               (fft_in_rru_ && (kUse12BitIQ == false) &&
+                (frame_.NumDLSyms() == 0)),
+           "sc_slice_nodes needs fft_in_rru and an uplink-only frame");
+  cfo_correction_ = tdd_conf.value("cfo_correction", false);
+  // The offset is estimated from the cyclic prefix of the int16 samples
+  RtAssert((cfo_correction_ == false) ||
+               ((cp_len_ > 0) && (fft_in_rru_ == false) &&
+                (kUse12BitIQ == false) && (fronthaul_bfp_bits_ == 0)),
+           "cfo_correction needs a cyclic prefix and int16 time-domain "
+           "uplink samples");
+  fft_int16_ = tdd_conf.value("fft_int16", false);
+  // A radix-2 transform of the int16 samples as they arrive
+  RtAssert((fft_int16_ == false) ||
+               ((ofdm_ca_num_ >= Int16Fft::kMinSize) &&
+                ((ofdm_ca_num_ & (ofdm_ca_num_ - 1)) == 0) &&
+                (fft_in_rru_ == false) && (kUse12BitIQ == false) &&
+                (fronthaul_bfp_bits_ == 0) && (cfo_correction_ == false)),
+           "fft_int16 needs a power of two fft_size of at least " +
+               std::to_string(Int16Fft::kMinSize) +
+               " and uncompressed int16 time-domain samples without "
+               "cfo_correction");
+
+  // The O-RAN 7.2x split: the RU does the FFT and sends the PRBs of the data
+  // subcarriers, in eCPRI messages timed on the GPS clock
+  oran_fronthaul_ = tdd_conf.value("oran_fronthaul", false);
+  oran_bfp_bits_ = tdd_conf.value("oran_bfp_bits", 9);
+  oran_ru_macs_ = tdd_conf.value("oran_ru_macs", "");
+  oran_vlan_ = tdd_conf.value("oran_vlan", 0);
+  oran_numerology_ = tdd_conf.value("oran_numerology", 1);
+  // [250, 350]: the window before its time on air in which the RU must
+  // receive a downlink symbol
+  oran_t1a_up_us_ = tdd_conf.value("oran_t1a_up_us",
+                                   std::vector<size_t>({250, 350}));
+  oran_tcp_adv_dl_us_ = tdd_conf.value("oran_tcp_adv_dl_us", 125);
+  if (oran_fronthaul_) {
+    RtAssert(kUseDPDK, "oran_fronthaul needs a build with RADIO_TYPE=DPDK");
+    RtAssert((oran_bfp_bits_ == 0) ||
+                 ((oran_bfp_bits_ >= 8) && (oran_bfp_bits_ <= 16)),
+             "oran_bfp_bits must be 0 (off) or 8-16");
+    RtAssert(oran_numerology_ <= 4, "oran_numerology must be 0-4");
+    RtAssert((oran_t1a_up_us_.size() == 2) &&
+                 (oran_t1a_up_us_.at(0) < oran_t1a_up_us_.at(1)),
+             "oran_t1a_up_us must be [min, max]");
+    RtAssert(oran_vlan_ <= UINT16_MAX, "oran_vlan must fit 16 bits");
+    RtAssert(frame_.NumTotalSyms() % OranTiming::kSymbolsPerSlot == 0,
+             "oran_fronthaul needs frames of whole slots of " +
+                 std::to_string(OranTiming::kSymbolsPerSlot) + " symbols");
+    RtAssert(ofdm_data_num_ % kOranPrbSubcarriers == 0,
+             "oran_fronthaul needs ofdm_data_num in whole PRBs");
+    // The RU has the downlink of all the symbols from the IFFT, and cannot
+    // loop back the calibration symbols
+    RtAssert((frame_.NumDlControlSyms() == 0) &&
+                 (frame_.IsRecCalEnabled() == false),
+             "oran_fronthaul does not support control or calibration "
+             "symbols");
+    RtAssert((fft_in_rru_ == false) && (fronthaul_bfp_bits_ == 0) &&
+                 (kUse12BitIQ == false) && (cfo_correction_ == false) &&
+                 (fft_int16_ == false) && (sc_slice_nodes_ == 1),
+             "oran_fronthaul replaces the time-domain fronthaul, and cannot "
+             "be combined with fft_in_rru, fronthaul_bfp_bits, 12-bit IQ, "
+             "cfo_correction, fft_int16 or sc_slice_nodes");
+    RtAssert(dpdk_zero_copy_tx_ == false,
+             "oran_fronthaul sends the downlink from its own mbufs, without "
+             "dpdk_zero_copy_tx");
+  }
 
   samps_per_symbol_ =
       ofdm_tx_zero_prefix_ + ofdm_ca_num_ + cp_len_ + ofdm_tx_zero_postfix_;
-  packet_length_ =
-      Packet::kOffsetOfData + ((kUse12BitIQ ? 3 : 4) * samps_per_symbol_);
-  dl_packet_length_ = Packet::kOffsetOfData + (samps_per_symbol_ * 4);
+  if (oran_fronthaul_) {
+    // The PRBs of the data subcarriers, and the bytes that the
+    // decompression may read past them
+    packet_length_ = Packet::kOffsetOfData +
+                     ((ofdm_data_num_ / kOranPrbSubcarriers) *
+                      OranPrbBytes(oran_bfp_bits_)) +
+                     kOranPadding;
+  } else if (fronthaul_bfp_bits_ != 0) {
+    packet_length_ = Packet::kOffsetOfData +
+                     BfpBytes(samps_per_symbol_, fronthaul_bfp_bits_);
+  } else if (sc_slice_nodes_ > 1) {
+    // The float16 samples of the slice's subcarriers, in FFT-shifted order
+    packet_length_ = Packet::kOffsetOfData + (4 * ofdm_data_num_);
+  } else {
+    packet_length_ =
+        Packet::kOffsetOfData + ((kUse12BitIQ ? 3 : 4) * samps_per_symbol_);
+  }
+  dl_packet_length_ = oran_fronthaul_
+                          ? packet_length_
+                          : Packet::kOffsetOfData + (samps_per_symbol_ * 4);
+  // Uplink packets of one frame per datagram, see AggregatePacket
+  fronthaul_aggregation_ = tdd_conf.value("fronthaul_aggregation", 1);
+  RtAssert((fronthaul_aggregation_ >= 1) &&
+               (fronthaul_aggregation_ <= AggregatePacket::kMaxEntries),
+           "fronthaul_aggregation must be in [1, " +
+               std::to_string(AggregatePacket::kMaxEntries) + "]");
+  // The largest UDP payload
+  RtAssert(AggregatePacketLength() <= 65507,
+           "fronthaul_aggregation makes a datagram longer than UDP allows");
+
+  // The sender, channel simulator, Agora and user on one host can exchange
+  // packets through shared-memory rings instead of loopback UDP, and the
+  // channel simulator and user on different hosts through DPDK
+  const std::string sim_transport = tdd_conf.value("sim_transport", "udp");
+  RtAssert((sim_transport == "udp") || (sim_transport == "shm") ||
+               (sim_transport == "dpdk"),
+           "sim_transport must be \"udp\", \"shm\" or \"dpdk\"");
+  sim_shm_ = (sim_transport == "shm");
+  sim_dpdk_ = (sim_transport == "dpdk");
+  RtAssert(kUseDPDK || (sim_dpdk_ == false),
+           "sim_transport \"dpdk\" needs a build with RADIO_TYPE=DPDK");
+  sim_shm_slots_ = tdd_conf.value("sim_shm_slots", 512);
+  sim_shm_hugepage_ = tdd_conf.value("sim_shm_hugepage", true);
+  sim_shm_slot_bytes_ =
+      Roundup<64>(std::max(AggregatePacketLength(), dl_packet_length_));
 
   //Don't check for jumbo frames when using the hardware, this might be temp
   // if (!kUseArgos) {
@@ -885,6 +1610,7 @@ Config::Config(std::string jsonfilename)
   }
 
   Print();
+  init_time_ms_ = (GetTime::GetTimeUs() - init_start_us) / 1000.0;
 }
 
 json Config::Parse(const json& in_json, const std::string& json_handle) {
@@ -902,7 +1628,7 @@ json Config::Parse(const json& in_json, const std::string& json_handle) {
 
 inline size_t SelectZc(size_t base_graph, size_t code_rate,
                        size_t mod_order_bits, size_t num_sc, size_t cb_per_sym,
-                       const std::string& dir) {
+                       const std::string& dir, bool quiet = false) {
   size_t n_zc = sizeof(kZc) / sizeof(size_t);
   std::vector<size_t> zc_vec(kZc, kZc + n_zc);
   std::sort(zc_vec.begin(), zc_vec.end());
@@ -924,65 +1650,108 @@ inline size_t SelectZc(size_t base_graph, size_t code_rate,
       break;
     }
   }
-  if (zc == SIZE_MAX) {
+  if ((zc == SIZE_MAX) && (quiet == false)) {
     AGORA_LOG_WARN(
         "Exceeded possible range of LDPC lifting Zc for " + dir +
             "! Setting lifting size to max possible value(%zu).\nThis may lead "
             "to too many unused subcarriers. For better use of the PHY "
             "resources, you may reduce your coding or modulation rate.\n",
         kMaxSupportedZc);
+  }
+  if (zc == SIZE_MAX) {
     zc = kMaxSupportedZc;
   }
   return zc;
 }
 
-void Config::UpdateUlMCS(const json& ul_mcs) {
-  if (ul_mcs.find("mcs_index") == ul_mcs.end()) {
-    ul_modulation_ = ul_mcs.value("modulation", "16QAM");
-    ul_mod_order_bits_ = kModulStringMap.at(ul_modulation_);
-
-    double ul_code_rate_usr = ul_mcs.value("code_rate", 0.333);
-    size_t code_rate_int =
-        static_cast<size_t>(std::round(ul_code_rate_usr * 1024.0));
+// The LDPC code and modulation of an MCS index, num_sc data subcarriers per
+// symbol
+static McsParams MakeMcsParams(size_t mcs_index, uint16_t base_graph,
+                               bool early_term, int16_t max_decoder_iter,
+                               size_t num_sc, size_t cb_per_sym,
+                               const std::string& dir) {
+  McsParams params;
+  params.mod_order_bits_ = GetModOrderBits(mcs_index);
+  params.code_rate_ = GetCodeRate(mcs_index);
+  const size_t zc = SelectZc(base_graph, params.code_rate_,
+                             params.mod_order_bits_, num_sc, cb_per_sym, dir,
+                             true /* quiet */);
+
+  // Always positive since the code rate is smaller than 1024
+  const size_t num_rows =
+      static_cast<size_t>(std::round(1024.0 * LdpcNumInputCols(base_graph) /
+                                     params.code_rate_)) -
+      (LdpcNumInputCols(base_graph) - 2);
 
-    ul_mcs_index_ = CommsLib::GetMcsIndex(ul_mod_order_bits_, code_rate_int);
-    ul_code_rate_ = GetCodeRate(ul_mcs_index_);
-    if (ul_code_rate_ / 1024.0 != ul_code_rate_usr) {
-      AGORA_LOG_WARN(
-          "Rounded the user-defined uplink code rate to the closest standard "
-          "rate %zu/1024.\n",
-          ul_code_rate_);
-    }
-  } else {
-    ul_mcs_index_ = ul_mcs.value("mcs_index", 10);  // 16QAM, 340/1024
-    ul_mod_order_bits_ = GetModOrderBits(ul_mcs_index_);
-    ul_modulation_ = MapModToStr(ul_mod_order_bits_);
-    ul_code_rate_ = GetCodeRate(ul_mcs_index_);
-    ul_modulation_ = MapModToStr(ul_mod_order_bits_);
-  }
-  InitModulationTable(this->ul_mod_table_, ul_mod_order_bits_);
+  const uint32_t num_cb_len = LdpcNumInputBits(base_graph, zc);
+  const uint32_t num_cb_codew_len =
+      LdpcNumEncodedBits(base_graph, zc, num_rows);
+  params.ldpc_config_ =
+      LDPCconfig(base_graph, zc, max_decoder_iter, early_term, num_cb_len,
+                 num_cb_codew_len, num_rows, 0);
+  params.ldpc_config_.NumBlocksInSymbol((num_sc * params.mod_order_bits_) /
+                                        num_cb_codew_len);
+  params.num_bytes_per_cb_ = num_cb_len / 8;
+  params.valid_ = (params.ldpc_config_.NumBlocksInSymbol() > 0) &&
+                  (num_rows <= LdpcMaxNumRows(base_graph));
+  return params;
+}
 
+void Config::BuildMcsBank(Direction dir, const json& mcs_params) {
+  const bool uplink = (dir == Direction::kUplink);
   // TODO: find the optimal base_graph
-  uint16_t base_graph = ul_mcs.value("base_graph", 1);
-  bool early_term = ul_mcs.value("earlyTermination", true);
-  int16_t max_decoder_iter = ul_mcs.value("decoderIter", 5);
-
-  size_t zc = SelectZc(base_graph, ul_code_rate_, ul_mod_order_bits_,
-                       ofdm_data_num_, kCbPerSymbol, "uplink");
-
-  // Always positive since ul_code_rate is smaller than 1024
-  size_t num_rows =
-      static_cast<size_t>(
-          std::round(1024.0 * LdpcNumInputCols(base_graph) / ul_code_rate_)) -
-      (LdpcNumInputCols(base_graph) - 2);
+  const uint16_t base_graph = mcs_params.value("base_graph", 1);
+  const bool early_term = mcs_params.value("earlyTermination", true);
+  const int16_t max_decoder_iter = mcs_params.value("decoderIter", 5);
+  const size_t num_sc = uplink ? ofdm_data_num_ : GetOFDMDataNum();
+  auto& bank = uplink ? ul_mcs_bank_ : dl_mcs_bank_;
+  for (size_t mcs = 0; mcs < kNumMcs; mcs++) {
+    bank.at(mcs) = MakeMcsParams(mcs, base_graph, early_term, max_decoder_iter,
+                                 num_sc, kCbPerSymbol,
+                                 uplink ? "uplink" : "downlink");
+    bank.at(mcs).mod_table_ = &mod_tables_.at(bank.at(mcs).mod_order_bits_);
+  }
+}
 
-  uint32_t num_cb_len = LdpcNumInputBits(base_graph, zc);
-  uint32_t num_cb_codew_len = LdpcNumEncodedBits(base_graph, zc, num_rows);
-  ul_ldpc_config_ = LDPCconfig(base_graph, zc, max_decoder_iter, early_term,
-                               num_cb_len, num_cb_codew_len, num_rows, 0);
+size_t Config::ParseMcsIndex(const json& mcs_params,
+                             const std::string& dir) const {
+  if (mcs_params.find("mcs_index") != mcs_params.end()) {
+    return mcs_params.value("mcs_index", 10);  // 16QAM, 340/1024
+  }
+  const std::string modulation = mcs_params.value("modulation", "16QAM");
+  const size_t mod_order_bits = kModulStringMap.at(modulation);
+  RtAssert(mod_order_bits <= kMaxDataModType,
+           "The " + dir + " data symbols can not be modulated with " +
+               modulation);
+  const double code_rate_usr = mcs_params.value("code_rate", 0.333);
+  const size_t code_rate_int =
+      static_cast<size_t>(std::round(code_rate_usr * 1024.0));
+  const size_t mcs_index = CommsLib::GetMcsIndex(mod_order_bits, code_rate_int);
+  if (GetCodeRate(mcs_index) / 1024.0 != code_rate_usr) {
+    AGORA_LOG_WARN(
+        "Rounded the user-defined %s code rate to the closest standard rate "
+        "%zu/1024.\n",
+        dir.c_str(), GetCodeRate(mcs_index));
+  }
+  return mcs_index;
+}
 
-  ul_ldpc_config_.NumBlocksInSymbol((ofdm_data_num_ * ul_mod_order_bits_) /
-                                    ul_ldpc_config_.NumCbCodewLen());
+void Config::UpdateUlMCS(const json& ul_mcs) {
+  ul_mcs_index_ = ParseMcsIndex(ul_mcs, "uplink");
+  const McsParams& params = ul_mcs_bank_.at(ul_mcs_index_);
+  ul_mod_order_bits_ = params.mod_order_bits_;
+  ul_modulation_ = MapModToStr(ul_mod_order_bits_);
+  ul_code_rate_ = params.code_rate_;
+  ul_mod_table_ = params.mod_table_;
+  ul_ldpc_config_ = params.ldpc_config_;
+  if (ul_ldpc_config_.ExpansionFactor() == kMaxSupportedZc) {
+    AGORA_LOG_WARN(
+        "Exceeded possible range of LDPC lifting Zc for uplink! Setting "
+        "lifting size to max possible value(%zu).\nThis may lead to too many "
+        "unused subcarriers. For better use of the PHY resources, you may "
+        "reduce your coding or modulation rate.\n",
+        kMaxSupportedZc);
+  }
   RtAssert(
       (frame_.NumULSyms() == 0) || (ul_ldpc_config_.NumBlocksInSymbol() > 0),
       "Uplink LDPC expansion factor is too large for number of OFDM data "
@@ -990,51 +1759,21 @@ void Config::UpdateUlMCS(const json& ul_mcs) {
 }
 
 void Config::UpdateDlMCS(const json& dl_mcs) {
-  if (dl_mcs.find("mcs_index") == dl_mcs.end()) {
-    dl_modulation_ = dl_mcs.value("modulation", "16QAM");
-    dl_mod_order_bits_ = kModulStringMap.at(dl_modulation_);
-
-    double dl_code_rate_usr = dl_mcs.value("code_rate", 0.333);
-    size_t code_rate_int =
-        static_cast<size_t>(std::round(dl_code_rate_usr * 1024.0));
-    dl_mcs_index_ = CommsLib::GetMcsIndex(dl_mod_order_bits_, code_rate_int);
-    dl_code_rate_ = GetCodeRate(dl_mcs_index_);
-    if (dl_code_rate_ / 1024.0 != dl_code_rate_usr) {
-      AGORA_LOG_WARN(
-          "Rounded the user-defined downlink code rate to the closest standard "
-          "rate %zu/1024.\n",
-          dl_code_rate_);
-    }
-  } else {
-    dl_mcs_index_ = dl_mcs.value("mcs_index", 10);  // 16QAM, 340/1024
-    dl_mod_order_bits_ = GetModOrderBits(dl_mcs_index_);
-    dl_modulation_ = MapModToStr(dl_mod_order_bits_);
-    dl_code_rate_ = GetCodeRate(dl_mcs_index_);
-    dl_modulation_ = MapModToStr(dl_mod_order_bits_);
+  dl_mcs_index_ = ParseMcsIndex(dl_mcs, "downlink");
+  const McsParams& params = dl_mcs_bank_.at(dl_mcs_index_);
+  dl_mod_order_bits_ = params.mod_order_bits_;
+  dl_modulation_ = MapModToStr(dl_mod_order_bits_);
+  dl_code_rate_ = params.code_rate_;
+  dl_mod_table_ = params.mod_table_;
+  dl_ldpc_config_ = params.ldpc_config_;
+  if (dl_ldpc_config_.ExpansionFactor() == kMaxSupportedZc) {
+    AGORA_LOG_WARN(
+        "Exceeded possible range of LDPC lifting Zc for downlink! Setting "
+        "lifting size to max possible value(%zu).\nThis may lead to too "
+        "many unused subcarriers. For better use of the PHY resources, you "
+        "may reduce your coding or modulation rate.\n",
+        kMaxSupportedZc);
   }
-  InitModulationTable(this->dl_mod_table_, dl_mod_order_bits_);
-
-  // TODO: find the optimal base_graph
-  uint16_t base_graph = dl_mcs.value("base_graph", 1);
-  bool early_term = dl_mcs.value("earlyTermination", true);
-  int16_t max_decoder_iter = dl_mcs.value("decoderIter", 5);
-
-  size_t zc = SelectZc(base_graph, dl_code_rate_, dl_mod_order_bits_,
-                       GetOFDMDataNum(), kCbPerSymbol, "downlink");
-
-  // Always positive since dl_code_rate is smaller than 1024
-  size_t num_rows =
-      static_cast<size_t>(
-          std::round(1024.0 * LdpcNumInputCols(base_graph) / dl_code_rate_)) -
-      (LdpcNumInputCols(base_graph) - 2);
-
-  uint32_t num_cb_len = LdpcNumInputBits(base_graph, zc);
-  uint32_t num_cb_codew_len = LdpcNumEncodedBits(base_graph, zc, num_rows);
-  dl_ldpc_config_ = LDPCconfig(base_graph, zc, max_decoder_iter, early_term,
-                               num_cb_len, num_cb_codew_len, num_rows, 0);
-
-  dl_ldpc_config_.NumBlocksInSymbol((GetOFDMDataNum() * dl_mod_order_bits_) /
-                                    dl_ldpc_config_.NumCbCodewLen());
   RtAssert(
       this->frame_.NumDLSyms() == 0 || dl_ldpc_config_.NumBlocksInSymbol() > 0,
       "Downlink LDPC expansion factor is too large for number of OFDM data "
@@ -1174,11 +1913,16 @@ void Config::GenPilots() {
   }
 
   // Generate common pilots based on Zadoff-Chu sequence for channel estimation
+  // The sequences span the whole carrier, of which a node of a split
+  // carrier keeps its slice
   auto zc_seq_double =
-      CommsLib::GetSequence(this->ofdm_data_num_, CommsLib::kLteZadoffChu);
+      CommsLib::GetSequence(this->carrier_data_num_, CommsLib::kLteZadoffChu);
   auto zc_seq = Utils::DoubleToCfloat(zc_seq_double);
-  this->common_pilot_ =
+  const auto carrier_pilot =
       CommsLib::SeqCyclicShift(zc_seq, M_PI / 4);  // Used in LTE SRS
+  this->common_pilot_.assign(
+      carrier_pilot.begin() + sc_slice_start_,
+      carrier_pilot.begin() + sc_slice_start_ + ofdm_data_num_);
 
   this->pilots_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
       Agora_memory::Alignment_t::kAlign64,
@@ -1222,8 +1966,9 @@ void Config::GenPilots() {
         zc_seq,
         (i + this->ue_ant_offset_) * (float)M_PI / 6);  // LTE DMRS
     for (size_t j = 0; j < this->ofdm_data_num_; j++) {
-      this->ue_specific_pilot_[i][j] = {zc_ue_pilot_i[j].real(),
-                                        zc_ue_pilot_i[j].imag()};
+      this->ue_specific_pilot_[i][j] = {
+          zc_ue_pilot_i[sc_slice_start_ + j].real(),
+          zc_ue_pilot_i[sc_slice_start_ + j].imag()};
       // FFT Shift
       const size_t k = j + ofdm_data_start_ >= ofdm_ca_num_ / 2
                            ? j + ofdm_data_start_ - ofdm_ca_num_ / 2
@@ -1234,8 +1979,58 @@ void Config::GenPilots() {
   }
 }
 
-void Config::GenData() {
-  this->GenPilots();
+uint64_t Config::TestVectorHash() const {
+  // Everything the test vectors are generated from
+  std::string conf;
+  Utils::LoadTddConfig(config_filename_, conf);
+  uint64_t hash = TestVectorFile::Hash(conf.data(), conf.size());
+  const size_t params[] = {
+      ofdm_ca_num_,
+      ofdm_data_num_,
+      ofdm_data_start_,
+      ofdm_tx_zero_prefix_,
+      cp_len_,
+      samps_per_symbol_,
+      ue_ant_num_,
+      ue_ant_offset_,
+      ue_ant_total_,
+      frame_.NumULSyms(),
+      frame_.NumDLSyms(),
+      frame_.ClientUlPilotSymbols(),
+      frame_.ClientDlPilotSymbols(),
+      ul_mod_order_bits_,
+      dl_mod_order_bits_,
+      ul_ldpc_config_.BaseGraph(),
+      ul_ldpc_config_.ExpansionFactor(),
+      ul_ldpc_config_.NumRows(),
+      dl_ldpc_config_.BaseGraph(),
+      dl_ldpc_config_.ExpansionFactor(),
+      dl_ldpc_config_.NumRows(),
+      scramble_enabled_,
+      freq_orthogonal_pilot_,
+      static_cast<size_t>(kDebugDownlink)};
+  hash = TestVectorFile::Hash(params, sizeof(params), hash);
+
+  // The data files are identified by their size and modification time
+  const std::string suffix = std::to_string(this->ofdm_ca_num_) + "_ant" +
+                             std::to_string(this->ue_ant_total_) + ".bin";
+  for (const std::string& data_file :
+       {kUlDataFilePrefix + suffix, kUlEncodedFilePrefix + suffix,
+        kDlDataFilePrefix + suffix}) {
+    struct stat file_stat;
+    std::array<int64_t, 3> file_id = {-1, 0, 0};
+    if (::stat(data_file.c_str(), &file_stat) == 0) {
+      file_id = {file_stat.st_size, file_stat.st_mtim.tv_sec,
+                 file_stat.st_mtim.tv_nsec};
+    }
+    hash = TestVectorFile::Hash(file_id.data(), sizeof(file_id), hash);
+  }
+  return hash;
+}
+
+bool Config::GenTestVectors() {
+  // Every symbol goes through the same IFFT size
+  const CommsLib::DftHold dft(ofdm_ca_num_);
   // Get uplink and downlink raw bits either from file or random numbers
   const size_t dl_num_bytes_per_ue_pad =
       Roundup<64>(this->dl_num_bytes_per_cb_) *
@@ -1383,7 +2178,7 @@ void Config::GenData() {
   std::ifstream infile(ul_encoded_data_file, std::ios::binary);  // Open the binary file
   if (!infile) {
       std::cerr << "Failed to open file!" << std::endl;
-      return;
+      return false;
   }
 
   int8_t* temp_ul = NULL; 
@@ -1429,7 +2224,7 @@ void Config::GenData() {
           infile.read(reinterpret_cast<char*>(coded_bits_ptr), ul_encoded_bytes_per_block);
           if (!infile) {
             std::cerr << "Error reading from file!" << std::endl;
-            return;
+            return false;
           }
         } else{
           LdpcEncodeHelper(ul_ldpc_config_.BaseGraph(),
@@ -1498,7 +2293,7 @@ void Config::GenData() {
         if (i >= this->frame_.ClientUlPilotSymbols()) {
           int8_t* mod_input_ptr =
               GetModBitsBuf(ul_mod_bits_, Direction::kUplink, 0, i, u, j);
-          ul_iq_f_[i][q + j] = ModSingleUint8(*mod_input_ptr, ul_mod_table_);
+          ul_iq_f_[i][q + j] = ModSingleUint8(*mod_input_ptr, *ul_mod_table_);
         } else {
           ul_iq_f_[i][q + j] = ue_specific_pilot_[u][j];
         }
@@ -1595,7 +2390,7 @@ void Config::GenData() {
           int8_t* mod_input_ptr =
               GetModBitsBuf(dl_mod_bits_, Direction::kDownlink, 0, i, u,
                             this->GetOFDMDataIndex(j));
-          dl_iq_f_[i][q + j] = ModSingleUint8(*mod_input_ptr, dl_mod_table_);
+          dl_iq_f_[i][q + j] = ModSingleUint8(*mod_input_ptr, *dl_mod_table_);
         } else {
           dl_iq_f_[i][q + j] = ue_specific_pilot_[u][j];
         }
@@ -1652,6 +2447,54 @@ void Config::GenData() {
                         this->scale_);
     }
   }
+  delete[](ul_temp_parity_buffer);
+  delete[](dl_temp_parity_buffer);
+  ul_iq_ifft.Free();
+  dl_iq_ifft.Free();
+  dl_encoded_bits.Free();
+  ul_encoded_bits.Free();
+  return true;
+}
+
+void Config::GenData() {
+  const double gen_data_start_us = GetTime::GetTimeUs();
+  this->GenPilots();
+  // The test vectors of the same configuration and data files are mapped
+  // from the file of a previous run, or generated and saved for the next
+  const std::string test_vector_file =
+      kTestVectorFilePrefix + std::to_string(this->ofdm_ca_num_) + "_ant" +
+      std::to_string(this->ue_ant_total_) + "_ue" +
+      std::to_string(this->ue_ant_offset_) + "_" +
+      std::to_string(this->ue_ant_num_) + ".bin";
+  const uint64_t test_vector_hash = this->TestVectorHash();
+  test_vectors_ = std::make_unique<TestVectorFile>();
+  if ((kOutputUlScData == false) &&
+      test_vectors_->Map(test_vector_file, test_vector_hash)) {
+    AGORA_LOG_INFO("Config: Mapped test vectors from %s\n",
+                   test_vector_file.c_str());
+    test_vectors_->Get(0, ul_bits_);
+    test_vectors_->Get(1, ul_mod_bits_);
+    test_vectors_->Get(2, ul_iq_f_);
+    test_vectors_->Get(3, ul_iq_t_);
+    test_vectors_->Get(4, dl_bits_);
+    test_vectors_->Get(5, dl_mod_bits_);
+    test_vectors_->Get(6, dl_iq_f_);
+    test_vectors_->Get(7, dl_iq_t_);
+    this->scale_ = test_vectors_->Scale();
+  } else {
+    if (this->GenTestVectors() == false) {
+      return;
+    }
+    test_vectors_->Add(ul_bits_);
+    test_vectors_->Add(ul_mod_bits_);
+    test_vectors_->Add(ul_iq_f_);
+    test_vectors_->Add(ul_iq_t_);
+    test_vectors_->Add(dl_bits_);
+    test_vectors_->Add(dl_mod_bits_);
+    test_vectors_->Add(dl_iq_f_);
+    test_vectors_->Add(dl_iq_t_);
+    test_vectors_->Write(test_vector_file, test_vector_hash, this->scale_);
+  }
 
   // Generate time domain ue-specific pilot symbols
   for (size_t i = 0; i < this->ue_ant_num_; i++) {
@@ -1741,12 +2584,24 @@ void Config::GenData() {
   if (pilot_ifft_ != nullptr) {
     FreeBuffer1d(&pilot_ifft_);
   }
-  delete[](ul_temp_parity_buffer);
-  delete[](dl_temp_parity_buffer);
-  ul_iq_ifft.Free();
-  dl_iq_ifft.Free();
-  dl_encoded_bits.Free();
-  ul_encoded_bits.Free();
+  ReplicateReadOnlyTables();
+  gen_data_time_ms_ = (GetTime::GetTimeUs() - gen_data_start_us) / 1000.0;
+}
+
+void Config::ReplicateReadOnlyTables() {
+  // Without numa_bind_buffers the workers are not placed by node, so the
+  // tables stay where the master allocated them
+  const size_t num_nodes = numa_bind_buffers_ ? NumaNodeCount() : 1;
+  if (num_nodes < 2) {
+    return;
+  }
+  ue_specific_pilot_replica_.Replicate(ue_specific_pilot_, num_nodes);
+  ul_bits_replica_.Replicate(ul_bits_, num_nodes);
+  for (size_t i = 0; i < mod_tables_.size(); i++) {
+    mod_table_replicas_.at(i).Replicate(mod_tables_.at(i), num_nodes);
+  }
+  AGORA_LOG_INFO("Config: Replicated the read-only tables on %zu NUMA nodes\n",
+                 num_nodes);
 }
 
 size_t Config::DecodeBroadcastSlots(const int16_t* const bcast_iq_samps) {
@@ -1827,33 +2682,32 @@ void Config::GenBroadcastSlots(
 
   int num_bcast_bytes = BitsToBytes(dl_bcast_ldpc_config_.NumCbLen());
   std::vector<int8_t> bcast_bits_buffer(num_bcast_bytes, 0);
-
-  Table<complex_float> dl_bcast_mod_table;
-  InitModulationTable(dl_bcast_mod_table, dl_bcast_mod_order_bits_);
-
-  for (size_t i = 0; i < this->frame_.NumDlControlSyms(); i++) {
-    std::memcpy(bcast_bits_buffer.data(), ctrl_msg.data(), sizeof(size_t));
-
-    const auto coded_bits_ptr = DataGenerator::GenCodeblock(
-        dl_bcast_ldpc_config_, &bcast_bits_buffer.at(0), num_bcast_bytes,
-        scramble_enabled_);
-
-    auto modulated_vector =
-        DataGenerator::GetModulation(&coded_bits_ptr[0], dl_bcast_mod_table,
-                                     dl_bcast_ldpc_config_.NumCbCodewLen(),
-                                     ofdm_data_num_, dl_bcast_mod_order_bits_);
-    auto mapped_symbol = DataGenerator::MapOFDMSymbol(
-        this, modulated_vector, pilots_, SymbolType::kControl);
-    auto ofdm_symbol = DataGenerator::BinForIfft(this, mapped_symbol, true);
-    CommsLib::IFFT(&ofdm_symbol[0], ofdm_ca_num_, false);
-    // additional 2^2 (6dB) power backoff
-    float dl_bcast_scale =
-        2 * CommsLib::FindMaxAbs(&ofdm_symbol[0], ofdm_symbol.size());
-    CommsLib::Ifft2tx(&ofdm_symbol[0], bcast_iq_samps[i], this->ofdm_ca_num_,
-                      this->ofdm_tx_zero_prefix_, this->cp_len_,
-                      dl_bcast_scale);
-  }
-  dl_bcast_mod_table.Free();
+  std::memcpy(bcast_bits_buffer.data(), ctrl_msg.data(), sizeof(size_t));
+
+  // Every control symbol carries the same message, so it is rendered once
+  // and copied to the others
+  const auto coded_bits_ptr = DataGenerator::GenCodeblock(
+      dl_bcast_ldpc_config_, &bcast_bits_buffer.at(0), num_bcast_bytes,
+      scramble_enabled_);
+
+  auto modulated_vector = DataGenerator::GetModulation(
+      &coded_bits_ptr[0], mod_tables_.at(dl_bcast_mod_order_bits_),
+      dl_bcast_ldpc_config_.NumCbCodewLen(), ofdm_data_num_,
+      dl_bcast_mod_order_bits_);
+  auto mapped_symbol = DataGenerator::MapOFDMSymbol(
+      this, modulated_vector, pilots_, SymbolType::kControl);
+  auto ofdm_symbol = DataGenerator::BinForIfft(this, mapped_symbol, true);
+  CommsLib::IFFT(&ofdm_symbol[0], ofdm_ca_num_, false);
+  // additional 2^2 (6dB) power backoff
+  float dl_bcast_scale =
+      2 * CommsLib::FindMaxAbs(&ofdm_symbol[0], ofdm_symbol.size());
+  CommsLib::Ifft2tx(&ofdm_symbol[0], bcast_iq_samps[0], this->ofdm_ca_num_,
+                    this->ofdm_tx_zero_prefix_, this->cp_len_,
+                    dl_bcast_scale);
+  for (size_t i = 1; i < this->frame_.NumDlControlSyms(); i++) {
+    std::memcpy(bcast_iq_samps[i], bcast_iq_samps[0],
+                samps_per_symbol_ * sizeof(std::complex<int16_t>));
+  }
   const double duration =
       GetTime::CyclesToUs(GetTime::WorkerRdtsc() - start_tsc, freq_ghz_);
   if (kDebugPrintInTask) {
@@ -1870,12 +2724,18 @@ Config::~Config() {
     std::free(pilots_sgn_);
     pilots_sgn_ = nullptr;
   }
+  ue_specific_pilot_replica_.Free();
+  ul_bits_replica_.Free();
+  for (auto& replica : mod_table_replicas_) {
+    replica.Free();
+  }
   ue_specific_pilot_t_.Free();
   ue_specific_pilot_.Free();
   ue_pilot_ifft_.Free();
 
-  ul_mod_table_.Free();
-  dl_mod_table_.Free();
+  for (auto& mod_table : mod_tables_) {
+    mod_table.Free();
+  }
   dl_bits_.Free();
   ul_bits_.Free();
   ul_mod_bits_.Free();
@@ -1904,6 +2764,15 @@ size_t Config::GetSymbolId(size_t input_id) const {
   return symbol_id;
 }
 
+size_t Config::AggregatePacketLength(size_t num_entries) const {
+  if (this->fronthaul_aggregation_ == 1) {
+    return this->packet_length_;
+  }
+  return AggregatePacket::Length(
+      (num_entries == 0) ? this->fronthaul_aggregation_ : num_entries,
+      this->packet_length_ - Packet::kOffsetOfData);
+}
+
 /* Returns True if symbol is valid index and is of symbol type 'P'
    False otherwise */
 bool Config::IsPilot(size_t /*frame_id*/, size_t symbol_id) const {
@@ -1979,10 +2848,6 @@ bool Config::IsDownlink(size_t frame_id, size_t symbol_id) const {
   return (s == 'D');
 }
 
-SymbolType Config::GetSymbolType(size_t symbol_id) const {
-  return kSymbolMap.at(this->frame_.FrameIdentifier().at(symbol_id));
-}
-
 void Config::Print() const {
   if (kDebugPrintConfiguration == true) {
     std::cout << "Freq Ghz: " << freq_ghz_ << std::endl
@@ -10,22 +10,49 @@
 #ifndef CONFIG_H_
 #define CONFIG_H_
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "armadillo"
 #include "common_typedef_sdk.h"
+#include "fast_math.h"
 #include "framestats.h"
 #include "ldpc_config.h"
 #include "memory_manage.h"
 #include "nlohmann/json.hpp"
+#include "numa_replica.h"
+#include "packed_iq.h"
+#include "resctrl.h"
 #include "symbols.h"
 #include "utils.h"
 
+class TestVectorFile;
+
+/// Coding and modulation parameters of one MCS index. Precomputed for every
+/// index at startup and never modified, so that an MCS change only selects
+/// another entry.
+struct McsParams {
+  /// False if the code of this MCS does not fit the subcarriers of a symbol
+  bool valid_ = false;
+  size_t mod_order_bits_ = 0;
+  size_t code_rate_ = 0;  // Out of 1024
+  LDPCconfig ldpc_config_{0, 0, 0, false, 0, 0, 0, 0};
+  size_t num_bytes_per_cb_ = 0;
+  /// Constellation of mod_order_bits_, shared by the entries with that order
+  Table<complex_float>* mod_table_ = nullptr;
+};
+
 class Config {
  public:
+  /// Number of MCS indices of the MCS table (kMCS)
+  static constexpr size_t kNumMcs = 32;
+
   static constexpr bool kDebugRecipCal = false;
   // Constructor
   explicit Config(std::string jsonfilename);
@@ -49,10 +76,19 @@ class Config {
   inline size_t OfdmDataStart() const { return this->ofdm_data_start_; }
 
   inline size_t OfdmDataStop() const { return this->ofdm_data_stop_; }
+  inline size_t ScSliceNodes() const { return this->sc_slice_nodes_; }
+  inline size_t ScSliceNode() const { return this->sc_slice_node_; }
   inline size_t OfdmPilotSpacing() const { return this->ofdm_pilot_spacing_; }
 
   inline bool HwFramer() const { return this->hw_framer_; }
   inline bool UeHwFramer() const { return this->ue_hw_framer_; }
+  /// Beams in the codebook of the analog phased arrays of the radios, 0 if
+  /// the analog beam is not managed
+  inline size_t NumAnalogBeams() const { return this->analog_beams_; }
+  /// Frames from the start of a beam sweep to the start of the next one
+  inline size_t BeamSweepInterval() const {
+    return this->beam_sweep_interval_;
+  }
   inline size_t UeResyncPeriod() const { return this->ue_resync_period_; }
   inline double FreqGhz() const { return this->freq_ghz_; };
   inline double Freq() const { return this->freq_; }
@@ -135,7 +171,7 @@ class Config {
 
   inline size_t ModifyRecCalIndex(size_t previous_index,
                                   int mod_value = 0) const {
-    return (previous_index + mod_value) % kFrameWnd;
+    return (previous_index + mod_value) % this->frame_window_;
   }
 
   inline size_t RecipCalIndex(size_t frame_id) const {
@@ -182,6 +218,255 @@ class Config {
 
   inline size_t CoreOffset() const { return this->core_offset_; }
   inline size_t WorkerThreadNum() const { return this->worker_thread_num_; }
+  inline ExecutionModel GetExecutionModel() const {
+    return this->execution_model_;
+  }
+  /// Number of worker threads to spawn, not counting the master thread
+  inline size_t DedicatedWorkerNum() const {
+    switch (this->execution_model_) {
+      case ExecutionModel::kSingleCore:
+        return 0;
+      case ExecutionModel::kMasterAssisted:
+        return this->worker_thread_num_ - 1;
+      default:
+        return this->worker_thread_num_;
+    }
+  }
+  /// True if the master thread also runs the doers
+  inline bool MasterRunsWorker() const {
+    return this->execution_model_ != ExecutionModel::kMultiCore;
+  }
+  /// True if tasks go through per-worker deques with work stealing instead
+  /// of the per-EventType task queues
+  inline bool WorkStealing() const { return this->work_stealing_; }
+  /// Workers that the decode tasks of each UE are pushed to with work
+  /// stealing, so that its demodulated data stays in their caches. 0 if they
+  /// are spread over all workers.
+  inline size_t DecodeUeAffinity() const { return this->decode_ue_affinity_; }
+  /// Worker threads of each stage with a group of its own, by stage name
+  /// (see kWorkerGroupStages). The stages not listed run on every worker.
+  inline const std::map<std::string, std::vector<size_t>>& WorkerGroups()
+      const {
+    return this->worker_groups_;
+  }
+  /// True if the workers of a group run the tasks of the other stages when
+  /// their own stages have none
+  inline bool WorkerGroupBorrow() const { return this->worker_group_borrow_; }
+  /// The resctrl cache and memory bandwidth allocation of each thread class
+  /// with one, by class name (see Resctrl::Setup)
+  inline const std::map<std::string, Resctrl::ClassAllocation>&
+  ResctrlClasses() const {
+    return this->resctrl_classes_;
+  }
+  /// Idle time after which a polling thread starts to PAUSE, see IdlePolicy
+  inline double IdleSpinUs() const { return this->idle_spin_us_; }
+  /// Idle time after which a polling thread starts to wait in TPAUSE
+  inline double IdlePauseUs() const { return this->idle_pause_us_; }
+  /// Longest TPAUSE of an idle polling thread, 0 to always busy-poll
+  inline double IdleSleepUs() const { return this->idle_sleep_us_; }
+  /// Minimum slack before the TX slot of the first downlink symbol for a
+  /// frame's downlink processing to be scheduled. 0 disables the
+  /// deadline-aware downlink scheduling
+  inline double DlDeadlineMarginUs() const {
+    return this->dl_deadline_margin_us_;
+  }
+  /// Time per iteration of its event loop in which the master thread runs
+  /// tasks, most urgent first. 0 runs one task per handled event.
+  inline double MasterTaskBudgetUs() const {
+    return this->master_task_budget_us_;
+  }
+  /// Time after the first packet of a frame after which the frame is
+  /// processed without its missing packets. 0 waits for every packet
+  inline double RxFrameTimeoutUs() const {
+    return this->rx_frame_timeout_us_;
+  }
+  /// Number of frames the base station data buffers hold. At most kFrameWnd,
+  /// which still sizes the frame counters and message queues
+  inline size_t FrameWindow() const { return this->frame_window_; }
+  /// Count the received packets and schedule their FFT on the RxManager
+  /// thread rather than the master
+  inline bool RxManager() const { return this->rx_manager_; }
+  /// Grow the dequeue bulks of the master and RxManager with the backlog of
+  /// their queues, up to kDequeueBulkMaxGrowth times the fixed sizes
+  inline bool AdaptiveDequeue() const { return this->adaptive_dequeue_; }
+  /// Pass the events of each TxRx thread through a SpscEventRing of its own
+  /// rather than the shared RX concurrent queue
+  inline bool RxEventRings() const { return this->rx_event_rings_; }
+  /// Poll the TX/RX workers on the master thread between its tasks instead
+  /// of running them on threads of their own
+  inline bool InlineTxRx() const { return this->inline_txrx_; }
+  /// Number of frames the master processes at once, each with its own set of
+  /// task and completion queues
+  inline size_t PipelineDepth() const { return this->pipeline_depth_; }
+  /// Pages backing the large per-frame buffers of AgoraBuffer
+  inline Agora_memory::PageType BufferPageType() const {
+    return this->buffer_page_type_;
+  }
+  /// True if buffers are bound to the NUMA node of the threads using them
+  inline bool NumaBindBuffers() const { return this->numa_bind_buffers_; }
+  /// True if the pages of the socket, FFT and equalizer buffers are faulted
+  /// in by a background thread during radio bring-up
+  inline bool PrefaultBuffers() const { return this->prefault_buffers_; }
+  /// True if all the memory of the process is locked once the radios are
+  /// up, after the buffers are prefaulted as with PrefaultBuffers()
+  inline bool LockMemory() const { return this->lock_memory_; }
+  /// Time spent in the constructor, for the startup profile
+  inline double InitTimeMs() const { return this->init_time_ms_; }
+  /// Time spent in GenData, for the startup profile
+  inline double GenDataTimeMs() const { return this->gen_data_time_ms_; }
+  /// True if the master packs several subcarrier blocks, code blocks or
+  /// antennas into one event, depending on the tasks per worker
+  inline bool EventBatching() const { return this->event_batching_; }
+  /// Time a beamweight, demul or precode event should take, for the
+  /// BlockSizeController of the master. 0 keeps the static event batching.
+  inline double AdaptiveBlockTargetUs() const {
+    return this->adaptive_block_target_us_;
+  }
+  /// True if the workers count the completed beam, demul, decode and precode
+  /// tasks, and only post the last task of each symbol to the master
+  inline bool SharedCounters() const { return this->shared_counters_; }
+  /// True if Agora processes in-process packets as fast as it can instead of
+  /// receiving them, to measure its maximum throughput
+  inline bool BenchMode() const { return this->bench_mode_; }
+  /// Frame duration at which bench mode releases the frames, in
+  /// microseconds, 0 to release them as fast as Agora frees the buffers
+  inline double BenchFrameDurationUs() const {
+    return this->bench_frame_duration_us_;
+  }
+  /// True if the worker that completes the FFT of an uplink symbol runs its
+  /// demul when the beamweights of the frame are ready
+  inline bool FuseFftDemul() const { return this->fuse_fft_demul_; }
+  /// True if one FFT task transforms all the antennas of a pilot or uplink
+  /// symbol with a batched descriptor, instead of one antenna per task
+  inline bool FftBatchSymbol() const { return this->fft_batch_symbol_; }
+  /// The FFT backend of the FFT and IFFT doers: "mkl", "fftw", "mufft", or
+  /// "auto" for the fastest at the FFT size
+  inline const std::string& FftBackend() const { return this->fft_backend_; }
+  /// Where the FFTW backend keeps its wisdom across runs, none if empty
+  inline const std::string& FftWisdomFile() const {
+    return this->fft_wisdom_file_;
+  }
+  /// True if one downlink task per antenna precodes a symbol straight into
+  /// the IFFT input and runs the IFFT, instead of separate precode and IFFT
+  /// tasks
+  inline bool FusePrecodeIfft() const { return this->fuse_precode_ifft_; }
+  /// True if one IFFT task transforms all the antennas of a downlink symbol
+  /// with a batched descriptor, instead of one antenna per task
+  inline bool IfftBatchSymbol() const { return this->ifft_batch_symbol_; }
+  /// True if the encode events carry up to EventData::kMaxTags code blocks
+  /// of a symbol, which DoEncode encodes with one multi-code-block request
+  inline bool BatchEncode() const { return this->batch_encode_; }
+  /// True if the downlink encode tasks modulate their code blocks straight
+  /// into the precoder input (see DlModSymbolIndex()), instead of writing
+  /// modulation bits for the precode tasks to look up
+  inline bool FuseEncodeModulation() const {
+    return this->fuse_encode_modulation_;
+  }
+  /// True if the uplink decoder picks the iteration budget of each code
+  /// block from the latest SNR of its UE, with early termination, instead of
+  /// always running up to the maximum number of iterations
+  inline bool AdaptiveDecodeIter() const { return this->adaptive_decode_iter_; }
+  /// Iteration budget for the UEs at or above DecodeIterSnrHighDb(). The
+  /// budget grows linearly to the maximum at DecodeIterSnrLowDb().
+  inline size_t MinDecoderIter() const { return this->min_decoder_iter_; }
+  inline float DecodeIterSnrLowDb() const {
+    return this->decode_iter_snr_low_db_;
+  }
+  inline float DecodeIterSnrHighDb() const {
+    return this->decode_iter_snr_high_db_;
+  }
+  /// Time from the first received symbol of a frame after which its code
+  /// blocks are decoded with MinDecoderIter() iterations, 0 to disable
+  inline double DecodeOverloadUs() const { return this->decode_overload_us_; }
+  /// True if the uplink beamweights are also stored as int16, and DoDemul
+  /// equalizes with int16 dot products instead of complex float products
+  inline bool UlBeamInt16() const { return this->ul_beam_int16_; }
+  /// True if the general (not small_mimo_acc) equalizer and precoder
+  /// multiply the matrices of all the subcarriers of a block with one MKL
+  /// batch GEMM call instead of one product per subcarrier
+  inline bool GemmBatch() const { return this->gemm_batch_; }
+  /// True if a worker takes the next event of a task queue along with the
+  /// current one and prefetches the inputs of the next while it runs the
+  /// current
+  inline bool TaskPrefetch() const { return this->task_prefetch_; }
+  /// True if buffer (csi, fft, ifft, decode or recorder) is written with
+  /// non-temporal stores, which bypass the cache of the writing core
+  inline bool NtStores(const std::string& buffer) const {
+    return std::find(nt_stores_.begin(), nt_stores_.end(), buffer) !=
+           nt_stores_.end();
+  }
+  /// True if the uplink code blocks of a symbol are decoded as soon as the
+  /// demul blocks of their LLRs are done, instead of after the whole symbol
+  inline bool EarlyDecode() const { return this->early_decode_; }
+  /// Uplink HARQ processes per UE, 0 if HARQ is off. A code block whose
+  /// decode failed is combined with its retransmission HarqProcesses()
+  /// frames later.
+  inline size_t HarqProcesses() const { return this->harq_processes_; }
+  /// Transmissions of a code block before its soft bits are dropped
+  inline size_t HarqMaxTx() const { return this->harq_max_tx_; }
+  /// Bits per LLR of the HARQ soft buffers, 8 or 4
+  inline size_t HarqLlrBits() const { return this->harq_llr_bits_; }
+  /// With ACC100, decode ops of a worker in the card from which its next
+  /// code blocks are decoded on the CPU instead, 0 to never spill
+  inline size_t AccSpillOps() const { return this->acc_spill_ops_; }
+  /// With ACC100, average decode op latency in microseconds above which the
+  /// code blocks of a busy worker are decoded on the CPU, 0 to ignore it
+  inline double AccSpillLatencyUs() const {
+    return this->acc_spill_latency_us_;
+  }
+  /// When the asynchronous ACC100 decoder enqueues its code blocks
+  inline AccBatchPolicy GetAccBatchPolicy() const {
+    return this->acc_batch_policy_;
+  }
+  /// Enqueue-to-dequeue latency in microseconds that the adaptive batches
+  /// grow up to, and the most code blocks in a batch
+  inline double AccBatchLatencyUs() const {
+    return this->acc_batch_latency_us_;
+  }
+  inline size_t AccBatchMaxOps() const { return this->acc_batch_max_ops_; }
+  /// With ACC100, the bbdev device of the cell's decoders and encoders, e.g.
+  /// one SR-IOV VF of the card per cell
+  inline uint8_t BbdevDevId() const { return this->bbdev_dev_id_; }
+  /// With ACC100, the UE emulator decodes the downlink on the bbdev device
+  /// UeBbdevDevId() instead of the CPU
+  inline bool UeAccDecode() const { return this->ue_acc_decode_; }
+  inline uint8_t UeBbdevDevId() const { return this->ue_bbdev_dev_id_; }
+  /// Accuracy tier of the reciprocals of a kernel family
+  inline FastMath::Precision FastMathPrecision(FastMath::Family family) const {
+    return this->fast_math_.at(static_cast<size_t>(family));
+  }
+  /// Latency budgets from the first received symbol of a frame, in
+  /// microseconds, by stage name (e.g. "demul_done", "tx_done")
+  inline const std::map<std::string, double>& StageDeadlinesUs() const {
+    return this->stage_deadlines_us_;
+  }
+  /// Frames between two latency reports of the master, 0 for none
+  inline size_t LatencyReportInterval() const {
+    return this->latency_report_interval_;
+  }
+  /// Uplink data symbols per mini-slot, 0 if the frame is a single one
+  inline size_t UlMiniSlotSymbols() const {
+    return this->ul_mini_slot_symbols_;
+  }
+  /// Mini-slots of the uplink data symbols, 1 without mini-slots
+  inline size_t UlMiniSlots() const { return this->ul_mini_slots_; }
+  /// Mini-slot of the uplink data symbol ul_data_symbol_idx, counted from
+  /// the first symbol after the client uplink pilots
+  inline size_t UlMiniSlot(size_t ul_data_symbol_idx) const {
+    return (this->ul_mini_slot_symbols_ == 0)
+               ? 0
+               : ul_data_symbol_idx / this->ul_mini_slot_symbols_;
+  }
+  /// Uplink data symbols of mini_slot, fewer for the last one if the frame
+  /// does not split evenly
+  inline size_t UlMiniSlotDataSyms(size_t mini_slot) const {
+    if (this->ul_mini_slot_symbols_ == 0) {
+      return this->frame_.NumUlDataSyms();
+    }
+    const size_t first = mini_slot * this->ul_mini_slot_symbols_;
+    return std::min(this->ul_mini_slot_symbols_,
+                    this->frame_.NumUlDataSyms() - first);
+  }
   inline size_t SocketThreadNum() const { return this->socket_thread_num_; }
   inline size_t UeCoreOffset() const { return this->ue_core_offset_; }
   inline size_t UeWorkerThreadNum() const {
@@ -190,6 +475,10 @@ class Config {
   inline size_t UeSocketThreadNum() const {
     return this->ue_socket_thread_num_;
   }
+  inline bool UeFusedUlTx() const { return this->ue_fused_ul_tx_; }
+  inline size_t UeTxLookaheadFrames() const {
+    return this->ue_tx_lookahead_frames_;
+  }
 
   inline size_t FftThreadNum() const { return this->fft_thread_num_; }
   inline size_t DemulThreadNum() const { return this->demul_thread_num_; }
@@ -201,10 +490,27 @@ class Config {
   inline size_t DemulEventsPerSymbol() const {
     return this->demul_events_per_symbol_;
   }
+  /// Bits of each uplink LLR in demod_buffer_: 8 for int8 LLRs, 4 or 6 for
+  /// the packed format of packed_llr.h
+  inline size_t DemodLlrBits() const { return this->demod_llr_bits_; }
   inline size_t BeamBlockSize() const { return this->beam_block_size_; }
+  inline size_t BeamScStride() const { return this->beam_sc_stride_; }
+  inline bool BeamInterpolation() const { return this->beam_interpolation_; }
   inline size_t BeamEventsPerSymbol() const {
     return this->beam_events_per_symbol_;
   }
+  inline float BeamReuseThreshold() const {
+    return this->beam_reuse_threshold_;
+  }
+  inline size_t BeamReuseMaxFrames() const {
+    return this->beam_reuse_max_frames_;
+  }
+  inline size_t BeamPredictionFrames() const {
+    return this->beam_prediction_frames_;
+  }
+  inline bool AmxBeams() const { return this->amx_beams_; }
+  inline float AmxBeamTolerance() const { return this->amx_beam_tolerance_; }
+  inline bool GpuUplink() const { return this->gpu_uplink_; }
   inline size_t FftBlockSize() const { return this->fft_block_size_; }
 
   inline size_t EncodeBlockSize() const { return this->encode_block_size_; }
@@ -291,8 +597,31 @@ class Config {
     return dl_bcast_ldpc_config_;
   }
   inline Table<complex_float>& ModTable(Direction dir) {
-    return dir == Direction::kUplink ? this->ul_mod_table_
-                                     : this->dl_mod_table_;
+    return dir == Direction::kUplink ? *this->ul_mod_table_
+                                     : *this->dl_mod_table_;
+  }
+  /// The copy of ModTable(dir) on numa_node, for the workers of the node
+  inline Table<complex_float>& ModTable(Direction dir, int numa_node) {
+    const auto mod_table_id =
+        static_cast<size_t>(&ModTable(dir) - this->mod_tables_.data());
+    return this->mod_table_replicas_[mod_table_id].On(numa_node);
+  }
+  /// The precomputed parameters of an MCS index. The LDPC options (base
+  /// graph, decoder iterations, early termination) are those of ul_mcs and
+  /// dl_mcs at startup.
+  inline const McsParams& Mcs(Direction dir, size_t mcs_index) const {
+    return dir == Direction::kUplink ? this->ul_mcs_bank_.at(mcs_index)
+                                     : this->dl_mcs_bank_.at(mcs_index);
+  }
+  /// True if the uplink can switch to an MCS at runtime: it is valid and has
+  /// the code blocks per symbol the task counts and buffers are sized for
+  inline bool UlMcsSwitchable(size_t mcs_index) const {
+    return (mcs_index < kNumMcs) && this->ul_mcs_switchable_.at(mcs_index);
+  }
+  /// Bytes between the decoded code blocks of a symbol, which hold those of
+  /// every switchable uplink MCS
+  inline size_t UlDecodedCbStride() const {
+    return this->ul_decoded_cb_stride_;
   }
   inline const nlohmann::json& MCSParams(Direction dir) const {
     return dir == Direction::kUplink ? this->ul_mcs_params_
@@ -322,6 +651,53 @@ class Config {
   inline size_t FramesToTest() const { return this->frames_to_test_; }
   inline float NoiseLevel() const { return this->noise_level_; }
   inline bool FftInRru() const { return this->fft_in_rru_; }
+  /// Mantissa bits of the block floating point compression of the uplink
+  /// fronthaul samples, 0 for uncompressed samples
+  inline size_t FronthaulBfpBits() const { return this->fronthaul_bfp_bits_; }
+  /// True if the fronthaul is O-RAN 7.2x eCPRI over DPDK: the RUs do the
+  /// FFT and IFFT, and exchange the PRBs of the data subcarriers
+  inline bool OranFronthaul() const { return this->oran_fronthaul_; }
+  /// Mantissa bits of the block floating point compression of the O-RAN
+  /// PRBs, 0 for uncompressed 16-bit IQ
+  inline size_t OranBfpBits() const { return this->oran_bfp_bits_; }
+  /// MAC addresses of the O-RAN RUs, one per radio, separated by commas
+  inline const std::string& OranRuMacs() const { return this->oran_ru_macs_; }
+  /// 802.1Q tag control information of the O-RAN messages, 0 for untagged
+  inline uint16_t OranVlan() const {
+    return static_cast<uint16_t>(this->oran_vlan_);
+  }
+  /// Numerology of the O-RAN carrier, 2^numerology slots per subframe
+  inline size_t OranNumerology() const { return this->oran_numerology_; }
+  /// The [min, max] microseconds before its time on air in which the RU
+  /// must receive a downlink symbol
+  inline const std::vector<size_t>& OranT1aUpUs() const {
+    return this->oran_t1a_up_us_;
+  }
+  /// Microseconds by which the C-plane message of a symbol precedes its
+  /// U-plane window
+  inline size_t OranTcpAdvDlUs() const { return this->oran_tcp_adv_dl_us_; }
+  /// True if DoFFT estimates the carrier frequency offset of each pilot and
+  /// uplink symbol from its cyclic prefix and derotates the FFT window
+  inline bool CfoCorrection() const { return this->cfo_correction_; }
+  /// True if DoFFT transforms the int16 uplink samples with the block
+  /// floating point Int16Fft instead of converting them to float first
+  inline bool FftInt16() const { return this->fft_int16_; }
+  /// Uplink packets of a frame that the RRU sends in one AggregatePacket
+  /// datagram, 1 for a datagram per Packet
+  inline size_t FronthaulAggregation() const {
+    return this->fronthaul_aggregation_;
+  }
+  /// The datagram length of num_entries packets in an AggregatePacket, by
+  /// default as many as FronthaulAggregation(). PacketLength() if not
+  /// aggregated.
+  size_t AggregatePacketLength(size_t num_entries = 0) const;
+  inline bool SimShm() const { return this->sim_shm_; }
+  /// "sim_transport": "dpdk" makes the links of the channel simulator and
+  /// user DpdkComm queue pairs
+  inline bool SimDpdk() const { return this->sim_dpdk_; }
+  inline size_t SimShmSlots() const { return this->sim_shm_slots_; }
+  inline bool SimShmHugepage() const { return this->sim_shm_hugepage_; }
+  inline size_t SimShmSlotBytes() const { return this->sim_shm_slot_bytes_; }
 
   inline uint16_t DpdkNumPorts() const { return this->dpdk_num_ports_; }
   inline uint16_t DpdkPortOffset() const { return this->dpdk_port_offset_; }
@@ -329,9 +705,75 @@ class Config {
   inline const std::string& DpdkMacAddrs() const {
     return this->dpdk_mac_addrs_;
   }
+  /// True if the DPDK RX packets point into the received mbufs, which go
+  /// back to the pool once the FFT is done with them, instead of copying the
+  /// payloads into the RX buffer
+  inline bool DpdkZeroCopyRx() const { return this->dpdk_zero_copy_rx_; }
+  /// True if the NICs send the downlink payloads straight from the socket
+  /// buffer, attached to mbufs as external buffers, instead of copying them
+  inline bool DpdkZeroCopyTx() const { return this->dpdk_zero_copy_tx_; }
+  /// Packets per rx burst of a DPDK queue, the maximum burst if
+  /// DpdkAdaptiveRxBurst()
+  inline size_t DpdkRxBurst() const { return this->dpdk_rx_burst_; }
+  /// True if each DPDK queue adapts its rx burst to its backlog
+  inline bool DpdkAdaptiveRxBurst() const {
+    return this->dpdk_adaptive_rx_burst_;
+  }
+  /// True if the NICs drop the packets that match no interface of a worker
+  inline bool DpdkDropUnmatched() const { return this->dpdk_drop_unmatched_; }
+  /// Interfaces of each DPDK port, in the order of the ports. Empty if they
+  /// are split evenly.
+  inline const std::vector<size_t>& DpdkPortInterfaces() const {
+    return this->dpdk_port_interfaces_;
+  }
+
+  /// Kernel name of the NIC of the AF_XDP sockets
+  inline const std::string& XdpInterface() const {
+    return this->xdp_interface_;
+  }
+  /// NIC queue of the AF_XDP socket of TxRx worker 0, the others follow
+  inline size_t XdpQueueOffset() const { return this->xdp_queue_offset_; }
+  /// True if the AF_XDP sockets must bind in zero-copy mode, which needs
+  /// driver support, instead of copy mode
+  inline bool XdpZeroCopy() const { return this->xdp_zero_copy_; }
+  /// True if the USRP TxRx worker takes the frame and symbol of the rx
+  /// samples from their timestamp and receives the unused symbols of a frame
+  /// in one call, instead of one rx call per symbol in a fixed order
+  inline bool UsrpRxStreaming() const { return this->usrp_rx_streaming_; }
+  /// True if the USRP TxRx worker sends the downlink symbols of a frame,
+  /// from the first to the last with the symbols in between zero, in one
+  /// timed burst instead of one send per symbol
+  inline bool UsrpTxBurst() const { return this->usrp_tx_burst_; }
+  /// True if the hardware TxRx worker lets the rx packets point into the
+  /// driver's rx buffers, on radios with direct buffer access
+  inline bool HwZeroCopyRx() const { return this->hw_zero_copy_rx_; }
 
   inline size_t BsMacRxPort() const { return this->bs_mac_rx_port_; }
   inline size_t BsMacTxPort() const { return this->bs_mac_tx_port_; }
+  /// True if the PHY hands the MAC whole uplink transport blocks, one per
+  /// (frame, UE), through shared-memory rings instead of one event per
+  /// decoded symbol
+  inline bool MacTbRing() const { return this->mac_tb_ring_; }
+  /// True if the MAC-PHY rings are backed by a hugepage
+  inline bool MacRingHugepage() const { return this->mac_ring_hugepage_; }
+  /// True if the base station schedules UEs each frame by proportional
+  /// fairness instead of with the static round-robin groups
+  inline bool MacSchedulerPf() const { return this->mac_scheduler_pf_; }
+  /// Averaging window, in frames, of the per-UE throughput of the
+  /// proportional-fair scheduler
+  inline size_t PfWindowFrames() const { return this->pf_window_frames_; }
+  /// True if the base station groups the UEs of each frame by the
+  /// correlation of their channels, when there are fewer spatial streams
+  /// than UEs
+  inline bool UeGroupingEnabled() const { return this->ue_grouping_; }
+  /// Largest squared normalized channel correlation of two UEs in a group
+  inline float UeGroupingMaxCorr() const {
+    return this->ue_grouping_max_corr_;
+  }
+  /// Fraction of the data subcarriers of a frame each UE starts with
+  /// traffic for, see MacScheduler::SetOfferedLoad()
+  inline float UlOfferedLoad() const { return this->ul_offered_load_; }
+  inline float DlOfferedLoad() const { return this->dl_offered_load_; }
 
   inline size_t UeMacRxPort() const { return this->ue_mac_rx_port_; }
   inline size_t UeMacTxPort() const { return this->ue_mac_tx_port_; }
@@ -342,8 +784,50 @@ class Config {
 
   inline size_t LogListenerPort() const { return this->log_listener_port_; }
 
+  /// Events kept per thread in the Chrome trace of the task timeline, 0 if
+  /// tracing is disabled
+  inline size_t TaskTraceEvents() const { return this->task_trace_events_; }
+  /// Whether Agora appends a row per frame to the binary frame log
+  inline bool FrameLog() const { return this->frame_log_; }
+  /// The workers read their hardware counters around 1 in N events, 0 if
+  /// they do not
+  inline size_t PerfSampleInterval() const {
+    return this->perf_sample_interval_;
+  }
+  /// A worker task counts as stalled once it runs for this many times the
+  /// 99th percentile of its event type, 0 if stalls are not detected
+  inline double StallFactor() const { return this->stall_factor_; }
+  /// Least run time of a stalled task in microseconds
+  inline double StallMinUs() const { return this->stall_min_us_; }
+
+  /// Address the telemetry HTTP servers listen on
+  inline const std::string& TelemetryAddr() const {
+    return this->telemetry_addr_;
+  }
+  /// TCP port of the telemetry HTTP server of Agora, 0 if disabled
+  inline size_t BsTelemetryPort() const { return this->bs_telemetry_port_; }
+  /// TCP port of the telemetry HTTP server of PhyUe, 0 if disabled
+  inline size_t UeTelemetryPort() const { return this->ue_telemetry_port_; }
+  /// Minimum time between two telemetry snapshots of the master thread
+  inline double TelemetryIntervalMs() const {
+    return this->telemetry_interval_ms_;
+  }
+
   inline size_t LogScNum() const { return this->log_sc_num_; }
   inline bool LogTimestamp() const { return this->log_timestamp_; }
+  /// PhyStats collects the EVM and CSI condition numbers of one frame in
+  /// this many
+  inline size_t PhyStatsFrameSampling() const {
+    return this->phy_stats_frame_sampling_;
+  }
+  /// PhyStats collects the EVM and CSI condition numbers of one block of
+  /// kSCsPerCacheline subcarriers in this many
+  inline size_t PhyStatsScSampling() const {
+    return this->phy_stats_sc_sampling_;
+  }
+  /// The uplink link quality comes from the equalized data alone, not from
+  /// the known transmitted data
+  inline bool BlindLinkQuality() const { return this->blind_link_quality_; }
 
   /* Inline accessors (complex types) */
   inline const std::vector<int>& ClTxAdvance() const {
@@ -387,6 +871,10 @@ class Config {
   inline Table<complex_float>& UeSpecificPilot() {
     return this->ue_specific_pilot_;
   };
+  /// The copy of UeSpecificPilot() on numa_node, for the workers of the node
+  inline Table<complex_float>& UeSpecificPilot(int numa_node) {
+    return this->ue_specific_pilot_replica_.On(numa_node);
+  }
   inline Table<std::complex<int16_t>>& UeSpecificPilotT() {
     return this->ue_specific_pilot_t_;
   };
@@ -406,6 +894,10 @@ class Config {
 
   inline Table<int8_t>& DlBits() { return this->dl_bits_; }
   inline Table<int8_t>& UlBits() { return this->ul_bits_; }
+  /// The copy of UlBits() on numa_node, for the workers of the node
+  inline Table<int8_t>& UlBits(int numa_node) {
+    return this->ul_bits_replica_.On(numa_node);
+  }
   inline Table<int8_t>& DlModBits() { return this->dl_mod_bits_; }
   inline Table<int8_t>& UlModBits() { return this->ul_mod_bits_; }
   inline Table<complex_float>& UlIqF() { return this->ul_iq_f_; }
@@ -437,26 +929,31 @@ class Config {
 
   /* Public functions that do not meet coding standard format */
   /// Return the symbol type of this symbol in this frame
-  SymbolType GetSymbolType(size_t symbol_id) const;
+  inline SymbolType GetSymbolType(size_t symbol_id) const {
+    return this->symbol_types_.at(symbol_id);
+  }
 
   /// Return total number of data symbols of all frames in a buffer
-  /// that holds data of kFrameWnd frames
+  /// that holds data of FrameWindow() frames
   inline size_t GetTotalDataSymbolIdx(size_t frame_id, size_t symbol_id) const {
-    return ((frame_id % kFrameWnd) * this->frame_.NumDataSyms() + symbol_id);
+    return ((frame_id % this->frame_window_) * this->frame_.NumDataSyms() +
+            symbol_id);
   }
 
   /// Return total number of uplink data symbols of all frames in a buffer
-  /// that holds data of kFrameWnd frames
+  /// that holds data of FrameWindow() frames
   inline size_t GetTotalDataSymbolIdxUl(size_t frame_id,
                                         size_t symbol_idx_ul) const {
-    return ((frame_id % kFrameWnd) * this->frame_.NumULSyms() + symbol_idx_ul);
+    return ((frame_id % this->frame_window_) * this->frame_.NumULSyms() +
+            symbol_idx_ul);
   }
 
   /// Return total number of downlink data symbols of all frames in a buffer
-  /// that holds data of kFrameWnd frames
+  /// that holds data of FrameWindow() frames
   inline size_t GetTotalDataSymbolIdxDl(size_t frame_id,
                                         size_t symbol_idx_dl) const {
-    return ((frame_id % kFrameWnd) * this->frame_.NumDLSyms() + symbol_idx_dl);
+    return ((frame_id % this->frame_window_) * this->frame_.NumDLSyms() +
+            symbol_idx_dl);
   }
 
   inline size_t GetTotalSymbolIdxDl(size_t frame_id, size_t symbol_id) {
@@ -465,7 +962,7 @@ class Config {
             ? this->frame_.GetDLControlSymbolIdx(symbol_id)
             : this->frame_.GetDLSymbolIdx(symbol_id) +
                   this->frame_.NumDlControlSyms();
-    return (frame_id % kFrameWnd) *
+    return (frame_id % this->frame_window_) *
                (this->frame_.NumDlControlSyms() + this->frame_.NumDLSyms()) +
            symbol_idx_dl;
   }
@@ -503,6 +1000,14 @@ class Config {
     return symbol_idx;
   }
 
+  /// Offset in samples of symbol_id of frame_id from the time reference of
+  /// the radios (time0), when the frame timing is kept in software
+  inline long long SymbolTimeOffset(size_t frame_id, size_t symbol_id) const {
+    return static_cast<long long>(
+        this->samps_per_symbol_ *
+        ((frame_id * this->frame_.NumTotalSyms()) + symbol_id));
+  }
+
   /// Return the frame duration in seconds
   inline double GetFrameDurationSec() const {
     return ((this->frame_.NumTotalSyms() * this->samps_per_symbol_) /
@@ -513,7 +1018,7 @@ class Config {
   /// be an uplink symbol.
   inline complex_float* GetDataBuf(Table<complex_float>& data_buffers,
                                    size_t frame_id, size_t symbol_id) const {
-    size_t frame_slot = frame_id % kFrameWnd;
+    size_t frame_slot = frame_id % this->frame_window_;
     size_t symbol_offset = (frame_slot * this->frame_.NumULSyms()) +
                            this->frame_.GetULSymbolIdx(symbol_id);
     return data_buffers[symbol_offset];
@@ -522,14 +1027,13 @@ class Config {
   /// Return the subcarrier ID which we should refer to for the beamweight
   /// matrices of subcarrier [sc_id].
   inline size_t GetBeamScId(size_t sc_id) const {
-    return this->group_pilot_sc_ ? sc_id - (sc_id % this->pilot_sc_group_size_)
-                                 : sc_id;
+    return sc_id - (sc_id % this->beam_sc_stride_);
   }
 
   /// Get the calibration buffer for this frame and subcarrier ID
   inline complex_float* GetCalibBuffer(Table<complex_float>& calib_buffer,
                                        size_t frame_id, size_t sc_id) const {
-    size_t frame_slot = frame_id % kFrameWnd;
+    size_t frame_slot = frame_id % this->frame_window_;
     return &calib_buffer[frame_slot][sc_id * bs_ant_num_];
   }
 
@@ -549,9 +1053,9 @@ class Config {
       num_bytes_per_cb = this->ul_num_bytes_per_cb_;
       mac_packet_length = this->ul_mac_packet_length_;
     }
-    return &info_bits[ue_id][(frame_id % kFrameWnd) * mac_bytes_perframe +
-                             symbol_id * mac_packet_length +
-                             cb_id * num_bytes_per_cb];
+    return &info_bits[ue_id]
+                     [(frame_id % this->frame_window_) * mac_bytes_perframe +
+                      symbol_id * mac_packet_length + cb_id * num_bytes_per_cb];
   }
 
   /// Get info bits for this symbol, user and code block ID
@@ -607,6 +1111,21 @@ class Config {
     return dl_symbol_data_id_.at(sc_id);
   }
 
+  // Returns the subcarrier of a data index, the inverse of GetOFDMDataIndex
+  inline size_t GetOFDMDataSc(size_t data_idx) const {
+    return dl_data_sc_id_.at(data_idx);
+  }
+
+  // Returns the index of the modulated symbol of a stream on a subcarrier in
+  // a downlink symbol of the fused encode and modulation buffer. This is the
+  // input layout of the batched precoder: blocks of kSCsPerCacheline
+  // subcarriers, with the subcarriers of a stream contiguous in a block.
+  inline size_t DlModSymbolIndex(size_t sc_id, size_t sp_id) const {
+    return (sc_id / kSCsPerCacheline) * kSCsPerCacheline *
+               this->num_spatial_streams_ +
+           sp_id * kSCsPerCacheline + sc_id % kSCsPerCacheline;
+  }
+
   inline size_t GetOFDMCtrlIndex(size_t sc_id) const {
     return dl_symbol_ctrl_id_.at(sc_id);
   }
@@ -619,6 +1138,77 @@ class Config {
   }
   inline const std::string& ConfigFilename() const { return config_filename_; }
   inline const std::string& TraceFilename() const { return trace_file_; }
+  /// Number of threads that compress and write the hdf5 chunks of the
+  /// recorder, 0 to write each rx symbol on the recorder thread
+  inline size_t RecorderWriterThreads() const {
+    return recorder_writer_threads_;
+  }
+  /// Frames, symbols and antennas in one hdf5 chunk of the recorder
+  inline const std::array<size_t, 3>& RecorderChunk() const {
+    return recorder_chunk_;
+  }
+  /// Deflate level (with byte shuffle) of the recorder chunks, 0 for none
+  inline size_t RecorderCompression() const { return recorder_compression_; }
+  /// Number of chunks the recorder writer threads stage at a time
+  inline size_t RecorderStagingChunks() const {
+    return recorder_staging_chunks_;
+  }
+  /// True if the recorder drops rx symbols when no staging chunk is free,
+  /// instead of waiting for the writer threads
+  inline bool RecorderDropWhenFull() const { return recorder_drop_when_full_; }
+  /// True if the multifile recorder writes with O_DIRECT, bypassing the page
+  /// cache
+  inline bool RecorderDirectIo() const { return recorder_direct_io_; }
+  /// Number of direct writes of the multifile recorder in flight
+  inline size_t RecorderIoDepth() const { return recorder_io_depth_; }
+  /// Number of files the multifile recorder writes between two syncs of the
+  /// file system, 0 to sync only at the end
+  inline size_t RecorderFsyncBatch() const { return recorder_fsync_batch_; }
+  /// Number of frames the recorder may lag behind the FFT. The rx packets of
+  /// as many more frames are allocated, as the recorder holds the packets it
+  /// records.
+  inline size_t RecorderLagFrames() const { return recorder_lag_frames_; }
+  /// First antenna and number of antennas the recorder records
+  inline const std::array<size_t, 2>& RecorderAntennas() const {
+    return recorder_antennas_;
+  }
+  /// True if the recorder records the rx symbols of type
+  inline bool RecorderRecordsSymbol(SymbolType type) const {
+    return std::find(recorder_symbols_.begin(), recorder_symbols_.end(),
+                     type) != recorder_symbols_.end();
+  }
+  /// The recorder records one frame out of this many
+  inline size_t RecorderFrameDecimation() const {
+    return recorder_frame_decimation_;
+  }
+  /// Format the recorder writes the rx samples in
+  inline IqFormat RecorderSampleFormat() const {
+    return recorder_sample_format_;
+  }
+  /// Number of frames the recorder keeps in memory until a capture
+  /// triggers, 0 to record every frame
+  inline size_t CaptureFrames() const { return capture_frames_; }
+  /// Per-frame tables kept with the captured frames: csi, equal, demod
+  inline const std::vector<std::string>& CaptureTables() const {
+    return capture_tables_;
+  }
+  /// Points of the data taps, e.g. equal (data_tap.h)
+  inline const std::vector<std::string>& TapPoints() const {
+    return tap_points_;
+  }
+  /// The taps publish every TapSubsample()-th frame
+  inline size_t TapSubsample() const { return tap_subsample_; }
+  /// Records in the ring of each tap
+  inline size_t TapSlots() const { return tap_slots_; }
+  /// Prefix of the tap names, empty for the default of the process
+  inline const std::string& TapName() const { return tap_name_; }
+  /// Frames in a row with block errors that trigger a capture, 0 for none
+  inline size_t CaptureCrcBurst() const { return capture_crc_burst_; }
+  /// Drop (dB) of a UE's EVM SNR below its average that triggers a capture,
+  /// 0 for none
+  inline float CaptureEvmDrop() const { return capture_evm_drop_; }
+  /// True if a downlink dropped for its TX deadline triggers a capture
+  inline bool CaptureDeadlineMiss() const { return capture_deadline_miss_; }
   inline const std::string& Timestamp() const { return timestamp_; }
   inline const std::vector<std::string>& UlTxFreqDataFiles() const {
     return ul_tx_f_data_files_;
@@ -629,6 +1219,21 @@ class Config {
   nlohmann::json Parse(const nlohmann::json& in_json,
                        const std::string& json_handle);
   void DumpMcsInfo();
+  /// Precompute the parameters of every MCS index of a direction, with the
+  /// LDPC options of mcs_params
+  void BuildMcsBank(Direction dir, const nlohmann::json& mcs_params);
+  /// The MCS index mcs_params asks for, by index or by modulation and code
+  /// rate
+  size_t ParseMcsIndex(const nlohmann::json& mcs_params,
+                       const std::string& dir) const;
+  /// Hash of the configuration and data files the test vectors come from
+  uint64_t TestVectorHash() const;
+  /// Copy the read-only tables the workers read to each NUMA node, with
+  /// numa_bind_buffers
+  void ReplicateReadOnlyTables();
+  /// Read or generate the data bits and generate the test vector tables from
+  /// them. False if the encoded uplink data file is missing.
+  bool GenTestVectors();
 
   /* Class constants */
   inline static const size_t kDefaultSymbolNumPerFrame = 70;
@@ -680,6 +1285,14 @@ class Config {
   // in block of ofdm_ca_num_ subcarriers.
   size_t ofdm_data_stop_;
 
+  // The non-zero subcarriers of the whole carrier, of which this node
+  // processes the ofdm_data_num_ from sc_slice_start_ when the carrier is
+  // split across sc_slice_nodes_ nodes
+  size_t carrier_data_num_;
+  size_t sc_slice_nodes_;
+  size_t sc_slice_node_;
+  size_t sc_slice_start_;
+
   size_t ofdm_pilot_spacing_;
 
   std::string ul_modulation_;  // Modulation order as a string, e.g., "16QAM"
@@ -689,9 +1302,21 @@ class Config {
   size_t dl_mod_order_bits_;
   size_t dl_bcast_mod_order_bits_;
 
-  // Modulation lookup table for mapping binary bits to constellation points
-  Table<complex_float> ul_mod_table_;
-  Table<complex_float> dl_mod_table_;
+  // Modulation lookup table for mapping binary bits to constellation points,
+  // one of mod_tables_
+  Table<complex_float>* ul_mod_table_;
+  Table<complex_float>* dl_mod_table_;
+  // Constellation of each modulation order, indexed by its bits
+  std::array<Table<complex_float>, kMaxModType + 1> mod_tables_;
+  // Copies of the read-only tables of the workers on each NUMA node, with
+  // numa_bind_buffers on a multi-node machine
+  std::array<NumaReplica<complex_float>, kMaxModType + 1> mod_table_replicas_;
+  NumaReplica<complex_float> ue_specific_pilot_replica_;
+  NumaReplica<int8_t> ul_bits_replica_;
+  std::array<McsParams, kNumMcs> ul_mcs_bank_;
+  std::array<McsParams, kNumMcs> dl_mcs_bank_;
+  std::array<bool, kNumMcs> ul_mcs_switchable_{};
+  size_t ul_decoded_cb_stride_;
 
   LDPCconfig ul_ldpc_config_;        // Uplink LDPC parameters
   LDPCconfig dl_ldpc_config_;        // Downlink LDPC parameters
@@ -708,6 +1333,8 @@ class Config {
   // representing the symbol types in the frame (e.g., 'P' for pilot symbols,
   // 'U' for uplink data symbols)
   FrameStats frame_;
+  // Type of each symbol of frame_, looked up per packet and task
+  std::vector<SymbolType> symbol_types_;
 
   std::atomic<bool> running_;
 
@@ -717,6 +1344,8 @@ class Config {
   std::vector<SubcarrierType> dl_symbol_map_;
   std::vector<SubcarrierType> control_symbol_map_;
   std::vector<size_t> dl_symbol_data_id_;
+  // Maps data index to subcarrier index
+  std::vector<size_t> dl_data_sc_id_;
   std::vector<size_t> dl_symbol_ctrl_id_;
 
   Table<int8_t> dl_bits_;
@@ -727,6 +1356,8 @@ class Config {
   Table<complex_float> ul_iq_f_;
   Table<std::complex<int16_t>> dl_iq_t_;
   Table<std::complex<int16_t>> ul_iq_t_;
+  // The file the test vector tables are mapped from, or were written to
+  std::unique_ptr<TestVectorFile> test_vectors_;
 
   std::vector<std::complex<float>> gold_cf32_;
   std::vector<std::complex<int16_t>> beacon_ci16_;
@@ -771,6 +1402,9 @@ class Config {
   // true: use hardware correlator; false: use software corrleator
   bool hw_framer_;
   bool ue_hw_framer_;
+  // Analog beam sweep of the phased arrays, 0 beams disables it
+  size_t analog_beams_;
+  size_t beam_sweep_interval_;
   size_t ue_resync_period_;
 
   double freq_;
@@ -810,6 +1444,87 @@ class Config {
 
   size_t core_offset_;
   size_t worker_thread_num_;
+  // Worker threads, including the master thread when it runs doers
+  // (single_core / master_assisted), see ExecutionModel
+  ExecutionModel execution_model_;
+  // "task_scheduler": "work_stealing" instead of the default "queues"
+  bool work_stealing_;
+  // "decode_ue_affinity": workers per UE of the decode tasks, 0 for none
+  size_t decode_ue_affinity_;
+  // "worker_groups", split into one entry per stage
+  std::map<std::string, std::vector<size_t>> worker_groups_;
+  // "resctrl", by thread class
+  std::map<std::string, Resctrl::ClassAllocation> resctrl_classes_;
+  bool worker_group_borrow_;
+  // Phases of the IdlePolicy of the polling threads
+  double idle_spin_us_;
+  double idle_pause_us_;
+  double idle_sleep_us_;
+  // Slack below which a frame's downlink is dropped instead of scheduled
+  double dl_deadline_margin_us_;
+  // Task time of each master iteration when the master runs the doers
+  double master_task_budget_us_;
+  // Reception time after which a frame goes on with the packets it has
+  double rx_frame_timeout_us_;
+  // Frames in flight held by the AgoraBuffer tables, <= kFrameWnd
+  size_t frame_window_;
+  // RX bookkeeping on its own thread
+  bool rx_manager_;
+  // Dequeue bulk sizes that follow the queue backlogs
+  bool adaptive_dequeue_;
+  // Per-TxRx-thread event rings
+  bool rx_event_rings_;
+  bool inline_txrx_;
+  // Frames in processing at once, <= kMaxScheduleQueues
+  size_t pipeline_depth_;
+  // "buffer_page_type": "default", "2M" or "1G"
+  Agora_memory::PageType buffer_page_type_;
+  bool numa_bind_buffers_;
+  bool prefault_buffers_;
+  bool lock_memory_;
+  double init_time_ms_{0};
+  double gen_data_time_ms_{0};
+  bool event_batching_;
+  double adaptive_block_target_us_;
+  bool shared_counters_;
+  bool bench_mode_;
+  double bench_frame_duration_us_;
+  bool fuse_fft_demul_;
+  bool fft_batch_symbol_;
+  std::string fft_backend_;
+  std::string fft_wisdom_file_;
+  bool fuse_precode_ifft_;
+  bool ifft_batch_symbol_;
+  bool batch_encode_;
+  bool fuse_encode_modulation_;
+  bool adaptive_decode_iter_;
+  size_t min_decoder_iter_;
+  float decode_iter_snr_low_db_;
+  float decode_iter_snr_high_db_;
+  double decode_overload_us_;
+  bool ul_beam_int16_;
+  bool gemm_batch_;
+  bool task_prefetch_;
+  std::vector<std::string> nt_stores_;
+  bool early_decode_;
+  size_t harq_processes_;
+  size_t harq_max_tx_;
+  size_t harq_llr_bits_;
+  size_t acc_spill_ops_;
+  double acc_spill_latency_us_;
+  AccBatchPolicy acc_batch_policy_;
+  double acc_batch_latency_us_;
+  size_t acc_batch_max_ops_;
+  uint8_t bbdev_dev_id_;
+  bool ue_acc_decode_;
+  uint8_t ue_bbdev_dev_id_;
+  // "stage_deadlines_us": {"<stage>": <budget>, ...}, see Stats
+  std::map<std::string, double> stage_deadlines_us_;
+  // "fast_math": {"<family>": "exact" | "refined" | "approx", ...}
+  std::array<FastMath::Precision, FastMath::kNumFamilies> fast_math_;
+  size_t latency_report_interval_;
+  size_t ul_mini_slot_symbols_;
+  size_t ul_mini_slots_;
   size_t socket_thread_num_;
   size_t fft_thread_num_;
   size_t demul_thread_num_;
@@ -819,6 +1534,12 @@ class Config {
   size_t ue_core_offset_;
   size_t ue_worker_thread_num_;
   size_t ue_socket_thread_num_;
+  // If true, the client encodes, modulates and iffts an uplink symbol in a
+  // single task
+  bool ue_fused_ul_tx_;
+  // Frames the client radios transmit the uplink later than TX_FRAME_DELTA,
+  // the frames are held in a tx ring until shortly before their tx time
+  size_t ue_tx_lookahead_frames_;
 
   // If true, accelerate small MIMO such as 1x1, 2x2, and 4x4. Vector operations
   // are done across subcarriers instead of looping through each subcarrier.
@@ -830,11 +1551,36 @@ class Config {
   size_t demul_block_size_;
   // Derived from demul_block_size
   size_t demul_events_per_symbol_;
-
+  // "demod_llr_bits" of the uplink LLRs, 8 unless packed
+  size_t demod_llr_bits_;
+
+  /// Beamweights are computed for the subcarriers that are a multiple of
+  /// beam_sc_stride (pilot_sc_group_size or 1 by default)
+  size_t beam_sc_stride_;
+  /// Linearly interpolate the uplink beamweights between those subcarriers
+  bool beam_interpolation_;
   /// Number of OFDM data subcarriers handled in 1 kBeam event
   size_t beam_block_size_;
   /// Beam Events generated per Frame.  Derived from beam_block_size
   size_t beam_events_per_symbol_;
+  /// Largest relative CSI change of a beam block, between the frame its
+  /// beamweights were computed in and the current frame, for which the
+  /// previous frame's beamweights are reused. 0 disables the reuse
+  float beam_reuse_threshold_;
+  /// Beamweights are recomputed at least once every beam_reuse_max_frames
+  size_t beam_reuse_max_frames_;
+  /// Frames of CSI the beamweights of the next frame are predicted from, on
+  /// idle workers, 0 for no prediction. A beam block uses its predicted
+  /// beamweights if its CSI is within beam_reuse_threshold of the prediction
+  size_t beam_prediction_frames_;
+  /// Compute the detector Gram matrices with AMX-BF16 if available
+  bool amx_beams_;
+  /// Largest estimated relative error of an AMX-based detector inverse
+  /// (condition number times the bf16 rounding error) before the float Gram
+  /// matrix is used instead
+  float amx_beam_tolerance_;
+  /// Run the uplink beamweights and demodulation on a CUDA GPU
+  bool gpu_uplink_;
 
   // Number of antennas handled in one FFT event
   size_t fft_block_size_;
@@ -968,9 +1714,37 @@ class Config {
   // MAC addresses of NIC ports separated by ';'
   std::string dpdk_mac_addrs_;
 
+  // Receive DPDK packets without copying them out of the mbufs
+  bool dpdk_zero_copy_rx_;
+  // Send DPDK packets without copying them into the mbufs
+  bool dpdk_zero_copy_tx_;
+  size_t dpdk_rx_burst_;
+  bool dpdk_adaptive_rx_burst_;
+  bool dpdk_drop_unmatched_;
+  // Interfaces (radios) of each NIC port, empty for an even split
+  std::vector<size_t> dpdk_port_interfaces_;
+
+  std::string xdp_interface_;
+  size_t xdp_queue_offset_;
+  bool xdp_zero_copy_;
+
+  bool usrp_rx_streaming_;
+  bool usrp_tx_burst_;
+  bool hw_zero_copy_rx_;
+
   // Port ID at BaseStation MAC layer side
   size_t bs_mac_rx_port_;
   size_t bs_mac_tx_port_;
+  bool mac_tb_ring_;
+  bool mac_ring_hugepage_;
+  // "mac_scheduler": "proportional_fair" instead of "round_robin"
+  bool mac_scheduler_pf_;
+  size_t pf_window_frames_;
+  // Channel-aware UE groups of the scheduler
+  bool ue_grouping_;
+  float ue_grouping_max_corr_;
+  float ul_offered_load_;
+  float dl_offered_load_;
 
   // Port ID at Client MAC layer side
   size_t ue_mac_rx_port_;
@@ -979,12 +1753,36 @@ class Config {
   // Port ID at log listening server
   size_t log_listener_port_;
 
+  // Per-thread event records of the Chrome trace, 0 if disabled
+  size_t task_trace_events_;
+  // Binary log of a row per frame, in place of the text timestamp files
+  bool frame_log_;
+  // Events per hardware counter sample of the workers, 0 if disabled
+  size_t perf_sample_interval_;
+  // Stall detection of the worker tasks, a factor of 0 disables it
+  double stall_factor_;
+  double stall_min_us_;
+
+  // Live telemetry over HTTP, a port of 0 disables a server
+  std::string telemetry_addr_;
+  size_t bs_telemetry_port_;
+  size_t ue_telemetry_port_;
+  double telemetry_interval_ms_;
+
   // Number of logged subcarrier data samples
   size_t log_sc_num_;
 
   // Whether use unique timestamp as subdirectory of csv log files
   bool log_timestamp_;
 
+  // Sampling rates of the EVM and CSI condition number statistics, in frames
+  // and in blocks of kSCsPerCacheline subcarriers
+  size_t phy_stats_frame_sampling_;
+  size_t phy_stats_sc_sampling_;
+  // Uplink SNR from decision-directed EVM, post-equalization SINR and LDPC
+  // iterations instead of the ground truth
+  bool blind_link_quality_;
+
   // Number of frames_ sent by sender during testing = number of frames_
   // processed by Agora before exiting.
   size_t frames_to_test_;
@@ -1003,8 +1801,50 @@ class Config {
   size_t dl_num_padding_bytes_per_cb_;
 
   bool fft_in_rru_;  // If true, the RRU does FFT instead of Agora
+  size_t fronthaul_bfp_bits_;
+  bool cfo_correction_;
+  bool fft_int16_;
+  // The O-RAN fronthaul, see OranFronthaul()
+  bool oran_fronthaul_;
+  size_t oran_bfp_bits_;
+  std::string oran_ru_macs_;
+  size_t oran_vlan_;
+  size_t oran_numerology_;
+  std::vector<size_t> oran_t1a_up_us_;
+  size_t oran_tcp_adv_dl_us_;
+  // Uplink packets per fronthaul datagram
+  size_t fronthaul_aggregation_;
+  // "sim_transport": "shm" makes the simulator links ShmComm rings of
+  // sim_shm_slots_ packets of up to sim_shm_slot_bytes_
+  bool sim_shm_;
+  size_t sim_shm_slots_;
+  bool sim_shm_hugepage_;
+  size_t sim_shm_slot_bytes_;
+  bool sim_dpdk_;
   const std::string config_filename_;
   std::string trace_file_;
+  size_t recorder_writer_threads_;
+  std::array<size_t, 3> recorder_chunk_;
+  size_t recorder_compression_;
+  size_t recorder_staging_chunks_;
+  bool recorder_drop_when_full_;
+  bool recorder_direct_io_;
+  size_t recorder_io_depth_;
+  size_t recorder_fsync_batch_;
+  size_t recorder_lag_frames_;
+  std::array<size_t, 2> recorder_antennas_;
+  std::vector<SymbolType> recorder_symbols_;
+  size_t recorder_frame_decimation_;
+  IqFormat recorder_sample_format_;
+  size_t capture_frames_;
+  std::vector<std::string> capture_tables_;
+  std::vector<std::string> tap_points_;
+  size_t tap_subsample_;
+  size_t tap_slots_;
+  std::string tap_name_;
+  size_t capture_crc_burst_;
+  float capture_evm_drop_;
+  bool capture_deadline_miss_;
   std::string timestamp_;
   std::vector<std::string> ul_tx_f_data_files_;
 };
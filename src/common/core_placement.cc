@@ -0,0 +1,162 @@
+/**
+ * @file core_placement.cc
+ * @brief Implementation file for the automatic core layout.
+ */
+#include "core_placement.h"
+
+#include <numa.h>
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+namespace CorePlacement {
+
+static const std::string kCpuPath = "/sys/devices/system/cpu/";
+
+// First line of a sysfs file, empty if it cannot be read
+static std::string ReadSysfs(const std::string& path) {
+  std::ifstream file(path);
+  std::string line;
+  if (file.is_open()) {
+    std::getline(file, line);
+  }
+  return line;
+}
+
+std::vector<size_t> ParseCpuList(const std::string& list) {
+  std::vector<size_t> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.find_first_of("0123456789") == std::string::npos) {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    const size_t first = std::stoul(range.substr(0, dash));
+    const size_t last = (dash == std::string::npos)
+                            ? first
+                            : std::stoul(range.substr(dash + 1));
+    for (size_t cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<Cpu> ReadTopology() {
+  const std::vector<size_t> isolated =
+      ParseCpuList(ReadSysfs(kCpuPath + "isolated"));
+  const bool numa = (numa_available() >= 0);
+  std::vector<Cpu> cpus;
+  for (size_t id : ParseCpuList(ReadSysfs(kCpuPath + "online"))) {
+    const std::string topology =
+        kCpuPath + "cpu" + std::to_string(id) + "/topology/";
+    Cpu cpu;
+    cpu.id_ = id;
+    cpu.numa_node_ = numa ? numa_node_of_cpu(static_cast<int>(id)) : 0;
+    const std::string package = ReadSysfs(topology + "physical_package_id");
+    cpu.package_ = package.empty() ? 0 : std::stoi(package);
+    const std::vector<size_t> siblings =
+        ParseCpuList(ReadSysfs(topology + "thread_siblings_list"));
+    cpu.core_first_cpu_ = siblings.empty()
+                              ? id
+                              : *std::min_element(siblings.begin(),
+                                                  siblings.end());
+    cpu.isolated_ =
+        std::find(isolated.begin(), isolated.end(), id) != isolated.end();
+    cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+int DeviceNumaNode(const std::string& device) {
+  std::string node =
+      ReadSysfs("/sys/class/net/" + device + "/device/numa_node");
+  if (node.empty()) {
+    node = ReadSysfs("/sys/bus/pci/devices/" + device + "/numa_node");
+  }
+  return node.empty() ? -1 : std::stoi(node);
+}
+
+std::vector<Slot> Plan(const std::vector<Cpu>& cpus,
+                       const std::vector<size_t>& excluded,
+                       const std::vector<int>& device_nodes) {
+  std::vector<int> nodes;
+  for (int node : device_nodes) {
+    if ((node >= 0) &&
+        (std::find(nodes.begin(), nodes.end(), node) == nodes.end())) {
+      nodes.push_back(node);
+    }
+  }
+  std::set<int> device_packages;
+  for (const Cpu& cpu : cpus) {
+    if (std::find(nodes.begin(), nodes.end(), cpu.numa_node_) != nodes.end()) {
+      device_packages.insert(cpu.package_);
+    }
+  }
+  // The nodes of the devices in their order, then the other nodes of their
+  // sockets, then the other sockets
+  auto node_rank = [&](const Cpu& cpu) {
+    const auto it = std::find(nodes.begin(), nodes.end(), cpu.numa_node_);
+    if (it != nodes.end()) {
+      return std::make_tuple(0, static_cast<int>(it - nodes.begin()));
+    }
+    const bool same_package = (device_packages.count(cpu.package_) > 0);
+    return std::make_tuple(same_package ? 1 : 2, cpu.numa_node_);
+  };
+
+  std::vector<Cpu> order;
+  std::set<size_t> included;
+  for (const Cpu& cpu : cpus) {
+    if (std::find(excluded.begin(), excluded.end(), cpu.id_) ==
+        excluded.end()) {
+      order.push_back(cpu);
+      included.insert(cpu.id_);
+    }
+  }
+  // A CPU whose first sibling is excluded has the physical core to itself
+  auto shares_core = [&](const Cpu& cpu) {
+    return (cpu.id_ != cpu.core_first_cpu_) &&
+           (included.count(cpu.core_first_cpu_) > 0);
+  };
+  std::sort(order.begin(), order.end(), [&](const Cpu& a, const Cpu& b) {
+    return std::make_tuple(shares_core(a), node_rank(a), !a.isolated_, a.id_) <
+           std::make_tuple(shares_core(b), node_rank(b), !b.isolated_, b.id_);
+  });
+
+  const bool any_isolated = std::any_of(
+      cpus.begin(), cpus.end(), [](const Cpu& cpu) { return cpu.isolated_; });
+  std::set<size_t> used_cores;
+  std::vector<Slot> slots;
+  for (const Cpu& cpu : order) {
+    Slot slot;
+    slot.cpu_ = cpu.id_;
+    slot.smt_sibling_ =
+        (used_cores.insert(cpu.core_first_cpu_).second == false);
+    slot.isolated_ = cpu.isolated_;
+    slot.remote_ = (nodes.empty() == false) &&
+                   (std::get<0>(node_rank(cpu)) != 0);
+    std::stringstream reason;
+    reason << "node " << cpu.numa_node_;
+    if (nodes.empty() == false) {
+      reason << (slot.remote_ ? " (remote from the devices)"
+                              : " (devices' node)");
+    }
+    if (slot.smt_sibling_) {
+      reason << ", SMT sibling of cpu " << cpu.core_first_cpu_;
+    } else {
+      reason << ", own physical core";
+    }
+    if (any_isolated) {
+      reason << (cpu.isolated_ ? ", isolated" : ", not isolated");
+    }
+    slot.reason_ = reason.str();
+    slots.push_back(slot);
+  }
+  return slots;
+}
+
+}  // namespace CorePlacement
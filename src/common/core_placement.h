@@ -0,0 +1,64 @@
+/**
+ * @file core_placement.h
+ * @brief Declaration file for the automatic core layout, which orders the
+ * CPUs PinToCoreWithOffset hands out from the sysfs topology.
+ */
+#ifndef CORE_PLACEMENT_H_
+#define CORE_PLACEMENT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace CorePlacement {
+
+/// A logical CPU of the topology
+struct Cpu {
+  size_t id_;
+  int numa_node_;
+  int package_;
+  // Lowest CPU of the physical core, id_ for its first hardware thread
+  size_t core_first_cpu_;
+  // In the isolcpus list of the kernel
+  bool isolated_;
+};
+
+/// A CPU of the layout and why it has its place
+struct Slot {
+  size_t cpu_;
+  // Shares its physical core with a CPU earlier in the layout
+  bool smt_sibling_;
+  bool isolated_;
+  // On another NUMA node than the devices
+  bool remote_;
+  std::string reason_;
+};
+
+/// The CPUs of a kernel CPU list, e.g. "0-3,8,10-11"
+std::vector<size_t> ParseCpuList(const std::string& list);
+
+/// The online CPUs, from sysfs and libnuma
+std::vector<Cpu> ReadTopology();
+
+/// NUMA node of a network interface (e.g. "ens1f0") or PCI device (e.g.
+/// "0000:17:00.0"), -1 if unknown
+int DeviceNumaNode(const std::string& device);
+
+/**
+ * @brief Order the CPUs so that the threads pinned at consecutive offsets
+ * (master, TxRx, workers, MAC, recorder) use one hardware thread per physical
+ * core, starting on the NUMA nodes of the devices, isolated CPUs first.
+ * SMT siblings come last.
+ *
+ * @param cpus The topology
+ * @param excluded CPUs left out of the layout
+ * @param device_nodes NUMA nodes of the NIC and accelerator, preferred in
+ * that order. Unknown (negative) nodes are ignored.
+ */
+std::vector<Slot> Plan(const std::vector<Cpu>& cpus,
+                       const std::vector<size_t>& excluded,
+                       const std::vector<int>& device_nodes);
+
+}  // namespace CorePlacement
+
+#endif  // CORE_PLACEMENT_H_
@@ -36,6 +36,8 @@
 
 #include "crc.h"
 
+#include <immintrin.h>
+
 #ifdef REBUILD_TABLE
 static void DoCRC::init_crc24(uint32_t table[256]) {
   /*
@@ -84,16 +86,112 @@ void DoCRC::AddCrc24(MacPacketPacked* p) {
   p->Crc(crc);
 }
 
+// CRC24A generating polynomial, without the x^24 term
+static constexpr uint32_t kCrc24Poly = 0x864CFBu;
+
+// x^n mod G_CRC_24A(x), as the 24 low bits
+static constexpr uint64_t Crc24XPowMod(size_t n) {
+  uint32_t rem = 1;
+  for (size_t i = 0; i < n; i++) {
+    rem <<= 1;
+    if ((rem & 0x1000000u) != 0) {
+      rem = (rem ^ kCrc24Poly) & 0xFFFFFFu;
+    }
+  }
+  return rem;
+}
+
+#if defined(__PCLMUL__)
+// Inputs of at least this many bytes are folded with carry-less multiplies
+static constexpr int kCrcFoldMinBytes = 32;
+
+// Fold the 128-bit polynomial acc over the next 128 bits of the message:
+// acc * x^128 + next, reduced to 128 bits modulo G_CRC_24A with the
+// constants lo64(k) = x^128 mod G and hi64(k) = x^192 mod G
+static inline __m128i Crc24Fold128(__m128i acc, __m128i next, __m128i k) {
+  const __m128i hi = _mm_clmulepi64_si128(acc, k, 0x11);
+  const __m128i lo = _mm_clmulepi64_si128(acc, k, 0x00);
+  return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+// Load 16 message bytes as a polynomial, with the first byte in the highest
+// bits (the CRC is MSB first)
+static inline __m128i Crc24Load128(const unsigned char* data) {
+  const __m128i bswap =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), bswap);
+}
+
+// Fold the first len & ~15 bytes of data into a 128-bit polynomial congruent
+// to them modulo G_CRC_24A. Returns the number of bytes folded, which is at
+// least 32.
+static size_t Crc24Fold(const unsigned char* data, size_t len,
+                        unsigned char folded[16]) {
+  const __m128i k128 = _mm_set_epi64x(Crc24XPowMod(192), Crc24XPowMod(128));
+  size_t pos = 0;
+  __m128i acc;
+#if defined(__VPCLMULQDQ__) && defined(__AVX512BW__)
+  if (len >= 128) {
+    // Four 128-bit accumulators, one per lane, each folded over 512 bits
+    const __m512i k512 = _mm512_broadcast_i32x4(
+        _mm_set_epi64x(Crc24XPowMod(576), Crc24XPowMod(512)));
+    const __m512i bswap = _mm512_broadcast_i32x4(
+        _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+    __m512i acc4 = _mm512_shuffle_epi8(_mm512_loadu_si512(data), bswap);
+    for (pos = 64; pos + 64 <= len; pos += 64) {
+      const __m512i next =
+          _mm512_shuffle_epi8(_mm512_loadu_si512(data + pos), bswap);
+      const __m512i hi = _mm512_clmulepi64_epi128(acc4, k512, 0x11);
+      const __m512i lo = _mm512_clmulepi64_epi128(acc4, k512, 0x00);
+      acc4 = _mm512_ternarylogic_epi64(hi, lo, next, 0x96);
+    }
+    // acc0 * x^384 + acc1 * x^256 + acc2 * x^128 + acc3
+    acc = _mm512_extracti32x4_epi32(acc4, 0);
+    acc = Crc24Fold128(acc, _mm512_extracti32x4_epi32(acc4, 1), k128);
+    acc = Crc24Fold128(acc, _mm512_extracti32x4_epi32(acc4, 2), k128);
+    acc = Crc24Fold128(acc, _mm512_extracti32x4_epi32(acc4, 3), k128);
+  } else
+#endif
+  {
+    acc = Crc24Load128(data);
+    pos = 16;
+  }
+  for (; pos + 16 <= len; pos += 16) {
+    acc = Crc24Fold128(acc, Crc24Load128(data + pos), k128);
+  }
+  const __m128i bswap =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(folded),
+                   _mm_shuffle_epi8(acc, bswap));
+  return pos;
+}
+#endif
+
+uint32_t DoCRC::UpdateCrc24(uint32_t crc, const unsigned char* data,
+                            size_t len) const {
+  for (size_t i = 0; i < len; i++) {
+    crc = (crc << 8) ^ crc24_table_[data[i] ^ (unsigned char)(crc >> 16)];
+  }
+  return crc;
+}
+
 uint32_t DoCRC::CalculateCrc24(const unsigned char* data, int len) {
   /*
-   *
+   * With PCLMULQDQ, long inputs are first folded into 16 bytes that have the
+   * same CRC as the folded part of the input, and the table finishes the CRC
+   * over them and the tail.
    */
-  int i;
   uint32_t crc = 0;
-
-  for (i = 0; i < len; i++) {
-    crc = (crc << 8) ^ crc24_table_[data[i] ^ (unsigned char)(crc >> 16)];
+  size_t done = 0;
+#if defined(__PCLMUL__)
+  if (len >= kCrcFoldMinBytes) {
+    unsigned char folded[16];
+    done = Crc24Fold(data, len, folded);
+    crc = UpdateCrc24(crc, folded, sizeof(folded));
   }
+#endif
+  crc = UpdateCrc24(crc, data + done, len - done);
 
   crc = (crc & 0x00ffffff);
 
@@ -13,6 +13,7 @@
 #ifndef CRC_H_
 #define CRC_H_
 
+#include <cstddef>
 #include <cstdint>
 
 #include "message.h"
@@ -32,6 +33,10 @@ class DoCRC {
  private:
   const uint32_t crc24_table_[256];
 
+  // Continue a CRC over len bytes of data with the table, one byte at a time
+  uint32_t UpdateCrc24(uint32_t crc, const unsigned char* data,
+                       size_t len) const;
+
  public:
   DoCRC()
       : crc24_table_{
@@ -96,7 +101,8 @@ class DoCRC {
   static void InitCrc24(uint32_t table[256]);
 
   /**
-   * Compute CRC
+   * Compute CRC. Inputs of 32 bytes or more are folded with carry-less
+   * multiplies (PCLMULQDQ, VPCLMULQDQ) when the CPU supports them.
    */
   uint32_t CalculateCrc24(const unsigned char* data, int len);
 
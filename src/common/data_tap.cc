@@ -0,0 +1,244 @@
+/**
+ * @file data_tap.cc
+ * @brief Implementation file for the data taps
+ */
+#include "data_tap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "config.h"
+#include "logger.h"
+#include "utils.h"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "DataTap needs lock-free atomics to share memory");
+
+static const std::string kShmDir = "/dev/shm/";
+static constexpr uint64_t kTapMagic = 0x5041545f41524f47;  // "GORA_TAP"
+// Each slot starts with its sequence word and the record header, padded to
+// a cache line
+static constexpr size_t kSlotHeaderBytes = 64;
+static_assert(sizeof(std::atomic<uint64_t>) + sizeof(TapRecord) <=
+                  kSlotHeaderBytes,
+              "The tap record header does not fit the slot header");
+
+static constexpr std::array<const char*, kNumTapPoints> kTapPointNames = {
+    "fft_iq", "csi", "beams", "equal", "llr", "decoded"};
+
+struct DataTap::Ring {
+  uint64_t magic_;
+  uint64_t num_slots_;
+  uint64_t record_bytes_;
+  alignas(64) std::atomic<uint64_t> consumers_;
+  alignas(64) std::atomic<uint64_t> next_seq_;  // Next record to publish
+};
+
+namespace {
+// Header of the slot of a record: its sequence word is 2 * seq + 1 while the
+// record seq is written and 2 * seq + 2 once it is complete
+struct SlotHeader {
+  std::atomic<uint64_t> state_;
+  TapRecord record_;
+};
+}  // namespace
+
+const char* TapPointName(TapPoint point) {
+  return kTapPointNames.at(static_cast<size_t>(point));
+}
+
+bool TapPointFromName(const std::string& name, TapPoint& point) {
+  for (size_t i = 0; i < kNumTapPoints; i++) {
+    if (name == kTapPointNames.at(i)) {
+      point = static_cast<TapPoint>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+static std::string TapPath(const std::string& name) {
+  return kShmDir + "agora_tap_" + name;
+}
+
+std::byte* DataTap::Slot(Ring* ring, uint64_t seq) {
+  return reinterpret_cast<std::byte*>(ring + 1) +
+         ((seq & (ring->num_slots_ - 1)) *
+          (kSlotHeaderBytes + ring->record_bytes_));
+}
+
+DataTap::DataTap(const std::string& name, size_t record_bytes,
+                 size_t num_slots, size_t subsample)
+    : record_bytes_(Roundup<64>(record_bytes)),
+      subsample_(std::max<size_t>(subsample, 1)),
+      path_(TapPath(name)) {
+  size_t slots = 1;
+  while (slots < num_slots) {
+    slots *= 2;
+  }
+  map_bytes_ = sizeof(Ring) + (slots * (kSlotHeaderBytes + record_bytes_));
+  // A ring left by an earlier run that did not exit cleanly
+  ::unlink(path_.c_str());
+
+  // The ring is set up under a temporary name, so that no reader maps a ring
+  // that is not initialized
+  const std::string tmp_path = path_ + ".tmp" + std::to_string(::getpid());
+  const int fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("DataTap: failed to create " + tmp_path);
+  }
+  void* mem = MAP_FAILED;
+  if (::ftruncate(fd, map_bytes_) == 0) {
+    mem = ::mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  }
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    ::unlink(tmp_path.c_str());
+    throw std::runtime_error("DataTap: failed to map " + tmp_path);
+  }
+  ring_ = new (mem) Ring();
+  ring_->magic_ = kTapMagic;
+  ring_->num_slots_ = slots;
+  ring_->record_bytes_ = record_bytes_;
+  ring_->consumers_.store(0);
+  ring_->next_seq_.store(0);
+  consumers_ = &ring_->consumers_;
+  if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    ::unlink(tmp_path.c_str());
+    throw std::runtime_error("DataTap: failed to publish " + path_);
+  }
+  AGORA_LOG_INFO("DataTap: %s, %zu slots of %zu bytes\n", path_.c_str(),
+                 slots, record_bytes_);
+}
+
+DataTap::~DataTap() {
+  ::unlink(path_.c_str());
+  ::munmap(ring_, map_bytes_);
+}
+
+void DataTap::Publish(const TapRecord& record, const void* data) {
+  RtAssert(record.bytes_ <= record_bytes_,
+           "DataTap: record larger than the ring slots");
+  const uint64_t seq = ring_->next_seq_.fetch_add(1, std::memory_order_relaxed);
+  std::byte* slot_mem = Slot(ring_, seq);
+  auto* slot = reinterpret_cast<SlotHeader*>(slot_mem);
+  slot->state_.store((2 * seq) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->record_ = record;
+  slot->record_.seq_ = seq;
+  std::memcpy(slot_mem + kSlotHeaderBytes, data, record.bytes_);
+  slot->state_.store((2 * seq) + 2, std::memory_order_release);
+}
+
+TapReader::TapReader(const std::string& name) {
+  const std::string path = TapPath(name);
+  const int fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    throw std::runtime_error("TapReader: no tap " + path);
+  }
+  struct stat st;
+  void* mem = MAP_FAILED;
+  if ((::fstat(fd, &st) == 0) &&
+      (static_cast<size_t>(st.st_size) >= sizeof(DataTap::Ring))) {
+    map_bytes_ = st.st_size;
+    mem = ::mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  }
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    throw std::runtime_error("TapReader: failed to map " + path);
+  }
+  ring_ = static_cast<DataTap::Ring*>(mem);
+  if (ring_->magic_ != kTapMagic) {
+    ::munmap(ring_, map_bytes_);
+    throw std::runtime_error("TapReader: " + path + " is not a tap");
+  }
+  ring_->consumers_.fetch_add(1);
+  next_seq_ = ring_->next_seq_.load(std::memory_order_acquire);
+}
+
+TapReader::~TapReader() {
+  ring_->consumers_.fetch_sub(1);
+  ::munmap(ring_, map_bytes_);
+}
+
+size_t TapReader::RecordBytes() const { return ring_->record_bytes_; }
+
+bool TapReader::Read(TapRecord& record, void* buf, size_t len) {
+  while (true) {
+    const uint64_t head = ring_->next_seq_.load(std::memory_order_acquire);
+    if (next_seq_ >= head) {
+      return false;
+    }
+    if ((head - next_seq_) > ring_->num_slots_) {
+      // The producer lapped this reader
+      lost_ += head - ring_->num_slots_ - next_seq_;
+      next_seq_ = head - ring_->num_slots_;
+    }
+    std::byte* slot_mem = DataTap::Slot(ring_, next_seq_);
+    auto* slot = reinterpret_cast<SlotHeader*>(slot_mem);
+    const uint64_t complete = (2 * next_seq_) + 2;
+    const uint64_t state = slot->state_.load(std::memory_order_acquire);
+    if (state < complete) {
+      // Still being written
+      return false;
+    }
+    if (state == complete) {
+      record = slot->record_;
+      std::memcpy(buf, slot_mem + kSlotHeaderBytes,
+                  std::min<size_t>(len, record.bytes_));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->state_.load(std::memory_order_relaxed) == complete) {
+        next_seq_++;
+        return true;
+      }
+    }
+    // Overwritten by a later record
+    lost_++;
+    next_seq_++;
+  }
+}
+
+DataTaps::DataTaps(const Config* cfg, const std::string& prefix,
+                   const std::array<size_t, kNumTapPoints>& record_bytes) {
+  const std::string name =
+      cfg->TapName().empty() ? prefix : cfg->TapName();
+  for (const auto& point_name : cfg->TapPoints()) {
+    TapPoint point;
+    RtAssert(TapPointFromName(point_name, point), "Unknown tap point");
+    const size_t i = static_cast<size_t>(point);
+    if (record_bytes.at(i) == 0) {
+      AGORA_LOG_WARN("DataTaps: %s has no %s tap\n", prefix.c_str(),
+                     point_name.c_str());
+      continue;
+    }
+    taps_.at(i) =
+        std::make_unique<DataTap>(name + "_" + point_name, record_bytes.at(i),
+                                  cfg->TapSlots(), cfg->TapSubsample());
+  }
+}
+
+extern "C" {
+EXPORT TapReader* AgoraTapOpen(const char* name) {
+  try {
+    return new TapReader(name);
+  } catch (const std::runtime_error& e) {
+    AGORA_LOG_ERROR("%s\n", e.what());
+    return nullptr;
+  }
+}
+EXPORT int AgoraTapRead(TapReader* reader, TapRecord* record, void* buf,
+                        size_t len) {
+  return reader->Read(*record, buf, len) ? 1 : 0;
+}
+EXPORT void AgoraTapClose(TapReader* reader) { delete reader; }
+}
@@ -0,0 +1,189 @@
+/**
+ * @file data_tap.h
+ * @brief Declaration file for the data taps: named shared-memory rings into
+ * which the doers publish the intermediate data of the frames (post-FFT IQ,
+ * CSI, beams, equalized symbols, LLRs, decoded bits) while a consumer, e.g.
+ * a GUI or an analyzer in another process, is attached.
+ */
+#ifndef DATA_TAP_H_
+#define DATA_TAP_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "symbols.h"
+
+class Config;
+
+/// The points of the pipeline that can be tapped
+enum class TapPoint : size_t {
+  kFftIq,    // Post-FFT IQ of the data subcarriers of an antenna
+  kCsi,      // Channel estimate of an antenna (or UE) per data subcarrier
+  kBeams,    // Uplink beam matrices of a block of subcarriers
+  kEqual,    // Equalized symbols of a block of subcarriers
+  kLlr,      // Demodulated LLRs of a block of subcarriers of a stream
+  kDecoded,  // Decoded bytes of a code block
+};
+static constexpr size_t kNumTapPoints =
+    static_cast<size_t>(TapPoint::kDecoded) + 1;
+
+/// Config name of a tap point, e.g. "equal"
+const char* TapPointName(TapPoint point);
+/// The tap point named name. Returns false if there is none.
+bool TapPointFromName(const std::string& name, TapPoint& point);
+
+/// Header of a record of a tap. What index_ and offset_ count depends on the
+/// tap point: the antenna, UE or stream, and the first subcarrier or the
+/// code block of the data.
+struct TapRecord {
+  // Running number of the record in its tap, set by DataTap::Publish()
+  uint64_t seq_;
+  uint32_t frame_id_;
+  uint16_t symbol_id_;
+  uint16_t index_;
+  uint32_t offset_;
+  // Bytes of data after the header
+  uint32_t bytes_;
+};
+
+/**
+ * @brief The producer side of a tap: a ring of records in a file of
+ * /dev/shm named "agora_tap_<name>", overwritten in a loop.
+ *
+ * Any thread may publish, without locks: a record claims the next slot, and
+ * its sequence word tells readers whether the slot is complete or was
+ * overwritten while they copied it. Publishing never waits for the readers,
+ * so a reader that falls more than a ring behind loses records. The doers
+ * check Wanted() first, so that the data costs nothing while no reader is
+ * attached. The ring needs more slots than records in flight at once.
+ */
+class DataTap {
+ public:
+  /**
+   * @param name Name of the tap, unique on the host
+   * @param record_bytes Largest record data
+   * @param num_slots Records in the ring, rounded up to a power of two
+   * @param subsample Publish every subsample-th frame
+   */
+  DataTap(const std::string& name, size_t record_bytes, size_t num_slots,
+          size_t subsample);
+  ~DataTap();
+
+  DataTap(const DataTap&) = delete;
+  DataTap& operator=(const DataTap&) = delete;
+
+  /// True if a reader is attached and the frame is one of the subsampled
+  /// ones. Costs a relaxed load while nobody listens.
+  inline bool Wanted(size_t frame_id) const {
+    return (consumers_->load(std::memory_order_relaxed) > 0) &&
+           ((frame_id % subsample_) == 0);
+  }
+
+  /// Copy a record with the header fields of record (but seq_) and
+  /// record.bytes_ bytes of data into the ring
+  void Publish(const TapRecord& record, const void* data);
+
+  inline const std::string& Path() const { return path_; }
+  inline size_t RecordBytes() const { return record_bytes_; }
+
+ private:
+  struct Ring;
+
+  // The slot of a running record number
+  static std::byte* Slot(Ring* ring, uint64_t seq);
+
+  const size_t record_bytes_;
+  const size_t subsample_;
+  std::string path_;
+  Ring* ring_;
+  size_t map_bytes_;
+  // Attached readers, in the ring
+  const std::atomic<uint64_t>* consumers_;
+
+  friend class TapReader;
+};
+
+/**
+ * @brief The consumer side of a tap, which attaches to the ring of a
+ * running DataTap and reads the records published from then on, in order.
+ * Detaches on destruction. A producer that restarts creates a new ring, so
+ * the readers of the old one must reopen it.
+ */
+class TapReader {
+ public:
+  /// Attach to the tap named name. Throws if it does not exist.
+  explicit TapReader(const std::string& name);
+  ~TapReader();
+
+  TapReader(const TapReader&) = delete;
+  TapReader& operator=(const TapReader&) = delete;
+
+  /**
+   * @brief Read the next record into record and the first len bytes of its
+   * data into buf. Returns false if there is no complete record to read
+   * yet.
+   */
+  bool Read(TapRecord& record, void* buf, size_t len);
+
+  /// Records overwritten before they were read
+  inline size_t Lost() const { return lost_; }
+  /// Largest record data of the tap
+  size_t RecordBytes() const;
+
+ private:
+  DataTap::Ring* ring_;
+  size_t map_bytes_;
+  uint64_t next_seq_;
+  size_t lost_ = 0;
+};
+
+/**
+ * @brief The taps of a process (or a cell) that Config::TapPoints() names,
+ * "<prefix>_<point>" each, e.g. "agora_equal".
+ */
+class DataTaps {
+ public:
+  /**
+   * @param prefix Config::TapName() if set, else this
+   * @param record_bytes Largest record data of each tap point
+   */
+  DataTaps(const Config* cfg, const std::string& prefix,
+           const std::array<size_t, kNumTapPoints>& record_bytes);
+
+  /// True if point is tapped and DataTap::Wanted(frame_id)
+  inline bool Wanted(TapPoint point, size_t frame_id) const {
+    const DataTap* tap = taps_.at(static_cast<size_t>(point)).get();
+    return (tap != nullptr) && tap->Wanted(frame_id);
+  }
+
+  /// Publish a record of point. Only after Wanted().
+  inline void Publish(TapPoint point, size_t frame_id, size_t symbol_id,
+                      size_t index, size_t offset, const void* data,
+                      size_t bytes) {
+    TapRecord record{};
+    record.frame_id_ = static_cast<uint32_t>(frame_id);
+    record.symbol_id_ = static_cast<uint16_t>(symbol_id);
+    record.index_ = static_cast<uint16_t>(index);
+    record.offset_ = static_cast<uint32_t>(offset);
+    record.bytes_ = static_cast<uint32_t>(bytes);
+    taps_.at(static_cast<size_t>(point))->Publish(record, data);
+  }
+
+ private:
+  std::array<std::unique_ptr<DataTap>, kNumTapPoints> taps_;
+};
+
+/// Consumer C API, e.g. for GUIs in Python. AgoraTapOpen() returns nullptr
+/// if the tap does not exist, AgoraTapRead() 1 if it read a record.
+extern "C" {
+EXPORT TapReader* AgoraTapOpen(const char* name);
+EXPORT int AgoraTapRead(TapReader* reader, TapRecord* record, void* buf,
+                        size_t len);
+EXPORT void AgoraTapClose(TapReader* reader);
+}
+
+#endif  // DATA_TAP_H_
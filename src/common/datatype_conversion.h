@@ -6,11 +6,20 @@
 #ifndef DATATYPE_CONVERSION_H_
 #define DATATYPE_CONVERSION_H_
 
+#if defined(__x86_64__)
 #include <emmintrin.h>
 #include <immintrin.h>
+#endif
 
+#include <algorithm>
+#include <array>
 #include <bitset>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
+#include "simd_portable.h"
 #include "utils.h"
 
 //#define DATATYPE_MEMORY_CHECK
@@ -88,6 +97,7 @@ static inline void SimdConvertShortToFloatAVX512(const short* in_buf,
 
 static inline void SimdConvertShortToFloatAVX2(const short* in_buf,
                                                float* out_buf, size_t n_elems) {
+#if defined(__AVX2__)
 #if defined(DATATYPE_MEMORY_CHECK)
   RtAssert(((n_elems % kAvx2ShortsPerLoop) == 0) &&
                ((reinterpret_cast<intptr_t>(in_buf) % kAvx2Bytes) == 0) &&
@@ -117,6 +127,24 @@ static inline void SimdConvertShortToFloatAVX2(const short* in_buf,
     const __m256 converted = _mm256_sub_ps(val_f, magic);  // port 1,5 ?
     _mm256_store_ps(out_buf + i, converted);               // port 2,3,4,7
   }
+#else
+  unused(in_buf);
+  unused(out_buf);
+  unused(n_elems);
+  throw std::runtime_error("AVX2 is not supported");
+#endif
+}
+
+// The portable version of SimdConvertShortToFloat, for builds without AVX2
+// (e.g., aarch64). n_elems must be a multiple of 4.
+static inline void SimdConvertShortToFloatPortable(const short* in_buf,
+                                                   float* out_buf,
+                                                   size_t n_elems) {
+  for (size_t i = 0; i < n_elems; i += 4) {
+    PortableSimd::Store(out_buf + i,
+                        PortableSimd::ShortToFloat(
+                            in_buf + i, 1.0f / kShrtFltConvFactor));
+  }
 }
 
 // Convert a short array [in_buf] to a float array [out_buf]. Each array must
@@ -127,11 +155,174 @@ static inline void SimdConvertShortToFloat(const short* in_buf, float* out_buf,
                                            size_t n_elems) {
 #if defined(__AVX512F__)
   return SimdConvertShortToFloatAVX512(in_buf, out_buf, n_elems);
-#else
+#elif defined(__AVX2__)
   return SimdConvertShortToFloatAVX2(in_buf, out_buf, n_elems);
+#else
+  return SimdConvertShortToFloatPortable(in_buf, out_buf, n_elems);
+#endif
+}
+
+// Same as SimdConvertShortToFloat for interleaved IQ samples, but negates
+// every other complex sample. Multiplying the input of an N-point FFT by
+// (-1)^n circularly shifts its output by N / 2, so the FFT of [out_buf] is
+// already FFT-shifted and needs no extra pass over the output.
+// out_buf must be 64-byte aligned, in_buf may start anywhere in a packet
+// n_elems must be a multiple of 16
+static inline void SimdConvertShortToFloatFftShift(const short* in_buf,
+                                                   float* out_buf,
+                                                   size_t n_elems) {
+#if defined(__AVX512F__)
+  const __m512 magic =
+      _mm512_set1_ps(float((1 << 23) + (1 << 15)) / kShrtFltConvFactor);
+  const __m512i magic_i = _mm512_castps_si512(magic);
+  // Sign bits of the odd complex samples, {re, im} pairs
+  const __m512i sign = _mm512_setr_epi32(
+      0, 0, INT32_MIN, INT32_MIN, 0, 0, INT32_MIN, INT32_MIN, 0, 0, INT32_MIN,
+      INT32_MIN, 0, 0, INT32_MIN, INT32_MIN);
+  for (size_t i = 0; i < n_elems; i += kAvx512ShortsPerLoop) {
+    const __m256i val =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in_buf + i));
+    const __m512i val_unpacked = _mm512_cvtepu16_epi32(val);
+    const __m512 val_f =
+        _mm512_castsi512_ps(_mm512_xor_si512(val_unpacked, magic_i));
+    const __m512 converted = _mm512_sub_ps(val_f, magic);
+    // Integer xor, as _mm512_xor_ps needs AVX-512DQ
+    _mm512_store_si512(out_buf + i,
+                       _mm512_xor_si512(_mm512_castps_si512(converted), sign));
+  }
+#elif defined(__AVX2__)
+  const __m256 magic =
+      _mm256_set1_ps(float((1 << 23) + (1 << 15)) / kShrtFltConvFactor);
+  const __m256i magic_i = _mm256_castps_si256(magic);
+  // Sign bits of the odd complex samples, {re, im} pairs
+  const __m256 sign = _mm256_castsi256_ps(_mm256_setr_epi32(
+      0, 0, INT32_MIN, INT32_MIN, 0, 0, INT32_MIN, INT32_MIN));
+  for (size_t i = 0; i < n_elems; i += kAvx2ShortsPerLoop) {
+    const __m128i val =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in_buf + i));
+    const __m256i val_unpacked = _mm256_cvtepu16_epi32(val);
+    const __m256 val_f =
+        _mm256_castsi256_ps(_mm256_xor_si256(val_unpacked, magic_i));
+    const __m256 converted = _mm256_sub_ps(val_f, magic);
+    _mm256_store_ps(out_buf + i, _mm256_xor_ps(converted, sign));
+  }
+#else
+  // Each vector holds an even and an odd complex sample
+  const PortableSimd::F32x4 sign = {1.0f, 1.0f, -1.0f, -1.0f};
+  for (size_t i = 0; i < n_elems; i += 4) {
+    PortableSimd::Store(out_buf + i,
+                        PortableSimd::ShortToFloat(
+                            in_buf + i, 1.0f / kShrtFltConvFactor) *
+                            sign);
+  }
 #endif
 }
 
+// Complex samples between two restarts of the phasor recurrence of
+// SimdConvertShortToFloatRotate
+constexpr size_t kRotateReseedSamples = 256;
+
+// Same as SimdConvertShortToFloat for interleaved IQ samples, but multiplies
+// complex sample n by exp(j * n * phase_step), e.g. to remove a carrier
+// frequency offset before the FFT. The phasors come from a recurrence in the
+// conversion loop, restarted from the exact phase every kRotateReseedSamples
+// samples so that the float rounding does not build up. With [fft_shift],
+// every other sample is also negated as in SimdConvertShortToFloatFftShift,
+// which is one more rotation by pi per sample.
+// out_buf must be 64-byte aligned, in_buf may start anywhere in a packet
+// n_elems must be a multiple of 16
+static inline void SimdConvertShortToFloatRotate(const short* in_buf,
+                                                 float* out_buf,
+                                                 size_t n_elems,
+                                                 float phase_step,
+                                                 bool fft_shift = false) {
+  const double step = phase_step + (fft_shift ? M_PI : 0.0);
+  // The phasors of 8 consecutive samples, and the rotation by 8 samples
+  alignas(64) std::array<float, 16> phasors;
+  alignas(64) std::array<float, 16> advance;
+  for (size_t k = 0; k < advance.size(); k += 2) {
+    advance[k] = static_cast<float>(std::cos(8.0 * step));
+    advance[k + 1] = static_cast<float>(std::sin(8.0 * step));
+  }
+
+  for (size_t chunk = 0; chunk < n_elems; chunk += 2 * kRotateReseedSamples) {
+    const size_t chunk_end =
+        std::min(n_elems, chunk + (2 * kRotateReseedSamples));
+    for (size_t k = 0; k < phasors.size(); k += 2) {
+      const double phase = step * static_cast<double>((chunk + k) / 2);
+      phasors[k] = static_cast<float>(std::cos(phase));
+      phasors[k + 1] = static_cast<float>(std::sin(phase));
+    }
+#if defined(__AVX512F__)
+    // a * b of each {re, im} pair
+    const auto mult = [](__m512 a, __m512 b) {
+      return _mm512_fmaddsub_ps(
+          a, _mm512_moveldup_ps(b),
+          _mm512_mul_ps(_mm512_permute_ps(a, 0xB1), _mm512_movehdup_ps(b)));
+    };
+    const __m512 magic =
+        _mm512_set1_ps(float((1 << 23) + (1 << 15)) / kShrtFltConvFactor);
+    const __m512i magic_i = _mm512_castps_si512(magic);
+    const __m512 rotate = _mm512_load_ps(advance.data());
+    __m512 phasor = _mm512_load_ps(phasors.data());
+    for (size_t i = chunk; i < chunk_end; i += kAvx512ShortsPerLoop) {
+      const __m256i val =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in_buf + i));
+      const __m512i val_unpacked = _mm512_cvtepu16_epi32(val);
+      const __m512 val_f =
+          _mm512_castsi512_ps(_mm512_xor_si512(val_unpacked, magic_i));
+      _mm512_store_ps(out_buf + i, mult(_mm512_sub_ps(val_f, magic), phasor));
+      phasor = mult(phasor, rotate);
+    }
+#elif defined(__AVX2__)
+    const auto mult = [](__m256 a, __m256 b) {
+      return _mm256_addsub_ps(
+          _mm256_mul_ps(a, _mm256_moveldup_ps(b)),
+          _mm256_mul_ps(_mm256_permute_ps(a, 0xB1), _mm256_movehdup_ps(b)));
+    };
+    const __m256 magic =
+        _mm256_set1_ps(float((1 << 23) + (1 << 15)) / kShrtFltConvFactor);
+    const __m256i magic_i = _mm256_castps_si256(magic);
+    // 4 samples per vector, so each half of the phasors advances by 8
+    const __m256 rotate = _mm256_load_ps(advance.data());
+    __m256 phasor_lo = _mm256_load_ps(phasors.data());
+    __m256 phasor_hi = _mm256_load_ps(phasors.data() + 8);
+    for (size_t i = chunk; i < chunk_end; i += 2 * kAvx2ShortsPerLoop) {
+      for (size_t half = 0; half < 2; half++) {
+        const size_t j = i + (half * kAvx2ShortsPerLoop);
+        const __m128i val =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in_buf + j));
+        const __m256i val_unpacked = _mm256_cvtepu16_epi32(val);
+        const __m256 val_f =
+            _mm256_castsi256_ps(_mm256_xor_si256(val_unpacked, magic_i));
+        const __m256 phasor = (half == 0) ? phasor_lo : phasor_hi;
+        _mm256_store_ps(out_buf + j, mult(_mm256_sub_ps(val_f, magic), phasor));
+      }
+      phasor_lo = mult(phasor_lo, rotate);
+      phasor_hi = mult(phasor_hi, rotate);
+    }
+#else
+    // 2 samples per vector, 4 vectors per rotation by 8 samples
+    const auto rotate = PortableSimd::Load<PortableSimd::F32x4>(advance.data());
+    std::array<PortableSimd::F32x4, 4> phasor;
+    for (size_t v = 0; v < phasor.size(); v++) {
+      phasor[v] = PortableSimd::Load<PortableSimd::F32x4>(&phasors[4 * v]);
+    }
+    for (size_t i = chunk; i < chunk_end; i += 16) {
+      for (size_t v = 0; v < phasor.size(); v++) {
+        PortableSimd::Store(
+            out_buf + i + (4 * v),
+            PortableSimd::ComplexCf32Mult(
+                PortableSimd::ShortToFloat(in_buf + i + (4 * v),
+                                           1.0f / kShrtFltConvFactor),
+                phasor[v]));
+        phasor[v] = PortableSimd::ComplexCf32Mult(phasor[v], rotate);
+      }
+    }
+#endif
+  }
+}
+
 // Convert a float array [in_buf] to a short array [out_buf]. Input array must
 // have [n_elems] elements. Output array must have [n_elems + n_prefix] elements.
 // in_buf and out_buf must be 64-byte aligned
@@ -191,6 +382,7 @@ static inline void SimdConvertFloatToShortAVX2(const float* in_buf,
                                                short* out_buf, size_t n_elems,
                                                size_t n_prefix,
                                                float scale_down_factor) {
+#if defined(__AVX2__)
 #if defined(DATATYPE_MEMORY_CHECK)
   constexpr size_t kAvx2ShortPerInstr = kAvx2Bytes / sizeof(short);
   RtAssert(((n_elems % kAvx2FloatsPerLoop) == 0) &&
@@ -227,6 +419,32 @@ static inline void SimdConvertFloatToShortAVX2(const float* in_buf,
                           slice);
     }
   }
+#else
+  unused(in_buf);
+  unused(out_buf);
+  unused(n_elems);
+  unused(n_prefix);
+  unused(scale_down_factor);
+  throw std::runtime_error("AVX2 is not supported");
+#endif
+}
+
+// The portable version of SimdConvertFloatToShort, for builds without AVX2
+// (e.g., aarch64). Rounds and saturates as the AVX2 version does.
+// n_elems and n_prefix must be multiples of 4.
+static inline void SimdConvertFloatToShortPortable(const float* in_buf,
+                                                   short* out_buf,
+                                                   size_t n_elems,
+                                                   size_t n_prefix,
+                                                   float scale_down_factor) {
+  const float scale_factor_float = kShrtFltConvFactor / scale_down_factor;
+  for (size_t i = 0; i < n_elems; i += 4) {
+    PortableSimd::FloatToShort(
+        PortableSimd::Load<PortableSimd::F32x4>(in_buf + i),
+        scale_factor_float, out_buf + i + n_prefix);
+  }
+  // Prepend / Set cyclic prefix
+  std::memcpy(out_buf, out_buf + n_elems, n_prefix * sizeof(short));
 }
 
 // Convert a float array [in_buf] to a short array [out_buf]. Input array must
@@ -269,9 +487,145 @@ static inline void SimdConvertFloatToShort(const float* in_buf, short* out_buf,
 #if defined(__AVX512F__)
   SimdConvertFloatToShortAVX512(in_buf, out_buf, n_elems, n_prefix,
                                 scale_down_factor);
-#else
+#elif defined(__AVX2__)
   SimdConvertFloatToShortAVX2(in_buf, out_buf, n_elems, n_prefix,
                               scale_down_factor);
+#else
+  SimdConvertFloatToShortPortable(in_buf, out_buf, n_elems, n_prefix,
+                                  scale_down_factor);
+#endif
+}
+
+#if defined(__AVX512F__)
+// Aligned store of v to dst, non-temporal if non_temporal
+static inline void StoreSi512(short* dst, __m512i v, bool non_temporal) {
+  if (non_temporal) {
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst), v);
+  } else {
+    _mm512_store_si512(reinterpret_cast<__m512i*>(dst), v);
+  }
+}
+#elif defined(__AVX2__)
+// Aligned store of v to dst, non-temporal if non_temporal
+static inline void StoreSi256(short* dst, __m256i v, bool non_temporal) {
+  if (non_temporal) {
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), v);
+  } else {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(dst), v);
+  }
+}
+#endif
+
+// Same as SimdConvertFloatToShort, but also returns the largest value
+// [max_val] and the largest magnitude [max_abs] of the scaled down input, so
+// that callers can check for clipping without another pass over the input.
+// With [fft_shift], every other complex sample of the input is negated
+// first: the IFFT of an N-point symbol times (-1)^n is the IFFT of the
+// symbol shifted by N / 2, so the caller needs no FFT shift pass. The
+// output is written with non-temporal stores unless [non_temporal] is false.
+static inline void SimdConvertFloatToShortPeak(
+    const float* in_buf, short* out_buf, size_t n_elems, size_t n_prefix,
+    float scale_down_factor, float& max_val, float& max_abs,
+    bool fft_shift = false, bool non_temporal = true) {
+  const float scale_factor_float = kShrtFltConvFactor / scale_down_factor;
+  const size_t repeat_idx = n_elems - n_prefix;
+#if defined(__AVX512F__)
+  const __m512 scale_factor = _mm512_set1_ps(scale_factor_float);
+  const __m512i permute_index = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+  // Sign bits of the odd complex samples, {re, im} pairs
+  const __m512i sign =
+      fft_shift ? _mm512_setr_epi32(0, 0, INT32_MIN, INT32_MIN, 0, 0,
+                                    INT32_MIN, INT32_MIN, 0, 0, INT32_MIN,
+                                    INT32_MIN, 0, 0, INT32_MIN, INT32_MIN)
+                : _mm512_setzero_si512();
+  __m512 peak = _mm512_set1_ps(-FLT_MAX);
+  __m512 peak_abs = _mm512_setzero_ps();
+  for (size_t i = 0; i < n_elems; i += kAvx512FloatsPerLoop) {
+    // Integer xor, as _mm512_xor_ps needs AVX-512DQ
+    const __m512 in1 = _mm512_castsi512_ps(_mm512_xor_si512(
+        _mm512_castps_si512(_mm512_load_ps(&in_buf[i])), sign));
+    const __m512 in2 = _mm512_castsi512_ps(_mm512_xor_si512(
+        _mm512_castps_si512(_mm512_load_ps(&in_buf[i + kAvx512FloatsPerInstr])),
+        sign));
+    peak = _mm512_max_ps(peak, _mm512_max_ps(in1, in2));
+    peak_abs = _mm512_max_ps(
+        peak_abs, _mm512_max_ps(_mm512_abs_ps(in1), _mm512_abs_ps(in2)));
+    const __m512i int32_1 =
+        _mm512_cvtps_epi32(_mm512_mul_ps(in1, scale_factor));
+    const __m512i int32_2 =
+        _mm512_cvtps_epi32(_mm512_mul_ps(in2, scale_factor));
+    const __m512i shuffled = _mm512_permutexvar_epi64(
+        permute_index, _mm512_packs_epi32(int32_1, int32_2));
+    StoreSi512(&out_buf[i + n_prefix], shuffled, non_temporal);
+    // Prepend / Set cyclic prefix
+    if (i >= repeat_idx) {
+      StoreSi512(&out_buf[i - repeat_idx], shuffled, non_temporal);
+    }
+  }
+  max_val = _mm512_reduce_max_ps(peak) / scale_down_factor;
+  max_abs = _mm512_reduce_max_ps(peak_abs) / scale_down_factor;
+#elif defined(__AVX2__)
+  const __m256 scale_factor = _mm256_set1_ps(scale_factor_float);
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  const __m256 sign =
+      fft_shift ? _mm256_castsi256_ps(_mm256_setr_epi32(
+                      0, 0, INT32_MIN, INT32_MIN, 0, 0, INT32_MIN, INT32_MIN))
+                : _mm256_setzero_ps();
+  __m256 peak = _mm256_set1_ps(-FLT_MAX);
+  __m256 peak_abs = _mm256_setzero_ps();
+  for (size_t i = 0; i < n_elems; i += kAvx2FloatsPerLoop) {
+    const __m256 in1 = _mm256_xor_ps(_mm256_load_ps(&in_buf[i]), sign);
+    const __m256 in2 =
+        _mm256_xor_ps(_mm256_load_ps(&in_buf[i + kAvx2FloatsPerInstr]), sign);
+    peak = _mm256_max_ps(peak, _mm256_max_ps(in1, in2));
+    peak_abs = _mm256_max_ps(peak_abs,
+                             _mm256_max_ps(_mm256_and_ps(in1, abs_mask),
+                                           _mm256_and_ps(in2, abs_mask)));
+    const __m256i integer1 =
+        _mm256_cvtps_epi32(_mm256_mul_ps(in1, scale_factor));
+    const __m256i integer2 =
+        _mm256_cvtps_epi32(_mm256_mul_ps(in2, scale_factor));
+    const __m256i slice = _mm256_permute4x64_epi64(
+        _mm256_packs_epi32(integer1, integer2), 0xD8);
+    StoreSi256(&out_buf[i + n_prefix], slice, non_temporal);
+    // Prepend / Set cyclic prefix
+    if (i >= repeat_idx) {
+      StoreSi256(&out_buf[i - repeat_idx], slice, non_temporal);
+    }
+  }
+  float peak_lanes[kAvx2FloatsPerInstr];
+  float peak_abs_lanes[kAvx2FloatsPerInstr];
+  _mm256_storeu_ps(peak_lanes, peak);
+  _mm256_storeu_ps(peak_abs_lanes, peak_abs);
+  max_val = -FLT_MAX;
+  max_abs = 0.0f;
+  for (size_t i = 0; i < kAvx2FloatsPerInstr; i++) {
+    max_val = std::max(max_val, peak_lanes[i]);
+    max_abs = std::max(max_abs, peak_abs_lanes[i]);
+  }
+  max_val /= scale_down_factor;
+  max_abs /= scale_down_factor;
+#else
+  unused(repeat_idx);
+  unused(non_temporal);
+  // Each vector holds an even and an odd complex sample
+  const PortableSimd::F32x4 sign = {1.0f, 1.0f, fft_shift ? -1.0f : 1.0f,
+                                    fft_shift ? -1.0f : 1.0f};
+  PortableSimd::F32x4 peak = PortableSimd::Set1(-FLT_MAX);
+  PortableSimd::F32x4 peak_abs = {};
+  for (size_t i = 0; i < n_elems; i += 4) {
+    const auto in = PortableSimd::Load<PortableSimd::F32x4>(in_buf + i) * sign;
+    peak = PortableSimd::Max(peak, in);
+    peak_abs = PortableSimd::Max(peak_abs, PortableSimd::Max(in, -in));
+    PortableSimd::FloatToShort(in, scale_factor_float, out_buf + i + n_prefix);
+  }
+  // Prepend / Set cyclic prefix
+  std::memcpy(out_buf, out_buf + n_elems, n_prefix * sizeof(short));
+  max_val = std::max(std::max(peak[0], peak[1]), std::max(peak[2], peak[3]));
+  max_abs = std::max(std::max(peak_abs[0], peak_abs[1]),
+                     std::max(peak_abs[2], peak_abs[3]));
+  max_val /= scale_down_factor;
+  max_abs /= scale_down_factor;
 #endif
 }
 
@@ -284,12 +638,70 @@ static inline void SimdConvertCxFloatToCxShort(
 #if defined(__AVX512F__)
   SimdConvertFloatToShortAVX512(in, out, n_elems * 2, n_prefix * 2,
                                 scale_down_factor);
-#else
+#elif defined(__AVX2__)
   SimdConvertFloatToShortAVX2(in, out, n_elems * 2, n_prefix * 2,
                               scale_down_factor);
+#else
+  SimdConvertFloatToShortPortable(in, out, n_elems * 2, n_prefix * 2,
+                                  scale_down_factor);
 #endif
 }
 
+// 12-bit IQ samples hold the upper 12 bits of the 16-bit I and Q, in 3 bytes:
+// I[11:4], then I[15:12] | Q[7:4] << 4, then Q[15:8]
+static constexpr size_t k12bitIqSampleBytes = 3;
+// Samples of one AVX-512 12-bit IQ kernel step, 48 bytes
+static constexpr size_t k12bitIqSamplesPerLoop = 16;
+
+// Byte indices of the 12-bit IQ kernels, built at compile time.
+// Unpack: the bytes 3k, 3k + 1 (I) and 3k + 1, 3k + 2 (Q) of sample k into
+// the 16-bit words 2k and 2k + 1. Pack: the low 3 bytes of each 32-bit word.
+template <bool kUnpack>
+static constexpr std::array<uint8_t, 64> Iq12bitByteIndex() {
+  constexpr std::array<uint8_t, 4> kSampleBytes = {0, 1, 1, 2};
+  std::array<uint8_t, 64> index{};
+  for (size_t j = 0; j < 64; j++) {
+    index[j] = kUnpack ? static_cast<uint8_t>(3 * (j / 4) + kSampleBytes[j % 4])
+                       : static_cast<uint8_t>(4 * (j / 3) + j % 3);
+  }
+  return index;
+}
+
+#if defined(__AVX512BW__)
+// Pack the 16 samples (32 floats) at in_buf into 48 bytes at out_buf
+static inline void Pack12bitIqAvx512(const float* in_buf, uint8_t* out_buf) {
+  const __m512 scale = _mm512_set1_ps(kShrtFltConvFactor * 4);
+  const __m512i lo =
+      _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_loadu_ps(in_buf), scale));
+  const __m512i hi =
+      _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_loadu_ps(in_buf + 16), scale));
+  // The upper 12 bits of I and Q of a sample in each 32-bit word
+  __m512i words = _mm512_inserti64x4(
+      _mm512_castsi256_si512(_mm512_cvtepi32_epi16(lo)),
+      _mm512_cvtepi32_epi16(hi), 1);
+  words = _mm512_srli_epi16(words, 4);
+  // I | Q << 12, the 3 bytes of the sample
+  words = _mm512_or_si512(
+      _mm512_and_si512(words, _mm512_set1_epi32(0xfff)),
+      _mm512_and_si512(_mm512_srli_epi32(words, 4),
+                       _mm512_set1_epi32(0xfff000)));
+#if defined(__AVX512VBMI__)
+  static constexpr std::array<uint8_t, 64> kIndex = Iq12bitByteIndex<false>();
+  const __m512i bytes =
+      _mm512_permutexvar_epi8(_mm512_loadu_si512(kIndex.data()), words);
+#else
+  // 12 bytes in each 128-bit lane, then the lanes side by side
+  const __m512i lanes = _mm512_shuffle_epi8(
+      words, _mm512_broadcast_i32x4(_mm_set_epi8(-1, -1, -1, -1, 14, 13, 12,
+                                                 10, 9, 8, 6, 5, 4, 2, 1, 0)));
+  const __m512i bytes = _mm512_permutexvar_epi32(
+      _mm512_set_epi32(0, 0, 0, 0, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0),
+      lanes);
+#endif
+  _mm512_mask_storeu_epi8(out_buf, (1ULL << 48) - 1, bytes);
+}
+#endif
+
 // Convert a float IQ array [in_buf] to an uint8_t IQ array [out_buf].
 // Each float is converted to 12-bit data (2 floats corresponds to 3 uint8_t).
 // Input array must have [n_elems] elements.
@@ -301,8 +713,18 @@ static inline void ConvertFloatTo12bitIq(const float* in_buf, uint8_t* out_buf,
   RtAssert((n_elems % 2) == 0,
            "ConvertFloatTo12bitIq n_elems not multiple of 2");
 #endif
+  size_t i = 0;
   size_t index_short = 0;
-  for (size_t i = 0; i < n_elems; i = i + 2) {
+#if defined(__AVX512BW__)
+  if (kDebug12BitIQ == false) {
+    for (; i + 2 * k12bitIqSamplesPerLoop <= n_elems;
+         i += 2 * k12bitIqSamplesPerLoop) {
+      Pack12bitIqAvx512(in_buf + i, out_buf + index_short);
+      index_short += k12bitIqSampleBytes * k12bitIqSamplesPerLoop;
+    }
+  }
+#endif
+  for (; i < n_elems; i = i + 2) {
     const auto temp_i =
         static_cast<unsigned short>(in_buf[i] * kShrtFltConvFactor * 4);
     const auto temp_q =
@@ -324,7 +746,7 @@ static inline void ConvertFloatTo12bitIq(const float* in_buf, uint8_t* out_buf,
   }
 }
 
-#ifdef __AVX512F__
+#if defined(__AVX512BW__)
 static inline void SimdConvert16bitIqToFloat(__m256i val, float* out_buf,
                                              __m512 magic, __m512i magic_i) {
   /* interleave with 0x0000 */
@@ -338,6 +760,7 @@ static inline void SimdConvert16bitIqToFloat(__m256i val, float* out_buf,
 }
 #endif
 
+#if defined(__AVX2__)
 static inline void Convert12bitIqTo16bitIq(uint8_t* in_buf, uint16_t* out_buf,
                                            size_t n_elems) {
 #if defined(DATATYPE_MEMORY_CHECK)
@@ -396,150 +819,252 @@ static inline void Convert12bitIqTo16bitIq(uint8_t* in_buf, uint16_t* out_buf,
   //     // }
   // }
 }
+#endif
+
+#if defined(__AVX512BW__)
+// Unpack the 16 samples (48 bytes) at in_buf into 32 16-bit I/Q values
+static inline __m512i Unpack12bitIqAvx512(const uint8_t* in_buf) {
+  static constexpr std::array<uint8_t, 64> kIndex = Iq12bitByteIndex<true>();
+  const __m512i bytes = _mm512_maskz_loadu_epi8((1ULL << 48) - 1, in_buf);
+#if defined(__AVX512VBMI__)
+  const __m512i words =
+      _mm512_permutexvar_epi8(_mm512_loadu_si512(kIndex.data()), bytes);
+#else
+  // 4 samples (12 bytes) in each 128-bit lane, then the same within the lanes
+  const __m512i lanes = _mm512_permutexvar_epi32(
+      _mm512_set_epi32(0, 11, 10, 9, 0, 8, 7, 6, 0, 5, 4, 3, 0, 2, 1, 0),
+      bytes);
+  const __m512i words = _mm512_shuffle_epi8(
+      lanes, _mm512_broadcast_i32x4(_mm_loadu_si128(
+                 reinterpret_cast<const __m128i*>(kIndex.data()))));
+#endif
+  // I: shift its 12 bits up (by 4 in the low word of each 32-bit word); Q:
+  // clear the 4 bits of I below it
+  const __m512i shift = _mm512_set1_epi32(4);
+  return _mm512_and_si512(_mm512_sllv_epi16(words, shift),
+                          _mm512_set1_epi16(static_cast<int16_t>(0xfff0)));
+}
+#elif defined(__AVX2__)
+// Unpack the 8 samples (24 bytes) at in_buf into 16 16-bit I/Q values, as
+// Unpack12bitIqAvx512 with 4 samples per 128-bit lane
+static inline __m256i Unpack12bitIqAvx2(const uint8_t* in_buf) {
+  static constexpr std::array<uint8_t, 64> kIndex = Iq12bitByteIndex<true>();
+  // The upper lane is read from in_buf + 8, so that no byte past the 24
+  // bytes of the samples is read, and its indices are 4 higher
+  const __m256i bytes = _mm256_loadu2_m128i(
+      reinterpret_cast<const __m128i*>(in_buf + 8),
+      reinterpret_cast<const __m128i*>(in_buf));
+  const __m128i index =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kIndex.data()));
+  const __m256i words = _mm256_shuffle_epi8(
+      bytes, _mm256_setr_m128i(index,
+                               _mm_add_epi8(index, _mm_set1_epi8(4))));
+  return _mm256_blend_epi16(
+      _mm256_slli_epi16(words, 4),
+      _mm256_and_si256(words, _mm256_set1_epi16(static_cast<int16_t>(0xfff0))),
+      0xaa);
+}
+#endif
 
 // Convert an uint8_t IQ array [in_buf] to a float IQ array [out_buf].
 // Each 12-bit I/Q is converted to a float (3 uint8_t corresponds to 2 floats).
 // Input array must have [n_elems] elements.
-// Output array must have [n_elems / 3 * 2] elements.
+// Output array must have [n_elems / 3 * 2] elements, and be 64-byte aligned.
 // n_elems must be multiples of 3
 static inline void SimdConvert12bitIqToFloat(const uint8_t* in_buf,
-                                             float* out_buf,
-                                             const uint16_t* in_16bits_buf,
-                                             size_t n_elems) {
-  unused(in_16bits_buf);
-#ifdef __AVX512F__
+                                             float* out_buf, size_t n_elems) {
+  const size_t num_samples = n_elems / k12bitIqSampleBytes;
+  size_t i = 0;
+#if defined(__AVX512BW__)
   const __m512 magic = _mm512_set1_ps(float((1 << 23) + (1 << 15)) / 131072.f);
   const __m512i magic_i = _mm512_castps_si512(magic);
-#else
-  const __m256 magic = _mm256_set1_ps(float((1 << 23) + (1 << 15)) / 131072.f);
-  const __m256i magic_i = _mm256_castps_si256(magic);
-#endif
-#ifdef __AVX512F__
-  for (size_t i = 0; i < n_elems / 3; i += 32) {
-    __m512i temp_i =
-        _mm512_set_epi16(*(uint16_t*)(in_buf + 93), *(uint16_t*)(in_buf + 90),
-                         *(uint16_t*)(in_buf + 87), *(uint16_t*)(in_buf + 84),
-                         *(uint16_t*)(in_buf + 81), *(uint16_t*)(in_buf + 78),
-                         *(uint16_t*)(in_buf + 75), *(uint16_t*)(in_buf + 72),
-                         *(uint16_t*)(in_buf + 69), *(uint16_t*)(in_buf + 66),
-                         *(uint16_t*)(in_buf + 63), *(uint16_t*)(in_buf + 60),
-                         *(uint16_t*)(in_buf + 57), *(uint16_t*)(in_buf + 54),
-                         *(uint16_t*)(in_buf + 51), *(uint16_t*)(in_buf + 48),
-                         *(uint16_t*)(in_buf + 45), *(uint16_t*)(in_buf + 42),
-                         *(uint16_t*)(in_buf + 39), *(uint16_t*)(in_buf + 36),
-                         *(uint16_t*)(in_buf + 33), *(uint16_t*)(in_buf + 30),
-                         *(uint16_t*)(in_buf + 27), *(uint16_t*)(in_buf + 24),
-                         *(uint16_t*)(in_buf + 21), *(uint16_t*)(in_buf + 18),
-                         *(uint16_t*)(in_buf + 15), *(uint16_t*)(in_buf + 12),
-                         *(uint16_t*)(in_buf + 9), *(uint16_t*)(in_buf + 6),
-                         *(uint16_t*)(in_buf + 3), *(uint16_t*)(in_buf + 0));
-
-    __m512i mask_q = _mm512_set1_epi16(0xfff0);
-    __m512i temp_q =
-        _mm512_set_epi16(*(uint16_t*)(in_buf + 94), *(uint16_t*)(in_buf + 91),
-                         *(uint16_t*)(in_buf + 88), *(uint16_t*)(in_buf + 85),
-                         *(uint16_t*)(in_buf + 82), *(uint16_t*)(in_buf + 79),
-                         *(uint16_t*)(in_buf + 76), *(uint16_t*)(in_buf + 73),
-                         *(uint16_t*)(in_buf + 70), *(uint16_t*)(in_buf + 67),
-                         *(uint16_t*)(in_buf + 64), *(uint16_t*)(in_buf + 61),
-                         *(uint16_t*)(in_buf + 58), *(uint16_t*)(in_buf + 55),
-                         *(uint16_t*)(in_buf + 52), *(uint16_t*)(in_buf + 49),
-                         *(uint16_t*)(in_buf + 46), *(uint16_t*)(in_buf + 43),
-                         *(uint16_t*)(in_buf + 40), *(uint16_t*)(in_buf + 37),
-                         *(uint16_t*)(in_buf + 34), *(uint16_t*)(in_buf + 31),
-                         *(uint16_t*)(in_buf + 28), *(uint16_t*)(in_buf + 25),
-                         *(uint16_t*)(in_buf + 22), *(uint16_t*)(in_buf + 19),
-                         *(uint16_t*)(in_buf + 16), *(uint16_t*)(in_buf + 13),
-                         *(uint16_t*)(in_buf + 10), *(uint16_t*)(in_buf + 7),
-                         *(uint16_t*)(in_buf + 4), *(uint16_t*)(in_buf + 1));
-
-    temp_q = _mm512_and_si512(temp_q, mask_q);  // Set lower 4 bits to 0
-    temp_i = _mm512_slli_epi16(temp_i, 4);      // Shift left by 4 bits
-
-    __m512i iq_0 = _mm512_unpacklo_epi16(temp_i, temp_q);
-    __m512i iq_1 = _mm512_unpackhi_epi16(temp_i, temp_q);
-    __m512i output_0 = _mm512_permutex2var_epi64(
-        iq_0, _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), iq_1);
-    __m512i output_1 = _mm512_permutex2var_epi64(
-        iq_0, _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), iq_1);
-
-    SimdConvert16bitIqToFloat(_mm512_extracti64x4_epi64(output_0, 0),
-                              out_buf + i * 2, magic, magic_i);
-    SimdConvert16bitIqToFloat(_mm512_extracti64x4_epi64(output_0, 1),
+  for (; i + k12bitIqSamplesPerLoop <= num_samples;
+       i += k12bitIqSamplesPerLoop) {
+    const __m512i iq = Unpack12bitIqAvx512(in_buf + i * k12bitIqSampleBytes);
+    SimdConvert16bitIqToFloat(_mm512_castsi512_si256(iq), out_buf + i * 2,
+                              magic, magic_i);
+    SimdConvert16bitIqToFloat(_mm512_extracti64x4_epi64(iq, 1),
                               out_buf + i * 2 + 16, magic, magic_i);
-    SimdConvert16bitIqToFloat(_mm512_extracti64x4_epi64(output_1, 0),
-                              out_buf + i * 2 + 32, magic, magic_i);
-    SimdConvert16bitIqToFloat(_mm512_extracti64x4_epi64(output_1, 1),
-                              out_buf + i * 2 + 48, magic, magic_i);
-    in_buf += 96;
   }
+#elif defined(__AVX2__)
+  const __m256 scale = _mm256_set1_ps(1.f / 131072.f);
+  for (; i + k12bitIqSamplesPerLoop / 2 <= num_samples;
+       i += k12bitIqSamplesPerLoop / 2) {
+    const __m256i iq = Unpack12bitIqAvx2(in_buf + i * k12bitIqSampleBytes);
+    for (size_t j = 0; j < 2; j++) {
+      const __m128i half = (j == 0) ? _mm256_castsi256_si128(iq)
+                                    : _mm256_extracti128_si256(iq, 1);
+      _mm256_store_ps(out_buf + i * 2 + j * 8,
+                      _mm256_mul_ps(_mm256_cvtepi32_ps(
+                                        _mm256_cvtepi16_epi32(half)),
+                                    scale));
+    }
+  }
+#endif
+  for (; i < num_samples; i++) {
+    const uint8_t* sample = in_buf + i * k12bitIqSampleBytes;
+    const auto sample_i =
+        static_cast<int16_t>((sample[0] << 4) | ((sample[1] & 0xf) << 12));
+    const auto sample_q =
+        static_cast<int16_t>((sample[1] & 0xf0) | (sample[2] << 8));
+    out_buf[2 * i] = sample_i / 131072.f;
+    out_buf[2 * i + 1] = sample_q / 131072.f;
+  }
+}
 
-#else
-  for (size_t i = 0; i < n_elems / 3; i += 16) {
-    // Convert 16 IQ smaples from 48 uint8_t to 32 shorts
-    // convert_12bit_iq_to_16bit_iq(in_buf + i * 3, in_16bits_buf, 16);
-    __m256i temp_i =
-        _mm256_setr_epi16(*(uint16_t*)in_buf, *(uint16_t*)(in_buf + 3),
-                          *(uint16_t*)(in_buf + 6), *(uint16_t*)(in_buf + 9),
-                          *(uint16_t*)(in_buf + 12), *(uint16_t*)(in_buf + 15),
-                          *(uint16_t*)(in_buf + 18), *(uint16_t*)(in_buf + 21),
-                          *(uint16_t*)(in_buf + 24), *(uint16_t*)(in_buf + 27),
-                          *(uint16_t*)(in_buf + 30), *(uint16_t*)(in_buf + 33),
-                          *(uint16_t*)(in_buf + 36), *(uint16_t*)(in_buf + 39),
-                          *(uint16_t*)(in_buf + 42), *(uint16_t*)(in_buf + 45));
+// Block floating point (BFP) fronthaul compression, as in the O-RAN user
+// plane: each block of kBfpBlockSamples IQ samples (one PRB) is an exponent
+// byte e followed by the 2 * kBfpBlockSamples values x >> e, as signed
+// [bfp_bits]-bit mantissas packed little-endian. Blocks are 1 + 3 * bfp_bits
+// bytes long, and the last one is zero padded.
+static constexpr size_t kBfpBlockSamples = 12;
+// Bytes after the last block, so that the kernels can read whole words
+static constexpr size_t kBfpPadding = 4;
 
-    __m256i mask_q = _mm256_set1_epi16(0xfff0);
-    __m256i temp_q =
-        _mm256_setr_epi16(*(uint16_t*)(in_buf + 1), *(uint16_t*)(in_buf + 4),
-                          *(uint16_t*)(in_buf + 7), *(uint16_t*)(in_buf + 10),
-                          *(uint16_t*)(in_buf + 13), *(uint16_t*)(in_buf + 16),
-                          *(uint16_t*)(in_buf + 19), *(uint16_t*)(in_buf + 22),
-                          *(uint16_t*)(in_buf + 25), *(uint16_t*)(in_buf + 28),
-                          *(uint16_t*)(in_buf + 31), *(uint16_t*)(in_buf + 34),
-                          *(uint16_t*)(in_buf + 37), *(uint16_t*)(in_buf + 40),
-                          *(uint16_t*)(in_buf + 43), *(uint16_t*)(in_buf + 46));
+static inline size_t BfpBlockBytes(size_t bfp_bits) {
+  return 1 + (2 * kBfpBlockSamples * bfp_bits) / 8;
+}
 
-    temp_q = _mm256_and_si256(temp_q, mask_q);  // Set lower 4 bits to 0
-    temp_i = _mm256_slli_epi16(temp_i, 4);      // Shift left by 4 bits
+// Compressed size of [num_samples] IQ samples, padding included
+static inline size_t BfpBytes(size_t num_samples, size_t bfp_bits) {
+  const size_t num_blocks =
+      (num_samples + kBfpBlockSamples - 1) / kBfpBlockSamples;
+  return (num_blocks * BfpBlockBytes(bfp_bits)) + kBfpPadding;
+}
 
-    __m256i iq_0 = _mm256_unpacklo_epi16(temp_i, temp_q);
-    __m256i iq_1 = _mm256_unpackhi_epi16(temp_i, temp_q);
-    __m256i output_0 = _mm256_permute2f128_si256(iq_0, iq_1, 0x20);
-    __m256i output_1 = _mm256_permute2f128_si256(iq_0, iq_1, 0x31);
+// Compress [num_samples] interleaved short IQ samples [in_buf] to
+// BfpBytes(num_samples, bfp_bits) bytes [out_buf]. bfp_bits must be in 8-16.
+static inline void BfpCompress(const short* in_buf, uint8_t* out_buf,
+                               size_t num_samples, size_t bfp_bits) {
+  const size_t block_bytes = BfpBlockBytes(bfp_bits);
+  const uint32_t mantissa_mask = (1u << bfp_bits) - 1;
+  for (size_t sample = 0; sample < num_samples; sample += kBfpBlockSamples) {
+    const size_t block_samples =
+        std::min(kBfpBlockSamples, num_samples - sample);
+    const short* block_in = in_buf + (2 * sample);
+    alignas(64) int32_t vals[2 * kBfpBlockSamples] = {};
+    int32_t max_abs = 0;
+    bool loaded = false;
+#ifdef __AVX512F__
+    if (block_samples == kBfpBlockSamples) {
+      const __m512i vals_lo = _mm512_cvtepi16_epi32(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block_in)));
+      const __m256i vals_hi = _mm256_cvtepi16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(block_in + 16)));
+      _mm512_store_si512(vals, vals_lo);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(vals + 16), vals_hi);
+      max_abs = std::max(
+          _mm512_reduce_max_epi32(_mm512_abs_epi32(vals_lo)),
+          _mm512_mask_reduce_max_epi32(
+              0x00ff, _mm512_abs_epi32(_mm512_zextsi256_si512(vals_hi))));
+      loaded = true;
+    }
+#endif
+    if (loaded == false) {
+      for (size_t i = 0; i < 2 * block_samples; i++) {
+        vals[i] = block_in[i];
+        max_abs = std::max(max_abs, std::abs(vals[i]));
+      }
+    }
 
-    _mm256_store_si256((__m256i*)(in_16bits_buf), output_0);
-    _mm256_store_si256((__m256i*)(in_16bits_buf + 16), output_1);
+    // Smallest exponent that fits the largest magnitude in the mantissa
+    int32_t exponent = 0;
+    if (max_abs > 0) {
+      const auto bit_len = static_cast<int32_t>(
+          32 - __builtin_clz(static_cast<uint32_t>(max_abs)));
+      exponent = std::max(0, bit_len - static_cast<int32_t>(bfp_bits - 1));
+    }
 
-    // Conver short to float
-    for (size_t j = 0; j < 2; j++) {
-      /* get input */
-      __m128i val =
-          _mm_load_si128((__m128i*)(in_16bits_buf + j * 16));  // port 2,3
-
-      __m128i val1 = _mm_load_si128((__m128i*)(in_16bits_buf + j * 16 + 8));
-      /* interleave with 0x0000 */
-      __m256i val_unpacked = _mm256_cvtepu16_epi32(val);  // port 5
-      /* convert by xor-ing and subtracting magic value:
-       * VPXOR avoids port5 bottlenecks on Intel CPUs before SKL */
-      __m256i val_f_int =
-          _mm256_xor_si256(val_unpacked, magic_i);           // port 0,1,5
-      __m256 val_f = _mm256_castsi256_ps(val_f_int);         // no instruction
-      __m256 converted = _mm256_sub_ps(val_f, magic);        // port 1,5 ?
-      _mm256_store_ps(out_buf + i * 2 + j * 16, converted);  // port 2,3,4,7
-
-      __m256i val_unpacked1 = _mm256_cvtepu16_epi32(val1);  // port 5
-      __m256i val_f_int1 =
-          _mm256_xor_si256(val_unpacked1, magic_i);      // port 0,1,5
-      __m256 val_f1 = _mm256_castsi256_ps(val_f_int1);   // no instruction
-      __m256 converted1 = _mm256_sub_ps(val_f1, magic);  // port 1,5 ?
-      _mm256_store_ps(out_buf + i * 2 + j * 16 + 8,
-                      converted1);  // port 2,3,4,7
+    uint8_t* block_out = out_buf + (sample / kBfpBlockSamples) * block_bytes;
+    *block_out++ = static_cast<uint8_t>(exponent);
+    uint64_t bits = 0;
+    size_t num_bits = 0;
+    for (int32_t val : vals) {
+      bits |= static_cast<uint64_t>(static_cast<uint32_t>(val >> exponent) &
+                                    mantissa_mask)
+              << num_bits;
+      num_bits += bfp_bits;
+      for (; num_bits >= 8; num_bits -= 8) {
+        *block_out++ = static_cast<uint8_t>(bits);
+        bits >>= 8;
+      }
     }
-    in_buf += 48;
+  }
+  const size_t num_blocks =
+      (num_samples + kBfpBlockSamples - 1) / kBfpBlockSamples;
+  std::memset(out_buf + (num_blocks * block_bytes), 0, kBfpPadding);
+}
+
+// Decompress the 2 * kBfpBlockSamples values of the BFP block [in_buf] to
+// floats [out_buf], scaled like SimdConvertShortToFloat (-1->+0.999)
+static inline void BfpDecompressBlock(const uint8_t* in_buf, float* out_buf,
+                                      size_t bfp_bits) {
+  const float scale = std::ldexp(1.0f, in_buf[0]) / 32768.f;
+  const uint8_t* mantissas = in_buf + 1;
+#ifdef __AVX512F__
+  // Gather the word that holds each mantissa, then shift it to the bottom
+  // and sign-extend it
+  const __m512i bit_pos =
+      _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                           11, 12, 13, 14, 15),
+                         _mm512_set1_epi32(static_cast<int>(bfp_bits)));
+  const __m512i byte_pos = _mm512_srli_epi32(bit_pos, 3);
+  const __m512i bit_shift = _mm512_and_si512(bit_pos, _mm512_set1_epi32(7));
+  const __m512i sign_shift =
+      _mm512_set1_epi32(32 - static_cast<int>(bfp_bits));
+  const __m512 scale_vec = _mm512_set1_ps(scale);
+  // Values 16-23 start 16 * bfp_bits bits in
+  for (size_t half = 0; half < 2; half++) {
+    const __mmask16 mask = (half == 0) ? 0xffff : 0x00ff;
+    __m512i words = _mm512_mask_i32gather_epi32(
+        _mm512_setzero_si512(), mask, byte_pos,
+        mantissas + (half * 2 * bfp_bits), 1);
+    words = _mm512_srlv_epi32(words, bit_shift);
+    words = _mm512_srav_epi32(_mm512_sllv_epi32(words, sign_shift), sign_shift);
+    _mm512_mask_storeu_ps(out_buf + (half * 16), mask,
+                          _mm512_mul_ps(_mm512_cvtepi32_ps(words), scale_vec));
+  }
+#else
+  for (size_t i = 0; i < 2 * kBfpBlockSamples; i++) {
+    const size_t bit_pos = i * bfp_bits;
+    uint32_t word;
+    std::memcpy(&word, mantissas + (bit_pos / 8), sizeof(word));
+    const auto val = static_cast<int32_t>((word >> (bit_pos % 8))
+                                          << (32 - bfp_bits)) >>
+                     (32 - bfp_bits);
+    out_buf[i] = static_cast<float>(val) * scale;
   }
 #endif
 }
 
+// Decompress IQ samples [first_sample, first_sample + num_samples) of the BFP
+// buffer [in_buf] to interleaved floats [out_buf], without an intermediate
+// short buffer. out_buf must have 2 * num_samples elements.
+static inline void BfpDecompressToFloat(const uint8_t* in_buf, float* out_buf,
+                                        size_t first_sample,
+                                        size_t num_samples, size_t bfp_bits) {
+  const size_t block_bytes = BfpBlockBytes(bfp_bits);
+  const size_t end_sample = first_sample + num_samples;
+  alignas(64) float block[2 * kBfpBlockSamples];
+  for (size_t sample = first_sample; sample < end_sample;) {
+    const size_t block_offset = sample % kBfpBlockSamples;
+    const size_t block_samples =
+        std::min(kBfpBlockSamples - block_offset, end_sample - sample);
+    const uint8_t* block_in =
+        in_buf + (sample / kBfpBlockSamples) * block_bytes;
+    if (block_samples == kBfpBlockSamples) {
+      BfpDecompressBlock(block_in, out_buf, bfp_bits);
+    } else {
+      // Partial blocks at the edges of the range
+      BfpDecompressBlock(block_in, block, bfp_bits);
+      std::memcpy(out_buf, block + (2 * block_offset),
+                  2 * block_samples * sizeof(float));
+    }
+    out_buf += 2 * block_samples;
+    sample += block_samples;
+  }
+}
+
 // Convert a float16 array [in_buf] to a float32 array [out_buf]. Each array
 // must have [n_elems] elements
 // in_buf and out_buf must be 64-byte aligned
@@ -560,12 +1085,17 @@ static inline void SimdConvertFloat16ToFloat32(float* out_buf,
     __m512 val = _mm512_cvtph_ps(val_a);
     _mm512_store_ps(out_buf + i, val);
   }
-#else
+#elif defined(__AVX2__)
   for (size_t i = 0; i < n_elems; i += 8) {
     __m128i val_a = _mm_load_si128((__m128i*)(in_buf + i / 2));
     __m256 val = _mm256_cvtph_ps(val_a);
     _mm256_store_ps(out_buf + i, val);
   }
+#else
+  const auto* in = reinterpret_cast<const _Float16*>(in_buf);
+  for (size_t i = 0; i < n_elems; i++) {
+    out_buf[i] = static_cast<float>(in[i]);
+  }
 #endif
 }
 
@@ -590,12 +1120,17 @@ static inline void SimdConvertFloat32ToFloat16(float* out_buf,
     __m256i val = _mm512_cvtps_ph(val_a, _MM_FROUND_NO_EXC);
     _mm256_store_si256(reinterpret_cast<__m256i*>(out_buf + i / 2), val);
   }
-#else
+#elif defined(__AVX2__)
   for (size_t i = 0; i < n_elems; i += 8) {
     __m256 val_a = _mm256_load_ps(in_buf + i);
     __m128i val = _mm256_cvtps_ph(val_a, _MM_FROUND_NO_EXC);
     _mm_store_si128(reinterpret_cast<__m128i*>(out_buf + i / 2), val);
   }
+#else
+  auto* out = reinterpret_cast<_Float16*>(out_buf);
+  for (size_t i = 0; i < n_elems; i++) {
+    out[i] = static_cast<_Float16>(in_buf[i]);
+  }
 #endif
 }
 #endif  // DATATYPE_CONVERSION_H_
\ No newline at end of file
@@ -4,30 +4,46 @@
 
 #include <immintrin.h>
 
+#include <atomic>
 #include <chrono>
 #include <string>
+#include <utility>
 
 #include "eth_common.h"
 #include "logger.h"
 #include "message.h"
+#include "rte_errno.h"
 #include "rte_version.h"
 #include "utils.h"
 
 static constexpr size_t kJumboFrameSize = 9000;
 ///#define ETH_IN_PROMISCUOUS_MODE
+// Time over which NicInit() measures the clock of the rx timestamps
+static constexpr size_t kRxClockCalibrationMs = 100;
 
-std::vector<uint16_t> DpdkTransport::GetPortIDFromMacAddr(
-    size_t port_num, const std::string& mac_addrs) {
-  RtAssert(mac_addrs.length() == (port_num * (kMacAddrBtyes + 1) - 1),
+// Offloads enabled by NicInit(), per port
+static std::array<uint64_t, RTE_MAX_ETHPORTS> port_tx_offloads{};
+static std::array<double, RTE_MAX_ETHPORTS> port_rx_clock_mhz{};
+
+std::vector<rte_ether_addr> DpdkTransport::ParseMacAddrs(
+    size_t num, const std::string& mac_addrs) {
+  RtAssert(mac_addrs.length() == (num * (kMacAddrBtyes + 1) - 1),
            "Invalid length of MAC address in config");
-  std::vector<uint16_t> port_ids;
-  for (size_t i = 0; i < port_num; i++) {
-    // Parse MAC addresses from string
+  std::vector<rte_ether_addr> parsed(num);
+  for (size_t i = 0; i < num; i++) {
     ether_addr* parsed_mac = ether_aton(
         mac_addrs.substr(i * (kMacAddrBtyes + 1), kMacAddrBtyes).c_str());
-    rte_ether_addr rte_mac_addr;
-    RtAssert(parsed_mac != nullptr, "Invalid server mac address");
-    std::memcpy(&rte_mac_addr, parsed_mac, sizeof(ether_addr));
+    RtAssert(parsed_mac != nullptr, "Invalid mac address");
+    std::memcpy(&parsed.at(i), parsed_mac, sizeof(ether_addr));
+  }
+  return parsed;
+}
+
+std::vector<uint16_t> DpdkTransport::GetPortIDFromMacAddr(
+    size_t port_num, const std::string& mac_addrs) {
+  std::vector<uint16_t> port_ids;
+  for (const rte_ether_addr& rte_mac_addr :
+       ParseMacAddrs(port_num, mac_addrs)) {
     // Find the port id with the given MAC address
     uint16_t port_id;
     RTE_ETH_FOREACH_DEV(port_id) {
@@ -44,7 +60,7 @@ std::vector<uint16_t> DpdkTransport::GetPortIDFromMacAddr(
 }
 
 int DpdkTransport::NicInit(uint16_t port, rte_mempool* mbuf_pool,
-                           int thread_num, size_t pkt_len) {
+                           int thread_num, size_t pkt_len, bool tx_multi_seg) {
   rte_eth_conf port_conf = rte_eth_conf();
   const uint16_t rx_rings = thread_num;
   const uint16_t tx_rings = thread_num;
@@ -110,7 +126,7 @@ int DpdkTransport::NicInit(uint16_t port, rte_mempool* mbuf_pool,
   }
 
   if ((dev_info.rx_offload_capa & DEV_RX_OFFLOAD_IPV4_CKSUM) ==
-      DEV_TX_OFFLOAD_IPV4_CKSUM) {
+      DEV_RX_OFFLOAD_IPV4_CKSUM) {
     std::printf("DEV_RX_OFFLOAD_IPV4_CKSUM  enabled\n");
     port_conf.rxmode.offloads |= DEV_RX_OFFLOAD_IPV4_CKSUM;
   }
@@ -119,10 +135,28 @@ int DpdkTransport::NicInit(uint16_t port, rte_mempool* mbuf_pool,
     std::printf("DEV_RX_OFFLOAD_UDP_CKSUM enabled\n");
     port_conf.rxmode.offloads |= DEV_RX_OFFLOAD_UDP_CKSUM;
   }
+  // The NIC stamps each rx mbuf with the time it arrived, see RxTimestamp()
+  const bool rx_timestamp =
+      (dev_info.rx_offload_capa & DEV_RX_OFFLOAD_TIMESTAMP) ==
+      DEV_RX_OFFLOAD_TIMESTAMP;
+  if (rx_timestamp) {
+    retval = rte_mbuf_dyn_rx_timestamp_register(&rx_timestamp_offset_,
+                                                &rx_timestamp_flag_);
+    RtAssert(retval == 0, "Cannot register the rx timestamp mbuf field");
+    std::printf("DEV_RX_OFFLOAD_TIMESTAMP enabled\n");
+    port_conf.rxmode.offloads |= DEV_RX_OFFLOAD_TIMESTAMP;
+  }
 
   //port_conf.rx_adv_conf.rss_conf.rss_hf &= dev_info.flow_type_rss_offloads;
-  if ((dev_info.tx_offload_capa & DEV_TX_OFFLOAD_MBUF_FAST_FREE) ==
-      DEV_TX_OFFLOAD_MBUF_FAST_FREE) {
+  if (tx_multi_seg) {
+    // Fast free skips the free callbacks of the external buffers
+    RtAssert((dev_info.tx_offload_capa & DEV_TX_OFFLOAD_MULTI_SEGS) ==
+                 DEV_TX_OFFLOAD_MULTI_SEGS,
+             "The dev does not support multi-segment tx mbufs");
+    std::printf("DEV_TX_OFFLOAD_MULTI_SEGS enabled\n");
+    port_conf.txmode.offloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+  } else if ((dev_info.tx_offload_capa & DEV_TX_OFFLOAD_MBUF_FAST_FREE) ==
+             DEV_TX_OFFLOAD_MBUF_FAST_FREE) {
     std::printf("DEV_TX_OFFLOAD_MBUF_FAST_FREE enabled\n");
     port_conf.txmode.offloads |= DEV_TX_OFFLOAD_MBUF_FAST_FREE;
   }
@@ -137,6 +171,8 @@ int DpdkTransport::NicInit(uint16_t port, rte_mempool* mbuf_pool,
     port_conf.txmode.offloads |= DEV_TX_OFFLOAD_UDP_CKSUM;
   }
 
+  port_tx_offloads.at(port) = port_conf.txmode.offloads;
+
   retval = rte_eth_dev_configure(port, rx_rings, tx_rings, &port_conf);
   if (retval != 0) {
     std::printf("Error in rte_eth_dev_configure\n");
@@ -185,6 +221,25 @@ int DpdkTransport::NicInit(uint16_t port, rte_mempool* mbuf_pool,
     return retval;
   }
 
+  port_rx_clock_mhz.at(port) = 0.0;
+  if (rx_timestamp) {
+    // The rate of the NIC clock is device specific
+    uint64_t clock_start;
+    uint64_t clock_end;
+    const uint64_t tsc_start = rte_rdtsc();
+    if (rte_eth_read_clock(port, &clock_start) == 0) {
+      rte_delay_ms(kRxClockCalibrationMs);
+      if (rte_eth_read_clock(port, &clock_end) == 0) {
+        const double us = static_cast<double>(rte_rdtsc() - tsc_start) *
+                          1e6 / static_cast<double>(rte_get_tsc_hz());
+        port_rx_clock_mhz.at(port) =
+            static_cast<double>(clock_end - clock_start) / us;
+      }
+    }
+    AGORA_LOG_INFO("NIC %u rx timestamp clock: %.3f MHz\n", port,
+                   port_rx_clock_mhz.at(port));
+  }
+
   rte_ether_addr addr;
   retval = rte_eth_macaddr_get(port, &addr);
   std::printf("NIC %u Socket: %d, MAC: %02" PRIx8 " %02" PRIx8 " %02" PRIx8
@@ -374,6 +429,66 @@ void DpdkTransport::InstallFlowRule(uint16_t port_id, uint16_t rx_q,
 }
 
 // Matches source / dest udp ipv4 packets and rountes them to specific rx queues
+void DpdkTransport::InstallFlowRuleEth(uint16_t port_id, uint16_t rx_q,
+                                       const rte_ether_addr& src_mac,
+                                       uint16_t ether_type, bool vlan) {
+  rte_flow_attr attr;
+  rte_flow_item pattern[3u];
+  rte_flow_action action[2u];
+  rte_flow_action_queue queue = {.index = rx_q};
+  std::memset(pattern, 0u, sizeof(pattern));
+  std::memset(action, 0u, sizeof(action));
+
+  std::memset(&attr, 0u, sizeof(rte_flow_attr));
+  attr.ingress = 1;
+  attr.priority = 0;
+
+  action[0u].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+  action[0u].conf = &queue;
+  action[1u].type = RTE_FLOW_ACTION_TYPE_END;
+
+  // The source MAC, and the type of the frame or of its VLAN payload
+  rte_flow_item_eth eth_spec;
+  rte_flow_item_eth eth_mask;
+  std::memset(&eth_spec, 0u, sizeof(rte_flow_item_eth));
+  std::memset(&eth_mask, 0u, sizeof(rte_flow_item_eth));
+  rte_ether_addr_copy(&src_mac, &eth_spec.src);
+  std::memset(eth_mask.src.addr_bytes, 0xff, RTE_ETHER_ADDR_LEN);
+  rte_flow_item_vlan vlan_spec;
+  rte_flow_item_vlan vlan_mask;
+  std::memset(&vlan_spec, 0u, sizeof(rte_flow_item_vlan));
+  std::memset(&vlan_mask, 0u, sizeof(rte_flow_item_vlan));
+
+  pattern[0u].type = RTE_FLOW_ITEM_TYPE_ETH;
+  pattern[0u].spec = &eth_spec;
+  pattern[0u].mask = &eth_mask;
+  if (vlan) {
+    vlan_spec.inner_type = rte_cpu_to_be_16(ether_type);
+    vlan_mask.inner_type = 0xffff;
+    pattern[1u].type = RTE_FLOW_ITEM_TYPE_VLAN;
+    pattern[1u].spec = &vlan_spec;
+    pattern[1u].mask = &vlan_mask;
+    pattern[2u].type = RTE_FLOW_ITEM_TYPE_END;
+  } else {
+    eth_spec.type = rte_cpu_to_be_16(ether_type);
+    eth_mask.type = 0xffff;
+    pattern[1u].type = RTE_FLOW_ITEM_TYPE_END;
+  }
+
+  rte_flow_error flow_error;
+  int res = rte_flow_validate(port_id, &attr, pattern, action, &flow_error);
+  if (res != 0) {
+    std::printf("Ethernet flow rule cannot be validated %d message: %s\n",
+                flow_error.type,
+                flow_error.message ? flow_error.message : "(no stated reason)");
+  }
+  RtAssert(res == 0, "DPDK: Failed to validate ethernet flow rule");
+
+  rte_flow* flow =
+      rte_flow_create(port_id, &attr, pattern, action, &flow_error);
+  RtAssert(flow != nullptr, "DPDK: Failed to install ethernet flow rule");
+}
+
 void DpdkTransport::InstallFlowRuleDropAll(uint16_t port_id) {
   rte_flow_attr attr;
   rte_flow_item pattern[2u];
@@ -413,16 +528,13 @@ void DpdkTransport::InstallFlowRuleDropAll(uint16_t port_id) {
   RtAssert(flow != nullptr, "DPDK: Failed to install drop all flow rule");
 }
 
-rte_mbuf* DpdkTransport::AllocUdp(rte_mempool* mbuf_pool,
-                                  rte_ether_addr src_mac_addr,
-                                  rte_ether_addr dst_mac_addr,
-                                  uint32_t src_ip_addr, uint32_t dst_ip_addr,
-                                  uint16_t src_udp_port, uint16_t dst_udp_port,
-                                  size_t buffer_length, uint16_t pkt_id) {
-  rte_mbuf* tx_buf __attribute__((aligned(64)));
-  tx_buf = rte_pktmbuf_alloc(mbuf_pool);
-
-  rte_ether_hdr* eth_hdr = rte_pktmbuf_mtod(tx_buf, rte_ether_hdr*);
+DpdkTransport::UdpHeader DpdkTransport::BuildUdpHeader(
+    rte_ether_addr src_mac_addr, rte_ether_addr dst_mac_addr,
+    uint32_t src_ip_addr, uint32_t dst_ip_addr, uint16_t src_udp_port,
+    uint16_t dst_udp_port, size_t buffer_length, uint16_t pkt_id,
+    uint64_t tx_offloads) {
+  UdpHeader header{};
+  auto* eth_hdr = reinterpret_cast<rte_ether_hdr*>(header.data());
   eth_hdr->ether_type = rte_be_to_cpu_16(RTE_ETHER_TYPE_IPV4);
   std::memcpy(eth_hdr->src_addr.addr_bytes, src_mac_addr.addr_bytes,
               RTE_ETHER_ADDR_LEN);
@@ -449,19 +561,63 @@ rte_mbuf* DpdkTransport::AllocUdp(rte_mempool* mbuf_pool,
   udp_h->dgram_len =
       rte_cpu_to_be_16(buffer_length + kPayloadOffset - sizeof(rte_ether_hdr) -
                        sizeof(rte_ipv4_hdr));
+  // The NIC adds the payload to the pseudo-header checksum. Without the
+  // offload the UDP checksum is left out, which IPv4 allows.
   udp_h->dgram_cksum = 0;
+  if ((tx_offloads & DEV_TX_OFFLOAD_UDP_CKSUM) != 0) {
+    udp_h->dgram_cksum = rte_ipv4_phdr_cksum(ip_h, 0);
+  }
+  if ((tx_offloads & DEV_TX_OFFLOAD_IPV4_CKSUM) == 0) {
+    ip_h->hdr_checksum = rte_ipv4_cksum(ip_h);
+  }
+  return header;
+}
+
+rte_mbuf* DpdkTransport::AllocUdp(rte_mempool* mbuf_pool,
+                                  const UdpHeader& header,
+                                  size_t buffer_length, uint64_t tx_offloads) {
+  rte_mbuf* tx_buf __attribute__((aligned(64)));
+  tx_buf = rte_pktmbuf_alloc(mbuf_pool);
+  RtAssert(tx_buf != nullptr, "DpdkTransport: mbuf pool is empty");
+  rte_memcpy(rte_pktmbuf_mtod(tx_buf, uint8_t*), header.data(),
+             header.size());
 
   tx_buf->pkt_len = buffer_length + kPayloadOffset;
   tx_buf->data_len = buffer_length + kPayloadOffset;
-  //Should very that these offloads were enabled
-  tx_buf->ol_flags =
-      RTE_MBUF_F_TX_IPV4 | RTE_MBUF_F_TX_IP_CKSUM | RTE_MBUF_F_TX_UDP_CKSUM;
-  //Not sure if this is needed?
-  tx_buf->l2_len = sizeof(*eth_hdr);
+  tx_buf->ol_flags = 0;
+  if ((tx_offloads & DEV_TX_OFFLOAD_IPV4_CKSUM) != 0) {
+    tx_buf->ol_flags |= RTE_MBUF_F_TX_IPV4 | RTE_MBUF_F_TX_IP_CKSUM;
+  }
+  if ((tx_offloads & DEV_TX_OFFLOAD_UDP_CKSUM) != 0) {
+    tx_buf->ol_flags |= RTE_MBUF_F_TX_IPV4 | RTE_MBUF_F_TX_UDP_CKSUM;
+  }
+  tx_buf->l2_len = sizeof(rte_ether_hdr);
   tx_buf->l3_len = sizeof(rte_ipv4_hdr);
   return tx_buf;
 }
 
+rte_mbuf* DpdkTransport::AllocUdp(rte_mempool* mbuf_pool,
+                                  rte_ether_addr src_mac_addr,
+                                  rte_ether_addr dst_mac_addr,
+                                  uint32_t src_ip_addr, uint32_t dst_ip_addr,
+                                  uint16_t src_udp_port, uint16_t dst_udp_port,
+                                  size_t buffer_length, uint16_t pkt_id) {
+  static constexpr uint64_t kTxCksum =
+      DEV_TX_OFFLOAD_IPV4_CKSUM | DEV_TX_OFFLOAD_UDP_CKSUM;
+  const UdpHeader header = BuildUdpHeader(
+      src_mac_addr, dst_mac_addr, src_ip_addr, dst_ip_addr, src_udp_port,
+      dst_udp_port, buffer_length, pkt_id, kTxCksum);
+  return AllocUdp(mbuf_pool, header, buffer_length, kTxCksum);
+}
+
+uint64_t DpdkTransport::TxOffloads(uint16_t port) {
+  return port_tx_offloads.at(port);
+}
+
+double DpdkTransport::RxClockMhz(uint16_t port) {
+  return port_rx_clock_mhz.at(port);
+}
+
 void DpdkTransport::DpdkInit(uint16_t core_offset, size_t thread_num) {
   // DPDK setup
   std::string core_list = std::to_string(GetPhysicalCoreId(core_offset));
@@ -478,6 +634,10 @@ void DpdkTransport::DpdkInit(uint16_t core_offset, size_t thread_num) {
   std::printf("Dpdk init on core start %d, num threads %zu\n", core_offset,
               thread_num);
   int ret = rte_eal_init(rte_argc, const_cast<char**>(rte_argv));
+  if ((ret < 0) && (rte_errno == EALREADY)) {
+    AGORA_LOG_INFO("DPDK: the EAL is already initialized in this process\n");
+    return;
+  }
   RtAssert(
       ret >= 0,
       "Failed to initialize DPDK.  Are you running with root permissions?");
@@ -485,14 +645,81 @@ void DpdkTransport::DpdkInit(uint16_t core_offset, size_t thread_num) {
 }
 
 rte_mempool* DpdkTransport::CreateMempool(size_t num_ports,
-                                          size_t packet_length) {
+                                          size_t packet_length,
+                                          int socket_id) {
   const size_t mbuf_size = packet_length + kPayloadOffset + kMBufCacheSize;
+  static std::atomic<size_t> num_pools{0};
+  const std::string name = "MBUF_POOL_" + std::to_string(num_pools++);
+  if (socket_id == SOCKET_ID_ANY) {
+    socket_id = static_cast<int>(rte_socket_id());
+  }
   rte_mempool* mbuf_pool =
-      rte_pktmbuf_pool_create("MBUF_POOL", kNumMBufs * num_ports,
-                              kMBufCacheSize, 0, mbuf_size, rte_socket_id());
+      rte_pktmbuf_pool_create(name.c_str(), kNumMBufs * num_ports,
+                              kMBufCacheSize, 0, mbuf_size, socket_id);
 
   RtAssert(mbuf_pool != nullptr, "Cannot create mbuf pool");
   return mbuf_pool;
 }
 
+void DpdkTransport::PrintPortStats(uint16_t port) {
+  rte_eth_stats stats;
+  const int ret = rte_eth_stats_get(port, &stats);
+  if (ret != 0) {
+    AGORA_LOG_ERROR("Cannot get the stats of port %u: %s\n", port,
+                    rte_strerror(-ret));
+    return;
+  }
+  AGORA_LOG_INFO(
+      "Port %u (socket %d): rx %" PRIu64 " packets %" PRIu64
+      " bytes, tx %" PRIu64 " packets %" PRIu64 " bytes, missed %" PRIu64
+      ", rx errors %" PRIu64 ", tx errors %" PRIu64 ", no mbuf %" PRIu64
+      "\n",
+      port, rte_eth_dev_socket_id(port), stats.ipackets, stats.ibytes,
+      stats.opackets, stats.obytes, stats.imissed, stats.ierrors,
+      stats.oerrors, stats.rx_nombuf);
+}
+
+// The page aligned range that covers [addr, addr + len)
+static std::pair<uintptr_t, size_t> ExtMemPages(void* addr, size_t len) {
+  const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  const uintptr_t start = reinterpret_cast<uintptr_t>(addr) & ~(page_size - 1);
+  const uintptr_t end =
+      (reinterpret_cast<uintptr_t>(addr) + len + page_size - 1) &
+      ~(page_size - 1);
+  return std::make_pair(start, end - start);
+}
+
+void DpdkTransport::RegisterExtMem(void* addr, size_t len,
+                                   const std::vector<uint16_t>& ports) {
+  RtAssert(rte_eal_iova_mode() == RTE_IOVA_VA,
+           "External tx memory needs IOVA as VA (--iova-mode=va)");
+  const auto pages = ExtMemPages(addr, len);
+  auto* const start = reinterpret_cast<void*>(pages.first);
+  int ret = rte_extmem_register(start, pages.second, nullptr, 0,
+                                sysconf(_SC_PAGESIZE));
+  RtAssert(ret == 0, "Cannot register the external tx memory");
+  for (const uint16_t port : ports) {
+    rte_eth_dev_info dev_info;
+    ret = rte_eth_dev_info_get(port, &dev_info);
+    RtAssert(ret == 0, "Cannot get the dev info of a port");
+    ret = rte_dev_dma_map(dev_info.device, start, pages.first, pages.second);
+    RtAssert(ret == 0, "Cannot map the external tx memory for a dev");
+  }
+  AGORA_LOG_INFO("Registered %zu bytes of external tx memory\n",
+                 pages.second);
+}
+
+void DpdkTransport::UnregisterExtMem(void* addr, size_t len,
+                                     const std::vector<uint16_t>& ports) {
+  const auto pages = ExtMemPages(addr, len);
+  auto* const start = reinterpret_cast<void*>(pages.first);
+  for (const uint16_t port : ports) {
+    rte_eth_dev_info dev_info;
+    if (rte_eth_dev_info_get(port, &dev_info) == 0) {
+      rte_dev_dma_unmap(dev_info.device, start, pages.first, pages.second);
+    }
+  }
+  rte_extmem_unregister(start, pages.second);
+}
+
 #endif  // USE_DPDK
\ No newline at end of file
@@ -17,11 +17,13 @@
 #include <rte_flow.h>
 #include <rte_ip.h>
 #include <rte_malloc.h>
+#include <rte_mbuf_dyn.h>
 #include <rte_pause.h>
 #include <rte_prefetch.h>
 #include <rte_udp.h>
 #include <unistd.h>
 
+#include <array>
 #include <cinttypes>
 #include <string>
 
@@ -36,8 +38,12 @@ static constexpr size_t kMacAddrBtyes = 17;
 
 // allow max jumbo frame 9.5 KB
 static constexpr size_t kJumboFrameMaxSize = 0x2600;
-/// Maximum number of packets received in rx_burst
+/// Default number of packets received in rx_burst, see
+/// Config::DpdkRxBurst()
 static constexpr size_t kRxBatchSize = 16;
+/// Bounds of Config::DpdkRxBurst(), and of the adaptive burst size
+static constexpr size_t kMaxRxBatchSize = 64;
+static constexpr size_t kMinRxBatchSize = 4;
 static constexpr size_t kTxBatchSize = 1;
 
 /// Offset to the payload starting from the beginning of the UDP frame
@@ -55,9 +61,15 @@ class DpdkTransport {
 
   static std::vector<uint16_t> GetPortIDFromMacAddr(
       size_t port_num, const std::string& mac_addrs);
+  /// The num MAC addresses of mac_addrs, each followed by one separator
+  static std::vector<rte_ether_addr> ParseMacAddrs(
+      size_t num, const std::string& mac_addrs);
 
+  // tx_multi_seg enables multi-segment TX mbufs, and disables the fast
+  // free of TX mbufs, for the external-buffer mbufs of zero-copy TX
   static int NicInit(uint16_t port, struct rte_mempool* mbuf_pool,
-                     int thread_num, size_t pkt_len = kJumboFrameMaxSize);
+                     int thread_num, size_t pkt_len = kJumboFrameMaxSize,
+                     bool tx_multi_seg = false);
 
   // Steer the flow [src_ip, dest_ip, src_port, dst_port] arriving on
   // [port_id] to RX queue [rx_q]
@@ -65,6 +77,12 @@ class DpdkTransport {
                               uint32_t dest_ip, uint16_t src_port,
                               uint16_t dst_port);
 
+  // Steer the frames of [ether_type] from [src_mac] arriving on [port_id],
+  // inside a VLAN tag if [vlan], to RX queue [rx_q]
+  static void InstallFlowRuleEth(uint16_t port_id, uint16_t rx_q,
+                                 const rte_ether_addr& src_mac,
+                                 uint16_t ether_type, bool vlan);
+
   static void InstallFlowRuleDropAll(uint16_t port_id);
 
   static void FastMemcpy(void* pvDest, void* pvSrc, size_t nBytes);
@@ -75,18 +93,78 @@ class DpdkTransport {
   /// Return a string representation of this packet
   static std::string PktToString(const rte_mbuf* pkt);
 
+  /// The Ethernet, IPv4 and UDP headers of a packet
+  using UdpHeader = std::array<uint8_t, kPayloadOffset>;
+
+  /// The headers of a packet of buffer_length payload bytes, with the
+  /// checksums that tx_offloads does not leave to the NIC filled in. Built
+  /// once per flow, for AllocUdp() to copy into each mbuf.
+  static UdpHeader BuildUdpHeader(rte_ether_addr src_mac_addr,
+                                  rte_ether_addr dst_mac_addr,
+                                  uint32_t src_ip_addr, uint32_t dst_ip_addr,
+                                  uint16_t src_udp_port, uint16_t dst_udp_port,
+                                  size_t buffer_length, uint16_t pkt_id,
+                                  uint64_t tx_offloads);
+
+  /// Allocate and return a fresh rte_mbuf with the prebuilt header, sized
+  /// for buffer_length payload bytes, and the checksum offload flags of
+  /// tx_offloads (see TxOffloads())
+  static rte_mbuf* AllocUdp(rte_mempool* mbuf_pool, const UdpHeader& header,
+                            size_t buffer_length, uint64_t tx_offloads);
+
   /// Allocate and return a fresh rte_mbuf with Ethernet, IPv4, and UDP
-  /// header filled
+  /// header filled, with the IPv4 and UDP checksums left to the NIC
   static rte_mbuf* AllocUdp(rte_mempool* mbuf_pool, rte_ether_addr src_mac_addr,
                             rte_ether_addr dst_mac_addr, uint32_t src_ip_addr,
                             uint32_t dst_ip_addr, uint16_t src_udp_port,
                             uint16_t dst_udp_port, size_t buffer_length,
                             uint16_t pkt_id);
 
-  /// Init dpdk on core [core_offset:core_offset+thread_num]
+  /// The tx offloads that NicInit() enabled on [port]
+  static uint64_t TxOffloads(uint16_t port);
+
+  /// Ticks per microsecond of the clock of the rx timestamps of [port], 0 if
+  /// NicInit() could not enable them
+  static double RxClockMhz(uint16_t port);
+
+  /// The hardware rx timestamp of pkt in ticks of the NIC clock, 0 if the
+  /// NIC did not stamp it
+  static inline uint64_t RxTimestamp(const rte_mbuf* pkt) {
+    if ((rx_timestamp_offset_ < 0) ||
+        ((pkt->ol_flags & rx_timestamp_flag_) == 0)) {
+      return 0;
+    }
+    return *RTE_MBUF_DYNFIELD(pkt, rx_timestamp_offset_,
+                              const rte_mbuf_timestamp_t*);
+  }
+
+  /// Init dpdk on core [core_offset:core_offset+thread_num]. The EAL is
+  /// initialized once per process, so the cells of a process after the first
+  /// one keep its core list.
   static void DpdkInit(uint16_t core_offset, size_t thread_num);
+  /// A pool with a name unique in the process, one per cell, or one per
+  /// port on the NUMA node of the port. SOCKET_ID_ANY is the socket of the
+  /// calling lcore.
   static rte_mempool* CreateMempool(size_t num_ports,
-                                    size_t packet_length = kJumboFrameMaxSize);
+                                    size_t packet_length = kJumboFrameMaxSize,
+                                    int socket_id = SOCKET_ID_ANY);
+
+  /// Log the packet, byte, drop and error counters of the NIC of [port]
+  static void PrintPortStats(uint16_t port);
+
+  /// Register [addr, addr + len) as external memory that the NICs of
+  /// [ports] can send from, widened to whole pages. Needs IOVA as VA, so
+  /// that the IOVA of an external buffer is its address.
+  static void RegisterExtMem(void* addr, size_t len,
+                             const std::vector<uint16_t>& ports);
+  static void UnregisterExtMem(void* addr, size_t len,
+                               const std::vector<uint16_t>& ports);
+
+ private:
+  // The mbuf dynamic field and flag of the rx timestamps, registered by the
+  // first NicInit() of a port with timestamps
+  static inline int rx_timestamp_offset_ = -1;
+  static inline uint64_t rx_timestamp_flag_ = 0;
 };
 
 #endif  // DPDK_TRANSPORT_H_
\ No newline at end of file
@@ -182,6 +182,20 @@ static inline void gen_ipv4_header(ipv4_hdr_t* ipv4_hdr, uint32_t src_ip,
   ipv4_hdr->check = 0;
 }
 
+/// Return the checksum of \p ipv4_hdr in network-byte order. The check field
+/// must be zero.
+static inline uint16_t ipv4_checksum(const ipv4_hdr_t* ipv4_hdr) {
+  const auto* words = reinterpret_cast<const uint16_t*>(ipv4_hdr);
+  uint32_t sum = 0;
+  for (size_t i = 0; i < sizeof(ipv4_hdr_t) / sizeof(uint16_t); i++) {
+    sum += words[i];
+  }
+  while ((sum >> 16) != 0) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return static_cast<uint16_t>(~sum);
+}
+
 /// Format the UDP header for a UDP packet. All value arguments are in host-byte
 /// order. \p data_size is the data payload size in the UDP packet.
 static inline void gen_udp_header(udp_hdr_t* udp_hdr, uint16_t src_port,
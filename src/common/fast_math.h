@@ -0,0 +1,110 @@
+/**
+ * @file fast_math.h
+ * @brief Accuracy tiers of the reciprocals and inverse square roots of the
+ * complex float kernels: the exact division, or the 14-bit (AVX-512) or
+ * 12-bit (AVX) estimate of the CPU with or without one Newton-Raphson step.
+ * The tier of each kernel family is set by "fast_math" in the config.
+ */
+#ifndef FAST_MATH_H_
+#define FAST_MATH_H_
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace FastMath {
+
+enum class Precision {
+  // Division and square root, to 0.5 ULP
+  kExact,
+  // The estimate with one Newton-Raphson step, within about 2 ULPs
+  kRefined,
+  // The estimate alone, 2^-14 relative error with AVX-512, 2^-12 with AVX
+  kApprox
+};
+static constexpr size_t kNumPrecisions = 3;
+
+/// The kernel families whose tier is set on its own
+enum class Family {
+  // Beamweight inversion of the small-MIMO path
+  kSmallMimo,
+  // Phase tracking of the uplink demodulation
+  kPhaseTrack,
+  // One-stream equalization of the UE
+  kSisoEqual
+};
+static constexpr size_t kNumFamilies = 3;
+
+/// Names of the tiers and families in the config
+static const std::array<std::string, kNumPrecisions> kPrecisionNames = {
+    "exact", "refined", "approx"};
+static const std::array<std::string, kNumFamilies> kFamilyNames = {
+    "small_mimo", "phase_track", "siso_equal"};
+
+inline const std::string& PrecisionName(Precision precision) {
+  return kPrecisionNames.at(static_cast<size_t>(precision));
+}
+
+// Internal linkage, so that no copy built for one instruction set is picked
+// by the linker for another
+#ifdef __AVX512F__
+/// 1 / x of each float
+template <Precision kPrecision>
+static inline __m512 Rcp(__m512 x) {
+  if constexpr (kPrecision == Precision::kExact) {
+    return _mm512_div_ps(_mm512_set1_ps(1.0f), x);
+  } else {
+    const __m512 r = _mm512_rcp14_ps(x);
+    if constexpr (kPrecision == Precision::kApprox) {
+      return r;
+    }
+    // r * (2 - x * r) as r + r * (1 - x * r)
+    const __m512 e = _mm512_fnmadd_ps(x, r, _mm512_set1_ps(1.0f));
+    return _mm512_fmadd_ps(r, e, r);
+  }
+}
+
+/// 1 / sqrt(x) of each float
+template <Precision kPrecision>
+static inline __m512 Rsqrt(__m512 x) {
+  if constexpr (kPrecision == Precision::kExact) {
+    return _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_sqrt_ps(x));
+  } else {
+    const __m512 r = _mm512_rsqrt14_ps(x);
+    if constexpr (kPrecision == Precision::kApprox) {
+      return r;
+    }
+    // r * (1.5 - 0.5 * x * r^2)
+    const __m512 half_xr = _mm512_mul_ps(_mm512_mul_ps(x, r),
+                                         _mm512_set1_ps(0.5f));
+    return _mm512_mul_ps(
+        r, _mm512_fnmadd_ps(half_xr, r, _mm512_set1_ps(1.5f)));
+  }
+}
+#endif
+
+#ifdef __AVX__
+/// 1 / x of each float
+template <Precision kPrecision>
+static inline __m256 Rcp(__m256 x) {
+  if constexpr (kPrecision == Precision::kExact) {
+    return _mm256_div_ps(_mm256_set1_ps(1.0f), x);
+  } else {
+    const __m256 r = _mm256_rcp_ps(x);
+    if constexpr (kPrecision == Precision::kApprox) {
+      return r;
+    }
+    // Without FMA, so that it builds for every AVX target
+    return _mm256_mul_ps(
+        r, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(x, r)));
+  }
+}
+#endif
+
+}  // namespace FastMath
+
+#endif  // FAST_MATH_H_
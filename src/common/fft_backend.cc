@@ -0,0 +1,301 @@
+/**
+ * @file fft_backend.cc
+ * @brief Implementation file for the FFT backends
+ */
+#include "fft_backend.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include "config.h"
+#include "gettime.h"
+#include "logger.h"
+#include "memory_manage.h"
+#include "mkl_dft_cache.h"
+#include "utils.h"
+
+#if defined(USE_FFTW)
+#include <fftw3.h>
+#endif
+#if defined(USE_MUFFT)
+extern "C" {
+#include "mufft/fft.h"
+}
+#endif
+
+namespace FftBackend {
+
+// Shares the committed descriptors of MklDftCache with the other plans of
+// the same shape
+class MklPlan : public FftPlan {
+ public:
+  MklPlan(size_t fft_size, size_t num_transforms, bool out_of_place)
+      : in_place_(MklDftCache::Acquire(fft_size, num_transforms, true)),
+        out_of_place_(
+            out_of_place
+                ? MklDftCache::Acquire(fft_size, num_transforms, false)
+                : nullptr) {}
+  ~MklPlan() override {
+    MklDftCache::Release(in_place_);
+    if (out_of_place_ != nullptr) {
+      MklDftCache::Release(out_of_place_);
+    }
+  }
+
+  void Forward(complex_float* in_out) override {
+    DftiComputeForward(in_place_, reinterpret_cast<float*>(in_out));
+  }
+  void Backward(complex_float* in_out) override {
+    DftiComputeBackward(in_place_, reinterpret_cast<float*>(in_out));
+  }
+  void Backward(const complex_float* in, complex_float* out) override {
+    DftiComputeBackward(out_of_place_,
+                        const_cast<float*>(reinterpret_cast<const float*>(in)),
+                        reinterpret_cast<float*>(out));
+  }
+
+ private:
+  DFTI_DESCRIPTOR_HANDLE in_place_;
+  DFTI_DESCRIPTOR_HANDLE out_of_place_;
+};
+
+#if defined(USE_FFTW)
+// The FFTW planner and its wisdom are process-wide and not thread safe
+static std::mutex fftw_mutex;
+static std::set<std::string> fftw_wisdom_loaded;
+
+// Planned with FFTW_MEASURE on scratch arrays, then executed on the caller's
+// arrays, which must be aligned like the Agora buffers
+class FftwPlan : public FftPlan {
+ public:
+  FftwPlan(size_t fft_size, size_t num_transforms, bool out_of_place,
+           const std::string& wisdom_file) {
+    std::lock_guard<std::mutex> lock(fftw_mutex);
+    if ((wisdom_file.empty() == false) &&
+        fftw_wisdom_loaded.insert(wisdom_file).second &&
+        (fftwf_import_wisdom_from_filename(wisdom_file.c_str()) != 0)) {
+      AGORA_LOG_INFO("FftBackend: loaded FFTW wisdom from %s\n",
+                     wisdom_file.c_str());
+    }
+    const int n = static_cast<int>(fft_size);
+    const int howmany = static_cast<int>(num_transforms);
+    fftwf_complex* a = fftwf_alloc_complex(fft_size * num_transforms);
+    fftwf_complex* b = fftwf_alloc_complex(fft_size * num_transforms);
+    forward_ = fftwf_plan_many_dft(1, &n, howmany, a, nullptr, 1, n, a,
+                                   nullptr, 1, n, FFTW_FORWARD, FFTW_MEASURE);
+    backward_ = fftwf_plan_many_dft(1, &n, howmany, a, nullptr, 1, n, a,
+                                    nullptr, 1, n, FFTW_BACKWARD, FFTW_MEASURE);
+    if (out_of_place) {
+      backward_out_ =
+          fftwf_plan_many_dft(1, &n, howmany, a, nullptr, 1, n, b, nullptr, 1,
+                              n, FFTW_BACKWARD, FFTW_MEASURE);
+    }
+    fftwf_free(a);
+    fftwf_free(b);
+    RtAssert((forward_ != nullptr) && (backward_ != nullptr) &&
+                 ((out_of_place == false) || (backward_out_ != nullptr)),
+             "FftBackend: FFTW planning failed");
+    if ((wisdom_file.empty() == false) &&
+        (fftwf_export_wisdom_to_filename(wisdom_file.c_str()) == 0)) {
+      AGORA_LOG_WARN("FftBackend: failed to save FFTW wisdom to %s\n",
+                     wisdom_file.c_str());
+    }
+  }
+  ~FftwPlan() override {
+    std::lock_guard<std::mutex> lock(fftw_mutex);
+    fftwf_destroy_plan(forward_);
+    fftwf_destroy_plan(backward_);
+    if (backward_out_ != nullptr) {
+      fftwf_destroy_plan(backward_out_);
+    }
+  }
+
+  void Forward(complex_float* in_out) override {
+    auto* data = reinterpret_cast<fftwf_complex*>(in_out);
+    fftwf_execute_dft(forward_, data, data);
+  }
+  void Backward(complex_float* in_out) override {
+    auto* data = reinterpret_cast<fftwf_complex*>(in_out);
+    fftwf_execute_dft(backward_, data, data);
+  }
+  void Backward(const complex_float* in, complex_float* out) override {
+    // An out-of-place complex transform preserves its input
+    fftwf_execute_dft(
+        backward_out_,
+        const_cast<fftwf_complex*>(reinterpret_cast<const fftwf_complex*>(in)),
+        reinterpret_cast<fftwf_complex*>(out));
+  }
+
+ private:
+  fftwf_plan forward_ = nullptr;
+  fftwf_plan backward_ = nullptr;
+  fftwf_plan backward_out_ = nullptr;
+};
+#endif
+
+#if defined(USE_MUFFT)
+// muFFT transforms out of place only, so the in-place transforms go through
+// a scratch transform of the plan
+class MufftPlan : public FftPlan {
+ public:
+  MufftPlan(size_t fft_size, size_t num_transforms)
+      : fft_size_(fft_size),
+        num_transforms_(num_transforms),
+        forward_(mufft_create_plan_1d_c2c(fft_size, MUFFT_FORWARD,
+                                          MUFFT_FLAG_CPU_ANY)),
+        backward_(mufft_create_plan_1d_c2c(fft_size, MUFFT_INVERSE,
+                                           MUFFT_FLAG_CPU_ANY)),
+        scratch_(static_cast<complex_float*>(
+            mufft_alloc(fft_size * sizeof(complex_float)))) {
+    RtAssert((forward_ != nullptr) && (backward_ != nullptr),
+             "FftBackend: muFFT planning failed");
+  }
+  ~MufftPlan() override {
+    mufft_free_plan_1d(forward_);
+    mufft_free_plan_1d(backward_);
+    mufft_free(scratch_);
+  }
+
+  void Forward(complex_float* in_out) override { InPlace(forward_, in_out); }
+  void Backward(complex_float* in_out) override {
+    InPlace(backward_, in_out);
+  }
+  void Backward(const complex_float* in, complex_float* out) override {
+    for (size_t i = 0; i < num_transforms_; i++) {
+      mufft_execute_plan_1d(backward_, &out[i * fft_size_],
+                            &in[i * fft_size_]);
+    }
+  }
+
+ private:
+  void InPlace(mufft_plan_1d* plan, complex_float* in_out) {
+    for (size_t i = 0; i < num_transforms_; i++) {
+      mufft_execute_plan_1d(plan, scratch_, &in_out[i * fft_size_]);
+      std::memcpy(&in_out[i * fft_size_], scratch_,
+                  fft_size_ * sizeof(complex_float));
+    }
+  }
+
+  const size_t fft_size_;
+  const size_t num_transforms_;
+  mufft_plan_1d* forward_;
+  mufft_plan_1d* backward_;
+  complex_float* scratch_;
+};
+#endif
+
+bool Available(const std::string& backend) {
+  if (backend == kMkl) {
+    return true;
+  }
+#if defined(USE_FFTW)
+  if (backend == kFftw) {
+    return true;
+  }
+#endif
+#if defined(USE_MUFFT)
+  if (backend == kMufft) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+std::unique_ptr<FftPlan> CreatePlan(const std::string& backend,
+                                    size_t fft_size, size_t num_transforms,
+                                    bool out_of_place,
+                                    const std::string& wisdom_file) {
+  unused(wisdom_file);
+  if (backend == kMkl) {
+    return std::make_unique<MklPlan>(fft_size, num_transforms, out_of_place);
+  }
+#if defined(USE_FFTW)
+  if (backend == kFftw) {
+    return std::make_unique<FftwPlan>(fft_size, num_transforms, out_of_place,
+                                      wisdom_file);
+  }
+#endif
+#if defined(USE_MUFFT)
+  if (backend == kMufft) {
+    return std::make_unique<MufftPlan>(fft_size, num_transforms);
+  }
+#endif
+  throw std::runtime_error("FftBackend: " + backend +
+                           " is not built in (USE_FFTW, USE_MUFFT)");
+}
+
+// Microseconds per forward transform of the backend at fft_size
+static double Benchmark(const std::string& backend, size_t fft_size,
+                        const std::string& wisdom_file) {
+  // Enough transforms for a stable time, a few ms at the common sizes
+  const size_t num_iters = std::max<size_t>(100, (1u << 22) / fft_size);
+  auto plan = CreatePlan(backend, fft_size, 1, false, wisdom_file);
+  auto* input = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, fft_size * sizeof(complex_float)));
+  auto* data = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, fft_size * sizeof(complex_float)));
+  for (size_t i = 0; i < fft_size; i++) {
+    input[i] = {static_cast<float>(i % 7) - 3.0f,
+                static_cast<float>(i % 5) - 2.0f};
+  }
+  // Each transform starts over from the same input, so the values stay in
+  // range; the copy costs the same for every backend
+  std::memcpy(data, input, fft_size * sizeof(complex_float));
+  plan->Forward(data);
+  const double start_us = GetTime::GetTimeUs();
+  for (size_t i = 0; i < num_iters; i++) {
+    std::memcpy(data, input, fft_size * sizeof(complex_float));
+    plan->Forward(data);
+  }
+  const double us = (GetTime::GetTimeUs() - start_us) / num_iters;
+  Agora_memory::PaddedAlignedFree(input);
+  Agora_memory::PaddedAlignedFree(data);
+  return us;
+}
+
+// Only touched when plans are created, not on the data path
+static std::mutex select_mutex;
+static std::map<size_t, std::string> selected;
+
+// The fastest built-in backend at fft_size, benchmarked on the first call
+static std::string Autotune(size_t fft_size, const std::string& wisdom_file) {
+  std::lock_guard<std::mutex> lock(select_mutex);
+  auto found = selected.find(fft_size);
+  if (found != selected.end()) {
+    return found->second;
+  }
+  std::string best;
+  double best_us = 0;
+  for (const char* backend : {kMkl, kFftw, kMufft}) {
+    if (Available(backend) == false) {
+      continue;
+    }
+    const double us = Benchmark(backend, fft_size, wisdom_file);
+    AGORA_LOG_INFO("FftBackend: %s takes %.3f us per %zu-point FFT\n",
+                   backend, us, fft_size);
+    if (best.empty() || (us < best_us)) {
+      best = backend;
+      best_us = us;
+    }
+  }
+  AGORA_LOG_INFO("FftBackend: using %s for %zu-point FFTs\n", best.c_str(),
+                 fft_size);
+  selected.emplace(fft_size, best);
+  return best;
+}
+
+std::unique_ptr<FftPlan> CreatePlan(const Config* cfg, size_t fft_size,
+                                    size_t num_transforms,
+                                    bool out_of_place) {
+  const std::string backend = (cfg->FftBackend() == "auto")
+                                  ? Autotune(fft_size, cfg->FftWisdomFile())
+                                  : cfg->FftBackend();
+  return CreatePlan(backend, fft_size, num_transforms, out_of_place,
+                    cfg->FftWisdomFile());
+}
+
+}  // namespace FftBackend
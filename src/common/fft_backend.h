@@ -0,0 +1,71 @@
+/**
+ * @file fft_backend.h
+ * @brief Declaration file for the FFT backends: a plan interface over MKL
+ * DFTI, FFTW and muFFT, and the selection of a backend per FFT size.
+ */
+#ifndef FFT_BACKEND_H_
+#define FFT_BACKEND_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "common_typedef_sdk.h"
+
+class Config;
+
+/**
+ * @brief Single precision complex transforms of one size, num_transforms at
+ * a time, each fft_size entries after the previous one.
+ *
+ * A plan is created when a doer is, never on the data path, and it is used
+ * by one thread. Backward() is the unscaled inverse transform.
+ */
+class FftPlan {
+ public:
+  virtual ~FftPlan() = default;
+
+  /// Forward transforms, in place
+  virtual void Forward(complex_float* in_out) = 0;
+  /// Backward transforms, in place
+  virtual void Backward(complex_float* in_out) = 0;
+  /// Backward transforms from in to out, for a plan created out_of_place.
+  /// in is left unchanged.
+  virtual void Backward(const complex_float* in, complex_float* out) = 0;
+};
+
+namespace FftBackend {
+
+/// The backends built in, by the names of the "fft_backend" key
+static constexpr const char* kMkl = "mkl";
+static constexpr const char* kFftw = "fftw";
+static constexpr const char* kMufft = "mufft";
+
+/// Whether the backend is built in (FFTW with USE_FFTW, muFFT with
+/// USE_MUFFT)
+bool Available(const std::string& backend);
+
+/**
+ * @brief The plan of a backend
+ *
+ * @param out_of_place Also support Backward(in, out)
+ * @param wisdom_file FFTW wisdom to load before planning and to save the new
+ * plans to, none if empty
+ */
+std::unique_ptr<FftPlan> CreatePlan(const std::string& backend,
+                                    size_t fft_size, size_t num_transforms = 1,
+                                    bool out_of_place = false,
+                                    const std::string& wisdom_file = "");
+
+/**
+ * @brief The plan of the backend of Config::FftBackend(). With "auto", the
+ * built-in backends are benchmarked at fft_size on the first request for
+ * that size, and the fastest is used from then on.
+ */
+std::unique_ptr<FftPlan> CreatePlan(const Config* cfg, size_t fft_size,
+                                    size_t num_transforms = 1,
+                                    bool out_of_place = false);
+
+}  // namespace FftBackend
+
+#endif  // FFT_BACKEND_H_
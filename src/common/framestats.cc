@@ -7,7 +7,6 @@
  */
 #include "framestats.h"
 
-#include <algorithm>
 #include <cassert>
 #include <utility>
 
@@ -16,26 +15,31 @@
 FrameStats::FrameStats(std::string new_frame_id)
     : frame_identifier_(std::move(new_frame_id)),
       client_ul_pilot_symbols_(0),
-      client_dl_pilot_symbols_(0) {
+      client_dl_pilot_symbols_(0),
+      symbol_idx_(frame_identifier_.length(), SIZE_MAX) {
   for (size_t i = 0; i < frame_identifier_.length(); i++) {
     char symbol = frame_identifier_.at(i);
     switch (symbol) {
       case 'B': {
+        symbol_idx_.at(i) = beacon_symbols_.size();
         beacon_symbols_.push_back(i);
         break;
       }
 
       case 'S': {
+        symbol_idx_.at(i) = dl_control_symbols_.size();
         dl_control_symbols_.push_back(i);
         break;
       }
 
       case 'C': {
+        symbol_idx_.at(i) = dl_cal_symbols_.size();
         dl_cal_symbols_.push_back(i);
         break;
       }
 
       case 'D': {
+        symbol_idx_.at(i) = dl_symbols_.size();
         dl_symbols_.push_back(i);
         break;
       }
@@ -45,16 +49,19 @@ FrameStats::FrameStats(std::string new_frame_id)
       }
 
       case 'L': {
+        symbol_idx_.at(i) = ul_cal_symbols_.size();
         ul_cal_symbols_.push_back(i);
         break;
       }
 
       case 'P': {
+        symbol_idx_.at(i) = pilot_symbols_.size();
         pilot_symbols_.push_back(i);
         break;
       }
 
       case 'U': {
+        symbol_idx_.at(i) = ul_symbols_.size();
         ul_symbols_.push_back(i);
         break;
       }
@@ -144,44 +151,35 @@ size_t FrameStats::GetDLControlSymbol(size_t location) const {
   return this->dl_control_symbols_.at(location);
 }
 
-size_t FrameStats::GetSymbolIdx(const std::vector<size_t>& search_vector,
-                                size_t symbol_number) {
-  /* TODO: Optimize this, probably with a precomputed table -- assumes sorted
-   * list
-   */
-  const auto [start, finish] = std::equal_range(
-      search_vector.begin(), search_vector.end(), symbol_number);
-
-  if (start == finish) {
-    return SIZE_MAX;
-  } else if ((start + 1) == finish) {
-    return (start - search_vector.begin());
-  } else { /* Invalid, multiple locations */
-    assert(false);
+size_t FrameStats::GetSymbolIdx(char symbol_type,
+                                size_t symbol_number) const {
+  if ((symbol_number >= this->frame_identifier_.length()) ||
+      (this->frame_identifier_[symbol_number] != symbol_type)) {
     return SIZE_MAX;
   }
+  return this->symbol_idx_[symbol_number];
 }
 
 size_t FrameStats::GetBeaconSymbolIdx(size_t symbol_number) const {
-  return FrameStats::GetSymbolIdx(this->beacon_symbols_, symbol_number);
+  return GetSymbolIdx('B', symbol_number);
 }
 
 size_t FrameStats::GetDLControlSymbolIdx(size_t symbol_number) const {
-  return FrameStats::GetSymbolIdx(this->dl_control_symbols_, symbol_number);
+  return GetSymbolIdx('S', symbol_number);
 }
 
 size_t FrameStats::GetDLSymbolIdx(size_t symbol_number) const {
-  return FrameStats::GetSymbolIdx(this->dl_symbols_, symbol_number);
+  return GetSymbolIdx('D', symbol_number);
 }
 
 size_t FrameStats::GetULSymbolIdx(size_t symbol_number) const {
-  return FrameStats::GetSymbolIdx(this->ul_symbols_, symbol_number);
+  return GetSymbolIdx('U', symbol_number);
 }
 
 size_t FrameStats::GetPilotSymbolIdx(size_t symbol_number) const {
-  return FrameStats::GetSymbolIdx(this->pilot_symbols_, symbol_number);
+  return GetSymbolIdx('P', symbol_number);
 }
 
 size_t FrameStats::GetDLCalSymbolIdx(size_t symbol_number) const {
-  return FrameStats::GetSymbolIdx(this->dl_cal_symbols_, symbol_number);
+  return GetSymbolIdx('C', symbol_number);
 }
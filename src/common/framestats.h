@@ -104,9 +104,12 @@ class FrameStats {
   size_t client_ul_data_symbols_;
   size_t client_dl_data_symbols_;
 
-  /* Helper function */
-  static size_t GetSymbolIdx(const std::vector<size_t>& search_vector,
-                             size_t symbol_number);
+  /* Index of each symbol among the symbols of its type, SIZE_MAX for guard
+   * symbols. Built once, so the Get*SymbolIdx lookups are O(1). */
+  std::vector<size_t> symbol_idx_;
+
+  /* Returns SIZE_MAX if symbol number is not of this type */
+  size_t GetSymbolIdx(char symbol_type, size_t symbol_number) const;
 }; /* class FrameStats */
 
 #endif /* FRAMESTATS_H_ */
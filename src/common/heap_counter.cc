@@ -0,0 +1,60 @@
+/**
+ * @file heap_counter.cc
+ * @brief Implementation file for the per-thread heap allocation count. The
+ * allocation functions of glibc are replaced by ones that count the call and
+ * forward it to glibc's own implementation.
+ */
+#include "heap_counter.h"
+
+#include <cerrno>
+
+#if defined(COUNT_HEAP_ALLOCS)
+// Static TLS of the executable, which itself never allocates
+static __thread size_t thread_heap_allocs = 0;
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+  thread_heap_allocs++;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  thread_heap_allocs++;
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  thread_heap_allocs++;
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  thread_heap_allocs++;
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  thread_heap_allocs++;
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  thread_heap_allocs++;
+  void* mem = __libc_memalign(alignment, size);
+  if (mem == nullptr) {
+    return ENOMEM;
+  }
+  *ptr = mem;
+  return 0;
+}
+}  // extern "C"
+
+size_t HeapCounter::ThreadAllocs() { return thread_heap_allocs; }
+#else
+size_t HeapCounter::ThreadAllocs() { return 0; }
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file heap_counter.h
+ * @brief Declaration file for the per-thread heap allocation count, enabled
+ * with -DCOUNT_HEAP_ALLOCS=ON.
+ */
+#ifndef HEAP_COUNTER_H_
+#define HEAP_COUNTER_H_
+
+#include <cstddef>
+
+namespace HeapCounter {
+
+#if defined(COUNT_HEAP_ALLOCS)
+static constexpr bool kEnabled = true;
+#else
+static constexpr bool kEnabled = false;
+#endif
+
+/// Number of malloc, calloc, realloc and aligned allocation calls made by the
+/// calling thread, including those of operator new and Armadillo. Always 0
+/// unless kEnabled.
+size_t ThreadAllocs();
+
+}  // namespace HeapCounter
+
+#endif  // HEAP_COUNTER_H_
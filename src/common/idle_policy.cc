@@ -0,0 +1,101 @@
+/**
+ * @file idle_policy.cc
+ * @brief Implementation file for the IdlePolicy class
+ */
+#include "idle_policy.h"
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#include <algorithm>
+
+#include "config.h"
+#include "logger.h"
+
+#if defined(__WAITPKG__)
+// CPUID.(EAX=7,ECX=0):ECX[bit 5]
+static bool CpuHasWaitpkg() {
+  unsigned int eax = 0;
+  unsigned int ebx = 0;
+  unsigned int ecx = 0;
+  unsigned int edx = 0;
+  return (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) != 0) &&
+         ((ecx & (1u << 5)) != 0);
+}
+#endif
+
+IdlePolicy::IdlePolicy(const Config* cfg)
+    : freq_ghz_(cfg->FreqGhz()),
+      spin_cycles_(GetTime::UsToCycles(cfg->IdleSpinUs(), freq_ghz_)),
+      pause_cycles_(GetTime::UsToCycles(cfg->IdlePauseUs(), freq_ghz_)),
+      sleep_cycles_(GetTime::UsToCycles(cfg->IdleSleepUs(), freq_ghz_)),
+#if defined(__WAITPKG__)
+      tpause_(CpuHasWaitpkg()),
+#else
+      tpause_(false),
+#endif
+      start_tsc_(GetTime::Rdtsc()) {}
+
+void IdlePolicy::Wait() {
+  const size_t now = GetTime::Rdtsc();
+  if (idle_since_tsc_ == 0) {
+    idle_since_tsc_ = now;
+    return;
+  }
+  const size_t idle = now - idle_since_tsc_;
+  if (idle < spin_cycles_) {
+    return;
+  }
+  if (idle < pause_cycles_) {
+    _mm_pause();
+    pause_cycles_spent_ += GetTime::Rdtsc() - now;
+    return;
+  }
+
+  // The OS may cap a TPAUSE (IA32_UMWAIT_CONTROL) or an interrupt may end
+  // it early, which the next poll handles like any other wake-up
+  const size_t deadline = now + sleep_cycles_;
+#if defined(__WAITPKG__)
+  if (tpause_) {
+    // 0 requests C0.2, the deeper of the two light states
+    _tpause(0, deadline);
+  }
+#endif
+  if (tpause_ == false) {
+    while (GetTime::Rdtsc() < deadline) {
+      _mm_pause();
+    }
+  }
+  const size_t end = GetTime::Rdtsc();
+  sleep_cycles_spent_ += end - now;
+  num_sleeps_++;
+  if (end > deadline) {
+    wake_cycles_sum_ += end - deadline;
+    wake_cycles_max_ = std::max(wake_cycles_max_, end - deadline);
+  }
+}
+
+void IdlePolicy::PrintSummary(const std::string& name) const {
+  if (Enabled() == false) {
+    return;
+  }
+  const size_t now = GetTime::Rdtsc();
+  const size_t idle_cycles =
+      idle_cycles_ + ((idle_since_tsc_ != 0) ? now - idle_since_tsc_ : 0);
+  const double total = static_cast<double>(std::max<size_t>(
+      now - start_tsc_, 1));
+  const size_t spin_cycles =
+      idle_cycles -
+      std::min(idle_cycles, pause_cycles_spent_ + sleep_cycles_spent_);
+  AGORA_LOG_INFO(
+      "%s: idle %.1f%% of the time, %.1f%% spinning, %.1f%% in PAUSE, "
+      "%.1f%% in %s. %zu waits, wake-up latency mean %.2f us, max %.2f "
+      "us\n",
+      name.c_str(), 100.0 * idle_cycles / total, 100.0 * spin_cycles / total,
+      100.0 * pause_cycles_spent_ / total, 100.0 * sleep_cycles_spent_ / total,
+      tpause_ ? "C0.2 (TPAUSE)" : "timed PAUSE", num_sleeps_,
+      (num_sleeps_ > 0) ? GetTime::CyclesToUs(wake_cycles_sum_, freq_ghz_) /
+                              num_sleeps_
+                        : 0.0,
+      GetTime::CyclesToUs(wake_cycles_max_, freq_ghz_));
+}
@@ -0,0 +1,76 @@
+/**
+ * @file idle_policy.h
+ * @brief Declaration file for the IdlePolicy class, which backs off the
+ * polling loop of a thread that finds no work
+ */
+#ifndef IDLE_POLICY_H_
+#define IDLE_POLICY_H_
+
+#include <cstddef>
+#include <string>
+
+#include "gettime.h"
+
+class Config;
+
+/**
+ * @brief The idle policy of one polling thread, set by the "idle_spin_us",
+ * "idle_pause_us" and "idle_sleep_us" keys.
+ *
+ * Call Busy() after each poll that found work and Idle() after each poll
+ * that found none. For the first idle_spin_us of an idle period Idle()
+ * returns at once; until idle_pause_us it executes a PAUSE; after that it
+ * waits in the C0.2 power state with TPAUSE (or PAUSEs where the CPU has no
+ * WAITPKG) for at most idle_sleep_us, which bounds the wake-up latency the
+ * policy adds. With idle_sleep_us 0 the thread busy-polls as before.
+ *
+ * Not thread safe: one object per thread.
+ */
+class IdlePolicy {
+ public:
+  explicit IdlePolicy(const Config* cfg);
+
+  inline bool Enabled() const { return sleep_cycles_ > 0; }
+
+  /// After a poll that found work
+  inline void Busy() {
+    if (idle_since_tsc_ != 0) {
+      idle_cycles_ += GetTime::Rdtsc() - idle_since_tsc_;
+      idle_since_tsc_ = 0;
+    }
+  }
+
+  /// After a poll that found no work
+  inline void Idle() {
+    if (Enabled()) {
+      Wait();
+    }
+  }
+
+  /// Log the share of the time spent in each idle phase and the wake-up
+  /// latency of the waits, as thread name
+  void PrintSummary(const std::string& name) const;
+
+ private:
+  void Wait();
+
+  const double freq_ghz_;
+  const size_t spin_cycles_;
+  const size_t pause_cycles_;
+  const size_t sleep_cycles_;
+  // TPAUSE is both built in and supported by the CPU
+  const bool tpause_;
+  const size_t start_tsc_;
+
+  // Start of the current idle period, 0 while busy
+  size_t idle_since_tsc_ = 0;
+  size_t idle_cycles_ = 0;
+  size_t pause_cycles_spent_ = 0;
+  size_t sleep_cycles_spent_ = 0;
+  size_t num_sleeps_ = 0;
+  // Cycles from the end of a wait's deadline until the thread ran again
+  size_t wake_cycles_sum_ = 0;
+  size_t wake_cycles_max_ = 0;
+};
+
+#endif  // IDLE_POLICY_H_
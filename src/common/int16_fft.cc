@@ -0,0 +1,221 @@
+/**
+ * @file int16_fft.cc
+ * @brief Implementation file for the fixed-point FFT of int16 IQ samples.
+ */
+#include "int16_fft.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "memory_manage.h"
+#include "utils.h"
+
+// Largest input magnitude of a stage whose outputs fit in int16: the real
+// and imaginary parts of a + w * b are at most (1 + sqrt(2)) times the
+// largest magnitude of a and b, with some room for the rounding
+static constexpr uint16_t kStageMaxInput = 13500;
+// Largest number of halvings before a stage, from 32768 to under
+// kStageMaxInput
+static constexpr size_t kMaxShift = 2;
+
+#if defined(__AVX512BW__)
+// int16 values per 512-bit register
+static constexpr size_t kValuesPerSimd = 32;
+#endif
+
+// (a * b) / 2^15, rounded, as VPMULHRSW
+static inline int16_t MulQ15(int16_t a, int16_t b) {
+  return static_cast<int16_t>(
+      ((static_cast<int32_t>(a) * static_cast<int32_t>(b)) + 0x4000) >> 15);
+}
+
+static inline uint16_t Magnitude(int32_t value) {
+  return static_cast<uint16_t>(std::abs(value));
+}
+
+Int16Fft::Int16Fft(size_t fft_size) : fft_size_(fft_size) {
+  RtAssert((fft_size_ >= kMinSize) && ((fft_size_ & (fft_size_ - 1)) == 0),
+           "Int16Fft: size must be a power of two of at least " +
+               std::to_string(kMinSize));
+  size_t log_size = 0;
+  while ((size_t{1} << log_size) < fft_size_) {
+    log_size++;
+  }
+  bit_reverse_.resize(fft_size_);
+  for (size_t i = 0; i < fft_size_; i++) {
+    uint32_t reversed = 0;
+    for (size_t bit = 0; bit < log_size; bit++) {
+      reversed |= ((i >> bit) & 1) << (log_size - 1 - bit);
+    }
+    bit_reverse_.at(i) = reversed;
+  }
+
+  const size_t bytes = fft_size_ * sizeof(int16_t);
+  twiddle_re_ = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, bytes));
+  twiddle_im_ = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, bytes));
+  re_ = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, bytes));
+  im_ = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, bytes));
+  // exp(-2 pi i j / (2 * half)), the forward twiddles of each stage
+  twiddle_re_[0] = 0;
+  twiddle_im_[0] = 0;
+  for (size_t half = 1; half < fft_size_; half *= 2) {
+    for (size_t j = 0; j < half; j++) {
+      const double angle = -M_PI * static_cast<double>(j) / half;
+      twiddle_re_[half + j] =
+          static_cast<int16_t>(std::lrint(std::cos(angle) * INT16_MAX));
+      twiddle_im_[half + j] =
+          static_cast<int16_t>(std::lrint(std::sin(angle) * INT16_MAX));
+    }
+  }
+}
+
+Int16Fft::~Int16Fft() {
+  Agora_memory::PaddedAlignedFree(twiddle_re_);
+  Agora_memory::PaddedAlignedFree(twiddle_im_);
+  Agora_memory::PaddedAlignedFree(re_);
+  Agora_memory::PaddedAlignedFree(im_);
+}
+
+void Int16Fft::Forward(const short* in) {
+  uint16_t max_magnitude = 0;
+  for (size_t i = 0; i < 2 * fft_size_; i++) {
+    max_magnitude = std::max(max_magnitude, Magnitude(in[i]));
+  }
+  // Small samples are scaled up to the headroom of the first stage, so that
+  // the rounding of the butterflies does not eat their precision
+  size_t up_shift = 0;
+  if (max_magnitude > 0) {
+    while ((static_cast<size_t>(max_magnitude) << (up_shift + 1)) <=
+           kStageMaxInput) {
+      up_shift++;
+    }
+  }
+  for (size_t i = 0; i < fft_size_; i++) {
+    const size_t src = bit_reverse_[i];
+    re_[i] = static_cast<int16_t>(in[2 * src] * (1 << up_shift));
+    im_[i] = static_cast<int16_t>(in[(2 * src) + 1] * (1 << up_shift));
+  }
+  max_magnitude = static_cast<uint16_t>(max_magnitude << up_shift);
+
+  exponent_ = -static_cast<int>(up_shift);
+  for (size_t half = 1; half < fft_size_; half *= 2) {
+    size_t shift = 0;
+    while (max_magnitude > kStageMaxInput) {
+      max_magnitude = (max_magnitude + 1) / 2;
+      shift++;
+    }
+    exponent_ += static_cast<int>(shift);
+    max_magnitude = Stage(half, shift);
+  }
+}
+
+uint16_t Int16Fft::Stage(size_t half, size_t shift) {
+  // 2^-shift in Q15, unused without a shift
+  const auto scale =
+      static_cast<int16_t>(1 << (15 - std::min(std::max(shift, size_t{1}),
+                                               kMaxShift)));
+  const int16_t* w_re = &twiddle_re_[half];
+  const int16_t* w_im = &twiddle_im_[half];
+  uint16_t max_magnitude = 0;
+
+#if defined(__AVX512BW__)
+  if (half >= kValuesPerSimd) {
+    const __m512i scale_v = _mm512_set1_epi16(scale);
+    __m512i max_v = _mm512_setzero_si512();
+    for (size_t base = 0; base < fft_size_; base += 2 * half) {
+      int16_t* a_re = &re_[base];
+      int16_t* a_im = &im_[base];
+      int16_t* b_re = &re_[base + half];
+      int16_t* b_im = &im_[base + half];
+      for (size_t j = 0; j < half; j += kValuesPerSimd) {
+        __m512i ar = _mm512_load_si512(&a_re[j]);
+        __m512i ai = _mm512_load_si512(&a_im[j]);
+        __m512i br = _mm512_load_si512(&b_re[j]);
+        __m512i bi = _mm512_load_si512(&b_im[j]);
+        if (shift > 0) {
+          ar = _mm512_mulhrs_epi16(ar, scale_v);
+          ai = _mm512_mulhrs_epi16(ai, scale_v);
+          br = _mm512_mulhrs_epi16(br, scale_v);
+          bi = _mm512_mulhrs_epi16(bi, scale_v);
+        }
+        const __m512i wr = _mm512_load_si512(&w_re[j]);
+        const __m512i wi = _mm512_load_si512(&w_im[j]);
+        const __m512i tr = _mm512_sub_epi16(_mm512_mulhrs_epi16(br, wr),
+                                            _mm512_mulhrs_epi16(bi, wi));
+        const __m512i ti = _mm512_add_epi16(_mm512_mulhrs_epi16(br, wi),
+                                            _mm512_mulhrs_epi16(bi, wr));
+        const __m512i x0r = _mm512_adds_epi16(ar, tr);
+        const __m512i x0i = _mm512_adds_epi16(ai, ti);
+        const __m512i x1r = _mm512_subs_epi16(ar, tr);
+        const __m512i x1i = _mm512_subs_epi16(ai, ti);
+        _mm512_store_si512(&a_re[j], x0r);
+        _mm512_store_si512(&a_im[j], x0i);
+        _mm512_store_si512(&b_re[j], x1r);
+        _mm512_store_si512(&b_im[j], x1i);
+        // The magnitude of -32768 is 32768 as unsigned
+        max_v = _mm512_max_epu16(max_v, _mm512_abs_epi16(x0r));
+        max_v = _mm512_max_epu16(max_v, _mm512_abs_epi16(x0i));
+        max_v = _mm512_max_epu16(max_v, _mm512_abs_epi16(x1r));
+        max_v = _mm512_max_epu16(max_v, _mm512_abs_epi16(x1i));
+      }
+    }
+    alignas(64) uint16_t lanes[kValuesPerSimd];
+    _mm512_store_si512(lanes, max_v);
+    return *std::max_element(lanes, lanes + kValuesPerSimd);
+  }
+#endif
+
+  for (size_t base = 0; base < fft_size_; base += 2 * half) {
+    int16_t* a_re = &re_[base];
+    int16_t* a_im = &im_[base];
+    int16_t* b_re = &re_[base + half];
+    int16_t* b_im = &im_[base + half];
+    for (size_t j = 0; j < half; j++) {
+      int16_t ar = a_re[j];
+      int16_t ai = a_im[j];
+      int16_t br = b_re[j];
+      int16_t bi = b_im[j];
+      if (shift > 0) {
+        ar = MulQ15(ar, scale);
+        ai = MulQ15(ai, scale);
+        br = MulQ15(br, scale);
+        bi = MulQ15(bi, scale);
+      }
+      const int32_t tr = MulQ15(br, w_re[j]) - MulQ15(bi, w_im[j]);
+      const int32_t ti = MulQ15(br, w_im[j]) + MulQ15(bi, w_re[j]);
+      a_re[j] = static_cast<int16_t>(ar + tr);
+      a_im[j] = static_cast<int16_t>(ai + ti);
+      b_re[j] = static_cast<int16_t>(ar - tr);
+      b_im[j] = static_cast<int16_t>(ai - ti);
+      max_magnitude = std::max(
+          {max_magnitude, Magnitude(a_re[j]), Magnitude(a_im[j]),
+           Magnitude(b_re[j]), Magnitude(b_im[j])});
+    }
+  }
+  return max_magnitude;
+}
+
+void Int16Fft::ToFloatShifted(complex_float* out, size_t first,
+                              size_t count) const {
+  // The output of SimdConvertShortToFloat() is the int16 input / 2^15
+  const float scale = std::ldexp(1.0f, exponent_ - 15);
+  const size_t half = fft_size_ / 2;
+  const size_t end = first + count;
+  // Shifted position i holds bin i + half below half, and bin i - half above
+  const size_t split = std::min(end, std::max(first, half));
+  for (size_t i = first; i < split; i++) {
+    out[i].re = re_[i + half] * scale;
+    out[i].im = im_[i + half] * scale;
+  }
+  for (size_t i = split; i < end; i++) {
+    out[i].re = re_[i - half] * scale;
+    out[i].im = im_[i - half] * scale;
+  }
+}
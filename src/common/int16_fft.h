@@ -0,0 +1,67 @@
+/**
+ * @file int16_fft.h
+ * @brief Declaration file for the fixed-point FFT of int16 IQ samples, with
+ * block floating point scaling between its radix-2 stages.
+ */
+#ifndef INT16_FFT_H_
+#define INT16_FFT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common_typedef_sdk.h"
+
+/**
+ * @brief Forward transform of fft_size interleaved int16 IQ samples, computed
+ * on int16 real and imaginary planes with Q15 twiddles.
+ *
+ * The samples are first scaled up by a power of two to the headroom of the
+ * butterflies, and before each stage whose butterflies could overflow int16
+ * the whole block is halved and its exponent incremented, so the output is
+ * the int16 planes times 2^Exponent(). The working set is half the one of
+ * the float FFT of the same samples. A transform is used by one thread.
+ */
+class Int16Fft {
+ public:
+  /// Smallest fft_size, so that the stages of the SIMD path are whole
+  /// vectors
+  static constexpr size_t kMinSize = 64;
+
+  /// fft_size must be a power of two of at least kMinSize
+  explicit Int16Fft(size_t fft_size);
+  ~Int16Fft();
+  Int16Fft(const Int16Fft&) = delete;
+  Int16Fft& operator=(const Int16Fft&) = delete;
+
+  /// Transform the fft_size complex samples at in
+  void Forward(const short* in);
+
+  /// Write the bins [first, first + count) of the FFT-shifted output to
+  /// out[first, first + count), as floats scaled like the float FFT of the
+  /// samples converted by SimdConvertShortToFloat()
+  void ToFloatShifted(complex_float* out, size_t first, size_t count) const;
+
+  /// Block exponent of the last Forward()
+  inline int Exponent() const { return exponent_; }
+  inline const int16_t* Re() const { return re_; }
+  inline const int16_t* Im() const { return im_; }
+
+ private:
+  // One radix-2 stage of butterflies half entries apart, dividing the block
+  // by 2^shift first. Returns the largest magnitude of the output values.
+  uint16_t Stage(size_t half, size_t shift);
+
+  const size_t fft_size_;
+  // Input index of each output position of the bit-reversed load
+  std::vector<uint32_t> bit_reverse_;
+  // Q15 twiddles of the stage with butterflies half entries apart at
+  // [half, 2 * half), so that those of the SIMD stages are aligned
+  int16_t* twiddle_re_;
+  int16_t* twiddle_im_;
+  int16_t* re_;
+  int16_t* im_;
+  int exponent_ = 0;
+};
+
+#endif  // INT16_FFT_H_
@@ -0,0 +1,221 @@
+/**
+ * @file dpdk_comm.cc
+ * @brief Implementation file for the DpdkComm class
+ */
+#include "dpdk_comm.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "config.h"
+#include "logger.h"
+
+// Packets per rte_eth_tx_burst() call
+static constexpr size_t kTxBurstSize = 32;
+
+namespace {
+struct PortState {
+  uint16_t port_id_;
+  // Queue pairs of the port, and the next one to give to a link
+  size_t num_queues_;
+  size_t next_queue_;
+};
+}  // namespace
+
+static std::mutex ports_mutex;
+static std::vector<PortState> ports;
+static rte_mempool* mbuf_pool = nullptr;
+
+void DpdkComm::InitPorts(const Config* cfg, size_t core_offset,
+                         size_t num_threads,
+                         const std::vector<size_t>& link_counts) {
+  std::scoped_lock lock(ports_mutex);
+  RtAssert(ports.empty(), "DpdkComm: the ports are already initialized");
+  RtAssert(link_counts.size() <= cfg->DpdkNumPorts(),
+           "DpdkComm: too few DPDK ports (dpdk_num_ports) for the links");
+  const size_t pkt_len =
+      std::max(cfg->AggregatePacketLength(), cfg->DlPacketLength());
+  RtAssert(pkt_len <= kJumboFrameMaxSize,
+           "DpdkComm: the packets are longer than a jumbo frame");
+
+  DpdkTransport::DpdkInit(core_offset, num_threads);
+  RtAssert((cfg->DpdkNumPorts() + cfg->DpdkPortOffset()) <=
+               rte_eth_dev_count_avail(),
+           "DpdkComm: too few eth devices available compared to the requested "
+           "number (dpdk_num_ports)");
+  std::vector<uint16_t> port_ids;
+  if (cfg->DpdkMacAddrs().length() > 0) {
+    port_ids = DpdkTransport::GetPortIDFromMacAddr(cfg->DpdkNumPorts(),
+                                                   cfg->DpdkMacAddrs());
+  } else {
+    for (uint16_t i = 0; i < cfg->DpdkNumPorts(); i++) {
+      port_ids.push_back(i + cfg->DpdkPortOffset());
+    }
+  }
+
+  // Each queue pair keeps its rings full of mbufs
+  const size_t total_links =
+      std::accumulate(link_counts.begin(), link_counts.end(), size_t{0});
+  const size_t pool_mbufs = total_links * (kRxRingSize + kTxRingSize);
+  mbuf_pool = DpdkTransport::CreateMempool(
+      std::max<size_t>((pool_mbufs + kNumMBufs - 1) / kNumMBufs, 1), pkt_len);
+
+  for (size_t i = 0; i < link_counts.size(); i++) {
+    const uint16_t port_id = port_ids.at(i);
+    ports.push_back(PortState{port_id, link_counts.at(i), 0});
+    if (link_counts.at(i) == 0) {
+      continue;
+    }
+    const int init_status = DpdkTransport::NicInit(
+        port_id, mbuf_pool, static_cast<int>(link_counts.at(i)), pkt_len);
+    if (init_status != 0) {
+      rte_exit(EXIT_FAILURE, "Cannot init nic with id %u\n", port_id);
+    }
+    if (cfg->DpdkDropUnmatched()) {
+      DpdkTransport::InstallFlowRuleDropAll(port_id);
+    }
+    AGORA_LOG_INFO("DpdkComm: dev %u with %zu links, packets of %zu bytes\n",
+                   port_id, link_counts.at(i), pkt_len);
+  }
+}
+
+void DpdkComm::ClosePorts() {
+  std::scoped_lock lock(ports_mutex);
+  for (const auto& port : ports) {
+    if (port.num_queues_ == 0) {
+      continue;
+    }
+    rte_flow_error flow_error;
+    if (rte_flow_flush(port.port_id_, &flow_error) != 0) {
+      AGORA_LOG_ERROR(
+          "Flow cannot be flushed %d message: %s\n", flow_error.type,
+          flow_error.message ? flow_error.message : "(no stated reason)");
+    }
+    int ret_status = rte_eth_dev_stop(port.port_id_);
+    if (ret_status < 0) {
+      AGORA_LOG_ERROR("Failed to stop port %u: %s", port.port_id_,
+                      rte_strerror(-ret_status));
+    }
+    ret_status = rte_eth_dev_close(port.port_id_);
+    if (ret_status < 0) {
+      AGORA_LOG_ERROR("Failed to close device %u: %s", port.port_id_,
+                      rte_strerror(-ret_status));
+    }
+  }
+  ports.clear();
+  if (mbuf_pool != nullptr) {
+    rte_mempool_free(mbuf_pool);
+    mbuf_pool = nullptr;
+    rte_eal_cleanup();
+  }
+}
+
+DpdkComm::DpdkComm(size_t port_idx, const std::string& local_addr,
+                   uint16_t local_port, const std::string& remote_addr,
+                   uint16_t remote_port)
+    : local_port_(local_port), remote_port_(remote_port), rx_pkts_() {
+  int ret = inet_pton(AF_INET, local_addr.c_str(), &local_ip_);
+  RtAssert(ret == 1, "DpdkComm: invalid local IP address");
+  ret = inet_pton(AF_INET, remote_addr.c_str(), &remote_ip_);
+  RtAssert(ret == 1, "DpdkComm: invalid remote IP address");
+  {
+    std::scoped_lock lock(ports_mutex);
+    RtAssert(port_idx < ports.size(), "DpdkComm: the port is not initialized");
+    PortState& port = ports.at(port_idx);
+    RtAssert(port.next_queue_ < port.num_queues_,
+             "DpdkComm: no queue left on the port for the link");
+    port_id_ = port.port_id_;
+    queue_id_ = static_cast<uint16_t>(port.next_queue_);
+    port.next_queue_++;
+  }
+  ret = rte_eth_macaddr_get(port_id_, &src_mac_);
+  RtAssert(ret == 0, "DpdkComm: could not retrieve the mac address");
+  dest_mac_ = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+  DpdkTransport::InstallFlowRule(port_id_, queue_id_, remote_ip_, local_ip_,
+                                 remote_port_, local_port_);
+  AGORA_LOG_INFO(
+      "DpdkComm: %s:%u to %s:%u on DPDK dev %u queue %u\n", local_addr.c_str(),
+      local_port_, remote_addr.c_str(), remote_port_, port_id_, queue_id_);
+}
+
+DpdkComm::~DpdkComm() {
+  for (size_t i = rx_head_; i < rx_tail_; i++) {
+    rte_pktmbuf_free(rx_pkts_.at(i));
+  }
+}
+
+void DpdkComm::Send(const std::byte* msg, size_t len) {
+  SendBatch(&msg, &len, 1);
+}
+
+void DpdkComm::SendBatch(const std::byte* const* msgs, const size_t* lens,
+                         size_t num_msgs) {
+  std::array<rte_mbuf*, kTxBurstSize> tx_pkts;
+  std::scoped_lock lock(tx_mutex_);
+  for (size_t msg_id = 0; msg_id < num_msgs; msg_id += kTxBurstSize) {
+    const size_t burst = std::min(kTxBurstSize, num_msgs - msg_id);
+    for (size_t i = 0; i < burst; i++) {
+      const size_t len = lens[msg_id + i];
+      tx_pkts.at(i) = DpdkTransport::AllocUdp(
+          mbuf_pool, src_mac_, dest_mac_, local_ip_, remote_ip_, local_port_,
+          remote_port_, len, tx_pkt_id_++);
+      std::memcpy(rte_pktmbuf_mtod_offset(tx_pkts.at(i), void*, kPayloadOffset),
+                  msgs[msg_id + i], len);
+    }
+    const size_t sent = rte_eth_tx_burst(port_id_, queue_id_, tx_pkts.data(),
+                                         static_cast<uint16_t>(burst));
+    if (sent < burst) {
+      rte_pktmbuf_free_bulk(&tx_pkts.at(sent), burst - sent);
+      tx_drops_ += burst - sent;
+    }
+  }
+}
+
+size_t DpdkComm::CopyPayload(rte_mbuf* pkt, std::byte* buf, size_t len) {
+  // The UDP length, as a short frame carries the padding of the ethernet
+  // minimum
+  const auto* udp_h = rte_pktmbuf_mtod_offset(
+      pkt, const rte_udp_hdr*, sizeof(rte_ether_hdr) + sizeof(rte_ipv4_hdr));
+  const size_t payload_len =
+      std::min(static_cast<size_t>(rte_be_to_cpu_16(udp_h->dgram_len)) -
+                   sizeof(rte_udp_hdr),
+               len);
+  std::memcpy(buf, rte_pktmbuf_mtod_offset(pkt, const void*, kPayloadOffset),
+              payload_len);
+  rte_pktmbuf_free(pkt);
+  return payload_len;
+}
+
+bool DpdkComm::Refill() const {
+  rx_head_ = 0;
+  rx_tail_ = rte_eth_rx_burst(port_id_, queue_id_, rx_pkts_.data(),
+                              static_cast<uint16_t>(kRxBatchSize));
+  return rx_tail_ > 0;
+}
+
+ssize_t DpdkComm::Recv(std::byte* buf, size_t len) const {
+  if ((rx_head_ == rx_tail_) && (Refill() == false)) {
+    return 0;
+  }
+  const size_t rx_bytes = CopyPayload(rx_pkts_.at(rx_head_), buf, len);
+  rx_head_++;
+  return static_cast<ssize_t>(rx_bytes);
+}
+
+ssize_t DpdkComm::RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                            size_t num_bufs) const {
+  size_t num_rx = 0;
+  while (num_rx < num_bufs) {
+    if ((rx_head_ == rx_tail_) && (Refill() == false)) {
+      break;
+    }
+    lens[num_rx] = CopyPayload(rx_pkts_.at(rx_head_), bufs[num_rx], len);
+    rx_head_++;
+    num_rx++;
+  }
+  return static_cast<ssize_t>(num_rx);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file dpdk_comm.h
+ * @brief Declaration file for the DpdkComm class, a packet link between the
+ * simulator processes over a queue pair of a DPDK port
+ */
+#ifndef DPDK_COMM_H_
+#define DPDK_COMM_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dpdk_transport.h"
+#include "packet_comm.h"
+
+class Config;
+
+/**
+ * @brief A connected link like a UDPComm from local_addr:local_port to
+ * remote_addr:remote_port, but the UDP packets are sent and received by a
+ * DPDK port, bypassing the kernel.
+ *
+ * Each link owns one rx / tx queue pair of its port, and a flow rule steers
+ * the packets of the remote endpoint to its rx queue. Packets are sent to the
+ * broadcast MAC address, as TxRxWorkerDpdk does. The sending threads of a
+ * link are serialized, so a link can be shared like a socket. A packet that
+ * the NIC does not take is dropped, as UDP would.
+ */
+class DpdkComm : public PacketComm {
+ public:
+  /**
+   * @brief Init the EAL on cores [core_offset, core_offset + num_threads],
+   * and the first link_counts.size() DPDK ports of the config, with
+   * link_counts[i] queue pairs on port i. Once per process, before the links
+   * are created.
+   */
+  static void InitPorts(const Config* cfg, size_t core_offset,
+                        size_t num_threads,
+                        const std::vector<size_t>& link_counts);
+  /// Stop the ports of InitPorts(), once the links are destroyed
+  static void ClosePorts();
+
+  /**
+   * @param port_idx The port of InitPorts() to use, which has a queue pair
+   * left
+   * @param local_addr The IPv4 address this side would bind
+   * @param local_port The port this side would bind
+   * @param remote_addr The IPv4 address of the other side
+   * @param remote_port The port of the other side
+   */
+  DpdkComm(size_t port_idx, const std::string& local_addr, uint16_t local_port,
+           const std::string& remote_addr, uint16_t remote_port);
+  ~DpdkComm() override;
+
+  DpdkComm(const DpdkComm&) = delete;
+  DpdkComm& operator=(const DpdkComm&) = delete;
+
+  void Send(const std::byte* msg, size_t len) override;
+  void SendBatch(const std::byte* const* msgs, const size_t* lens,
+                 size_t num_msgs) override;
+  ssize_t Recv(std::byte* buf, size_t len) const override;
+  ssize_t RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                    size_t num_bufs) const override;
+
+  /// Packets dropped because the NIC tx queue was full
+  inline size_t TxDrops() const { return tx_drops_; }
+
+ private:
+  // Copy the payload of pkt to buf, up to len bytes, and free pkt. Returns
+  // the number of bytes copied.
+  static size_t CopyPayload(rte_mbuf* pkt, std::byte* buf, size_t len);
+  // Refill the received packets from the rx queue. Returns false if there
+  // are none.
+  bool Refill() const;
+
+  uint16_t port_id_;
+  uint16_t queue_id_;
+  uint32_t local_ip_;
+  uint32_t remote_ip_;
+  uint16_t local_port_;
+  uint16_t remote_port_;
+  rte_ether_addr src_mac_;
+  rte_ether_addr dest_mac_;
+
+  // Packets of the last rx burst that are not returned yet. Some drivers
+  // need a burst of at least 4 packets, so Recv() takes them one by one.
+  mutable std::array<rte_mbuf*, kRxBatchSize> rx_pkts_;
+  mutable size_t rx_head_ = 0;
+  mutable size_t rx_tail_ = 0;
+
+  std::mutex tx_mutex_;
+  uint16_t tx_pkt_id_ = 0;
+  size_t tx_drops_ = 0;
+};
+
+#endif  // DPDK_COMM_H_
@@ -0,0 +1,49 @@
+/**
+ * @file packet_comm.h
+ * @brief Declaration file for the PacketComm interface, a connected
+ * point-to-point packet link between two endpoints
+ */
+#ifndef PACKET_COMM_H_
+#define PACKET_COMM_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+// The connected half of UDPComm, so that the simulators can exchange packets
+// over UDP or shared memory
+class PacketComm {
+ public:
+  virtual ~PacketComm() = default;
+
+  /// Send one packet to the connected endpoint
+  virtual void Send(const std::byte* msg, size_t len) = 0;
+
+  /// Send num_msgs packets to the connected endpoint
+  virtual void SendBatch(const std::byte* const* msgs, const size_t* lens,
+                         size_t num_msgs) = 0;
+
+  /**
+   * @brief Try to receive one packet of up to len bytes in buf, without
+   * blocking
+   *
+   * @return The number of bytes received, zero if there is no packet, -1 on
+   * error
+   */
+  virtual ssize_t Recv(std::byte* buf, size_t len) const = 0;
+
+  /**
+   * @brief Try to receive up to num_bufs packets of up to len bytes each,
+   * without blocking
+   *
+   * @param bufs Buffers of len bytes, one per packet
+   * @param lens Filled with the number of bytes received in each buffer
+   * @param num_bufs Number of buffers
+   * @return The number of packets received, zero if there are none, -1 on
+   * error
+   */
+  virtual ssize_t RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                            size_t num_bufs) const = 0;
+};
+
+#endif  // PACKET_COMM_H_
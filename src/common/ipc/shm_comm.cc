@@ -0,0 +1,239 @@
+/**
+ * @file shm_comm.cc
+ * @brief Implementation file for the ShmComm class
+ */
+#include "shm_comm.h"
+
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include "config.h"
+#include "logger.h"
+#include "udp_comm.h"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "ShmComm needs lock-free atomics to share memory");
+
+static const std::string kHugepageDir = "/dev/hugepages/";
+static const std::string kShmDir = "/dev/shm/";
+// Smallest hugepage, which a hugetlbfs file size must be a multiple of
+static constexpr size_t kHugepageBytes = 2 * 1024 * 1024;
+// Each slot starts with the packet length, padded to a cache line
+static constexpr size_t kSlotHeaderBytes = 64;
+
+struct ShmComm::Ring {
+  alignas(64) std::atomic<uint64_t> head_;  // Next slot to pop
+  alignas(64) std::atomic<uint64_t> tail_;  // Next slot to push
+  alignas(64) uint64_t num_slots_;
+  uint64_t slot_bytes_;
+};
+
+static std::string RingName(uint16_t from_port, uint16_t to_port) {
+  return "agora_link_" + std::to_string(from_port) + "_" +
+         std::to_string(to_port);
+}
+
+std::byte* ShmComm::Slot(Ring* ring, uint64_t index) {
+  return reinterpret_cast<std::byte*>(ring + 1) +
+         ((index & (ring->num_slots_ - 1)) *
+          (kSlotHeaderBytes + ring->slot_bytes_));
+}
+
+static bool IsHugetlbfs(const std::string& dir) {
+  struct statfs fs;
+  return (::statfs(dir.c_str(), &fs) == 0) && (fs.f_type == HUGETLBFS_MAGIC);
+}
+
+// Create the file at path with bytes, mapped at *mem. Returns false on
+// failure, leaving no file behind.
+static bool CreateFile(const std::string& path, size_t bytes, void** mem) {
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  *mem = MAP_FAILED;
+  if (::ftruncate(fd, bytes) == 0) {
+    *mem = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (*mem == MAP_FAILED) {
+    ::unlink(path.c_str());
+    return false;
+  }
+  return true;
+}
+
+ShmComm::ShmComm(uint16_t local_port, uint16_t remote_port, size_t slot_bytes,
+                 size_t num_slots, bool use_hugepage)
+    : slot_bytes_(slot_bytes), tx_name_(RingName(local_port, remote_port)) {
+  size_t slots = 1;
+  while (slots < num_slots) {
+    slots *= 2;
+  }
+  const std::string rx_name = RingName(remote_port, local_port);
+  const size_t bytes =
+      sizeof(Ring) + (slots * (kSlotHeaderBytes + slot_bytes_));
+  // A ring left by an earlier run that did not exit cleanly
+  ::unlink((kHugepageDir + rx_name).c_str());
+  ::unlink((kShmDir + rx_name).c_str());
+
+  // The ring is set up under a temporary name, so that the other side never
+  // maps a ring that is not initialized
+  const std::string tmp_suffix = ".tmp" + std::to_string(::getpid());
+  void* mem = nullptr;
+  bool created = false;
+  if (use_hugepage && IsHugetlbfs(kHugepageDir)) {
+    rx_map_bytes_ =
+        ((bytes + kHugepageBytes - 1) / kHugepageBytes) * kHugepageBytes;
+    rx_path_ = kHugepageDir + rx_name;
+    created = CreateFile(rx_path_ + tmp_suffix, rx_map_bytes_, &mem);
+  }
+  if (created == false) {
+    if (use_hugepage) {
+      AGORA_LOG_WARN("ShmComm: no hugepage for %s, using 4 KB pages\n",
+                     rx_name.c_str());
+    }
+    rx_map_bytes_ = bytes;
+    rx_path_ = kShmDir + rx_name;
+    created = CreateFile(rx_path_ + tmp_suffix, rx_map_bytes_, &mem);
+  }
+  if (created == false) {
+    throw std::runtime_error("ShmComm: failed to create the ring " + rx_name);
+  }
+  rx_ring_ = new (mem) Ring();
+  rx_ring_->head_.store(0);
+  rx_ring_->tail_.store(0);
+  rx_ring_->num_slots_ = slots;
+  rx_ring_->slot_bytes_ = slot_bytes_;
+  if (std::rename((rx_path_ + tmp_suffix).c_str(), rx_path_.c_str()) != 0) {
+    throw std::runtime_error("ShmComm: failed to publish the ring " +
+                             rx_name);
+  }
+  AGORA_LOG_INFO("ShmComm: receiving from port %u on %s, %zu slots\n",
+                 remote_port, rx_path_.c_str(), slots);
+}
+
+ShmComm::~ShmComm() {
+  ::unlink(rx_path_.c_str());
+  ::munmap(rx_ring_, rx_map_bytes_);
+  if (tx_ring_ != nullptr) {
+    ::munmap(tx_ring_, tx_map_bytes_);
+  }
+  if (tx_drops_ > 0) {
+    AGORA_LOG_INFO("ShmComm: dropped %zu packets to %s\n", tx_drops_,
+                   tx_name_.c_str());
+  }
+}
+
+ShmComm::Ring* ShmComm::MapRing(const std::string& path, size_t* map_bytes) {
+  const int fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  void* mem = MAP_FAILED;
+  if (::fstat(fd, &st) == 0) {
+    *map_bytes = st.st_size;
+    mem = ::mmap(nullptr, *map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  }
+  ::close(fd);
+  return (mem == MAP_FAILED) ? nullptr : static_cast<Ring*>(mem);
+}
+
+bool ShmComm::Push(const std::byte* msg, size_t len) {
+  if (tx_ring_ == nullptr) {
+    tx_ring_ = MapRing(kHugepageDir + tx_name_, &tx_map_bytes_);
+    if (tx_ring_ == nullptr) {
+      tx_ring_ = MapRing(kShmDir + tx_name_, &tx_map_bytes_);
+    }
+    if (tx_ring_ == nullptr) {
+      return false;
+    }
+    if (tx_ring_->slot_bytes_ != slot_bytes_) {
+      throw std::runtime_error("ShmComm: the two sides of " + tx_name_ +
+                               " disagree on the packet size");
+    }
+  }
+  if (len > slot_bytes_) {
+    throw std::runtime_error("ShmComm: packet larger than the ring slots");
+  }
+  const uint64_t tail = tx_ring_->tail_.load(std::memory_order_relaxed);
+  if ((tail - tx_ring_->head_.load(std::memory_order_acquire)) ==
+      tx_ring_->num_slots_) {
+    return false;
+  }
+  std::byte* slot = Slot(tx_ring_, tail);
+  *reinterpret_cast<uint64_t*>(slot) = len;
+  std::memcpy(slot + kSlotHeaderBytes, msg, len);
+  tx_ring_->tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+void ShmComm::Send(const std::byte* msg, size_t len) {
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  if (Push(msg, len) == false) {
+    tx_drops_++;
+  }
+}
+
+void ShmComm::SendBatch(const std::byte* const* msgs, const size_t* lens,
+                        size_t num_msgs) {
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  for (size_t i = 0; i < num_msgs; i++) {
+    if (Push(msgs[i], lens[i]) == false) {
+      tx_drops_++;
+    }
+  }
+}
+
+ssize_t ShmComm::Recv(std::byte* buf, size_t len) const {
+  size_t rx_len = 0;
+  const ssize_t num_rx = RecvBatch(&buf, len, &rx_len, 1);
+  return (num_rx > 0) ? static_cast<ssize_t>(rx_len) : num_rx;
+}
+
+ssize_t ShmComm::RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                           size_t num_bufs) const {
+  const uint64_t head = rx_ring_->head_.load(std::memory_order_relaxed);
+  const uint64_t available =
+      rx_ring_->tail_.load(std::memory_order_acquire) - head;
+  const size_t num_rx = std::min(static_cast<size_t>(available), num_bufs);
+  for (size_t i = 0; i < num_rx; i++) {
+    const std::byte* slot = Slot(rx_ring_, head + i);
+    // Truncated to the buffer, as a datagram would be
+    lens[i] = std::min(*reinterpret_cast<const uint64_t*>(slot),
+                       static_cast<uint64_t>(len));
+    std::memcpy(bufs[i], slot + kSlotHeaderBytes, lens[i]);
+  }
+  rx_ring_->head_.store(head + num_rx, std::memory_order_release);
+  return static_cast<ssize_t>(num_rx);
+}
+
+std::unique_ptr<PacketComm> CreateSimComm(const Config* cfg,
+                                          const std::string& local_addr,
+                                          uint16_t local_port,
+                                          const std::string& remote_addr,
+                                          uint16_t remote_port,
+                                          size_t rx_buffer_size) {
+  if (cfg->SimShm()) {
+    return std::make_unique<ShmComm>(local_port, remote_port,
+                                     cfg->SimShmSlotBytes(),
+                                     cfg->SimShmSlots(),
+                                     cfg->SimShmHugepage());
+  }
+  auto udp_comm =
+      std::make_unique<UDPComm>(local_addr, local_port, rx_buffer_size, 0);
+  udp_comm->Connect(remote_addr, remote_port);
+  return udp_comm;
+}
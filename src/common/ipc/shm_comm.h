@@ -0,0 +1,93 @@
+/**
+ * @file shm_comm.h
+ * @brief Declaration file for the ShmComm class, a packet link between two
+ * processes on one host through a pair of shared-memory rings
+ */
+#ifndef SHM_COMM_H_
+#define SHM_COMM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "packet_comm.h"
+
+class Config;
+
+/**
+ * @brief A connected link like a UDPComm from local_port to remote_port, but
+ * the packets go through a single-producer single-consumer ring per
+ * direction, in a file of /dev/hugepages (or /dev/shm), with no system call
+ * or kernel copy.
+ *
+ * Each side creates the ring it receives from, named after the two ports,
+ * and maps the ring it sends to once the other side has created it. Until
+ * then, or when the ring is full, a packet is dropped, as UDP would. The
+ * sending threads of a process are serialized, so a link can be shared like
+ * a socket.
+ */
+class ShmComm : public PacketComm {
+ public:
+  /**
+   * @param local_port The port this side would bind
+   * @param remote_port The port of the other side
+   * @param slot_bytes The largest packet, the same on both sides
+   * @param num_slots Packets in the receive ring, rounded up to a power of two
+   * @param use_hugepage Place the receive ring on hugepages if possible
+   */
+  ShmComm(uint16_t local_port, uint16_t remote_port, size_t slot_bytes,
+          size_t num_slots, bool use_hugepage);
+  ~ShmComm() override;
+
+  ShmComm(const ShmComm&) = delete;
+  ShmComm& operator=(const ShmComm&) = delete;
+
+  void Send(const std::byte* msg, size_t len) override;
+  void SendBatch(const std::byte* const* msgs, const size_t* lens,
+                 size_t num_msgs) override;
+  ssize_t Recv(std::byte* buf, size_t len) const override;
+  ssize_t RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                    size_t num_bufs) const override;
+
+  /// Packets dropped because the other side's ring was missing or full
+  inline size_t TxDrops() const { return tx_drops_; }
+
+ private:
+  struct Ring;
+
+  // The slot of a ring that a running index falls on
+  static std::byte* Slot(Ring* ring, uint64_t index);
+  // Map the ring at path, nullptr if it does not exist (yet)
+  static Ring* MapRing(const std::string& path, size_t* map_bytes);
+  // Copy one packet into the tx ring. Returns false if it is full.
+  bool Push(const std::byte* msg, size_t len);
+
+  const size_t slot_bytes_;
+  // The ring this side receives from, which it created
+  std::string rx_path_;
+  Ring* rx_ring_;
+  size_t rx_map_bytes_;
+  // The ring of the other side
+  const std::string tx_name_;
+  Ring* tx_ring_ = nullptr;
+  size_t tx_map_bytes_ = 0;
+  std::mutex tx_mutex_;
+  size_t tx_drops_ = 0;
+};
+
+/**
+ * @brief A connected packet link between the simulator processes: a ShmComm
+ * if the config sets "sim_transport" to "shm", else a UDPComm bound to
+ * local_addr:local_port and connected to remote_addr:remote_port.
+ */
+std::unique_ptr<PacketComm> CreateSimComm(const Config* cfg,
+                                          const std::string& local_addr,
+                                          uint16_t local_port,
+                                          const std::string& remote_addr,
+                                          uint16_t remote_port,
+                                          size_t rx_buffer_size);
+
+#endif  // SHM_COMM_H_
@@ -62,6 +62,35 @@ class UDPClient {
     return comm_object_.Send(msg, len);
   }
 
+  /**
+   * @brief Send num_msgs UDP packets, each to its port of one remote server,
+   * with one sendmmsg() call per UDPComm::kMaxBatchSize packets
+   *
+   * @param rem_hostname Hostname or IP address of the remote server
+   * @param rem_ports UDP port of each message
+   * @param msgs Pointers to the messages to send
+   * @param lens Length in bytes of each message
+   * @param num_msgs Number of messages to send
+   */
+  inline void SendBatch(const std::string& rem_hostname,
+                        const uint16_t* rem_ports, const std::byte* const* msgs,
+                        const size_t* lens, size_t num_msgs) {
+    return comm_object_.SendBatch(rem_hostname, rem_ports, msgs, lens,
+                                  num_msgs);
+  }
+
+  /**
+   * @brief Send num_msgs UDP packets to one remote server, each gathered from
+   * iovs_per_msg buffers, with one sendmmsg() call per
+   * UDPComm::kMaxBatchSize packets
+   */
+  inline void SendBatch(const std::string& rem_hostname, uint16_t rem_port,
+                        const ::iovec* iovs, size_t iovs_per_msg,
+                        size_t num_msgs) {
+    return comm_object_.SendBatch(rem_hostname, rem_port, iovs, iovs_per_msg,
+                                  num_msgs);
+  }
+
   // Enable recording of all packets sent by this UDP client
   inline void EnableRecording() { return comm_object_.EnableRecording(); }
 
@@ -7,9 +7,13 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netdb.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <cstring> /* std::strerror, std::memset, std::memcpy */
 #include <stdexcept>
 #include <utility>
@@ -257,27 +261,15 @@ ssize_t UDPComm::Connect(const std::string& remote_address,
 }
 
 /**
-   * @brief Send one UDP packet to a remote server. The client caches the
-   * the remote server's addrinfo after resolving it for the first time. After
-   * the first time, sending data does not require expensive addrinfo
-   * resolution.
-   *
-   * @param rem_hostname Hostname or IP address of the remote server
-   * @param rem_port UDP port that the remote server is listening on
-   * @param msg Pointer to the message to send
-   * @param len Length in bytes of the message to send
+   * @brief The addrinfo of a remote server, resolved the first time and
+   * cached in addrinfo_map_ after that
    */
-void UDPComm::Send(const std::string& rem_hostname, uint16_t rem_port,
-                   const std::byte* msg, size_t len) {
+::addrinfo* UDPComm::RemoteAddrInfo(const std::string& rem_hostname,
+                                    uint16_t rem_port) {
   const std::string port_str = std::to_string(rem_port);
   const std::string remote_uri = rem_hostname + ":" + port_str;
   ::addrinfo* rem_addrinfo = nullptr;
 
-  if (kDebugPrintUdpSend) {
-    AGORA_LOG_INFO("UDPComm sending message to %s:%d of size %zu\n",
-                   rem_hostname.c_str(), rem_port, len);
-  }
-
   const auto remote_itr = addrinfo_map_.find(remote_uri);
   if (remote_itr == addrinfo_map_.end()) {
     ::addrinfo hints;
@@ -294,9 +286,10 @@ void UDPComm::Send(const std::string& rem_hostname, uint16_t rem_port,
 
     if ((r != 0) || (rem_addrinfo == nullptr)) {
       char issue_msg[1000u];
-      AGORA_LOG_ERROR(issue_msg,
-                      "Send() failed to resolve %s. getaddrinfo error = %s.",
-                      remote_uri.c_str(), gai_strerror(r));
+      std::snprintf(issue_msg, sizeof(issue_msg),
+                    "Send() failed to resolve %s. getaddrinfo error = %s.",
+                    remote_uri.c_str(), gai_strerror(r));
+      AGORA_LOG_ERROR("%s\n", issue_msg);
       throw std::runtime_error(issue_msg);
     }
 
@@ -321,6 +314,28 @@ void UDPComm::Send(const std::string& rem_hostname, uint16_t rem_port,
   } else {
     rem_addrinfo = remote_itr->second;
   }
+  return rem_addrinfo;
+}
+
+/**
+   * @brief Send one UDP packet to a remote server. The client caches the
+   * the remote server's addrinfo after resolving it for the first time. After
+   * the first time, sending data does not require expensive addrinfo
+   * resolution.
+   *
+   * @param rem_hostname Hostname or IP address of the remote server
+   * @param rem_port UDP port that the remote server is listening on
+   * @param msg Pointer to the message to send
+   * @param len Length in bytes of the message to send
+   */
+void UDPComm::Send(const std::string& rem_hostname, uint16_t rem_port,
+                   const std::byte* msg, size_t len) {
+  if (kDebugPrintUdpSend) {
+    AGORA_LOG_INFO("UDPComm sending message to %s:%d of size %zu\n",
+                   rem_hostname.c_str(), rem_port, len);
+  }
+
+  const ::addrinfo* rem_addrinfo = RemoteAddrInfo(rem_hostname, rem_port);
   const ssize_t ret = ::sendto(sock_fd_, msg, len, 0, rem_addrinfo->ai_addr,
                                rem_addrinfo->ai_addrlen);
   if (ret != static_cast<ssize_t>(len)) {
@@ -362,6 +377,127 @@ void UDPComm::Send(const std::byte* msg, size_t len) {
   }
 }
 
+/**
+   * @brief Send num_msgs UDP packets to the connected remote server, with one
+   * sendmmsg() call per kMaxBatchSize packets.
+   */
+void UDPComm::SendBatch(const std::byte* const* msgs, const size_t* lens,
+                        size_t num_msgs) {
+  std::array<::iovec, kMaxBatchSize> iovecs;
+  size_t num_sent = 0;
+  while (num_sent < num_msgs) {
+    const size_t batch_size = std::min(num_msgs - num_sent, kMaxBatchSize);
+    for (size_t i = 0; i < batch_size; i++) {
+      iovecs.at(i).iov_base = const_cast<std::byte*>(msgs[num_sent + i]);
+      iovecs.at(i).iov_len = lens[num_sent + i];
+    }
+    SendMessages(iovecs.data(), 1, batch_size, nullptr);
+    num_sent += batch_size;
+  }
+}
+
+/**
+   * @brief Send num_msgs UDP packets, each to its port of one remote host,
+   * with one sendmmsg() call per kMaxBatchSize packets
+   */
+void UDPComm::SendBatch(const std::string& rem_hostname,
+                        const uint16_t* rem_ports, const std::byte* const* msgs,
+                        const size_t* lens, size_t num_msgs) {
+  std::array<::iovec, kMaxBatchSize> iovecs;
+  std::array<const ::addrinfo*, kMaxBatchSize> rem_addrinfos;
+  size_t num_sent = 0;
+  while (num_sent < num_msgs) {
+    const size_t batch_size = std::min(num_msgs - num_sent, kMaxBatchSize);
+    for (size_t i = 0; i < batch_size; i++) {
+      iovecs.at(i).iov_base = const_cast<std::byte*>(msgs[num_sent + i]);
+      iovecs.at(i).iov_len = lens[num_sent + i];
+      rem_addrinfos.at(i) =
+          RemoteAddrInfo(rem_hostname, rem_ports[num_sent + i]);
+    }
+    SendMessages(iovecs.data(), 1, batch_size, rem_addrinfos.data());
+    num_sent += batch_size;
+  }
+}
+
+/**
+   * @brief Send num_msgs UDP packets gathered from iovs_per_msg buffers each
+   * to one remote server, with one sendmmsg() call per kMaxBatchSize packets
+   */
+void UDPComm::SendBatch(const std::string& rem_hostname, uint16_t rem_port,
+                        const ::iovec* iovs, size_t iovs_per_msg,
+                        size_t num_msgs) {
+  std::array<const ::addrinfo*, kMaxBatchSize> rem_addrinfos;
+  rem_addrinfos.fill(RemoteAddrInfo(rem_hostname, rem_port));
+  size_t num_sent = 0;
+  while (num_sent < num_msgs) {
+    const size_t batch_size = std::min(num_msgs - num_sent, kMaxBatchSize);
+    SendMessages(&iovs[num_sent * iovs_per_msg], iovs_per_msg, batch_size,
+                 rem_addrinfos.data());
+    num_sent += batch_size;
+  }
+}
+
+/**
+   * @brief Send up to kMaxBatchSize UDP packets of iovs_per_msg buffers each,
+   * to rem_addrinfos[i] or, if rem_addrinfos is nullptr, to the connected
+   * remote server
+   */
+void UDPComm::SendMessages(const ::iovec* iovs, size_t iovs_per_msg,
+                           size_t num_msgs,
+                           const ::addrinfo* const* rem_addrinfos) {
+  std::array<::mmsghdr, kMaxBatchSize> msg_hdrs;
+  std::array<size_t, kMaxBatchSize> msg_lens;
+  for (size_t i = 0; i < num_msgs; i++) {
+    std::memset(&msg_hdrs.at(i), 0, sizeof(::mmsghdr));
+    msg_hdrs.at(i).msg_hdr.msg_iov =
+        const_cast<::iovec*>(&iovs[i * iovs_per_msg]);
+    msg_hdrs.at(i).msg_hdr.msg_iovlen = iovs_per_msg;
+    if (rem_addrinfos != nullptr) {
+      msg_hdrs.at(i).msg_hdr.msg_name = rem_addrinfos[i]->ai_addr;
+      msg_hdrs.at(i).msg_hdr.msg_namelen = rem_addrinfos[i]->ai_addrlen;
+    }
+    msg_lens.at(i) = 0;
+    for (size_t j = 0; j < iovs_per_msg; j++) {
+      msg_lens.at(i) += iovs[(i * iovs_per_msg) + j].iov_len;
+    }
+  }
+  if (kDebugPrintUdpSend) {
+    AGORA_LOG_INFO("UDPComm sending %zu messages\n", num_msgs);
+  }
+
+  size_t num_sent = 0;
+  while (num_sent < num_msgs) {
+    // sendmmsg() may send only a part of the batch, send the rest next
+    const int ret =
+        ::sendmmsg(sock_fd_, &msg_hdrs.at(num_sent), num_msgs - num_sent, 0);
+    if (ret <= 0) {
+      AGORA_LOG_ERROR("UDPComm sendmmsg failed with code %d message %s\n",
+                      errno, std::strerror(errno));
+      throw std::runtime_error(
+          "UDPComm::SendBatch() failed. Do you have a connection? " +
+          std::string(std::strerror(errno)));
+    }
+    for (size_t i = num_sent; i < num_sent + ret; i++) {
+      if (msg_hdrs.at(i).msg_len != msg_lens.at(i)) {
+        throw std::runtime_error("UDPComm::SendBatch() sent a partial message");
+      }
+    }
+
+    if (enable_recording_flag_) {
+      std::scoped_lock map_access(map_insert_access_);
+      for (size_t i = num_sent; i < num_sent + ret; i++) {
+        std::vector<uint8_t>& sent = sent_vec_.emplace_back();
+        for (size_t j = 0; j < iovs_per_msg; j++) {
+          const ::iovec& iov = iovs[(i * iovs_per_msg) + j];
+          const auto* buf = static_cast<const uint8_t*>(iov.iov_base);
+          sent.insert(sent.end(), buf, buf + iov.iov_len);
+        }
+      }
+    }
+    num_sent += ret;
+  }
+}
+
 /**
    * @brief Try to receive up to len bytes in buf by default this will not block
    *
@@ -409,7 +545,9 @@ ssize_t UDPComm::Recv(const std::string& src_address, uint16_t src_port,
     }
     if (rem_addrinfo == nullptr) {
       char issue_msg[1000u];
-      AGORA_LOG_ERROR(issue_msg, "Failed to resolve %s", remote_uri.c_str());
+      std::snprintf(issue_msg, sizeof(issue_msg), "Failed to resolve %s",
+                    remote_uri.c_str());
+      AGORA_LOG_ERROR("%s\n", issue_msg);
       throw std::runtime_error(issue_msg);
     }
 
@@ -442,6 +580,51 @@ ssize_t UDPComm::Recv(const std::string& src_address, uint16_t src_port,
   return ret;
 }
 
+/**
+   * @brief Try to receive up to num_bufs packets of up to len bytes each, with
+   * one recvmmsg() call
+   *
+   * @return Return the number of packets received, zero if there are none. If
+   * there was an error in receiving, return -1.
+   */
+ssize_t UDPComm::RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                           size_t num_bufs) const {
+  if (num_bufs > kMaxBatchSize) {
+    throw std::runtime_error("UDPComm::RecvBatch() batch is too large");
+  }
+  std::array<::iovec, kMaxBatchSize> iovecs;
+  std::array<::mmsghdr, kMaxBatchSize> msg_hdrs;
+  for (size_t i = 0; i < num_bufs; i++) {
+    iovecs.at(i).iov_base = static_cast<void*>(bufs[i]);
+    iovecs.at(i).iov_len = len;
+    std::memset(&msg_hdrs.at(i), 0, sizeof(::mmsghdr));
+    msg_hdrs.at(i).msg_hdr.msg_iov = &iovecs.at(i);
+    msg_hdrs.at(i).msg_hdr.msg_iovlen = 1;
+  }
+
+  // Only wait for the first packet (if blocking), then take what is queued
+  ssize_t ret = ::recvmmsg(sock_fd_, msg_hdrs.data(), num_bufs, MSG_WAITFORONE,
+                           nullptr);
+  if (ret == -1) {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) ||
+        (errno == ECONNREFUSED)) {
+      // These errors mean that there's no data to receive
+      ret = 0;
+    } else {
+      AGORA_LOG_ERROR(
+          "UDPComm: recvmmsg() failed with unexpected error %s(%d)\n",
+          std::strerror(errno), errno);
+    }
+  }
+  for (ssize_t i = 0; i < ret; i++) {
+    lens[i] = msg_hdrs.at(i).msg_len;
+  }
+  if (kDebugPrintUdpRecv && (ret > 0)) {
+    AGORA_LOG_INFO("UDPComm received %zd messages\n", ret);
+  }
+  return ret;
+}
+
 /**
    * @brief Configures the socket in blocking mode.  Any calls to recv / send
    * will now block
@@ -479,4 +662,22 @@ void UDPComm::MakeBlocking(size_t rx_timeout_sec) const {
       throw std::runtime_error("UDPComm: Failed to set timeout.");
     }
   }
-}
\ No newline at end of file
+}
+
+/**
+   * @brief Let the kernel coalesce the packets of a flow (UDP GRO), so that
+   * one receive may return several packets back to back. Only for receivers
+   * that treat the packets as a byte stream.
+   *
+   * @return True if the kernel supports it
+   */
+bool UDPComm::EnableGro() const {
+  const int enable = 1;
+  const int opt_status =
+      ::setsockopt(sock_fd_, SOL_UDP, UDP_GRO, &enable, sizeof(enable));
+  if (opt_status != 0) {
+    AGORA_LOG_WARN("UDPComm: UDP GRO is not supported: %s\n",
+                   std::strerror(errno));
+  }
+  return opt_status == 0;
+}
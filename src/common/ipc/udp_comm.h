@@ -6,6 +6,7 @@
 #define UDP_COMM_H_
 
 #include <netdb.h>
+#include <sys/uio.h>
 
 #include <cstddef>
 #include <map>
@@ -13,13 +14,17 @@
 #include <string>
 #include <vector>
 
+#include "packet_comm.h"
+
 // Basic UDP client class based on OS sockets that supports sending messages
 // and caches remote addrinfo mappings
-class UDPComm {
+class UDPComm : public PacketComm {
  public:
   static constexpr bool kDebugPrintUdpInit = false;
   static constexpr bool kDebugPrintUdpSend = false;
   static constexpr bool kDebugPrintUdpRecv = false;
+  // Max packets per RecvBatch() / SendBatch() system call
+  static constexpr size_t kMaxBatchSize = 64;
   explicit UDPComm(std::string local_addr, uint16_t local_port,
                    size_t rx_buffer_size, size_t tx_buffer_size);
 
@@ -28,7 +33,7 @@ class UDPComm {
 
   UDPComm& operator=(const UDPComm&) = delete;
   UDPComm(const UDPComm&) = delete;
-  ~UDPComm();
+  ~UDPComm() override;
 
   /**
    * @brief The remote_address | remote_port is the address to which datagrams are sent.
@@ -62,7 +67,46 @@ class UDPComm {
    * @param msg Pointer to the message to send
    * @param len Length in bytes of the message to send
    */
-  void Send(const std::byte* msg, size_t len);
+  void Send(const std::byte* msg, size_t len) override;
+
+  /**
+   * @brief Send num_msgs UDP packets to the connected remote server, with one
+   * sendmmsg() call per kMaxBatchSize packets.
+   *
+   * @param msgs Pointers to the messages to send
+   * @param lens Length in bytes of each message
+   * @param num_msgs Number of messages to send
+   */
+  void SendBatch(const std::byte* const* msgs, const size_t* lens,
+                 size_t num_msgs) override;
+
+  /**
+   * @brief Send num_msgs UDP packets, each to its port of one remote host,
+   * with one sendmmsg() call per kMaxBatchSize packets. The remote addresses
+   * are cached as in Send().
+   *
+   * @param rem_hostname Hostname or IP address of the remote host
+   * @param rem_ports UDP port of each message
+   * @param msgs Pointers to the messages to send
+   * @param lens Length in bytes of each message
+   * @param num_msgs Number of messages to send
+   */
+  void SendBatch(const std::string& rem_hostname, const uint16_t* rem_ports,
+                 const std::byte* const* msgs, const size_t* lens,
+                 size_t num_msgs);
+
+  /**
+   * @brief Send num_msgs UDP packets to one remote host, each gathered from
+   * iovs_per_msg buffers, with one sendmmsg() call per kMaxBatchSize packets
+   *
+   * @param rem_hostname Hostname or IP address of the remote host
+   * @param rem_port UDP port of the remote host
+   * @param iovs The buffers of message i are iovs[i * iovs_per_msg] onwards
+   * @param iovs_per_msg Number of buffers of each message
+   * @param num_msgs Number of messages to send
+   */
+  void SendBatch(const std::string& rem_hostname, uint16_t rem_port,
+                 const ::iovec* iovs, size_t iovs_per_msg, size_t num_msgs);
 
   /**
    * @brief Try to receive up to len bytes in buf by default this will not block
@@ -71,10 +115,23 @@ class UDPComm {
    * received. If no bytes are received, return zero. If there was an error
    * in receiving, return -1.
    */
-  ssize_t Recv(std::byte* buf, size_t len) const;
+  ssize_t Recv(std::byte* buf, size_t len) const override;
   ssize_t Recv(const std::string& src_address, uint16_t src_port,
                std::byte* buf, size_t len);
 
+  /**
+   * @brief Try to receive up to num_bufs packets of up to len bytes each, with
+   * one recvmmsg() call. By default this will not block.
+   *
+   * @param bufs Buffers of len bytes, one per packet
+   * @param lens Filled with the number of bytes received in each buffer
+   * @param num_bufs Number of buffers, at most kMaxBatchSize
+   * @return Return the number of packets received, zero if there are none. If
+   * there was an error in receiving, return -1.
+   */
+  ssize_t RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                    size_t num_bufs) const override;
+
   // Enable recording of all packets sent by this UDPComm object
   inline void EnableRecording() { enable_recording_flag_ = true; }
 
@@ -84,7 +141,20 @@ class UDPComm {
    */
   void MakeBlocking(size_t rx_timeout_sec = 0) const;
 
+  /**
+   * @brief Let the kernel coalesce the packets of a flow (UDP GRO), so that
+   * one receive may return several packets back to back
+   *
+   * @return True if the kernel supports it
+   */
+  bool EnableGro() const;
+
  private:
+  ::addrinfo* RemoteAddrInfo(const std::string& rem_hostname,
+                             uint16_t rem_port);
+  void SendMessages(const ::iovec* iovs, size_t iovs_per_msg,
+                    size_t num_msgs, const ::addrinfo* const* rem_addrinfos);
+
   /**
    * @brief The raw socket file descriptor
    */
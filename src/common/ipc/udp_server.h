@@ -60,6 +60,22 @@ class UDPServer {
     return comm_object_.Recv(src_address, src_port, buf, len);
   }
 
+  /**
+   * @brief Try to receive up to num_bufs packets of up to len bytes each, with
+   * one recvmmsg() call
+   *
+   * @return Return the number of packets received, zero if there are none. If
+   * there was an error in receiving, return -1.
+   */
+  inline ssize_t RecvBatch(std::byte* const* bufs, size_t len, size_t* lens,
+                           size_t num_bufs) const {
+    return comm_object_.RecvBatch(bufs, len, lens, num_bufs);
+  }
+
+  // Let the kernel coalesce the packets of a flow, returns false if the
+  // kernel does not support it
+  inline bool EnableGro() const { return comm_object_.EnableGro(); }
+
   /**
    * @brief Configures the socket in blocking mode.  Any calls to recv / send
    * will now block
@@ -0,0 +1,155 @@
+/**
+ * @file async_log.cc
+ * @brief Implementation file for the asynchronous backend of the AGORA_LOG
+ * macros
+ */
+#include "async_log.h"
+
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+
+namespace AsyncLog {
+
+static constexpr uint64_t kNsPerSec = 1000000000;
+// Sleep of the background thread when all rings are empty
+static constexpr auto kIdleSleep = std::chrono::milliseconds(1);
+// Messages longer than this are formatted a second time into a string
+static constexpr size_t kLineBytes = 1024;
+
+static std::atomic<bool> started{false};
+static std::atomic<bool> running{false};
+static std::thread writer;
+static FILE* out_stream = nullptr;
+// Rings of all threads that ever logged, never freed while the process runs
+static std::mutex rings_mutex;
+static std::vector<std::unique_ptr<Ring>> rings;
+
+bool RateLimit::Allow(uint64_t now_ns, uint32_t& suppressed) {
+  uint64_t window_start = window_start_ns_.load(std::memory_order_relaxed);
+  if ((now_ns - window_start >= kNsPerSec) &&
+      window_start_ns_.compare_exchange_strong(window_start, now_ns,
+                                               std::memory_order_relaxed)) {
+    count_.store(0, std::memory_order_relaxed);
+  }
+  if (count_.fetch_add(1, std::memory_order_relaxed) >= kRateLimitPerSec) {
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t NowNs() {
+  struct timespec t;
+  clock_gettime(CLOCK_REALTIME, &t);
+  return (static_cast<uint64_t>(t.tv_sec) * kNsPerSec) + t.tv_nsec;
+}
+
+bool Started() { return started.load(std::memory_order_acquire); }
+
+Ring& ThreadRing() {
+  thread_local Ring* ring = nullptr;
+  if (ring == nullptr) {
+    auto new_ring = std::make_unique<Ring>();
+    ring = new_ring.get();
+    const std::lock_guard<std::mutex> lock(rings_mutex);
+    rings.push_back(std::move(new_ring));
+  }
+  return *ring;
+}
+
+// Same header as AgoraOutputLogHeader, with the time of the record
+static void WriteRecord(FILE* stream, const Record& record) {
+  const uint64_t sec = (record.time_ns_ / kNsPerSec) % 100;
+  const uint64_t usec = (record.time_ns_ % kNsPerSec) / 1000;
+  std::fprintf(stream, "%u:%06u %s: ", static_cast<uint32_t>(sec),
+               static_cast<uint32_t>(usec), AgoraLogLevelName(record.level_));
+  if (record.suppressed_ > 0) {
+    std::fprintf(stream, "(%u similar messages suppressed) ",
+                 record.suppressed_);
+  }
+  char line[kLineBytes];
+  const int len = record.format_(line, sizeof(line), record);
+  if (len < 0) {
+    return;
+  }
+  if (static_cast<size_t>(len) < sizeof(line)) {
+    std::fwrite(line, 1, len, stream);
+  } else {
+    std::string long_line(len + 1, '\0');
+    record.format_(long_line.data(), long_line.size(), record);
+    std::fwrite(long_line.data(), 1, len, stream);
+  }
+}
+
+void WriteNow(const Record& record) {
+  FILE* stream = (out_stream != nullptr) ? out_stream : AGORA_LOG_STREAM;
+  WriteRecord(stream, record);
+  std::fflush(stream);
+}
+
+// Write the records of all rings, returns the number written
+static size_t Drain() {
+  // Used by the writer (or by Stop() after it), so a new thread never waits
+  // for the output to register its ring
+  static std::vector<Ring*> snapshot;
+  {
+    const std::lock_guard<std::mutex> lock(rings_mutex);
+    for (size_t i = snapshot.size(); i < rings.size(); i++) {
+      snapshot.push_back(rings.at(i).get());
+    }
+  }
+  size_t num_written = 0;
+  for (Ring* ring : snapshot) {
+    for (const Record* record = ring->Front(); record != nullptr;
+         record = ring->Front()) {
+      WriteRecord(out_stream, *record);
+      ring->Pop();
+      num_written++;
+    }
+    const size_t dropped = ring->TakeDropped();
+    if (dropped > 0) {
+      std::fprintf(out_stream, "%s: %zu log messages dropped, ring full\n",
+                   AgoraLogLevelName(AGORA_LOG_LEVEL_WARN), dropped);
+      num_written++;
+    }
+  }
+  if (num_written > 0) {
+    std::fflush(out_stream);
+  }
+  return num_written;
+}
+
+void Start(FILE* stream) {
+  if (running.exchange(true)) {
+    return;
+  }
+  out_stream = stream;
+  writer = std::thread([]() {
+    while (running.load(std::memory_order_acquire)) {
+      if (Drain() == 0) {
+        std::this_thread::sleep_for(kIdleSleep);
+      }
+    }
+  });
+  started.store(true, std::memory_order_release);
+}
+
+void Stop() {
+  if (running.exchange(false) == false) {
+    return;
+  }
+  // Later messages are written by their threads
+  started.store(false, std::memory_order_release);
+  writer.join();
+  Drain();
+}
+
+}  // namespace AsyncLog
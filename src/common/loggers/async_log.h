@@ -0,0 +1,210 @@
+/**
+ * @file async_log.h
+ * @brief Declaration file for the asynchronous backend of the AGORA_LOG
+ * macros. The logging threads copy the format string pointer and the raw
+ * arguments into a per-thread lock-free ring, and a background thread formats
+ * and writes them.
+ */
+#ifndef ASYNC_LOG_H_
+#define ASYNC_LOG_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
+
+namespace AsyncLog {
+
+/// Bytes of one log record in the ring, header included
+static constexpr size_t kRecordBytes = 256;
+/// Records in the ring of each logging thread. A full ring drops the new
+/// records instead of blocking the thread.
+static constexpr size_t kRingRecords = 512;
+/// Messages of one call site (of AGORA_LOG_ERROR or AGORA_LOG_WARN) per
+/// second before the site is suppressed until the next second
+static constexpr size_t kRateLimitPerSec = 10;
+
+/// A string argument, stored in the record after the other arguments
+struct StrRef {
+  uint16_t offset_;
+};
+
+template <typename T>
+static constexpr bool kIsString =
+    std::is_same_v<std::decay_t<T>, const char*> ||
+    std::is_same_v<std::decay_t<T>, char*>;
+
+template <typename T>
+using Stored = std::conditional_t<kIsString<T>, StrRef, std::decay_t<T>>;
+
+struct Record;
+using FormatFn = int (*)(char* buf, size_t len, const Record& record);
+
+struct Record {
+  FormatFn format_;
+  // Must outlive the process, which the macros ensure with a string literal
+  const char* fmt_;
+  uint64_t time_ns_;
+  uint32_t level_;
+  // Messages of this call site suppressed by the rate limit since the last
+  // one
+  uint32_t suppressed_;
+  alignas(8) uint8_t args_[kRecordBytes - 32];
+};
+static_assert(sizeof(Record) == kRecordBytes, "Record must fill its slot");
+
+/// Single-producer single-consumer ring of one logging thread
+class Ring {
+ public:
+  /// The next free record, or nullptr if the ring is full
+  inline Record* Reserve() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kRingRecords) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &records_[head % kRingRecords];
+  }
+  inline void Commit() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  /// The oldest record, or nullptr if the ring is empty. Consumer only.
+  inline const Record* Front() const {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &records_[tail % kRingRecords];
+  }
+  inline void Pop() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+  inline size_t TakeDropped() {
+    return dropped_.exchange(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::array<Record, kRingRecords> records_;
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  std::atomic<size_t> dropped_{0};
+};
+
+/// Per call site limit of kRateLimitPerSec messages per second
+class RateLimit {
+ public:
+  /// Returns false if the message is to be suppressed. Otherwise suppressed
+  /// is set to the messages suppressed since the last allowed one.
+  bool Allow(uint64_t now_ns, uint32_t& suppressed);
+
+ private:
+  std::atomic<uint64_t> window_start_ns_{0};
+  std::atomic<size_t> count_{0};
+  std::atomic<uint32_t> suppressed_{0};
+};
+
+/// Start the background thread, which writes the records to stream. Until
+/// then, and after Stop(), messages are formatted and written by the logging
+/// thread itself.
+void Start(FILE* stream);
+/// Write the remaining records and stop the background thread
+void Stop();
+bool Started();
+uint64_t NowNs();
+/// The ring of the calling thread, created on its first message
+Ring& ThreadRing();
+/// Format and write one message on the calling thread
+void WriteNow(const Record& record);
+
+template <typename... Args>
+static int FormatRecord(char* buf, size_t len, const Record& record) {
+  const auto& stored = *std::launder(
+      reinterpret_cast<const std::tuple<Stored<Args>...>*>(record.args_));
+  return std::apply(
+      [&](const auto&... arg) {
+        [[maybe_unused]] const auto decode = [&](const auto& value) {
+          if constexpr (std::is_same_v<std::decay_t<decltype(value)>,
+                                       StrRef>) {
+            return reinterpret_cast<const char*>(record.args_ +
+                                                 value.offset_);
+          } else {
+            return value;
+          }
+        };
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        return std::snprintf(buf, len, record.fmt_, decode(arg)...);
+      },
+      stored);
+}
+
+/// Copy str after the stored arguments, truncated to the space left. The
+/// last byte of the record is kept zero for the strings that find no space.
+static inline StrRef StoreString(Record& record, size_t& offset,
+                                 const char* str) {
+  static constexpr size_t kLast = sizeof(Record::args_) - 1;
+  record.args_[kLast] = '\0';
+  if ((str == nullptr) || (offset >= kLast)) {
+    return StrRef{static_cast<uint16_t>(kLast)};
+  }
+  const size_t len = strnlen(str, kLast - offset);
+  const StrRef ref{static_cast<uint16_t>(offset)};
+  std::memcpy(record.args_ + offset, str, len);
+  record.args_[offset + len] = '\0';
+  offset += len + 1;
+  return ref;
+}
+
+template <typename T>
+static inline Stored<T> StoreArg(Record& record, size_t& offset,
+                                 const T& value) {
+  if constexpr (kIsString<T>) {
+    return StoreString(record, offset, value);
+  } else {
+    return value;
+  }
+}
+
+/// Log one message, level is only used for its header
+template <typename... Args>
+static inline void Log(int level, uint32_t suppressed, const char* fmt,
+                       const Args&... args) {
+  using Tuple = std::tuple<Stored<Args>...>;
+  static_assert(sizeof(Tuple) <= sizeof(Record::args_) / 2,
+                "Too many log arguments for a record");
+  static_assert((std::is_trivially_copyable_v<Stored<Args>> && ...),
+                "Log arguments must be printf arguments");
+  Record local_record;
+  Record* record = &local_record;
+  const bool deferred = Started();
+  if (deferred) {
+    record = ThreadRing().Reserve();
+    if (record == nullptr) {
+      return;
+    }
+  }
+  record->format_ = &FormatRecord<Args...>;
+  record->fmt_ = fmt;
+  record->time_ns_ = NowNs();
+  record->level_ = static_cast<uint32_t>(level);
+  record->suppressed_ = suppressed;
+  [[maybe_unused]] size_t offset = sizeof(Tuple);
+  // Braced init list, so the strings are stored in argument order
+  new (record->args_) Tuple{StoreArg(*record, offset, args)...};
+  if (deferred) {
+    ThreadRing().Commit();
+  } else {
+    WriteNow(*record);
+  }
+}
+
+}  // namespace AsyncLog
+
+#endif  // ASYNC_LOG_H_
@@ -1,6 +1,39 @@
 #include "memory_manage.h"
 
+#include <numa.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
 namespace Agora_memory {
+static constexpr size_t kPageSize = 4096;
+static constexpr size_t kHugePageSize2M = (2ul << 20);
+static constexpr size_t kHugePageSize1G = (1ul << 30);
+
+// Mapped size of the allocations not from the heap, to unmap them on free.
+// Only touched at allocation time, not on the data path.
+static std::mutex mapped_mutex;
+static std::unordered_map<void*, size_t> mapped_sizes;
+
 inline size_t PaddedAllocSize(Alignment_t alignment, size_t size) {
   auto align = static_cast<size_t>(alignment);
   size_t padded_size = size;
@@ -12,8 +45,124 @@ inline size_t PaddedAllocSize(Alignment_t alignment, size_t size) {
   return padded_size;
 }
 
-void* PaddedAlignedAlloc(Alignment_t alignment, size_t size) {
-  return std::aligned_alloc(static_cast<size_t>(alignment),
-                            PaddedAllocSize(alignment, size));
+// Map size bytes of anonymous memory, with hugepages if requested. Falls back
+// to transparent hugepages if no hugepages of that size are reserved.
+static void* MapPages(PageType page_type, size_t& size) {
+  if (page_type != PageType::kDefault) {
+    const bool huge_1g = (page_type == PageType::kHuge1G);
+    const size_t huge_size = huge_1g ? kHugePageSize1G : kHugePageSize2M;
+    const size_t huge_map_size =
+        ((size + huge_size - 1) / huge_size) * huge_size;
+    void* ptr = mmap(nullptr, huge_map_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                         (huge_1g ? MAP_HUGE_1GB : MAP_HUGE_2MB),
+                     -1, 0);
+    if (ptr != MAP_FAILED) {
+      size = huge_map_size;
+      return ptr;
+    }
+    static std::once_flag warned;
+    std::call_once(warned, [huge_1g]() {
+      std::fprintf(stderr,
+                   "Memory: no %s hugepages available, using transparent "
+                   "hugepages\n",
+                   huge_1g ? "1 GB" : "2 MB");
+    });
+  }
+
+  size = ((size + kPageSize - 1) / kPageSize) * kPageSize;
+  void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return nullptr;
+  }
+  if (page_type != PageType::kDefault) {
+    madvise(ptr, size, MADV_HUGEPAGE);
+  }
+  return ptr;
 }
-};  // namespace Agora_memory
\ No newline at end of file
+
+void* PaddedAlignedAlloc(Alignment_t alignment, size_t size,
+                         const MemoryPolicy& policy) {
+  if ((policy.page_type_ == PageType::kDefault) && (policy.numa_node_ < 0)) {
+    return std::aligned_alloc(static_cast<size_t>(alignment),
+                              PaddedAllocSize(alignment, size));
+  }
+
+  // Mappings are page aligned, which covers every Alignment_t
+  size_t map_size = PaddedAllocSize(alignment, size);
+  void* ptr = MapPages(policy.page_type_, map_size);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  // Bind before the first touch, so that no page lands on another node
+  if ((policy.numa_node_ >= 0) && (numa_available() >= 0)) {
+    numa_tonode_memory(ptr, map_size, policy.numa_node_);
+  }
+  std::lock_guard<std::mutex> lock(mapped_mutex);
+  mapped_sizes.emplace(ptr, map_size);
+  return ptr;
+}
+
+void PaddedAlignedFree(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mapped_mutex);
+    auto mapped = mapped_sizes.find(ptr);
+    if (mapped != mapped_sizes.end()) {
+      munmap(ptr, mapped->second);
+      mapped_sizes.erase(mapped);
+      return;
+    }
+  }
+  std::free(ptr);
+}
+
+bool Prefault(void* ptr, size_t size) {
+  if ((ptr == nullptr) || (size == 0)) {
+    return true;
+  }
+  // Whole pages; the partial pages at the ends keep their contents too
+  const auto start = reinterpret_cast<uintptr_t>(ptr) & ~(kPageSize - 1);
+  const auto end = reinterpret_cast<uintptr_t>(ptr) + size;
+  return madvise(reinterpret_cast<void*>(start), end - start,
+                 MADV_POPULATE_WRITE) == 0;
+}
+
+bool PrefaultParallel(const std::vector<std::pair<void*, size_t>>& buffers,
+                      size_t num_threads) {
+  // Chunk i of all the buffers goes to thread i % num_threads
+  static constexpr size_t kPrefaultChunk = kHugePageSize2M;
+  std::atomic<bool> ok(true);
+  auto prefault_share = [&](size_t thread_id) {
+    size_t chunk = 0;
+    for (const auto& buffer : buffers) {
+      auto* base = static_cast<std::byte*>(buffer.first);
+      for (size_t offset = 0; offset < buffer.second;
+           offset += kPrefaultChunk, chunk++) {
+        if ((chunk % num_threads) != thread_id) {
+          continue;
+        }
+        const size_t size = std::min(kPrefaultChunk, buffer.second - offset);
+        if (Prefault(base + offset, size) == false) {
+          ok = false;
+          return;
+        }
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(prefault_share, i);
+  }
+  prefault_share(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return ok;
+}
+
+bool LockAllMemory() { return mlockall(MCL_CURRENT | MCL_FUTURE) == 0; }
+};  // namespace Agora_memory
@@ -13,6 +13,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <random>
+#include <utility>
+#include <vector>
 
 namespace Agora_memory {
 enum class Alignment_t : size_t {
@@ -21,7 +23,37 @@ enum class Alignment_t : size_t {
   kAlign4096 = 4096
 };
 
-void* PaddedAlignedAlloc(Alignment_t alignment, size_t size);
+/// Pages backing an allocation
+enum class PageType : size_t {
+  kDefault,  /// Heap memory, or 4 KB pages if bound to a NUMA node
+  kHuge2M,   /// 2 MB hugepages
+  kHuge1G    /// 1 GB hugepages
+};
+
+/// Placement of a buffer. Hugepages fall back to transparent hugepages if
+/// none are reserved. numa_node_ < 0 leaves the placement to the kernel (first
+/// touch).
+struct MemoryPolicy {
+  PageType page_type_ = PageType::kDefault;
+  int numa_node_ = -1;
+};
+
+void* PaddedAlignedAlloc(Alignment_t alignment, size_t size,
+                         const MemoryPolicy& policy = MemoryPolicy());
+/// Free memory from PaddedAlignedAlloc, whatever its policy
+void PaddedAlignedFree(void* ptr);
+/// Fault in the pages of size bytes at ptr for writing, without changing
+/// their contents. Safe while other threads use the memory. Returns false if
+/// the kernel does not support it (before Linux 5.14).
+bool Prefault(void* ptr, size_t size);
+/// Prefault the (pointer, size) buffers with num_threads threads, which take
+/// turns on their 2 MB chunks. Returns false as Prefault().
+bool PrefaultParallel(const std::vector<std::pair<void*, size_t>>& buffers,
+                      size_t num_threads);
+/// Lock the pages of the process in memory, those mapped now and those
+/// mapped later, faulting in the ones not present yet. Returns false if the
+/// kernel refuses, e.g. above RLIMIT_MEMLOCK without CAP_IPC_LOCK.
+bool LockAllMemory();
 }  // namespace Agora_memory
 
 template <typename T>
@@ -31,22 +63,29 @@ class Table {
   size_t dim1_{0};
   T* data_;
   Agora_memory::Alignment_t alignment;
+  // False if data_ belongs to someone else, e.g. a mapped file
+  bool owned_{true};
 
  public:
   Table() : data_(nullptr) {}
 
-  void Malloc(size_t dim1, size_t dim2, Agora_memory::Alignment_t alignment) {
+  void Malloc(size_t dim1, size_t dim2, Agora_memory::Alignment_t alignment,
+              const Agora_memory::MemoryPolicy& policy =
+                  Agora_memory::MemoryPolicy()) {
     this->dim2_ = dim2;
     this->dim1_ = dim1;
     this->alignment = alignment;
+    this->owned_ = true;
     // RtAssert(((dim1 > 0) && (dim2 == 0)), "Table: Malloc one dimension = 0");
     size_t alloc_size = (this->dim1_ * this->dim2_ * sizeof(T));
     this->data_ = static_cast<T*>(
-        Agora_memory::PaddedAlignedAlloc(alignment, alloc_size));
+        Agora_memory::PaddedAlignedAlloc(alignment, alloc_size, policy));
   }
-  void Calloc(size_t dim1, size_t dim2, Agora_memory::Alignment_t alignment) {
+  void Calloc(size_t dim1, size_t dim2, Agora_memory::Alignment_t alignment,
+              const Agora_memory::MemoryPolicy& policy =
+                  Agora_memory::MemoryPolicy()) {
     // RtAssert(((dim1 > 0) && (dim2 == 0)), "Table: Calloc one dimension = 0");
-    this->Malloc(dim1, dim2, alignment);
+    this->Malloc(dim1, dim2, alignment, policy);
     std::memset(static_cast<void*>(this->data_), 0,
                 (this->dim1_ * this->dim2_ * sizeof(T)));
   }
@@ -90,11 +129,21 @@ class Table {
     }
   }
 
+  // Use dim1 x dim2 entries at data, which the table does not own and Free()
+  // leaves to their owner
+  void Wrap(T* data, size_t dim1, size_t dim2) {
+    assert(this->data_ == nullptr);
+    this->dim2_ = dim2;
+    this->dim1_ = dim1;
+    this->data_ = data;
+    this->owned_ = false;
+  }
+
   bool IsAllocated() { return (this->data_ != nullptr); }
 
   void Free() {
-    if (this->data_ != nullptr) {
-      std::free(this->data_);
+    if ((this->data_ != nullptr) && this->owned_) {
+      Agora_memory::PaddedAlignedFree(this->data_);
     }
     this->dim2_ = 0u;
     this->dim1_ = 0u;
@@ -110,6 +159,8 @@ class Table {
 
   size_t Dim1() { return (this->dim1_); }
   size_t Dim2() { return (this->dim2_); }
+  /// Bytes allocated for the table entries
+  size_t SizeBytes() const { return (this->dim1_ * this->dim2_ * sizeof(T)); }
 
   // Functions for unit tests (functional/correctness verification)
   const std::type_info& get_typeid() { return typeid(T); }
@@ -147,11 +198,13 @@ class Table {
 };
 
 template <typename T, typename U>
-static void AllocBuffer1d(T** buffer, U dim,
-                          Agora_memory::Alignment_t alignment, int init_zero) {
+static void AllocBuffer1d(
+    T** buffer, U dim, Agora_memory::Alignment_t alignment, int init_zero,
+    const Agora_memory::MemoryPolicy& policy = Agora_memory::MemoryPolicy()) {
   size_t size = dim * sizeof(T);
   // RtAssert(((dim > 0)), "AllocBuffer1d: size = 0");
-  *buffer = static_cast<T*>(Agora_memory::PaddedAlignedAlloc(alignment, size));
+  *buffer = static_cast<T*>(
+      Agora_memory::PaddedAlignedAlloc(alignment, size, policy));
   if (init_zero) {
     std::memset(static_cast<void*>(*buffer), 0u, size);
   }
@@ -159,44 +212,107 @@ static void AllocBuffer1d(T** buffer, U dim,
 
 template <typename T>
 static void FreeBuffer1d(T** buffer) {
-  std::free(*buffer);
+  Agora_memory::PaddedAlignedFree(*buffer);
+};
+
+// FlatGrid is a view of the cells of a PtrGrid, indexed as the grid is with
+// grid[row][col]. The cell address is computed from the backing buffer and
+// the dimensions, so an access does not load it from the pointer cells.
+template <class T>
+class FlatGrid {
+ public:
+  class Row {
+   public:
+    Row(T* base, size_t n_entries) : base_(base), n_entries_(n_entries) {}
+    T* operator[](size_t col) const { return base_ + (col * n_entries_); }
+
+   private:
+    T* base_;
+    size_t n_entries_;
+  };
+
+  FlatGrid() = default;
+  FlatGrid(T* base, size_t n_cols, size_t n_entries)
+      : base_(base), row_stride_(n_cols * n_entries), n_entries_(n_entries) {}
+
+  Row operator[](size_t row_idx) const {
+    return Row(base_ + (row_idx * row_stride_), n_entries_);
+  }
+
+  /// Elements from the array of a cell to that of the next cell in its row
+  size_t CellStride() const { return n_entries_; }
+
+ private:
+  T* base_ = nullptr;
+  size_t row_stride_ = 0;
+  size_t n_entries_ = 0;
+};
+
+// FlatCube is the view of a PtrCube, cube[i][j][k], like FlatGrid
+template <class T>
+class FlatCube {
+ public:
+  FlatCube() = default;
+  FlatCube(T* base, size_t dim_2, size_t dim_3, size_t n_entries)
+      : base_(base),
+        dim_3_(dim_3),
+        n_entries_(n_entries),
+        mat_stride_(dim_2 * dim_3 * n_entries) {}
+
+  FlatGrid<T> operator[](size_t idx) const {
+    return FlatGrid<T>(base_ + (idx * mat_stride_), dim_3_, n_entries_);
+  }
+
+ private:
+  T* base_ = nullptr;
+  size_t dim_3_ = 0;
+  size_t n_entries_ = 0;
+  size_t mat_stride_ = 0;
 };
 
-// PtrGrid is a 2D grid of pointers with [ROWS] rows and [COLS] columns. Each
-// entry of the grid is a pointer to an array of [T].
+// PtrGrid is a 2D grid of pointers with at most [ROWS] rows and [COLS]
+// columns. Each entry of the grid is a pointer to an array of [T]. Only the
+// allocated rows and columns are stored.
 template <size_t ROWS, size_t COLS, class T>
 class PtrGrid {
  public:
-  PtrGrid() : backing_buf_(nullptr) {}
+  PtrGrid() : backing_buf_(nullptr), alloc_sz_(0), n_cols_(0), n_entries_(0) {}
 
   /// Create a grid of pointers where each grid cell points to an array of
   /// [n_entries]
   explicit PtrGrid(size_t num_entries) { this->Alloc(ROWS, COLS, num_entries); }
 
-  /// Create a grid of pointers with dimensions [ROWS, COLS], where
-  /// only the grid with dimensions [n_rows, n_cols] has cells pointing to an
-  /// array of [n_entries]. This can use less memory than a fully-allocated
-  /// grid.
-  PtrGrid(size_t n_rows, size_t n_cols, size_t n_entries) {
-    assert(n_rows <= ROWS && n_cols <= COLS);
-    this->Alloc(n_rows, n_cols, n_entries);
+  /// Create a grid of pointers with dimensions [n_rows, n_cols], where each
+  /// grid cell points to an array of [n_entries]. This can use less memory
+  /// than a fully-allocated grid.
+  PtrGrid(size_t n_rows, size_t n_cols, size_t n_entries,
+          const Agora_memory::MemoryPolicy& policy =
+              Agora_memory::MemoryPolicy()) {
+    this->Alloc(n_rows, n_cols, n_entries, policy);
   }
 
   ~PtrGrid() {
     if (this->backing_buf_ != nullptr) {
-      std::free(this->backing_buf_);
+      Agora_memory::PaddedAlignedFree(this->backing_buf_);
       this->backing_buf_ = nullptr;
     }
   }
 
   /// Allocate [n_entries] entries per pointer cell
-  void Alloc(size_t n_rows, size_t n_cols, size_t n_entries) {
+  void Alloc(size_t n_rows, size_t n_cols, size_t n_entries,
+             const Agora_memory::MemoryPolicy& policy =
+                 Agora_memory::MemoryPolicy()) {
+    assert(n_rows <= ROWS && n_cols <= COLS);
     const size_t alloc_sz = n_rows * n_cols * n_entries * sizeof(T);
     this->backing_buf_ = static_cast<T*>(Agora_memory::PaddedAlignedAlloc(
-        Agora_memory::Alignment_t::kAlign64, alloc_sz));
+        Agora_memory::Alignment_t::kAlign64, alloc_sz, policy));
     std::memset(static_cast<void*>(this->backing_buf_), 0, alloc_sz);
+    this->alloc_sz_ = alloc_sz;
+    this->n_cols_ = n_cols;
+    this->n_entries_ = n_entries;
 
     // Fill-in the grid with pointers into backing_buf
+    this->mat_.assign(n_rows, std::vector<T*>(n_cols, nullptr));
     size_t offset = 0;
     for (size_t i = 0; i < n_rows; i++) {
       for (size_t j = 0; j < n_cols; j++) {
@@ -225,8 +341,20 @@ class PtrGrid {
     }
   }
 
-  std::array<T*, COLS>& operator[](size_t row_idx) {
-    return this->mat_[row_idx];
+  std::vector<T*>& operator[](size_t row_idx) { return this->mat_[row_idx]; }
+
+  /// The cells without the pointer cells, for the hot paths
+  FlatGrid<T> Flat() const {
+    return FlatGrid<T>(this->backing_buf_, this->n_cols_, this->n_entries_);
+  }
+
+  /// Bytes allocated for the per-cell arrays and the pointer cells
+  size_t SizeBytes() const {
+    size_t num_cells = 0;
+    for (const auto& row : this->mat_) {
+      num_cells += row.size();
+    }
+    return this->alloc_sz_ + (num_cells * sizeof(T*));
   }
 
   // Delete copy constructor and copy assignment
@@ -234,19 +362,28 @@ class PtrGrid {
   PtrGrid& operator=(PtrGrid const&) = delete;
 
  private:
-  std::array<std::array<T*, COLS>, ROWS> mat_;  /// The pointer cells
+  std::vector<std::vector<T*>> mat_;  /// The pointer cells
 
   /// The backing buffer for the per-cell arrays. Having a common buffer
   /// reduces the number of memory allocations.
   T* backing_buf_;
+  size_t alloc_sz_;
+  size_t n_cols_;
+  size_t n_entries_;
 };
 
-// PtrCube is a 3D cube of pointers. Each entry of the cube is a pointer to an
-// array of [T].
+// PtrCube is a 3D cube of pointers with dimensions of at most [DIM1, DIM2,
+// DIM3]. Each entry of the cube is a pointer to an array of [T]. Only the
+// allocated part of the cube is stored.
 template <size_t DIM1, size_t DIM2, size_t DIM3, class T>
 class PtrCube {
  public:
-  PtrCube() : backing_buf_(nullptr) {}
+  PtrCube()
+      : backing_buf_(nullptr),
+        alloc_sz_(0),
+        dim_2_(0),
+        dim_3_(0),
+        n_entries_(0) {}
 
   /// Create a cube of pointers with dimensions [DIM1, DIM2, DIM3], where each
   /// cube cell points to an array of [n_entries]
@@ -254,38 +391,40 @@ class PtrCube {
     this->Alloc(DIM1, DIM2, DIM3, num_entries);
   }
 
-  /// Create a cube of pointers with dimensions [DIM1, DIM2, DIM3], where
-  /// only the cube with dimensions [dim_1, dim_2, dim_3] has cells
-  /// pointing to an array of [n_entries]. This can use less memory than a
-  /// fully-allocated cube.
-  PtrCube(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries) {
-    assert(dim_1 <= DIM1 && dim_2 <= DIM2 && dim_3 <= DIM3);
-    this->Alloc(dim_1, dim_2, dim_3, n_entries);
+  /// Create a cube of pointers with dimensions [dim_1, dim_2, dim_3], where
+  /// each cube cell points to an array of [n_entries]. This can use less
+  /// memory than a fully-allocated cube.
+  PtrCube(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries,
+          const Agora_memory::MemoryPolicy& policy =
+              Agora_memory::MemoryPolicy()) {
+    this->Alloc(dim_1, dim_2, dim_3, n_entries, policy);
   }
 
   ~PtrCube() {
     if (this->backing_buf_ != nullptr) {
-      std::free(this->backing_buf_);
+      Agora_memory::PaddedAlignedFree(this->backing_buf_);
       this->backing_buf_ = nullptr;
     }
   }
 
   /// Allocate [n_entries] entries per pointer cell
-  void Alloc(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries) {
+  void Alloc(size_t dim_1, size_t dim_2, size_t dim_3, size_t n_entries,
+             const Agora_memory::MemoryPolicy& policy =
+                 Agora_memory::MemoryPolicy()) {
+    assert(dim_1 <= DIM1 && dim_2 <= DIM2 && dim_3 <= DIM3);
     const size_t alloc_sz = dim_1 * dim_2 * dim_3 * n_entries * sizeof(T);
     this->backing_buf_ = static_cast<T*>(Agora_memory::PaddedAlignedAlloc(
-        Agora_memory::Alignment_t::kAlign64, alloc_sz));
+        Agora_memory::Alignment_t::kAlign64, alloc_sz, policy));
     std::memset(static_cast<void*>(this->backing_buf_), 0, alloc_sz);
+    this->alloc_sz_ = alloc_sz;
+    this->dim_2_ = dim_2;
+    this->dim_3_ = dim_3;
+    this->n_entries_ = n_entries;
 
     // Fill-in the grid with pointers into backing_buf
-    for (auto& mat : this->cube_) {
-      for (auto& row : mat) {
-        for (auto& entry : row) {
-          entry = nullptr;
-        }
-      }
-    }
-
+    this->cube_.assign(
+        dim_1, std::vector<std::vector<T*>>(dim_2,
+                                            std::vector<T*>(dim_3, nullptr)));
     size_t offset = 0;
     for (size_t i = 0; i < dim_1; i++) {
       for (size_t j = 0; j < dim_2; j++) {
@@ -297,21 +436,42 @@ class PtrCube {
     }
   }
 
-  std::array<std::array<T*, DIM3>, DIM2>& operator[](size_t row_idx) {
+  std::vector<std::vector<T*>>& operator[](size_t row_idx) {
     return this->cube_[row_idx];
   }
 
+  /// The cells without the pointer cells, for the hot paths
+  FlatCube<T> Flat() const {
+    return FlatCube<T>(this->backing_buf_, this->dim_2_, this->dim_3_,
+                       this->n_entries_);
+  }
+
+  /// Bytes allocated for the per-cell arrays and the pointer cells
+  size_t SizeBytes() const {
+    size_t num_cells = 0;
+    for (const auto& mat : this->cube_) {
+      for (const auto& row : mat) {
+        num_cells += row.size();
+      }
+    }
+    return this->alloc_sz_ + (num_cells * sizeof(T*));
+  }
+
   // Delete copy constructor and copy assignment
   PtrCube(PtrCube const&) = delete;
   PtrCube& operator=(PtrCube const&) = delete;
 
  private:
   /// The pointer cells
-  std::array<std::array<std::array<T*, DIM3>, DIM2>, DIM1> cube_;
+  std::vector<std::vector<std::vector<T*>>> cube_;
 
   /// The backing buffer for the per-cell arrays. Having a common buffer
   /// reduces the number of memory allocations.
   T* backing_buf_;
+  size_t alloc_sz_;
+  size_t dim_2_;
+  size_t dim_3_;
+  size_t n_entries_;
 };
 
 #endif  // MEMORY_MANAGE_H_
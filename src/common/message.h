@@ -195,10 +195,13 @@ struct Packet {
   uint32_t symbol_id_;
   uint32_t cell_id_;
   uint32_t ant_id_;
-  uint32_t fill_[12];  // Padding for 64-byte alignment needed for SIMD
+  // TSC of the host at which the last sample of the symbol was on air, from
+  // the hardware timestamp of the radio. 0 if the receiver has none.
+  uint64_t air_tsc_;
+  uint32_t fill_[10];  // Padding for 64-byte alignment needed for SIMD
   short data_[];       // Elements sent by antennae are two bytes (I/Q samples)
   Packet(int f, int s, int c, int a)  // TODO: Should be unsigned integers
-      : frame_id_(f), symbol_id_(s), cell_id_(c), ant_id_(a) {}
+      : frame_id_(f), symbol_id_(s), cell_id_(c), ant_id_(a), air_tsc_(0) {}
 
   std::string ToString() const {
     std::ostringstream ret;
@@ -208,18 +211,84 @@ struct Packet {
     return ret.str();
   }
 };
+static_assert(sizeof(Packet) == Packet::kOffsetOfData,
+              "The packet header must keep the samples aligned");
+
+/**
+ * @brief Several uplink packets of one frame in one datagram, for jumbo
+ * frames. A compact index of the symbol and antenna of each payload takes the
+ * place of the Packet header, and the payloads follow it back to back, each
+ * as long as the payload of a Packet.
+ */
+struct AggregatePacket {
+  static constexpr size_t kMaxEntries = 12;
+
+  struct Entry {
+    uint16_t symbol_id_;
+    uint16_t ant_id_;  // Antenna of the base station, cell included
+  };
+
+  uint32_t frame_id_;
+  uint32_t num_entries_;
+  uint32_t fill_[2];
+  Entry entries_[kMaxEntries];
+  std::byte data_[];
+
+  /// Datagram bytes of num_entries payloads of payload_bytes
+  static constexpr size_t Length(size_t num_entries, size_t payload_bytes) {
+    return Packet::kOffsetOfData + (num_entries * payload_bytes);
+  }
+  /// The number of payloads, or 0 if num_bytes does not match the index
+  inline size_t NumEntries(size_t num_bytes, size_t payload_bytes) const {
+    if ((num_entries_ == 0) || (num_entries_ > kMaxEntries) ||
+        (num_bytes != Length(num_entries_, payload_bytes))) {
+      return 0;
+    }
+    return num_entries_;
+  }
+  inline const short* Samples(size_t entry, size_t payload_bytes) const {
+    return reinterpret_cast<const short*>(&data_[entry * payload_bytes]);
+  }
+  inline short* Samples(size_t entry, size_t payload_bytes) {
+    return reinterpret_cast<short*>(&data_[entry * payload_bytes]);
+  }
+};
+static_assert(sizeof(AggregatePacket) == Packet::kOffsetOfData,
+              "The aggregate index must keep the payloads aligned");
 
 class RxPacket {
+ public:
+  // Returns the external memory of a packet, see SetExternal()
+  using ReleaseFn = void (*)(void *mem);
+
  private:
   std::atomic<unsigned> references_;
   Packet *packet_;
-
-  inline virtual void GcPacket() {}
+  // Samples outside of the packet, see SetExternalSamples()
+  const short *samples_;
+  void *ext_mem_;
+  ReleaseFn release_;
 
  public:
-  RxPacket() : references_(0) { packet_ = nullptr; }
-  explicit RxPacket(Packet *in) : references_(0) { Set(in); }
-  RxPacket(const RxPacket &copy) : packet_(copy.packet_) {
+  RxPacket()
+      : references_(0),
+        samples_(nullptr),
+        ext_mem_(nullptr),
+        release_(nullptr) {
+    packet_ = nullptr;
+  }
+  explicit RxPacket(Packet *in)
+      : references_(0),
+        samples_(nullptr),
+        ext_mem_(nullptr),
+        release_(nullptr) {
+    Set(in);
+  }
+  RxPacket(const RxPacket &copy)
+      : packet_(copy.packet_),
+        samples_(copy.samples_),
+        ext_mem_(copy.ext_mem_),
+        release_(copy.release_) {
     references_.store(copy.references_.load());
   }
   virtual ~RxPacket() = default;
@@ -236,15 +305,56 @@ class RxPacket {
     }
   }
 
+  /**
+   * @brief Point a packet in use at memory owned by someone else (e.g., the
+   * payload of a DPDK mbuf) instead of copying it in. release(mem) is called
+   * when the last reference is freed. Once set, the packet must get new
+   * external memory every time it is reused.
+   */
+  inline void SetExternal(Packet *in_pkt, void *mem, ReleaseFn release) {
+    packet_ = in_pkt;
+    samples_ = nullptr;
+    ext_mem_ = mem;
+    release_ = release;
+  }
+
+  /**
+   * @brief Keep the header in the packet but read the samples from memory
+   * owned by someone else (e.g., a radio driver's DMA buffer), for memory
+   * with no room for the header in front of the samples. release(mem) is
+   * called when the last reference is freed.
+   */
+  inline void SetExternalSamples(const short *samples, void *mem,
+                                 ReleaseFn release) {
+    samples_ = samples;
+    ext_mem_ = mem;
+    release_ = release;
+  }
+
+  /// Back to the samples in the packet, with no external memory
+  inline void ClearExternal() {
+    samples_ = nullptr;
+    ext_mem_ = nullptr;
+    release_ = nullptr;
+  }
+
   inline Packet *RawPacket() { return packet_; }
+  /// The I/Q samples of the packet, which are not always in RawPacket()
+  inline const short *Samples() {
+    return (samples_ != nullptr) ? samples_ : packet_->data_;
+  }
   inline bool Empty() const { return references_.load() == 0; }
   inline void Use() { references_.fetch_add(1); }
   inline void Free() {
+    // Read before the last reference goes, after which the owner may reuse
+    // the packet
+    void *const ext_mem = ext_mem_;
+    const ReleaseFn release = release_;
     unsigned value = references_.fetch_sub(1);
     if (value == 0) {
       throw std::runtime_error("RxPacket free called when memory was empty");
-    } else if (value == 1) {
-      GcPacket();
+    } else if ((value == 1) && (release != nullptr)) {
+      release(ext_mem);
     }
   }
 };
@@ -338,35 +448,6 @@ union rx_mac_tag_t {
 };
 static_assert(sizeof(rx_mac_tag_t) == sizeof(size_t));
 
-class RxCounters {
- public:
-  // num_pkt[i] is the total number of packets we've received for frame i
-  std::array<size_t, kFrameWnd> num_pkts_;
-
-  // num_pilot_pkts[i] is the total number of pilot packets we've received
-  // for frame i
-  std::array<size_t, kFrameWnd> num_pilot_pkts_;
-
-  // num_rc_pkts[i] is the total number of reciprocity pilot packets we've
-  // received for frame i
-  std::array<size_t, kFrameWnd> num_reciprocity_pkts_;
-
-  // Number of packets we'll receive per frame on the uplink
-  size_t num_rx_pkts_per_frame_;
-
-  // Number of pilot packets we'll receive per frame
-  size_t num_pilot_pkts_per_frame_;
-
-  // Number of reciprocity pilot packets we'll receive per frame
-  size_t num_reciprocity_pkts_per_frame_;
-
-  RxCounters() {
-    num_pkts_.fill(0);
-    num_pilot_pkts_.fill(0);
-    num_reciprocity_pkts_.fill(0);
-  }
-};
-
 /**
  * @brief This class stores the counters corresponding to a frame.
  * Specifically, it contains a) the number of symbols per frame
@@ -418,6 +499,31 @@ class FrameCounters {
    */
   bool CompleteTask(size_t frame_id) { return this->CompleteSymbol(frame_id); }
 
+  /**
+   * @brief Increments the task count for input frame and symbol by all the
+   * tasks of a batched event
+   * @param frame_id The frame id of the tasks to increment
+   * @param symbol_id The symbol id of the tasks to increment
+   * @param num_tasks The number of completed tasks
+   */
+  bool CompleteTasks(size_t frame_id, size_t symbol_id, size_t num_tasks) {
+    const size_t frame_slot = (frame_id % kFrameWnd);
+    this->task_count_.at(frame_slot).at(symbol_id) += num_tasks;
+    return this->IsLastTask(frame_id, symbol_id);
+  }
+
+  /**
+   * @brief Increments the symbol count for input frame by all the tasks of a
+   * batched event
+   * @param frame_id The frame id of the tasks to increment
+   * @param num_tasks The number of completed tasks
+   */
+  bool CompleteTasks(size_t frame_id, size_t num_tasks) {
+    const size_t frame_slot = (frame_id % kFrameWnd);
+    this->symbol_count_.at(frame_slot) += num_tasks;
+    return this->IsLastSymbol(frame_id);
+  }
+
   /**
    * @brief Check whether the symbol is the last symbol for a given frame
    * @param frame id The frame id of the symbol to check
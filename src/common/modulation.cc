@@ -1,5 +1,11 @@
 #include "modulation.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "simd_portable.h"
+
+#if defined(__AVX2__)
 void Print256Epi32(__m256i var) {
   auto* val = reinterpret_cast<int32_t*>(&var);
   std::printf("Numerical: %i %i %i %i %i %i %i %i \n", val[0], val[1], val[2],
@@ -32,6 +38,7 @@ void Print128Epi8(__m128i var) {
       val[0], val[1], val[2], val[3], val[4], val[5], val[6], val[7], val[8],
       val[9], val[10], val[11], val[12], val[13], val[14], val[15]);
 }
+#endif
 
 /**
  ***********************************************************************************
@@ -59,6 +66,9 @@ void InitModulationTable(Table<complex_float>& mod_table,
     case 8:
       InitQam256Table(mod_table);
       break;
+    case 10:
+      InitQam1024Table(mod_table);
+      break;
     default: {
       std::printf(
           "Modulation order %zu not supported, use default value 4 (16QAM)\n",
@@ -203,6 +213,35 @@ void InitQam256Table(Table<complex_float>& qam256_table) {
   }
 }
 
+void InitQam1024Table(Table<complex_float>& qam1024_table) {
+  const float scale = 1 / sqrt(682);
+  /**
+   * The level of the 5 bits of an axis, most significant first, as in
+   * 38.211 5.1.7 with the signs of the QAM256 table: the first bit picks the
+   * sign, and each next bit whether the level is on the inner side of the
+   * middle of the previous bit's interval
+   */
+  float mod_1024qam[32];
+  for (int bits = 0; bits < 32; bits++) {
+    float level = 1;
+    for (int b = 0; b < 4; b++) {
+      const float sign = ((bits >> b) & 0x1) != 0 ? -1 : 1;
+      level = static_cast<float>(2 << b) + sign * level;
+    }
+    mod_1024qam[bits] = ((bits & 0x10) != 0 ? level : -level) * scale;
+  }
+  for (int i = 0; i < 1024; i++) {
+    int imag_i = 0;
+    int real_i = 0;
+    // The odd bits pick the real level and the even bits the imaginary one
+    for (int b = 0; b < 5; b++) {
+      imag_i |= ((i >> (2 * b)) & 0x1) << b;
+      real_i |= ((i >> (2 * b + 1)) & 0x1) << b;
+    }
+    qam1024_table[0][i] = {mod_1024qam[real_i], mod_1024qam[imag_i]};
+  }
+}
+
 /**
  ***********************************************************************************
  * Modulation functions
@@ -217,36 +256,152 @@ complex_float ModSingleUint8(uint8_t x, Table<complex_float>& mod_table) {
   return mod_table[0][x];
 }
 
-// TODO: test correctness
-void ModSimd(uint8_t* in, complex_float*& out, size_t len,
-             Table<complex_float>& mod_table) {
+// The bits of a symbol at even positions whose packed value is axis_idx,
+// e.g. 0b1011 to 0b1000101
+static inline size_t SpreadAxisBits(size_t axis_idx) {
+  size_t bits = 0;
+  for (size_t b = 0; b < 4; b++) {
+    bits |= ((axis_idx >> b) & 0x1) << (2 * b);
+  }
+  return bits;
+}
+
 #ifdef __AVX512F__
-  for (size_t i = 0; i < len / kSCsPerCacheline; i++) {
-    __m512i index = _mm512_setr_epi64(in[0], in[1], in[2], in[3], in[4], in[5],
-                                      in[6], in[7]);
-    __m512d t = _mm512_i64gather_pd(index, (double*)(mod_table[0]), 8);
-    _mm512_store_pd((double*)(out), t);
-    in += kSCsPerCacheline;
-    out += kSCsPerCacheline;
+// Points of 8 symbols, given the bytes of their bits in the low 8 bytes of
+// bytes. Each byte goes to two float lanes: the even lane takes the real
+// (odd) bits and the odd lane the imaginary (even) bits, which are packed
+// and pick the levels.
+template <size_t kModOrderBits>
+static inline __m512 ModPointsAvx512(__m128i bytes, __m512 levels) {
+  static constexpr int kSymbolMask = (1 << kModOrderBits) - 1;
+  const __m512i shift =
+      _mm512_set_epi32(0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1);
+  __m512i idx = _mm512_cvtepu8_epi32(_mm_unpacklo_epi8(bytes, bytes));
+  idx = _mm512_and_si512(_mm512_srlv_epi32(idx, shift),
+                         _mm512_set1_epi32(0x55 & kSymbolMask));
+  if constexpr (kModOrderBits >= 4) {
+    idx = _mm512_and_si512(_mm512_or_si512(idx, _mm512_srli_epi32(idx, 1)),
+                           _mm512_set1_epi32(0x33));
   }
-#else
-  size_t half_size = kSCsPerCacheline / 2;
-  for (size_t i = 0; i < len / kSCsPerCacheline; i++) {
-    __m256i index = _mm256_setr_epi64x(in[0], in[1], in[2], in[3]);
-    __m256d t = _mm256_i64gather_pd((double*)(mod_table[0]), index, 8);
-    _mm256_store_pd((double*)(out), t);
-    in += half_size;
-    out += half_size;
-    index = _mm256_setr_epi64x(in[4], in[5], in[6], in[7]);
-    t = _mm256_i64gather_pd((double*)(mod_table[0]), index, 8);
-    _mm256_store_pd((double*)(out), t);
-    in += half_size;
-    out += half_size;
+  if constexpr (kModOrderBits >= 6) {
+    idx = _mm512_and_si512(_mm512_or_si512(idx, _mm512_srli_epi32(idx, 2)),
+                           _mm512_set1_epi32(0x0F));
+  }
+  return _mm512_permutexvar_ps(idx, levels);
+}
+
+template <size_t kModOrderBits>
+static void ModAvx512(const uint8_t* in, complex_float* out, size_t len,
+                      const float* levels) {
+  const __m512 level_vec = _mm512_load_ps(levels);
+  auto* out_f = reinterpret_cast<float*>(out);
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    const __m128i bytes =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+    _mm512_storeu_ps(out_f + 2 * i,
+                     ModPointsAvx512<kModOrderBits>(bytes, level_vec));
   }
+  if (i < len) {
+    int64_t bytes = 0;
+    std::memcpy(&bytes, in + i, len - i);
+    const auto mask = static_cast<__mmask16>((1u << (2 * (len - i))) - 1);
+    _mm512_mask_storeu_ps(out_f + 2 * i, mask,
+                          ModPointsAvx512<kModOrderBits>(
+                              _mm_cvtsi64_si128(bytes), level_vec));
+  }
+}
+#elif defined(__AVX2__)
+// Points of 4 symbols, given the bytes of their bits in the low 4 bytes of
+// bytes, as ModPointsAvx512 with the levels in two registers
+template <size_t kModOrderBits>
+static inline __m256 ModPointsAvx2(__m128i bytes, __m256 levels_lo,
+                                   __m256 levels_hi) {
+  static constexpr int kSymbolMask = (1 << kModOrderBits) - 1;
+  const __m256i shift = _mm256_set_epi32(0, 1, 0, 1, 0, 1, 0, 1);
+  __m256i idx = _mm256_cvtepu8_epi32(_mm_unpacklo_epi8(bytes, bytes));
+  idx = _mm256_and_si256(_mm256_srlv_epi32(idx, shift),
+                         _mm256_set1_epi32(0x55 & kSymbolMask));
+  if constexpr (kModOrderBits >= 4) {
+    idx = _mm256_and_si256(_mm256_or_si256(idx, _mm256_srli_epi32(idx, 1)),
+                           _mm256_set1_epi32(0x33));
+  }
+  if constexpr (kModOrderBits >= 6) {
+    idx = _mm256_and_si256(_mm256_or_si256(idx, _mm256_srli_epi32(idx, 2)),
+                           _mm256_set1_epi32(0x0F));
+  }
+  const __m256 points = _mm256_permutevar8x32_ps(levels_lo, idx);
+  if constexpr (kModOrderBits < 8) {
+    return points;
+  }
+  // Bit 3 of the packed bits picks the upper 8 levels
+  return _mm256_blendv_ps(points, _mm256_permutevar8x32_ps(levels_hi, idx),
+                          _mm256_castsi256_ps(_mm256_slli_epi32(idx, 28)));
+}
+
+// The symbols up to the last multiple of 4, of which it returns the number
+template <size_t kModOrderBits>
+static size_t ModAvx2(const uint8_t* in, complex_float* out, size_t len,
+                      const float* levels) {
+  const __m256 levels_lo = _mm256_load_ps(levels);
+  const __m256 levels_hi = _mm256_load_ps(levels + 8);
+  auto* out_f = reinterpret_cast<float*>(out);
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    int32_t bytes;
+    std::memcpy(&bytes, in + i, sizeof(bytes));
+    _mm256_storeu_ps(out_f + 2 * i,
+                     ModPointsAvx2<kModOrderBits>(_mm_cvtsi32_si128(bytes),
+                                                  levels_lo, levels_hi));
+  }
+  return i;
+}
 #endif
 
-  size_t remainder = len % kSCsPerCacheline;
-  for (size_t i = 0; i < remainder; i++) {
+void ModSimd(const uint8_t* in, complex_float* out, size_t len,
+             Table<complex_float>& mod_table, size_t mod_order_bits) {
+  size_t done = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+  if (mod_order_bits == 2 || mod_order_bits == 4 || mod_order_bits == 6 ||
+      mod_order_bits == 8) {
+    // The levels of the imaginary axis, which the real axis shares
+    __attribute__((aligned(64))) float levels[16] = {};
+    for (size_t i = 0; i < (1u << (mod_order_bits / 2)); i++) {
+      levels[i] = mod_table[0][SpreadAxisBits(i)].im;
+    }
+#ifdef __AVX512F__
+    switch (mod_order_bits) {
+      case 2:
+        ModAvx512<2>(in, out, len, levels);
+        break;
+      case 4:
+        ModAvx512<4>(in, out, len, levels);
+        break;
+      case 6:
+        ModAvx512<6>(in, out, len, levels);
+        break;
+      default:
+        ModAvx512<8>(in, out, len, levels);
+    }
+    return;
+#elif defined(__AVX2__)
+    switch (mod_order_bits) {
+      case 2:
+        done = ModAvx2<2>(in, out, len, levels);
+        break;
+      case 4:
+        done = ModAvx2<4>(in, out, len, levels);
+        break;
+      case 6:
+        done = ModAvx2<6>(in, out, len, levels);
+        break;
+      default:
+        done = ModAvx2<8>(in, out, len, levels);
+    }
+#endif
+  }
+#endif
+  for (size_t i = done; i < len; i++) {
     out[i] = ModSingleUint8(in[i], mod_table);
   }
 }
@@ -345,6 +500,7 @@ void Demod16qamHardLoop(const float* vec_in, uint8_t* vec_out, int num) {
   }
 }
 
+#if defined(__AVX2__)
 void Demod16qamHardSse(float* vec_in, uint8_t* vec_out, int num) {
   float* symbols_ptr = vec_in;
   auto* result_ptr = reinterpret_cast<__m64*>(vec_out);
@@ -685,6 +841,7 @@ void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
   Demod16qamSoftSse(vec_in + 2 * next_start, llr + next_start * 4,
                     num - next_start);
 }
+#endif
 
 /**
  * 64-QAM modulation
@@ -732,6 +889,7 @@ void Demod64qamHardLoop(const float* vec_in, uint8_t* vec_out, int num) {
   }
 }
 
+#if defined(__AVX2__)
 void Demod64qamHardSse(float* vec_in, uint8_t* vec_out, int num) {
   float* symbols_ptr = vec_in;
   auto* result_ptr = reinterpret_cast<__m64*>(vec_out);
@@ -1247,6 +1405,7 @@ void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
   Demod64qamSoftSse(vec_in + 2 * next_start, llr + next_start * 6,
                     num - next_start);
 }
+#endif
 
 /**
  * 256-QAM Modulation
@@ -1329,6 +1488,7 @@ void Demod256qamHardLoop(const float* vec_in, uint8_t* vec_out, int num) {
   }
 }
 
+#if defined(__AVX2__)
 void Demod256qamHardSse(float* vec_in, uint8_t* vec_out, int num) {
   __m128 symbol1;
   __m128 symbol2;
@@ -1851,6 +2011,7 @@ void Demod256qamHardAvx2(float* vec_in, uint8_t* vec_out, int num) {
   Demod256qamHardSse(vec_in + 2 * next_start, vec_out + next_start,
                      num - next_start);
 }
+#endif
 
 #ifdef __AVX512F__
 
@@ -2201,6 +2362,7 @@ void Demod256qamSoftLoop(const float* vec_in, int8_t* llr, int num) {
   }
 }
 
+#if defined(__AVX2__)
 void Demod256qamSoftSse(const float* vec_in, int8_t* llr, int num) {
   float* symbols_ptr = (float*)vec_in;
   auto* result_ptr = reinterpret_cast<__m128i*>(llr);
@@ -2559,6 +2721,7 @@ void Demod256qamSoftAvx2(const float* vec_in, int8_t* llr, int num) {
   Demod256qamSoftSse(vec_in + 2 * next_start, llr + next_start * 8,
                      num - next_start);
 }
+#endif
 
 #ifdef __AVX512F__
 void Demod256qamSoftAvx512(const float* vec_in, int8_t* llr, int num) {
@@ -2753,35 +2916,499 @@ void Demod256qamSoftAvx512(const float* vec_in, int8_t* llr, int num) {
 }
 #endif
 
+#ifdef __AVX512F__
+/// Hard decision bits of each real or imaginary value of an interleaved
+/// register, at the even bit positions: the final symbol is
+/// (real bits << 1) | imag bits, as in the Demod*HardLoop functions
+template <size_t kModOrderBits>
+static inline __m512i HardBitsAvx512(__m512 values) {
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 abs_values = _mm512_abs_ps(values);
+  auto bits_if = [](__mmask16 mask, int bits) {
+    return _mm512_maskz_mov_epi32(mask, _mm512_set1_epi32(bits));
+  };
+  auto lt = [&abs_values](double threshold) {
+    return _mm512_cmp_ps_mask(abs_values, _mm512_set1_ps(threshold),
+                              _CMP_LT_OQ);
+  };
+
+  if constexpr (kModOrderBits == 2) {
+    return bits_if(_mm512_cmp_ps_mask(values, zero, _CMP_GE_OQ), 0x1);
+  } else if constexpr (kModOrderBits == 4) {
+    return _mm512_or_si512(
+        bits_if(_mm512_cmp_ps_mask(values, zero, _CMP_LE_OQ), 0x4),
+        bits_if(_mm512_cmp_ps_mask(abs_values, _mm512_set1_ps(QAM16_THRESHOLD),
+                                   _CMP_GT_OQ),
+                0x1));
+  } else if constexpr (kModOrderBits == 6) {
+    const __mmask16 gt_2 = _mm512_cmp_ps_mask(
+        abs_values, _mm512_set1_ps(QAM64_THRESHOLD_2), _CMP_GT_OQ);
+    const __mmask16 gt_3 = _mm512_cmp_ps_mask(
+        abs_values, _mm512_set1_ps(QAM64_THRESHOLD_3), _CMP_GT_OQ);
+    const __mmask16 le_1 = _mm512_cmp_ps_mask(
+        abs_values, _mm512_set1_ps(QAM64_THRESHOLD_1), _CMP_LE_OQ);
+    return _mm512_or_si512(
+        _mm512_or_si512(
+            bits_if(_mm512_cmp_ps_mask(values, zero, _CMP_LE_OQ), 0x10),
+            bits_if(gt_2, 0x4)),
+        bits_if(gt_3 | le_1, 0x1));
+  } else if constexpr (kModOrderBits == 10) {
+    auto between = [&lt](int low, int high) {
+      return static_cast<__mmask16>(~lt(QAM1024_THRESHOLD(low)) &
+                                    lt(QAM1024_THRESHOLD(high)));
+    };
+    return _mm512_or_si512(
+        _mm512_or_si512(
+            bits_if(_mm512_cmp_ps_mask(values, zero, _CMP_GT_OQ), 0x100),
+            bits_if(lt(QAM1024_THRESHOLD(8)), 0x40)),
+        _mm512_or_si512(
+            _mm512_or_si512(bits_if(between(4, 12), 0x10),
+                            bits_if(between(2, 6) | between(10, 14), 0x4)),
+            bits_if(between(1, 3) | between(5, 7) | between(9, 11) |
+                        between(13, 15),
+                    0x1)));
+  } else {
+    static_assert(kModOrderBits == 8,
+                  "Unsupported modulation order");
+    const __mmask16 lt_1 = lt(QAM256_THRESHOLD_1);
+    const __mmask16 lt_2 = lt(QAM256_THRESHOLD_2);
+    const __mmask16 lt_3 = lt(QAM256_THRESHOLD_3);
+    const __mmask16 lt_4 = lt(QAM256_THRESHOLD_4);
+    const __mmask16 lt_5 = lt(QAM256_THRESHOLD_5);
+    const __mmask16 lt_6 = lt(QAM256_THRESHOLD_6);
+    const __mmask16 lt_7 = lt(QAM256_THRESHOLD_7);
+    return _mm512_or_si512(
+        _mm512_or_si512(
+            bits_if(_mm512_cmp_ps_mask(values, zero, _CMP_GT_OQ), 0x40),
+            bits_if(lt_4, 0x10)),
+        _mm512_or_si512(
+            bits_if(~lt_2 & lt_6, 0x4),
+            bits_if((~lt_1 & lt_3) | (~lt_5 & lt_7), 0x1)));
+  }
+}
+
+/// Hard-demodulate num symbols, 8 per AVX-512 register, into one Out per
+/// symbol
+template <size_t kModOrderBits, class Out = uint8_t>
+static inline void DemodHardAvx512(const float* vec_in, Out* vec_out,
+                                   int num) {
+  for (int i = 0; i < num; i += 8) {
+    const int rem = std::min(num - i, 8);
+    const __m512i bits = HardBitsAvx512<kModOrderBits>(_mm512_maskz_loadu_ps(
+        static_cast<__mmask16>((1u << (2 * rem)) - 1), vec_in + 2 * i));
+    // Symbol k is (bits[2k] << 1) | bits[2k + 1], in 64-bit lane k
+    const __m512i symbols =
+        _mm512_or_si512(_mm512_maskz_slli_epi64(0xFF, bits, 1),
+                        _mm512_maskz_srli_epi64(0xFF, bits, 32));
+    const auto store_mask = static_cast<__mmask8>((1u << rem) - 1);
+    if constexpr (sizeof(Out) == 1) {
+      _mm512_mask_cvtepi64_storeu_epi8(vec_out + i, store_mask, symbols);
+    } else {
+      _mm512_mask_cvtepi64_storeu_epi16(vec_out + i, store_mask, symbols);
+    }
+  }
+}
+
+void DemodQpskHardAvx512(const float* vec_in, uint8_t* vec_out, int num) {
+  DemodHardAvx512<2>(vec_in, vec_out, num);
+}
+
+void Demod16qamHardAvx512(const float* vec_in, uint8_t* vec_out, int num) {
+  DemodHardAvx512<4>(vec_in, vec_out, num);
+}
+
+void Demod64qamHardAvx512(const float* vec_in, uint8_t* vec_out, int num) {
+  DemodHardAvx512<6>(vec_in, vec_out, num);
+}
+
+void Demod1024qamHardAvx512(const float* vec_in, uint16_t* vec_out, int num) {
+  DemodHardAvx512<10>(vec_in, vec_out, num);
+}
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+/// Soft-demodulate num symbols, 8 per AVX-512 register
+template <size_t kModOrderBits>
+static inline void DemodSoftAvx512(const float* vec_in, int8_t* llr, int num) {
+  int i = 0;
+  for (; i + 8 <= num; i += 8) {
+    DemodSoftAvx512x8<kModOrderBits>(_mm512_loadu_ps(vec_in + 2 * i),
+                                     llr + kModOrderBits * i);
+  }
+  if (i < num) {
+    // Demodulate the last symbols through a scratch buffer
+    int8_t last_llr[8 * kModOrderBits];
+    DemodSoftAvx512x8<kModOrderBits>(
+        _mm512_maskz_loadu_ps(static_cast<__mmask16>((1u << 2 * (num - i)) - 1),
+                              vec_in + 2 * i),
+        last_llr);
+    std::memcpy(llr + kModOrderBits * i, last_llr, kModOrderBits * (num - i));
+  }
+}
+
+void DemodQpskSoftAvx512(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftAvx512<2>(vec_in, llr, num);
+}
+
+void Demod16qamSoftAvx512(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftAvx512<4>(vec_in, llr, num);
+}
+
+void Demod64qamSoftAvx512(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftAvx512<6>(vec_in, llr, num);
+}
+
+void Demod1024qamSoftAvx512(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftAvx512<10>(vec_in, llr, num);
+}
+#endif
+
+/**
+ * QAM1024 with the 5 bits of each axis as in InitQam1024Table(). After the
+ * sign, each bit is set on the inner side of the middle of the intervals of
+ * the previous bit: below QAM1024_THRESHOLD(8), then within 4 thresholds of
+ * it, etc.
+ */
+void Demod1024qamHardLoop(const float* vec_in, uint16_t* vec_out, int num) {
+  auto axis_bits = [](float value) {
+    const float abs_value = std::abs(value);
+    auto between = [abs_value](int low, int high) {
+      return (abs_value >= static_cast<float>(QAM1024_THRESHOLD(low))) &&
+             (abs_value < static_cast<float>(QAM1024_THRESHOLD(high)));
+    };
+    uint16_t bits = 0;
+    if (value > 0) {
+      bits |= 0x100;
+    }
+    if (abs_value < static_cast<float>(QAM1024_THRESHOLD(8))) {
+      bits |= 0x40;
+    }
+    if (between(4, 12)) {
+      bits |= 0x10;
+    }
+    if (between(2, 6) || between(10, 14)) {
+      bits |= 0x4;
+    }
+    if (between(1, 3) || between(5, 7) || between(9, 11) || between(13, 15)) {
+      bits |= 0x1;
+    }
+    return bits;
+  };
+  for (int i = 0; i < num; i++) {
+    vec_out[i] = static_cast<uint16_t>((axis_bits(vec_in[i * 2]) << 1) |
+                                       axis_bits(vec_in[(i * 2) + 1]));
+  }
+}
+
+void Demod1024qamSoftLoop(const float* vec_in, int8_t* llr, int num) {
+  // The max-log LLRs of Demod256qamSoftLoop() with one more level, rounded
+  // and saturated as the vector kernels
+  const int offsets[4] = {
+      static_cast<int8_t>(QAM1024_THRESHOLD(8) * SCALE_BYTE_CONV_QAM1024),
+      static_cast<int8_t>(QAM1024_THRESHOLD(4) * SCALE_BYTE_CONV_QAM1024),
+      static_cast<int8_t>(QAM1024_THRESHOLD(2) * SCALE_BYTE_CONV_QAM1024),
+      static_cast<int8_t>(QAM1024_THRESHOLD(1) * SCALE_BYTE_CONV_QAM1024)};
+  for (int i = 0; i < 2 * num; i++) {
+    const int symbol = i / 2;
+    const int axis = i % 2;
+    int level = static_cast<int>(std::clamp(
+        std::lrint(SCALE_BYTE_CONV_QAM1024 * vec_in[i]), -128L, 127L));
+    llr[10 * symbol + axis] = static_cast<int8_t>(level);
+    for (int k = 0; k < 4; k++) {
+      level = offsets[k] - std::abs(level);
+      llr[10 * symbol + 2 * (k + 1) + axis] = static_cast<int8_t>(level);
+    }
+  }
+}
+
+/// Soft-demodulate the 2 complex symbols of each portable vector, with the
+/// LLR definitions and scaling of the x86 kernels
+template <size_t kModOrderBits>
+static inline void DemodSoftPortableX2(PortableSimd::F32x4 symbols,
+                                       int8_t* llr) {
+  using PortableSimd::I32x4;
+  if constexpr (kModOrderBits == 2) {
+    // Truncated, as the SSE kernel
+    const I32x4 level0 = __builtin_convertvector(
+        PortableSimd::Min(
+            PortableSimd::Max(
+                symbols * PortableSimd::Set1(-SCALE_BYTE_CONV_QPSK * M_SQRT2),
+                PortableSimd::Set1(-128.0f)),
+            PortableSimd::Set1(127.0f)),
+        I32x4);
+    for (size_t i = 0; i < 4; i++) {
+      llr[i] = static_cast<int8_t>(level0[i]);
+    }
+  } else {
+    float scale;
+    int8_t offset[4] = {};
+    if constexpr (kModOrderBits == 4) {
+      scale = SCALE_BYTE_CONV_QAM16;
+      offset[0] = 2 * SCALE_BYTE_CONV_QAM16 / sqrt(10);
+    } else if constexpr (kModOrderBits == 6) {
+      scale = SCALE_BYTE_CONV_QAM64;
+      offset[0] = 4 * SCALE_BYTE_CONV_QAM64 / sqrt(42);
+      offset[1] = 2 * SCALE_BYTE_CONV_QAM64 / sqrt(42);
+    } else if constexpr (kModOrderBits == 8) {
+      scale = SCALE_BYTE_CONV_QAM256;
+      offset[0] = QAM256_THRESHOLD_4 * SCALE_BYTE_CONV_QAM256;
+      offset[1] = QAM256_THRESHOLD_2 * SCALE_BYTE_CONV_QAM256;
+      offset[2] = QAM256_THRESHOLD_1 * SCALE_BYTE_CONV_QAM256;
+    } else {
+      static_assert(kModOrderBits == 10, "Unsupported modulation order");
+      scale = SCALE_BYTE_CONV_QAM1024;
+      offset[0] = QAM1024_THRESHOLD(8) * SCALE_BYTE_CONV_QAM1024;
+      offset[1] = QAM1024_THRESHOLD(4) * SCALE_BYTE_CONV_QAM1024;
+      offset[2] = QAM1024_THRESHOLD(2) * SCALE_BYTE_CONV_QAM1024;
+      offset[3] = QAM1024_THRESHOLD(1) * SCALE_BYTE_CONV_QAM1024;
+    }
+    // Each level is (offset - |previous level|), kept in 32-bit lanes. A
+    // saturated -128 gives the same level as the wrapping int8 abs of the
+    // x86 kernels.
+    I32x4 levels[kModOrderBits / 2];
+    levels[0] = PortableSimd::SaturateInt8(
+        PortableSimd::RoundToInt(symbols * PortableSimd::Set1(scale)));
+    for (size_t k = 1; k < kModOrderBits / 2; k++) {
+      levels[k] = offset[k - 1] - PortableSimd::Abs(levels[k - 1]);
+    }
+    for (size_t sym = 0; sym < PortableSimd::kCxPerVec; sym++) {
+      for (size_t k = 0; k < kModOrderBits / 2; k++) {
+        llr[sym * kModOrderBits + 2 * k] =
+            static_cast<int8_t>(levels[k][2 * sym]);
+        llr[sym * kModOrderBits + 2 * k + 1] =
+            static_cast<int8_t>(levels[k][2 * sym + 1]);
+      }
+    }
+  }
+}
+
+template <size_t kModOrderBits>
+static void DemodSoftPortable(const float* vec_in, int8_t* llr, int num) {
+  const auto n = static_cast<size_t>(num);
+  size_t i = 0;
+  for (; i + PortableSimd::kCxPerVec <= n; i += PortableSimd::kCxPerVec) {
+    DemodSoftPortableX2<kModOrderBits>(
+        PortableSimd::Load<PortableSimd::F32x4>(vec_in + 2 * i),
+        llr + i * kModOrderBits);
+  }
+  if (i < n) {
+    // The odd last symbol, through zero padded buffers
+    const PortableSimd::F32x4 last = {vec_in[2 * i], vec_in[2 * i + 1], 0.0f,
+                                      0.0f};
+    int8_t last_llr[PortableSimd::kCxPerVec * kModOrderBits];
+    DemodSoftPortableX2<kModOrderBits>(last, last_llr);
+    std::memcpy(llr + i * kModOrderBits, last_llr, kModOrderBits);
+  }
+}
+
+void DemodQpskSoftPortable(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftPortable<2>(vec_in, llr, num);
+}
+
+void Demod16qamSoftPortable(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftPortable<4>(vec_in, llr, num);
+}
+
+void Demod64qamSoftPortable(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftPortable<6>(vec_in, llr, num);
+}
+
+void Demod256qamSoftPortable(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftPortable<8>(vec_in, llr, num);
+}
+
+void Demod1024qamSoftPortable(const float* vec_in, int8_t* llr, int num) {
+  DemodSoftPortable<10>(vec_in, llr, num);
+}
+
+namespace {
+using DemodSoftFunc = void (*)(const float*, int8_t*, int);
+using DemodHardFunc = void (*)(const float*, uint8_t*, int);
+using DemodHard16Func = void (*)(const float*, uint16_t*, int);
+
+/// Demodulation kernels indexed by (modulation order / 2) - 1, and the hard
+/// one of QAM1024, whose symbols take two bytes
+struct DemodKernels {
+  std::array<DemodSoftFunc, 5> soft_;
+  std::array<DemodHardFunc, 4> hard_;
+  DemodHard16Func hard_qam1024_;
+};
+
+/// Pick the widest kernels supported by this CPU
+DemodKernels SelectDemodKernels() {
+  DemodKernels kernels;
+#if defined(__AVX2__)
+  // SSE/AVX2 kernels (required by x86 builds)
+  kernels.soft_ = {
+      [](const float* in, int8_t* llr, int num) {
+        DemodQpskSoftSse(const_cast<float*>(in), llr, 2 * num);
+      },
+      [](const float* in, int8_t* llr, int num) {
+        Demod16qamSoftAvx2(const_cast<float*>(in), llr, num);
+      },
+      [](const float* in, int8_t* llr, int num) {
+        Demod64qamSoftAvx2(const_cast<float*>(in), llr, num);
+      },
+      Demod256qamSoftAvx2, Demod1024qamSoftPortable};
+  kernels.hard_ = {
+      DemodQpskHardLoop,
+      [](const float* in, uint8_t* out, int num) {
+        Demod16qamHardAvx2(const_cast<float*>(in), out, num);
+      },
+      [](const float* in, uint8_t* out, int num) {
+        Demod64qamHardAvx2(const_cast<float*>(in), out, num);
+      },
+      [](const float* in, uint8_t* out, int num) {
+        Demod256qamHardAvx2(const_cast<float*>(in), out, num);
+      }};
+#else
+  // Portable kernels, e.g. NEON on aarch64
+  kernels.soft_ = {DemodQpskSoftPortable, Demod16qamSoftPortable,
+                   Demod64qamSoftPortable, Demod256qamSoftPortable,
+                   Demod1024qamSoftPortable};
+  kernels.hard_ = {DemodQpskHardLoop, Demod16qamHardLoop, Demod64qamHardLoop,
+                   Demod256qamHardLoop};
+#endif
+  kernels.hard_qam1024_ = Demod1024qamHardLoop;
+
+#ifdef __AVX512F__
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    kernels.hard_ = {
+        DemodQpskHardAvx512, Demod16qamHardAvx512, Demod64qamHardAvx512,
+        [](const float* in, uint8_t* out, int num) {
+          Demod256qamHardAvx512(const_cast<float*>(in), out, num);
+        }};
+    kernels.hard_qam1024_ = Demod1024qamHardAvx512;
+  }
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    kernels.soft_ = {DemodQpskSoftAvx512, Demod16qamSoftAvx512,
+                     Demod64qamSoftAvx512, Demod256qamSoftAvx512,
+                     Demod1024qamSoftAvx512};
+  }
+#endif
+  return kernels;
+}
+
+/// Selected once, on first use
+const DemodKernels& GetDemodKernels() {
+  static const DemodKernels kKernels = SelectDemodKernels();
+  return kKernels;
+}
+}  // namespace
+
 void Demodulate(float* equal_ptr, int8_t* demod_ptr, size_t data_num,
                 size_t mod, bool hard_demod) {
-  switch (mod) {
-    case 2:
-      hard_demod
-          ? DemodQpskHardLoop(equal_ptr, reinterpret_cast<uint8_t*>(demod_ptr),
-                              data_num)
-          : DemodQpskSoftSse(equal_ptr, demod_ptr, data_num);
-      break;
-    case 4:
-      hard_demod
-          ? Demod16qamHardAvx2(equal_ptr, reinterpret_cast<uint8_t*>(demod_ptr),
-                               data_num)
-          : Demod16qamSoftAvx2(equal_ptr, demod_ptr, data_num);
-      break;
-    case 6:
-      hard_demod
-          ? Demod64qamHardAvx2(equal_ptr, reinterpret_cast<uint8_t*>(demod_ptr),
-                               data_num)
-          : Demod64qamSoftAvx2(equal_ptr, demod_ptr, data_num);
-      break;
-    case 8:
-      hard_demod
-          ? Demod256qamHardAvx2(equal_ptr,
-                                reinterpret_cast<uint8_t*>(demod_ptr), data_num)
-          : Demod256qamSoftAvx2(equal_ptr, demod_ptr, data_num);
-      break;
-    default:
-      std::printf("Demodulation: modulation type %s not supported!\n",
-                  MapModToStr(mod).c_str());
+  if (mod != 2 && mod != 4 && mod != 6 && mod != 8 && mod != 10) {
+    std::printf("Demodulation: modulation type %s not supported!\n",
+                MapModToStr(mod).c_str());
+    return;
+  }
+  const DemodKernels& kernels = GetDemodKernels();
+  const size_t kernel_idx = (mod / 2) - 1;
+  const int num = static_cast<int>(data_num);
+  if (hard_demod && (mod == 10)) {
+    kernels.hard_qam1024_(equal_ptr, reinterpret_cast<uint16_t*>(demod_ptr),
+                          num);
+  } else if (hard_demod) {
+    kernels.hard_[kernel_idx](equal_ptr, reinterpret_cast<uint8_t*>(demod_ptr),
+                              num);
+  } else {
+    kernels.soft_[kernel_idx](equal_ptr, demod_ptr, num);
+  }
+}
+
+/**
+ * Expand hard decision bits (most significant bit first) into one LLR per
+ * bit: 0x81 for a 1 and 0x7F for a 0
+ */
+void TranslateToLLRLoop(const uint8_t* encoded_bits, int8_t* llr,
+                        size_t bit_len, int8_t llr_magnitude) {
+  for (size_t bit_idx = 0; bit_idx < bit_len; bit_idx++) {
+    const uint8_t byte = encoded_bits[bit_idx / 8];
+    llr[bit_idx] =
+        (byte & (0x80 >> (bit_idx % 8))) ? -llr_magnitude : llr_magnitude;
+  }
+}
+
+#ifdef __AVX2__
+void TranslateToLLRAvx2(const uint8_t* encoded_bits, int8_t* llr,
+                        size_t bit_len, int8_t llr_magnitude) {
+  // Byte i of the output tests bit (7 - i % 8) of input byte i / 8
+  const __m256i byte_idx =
+      _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2,
+                       2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  const __m256i bit_sel = _mm256_set1_epi64x(0x0102040810204080);
+  const __m256i llr_zero = _mm256_set1_epi8(llr_magnitude);
+  const __m256i llr_one =
+      _mm256_set1_epi8(static_cast<int8_t>(-llr_magnitude));
+
+  size_t bit_idx = 0;
+  for (; bit_idx + 32 <= bit_len; bit_idx += 32) {
+    int32_t bytes;
+    std::memcpy(&bytes, encoded_bits + bit_idx / 8, sizeof(bytes));
+    const __m256i bits = _mm256_and_si256(
+        _mm256_shuffle_epi8(_mm256_set1_epi32(bytes), byte_idx), bit_sel);
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(llr + bit_idx),
+        _mm256_blendv_epi8(llr_zero, llr_one,
+                           _mm256_cmpeq_epi8(bits, bit_sel)));
+  }
+  TranslateToLLRLoop(encoded_bits + bit_idx / 8, llr + bit_idx,
+                     bit_len - bit_idx, llr_magnitude);
+}
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+void TranslateToLLRAvx512(const uint8_t* encoded_bits, int8_t* llr,
+                          size_t bit_len, int8_t llr_magnitude) {
+  // Byte i of the output tests bit (7 - i % 8) of input byte i / 8. The
+  // shuffle stays within 128-bit lanes, which all hold the 8 input bytes.
+  const __m512i shuffle_idx = _mm512_set_epi64(
+      0x0707070707070707, 0x0606060606060606, 0x0505050505050505,
+      0x0404040404040404, 0x0303030303030303, 0x0202020202020202,
+      0x0101010101010101, 0x0000000000000000);
+  const __m512i bit_sel = _mm512_set1_epi64(0x0102040810204080);
+  const __m512i llr_zero = _mm512_set1_epi8(llr_magnitude);
+  const __m512i llr_one =
+      _mm512_set1_epi8(static_cast<int8_t>(-llr_magnitude));
+
+  for (size_t bit_idx = 0; bit_idx < bit_len; bit_idx += 64) {
+    const size_t num_bits = std::min<size_t>(bit_len - bit_idx, 64);
+    int64_t bytes = 0;
+    std::memcpy(&bytes, encoded_bits + bit_idx / 8, (num_bits + 7) / 8);
+    const __mmask64 ones = _mm512_test_epi8_mask(
+        _mm512_shuffle_epi8(_mm512_set1_epi64(bytes), shuffle_idx), bit_sel);
+    const __mmask64 store_mask =
+        (num_bits == 64) ? ~0ull : ((1ull << num_bits) - 1);
+    _mm512_mask_storeu_epi8(llr + bit_idx, store_mask,
+                            _mm512_mask_blend_epi8(ones, llr_zero, llr_one));
   }
 }
+#endif
+
+void TranslateToLLR(const uint8_t* encoded_bits, int8_t* llr,
+                    size_t bit_len, int8_t llr_magnitude) {
+  using TranslateFunc = void (*)(const uint8_t*, int8_t*, size_t, int8_t);
+  // Selected once, on first use
+  static const TranslateFunc kTranslate = []() -> TranslateFunc {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw")) {
+      return TranslateToLLRAvx512;
+    }
+#endif
+#ifdef __AVX2__
+    if (__builtin_cpu_supports("avx2")) {
+      return TranslateToLLRAvx2;
+    }
+#endif
+    return TranslateToLLRLoop;
+  }();
+  kTranslate(encoded_bits, llr, bit_len, llr_magnitude);
+}
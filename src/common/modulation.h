@@ -1,9 +1,12 @@
 #ifndef MODULATION_H_
 #define MODULATION_H_
 
+#if defined(__x86_64__)
 #include <emmintrin.h>
 #include <immintrin.h>
+#endif
 
+#include <array>
 #include <cmath>
 #include <iostream>
 
@@ -20,6 +23,7 @@
 #define SCALE_BYTE_CONV_QAM16 100
 #define SCALE_BYTE_CONV_QAM64 100
 #define SCALE_BYTE_CONV_QAM256 100
+#define SCALE_BYTE_CONV_QAM1024 100
 #define QAM16_THRESHOLD (2 / sqrt(10))
 #define QAM64_THRESHOLD_1 (2 / sqrt(42))
 #define QAM64_THRESHOLD_2 (4 / sqrt(42))
@@ -31,6 +35,8 @@
 #define QAM256_THRESHOLD_5 (10 / sqrt(170))
 #define QAM256_THRESHOLD_6 (12 / sqrt(170))
 #define QAM256_THRESHOLD_7 (14 / sqrt(170))
+// Threshold k of QAM1024, half way between the levels 2k - 1 and 2k + 1
+#define QAM1024_THRESHOLD(k) ((2 * (k)) / sqrt(682))
 
 static const std::map<std::string, size_t> kModulStringMap{
     {"BPSK", 1},  {"QPSK", 2},   {"16QAM", 4},
@@ -60,45 +66,268 @@ void InitQpskTable(Table<complex_float>& table);
 void InitQam16Table(Table<complex_float>& table);
 void InitQam64Table(Table<complex_float>& table);
 void InitQam256Table(Table<complex_float>& table);
+void InitQam1024Table(Table<complex_float>& table);
 
 complex_float ModSingle(int x, Table<complex_float>& mod_table);
 complex_float ModSingleUint8(uint8_t x, Table<complex_float>& mod_table);
-void ModSimd(uint8_t* in, complex_float*& out, size_t len,
-             Table<complex_float>& mod_table);
+/**
+ * @brief Modulate len symbols without table gathers
+ *
+ * @param in One symbol of mod_order_bits bits per byte, as AdaptBitsForMod
+ * leaves them
+ * @param mod_table The constellation of mod_order_bits, from
+ * InitModulationTable()
+ *
+ * The real and imaginary parts of the QPSK to 256QAM constellations each
+ * take one of up to 16 levels, picked by the odd and the even bits of a
+ * symbol. The levels sit in one register (two with AVX2), and the points of
+ * 8 symbols (4 with AVX2) come from one permute by the packed bits. Other
+ * modulation orders use ModSingleUint8().
+ */
+void ModSimd(const uint8_t* in, complex_float* out, size_t len,
+             Table<complex_float>& mod_table, size_t mod_order_bits);
 
 void DemodQpskHardLoop(const float* vec_in, uint8_t* vec_out, int num);
+#if defined(__AVX2__)
 void DemodQpskSoftSse(float* x, int8_t* z, int len);
+#endif
+#ifdef __AVX512F__
+void DemodQpskHardAvx512(const float* vec_in, uint8_t* vec_out, int num);
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+void DemodQpskSoftAvx512(const float* vec_in, int8_t* llr, int num);
+#endif
 
 void Demod16qamHardLoop(const float* vec_in, uint8_t* vec_out, int num);
+#if defined(__AVX2__)
 void Demod16qamHardSse(float* vec_in, uint8_t* vec_out, int num);
 void Demod16qamHardAvx2(float* vec_in, uint8_t* vec_out, int num);
+#endif
+#ifdef __AVX512F__
+void Demod16qamHardAvx512(const float* vec_in, uint8_t* vec_out, int num);
+#endif
 
 void Demod16qamSoftLoop(const float* vec_in, int8_t* llr, int num);
+#if defined(__AVX2__)
 void Demod16qamSoftSse(float* vec_in, int8_t* llr, int num);
 void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num);
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+void Demod16qamSoftAvx512(const float* vec_in, int8_t* llr, int num);
+#endif
 
 void Demod64qamHardLoop(const float* vec_in, uint8_t* vec_out, int num);
+#if defined(__AVX2__)
 void Demod64qamHardSse(float* vec_in, uint8_t* vec_out, int num);
 void Demod64qamHardAvx2(float* vec_in, uint8_t* vec_out, int num);
+#endif
+#ifdef __AVX512F__
+void Demod64qamHardAvx512(const float* vec_in, uint8_t* vec_out, int num);
+#endif
 
 void Demod64qamSoftLoop(const float* vec_in, int8_t* llr, int num);
+#if defined(__AVX2__)
 void Demod64qamSoftSse(float* vec_in, int8_t* llr, int num);
 void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num);
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+void Demod64qamSoftAvx512(const float* vec_in, int8_t* llr, int num);
+#endif
 
 void Demod256qamHardLoop(const float* vec_in, uint8_t* vec_out, int num);
+#if defined(__AVX2__)
 void Demod256qamHardSse(float* vec_in, uint8_t* vec_out, int num);
 void Demod256qamHardAvx2(float* vec_in, uint8_t* vec_out, int num);
+#endif
 #ifdef __AVX512F__
 void Demod256qamHardAvx512(float* vec_in, uint8_t* vec_out, int num);
 #endif
 void Demod256qamSoftLoop(const float* vec_in, int8_t* llr, int num);
+#if defined(__AVX2__)
 void Demod256qamSoftSse(const float* vec_in, int8_t* llr, int num);
 void Demod256qamSoftAvx2(const float* vec_in, int8_t* llr, int num);
+#endif
 
 #ifdef __AVX512F__
 void Demod256qamSoftAvx512(const float* vec_in, int8_t* llr, int num);
 #endif
+
+/// QAM1024 symbols take 10 bits, so the hard demodulators write one
+/// uint16_t per symbol
+void Demod1024qamHardLoop(const float* vec_in, uint16_t* vec_out, int num);
+#ifdef __AVX512F__
+void Demod1024qamHardAvx512(const float* vec_in, uint16_t* vec_out, int num);
+#endif
+void Demod1024qamSoftLoop(const float* vec_in, int8_t* llr, int num);
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+void Demod1024qamSoftAvx512(const float* vec_in, int8_t* llr, int num);
+#endif
+
+/// Soft demodulation on the portable vectors of simd_portable.h (NEON on
+/// aarch64), with the same LLRs as the x86 kernels. Used by builds without
+/// AVX2.
+void DemodQpskSoftPortable(const float* vec_in, int8_t* llr, int num);
+void Demod16qamSoftPortable(const float* vec_in, int8_t* llr, int num);
+void Demod64qamSoftPortable(const float* vec_in, int8_t* llr, int num);
+void Demod256qamSoftPortable(const float* vec_in, int8_t* llr, int num);
+void Demod1024qamSoftPortable(const float* vec_in, int8_t* llr, int num);
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+/// Word permutation that interleaves kLevels vectors of 8 (real, imag) LLR
+/// pairs, stored in consecutive 128-bit lanes, into per-symbol order
+template <size_t kLevels>
+static constexpr std::array<uint16_t, 32> LlrInterleaveIndex() {
+  std::array<uint16_t, 32> index{};
+  for (size_t i = 0; i < 8 * kLevels; i++) {
+    index[i] = static_cast<uint16_t>((i % kLevels) * 8 + i / kLevels);
+  }
+  return index;
+}
+
+/// Interleave the LLR pairs of 8 symbols, kLevels 128-bit lanes in levels
+/// (one lane per LLR pair index), into per-symbol order and store them
+template <size_t kLevels>
+static inline void StoreLlrLevelsAvx512(__m512i levels, int8_t* llr) {
+  static constexpr std::array<uint16_t, 32> kIndex =
+      LlrInterleaveIndex<kLevels>();
+  levels =
+      _mm512_permutexvar_epi16(_mm512_loadu_si512(kIndex.data()), levels);
+  constexpr __mmask64 kStoreMask =
+      (kLevels == 4) ? ~0ull : ((1ull << (16 * kLevels)) - 1);
+  _mm512_mask_storeu_epi8(llr, kStoreMask, levels);
+}
+
+/// Word permutation that interleaves the 5 LLR pairs of 8 symbols, levels 0
+/// to 3 in the lanes of the first register (indices 0 to 31) and level 4 in
+/// the low lane of the second (indices 32 and up), into per-symbol order
+static constexpr std::array<uint16_t, 40> LlrInterleaveIndex5() {
+  std::array<uint16_t, 40> index{};
+  for (size_t i = 0; i < index.size(); i++) {
+    const size_t level = i % 5;
+    const size_t symbol = i / 5;
+    index[i] = static_cast<uint16_t>(
+        (level < 4) ? (level * 8 + symbol) : (32 + symbol));
+  }
+  return index;
+}
+
+/// StoreLlrLevelsAvx512() of the 5 levels of QAM1024, 80 bytes
+static inline void StoreLlrLevels5Avx512(__m512i levels, __m512i level4,
+                                         int8_t* llr) {
+  static constexpr std::array<uint16_t, 40> kIndex = LlrInterleaveIndex5();
+  _mm512_storeu_si512(
+      llr, _mm512_permutex2var_epi16(
+               levels, _mm512_loadu_si512(kIndex.data()), level4));
+  // The last 8 words, with indices 32 to 39 in the low lane
+  const __m512i last_index = _mm512_zextsi128_si512(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(kIndex.data() + 32)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(llr + 64),
+                   _mm512_castsi512_si128(_mm512_permutex2var_epi16(
+                       levels, last_index, level4)));
+}
+
+/// Soft-demodulate the 8 complex symbols (interleaved real and imaginary
+/// parts) held in one AVX-512 register into 8 * kModOrderBits LLRs, with the
+/// same LLR definitions and scaling as Demodulate(). Used to demodulate
+/// equalized symbols without storing them to memory first.
+template <size_t kModOrderBits>
+static inline void DemodSoftAvx512x8(__m512 symbols, int8_t* llr) {
+  static_assert(kModOrderBits == 2 || kModOrderBits == 4 ||
+                    kModOrderBits == 6 || kModOrderBits == 8 ||
+                    kModOrderBits == 10,
+                "Unsupported modulation order");
+  if constexpr (kModOrderBits == 2) {
+    // The maskz forms avoid GCC's uninitialized warnings on the plain ones
+    const __m512i symbol_i = _mm512_maskz_cvttps_epi32(
+        0xFFFF, _mm512_mul_ps(symbols,
+                              _mm512_set1_ps(-SCALE_BYTE_CONV_QPSK * M_SQRT2)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(llr),
+                     _mm512_maskz_cvtsepi32_epi8(0xFFFF, symbol_i));
+  } else {
+    float scale;
+    int8_t offset1;
+    int8_t offset2 = 0;
+    int8_t offset3 = 0;
+    int8_t offset4 = 0;
+    if constexpr (kModOrderBits == 4) {
+      scale = SCALE_BYTE_CONV_QAM16;
+      offset1 = 2 * SCALE_BYTE_CONV_QAM16 / sqrt(10);
+    } else if constexpr (kModOrderBits == 6) {
+      scale = SCALE_BYTE_CONV_QAM64;
+      offset1 = 4 * SCALE_BYTE_CONV_QAM64 / sqrt(42);
+      offset2 = 2 * SCALE_BYTE_CONV_QAM64 / sqrt(42);
+    } else if constexpr (kModOrderBits == 8) {
+      scale = SCALE_BYTE_CONV_QAM256;
+      offset1 = QAM256_THRESHOLD_4 * SCALE_BYTE_CONV_QAM256;
+      offset2 = QAM256_THRESHOLD_2 * SCALE_BYTE_CONV_QAM256;
+      offset3 = QAM256_THRESHOLD_1 * SCALE_BYTE_CONV_QAM256;
+    } else {
+      scale = SCALE_BYTE_CONV_QAM1024;
+      offset1 = QAM1024_THRESHOLD(8) * SCALE_BYTE_CONV_QAM1024;
+      offset2 = QAM1024_THRESHOLD(4) * SCALE_BYTE_CONV_QAM1024;
+      offset3 = QAM1024_THRESHOLD(2) * SCALE_BYTE_CONV_QAM1024;
+      offset4 = QAM1024_THRESHOLD(1) * SCALE_BYTE_CONV_QAM1024;
+    }
+
+    // Saturating conversion to int8, as with the packs of the AVX2 kernels
+    const __m128i level0 = _mm512_maskz_cvtsepi32_epi8(
+        0xFFFF, _mm512_maskz_cvtps_epi32(
+                    0xFFFF, _mm512_mul_ps(symbols, _mm512_set1_ps(scale))));
+    const __m128i level1 =
+        _mm_sub_epi8(_mm_set1_epi8(offset1), _mm_abs_epi8(level0));
+    __m512i levels =
+        _mm512_inserti32x4(_mm512_zextsi128_si512(level0), level1, 1);
+    if constexpr (kModOrderBits >= 6) {
+      const __m128i level2 =
+          _mm_sub_epi8(_mm_set1_epi8(offset2), _mm_abs_epi8(level1));
+      levels = _mm512_inserti32x4(levels, level2, 2);
+      if constexpr (kModOrderBits >= 8) {
+        const __m128i level3 =
+            _mm_sub_epi8(_mm_set1_epi8(offset3), _mm_abs_epi8(level2));
+        levels = _mm512_inserti32x4(levels, level3, 3);
+      }
+    }
+    if constexpr (kModOrderBits == 10) {
+      // The fifth level takes a second register
+      const __m128i level4 = _mm_sub_epi8(
+          _mm_set1_epi8(offset4),
+          _mm_abs_epi8(_mm512_extracti32x4_epi32(levels, 3)));
+      StoreLlrLevels5Avx512(levels, _mm512_zextsi128_si512(level4), llr);
+    } else {
+      StoreLlrLevelsAvx512<kModOrderBits / 2>(levels, llr);
+    }
+  }
+}
+#endif
+
+#if defined(__AVX2__)
 void Print256Epi8(__m256i var);
+#endif
+/// Magnitude of a hard decision LLR in the demodulator's LLR format
+static constexpr int8_t kHardLlrMagnitude = 0x7F;
+void TranslateToLLRLoop(const uint8_t* encoded_bits, int8_t* llr,
+                        size_t bit_len,
+                        int8_t llr_magnitude = kHardLlrMagnitude);
+#ifdef __AVX2__
+void TranslateToLLRAvx2(const uint8_t* encoded_bits, int8_t* llr,
+                        size_t bit_len,
+                        int8_t llr_magnitude = kHardLlrMagnitude);
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+void TranslateToLLRAvx512(const uint8_t* encoded_bits, int8_t* llr,
+                          size_t bit_len,
+                          int8_t llr_magnitude = kHardLlrMagnitude);
+#endif
+/// Expand bit_len hard decision bits into -llr_magnitude (bit 1) /
+/// llr_magnitude (bit 0) LLRs, 0x81 / 0x7F by default, with the widest
+/// kernel supported by the CPU (chosen once through CPUID). A decoder that
+/// takes another LLR format gets its saturated hard LLR as llr_magnitude.
+void TranslateToLLR(const uint8_t* encoded_bits, int8_t* llr, size_t bit_len,
+                    int8_t llr_magnitude = kHardLlrMagnitude);
+
+/// Demodulate data_num symbols with the widest soft or hard demodulation
+/// kernels supported by the CPU (chosen once through CPUID). The hard
+/// decisions of QAM1024 are one uint16_t per symbol.
 void Demodulate(float* equal_ptr, int8_t* demod_ptr, size_t data_num,
                 size_t mod, bool hard_demod);
 
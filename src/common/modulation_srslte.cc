@@ -33,6 +33,7 @@ void Demod16qamSoftLoop(const float* vec_in, int8_t* llr, int num) {
   }
 }
 
+#if defined(__AVX2__)
 void Demod16qamSoftSse(float* vec_in, int8_t* llr, int num) {
   float* symbols_ptr = vec_in;
   auto* result_ptr = reinterpret_cast<__m128i*>(llr);
@@ -113,6 +114,7 @@ void Demod16qamSoftSse(float* vec_in, int8_t* llr, int num) {
   //     vec_in[2*i+1], llr[4*i+0], llr[4*i+1], llr[4*i+2], llr[4*i+3]);
   // }
 }
+#endif
 
 void Demod64qamSoftLoop(const float* vec_in, int8_t* llr, int num) {
   for (int i = 0; i < num; i++) {
@@ -128,6 +130,7 @@ void Demod64qamSoftLoop(const float* vec_in, int8_t* llr, int num) {
   }
 }
 
+#if defined(__AVX2__)
 void Demod64qamSoftSse(float* vec_in, int8_t* llr, int num) {
   auto* symbols_ptr = static_cast<float*>(vec_in);
   auto* result_ptr = reinterpret_cast<__m128i*>(llr);
@@ -301,3 +304,4 @@ void DemodQpskSoftSse(float* x, int8_t* z, int len) {
     z[i] = (int8_t)(x[i] * -SCALE_BYTE_CONV_QPSK * M_SQRT2);
   }
 }
+#endif
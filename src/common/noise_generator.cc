@@ -0,0 +1,242 @@
+/**
+ * @file noise_generator.cc
+ * @brief Implementation file for the NoiseGenerator class
+ */
+#include "noise_generator.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+// Philox4x32 multipliers and Weyl key increments
+static constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+static constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+static constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+static constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+static constexpr size_t kPhiloxRounds = 10;
+// Counters per group, one per AVX-512 lane
+static constexpr size_t kGroupCounters = NoiseGenerator::kGroupSize / 4;
+static constexpr float kTwoPi = 6.283185307179586f;
+// 24-bit uniform values
+static constexpr float kUniformScale = 1.0f / 16777216.0f;
+
+NoiseGenerator::NoiseGenerator(uint64_t seed, uint64_t stream)
+    : key_({static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}),
+      stream_(stream),
+      group_(0),
+      buffer_(),
+      buffer_pos_(kGroupSize) {}
+
+std::array<uint32_t, 4> NoiseGenerator::Philox(std::array<uint32_t, 4> counter,
+                                               std::array<uint32_t, 2> key) {
+  for (size_t round = 0; round < kPhiloxRounds; round++) {
+    const uint64_t prod0 = static_cast<uint64_t>(kPhiloxM0) * counter[0];
+    const uint64_t prod1 = static_cast<uint64_t>(kPhiloxM1) * counter[2];
+    counter = {static_cast<uint32_t>(prod1 >> 32) ^ counter[1] ^ key[0],
+               static_cast<uint32_t>(prod1),
+               static_cast<uint32_t>(prod0 >> 32) ^ counter[3] ^ key[1],
+               static_cast<uint32_t>(prod0)};
+    key[0] += kPhiloxW0;
+    key[1] += kPhiloxW1;
+  }
+  return counter;
+}
+
+void NoiseGenerator::Seek(uint64_t position) {
+  group_ = position;
+  buffer_pos_ = kGroupSize;
+}
+
+#if defined(__AVX512F__)
+// High and low 32 bits of the products of the 16 lanes of a with m
+static inline void MulHiLo(__m512i a, __m512i m, __m512i& hi, __m512i& lo) {
+  // Products of the even and the odd lanes
+  const __m512i prod_even = _mm512_mul_epu32(a, m);
+  const __m512i prod_odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+  lo = _mm512_mask_blend_epi32(0xAAAA, prod_even,
+                               _mm512_slli_epi64(prod_odd, 32));
+  hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(prod_even, 32),
+                               prod_odd);
+}
+
+// Natural logarithm of x > 0, from the Cephes logf
+static inline __m512 Log(__m512 x) {
+  // x = m * 2^e with m in [sqrt(0.5), sqrt(2))
+  __m512 e = _mm512_add_ps(_mm512_getexp_ps(x), _mm512_set1_ps(1.0f));
+  __m512 m = _mm512_getmant_ps(x, _MM_MANT_NORM_p5_1, _MM_MANT_SIGN_src);
+  const __mmask16 small = _mm512_cmp_ps_mask(
+      m, _mm512_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+  e = _mm512_mask_sub_ps(e, small, e, _mm512_set1_ps(1.0f));
+  m = _mm512_mask_add_ps(m, small, m, m);
+  m = _mm512_sub_ps(m, _mm512_set1_ps(1.0f));
+
+  const __m512 z = _mm512_mul_ps(m, m);
+  __m512 p = _mm512_set1_ps(7.0376836292e-2f);
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-1.1514610310e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(1.1676998740e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-1.2420140846e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(1.4249322787e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-1.6668057665e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(2.0000714765e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(-2.4999993993e-1f));
+  p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(3.3333331174e-1f));
+  __m512 y = _mm512_mul_ps(_mm512_mul_ps(p, m), z);
+  y = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440e-4f), y);
+  y = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), y);
+  return _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f),
+                         _mm512_add_ps(m, y));
+}
+
+// Cosine and sine of 2 * pi * u for u in [0, 1), from the Cephes sinf and
+// cosf polynomials
+static inline void SinCos2Pi(__m512 u, __m512& c, __m512& s) {
+  // 2 * pi * u = q * pi / 2 + a with a in [-pi / 4, pi / 4]
+  const __m512 t = _mm512_mul_ps(u, _mm512_set1_ps(4.0f));
+  const __m512 q = _mm512_roundscale_ps(
+      t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  const __m512 a =
+      _mm512_mul_ps(_mm512_sub_ps(t, q), _mm512_set1_ps(kTwoPi / 4.0f));
+  const __m512 a2 = _mm512_mul_ps(a, a);
+
+  __m512 sin_a = _mm512_set1_ps(-1.9515295891e-4f);
+  sin_a = _mm512_fmadd_ps(sin_a, a2, _mm512_set1_ps(8.3321608736e-3f));
+  sin_a = _mm512_fmadd_ps(sin_a, a2, _mm512_set1_ps(-1.6666654611e-1f));
+  sin_a = _mm512_fmadd_ps(_mm512_mul_ps(sin_a, a2), a, a);
+  __m512 cos_a = _mm512_set1_ps(2.443315711809948e-5f);
+  cos_a = _mm512_fmadd_ps(cos_a, a2, _mm512_set1_ps(-1.388731625493765e-3f));
+  cos_a = _mm512_fmadd_ps(cos_a, a2, _mm512_set1_ps(4.166664568298827e-2f));
+  cos_a = _mm512_fmadd_ps(_mm512_mul_ps(cos_a, a2), a2,
+                          _mm512_fnmadd_ps(a2, _mm512_set1_ps(0.5f),
+                                           _mm512_set1_ps(1.0f)));
+
+  // Rotate by the quadrant
+  const __m512i quadrant =
+      _mm512_and_si512(_mm512_cvtps_epi32(q), _mm512_set1_epi32(3));
+  const __mmask16 odd =
+      _mm512_test_epi32_mask(quadrant, _mm512_set1_epi32(1));
+  // The cosine is negative in quadrants 1 and 2, the sine in 2 and 3
+  const __mmask16 neg_cos = _mm512_cmplt_epu32_mask(
+      _mm512_sub_epi32(quadrant, _mm512_set1_epi32(1)), _mm512_set1_epi32(2));
+  const __mmask16 neg_sin =
+      _mm512_cmpge_epi32_mask(quadrant, _mm512_set1_epi32(2));
+  c = _mm512_mask_blend_ps(odd, cos_a, sin_a);
+  s = _mm512_mask_blend_ps(odd, sin_a, cos_a);
+  const __m512 zero = _mm512_setzero_ps();
+  c = _mm512_mask_sub_ps(c, neg_cos, zero, c);
+  s = _mm512_mask_sub_ps(s, neg_sin, zero, s);
+}
+
+template <bool kAdd>
+void NoiseGenerator::NextGroup(float* out, float std_dev) {
+  const uint64_t first = group_ * kGroupCounters;
+  __m512i ctr0 = _mm512_add_epi32(
+      _mm512_set1_epi32(static_cast<int>(first)),
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+  __m512i ctr1 = _mm512_set1_epi32(static_cast<int>(first >> 32));
+  __m512i ctr2 = _mm512_set1_epi32(static_cast<int>(stream_));
+  __m512i ctr3 = _mm512_set1_epi32(static_cast<int>(stream_ >> 32));
+  __m512i key0 = _mm512_set1_epi32(static_cast<int>(key_[0]));
+  __m512i key1 = _mm512_set1_epi32(static_cast<int>(key_[1]));
+  const __m512i m0 = _mm512_set1_epi64(kPhiloxM0);
+  const __m512i m1 = _mm512_set1_epi64(kPhiloxM1);
+  for (size_t round = 0; round < kPhiloxRounds; round++) {
+    __m512i hi0;
+    __m512i lo0;
+    __m512i hi1;
+    __m512i lo1;
+    MulHiLo(ctr0, m0, hi0, lo0);
+    MulHiLo(ctr2, m1, hi1, lo1);
+    ctr0 = _mm512_xor_si512(_mm512_xor_si512(hi1, ctr1), key0);
+    ctr1 = lo1;
+    ctr2 = _mm512_xor_si512(_mm512_xor_si512(hi0, ctr3), key1);
+    ctr3 = lo0;
+    key0 = _mm512_add_epi32(key0, _mm512_set1_epi32(kPhiloxW0));
+    key1 = _mm512_add_epi32(key1, _mm512_set1_epi32(kPhiloxW1));
+  }
+  const __m512i words[4] = {ctr0, ctr1, ctr2, ctr3};
+
+  const __m512 scale = _mm512_set1_ps(kUniformScale);
+  const __m512 sd = _mm512_set1_ps(std_dev);
+  for (size_t pair = 0; pair < 2; pair++) {
+    // u1 in (0, 1] for the logarithm, u2 in [0, 1)
+    const __m512 u1 = _mm512_mul_ps(
+        _mm512_cvtepi32_ps(_mm512_add_epi32(
+            _mm512_srli_epi32(words[2 * pair], 8), _mm512_set1_epi32(1))),
+        scale);
+    const __m512 u2 = _mm512_mul_ps(
+        _mm512_cvtepi32_ps(_mm512_srli_epi32(words[2 * pair + 1], 8)), scale);
+    const __m512 r = _mm512_mul_ps(
+        _mm512_sqrt_ps(_mm512_mul_ps(_mm512_set1_ps(-2.0f), Log(u1))), sd);
+    __m512 c;
+    __m512 s;
+    SinCos2Pi(u2, c, s);
+    float* dst = out + (2 * pair * kGroupCounters);
+    __m512 z0 = _mm512_mul_ps(r, c);
+    __m512 z1 = _mm512_mul_ps(r, s);
+    if (kAdd) {
+      z0 = _mm512_add_ps(z0, _mm512_loadu_ps(dst));
+      z1 = _mm512_add_ps(z1, _mm512_loadu_ps(dst + kGroupCounters));
+    }
+    _mm512_storeu_ps(dst, z0);
+    _mm512_storeu_ps(dst + kGroupCounters, z1);
+  }
+  group_++;
+}
+#else
+template <bool kAdd>
+void NoiseGenerator::NextGroup(float* out, float std_dev) {
+  // Same layout as the AVX-512 version: value j of counter i at j * 16 + i
+  const uint64_t first = group_ * kGroupCounters;
+  for (size_t i = 0; i < kGroupCounters; i++) {
+    const uint64_t counter = first + i;
+    const std::array<uint32_t, 4> x =
+        Philox({static_cast<uint32_t>(counter),
+                static_cast<uint32_t>(counter >> 32),
+                static_cast<uint32_t>(stream_),
+                static_cast<uint32_t>(stream_ >> 32)},
+               key_);
+    for (size_t pair = 0; pair < 2; pair++) {
+      const float u1 =
+          static_cast<float>((x[2 * pair] >> 8) + 1) * kUniformScale;
+      const float u2 =
+          static_cast<float>(x[2 * pair + 1] >> 8) * kUniformScale;
+      const float r = std::sqrt(-2.0f * std::log(u1)) * std_dev;
+      float* dst = out + (2 * pair * kGroupCounters) + i;
+      const float z0 = r * std::cos(kTwoPi * u2);
+      const float z1 = r * std::sin(kTwoPi * u2);
+      dst[0] = kAdd ? (dst[0] + z0) : z0;
+      dst[kGroupCounters] = kAdd ? (dst[kGroupCounters] + z1) : z1;
+    }
+  }
+  group_++;
+}
+#endif
+
+template <bool kAdd>
+void NoiseGenerator::Generate(float* out, size_t num, float std_dev) {
+  size_t i = 0;
+  // Leftover of the last group first
+  for (; (i < num) && (buffer_pos_ < kGroupSize); i++, buffer_pos_++) {
+    const float z = buffer_[buffer_pos_] * std_dev;
+    out[i] = kAdd ? (out[i] + z) : z;
+  }
+  for (; i + kGroupSize <= num; i += kGroupSize) {
+    NextGroup<kAdd>(out + i, std_dev);
+  }
+  if (i < num) {
+    NextGroup<false>(buffer_.data(), 1.0f);
+    for (buffer_pos_ = 0; i < num; i++, buffer_pos_++) {
+      const float z = buffer_[buffer_pos_] * std_dev;
+      out[i] = kAdd ? (out[i] + z) : z;
+    }
+  }
+}
+
+void NoiseGenerator::Gaussian(float* out, size_t num, float std_dev) {
+  Generate<false>(out, num, std_dev);
+}
+
+void NoiseGenerator::AddGaussian(float* data, size_t num, float std_dev) {
+  Generate<true>(data, num, std_dev);
+}
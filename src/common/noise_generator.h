@@ -0,0 +1,63 @@
+/**
+ * @file noise_generator.h
+ * @brief Declaration file for the NoiseGenerator class, a fast Gaussian noise
+ * generator shared by the channel simulator and the data generator.
+ */
+#ifndef NOISE_GENERATOR_H_
+#define NOISE_GENERATOR_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Gaussian noise from a counter-based Philox4x32-10 generator and the
+ * Box-Muller transform, 16 counters at a time with AVX-512.
+ *
+ * The values only depend on the seed, the stream and their position in the
+ * stream, so each thread can own an independent stream of the same seed and
+ * any position can be reached without generating the values before it.
+ */
+class NoiseGenerator {
+ public:
+  // Values generated per group of 16 Philox counters. Streams are generated
+  // and positioned in whole groups.
+  static constexpr size_t kGroupSize = 64;
+
+  /**
+   * @param seed Key of the Philox generator
+   * @param stream Independent stream of the seed, e.g. a thread id
+   */
+  NoiseGenerator(uint64_t seed, uint64_t stream);
+
+  /// Write num Gaussian values of standard deviation std_dev to out
+  void Gaussian(float* out, size_t num, float std_dev);
+
+  /// Add num Gaussian values of standard deviation std_dev to data, e.g. the
+  /// interleaved real and imaginary parts of complex samples
+  void AddGaussian(float* data, size_t num, float std_dev);
+
+  /// Continue the stream from its group of values at position
+  void Seek(uint64_t position);
+
+  /// The Philox4x32-10 block function
+  static std::array<uint32_t, 4> Philox(std::array<uint32_t, 4> counter,
+                                        std::array<uint32_t, 2> key);
+
+ private:
+  // Generate the next group of values to out, scaled by std_dev, and add
+  // them to out if add is true
+  template <bool kAdd>
+  void NextGroup(float* out, float std_dev);
+  template <bool kAdd>
+  void Generate(float* out, size_t num, float std_dev);
+
+  const std::array<uint32_t, 2> key_;
+  const uint64_t stream_;
+  uint64_t group_;
+  // Unit values of the last group not used yet, from buffer_pos_ on
+  alignas(64) std::array<float, kGroupSize> buffer_;
+  size_t buffer_pos_;
+};
+
+#endif  // NOISE_GENERATOR_H_
@@ -0,0 +1,74 @@
+/**
+ * @file numa_replica.h
+ * @brief Declaration file for the per-NUMA-node copies of read-only tables.
+ */
+#ifndef NUMA_REPLICA_H_
+#define NUMA_REPLICA_H_
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "memory_manage.h"
+
+/// Copies of a read-only table on each NUMA node, so that the workers of a
+/// node read it from local memory. Without copies, or for a node without
+/// one, On() returns the source table.
+template <typename T>
+class NumaReplica {
+ public:
+  NumaReplica() = default;
+  ~NumaReplica() { Free(); }
+  NumaReplica(const NumaReplica&) = delete;
+  NumaReplica& operator=(const NumaReplica&) = delete;
+
+  /// Copy the dim1 x dim2 entries of src to each of num_nodes NUMA nodes.
+  /// src must outlive the copies and not change after this call.
+  void Replicate(Table<T>& src, size_t num_nodes) {
+    Free();
+    src_ = &src;
+    const size_t dim1 = src.Dim1();
+    const size_t dim2 = src.Dim2();
+    if (src.SizeBytes() == 0) {
+      return;
+    }
+    replicas_.resize(num_nodes);
+    for (size_t node = 0; node < num_nodes; node++) {
+      Agora_memory::MemoryPolicy policy;
+      policy.numa_node_ = static_cast<int>(node);
+      replicas_.at(node).Malloc(dim1, dim2,
+                                Agora_memory::Alignment_t::kAlign64, policy);
+      std::memcpy(static_cast<void*>(replicas_.at(node)[0]),
+                  static_cast<const void*>(src.At(0)), src.SizeBytes());
+    }
+  }
+
+  /// Use src without copies
+  void Wrap(Table<T>& src) {
+    Free();
+    src_ = &src;
+  }
+
+  /// The copy on numa_node, or the source table if there is none (e.g.
+  /// numa_node < 0 if the node is unknown)
+  inline Table<T>& On(int numa_node) {
+    if ((numa_node < 0) ||
+        (static_cast<size_t>(numa_node) >= replicas_.size())) {
+      return *src_;
+    }
+    return replicas_[numa_node];
+  }
+
+  void Free() {
+    for (auto& replica : replicas_) {
+      replica.Free();
+    }
+    replicas_.clear();
+  }
+
+ private:
+  Table<T>* src_ = nullptr;
+  std::vector<Table<T>> replicas_;
+};
+
+#endif  // NUMA_REPLICA_H_
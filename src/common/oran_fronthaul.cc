@@ -0,0 +1,317 @@
+/**
+ * @file oran_fronthaul.cc
+ * @brief Implementation file for the O-RAN 7.2x fronthaul messages and
+ * timing
+ */
+#include "oran_fronthaul.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "utils.h"
+
+// Section of the C-plane grants and of the U-plane messages sent
+static constexpr uint16_t kOranSectionId = 1;
+// ecpriRevision 1, and a message that is not concatenated
+static constexpr uint8_t kEcpriRevision = 0x10;
+// payloadVersion 1 and filterIndex 0, below the data direction bit
+static constexpr uint8_t kOranPayloadVersion = 0x10;
+
+static inline void WriteBe16(uint8_t* buf, uint16_t val) {
+  buf[0] = static_cast<uint8_t>(val >> 8);
+  buf[1] = static_cast<uint8_t>(val);
+}
+
+static inline uint16_t ReadBe16(const uint8_t* buf) {
+  return static_cast<uint16_t>((buf[0] << 8) | buf[1]);
+}
+
+// The eCPRI common header, ecpriPcid / ecpriRtcid and ecpriSeqid, then the
+// common application header of both planes
+static void WriteEcpriHeaders(uint8_t* buf, uint8_t message_type,
+                              size_t payload_bytes, uint16_t eaxc_id,
+                              uint8_t seq_id, bool downlink,
+                              const OranSymbolId& symbol) {
+  buf[0] = kEcpriRevision;
+  buf[1] = message_type;
+  WriteBe16(&buf[2], static_cast<uint16_t>(payload_bytes));
+  WriteBe16(&buf[4], eaxc_id);
+  buf[6] = seq_id;
+  // The E bit: the last (and only) subsequence of the message
+  buf[7] = 0x80;
+  buf[8] = static_cast<uint8_t>((downlink ? 0x80 : 0) | kOranPayloadVersion);
+  buf[9] = symbol.frame_id_;
+  WriteBe16(&buf[10],
+            static_cast<uint16_t>(((symbol.subframe_id_ & 0xF) << 12) |
+                                  ((symbol.slot_id_ & 0x3F) << 6) |
+                                  (symbol.symbol_id_ & 0x3F)));
+}
+
+// sectionId, rb 0, symInc 0 and startPrb 0, then numPrb (0 for all PRBs)
+static void WriteSectionHeader(uint8_t* buf, size_t num_prb) {
+  buf[0] = static_cast<uint8_t>(kOranSectionId >> 4);
+  buf[1] = static_cast<uint8_t>((kOranSectionId & 0xF) << 4);
+  buf[2] = 0;
+  buf[3] = (num_prb > UINT8_MAX) ? 0 : static_cast<uint8_t>(num_prb);
+}
+
+void OranCompress(const complex_float* in, uint8_t* out, size_t num_prb,
+                  size_t bfp_bits, float scale) {
+  const size_t prb_bytes = OranPrbBytes(bfp_bits);
+  const uint32_t mantissa_mask = (1u << bfp_bits) - 1;
+  for (size_t prb = 0; prb < num_prb; prb++) {
+    const auto* prb_in =
+        reinterpret_cast<const float*>(&in[prb * kOranPrbSubcarriers]);
+    uint8_t* prb_out = out + (prb * prb_bytes);
+    std::array<int32_t, 2 * kOranPrbSubcarriers> vals;
+    int32_t max_abs = 0;
+    for (size_t i = 0; i < vals.size(); i++) {
+      vals[i] = std::clamp(static_cast<int32_t>(std::lrint(prb_in[i] * scale)),
+                           INT16_MIN, INT16_MAX);
+      max_abs = std::max(max_abs, std::abs(vals[i]));
+    }
+    if (bfp_bits == 0) {
+      for (size_t i = 0; i < vals.size(); i++) {
+        WriteBe16(&prb_out[2 * i], static_cast<uint16_t>(vals[i]));
+      }
+      continue;
+    }
+
+    // Smallest exponent that fits the largest magnitude in the mantissa
+    int32_t exponent = 0;
+    if (max_abs > 0) {
+      const auto bit_len = static_cast<int32_t>(
+          32 - __builtin_clz(static_cast<uint32_t>(max_abs)));
+      exponent = std::max(0, bit_len - static_cast<int32_t>(bfp_bits - 1));
+    }
+    *prb_out++ = static_cast<uint8_t>(exponent);
+    uint32_t bits = 0;
+    size_t num_bits = 0;
+    for (const int32_t val : vals) {
+      bits = (bits << bfp_bits) |
+             (static_cast<uint32_t>(val >> exponent) & mantissa_mask);
+      num_bits += bfp_bits;
+      for (; num_bits >= 8; num_bits -= 8) {
+        *prb_out++ = static_cast<uint8_t>(bits >> (num_bits - 8));
+      }
+    }
+  }
+}
+
+void OranDecompress(const uint8_t* in, complex_float* out, size_t num_prb,
+                    size_t bfp_bits) {
+  auto* out_vals = reinterpret_cast<float*>(out);
+  static constexpr size_t kPrbValues = 2 * kOranPrbSubcarriers;
+  if (bfp_bits == 0) {
+    for (size_t i = 0; i < num_prb * kPrbValues; i++) {
+      out_vals[i] =
+          static_cast<float>(static_cast<int16_t>(ReadBe16(&in[2 * i]))) /
+          32768.f;
+    }
+    return;
+  }
+
+  const size_t prb_bytes = OranPrbBytes(bfp_bits);
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+  // Gather the 32-bit big-endian word that starts at the byte of each
+  // mantissa, byte swap it, then shift the mantissa to the top and
+  // sign-extend it down
+  const __m512i bit_pos =
+      _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                           11, 12, 13, 14, 15),
+                         _mm512_set1_epi32(static_cast<int>(bfp_bits)));
+  const __m512i byte_pos = _mm512_srli_epi32(bit_pos, 3);
+  const __m512i bit_shift = _mm512_and_si512(bit_pos, _mm512_set1_epi32(7));
+  const __m512i sign_shift =
+      _mm512_set1_epi32(32 - static_cast<int>(bfp_bits));
+  const __m512i bswap = _mm512_broadcast_i32x4(
+      _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+  for (size_t prb = 0; prb < num_prb; prb++) {
+    const uint8_t* prb_in = in + (prb * prb_bytes);
+    const __m512 scale =
+        _mm512_set1_ps(std::ldexp(1.0f, prb_in[0] & 0xF) / 32768.f);
+    // Values 16-23 start 16 * bfp_bits bits in
+    for (size_t half = 0; half < 2; half++) {
+      const __mmask16 mask = (half == 0) ? 0xffff : 0x00ff;
+      __m512i words = _mm512_mask_i32gather_epi32(
+          _mm512_setzero_si512(), mask, byte_pos,
+          prb_in + 1 + (half * 2 * bfp_bits), 1);
+      words = _mm512_shuffle_epi8(words, bswap);
+      words = _mm512_srav_epi32(_mm512_sllv_epi32(words, bit_shift),
+                                sign_shift);
+      _mm512_mask_storeu_ps(&out_vals[(prb * kPrbValues) + (half * 16)], mask,
+                            _mm512_mul_ps(_mm512_cvtepi32_ps(words), scale));
+    }
+  }
+#else
+  for (size_t prb = 0; prb < num_prb; prb++) {
+    const uint8_t* prb_in = in + (prb * prb_bytes);
+    const float scale = std::ldexp(1.0f, prb_in[0] & 0xF) / 32768.f;
+    for (size_t i = 0; i < kPrbValues; i++) {
+      const size_t bit_pos = i * bfp_bits;
+      const uint8_t* word = &prb_in[1 + (bit_pos / 8)];
+      const uint32_t bits =
+          (static_cast<uint32_t>(word[0]) << 24) |
+          (static_cast<uint32_t>(word[1]) << 16) |
+          (static_cast<uint32_t>(word[2]) << 8) | word[3];
+      const int32_t val = static_cast<int32_t>(bits << (bit_pos % 8)) >>
+                          (32 - bfp_bits);
+      out_vals[(prb * kPrbValues) + i] = static_cast<float>(val) * scale;
+    }
+  }
+#endif
+}
+
+void OranWriteUplane(uint8_t* buf, const OranUplaneHeader& header,
+                     size_t num_prb, size_t prb_bytes) {
+  WriteEcpriHeaders(buf, kEcpriIqData,
+                    kOranUplaneHeaderBytes - 4 + (num_prb * prb_bytes),
+                    header.eaxc_id_, header.seq_id_, header.downlink_,
+                    header.symbol_);
+  WriteSectionHeader(&buf[12], num_prb);
+}
+
+size_t OranParseUplane(const uint8_t* buf, size_t len, size_t num_prb,
+                       size_t bfp_bits, OranUplaneHeader& header,
+                       std::array<OranSection, kOranMaxSections>& sections) {
+  if ((len < kOranUplaneHeaderBytes) || ((buf[0] & 0xF0) != kEcpriRevision) ||
+      (buf[1] != kEcpriIqData)) {
+    return 0;
+  }
+  // Ethernet frames may be padded past the end of the message
+  const size_t end = 4 + ReadBe16(&buf[2]);
+  if (end > len) {
+    return 0;
+  }
+  header.eaxc_id_ = ReadBe16(&buf[4]);
+  header.seq_id_ = buf[6];
+  header.downlink_ = (buf[8] & 0x80) != 0;
+  header.symbol_.frame_id_ = buf[9];
+  const uint16_t symbol = ReadBe16(&buf[10]);
+  header.symbol_.subframe_id_ = static_cast<uint8_t>(symbol >> 12);
+  header.symbol_.slot_id_ = static_cast<uint8_t>((symbol >> 6) & 0x3F);
+  header.symbol_.symbol_id_ = static_cast<uint8_t>(symbol & 0x3F);
+
+  const size_t prb_bytes = OranPrbBytes(bfp_bits);
+  size_t num_sections = 0;
+  size_t offset = 12;
+  while ((offset + 4 <= end) && (num_sections < kOranMaxSections)) {
+    OranSection& section = sections[num_sections];
+    section.section_id_ =
+        static_cast<uint16_t>((buf[offset] << 4) | (buf[offset + 1] >> 4));
+    section.start_prb_ =
+        static_cast<uint16_t>(((buf[offset + 1] & 0x3) << 8) | buf[offset + 2]);
+    // 0 for all the PRBs
+    section.num_prb_ = (buf[offset + 3] == 0)
+                           ? static_cast<uint16_t>(num_prb)
+                           : buf[offset + 3];
+    section.data_offset_ = offset + 4;
+    offset = section.data_offset_ + (section.num_prb_ * prb_bytes);
+    if ((offset > end) || (section.start_prb_ + section.num_prb_ > num_prb)) {
+      return 0;
+    }
+    num_sections++;
+  }
+  return num_sections;
+}
+
+void OranWriteCplane(uint8_t* buf, const OranCplane& cplane) {
+  WriteEcpriHeaders(buf, kEcpriRtControl, kOranCplaneBytes - 4,
+                    cplane.eaxc_id_, cplane.seq_id_, cplane.downlink_,
+                    cplane.symbol_);
+  // numberOfSections, sectionType 1, udCompHdr and a reserved byte
+  buf[12] = 1;
+  buf[13] = 1;
+  buf[14] = OranCompHdr(cplane.bfp_bits_);
+  buf[15] = 0;
+  WriteSectionHeader(&buf[16], cplane.num_prb_);
+  // All the REs of the PRBs, numSymbol, then ef 0 and beamId
+  buf[20] = 0xFF;
+  buf[21] = static_cast<uint8_t>(0xF0 | (cplane.num_symbols_ & 0xF));
+  WriteBe16(&buf[22], cplane.beam_id_ & 0x7FFF);
+}
+
+OranTiming::OranTiming(size_t numerology, size_t symbols_per_frame)
+    : slots_per_subframe_(1ul << numerology),
+      symbols_per_frame_(symbols_per_frame),
+      slot_ns_(kSubframeNs >> numerology),
+      id_period_(kFrameIdPeriod * kSubframesPerFrame * (1ul << numerology) *
+                 kSymbolsPerSlot) {
+  RtAssert(numerology <= 4, "OranTiming: numerology must be 0-4");
+  RtAssert((symbols_per_frame > 0) &&
+               ((symbols_per_frame % kSymbolsPerSlot) == 0),
+           "OranTiming: a frame must be whole slots of 14 symbols");
+}
+
+void OranTiming::Start(int64_t gps_ns, size_t host_tsc, double freq_ghz,
+                       int64_t lead_ns) {
+  ref_ns_ = gps_ns;
+  ref_tsc_ = static_cast<double>(host_tsc);
+  freq_ghz_ = freq_ghz;
+  const int64_t radio_frame_ns = kSubframesPerFrame * kSubframeNs;
+  const auto radio_frame = static_cast<size_t>(
+      (gps_ns + lead_ns + radio_frame_ns - 1) / radio_frame_ns);
+  first_symbol_ =
+      radio_frame * kSubframesPerFrame * slots_per_subframe_ * kSymbolsPerSlot;
+}
+
+bool OranTiming::ToAgora(size_t abs_symbol, size_t& frame_id,
+                         size_t& symbol_id) const {
+  if (abs_symbol < first_symbol_) {
+    return false;
+  }
+  frame_id = (abs_symbol - first_symbol_) / symbols_per_frame_;
+  symbol_id = (abs_symbol - first_symbol_) % symbols_per_frame_;
+  return true;
+}
+
+OranSymbolId OranTiming::ToOran(size_t abs_symbol) const {
+  const size_t slot = abs_symbol / kSymbolsPerSlot;
+  const size_t subframe = slot / slots_per_subframe_;
+  OranSymbolId id;
+  id.symbol_id_ = static_cast<uint8_t>(abs_symbol % kSymbolsPerSlot);
+  id.slot_id_ = static_cast<uint8_t>(slot % slots_per_subframe_);
+  id.subframe_id_ = static_cast<uint8_t>(subframe % kSubframesPerFrame);
+  id.frame_id_ =
+      static_cast<uint8_t>((subframe / kSubframesPerFrame) % kFrameIdPeriod);
+  return id;
+}
+
+size_t OranTiming::FromOran(const OranSymbolId& id,
+                            size_t ref_abs_symbol) const {
+  const size_t symbol =
+      ((((static_cast<size_t>(id.frame_id_) * kSubframesPerFrame) +
+         id.subframe_id_) *
+        slots_per_subframe_) +
+       id.slot_id_) *
+          kSymbolsPerSlot +
+      id.symbol_id_;
+  const size_t ahead =
+      (symbol + id_period_ - (ref_abs_symbol % id_period_)) % id_period_;
+  if (ahead > id_period_ / 2) {
+    return ref_abs_symbol + ahead - id_period_;
+  }
+  return ref_abs_symbol + ahead;
+}
+
+int64_t OranTiming::SymbolNs(size_t abs_symbol) const {
+  return (static_cast<int64_t>(abs_symbol / kSymbolsPerSlot) * slot_ns_) +
+         (static_cast<int64_t>(abs_symbol % kSymbolsPerSlot) * slot_ns_ /
+          static_cast<int64_t>(kSymbolsPerSlot));
+}
+
+double OranTiming::SymbolTsc(size_t abs_symbol) const {
+  return ref_tsc_ +
+         (static_cast<double>(SymbolNs(abs_symbol) - ref_ns_) * freq_ghz_);
+}
+
+size_t OranTiming::SymbolAt(size_t tsc) const {
+  const auto ns = ref_ns_ + static_cast<int64_t>(
+                                (static_cast<double>(tsc) - ref_tsc_) /
+                                freq_ghz_);
+  return (static_cast<size_t>(ns / slot_ns_) * kSymbolsPerSlot) +
+         static_cast<size_t>((ns % slot_ns_) *
+                             static_cast<int64_t>(kSymbolsPerSlot) / slot_ns_);
+}
@@ -0,0 +1,178 @@
+/**
+ * @file oran_fronthaul.h
+ * @brief Declaration file for the O-RAN 7.2x fronthaul: the eCPRI user plane
+ * (U-plane) and control plane (C-plane) messages, the block floating point
+ * compression of their PRBs, and the timing of the symbols on air.
+ */
+#ifndef ORAN_FRONTHAUL_H_
+#define ORAN_FRONTHAUL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "symbols.h"
+
+/// Ethernet type of eCPRI
+static constexpr uint16_t kEcpriEtherType = 0xAEFE;
+/// eCPRI message types of the U-plane and of the C-plane
+static constexpr uint8_t kEcpriIqData = 0x00;
+static constexpr uint8_t kEcpriRtControl = 0x02;
+/// Subcarriers of a physical resource block (PRB)
+static constexpr size_t kOranPrbSubcarriers = 12;
+/// Bytes of the headers of a U-plane message with one section, from the
+/// eCPRI common header to the section header
+static constexpr size_t kOranUplaneHeaderBytes = 16;
+/// Bytes of a C-plane message of section type 1 with one section
+static constexpr size_t kOranCplaneBytes = 24;
+/// Most sections of a received U-plane message
+static constexpr size_t kOranMaxSections = 16;
+/// Bytes after the last PRB that the decompression may read
+static constexpr size_t kOranPadding = 4;
+
+/// Bytes of a PRB with bfp_bits-bit BFP mantissas and an exponent byte, or
+/// of an uncompressed PRB of big-endian 16-bit IQ samples if bfp_bits is 0
+static inline size_t OranPrbBytes(size_t bfp_bits) {
+  return (bfp_bits == 0) ? (4 * kOranPrbSubcarriers)
+                         : (1 + (2 * kOranPrbSubcarriers * bfp_bits) / 8);
+}
+
+/// The udCompHdr of the PRBs of OranPrbBytes(bfp_bits): the IQ width in the
+/// high nibble (0 for 16) and the compression method (1 for BFP)
+static inline uint8_t OranCompHdr(size_t bfp_bits) {
+  return (bfp_bits == 0) ? 0
+                         : static_cast<uint8_t>(((bfp_bits & 0xF) << 4) | 1);
+}
+
+/// Compress num_prb PRBs of complex samples in, multiplied by scale and
+/// saturated to 16 bits, to num_prb * OranPrbBytes(bfp_bits) bytes out: the
+/// exponent of each PRB in the low nibble of its first byte, then its
+/// mantissas I0 Q0 I1 Q1... packed MSB first. bfp_bits is 0 (uncompressed)
+/// or 8-16.
+void OranCompress(const complex_float* in, uint8_t* out, size_t num_prb,
+                  size_t bfp_bits, float scale);
+
+/// Decompress num_prb PRBs of OranCompress() to complex samples, scaled
+/// like SimdConvertShortToFloat (-1->+0.999). Reads up to kOranPadding bytes
+/// after the last PRB.
+void OranDecompress(const uint8_t* in, complex_float* out, size_t num_prb,
+                    size_t bfp_bits);
+
+/// The position of a symbol in the O-RAN radio frames
+struct OranSymbolId {
+  uint8_t frame_id_;     // Radio frame (10 ms), modulo 256
+  uint8_t subframe_id_;  // 1 ms subframe of the frame, 0-9
+  uint8_t slot_id_;      // Slot of the subframe, below 2^numerology
+  uint8_t symbol_id_;    // Symbol of the slot, 0-13
+};
+
+/// The fields of the headers of a U-plane message
+struct OranUplaneHeader {
+  uint16_t eaxc_id_;  // Antenna carrier (ecpriPcid)
+  uint8_t seq_id_;
+  bool downlink_;
+  OranSymbolId symbol_;
+};
+
+/// A section of a received U-plane message: PRBs [start_prb_, start_prb_ +
+/// num_prb_) of the data subcarriers, at data_offset_ bytes into the message
+struct OranSection {
+  uint16_t section_id_;
+  uint16_t start_prb_;
+  uint16_t num_prb_;
+  size_t data_offset_;
+};
+
+/// Write the kOranUplaneHeaderBytes bytes of the headers of a U-plane
+/// message at buf, with one section of num_prb PRBs from PRB 0, whose
+/// prb_bytes bytes of data follow
+void OranWriteUplane(uint8_t* buf, const OranUplaneHeader& header,
+                     size_t num_prb, size_t prb_bytes);
+
+/// Parse the U-plane message of len bytes at buf, of PRBs of
+/// OranPrbBytes(bfp_bits) bytes out of num_prb. Returns the number of
+/// sections, at most kOranMaxSections, and 0 if the message is malformed or
+/// not a U-plane message.
+size_t OranParseUplane(const uint8_t* buf, size_t len, size_t num_prb,
+                       size_t bfp_bits, OranUplaneHeader& header,
+                       std::array<OranSection, kOranMaxSections>& sections);
+
+/// The fields of a C-plane message of section type 1, which grants the
+/// symbols [symbol_.symbol_id_, symbol_.symbol_id_ + num_symbols_) of a slot
+/// in one direction to all the PRBs of an antenna carrier
+struct OranCplane {
+  uint16_t eaxc_id_;
+  uint8_t seq_id_;
+  bool downlink_;
+  OranSymbolId symbol_;
+  uint8_t num_symbols_;
+  uint16_t num_prb_;
+  size_t bfp_bits_;
+  uint16_t beam_id_;
+};
+
+/// Write the kOranCplaneBytes bytes of the C-plane message at buf
+void OranWriteCplane(uint8_t* buf, const OranCplane& cplane);
+
+/**
+ * @brief The time on air of the O-RAN symbols, and the Agora frame and
+ * symbol of each. Symbols are counted from the GPS epoch, which both ends of
+ * the fronthaul are synchronized to, and Agora frame 0 starts at a radio
+ * frame. The symbols of a slot are taken to be of equal length: the longer
+ * cyclic prefix of the first symbol of each half subframe (about 0.5 us) is
+ * spread over the slot.
+ */
+class OranTiming {
+ public:
+  static constexpr size_t kSymbolsPerSlot = 14;
+  static constexpr size_t kSubframesPerFrame = 10;
+  static constexpr size_t kFrameIdPeriod = 256;
+  static constexpr int64_t kSubframeNs = 1000000;
+
+  /// symbols_per_frame symbols of an Agora frame, a multiple of a slot
+  OranTiming(size_t numerology, size_t symbols_per_frame);
+
+  /// Map the host clock: gps_ns nanoseconds since the GPS epoch was at TSC
+  /// host_tsc, which counts freq_ghz cycles per nanosecond. Agora frame 0
+  /// then starts at the first radio frame at least lead_ns later.
+  void Start(int64_t gps_ns, size_t host_tsc, double freq_ghz,
+             int64_t lead_ns);
+
+  /// Symbol since the GPS epoch of symbol symbol_id of Agora frame frame_id
+  inline size_t AbsSymbol(size_t frame_id, size_t symbol_id) const {
+    return this->first_symbol_ + (frame_id * this->symbols_per_frame_) +
+           symbol_id;
+  }
+  /// The Agora frame and symbol of abs_symbol, false if it is before frame 0
+  bool ToAgora(size_t abs_symbol, size_t& frame_id, size_t& symbol_id) const;
+
+  OranSymbolId ToOran(size_t abs_symbol) const;
+  /// The symbol since the GPS epoch of id nearest to ref_abs_symbol
+  size_t FromOran(const OranSymbolId& id, size_t ref_abs_symbol) const;
+
+  /// Nanoseconds since the GPS epoch at which abs_symbol starts on air
+  int64_t SymbolNs(size_t abs_symbol) const;
+  /// TSC at which abs_symbol starts on air
+  double SymbolTsc(size_t abs_symbol) const;
+  /// The symbol on air at TSC tsc
+  size_t SymbolAt(size_t tsc) const;
+
+  inline size_t SymbolsPerSlot() const { return kSymbolsPerSlot; }
+  inline size_t SlotsPerSubframe() const { return this->slots_per_subframe_; }
+  inline int64_t SlotNs() const { return this->slot_ns_; }
+  inline size_t FirstSymbol() const { return this->first_symbol_; }
+
+ private:
+  const size_t slots_per_subframe_;
+  const size_t symbols_per_frame_;
+  const int64_t slot_ns_;
+  // Symbols of kFrameIdPeriod radio frames, after which the ids repeat
+  const size_t id_period_;
+
+  size_t first_symbol_ = 0;
+  int64_t ref_ns_ = 0;
+  double ref_tsc_ = 0.0;
+  double freq_ghz_ = 1.0;
+};
+
+#endif  // ORAN_FRONTHAUL_H_
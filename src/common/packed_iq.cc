@@ -0,0 +1,135 @@
+/**
+ * @file packed_iq.cc
+ * @brief Implementation file for the requantized IQ formats of the recorder
+ */
+#include "packed_iq.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+std::string IqFormatName(IqFormat format) {
+  switch (format) {
+    case IqFormat::kInt8:
+      return "int8";
+    case IqFormat::kBfp:
+      return "bfp";
+    default:
+      return "int16";
+  }
+}
+
+// The smallest shift that rounds max_abs to at most 127
+static inline int BlockShift(int max_abs) {
+  int shift = 0;
+  while (((max_abs + ((1 << shift) >> 1)) >> shift) > 127) {
+    shift++;
+  }
+  return shift;
+}
+
+#if defined(__AVX512BW__)
+// Magnitudes of up to 32 values, as unsigned 16 bits (-32768 is 32768)
+static inline __m512i LoadAbs(const short* iq, size_t n, __m512i& values) {
+  const __mmask32 mask = (n >= 32) ? ~__mmask32{0} : ((1u << n) - 1);
+  values = _mm512_maskz_loadu_epi16(mask, iq);
+  return _mm512_abs_epi16(values);
+}
+#endif
+
+// Largest magnitude of n values
+static int MaxAbs(const short* iq, size_t n) {
+  int max_abs = 0;
+#if defined(__AVX512BW__)
+  __m512i max_vec = _mm512_setzero_si512();
+  for (size_t i = 0; i < n; i += 32) {
+    __m512i values;
+    max_vec = _mm512_max_epu16(max_vec, LoadAbs(iq + i, n - i, values));
+  }
+  const __m256i max_256 =
+      _mm256_max_epu16(_mm512_castsi512_si256(max_vec),
+                       _mm512_extracti64x4_epi64(max_vec, 1));
+  const __m128i max_128 =
+      _mm_max_epu16(_mm256_castsi256_si128(max_256),
+                    _mm256_extracti128_si256(max_256, 1));
+  // The max is the complement of the min of the complements
+  const __m128i min_inv =
+      _mm_minpos_epu16(_mm_xor_si128(max_128, _mm_set1_epi32(-1)));
+  max_abs = 0xFFFF - (_mm_cvtsi128_si32(min_inv) & 0xFFFF);
+#else
+  for (size_t i = 0; i < n; i++) {
+    max_abs = std::max(max_abs, std::abs(int{iq[i]}));
+  }
+#endif
+  return max_abs;
+}
+
+// Round n values to int8 steps of 2^shift, symmetrically
+static void Quantize(const short* iq, int8_t* q, size_t n, int shift) {
+  const int half = (1 << shift) >> 1;
+#if defined(__AVX512BW__)
+  const __m512i half_vec = _mm512_set1_epi16(static_cast<short>(half));
+  const __m128i shift_vec = _mm_cvtsi32_si128(shift);
+  const __m512i max_q = _mm512_set1_epi16(127);
+  for (size_t i = 0; i < n; i += 32) {
+    __m512i values;
+    const __m512i mag = _mm512_min_epu16(
+        _mm512_srl_epi16(
+            _mm512_add_epi16(LoadAbs(iq + i, n - i, values), half_vec),
+            shift_vec),
+        max_q);
+    const __mmask32 negative =
+        _mm512_cmplt_epi16_mask(values, _mm512_setzero_si512());
+    const __m512i rounded =
+        _mm512_mask_sub_epi16(mag, negative, _mm512_setzero_si512(), mag);
+    const __mmask32 mask =
+        (n - i >= 32) ? ~__mmask32{0} : ((1u << (n - i)) - 1);
+    _mm512_mask_cvtepi16_storeu_epi8(q + i, mask, rounded);
+  }
+#else
+  for (size_t i = 0; i < n; i++) {
+    const int value = iq[i];
+    const int mag = std::min((std::abs(value) + half) >> shift, 127);
+    q[i] = static_cast<int8_t>((value < 0) ? -mag : mag);
+  }
+#endif
+}
+
+void PackIq(const short* iq, uint8_t* packed, size_t num_values,
+            IqFormat format) {
+  if (format == IqFormat::kInt16) {
+    std::memcpy(packed, iq, num_values * sizeof(short));
+    return;
+  }
+  const size_t block =
+      (format == IqFormat::kBfp) ? kPackedIqBlock : num_values;
+  for (size_t b = 0; b < num_values; b += block) {
+    const size_t n = std::min(block, num_values - b);
+    uint8_t* out = packed + ((b / block) * (block + 1));
+    const int shift = BlockShift(MaxAbs(iq + b, n));
+    out[0] = static_cast<uint8_t>(shift);
+    Quantize(iq + b, reinterpret_cast<int8_t*>(out + 1), n, shift);
+  }
+}
+
+void UnpackIq(const uint8_t* packed, size_t num_values, IqFormat format,
+              short* iq) {
+  if (format == IqFormat::kInt16) {
+    std::memcpy(iq, packed, num_values * sizeof(short));
+    return;
+  }
+  const size_t block =
+      (format == IqFormat::kBfp) ? kPackedIqBlock : num_values;
+  for (size_t b = 0; b < num_values; b += block) {
+    const size_t n = std::min(block, num_values - b);
+    const uint8_t* in = packed + ((b / block) * (block + 1));
+    const auto* q = reinterpret_cast<const int8_t*>(in + 1);
+    for (size_t i = 0; i < n; i++) {
+      // Rounding up the largest values may step past int16
+      iq[b + i] = static_cast<short>(
+          std::clamp(q[i] * (1 << in[0]), -32768, 32767));
+    }
+  }
+}
@@ -0,0 +1,53 @@
+/**
+ * @file packed_iq.h
+ * @brief Declaration file for the requantized IQ formats of the recorder:
+ * int8 samples with one shift per rx symbol (int8) or per block of samples
+ * (block floating point).
+ */
+#ifndef PACKED_IQ_H_
+#define PACKED_IQ_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// int16 values (I and Q of 16 samples) of a block floating point block,
+/// which share one shift
+static constexpr size_t kPackedIqBlock = 32;
+
+enum class IqFormat {
+  // The int16 samples as received
+  kInt16,
+  // int8 samples with one shift for all of them
+  kInt8,
+  // int8 samples with one shift per kPackedIqBlock values
+  kBfp
+};
+
+/// Name of the format in the config, and in the recorded files
+std::string IqFormatName(IqFormat format);
+
+/// Bytes of num_values int16 values in format. A packed block is its left
+/// shift, then its int8 values; int8 has one block of all values. A partial
+/// last block holds only its values.
+inline size_t PackedIqBytes(size_t num_values, IqFormat format) {
+  switch (format) {
+    case IqFormat::kInt8:
+      return 1 + num_values;
+    case IqFormat::kBfp:
+      return ((num_values + kPackedIqBlock - 1) / kPackedIqBlock) + num_values;
+    default:
+      return num_values * sizeof(short);
+  }
+}
+
+/// Pack num_values int16 values to format, with the smallest shift of each
+/// block that keeps its largest value, rounded to the nearest step
+void PackIq(const short* iq, uint8_t* packed, size_t num_values,
+            IqFormat format);
+
+/// Unpack num_values values packed in format back to int16
+void UnpackIq(const uint8_t* packed, size_t num_values, IqFormat format,
+              short* iq);
+
+#endif  // PACKED_IQ_H_
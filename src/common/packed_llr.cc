@@ -0,0 +1,116 @@
+/**
+ * @file packed_llr.cc
+ * @brief Implementation file for the packed LLR format of the demodulation
+ * buffer
+ */
+#include "packed_llr.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+
+void PackLlrs(const int8_t* llrs, uint8_t* packed, size_t num_llrs,
+              size_t llr_bits) {
+  assert((llr_bits == 4) || (llr_bits == 6));
+  const int max_q = (1 << (llr_bits - 1)) - 1;
+  const size_t chunk_bytes = PackedLlrChunkBytes(llr_bits);
+  for (size_t c = 0; c < num_llrs; c += kPackedLlrChunk) {
+    const size_t n = std::min(kPackedLlrChunk, num_llrs - c);
+    // -128 is taken as -127, so that no unpacked LLR overflows int8
+    int max_abs = 0;
+    for (size_t i = 0; i < n; i++) {
+      max_abs = std::max(max_abs, std::min(std::abs(int{llrs[c + i]}), 127));
+    }
+    int shift = 0;
+    while ((max_abs >> shift) > max_q) {
+      shift++;
+    }
+    std::array<int, kPackedLlrChunk> q{};
+    for (size_t i = 0; i < n; i++) {
+      const int llr = llrs[c + i];
+      // Rounded to the nearest step, symmetrically
+      const int mag = (shift == 0) ? std::abs(llr)
+                                   : ((std::abs(llr) + (1 << (shift - 1))) >>
+                                      shift);
+      q.at(i) = (llr < 0) ? -std::min(mag, max_q) : std::min(mag, max_q);
+    }
+
+    uint8_t* out = packed + ((c / kPackedLlrChunk) * chunk_bytes);
+    out[0] = static_cast<uint8_t>(shift);
+    if (llr_bits == 4) {
+      for (size_t k = 0; k < kPackedLlrChunk / 2; k++) {
+        out[1 + k] = static_cast<uint8_t>((q[2 * k] & 0x0F) |
+                                          ((q[(2 * k) + 1] & 0x0F) << 4));
+      }
+    } else {
+      // Four LLRs in three bytes
+      for (size_t k = 0; k < kPackedLlrChunk / 4; k++) {
+        const uint32_t word = (q[4 * k] & 0x3F) |
+                              ((q[(4 * k) + 1] & 0x3F) << 6) |
+                              ((q[(4 * k) + 2] & 0x3F) << 12) |
+                              ((q[(4 * k) + 3] & 0x3F) << 18);
+        out[1 + (3 * k)] = static_cast<uint8_t>(word);
+        out[2 + (3 * k)] = static_cast<uint8_t>(word >> 8);
+        out[3 + (3 * k)] = static_cast<uint8_t>(word >> 16);
+      }
+    }
+  }
+}
+
+// The LLR k of a chunk
+static inline int8_t UnpackOne(const uint8_t* chunk, size_t k,
+                               size_t llr_bits) {
+  int q;
+  if (llr_bits == 4) {
+    const uint8_t byte = chunk[1 + (k / 2)];
+    q = ((k & 0x1) != 0) ? (byte >> 4) : (byte & 0x0F);
+    q = (q ^ 0x8) - 0x8;
+  } else {
+    const uint8_t* bytes = chunk + 1 + (3 * (k / 4));
+    const uint32_t word =
+        bytes[0] | (uint32_t{bytes[1]} << 8) | (uint32_t{bytes[2]} << 16);
+    q = static_cast<int>((word >> (6 * (k % 4))) & 0x3F);
+    q = (q ^ 0x20) - 0x20;
+  }
+  return static_cast<int8_t>(q * (1 << chunk[0]));
+}
+
+void UnpackLlrs(const uint8_t* packed, size_t first, size_t num_llrs,
+                size_t llr_bits, int8_t* llrs) {
+  assert((llr_bits == 4) || (llr_bits == 6));
+  const size_t chunk_bytes = PackedLlrChunkBytes(llr_bits);
+  size_t i = 0;
+  while (i < num_llrs) {
+    const size_t pos = first + i;
+    const uint8_t* chunk = packed + ((pos / kPackedLlrChunk) * chunk_bytes);
+    const size_t k = pos % kPackedLlrChunk;
+#if defined(__SSE2__)
+    // A whole chunk of 4-bit LLRs: split the nibbles, sign extend them and
+    // shift them in 16-bit lanes, masking the bits shifted into the next LLR
+    if ((llr_bits == 4) && (k == 0) && (num_llrs - i >= kPackedLlrChunk)) {
+      const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+      const __m128i sign = _mm_set1_epi8(0x08);
+      const __m128i bytes =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(chunk + 1));
+      const __m128i lo = _mm_and_si128(bytes, nibble_mask);
+      const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble_mask);
+      __m128i q = _mm_unpacklo_epi8(lo, hi);
+      q = _mm_sub_epi8(_mm_xor_si128(q, sign), sign);
+      q = _mm_and_si128(
+          _mm_sll_epi16(q, _mm_cvtsi32_si128(chunk[0])),
+          _mm_set1_epi8(static_cast<char>((0xFF << chunk[0]) & 0xFF)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(llrs + i), q);
+      i += kPackedLlrChunk;
+      continue;
+    }
+#endif
+    const size_t n = std::min(kPackedLlrChunk - k, num_llrs - i);
+    for (size_t j = 0; j < n; j++) {
+      llrs[i + j] = UnpackOne(chunk, k + j, llr_bits);
+    }
+    i += n;
+  }
+}
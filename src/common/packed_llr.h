@@ -0,0 +1,42 @@
+/**
+ * @file packed_llr.h
+ * @brief Declaration file for the packed LLR format of the demodulation
+ * buffer: LLRs of 4 or 6 bits in chunks that share a scale.
+ */
+#ifndef PACKED_LLR_H_
+#define PACKED_LLR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/// LLRs of a chunk, which share one scale. The LLRs of a demodulation block
+/// start on a chunk.
+static constexpr size_t kPackedLlrChunk = 16;
+
+/// Bytes of a chunk of LLRs of llr_bits (4 or 6) each: the left shift that
+/// scales its LLRs back to int8, then the LLRs, little endian
+inline size_t PackedLlrChunkBytes(size_t llr_bits) {
+  return 1 + ((kPackedLlrChunk * llr_bits) / 8);
+}
+
+/// Bytes of num_llrs LLRs packed to llr_bits each, 8 for int8 LLRs
+inline size_t PackedLlrBytes(size_t num_llrs, size_t llr_bits) {
+  if (llr_bits == 8) {
+    return num_llrs;
+  }
+  return ((num_llrs + kPackedLlrChunk - 1) / kPackedLlrChunk) *
+         PackedLlrChunkBytes(llr_bits);
+}
+
+/// Pack num_llrs int8 LLRs to llr_bits (4 or 6) each, with the smallest
+/// shift of each chunk that keeps its largest LLR. The unused LLRs of a
+/// partial last chunk are 0.
+void PackLlrs(const int8_t* llrs, uint8_t* packed, size_t num_llrs,
+              size_t llr_bits);
+
+/// Unpack num_llrs LLRs of llr_bits each to int8, from LLR first of the
+/// chunks at packed
+void UnpackLlrs(const uint8_t* packed, size_t first, size_t num_llrs,
+                size_t llr_bits, int8_t* llrs);
+
+#endif  // PACKED_LLR_H_
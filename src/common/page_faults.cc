@@ -0,0 +1,93 @@
+/**
+ * @file page_faults.cc
+ * @brief Implementation file for the per-thread page fault counters.
+ */
+#include "page_faults.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace PageFaults {
+
+struct Entry {
+  std::string name_;
+  pid_t tid_;
+  // Counts of the last read, kept once the thread exits
+  Counts counts_;
+};
+
+static std::mutex registry_mutex;
+static std::vector<Entry> registry;
+
+// The faults of thread tid of this process, from /proc/self/task/<tid>/stat.
+// False if the thread exited.
+static bool ReadTaskCounts(pid_t tid, Counts& counts) {
+  std::ifstream stat_file("/proc/self/task/" + std::to_string(tid) + "/stat");
+  std::string line;
+  if (std::getline(stat_file, line).fail()) {
+    return false;
+  }
+  // The name in parentheses may contain spaces, the fields after it do not:
+  // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt
+  const size_t name_end = line.rfind(')');
+  if (name_end == std::string::npos) {
+    return false;
+  }
+  std::istringstream fields(line.substr(name_end + 1));
+  std::string skipped;
+  for (size_t i = 0; i < 7; i++) {
+    fields >> skipped;
+  }
+  size_t minor = 0;
+  size_t child_minor = 0;
+  size_t major = 0;
+  fields >> minor >> child_minor >> major;
+  if (fields.fail()) {
+    return false;
+  }
+  counts.minor_ = minor;
+  counts.major_ = major;
+  return true;
+}
+
+void RegisterThread(const std::string& name) {
+  const auto tid = static_cast<pid_t>(syscall(SYS_gettid));
+  std::scoped_lock lock(registry_mutex);
+  auto entry =
+      std::find_if(registry.begin(), registry.end(),
+                   [tid](const Entry& other) { return other.tid_ == tid; });
+  if (entry != registry.end()) {
+    entry->name_ = name;
+    return;
+  }
+  registry.push_back(Entry{name, tid, Counts()});
+}
+
+Counts ThisThread() {
+  struct rusage usage {};
+  Counts counts;
+  if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+    counts.minor_ = static_cast<size_t>(usage.ru_minflt);
+    counts.major_ = static_cast<size_t>(usage.ru_majflt);
+  }
+  return counts;
+}
+
+std::vector<ThreadCounts> Registered() {
+  std::scoped_lock lock(registry_mutex);
+  std::vector<ThreadCounts> threads;
+  threads.reserve(registry.size());
+  for (Entry& entry : registry) {
+    ReadTaskCounts(entry.tid_, entry.counts_);
+    threads.push_back(ThreadCounts{entry.name_, entry.counts_});
+  }
+  return threads;
+}
+
+}  // namespace PageFaults
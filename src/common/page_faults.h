@@ -0,0 +1,42 @@
+/**
+ * @file page_faults.h
+ * @brief Declaration file for the per-thread page fault counters, to check
+ * that the threads no longer fault once warmed up.
+ */
+#ifndef PAGE_FAULTS_H_
+#define PAGE_FAULTS_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace PageFaults {
+
+/// Page faults of a thread
+struct Counts {
+  // Served without I/O, e.g. the first touch of a page
+  size_t minor_ = 0;
+  // Served with I/O, e.g. a page of a mapped file or swapped out
+  size_t major_ = 0;
+};
+
+/// A registered thread and its faults since it started
+struct ThreadCounts {
+  std::string name_;
+  Counts counts_;
+};
+
+/// Register the calling thread under name, so that Registered() reports its
+/// faults. A thread registered again is renamed.
+void RegisterThread(const std::string& name);
+
+/// Faults of the calling thread since it started
+Counts ThisThread();
+
+/// The registered threads and their faults, read from /proc, in the order
+/// they registered. Threads that exited report their last counts.
+std::vector<ThreadCounts> Registered();
+
+}  // namespace PageFaults
+
+#endif  // PAGE_FAULTS_H_
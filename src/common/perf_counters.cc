@@ -0,0 +1,102 @@
+/**
+ * @file perf_counters.cc
+ * @brief Implementation file for the PerfCounters class.
+ */
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "logger.h"
+#include "utils.h"
+
+// The generic event of each PerfCounters::Event. The cache misses are those
+// of the last level cache on x86.
+static constexpr std::array<uint64_t, PerfCounters::kNumEvents> kPerfConfigs =
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND};
+
+PerfCounters::PerfCounters(size_t sample_interval)
+    : sample_interval_(sample_interval) {
+  RtAssert(sample_interval_ > 0, "PerfCounters: sample interval is 0");
+  fds_.fill(-1);
+  read_index_.fill(0);
+  for (size_t i = 0; i < kNumEvents; i++) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = kPerfConfigs.at(i);
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The whole group starts with its leader
+    attr.disabled = (i == 0) ? 1 : 0;
+    const int group_fd = fds_.at(0);
+    if ((i > 0) && (group_fd < 0)) {
+      break;
+    }
+    // This thread, on any core
+    const int fd = static_cast<int>(
+        syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+    if (fd < 0) {
+      AGORA_LOG_WARN("PerfCounters: cannot count %s: %s\n",
+                     EventName(static_cast<Event>(i)), std::strerror(errno));
+      continue;
+    }
+    fds_.at(i) = fd;
+    read_index_.at(i) = num_open_;
+    num_open_++;
+  }
+  if (Available()) {
+    ioctl(fds_.at(0), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_.at(0), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  // Members first, then the group leader
+  for (size_t i = kNumEvents; i-- > 0;) {
+    if (fds_.at(i) >= 0) {
+      close(fds_.at(i));
+    }
+  }
+}
+
+void PerfCounters::Read(Counts& counts) const {
+  counts.fill(0);
+  if (Available() == false) {
+    return;
+  }
+  // The number of events, then their values in the order they were opened
+  std::array<uint64_t, kNumEvents + 1> values;
+  const ssize_t bytes =
+      read(fds_.at(0), values.data(), sizeof(uint64_t) * (num_open_ + 1));
+  if (bytes != static_cast<ssize_t>(sizeof(uint64_t) * (num_open_ + 1))) {
+    return;
+  }
+  for (size_t i = 0; i < kNumEvents; i++) {
+    if (fds_.at(i) >= 0) {
+      counts.at(i) = values.at(1 + read_index_.at(i));
+    }
+  }
+}
+
+const char* PerfCounters::EventName(Event event) {
+  switch (event) {
+    case Event::kCycles:
+      return "cycles";
+    case Event::kInstructions:
+      return "instructions";
+    case Event::kLlcMisses:
+      return "llc_misses";
+    case Event::kFrontendStalls:
+      return "frontend_stalls";
+  }
+  return "unknown";
+}
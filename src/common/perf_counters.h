@@ -0,0 +1,70 @@
+/**
+ * @file perf_counters.h
+ * @brief Declaration file for the PerfCounters class, the hardware
+ * performance counters of one thread read with perf_event_open.
+ */
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The hardware counters of the thread that creates the object, in one
+ * perf event group so that a single read() returns all of them.
+ *
+ * Counts user space only, which needs perf_event_paranoid <= 2. Events that
+ * the CPU or the kernel does not support read as 0. Not thread safe: only
+ * the creating thread may use it.
+ */
+class PerfCounters {
+ public:
+  enum class Event : size_t {
+    kCycles,
+    kInstructions,
+    kLlcMisses,
+    kFrontendStalls
+  };
+  static constexpr size_t kNumEvents = 4;
+  // By Event
+  using Counts = std::array<uint64_t, kNumEvents>;
+
+  /// Open the counters of the calling thread. Sample() is true for 1 in
+  /// sample_interval calls.
+  explicit PerfCounters(size_t sample_interval);
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  /// False if not even the cycle counter could be opened
+  inline bool Available() const { return EventAvailable(Event::kCycles); }
+  inline bool EventAvailable(Event event) const {
+    return fds_.at(static_cast<size_t>(event)) >= 0;
+  }
+
+  /// True for every sample_interval-th call, starting with the first
+  inline bool Sample() {
+    const bool sample = (calls_ == 0);
+    calls_ = (calls_ + 1 == sample_interval_) ? 0 : calls_ + 1;
+    return sample;
+  }
+
+  /// The current counts since the counters were opened
+  void Read(Counts& counts) const;
+
+  /// Name of an event in the reports, e.g. "llc_misses"
+  static const char* EventName(Event event);
+
+ private:
+  const size_t sample_interval_;
+  size_t calls_ = 0;
+  // Group leader first, -1 for events that could not be opened
+  std::array<int, kNumEvents> fds_;
+  // Position of each event in the values of a group read
+  std::array<size_t, kNumEvents> read_index_;
+  size_t num_open_ = 0;
+};
+
+#endif  // PERF_COUNTERS_H_
@@ -4,14 +4,21 @@
  */
 #include "phy_stats.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <cstring>
 
 #include "logger.h"
+#include "utils.h"
 
 PhyStats::PhyStats(Config* const cfg, Direction dir)
     : config_(cfg),
       dir_(dir),
+      frame_window_(cfg->FrameWindow()),
+      frame_sampling_(cfg->PhyStatsFrameSampling()),
+      sc_sampling_(cfg->PhyStatsScSampling()),
+      blind_(cfg->BlindLinkQuality() && (dir == Direction::kUplink)),
       logger_plt_snr_(CsvLog::kPltSnr, cfg, dir, true),
       logger_plt_rssi_(CsvLog::kPltRssi, cfg, dir, true),
       logger_plt_noise_(CsvLog::kPltNoise, cfg, dir, true),
@@ -36,24 +43,30 @@ PhyStats::PhyStats(Config* const cfg, Direction dir)
     num_rx_symbols_ = cfg->Frame().NumULSyms();
     num_rxdata_symbols_ = cfg->Frame().NumUlDataSyms();
   }
-  const size_t task_buffer_symbol_num = num_rx_symbols_ * kFrameWnd;
+  const size_t task_buffer_symbol_num = num_rx_symbols_ * frame_window_;
+  sampled_sc_num_ = 0;
+  for (size_t sc = 0; sc < cfg->OfdmDataNum(); sc++) {
+    sampled_sc_num_ += static_cast<size_t>(SampleSc(sc));
+  }
 
   decoded_bits_count_.Calloc(cfg->UeAntNum(), task_buffer_symbol_num,
                              Agora_memory::Alignment_t::kAlign64);
   bit_error_count_.Calloc(cfg->UeAntNum(), task_buffer_symbol_num,
                           Agora_memory::Alignment_t::kAlign64);
-  frame_decoded_bits_.Calloc(cfg->UeAntNum(), kFrameWnd,
+  frame_decoded_bits_.Calloc(cfg->UeAntNum(), frame_window_,
                              Agora_memory::Alignment_t::kAlign64);
-  frame_bit_errors_.Calloc(cfg->UeAntNum(), kFrameWnd,
+  frame_bit_errors_.Calloc(cfg->UeAntNum(), frame_window_,
                            Agora_memory::Alignment_t::kAlign64);
 
   decoded_blocks_count_.Calloc(cfg->UeAntNum(), task_buffer_symbol_num,
                                Agora_memory::Alignment_t::kAlign64);
   block_error_count_.Calloc(cfg->UeAntNum(), task_buffer_symbol_num,
                             Agora_memory::Alignment_t::kAlign64);
-  frame_symbol_errors_.Calloc(cfg->UeAntNum(), kFrameWnd,
+  frame_symbol_errors_.Calloc(cfg->UeAntNum(), frame_window_,
                               Agora_memory::Alignment_t::kAlign64);
-  frame_decoded_symbols_.Calloc(cfg->UeAntNum(), kFrameWnd,
+  frame_block_errors_.Calloc(cfg->UeAntNum(), frame_window_,
+                             Agora_memory::Alignment_t::kAlign64);
+  frame_decoded_symbols_.Calloc(cfg->UeAntNum(), frame_window_,
                                 Agora_memory::Alignment_t::kAlign64);
 
   uncoded_bits_count_.Calloc(cfg->UeAntNum(), task_buffer_symbol_num,
@@ -61,10 +74,14 @@ PhyStats::PhyStats(Config* const cfg, Direction dir)
   uncoded_bit_error_count_.Calloc(cfg->UeAntNum(), task_buffer_symbol_num,
                                   Agora_memory::Alignment_t::kAlign64);
 
-  evm_buffer_.Calloc(kFrameWnd, cfg->UeAntNum(),
+  evm_buffer_.Calloc(frame_window_, cfg->UeAntNum(),
                      Agora_memory::Alignment_t::kAlign64);
-  evm_sc_buffer_.Calloc(kFrameWnd, cfg->UeAntNum() * cfg->OfdmDataNum(),
+  evm_sc_buffer_.Calloc(frame_window_, cfg->UeAntNum() * cfg->OfdmDataNum(),
                         Agora_memory::Alignment_t::kAlign64);
+  blind_evm_buffer_.Calloc(frame_window_, cfg->UeAntNum(),
+                           Agora_memory::Alignment_t::kAlign64);
+  noise_gain_buffer_.Calloc(frame_window_, cfg->UeAntNum(),
+                            Agora_memory::Alignment_t::kAlign64);
 
   if (num_rxdata_symbols_ > 0) {
     gt_cube_ = arma::cx_fcube(cfg->UeAntNum(), cfg->OfdmDataNum(),
@@ -78,29 +95,44 @@ PhyStats::PhyStats(Config* const cfg, Direction dir)
                              false);
       gt_cube_.slice(i) = iq_f_mat.st();
     }
+    gt_table_.Wrap(reinterpret_cast<complex_float*>(gt_cube_.memptr()),
+                   num_rxdata_symbols_, cfg->UeAntNum() * cfg->OfdmDataNum());
+    if (cfg->NumaBindBuffers() && (NumaNodeCount() > 1)) {
+      gt_replica_.Replicate(gt_table_, NumaNodeCount());
+    } else {
+      gt_replica_.Wrap(gt_table_);
+    }
   }
-  dl_pilot_snr_.Calloc(kFrameWnd,
+  dl_pilot_snr_.Calloc(frame_window_,
                        cfg->UeAntNum() * cfg->Frame().ClientDlPilotSymbols(),
                        Agora_memory::Alignment_t::kAlign64);
-  dl_pilot_rssi_.Calloc(kFrameWnd,
+  dl_pilot_rssi_.Calloc(frame_window_,
                         cfg->UeAntNum() * cfg->Frame().ClientDlPilotSymbols(),
                         Agora_memory::Alignment_t::kAlign64);
-  dl_pilot_noise_.Calloc(kFrameWnd,
+  dl_pilot_noise_.Calloc(frame_window_,
                          cfg->UeAntNum() * cfg->Frame().ClientDlPilotSymbols(),
                          Agora_memory::Alignment_t::kAlign64);
-  pilot_snr_.Calloc(kFrameWnd, cfg->UeAntNum() * cfg->BsAntNum(),
+  pilot_snr_.Calloc(frame_window_, cfg->UeAntNum() * cfg->BsAntNum(),
                     Agora_memory::Alignment_t::kAlign64);
-  pilot_rssi_.Calloc(kFrameWnd, cfg->UeAntNum() * cfg->BsAntNum(),
+  pilot_rssi_.Calloc(frame_window_, cfg->UeAntNum() * cfg->BsAntNum(),
                      Agora_memory::Alignment_t::kAlign64);
-  pilot_noise_.Calloc(kFrameWnd, cfg->UeAntNum() * cfg->BsAntNum(),
+  pilot_noise_.Calloc(frame_window_, cfg->UeAntNum() * cfg->BsAntNum(),
                       Agora_memory::Alignment_t::kAlign64);
-  calib_pilot_snr_.Calloc(kFrameWnd, 2 * cfg->BsAntNum(),
+  calib_pilot_snr_.Calloc(frame_window_, 2 * cfg->BsAntNum(),
                           Agora_memory::Alignment_t::kAlign64);
-  csi_cond_.Calloc(kFrameWnd, cfg->OfdmDataNum(),
+  csi_cond_.Calloc(frame_window_, cfg->OfdmDataNum(),
                    Agora_memory::Alignment_t::kAlign64);
+  for (auto& snr : latest_snr_) {
+    snr.store(NAN, std::memory_order_relaxed);
+  }
+  for (auto& sinr : latest_sinr_) {
+    sinr.store(NAN, std::memory_order_relaxed);
+  }
 }
 
 PhyStats::~PhyStats() {
+  gt_replica_.Free();
+  gt_table_.Free();
   decoded_bits_count_.Free();
   bit_error_count_.Free();
 
@@ -111,6 +143,7 @@ PhyStats::~PhyStats() {
   block_error_count_.Free();
 
   frame_symbol_errors_.Free();
+  frame_block_errors_.Free();
   frame_decoded_symbols_.Free();
 
   uncoded_bits_count_.Free();
@@ -118,6 +151,8 @@ PhyStats::~PhyStats() {
 
   evm_buffer_.Free();
   evm_sc_buffer_.Free();
+  blind_evm_buffer_.Free();
+  noise_gain_buffer_.Free();
   csi_cond_.Free();
 
   calib_pilot_snr_.Free();
@@ -130,7 +165,7 @@ PhyStats::~PhyStats() {
 }
 
 void PhyStats::PrintPhyStats() {
-  const size_t task_buffer_symbol_num = num_rx_symbols_ * kFrameWnd;
+  const size_t task_buffer_symbol_num = num_rx_symbols_ * frame_window_;
   std::string tx_type;
   if (dir_ == Direction::kDownlink) {
     tx_type = "Downlink";
@@ -163,11 +198,38 @@ void PhyStats::PrintPhyStats() {
   }
 }
 
+void PhyStats::PrintDecodeIterStats() const {
+  for (size_t ue_id = 0; ue_id < this->config_->UeAntNum(); ue_id++) {
+    size_t num_blocks = 0;
+    size_t total_iter = 0;
+    std::stringstream ss;
+    for (size_t i = 0; i < kDecodeIterBins; i++) {
+      const size_t count =
+          decode_iter_hist_[ue_id][i].load(std::memory_order_relaxed);
+      if (count > 0) {
+        ss << " " << i << ((i == kDecodeIterBins - 1) ? "+" : "") << ":"
+           << count;
+      }
+      num_blocks += count;
+      total_iter += count * i;
+    }
+    if (num_blocks > 0) {
+      AGORA_LOG_INFO("UE %zu: decoder iterations mean %.2f, histogram%s\n",
+                     ue_id,
+                     static_cast<float>(total_iter) /
+                         static_cast<float>(num_blocks),
+                     ss.str().c_str());
+    }
+  }
+}
+
 void PhyStats::PrintEvmStats(size_t frame_id, const arma::uvec& ue_list) {
-  arma::fmat evm_buf(evm_buffer_[frame_id % kFrameWnd], config_->UeAntNum(), 1,
-                     false);
-  arma::fmat evm_mat =
-      evm_buf.st() / (config_->OfdmDataNum() * num_rxdata_symbols_);
+  if (SampleFrame(frame_id) == false) {
+    return;
+  }
+  arma::fmat evm_buf(evm_buffer_[frame_id % frame_window_],
+                     config_->UeAntNum(), 1, false);
+  arma::fmat evm_mat = evm_buf.st() / (sampled_sc_num_ * num_rxdata_symbols_);
 
   [[maybe_unused]] std::stringstream ss;
   ss << "Frame " << frame_id << ", Scheduled User(s): \n  " << ue_list.st()
@@ -177,14 +239,19 @@ void PhyStats::PrintEvmStats(size_t frame_id, const arma::uvec& ue_list) {
 }
 
 float PhyStats::GetEvmSnr(size_t frame_id, size_t ue_id) {
-  float evm = evm_buffer_[frame_id % kFrameWnd][ue_id];
-  evm = evm / config_->OfdmDataNum();
+  if (SampleFrame(frame_id) == false) {
+    return LatestSnr(ue_id);
+  }
+  float evm = evm_buffer_[frame_id % frame_window_][ue_id];
+  evm = evm / sampled_sc_num_;
   return (-10.0f * std::log10(evm));
 }
 
 void PhyStats::ClearEvmBuffer(size_t frame_id) {
   for (size_t i = 0; i < config_->UeAntNum(); i++) {
-    evm_buffer_[frame_id % kFrameWnd][i] = 0.0f;
+    evm_buffer_[frame_id % frame_window_][i] = 0.0f;
+    blind_evm_buffer_[frame_id % frame_window_][i] = 0.0f;
+    noise_gain_buffer_[frame_id % frame_window_][i] = 0.0f;
   }
 }
 
@@ -198,7 +265,7 @@ void PhyStats::PrintDlSnrStats(size_t frame_id, const arma::uvec& ue_list) {
     ss << "UE Antenna " << i << ": [ ";
     for (size_t j = 0; j < dl_pilots_num; j++) {
       float frame_snr =
-          dl_pilot_snr_[frame_id % kFrameWnd][i * dl_pilots_num + j];
+          dl_pilot_snr_[frame_id % frame_window_][i * dl_pilots_num + j];
       ss << frame_snr << " ";
     }
     ss << "] ";
@@ -217,7 +284,7 @@ void PhyStats::PrintUlSnrStats(size_t frame_id) {
     float min_snr = FLT_MAX;
     size_t min_snr_id = 0;
     const float* frame_snr =
-        &pilot_snr_[frame_id % kFrameWnd][i * config_->BsAntNum()];
+        &pilot_snr_[frame_id % frame_window_][i * config_->BsAntNum()];
     for (size_t j = 0; j < config_->BsAntNum(); j++) {
       const size_t radio_id = j / config_->NumChannels();
       const size_t cell_id = config_->CellId().at(radio_id);
@@ -258,7 +325,7 @@ void PhyStats::PrintCalibSnrStats(size_t frame_id) {
     float max_snr = FLT_MIN;
     float min_snr = FLT_MAX;
     const float* frame_snr =
-        &calib_pilot_snr_[frame_id % kFrameWnd][i * config_->BsAntNum()];
+        &calib_pilot_snr_[frame_id % frame_window_][i * config_->BsAntNum()];
     for (size_t j = 0; j < config_->BsAntNum(); j++) {
       const size_t radio_id = j / config_->NumChannels();
       const size_t cell_id = config_->CellId().at(radio_id);
@@ -298,7 +365,7 @@ void PhyStats::RecordPilotSnr(size_t frame_id) {
     ss_snr << frame_id;
     ss_rssi << frame_id;
     ss_noise << frame_id;
-    const size_t frame_slot = frame_id % kFrameWnd;
+    const size_t frame_slot = frame_id % frame_window_;
     for (size_t i = 0; i < config_->UeAntNum(); i++) {
       for (size_t j = 0; j < config_->BsAntNum(); j++) {
         const size_t idx_offset = i * config_->BsAntNum() + j;
@@ -314,14 +381,14 @@ void PhyStats::RecordPilotSnr(size_t frame_id) {
 }
 
 void PhyStats::RecordCsiCond(size_t frame_id, size_t num_rec_sc) {
-  if (kEnableCsvLog) {
+  if (kEnableCsvLog && SampleFrame(frame_id)) {
     std::stringstream ss;
     ss << frame_id;
     const size_t sc_step = config_->OfdmDataNum() / num_rec_sc;
     const size_t sc_offset = sc_step / 2;
     for (size_t sc_rec = 0; sc_rec < num_rec_sc; sc_rec++) {
-      const size_t sc_id = sc_rec * sc_step + sc_offset;
-      ss << "," << (csi_cond_[frame_id % kFrameWnd][sc_id]);
+      const size_t sc_id = SampledSc(sc_rec * sc_step + sc_offset);
+      ss << "," << (csi_cond_[frame_id % frame_window_][sc_id]);
     }
     logger_csi_.Write(ss.str());
   }
@@ -329,15 +396,15 @@ void PhyStats::RecordCsiCond(size_t frame_id, size_t num_rec_sc) {
 
 void PhyStats::RecordEvm(size_t frame_id, size_t num_rec_sc,
                          const arma::uvec& ue_map) {
-  if (kEnableCsvLog) {
+  if (kEnableCsvLog && SampleFrame(frame_id)) {
     std::stringstream ss_evm;
     std::stringstream ss_evm_sc;
     ss_evm << frame_id;
     ss_evm_sc << frame_id;
-    const size_t num_frame_data = config_->OfdmDataNum() * num_rxdata_symbols_;
+    const size_t num_frame_data = sampled_sc_num_ * num_rxdata_symbols_;
     for (size_t ue_id = 0; ue_id < config_->UeAntNum(); ue_id++) {
       float evm_pcnt =
-          ((evm_buffer_[frame_id % kFrameWnd][ue_id] / num_frame_data) *
+          ((evm_buffer_[frame_id % frame_window_][ue_id] / num_frame_data) *
            100.0f);
       ss_evm << ","
              << ((ue_map.at(ue_id) != 0) ? std::to_string(evm_pcnt) : "ns");
@@ -346,11 +413,12 @@ void PhyStats::RecordEvm(size_t frame_id, size_t num_rec_sc,
     const size_t sc_offset = sc_step / 2;
     for (size_t ue_id = 0; ue_id < config_->UeAntNum(); ue_id++) {
       for (size_t sc_rec = 0; sc_rec < num_rec_sc; sc_rec++) {
-        const size_t sc_id = sc_rec * sc_step + sc_offset;
+        const size_t sc_id = SampledSc(sc_rec * sc_step + sc_offset);
         const size_t ue_offset = ue_id * config_->OfdmDataNum();
-        ss_evm_sc << ","
-                  << (evm_sc_buffer_[frame_id % kFrameWnd][ue_offset + sc_id] *
-                      100.0f);
+        ss_evm_sc
+            << ","
+            << (evm_sc_buffer_[frame_id % frame_window_][ue_offset + sc_id] *
+                100.0f);
       }
     }
     logger_evm_.Write(ss_evm.str());
@@ -359,20 +427,69 @@ void PhyStats::RecordEvm(size_t frame_id, size_t num_rec_sc,
 }
 
 void PhyStats::RecordEvmSnr(size_t frame_id, const arma::uvec& ue_map) {
-  if (kEnableCsvLog) {
+  if (kEnableCsvLog && SampleFrame(frame_id)) {
     std::stringstream ss;
     ss << frame_id;
-    const size_t num_frame_data = config_->OfdmDataNum() * num_rxdata_symbols_;
+    const size_t num_frame_data = sampled_sc_num_ * num_rxdata_symbols_;
     for (size_t i = 0; i < config_->UeAntNum(); i++) {
       float evm_snr_db =
-          (-10.0f *
-           std::log10(evm_buffer_[frame_id % kFrameWnd][i] / num_frame_data));
+          (-10.0f * std::log10(evm_buffer_[frame_id % frame_window_][i] /
+                               num_frame_data));
       ss << "," << ((ue_map.at(i) != 0) ? std::to_string(evm_snr_db) : "ns");
     }
     logger_evm_snr_.Write(ss.str());
   }
 }
 
+void PhyStats::UpdateLatestSnr(size_t frame_id, const arma::uvec& ue_map) {
+  if (SampleFrame(frame_id) == false) {
+    return;
+  }
+  const size_t frame_slot = frame_id % frame_window_;
+  const size_t num_frame_data = sampled_sc_num_ * num_rxdata_symbols_;
+  const Table<float>& evm = blind_ ? blind_evm_buffer_ : evm_buffer_;
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    if (ue_map.at(i) != 0) {
+      latest_snr_.at(i).store(
+          -10.0f * std::log10(evm[frame_slot][i] / num_frame_data),
+          std::memory_order_relaxed);
+      if (blind_) {
+        // Unit-power symbols over the pilot noise of the UE, amplified by
+        // the beam rows
+        float noise = 0.0f;
+        for (size_t ant = 0; ant < config_->BsAntNum(); ant++) {
+          noise += pilot_noise_[frame_slot][i * config_->BsAntNum() + ant];
+        }
+        noise /= config_->BsAntNum();
+        latest_sinr_.at(i).store(
+            -10.0f * std::log10(noise * noise_gain_buffer_[frame_slot][i] /
+                                sampled_sc_num_),
+            std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+float PhyStats::MeanDecodeIterations(size_t ue_id) const {
+  size_t num_blocks = 0;
+  size_t total_iter = 0;
+  for (size_t i = 0; i < kDecodeIterBins; i++) {
+    const size_t count =
+        decode_iter_hist_[ue_id][i].load(std::memory_order_relaxed);
+    num_blocks += count;
+    total_iter += count * i;
+  }
+  return (num_blocks == 0) ? NAN
+                           : static_cast<float>(total_iter) /
+                                 static_cast<float>(num_blocks);
+}
+
+void PhyStats::RecordDecodeIterations(size_t ue_id, size_t num_iter) {
+  decode_iter_hist_.at(ue_id)
+      .at(std::min(num_iter, kDecodeIterBins - 1))
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
 void PhyStats::RecordDlPilotSnr(size_t frame_id, const arma::uvec& ue_map) {
   if (kEnableCsvLog) {
     const size_t dl_pilots_num = config_->Frame().ClientDlPilotSymbols();
@@ -383,7 +500,7 @@ void PhyStats::RecordDlPilotSnr(size_t frame_id, const arma::uvec& ue_map) {
       ss_snr << frame_id;
       ss_rssi << frame_id;
       ss_noise << frame_id;
-      const size_t frame_slot = frame_id % kFrameWnd;
+      const size_t frame_slot = frame_id % frame_window_;
       for (size_t i = 0; i < config_->UeAntNum(); i++) {
         for (size_t j = 0; j < dl_pilots_num; j++) {
           const size_t idx_offset = i * dl_pilots_num + j;
@@ -414,7 +531,8 @@ void PhyStats::RecordDlCsi(size_t frame_id, size_t num_rec_sc,
                            const Table<complex_float>& csi_buffer,
                            const arma::uvec& ue_list) {
   if (kEnableCsvLog) {
-    const size_t csi_offset_base = (frame_id % kFrameWnd) * config_->UeAntNum();
+    const size_t csi_offset_base =
+        (frame_id % frame_window_) * config_->UeAntNum();
     std::stringstream ss;
     ss << frame_id;
     for (long long unsigned ue_id : ue_list) {
@@ -435,7 +553,7 @@ void PhyStats::RecordBer(size_t frame_id, const arma::uvec& ue_map) {
   if (kEnableCsvLog) {
     std::stringstream ss;
     ss << frame_id;
-    const size_t frame_slot = frame_id % kFrameWnd;
+    const size_t frame_slot = frame_id % frame_window_;
     for (size_t i = 0; i < config_->UeAntNum(); i++) {
       size_t& error_bits = frame_bit_errors_[i][frame_slot];
       size_t& total_bits = frame_decoded_bits_[i][frame_slot];
@@ -456,7 +574,7 @@ void PhyStats::RecordSer(size_t frame_id, const arma::uvec& ue_map) {
   if (kEnableCsvLog) {
     std::stringstream ss;
     ss << frame_id;
-    const size_t frame_slot = frame_id % kFrameWnd;
+    const size_t frame_slot = frame_id % frame_window_;
     for (size_t i = 0; i < config_->UeAntNum(); i++) {
       size_t& error_symbols = frame_symbol_errors_[i][frame_slot];
       size_t& total_symbols = frame_decoded_symbols_[i][frame_slot];
@@ -488,8 +606,9 @@ void PhyStats::UpdateCalibPilotSnr(size_t frame_id, size_t calib_sym_id,
   const float noise =
       config_->OfdmCaNum() * (noise_per_sc1 + noise_per_sc2) / 2;
   const float snr = (rssi - noise) / noise;
-  calib_pilot_snr_[frame_id % kFrameWnd][calib_sym_id * config_->BsAntNum() +
-                                         ant_id] = (10.0f * std::log10(snr));
+  calib_pilot_snr_[frame_id % frame_window_]
+                  [calib_sym_id * config_->BsAntNum() + ant_id] =
+                      (10.0f * std::log10(snr));
 }
 
 void PhyStats::UpdatePilotSnr(size_t frame_id, size_t ue_id, size_t ant_id,
@@ -502,7 +621,7 @@ void PhyStats::UpdatePilotSnr(size_t frame_id, size_t ue_id, size_t ant_id,
   fft_abs_mag.shed_rows(config_->OfdmDataStart(), config_->OfdmDataStop() - 1);
   const float noise_per_sc = arma::mean(fft_abs_mag);
   const float snr = (rssi_per_sc - noise_per_sc) / noise_per_sc;
-  const size_t frame_slot = frame_id % kFrameWnd;
+  const size_t frame_slot = frame_id % frame_window_;
   const size_t idx_offset = ue_id * config_->BsAntNum() + ant_id;
   pilot_snr_[frame_slot][idx_offset] = 10.0f * std::log10(snr);
   pilot_rssi_[frame_slot][idx_offset] = rssi_per_sc;
@@ -519,7 +638,7 @@ void PhyStats::UpdateDlPilotSnr(size_t frame_id, size_t symbol_id,
   fft_abs_mag.shed_rows(config_->OfdmDataStart(), config_->OfdmDataStop() - 1);
   const float noise_per_sc = arma::mean(fft_abs_mag);
   const float snr = (rssi_per_sc - noise_per_sc) / noise_per_sc;
-  const size_t frame_slot = frame_id % kFrameWnd;
+  const size_t frame_slot = frame_id % frame_window_;
   const size_t idx_offset =
       ant_id * config_->Frame().ClientDlPilotSymbols() + symbol_id;
   dl_pilot_snr_[frame_slot][idx_offset] = 10.0f * std::log10(snr);
@@ -528,65 +647,213 @@ void PhyStats::UpdateDlPilotSnr(size_t frame_id, size_t symbol_id,
 }
 
 void PhyStats::PrintBeamStats(size_t frame_id) {
-  const size_t frame_slot = frame_id % kFrameWnd;
+  if (SampleFrame(frame_id) == false) {
+    return;
+  }
+  const size_t frame_slot = frame_id % frame_window_;
   [[maybe_unused]] std::stringstream ss;
   ss << "Frame " << frame_id
      << " Beamweight matrix inverse condition number range: " << std::fixed
      << std::setw(5) << std::setprecision(2);
-  arma::fvec cond_vec(csi_cond_[frame_slot], config_->OfdmDataNum(), false);
+  const float* cond = csi_cond_[frame_slot];
   float max_cond = 0;
   float min_cond = 1;
+  float sum_cond = 0;
   for (size_t j = 0; j < config_->OfdmDataNum(); j++) {
-    if (cond_vec.at(j) < min_cond) {
-      min_cond = cond_vec.at(j);
-    }
-    if (cond_vec.at(j) > max_cond) {
-      max_cond = cond_vec.at(j);
+    if (SampleSc(j)) {
+      min_cond = std::min(min_cond, cond[j]);
+      max_cond = std::max(max_cond, cond[j]);
+      sum_cond += cond[j];
     }
   }
   ss << "[" << min_cond << "," << max_cond
-     << "], Mean: " << arma::mean(cond_vec);
+     << "], Mean: " << (sum_cond / sampled_sc_num_);
   ss << std::endl;
   AGORA_LOG_INFO("%s", ss.str().c_str());
 }
 
 void PhyStats::UpdateCsiCond(size_t frame_id, size_t sc_id, float cond) {
-  csi_cond_[frame_id % kFrameWnd][sc_id] = cond;
+  csi_cond_[frame_id % frame_window_][sc_id] = cond;
 }
 
-void PhyStats::UpdateEvm(size_t frame_id, size_t data_symbol_id, size_t sc_id,
-                         const arma::cx_fvec& eq_vec,
-                         const arma::uvec& ue_list) {
-  arma::cx_fvec tx_data = gt_cube_.slice(data_symbol_id).col(sc_id);
-  arma::fvec evm_vec = arma::square(arma::abs(eq_vec - tx_data(ue_list)));
-  evm_sc_buffer_[frame_id % kFrameWnd][sc_id] = arma::mean(evm_vec);
-  arma::fvec evm_buf(evm_buffer_[frame_id % kFrameWnd], config_->UeAntNum(),
-                     false);
-  evm_buf(ue_list) += evm_vec;
+void PhyStats::UpdateEvmBlock(size_t frame_id, size_t data_symbol_id,
+                              size_t sc_id, size_t num_sc,
+                              const complex_float* eq, const size_t* ue_list,
+                              size_t num_streams, int numa_node) {
+  if (SampleFrame(frame_id) == false) {
+    return;
+  }
+  const size_t frame_slot = frame_id % frame_window_;
+  const size_t num_ues = config_->UeAntNum();
+  // Subcarrier-major like eq, UE ue of subcarrier sc at sc * num_ues + ue
+  const complex_float* gt = gt_replica_.On(numa_node)[data_symbol_id];
+  // If the streams are all the UEs in order, a block of eq has the layout of
+  // the ground truth and the errors are one flat loop
+  bool all_ues = (num_streams == num_ues);
+  for (size_t i = 0; all_ues && (i < num_streams); i++) {
+    all_ues = (ue_list[i] == i);
+  }
+
+  std::array<float, kMaxUEs * kSCsPerCacheline> err;
+  std::array<float, kMaxUEs> evm_sum{};
+  const size_t sc_end = sc_id + num_sc;
+  size_t block_end;
+  for (size_t block = sc_id; block < sc_end; block = block_end) {
+    block_end = std::min(sc_end, ((block / kSCsPerCacheline) + 1) *
+                                     kSCsPerCacheline);
+    if (SampleSc(block) == false) {
+      continue;
+    }
+    const size_t block_sc = block_end - block;
+    const complex_float* eq_block = &eq[(block - sc_id) * num_streams];
+    if (all_ues) {
+      const complex_float* gt_block = &gt[block * num_ues];
+      for (size_t i = 0; i < block_sc * num_streams; i++) {
+        const float re = eq_block[i].re - gt_block[i].re;
+        const float im = eq_block[i].im - gt_block[i].im;
+        err[i] = (re * re) + (im * im);
+      }
+    } else {
+      for (size_t j = 0; j < block_sc; j++) {
+        for (size_t i = 0; i < num_streams; i++) {
+          const complex_float& tx = gt[((block + j) * num_ues) + ue_list[i]];
+          const float re = eq_block[j * num_streams + i].re - tx.re;
+          const float im = eq_block[j * num_streams + i].im - tx.im;
+          err[j * num_streams + i] = (re * re) + (im * im);
+        }
+      }
+    }
+    for (size_t j = 0; j < block_sc; j++) {
+      for (size_t i = 0; i < num_streams; i++) {
+        const float e = err[j * num_streams + i];
+        evm_sc_buffer_[frame_slot]
+                      [ue_list[i] * config_->OfdmDataNum() + block + j] = e;
+        evm_sum[i] += e;
+      }
+    }
+  }
+  for (size_t i = 0; i < num_streams; i++) {
+    evm_buffer_[frame_slot][ue_list[i]] += evm_sum[i];
+  }
+}
+
+// Squared distance of v to the nearest odd integer within +-max_level, a
+// level of a square QAM with unit spacing
+static inline float QamDecisionError(float v, float max_level) {
+  const float level =
+      std::min(max_level, std::max(-max_level, 2.0f * std::floor(v * 0.5f) +
+                                                   1.0f));
+  return (v - level) * (v - level);
+}
+
+void PhyStats::UpdateBlindEvmBlock(size_t frame_id, size_t sc_id,
+                                   size_t num_sc, const complex_float* eq,
+                                   const size_t* ue_list, size_t num_streams,
+                                   size_t mod_order_bits) {
+  if ((mod_order_bits % 2 != 0) || (SampleFrame(frame_id) == false)) {
+    return;
+  }
+  // M-QAM has sqrt(M) levels per dimension and an average power of
+  // 2 (M - 1) / 3 with odd integer levels
+  const float num_points = static_cast<float>(1u << mod_order_bits);
+  const float max_level =
+      static_cast<float>(1u << (mod_order_bits / 2)) - 1.0f;
+  const float scale = std::sqrt(2.0f * (num_points - 1.0f) / 3.0f);
+  const float inv_power = 1.0f / (scale * scale);
+
+  std::array<float, kMaxUEs> evm_sum{};
+  const size_t sc_end = sc_id + num_sc;
+  size_t block_end;
+  for (size_t block = sc_id; block < sc_end; block = block_end) {
+    block_end = std::min(sc_end, ((block / kSCsPerCacheline) + 1) *
+                                     kSCsPerCacheline);
+    if (SampleSc(block) == false) {
+      continue;
+    }
+    const complex_float* eq_block = &eq[(block - sc_id) * num_streams];
+    for (size_t j = 0; j < block_end - block; j++) {
+      for (size_t i = 0; i < num_streams; i++) {
+        const complex_float& x = eq_block[j * num_streams + i];
+        evm_sum[i] += QamDecisionError(x.re * scale, max_level) +
+                      QamDecisionError(x.im * scale, max_level);
+      }
+    }
+  }
+  const size_t frame_slot = frame_id % frame_window_;
+  for (size_t i = 0; i < num_streams; i++) {
+    blind_evm_buffer_[frame_slot][ue_list[i]] += evm_sum[i] * inv_power;
+  }
+}
+
+void PhyStats::UpdatePostEqNoiseGain(size_t frame_id, size_t sc_id,
+                                     const complex_float* ul_beam,
+                                     const size_t* ue_list,
+                                     size_t num_streams, size_t num_ants) {
+  if ((SampleFrame(frame_id) == false) || (SampleSc(sc_id) == false)) {
+    return;
+  }
+  std::array<float, kMaxUEs> gain{};
+  for (size_t ant = 0; ant < num_ants; ant++) {
+    for (size_t i = 0; i < num_streams; i++) {
+      const complex_float& w = ul_beam[ant * num_streams + i];
+      gain[i] += (w.re * w.re) + (w.im * w.im);
+    }
+  }
+  const size_t frame_slot = frame_id % frame_window_;
+  for (size_t i = 0; i < num_streams; i++) {
+    noise_gain_buffer_[frame_slot][ue_list[i]] += gain[i];
+  }
 }
 
 void PhyStats::UpdateEvm(size_t frame_id, size_t data_symbol_id, size_t sc_id,
                          size_t tx_ue_id, size_t rx_ue_id, arma::cx_float eq) {
+  if ((SampleFrame(frame_id) == false) || (SampleSc(sc_id) == false)) {
+    return;
+  }
   const float evm =
       std::norm(eq - gt_cube_.slice(data_symbol_id)(tx_ue_id, sc_id));
-  evm_buffer_[frame_id % kFrameWnd][rx_ue_id] += evm;
-  evm_sc_buffer_[frame_id % kFrameWnd]
+  evm_buffer_[frame_id % frame_window_][rx_ue_id] += evm;
+  evm_sc_buffer_[frame_id % frame_window_]
                 [rx_ue_id * config_->OfdmDataNum() + sc_id] = evm;
 }
 
 void PhyStats::UpdateBitErrors(size_t ue_id, size_t offset, size_t frame_slot,
                                uint8_t tx_byte, uint8_t rx_byte) {
-  static constexpr size_t kBitsInByte = 8;
   AGORA_LOG_TRACE("Updating bit errors: User %zu Offset  %zu Tx %d Rx %d\n",
                   ue_id, offset, tx_byte, rx_byte);
-  uint8_t xor_byte(tx_byte ^ rx_byte);
+  const size_t bit_errors = __builtin_popcount(tx_byte ^ rx_byte);
+  bit_error_count_[ue_id][offset] += bit_errors;
+  frame_bit_errors_[ue_id][frame_slot] += bit_errors;
+}
+
+size_t PhyStats::UpdateBitErrors(size_t ue_id, size_t offset,
+                                 size_t frame_slot, const uint8_t* tx_bytes,
+                                 const uint8_t* rx_bytes, size_t num_bytes) {
+  static constexpr uint64_t kLowBitOfBytes = 0x0101010101010101ull;
   size_t bit_errors = 0;
-  for (size_t j = 0; j < kBitsInByte; j++) {
-    bit_errors += (xor_byte & 1);
-    xor_byte >>= 1;
+  size_t byte_errors = 0;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= num_bytes; i += sizeof(uint64_t)) {
+    uint64_t tx_word;
+    uint64_t rx_word;
+    std::memcpy(&tx_word, &tx_bytes[i], sizeof(uint64_t));
+    std::memcpy(&rx_word, &rx_bytes[i], sizeof(uint64_t));
+    uint64_t diff = tx_word ^ rx_word;
+    bit_errors += __builtin_popcountll(diff);
+    // Fold each byte onto its lowest bit to count the bytes in error
+    diff |= (diff >> 4);
+    diff |= (diff >> 2);
+    diff |= (diff >> 1);
+    byte_errors += __builtin_popcountll(diff & kLowBitOfBytes);
+  }
+  for (; i < num_bytes; i++) {
+    const uint8_t diff = tx_bytes[i] ^ rx_bytes[i];
+    bit_errors += __builtin_popcount(diff);
+    byte_errors += static_cast<size_t>(diff != 0);
   }
   bit_error_count_[ue_id][offset] += bit_errors;
   frame_bit_errors_[ue_id][frame_slot] += bit_errors;
+  return byte_errors;
 }
 
 void PhyStats::UpdateDecodedBits(size_t ue_id, size_t offset, size_t frame_slot,
@@ -600,6 +867,18 @@ void PhyStats::UpdateBlockErrors(size_t ue_id, size_t offset, size_t frame_slot,
   block_error_count_[ue_id][offset] +=
       static_cast<unsigned long>(block_error_count > 0);
   frame_symbol_errors_[ue_id][frame_slot] += block_error_count;
+  frame_block_errors_[ue_id][frame_slot] +=
+      static_cast<size_t>(block_error_count > 0);
+}
+
+size_t PhyStats::PopFrameBlockErrors(size_t frame_id) {
+  const size_t frame_slot = frame_id % frame_window_;
+  size_t block_errors = 0;
+  for (size_t i = 0; i < config_->UeAntNum(); i++) {
+    block_errors += frame_block_errors_[i][frame_slot];
+    frame_block_errors_[i][frame_slot] = 0;
+  }
+  return block_errors;
 }
 
 void PhyStats::IncrementDecodedBlocks(size_t ue_id, size_t offset,
@@ -608,16 +887,24 @@ void PhyStats::IncrementDecodedBlocks(size_t ue_id, size_t offset,
   frame_decoded_symbols_[ue_id][frame_slot] += config_->GetOFDMDataNum();
 }
 
+void PhyStats::GetBlockCounts(size_t ue_id, size_t* decoded_blocks,
+                              size_t* block_errors) const {
+  *decoded_blocks = 0;
+  *block_errors = 0;
+  const size_t* ue_blocks = decoded_blocks_count_.At(ue_id);
+  const size_t* ue_errors = block_error_count_.At(ue_id);
+  for (size_t i = 0u; i < num_rx_symbols_ * frame_window_; i++) {
+    *decoded_blocks += ue_blocks[i];
+    *block_errors += ue_errors[i];
+  }
+}
+
 void PhyStats::UpdateUncodedBitErrors(size_t ue_id, size_t offset,
                                       size_t mod_bit_size, uint8_t tx_byte,
                                       uint8_t rx_byte) {
-  uint8_t xor_byte(tx_byte ^ rx_byte);
-  size_t bit_errors = 0;
-  for (size_t j = 0; j < mod_bit_size; j++) {
-    bit_errors += xor_byte & 1;
-    xor_byte >>= 1;
-  }
-  uncoded_bit_error_count_[ue_id][offset] += bit_errors;
+  const unsigned int mask = (1u << mod_bit_size) - 1;
+  uncoded_bit_error_count_[ue_id][offset] +=
+      __builtin_popcount((tx_byte ^ rx_byte) & mask);
 }
 
 void PhyStats::UpdateUncodedBits(size_t ue_id, size_t offset,
@@ -651,7 +938,7 @@ void PhyStats::UpdateCalibMat(size_t frame_id, size_t sc_id,
 }
 
 float PhyStats::GetNoise(size_t frame_id, const arma::uvec& ue_list) {
-  arma::fvec noise_vec(pilot_noise_[frame_id % kFrameWnd],
+  arma::fvec noise_vec(pilot_noise_[frame_id % frame_window_],
                        config_->BsAntNum() * config_->UeAntNum(), false);
 
   return arma::as_scalar(arma::mean(noise_vec(ue_list)));
@@ -5,11 +5,15 @@
 #ifndef PHY_STATS_H_
 #define PHY_STATS_H_
 
+#include <array>
+#include <atomic>
+
 #include "armadillo"
 #include "common_typedef_sdk.h"
 #include "config.h"
 #include "mat_logger.h"
 #include "memory_manage.h"
+#include "numa_replica.h"
 #include "symbols.h"
 
 class PhyStats {
@@ -20,18 +24,52 @@ class PhyStats {
   void PrintEvmStats(size_t frame_id, const arma::uvec& ue_list);
   void UpdateBitErrors(size_t ue_id, size_t offset, size_t frame_slot,
                        uint8_t tx_byte, uint8_t rx_byte);
+  /// Add the bit errors of num_bytes received bytes against the transmitted
+  /// ones, counted 64 bits at a time. Returns the number of bytes in error,
+  /// for UpdateBlockErrors().
+  size_t UpdateBitErrors(size_t ue_id, size_t offset, size_t frame_slot,
+                         const uint8_t* tx_bytes, const uint8_t* rx_bytes,
+                         size_t num_bytes);
   void UpdateDecodedBits(size_t ue_id, size_t offset, size_t frame_slot,
                          size_t new_bits_num);
   void UpdateBlockErrors(size_t ue_id, size_t offset, size_t frame_slot,
                          size_t block_error_count);
   void IncrementDecodedBlocks(size_t ue_id, size_t offset, size_t frame_slot);
+  /// Code blocks of a UE decoded so far, and those with errors, as
+  /// PrintPhyStats() reports them. The workers may add to the counts while
+  /// they are summed.
+  void GetBlockCounts(size_t ue_id, size_t* decoded_blocks,
+                      size_t* block_errors) const;
+  /// Code blocks of the frame decoded with errors, over all the UEs. Clears
+  /// the count for the next frame in the slot.
+  size_t PopFrameBlockErrors(size_t frame_id);
   void UpdateUncodedBitErrors(size_t ue_id, size_t offset, size_t mod_bit_size,
                               uint8_t tx_byte, uint8_t rx_byte);
   void UpdateUncodedBits(size_t ue_id, size_t offset, size_t new_bits_num);
-  void UpdateEvm(size_t frame_id, size_t data_symbol_id, size_t sc_id,
-                 const arma::cx_fvec& eq_vec, const arma::uvec& ue_list);
+  /// Add the EVM of num_sc subcarriers from sc_id, whose equalized streams
+  /// are eq[sc * num_streams + stream], stream i being UE ue_list[i]. Skips
+  /// the frames and subcarrier blocks that are not sampled. The ground truth
+  /// is read from its copy on numa_node, -1 for the master's.
+  void UpdateEvmBlock(size_t frame_id, size_t data_symbol_id, size_t sc_id,
+                      size_t num_sc, const complex_float* eq,
+                      const size_t* ue_list, size_t num_streams,
+                      int numa_node = -1);
   void UpdateEvm(size_t frame_id, size_t data_symbol_id, size_t sc_id,
                  size_t tx_ue_id, size_t rx_ue_id, arma::cx_float eq);
+  /// Add the decision-directed EVM of a block laid out as in
+  /// UpdateEvmBlock(), against the nearest points of the square QAM of
+  /// mod_order_bits. Needs no ground truth.
+  void UpdateBlindEvmBlock(size_t frame_id, size_t sc_id, size_t num_sc,
+                           const complex_float* eq, const size_t* ue_list,
+                           size_t num_streams, size_t mod_order_bits);
+  /// Add the noise gain of the uplink beam matrix of a subcarrier, the squared
+  /// norm of the row of each stream, from which UpdateLatestSnr() estimates
+  /// the post-equalization SINR. ul_beam is num_streams x num_ants,
+  /// column-major.
+  void UpdatePostEqNoiseGain(size_t frame_id, size_t sc_id,
+                             const complex_float* ul_beam,
+                             const size_t* ue_list, size_t num_streams,
+                             size_t num_ants);
   void RecordEvmSnr(size_t frame_id, const arma::uvec& ue_map);
   void RecordDlPilotSnr(size_t frame_id, const arma::uvec& ue_map);
   void RecordDlCsi(size_t frame_id, size_t num_rec_sc,
@@ -64,9 +102,62 @@ class PhyStats {
   void UpdateCalibMat(size_t frame_id, size_t sc_id,
                       const arma::cx_fvec& vec_in);
 
+  /// Whether the EVM and CSI condition numbers of a frame are collected,
+  /// one frame in Config::PhyStatsFrameSampling()
+  inline bool SampleFrame(size_t frame_id) const {
+    return (frame_id % frame_sampling_) == 0;
+  }
+  /// Whether the EVM and CSI condition number of a subcarrier are collected,
+  /// one block of kSCsPerCacheline subcarriers in
+  /// Config::PhyStatsScSampling()
+  inline bool SampleSc(size_t sc_id) const {
+    return ((sc_id / kSCsPerCacheline) % sc_sampling_) == 0;
+  }
+
+  /// Publish the EVM SNR of the scheduled UEs of a frame, once the EVM of
+  /// all its data symbols is in, as the latest SNR of the UEs. With
+  /// Config::BlindLinkQuality() the EVM is the decision-directed one, and
+  /// the post-equalization SINR is published too.
+  void UpdateLatestSnr(size_t frame_id, const arma::uvec& ue_map);
+  /// Latest published SNR of a UE in dB, NaN before the first one. Safe to
+  /// call from the workers.
+  inline float LatestSnr(size_t ue_id) const {
+    return latest_snr_.at(ue_id).load(std::memory_order_relaxed);
+  }
+  /// Latest published post-equalization SINR of a UE in dB, NaN without
+  /// Config::BlindLinkQuality()
+  inline float LatestSinr(size_t ue_id) const {
+    return latest_sinr_.at(ue_id).load(std::memory_order_relaxed);
+  }
+  /// Count a code block of a UE decoded in num_iter iterations. Safe to
+  /// call from the workers.
+  void RecordDecodeIterations(size_t ue_id, size_t num_iter);
+  void PrintDecodeIterStats() const;
+  /// Mean decoder iterations of the code blocks of a UE so far, NaN before
+  /// the first one
+  float MeanDecodeIterations(size_t ue_id) const;
+
  private:
+  // Bins of the decoder iteration histograms, the last one counts the code
+  // blocks with more iterations
+  static constexpr size_t kDecodeIterBins = 32;
+
+  // The subcarrier at or below sc_id whose statistics are collected
+  inline size_t SampledSc(size_t sc_id) const {
+    return sc_id -
+           (((sc_id / kSCsPerCacheline) % sc_sampling_) * kSCsPerCacheline);
+  }
+
   Config const* const config_;
   Direction dir_;
+  // Frames held by the per-frame tables, Config::FrameWindow()
+  const size_t frame_window_;
+  const size_t frame_sampling_;
+  const size_t sc_sampling_;
+  // Data subcarriers of the sampled blocks, which the EVM is averaged over
+  size_t sampled_sc_num_;
+  // Config::BlindLinkQuality(), for the uplink only
+  const bool blind_;
   Table<size_t> decoded_bits_count_;
   Table<size_t> bit_error_count_;
   Table<size_t> frame_decoded_bits_;
@@ -74,11 +165,15 @@ class PhyStats {
   Table<size_t> decoded_blocks_count_;
   Table<size_t> block_error_count_;
   Table<size_t> frame_symbol_errors_;
+  Table<size_t> frame_block_errors_;
   Table<size_t> frame_decoded_symbols_;
   Table<size_t> uncoded_bits_count_;
   Table<size_t> uncoded_bit_error_count_;
   Table<float> evm_buffer_;
   Table<float> evm_sc_buffer_;
+  // Decision-directed EVM sums and beam noise gain sums, [frame_slot][ue]
+  Table<float> blind_evm_buffer_;
+  Table<float> noise_gain_buffer_;
   Table<float> pilot_snr_;
   Table<float> pilot_rssi_;
   Table<float> pilot_noise_;
@@ -90,6 +185,10 @@ class PhyStats {
   Table<float> calib_;
 
   arma::cx_fcube gt_cube_;
+  // gt_cube_ as a table of a slice per data symbol, and its copies on each
+  // NUMA node with numa_bind_buffers
+  Table<complex_float> gt_table_;
+  NumaReplica<complex_float> gt_replica_;
   size_t num_rx_symbols_;
   size_t num_rxdata_symbols_;
 
@@ -110,6 +209,13 @@ class PhyStats {
   CsvLog::MatLogger logger_dl_csi_;
   CsvLog::MatLogger logger_ul_beam_;
   CsvLog::MatLogger logger_dl_beam_;
+
+  std::array<std::atomic<float>, kMaxUEs> latest_snr_;
+  std::array<std::atomic<float>, kMaxUEs> latest_sinr_;
+  // decode_iter_hist_[i][j] is the number of code blocks of UE i decoded in
+  // j iterations
+  std::array<std::array<std::atomic<size_t>, kDecodeIterBins>, kMaxUEs>
+      decode_iter_hist_{};
 };
 
 #endif  // PHY_STATS_H_
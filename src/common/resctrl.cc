@@ -0,0 +1,263 @@
+/**
+ * @file resctrl.cc
+ * @brief Implementation file for the resctrl groups of the thread classes.
+ */
+#include "resctrl.h"
+
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "logger.h"
+
+namespace {
+
+std::mutex resctrl_mutex;
+// Group directory of each class
+std::map<std::string, std::string> group_dirs;
+// Class and CPU of each thread moved into a group, by thread id
+std::map<pid_t, std::pair<std::string, int>> group_threads;
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream file(path);
+  file << content;
+  file.flush();
+  if (file.good() == false) {
+    AGORA_LOG_WARN("Resctrl: cannot write \"%s\" to %s\n",
+                   content.substr(0, content.find('\n')).c_str(),
+                   path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// The domain ids of a resource in the schemata of a group, e.g. {"0", "1"}
+// for the line "L3:0=7ff;1=7ff"
+std::vector<std::string> Domains(const std::string& schemata,
+                                 const std::string& resource) {
+  std::vector<std::string> domains;
+  std::istringstream lines(schemata);
+  std::string line;
+  while (std::getline(lines, line)) {
+    line.erase(0, line.find_first_not_of(' '));
+    if (line.rfind(resource + ":", 0) != 0) {
+      continue;
+    }
+    std::istringstream entries(line.substr(resource.size() + 1));
+    std::string entry;
+    while (std::getline(entries, entry, ';')) {
+      domains.push_back(entry.substr(0, entry.find('=')));
+    }
+  }
+  return domains;
+}
+
+// The schemata line of resource with value on every domain
+std::string SchemataLine(const std::string& resource,
+                         const std::vector<std::string>& domains,
+                         const std::string& value) {
+  std::string line = resource + ":";
+  for (size_t i = 0; i < domains.size(); i++) {
+    line += ((i == 0) ? "" : ";") + domains.at(i) + "=" + value;
+  }
+  return line + "\n";
+}
+
+// Sum of a monitoring file over the L3 domains of a group, -1 if the group
+// is not monitored
+double SumMonData(const std::string& group_dir, const std::string& event) {
+  std::error_code ec;
+  const std::filesystem::path mon_data(group_dir + "/mon_data");
+  if (std::filesystem::is_directory(mon_data, ec) == false) {
+    return -1.0;
+  }
+  double sum = -1.0;
+  for (const auto& domain :
+       std::filesystem::directory_iterator(mon_data, ec)) {
+    const std::string value = ReadFile((domain.path() / event).string());
+    if (value.empty() == false) {
+      sum = std::max(sum, 0.0) + std::strtod(value.c_str(), nullptr);
+    }
+  }
+  return sum;
+}
+
+void RemoveGroups() {
+  for (const auto& group : group_dirs) {
+    if (rmdir(group.second.c_str()) != 0) {
+      AGORA_LOG_WARN("Resctrl: cannot remove %s: %s\n",
+                     group.second.c_str(), std::strerror(errno));
+    }
+  }
+  group_dirs.clear();
+  group_threads.clear();
+}
+
+}  // namespace
+
+bool Resctrl::Setup(const std::map<std::string, ClassAllocation>& classes,
+                    const std::string& root) {
+  std::scoped_lock lock(resctrl_mutex);
+  const std::string root_schemata = ReadFile(root + "/schemata");
+  if (root_schemata.empty()) {
+    AGORA_LOG_WARN(
+        "Resctrl: %s is not mounted, the thread classes share the cache and "
+        "the memory bandwidth\n",
+        root.c_str());
+    return false;
+  }
+  const std::vector<std::string> l3_domains = Domains(root_schemata, "L3");
+  const std::vector<std::string> mb_domains = Domains(root_schemata, "MB");
+
+  for (const auto& [thread_class, allocation] : classes) {
+    const std::string dir = root + "/agora_" + thread_class;
+    if ((mkdir(dir.c_str(), 0755) != 0) && (errno != EEXIST)) {
+      AGORA_LOG_WARN("Resctrl: cannot create %s: %s\n", dir.c_str(),
+                     std::strerror(errno));
+      RemoveGroups();
+      return false;
+    }
+    group_dirs.emplace(thread_class, dir);
+
+    // The kernel takes the lines of both resources in one write
+    bool ok = true;
+    std::string schemata;
+    if (allocation.l3_mask_.empty() == false) {
+      std::string mask = allocation.l3_mask_;
+      if (mask.rfind("0x", 0) == 0) {
+        mask = mask.substr(2);
+      }
+      ok = (l3_domains.empty() == false);
+      schemata += SchemataLine("L3", l3_domains, mask);
+    }
+    if (allocation.mba_percent_ > 0) {
+      ok = ok && (mb_domains.empty() == false);
+      schemata += SchemataLine("MB", mb_domains,
+                               std::to_string(allocation.mba_percent_));
+    }
+    if (ok && (schemata.empty() == false)) {
+      ok = WriteFile(dir + "/schemata", schemata);
+    }
+    if (ok == false) {
+      AGORA_LOG_WARN(
+          "Resctrl: the system does not support the allocation of the %s "
+          "class\n",
+          thread_class.c_str());
+      RemoveGroups();
+      return false;
+    }
+    AGORA_LOG_INFO("Resctrl: %s threads in %s, L3 mask %s, MBA %zu%%\n",
+                   thread_class.c_str(), dir.c_str(),
+                   allocation.l3_mask_.empty() ? "default"
+                                               : allocation.l3_mask_.c_str(),
+                   (allocation.mba_percent_ > 0) ? allocation.mba_percent_
+                                                 : 100);
+  }
+  return true;
+}
+
+bool Resctrl::HasClass(const std::string& thread_class) {
+  std::scoped_lock lock(resctrl_mutex);
+  return group_dirs.count(thread_class) > 0;
+}
+
+void Resctrl::AssignThread(const std::string& thread_class) {
+  std::scoped_lock lock(resctrl_mutex);
+  const auto group = group_dirs.find(thread_class);
+  if (group == group_dirs.end()) {
+    return;
+  }
+  // A thread is in one group, so this also moves it out of its previous one
+  const auto tid = static_cast<pid_t>(syscall(SYS_gettid));
+  if (WriteFile(group->second + "/tasks", std::to_string(tid) + "\n")) {
+    group_threads[tid] = std::make_pair(thread_class, sched_getcpu());
+  }
+}
+
+std::string Resctrl::ClassOf(ThreadType thread_type) {
+  switch (thread_type) {
+    case ThreadType::kMaster:
+    case ThreadType::kMasterRX:
+    case ThreadType::kMasterTX:
+      return "master";
+    case ThreadType::kWorkerRX:
+    case ThreadType::kWorkerTX:
+    case ThreadType::kWorkerTXRX:
+      return "txrx";
+    case ThreadType::kWorkerMacTXRX:
+      return "mac";
+    case ThreadType::kRecorderWorker:
+      return "recorder";
+    case ThreadType::kWorker:
+    case ThreadType::kWorkerFFT:
+    case ThreadType::kWorkerBeam:
+    case ThreadType::kWorkerDemul:
+    case ThreadType::kWorkerDecode:
+      return "worker";
+  }
+  return "worker";
+}
+
+void Resctrl::PrintOccupancy() {
+  std::scoped_lock lock(resctrl_mutex);
+  if (group_dirs.empty()) {
+    return;
+  }
+  std::string report = "Resctrl: LLC occupancy by thread class\n";
+  for (const auto& [thread_class, dir] : group_dirs) {
+    std::set<int> cpus;
+    for (const auto& thread : group_threads) {
+      if (thread.second.first == thread_class) {
+        cpus.insert(thread.second.second);
+      }
+    }
+    std::string cpu_list;
+    for (const int cpu : cpus) {
+      cpu_list += (cpu_list.empty() ? "" : ",") + std::to_string(cpu);
+    }
+    const double occupancy = SumMonData(dir, "llc_occupancy");
+    const double traffic = SumMonData(dir, "mbm_total_bytes");
+    char line[256];
+    std::snprintf(line, sizeof(line), "  %-16s cpus [%s]: ",
+                  thread_class.c_str(), cpu_list.c_str());
+    report += line;
+    if (occupancy < 0.0) {
+      report += "not monitored\n";
+      continue;
+    }
+    std::snprintf(line, sizeof(line), "%.2f MB of LLC", occupancy / 1e6);
+    report += line;
+    if (traffic >= 0.0) {
+      std::snprintf(line, sizeof(line), ", %.2f GB of memory traffic",
+                    traffic / 1e9);
+      report += line;
+    }
+    report += "\n";
+  }
+  AGORA_LOG_INFO("%s", report.c_str());
+}
+
+void Resctrl::Teardown() {
+  std::scoped_lock lock(resctrl_mutex);
+  RemoveGroups();
+}
@@ -0,0 +1,65 @@
+/**
+ * @file resctrl.h
+ * @brief Declaration file for the resctrl groups of the thread classes, which
+ * partition the last level cache (CAT) and the memory bandwidth (MBA) between
+ * them with Intel RDT.
+ */
+#ifndef RESCTRL_H_
+#define RESCTRL_H_
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+
+#include "symbols.h"
+
+namespace Resctrl {
+
+/// Mount point of the resctrl file system
+static constexpr char kResctrlRoot[] = "/sys/fs/resctrl";
+
+/// The thread classes other than the worker_<stage> ones
+static const std::set<std::string> kClasses{"master", "txrx", "worker", "mac",
+                                            "recorder"};
+
+/// The allocation of one thread class on every cache and memory domain
+struct ClassAllocation {
+  // Hex capacity bitmask of the L3 ways, e.g. "0x0f0", empty to keep the
+  // default of the system
+  std::string l3_mask_;
+  // Memory bandwidth limit in percent, 0 to keep the default of the system
+  size_t mba_percent_ = 0;
+};
+
+/**
+ * @brief Create a resctrl group named agora_<class> for each class, with its
+ * allocation on all the domains of the system. The classes are master, txrx,
+ * worker, worker_<stage> (the workers of that stage in worker_groups), mac
+ * and recorder.
+ *
+ * @return False if resctrl is not mounted or a group could not be created,
+ * in which case no thread is moved
+ */
+bool Setup(const std::map<std::string, ClassAllocation>& classes,
+           const std::string& root = kResctrlRoot);
+
+/// True if Setup created a group for thread_class
+bool HasClass(const std::string& thread_class);
+
+/// Move the calling thread into the group of thread_class, if there is one
+void AssignThread(const std::string& thread_class);
+
+/// The class of the threads pinned as thread_type
+std::string ClassOf(ThreadType thread_type);
+
+/// Log the CPUs of the threads of each group and its LLC occupancy, and its
+/// memory traffic if the system monitors it
+void PrintOccupancy();
+
+/// Remove the groups. Their threads go back to the default group.
+void Teardown();
+
+}  // namespace Resctrl
+
+#endif  // RESCTRL_H_
@@ -5,10 +5,9 @@
 #ifndef SCRAMBLER_H_
 #define SCRAMBLER_H_
 
-#include <bitset>
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <vector>
 
 namespace AgoraScrambler {
 // [1, 127] (93)
@@ -40,43 +39,23 @@ class Scrambler {
    * [1,127]. The mapping of the seed to the generator is Bit0 ~ Bit6 to x1 ~
    * x7. The output is the scrambld data of the same size and type as the input.
    *
+   * The bits of each byte are scrambled MSB first. The scrambling sequence is
+   * precomputed as bytes in pattern_, so this is a byte-wise xor.
+   *
    * @param  output_buffer         Byte array for output scrambled data (can the the same as input)
    * @param  input_buffer          Byte array for input to be scrambled
    * @param  num_bytes             Byte array size - number of bytes to scramble / descramble
-   * @param  scram_buffer          Scratch memory
-   * @param  bit_buffer            Scratch memory
-   */
-  static void WlanScrambler(void* output_buffer, const void* input_buffer,
-                            size_t num_bytes,
-                            std::bitset<kScramblerlength>& scram_buffer,
-                            std::vector<std::byte>& bit_buffer);
-
-  /**
-   * @brief                        Convert a byte array to a bit array. MSB
-   * first
-   *
-   * @param  in_byte_buffer        Input byte array
-   * @param  byte_buffer_size      Input byte array size
-   * @param  out_bit_buffer        Output bit array
    */
-  static void ConvertBytesToBits(const std::byte* in_byte_buffer,
-                                 size_t byte_buffer_size,
-                                 std::byte* out_bit_buffer);
+  void WlanScrambler(void* output_buffer, const void* input_buffer,
+                     size_t num_bytes) const;
 
-  /**
-   * @brief                        Convert a bit array to a byte array. MSB
-   * first
-   *
-   * @param  in_bit_buffer         Input bit array
-   * @param  byte_buffer_size      Output byte array size
-   * @param  out_byte_buffer       Output byte array
-   */
-  static void ConvertBitsToBytes(const std::byte* in_bit_buffer,
-                                 size_t byte_buffer_size,
-                                 std::byte* out_byte_buffer);
+  // Bytes of the scrambling sequence repeated at the end of pattern_, so that
+  // a SIMD load of the sequence from any phase is contiguous
+  static constexpr size_t kPatternPadBytes = 64;
 
-  std::bitset<kScramblerlength> scram_buffer_;
-  std::vector<std::byte> bit_buffer_;
+  // 127 bytes hold exactly 8 periods of the 127-bit scrambling sequence, so
+  // byte i of the data is xor-ed with pattern_[i % kScramblerlength]
+  std::array<uint8_t, kScramblerlength + kPatternPadBytes> pattern_;
 };  // class Scrambler
 
 };  // namespace AgoraScrambler
@@ -1,239 +1,224 @@
+/**
+ * @file shared_counters.h
+ * @brief Task counters shared between the workers of a stage, so that the
+ * workers instead of the master count the completed tasks of each symbol.
+ */
 #ifndef SHARED_COUNTERS_INC_
 #define SHARED_COUNTERS_INC_
 
-#include <mutex>
-#include <sstream>
-#include <vector>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 
-#include "config.h"
-#include "logger.h"
 #include "symbols.h"
 #include "utils.h"
 
-// We use one RxStatus object to track packet reception status.
-// This object is shared between socket threads and subcarrier workers.
-class RxStatus {
+// We use one SharedTaskCounters object to track the completed tasks of each
+// symbol of a stage (e.g., demul). It is shared between all the workers of
+// the stage, and only the worker that completes the last task of a symbol
+// notifies the master.
+class SharedTaskCounters {
  public:
-  RxStatus(Config* cfg)
-      : num_pilot_pkts_per_frame_(cfg->Frame().NumPilotSyms() *
-                                  cfg->BsAntNum()),
-        num_pilot_symbols_per_frame_(cfg->Frame().NumPilotSyms()),
-        num_data_symbol_per_frame_(cfg->Frame().NumDataSyms()),
-        num_pkts_per_symbol_(cfg->BsAntNum()),
-        num_decode_tasks_per_frame_(cfg->get_num_ues_to_process()) {}
-
-  // When receive a new packet, record it here
-  bool add_new_packet(const Packet* pkt) {
-    if (pkt->frame_id >= cur_frame_ + kFrameWnd) {
-      AGORA_LOG_ERROR(
-          "SharedCounters RxStatus error: Received packet for future "
-          "frame %u beyond frame window (%zu + %zu). This can "
-          "happen if Agora is running slowly, e.g., in debug mode. "
-          "Full packet = %s.\n",
-          pkt->frame_id, cur_frame_, kFrameWnd, pkt->to_string().c_str());
-      return false;
-    }
-
-    const size_t frame_slot = pkt->frame_id % kFrameWnd;
-    num_pkts_[frame_slot]++;
-    if (num_pkts_[frame_slot] ==
-        num_pkts_per_symbol_ *
-            (num_pilot_symbols_per_frame_ + num_data_symbol_per_frame_)) {
-      std::printf(
-          "SharedCounters: received all packets in frame: %u. "
-          "Pilot pkts = %zu of %zu\n",
-          pkt->frame_id, num_pilot_pkts_[frame_slot].load(),
-          num_pilot_pkts_per_frame_);
-    }
-
-    if (pkt->symbol_id < num_pilot_symbols_per_frame_) {
-      num_pilot_pkts_[frame_slot]++;
-      if (num_pilot_pkts_[frame_slot] == num_pilot_pkts_per_frame_) {
-        std::printf("SharedCounters: received all pilots in frame: %u\n",
-                    pkt->frame_id);
-      }
-    } else {
-      num_data_pkts_[frame_slot][pkt->symbol_id]++;
-    }
-    if (pkt->frame_id > latest_frame_) {
-      // TODO: race condition could happen here but the impact is small
-      latest_frame_ = pkt->frame_id;
-    }
-    return true;
-  }
-
-  // Check whether all pilot packets are received for a frame
-  // used by CSI
-  bool received_all_pilots(size_t frame_id) {
-    if (frame_id < cur_frame_ || frame_id >= cur_frame_ + kFrameWnd) {
-      return false;
-    }
-    return num_pilot_pkts_[frame_id % kFrameWnd] == num_pilot_pkts_per_frame_;
-  }
-
-  // Check whether demodulation can proceed for a symbol in a frame
-  bool is_demod_ready(size_t frame_id, size_t symbol_id) {
-    if (frame_id < cur_frame_ || frame_id >= cur_frame_ + kFrameWnd) {
-      return false;
-    }
-    return num_data_pkts_[frame_id % kFrameWnd][symbol_id] ==
-           num_pkts_per_symbol_;
-  }
-
-  // When decoding is done for a frame from one decoder, call this function
-  // This function will increase cur_frame when this frame is decoded so that
-  // we can move on decoding the next frame and release the resources used by
-  // this frame
-  void decode_done(size_t frame_id) {
-    rt_assert(frame_id == cur_frame_, "Wrong completed decode task!");
-    decode_mutex_.lock();
-    num_decode_tasks_completed_++;
-    if (num_decode_tasks_completed_ == num_decode_tasks_per_frame_) {
-      cur_frame_++;
-      num_decode_tasks_completed_ = 0;
-      size_t frame_slot = frame_id % kFrameWnd;
-      num_pkts_[frame_slot] = 0;
-      num_pilot_pkts_[frame_slot] = 0;
-      for (size_t j = 0; j < kMaxSymbols; j++) {
-        num_data_pkts_[frame_slot][j] = 0;
-      }
-      std::printf("Main thread: Decode done frame: %lu\n", cur_frame_ - 1);
+  explicit SharedTaskCounters(size_t max_task_count)
+      : max_task_count_(max_task_count) {}
+
+  /**
+   * @brief Add the completed tasks of a worker to the task count of a frame
+   * and symbol
+   * @param frame_id The frame id of the completed tasks
+   * @param symbol_id The symbol id of the completed tasks, or
+   * gen_tag_t::kInvalidSymbolId for tasks performed once per frame (e.g., ZF)
+   * @param num_tasks The number of completed tasks
+   * @return True for exactly one caller: the one whose tasks complete the
+   * symbol. The count is then reset for the next frame in the same slot.
+   */
+  bool CompleteTasks(size_t frame_id, size_t symbol_id, size_t num_tasks) {
+    std::atomic<size_t>& task_count =
+        task_count_.at(frame_id % kFrameWnd)
+            .at(symbol_id < kMaxSymbols ? symbol_id : 0)
+            .count_;
+    // acq_rel so that the last worker sees the results of all the others
+    // before it notifies the master
+    const size_t done =
+        task_count.fetch_add(num_tasks, std::memory_order_acq_rel) +
+        num_tasks;
+    RtAssert(done <= max_task_count_,
+             "SharedTaskCounters: more completed tasks than tasks per symbol");
+    if (done == max_task_count_) {
+      // All the tasks of the symbol are done, so no other worker touches
+      // this count until the frame slot is reused
+      task_count.store(0, std::memory_order_relaxed);
+      return true;
     }
-    decode_mutex_.unlock();
+    return false;
   }
 
-  // TODO: Instead of having all-atomic counter arrays, can we just make
-  // the entire class atomic?
-
-  // num_pkts[i % kFrameWnd] is the total number of packets
-  // received for frame i (may be removed if not used)
-  std::array<std::atomic<size_t>, kFrameWnd> num_pkts_ = {};
-
-  // num_pilot_pkts[i % kFrameWnd] is the total number of pilot
-  // packets received for frame i
-  std::array<std::atomic<size_t>, kFrameWnd> num_pilot_pkts_ = {};
+  inline size_t MaxTaskCount() const { return max_task_count_; }
 
-  // num_data_pkts[i % kFrameWnd][j] is the total number of data
-  // packets received for frame i and symbol j
-  std::array<std::array<std::atomic<size_t>, kMaxSymbols>, kFrameWnd>
-      num_data_pkts_ = {};
-
-  // cur_frame is the first frame for which decoding is incomplete
-  size_t cur_frame_ = 0;
-
-  // The max frame number for which socket I/O threads have received any packet
-  size_t latest_frame_ = 0;
+ private:
+  // One cache line per count, as the workers of different symbols update
+  // neighboring counts at the same time
+  struct alignas(64) PaddedCount {
+    std::atomic<size_t> count_{0};
+  };
 
-  // Atomic counter for # completed decode tasks
-  // cur_frame will be incremented in all tasks are completed
-  size_t num_decode_tasks_completed_;
-  std::mutex decode_mutex_;
+  // task_count_[i % kFrameWnd][j] is the number of completed tasks of
+  // frame i and symbol j
+  std::array<std::array<PaddedCount, kMaxSymbols>, kFrameWnd> task_count_;
 
-  // Copies of Config variables
-  const size_t num_pilot_pkts_per_frame_;
-  const size_t num_pilot_symbols_per_frame_;
-  const size_t num_data_symbol_per_frame_;
-  const size_t num_pkts_per_symbol_;
-  const size_t num_decode_tasks_per_frame_;
+  // Number of tasks of each symbol
+  const size_t max_task_count_;
 };
 
-// We use DemulStatus to track # completed demul tasks for each symbol
-// This object is shared between all dosubcarriers and dodecoders
-class DemulStatus {
+// We use one FftDemulFusion object to let the worker that completes the FFT
+// of an uplink symbol run the demul of that symbol, without a round trip
+// through the master. It is shared between the master, which publishes the
+// frame of the latest beamweights, and all the FFT workers.
+class FftDemulFusion {
  public:
-  DemulStatus(Config* cfg)
-      : num_demul_tasks_required_(cfg->get_num_sc_per_server() /
-                                  cfg->DemulBlockSize()) {
-    for (size_t i = 0; i < kFrameWnd; i++) {
-      for (size_t j = 0; j < kMaxSymbols; j++) {
-        num_demul_tasks_completed_[i][j] = 0;
-      }
-    }
-    max_frame_ = 0;
-  }
+  explicit FftDemulFusion(size_t fft_tasks_per_symbol)
+      : fft_counters_(fft_tasks_per_symbol), beam_frame_(SIZE_MAX) {}
 
-  // Mark [num_tasks] demodulation tasks for this frame and symbol as complete
-  void demul_complete(size_t frame_id, size_t symbol_id, size_t num_tasks) {
-    max_frame_mutex_.lock();
-    if (frame_id > max_frame_) {
-      max_frame_++;
-      for (size_t i = 0; i < kMaxSymbols; i++) {
-        num_demul_tasks_completed_[max_frame_ % kFrameWnd][i] = 0;
-      }
-    }
-    max_frame_mutex_.unlock();
-    rt_assert(frame_id <= max_frame_ && frame_id + kFrameWnd > max_frame_,
-              "Complete a wrong frame in demul!");
-    num_demul_tasks_completed_[frame_id % kFrameWnd][symbol_id] += num_tasks;
+  /// Called by the master when the beamweights of frame_id are ready
+  void SetBeamReady(size_t frame_id) {
+    beam_frame_.store(frame_id, std::memory_order_release);
   }
 
-  // Return true iff we have completed demodulation for all subcarriers in
-  // this symbol have
-  bool ready_to_decode(size_t frame_id, size_t symbol_id) {
-    rt_assert(frame_id + kFrameWnd > max_frame_, "Decode too slow!");
-    if (frame_id > max_frame_) {
+  /**
+   * @brief Add the completed FFT tasks of a worker to an uplink symbol
+   * @return True for the caller whose tasks complete the FFT of the symbol
+   * while the beamweights of the frame are ready. This caller must run the
+   * demul of the symbol, and the master must not schedule it.
+   */
+  bool CompleteFft(size_t frame_id, size_t symbol_id, size_t num_tasks) {
+    if ((fft_counters_.CompleteTasks(frame_id, symbol_id, num_tasks) ==
+         false) ||
+        (beam_frame_.load(std::memory_order_acquire) != frame_id)) {
       return false;
     }
-    return num_demul_tasks_completed_[frame_id % kFrameWnd][symbol_id] ==
-           num_demul_tasks_required_;
+    fused_.at(frame_id % kFrameWnd).at(symbol_id).store(
+        true, std::memory_order_relaxed);
+    return true;
   }
 
-  // num_demul_tasks_completed[i % kFrameWnd][j] is
-  // the number of subcarriers completed for demul tasks in
-  // frame i and symbol j
-  std::array<std::array<std::atomic<size_t>, kMaxSymbols>, kFrameWnd>
-      num_demul_tasks_completed_;
+  /// Called by the master on the last FFT task of an uplink symbol. Returns
+  /// true, and clears the flag, if a worker runs the demul of the symbol.
+  bool TakeFused(size_t frame_id, size_t symbol_id) {
+    return fused_.at(frame_id % kFrameWnd)
+        .at(symbol_id)
+        .exchange(false, std::memory_order_relaxed);
+  }
 
-  // Number of subcarriers required to demodulate for each symbol
-  const size_t num_demul_tasks_required_;
+ private:
+  SharedTaskCounters fft_counters_;
+  // Frame of the latest beamweights, SIZE_MAX before the first frame
+  std::atomic<size_t> beam_frame_;
+  // fused_[i % kFrameWnd][j] is set if a worker runs the demul of frame i
+  // and symbol j. The FFT response that carries it is posted afterwards.
+  std::array<std::array<std::atomic<bool>, kMaxSymbols>, kFrameWnd> fused_{};
+};
 
-  size_t max_frame_;
-  std::mutex max_frame_mutex_;
+// Events of a frame returned by RxCounters::CountPacket(), as bits
+enum RxCountEvent : uint32_t {
+  kRxFirstPacket = 1,       // The first packet of the frame
+  kRxPilotsDone = 2,        // The last pilot packet of the frame
+  kRxReciprocityDone = 4,   // The last reciprocity pilot packet of the frame
+  kRxFrameDone = 8          // The last packet of the frame
 };
 
-class DecodeStatus {
+enum class RxPacketKind { kPilot, kReciprocity, kOther };
+
+// We use one RxCounters object to count the received packets of each frame.
+// Each frame slot has its own cache line, so counting the packets of one
+// frame never invalidates the counts of the neighboring frames.
+class RxCounters {
  public:
-  DecodeStatus(Config* cfg)
-      : cfg_(cfg), num_demod_data_required_(cfg->server_addr_list.size()) {
-    cur_frame_ = new size_t[cfg->get_num_ues_to_process()];
-    std::memset(cur_frame_, 0, sizeof(size_t) * cfg->get_num_ues_to_process());
-    cur_symbol_ = new size_t[cfg->get_num_ues_to_process()];
-    std::memset(cur_symbol_, 0, sizeof(size_t) * cfg->get_num_ues_to_process());
-
-    num_demod_data_received_ =
-        new std::array<std::array<size_t, kMaxSymbols>,
-                       kFrameWnd>[cfg->get_num_ues_to_process()];
-    for (size_t i = 0; i < cfg->get_num_ues_to_process(); i++) {
-      for (size_t j = 0; j < kFrameWnd; j++) {
-        num_demod_data_received_[i][j].fill(0);
-      }
+  void Init(size_t num_pilot_pkts_per_frame,
+            size_t num_reciprocity_pkts_per_frame,
+            size_t num_rx_pkts_per_frame) {
+    num_pilot_pkts_per_frame_ = num_pilot_pkts_per_frame;
+    num_reciprocity_pkts_per_frame_ = num_reciprocity_pkts_per_frame;
+    num_rx_pkts_per_frame_ = num_rx_pkts_per_frame;
+  }
+
+  /**
+   * @brief Count one received packet of a frame, from any thread
+   * @return The RxCountEvent bits of the frame that this packet triggers.
+   * Each event goes to exactly one caller, which sees everything written
+   * before the earlier packets of the frame were counted. The counts are
+   * then reset for the next frame in the same slot.
+   */
+  uint32_t CountPacket(size_t frame_id, RxPacketKind kind) {
+    FrameCounts& counts = counts_.at(frame_id % kFrameWnd);
+    uint32_t events = 0;
+    if ((kind == RxPacketKind::kPilot) &&
+        CountOne(counts.pilot_pkts_, num_pilot_pkts_per_frame_)) {
+      events |= kRxPilotsDone;
+    } else if ((kind == RxPacketKind::kReciprocity) &&
+               CountOne(counts.reciprocity_pkts_,
+                        num_reciprocity_pkts_per_frame_)) {
+      events |= kRxReciprocityDone;
+    }
+    const size_t prev_pkts =
+        counts.pkts_.fetch_add(1, std::memory_order_acq_rel);
+    if (prev_pkts == 0) {
+      events |= kRxFirstPacket;
+    }
+    if (prev_pkts + 1 == num_rx_pkts_per_frame_) {
+      counts.pkts_.store(0, std::memory_order_relaxed);
+      // Pairs with the acquire in FrameReceived()
+      counts.received_frame_.store(frame_id, std::memory_order_release);
+      events |= kRxFrameDone;
     }
+    return events;
   }
 
-  void receive_demod_data(size_t ue_id, size_t frame_id, size_t symbol_id) {
-    num_demod_data_received_[ue_id - cfg_->ue_start][frame_id % kFrameWnd]
-                            [symbol_id]++;
+  /// True once all the packets of frame_id are received, until the frame
+  /// slot is reused. The caller then sees everything written before the
+  /// packets of the frame were counted, without a message from the counting
+  /// thread.
+  inline bool FrameReceived(size_t frame_id) const {
+    return counts_.at(frame_id % kFrameWnd)
+               .received_frame_.load(std::memory_order_acquire) == frame_id;
   }
 
-  bool received_all_demod_data(size_t ue_id, size_t frame_id,
-                               size_t symbol_id) {
-    if (num_demod_data_received_[ue_id - cfg_->ue_start][frame_id % kFrameWnd]
-                                [symbol_id] == num_demod_data_required_) {
-      num_demod_data_received_[ue_id - cfg_->ue_start][frame_id % kFrameWnd]
-                              [symbol_id] = 0;
+  /// Packets of frame_id counted so far, for debug output
+  inline size_t Packets(size_t frame_id) const {
+    return counts_.at(frame_id % kFrameWnd)
+        .pkts_.load(std::memory_order_relaxed);
+  }
+
+  inline size_t PacketsPerFrame() const { return num_rx_pkts_per_frame_; }
+
+ private:
+  // The counts of one frame slot, alone in their cache line
+  struct alignas(64) FrameCounts {
+    std::atomic<size_t> pkts_{0};
+    std::atomic<size_t> pilot_pkts_{0};
+    std::atomic<size_t> reciprocity_pkts_{0};
+    // The latest frame of this slot with all its packets received
+    std::atomic<size_t> received_frame_{SIZE_MAX};
+  };
+  static_assert(sizeof(FrameCounts) == 64, "One cache line per frame slot");
+
+  // True for the caller that counts the last of max_count packets
+  static inline bool CountOne(std::atomic<size_t>& count, size_t max_count) {
+    if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == max_count) {
+      count.store(0, std::memory_order_relaxed);
       return true;
     }
     return false;
   }
 
- private:
-  Config* cfg_;
-  size_t* cur_frame_;
-  size_t* cur_symbol_;  // symbol ID for UL data
-  const size_t num_demod_data_required_;
+  std::array<FrameCounts, kFrameWnd> counts_;
 
-  std::array<std::array<size_t, kMaxSymbols>, kFrameWnd>*
-      num_demod_data_received_;
+  // Number of packets we'll receive per frame on the uplink
+  size_t num_rx_pkts_per_frame_ = 0;
+  // Number of pilot packets we'll receive per frame
+  size_t num_pilot_pkts_per_frame_ = 0;
+  // Number of reciprocity pilot packets we'll receive per frame
+  size_t num_reciprocity_pkts_per_frame_ = 0;
 };
 
-#endif  // SHARED_COUNTERS_INC_
\ No newline at end of file
+#endif  // SHARED_COUNTERS_INC_
@@ -6,6 +6,7 @@
 #include <csignal>
 
 bool SignalHandler::mb_got_exit_signal = false;
+volatile std::sig_atomic_t SignalHandler::mb_got_capture_signal = 0;
 
 /**
  * Default Contructor.
@@ -46,3 +47,34 @@ void SignalHandler::SetupSignalHandlers() {
     throw SignalException("!!!!! Error setting up signal handlers !!!!!");
   }
 }
+
+/**
+ * Returns true if a capture signal arrived since the last call, and clears it
+ * @return Flag indicating a capture request
+ */
+bool SignalHandler::PopCaptureSignal() {
+  if (mb_got_capture_signal == 0) {
+    return false;
+  }
+  mb_got_capture_signal = 0;
+  return true;
+}
+
+/**
+ * Sets capture signal to true.
+ * @param[in] _ignored Not used but required by function prototype
+ *                     to match required handler.
+ */
+void SignalHandler::CaptureSignalHandler(int /*unused*/) {
+  mb_got_capture_signal = 1;
+}
+
+/**
+ * Set up the signal handler for SIGUSR1, which requests a recorder capture.
+ */
+void SignalHandler::SetupCaptureSignalHandler() {
+  if (std::signal((int)SIGUSR1, SignalHandler::CaptureSignalHandler) ==
+      SIG_ERR) {
+    throw SignalException("!!!!! Error setting up capture signal handler !!!!!");
+  }
+}
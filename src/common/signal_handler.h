@@ -2,6 +2,7 @@
 
 #ifndef SIGNALHANDLER_H_
 #define SIGNALHANDLER_H_
+#include <csignal>
 #include <stdexcept>
 using std::runtime_error;
 
@@ -14,6 +15,7 @@ class SignalException : public runtime_error {
 class SignalHandler {
  protected:
   static bool mb_got_exit_signal;
+  static volatile std::sig_atomic_t mb_got_capture_signal;
 
  public:
   SignalHandler();
@@ -24,5 +26,10 @@ class SignalHandler {
 
   void SetupSignalHandlers();
   static void ExitSignalHandler(int _ignored);
+
+  /// Returns true once per SIGUSR1 received since the last call
+  static bool PopCaptureSignal();
+  void SetupCaptureSignalHandler();
+  static void CaptureSignalHandler(int _ignored);
 };
 #endif  // SIGNALHANDLER_H_
@@ -0,0 +1,147 @@
+/**
+ * @file simd_portable.h
+ * @brief Portable 128-bit SIMD vectors, and the complex-float helpers of
+ * CommsLib (M512ComplexCf32Mult, Reciprocal, Sum, NearZeros) on them. Written
+ * with the GCC/Clang vector extensions, so the same code compiles to NEON on
+ * aarch64 and to SSE on x86. Used by the paths that have no x86 intrinsics to
+ * run: the type conversions and demodulators of non-AVX2 builds, and the
+ * 128-bit small-MIMO kernels.
+ */
+#ifndef SIMD_PORTABLE_H_
+#define SIMD_PORTABLE_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace PortableSimd {
+
+using F32x4 = float __attribute__((vector_size(16)));
+using I32x4 = int32_t __attribute__((vector_size(16)));
+using I16x4 = int16_t __attribute__((vector_size(8)));
+
+/// Complex floats in an F32x4, {re, im} interleaved
+static constexpr size_t kCxPerVec = 2;
+
+// Unaligned loads and stores, which the compiler turns into single vector
+// moves
+template <class V>
+static inline V Load(const void* src) {
+  V v;
+  std::memcpy(&v, src, sizeof(v));
+  return v;
+}
+
+template <class V>
+static inline void Store(void* dst, V v) {
+  std::memcpy(dst, &v, sizeof(v));
+}
+
+static inline F32x4 Set1(float v) { return F32x4{v, v, v, v}; }
+
+/// {v.re, v.im, v.re, v.im}
+static inline F32x4 Set1(std::complex<float> v) {
+  return F32x4{v.real(), v.imag(), v.real(), v.imag()};
+}
+
+static inline F32x4 Min(F32x4 a, F32x4 b) { return a < b ? a : b; }
+static inline F32x4 Max(F32x4 a, F32x4 b) { return a > b ? a : b; }
+static inline I32x4 Abs(I32x4 a) { return a < 0 ? -a : a; }
+
+#if defined(__clang__)
+#define PORTABLE_SIMD_SHUFFLE(v, i0, i1, i2, i3) \
+  __builtin_shufflevector(v, v, i0, i1, i2, i3)
+#else
+#define PORTABLE_SIMD_SHUFFLE(v, i0, i1, i2, i3) \
+  __builtin_shuffle(v, I32x4{i0, i1, i2, i3})
+#endif
+
+/// {im, re} of each complex element
+static inline F32x4 SwapReIm(F32x4 a) {
+  return PORTABLE_SIMD_SHUFFLE(a, 1, 0, 3, 2);
+}
+/// {re, re} of each complex element
+static inline F32x4 DupRe(F32x4 a) {
+  return PORTABLE_SIMD_SHUFFLE(a, 0, 0, 2, 2);
+}
+/// {im, im} of each complex element
+static inline F32x4 DupIm(F32x4 a) {
+  return PORTABLE_SIMD_SHUFFLE(a, 1, 1, 3, 3);
+}
+
+#undef PORTABLE_SIMD_SHUFFLE
+
+/// a * b of each complex element
+static inline F32x4 ComplexCf32Mult(F32x4 a, F32x4 b) {
+  return a * DupRe(b) +
+         SwapReIm(a) * DupIm(b) * F32x4{-1.0f, 1.0f, -1.0f, 1.0f};
+}
+
+/// a * conj(b) of each complex element
+static inline F32x4 ComplexCf32MultConj(F32x4 a, F32x4 b) {
+  return a * DupRe(b) +
+         SwapReIm(a) * DupIm(b) * F32x4{1.0f, -1.0f, 1.0f, -1.0f};
+}
+
+/// |a|^2 in both floats of each complex element
+static inline F32x4 ComplexCf32Norm(F32x4 a) {
+  const F32x4 sq = a * a;
+  return sq + SwapReIm(sq);
+}
+
+/// 1 / a of each complex element
+static inline F32x4 ComplexCf32Reciprocal(F32x4 a) {
+  return (a * F32x4{1.0f, -1.0f, 1.0f, -1.0f}) / ComplexCf32Norm(a);
+}
+
+/// Sum of the complex elements
+static inline std::complex<float> ComplexCf32Sum(F32x4 a) {
+  return {a[0] + a[2], a[1] + a[3]};
+}
+
+/// True if |a| < threshold for some complex element
+static inline bool ComplexCf32NearZeros(F32x4 a, float threshold) {
+  const I32x4 below = ComplexCf32Norm(a) < Set1(threshold * threshold);
+  return (below[0] | below[2]) != 0;
+}
+
+/// Round to the nearest integer, ties to even, as cvtps_epi32 does. The
+/// magic number trick is not used, since -Ofast folds it away.
+static inline I32x4 RoundToInt(F32x4 a) {
+#if defined(__ARM_NEON)
+  return reinterpret_cast<I32x4>(
+      vcvtnq_s32_f32(reinterpret_cast<float32x4_t>(a)));
+#else
+  return I32x4{static_cast<int32_t>(__builtin_rintf(a[0])),
+               static_cast<int32_t>(__builtin_rintf(a[1])),
+               static_cast<int32_t>(__builtin_rintf(a[2])),
+               static_cast<int32_t>(__builtin_rintf(a[3]))};
+#endif
+}
+
+/// 4 shorts to floats, times scale
+static inline F32x4 ShortToFloat(const short* src, float scale) {
+  return __builtin_convertvector(Load<I16x4>(src), F32x4) * Set1(scale);
+}
+
+/// 4 floats times scale to shorts, rounded and saturated as with the
+/// cvtps and packs of the x86 versions
+static inline void FloatToShort(F32x4 a, float scale, short* dst) {
+  const F32x4 clamped =
+      Min(Max(a * Set1(scale), Set1(-32768.0f)), Set1(32767.0f));
+  Store(dst, __builtin_convertvector(RoundToInt(clamped), I16x4));
+}
+
+/// Saturate to the int8 range
+static inline I32x4 SaturateInt8(I32x4 a) {
+  return a < -128 ? I32x4{} - 128 : (a > 127 ? I32x4{} + 127 : a);
+}
+
+}  // namespace PortableSimd
+
+#endif  // SIMD_PORTABLE_H_
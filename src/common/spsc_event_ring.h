@@ -0,0 +1,103 @@
+/**
+ * @file spsc_event_ring.h
+ * @brief Declaration file for the SpscEventRing class, a bounded ring of
+ * EventData between one producer and one consumer thread
+ */
+#ifndef SPSC_EVENT_RING_H_
+#define SPSC_EVENT_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "message.h"
+
+/**
+ * @brief A lock-free ring of EventData records for exactly one producer and
+ * one consumer thread, e.g. a TxRx thread and the master.
+ *
+ * The index each side writes sits on a cache line of its own, next to that
+ * side's copy of the other index, so the other side's line is only read
+ * when the copy says the ring is full (producer) or empty (consumer). A bulk
+ * push or pop publishes its index once for the whole bulk.
+ */
+class SpscEventRing {
+ public:
+  /// num_slots is rounded up to a power of two
+  explicit SpscEventRing(size_t num_slots) {
+    size_t slots = 1;
+    while (slots < num_slots) {
+      slots *= 2;
+    }
+    slots_.resize(slots);
+    mask_ = slots - 1;
+  }
+
+  SpscEventRing(const SpscEventRing&) = delete;
+  SpscEventRing& operator=(const SpscEventRing&) = delete;
+
+  /// Producer side. Returns false if the ring is full.
+  inline bool TryPush(const EventData& event) {
+    return TryPushBulk(&event, 1) == 1;
+  }
+
+  /// Producer side. Pushes the first events of num_events that fit, and
+  /// returns how many.
+  inline size_t TryPushBulk(const EventData* events, size_t num_events) {
+    const size_t tail = producer_.tail_.load(std::memory_order_relaxed);
+    if ((tail + num_events - producer_.head_copy_) > slots_.size()) {
+      producer_.head_copy_ = consumer_.head_.load(std::memory_order_acquire);
+    }
+    const size_t num_push =
+        std::min(num_events, slots_.size() - (tail - producer_.head_copy_));
+    for (size_t i = 0; i < num_push; i++) {
+      slots_[(tail + i) & mask_] = events[i];
+    }
+    if (num_push > 0) {
+      producer_.tail_.store(tail + num_push, std::memory_order_release);
+    }
+    return num_push;
+  }
+
+  /// Consumer side. Pops up to max_events into events, and returns how many.
+  inline size_t TryPopBulk(EventData* events, size_t max_events) {
+    const size_t head = consumer_.head_.load(std::memory_order_relaxed);
+    if ((consumer_.tail_copy_ - head) < max_events) {
+      consumer_.tail_copy_ = producer_.tail_.load(std::memory_order_acquire);
+    }
+    const size_t num_pop = std::min(max_events, consumer_.tail_copy_ - head);
+    for (size_t i = 0; i < num_pop; i++) {
+      events[i] = slots_[(head + i) & mask_];
+    }
+    if (num_pop > 0) {
+      consumer_.head_.store(head + num_pop, std::memory_order_release);
+    }
+    return num_pop;
+  }
+
+  /// Approximate number of events in the ring. Can be read from any thread.
+  inline size_t SizeApprox() const {
+    const size_t head = consumer_.head_.load(std::memory_order_relaxed);
+    const size_t tail = producer_.tail_.load(std::memory_order_relaxed);
+    return (tail > head) ? (tail - head) : 0;
+  }
+  inline size_t NumSlots() const { return slots_.size(); }
+
+ private:
+  struct alignas(64) Producer {
+    std::atomic<size_t> tail_{0};  // Next slot to push
+    size_t head_copy_ = 0;         // Last head_ seen by the producer
+  };
+  struct alignas(64) Consumer {
+    std::atomic<size_t> head_{0};  // Next slot to pop
+    size_t tail_copy_ = 0;         // Last tail_ seen by the consumer
+  };
+
+  Producer producer_;
+  Consumer consumer_;
+  std::vector<EventData> slots_;
+  size_t mask_;
+};
+
+#endif  // SPSC_EVENT_RING_H_
@@ -0,0 +1,63 @@
+/**
+ * @file streaming_store.h
+ * @brief Non-temporal stores for the write-once outputs of the pipeline,
+ * which the next stage reads on another core: they go to memory without
+ * evicting the lines that the writing core reads again, such as the CSI and
+ * the beamweights. Selected per buffer by Config::NtStores().
+ */
+#ifndef STREAMING_STORE_H_
+#define STREAMING_STORE_H_
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace StreamingStore {
+
+/// Copy bytes from src to dst, with non-temporal stores for the 64-byte
+/// aligned lines of dst and regular ones for its unaligned head and tail
+inline void Copy(void* dst, const void* src, size_t bytes) {
+#if defined(__AVX512F__) || defined(__AVX2__)
+  auto* out = static_cast<uint8_t*>(dst);
+  const auto* in = static_cast<const uint8_t*>(src);
+  const size_t head =
+      std::min(bytes, (64 - (reinterpret_cast<uintptr_t>(out) % 64)) % 64);
+  std::memcpy(out, in, head);
+  size_t i = head;
+  for (; i + 64 <= bytes; i += 64) {
+#if defined(__AVX512F__)
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(out + i),
+                        _mm512_loadu_si512(in + i));
+#else
+    _mm256_stream_si256(
+        reinterpret_cast<__m256i*>(out + i),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)));
+    _mm256_stream_si256(
+        reinterpret_cast<__m256i*>(out + i + 32),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 32)));
+#endif
+  }
+  std::memcpy(out + i, in + i, bytes - i);
+#else
+  std::memcpy(dst, src, bytes);
+#endif
+}
+
+/// Order the non-temporal stores of the calling thread before its later
+/// stores. A task that streamed its output calls this before it reports
+/// the task complete, as the release of the completion does not order
+/// non-temporal stores.
+inline void Fence() {
+#if defined(__x86_64__)
+  _mm_sfence();
+#endif
+}
+
+}  // namespace StreamingStore
+
+#endif  // STREAMING_STORE_H_
@@ -14,7 +14,9 @@
 #define TOSTRING(x) STRINGIFY(x)
 
 // Number of frames received that we allocate space for in worker threads. This
-// is the frame window that we track in Agora.
+// is the frame window that we track in Agora. It is the upper bound of the
+// configurable frame window (Config::FrameWindow()): the frame counters and
+// message queues are sized for it, the data buffers for the configured window.
 static constexpr size_t kFrameWnd = 40;
 
 #define TX_FRAME_DELTA (4)
@@ -59,12 +61,24 @@ enum class EventType : int {
   kRANUpdate,    // Signal new RAN config to Agora
   kRBIndicator,  // Signal RB schedule to UEs
   kBroadcast,    // Signal generation of new broadcast symbols
+  kFFTSymbol,    // FFT of all the antennas of one symbol in one task
+  kCaptureFrame,    // Signal the recorder to keep the tables of a frame
+  kCaptureTrigger,  // Signal the recorder to write out its capture
+  kFrameStart,      // Signal the first packet of a frame from the RxManager
   kThreadTermination
 };
 
 static constexpr size_t kNumEventTypes =
     static_cast<size_t>(EventType::kThreadTermination) + 1;
 
+// The stages of the "worker_groups" key, by the task type of each. "fft" also
+// covers the kFFTSymbol tasks.
+static const std::map<std::string, EventType> kWorkerGroupStages{
+    {"fft", EventType::kFFT},         {"beam", EventType::kBeam},
+    {"demul", EventType::kDemul},     {"decode", EventType::kDecode},
+    {"encode", EventType::kEncode},   {"precode", EventType::kPrecode},
+    {"ifft", EventType::kIFFT}};
+
 // Types of Agora Doers
 enum class DoerType : size_t {
   kFFT,
@@ -137,10 +151,17 @@ static constexpr size_t kDefaultMessageQueueSize = 512;
 static constexpr size_t kDefaultWorkerQueueSize = 256;
 // Max number of worker threads allowed
 //static constexpr size_t kMaxWorkerNum = 50;
+// Default number of frames in processing at once (pipeline_depth), each
+// with its own set of task and completion queues
 static constexpr size_t kScheduleQueues = 2;
+// Largest pipeline_depth, which sizes the queue sets
+static constexpr size_t kMaxScheduleQueues = 4;
 // Dequeue batch size, used to reduce the overhead of dequeue in main thread
 static constexpr size_t kDequeueBulkSizeTXRX = 8;
 static constexpr size_t kDequeueBulkSizeWorker = 4;
+// With adaptive_dequeue, the largest multiple of these sizes a backlogged
+// queue is dequeued in
+static constexpr size_t kDequeueBulkMaxGrowth = 4;
 
 // Enable thread pinning and exit if thread pinning fails. Thread pinning is
 // crucial for good performance. For testing or developing Agora on machines
@@ -149,12 +170,25 @@ static constexpr bool kEnableThreadPinning = true;
 static constexpr bool kEnableCoreReuse = false;
 
 #define BIGSTATION (0)
+
+#if defined(USE_ACC100)
+static constexpr bool kUseAcc100 = true;
+#else
+static constexpr bool kUseAcc100 = false;
+#endif
+
 #if defined(USE_DPDK)
 static constexpr bool kUseDPDK = true;
 #else
 static constexpr bool kUseDPDK = false;
 #endif
 
+#if defined(USE_XDP)
+static constexpr bool kUseXDP = true;
+#else
+static constexpr bool kUseXDP = false;
+#endif
+
 #if defined(ENABLE_MAC)
 static constexpr bool kEnableMac = true;
 #else
@@ -277,6 +311,41 @@ static inline std::string ThreadTypeStr(ThreadType thread_type) {
   return "Invalid thread type";
 }
 
+/// How the Agora doers are mapped onto threads
+enum class ExecutionModel {
+  // WorkerThreadNum() dedicated worker threads, the master only schedules
+  kMultiCore,
+  // One worker, merged with the master thread
+  kSingleCore,
+  // The master thread runs the doers between scheduling rounds, next to
+  // WorkerThreadNum() - 1 dedicated worker threads
+  kMasterAssisted
+};
+
+static const std::map<std::string, ExecutionModel> kExecutionModelStr{
+    {"multi_core", ExecutionModel::kMultiCore},
+    {"single_core", ExecutionModel::kSingleCore},
+    {"master_assisted", ExecutionModel::kMasterAssisted}};
+
+/// When the ACC100 decoder of a worker enqueues the code blocks of its
+/// decode requests, in the asynchronous mode. Every policy but kRequest
+/// also enqueues the staged requests once the worker has no decode request
+/// left.
+enum class AccBatchPolicy {
+  // Each request as it is launched
+  kRequest,
+  // The requests of a frame, up to its last uplink symbol or the first
+  // request of another frame
+  kFrame,
+  // Requests up to a burst size that adapts to a latency target
+  kAdaptive
+};
+
+static const std::map<std::string, AccBatchPolicy> kAccBatchPolicyStr{
+    {"request", AccBatchPolicy::kRequest},
+    {"frame", AccBatchPolicy::kFrame},
+    {"adaptive", AccBatchPolicy::kAdaptive}};
+
 enum class SymbolType {
   kBeacon,
   kControl,
@@ -311,10 +380,14 @@ static constexpr size_t kMaxUEs = 64;
 // Maximum number of transceiver channels per radio
 static constexpr size_t kMaxChannels = 2;
 
-// Maximum modulation (QAM256) supported by Agora. The implementation might
-// support only lower modulation orders (e.g., up to QAM64), but using 8 here
-// helps reduce false cache line sharing.
-static constexpr size_t kMaxModType = 8;
+// Maximum modulation (QAM1024) supported by Agora. The implementation might
+// support only lower modulation orders (e.g., up to QAM64), but sizing the
+// per-subcarrier buffers for it helps reduce false cache line sharing.
+static constexpr size_t kMaxModType = 10;
+
+// Maximum modulation of the data symbols, the highest of the MCS table. The
+// modulation bits carry one symbol per byte, so QAM1024 is only demodulated.
+static constexpr size_t kMaxDataModType = 8;
 
 // An arbitrary setting for default Mcs for Data symbols
 // 16QAM modulation and 340/1024 code rate
@@ -0,0 +1,171 @@
+/**
+ * @file test_vector_file.cc
+ * @brief Implementation file for the TestVectorFile class
+ */
+#include "test_vector_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "logger.h"
+
+static constexpr char kMagic[8] = {'A', 'G', 'O', 'R', 'A', 'T', 'V', '\0'};
+// Changes with the layout of the file
+static constexpr uint32_t kFileVersion = 1;
+
+struct FileHeader {
+  char magic_[8];
+  uint32_t version_;
+  uint32_t num_tables_;
+  uint64_t config_hash_;
+  float scale_;
+  uint32_t reserved_;
+  struct {
+    uint32_t dtype_;
+    uint32_t reserved_;
+    uint64_t dim1_;
+    uint64_t dim2_;
+    uint64_t offset_;
+  } tables_[TestVectorFile::kMaxTables];
+};
+static_assert(sizeof(FileHeader) <= TestVectorFile::kPageSize,
+              "The header must fit in its page");
+
+static inline size_t PageRoundup(size_t bytes) {
+  return ((bytes + TestVectorFile::kPageSize - 1) /
+          TestVectorFile::kPageSize) *
+         TestVectorFile::kPageSize;
+}
+
+TestVectorFile::~TestVectorFile() {
+  if (map_ != nullptr) {
+    ::munmap(map_, map_size_);
+  }
+}
+
+uint64_t TestVectorFile::Hash(const void* data, size_t size, uint64_t hash) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+size_t TestVectorFile::TypeSize(DType dtype) {
+  switch (dtype) {
+    case DType::kInt8:
+      return sizeof(int8_t);
+    case DType::kComplexFloat:
+      return sizeof(complex_float);
+    case DType::kComplexInt16:
+      return sizeof(std::complex<int16_t>);
+  }
+  return 0;
+}
+
+bool TestVectorFile::Write(const std::string& filename, uint64_t config_hash,
+                           float scale) const {
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kFileVersion;
+  header.num_tables_ = tables_.size();
+  header.config_hash_ = config_hash;
+  header.scale_ = scale;
+  size_t offset = kPageSize;
+  for (size_t i = 0; i < tables_.size(); i++) {
+    const TableInfo& info = tables_.at(i);
+    header.tables_[i].dtype_ = static_cast<uint32_t>(info.dtype_);
+    header.tables_[i].dim1_ = info.dim1_;
+    header.tables_[i].dim2_ = info.dim2_;
+    header.tables_[i].offset_ = offset;
+    offset += PageRoundup(info.dim1_ * info.dim2_ * TypeSize(info.dtype_));
+  }
+
+  const std::string partial_name =
+      filename + ".partial_" + std::to_string(::getpid());
+  FILE* fp = std::fopen(partial_name.c_str(), "wb");
+  if (fp == nullptr) {
+    AGORA_LOG_WARN("TestVectorFile: Failed to create %s. Error %s.\n",
+                   partial_name.c_str(), strerror(errno));
+    return false;
+  }
+  static const std::vector<uint8_t> kZeros(kPageSize, 0);
+  bool written =
+      std::fwrite(&header, sizeof(header), 1, fp) == 1 &&
+      std::fwrite(kZeros.data(), kPageSize - sizeof(header), 1, fp) == 1;
+  for (size_t i = 0; written && i < tables_.size(); i++) {
+    const TableInfo& info = tables_.at(i);
+    const size_t bytes = info.dim1_ * info.dim2_ * TypeSize(info.dtype_);
+    const size_t padding = PageRoundup(bytes) - bytes;
+    written = (bytes == 0 ||
+               std::fwrite(sources_.at(i), bytes, 1, fp) == 1) &&
+              (padding == 0 ||
+               std::fwrite(kZeros.data(), padding, 1, fp) == 1);
+  }
+  written = (std::fclose(fp) == 0) && written;
+  if (written == false ||
+      std::rename(partial_name.c_str(), filename.c_str()) != 0) {
+    AGORA_LOG_WARN("TestVectorFile: Failed to write %s. Error %s.\n",
+                   filename.c_str(), strerror(errno));
+    std::remove(partial_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool TestVectorFile::Map(const std::string& filename, uint64_t config_hash) {
+  RtAssert(map_ == nullptr, "TestVectorFile: already mapped");
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0 ||
+      static_cast<size_t>(file_stat.st_size) < kPageSize) {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = file_stat.st_size;
+  // Written pages are copied, the file is never modified
+  void* map =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    AGORA_LOG_WARN("TestVectorFile: Failed to map %s. Error %s.\n",
+                   filename.c_str(), strerror(errno));
+    return false;
+  }
+
+  const auto* header = static_cast<const FileHeader*>(map);
+  bool valid = std::memcmp(header->magic_, kMagic, sizeof(kMagic)) == 0 &&
+               header->version_ == kFileVersion &&
+               header->config_hash_ == config_hash &&
+               header->num_tables_ <= kMaxTables;
+  std::vector<TableInfo> tables;
+  for (size_t i = 0; valid && i < header->num_tables_; i++) {
+    const TableInfo info = {static_cast<DType>(header->tables_[i].dtype_),
+                            header->tables_[i].dim1_, header->tables_[i].dim2_,
+                            header->tables_[i].offset_};
+    const size_t type_size = TypeSize(info.dtype_);
+    valid = type_size > 0 && info.offset_ % kPageSize == 0 &&
+            info.offset_ <= size &&
+            info.dim1_ * info.dim2_ * type_size <= size - info.offset_;
+    tables.push_back(info);
+  }
+  if (valid == false) {
+    ::munmap(map, size);
+    return false;
+  }
+  map_ = map;
+  map_size_ = size;
+  scale_ = header->scale_;
+  tables_ = std::move(tables);
+  return true;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file test_vector_file.h
+ * @brief Declaration file for the TestVectorFile class, a page-aligned file of
+ * test vector tables which processes map instead of reading.
+ */
+#ifndef TEST_VECTOR_FILE_H_
+#define TEST_VECTOR_FILE_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common_typedef_sdk.h"
+#include "memory_manage.h"
+#include "utils.h"
+
+/**
+ * @brief Tables of test vectors behind a header page of their types and
+ * dimensions, the hash of the configuration they were generated for and the
+ * scale of their time-domain samples. Each table starts on a page.
+ *
+ * Mapping the file reads the pages of a table only when they are first used,
+ * and the processes of the same configuration (agora, sender, user, chsim)
+ * share them through the page cache. The mapping is private, so a process
+ * that writes to a table gets its own copy of the pages it writes.
+ */
+class TestVectorFile {
+ public:
+  enum class DType : uint32_t { kInt8 = 1, kComplexFloat, kComplexInt16 };
+
+  static constexpr size_t kPageSize = 4096;
+  static constexpr size_t kMaxTables = 16;
+
+  TestVectorFile() = default;
+  ~TestVectorFile();
+  TestVectorFile(const TestVectorFile&) = delete;
+  TestVectorFile& operator=(const TestVectorFile&) = delete;
+
+  /// FNV-1a hash of size bytes at data, continuing from hash
+  static uint64_t Hash(const void* data, size_t size,
+                       uint64_t hash = kHashBasis);
+
+  /// Add a table to write
+  template <typename T>
+  void Add(Table<T>& table) {
+    RtAssert(tables_.size() < kMaxTables, "TestVectorFile: too many tables");
+    tables_.push_back({TypeOf<T>(), table.Dim1(), table.Dim2(), 0});
+    sources_.push_back(table.Dim1() > 0 ? table[0] : nullptr);
+  }
+
+  /// Write the added tables to filename. The file is written under another
+  /// name and renamed, so it is never mapped incomplete. False if it could
+  /// not be written.
+  bool Write(const std::string& filename, uint64_t config_hash,
+             float scale) const;
+
+  /// Map filename. False if it is missing, malformed or was written for
+  /// another configuration hash.
+  bool Map(const std::string& filename, uint64_t config_hash);
+
+  inline size_t NumTables() const { return tables_.size(); }
+  inline float Scale() const { return scale_; }
+
+  /// Let table use the mapped entries of table index, which stay valid until
+  /// this file is destroyed
+  template <typename T>
+  void Get(size_t index, Table<T>& table) const {
+    RtAssert(index < tables_.size(), "TestVectorFile: no such table");
+    const TableInfo& info = tables_.at(index);
+    RtAssert(info.dtype_ == TypeOf<T>(), "TestVectorFile: wrong table type");
+    table.Wrap(reinterpret_cast<T*>(static_cast<uint8_t*>(map_) +
+                                    info.offset_),
+               info.dim1_, info.dim2_);
+  }
+
+ private:
+  static constexpr uint64_t kHashBasis = 0xCBF29CE484222325ull;
+
+  struct TableInfo {
+    DType dtype_;
+    uint64_t dim1_;
+    uint64_t dim2_;
+    // Bytes from the start of the file
+    uint64_t offset_;
+  };
+
+  template <typename T>
+  static DType TypeOf();
+
+  static size_t TypeSize(DType dtype);
+
+  std::vector<TableInfo> tables_;
+  std::vector<const void*> sources_;
+  float scale_{1.0f};
+  void* map_{nullptr};
+  size_t map_size_{0};
+};
+
+template <>
+inline TestVectorFile::DType TestVectorFile::TypeOf<int8_t>() {
+  return DType::kInt8;
+}
+template <>
+inline TestVectorFile::DType TestVectorFile::TypeOf<complex_float>() {
+  return DType::kComplexFloat;
+}
+template <>
+inline TestVectorFile::DType TestVectorFile::TypeOf<std::complex<int16_t>>() {
+  return DType::kComplexInt16;
+}
+
+#endif  // TEST_VECTOR_FILE_H_
@@ -0,0 +1,45 @@
+/**
+ * @file tile_layout.h
+ * @brief The subcarrier-tile layout that dofft writes the CSI and uplink
+ * data of each symbol in, and that the beamweight and demul kernels read.
+ */
+#ifndef TILE_LAYOUT_H_
+#define TILE_LAYOUT_H_
+
+#include <cstddef>
+
+#include "symbols.h"
+
+/**
+ * A buffer of one symbol (one UE for the CSI) is a sequence of tiles of
+ * kTransposeBlockSize subcarriers. A tile holds the subcarriers of every
+ * antenna, antenna after antenna. One antenna's part of a tile is
+ * kTransposeBlockSize / kSCsPerCacheline cache lines, so a SIMD kernel streams
+ * the tiles in order and reads each antenna with whole-cacheline loads, and a
+ * per-subcarrier gather reads one tile instead of BsAntNum() planes.
+ *
+ * With kUsePartialTrans unset, each antenna is instead a plane of all its
+ * subcarriers.
+ */
+namespace TileLayout {
+
+static constexpr size_t kTileScs = kTransposeBlockSize;
+static_assert(kTileScs % kSCsPerCacheline == 0);
+
+/// Offset of the tile holding subcarrier sc
+inline size_t TileBase(size_t sc, size_t num_ants) {
+  return (sc / kTileScs) * (kTileScs * num_ants);
+}
+
+/// Offset of subcarrier sc of antenna ant. Subcarriers sc to
+/// sc + kSCsPerCacheline - 1 of the antenna are contiguous when sc is a
+/// multiple of kSCsPerCacheline.
+inline size_t Index(size_t sc, size_t ant, size_t num_ants, size_t sc_num) {
+  return kUsePartialTrans
+             ? TileBase(sc, num_ants) + (ant * kTileScs) + (sc % kTileScs)
+             : (ant * sc_num) + sc;
+}
+
+}  // namespace TileLayout
+
+#endif  // TILE_LAYOUT_H_
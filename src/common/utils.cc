@@ -14,10 +14,14 @@
 #include <iomanip>   // std::setw
 #include <iostream>  // std::cout, std::endl
 #include <list>
+#include <map>
 #include <mutex>
 #include <tuple>
 
+#include "core_placement.h"
 #include "datatype_conversion.h"
+#include "page_faults.h"
+#include "resctrl.h"
 
 struct CoreInfo {
   CoreInfo(size_t id, size_t mapped, size_t req, ThreadType type)
@@ -47,6 +51,8 @@ static std::mutex pin_core_mutex;
 
 /* Keep list of core-thread relationship*/
 static std::list<CoreInfo> core_list;
+/* Why each core of an automatic layout has its place */
+static std::map<size_t, CorePlacement::Slot> core_placement;
 
 static size_t GetCoreId(size_t core) {
   size_t result;
@@ -66,12 +72,29 @@ static void PrintCoreList(const std::list<CoreInfo>& clist) {
   std::printf("          CORE LIST SUMMARY      \n");
   std::printf("=================================\n");
   std::printf("Total Number of Cores: %d : %d \n", numa_max_cpus, system_cpus);
+  size_t num_smt = 0;
+  size_t num_not_isolated = 0;
+  size_t num_remote = 0;
   for (const auto& iter : clist) {
     std::printf(
         "|| Core ID: %2zu || Requested: %2zu || ThreadType: %-16s || "
         "ThreadId: %zu \n",
         iter.mapped_core_, iter.requested_core_,
         ThreadTypeStr(iter.type_).c_str(), iter.thread_id_);
+    const auto placement = core_placement.find(iter.mapped_core_);
+    if (placement != core_placement.end()) {
+      const CorePlacement::Slot& slot = placement->second;
+      std::printf("||   Placement: %s\n", slot.reason_.c_str());
+      num_smt += slot.smt_sibling_ ? 1 : 0;
+      num_not_isolated += slot.isolated_ ? 0 : 1;
+      num_remote += slot.remote_ ? 1 : 0;
+    }
+  }
+  if (core_placement.empty() == false) {
+    std::printf(
+        "Isolation: %zu threads on SMT siblings, %zu on non-isolated cores, "
+        "%zu remote from the devices\n",
+        num_smt, num_not_isolated, num_remote);
   }
   std::printf("=================================\n");
 }
@@ -125,6 +148,33 @@ void SetCpuLayoutOnNumaNodes(bool verbose,
   }
 }
 
+void SetCpuLayoutFromTopology(bool verbose,
+                              const std::vector<size_t>& cores_to_exclude,
+                              const std::vector<std::string>& devices) {
+  if (cpu_layout_initialized == false) {
+    std::vector<int> device_nodes;
+    for (const auto& device : devices) {
+      const int node = CorePlacement::DeviceNumaNode(device);
+      std::printf("Device %s: NUMA node %d\n", device.c_str(), node);
+      device_nodes.push_back(node);
+    }
+    const std::vector<CorePlacement::Slot> slots = CorePlacement::Plan(
+        CorePlacement::ReadTopology(), cores_to_exclude, device_nodes);
+    for (const auto& slot : slots) {
+      if (verbose) {
+        std::printf("Core offset %zu: cpu %zu, %s\n", cpu_layout.size(),
+                    slot.cpu_, slot.reason_.c_str());
+      }
+      cpu_layout.emplace_back(slot.cpu_);
+      core_placement.emplace(slot.cpu_, slot);
+    }
+    std::printf("Usable Cpu count %zu\n", cpu_layout.size());
+    RtAssert(cpu_layout.empty() == false,
+             "No usable CPU in the automatic core layout");
+    cpu_layout_initialized = true;
+  }
+}
+
 size_t GetPhysicalCoreId(size_t core_id) {
   size_t core;
   if (cpu_layout_initialized) {
@@ -202,6 +252,40 @@ void PinToCoreWithOffset(ThreadType thread_type, size_t core_offset,
       }
     }  // EnableThreadPinning == true
   }
+  // Into the resctrl group of its class, if the config gives it one
+  Resctrl::AssignThread(Resctrl::ClassOf(thread_type));
+  PageFaults::RegisterThread(ThreadTypeStr(thread_type) + " " +
+                             std::to_string(thread_id));
+}
+
+size_t CoreIdWithOffset(size_t base_core_offset, size_t thread_id) {
+  std::scoped_lock lock(pin_core_mutex);
+  return (kEnableThreadPinning == true)
+             ? GetCoreId(base_core_offset + thread_id)
+             : (base_core_offset + thread_id);
+}
+
+int NumaNodeOfCoreWithOffset(size_t base_core_offset, size_t thread_id) {
+  if (numa_available() < 0) {
+    return -1;
+  }
+  const size_t core = CoreIdWithOffset(base_core_offset, thread_id);
+  return numa_node_of_cpu(static_cast<int>(core));
+}
+
+int CurrentNumaNode() {
+  const int cpu = sched_getcpu();
+  if ((cpu < 0) || (numa_available() < 0)) {
+    return -1;
+  }
+  return numa_node_of_cpu(cpu);
+}
+
+size_t NumaNodeCount() {
+  if (numa_available() < 0) {
+    return 1;
+  }
+  return static_cast<size_t>(numa_max_node()) + 1;
 }
 
 std::vector<size_t> Utils::StrToChannels(const std::string& channel) {
@@ -31,6 +31,13 @@ void SetCpuLayoutOnNumaNodes(
     bool verbose = false,
     const std::vector<size_t>& cores_to_exclude = std::vector<size_t>(1, 0));
 
+/* Order the usable cores from the sysfs topology: one hardware thread per
+ * physical core on the NUMA nodes of the devices (network interfaces or PCI
+ * addresses) first, isolated cores first, SMT siblings last */
+void SetCpuLayoutFromTopology(bool verbose,
+                              const std::vector<size_t>& cores_to_exclude,
+                              const std::vector<std::string>& devices);
+
 size_t GetPhysicalCoreId(size_t core_id);
 
 /* Pin this thread to core with global index = core_id */
@@ -43,6 +50,19 @@ void PinToCoreWithOffset(ThreadType thread, size_t base_core_offset,
 
 void PrintCoreAssignmentSummary();
 
+/* Core that PinToCoreWithOffset assigns to thread_id */
+size_t CoreIdWithOffset(size_t base_core_offset, size_t thread_id);
+
+/* NUMA node of the core that PinToCoreWithOffset assigns to thread_id, -1 if
+ * unknown */
+int NumaNodeOfCoreWithOffset(size_t base_core_offset, size_t thread_id);
+
+/* NUMA node of the core the calling thread runs on, -1 if unknown */
+int CurrentNumaNode();
+
+/* Number of NUMA nodes of the machine, 1 if unknown */
+size_t NumaNodeCount();
+
 template <class T>
 struct EventHandlerContext {
   T* obj_ptr_;
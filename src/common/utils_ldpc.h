@@ -280,32 +280,18 @@ static inline size_t LdpcGetMinZc() { return kUseAVX2Encoder ? 2 : 6; }
 
 // Return the maximum LDPC expansion factor supported
 static inline size_t LdpcGetMaxZc() {
-  return kUseAVX2Encoder ? avx2enc::kZcMax : ZC_MAX;
+  return kUseAVX2Encoder ? avx2enc::MaxZc() : ZC_MAX;
 }
 
-// Generate the codeword output and parity buffer for this input buffer
-static inline void LdpcEncodeHelper(size_t base_graph, size_t zc, size_t nRows,
-                                    int8_t* encoded_buffer,
-                                    int8_t* parity_buffer,
-                                    const int8_t* input_buffer) {
+// Copy the punctured input bits of input_buffer, and the parity bits of
+// parity_buffer from the encoder into encoded_buffer
+static inline void LdpcCopyEncodedBits(size_t base_graph, size_t zc,
+                                       size_t nRows, int8_t* encoded_buffer,
+                                       int8_t* parity_buffer,
+                                       const int8_t* input_buffer) {
   const size_t num_input_bits = LdpcNumInputBits(base_graph, zc);
   const size_t num_parity_bits = nRows * zc;
 
-  bblib_ldpc_encoder_5gnr_request req;
-  bblib_ldpc_encoder_5gnr_response resp;
-  req.baseGraph = base_graph;
-  req.nRows = kUseAVX2Encoder ? LdpcMaxNumRows(base_graph) : nRows;
-  req.Zc = zc;
-  req.nRows = nRows;
-  req.numberCodeblocks = 1;
-  req.input[0] = const_cast<int8_t*>(input_buffer);
-  resp.output[0] = parity_buffer;
-
-  kUseAVX2Encoder ? avx2enc::BblibLdpcEncoder5gnr(&req, &resp)
-                  : bblib_ldpc_encoder_5gnr(&req, &resp);
-
-  // Copy punctured input bits from the encoding request, and parity bits from
-  // the encoding response into encoded_buffer
   static size_t k_num_punctured_cols = 2;
   if (zc % 4 == 0) {
     // In this case, the start and end of punctured input bits is
@@ -363,4 +349,45 @@ static inline void LdpcEncodeHelper(size_t base_graph, size_t zc, size_t nRows,
   }
 }
 
+// Generate the codeword output and parity buffers for num_cbs input buffers
+// of the same base graph and Zc with one encoder request. FlexRAN's encoder,
+// and Agora's encoder with AVX-512 and Zc <= avx2enc::kLanesZcMax, encode the
+// code blocks of a request side by side in SIMD lanes.
+static inline void LdpcEncodeHelperBatch(size_t base_graph, size_t zc,
+                                         size_t nRows, size_t num_cbs,
+                                         int8_t* const* encoded_buffers,
+                                         int8_t* const* parity_buffers,
+                                         const int8_t* const* input_buffers) {
+  bblib_ldpc_encoder_5gnr_request req;
+  bblib_ldpc_encoder_5gnr_response resp;
+  RtAssert(num_cbs <= sizeof(req.input) / sizeof(req.input[0]),
+           "Too many code blocks in one LDPC encoding request");
+  req.baseGraph = base_graph;
+  req.nRows = kUseAVX2Encoder ? LdpcMaxNumRows(base_graph) : nRows;
+  req.Zc = zc;
+  req.nRows = nRows;
+  req.numberCodeblocks = num_cbs;
+  for (size_t i = 0; i < num_cbs; i++) {
+    req.input[i] = const_cast<int8_t*>(input_buffers[i]);
+    resp.output[i] = parity_buffers[i];
+  }
+
+  kUseAVX2Encoder ? avx2enc::BblibLdpcEncoder5gnr(&req, &resp)
+                  : bblib_ldpc_encoder_5gnr(&req, &resp);
+
+  for (size_t i = 0; i < num_cbs; i++) {
+    LdpcCopyEncodedBits(base_graph, zc, nRows, encoded_buffers[i],
+                        parity_buffers[i], input_buffers[i]);
+  }
+}
+
+// Generate the codeword output and parity buffer for this input buffer
+static inline void LdpcEncodeHelper(size_t base_graph, size_t zc, size_t nRows,
+                                    int8_t* encoded_buffer,
+                                    int8_t* parity_buffer,
+                                    const int8_t* input_buffer) {
+  LdpcEncodeHelperBatch(base_graph, zc, nRows, 1, &encoded_buffer,
+                        &parity_buffer, &input_buffer);
+}
+
 #endif  // UTILS_LDPC_H_
@@ -6,14 +6,26 @@
 
 #include "data_generator.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #include "comms-lib.h"
 #include "crc.h"
 #include "datatype_conversion.h"
 #include "logger.h"
 #include "modulation.h"
+#include "noise_generator.h"
 #include "phy_ldpc_decoder_5gnr.h"
 #include "scrambler.h"
 
@@ -52,6 +64,10 @@ static const std::string kDlLdpcDataPrefix = "LDPC_orig_dl_data_";
 static const std::string kRxLdpcPrefix = "LDPC_rx_data_";
 static const std::string kDlTxPrefix = "LDPC_dl_tx_data_";
 static const std::string kUlScBitsPrefix = "ul_data_b_";
+// Generated data, in a subdirectory per cache key
+static const std::string kCacheDir = "data_cache/";
+// Change whenever the generated data changes for the same config
+static constexpr size_t kCacheVersion = 1;
 
 //Utilities?
 static float RandFloatFromShort(float min, float max) {
@@ -88,19 +104,132 @@ int allocate_buffers_on_socket(struct rte_bbdev_op_data **buffers,
 }
 #endif
 
-DataGenerator::DataGenerator(Config* cfg, uint64_t seed, Profile profile)
-    : cfg_(cfg), seed_(seed), profile_(profile) {
+/**
+ * @brief Call body(i) for every i below count on up to num_threads threads,
+ * including the calling one. The first exception stops the loop and is
+ * rethrown once all threads are done.
+ */
+static void ParallelFor(size_t num_threads, size_t count,
+                        const std::function<void(size_t)>& body) {
+  std::atomic<size_t> next(0);
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  auto worker = [&]() {
+    for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+      try {
+        body(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (error == nullptr) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(num_threads, count); i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+DataGenerator::DataGenerator(Config* cfg, uint64_t seed, Profile profile,
+                             size_t num_threads)
+    : cfg_(cfg),
+      seed_(seed),
+      profile_(profile),
+      num_threads_(num_threads != 0
+                       ? num_threads
+                       : std::max(1u, std::thread::hardware_concurrency())) {
   if (seed != 0) {
     fast_rand_.seed_ = seed;
   }
 }
 
-void DataGenerator::DoDataGeneration(const std::string& directory) {
+std::string DataGenerator::CacheKey() const {
+  std::ostringstream fields;
+  fields << kCacheVersion << ' ' << seed_ << ' '
+         << static_cast<int>(profile_) << ' ' << cfg_->Frame().FrameIdentifier()
+         << ' ' << cfg_->OfdmCaNum() << ' ' << cfg_->OfdmDataNum() << ' '
+         << cfg_->OfdmDataStart() << ' ' << cfg_->OfdmPilotSpacing() << ' '
+         << cfg_->CpLen() << ' ' << cfg_->OfdmTxZeroPrefix() << ' '
+         << cfg_->OfdmTxZeroPostfix() << ' ' << cfg_->SampsPerSymbol() << ' '
+         << cfg_->BsAntNum() << ' ' << cfg_->UeAntNum() << ' '
+         << cfg_->UeNum() << ' ' << cfg_->NumUeChannels() << ' '
+         << cfg_->UeChannel() << ' ' << cfg_->FreqOrthogonalPilot() << ' '
+         << cfg_->GroupPilotSc() << ' ' << cfg_->PilotScGroupSize() << ' '
+         << cfg_->ScrambleEnabled() << ' ' << cfg_->NoiseLevel();
+  for (const Direction dir : {Direction::kUplink, Direction::kDownlink}) {
+    const LDPCconfig& lc = cfg_->LdpcConfig(dir);
+    fields << ' ' << cfg_->Modulation(dir) << ' ' << lc.BaseGraph() << ' '
+           << lc.ExpansionFactor() << ' ' << lc.NumRows() << ' '
+           << lc.NumCbLen() << ' ' << lc.NumCbCodewLen() << ' '
+           << lc.NumBlocksInSymbol() << ' ' << cfg_->MacBytesNumPerframe(dir)
+           << ' ' << cfg_->MacPacketsPerframe(dir) << ' '
+           << cfg_->MacPacketLength(dir) << ' '
+           << cfg_->MacPayloadMaxLength(dir);
+  }
+
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : fields.str()) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+  }
+  char key[17];
+  std::snprintf(key, sizeof(key), "%016lx", static_cast<unsigned long>(hash));
+  return key;
+}
+
+void DataGenerator::DoDataGeneration(const std::string& directory,
+                                     bool use_cache) {
   //Make sure the directory exists
   if (std::filesystem::is_directory(directory) == false) {
     std::filesystem::create_directory(directory);
   }
+  if (use_cache == false) {
+    GenerateData(directory);
+    return;
+  }
+
+  const std::string cache_dir = directory + kCacheDir + CacheKey() + "/";
+  if (std::filesystem::is_directory(cache_dir)) {
+    AGORA_LOG_INFO("DataGenerator: Reusing the data cached in %s\n",
+                   cache_dir.c_str());
+  } else {
+    // Generated aside, then renamed, so that a cache directory is always
+    // complete
+    const std::string partial_dir = directory + kCacheDir + "partial_" +
+                                    std::to_string(::getpid()) + "/";
+    std::filesystem::create_directories(partial_dir);
+    GenerateData(partial_dir);
+    std::error_code error;
+    std::filesystem::rename(partial_dir, cache_dir, error);
+    if (error) {
+      // Another run cached the same data first
+      std::filesystem::remove_all(partial_dir);
+    }
+  }
+
+  for (const auto& entry : std::filesystem::directory_iterator(cache_dir)) {
+    std::filesystem::copy_file(
+        entry.path(), directory + entry.path().filename().string(),
+        std::filesystem::copy_options::overwrite_existing);
+  }
+}
+
+void DataGenerator::GenerateData(const std::string& directory) {
   srand(time(nullptr));
+  // The symbols of every thread share one committed IFFT
+  const CommsLib::DftHold dft(cfg_->OfdmCaNum());
   std::unique_ptr<DoCRC> crc_obj = std::make_unique<DoCRC>();
   const size_t ul_cb_bytes = cfg_->NumBytesPerCb(Direction::kUplink);
   LDPCconfig ul_ldpc_config = this->cfg_->LdpcConfig(Direction::kUplink);
@@ -313,7 +442,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
     std::vector<std::vector<int8_t>> ul_encoded_codewords(num_ul_codeblocks);
     std::vector<std::vector<int8_t>> ul_encoded_codewords_flexRAN(num_ul_codeblocks);
     const size_t encoded_bytes = BitsToBytes(ul_ldpc_config.NumCbCodewLen());
-    for (size_t cb = 0; cb < num_ul_codeblocks; cb++) {
+    ParallelFor(num_threads_, num_ul_codeblocks, [&](size_t cb) {
       // i : symbol -> ue -> cb (repeat)
       size_t sym_id = cb / (symbol_blocks);
       // ue antenna for code block
@@ -334,17 +463,18 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       ul_encoded_codewords_flexRAN.at(cb) = DataGenerator::GenCodeblock(
           ul_ldpc_config, &ul_information.at(cb).at(0), ul_cb_bytes,
           this->cfg_->ScrambleEnabled());
+    });
 
 #if defined(USE_ACC100_ENCODE)
+    // The accelerator queue is used by one thread
+    for (size_t cb = 0; cb < num_ul_codeblocks; cb++) {
       ul_encoded_codewords.at(cb) = DataGenerator::GenCodeblock_ACC100(
           ul_ldpc_config, &ul_information.at(cb).at(0), ul_cb_bytes,
           this->cfg_->ScrambleEnabled(), cb);
+    }
 #else
-      ul_encoded_codewords.at(cb) = DataGenerator::GenCodeblock(
-          ul_ldpc_config, &ul_information.at(cb).at(0), ul_cb_bytes,
-          this->cfg_->ScrambleEnabled());
+    ul_encoded_codewords = ul_encoded_codewords_flexRAN;
 #endif
-    }
 
     // the following generated file is used as a reference to compare BLER.
     {
@@ -546,14 +676,14 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
     // Modulate the encoded codewords
     std::vector<std::vector<complex_float>> ul_modulated_codewords(
         num_ul_codeblocks);
-    for (size_t i = 0; i < num_ul_codeblocks; i++) {
+    ParallelFor(num_threads_, num_ul_codeblocks, [&](size_t i) {
       auto ofdm_symbol = DataGenerator::GetModulation(
           &ul_encoded_codewords.at(i)[0], cfg_->ModTable(Direction::kUplink),
           cfg_->LdpcConfig(Direction::kUplink).NumCbCodewLen(),
           cfg_->OfdmDataNum(), cfg_->ModOrderBits(Direction::kUplink));
       ul_modulated_codewords.at(i) = DataGenerator::MapOFDMSymbol(
           cfg_, ofdm_symbol, nullptr, SymbolType::kUL);
-    }
+    });
 
     // Place modulated uplink data codewords into central IFFT bins
     AGORA_LOG_INFO("ul_mod_order_bits: %zu\n",
@@ -570,9 +700,9 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
              "This version of Agora does not support code block partition");
     pre_ifft_data_syms.resize(this->cfg_->UeAntNum() *
                               this->cfg_->Frame().NumUlDataSyms());
-    for (size_t i = 0; i < pre_ifft_data_syms.size(); i++) {
+    ParallelFor(num_threads_, pre_ifft_data_syms.size(), [&](size_t i) {
       pre_ifft_data_syms.at(i) = BinForIfft(cfg_, ul_modulated_codewords.at(i));
-    }
+    });
   }
 
   // Generate common sounding pilots
@@ -649,7 +779,6 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       csi_matrices[j][i].im = csi.im * sqrt2_norm;
     }
   }
-  arma::arma_rng::set_seed_random();
 
   // Generate RX data received by base station after going through channels
   Table<complex_float> rx_data_all_symbols;
@@ -658,7 +787,12 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       this->cfg_->SampsPerSymbol() * this->cfg_->BsAntNum(),
       Agora_memory::Alignment_t::kAlign64);
   size_t data_start = this->cfg_->CpLen() + this->cfg_->OfdmTxZeroPrefix();
-  for (size_t i = 0; i < this->cfg_->Frame().NumTotalSyms(); i++) {
+  // Each symbol draws its noise from its own part of the stream
+  const size_t noise_groups_per_symbol =
+      ((2 * this->cfg_->SampsPerSymbol() * this->cfg_->BsAntNum()) +
+       NoiseGenerator::kGroupSize - 1) /
+      NoiseGenerator::kGroupSize;
+  ParallelFor(num_threads_, this->cfg_->Frame().NumTotalSyms(), [&](size_t i) {
     arma::cx_fmat mat_input_data(
         reinterpret_cast<arma::cx_float*>(tx_data_all_symbols[i]),
         this->cfg_->OfdmCaNum(), this->cfg_->UeAntNum(), false);
@@ -672,10 +806,11 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
                             false);
       mat_output.row(j + data_start) = mat_input_data.row(j) * mat_csi.st();
     }
-    arma::cx_fmat noise_mat(size(mat_output));
-    noise_mat.set_real(arma::randn<arma::fmat>(size(real(mat_output))));
-    noise_mat.set_imag(arma::randn<arma::fmat>(size(real(mat_output))));
-    mat_output += (noise_mat * this->cfg_->NoiseLevel() * sqrt2_norm);
+    NoiseGenerator noise(seed_, 0);
+    noise.Seek(i * noise_groups_per_symbol);
+    noise.AddGaussian(reinterpret_cast<float*>(mat_output.memptr()),
+                      2 * mat_output.n_elem,
+                      this->cfg_->NoiseLevel() * sqrt2_norm);
     for (size_t j = 0; j < this->cfg_->BsAntNum(); j++) {
       auto* this_ofdm_symbol =
           rx_data_all_symbols[i] + j * this->cfg_->SampsPerSymbol() +
@@ -683,7 +818,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       CommsLib::FFTShift(this_ofdm_symbol, this->cfg_->OfdmCaNum());
       CommsLib::IFFT(this_ofdm_symbol, this->cfg_->OfdmCaNum(), false);
     }
-  }
+  });
 
   const std::string filename_rx =
       directory + kRxLdpcPrefix + std::to_string(this->cfg_->OfdmCaNum()) +
@@ -808,7 +943,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
 
     std::vector<std::vector<int8_t>> dl_information(num_dl_codeblocks);
     std::vector<std::vector<int8_t>> dl_encoded_codewords(num_dl_codeblocks);
-    for (size_t cb = 0; cb < num_dl_codeblocks; cb++) {
+    ParallelFor(num_threads_, num_dl_codeblocks, [&](size_t cb) {
       // i : symbol -> ue -> cb (repeat)
       const size_t sym_id = cb / (symbol_blocks);
       // ue antenna for code block
@@ -823,12 +958,12 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       dl_encoded_codewords.at(cb) = DataGenerator::GenCodeblock(
           dl_ldpc_config, &dl_information.at(cb).at(0), dl_cb_bytes,
           this->cfg_->ScrambleEnabled());
-    }
+    });
 
     // Modulate the encoded codewords
     std::vector<std::vector<complex_float>> dl_modulated_codewords(
         num_dl_codeblocks);
-    for (size_t i = 0; i < num_dl_codeblocks; i++) {
+    ParallelFor(num_threads_, num_dl_codeblocks, [&](size_t i) {
       const size_t sym_offset = i % (symbol_blocks);
       const size_t ue_id = sym_offset / dl_ldpc_config.NumBlocksInSymbol();
       auto ofdm_symbol = DataGenerator::GetModulation(
@@ -837,7 +972,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
           cfg_->OfdmDataNum(), cfg_->ModOrderBits(Direction::kDownlink));
       dl_modulated_codewords.at(i) = DataGenerator::MapOFDMSymbol(
           cfg_, ofdm_symbol, ue_specific_pilot[ue_id], SymbolType::kDL);
-    }
+    });
 
     {
       // Save downlink information bytes to file
@@ -888,7 +1023,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
     precoder.Calloc(this->cfg_->OfdmCaNum(),
                     this->cfg_->UeAntNum() * this->cfg_->BsAntNum(),
                     Agora_memory::Alignment_t::kAlign32);
-    for (size_t i = 0; i < this->cfg_->OfdmCaNum(); i++) {
+    ParallelFor(num_threads_, this->cfg_->OfdmCaNum(), [&](size_t i) {
       arma::cx_fmat mat_input(
           reinterpret_cast<arma::cx_float*>(csi_matrices[i]),
           this->cfg_->BsAntNum(), this->cfg_->UeAntNum(), false);
@@ -896,7 +1031,9 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
                                this->cfg_->UeAntNum(), this->cfg_->BsAntNum(),
                                false);
       pinv(mat_output, mat_input, 1e-2, "dc");
-    }
+      // Normalized once here, as every downlink symbol uses it
+      mat_output /= abs(mat_output).max();
+    });
 
     if (kPrintDebugCSI) {
       std::printf("CSI \n");
@@ -972,7 +1109,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
                       2 * this->cfg_->SampsPerSymbol() * this->cfg_->BsAntNum(),
                       Agora_memory::Alignment_t::kAlign64);
 
-    for (size_t i = 0; i < this->cfg_->Frame().NumDLSyms(); i++) {
+    ParallelFor(num_threads_, this->cfg_->Frame().NumDLSyms(), [&](size_t i) {
       arma::cx_fmat mat_input_data(
           reinterpret_cast<arma::cx_float*>(dl_mod_data[i]),
           this->cfg_->OfdmCaNum(), this->cfg_->UeAntNum(), false);
@@ -986,7 +1123,6 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
         arma::cx_fmat mat_precoder(
             reinterpret_cast<arma::cx_float*>(precoder[j]),
             this->cfg_->UeAntNum(), this->cfg_->BsAntNum(), false);
-        mat_precoder /= abs(mat_precoder).max();
         mat_output.row(j) = mat_input_data.row(j) * mat_precoder;
 
         // std::printf("symbol %d, sc: %d\n", i, j -
@@ -1025,7 +1161,7 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
         std::memset(tx_symbol + tx_zero_postfix_offset, 0,
                     sizeof(short) * 2 * this->cfg_->OfdmTxZeroPostfix());
       }
-    }
+    });
 
     std::string filename_dl_tx =
         directory + kDlTxPrefix + std::to_string(this->cfg_->OfdmCaNum()) +
@@ -1164,29 +1300,17 @@ Table<complex_float> DataGenerator::GetUeSpecificPilotFreqDomain() const {
 void DataGenerator::GetNoisySymbol(
     const std::vector<complex_float>& modulated_symbol,
     std::vector<complex_float>& noisy_symbol, float noise_level) {
-  std::default_random_engine generator(seed_);
-  std::normal_distribution<double> distribution(0.0, 1.0);
-  for (size_t j = 0; j < modulated_symbol.size(); j++) {
-    complex_float noise = {
-        static_cast<float>(distribution(generator)) * noise_level,
-        static_cast<float>(distribution(generator)) * noise_level};
-    noisy_symbol.at(j).re = modulated_symbol.at(j).re + noise.re;
-    noisy_symbol.at(j).im = modulated_symbol.at(j).im + noise.im;
-  }
+  RtAssert(noisy_symbol.size() >= modulated_symbol.size(),
+           "GetNoisySymbol: output shorter than the input");
+  GetNoisySymbol(modulated_symbol.data(), noisy_symbol.data(),
+                 modulated_symbol.size(), noise_level);
 }
 
 void DataGenerator::GetNoisySymbol(const complex_float* modulated_symbol,
                                    complex_float* noisy_symbol, size_t length,
                                    float noise_level) {
-  std::default_random_engine generator(seed_);
-  std::normal_distribution<double> distribution(0.0, 1.0);
-  for (size_t j = 0; j < length; j++) {
-    complex_float noise = {
-        static_cast<float>(distribution(generator)) * noise_level,
-        static_cast<float>(distribution(generator)) * noise_level};
-    noisy_symbol[j].re = modulated_symbol[j].re + noise.re;
-    noisy_symbol[j].im = modulated_symbol[j].im + noise.im;
-  }
+  std::memcpy(noisy_symbol, modulated_symbol, length * sizeof(complex_float));
+  GetNoisySymbol(noisy_symbol, length, noise_level, seed_);
 }
 
 /**
@@ -1384,16 +1508,10 @@ std::vector<complex_float> DataGenerator::BinForIfft(
 
 void DataGenerator::GetNoisySymbol(complex_float* modulated_symbol,
                                    size_t length, float noise_level,
-                                   unsigned seed) {
-  std::default_random_engine generator(seed);
-  std::normal_distribution<double> distribution(0.0, 1.0);
-  for (size_t j = 0; j < length; j++) {
-    complex_float noise = {
-        static_cast<float>(distribution(generator)) * noise_level,
-        static_cast<float>(distribution(generator)) * noise_level};
-    modulated_symbol[j].re += noise.re;
-    modulated_symbol[j].im += noise.im;
-  }
+                                   uint64_t seed) {
+  NoiseGenerator noise(seed, 0);
+  noise.AddGaussian(reinterpret_cast<float*>(modulated_symbol), 2 * length,
+                    noise_level);
 }
 
 void DataGenerator::GetDecodedData(int8_t* demoded_data,
@@ -86,10 +86,21 @@ class DataGenerator {
     kProfile123
   };
 
+  /**
+   * @param num_threads Threads of DoDataGeneration, all the cores if 0
+   */
   explicit DataGenerator(Config* cfg, uint64_t seed = 0,
-                         Profile profile = Profile::kRandom);
+                         Profile profile = Profile::kRandom,
+                         size_t num_threads = 0);
 
-  void DoDataGeneration(const std::string& directory);
+  /**
+   * @brief Write the data files of the config to directory
+   *
+   * The files are generated in a cache directory named by a hash of the
+   * config fields they depend on, then copied to directory. A later run with
+   * the same fields only copies them again, unless use_cache is false.
+   */
+  void DoDataGeneration(const std::string& directory, bool use_cache = true);
 
   /**
    * @brief                        Generate random Mac payload bit
@@ -172,8 +183,10 @@ class DataGenerator {
                       complex_float* noisy_symbol, size_t length,
                       float noise_level);
 
+  /// Add Gaussian noise of standard deviation noise_level to the real and
+  /// imaginary parts, the same noise for the same seed
   static void GetNoisySymbol(complex_float* modulated_symbol, size_t length,
-                             float noise_level, unsigned seed = 0);
+                             float noise_level, uint64_t seed = 0);
 
   static void GetDecodedData(int8_t* demoded_data, uint8_t* decoded_codewords,
                              const LDPCconfig& ldpc_config,
@@ -188,10 +201,16 @@ class DataGenerator {
                                   bool scramble_enabled = false);
 
  private:
+  // Generate the data files to directory
+  void GenerateData(const std::string& directory);
+  // Hash of the config fields, seed and profile the data depends on
+  std::string CacheKey() const;
+
   FastRand fast_rand_;  // A fast random number generator
   Config* cfg_;         // The global Agora config
   uint64_t seed_;
   const Profile profile_;  // The pattern of the input byte sequence
+  const size_t num_threads_;
 #if defined(USE_ACC100_ENCODE)
   uint8_t dev_id;
   int ldpc_llr_decimals;
@@ -24,6 +24,9 @@ DEFINE_string(
     conf_file,
     TOSTRING(PROJECT_DIRECTORY) "/files/examples/ci/tddconfig-sim-both.json",
     "Agora config filename");
+DEFINE_uint64(threads, 0, "Number of generation threads, all the cores if 0");
+DEFINE_bool(cache, true,
+            "Reuse the data generated before for the same config fields");
 
 int main(int argc, char* argv[]) {
   const std::string output_directory =
@@ -37,7 +40,8 @@ int main(int argc, char* argv[]) {
       FLAGS_profile == "123" ? DataGenerator::Profile::kProfile123
                              : DataGenerator::Profile::kRandom;
   std::unique_ptr<DataGenerator> data_generator =
-      std::make_unique<DataGenerator>(cfg.get(), 0 /* RNG seed */, profile);
+      std::make_unique<DataGenerator>(cfg.get(), 0 /* RNG seed */, profile,
+                                      FLAGS_threads);
 
   AGORA_LOG_INFO(
       "DataGenerator: Config file: %s, data profile = %s\n",
@@ -48,7 +52,7 @@ int main(int argc, char* argv[]) {
                  cfg->FreqOrthogonalPilot() ? "frequency" : "time");
 
   AGORA_LOG_INFO("DataGenerator: Generating encoded and modulated data\n");
-  data_generator->DoDataGeneration(output_directory);
+  data_generator->DoDataGeneration(output_directory, FLAGS_cache);
   AGORA_LOG_SHUTDOWN();
   return 0;
 }
@@ -162,6 +162,60 @@ inline __m256i CycleBitShift144to256(__m256i data, int16_t cyc_shift,
   return x1;
 }
 
+#if defined(__AVX512VBMI2__)
+// Shift all 512 bits of data right (or left) by num_bits < 512: whole 64-bit
+// words with a permute, and the remaining bits with a VBMI2 funnel shift
+// that pulls them in from the neighbouring word
+static inline __m512i ShiftRight512(__m512i data, int num_bits) {
+  const int word_shift = num_bits >> 6;
+  const __m512i idx = _mm512_add_epi64(
+      _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_epi64(word_shift));
+  const __m512i lo =
+      _mm512_maskz_permutexvar_epi64(0xFF >> word_shift, idx, data);
+  const __m512i hi = _mm512_maskz_permutexvar_epi64(
+      0xFF >> (word_shift + 1), _mm512_add_epi64(idx, _mm512_set1_epi64(1)),
+      data);
+  return _mm512_shrdv_epi64(lo, hi, _mm512_set1_epi64(num_bits & 63));
+}
+
+static inline __m512i ShiftLeft512(__m512i data, int num_bits) {
+  const int word_shift = num_bits >> 6;
+  const __m512i idx = _mm512_sub_epi64(
+      _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_epi64(word_shift));
+  const __m512i hi =
+      _mm512_maskz_permutexvar_epi64(0xFF << word_shift, idx, data);
+  const __m512i lo = _mm512_maskz_permutexvar_epi64(
+      0xFF << (word_shift + 1), _mm512_sub_epi64(idx, _mm512_set1_epi64(1)),
+      data);
+  return _mm512_shldv_epi64(hi, lo, _mm512_set1_epi64(num_bits & 63));
+}
+
+__m512i CycleBitShift2to384(__m512i data, int16_t cyc_shift, int16_t zc) {
+  cyc_shift = cyc_shift % zc;
+  if (cyc_shift == 0) {
+    return data;
+  }
+  if (zc <= 64) {
+    // The segment fits the lowest 64-bit word
+    const __m512i x1 = _mm512_srli_epi64(data, cyc_shift);
+    const __m512i x2 = _mm512_slli_epi64(data, zc - cyc_shift);
+    return _mm512_maskz_and_epi64(
+        1, _mm512_or_si512(x1, x2),
+        _mm512_set1_epi64(static_cast<int64_t>(~0ULL >> (64 - zc))));
+  }
+  // The bits above zc: the whole words, and the remaining bits of a word
+  const __mmask8 word_mask = static_cast<__mmask8>((1u << (zc >> 6)) - 1);
+  const __mmask8 part_mask = static_cast<__mmask8>(1u << (zc >> 6));
+  const __m512i bit_mask = _mm512_mask_set1_epi64(
+      _mm512_maskz_set1_epi64(word_mask, -1), part_mask,
+      static_cast<int64_t>((1ULL << (zc & 63)) - 1));
+
+  const __m512i x1 = ShiftRight512(data, cyc_shift);
+  const __m512i x2 = ShiftLeft512(data, zc - cyc_shift);
+  return _mm512_and_si512(_mm512_or_si512(x1, x2), bit_mask);
+}
+#endif
+
 CYCLIC_BIT_SHIFT LdpcSelectShiftFunc(int16_t zcSize) {
   if (zcSize <= 64) {
     return CycleBitShift2to64;
@@ -18,6 +18,12 @@ inline __m256i CycleBitShift144to256(__m256i data, int16_t cyc_shift,
 
 using CYCLIC_BIT_SHIFT = __m256i (*)(__m256i, int16_t, int16_t);
 CYCLIC_BIT_SHIFT LdpcSelectShiftFunc(int16_t zcSize);
+
+#if defined(__AVX512VBMI2__)
+// Cyclic right shift of a zc-bit (zc <= 384) segment held in one __m512i.
+// The segment must be masked to zc bits.
+__m512i CycleBitShift2to384(__m512i data, int16_t cyc_shift, int16_t zc);
+#endif
 }  // namespace avx2enc
 
 #endif  // CYCLIC_SHIFT_H_
@@ -236,6 +236,213 @@ void LdpcEncoderBg2(int8_t* pDataIn, int8_t* pDataOut,
   }
 }
 
+#if defined(__AVX512F__)
+// Cyclic right shift of the zc-bit (zc <= 64) chunk in each 64-bit lane, by
+// the same amount in all the lanes. The chunks must be masked to zc bits.
+static inline __m512i CycleBitShiftLanes(__m512i data, int16_t cyc_shift,
+                                         int16_t zc, __m512i bit_mask) {
+  cyc_shift = cyc_shift % zc;
+  const __m512i x1 = _mm512_srlv_epi64(data, _mm512_set1_epi64(cyc_shift));
+  const __m512i x2 =
+      _mm512_sllv_epi64(data, _mm512_set1_epi64(zc - cyc_shift));
+  return _mm512_and_si512(_mm512_or_si512(x1, x2), bit_mask);
+}
+
+// LdpcEncoderBg1 and LdpcEncoderBg2 on __m512i chunks. p_in holds one vector
+// per input column, masked to the zc-bit segments, and p_out gets one vector
+// per parity row. cycle_bit_shift(data, cyc_shift) rotates the segments of a
+// vector: the 64-bit lanes of several code blocks, or the single segment of
+// one code block with zc up to 384.
+template <typename CycleBitShift>
+static void LdpcEncoderZmm(const __m512i* p_in, __m512i* p_out, uint16_t bg,
+                           const int16_t* pMatrixNumPerCol,
+                           const int16_t* pAddr, const int16_t* pShiftMatrix,
+                           int16_t zcSize, uint8_t i_LS,
+                           CycleBitShift cycle_bit_shift) {
+  const size_t num_rows = (bg == 1) ? BG1_ROW_TOTAL : BG2_ROW_TOTAL;
+  const size_t num_inf_cols = (bg == 1) ? BG1_COL_INF_NUM : BG2_COL_INF_NUM;
+  const int16_t* p_temp_addr = pAddr;
+  const int16_t* p_temp_matrix = pShiftMatrix;
+
+  for (size_t j = 0; j < num_rows; j++) {
+    p_out[j] = _mm512_setzero_si512();
+  }
+
+  // getting lambdas
+  for (size_t i = 0; i < num_inf_cols; i++) {
+    const __m512i x1 = p_in[i];
+    for (int32_t j = 0; j < *(pMatrixNumPerCol + i); j++) {
+      // pAddr is the byte offset of the row with FlexRAN's PROC_BYTES
+      const size_t row = (*p_temp_addr++) / PROC_BYTES;
+      const __m512i x2 = cycle_bit_shift(x1, *p_temp_matrix++);
+      p_out[row] = _mm512_xor_si512(p_out[row], x2);
+    }
+  }
+
+  // Row Transform to resolve the small 4x4 parity matrix
+  const __m512i x1 = p_out[0];
+  const __m512i x2 = p_out[1];
+  const __m512i x3 = p_out[2];
+  const __m512i x4 = p_out[3];
+  __m512i x5 = _mm512_xor_si512(_mm512_xor_si512(x1, x2),
+                                _mm512_xor_si512(x3, x4));
+  __m512i x6;
+  if (bg == 1) {
+    // Special case for the circulant
+    if (i_LS == 6) {
+      x5 = cycle_bit_shift(x5, 103);
+      x6 = x5;
+    } else {
+      x6 = cycle_bit_shift(x5, 1);
+    }
+    p_out[0] = x5;
+    p_out[1] = _mm512_xor_si512(x1, x6);
+    p_out[3] = _mm512_xor_si512(x4, x6);
+    p_out[2] = _mm512_xor_si512(x3, p_out[3]);
+  } else {
+    if ((i_LS == 3) || (i_LS == 7)) {
+      x6 = cycle_bit_shift(x5, 1);
+    } else {
+      x5 = cycle_bit_shift(x5, (zcSize - 1));
+      x6 = x5;
+    }
+    p_out[0] = x5;
+    p_out[1] = _mm512_xor_si512(x1, x6);
+    p_out[2] = _mm512_xor_si512(x2, p_out[1]);
+    p_out[3] = _mm512_xor_si512(x4, x6);
+  }
+
+  // Rest of parity based on identity matrix
+  for (size_t i = num_inf_cols; i < num_inf_cols + 4; i++) {
+    const __m512i x7 = p_out[i - num_inf_cols];
+    for (int32_t j = 0; j < *(pMatrixNumPerCol + i); j++) {
+      const size_t row = (*p_temp_addr++) / PROC_BYTES;
+      const __m512i x8 = cycle_bit_shift(x7, *p_temp_matrix++);
+      p_out[row] = _mm512_xor_si512(p_out[row], x8);
+    }
+  }
+}
+
+// Encode the code blocks of a request kEncodeLanes at a time with
+// LdpcEncoderZmm, each code block in one 64-bit lane. The adapters still scatter and gather each code block
+// through its own internal buffers, whose first 64 bits per chunk are
+// interleaved into the lanes.
+static void LdpcEncodeLanes(int8_t* const* input, int8_t* const* parity,
+                            int number_codeblocks, uint16_t bg, uint16_t zc,
+                            uint32_t cb_len, uint32_t cb_enc_len,
+                            const int16_t* p_matrix_num_per_col,
+                            const int16_t* p_addr,
+                            const int16_t* p_shift_matrix, uint8_t i_ls) {
+  static constexpr size_t kInputChunks = BG1_COL_TOTAL;
+  static constexpr size_t kParityChunks = BG1_ROW_TOTAL;
+  __attribute__((aligned(64))) int8_t
+      input_internal_buffer[kEncodeLanes][kInputChunks * kProcBytes] = {};
+  __attribute__((aligned(64))) int8_t
+      parity_internal_buffer[kEncodeLanes][kParityChunks * kProcBytes] = {};
+  __m512i lanes_in[kInputChunks];
+  __m512i lanes_out[kParityChunks];
+
+  const size_t num_inf_cols = (bg == 1) ? BG1_COL_INF_NUM : BG2_COL_INF_NUM;
+  const size_t num_rows = (bg == 1) ? BG1_ROW_TOTAL : BG2_ROW_TOTAL;
+  // Byte offsets of the internal buffers of the lanes
+  __attribute__((aligned(64))) int64_t input_offsets[kEncodeLanes];
+  __attribute__((aligned(64))) int64_t parity_offsets[kEncodeLanes];
+  for (size_t n = 0; n < kEncodeLanes; n++) {
+    input_offsets[n] = n * kInputChunks * kProcBytes;
+    parity_offsets[n] = n * kParityChunks * kProcBytes;
+  }
+  const __m512i lane_offsets = _mm512_load_si512(input_offsets);
+  const __m512i parity_lane_offsets = _mm512_load_si512(parity_offsets);
+  const __m512i bit_mask =
+      _mm512_set1_epi64(zc >= 64 ? -1 : ((1LL << zc) - 1));
+  const auto cycle_bit_shift = [zc, bit_mask](__m512i data,
+                                              int16_t cyc_shift) {
+    return CycleBitShiftLanes(data, cyc_shift, zc, bit_mask);
+  };
+  avx2enc::LDPC_ADAPTER_P ldpc_adapter_func =
+      avx2enc::LdpcSelectAdapterFunc(zc);
+
+  for (int n0 = 0; n0 < number_codeblocks; n0 += kEncodeLanes) {
+    const int num_lanes =
+        MIN(static_cast<int>(kEncodeLanes), number_codeblocks - n0);
+    const __mmask8 lane_mask = static_cast<__mmask8>((1u << num_lanes) - 1);
+    for (int n = 0; n < num_lanes; n++) {
+      ldpc_adapter_func(input[n0 + n], input_internal_buffer[n], zc, cb_len,
+                        1);
+    }
+    for (size_t i = 0; i < num_inf_cols; i++) {
+      lanes_in[i] = _mm512_and_si512(
+          _mm512_mask_i64gather_epi64(
+              _mm512_setzero_si512(), lane_mask, lane_offsets,
+              &input_internal_buffer[0][i * kProcBytes], 1),
+          bit_mask);
+    }
+
+    LdpcEncoderZmm(lanes_in, lanes_out, bg, p_matrix_num_per_col, p_addr,
+                   p_shift_matrix, static_cast<int16_t>(zc), i_ls,
+                   cycle_bit_shift);
+
+    for (size_t j = 0; j < num_rows; j++) {
+      _mm512_mask_i64scatter_epi64(&parity_internal_buffer[0][j * kProcBytes],
+                                   lane_mask, parity_lane_offsets,
+                                   lanes_out[j], 1);
+    }
+    for (int n = 0; n < num_lanes; n++) {
+      ldpc_adapter_func(parity[n0 + n], parity_internal_buffer[n], zc,
+                        cb_enc_len, 0);
+    }
+  }
+}
+#endif
+
+#if defined(__AVX512VBMI2__)
+// Whether this CPU runs the AVX-512 VBMI2 encoder, checked once
+static bool UseAvx512Encoder() {
+  static const bool kUseAvx512 = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512vbmi2");
+  }();
+  return kUseAvx512;
+}
+
+// Encode the code blocks of a request one at a time with LdpcEncoderZmm,
+// each Zc-bit segment (zc <= 384) in one kProcBytesAvx512-sized chunk
+static void LdpcEncodeAvx512(int8_t* const* input, int8_t* const* parity,
+                             int number_codeblocks, uint16_t bg, uint16_t zc,
+                             uint32_t cb_len, uint32_t cb_enc_len,
+                             const int16_t* p_matrix_num_per_col,
+                             const int16_t* p_addr,
+                             const int16_t* p_shift_matrix, uint8_t i_ls) {
+  static_assert(kProcBytesAvx512 == sizeof(__m512i));
+  __m512i input_internal_buffer[BG1_COL_TOTAL];
+  __m512i parity_internal_buffer[BG1_ROW_TOTAL];
+  const auto cycle_bit_shift = [zc](__m512i data, int16_t cyc_shift) {
+    return CycleBitShift2to384(data, cyc_shift, zc);
+  };
+
+  for (int n = 0; n < number_codeblocks; n++) {
+    Adapter2to384(input[n], reinterpret_cast<int8_t*>(input_internal_buffer),
+                  zc, cb_len, 1);
+    LdpcEncoderZmm(input_internal_buffer, parity_internal_buffer, bg,
+                   p_matrix_num_per_col, p_addr, p_shift_matrix,
+                   static_cast<int16_t>(zc), i_ls, cycle_bit_shift);
+    Adapter2to384(parity[n],
+                  reinterpret_cast<int8_t*>(parity_internal_buffer), zc,
+                  cb_enc_len, 0);
+  }
+}
+#endif
+
+size_t MaxZc() {
+#if defined(__AVX512VBMI2__)
+  if (UseAvx512Encoder()) {
+    return kZcMaxAvx512;
+  }
+#endif
+  return kZcMax;
+}
+
 int32_t BblibLdpcEncoder5gnr(
     struct bblib_ldpc_encoder_5gnr_request* request,
     struct bblib_ldpc_encoder_5gnr_response* response) {
@@ -295,6 +502,23 @@ int32_t BblibLdpcEncoder5gnr(
     p_addr = kBg2Address;
   }
 
+#if defined(__AVX512F__)
+  if ((number_codeblocks > 1) && (zc <= kLanesZcMax)) {
+    LdpcEncodeLanes(input, parity, number_codeblocks, bg, zc, cb_len,
+                    cb_enc_len, p_matrix_num_per_col, p_addr, p_shift_matrix,
+                    i_ls);
+    return 0;
+  }
+#endif
+#if defined(__AVX512VBMI2__)
+  if (UseAvx512Encoder()) {
+    LdpcEncodeAvx512(input, parity, number_codeblocks, bg, zc, cb_len,
+                     cb_enc_len, p_matrix_num_per_col, p_addr, p_shift_matrix,
+                     i_ls);
+    return 0;
+  }
+#endif
+
   __attribute__((aligned(64)))
   int8_t input_internal_buffer[BG1_COL_TOTAL * avx2enc::kProcBytes] = {0};
   __attribute__((aligned(64)))
@@ -20,12 +20,27 @@ namespace avx2enc {
 static constexpr size_t kZcMax = 255;
 
 static constexpr size_t kProcBytes = 32;
+
+// With AVX-512 VBMI2 (checked at runtime), code blocks are encoded in
+// kProcBytesAvx512-sized chunks, which hold every Zc up to kZcMaxAvx512
+static constexpr size_t kProcBytesAvx512 = 64;
+static constexpr size_t kZcMaxAvx512 = ZC_MAX;
+
+// With AVX-512, requests of several code blocks with Zc <= kLanesZcMax are
+// encoded kEncodeLanes code blocks at a time, one per 64-bit lane
+static constexpr size_t kEncodeLanes = 8;
+static constexpr size_t kLanesZcMax = 64;
+
+// Largest Zc that the encoder supports on this CPU
+size_t MaxZc();
+
 int32_t BblibLdpcEncoder5gnr(struct bblib_ldpc_encoder_5gnr_request* request,
                              struct bblib_ldpc_encoder_5gnr_response* response);
 };  // namespace avx2enc
 
 // PROC_BYTES (maximum bytes processed as an LDPC chunk) is 64 bytes in
-// FlexRAN's LDPC encoder and 32 bytes in Agora's derived LDPC encoder.
+// FlexRAN's LDPC encoder and 32 (AVX2) or 64 (AVX-512) bytes in Agora's
+// derived LDPC encoder.
 // Using the larger of the two works for padding buffers.
 static constexpr size_t kMaxProcBytes = 64;
 
@@ -7,6 +7,7 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 
 #include "common_typedef_sdk.h"
 #include "encoder.h"
@@ -224,6 +225,90 @@ void Adapter288to384(int8_t* ptr_buff_0, int8_t* ptr_buff_1, uint16_t zc_size,
   }
 }
 
+#if defined(__AVX512VBMI2__)
+/**
+ * @param ptr_buff_0 the packed bits, which are read or written exactly
+ * @param ptr_buff_1 must be (cb_len_bits / zc_size) * kProcBytesAvx512 (64)
+ * bytes large
+ * @param zc_size  zc value
+ * @param cb_len_bits codeblock length
+ * @param direct  1 = scatter, otherwise gather
+ */
+void Adapter2to384(int8_t* ptr_buff_0, int8_t* ptr_buff_1, uint16_t zc_size,
+                   uint32_t cb_len_bits, int8_t direct) {
+  assert(zc_size <= ZC_MAX);
+  auto* p_bits = reinterpret_cast<uint8_t*>(ptr_buff_0);
+  int8_t* p_chunk = ptr_buff_1;
+  const size_t sg_ops = (cb_len_bits / zc_size);
+
+  if ((zc_size % 8) == 0) {
+    // Byte-aligned segments move with one masked load and store each
+    const int16_t byte_num = zc_size >> 3;
+    const __mmask64 byte_mask = (1ULL << byte_num) - 1;
+    for (size_t i = 0; i < sg_ops; i++) {
+      if (1 == direct) {
+        _mm512_storeu_si512(p_chunk,
+                            _mm512_maskz_loadu_epi8(byte_mask, p_bits));
+      } else {
+        _mm512_mask_storeu_epi8(p_bits, byte_mask,
+                                _mm512_loadu_si512(p_chunk));
+      }
+      p_bits += byte_num;
+      p_chunk += kProcBytesAvx512;
+    }
+    return;
+  }
+
+  // Otherwise zc < 64: stream the bits through a 128-bit window, 64 bits at
+  // a time instead of ScatterSlow's and GatherSlow's byte at a time
+  const uint64_t bit_mask = (1ULL << zc_size) - 1;
+  unsigned __int128 window = 0;
+  size_t window_bits = 0;
+  if (1 == direct) {
+    size_t bytes_left = (cb_len_bits + 7) / 8;
+    for (size_t i = 0; i < sg_ops; i++) {
+      while (window_bits < zc_size) {
+        if (bytes_left >= sizeof(uint64_t)) {
+          uint64_t word;
+          std::memcpy(&word, p_bits, sizeof(uint64_t));
+          window |= static_cast<unsigned __int128>(word) << window_bits;
+          window_bits += 64;
+          p_bits += sizeof(uint64_t);
+          bytes_left -= sizeof(uint64_t);
+        } else {
+          window |= static_cast<unsigned __int128>(*p_bits++) << window_bits;
+          window_bits += 8;
+          bytes_left--;
+        }
+      }
+      const auto segment = static_cast<uint64_t>(window) & bit_mask;
+      _mm512_storeu_si512(p_chunk, _mm512_maskz_set1_epi64(1, segment));
+      window >>= zc_size;
+      window_bits -= zc_size;
+      p_chunk += kProcBytesAvx512;
+    }
+  } else {
+    for (size_t i = 0; i < sg_ops; i++) {
+      uint64_t segment;
+      std::memcpy(&segment, p_chunk, sizeof(uint64_t));
+      window |= static_cast<unsigned __int128>(segment & bit_mask)
+                << window_bits;
+      window_bits += zc_size;
+      if (window_bits >= 64) {
+        const auto word = static_cast<uint64_t>(window);
+        std::memcpy(p_bits, &word, sizeof(uint64_t));
+        p_bits += sizeof(uint64_t);
+        window >>= 64;
+        window_bits -= 64;
+      }
+      p_chunk += kProcBytesAvx512;
+    }
+    const auto word = static_cast<uint64_t>(window);
+    std::memcpy(p_bits, &word, (window_bits + 7) / 8);
+  }
+}
+#endif
+
 LDPC_ADAPTER_P LdpcSelectAdapterFunc(uint16_t zc_size) {
   if (zc_size < 64) {
     return Adapter2to64;
@@ -21,6 +21,13 @@ void Adapter288to384(int8_t* ptr_buff_0, int8_t* ptr_buff_1, uint16_t zc_size,
 
 using LDPC_ADAPTER_P = void (*)(int8_t*, int8_t*, uint16_t, uint32_t, int8_t);
 LDPC_ADAPTER_P LdpcSelectAdapterFunc(uint16_t zc_size);
+
+#if defined(__AVX512VBMI2__)
+// Scatter / gather zc-bit segments (zc <= 384) to / from kProcBytesAvx512
+// sized chunks
+void Adapter2to384(int8_t* ptr_buff_0, int8_t* ptr_buff_1, uint16_t zc_size,
+                   uint32_t cb_len_bits, int8_t direct);
+#endif
 }  // namespace avx2enc
 
 #endif  // IOBUFFER_H_
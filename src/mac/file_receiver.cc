@@ -5,27 +5,93 @@
 
 #include "file_receiver.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
 #include "logger.h"
+#include "utils.h"
 
 static constexpr size_t kMaxReadAttempts = 2u;
 
-FileReceiver::FileReceiver(std::string &file_name)
-    : file_name_(file_name), data_available_(0), data_start_offset_(0) {
+FileReceiver::FileReceiver(std::string &file_name, bool map_file)
+    : file_name_(file_name),
+      map_(nullptr),
+      map_size_(0),
+      map_offset_(0),
+      map_prefetched_(0),
+      data_available_(0),
+      data_start_offset_(0) {
+  if (map_file) {
+    const int fd = ::open(file_name_.c_str(), O_RDONLY);
+    RtAssert(fd >= 0, "[FileReceiver] failed to open " + file_name_);
+    struct stat file_stat;
+    RtAssert(::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0,
+             "[FileReceiver] failed to get the size of " + file_name_);
+    map_size_ = static_cast<size_t>(file_stat.st_size);
+    void *map = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    RtAssert(map != MAP_FAILED, "[FileReceiver] failed to map " + file_name_);
+    ::madvise(map, map_size_, MADV_SEQUENTIAL);
+    map_ = static_cast<const unsigned char *>(map);
+    AGORA_LOG_INFO("[FileReceiver] mapped %zu bytes of %s\n", map_size_,
+                   file_name_.c_str());
+    return;
+  }
   ///\todo Make sure that the file size is > FileReceiver::kFileStreamRxSize
   data_stream_.open(file_name_, (std::ifstream::in | std::ifstream::binary));
   assert(data_stream_.is_open() == true);
 }
 
 FileReceiver::~FileReceiver() {
+  if (map_ != nullptr) {
+    ::munmap(const_cast<unsigned char *>(map_), map_size_);
+  }
   if (data_stream_.is_open() == true) {
     data_stream_.close();
   }
 }
 
+const unsigned char *FileReceiver::Map(size_t requested_bytes,
+                                       size_t &loaded_bytes) {
+  if (map_ == nullptr) {
+    loaded_bytes = 0;
+    return nullptr;
+  }
+  if (map_offset_ + requested_bytes > map_size_) {
+    map_offset_ = 0;
+    map_prefetched_ = 0;
+  }
+  // Read ahead in the background, so the sender does not wait for the disk
+  if ((map_prefetched_ < map_size_) &&
+      (map_offset_ + requested_bytes + (kMapPrefetchBytes / 2) >
+       map_prefetched_)) {
+    static const size_t kPageSize = ::sysconf(_SC_PAGESIZE);
+    const size_t start = (map_offset_ / kPageSize) * kPageSize;
+    const size_t end =
+        std::min(map_offset_ + requested_bytes + kMapPrefetchBytes, map_size_);
+    ::madvise(const_cast<unsigned char *>(map_ + start), end - start,
+              MADV_WILLNEED);
+    map_prefetched_ = end;
+  }
+  const unsigned char *data = map_ + map_offset_;
+  loaded_bytes = std::min(requested_bytes, map_size_);
+  map_offset_ += loaded_bytes;
+  return data;
+}
+
 size_t FileReceiver::Load(unsigned char *destination, size_t requested_bytes) {
+  if (map_ != nullptr) {
+    size_t loaded_bytes = 0;
+    const unsigned char *data = Map(requested_bytes, loaded_bytes);
+    std::memcpy(destination, data, loaded_bytes);
+    return loaded_bytes;
+  }
   size_t loaded_bytes = 0;
   const size_t file_read_size =
       std::max(FileReceiver::kFileStreamRxSize, requested_bytes);
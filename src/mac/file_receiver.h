@@ -21,13 +21,29 @@ class FileReceiver : public MacDataReceiver {
   static constexpr size_t kFileStreamRxSize = (2048u);
   static constexpr size_t kFileStreamLocalRxBufSize = (kFileStreamRxSize * 10u);
 
-  explicit FileReceiver(std::string &file_name);
+  // Bytes of the mapped file that Map() asks the kernel to read ahead
+  static constexpr size_t kMapPrefetchBytes = (4u * 1024u * 1024u);
+
+  // With map_file, the file is memory-mapped and Map() hands out the
+  // payloads in place
+  explicit FileReceiver(std::string &file_name, bool map_file = false);
   ~FileReceiver() override;
 
   size_t Load(unsigned char *destination, size_t requested_bytes) final;
+  // Payloads never straddle the end of the file: when fewer than
+  // requested_bytes are left, the file starts over
+  const unsigned char *Map(size_t requested_bytes,
+                           size_t &loaded_bytes) final;
 
  private:
   std::string file_name_;
+  // The memory-mapped file, if mapped
+  const unsigned char *map_;
+  size_t map_size_;
+  size_t map_offset_;
+  // The kernel has been asked to read the mapping up to here
+  size_t map_prefetched_;
+
   std::ifstream data_stream_;
   std::array<uint8_t, FileReceiver::kFileStreamLocalRxBufSize> local_rx_buffer_;
 
@@ -32,6 +32,8 @@ DEFINE_string(
 DEFINE_string(fwd_udp_address, "", "Forward decoded mac data to address");
 DEFINE_uint64(fwd_udp_port, 0,
               "Forward decoded mac data port id (Set to 0 to disable)");
+DEFINE_bool(map_data_file, false,
+            "Memory-map the data file and send the payloads from it in place");
 DEFINE_uint64(
     enable_slow_start, 0,
     "Send frames slower than the specified frame duration during warmup");
@@ -41,7 +43,7 @@ int main(int argc, char* argv[]) {
 
   gflags::SetUsageMessage(
       "num_sender_threads, num_receiver_threads, core_offset, frame_duration, "
-      "conf_file, data_file, enable_slow_start");
+      "conf_file, data_file, map_data_file, enable_slow_start");
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   std::string cur_directory = TOSTRING(PROJECT_DIRECTORY);
   std::string filename = FLAGS_conf_file;
@@ -110,7 +112,7 @@ int main(int argc, char* argv[]) {
                       std::placeholders::_1),
             thread_start, FLAGS_num_sender_worker_threads,
             FLAGS_num_sender_update_threads, FLAGS_frame_duration, 0,
-            FLAGS_enable_slow_start, true);
+            FLAGS_enable_slow_start, true, FLAGS_map_data_file);
         thread_start += num_total_sender_threads;
         sender->StartTxfromMain(frame_start, frame_end);
       }
@@ -12,11 +12,21 @@
  */
 class MacDataReceiver {
  public:
+  virtual ~MacDataReceiver() = default;
+
   virtual size_t Load(unsigned char *destination, size_t requested_bytes) = 0;
 
+  // The next requested_bytes of data in place, valid for the life of the
+  // source, with loaded_bytes set to the bytes available there. Returns
+  // nullptr if the source can only Load().
+  virtual const unsigned char *Map(size_t /*requested_bytes*/,
+                                   size_t &loaded_bytes) {
+    loaded_bytes = 0;
+    return nullptr;
+  }
+
  protected:
   inline MacDataReceiver() = default;
-  virtual ~MacDataReceiver() = default;
 };
 
 #endif  // MAC_DATA_RECEIVER_H_
\ No newline at end of file
@@ -0,0 +1,105 @@
+/**
+ * @file mac_phy_ring.cc
+ * @brief Implementation file for the MacPhyRing class
+ */
+#include "mac_phy_ring.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "logger.h"
+#include "utils.h"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "MacPhyRing needs lock-free atomics to share memory");
+
+// Smallest hugepage, which the memfd size must be a multiple of
+static constexpr size_t kHugepageBytes = 2 * 1024 * 1024;
+
+MacPhyRing::MacPhyRing(size_t num_slots, bool use_hugepage) {
+  size_t slots = 1;
+  while (slots < num_slots) {
+    slots *= 2;
+  }
+  const size_t bytes = sizeof(Header) + (slots * sizeof(MacTbDescriptor));
+  bool mapped = false;
+  if (use_hugepage) {
+    mapped = Create(
+        ((bytes + kHugepageBytes - 1) / kHugepageBytes) * kHugepageBytes,
+        MFD_CLOEXEC | MFD_HUGETLB);
+    if (mapped == false) {
+      AGORA_LOG_WARN(
+          "MacPhyRing: no hugepage for the ring, using 4 KB pages\n");
+    }
+  }
+  if ((mapped == false) && (Create(bytes, MFD_CLOEXEC) == false)) {
+    throw std::runtime_error("MacPhyRing: failed to create the memfd");
+  }
+  header_->head_.store(0);
+  header_->tail_.store(0);
+  header_->num_slots_ = slots;
+}
+
+MacPhyRing::MacPhyRing(int fd) : fd_(fd) {
+  struct stat st;
+  if (::fstat(fd_, &st) != 0) {
+    throw std::runtime_error("MacPhyRing: failed to stat the memfd");
+  }
+  if (Map(st.st_size) == false) {
+    throw std::runtime_error("MacPhyRing: failed to map the memfd");
+  }
+}
+
+MacPhyRing::~MacPhyRing() {
+  ::munmap(header_, map_bytes_);
+  ::close(fd_);
+}
+
+bool MacPhyRing::Create(size_t bytes, unsigned int flags) {
+  fd_ = ::memfd_create("agora_mac_phy_ring", flags);
+  if (fd_ < 0) {
+    return false;
+  }
+  if ((::ftruncate(fd_, bytes) != 0) || (Map(bytes) == false)) {
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+bool MacPhyRing::Map(size_t bytes) {
+  void* mem =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (mem == MAP_FAILED) {
+    return false;
+  }
+  map_bytes_ = bytes;
+  header_ = static_cast<Header*>(mem);
+  slots_ = reinterpret_cast<MacTbDescriptor*>(header_ + 1);
+  return true;
+}
+
+bool MacPhyRing::TryPush(const MacTbDescriptor& tb) {
+  const uint64_t tail = header_->tail_.load(std::memory_order_relaxed);
+  if ((tail - header_->head_.load(std::memory_order_acquire)) ==
+      header_->num_slots_) {
+    return false;
+  }
+  slots_[tail & (header_->num_slots_ - 1)] = tb;
+  header_->tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+bool MacPhyRing::TryPop(MacTbDescriptor& tb) {
+  const uint64_t head = header_->head_.load(std::memory_order_relaxed);
+  if (head == header_->tail_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  tb = slots_[head & (header_->num_slots_ - 1)];
+  header_->head_.store(head + 1, std::memory_order_release);
+  return true;
+}
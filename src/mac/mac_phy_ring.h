@@ -0,0 +1,68 @@
+/**
+ * @file mac_phy_ring.h
+ * @brief Single-producer single-consumer ring of transport block descriptors
+ * between the PHY and the MAC, in shared memory
+ */
+#ifndef MAC_PHY_RING_H_
+#define MAC_PHY_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// The uplink transport block of one UE in one frame, decoded in place in
+/// the frame's slot of the decoded buffer
+struct MacTbDescriptor {
+  uint32_t frame_id_;
+  uint32_t ue_id_;
+};
+
+/**
+ * @brief A lock-free ring of MacTbDescriptor, for one producer and one
+ * consumer thread. The ring lives in a memfd, so that a MAC running in
+ * another process can map it from Fd().
+ */
+class MacPhyRing {
+ public:
+  /**
+   * @brief Create a ring in a new memfd
+   * @param num_slots Number of descriptors, rounded up to a power of two
+   * @param use_hugepage Back the memfd with a hugepage
+   */
+  MacPhyRing(size_t num_slots, bool use_hugepage);
+  /// Map the ring created by another process, given the memfd it shared
+  explicit MacPhyRing(int fd);
+  ~MacPhyRing();
+
+  MacPhyRing(const MacPhyRing&) = delete;
+  MacPhyRing& operator=(const MacPhyRing&) = delete;
+
+  /// Producer side. Returns false if the ring is full.
+  bool TryPush(const MacTbDescriptor& tb);
+  /// Consumer side. Returns false if the ring is empty.
+  bool TryPop(MacTbDescriptor& tb);
+
+  inline int Fd() const { return fd_; }
+  inline size_t NumSlots() const { return header_->num_slots_; }
+
+ private:
+  // Start of the shared memory, followed by the slots. The atomics are
+  // lock-free, so they work across processes.
+  struct Header {
+    alignas(64) std::atomic<uint64_t> head_;  // Next slot to pop
+    alignas(64) std::atomic<uint64_t> tail_;  // Next slot to push
+    alignas(64) uint64_t num_slots_;
+  };
+
+  // Create, size and map a new memfd. Returns false on failure.
+  bool Create(size_t bytes, unsigned int flags);
+  // Map bytes of fd_. Returns false on failure.
+  bool Map(size_t bytes);
+
+  int fd_;
+  size_t map_bytes_;
+  Header* header_;
+  MacTbDescriptor* slots_;
+};
+
+#endif  // MAC_PHY_RING_H_
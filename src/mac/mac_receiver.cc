@@ -4,17 +4,22 @@
  */
 #include "mac_receiver.h"
 
+#include <array>
 #include <utility>
+#include <vector>
 
 #include "logger.h"
 #include "signal_handler.h"
 #include "udp_client.h"
 #include "udp_server.h"
 
-static const bool kDebugMacReceiver = true;
+static const bool kDebugMacReceiver = false;
 static const std::string kMacRxAddress = "";
 static const std::string kMacTxAddress = "127.0.0.1";
 static constexpr uint16_t kMacTxPort = 0;
+// Maximum number of frames received per recvmmsg() and forwarded per
+// sendmmsg()
+static constexpr size_t kRxBatchSize = 16;
 
 MacReceiver::MacReceiver(Config* const cfg, size_t num_frame_data_bytes,
                          std::string phy_server_address, size_t phy_port,
@@ -75,42 +80,51 @@ void* MacReceiver::LoopRecv(size_t tid) {
       "MacReceiver: Set up UDP socket server listening to port %zu\n",
       phy_port_ + ue_id);
 
-  // Create a rx buffer
+  // Create the rx buffers, one frame each
   const size_t max_packet_length = data_bytes_;
-  auto* rx_buffer = new std::byte[max_packet_length];
+  std::vector<std::byte> rx_buffer(kRxBatchSize * max_packet_length);
+  std::array<std::byte*, kRxBatchSize> rx_bufs;
+  std::array<size_t, kRxBatchSize> rx_lens;
+  std::array<uint16_t, kRxBatchSize> fwd_ports;
+  for (size_t i = 0; i < kRxBatchSize; i++) {
+    rx_bufs.at(i) = &rx_buffer.at(i * max_packet_length);
+  }
+  fwd_ports.fill(static_cast<uint16_t>(udp_dest_port_ + ue_id));
 
   while ((SignalHandler::GotExitSignal() == false) &&
          (cfg_->Running() == true)) {
-    const ssize_t recvlen = udp_server->Recv(phy_address_, phy_port_ + ue_id,
-                                             &rx_buffer[0u], max_packet_length);
-    if (recvlen < 0) {
+    const ssize_t num_rx = udp_server->RecvBatch(
+        rx_bufs.data(), max_packet_length, rx_lens.data(), kRxBatchSize);
+    if (num_rx < 0) {
       std::perror("recv failed");
       throw std::runtime_error("Receiver: recv failed");
-    } else if ((recvlen > 0) &&
-               static_cast<size_t>(recvlen) <= max_packet_length) {
+    } else if (num_rx > 0) {
       if (enable_udp_output_) {
-        udp_streamer->Send(udp_dest_address_, udp_dest_port_ + ue_id,
-                           &rx_buffer[0u], recvlen);
+        udp_streamer->SendBatch(udp_dest_address_, fwd_ports.data(),
+                                rx_bufs.data(), rx_lens.data(), num_rx);
       }
 
-      if (kDebugMacReceiver) {
-        AGORA_LOG_INFO("MacReceiver: Thread %zu, Data Bytes: %zu:%zu, Data:",
-                       tid, recvlen, max_packet_length);
-        for (size_t i = 0; i < static_cast<size_t>(recvlen); i++) {
-          AGORA_LOG_INFO(" %02x", static_cast<uint8_t>(rx_buffer[i]));
+      for (size_t pkt = 0; pkt < static_cast<size_t>(num_rx); pkt++) {
+        const size_t recvlen = rx_lens.at(pkt);
+        if (kDebugMacReceiver) {
+          AGORA_LOG_INFO(
+              "MacReceiver: Thread %zu, Data Bytes: %zu:%zu, Data:", tid,
+              recvlen, max_packet_length);
+          for (size_t i = 0; i < recvlen; i++) {
+            AGORA_LOG_INFO(" %02x", static_cast<uint8_t>(rx_bufs.at(pkt)[i]));
+          }
+          AGORA_LOG_INFO("\n");
         }
-        AGORA_LOG_INFO("\n");
-      }
 
-      if (static_cast<size_t>(recvlen) != max_packet_length) {
-        AGORA_LOG_INFO(
-            "MacReceiver: Thread %zu received less than max data bytes "
-            "%zu:%zu\n",
-            tid, recvlen, max_packet_length);
+        if (recvlen != max_packet_length) {
+          AGORA_LOG_INFO(
+              "MacReceiver: Thread %zu received less than max data bytes "
+              "%zu:%zu\n",
+              tid, recvlen, max_packet_length);
+        }
       }
     }
   }
-  delete[] rx_buffer;
   AGORA_LOG_INFO("MacReceiver: Finished\n");
   return nullptr;
 }
@@ -4,77 +4,270 @@
  */
 #include "mac_scheduler.h"
 
-MacScheduler::MacScheduler(Config* const cfg) : cfg_(cfg) {
+#include <algorithm>
+#include <cmath>
+
+#include "comms-lib.h"
+
+// Average rate of a UE before it is first scheduled
+static constexpr float kInitAvgRate = 1e-3f;
+// Subcarriers per PRB, the unit of the subcarrier allocation
+static constexpr size_t kScsPerPrb = 12;
+
+// num_sc subcarriers rounded up to whole PRBs, within the data subcarriers
+static size_t WholePrbs(size_t num_sc, size_t ofdm_data_num) {
+  return std::min(ofdm_data_num,
+                  ((num_sc + kScsPerPrb - 1) / kScsPerPrb) * kScsPerPrb);
+}
+
+MacScheduler::MacScheduler(Config* const cfg, bool per_frame)
+    : per_frame_(per_frame),
+      next_frame_id_(0),
+      cfg_(cfg),
+      ran_epoch_(0),
+      ran_ul_mcs_(cfg->McsIndex(Direction::kUplink)),
+      ran_frame_id_(0),
+      epoch_(0),
+      base_ul_mcs_(cfg->McsIndex(Direction::kUplink)) {
   num_groups_ =
       (cfg_->SpatialStreamsNum() == cfg_->UeAntNum()) ? 1 : cfg_->UeAntNum();
-  schedule_buffer_.Calloc(num_groups_, cfg_->UeAntNum() * cfg_->OfdmDataNum(),
-                          Agora_memory::Alignment_t::kAlign64);
-  schedule_buffer_index_.Calloc(num_groups_,
-                                cfg_->SpatialStreamsNum() * cfg_->OfdmDataNum(),
-                                Agora_memory::Alignment_t::kAlign64);
+  rows_.resize(per_frame_ ? cfg_->FrameWindow() : num_groups_);
+  // No frame is scheduled before ScheduleFrame()
+  published_ = std::make_unique<std::atomic<size_t>[]>(rows_.size());
+  for (size_t row = 0u; row < rows_.size(); row++) {
+    published_[row].store(SIZE_MAX, std::memory_order_relaxed);
+  }
+  // Only the per-frame proportional fair schedule may keep a group
+  rotates_groups_ =
+      (num_groups_ > 1) && ((per_frame_ && cfg_->MacSchedulerPf()) == false);
+  ul_load_.fill(cfg_->UlOfferedLoad());
+  dl_load_.fill(cfg_->DlOfferedLoad());
+  next_turn_.fill(0);
+  if (per_frame_ && cfg_->UeGroupingEnabled() &&
+      (cfg_->SpatialStreamsNum() < cfg_->UeAntNum())) {
+    grouping_ = std::make_unique<UeGrouping>(
+        cfg_->UeAntNum(), cfg_->SpatialStreamsNum(), cfg_->UeGroupingMaxCorr());
+  }
   // Create round-robin schedule
-  for (size_t gp = 0u; gp < num_groups_; gp++) {
-    for (size_t sc = 0; sc < cfg_->OfdmDataNum(); sc++) {
-      for (size_t ue = gp; ue < gp + cfg_->SpatialStreamsNum(); ue++) {
-        size_t cur_ue = ue % cfg_->UeAntNum();
-        // for now all SCs are allocated to scheduled UEs
-        schedule_buffer_[gp][cur_ue + cfg_->UeAntNum() * sc] = 1;
-        schedule_buffer_index_[gp][(ue - gp) + cfg_->SpatialStreamsNum() * sc] =
-            cur_ue;
-      }
+  for (size_t row = 0u; row < rows_.size(); row++) {
+    const size_t gp = row % num_groups_;
+    std::array<uint8_t, kMaxUEs> selected{};
+    for (size_t ue = gp; ue < gp + cfg_->SpatialStreamsNum(); ue++) {
+      selected.at(ue % cfg_->UeAntNum()) = 1;
     }
+    ScheduleSnapshot& snapshot = rows_.at(row);
+    snapshot.epoch_ = 0;
+    snapshot.frame_id_ = row;
+    WriteSchedule(snapshot, selected);
+    snapshot.ul_mcs_.fill(cfg_->McsIndex(Direction::kUplink));
+    snapshot.dl_mcs_.fill(cfg_->McsIndex(Direction::kDownlink));
+    snapshot.phy_ul_mcs_ = cfg_->McsIndex(Direction::kUplink);
+    WriteAllocation(snapshot);
   }
 
-  ul_mcs_buffer_.Calloc(num_groups_, cfg_->UeAntNum(),
-                        Agora_memory::Alignment_t::kAlign64);
-  dl_mcs_buffer_.Calloc(num_groups_, cfg_->UeAntNum(),
-                        Agora_memory::Alignment_t::kAlign64);
-  for (size_t gp = 0u; gp < num_groups_; gp++) {
-    for (size_t ue = 0; ue < cfg_->UeAntNum(); ue++) {
-      ul_mcs_buffer_[gp][ue] = cfg_->McsIndex(Direction::kUplink);
-      dl_mcs_buffer_[gp][ue] = cfg_->McsIndex(Direction::kDownlink);
-    }
+  for (size_t mcs = 0; mcs < kNumMcs; mcs++) {
+    mcs_rate_.at(mcs) = static_cast<float>(GetModOrderBits(mcs) *
+                                           GetCodeRate(mcs)) /
+                        1024.0f;
+  }
+  avg_rate_.fill(kInitAvgRate);
+  metric_.fill(0.0f);
+  ul_mcs_.fill(cfg_->McsIndex(Direction::kUplink));
+  dl_mcs_.fill(cfg_->McsIndex(Direction::kDownlink));
+  for (size_t ue = 0; ue < kMaxUEs; ue++) {
+    rate_.at(ue) = mcs_rate_.at(ul_mcs_.at(ue));
   }
 }
 
-MacScheduler::~MacScheduler() {
-  schedule_buffer_.Free();
-  schedule_buffer_index_.Free();
-  ul_mcs_buffer_.Free();
-  dl_mcs_buffer_.Free();
-}
+MacScheduler::~MacScheduler() = default;
 
 bool MacScheduler::IsUeScheduled(size_t frame_id, size_t sc_id, size_t ue_id) {
-  size_t gp = frame_id % num_groups_;
-  return (schedule_buffer_[gp][ue_id + cfg_->UeAntNum() * sc_id] != 0);
+  unused(sc_id);
+  return (Schedule(frame_id).ue_map_[ue_id] != 0);
 }
 
 size_t MacScheduler::ScheduledUeIndex(size_t frame_id, size_t sc_id,
                                       size_t sched_ue_id) {
-  return (size_t)this->ScheduledUeList(frame_id, sc_id)[sched_ue_id];
+  unused(sc_id);
+  return Schedule(frame_id).ue_list_[sched_ue_id];
 }
 
 arma::uvec MacScheduler::ScheduledUeMap(size_t frame_id, size_t sc_id) {
-  size_t gp = frame_id % num_groups_;
-  return arma::uvec(reinterpret_cast<unsigned long long*>(
-                        &schedule_buffer_[gp][cfg_->UeAntNum() * sc_id]),
+  unused(sc_id);
+  return arma::uvec(reinterpret_cast<unsigned long long*>(const_cast<size_t*>(
+                        Schedule(frame_id).ue_map_.data())),
                     cfg_->UeAntNum(), false);
 }
 
 arma::uvec MacScheduler::ScheduledUeList(size_t frame_id, size_t sc_id) {
-  size_t gp = frame_id % num_groups_;
-  return sort(arma::uvec(
-      reinterpret_cast<unsigned long long*>(
-          &schedule_buffer_index_[gp][cfg_->SpatialStreamsNum() * sc_id]),
-      cfg_->SpatialStreamsNum(), false));
+  unused(sc_id);
+  return arma::uvec(reinterpret_cast<unsigned long long*>(const_cast<size_t*>(
+                        Schedule(frame_id).ue_list_.data())),
+                    cfg_->SpatialStreamsNum(), false);
 }
 
 size_t MacScheduler::ScheduledUeUlMcs(size_t frame_id, size_t ue_id) {
-  size_t gp = frame_id % num_groups_;
-  return ul_mcs_buffer_[gp][ue_id];
+  return Schedule(frame_id).ul_mcs_[ue_id];
 }
 
 size_t MacScheduler::ScheduledUeDlMcs(size_t frame_id, size_t ue_id) {
-  size_t gp = frame_id % num_groups_;
-  return dl_mcs_buffer_[gp][ue_id];
+  return Schedule(frame_id).dl_mcs_[ue_id];
+}
+
+void MacScheduler::UpdateRanConfig(const RanConfig& rc) {
+  if (rc.mcs_index_ == ran_ul_mcs_) {
+    return;
+  }
+  ran_epoch_++;
+  ran_ul_mcs_ = rc.mcs_index_;
+  ran_frame_id_ = std::max(rc.frame_id_, next_frame_id_);
+}
+
+void MacScheduler::SetOfferedLoad(size_t ue_id, float ul_load,
+                                  float dl_load) {
+  ul_load_.at(ue_id) = std::clamp(ul_load, 0.0f, 1.0f);
+  dl_load_.at(ue_id) = std::clamp(dl_load, 0.0f, 1.0f);
+}
+
+void MacScheduler::ScheduleFrame(size_t frame_id) {
+  if ((per_frame_ == false) || (frame_id < next_frame_id_)) {
+    return;
+  }
+  // Only the last rows_.size() frames are still in a row
+  if ((frame_id - next_frame_id_) >= rows_.size()) {
+    next_frame_id_ = frame_id + 1 - rows_.size();
+  }
+  for (; next_frame_id_ <= frame_id; next_frame_id_++) {
+    ScheduleOneFrame(next_frame_id_);
+  }
+}
+
+void MacScheduler::ScheduleOneFrame(size_t frame_id) {
+  const size_t num_ues = cfg_->UeAntNum();
+  if ((ran_epoch_ != epoch_) && (frame_id >= ran_frame_id_)) {
+    epoch_ = ran_epoch_;
+    base_ul_mcs_ = ran_ul_mcs_;
+    ul_mcs_.fill(base_ul_mcs_);
+    rate_.fill(mcs_rate_.at(base_ul_mcs_));
+  }
+
+  std::array<uint8_t, kMaxUEs> selected{};
+  const size_t num_streams = cfg_->SpatialStreamsNum();
+  if ((cfg_->MacSchedulerPf() == false) && (grouping_ != nullptr)) {
+    // Round robin over the channel-aware groups: the UEs that waited the
+    // longest go first
+    for (size_t ue = 0; ue < num_ues; ue++) {
+      metric_[ue] = static_cast<float>(frame_id + 1 - next_turn_[ue]);
+    }
+    grouping_->FormGroup(metric_.data(), selected);
+  } else if (cfg_->MacSchedulerPf() == false) {
+    const size_t gp = frame_id % num_groups_;
+    for (size_t ue = gp; ue < gp + num_streams; ue++) {
+      selected[ue % num_ues] = 1;
+    }
+  } else if (num_streams == num_ues) {
+    std::fill_n(selected.begin(), num_ues, 1);
+  } else if (grouping_ != nullptr) {
+    for (size_t ue = 0; ue < num_ues; ue++) {
+      metric_[ue] = rate_[ue] / avg_rate_[ue];
+    }
+    grouping_->FormGroup(metric_.data(), selected);
+  } else {
+    // Proportional fair: the streams go to the UEs with the highest ratio of
+    // their rate to their average rate
+    for (size_t ue = 0; ue < num_ues; ue++) {
+      metric_[ue] = rate_[ue] / avg_rate_[ue];
+    }
+    for (size_t stream = 0; stream < num_streams; stream++) {
+      size_t best = 0;
+      float best_metric = -1.0f;
+      for (size_t ue = 0; ue < num_ues; ue++) {
+        if (metric_[ue] > best_metric) {
+          best_metric = metric_[ue];
+          best = ue;
+        }
+      }
+      selected[best] = 1;
+      metric_[best] = -2.0f;
+    }
+  }
+
+  if (cfg_->MacSchedulerPf()) {
+    const float alpha = 1.0f / static_cast<float>(cfg_->PfWindowFrames());
+    for (size_t ue = 0; ue < num_ues; ue++) {
+      avg_rate_[ue] = ((1.0f - alpha) * avg_rate_[ue]) +
+                      (alpha * rate_[ue] * static_cast<float>(selected[ue]));
+      avg_rate_[ue] = std::max(avg_rate_[ue], kInitAvgRate);
+    }
+  }
+
+  for (size_t ue = 0; ue < num_ues; ue++) {
+    if (selected[ue] != 0) {
+      next_turn_[ue] = frame_id + 1;
+    }
+  }
+
+  // Published to the workers through the task queues, which the frame's
+  // tasks go through after this, and to the workers that read it ahead of
+  // them through published_
+  ScheduleSnapshot& snapshot = rows_[frame_id % rows_.size()];
+  std::atomic<size_t>& published = published_[frame_id % rows_.size()];
+  published.store(SIZE_MAX, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  snapshot.epoch_ = epoch_;
+  snapshot.frame_id_ = frame_id;
+  WriteSchedule(snapshot, selected);
+  std::copy_n(ul_mcs_.begin(), num_ues, snapshot.ul_mcs_.begin());
+  std::copy_n(dl_mcs_.begin(), num_ues, snapshot.dl_mcs_.begin());
+  snapshot.phy_ul_mcs_ = base_ul_mcs_;
+  WriteAllocation(snapshot);
+  published.store(frame_id, std::memory_order_release);
+}
+
+void MacScheduler::WriteSchedule(ScheduleSnapshot& snapshot,
+                                 const std::array<uint8_t, kMaxUEs>& selected) {
+  // for now all SCs are allocated to scheduled UEs, in increasing UE order
+  size_t stream = 0;
+  for (size_t ue = 0; ue < cfg_->UeAntNum(); ue++) {
+    snapshot.ue_map_[ue] = selected[ue];
+    if (selected[ue] != 0) {
+      snapshot.ue_list_[stream] = ue;
+      stream++;
+    }
+  }
+}
+
+void MacScheduler::WriteAllocation(ScheduleSnapshot& snapshot) {
+  const McsParams& mcs = cfg_->Mcs(Direction::kUplink, snapshot.phy_ul_mcs_);
+  const size_t num_cbs = mcs.ldpc_config_.NumBlocksInSymbol();
+  size_t max_ul_cbs = 0;
+  float max_dl_load = 0.0f;
+  snapshot.ul_num_cbs_.fill(0);
+  for (size_t ue = 0; ue < cfg_->UeAntNum(); ue++) {
+    if (snapshot.ue_map_[ue] == 0) {
+      continue;
+    }
+    const auto ue_cbs = std::min(
+        num_cbs, static_cast<size_t>(
+                     std::ceil(ul_load_[ue] * static_cast<float>(num_cbs))));
+    snapshot.ul_num_cbs_[ue] = ue_cbs;
+    max_ul_cbs = std::max(max_ul_cbs, ue_cbs);
+    max_dl_load = std::max(max_dl_load, dl_load_[ue]);
+  }
+
+  const size_t ofdm_data_num = cfg_->OfdmDataNum();
+  if (max_ul_cbs == num_cbs) {
+    // Including the subcarriers after the last code block, as without load
+    snapshot.ul_num_sc_ = ofdm_data_num;
+  } else {
+    // The subcarriers of the LLRs of the granted code blocks
+    const size_t num_llrs = max_ul_cbs * mcs.ldpc_config_.NumCbCodewLen();
+    snapshot.ul_num_sc_ = WholePrbs(
+        (num_llrs + mcs.mod_order_bits_ - 1) / mcs.mod_order_bits_,
+        ofdm_data_num);
+  }
+  snapshot.dl_num_sc_ = WholePrbs(
+      static_cast<size_t>(
+          std::ceil(max_dl_load * static_cast<float>(ofdm_data_num))),
+      ofdm_data_num);
 }
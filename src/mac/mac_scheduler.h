@@ -5,13 +5,71 @@
 #ifndef MAC_SCHEDULER_H_
 #define MAC_SCHEDULER_H_
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "config.h"
+#include "ran_config.h"
+#include "symbols.h"
+#include "ue_grouping.h"
+
+/**
+ * @brief The schedule of one frame, written once before any task of the
+ * frame runs and only read afterwards. The scheduled UEs share the allocated
+ * subcarriers, which start at the first data subcarrier.
+ */
+struct alignas(64) ScheduleSnapshot {
+  // RAN config epoch of the frame, see MacScheduler::UpdateRanConfig()
+  size_t epoch_;
+  size_t frame_id_;
+  // ue_list_[i] is the UE of spatial stream i, in increasing UE order
+  std::array<size_t, kMaxUEs> ue_list_;
+  // ue_map_[i] is 1 if UE i is scheduled, 0 otherwise
+  std::array<size_t, kMaxUEs> ue_map_;
+  std::array<size_t, kMaxUEs> ul_mcs_;
+  std::array<size_t, kMaxUEs> dl_mcs_;
+  // Uplink MCS of the frame's RAN config, which the PHY decodes every UE
+  // with. ul_mcs_ is the per-UE choice of the MAC.
+  size_t phy_ul_mcs_;
+  // ul_num_cbs_[i] is the number of uplink code blocks per data symbol
+  // granted to UE i, 0 if UE i has no grant. Decode skips the others.
+  std::array<size_t, kMaxUEs> ul_num_cbs_;
+  // Data subcarriers allocated in each direction, in whole PRBs from data
+  // subcarrier 0. The uplink ones hold the granted code blocks. Demul and
+  // precode skip the others, and the IFFT sends a downlink data symbol with
+  // no subcarrier as zeros.
+  size_t ul_num_sc_;
+  size_t dl_num_sc_;
+};
 
 class MacScheduler {
  public:
-  explicit MacScheduler(Config* const cfg);
+  /**
+   * @param per_frame Keep a schedule per frame in the frame window, computed
+   * by ScheduleFrame(), as the base station does. The client keeps the
+   * static round-robin schedule, which it can compute on its own.
+   */
+  explicit MacScheduler(Config* const cfg, bool per_frame = false);
   ~MacScheduler();
 
+  /// The schedule of a frame. Does not allocate, safe to call from the
+  /// workers.
+  inline const ScheduleSnapshot& Schedule(size_t frame_id) const {
+    return rows_[frame_id % rows_.size()];
+  }
+  /// True if the row of frame_id holds its complete schedule. The tasks of
+  /// a frame see its schedule through the task queues; a worker that reads
+  /// it ahead of them calls this before reading the row, and again after.
+  inline bool Published(size_t frame_id) const {
+    return (per_frame_ == false) ||
+           (published_[frame_id % rows_.size()].load(
+                std::memory_order_acquire) == frame_id);
+  }
+
+  // Views of Schedule(), for the callers that need armadillo vectors. The
+  // subcarrier is not used, every subcarrier has the same schedule.
   bool IsUeScheduled(size_t frame_id, size_t sc_id, size_t ue_id);
   size_t ScheduledUeIndex(size_t frame_id, size_t sc_id, size_t sched_ue_id);
   arma::uvec ScheduledUeList(size_t frame_id, size_t sc_id);
@@ -19,13 +77,78 @@ class MacScheduler {
   size_t ScheduledUeUlMcs(size_t frame_id, size_t ue_id);
   size_t ScheduledUeDlMcs(size_t frame_id, size_t ue_id);
 
+  /// True if the scheduled UEs change every frame: the round robin over
+  /// fewer spatial streams than UEs, with or without ue_grouping
+  inline bool RotatesGroups() const { return this->rotates_groups_; }
+
+  /// Compute the UEs and MCS of every frame up to frame_id that is not
+  /// scheduled yet. Master thread only, before any task of the frame reads
+  /// its schedule. Does not allocate.
+  void ScheduleFrame(size_t frame_id);
+  /// Apply the uplink MCS of a RAN config update from rc.frame_id_ on. The
+  /// frames already scheduled keep their MCS, so a frame never sees a mix of
+  /// the two. Starts a new epoch if the MCS changes.
+  void UpdateRanConfig(const RanConfig& rc);
+  /// Fraction of the data subcarriers of a frame that a UE has traffic for
+  /// in each direction, from the next frame scheduled on. Master thread
+  /// only. Starts at ul_offered_load and dl_offered_load.
+  void SetOfferedLoad(size_t ue_id, float ul_load, float dl_load);
+  /// The correlation of the UE channels that groups the UEs of each frame,
+  /// nullptr if the groups do not follow the channels. The beam workers
+  /// update it from the CSI.
+  inline UeGrouping* Grouping() { return this->grouping_.get(); }
+
  private:
+  static constexpr size_t kNumMcs = Config::kNumMcs;
+
+  // Schedule the UEs flagged in selected in a snapshot
+  void WriteSchedule(ScheduleSnapshot& snapshot,
+                     const std::array<uint8_t, kMaxUEs>& selected);
+  // Grant the scheduled UEs of a snapshot their offered load, with the code
+  // blocks of its phy_ul_mcs_
+  void WriteAllocation(ScheduleSnapshot& snapshot);
+  // Schedule one frame in its row
+  void ScheduleOneFrame(size_t frame_id);
+
   size_t num_groups_;
-  Table<int> schedule_buffer_;
-  Table<size_t> schedule_buffer_index_;
-  Table<size_t> ul_mcs_buffer_;
-  Table<size_t> dl_mcs_buffer_;
+  const bool per_frame_;
+  bool rotates_groups_;
+  size_t next_frame_id_;  // The first frame not scheduled yet
+  // A frame uses row (frame_id % rows_.size()): num_groups_ rows for the
+  // static schedule, the frame window otherwise
+  std::vector<ScheduleSnapshot> rows_;
+  // The frame each row of the per-frame schedule holds, SIZE_MAX while the
+  // row is written
+  std::unique_ptr<std::atomic<size_t>[]> published_;
   Config* const cfg_;
+
+  // The last RAN config update: its epoch, uplink MCS and first frame
+  size_t ran_epoch_;
+  size_t ran_ul_mcs_;
+  size_t ran_frame_id_;
+  // The RAN config of the frames being scheduled
+  size_t epoch_;
+  size_t base_ul_mcs_;
+
+  // Per-UE state of the proportional fair schedule, as float lanes over the
+  // UEs: the spectral efficiency of the UE at its MCS, and its average over
+  // the frames it was scheduled in (0 when not scheduled)
+  alignas(64) std::array<float, kMaxUEs> rate_;
+  alignas(64) std::array<float, kMaxUEs> avg_rate_;
+  alignas(64) std::array<float, kMaxUEs> metric_;
+  std::array<size_t, kMaxUEs> ul_mcs_;
+  std::array<size_t, kMaxUEs> dl_mcs_;
+  // Offered load of each UE, see SetOfferedLoad()
+  std::array<float, kMaxUEs> ul_load_;
+  std::array<float, kMaxUEs> dl_load_;
+  // Channel-aware groups, see Config::UeGroupingEnabled()
+  std::unique_ptr<UeGrouping> grouping_;
+  // The frame after the last one each UE was scheduled in, for the priority
+  // of the round-robin groups of grouping_
+  std::array<size_t, kMaxUEs> next_turn_;
+
+  // Bits per subcarrier of each MCS
+  std::array<float, kNumMcs> mcs_rate_;
 };
 
 #endif  // MAC_SCHEDULER_H_
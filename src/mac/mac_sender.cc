@@ -61,7 +61,7 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
                      size_t core_offset, size_t worker_thread_num,
                      size_t update_thread_num, size_t frame_duration_us,
                      size_t inter_frame_delay, size_t enable_slow_start,
-                     bool create_thread_for_master)
+                     bool create_thread_for_master, bool map_data_file)
     : cfg_(cfg),
       freq_ghz_(GetTime::MeasureRdtscFreq()),
       ticks_per_usec_(freq_ghz_ * 1e3f),
@@ -80,7 +80,8 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
       server_rx_port_(server_rx_port),
       get_data_symbol_id_(std::move(get_data_symbol_id)),
       // end -- Ul / Dl     UE / BS
-      has_master_thread_(create_thread_for_master) {
+      has_master_thread_(create_thread_for_master),
+      map_data_file_(map_data_file) {
   if (frame_duration_us == 0) {
     frame_duration_us_ =
         (cfg->Frame().NumTotalSyms() * cfg->SampsPerSymbol() * 1000000ul) /
@@ -110,6 +111,7 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
   // tx buffers will be an array of
   tx_buffers_.Malloc(kFrameWnd * cfg_->UeAntNum(), tx_packet_storage,
                      Agora_memory::Alignment_t::kAlign64);
+  tx_payloads_.resize(kFrameWnd * cfg_->UeAntNum() * packets_per_frame_);
   AGORA_LOG_TRACE(
       "Tx buffer size: dim1 %zu, dim2 %zu, total %zu, start %zu, end: %zu\n",
       (kFrameWnd * cfg_->UeAntNum()), tx_packet_storage,
@@ -119,9 +121,9 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
 
   AGORA_LOG_INFO(
       "Initializing MacSender, sending to mac thread at %s:%zu, frame "
-      "duration = %.2f ms, slow start = %s\n",
+      "duration = %.2f ms, slow start = %s, mapped data file = %s\n",
       server_address_.c_str(), server_rx_port_, frame_duration_us_ / 1000.0,
-      enable_slow_start == 1 ? "yes" : "no");
+      enable_slow_start == 1 ? "yes" : "no", map_data_file_ ? "yes" : "no");
 
   task_ptok_ =
       static_cast<moodycamel::ProducerToken**>(Agora_memory::PaddedAlignedAlloc(
@@ -137,6 +139,19 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
   // Add the data update thread (background data reader), need to add a variable
   // for the update source number
   static constexpr size_t kUpdateSourcePerThread = 1;
+  for (size_t source = 0; source < update_thread_num_ * kUpdateSourcePerThread;
+       source++) {
+#if defined(USE_UDP_DATA_SOURCE)
+    // Assumes that the sources are spread evenly between threads
+    data_sources_.emplace_back(std::make_unique<VideoReceiver>(
+        VideoReceiver::kVideoStreamRxPort + source));
+#else
+    ///\todo need a list of file names for this
+    data_sources_.emplace_back(
+        std::make_unique<FileReceiver>(data_filename_, map_data_file_));
+#endif
+  }
+
   for (size_t update_threads = 0; update_threads < update_thread_num_;
        update_threads++) {
     data_update_queue_.emplace_back(
@@ -352,6 +367,11 @@ void* MacSender::WorkerThread(size_t tid) {
       "MacSender[%zu]: processing work for antennas %zu:%zu total: %zu:%zu\n",
       tid, ue_ant_low, ue_ant_high, ant_this_thread, cfg_->UeAntNum());
 
+  // Header and payload of each packet of a frame
+  static constexpr size_t kIovsPerPacket = 2;
+  const size_t mac_header_length = mac_packet_length_ - mac_payload_max_length_;
+  std::vector<::iovec> tx_iovs(packets_per_frame_ * kIovsPerPacket);
+
   std::array<size_t, kDequeueBulkSize> tags;
   while (keep_running.load() == true) {
     size_t num_tags = this->send_queue_.try_dequeue_bulk_from_producer(
@@ -366,31 +386,34 @@ void* MacSender::WorkerThread(size_t tid) {
           AGORA_LOG_INFO("MacSender[%zu] : worker processing frame %d : %d \n",
                          tid, tag.frame_id_, tag.ant_id_);
         }
-        const uint8_t* mac_packet_location =
-            tx_buffers_[TagToTxBuffersIndex(tag)];
+        const size_t buffer_id = TagToTxBuffersIndex(tag);
+        const uint8_t* mac_packet_location = tx_buffers_[buffer_id];
 
-        // Send the mac data to the data sinc
+        // Send the mac data to the data sinc, each packet gathered from its
+        // header and its payload, with one sendmmsg() per frame
         for (size_t packet = 0; packet < packets_per_frame_; packet++) {
           ///\todo Use assume_aligned<kTxBufferElementAlignment> when code has
           /// c++20 support
           const auto* tx_packet =
               reinterpret_cast<const MacPacketPacked*>(mac_packet_location);
 
-          const size_t mac_packet_tx_size =
-              mac_packet_length_ -
-              (mac_payload_max_length_ - tx_packet->PayloadLength());
-
           AGORA_LOG_TRACE(
               "MacSender[%zu] sending frame %d:%d, packet %zu, symbol %d, size "
               "%zu\n",
               tid, tx_packet->Frame(), tag.frame_id_, packet,
-              tx_packet->Symbol(), mac_packet_tx_size);
-
-          udp_client.Send(server_address_, server_rx_port_,
-                          reinterpret_cast<const std::byte*>(tx_packet),
-                          mac_packet_tx_size);
+              tx_packet->Symbol(),
+              mac_header_length + tx_packet->PayloadLength());
+
+          ::iovec* iovs = &tx_iovs.at(packet * kIovsPerPacket);
+          iovs[0].iov_base = const_cast<MacPacketPacked*>(tx_packet);
+          iovs[0].iov_len = mac_header_length;
+          iovs[1].iov_base = const_cast<unsigned char*>(
+              tx_payloads_.at((buffer_id * packets_per_frame_) + packet));
+          iovs[1].iov_len = tx_packet->PayloadLength();
           mac_packet_location += tx_buffer_pkt_offset_;
         }
+        udp_client.SendBatch(server_address_, server_rx_port_, tx_iovs.data(),
+                             kIovsPerPacket, packets_per_frame_);
 
         if (kDebugSenderReceiver) {
           AGORA_LOG_INFO(
@@ -470,23 +493,8 @@ void* MacSender::DataUpdateThread(size_t tid, size_t num_data_sources) {
       "%zu:%zu data\n",
       tid, sched_getcpu(), ue_ant_low, ue_ant_high);
 
-#if defined(USE_UDP_DATA_SOURCE)
-  std::vector<std::unique_ptr<VideoReceiver>> sources;
-#else
-  ///\todo need a list of file names for this
-  std::vector<std::unique_ptr<FileReceiver>> sources;
-#endif
-
-  for (size_t source = 0; source < num_data_sources; source++) {
-#if defined(USE_UDP_DATA_SOURCE)
-    // Assumes that the num_data_sources are spread evenly between threads
-    sources.emplace_back(std::make_unique<VideoReceiver>(
-        VideoReceiver::kVideoStreamRxPort + (tid * num_data_sources) + source));
-#else
-    ///\todo need a list of file names for this
-    sources.emplace_back(std::make_unique<FileReceiver>(data_filename_));
-#endif
-  }
+  // The sources of this thread
+  const size_t first_source = tid * num_data_sources;
 
   // Init the data buffers
   while ((keep_running.load() == true) && (buffer_updates < kBufferInit)) {
@@ -496,7 +504,8 @@ void* MacSender::DataUpdateThread(size_t tid, size_t num_data_sources) {
         auto tag_for_ue = gen_tag_t::FrmSymUe(((gen_tag_t)tag).frame_id_,
                                               ((gen_tag_t)tag).symbol_id_, i);
         size_t ant_source = i % num_data_sources;
-        UpdateTxBuffer(sources.at(ant_source).get(), tag_for_ue);
+        UpdateTxBuffer(data_sources_.at(first_source + ant_source).get(),
+                       tag_for_ue);
       }
       buffer_updates++;
     }
@@ -513,7 +522,8 @@ void* MacSender::DataUpdateThread(size_t tid, size_t num_data_sources) {
         auto tag_for_ue = gen_tag_t::FrmSymUe(((gen_tag_t)tag).frame_id_,
                                               ((gen_tag_t)tag).symbol_id_, i);
         size_t ant_source = i % num_data_sources;
-        UpdateTxBuffer(sources.at(ant_source).get(), tag_for_ue);
+        UpdateTxBuffer(data_sources_.at(first_source + ant_source).get(),
+                       tag_for_ue);
       }
     }
   }
@@ -522,13 +532,21 @@ void* MacSender::DataUpdateThread(size_t tid, size_t num_data_sources) {
 
 void MacSender::UpdateTxBuffer(MacDataReceiver* data_source, gen_tag_t tag) {
   // Load a frames worth of data
-  uint8_t* mac_packet_location = tx_buffers_[TagToTxBuffersIndex(tag)];
+  const size_t buffer_id = TagToTxBuffersIndex(tag);
+  uint8_t* mac_packet_location = tx_buffers_[buffer_id];
+  const unsigned char** payloads =
+      &tx_payloads_.at(buffer_id * packets_per_frame_);
 
   for (size_t i = 0; i < packets_per_frame_; i++) {
     auto* pkt = reinterpret_cast<MacPacketPacked*>(mac_packet_location);
-    // Read a MacPayload into the data section
-    size_t loaded_bytes =
-        data_source->Load(pkt->DataPtr(), mac_payload_max_length_);
+    // Take the MacPayload in place from a mapped source, otherwise read it
+    // into the data section
+    size_t loaded_bytes = 0;
+    payloads[i] = data_source->Map(mac_payload_max_length_, loaded_bytes);
+    if (payloads[i] == nullptr) {
+      loaded_bytes = data_source->Load(pkt->DataPtr(), mac_payload_max_length_);
+      payloads[i] = pkt->DataPtr();
+    }
 
     pkt->Set(tag.frame_id_, get_data_symbol_id_(i), tag.ue_id_, loaded_bytes);
 
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <thread>
 #include <vector>
 
@@ -42,6 +43,10 @@ class MacSender {
    *
    * @param enable_slow_start If 1, the sender initially sends frames in a
    * duration larger than the TTI
+   *
+   * @param map_data_file If true, the data file is memory-mapped and the
+   * payloads are sent from it in place instead of being copied to the frame
+   * buffers
    */
   MacSender(Config* cfg, std::string& data_filename, size_t mac_packet_length,
             size_t mac_payload_max_length, size_t packets_per_frame,
@@ -50,7 +55,8 @@ class MacSender {
             size_t core_offset = 30, size_t worker_thread_num = 1,
             size_t update_thread_num = 1, size_t frame_duration_us = 0,
             size_t inter_frame_delay = 0, size_t enable_slow_start = 1,
-            bool create_thread_for_master = false);
+            bool create_thread_for_master = false,
+            bool map_data_file = false);
   ~MacSender();
 
   void StartTx();
@@ -119,6 +125,13 @@ class MacSender {
 
   Table<uint8_t> tx_buffers_;
   size_t tx_buffer_pkt_offset_;
+  // Payload of each packet of tx_buffers_, either in the packet or in place
+  // in a mapped data source. Packet p of tx_buffers_[i] is at
+  // [i * packets_per_frame_ + p].
+  std::vector<const unsigned char*> tx_payloads_;
+  // The sources of the data update threads, kept until the workers stop
+  // sending from them
+  std::vector<std::unique_ptr<MacDataReceiver>> data_sources_;
   std::string data_filename_;
 
   size_t mac_packet_length_;
@@ -128,6 +141,7 @@ class MacSender {
   const size_t server_rx_port_;
   std::function<size_t(size_t)> get_data_symbol_id_;
   const bool has_master_thread_;
+  const bool map_data_file_;
 };
 
 #endif  // MAC_SENDER_H_
@@ -4,25 +4,28 @@
  */
 #include "mac_thread_basestation.h"
 
+#include <algorithm>
+
 #include "logger.h"
 #include "utils_ldpc.h"
 
-static constexpr size_t kUdpRxBufferPadding = 2048u;
-
 MacThreadBaseStation::MacThreadBaseStation(
     Config* cfg, size_t core_offset,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffer,
     Table<int8_t>* dl_bits_buffer, Table<int8_t>* dl_bits_buffer_status,
     moodycamel::ConcurrentQueue<EventData>* rx_queue,
     moodycamel::ConcurrentQueue<EventData>* tx_queue,
-    const std::string& log_filename)
+    const std::string& log_filename, MacPhyRing* tb_ring,
+    MacPhyRing* tb_done_ring)
     : cfg_(cfg),
       freq_ghz_(GetTime::MeasureRdtscFreq()),
       tsc_delta_((cfg_->GetFrameDurationSec() * 1e9) / freq_ghz_),
       core_offset_(core_offset),
       decoded_buffer_(decoded_buffer),
       rx_queue_(rx_queue),
-      tx_queue_(tx_queue) {
+      tx_queue_(tx_queue),
+      tb_ring_(tb_ring),
+      tb_done_ring_(tb_done_ring) {
   // Set up MAC log file
   if (log_filename.empty() == false) {
     log_filename_ = log_filename;  // Use a non-default log filename
@@ -38,10 +41,19 @@ MacThreadBaseStation::MacThreadBaseStation(
 
   // Set up buffers
   client_.dl_bits_buffer_id_.fill(0);
+  client_.dl_pkts_filled_.fill(0);
+  client_.dl_dropping_frame_.fill(false);
+  client_.dl_frames_sent_.fill(0);
+  client_.dl_frames_dropped_.fill(0);
+  client_.dl_queue_depth_sum_.fill(0);
+  client_.dl_queue_depth_max_.fill(0);
   client_.dl_bits_buffer_ = dl_bits_buffer;
   client_.dl_bits_buffer_status_ = dl_bits_buffer_status;
 
-  server_.n_filled_in_frame_.fill(0);
+  for (auto& n_filled : server_.n_filled_in_mini_slot_) {
+    n_filled.assign(cfg_->UlMiniSlots(), 0);
+  }
+  server_.tx_pending_.fill(false);
   for (size_t ue_ant = 0; ue_ant < cfg_->UeAntTotal(); ue_ant++) {
     server_.data_size_.emplace_back(
         std::vector<size_t>(cfg->Frame().NumUlDataSyms()));
@@ -54,7 +66,8 @@ MacThreadBaseStation::MacThreadBaseStation(
 
   const size_t udp_pkt_len =
       cfg_->MacDataBytesNumPerframe(Direction::kDownlink);
-  udp_pkt_buf_.resize(udp_pkt_len + kUdpRxBufferPadding);
+  udp_pkt_buf_.resize(kUdpRxBatchSize *
+                      cfg_->MacPacketLength(Direction::kDownlink));
 
   // TODO: See if it makes more sense to split up the UE's by port here for
   // client mode.
@@ -69,23 +82,52 @@ MacThreadBaseStation::MacThreadBaseStation(
 }
 
 MacThreadBaseStation::~MacThreadBaseStation() {
+  for (size_t ue_id = 0; ue_id < cfg_->UeAntNum(); ue_id++) {
+    if ((client_.dl_frames_sent_[ue_id] + client_.dl_frames_dropped_[ue_id]) ==
+        0) {
+      continue;
+    }
+    AGORA_LOG_INFO(
+        "MacThreadBaseStation: UE %zu downlink frames sent %zu, dropped %zu, "
+        "queue depth avg %.2f max %zu\n",
+        ue_id, client_.dl_frames_sent_[ue_id],
+        client_.dl_frames_dropped_[ue_id],
+        (client_.dl_frames_sent_[ue_id] == 0)
+            ? 0.0
+            : static_cast<double>(client_.dl_queue_depth_sum_[ue_id]) /
+                  client_.dl_frames_sent_[ue_id],
+        client_.dl_queue_depth_max_[ue_id]);
+  }
+  if (server_.udp_batches_ > 0) {
+    AGORA_LOG_INFO(
+        "MacThreadBaseStation: Sent %zu uplink frames in %zu batches\n",
+        server_.udp_frames_, server_.udp_batches_);
+  }
+  if (client_.udp_batches_ > 0) {
+    AGORA_LOG_INFO(
+        "MacThreadBaseStation: Received %zu downlink packets in %zu batches\n",
+        client_.udp_packets_, client_.udp_batches_);
+  }
   std::fclose(log_file_);
   AGORA_LOG_INFO("MacThreadBaseStation: MAC thread destroyed\n");
 }
 
 void MacThreadBaseStation::ProcessRxFromPhy() {
-  EventData event;
-  if (rx_queue_->try_dequeue(event) == false) {
-    return;
-  }
-
-  if (event.event_type_ == EventType::kPacketToMac) {
-    AGORA_LOG_TRACE("MacThreadBaseStation: MAC thread event kPacketToMac\n");
-    ProcessCodeblocksFromPhy(event);
-  } else if (event.event_type_ == EventType::kSNRReport) {
-    AGORA_LOG_TRACE("MacThreadBaseStation: MAC thread event kSNRReport\n");
-    ProcessSnrReportFromPhy(event);
+  std::array<EventData, kPhyRxBatchSize> events;
+  const size_t num_events =
+      rx_queue_->try_dequeue_bulk(events.begin(), kPhyRxBatchSize);
+
+  for (size_t i = 0; i < num_events; i++) {
+    const EventData& event = events[i];
+    if (event.event_type_ == EventType::kPacketToMac) {
+      AGORA_LOG_TRACE("MacThreadBaseStation: MAC thread event kPacketToMac\n");
+      ProcessCodeblocksFromPhy(event);
+    } else if (event.event_type_ == EventType::kSNRReport) {
+      AGORA_LOG_TRACE("MacThreadBaseStation: MAC thread event kSNRReport\n");
+      ProcessSnrReportFromPhy(event);
+    }
   }
+  SendFramesToApps();
 }
 
 void MacThreadBaseStation::ProcessSnrReportFromPhy(EventData event) {
@@ -122,101 +164,139 @@ void MacThreadBaseStation::SendRanConfigUpdate(EventData /*event*/) {
 void MacThreadBaseStation::ProcessCodeblocksFromPhy(EventData event) {
   assert(event.event_type_ == EventType::kPacketToMac);
 
-  const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-  const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-  const size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
+  ProcessCodeblock(gen_tag_t(event.tags_[0]).frame_id_,
+                   gen_tag_t(event.tags_[0]).symbol_id_,
+                   gen_tag_t(event.tags_[0]).ue_id_);
+
+  RtAssert(
+      tx_queue_->enqueue(EventData(EventType::kPacketToMac, event.tags_[0])),
+      "Socket message enqueue failed\n");
+}
+
+void MacThreadBaseStation::ProcessTransportBlocksFromPhy() {
+  MacTbDescriptor tb;
+  while (tb_ring_->TryPop(tb)) {
+    // The data symbols of the transport block are in place in the decoded
+    // buffer slot of the frame
+    for (size_t i = 0; i < cfg_->Frame().NumULSyms(); i++) {
+      ProcessCodeblock(tb.frame_id_, cfg_->Frame().GetULSymbol(i), tb.ue_id_);
+    }
+    // The master thread drains the ring every loop, so it is never full for
+    // long
+    while (tb_done_ring_->TryPush(tb) == false) {
+      if (cfg_->Running() == false) {
+        return;
+      }
+    }
+  }
+  SendFramesToApps();
+}
+
+void MacThreadBaseStation::ProcessCodeblock(size_t frame_id, size_t symbol_id,
+                                            size_t ue_id) {
   // Helper variables (changes with bs / user)
   const size_t num_pilot_symbols = cfg_->Frame().ClientUlPilotSymbols();
   const size_t symbol_array_index = cfg_->Frame().GetULSymbolIdx(symbol_id);
   const size_t data_symbol_index_start =
       cfg_->Frame().GetULSymbol(num_pilot_symbols);
   const size_t data_symbol_index_end = cfg_->Frame().GetULSymbolLast();
-  const size_t mac_data_bytes_per_frame =
-      cfg_->MacDataBytesNumPerframe(Direction::kUplink);
-  const size_t num_mac_packets_per_frame =
-      cfg_->MacPacketsPerframe(Direction::kUplink);
   const size_t mac_payload_max_length =
       cfg_->MacPayloadMaxLength(Direction::kUplink);
-  const int8_t* src_data =
-      decoded_buffer_[(frame_id % kFrameWnd)][symbol_array_index][ue_id];
+  const int8_t* src_data = decoded_buffer_[(frame_id % cfg_->FrameWindow())]
+                                          [symbol_array_index][ue_id];
 
   std::stringstream ss;  // Debug formatting
 
-  // Only non-pilot data symbols have application data.
-  if (symbol_array_index >= num_pilot_symbols) {
-    // The decoded symbol knows nothing about the padding / storage of the data
-    const auto* pkt = reinterpret_cast<const MacPacketPacked*>(src_data);
-    // Destination only contains "payload"
-    const size_t dest_packet_size = mac_payload_max_length;
-
-    // TODO: enable ARQ and ensure reliable data goes to app
-    const size_t frame_data_offset =
-        (symbol_array_index - num_pilot_symbols) * dest_packet_size;
-
-    // Who's junk is better? No reason to copy currupted data
-    server_.n_filled_in_frame_.at(ue_id) += dest_packet_size;
+  // The previous mini-slot of the UE is still waiting in frame_data_
+  if (server_.tx_pending_.at(ue_id)) {
+    SendFramesToApps();
+  }
 
-    ss << "MacThreadBasestation: Received frame " << pkt->Frame() << ":"
-       << frame_id << " symbol " << pkt->Symbol() << ":" << symbol_id
-       << " user " << pkt->Ue() << ":" << ue_id << " length "
-       << pkt->PayloadLength() << ":" << dest_packet_size << " crc "
-       << pkt->Crc() << " copied to offset " << frame_data_offset << std::endl;
+  // Only non-pilot data symbols have application data.
+  if (symbol_array_index < num_pilot_symbols) {
+    return;
+  }
+  const size_t mini_slot =
+      cfg_->UlMiniSlot(symbol_array_index - num_pilot_symbols);
+  // The decoded symbol knows nothing about the padding / storage of the data
+  const auto* pkt = reinterpret_cast<const MacPacketPacked*>(src_data);
+  // Destination only contains "payload"
+  const size_t dest_packet_size = mac_payload_max_length;
+
+  // TODO: enable ARQ and ensure reliable data goes to app
+  const size_t frame_data_offset =
+      (symbol_array_index - num_pilot_symbols) * dest_packet_size;
+
+  // Who's junk is better? No reason to copy currupted data
+  server_.n_filled_in_mini_slot_.at(ue_id).at(mini_slot) += dest_packet_size;
+
+  ss << "MacThreadBasestation: Received frame " << pkt->Frame() << ":"
+     << frame_id << " symbol " << pkt->Symbol() << ":" << symbol_id
+     << " user " << pkt->Ue() << ":" << ue_id << " length "
+     << pkt->PayloadLength() << ":" << dest_packet_size << " crc "
+     << pkt->Crc() << " copied to offset " << frame_data_offset << std::endl;
 
-    if (kLogMacPackets) {
-      ss << "Header Info:" << std::endl
-         << "FRAME_ID: " << pkt->Frame() << std::endl
-         << "SYMBOL_ID: " << pkt->Symbol() << std::endl
-         << "UE_ID: " << pkt->Ue() << std::endl
-         << "DATLEN: " << pkt->PayloadLength() << std::endl
-         << "PAYLOAD:" << std::endl;
-      for (size_t i = 0; i < dest_packet_size; i++) {
-        ss << std::to_string(pkt->Data()[i]) << " ";
-      }
-      ss << std::endl;
+  if (kLogMacPackets) {
+    ss << "Header Info:" << std::endl
+       << "FRAME_ID: " << pkt->Frame() << std::endl
+       << "SYMBOL_ID: " << pkt->Symbol() << std::endl
+       << "UE_ID: " << pkt->Ue() << std::endl
+       << "DATLEN: " << pkt->PayloadLength() << std::endl
+       << "PAYLOAD:" << std::endl;
+    for (size_t i = 0; i < dest_packet_size; i++) {
+      ss << std::to_string(pkt->Data()[i]) << " ";
     }
+    ss << std::endl;
+  }
 
-    bool data_valid = false;
-    // Data validity check
-    if ((static_cast<size_t>(pkt->PayloadLength()) <= dest_packet_size) &&
-        ((pkt->Symbol() >= data_symbol_index_start) &&
-         (pkt->Symbol() <= data_symbol_index_end)) &&
-        (pkt->Ue() <= cfg_->UeAntNum())) {
-      auto crc = static_cast<uint16_t>(
-          crc_obj_->CalculateCrc24(pkt->Data(), pkt->PayloadLength()) & 0xFFFF);
+  bool data_valid = false;
+  // Data validity check
+  if ((static_cast<size_t>(pkt->PayloadLength()) <= dest_packet_size) &&
+      ((pkt->Symbol() >= data_symbol_index_start) &&
+       (pkt->Symbol() <= data_symbol_index_end)) &&
+      (pkt->Ue() <= cfg_->UeAntNum())) {
+    auto crc = static_cast<uint16_t>(
+        crc_obj_->CalculateCrc24(pkt->Data(), pkt->PayloadLength()) & 0xFFFF);
 
-      data_valid = (crc == pkt->Crc());
-    }
+    data_valid = (crc == pkt->Crc());
+  }
 
-    if (data_valid) {
-      AGORA_LOG_FRAME("%s", ss.str().c_str());
-      /// Spot to be optimized #1
-      std::memcpy(&server_.frame_data_.at(ue_id).at(frame_data_offset),
-                  pkt->Data(), pkt->PayloadLength());
+  if (data_valid) {
+    AGORA_LOG_FRAME("%s", ss.str().c_str());
+    /// Spot to be optimized #1
+    std::memcpy(&server_.frame_data_.at(ue_id).at(frame_data_offset),
+                pkt->Data(), pkt->PayloadLength());
 
-      server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
-          pkt->PayloadLength();
+    server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
+        pkt->PayloadLength();
 
-    } else {
-      ss << "  *****Failed Data integrity check - invalid parameters"
-         << std::endl;
+  } else {
+    ss << "  *****Failed Data integrity check - invalid parameters"
+       << std::endl;
 
-      AGORA_LOG_ERROR("%s", ss.str().c_str());
-      // Set the default to 0 valid data bytes
-      server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
-          0;
-    }
-    std::fprintf(log_file_, "%s", ss.str().c_str());
-    ss.str("");
+    AGORA_LOG_ERROR("%s", ss.str().c_str());
+    // Set the default to 0 valid data bytes
+    server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
+        0;
   }
-
-  // When the frame is full, send it to the application
-  if (server_.n_filled_in_frame_.at(ue_id) == mac_data_bytes_per_frame) {
-    server_.n_filled_in_frame_.at(ue_id) = 0;
+  std::fprintf(log_file_, "%s", ss.str().c_str());
+  ss.str("");
+
+  // When the mini-slot (by default the frame) is full, send it to the
+  // application
+  const size_t first_packet = mini_slot * cfg_->UlMiniSlotSymbols();
+  const size_t num_mini_slot_packets = cfg_->UlMiniSlotDataSyms(mini_slot);
+  const size_t mini_slot_bytes = num_mini_slot_packets * mac_payload_max_length;
+  if (server_.n_filled_in_mini_slot_.at(ue_id).at(mini_slot) ==
+      mini_slot_bytes) {
+    server_.n_filled_in_mini_slot_.at(ue_id).at(mini_slot) = 0;
     /// Spot to be optimized #2 -- left shift data over to remove padding
     bool shifted = false;
-    size_t src_offset = 0;
-    size_t dest_offset = 0;
-    for (size_t packet = 0; packet < num_mac_packets_per_frame; packet++) {
+    const size_t start_offset = first_packet * mac_payload_max_length;
+    size_t src_offset = start_offset;
+    size_t dest_offset = start_offset;
+    for (size_t packet = first_packet;
+         packet < first_packet + num_mini_slot_packets; packet++) {
       const size_t rx_packet_size = server_.data_size_.at(ue_id).at(packet);
       if ((rx_packet_size < mac_payload_max_length) || (shifted == true)) {
         shifted = true;
@@ -230,29 +310,48 @@ void MacThreadBaseStation::ProcessCodeblocksFromPhy(EventData event) {
       src_offset += mac_payload_max_length;
     }
 
-    if (dest_offset > 0) {
-      udp_comm_->Send(kMacRemoteHostname, cfg_->BsMacTxPort() + ue_id,
-                      &server_.frame_data_.at(ue_id).at(0), dest_offset);
+    const size_t tx_len = dest_offset - start_offset;
+    if (tx_len > 0) {
+      // The nodes of a split carrier each send their code blocks to their
+      // own block of ports of the MAC node
+      const size_t port = cfg_->BsMacTxPort() +
+                          (cfg_->ScSliceNode() * cfg_->UeAntNum()) + ue_id;
+      const size_t tx_id = server_.num_tx_frames_;
+      server_.tx_frames_.at(tx_id) =
+          &server_.frame_data_.at(ue_id).at(start_offset);
+      server_.tx_lens_.at(tx_id) = tx_len;
+      server_.tx_ports_.at(tx_id) = static_cast<uint16_t>(port);
+      server_.tx_pending_.at(ue_id) = true;
+      server_.num_tx_frames_++;
     }
 
-    ss << "MacThreadBasestation: Sent data for frame " << frame_id << ", ue "
-       << ue_id << ", size " << dest_offset << ":" << mac_data_bytes_per_frame
-       << std::endl;
+    ss << "MacThreadBasestation: Sent data for frame " << frame_id
+       << ", mini-slot " << mini_slot << ", ue " << ue_id << ", size "
+       << tx_len << ":" << mini_slot_bytes << std::endl;
 
     if (kLogMacPackets) {
       std::fprintf(stdout, "%s", ss.str().c_str());
     }
 
-    for (size_t i = 0u; i < dest_offset; i++) {
+    for (size_t i = start_offset; i < dest_offset; i++) {
       ss << static_cast<uint8_t>(server_.frame_data_.at(ue_id).at(i)) << " ";
     }
     std::fprintf(log_file_, "%s", ss.str().c_str());
     ss.str("");
   }
+}
 
-  RtAssert(
-      tx_queue_->enqueue(EventData(EventType::kPacketToMac, event.tags_[0])),
-      "Socket message enqueue failed\n");
+void MacThreadBaseStation::SendFramesToApps() {
+  if (server_.num_tx_frames_ == 0) {
+    return;
+  }
+  udp_comm_->SendBatch(kMacRemoteHostname, server_.tx_ports_.data(),
+                       server_.tx_frames_.data(), server_.tx_lens_.data(),
+                       server_.num_tx_frames_);
+  server_.udp_batches_++;
+  server_.udp_frames_ += server_.num_tx_frames_;
+  server_.num_tx_frames_ = 0;
+  server_.tx_pending_.fill(false);
 }
 
 void MacThreadBaseStation::SendControlInformation() {
@@ -268,215 +367,170 @@ void MacThreadBaseStation::SendControlInformation() {
 }
 
 void MacThreadBaseStation::ProcessUdpPacketsFromApps() {
-  const size_t max_data_bytes_per_frame =
-      cfg_->MacDataBytesNumPerframe(Direction::kDownlink);
+  const size_t mac_packet_length = cfg_->MacPacketLength(Direction::kDownlink);
   const size_t num_mac_packets_per_frame =
       cfg_->MacPacketsPerframe(Direction::kDownlink);
 
-  if (0 == max_data_bytes_per_frame) {
+  if (0 == cfg_->MacDataBytesNumPerframe(Direction::kDownlink)) {
     return;
   }
 
-  // Processes the packets of an entire frame (remove variable later)
-  const size_t packets_required = num_mac_packets_per_frame;
-
-  size_t packets_received = 0;
-  size_t current_packet_bytes = 0;
-  size_t current_packet_start_index = 0;
-  size_t total_bytes_received = 0;
-
-  const size_t max_recv_attempts = (packets_required * 10u);
-  size_t rx_attempts;
-  for (rx_attempts = 0u; rx_attempts < max_recv_attempts; rx_attempts++) {
-    const ssize_t ret =
-        udp_comm_->Recv(&udp_pkt_buf_.at(total_bytes_received),
-                        (udp_pkt_buf_.size() - total_bytes_received));
-    if (ret == 0) {
-      AGORA_LOG_TRACE(
-          "MacThreadBaseStation: No data received with %zu pending\n",
-          total_bytes_received);
-      if (total_bytes_received == 0) {
-        return;  // No data received
-      } else {
-        AGORA_LOG_INFO(
-            "MacThreadBaseStation: No data received but there was data in "
-            "buffer pending %zu : try %zu out of %zu\n",
-            total_bytes_received, rx_attempts, max_recv_attempts);
-      }
-    } else if (ret < 0) {
-      // There was an error in receiving
-      AGORA_LOG_ERROR("MacThreadBaseStation: Error in reception %zu\n", ret);
-      cfg_->Running(false);
-      return;
-    } else { /* Got some data */
-      total_bytes_received += ret;
-      current_packet_bytes += ret;
-
-      // std::printf(
-      //    "Received %zu bytes packet number %zu packet size %zu total %zu\n",
-      //    ret, packets_received, total_bytes_received, current_packet_bytes);
-
-      // While we have packets remaining and a header to process
-      const size_t header_size = sizeof(MacPacketHeaderPacked);
-      while ((packets_received < packets_required) &&
-             (current_packet_bytes >= header_size)) {
-        // See if we have enough data and process the MacPacket header
-        const auto* rx_mac_packet_header =
-            reinterpret_cast<const MacPacketPacked*>(
-                &udp_pkt_buf_.at(current_packet_start_index));
-
-        const size_t current_packet_size =
-            header_size + rx_mac_packet_header->PayloadLength();
-
-        // std::printf("Packet number %zu @ %zu packet size %d:%zu total %zu\n",
-        //            packets_received, current_packet_start_index,
-        //            rx_mac_packet_header->datalen_, current_packet_size,
-        //            current_packet_bytes);
-
-        if (current_packet_bytes >= current_packet_size) {
-          current_packet_bytes = current_packet_bytes - current_packet_size;
-          current_packet_start_index =
-              current_packet_start_index + current_packet_size;
-          packets_received++;
-        } else {
-          // Don't have the entire packet, keep trying
-          break;
-        }
-      }
-      AGORA_LOG_FRAME(
-          "MacThreadBaseStation: Received %zu : %zu bytes in packet %zu : "
-          "%zu\n",
-          ret, total_bytes_received, packets_received, packets_required);
+  // Aim the batch at the slots the next packets should land in: the rest of
+  // the frame of each UE, in the order mac_sender sends them. Packets past
+  // those, or of a frame being dropped, land in udp_pkt_buf_.
+  std::array<std::byte*, kUdpRxBatchSize> bufs;
+  std::array<size_t, kUdpRxBatchSize> rx_bytes;
+  std::array<MacPacketPacked*, kUdpRxBatchSize> in_place;
+  size_t num_bufs = 0;
+  for (size_t i = 0; i < cfg_->UeAntNum(); i++) {
+    const size_t ue_id = (next_radio_id_ + i) % cfg_->UeAntNum();
+    const bool dropping =
+        (client_.dl_pkts_filled_[ue_id] == 0)
+            ? DlBitsSlotBusy(ue_id)
+            : client_.dl_dropping_frame_[ue_id];
+    for (size_t pkt_id = client_.dl_pkts_filled_[ue_id];
+         (pkt_id < num_mac_packets_per_frame) && (num_bufs < kUdpRxBatchSize);
+         pkt_id++) {
+      in_place.at(num_bufs) = dropping ? nullptr : DlBitsPacket(ue_id, pkt_id);
+      num_bufs++;
     }
+  }
+  for (size_t i = 0; i < kUdpRxBatchSize; i++) {
+    if (i >= num_bufs) {
+      in_place.at(i) = nullptr;
+    }
+    bufs.at(i) = (in_place.at(i) != nullptr)
+                     ? reinterpret_cast<std::byte*>(in_place.at(i))
+                     : &udp_pkt_buf_.at(i * mac_packet_length);
+  }
 
-    // Check for completion
-    if (packets_received == packets_required) {
-      break;
+  const ssize_t num_rx = udp_comm_->RecvBatch(
+      bufs.data(), mac_packet_length, rx_bytes.data(), kUdpRxBatchSize);
+  if (num_rx < 0) {
+    // There was an error in receiving
+    AGORA_LOG_ERROR("MacThreadBaseStation: Error in reception %zd\n", num_rx);
+    cfg_->Running(false);
+    return;
+  } else if (num_rx == 0) {
+    return;
+  }
+  client_.udp_batches_++;
+  client_.udp_packets_ += num_rx;
+
+  // Move the packets that did not land in their own slot out of the way
+  // first, so placing them cannot overwrite a packet still to be placed
+  std::array<const MacPacketPacked*, kUdpRxBatchSize> placed;
+  for (ssize_t i = 0; i < num_rx; i++) {
+    placed.at(i) = reinterpret_cast<const MacPacketPacked*>(bufs.at(i));
+    if ((in_place.at(i) != nullptr) &&
+        (DlBitsPacketFor(placed.at(i), rx_bytes.at(i)) != in_place.at(i))) {
+      std::memcpy(&udp_pkt_buf_.at(i * mac_packet_length), bufs.at(i),
+                  rx_bytes.at(i));
+      placed.at(i) = reinterpret_cast<const MacPacketPacked*>(
+          &udp_pkt_buf_.at(i * mac_packet_length));
     }
-  }  // end rx attempts
+  }
+  for (ssize_t i = 0; i < num_rx; i++) {
+    PlaceDlPacket(placed.at(i), rx_bytes.at(i));
+  }
+  AGORA_LOG_FRAME("MacThreadBaseStation: Received %zd packets in one batch\n",
+                  num_rx);
+}
 
-  if (packets_received != packets_required) {
-    AGORA_LOG_ERROR(
-        "MacThreadBaseStation: Received %zu : %zu packets with %zu total bytes "
-        "in %zu attempts\n",
-        packets_received, packets_required, total_bytes_received, rx_attempts);
-  } else {
-    AGORA_LOG_FRAME("MacThreadClient: Received Mac Frame Data\n");
+MacPacketPacked* MacThreadBaseStation::DlBitsPacket(size_t ue_id,
+                                                    size_t pkt_id) {
+  const size_t dest_pkt_offset =
+      ((client_.dl_bits_buffer_id_[ue_id] *
+        cfg_->MacPacketsPerframe(Direction::kDownlink)) +
+       pkt_id) *
+      cfg_->MacPacketLength(Direction::kDownlink);
+  return reinterpret_cast<MacPacketPacked*>(
+      &(*client_.dl_bits_buffer_)[ue_id][dest_pkt_offset]);
+}
+
+MacPacketPacked* MacThreadBaseStation::DlBitsPacketFor(
+    const MacPacketPacked* pkt, size_t rx_bytes) {
+  if ((rx_bytes < MacPacketPacked::kHeaderSize) ||
+      (rx_bytes < (MacPacketPacked::kHeaderSize + pkt->PayloadLength())) ||
+      (pkt->Ue() >= cfg_->UeAntNum())) {
+    return nullptr;
+  }
+  // could use the packet order vs symbol id but might reorder packets
+  const size_t pkt_id = cfg_->Frame().GetDLSymbolIdx(pkt->Symbol()) -
+                        cfg_->Frame().ClientDlPilotSymbols();
+  if (pkt_id >= cfg_->MacPacketsPerframe(Direction::kDownlink)) {
+    return nullptr;
   }
-  RtAssert(packets_received == packets_required,
-           "MacThreadBaseStation: ProcessUdpPacketsFromApps incorrect data "
-           "received!");
+  return DlBitsPacket(pkt->Ue(), pkt_id);
+}
 
-  // Currently this is a packet list of mac packets
-  ProcessUdpPacketsFromAppsBs((char*)&udp_pkt_buf_[0]);
+bool MacThreadBaseStation::DlBitsSlotBusy(size_t ue_id) const {
+  return (*client_.dl_bits_buffer_status_)[ue_id]
+                                          [client_.dl_bits_buffer_id_[ue_id]] ==
+         1;
 }
 
-void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
-  const size_t mac_packet_length = cfg_->MacPacketLength(Direction::kDownlink);
+void MacThreadBaseStation::PlaceDlPacket(const MacPacketPacked* src_packet,
+                                         size_t rx_bytes) {
   const size_t num_mac_packets_per_frame =
       cfg_->MacPacketsPerframe(Direction::kDownlink);
-  const size_t num_pilot_symbols = cfg_->Frame().ClientDlPilotSymbols();
 
   // Data integrity check
-  size_t pkt_offset = 0;
-  size_t ue_id = 0;
-  size_t symbol_id = 0;
-  size_t frame_id = 0;
-  for (size_t packet = 0u; packet < num_mac_packets_per_frame; packet++) {
-    const auto* pkt =
-        reinterpret_cast<const MacPacketPacked*>(&payload[pkt_offset]);
-
-    // std::printf("Frame %d, Packet %zu, symbol %d, user %d\n", pkt->Frame(),
-    //            packet, pkt->Symbol(), pkt->Ue());
-    if (packet == 0) {
-      ue_id = pkt->Ue();
-      frame_id = pkt->Frame();
-    } else {
-      if (ue_id != pkt->Ue()) {
-        AGORA_LOG_ERROR(
-            "Received pkt %zu data with unexpected UE id %zu, expected %d\n",
-            packet, ue_id, pkt->Ue());
-      }
-      if ((symbol_id + 1) != pkt->Symbol()) {
-        AGORA_LOG_ERROR("Received out of order symbol id %d, expected %zu\n",
-                        pkt->Symbol(), symbol_id + 1);
-      }
-
-      if (frame_id != pkt->Frame()) {
-        AGORA_LOG_ERROR(
-            "Received pkt %zu data with unexpected frame id %zu, expected %d\n",
-            packet, frame_id, pkt->Frame());
-      }
-    }
-    symbol_id = pkt->Symbol();
-    pkt_offset += MacPacketPacked::kHeaderSize + pkt->PayloadLength();
-  }
-
-  if (next_radio_id_ != ue_id) {
-    AGORA_LOG_ERROR("Error - radio id %zu, expected %zu\n", ue_id,
-                    next_radio_id_);
+  if ((rx_bytes < MacPacketPacked::kHeaderSize) ||
+      (rx_bytes < (MacPacketPacked::kHeaderSize +
+                   src_packet->PayloadLength())) ||
+      (src_packet->Ue() >= cfg_->UeAntNum())) {
+    AGORA_LOG_ERROR(
+        "MacThreadBaseStation: Dropping malformed packet of %zu bytes\n",
+        rx_bytes);
+    return;
   }
-  // End data integrity check
-
-  next_radio_id_ = ue_id;
-
-  // We've received bits for the uplink.
-  size_t& radio_buf_id = client_.dl_bits_buffer_id_[next_radio_id_];
-
-  if ((*client_.dl_bits_buffer_status_)[next_radio_id_][radio_buf_id] == 1) {
-    std::fprintf(
-        stderr,
-        "MacThreadBasestation: UDP RX buffer full, buffer ID: %zu. Dropping "
-        "rx frame data\n",
-        radio_buf_id);
+  const size_t ue_id = src_packet->Ue();
+  const size_t pkt_id = cfg_->Frame().GetDLSymbolIdx(src_packet->Symbol()) -
+                        cfg_->Frame().ClientDlPilotSymbols();
+  if (pkt_id >= num_mac_packets_per_frame) {
+    AGORA_LOG_ERROR("Received pkt with unexpected symbol id %d\n",
+                    src_packet->Symbol());
     return;
   }
+  size_t& pkts_filled = client_.dl_pkts_filled_[ue_id];
+  if (pkt_id != pkts_filled) {
+    AGORA_LOG_ERROR(
+        "Received out of order symbol id %d for UE %zu, expected packet "
+        "%zu\n",
+        src_packet->Symbol(), ue_id, pkts_filled);
+  }
+  // End data integrity check
 
-#if defined(ENABLE_RB_IND)
-  RBIndicator ri;
-  ri.ue_id_ = next_radio_id_;
-  ri.mcs_index_ = kDefaultMcsIndex;
-#endif
-
-  if (kLogMacPackets) {
-    std::stringstream ss;
-    std::fprintf(
-        log_file_,
-        "MacThreadBasestation: Received data from app for frame %zu, ue "
-        "%zu size %zu\n",
-        next_tx_frame_id_, next_radio_id_, pkt_offset);
-
-    for (size_t i = 0; i < pkt_offset; i++) {
-      ss << std::to_string((uint8_t)(payload[i])) << " ";
+  // We've received bits for the downlink. Drop the whole frame if its slot
+  // is still waiting for the PHY.
+  if (pkts_filled == 0) {
+    client_.dl_dropping_frame_[ue_id] = DlBitsSlotBusy(ue_id);
+    if (client_.dl_dropping_frame_[ue_id]) {
+      std::fprintf(
+          stderr,
+          "MacThreadBasestation: UDP RX buffer full, buffer ID: %zu. Dropping "
+          "rx frame data\n",
+          client_.dl_bits_buffer_id_[ue_id]);
     }
-    std::fprintf(log_file_, "%s\n", ss.str().c_str());
   }
+  pkts_filled++;
 
-  size_t src_pkt_offset = 0;
-  // Copy from the packet rx buffer into ul_bits memory (unpacked)
-  for (size_t pkt_id = 0; pkt_id < num_mac_packets_per_frame; pkt_id++) {
-    const auto* src_packet =
-        reinterpret_cast<const MacPacketPacked*>(&payload[src_pkt_offset]);
-    const size_t symbol_idx =
-        cfg_->Frame().GetDLSymbolIdx(src_packet->Symbol());
-    // next_radio_id_ = src_packet->ue_id;
-
-    // could use pkt_id vs src_packet->symbol_id_ but might reorder packets
-    const size_t dest_pkt_offset = ((radio_buf_id * num_mac_packets_per_frame) +
-                                    (symbol_idx - num_pilot_symbols)) *
-                                   mac_packet_length;
-
-    auto* pkt = reinterpret_cast<MacPacketPacked*>(
-        &(*client_.dl_bits_buffer_)[next_radio_id_][dest_pkt_offset]);
-
-    pkt->Set(next_tx_frame_id_, src_packet->Symbol(), src_packet->Ue(),
-             src_packet->PayloadLength());
+  if (client_.dl_dropping_frame_[ue_id] == false) {
+    auto* pkt = DlBitsPacket(ue_id, pkt_id);
+    if (pkt != src_packet) {
+      std::memcpy(pkt, src_packet,
+                  MacPacketPacked::kHeaderSize + src_packet->PayloadLength());
+    }
+    pkt->Set(next_tx_frame_id_, pkt->Symbol(), ue_id, pkt->PayloadLength());
 
 #if ENABLE_RB_IND
+    RBIndicator ri;
+    ri.ue_id_ = ue_id;
+    ri.mcs_index_ = kDefaultMcsIndex;
     pkt->rb_indicator_ = ri;
 #endif
 
-    pkt->LoadData(src_packet->Data());
     // Insert CRC
     pkt->Crc((uint16_t)(
         crc_obj_->CalculateCrc24(pkt->Data(), pkt->PayloadLength()) & 0xFFFF));
@@ -487,8 +541,8 @@ void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
       ss << "MacThreadBasestation: created packet frame " << next_tx_frame_id_
          << ", pkt " << pkt_id << ", size "
          << cfg_->MacPayloadMaxLength(Direction::kDownlink) << " radio buff id "
-         << radio_buf_id << ", loc " << (size_t)pkt << " dest offset "
-         << dest_pkt_offset << std::endl;
+         << client_.dl_bits_buffer_id_[ue_id] << ", loc " << (size_t)pkt
+         << std::endl;
 
       ss << "Header Info:" << std::endl
          << "FRAME_ID: " << pkt->Frame() << std::endl
@@ -504,23 +558,44 @@ void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
       std::fprintf(log_file_, "%s", ss.str().c_str());
       ss.str("");
     }
-    src_pkt_offset += pkt->PayloadLength() + MacPacketPacked::kHeaderSize;
-  }  // end all packets
+  }
+
+  if (pkts_filled == num_mac_packets_per_frame) {
+    pkts_filled = 0;
+    if (client_.dl_dropping_frame_[ue_id]) {
+      client_.dl_frames_dropped_[ue_id]++;
+    } else {
+      SendDlFrameToPhy(ue_id);
+    }
+    next_radio_id_ = (ue_id + 1) % cfg_->UeAntNum();
+    if (next_radio_id_ == 0) {
+      next_tx_frame_id_++;
+    }
+  }
+}
 
-  (*client_.dl_bits_buffer_status_)[next_radio_id_][radio_buf_id] = 1;
+void MacThreadBaseStation::SendDlFrameToPhy(size_t ue_id) {
+  size_t& radio_buf_id = client_.dl_bits_buffer_id_[ue_id];
+  (*client_.dl_bits_buffer_status_)[ue_id][radio_buf_id] = 1;
   EventData msg(EventType::kPacketFromMac,
-                rx_mac_tag_t(next_radio_id_, radio_buf_id).tag_);
+                rx_mac_tag_t(ue_id, radio_buf_id).tag_);
   AGORA_LOG_FRAME("MacThreadBasestation: Tx mac information to %zu %zu\n",
-                  next_radio_id_, radio_buf_id);
+                  ue_id, radio_buf_id);
   RtAssert(tx_queue_->enqueue(msg),
            "MacThreadBasestation: Failed to enqueue downlink packet");
+  radio_buf_id = (radio_buf_id + 1) % cfg_->FrameWindow();
 
-  radio_buf_id = (radio_buf_id + 1) % kFrameWnd;
-  // Might be unnecessary now.
-  next_radio_id_ = (next_radio_id_ + 1) % cfg_->UeAntNum();
-  if (next_radio_id_ == 0) {
-    next_tx_frame_id_++;
+  // Frames of this UE waiting for the PHY, including this one
+  size_t queue_depth = 0;
+  for (size_t i = 0; i < cfg_->FrameWindow(); i++) {
+    if ((*client_.dl_bits_buffer_status_)[ue_id][i] == 1) {
+      queue_depth++;
+    }
   }
+  client_.dl_frames_sent_[ue_id]++;
+  client_.dl_queue_depth_sum_[ue_id] += queue_depth;
+  client_.dl_queue_depth_max_[ue_id] =
+      std::max(client_.dl_queue_depth_max_[ue_id], queue_depth);
 }
 
 void MacThreadBaseStation::RunEventLoop() {
@@ -535,6 +610,9 @@ void MacThreadBaseStation::RunEventLoop() {
 
   while (cfg_->Running() == true) {
     ProcessRxFromPhy();
+    if (tb_ring_ != nullptr) {
+      ProcessTransportBlocksFromPhy();
+    }
 
     if ((GetTime::Rdtsc() - last_frame_tx_tsc) > tsc_delta_) {
       SendControlInformation();
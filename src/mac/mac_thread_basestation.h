@@ -5,12 +5,14 @@
 #ifndef MAC_THREAD_H_
 #define MAC_THREAD_H_
 
+#include <array>
 #include <queue>
 
 #include "concurrentqueue.h"
 #include "config.h"
 #include "crc.h"
 #include "gettime.h"
+#include "mac_phy_ring.h"
 #include "message.h"
 #include "ran_config.h"
 #include "symbols.h"
@@ -33,6 +35,13 @@ class MacThreadBaseStation {
   // buffer space for
   static constexpr size_t kMaxPktsPerUE = 64;
 
+  // Maximum number of UDP packets received from applications per recvmmsg()
+  static constexpr size_t kUdpRxBatchSize = UDPComm::kMaxBatchSize;
+
+  // Maximum number of events from the PHY handled per loop. The frames they
+  // complete are sent to the applications together.
+  static constexpr size_t kPhyRxBatchSize = kMaxUEs;
+
   // Length of SNR moving average window
   // TODO: map this to time?
   static constexpr size_t kSNRWindowSize = 100;
@@ -43,7 +52,8 @@ class MacThreadBaseStation {
       Table<int8_t>* dl_bits_buffer, Table<int8_t>* dl_bits_buffer_status,
       moodycamel::ConcurrentQueue<EventData>* rx_queue,
       moodycamel::ConcurrentQueue<EventData>* tx_queue,
-      const std::string& log_filename = "");
+      const std::string& log_filename = "", MacPhyRing* tb_ring = nullptr,
+      MacPhyRing* tb_done_ring = nullptr);
 
   ~MacThreadBaseStation();
 
@@ -60,6 +70,17 @@ class MacThreadBaseStation {
   // fully-received frames for UE #i to kRemoteHostname::(kBaseRemotePort + i)
   void ProcessCodeblocksFromPhy(EventData event);
 
+  // Receive whole uplink transport blocks, one per (frame, UE), from the
+  // PHY through tb_ring_ and return each through tb_done_ring_ once sent
+  void ProcessTransportBlocksFromPhy();
+
+  // Copy the decoded data symbol of a UE to its frame, which is queued for
+  // the application once full
+  void ProcessCodeblock(size_t frame_id, size_t symbol_id, size_t ue_id);
+
+  // Send the queued frames straight from frame_data_ with one sendmmsg()
+  void SendFramesToApps();
+
   // Receive SNR report from PHY master thread. Use for RB scheduling.
   // TODO: process CQI report here as well.
   void ProcessSnrReportFromPhy(EventData event);
@@ -73,9 +94,26 @@ class MacThreadBaseStation {
 
   // Receive user data bits (downlink bits at the MAC thread running at the
   // server, uplink bits at the MAC thread running at the client) and forward
-  // them to the PHY.
+  // them to the PHY. Receives a batch of packets, most of them straight into
+  // their slot of dl_bits_buffer_.
   void ProcessUdpPacketsFromApps();
-  void ProcessUdpPacketsFromAppsBs(const char* payload);
+
+  // Check, stamp and place one received packet in its UE's frame, which is
+  // sent to the PHY once full. The packet may already be in its slot.
+  void PlaceDlPacket(const MacPacketPacked* src_packet, size_t rx_bytes);
+
+  // Hand the full frame of a UE to the PHY and move to its next slot
+  void SendDlFrameToPhy(size_t ue_id);
+
+  // Packet pkt_id of the current dl_bits_buffer_ slot of a UE
+  MacPacketPacked* DlBitsPacket(size_t ue_id, size_t pkt_id);
+
+  // Where pkt belongs, or nullptr if it is malformed
+  MacPacketPacked* DlBitsPacketFor(const MacPacketPacked* pkt,
+                                   size_t rx_bytes);
+
+  // True if the current dl_bits_buffer_ slot of a UE is still used by the PHY
+  bool DlBitsSlotBusy(size_t ue_id) const;
 
   Config* const cfg_;
 
@@ -92,7 +130,8 @@ class MacThreadBaseStation {
   // UDP endpoint used for sending messages
   std::unique_ptr<UDPComm> udp_comm_;
 
-  // A preallocated buffer to store UDP packets received via recv()
+  // A preallocated buffer for the UDP packets of a batch that are not
+  // received into their dl_bits_buffer_ slot
   std::vector<std::byte> udp_pkt_buf_;
 
   // The timestamp at which we last received a UDP packet from an application
@@ -114,13 +153,24 @@ class MacThreadBaseStation {
     // Staging buffers to accumulate decoded uplink code blocks for each UE
     std::array<std::vector<std::byte>, kMaxUEs> frame_data_;
 
-    // n_filled_in_frame_[i] is the number of bytes received in the current
-    // frame for UE #i
-    std::array<size_t, kMaxUEs> n_filled_in_frame_;
+    // n_filled_in_mini_slot_[i][j] is the number of bytes received in
+    // uplink mini-slot j of the current frame for UE #i. The frame is a single
+    // mini-slot without ul_mini_slot_symbols.
+    std::array<std::vector<size_t>, kMaxUEs> n_filled_in_mini_slot_;
 
     // snr_[i] contains a moving window of SNR measurement for UE #i
     std::array<std::queue<float>, kMaxUEs> snr_;
 
+    // Full mini-slots waiting for SendFramesToApps(). The mini-slot of a UE
+    // must be sent before the UE's next code block is copied to frame_data_.
+    std::array<const std::byte*, kMaxUEs> tx_frames_;
+    std::array<size_t, kMaxUEs> tx_lens_;
+    std::array<uint16_t, kMaxUEs> tx_ports_;
+    std::array<bool, kMaxUEs> tx_pending_;
+    size_t num_tx_frames_ = 0;
+    size_t udp_batches_ = 0;
+    size_t udp_frames_ = 0;
+
     // Placing at the end because it is variable size based on configuration
     std::vector<std::vector<size_t>> data_size_;
 
@@ -133,6 +183,20 @@ class MacThreadBaseStation {
   struct {
     std::array<size_t, kMaxUEs> dl_bits_buffer_id_;
 
+    // Packets received in the current frame of each UE, and whether the
+    // frame is dropped because its slot was busy
+    std::array<size_t, kMaxUEs> dl_pkts_filled_;
+    std::array<bool, kMaxUEs> dl_dropping_frame_;
+
+    // Per-UE downlink stats, logged at exit. The queue depth is the number
+    // of frames of the UE waiting for the PHY, sampled at each frame sent.
+    std::array<size_t, kMaxUEs> dl_frames_sent_;
+    std::array<size_t, kMaxUEs> dl_frames_dropped_;
+    std::array<size_t, kMaxUEs> dl_queue_depth_sum_;
+    std::array<size_t, kMaxUEs> dl_queue_depth_max_;
+    size_t udp_batches_ = 0;
+    size_t udp_packets_ = 0;
+
     Table<int8_t>* dl_bits_buffer_;
     Table<int8_t>* dl_bits_buffer_status_;
   } client_;
@@ -142,6 +206,10 @@ class MacThreadBaseStation {
   // FIFO queue for sending messages to the master thread
   moodycamel::ConcurrentQueue<EventData>* tx_queue_;
 
+  // Transport blocks from and back to the master thread, if mac_tb_ring
+  MacPhyRing* tb_ring_;
+  MacPhyRing* tb_done_ring_;
+
   // CRC
   std::unique_ptr<DoCRC> crc_obj_;
 };
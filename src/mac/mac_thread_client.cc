@@ -43,6 +43,7 @@ MacThreadClient::MacThreadClient(
   client_.ul_bits_buffer_status_ = ul_bits_buffer_status;
 
   server_.n_filled_in_frame_.fill(0);
+  server_.tx_pending_.fill(false);
   for (size_t ue_ant = 0; ue_ant < cfg_->UeAntTotal(); ue_ant++) {
     server_.data_size_.emplace_back(
         std::vector<size_t>(cfg->Frame().NumDlDataSyms()));
@@ -85,18 +86,21 @@ MacThreadClient::~MacThreadClient() {
 }
 
 void MacThreadClient::ProcessRxFromPhy() {
-  EventData event;
-  if (rx_queue_->try_dequeue(event) == false) {
-    return;
-  }
-
-  if (event.event_type_ == EventType::kPacketToMac) {
-    AGORA_LOG_TRACE("MacThreadClient: MAC thread event kPacketToMac\n");
-    ProcessCodeblocksFromPhy(event);
-  } else if (event.event_type_ == EventType::kSNRReport) {
-    AGORA_LOG_TRACE("MacThreadClient: MAC thread event kSNRReport\n");
-    ProcessSnrReportFromPhy(event);
+  std::array<EventData, kPhyRxBatchSize> events;
+  const size_t num_events =
+      rx_queue_->try_dequeue_bulk(events.begin(), kPhyRxBatchSize);
+
+  for (size_t i = 0; i < num_events; i++) {
+    const EventData& event = events[i];
+    if (event.event_type_ == EventType::kPacketToMac) {
+      AGORA_LOG_TRACE("MacThreadClient: MAC thread event kPacketToMac\n");
+      ProcessCodeblocksFromPhy(event);
+    } else if (event.event_type_ == EventType::kSNRReport) {
+      AGORA_LOG_TRACE("MacThreadClient: MAC thread event kSNRReport\n");
+      ProcessSnrReportFromPhy(event);
+    }
   }
+  SendFramesToApps();
 }
 
 void MacThreadClient::ProcessSnrReportFromPhy(EventData event) {
@@ -135,6 +139,11 @@ void MacThreadClient::ProcessCodeblocksFromPhy(EventData event) {
 
   std::stringstream ss;  // Debug-only
 
+  // The previous frame of the UE is still waiting in frame_data_
+  if (server_.tx_pending_.at(ue_id)) {
+    SendFramesToApps();
+  }
+
   // Only non-pilot data symbols have application data.
   if (symbol_array_index >= num_pilot_symbols) {
     // The decoded symbol knows nothing about the padding / storage of the data
@@ -231,8 +240,13 @@ void MacThreadClient::ProcessCodeblocksFromPhy(EventData event) {
     }
 
     if (dest_offset > 0) {
-      udp_comm_->Send(kMacRemoteHostname, cfg_->UeMacTxPort() + ue_id,
-                      &server_.frame_data_.at(ue_id).at(0), dest_offset);
+      const size_t tx_id = server_.num_tx_frames_;
+      server_.tx_frames_.at(tx_id) = &server_.frame_data_.at(ue_id).at(0);
+      server_.tx_lens_.at(tx_id) = dest_offset;
+      server_.tx_ports_.at(tx_id) =
+          static_cast<uint16_t>(cfg_->UeMacTxPort() + ue_id);
+      server_.tx_pending_.at(ue_id) = true;
+      server_.num_tx_frames_++;
     }
 
     ss << "MacThreadClient: Sent data for frame " << frame_id << ", ue "
@@ -255,6 +269,17 @@ void MacThreadClient::ProcessCodeblocksFromPhy(EventData event) {
       "Socket message enqueue failed\n");
 }
 
+void MacThreadClient::SendFramesToApps() {
+  if (server_.num_tx_frames_ == 0) {
+    return;
+  }
+  udp_comm_->SendBatch(kMacRemoteHostname, server_.tx_ports_.data(),
+                       server_.tx_frames_.data(), server_.tx_lens_.data(),
+                       server_.num_tx_frames_);
+  server_.num_tx_frames_ = 0;
+  server_.tx_pending_.fill(false);
+}
+
 void MacThreadClient::ProcessControlInformation() {
   std::memset(&udp_control_buf_[0], 0, udp_control_buf_.size());
   ssize_t ret =
@@ -5,6 +5,7 @@
 #ifndef MAC_THREAD_H_
 #define MAC_THREAD_H_
 
+#include <array>
 #include <queue>
 
 #include "concurrentqueue.h"
@@ -34,6 +35,10 @@ class MacThreadClient {
   // buffer space for
   static constexpr size_t kMaxPktsPerUE = 64;
 
+  // Maximum number of events from the PHY handled per loop. The frames they
+  // complete are sent to the applications together.
+  static constexpr size_t kPhyRxBatchSize = kMaxUEs;
+
   // Length of SNR moving average window
   // TODO: map this to time?
   static constexpr size_t kSNRWindowSize = 100;
@@ -61,6 +66,9 @@ class MacThreadClient {
   // fully-received frames for UE #i to kRemoteHostname::(kBaseRemotePort + i)
   void ProcessCodeblocksFromPhy(EventData event);
 
+  // Send the queued frames straight from frame_data_ with one sendmmsg()
+  void SendFramesToApps();
+
   // Receive SNR report from PHY master thread. Use for RB scheduling.
   // TODO: process CQI report here as well.
   void ProcessSnrReportFromPhy(EventData event);
@@ -130,6 +138,14 @@ class MacThreadClient {
     // snr_[i] contains a moving window of SNR measurement for UE #i
     std::array<std::queue<float>, kMaxUEs> snr_;
 
+    // Full frames waiting for SendFramesToApps(). The frame of a UE must be
+    // sent before the UE's next code block is copied to frame_data_.
+    std::array<const std::byte*, kMaxUEs> tx_frames_;
+    std::array<size_t, kMaxUEs> tx_lens_;
+    std::array<uint16_t, kMaxUEs> tx_ports_;
+    std::array<bool, kMaxUEs> tx_pending_;
+    size_t num_tx_frames_ = 0;
+
     // Placing at the end because it is variable size based on configuration
     std::vector<std::vector<size_t>> data_size_;
   } server_;
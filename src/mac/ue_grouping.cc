@@ -0,0 +1,117 @@
+/**
+ * @file ue_grouping.cc
+ * @brief Implementation file for the UeGrouping class
+ */
+#include "ue_grouping.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+#include "utils.h"
+
+UeGrouping::UeGrouping(size_t num_ues, size_t num_streams, float max_corr)
+    : num_ues_(num_ues),
+      num_streams_(num_streams),
+      max_corr_(max_corr),
+      corr_(std::make_unique<std::atomic<float>[]>(num_ues * num_ues)) {
+  RtAssert(num_streams_ <= num_ues_ && num_ues_ <= kMaxUEs,
+           "UeGrouping: more spatial streams than UEs");
+  for (size_t i = 0; i < num_ues_ * num_ues_; i++) {
+    corr_[i].store(0.0f, std::memory_order_relaxed);
+  }
+}
+
+std::complex<float> UeGrouping::Dot(const complex_float* a,
+                                    const complex_float* b, size_t n) {
+  const auto* fa = reinterpret_cast<const float*>(a);
+  const auto* fb = reinterpret_cast<const float*>(b);
+  size_t i = 0;
+  float re = 0.0f;
+  float im = 0.0f;
+#if defined(__AVX512F__)
+  // Lanes of a * b add up to the real part, and lanes of a * swap(b) to the
+  // imaginary part, with the odd lanes negated
+  __m512 sum_re = _mm512_setzero_ps();
+  __m512 sum_im = _mm512_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    const __m512 va = _mm512_loadu_ps(&fa[2 * i]);
+    const __m512 vb = _mm512_loadu_ps(&fb[2 * i]);
+    sum_re = _mm512_fmadd_ps(va, vb, sum_re);
+    sum_im = _mm512_fmadd_ps(va, _mm512_permute_ps(vb, 0xB1), sum_im);
+  }
+  const __m512 sign = _mm512_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f,
+                                     1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f,
+                                     1.0f, -1.0f, 1.0f, -1.0f);
+  re = _mm512_reduce_add_ps(sum_re);
+  im = _mm512_reduce_add_ps(_mm512_mul_ps(sum_im, sign));
+#endif
+  for (; i < n; i++) {
+    re += (fa[2 * i] * fb[2 * i]) + (fa[2 * i + 1] * fb[2 * i + 1]);
+    im += (fa[2 * i] * fb[2 * i + 1]) - (fa[2 * i + 1] * fb[2 * i]);
+  }
+  return {re, im};
+}
+
+void UeGrouping::UpdateCorrelation(const complex_float* csi,
+                                   size_t bs_ant_num, size_t num_sc) {
+  RtAssert(num_sc > 0 && num_sc <= kNumSamples,
+           "UeGrouping: too many subcarriers in a correlation update");
+  std::array<std::array<float, kMaxUEs>, kNumSamples> norms;
+  for (size_t sc = 0; sc < num_sc; sc++) {
+    const complex_float* h = &csi[sc * bs_ant_num * num_ues_];
+    for (size_t ue = 0; ue < num_ues_; ue++) {
+      const complex_float* h_ue = &h[ue * bs_ant_num];
+      norms[sc][ue] = Dot(h_ue, h_ue, bs_ant_num).real();
+    }
+  }
+  for (size_t a = 0; a < num_ues_; a++) {
+    for (size_t b = a + 1; b < num_ues_; b++) {
+      float corr = 0.0f;
+      for (size_t sc = 0; sc < num_sc; sc++) {
+        const complex_float* h = &csi[sc * bs_ant_num * num_ues_];
+        const float norm = norms[sc][a] * norms[sc][b];
+        if (norm > 0.0f) {
+          const std::complex<float> dot =
+              Dot(&h[a * bs_ant_num], &h[b * bs_ant_num], bs_ant_num);
+          corr += std::norm(dot) / norm;
+        }
+      }
+      corr /= static_cast<float>(num_sc);
+      corr_[(a * num_ues_) + b].store(corr, std::memory_order_relaxed);
+      corr_[(b * num_ues_) + a].store(corr, std::memory_order_relaxed);
+    }
+  }
+}
+
+void UeGrouping::FormGroup(const float* priority,
+                           std::array<uint8_t, kMaxUEs>& selected) const {
+  selected.fill(0);
+  // Largest correlation of each UE with the UEs selected so far
+  std::array<float, kMaxUEs> group_corr;
+  group_corr.fill(0.0f);
+  for (size_t stream = 0; stream < num_streams_; stream++) {
+    size_t best = SIZE_MAX;
+    size_t least_corr = SIZE_MAX;
+    for (size_t ue = 0; ue < num_ues_; ue++) {
+      if (selected[ue] != 0) {
+        continue;
+      }
+      if ((group_corr[ue] <= max_corr_) &&
+          ((best == SIZE_MAX) || (priority[ue] > priority[best]))) {
+        best = ue;
+      }
+      if ((least_corr == SIZE_MAX) ||
+          (group_corr[ue] < group_corr[least_corr])) {
+        least_corr = ue;
+      }
+    }
+    if (best == SIZE_MAX) {
+      best = least_corr;
+    }
+    selected[best] = 1;
+    for (size_t ue = 0; ue < num_ues_; ue++) {
+      group_corr[ue] = std::max(group_corr[ue], Correlation(best, ue));
+    }
+  }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file ue_grouping.h
+ * @brief Declaration file for the UeGrouping class, which groups the UEs of
+ * a frame by the correlation of their channels.
+ */
+#ifndef UE_GROUPING_H_
+#define UE_GROUPING_H_
+
+#include <array>
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "symbols.h"
+
+/**
+ * @brief The correlation of the channels of every pair of UEs, measured
+ * from the CSI of the latest frames, and the choice of the UEs that share
+ * the spatial streams of a frame. UEs whose channels point the same way
+ * inflate the condition number of the zeroforcing detector, so a group
+ * takes the UEs with the highest priority among those that are nearly
+ * orthogonal to the UEs already in it.
+ */
+class UeGrouping {
+ public:
+  /// Subcarriers of the CSI of a frame that a correlation update averages
+  static constexpr size_t kNumSamples = 4;
+
+  /**
+   * @param max_corr Largest squared normalized correlation of two UEs in a
+   * group, as long as enough UEs are below it
+   */
+  UeGrouping(size_t num_ues, size_t num_streams, float max_corr);
+
+  /// Update the correlations from the channels of all the UEs at num_sc
+  /// subcarriers (at most kNumSamples): bs_ant_num x num_ues column-major
+  /// matrices one after the other. Can be called from any thread. The
+  /// updates of two frames may race, and each pair then keeps one of them.
+  void UpdateCorrelation(const complex_float* csi, size_t bs_ant_num,
+                         size_t num_sc);
+
+  /// Squared normalized correlation of the channels of UEs a and b, from 0
+  /// (orthogonal) to 1, and 0 before any CSI
+  inline float Correlation(size_t a, size_t b) const {
+    return corr_[(a * num_ues_) + b].load(std::memory_order_relaxed);
+  }
+
+  /// Select num_streams UEs in selected: the UE of the highest priority,
+  /// then each time the UE of the highest priority whose correlation with
+  /// the UEs selected so far is at most max_corr, or the least correlated
+  /// UE if there is none. Ties go to the lower UE. Does not allocate.
+  void FormGroup(const float* priority,
+                 std::array<uint8_t, kMaxUEs>& selected) const;
+
+  /// sum(conj(a[i]) * b[i]) over n samples
+  static std::complex<float> Dot(const complex_float* a,
+                                 const complex_float* b, size_t n);
+
+ private:
+  const size_t num_ues_;
+  const size_t num_streams_;
+  const float max_corr_;
+  // num_ues_ x num_ues_, symmetric
+  std::unique_ptr<std::atomic<float>[]> corr_;
+};
+
+#endif  // UE_GROUPING_H_
@@ -17,40 +17,42 @@ static const std::string kRxAddress = "";
 VideoReceiver::VideoReceiver(uint16_t port)
     : udp_video_receiver_(kRxAddress, port,
                           VideoReceiver::kVideoStreamSocketRxBufSize),
+      rx_size_(udp_video_receiver_.EnableGro()
+                   ? VideoReceiver::kVideoStreamGroRxSize
+                   : VideoReceiver::kVideoStreamMaxRxSize),
       data_available_(0),
       data_start_offset_(0) {}
 
 size_t VideoReceiver::Load(unsigned char *destination, size_t requested_bytes) {
   size_t rx_attempts = 0u;
 
-  if (requested_bytes > data_available_) {
+  while ((data_available_ < requested_bytes) &&
+         (rx_attempts < kMaxRxAttempts)) {
     // Check for potential local buffer wrap-around
-    if ((data_available_ + data_start_offset_ +
-         VideoReceiver::kVideoStreamMaxRxSize) > local_rx_buffer_.size()) {
-      std::memcpy(&local_rx_buffer_.at(0u),
-                  &local_rx_buffer_.at(data_start_offset_), data_available_);
+    if ((data_available_ + data_start_offset_ + rx_size_) >
+        local_rx_buffer_.size()) {
+      if (data_available_ + rx_size_ > local_rx_buffer_.size()) {
+        break;
+      }
+      std::memmove(&local_rx_buffer_.at(0u),
+                   &local_rx_buffer_.at(data_start_offset_), data_available_);
       data_start_offset_ = 0u;
     }
 
-    while ((data_available_ < requested_bytes) &&
-           (rx_attempts < kMaxRxAttempts)) {
-      rx_attempts++;
-      ssize_t rcv_ret = udp_video_receiver_.Recv(
-          &local_rx_buffer_.at(data_start_offset_ + data_available_),
-          VideoReceiver::kVideoStreamMaxRxSize);
+    rx_attempts++;
+    ssize_t rcv_ret = udp_video_receiver_.Recv(
+        &local_rx_buffer_.at(data_start_offset_ + data_available_), rx_size_);
 
-      if (rcv_ret < 0) {
-        throw std::runtime_error("[VideoReceiver] Receive error");
-      } else if (static_cast<size_t>(rcv_ret) >
-                 VideoReceiver::kVideoStreamMaxRxSize) {
-        throw std::runtime_error(
-            "[VideoReceiver] Received packet larger than max receive size -- "
-            "inspect");
-      } else if (rcv_ret > 0) {
-        AGORA_LOG_INFO("[VideoReceiver] data received: %zd\n", rcv_ret);
-      }
-      data_available_ += rcv_ret;
+    if (rcv_ret < 0) {
+      throw std::runtime_error("[VideoReceiver] Receive error");
+    } else if (static_cast<size_t>(rcv_ret) > rx_size_) {
+      throw std::runtime_error(
+          "[VideoReceiver] Received packet larger than max receive size -- "
+          "inspect");
+    } else if (rcv_ret > 0) {
+      AGORA_LOG_INFO("[VideoReceiver] data received: %zd\n", rcv_ret);
     }
+    data_available_ += rcv_ret;
   }
 
   // Copy what is available
@@ -24,8 +24,11 @@ class VideoReceiver : public MacDataReceiver {
       (kVideoStreamRxSize * 1000u);
   // Oversize the potential receive size
   static constexpr size_t kVideoStreamMaxRxSize = 2048u;
+  // Receive size with UDP GRO, which returns up to 64 KB of back to back
+  // packets of the stream per receive
+  static constexpr size_t kVideoStreamGroRxSize = 65536u;
   static constexpr size_t kVideoStreamLocalRxBufSize =
-      kVideoStreamMaxRxSize * 10;
+      kVideoStreamGroRxSize * 2;
 
   explicit VideoReceiver(uint16_t port);
   ~VideoReceiver() override = default;
@@ -37,6 +40,9 @@ class VideoReceiver : public MacDataReceiver {
   std::array<std::byte, VideoReceiver::kVideoStreamLocalRxBufSize>
       local_rx_buffer_;
 
+  // kVideoStreamGroRxSize if the kernel coalesces the packets, otherwise
+  // kVideoStreamMaxRxSize
+  const size_t rx_size_;
   size_t data_available_;
   size_t data_start_offset_;
 };
@@ -0,0 +1,373 @@
+/**
+ * @file agora_py.cc
+ * @brief Python module over the uplink doers of Agora. A Session builds
+ * DoFFT, DoBeamWeights, DoDemul and DoDecode over an AgoraBuffer as
+ * AgoraWorker does, hands out its buffers as NumPy views of their memory
+ * (no copies), and launches and times the tasks of each stage.
+ */
+#include <pybind11/complex.h>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <complex>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "agora_buffer.h"
+#include "config.h"
+#include "data_generator.h"
+#include "datatype_conversion.h"
+#include "dobeamweights.h"
+#include "dodecode.h"
+#include "dodemul.h"
+#include "dofft.h"
+#include "gettime.h"
+#include "logger.h"
+#include "mac_scheduler.h"
+#include "packed_llr.h"
+#include "phy_stats.h"
+#include "stats.h"
+#include "tile_layout.h"
+#include "utils.h"
+
+namespace py = pybind11;
+
+static const std::string kExperimentDirectory =
+    TOSTRING(PROJECT_DIRECTORY) "/files/experiment/";
+
+using CxFloat = std::complex<float>;
+
+class Session {
+ public:
+  explicit Session(const std::string& conf_file, bool generate_data) {
+    cfg_ = std::make_unique<Config>(conf_file);
+    RtAssert((kUse12BitIQ == false) && (cfg_->FronthaulBfpBits() == 0) &&
+                 (cfg_->FftInRru() == false),
+             "agora_py: The packets must hold 16-bit time-domain samples");
+    if (generate_data) {
+      DataGenerator(cfg_.get()).DoDataGeneration(kExperimentDirectory);
+    }
+    cfg_->GenData();
+
+    mac_sched_ = std::make_unique<MacScheduler>(cfg_.get(), true);
+    stats_ = std::make_unique<Stats>(cfg_.get());
+    phy_stats_ = std::make_unique<PhyStats>(cfg_.get(), Direction::kUplink);
+    buffer_ = std::make_unique<AgoraBuffer>(cfg_.get());
+    const size_t tid = 0;
+
+    fft_ = std::make_unique<DoFFT>(
+        cfg_.get(), tid, buffer_->GetFft(), buffer_->GetCsi(),
+        buffer_->GetCalibDl(), buffer_->GetCalibUl(),
+        buffer_->GetFftSymbolPackets(), phy_stats_.get(), stats_.get());
+    beam_ = std::make_unique<DoBeamWeights>(
+        cfg_.get(), tid, buffer_->GetCsi(), buffer_->GetCalibDl(),
+        buffer_->GetCalibUl(), buffer_->GetCalibDlMsum(),
+        buffer_->GetCalibUlMsum(), buffer_->GetCalib(),
+        buffer_->GetUlBeamMatrix(), buffer_->GetDlBeamMatrix(),
+        buffer_->GetBeamRefCsi(), buffer_->GetBeamReuseState(),
+        mac_sched_.get(), phy_stats_.get(), stats_.get());
+    demul_ = std::make_unique<DoDemul>(
+        cfg_.get(), tid, buffer_->GetFft(), buffer_->GetUlBeamMatrix(),
+        buffer_->GetUeSpecPilot(), buffer_->GetEqual(), buffer_->GetDemod(),
+        buffer_->GetUlPhaseBase(), buffer_->GetUlPhaseShiftPerSymbol(),
+        mac_sched_.get(), phy_stats_.get(), stats_.get());
+    if (cfg_->UlBeamInt16()) {
+      beam_->EnableInt16Beams(&buffer_->GetUlBeamInt16(),
+                              &buffer_->GetUlBeamScale());
+      demul_->EnableInt16Beams(&buffer_->GetUlBeamInt16(),
+                               &buffer_->GetUlBeamScale());
+    }
+    doers_ = {{"fft", fft_.get()},
+              {"beam", beam_.get()},
+              {"demul", demul_.get()}};
+#if !defined(USE_ACC100)
+    decode_ = std::make_unique<DoDecode>(
+        cfg_.get(), tid, buffer_->GetDemod(), buffer_->GetDecod(),
+        mac_sched_.get(), phy_stats_.get(), stats_.get(),
+        buffer_->GetHarq());
+    doers_.emplace("decode", decode_.get());
+#endif
+    LoadRxPackets();
+  }
+
+  ~Session() { packets_.Free(); }
+
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+
+  const Config& Cfg() const { return *cfg_; }
+
+  /// The tags of the tasks of stage in frame_id, as Agora schedules them.
+  /// The FFT tasks are those of the packets of frame 0.
+  std::vector<size_t> Tags(const std::string& stage, size_t frame_id) {
+    std::vector<size_t> tags;
+    if (stage == "fft") {
+      for (auto& rx_packet : rx_packets_) {
+        tags.push_back(fft_req_tag_t(rx_packet).tag_);
+      }
+    } else if (stage == "beam") {
+      for (size_t sc = 0; sc < cfg_->OfdmDataNum();
+           sc += cfg_->BeamBlockSize()) {
+        tags.push_back(gen_tag_t::FrmSc(frame_id, sc).tag_);
+      }
+    } else if (stage == "demul") {
+      for (size_t i = 0; i < cfg_->Frame().NumULSyms(); i++) {
+        const size_t symbol_id = cfg_->Frame().GetULSymbol(i);
+        for (size_t sc = 0; sc < cfg_->OfdmDataNum();
+             sc += cfg_->DemulBlockSize()) {
+          tags.push_back(gen_tag_t::FrmSymSc(frame_id, symbol_id, sc).tag_);
+        }
+      }
+    } else if (stage == "decode") {
+      const size_t num_cbs =
+          cfg_->SpatialStreamsNum() *
+          cfg_->LdpcConfig(Direction::kUplink).NumBlocksInSymbol();
+      for (size_t i = cfg_->Frame().ClientUlPilotSymbols();
+           i < cfg_->Frame().NumULSyms(); i++) {
+        const size_t symbol_id = cfg_->Frame().GetULSymbol(i);
+        for (size_t cb = 0; cb < num_cbs; cb++) {
+          tags.push_back(gen_tag_t::FrmSymCb(frame_id, symbol_id, cb).tag_);
+        }
+      }
+    } else {
+      throw std::invalid_argument("agora_py: Unknown stage " + stage);
+    }
+    return tags;
+  }
+
+  /// Run the tasks of tags on the doer of stage, and return the TSC cycles
+  /// of each
+  py::array_t<uint64_t> Launch(const std::string& stage,
+                               const std::vector<size_t>& tags) {
+    const auto doer = doers_.find(stage);
+    if (doer == doers_.end()) {
+      throw std::invalid_argument("agora_py: No doer for stage " + stage);
+    }
+    py::array_t<uint64_t> cycles(static_cast<py::ssize_t>(tags.size()));
+    uint64_t* out = cycles.mutable_data();
+    {
+      // The doers do not touch Python objects
+      py::gil_scoped_release release;
+      for (size_t i = 0; i < tags.size(); i++) {
+        // Each FFT task frees its packet
+        if (stage == "fft") {
+          fft_req_tag_t(tags[i]).rx_packet_->Use();
+        }
+        const size_t start_tsc = GetTime::Rdtsc();
+        doer->second->Launch(tags[i]);
+        out[i] = GetTime::Rdtsc() - start_tsc;
+      }
+    }
+    return cycles;
+  }
+
+  /// The 16-bit IQ samples of the frame 0 packet of an antenna
+  py::array_t<int16_t> PacketSamples(size_t symbol_id, size_t ant) {
+    const SymbolType symbol_type = cfg_->GetSymbolType(symbol_id);
+    RtAssert(((symbol_type == SymbolType::kPilot) ||
+              (symbol_type == SymbolType::kUL)) &&
+                 (ant < cfg_->BsAntNum()),
+             "agora_py: Only pilot and uplink symbols have packets");
+    auto* pkt =
+        reinterpret_cast<Packet*>(packets_[(symbol_id * cfg_->BsAntNum()) +
+                                           ant]);
+    return View<int16_t>(
+        {static_cast<py::ssize_t>(cfg_->SampsPerSymbol()), py::ssize_t{2}},
+        pkt->data_);
+  }
+
+  /// The FFT output of an uplink data symbol, in the tile layout
+  py::array_t<CxFloat> FftData(size_t frame_id, size_t symbol_id) {
+    complex_float* row = buffer_->GetFft()[cfg_->GetTotalDataSymbolIdxUl(
+        frame_id, UlSymbolIdx(symbol_id))];
+    return View<CxFloat>(
+        {static_cast<py::ssize_t>(cfg_->OfdmDataNum() * cfg_->BsAntNum())},
+        reinterpret_cast<CxFloat*>(row));
+  }
+
+  /// The CSI of a UE, in the tile layout
+  py::array_t<CxFloat> Csi(size_t frame_id, size_t ue) {
+    RtAssert(ue < cfg_->UeAntNum(), "agora_py: No such UE");
+    complex_float* csi =
+        buffer_->GetCsi()[frame_id % cfg_->FrameWindow()][ue];
+    return View<CxFloat>(
+        {static_cast<py::ssize_t>(cfg_->OfdmDataNum() * cfg_->BsAntNum())},
+        reinterpret_cast<CxFloat*>(csi));
+  }
+
+  /// The uplink beam matrices, [subcarrier][antenna][stream] as the general
+  /// path stores them (column-major streams x antennas matrices)
+  py::array_t<CxFloat> UlBeamMatrices(size_t frame_id) {
+    complex_float* beams =
+        buffer_->GetUlBeamMatrix()[frame_id % cfg_->FrameWindow()][0];
+    return View<CxFloat>(
+        {static_cast<py::ssize_t>(cfg_->OfdmDataNum()),
+         static_cast<py::ssize_t>(cfg_->BsAntNum()),
+         static_cast<py::ssize_t>(cfg_->SpatialStreamsNum())},
+        reinterpret_cast<CxFloat*>(beams));
+  }
+
+  /// The LLRs of a stream of an uplink symbol, int8 or packed to
+  /// demod_llr_bits
+  py::array_t<int8_t> Demod(size_t frame_id, size_t symbol_id,
+                            size_t stream) {
+    RtAssert(stream < cfg_->SpatialStreamsNum(), "agora_py: No such stream");
+    int8_t* llrs = buffer_->GetDemod()[frame_id % cfg_->FrameWindow()]
+                                      [UlSymbolIdx(symbol_id)][stream];
+    return View<int8_t>(
+        {static_cast<py::ssize_t>(PackedLlrBytes(
+            kMaxModType * cfg_->OfdmDataNum(), cfg_->DemodLlrBits()))},
+        llrs);
+  }
+
+  /// The decoded bytes of a UE in an uplink symbol, code block after code
+  /// block
+  py::array_t<uint8_t> Decoded(size_t frame_id, size_t symbol_id,
+                               size_t ue) {
+    RtAssert(ue < cfg_->UeAntNum(), "agora_py: No such UE");
+    int8_t* bytes = buffer_->GetDecod()[frame_id % cfg_->FrameWindow()]
+                                       [UlSymbolIdx(symbol_id)][ue];
+    const size_t num_cbs =
+        cfg_->LdpcConfig(Direction::kUplink).NumBlocksInSymbol();
+    return View<uint8_t>(
+        {static_cast<py::ssize_t>(num_cbs),
+         static_cast<py::ssize_t>(cfg_->UlDecodedCbStride())},
+        reinterpret_cast<uint8_t*>(bytes));
+  }
+
+ private:
+  /// A NumPy view of the memory at data, which keeps this session alive
+  template <class T>
+  py::array_t<T> View(const std::vector<py::ssize_t>& shape, T* data) {
+    return py::array_t<T>(
+        shape, data, py::cast(this, py::return_value_policy::reference));
+  }
+
+  size_t UlSymbolIdx(size_t symbol_id) const {
+    RtAssert(cfg_->GetSymbolType(symbol_id) == SymbolType::kUL,
+             "agora_py: Not an uplink symbol");
+    return cfg_->Frame().GetULSymbolIdx(symbol_id);
+  }
+
+  /// Packets of the pilot and uplink symbols of the generated rx data
+  void LoadRxPackets() {
+    const std::string filename = kExperimentDirectory + "LDPC_rx_data_" +
+                                 std::to_string(cfg_->OfdmCaNum()) + "_ant" +
+                                 std::to_string(cfg_->BsAntNum()) + ".bin";
+    const size_t num_samples = cfg_->SampsPerSymbol() * 2;
+    Table<float> iq_float;
+    iq_float.Calloc(1, num_samples, Agora_memory::Alignment_t::kAlign64);
+    packets_.Calloc(cfg_->Frame().NumTotalSyms() * cfg_->BsAntNum(),
+                    Roundup<64>(cfg_->PacketLength()),
+                    Agora_memory::Alignment_t::kAlign64);
+    rx_packets_.reserve(packets_.Dim1());
+
+    FILE* fp = std::fopen(filename.c_str(), "rb");
+    RtAssert(fp != nullptr, "Failed to open " + filename);
+    for (size_t i = 0; i < packets_.Dim1(); i++) {
+      RtAssert(std::fread(iq_float[0], sizeof(float), num_samples, fp) ==
+                   num_samples,
+               "Failed to read " + filename);
+      const size_t symbol_id = i / cfg_->BsAntNum();
+      const SymbolType symbol_type = cfg_->GetSymbolType(symbol_id);
+      if ((symbol_type != SymbolType::kPilot) &&
+          (symbol_type != SymbolType::kUL)) {
+        continue;
+      }
+      auto* pkt =
+          new (packets_[i]) Packet(0, symbol_id, 0, i % cfg_->BsAntNum());
+      SimdConvertFloatToShort(iq_float[0], pkt->data_, num_samples);
+      rx_packets_.emplace_back(pkt);
+    }
+    std::fclose(fp);
+    iq_float.Free();
+  }
+
+  std::unique_ptr<Config> cfg_;
+  std::unique_ptr<MacScheduler> mac_sched_;
+  std::unique_ptr<Stats> stats_;
+  std::unique_ptr<PhyStats> phy_stats_;
+  std::unique_ptr<AgoraBuffer> buffer_;
+  std::unique_ptr<DoFFT> fft_;
+  std::unique_ptr<DoBeamWeights> beam_;
+  std::unique_ptr<DoDemul> demul_;
+  std::unique_ptr<DoDecode> decode_;
+  // The doers by stage name
+  std::map<std::string, Doer*> doers_;
+  // The packets of frame 0, one per symbol and antenna. Only those of the
+  // pilot and uplink symbols hold samples and have an RxPacket.
+  Table<char> packets_;
+  std::vector<RxPacket> rx_packets_;
+};
+
+PYBIND11_MODULE(agora_py, m) {
+  m.doc() =
+      "The uplink doers of Agora over NumPy views of their buffers, to run "
+      "and time them next to Python prototypes";
+  AGORA_LOG_INIT();
+  py::module_::import("atexit").attr("register")(
+      py::cpp_function([]() { AGORA_LOG_SHUTDOWN(); }));
+
+  py::class_<Session>(m, "Session")
+      .def(py::init<const std::string&, bool>(), py::arg("conf_file"),
+           py::arg("generate_data") = true,
+           "Build the doers of conf_file, generating its data in "
+           "files/experiment first unless generate_data is False")
+      .def_property_readonly(
+          "bs_ant_num", [](const Session& s) { return s.Cfg().BsAntNum(); })
+      .def_property_readonly(
+          "ue_ant_num", [](const Session& s) { return s.Cfg().UeAntNum(); })
+      .def_property_readonly(
+          "spatial_streams",
+          [](const Session& s) { return s.Cfg().SpatialStreamsNum(); })
+      .def_property_readonly(
+          "ofdm_data_num",
+          [](const Session& s) { return s.Cfg().OfdmDataNum(); })
+      .def_property_readonly(
+          "ul_symbols",
+          [](const Session& s) {
+            std::vector<size_t> symbols;
+            for (size_t i = 0; i < s.Cfg().Frame().NumULSyms(); i++) {
+              symbols.push_back(s.Cfg().Frame().GetULSymbol(i));
+            }
+            return symbols;
+          },
+          "Symbol ids of the uplink symbols, the UE pilots first")
+      .def_property_readonly(
+          "freq_ghz", [](const Session& s) { return s.Cfg().FreqGhz(); },
+          "TSC frequency that converts the cycles of launch()")
+      .def(
+          "tile_index",
+          [](const Session& s, size_t sc, size_t ant) {
+            return TileLayout::Index(sc, ant, s.Cfg().BsAntNum(),
+                                     s.Cfg().OfdmDataNum());
+          },
+          py::arg("sc"), py::arg("ant"),
+          "Index of a subcarrier of an antenna in fft_data() and csi()")
+      .def("tags", &Session::Tags, py::arg("stage"), py::arg("frame_id") = 0,
+           "Tags of the tasks of stage (fft, beam, demul or decode) in a "
+           "frame")
+      .def("launch", &Session::Launch, py::arg("stage"), py::arg("tags"),
+           "Run the tasks of tags on the doer of stage, returning the TSC "
+           "cycles of each")
+      .def("packet", &Session::PacketSamples, py::arg("symbol_id"),
+           py::arg("ant"),
+           "The 16-bit IQ samples of the frame 0 packet of an antenna")
+      .def("fft_data", &Session::FftData, py::arg("frame_id"),
+           py::arg("symbol_id"),
+           "FFT output of an uplink symbol, in the tile layout")
+      .def("csi", &Session::Csi, py::arg("frame_id"), py::arg("ue"),
+           "CSI of a UE, in the tile layout")
+      .def("ul_beam_matrices", &Session::UlBeamMatrices, py::arg("frame_id"),
+           "Uplink beamweights, [subcarrier][antenna][stream]")
+      .def("demod", &Session::Demod, py::arg("frame_id"),
+           py::arg("symbol_id"), py::arg("stream"),
+           "LLRs of a stream of an uplink symbol")
+      .def("decoded", &Session::Decoded, py::arg("frame_id"),
+           py::arg("symbol_id"), py::arg("ue"),
+           "Decoded bytes of a UE, [code block][byte]");
+}
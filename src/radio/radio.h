@@ -61,6 +61,20 @@ class Radio {
   virtual int Rx(std::vector<void*>& rx_locs, size_t rx_size,
                  RxFlags& out_flags, long long& rx_time_ns) = 0;
 
+  /// Number of rx buffers that the driver can lend out with AcquireRx(),
+  /// or 0 without direct buffer access
+  inline virtual size_t NumRxDirectBuffers() { return 0; }
+  /// Borrow the next rx buffer of the driver, one sample pointer per channel
+  /// in rx_locs, instead of copying it out. Returns the number of samples
+  /// (0 on timeout). The buffer must be given back with ReleaseRx(handle).
+  inline virtual int AcquireRx(
+      [[maybe_unused]] std::vector<const void*>& rx_locs,
+      [[maybe_unused]] size_t& handle, [[maybe_unused]] RxFlags& out_flags,
+      [[maybe_unused]] long long& rx_time_ns) {
+    return -1;
+  }
+  inline virtual void ReleaseRx([[maybe_unused]] size_t handle) {}
+
   inline virtual void ConfigureTddModeBs([[maybe_unused]] bool is_ref_radio) {}
   inline virtual void ConfigureTddModeUe() {}
   inline virtual void ClearSyncDelay() {}
@@ -74,6 +88,11 @@ class Radio {
   //For digital cal
   inline virtual void AdjustDelay([[maybe_unused]] const std::string& delay) {}
 
+  /// Point the analog beam of a phased array at entry beam of its codebook.
+  /// Called from a TxRx thread between frames, so it must not block for
+  /// long. Radios without an analog array ignore it.
+  inline virtual void SetAnalogBeam([[maybe_unused]] size_t beam) {}
+
   inline const std::vector<size_t>& EnabledChannels() const {
     return enabled_channels_;
   }
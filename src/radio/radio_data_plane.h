@@ -43,6 +43,17 @@ class RadioDataPlane {
 
   virtual void Flush() = 0;
 
+  /// Direct access to the driver's rx buffers, see Radio::AcquireRx()
+  inline virtual size_t NumRxDirectBuffers() { return 0; }
+  inline virtual int AcquireRx(
+      [[maybe_unused]] std::vector<const void*>& rx_locations,
+      [[maybe_unused]] size_t& handle,
+      [[maybe_unused]] Radio::RxFlags& out_flags,
+      [[maybe_unused]] long long& rx_time_ns) {
+    return -1;
+  }
+  inline virtual void ReleaseRx([[maybe_unused]] size_t handle) {}
+
  protected:
   RadioDataPlane();
 
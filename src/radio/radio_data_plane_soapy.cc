@@ -193,6 +193,48 @@ int RadioDataPlaneSoapy::Rx(std::vector<void*>& rx_locations, size_t rx_size,
   return rx_status;
 }
 
+size_t RadioDataPlaneSoapy::NumRxDirectBuffers() {
+  auto* device = dynamic_cast<RadioSoapySdr*>(radio_)->SoapyDevice();
+  return device->getNumDirectAccessBuffers(remote_stream_);
+}
+
+int RadioDataPlaneSoapy::AcquireRx(std::vector<const void*>& rx_locations,
+                                   size_t& handle, Radio::RxFlags& out_flags,
+                                   long long& rx_time_ns) {
+  static constexpr long kRxTimeout = 1;  // 1uS
+  out_flags = Radio::RxFlags::kRxFlagNone;
+  //Magic number for soapy driver code to ignore tdd framing logic
+  int soapy_rx_flags = (1 << 29);
+  long long frame_time_ns(0);
+  auto* device = dynamic_cast<RadioSoapySdr*>(radio_)->SoapyDevice();
+
+  int rx_status =
+      device->acquireReadBuffer(remote_stream_, handle, rx_locations.data(),
+                                soapy_rx_flags, frame_time_ns, kRxTimeout);
+  if (rx_status > 0) {
+    if ((soapy_rx_flags & SOAPY_SDR_HAS_TIME) == 0) {
+      AGORA_LOG_WARN(
+          "RadioDataPlaneSoapy::AcquireRx %s(%zu) - does not have time",
+          radio_->SerialNumber().c_str(), radio_->Id());
+    }
+    if ((soapy_rx_flags & SOAPY_SDR_END_BURST) == SOAPY_SDR_END_BURST) {
+      out_flags = Radio::RxFlags::kEndReceive;
+    }
+    // Same time format as Rx()
+    rx_time_ns = HwFramer() ? frame_time_ns
+                            : SoapySDR::timeNsToTicks(frame_time_ns,
+                                                      Configuration()->Rate());
+  } else if (rx_status == SOAPY_SDR_TIMEOUT) {
+    rx_status = 0;
+  }
+  return rx_status;
+}
+
+void RadioDataPlaneSoapy::ReleaseRx(size_t handle) {
+  auto* device = dynamic_cast<RadioSoapySdr*>(radio_)->SoapyDevice();
+  device->releaseReadBuffer(remote_stream_, handle);
+}
+
 void RadioDataPlaneSoapy::Flush() {
   const long timeout_us(0);
   int flags = 0;
@@ -35,6 +35,11 @@ class RadioDataPlaneSoapy : public RadioDataPlane {
 
   void Flush() final;
 
+  size_t NumRxDirectBuffers() final;
+  int AcquireRx(std::vector<const void*>& rx_locations, size_t& handle,
+                Radio::RxFlags& out_flags, long long& rx_time_ns) final;
+  void ReleaseRx(size_t handle) final;
+
  private:
 };
 #endif  // RADIO_DATA_PLANE_SOAPY_H_
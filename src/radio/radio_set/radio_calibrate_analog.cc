@@ -10,6 +10,7 @@
 #include "matplotlibcpp.h"
 #include "radio_set_calibrate.h"
 #include "radio_soapysdr.h"
+#include "radio_thread_pool.h"
 
 namespace plt = matplotlibcpp;
 static constexpr bool kIQImbalancePlot = false;
@@ -365,11 +366,13 @@ void RadioSetCalibrate::DciqCalibrationProc(size_t channel) {
   std::cout << "Calibrating Rx Channels with Tx Reference Radio\n";
   ref_dev->InitRefTx(channel, center_rf_freq + tone_bb_freq);
   std::vector<Radio*> all_but_ref_devs;
+  std::vector<size_t> all_but_ref_ids;
   for (size_t r = 0; r < total_radios; r++) {
     if (r != reference_radio) {
       auto* cal_radio = dynamic_cast<RadioSoapySdr*>(radios_.at(r).get());
       cal_radio->InitCalRx(channel, center_rf_freq);
       all_but_ref_devs.push_back(radios_.at(r).get());
+      all_but_ref_ids.push_back(r);
     }
   }
   //Can we move this code to InitRefTx????
@@ -380,16 +383,27 @@ void RadioSetCalibrate::DciqCalibrationProc(size_t channel) {
   RadioSetCalibrate::AdjustCalibrationGains(all_but_ref_devs, ref_dev, channel,
                                             tone_bb_freq / sample_rate, true);
 
-  // Minimize Rx DC offset and IQ Imbalance on all receiving radios
-  // TODO: Parallelize this loop
-  for (size_t r = 0; r < total_radios - 1; r++) {
-    best_rx_dc_sets_[channel].push_back(RadioSetCalibrate::FindArgMinDC(
-        all_but_ref_devs.at(r), all_but_ref_devs.at(r), SOAPY_SDR_RX, channel,
-        0.0, tone_bb_freq / sample_rate));
-    best_rx_iq_sets_[channel].push_back(RadioSetCalibrate::FindArgMinIQ(
-        all_but_ref_devs.at(r), all_but_ref_devs.at(r), SOAPY_SDR_RX, channel,
-        0.0, tone_bb_freq / sample_rate));
-  }
+  // Minimize Rx DC offset and IQ Imbalance on all receiving radios. Each
+  // radio measures its own rx path, so the radios are calibrated in parallel.
+  std::vector<std::complex<double>> rx_dc_sets(total_radios - 1);
+  std::vector<std::complex<double>> rx_iq_sets(total_radios - 1);
+  const size_t rx_failures = RadioThreadPool::ForEachRadio(
+      "Rx DC/IQ calibration", radios_, all_but_ref_ids, [&](size_t radio_id) {
+        const size_t r =
+            (radio_id < reference_radio) ? radio_id : (radio_id - 1);
+        Radio* cal_dev = all_but_ref_devs.at(r);
+        rx_dc_sets.at(r) = RadioSetCalibrate::FindArgMinDC(
+            cal_dev, cal_dev, SOAPY_SDR_RX, channel, 0.0,
+            tone_bb_freq / sample_rate);
+        rx_iq_sets.at(r) = RadioSetCalibrate::FindArgMinIQ(
+            cal_dev, cal_dev, SOAPY_SDR_RX, channel, 0.0,
+            tone_bb_freq / sample_rate);
+      });
+  RtAssert(rx_failures == 0, "Rx DC/IQ calibration failed");
+  best_rx_dc_sets_[channel].insert(best_rx_dc_sets_[channel].end(),
+                                   rx_dc_sets.begin(), rx_dc_sets.end());
+  best_rx_iq_sets_[channel].insert(best_rx_iq_sets_[channel].end(),
+                                   rx_iq_sets.begin(), rx_iq_sets.end());
   ref_dev->StopRefTx(channel);
 
   /*
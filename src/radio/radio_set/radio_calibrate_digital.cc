@@ -10,6 +10,7 @@
 #include "logger.h"
 #include "matplotlibcpp.h"
 #include "radio_set_calibrate.h"
+#include "radio_thread_pool.h"
 #include "simd_types.h"
 
 namespace plt = matplotlibcpp;
@@ -121,7 +122,6 @@ auto RadioSetCalibrate::TxRefToArray(
   // minus ref. node (last in radio list assumed)
   const size_t rx_radios = num_radios - 1;
   const size_t ref = cfg_->RefRadio(0);
-  long long rx_time;
   long long tx_time{0};
 
   RtAssert(ref == rx_radios, "Ref radio must be last");
@@ -140,12 +140,13 @@ auto RadioSetCalibrate::TxRefToArray(
   std::vector<std::vector<std::complex<int16_t>>> ul_buff(
       cfg_->BfAntNum(), std::vector<std::complex<int16_t>>(
                             read_samples, std::complex<int16_t>(0, 0)));
-  std::vector<std::vector<std::complex<int16_t>>*> rx_buffs(num_channels,
-                                                            nullptr);
 
-  for (size_t i = 0; i < num_radios; i++) {
-    radios_.at(i)->Activate(Radio::kActivateWaitTrigger, tx_time, read_samples);
-  }
+  const size_t activate_failures = RadioThreadPool::ForEachRadio(
+      "Calibration activate", radios_, [&](size_t radio_id) {
+        radios_.at(radio_id)->Activate(Radio::kActivateWaitTrigger, tx_time,
+                                       read_samples);
+      });
+  RtAssert(activate_failures == 0, "Radio activation failed");
 
   const auto tx_flags = Radio::TxFlags::kTxWaitTrigger;
   const int tx_status =
@@ -158,11 +159,18 @@ auto RadioSetCalibrate::TxRefToArray(
   //TRIGGER
   Go();
 
-  auto rx_flags = Radio::RxFlags::kRxFlagNone;
+  // Each radio receives the reference pilot on its own, in parallel
+  std::vector<size_t> rx_radio_ids(rx_radios);
   for (size_t radio_i = 0; radio_i < rx_radios; radio_i++) {
+    rx_radio_ids.at(radio_i) = radio_i;
+  }
+  auto rx_from_ref = [&](size_t radio_i) {
     auto start_time = std::chrono::steady_clock::now();
     std::chrono::duration<float> elapsed_seconds{0.0};
+    auto rx_flags = Radio::RxFlags::kRxFlagNone;
+    long long rx_time;
 
+    std::vector<std::vector<std::complex<int16_t>>*> rx_buffs(num_channels);
     const size_t base_ant = radio_i * num_channels;
     for (size_t ch = 0; ch < num_channels; ch++) {
       rx_buffs.at(ch) = &ul_buff.at(base_ant + ch);
@@ -201,7 +209,9 @@ auto RadioSetCalibrate::TxRefToArray(
           radio_i, elapsed_seconds.count(), ref);
     }
     radios_.at(radio_i)->Deactivate();
-  }
+  };
+  RadioThreadPool::ForEachRadio("Calibration rx", radios_, rx_radio_ids,
+                                rx_from_ref);
   //All rx done, deactivate the tx
   radios_.at(ref)->Deactivate();
   return ul_buff;
@@ -403,6 +413,8 @@ bool RadioSetCalibrate::CalibrateSampleOffsetDownlink(size_t max_attempts) {
 }
 
 bool RadioSetCalibrate::InitialCalib() {
+  // The FFTs of every antenna share one committed descriptor
+  const CommsLib::DftHold dft(cfg_->OfdmCaNum());
   // excludes zero padding
   const size_t seq_len = cfg_->PilotCf32().size();
   const size_t read_len = cfg_->PilotCi16().size();
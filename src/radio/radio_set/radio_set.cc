@@ -5,24 +5,19 @@
 
 #include "radio_set.h"
 
-#include <thread>
 #include <vector>
 
 #include "logger.h"
+#include "radio_thread_pool.h"
 
 RadioSet::RadioSet(size_t samples_per_symbol)
     : samples_per_symbol_(samples_per_symbol) {}
 
 RadioSet::~RadioSet() {
-  std::vector<std::thread> close_radio_threads;
-  for (auto& radio : radios_) {
-    close_radio_threads.emplace_back(&Radio::Close, radio.get());
-  }
-
   AGORA_LOG_INFO("~RadioSet waiting for close\n");
-  for (auto& join_thread : close_radio_threads) {
-    join_thread.join();
-  }
+  RadioThreadPool::ForEachRadio("Close", radios_, [this](size_t radio_id) {
+    radios_.at(radio_id)->Close();
+  });
   radios_.clear();
 }
 
@@ -70,6 +65,26 @@ int RadioSet::RadioRx(size_t radio_id, std::vector<void*>& rx_locs,
   return radios_.at(radio_id)->Rx(rx_locs, rx_size, out_flags, rx_time_ns);
 }
 
+size_t RadioSet::RadioNumRxDirectBuffers(size_t radio_id) {
+  return radios_.at(radio_id)->NumRxDirectBuffers();
+}
+
+int RadioSet::RadioAcquireRx(size_t radio_id,
+                             std::vector<const void*>& rx_locs, size_t& handle,
+                             Radio::RxFlags& out_flags,
+                             long long& rx_time_ns) {
+  return radios_.at(radio_id)->AcquireRx(rx_locs, handle, out_flags,
+                                         rx_time_ns);
+}
+
+void RadioSet::RadioReleaseRx(size_t radio_id, size_t handle) {
+  radios_.at(radio_id)->ReleaseRx(handle);
+}
+
+void RadioSet::RadioSetAnalogBeam(size_t radio_id, size_t beam) {
+  radios_.at(radio_id)->SetAnalogBeam(beam);
+}
+
 void RadioSet::ReadSensors() {
   for (const auto& radio : radios_) {
     radio->ReadSensor();
@@ -78,30 +93,20 @@ void RadioSet::ReadSensors() {
 
 bool RadioSet::RadioStart(Radio::ActivationTypes start_type) {
   //Speed up the activations (could have a flush)
-  std::vector<std::thread> activate_radio_threads;
-  for (auto& radio : radios_) {
-    activate_radio_threads.emplace_back(&Radio::Activate, radio.get(),
-                                        start_type, 0, 0);
-  }
-
   AGORA_LOG_INFO("RadioStart waiting for activation\n");
-  for (auto& join_thread : activate_radio_threads) {
-    join_thread.join();
-  }
+  const size_t failures = RadioThreadPool::ForEachRadio(
+      "Activate", radios_, [this, start_type](size_t radio_id) {
+        radios_.at(radio_id)->Activate(start_type, 0, 0);
+      });
   AGORA_LOG_INFO("RadioStart complete!\n");
-  return true;
+  return failures == 0;
 }
 
 void RadioSet::RadioStop() {
   //Threaded deactivate to speed things up
-  std::vector<std::thread> deactivate_radio_threads;
-  for (auto& radio : radios_) {
-    deactivate_radio_threads.emplace_back(&Radio::Deactivate, radio.get());
-  }
-
   AGORA_LOG_INFO("RadioStop waiting for deactivation\n");
-  for (auto& join_thread : deactivate_radio_threads) {
-    join_thread.join();
-  }
+  RadioThreadPool::ForEachRadio("Deactivate", radios_, [this](size_t radio_id) {
+    radios_.at(radio_id)->Deactivate();
+  });
   AGORA_LOG_INFO("RadioStop deactivated\n");
 }
\ No newline at end of file
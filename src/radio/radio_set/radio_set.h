@@ -43,6 +43,14 @@ class RadioSet {
   int RadioRx(size_t radio_id, std::vector<void*>& rx_locs, size_t rx_size,
               Radio::RxFlags& out_flags, long long& rx_time_ns);
 
+  // Direct access to the rx buffers of the driver, see Radio::AcquireRx()
+  size_t RadioNumRxDirectBuffers(size_t radio_id);
+  int RadioAcquireRx(size_t radio_id, std::vector<const void*>& rx_locs,
+                     size_t& handle, Radio::RxFlags& out_flags,
+                     long long& rx_time_ns);
+  void RadioReleaseRx(size_t radio_id, size_t handle);
+  void RadioSetAnalogBeam(size_t radio_id, size_t beam);
+
   virtual bool DoCalib() const { return false; };
   virtual arma::cx_float* GetCalibUl() { return nullptr; }
   virtual arma::cx_float* GetCalibDl() { return nullptr; }
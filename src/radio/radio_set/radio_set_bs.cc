@@ -10,6 +10,7 @@
 #include "SoapySDR/Logger.hpp"
 #include "logger.h"
 #include "radio_soapysdr.h"
+#include "radio_thread_pool.h"
 
 static constexpr bool kPrintCalibrationMats = false;
 static constexpr size_t kSoapyMakeMaxAttempts = 3;
@@ -76,32 +77,10 @@ RadioSetBs::RadioSetBs(Config* cfg, Radio::RadioType radio_type)
     radios_.emplace_back(Radio::Create(radio_type));
   }
 
-  std::vector<std::thread> init_bs_threads;
-
-  for (size_t i = 0; i < radio_num_; i++) {
-#ifdef THREADED_INIT
-    init_bs_threads.emplace_back(&RadioSetBs::InitRadio, this, i);
-#else
-    InitRadio(i);
-#endif
-  }
-
-  // Block until all radios are initialized
-  size_t num_checks = 0;
-  size_t num_radios_init = num_radios_initialized_.load();
-  while (num_radios_init != radio_num_) {
-    num_checks++;
-    if (num_checks > 1e9) {
-      std::printf(
-          "RadioSetBs: Waiting for radio initialization, %zu of %zu ready\n",
-          num_radios_init, radio_num_);
-      num_checks = 0;
-    }
-    num_radios_init = num_radios_initialized_.load();
-  }
-
-  for (auto& join_thread : init_bs_threads) {
-    join_thread.join();
+  const size_t init_failures = RadioThreadPool::ForEachRadio(
+      "Init", radios_, [this](size_t radio_id) { InitRadio(radio_id); });
+  if (init_failures != 0) {
+    throw std::runtime_error("RadioSetBs: radio initialization failed");
   }
 
   for (const auto& radio : radios_) {
@@ -156,8 +135,7 @@ bool RadioSetBs::RadioStart() {
     }
     radios_.at(i)->SetTimeAtTrigger(0);
   }
-  RadioSet::RadioStart(Radio::kActivate);
-  return true;
+  return RadioSet::RadioStart(Radio::kActivate);
 }
 
 void RadioSetBs::Go() {
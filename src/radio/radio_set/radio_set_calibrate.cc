@@ -10,6 +10,7 @@
 #include "SoapySDR/Formats.h"
 #include "SoapySDR/Logger.hpp"
 #include "logger.h"
+#include "radio_thread_pool.h"
 
 static constexpr bool kPrintCalibrationMats = false;
 static constexpr size_t kSoapyMakeMaxAttempts = 3;
@@ -73,33 +74,10 @@ RadioSetCalibrate::RadioSetCalibrate(Config* cfg, std::string calibration_type)
     radios_.emplace_back(Radio::Create(Radio::kSoapySdrStream));
   }
 
-  std::vector<std::thread> init_bs_threads;
-
-  for (size_t i = 0; i < radio_num_; i++) {
-#ifdef THREADED_INIT
-    init_bs_threads.emplace_back(&RadioSetCalibrate::InitRadio, this, i);
-#else
-    InitRadio(i);
-#endif
-  }
-
-  // Block until all radios are initialized
-  size_t num_checks = 0;
-  size_t num_radios_init = num_radios_initialized_.load();
-  while (num_radios_init != radio_num_) {
-    num_checks++;
-    if (num_checks > 1e9) {
-      std::printf(
-          "RadioSetCalibrate: Waiting for radio initialization, %zu of %zu "
-          "ready\n",
-          num_radios_init, radio_num_);
-      num_checks = 0;
-    }
-    num_radios_init = num_radios_initialized_.load();
-  }
-
-  for (auto& join_thread : init_bs_threads) {
-    join_thread.join();
+  const size_t init_failures = RadioThreadPool::ForEachRadio(
+      "Init", radios_, [this](size_t radio_id) { InitRadio(radio_id); });
+  if (init_failures != 0) {
+    throw std::runtime_error("RadioSetCalibrate: radio initialization failed");
   }
 
   if (calibration_type_ != "analog") {
@@ -6,6 +6,7 @@
 #include "radio_set_ue.h"
 
 #include "logger.h"
+#include "radio_thread_pool.h"
 
 RadioSetUe::RadioSetUe(const Config* const cfg, Radio::RadioType radio_type)
     : RadioSet(cfg->SampsPerSymbol()), cfg_(cfg) {
@@ -24,35 +25,12 @@ RadioSetUe::RadioSetUe(const Config* const cfg, Radio::RadioType radio_type)
     radios_.emplace_back(Radio::Create(radio_type));
   }
 
-  std::vector<std::thread> radio_threads;
   num_client_radios_initialized_ = 0;
-  for (size_t i = 0; i < total_radios_; i++) {
-#if defined(THREADED_INIT)
-    radio_threads.emplace_back(&RadioSetUe::InitRadio, this, i);
-#else
-    InitRadio(i);
-#endif
-  }  // end for (size_t i = 0; i < total_radios_; i++)
-
-#if defined(THREADED_INIT)
-  size_t num_checks = 0;
-  size_t num_client_radios_init = num_client_radios_initialized_.load();
-  while (num_client_radios_init != total_radios_) {
-    num_checks++;
-    if (num_checks > 1e9) {
-      AGORA_LOG_INFO(
-          "RadioSetUe: Waiting for radio initialization, %zu of %zu "
-          "ready\n",
-          num_client_radios_init, total_radios_);
-      num_checks = 0;
-    }
-    num_client_radios_init = num_client_radios_initialized_.load();
-  }
-
-  for (auto& init_thread : radio_threads) {
-    init_thread.join();
+  const size_t init_failures = RadioThreadPool::ForEachRadio(
+      "Init", radios_, [this](size_t radio_id) { InitRadio(radio_id); });
+  if (init_failures != 0) {
+    throw std::runtime_error("RadioSetUe: radio initialization failed");
   }
-#endif
 
   for (const auto& radio : radios_) {
     radio->PrintSettings();
@@ -111,9 +89,9 @@ bool RadioSetUe::RadioStart() {
       radios_.at(i)->ConfigureTddModeUe();
     }
   }
-  RadioSet::RadioStart(Radio::kActivateWaitTrigger);
+  const bool started = RadioSet::RadioStart(Radio::kActivateWaitTrigger);
   AGORA_LOG_INFO("RadioSetUe: Radio start complete!\n");
-  return true;
+  return started;
 }
 
 void RadioSetUe::Go() {
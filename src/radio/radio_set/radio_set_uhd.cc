@@ -4,9 +4,8 @@
  */
 #include "radio_set_uhd.h"
 
-#include <thread>
-
 #include "logger.h"
+#include "radio_thread_pool.h"
 
 // only one BS radio object, since, no emplace_back is needed, and the thread number for BS is also set to be 1
 RadioSetUhd::RadioSetUhd(Config* cfg, Radio::RadioType radio_type)
@@ -27,60 +26,16 @@ RadioSetUhd::RadioSetUhd(Config* cfg, Radio::RadioType radio_type)
     radios_.emplace_back(Radio::Create(radio_type));
   }
   AGORA_LOG_INFO("radio UHD created here \n");
-  std::vector<std::thread> init_bs_threads;
-  for (size_t i = 0; i < radio_num_; i++) {
-#if defined(THREADED_INIT)
-    init_bs_threads.emplace_back(&RadioSetUhd::InitRadio, this, i);
-#else
-    InitRadio(i);
-#endif
-  }
-
-  // Block until all radios are initialized
-  size_t num_checks = 0;
-  size_t num_radios_init = num_radios_initialized_.load();
-  while (num_radios_init != radio_num_) {
-    num_checks++;
-    if (num_checks > 1e9) {
-      std::printf(
-          "RadioSetUhd: Waiting for radio initialization, %zu of %zu "
-          "ready\n",
-          num_radios_init, radio_num_);
-      num_checks = 0;
-    }
-    num_radios_init = num_radios_initialized_.load();
-  }
-
-  for (auto& join_thread : init_bs_threads) {
-    join_thread.join();
-  }
-
-  std::vector<std::thread> config_bs_threads;
-  for (size_t i = 0; i < radio_num_; i++) {
-#if defined(THREADED_INIT)
-    config_bs_threads.emplace_back(&RadioSetUhd::ConfigureRadio, this, i);
-#else
-    ConfigureRadio(i);
-#endif
-  }
-
-  AGORA_LOG_INFO("radio UHD configured here \n");
-  num_checks = 0;
-  // Block until all radios are configured
-  size_t num_radios_config = num_radios_configured_.load();
-  while (num_radios_config != radio_num_) {
-    num_checks++;
-    if (num_checks > 1e9) {
-      AGORA_LOG_WARN(
-          "RadioSetUhd: Waiting for radio initialization, %zu of %zu "
-          "ready\n",
-          num_radios_config, radio_num_);
-      num_checks = 0;
-    }
-    num_radios_config = num_radios_configured_.load();
+  const size_t init_failures = RadioThreadPool::ForEachRadio(
+      "Init", radios_, [this](size_t radio_id) { InitRadio(radio_id); });
+  if (init_failures != 0) {
+    throw std::runtime_error("RadioSetUhd: radio initialization failed");
   }
-  for (auto& join_thread : config_bs_threads) {
-    join_thread.join();
+  const size_t config_failures = RadioThreadPool::ForEachRadio(
+      "Configure", radios_,
+      [this](size_t radio_id) { ConfigureRadio(radio_id); });
+  if (config_failures != 0) {
+    throw std::runtime_error("RadioSetUhd: radio configuration failed");
   }
   for (const auto& radio : radios_) {
     radio->PrintSettings();
@@ -136,8 +91,7 @@ bool RadioSetUhd::RadioStart() {
     //radios_.at(i)->ConfigureTddModeBs(false);
     //radios_.at(i)->SetTimeAtTrigger(0);
   }
-  RadioSet::RadioStart(Radio::kActivate);
-  return true;
+  return RadioSet::RadioStart(Radio::kActivate);
 }
 
 //Maybe we start the streaming on all radios at go....
@@ -0,0 +1,107 @@
+/**
+ * @file radio_thread_pool.h
+ * @brief Runs a bring-up or calibration step on many radios in parallel, with
+ * per-radio timing and failure isolation.
+ */
+#ifndef RADIO_THREAD_POOL_H_
+#define RADIO_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+#include "radio.h"
+
+namespace RadioThreadPool {
+// Radio bring-up mostly waits on the network, so use more threads than cores
+// but not one per radio, which overloads the radios' hub / switch
+#if defined(THREADED_INIT)
+static constexpr size_t kMaxThreads = 16;
+#else
+static constexpr size_t kMaxThreads = 1;
+#endif
+
+/**
+ * @brief Call step(i) for every i in radio_ids, on up to kMaxThreads threads.
+ * Logs the time each radio took. A radio that throws does not stop the
+ * others; the failures are logged once all radios are done.
+ * @param stage Name of the step for the logs, e.g. "Init"
+ * @param radios The radios, only used to name them in the logs
+ * @return The number of radios that failed
+ */
+inline size_t ForEachRadio(const std::string& stage,
+                           const std::vector<std::unique_ptr<Radio>>& radios,
+                           const std::vector<size_t>& radio_ids,
+                           const std::function<void(size_t)>& step) {
+  std::atomic<size_t> next(0);
+  std::mutex failed_mutex;
+  std::vector<std::pair<size_t, std::string>> failed;
+
+  const auto start = std::chrono::steady_clock::now();
+  auto worker = [&]() {
+    for (size_t i = next.fetch_add(1); i < radio_ids.size();
+         i = next.fetch_add(1)) {
+      const size_t radio_id = radio_ids.at(i);
+      const auto radio_start = std::chrono::steady_clock::now();
+      try {
+        step(radio_id);
+      } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(failed_mutex);
+        failed.emplace_back(radio_id, e.what());
+        continue;
+      }
+      const std::chrono::duration<double, std::milli> radio_time =
+          std::chrono::steady_clock::now() - radio_start;
+      AGORA_LOG_INFO("RadioThreadPool: %s radio %zu (%s) took %.1f ms\n",
+                     stage.c_str(), radio_id,
+                     radios.at(radio_id)->SerialNumber().c_str(),
+                     radio_time.count());
+    }
+  };
+
+  const size_t num_threads = std::min(kMaxThreads, radio_ids.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  // The calling thread takes part as well
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const std::chrono::duration<double, std::milli> total_time =
+      std::chrono::steady_clock::now() - start;
+  AGORA_LOG_INFO(
+      "RadioThreadPool: %s of %zu radios on %zu threads took %.1f ms\n",
+      stage.c_str(), radio_ids.size(), num_threads, total_time.count());
+  for (const auto& [radio_id, message] : failed) {
+    AGORA_LOG_ERROR("RadioThreadPool: %s failed on radio %zu (%s) -- %s\n",
+                    stage.c_str(), radio_id,
+                    radios.at(radio_id)->SerialNumber().c_str(),
+                    message.c_str());
+  }
+  return failed.size();
+}
+
+/// ForEachRadio() over all the radios
+inline size_t ForEachRadio(const std::string& stage,
+                           const std::vector<std::unique_ptr<Radio>>& radios,
+                           const std::function<void(size_t)>& step) {
+  std::vector<size_t> radio_ids(radios.size());
+  for (size_t i = 0; i < radio_ids.size(); i++) {
+    radio_ids.at(i) = i;
+  }
+  return ForEachRadio(stage, radios, radio_ids, step);
+}
+}  // namespace RadioThreadPool
+
+#endif  // RADIO_THREAD_POOL_H_
@@ -519,6 +519,24 @@ int RadioSoapySdr::Rx(std::vector<void*>& rx_locs, size_t rx_size,
   return rx_return;
 }
 
+size_t RadioSoapySdr::NumRxDirectBuffers() {
+  return rxp_->NumRxDirectBuffers();
+}
+
+int RadioSoapySdr::AcquireRx(std::vector<const void*>& rx_locs, size_t& handle,
+                             Radio::RxFlags& out_flags,
+                             long long& rx_time_ns) {
+  rx_time_ns = 0;
+
+  const int rx_return = rxp_->AcquireRx(rx_locs, handle, out_flags, rx_time_ns);
+  if (rx_return < 0) {
+    throw std::runtime_error("Error in RadioAcquireRx!");
+  }
+  return rx_return;
+}
+
+void RadioSoapySdr::ReleaseRx(size_t handle) { rxp_->ReleaseRx(handle); }
+
 void RadioSoapySdr::Trigger() { dev_->writeSetting("TRIGGER_GEN", ""); }
 
 void RadioSoapySdr::ReadSensor() const {
@@ -753,6 +771,11 @@ void RadioSoapySdr::AdjustDelay(const std::string& delay) {
   dev_->writeSetting("ADJUST_DELAYS", delay);
 }
 
+void RadioSoapySdr::SetAnalogBeam(size_t beam) {
+  // The index in the codebook loaded on the phased array front end
+  dev_->writeSetting("BEAM_INDEX", std::to_string(beam));
+}
+
 void RadioSoapySdr::SetFreqBb(size_t channel, double freq) {
   dev_->setFrequency(SOAPY_SDR_TX, channel, "BB", freq);
   dev_->setFrequency(SOAPY_SDR_RX, channel, "BB", freq);
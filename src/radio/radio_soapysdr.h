@@ -40,6 +40,11 @@ class RadioSoapySdr : public Radio {
   int Rx(std::vector<void*>& rx_locs, size_t rx_size, RxFlags& out_flags,
          long long& rx_time_ns) final;
 
+  size_t NumRxDirectBuffers() final;
+  int AcquireRx(std::vector<const void*>& rx_locs, size_t& handle,
+                RxFlags& out_flags, long long& rx_time_ns) final;
+  void ReleaseRx(size_t handle) final;
+
   void SetTimeAtTrigger(long long time_ns = 0) final;
   long long GetTimeNs() final;
   //End of generic interface
@@ -51,6 +56,7 @@ class RadioSoapySdr : public Radio {
   void Trigger() final;
   void ReadSensor() const final;
   void AdjustDelay(const std::string& delay) final;
+  void SetAnalogBeam(size_t beam) final;
 
   // Calibration helper functions
   void InitRefTx(size_t channel, double freq);
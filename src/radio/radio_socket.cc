@@ -4,6 +4,7 @@
  */
 #include "radio_socket.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 
@@ -118,6 +119,15 @@ static inline size_t ValidateSamples(long long& stream_rx_time,
   return samples_to_load;
 }
 
+//One 12-bit IQ sample of 3 bytes, to 16 bits
+static inline std::complex<int16_t> UnpackSample(const uint8_t* in) {
+  const uint16_t i_lsb = uint16_t(in[0u]);
+  const uint16_t split = uint16_t(in[1u]);
+  const uint16_t q_msb = uint16_t(in[2u]);
+  return std::complex<int16_t>(int16_t((split << 12u) | (i_lsb << 4u)),
+                               int16_t((q_msb << 8u) | (split & 0xf0)));
+}
+
 //bytes_per_element is based on "WIRE" format
 //info.options = {SOAPY_SDR_CS16, SOAPY_SDR_CS12, SOAPY_SDR_CS8};
 //info.optionNames = {"Complex int16", "Complex int12", "Complex int8"};
@@ -186,45 +196,60 @@ int RadioSocket::RxSamples(std::vector<void*>& out_data, long long& rx_time_ns,
 
   //Loop until we have enough samples or there is no pending data at the socket
   while (try_rx) {
-    const size_t udp_rx_size = (rx_buffer_.size() - rx_bytes_);
-    //If the requested rec is < the pending udp packet then the remainer will be thrown out without knowledge
-    RtAssert(udp_rx_size >= kMaxMTU,
-             "Requesting less samples than an MTU, could cause a truncated "
-             "reception");
-    //This function will return 1 UDP packet of up to the requested size.
-    const int rx_return = socket_->Recv(&rx_buffer_.at(rx_bytes_), udp_rx_size);
+    const size_t free_slots = (rx_buffer_.size() - rx_bytes_) / kMaxMTU;
+    RtAssert(free_slots > 0, "No free rx buffer slot for a datagram");
+    //Only the datagrams that complete the request, so that an in order
+    //stream leaves none pending in the rx buffer
+    size_t batch = 1;
+    if ((rx_datagram_samples_ > 0) && (req_total_samples > samples_available)) {
+      batch = ((req_total_samples - samples_available) + rx_datagram_samples_ -
+               1) /
+              rx_datagram_samples_;
+    }
+    batch = std::min({batch, free_slots, UDPComm::kMaxBatchSize});
+    for (size_t i = 0; i < batch; i++) {
+      rx_slots_.at(i) = &rx_buffer_.at(rx_bytes_ + (i * kMaxMTU));
+    }
+    //One recvmmsg call for up to batch datagrams of up to kMaxMTU each
+    const ssize_t rx_return = socket_->RecvBatch(
+        rx_slots_.data(), kMaxMTU, rx_slot_bytes_.data(), batch);
     try_rx = false;
 
     if (rx_return > 0) {
-      const size_t new_bytes = static_cast<size_t>(rx_return);
-      rx_pkt_byte_count_.push(new_bytes);
-      DEBUG_OUTPUT(
-          "RadioSocket::RxSamples: Received %zu new bytes. Pending Total "
-          "Samples (Packed %zu, Unpacked %zu)\n",
-          new_bytes, rx_samples_, sample_buffer_.size());
-      long long pkt_rx_time;
-      size_t burst_count;
-      const size_t new_rx_samples = InspectRx(
-          &rx_buffer_.at(rx_bytes_), new_bytes, pkt_rx_time, burst_count);
-
-      rx_bytes_ += new_bytes;
-      rx_samples_ += new_rx_samples;
-      RtAssert((new_rx_samples % num_channels) == 0,
-               "Newly received samples do not align with output dimensions");
-
-      //Modifies stream_rx_time for next call
-      samples_to_load = ValidateSamples(
-          stream_rx_time, pkt_rx_time, samples_available, new_rx_samples,
-          req_total_samples, burst_count, num_channels);
-
-      samples_available += new_rx_samples;
+      rx_datagrams_.resize(static_cast<size_t>(rx_return));
+      for (size_t i = 0; i < rx_datagrams_.size(); i++) {
+        rx_datagrams_.at(i).data_ = rx_slots_.at(i);
+        rx_datagrams_.at(i).bytes_ = rx_slot_bytes_.at(i);
+      }
+      InspectRx(rx_datagrams_);
+
+      for (const auto& datagram : rx_datagrams_) {
+        rx_pkt_byte_count_.push(datagram.bytes_);
+        DEBUG_OUTPUT(
+            "RadioSocket::RxSamples: Received %zu new bytes. Pending Total "
+            "Samples (Packed %zu, Unpacked %zu)\n",
+            datagram.bytes_, rx_samples_, sample_buffer_.size());
+        rx_bytes_ += kMaxMTU;
+        rx_samples_ += datagram.samples_;
+        RtAssert((datagram.samples_ % num_channels) == 0,
+                 "Newly received samples do not align with output dimensions");
+
+        //Datagrams after the one that completes the load stay pending
+        if (samples_to_load == 0) {
+          //Modifies stream_rx_time for next call
+          samples_to_load = ValidateSamples(
+              stream_rx_time, datagram.rx_time_ticks_, samples_available,
+              datagram.samples_, req_total_samples, datagram.burst_count_,
+              num_channels);
+        }
+        samples_available += datagram.samples_;
+      }
+      rx_datagram_samples_ = rx_datagrams_.back().samples_;
       if (samples_to_load == 0) {
         try_rx = true;
       }
     } else if (rx_return < 0) {
-      if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
-        throw std::runtime_error("Error in socket receive call!");
-      }
+      throw std::runtime_error("Error in socket receive call!");
     }
   }  // end while (try_rx)
 
@@ -306,7 +331,7 @@ size_t RadioSocket::UnpackSamples(std::vector<void*>& out_samples,
     RtAssert(((payload_bytes % (bytes_per_element_ * num_out_dims)) == 0),
              "Invalid payload size, contains a partial sample!");
 
-    processed_bytes += sizeof(rx_data->header_);
+    const size_t pkt_start = processed_bytes;
     //Number of total samples through the end of this data parsing const size_t
     const size_t current_total_samples = processed_samples + pkt_samples;
     AGORA_LOG_TRACE(
@@ -315,44 +340,34 @@ size_t RadioSocket::UnpackSamples(std::vector<void*>& out_samples,
         processed_samples, req_samples, sizeof(rx_data->header_),
         processed_bytes, rx_bytes_, current_total_samples);
 
-    size_t ch = 0;
-    //Maybe able to combine processed_bytes + pkt_byte_offset;
+    //Samples of the request are unpacked straight to the output locations
+    const size_t out_pkt_samples =
+        std::min(pkt_samples, req_samples - processed_samples);
     size_t pkt_byte_offset = 0;
-    while (processed_samples < current_total_samples) {
-      // Optimization point (multi channel mode may not be trivial)
-      // Unpack + Split
-      const uint16_t i_lsb = uint16_t(payload[pkt_byte_offset]);
-      const uint16_t split = uint16_t(payload[pkt_byte_offset + 1u]);
-      const uint16_t q_msb = uint16_t(payload[pkt_byte_offset + 2u]);
-
-      const std::complex<int16_t> new_sample =
-          std::complex<int16_t>(int16_t((split << 12u) | (i_lsb << 4u)),
-                                int16_t((q_msb << 8u) | (split & 0xf0)));
-
-      //Output location is in the output vector
-      if (processed_samples < req_samples) {
-        auto* output_location = &static_cast<std::complex<int16_t>*>(
-            out_samples.at(ch))[processed_samples];
-        *output_location = new_sample;
-      }
-      //Too many samples, place them in the unpacked holding buffer
-      else {
-        if (sample_buffer_.empty()) {
-          //Set the sample time of the first element
-          rx_time_unpacked_ = rx_time + processed_samples;
-        }
-        sample_buffer_.emplace_back(new_sample);
-      }
-      ch++;
-      if (ch == num_out_dims) {
-        //processed_samples are per dimension (!total)
-        processed_samples++;
-        ch = 0;
+    for (size_t sample = 0; sample < out_pkt_samples; sample++) {
+      for (size_t ch = 0; ch < num_out_dims; ch++) {
+        static_cast<std::complex<int16_t>*>(
+            out_samples[ch])[processed_samples + sample] =
+            UnpackSample(&payload[pkt_byte_offset]);
+        pkt_byte_offset += bytes_per_element_;
       }
-      pkt_byte_offset += bytes_per_element_;
-      processed_bytes += bytes_per_element_;
-      RtAssert(rx_bytes_ >= processed_bytes, "Exceeded rx byte count!");
-    }  // end pkt
+    }
+    processed_samples += out_pkt_samples;
+
+    //Too many samples, place them in the unpacked holding buffer
+    if ((processed_samples < current_total_samples) && sample_buffer_.empty()) {
+      //Set the sample time of the first element
+      rx_time_unpacked_ = rx_time + processed_samples;
+    }
+    for (; pkt_byte_offset < payload_bytes;
+         pkt_byte_offset += bytes_per_element_) {
+      sample_buffer_.emplace_back(UnpackSample(&payload[pkt_byte_offset]));
+    }
+    //processed_samples are per dimension (!total)
+    processed_samples = current_total_samples;
+    //On to the slot of the next datagram
+    processed_bytes = pkt_start + kMaxMTU;
+    RtAssert(rx_bytes_ >= processed_bytes, "Exceeded rx byte count!");
   }    // end (processed_samples < req_samples) && (processed_bytes < rx_bytes_)
   rx_bytes_ = rx_bytes_ - processed_bytes;
   rx_samples_ = rx_samples_ - (processed_samples * num_out_dims);
@@ -543,6 +558,14 @@ size_t RadioSocket::InspectRx(const std::byte* in_data, size_t in_count,
   return total_sample_count;
 }
 
+void RadioSocket::InspectRx(std::vector<RxDatagram>& datagrams) const {
+  for (auto& datagram : datagrams) {
+    datagram.samples_ =
+        InspectRx(datagram.data_, datagram.bytes_, datagram.rx_time_ticks_,
+                  datagram.burst_count_);
+  }
+}
+
 //Only set the rx_time if samples were loaded
 size_t RadioSocket::GetUnpackedSamples(std::vector<void*>& out_samples,
                                        long long& rx_time,
@@ -5,6 +5,7 @@
 #ifndef RADIO_SOCKET_H_
 #define RADIO_SOCKET_H_
 
+#include <array>
 #include <complex>
 #include <cstddef>
 #include <memory>
@@ -34,9 +35,21 @@ class RadioSocket {
   void Flush();
 
  private:
+  /// A datagram of a batch receive, in its slot of the rx buffer
+  struct RxDatagram {
+    const std::byte* data_;
+    size_t bytes_;
+    // Filled by InspectRx
+    long long rx_time_ticks_;
+    size_t burst_count_;
+    size_t samples_;
+  };
+
   bool CheckSymbolComplete(const std::byte* in_data, const int& in_count);
   size_t InspectRx(const std::byte* in_data, size_t in_count,
                    long long& rx_time_ticks, size_t& burst_count) const;
+  /// InspectRx of each datagram of a batch
+  void InspectRx(std::vector<RxDatagram>& datagrams) const;
   size_t UnpackSamples(std::vector<void*>& out_samples, size_t req_samples,
                        long long& rx_time);
 
@@ -51,6 +64,7 @@ class RadioSocket {
                           size_t sample_offset, size_t req_samples);
 
   std::unique_ptr<UDPServer> socket_;
+  //Datagrams are received to slots of kMaxMTU bytes, in order
   std::vector<std::byte> rx_buffer_;
   std::queue<size_t> rx_pkt_byte_count_;
 
@@ -61,6 +75,13 @@ class RadioSocket {
   size_t rx_bytes_{0};
   size_t rx_samples_{0};
 
+  //Slots and byte counts of a batch receive
+  std::array<std::byte*, UDPComm::kMaxBatchSize> rx_slots_{};
+  std::array<size_t, UDPComm::kMaxBatchSize> rx_slot_bytes_{};
+  std::vector<RxDatagram> rx_datagrams_;
+  //Total samples of the last datagram, to size the next batch
+  size_t rx_datagram_samples_{0};
+
   size_t samples_per_symbol_{1};
   const size_t bytes_per_element_{3u};
 };
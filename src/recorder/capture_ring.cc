@@ -0,0 +1,120 @@
+/**
+ * @file capture_ring.cc
+ * @brief Implementation of the capture ring of the recorder
+ */
+#include "capture_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "utils.h"
+
+namespace Agora_recorder {
+
+CaptureRing::CaptureRing(size_t num_frames, size_t packets_per_frame,
+                         size_t packet_bytes)
+    : packets_per_frame_(packets_per_frame),
+      packet_bytes_(packet_bytes),
+      slots_(num_frames) {
+  RtAssert(num_frames > 0, "CaptureRing: needs at least one frame");
+  for (auto& slot : slots_) {
+    slot.used_ = false;
+    slot.frame_id_ = 0;
+    slot.packets_.resize(packets_per_frame * packet_bytes);
+    slot.packet_saved_.assign(packets_per_frame, false);
+  }
+}
+
+size_t CaptureRing::AddTable(const std::string& name, size_t frame_bytes) {
+  table_names_.push_back(name);
+  table_bytes_.push_back(frame_bytes);
+  for (auto& slot : slots_) {
+    slot.tables_.emplace_back(frame_bytes);
+    slot.table_saved_.push_back(false);
+  }
+  return table_names_.size() - 1;
+}
+
+CaptureRing::Slot* CaptureRing::SlotFor(size_t frame_id) {
+  Slot& slot = slots_.at(frame_id % slots_.size());
+  if (slot.used_ && (slot.frame_id_ > frame_id)) {
+    return nullptr;
+  }
+  if ((slot.used_ == false) || (slot.frame_id_ < frame_id)) {
+    slot.used_ = true;
+    slot.frame_id_ = frame_id;
+    std::fill(slot.packet_saved_.begin(), slot.packet_saved_.end(), false);
+    std::fill(slot.table_saved_.begin(), slot.table_saved_.end(), false);
+  }
+  return &slot;
+}
+
+const CaptureRing::Slot* CaptureRing::HeldSlot(size_t frame_id) const {
+  const Slot& slot = slots_.at(frame_id % slots_.size());
+  return (slot.used_ && (slot.frame_id_ == frame_id)) ? &slot : nullptr;
+}
+
+void CaptureRing::SavePacket(const Packet* pkt, const short* samples,
+                             size_t packet_index) {
+  RtAssert(packet_index < packets_per_frame_,
+           "CaptureRing: packet index out of the frame");
+  Slot* slot = SlotFor(pkt->frame_id_);
+  if (slot != nullptr) {
+    uint8_t* dst = &slot->packets_.at(packet_index * packet_bytes_);
+    std::memcpy(dst, pkt, Packet::kOffsetOfData);
+    std::memcpy(dst + Packet::kOffsetOfData, samples,
+                packet_bytes_ - Packet::kOffsetOfData);
+    slot->packet_saved_.at(packet_index) = true;
+  }
+}
+
+void CaptureRing::SaveTable(size_t table_id, size_t frame_id,
+                            const void* data) {
+  Slot* slot = SlotFor(frame_id);
+  if (slot != nullptr) {
+    std::memcpy(slot->tables_.at(table_id).data(), data,
+                table_bytes_.at(table_id));
+    slot->table_saved_.at(table_id) = true;
+  }
+}
+
+std::vector<size_t> CaptureRing::Frames(size_t last_frame) const {
+  std::vector<size_t> frames;
+  for (const auto& slot : slots_) {
+    if (slot.used_ && (slot.frame_id_ <= last_frame)) {
+      frames.push_back(slot.frame_id_);
+    }
+  }
+  std::sort(frames.begin(), frames.end());
+  return frames;
+}
+
+void CaptureRing::ForEachPacket(
+    size_t frame_id, const std::function<void(const Packet*)>& fn) const {
+  const Slot* slot = HeldSlot(frame_id);
+  if (slot == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < packets_per_frame_; i++) {
+    if (slot->packet_saved_.at(i)) {
+      fn(reinterpret_cast<const Packet*>(&slot->packets_.at(i * packet_bytes_)));
+    }
+  }
+}
+
+const void* CaptureRing::Table(size_t table_id, size_t frame_id) const {
+  const Slot* slot = HeldSlot(frame_id);
+  if ((slot == nullptr) || (slot->table_saved_.at(table_id) == false)) {
+    return nullptr;
+  }
+  return slot->tables_.at(table_id).data();
+}
+
+void CaptureRing::Release(size_t last_frame) {
+  for (auto& slot : slots_) {
+    if (slot.used_ && (slot.frame_id_ <= last_frame)) {
+      slot.used_ = false;
+    }
+  }
+}
+};  // namespace Agora_recorder
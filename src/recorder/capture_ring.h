@@ -0,0 +1,92 @@
+/**
+ * @file capture_ring.h
+ * @brief Keeps the rx packets and selected per-frame tables of the last few
+ * frames in memory, for the recorder to write out when a capture triggers.
+ */
+#ifndef AGORA_CAPTURE_RING_H_
+#define AGORA_CAPTURE_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "message.h"
+
+namespace Agora_recorder {
+
+/**
+ * @brief A ring of num_frames frame slots, frame f in slot f % num_frames. A
+ * packet or table of a newer frame empties the slot of the frame it replaces,
+ * one of an older frame is dropped. All memory is allocated up front, so
+ * nothing is allocated while frames stream through the ring.
+ */
+class CaptureRing {
+ public:
+  /**
+   * @param num_frames Number of frames held
+   * @param packets_per_frame Number of packets of one frame
+   * @param packet_bytes Size of a packet, header and samples
+   */
+  CaptureRing(size_t num_frames, size_t packets_per_frame,
+              size_t packet_bytes);
+
+  /// Add a table of frame_bytes per frame, before the first SaveTable().
+  /// Returns the id of the table.
+  size_t AddTable(const std::string& name, size_t frame_bytes);
+
+  /// Copy the packet header and its samples to its place (packet_index) in
+  /// the slot of its frame
+  void SavePacket(const Packet* pkt, const short* samples,
+                  size_t packet_index);
+
+  /// Copy the table of frame frame_id from data, frame_bytes long
+  void SaveTable(size_t table_id, size_t frame_id, const void* data);
+
+  /// Frames held up to last_frame, oldest first
+  std::vector<size_t> Frames(size_t last_frame) const;
+
+  /// Call fn for the packets held of frame_id, in packet order
+  void ForEachPacket(size_t frame_id,
+                     const std::function<void(const Packet*)>& fn) const;
+
+  /// The table of frame_id, or nullptr if it is not held
+  const void* Table(size_t table_id, size_t frame_id) const;
+
+  /// Forget the frames up to last_frame, typically once they are written
+  void Release(size_t last_frame);
+
+  inline size_t NumFrames() const { return slots_.size(); }
+  inline size_t NumTables() const { return table_names_.size(); }
+  inline const std::string& TableName(size_t table_id) const {
+    return table_names_.at(table_id);
+  }
+  inline size_t TableBytes(size_t table_id) const {
+    return table_bytes_.at(table_id);
+  }
+
+ private:
+  struct Slot {
+    bool used_;
+    size_t frame_id_;
+    std::vector<uint8_t> packets_;
+    std::vector<bool> packet_saved_;
+    std::vector<std::vector<uint8_t>> tables_;
+    std::vector<bool> table_saved_;
+  };
+
+  // The slot of frame_id, emptied if it held an older frame, or nullptr if
+  // it holds a newer one
+  Slot* SlotFor(size_t frame_id);
+  const Slot* HeldSlot(size_t frame_id) const;
+
+  const size_t packets_per_frame_;
+  const size_t packet_bytes_;
+  std::vector<Slot> slots_;
+  std::vector<std::string> table_names_;
+  std::vector<size_t> table_bytes_;
+};
+};  // namespace Agora_recorder
+
+#endif  // AGORA_CAPTURE_RING_H_
@@ -0,0 +1,209 @@
+/**
+ * @file direct_file_writer.cc
+ * @brief Implementation of the O_DIRECT file writer of the recorder
+ */
+#include "direct_file_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "gettime.h"
+#include "logger.h"
+#include "streaming_store.h"
+#include "utils.h"
+
+namespace Agora_recorder {
+
+// O_DIRECT needs the buffers, offsets and sizes aligned to the logical block
+// size of the device, at most a page
+static constexpr size_t kDirectIoAlign = 4096;
+
+DirectFileWriter::DirectFileWriter(const std::string& dir, size_t queue_depth,
+                                   size_t max_file_bytes, size_t fsync_batch,
+                                   bool non_temporal)
+    : fsync_batch_(fsync_batch),
+      buffer_bytes_(((max_file_bytes + kDirectIoAlign - 1) / kDirectIoAlign) *
+                    kDirectIoAlign),
+      non_temporal_(non_temporal),
+      staging_(queue_depth),
+      in_flight_(0),
+      unsynced_files_(0),
+      direct_(true),
+      files_written_(0),
+      bytes_written_(0),
+      stalls_(0),
+      stall_us_(0.0),
+      start_us_(GetTime::GetTimeUs()) {
+  RtAssert(queue_depth > 0, "DirectFileWriter: needs a queue depth above 0");
+  dir_fd_ = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd_ < 0) {
+    throw std::runtime_error("DirectFileWriter failed to open directory " +
+                             dir);
+  }
+  for (auto& staging : staging_) {
+    staging.buf_ = static_cast<uint8_t*>(
+        std::aligned_alloc(kDirectIoAlign, buffer_bytes_));
+    RtAssert(staging.buf_ != nullptr,
+             "DirectFileWriter: failed to allocate a staging buffer");
+    staging.fd_ = -1;
+    staging.bytes_ = 0;
+    free_staging_.push_back(&staging);
+  }
+#if defined(ENABLE_IO_URING)
+  const int ret = ::io_uring_queue_init(queue_depth, &ring_, 0);
+  if (ret < 0) {
+    throw std::runtime_error("DirectFileWriter failed to set up io_uring: " +
+                             std::string(std::strerror(-ret)));
+  }
+  AGORA_LOG_INFO(
+      "DirectFileWriter: io_uring with %zu writes in flight of up to %zu KB\n",
+      queue_depth, buffer_bytes_ / 1024);
+#else
+  AGORA_LOG_INFO(
+      "DirectFileWriter: synchronous writes of up to %zu KB, built without "
+      "ENABLE_IO_URING\n",
+      buffer_bytes_ / 1024);
+#endif
+}
+
+DirectFileWriter::~DirectFileWriter() {
+  Flush();
+#if defined(ENABLE_IO_URING)
+  ::io_uring_queue_exit(&ring_);
+#endif
+  for (auto& staging : staging_) {
+    std::free(staging.buf_);
+  }
+  ::close(dir_fd_);
+}
+
+void DirectFileWriter::WriteFile(const std::string& path, const void* data,
+                                 size_t bytes) {
+  RtAssert(bytes <= buffer_bytes_, "DirectFileWriter: file too large");
+  if (free_staging_.empty()) {
+    const double wait_start_us = GetTime::GetTimeUs();
+    stalls_++;
+    while (free_staging_.empty()) {
+      WaitOne();
+    }
+    stall_us_ += GetTime::GetTimeUs() - wait_start_us;
+  }
+  Staging* staging = free_staging_.back();
+  free_staging_.pop_back();
+
+  int fd = -1;
+  if (direct_) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if ((fd < 0) && (errno == EINVAL)) {
+      AGORA_LOG_WARN(
+          "DirectFileWriter: %s does not support O_DIRECT, writing through "
+          "the page cache\n",
+          path.c_str());
+      direct_ = false;
+    }
+  }
+  if (direct_ == false) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd < 0) {
+    throw std::runtime_error("DirectFileWriter failed to open " + path +
+                             " for writing");
+  }
+
+  // Pad to the alignment, the file is trimmed once written
+  const size_t write_bytes =
+      ((bytes + kDirectIoAlign - 1) / kDirectIoAlign) * kDirectIoAlign;
+  if (non_temporal_) {
+    StreamingStore::Copy(staging->buf_, data, bytes);
+  } else {
+    std::memcpy(staging->buf_, data, bytes);
+  }
+  std::memset(staging->buf_ + bytes, 0, write_bytes - bytes);
+  if (non_temporal_) {
+    StreamingStore::Fence();
+  }
+  staging->fd_ = fd;
+  staging->bytes_ = bytes;
+  in_flight_++;
+
+#if defined(ENABLE_IO_URING)
+  struct io_uring_sqe* sqe = ::io_uring_get_sqe(&ring_);
+  // The ring has a submission entry per staging buffer
+  RtAssert(sqe != nullptr, "DirectFileWriter: io_uring submission queue full");
+  ::io_uring_prep_write(sqe, fd, staging->buf_, write_bytes, 0);
+  ::io_uring_sqe_set_data(sqe, staging);
+  const int ret = ::io_uring_submit(&ring_);
+  if (ret < 0) {
+    throw std::runtime_error("DirectFileWriter failed to submit a write: " +
+                             std::string(std::strerror(-ret)));
+  }
+#else
+  const ssize_t result = ::pwrite(fd, staging->buf_, write_bytes, 0);
+  Complete(*staging, (result < 0) ? -errno : static_cast<int>(result));
+#endif
+}
+
+void DirectFileWriter::WaitOne() {
+#if defined(ENABLE_IO_URING)
+  struct io_uring_cqe* cqe = nullptr;
+  const int ret = ::io_uring_wait_cqe(&ring_, &cqe);
+  if (ret < 0) {
+    throw std::runtime_error("DirectFileWriter failed to wait for a write: " +
+                             std::string(std::strerror(-ret)));
+  }
+  auto* staging = static_cast<Staging*>(::io_uring_cqe_get_data(cqe));
+  const int result = cqe->res;
+  ::io_uring_cqe_seen(&ring_, cqe);
+  Complete(*staging, result);
+#endif
+}
+
+void DirectFileWriter::Complete(Staging& staging, int result) {
+  if (result < static_cast<int>(staging.bytes_)) {
+    throw std::runtime_error(
+        "DirectFileWriter failed to write a file: " +
+        std::string((result < 0) ? std::strerror(-result) : "short write"));
+  }
+  if (::ftruncate(staging.fd_, staging.bytes_) != 0) {
+    throw std::runtime_error("DirectFileWriter failed to trim a file");
+  }
+  if (::close(staging.fd_) != 0) {
+    throw std::runtime_error("DirectFileWriter failed to close a file");
+  }
+  staging.fd_ = -1;
+  files_written_++;
+  bytes_written_ += staging.bytes_;
+  in_flight_--;
+  free_staging_.push_back(&staging);
+
+  // One syncfs() commits the metadata of the whole batch of files
+  unsynced_files_++;
+  if ((fsync_batch_ > 0) && (unsynced_files_ >= fsync_batch_)) {
+    ::syncfs(dir_fd_);
+    unsynced_files_ = 0;
+  }
+}
+
+void DirectFileWriter::Flush() {
+  while (in_flight_ > 0) {
+    WaitOne();
+  }
+  if (unsynced_files_ > 0) {
+    ::syncfs(dir_fd_);
+    unsynced_files_ = 0;
+  }
+
+  const double elapsed_us = GetTime::GetTimeUs() - start_us_;
+  AGORA_LOG_INFO(
+      "DirectFileWriter: wrote %zu files, %zu MB at %.1f MB/s, %zu stalls "
+      "waiting %.1f ms for the disk\n",
+      files_written_, bytes_written_ >> 20,
+      (elapsed_us > 0.0) ? bytes_written_ / elapsed_us : 0.0, stalls_,
+      stall_us_ / 1000.0);
+}
+};  // namespace Agora_recorder
@@ -0,0 +1,82 @@
+/**
+ * @file direct_file_writer.h
+ * @brief Writes the small files of the multifile recorder with O_DIRECT,
+ * through io_uring when built with ENABLE_IO_URING, so long captures do not
+ * fill the page cache.
+ */
+#ifndef AGORA_DIRECT_FILE_WRITER_H_
+#define AGORA_DIRECT_FILE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(ENABLE_IO_URING)
+#include <liburing.h>
+#endif
+
+namespace Agora_recorder {
+
+class DirectFileWriter {
+ public:
+  /**
+   * @param dir Directory of the files, synced every fsync_batch files
+   * @param queue_depth Number of writes in flight, each with its own aligned
+   * staging buffer
+   * @param max_file_bytes Size of the largest file
+   * @param fsync_batch Number of files written between two syncs of the file
+   * system, 0 to sync only in Flush()
+   * @param non_temporal Copy the files into the staging buffers with
+   * non-temporal stores, as only the device reads them
+   */
+  DirectFileWriter(const std::string& dir, size_t queue_depth,
+                   size_t max_file_bytes, size_t fsync_batch,
+                   bool non_temporal = false);
+  ~DirectFileWriter();
+
+  /// Copy data to a staging buffer and start writing it to a new file of
+  /// bytes at path. Waits for a write in flight if every buffer is in use.
+  void WriteFile(const std::string& path, const void* data, size_t bytes);
+
+  /// Wait for the writes in flight, sync the file system and log the write
+  /// bandwidth
+  void Flush();
+
+ private:
+  struct Staging {
+    uint8_t* buf_;
+    int fd_;
+    size_t bytes_;
+  };
+
+  // Finish the write of a staging buffer: trim the file to its size, close
+  // it, and sync the file system once fsync_batch files are done
+  void Complete(Staging& staging, int result);
+  // Wait for at least one write in flight to complete
+  void WaitOne();
+
+  const size_t fsync_batch_;
+  const size_t buffer_bytes_;
+  const bool non_temporal_;
+  int dir_fd_;
+  std::vector<Staging> staging_;
+  std::vector<Staging*> free_staging_;
+  size_t in_flight_;
+  size_t unsynced_files_;
+  bool direct_;
+
+#if defined(ENABLE_IO_URING)
+  struct io_uring ring_;
+#endif
+
+  // Stats, see Flush()
+  size_t files_written_;
+  size_t bytes_written_;
+  size_t stalls_;
+  double stall_us_;
+  double start_us_;
+};
+};  // namespace Agora_recorder
+
+#endif  // AGORA_DIRECT_FILE_WRITER_H_
@@ -0,0 +1,281 @@
+/**
+ * @file hdf5_chunk_writer.cc
+ * @brief Implementation of the hdf5 chunk writer of the recorder
+ */
+#include "hdf5_chunk_writer.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "logger.h"
+#include "streaming_store.h"
+#include "utils.h"
+
+namespace Agora_recorder {
+
+Hdf5ChunkWriter::Hdf5ChunkWriter(Hdf5Lib& hdf5, size_t num_threads,
+                                 size_t num_staging, size_t max_chunk_bytes,
+                                 size_t deflate_level, bool drop_when_full,
+                                 bool non_temporal)
+    : hdf5_(hdf5),
+      deflate_level_(deflate_level),
+      drop_when_full_(drop_when_full),
+      non_temporal_(non_temporal),
+      chunks_(num_staging),
+      chunks_in_flight_(0),
+      stop_(false),
+      dropped_symbols_(0),
+      partial_chunks_(0),
+      written_chunks_(0),
+      failed_chunks_(0),
+      raw_bytes_(0),
+      stored_bytes_(0) {
+  RtAssert((num_threads > 0) && (num_staging > 0),
+           "Hdf5ChunkWriter: needs at least one thread and staging chunk");
+  for (auto& chunk : chunks_) {
+    chunk.samples_.resize(max_chunk_bytes);
+    chunk.stored_.resize(max_chunk_bytes);
+    if (deflate_level_ > 0) {
+      chunk.compressed_.resize(::compressBound(max_chunk_bytes));
+    }
+    free_chunks_.push_back(&chunk);
+  }
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&Hdf5ChunkWriter::WriterLoop, this);
+  }
+  AGORA_LOG_INFO(
+      "Hdf5ChunkWriter: %zu writer threads, %zu staging chunks of %zu KB, "
+      "deflate level %zu\n",
+      num_threads, num_staging, max_chunk_bytes / 1024, deflate_level_);
+}
+
+Hdf5ChunkWriter::~Hdf5ChunkWriter() {
+  Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  ready_cond_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t Hdf5ChunkWriter::AddDataset(
+    const std::string& name, const std::array<hsize_t, kDsDimsNum>& chunk_dims,
+    const std::array<hsize_t, kDsDimsNum>& dims, size_t sample_bytes) {
+  size_t chunk_samples = 1;
+  for (const auto dim : chunk_dims) {
+    chunk_samples *= dim;
+  }
+  RtAssert((sample_bytes == sizeof(short)) || (sample_bytes == 1),
+           "Hdf5ChunkWriter: samples of " + name + " must be int16 or int8");
+  RtAssert(chunk_samples * sample_bytes <= chunks_.front().samples_.size(),
+           "Hdf5ChunkWriter: chunk of " + name + " larger than the max chunk");
+  datasets_.push_back({name, chunk_dims, dims, chunk_samples, sample_bytes});
+  return datasets_.size() - 1;
+}
+
+bool Hdf5ChunkWriter::Write(size_t dataset_id,
+                            const std::array<hsize_t, kDsDimsNum>& start,
+                            const void* samples) {
+  const Dataset& dataset = datasets_.at(dataset_id);
+  const auto& chunk_dims = dataset.chunk_dims_;
+  std::array<hsize_t, kDsDimsNum> offset;
+  for (size_t d = 0; d < kDsDimsNum; d++) {
+    offset.at(d) = (start.at(d) / chunk_dims.at(d)) * chunk_dims.at(d);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  size_t open_index = 0;
+  while ((open_index < open_chunks_.size()) &&
+         ((open_chunks_.at(open_index)->dataset_id_ != dataset_id) ||
+          (open_chunks_.at(open_index)->offset_ != offset))) {
+    open_index++;
+  }
+  if (open_index == open_chunks_.size()) {
+    Chunk* chunk = AcquireChunk(lock);
+    if (chunk == nullptr) {
+      dropped_symbols_++;
+      return false;
+    }
+    chunk->dataset_id_ = dataset_id;
+    chunk->offset_ = offset;
+    chunk->symbols_filled_ = 0;
+    // Frames are never cut, as the dataset is extended a chunk at a time.
+    // The last chunks of the other dimensions may stick out of the dataset.
+    chunk->symbols_expected_ = chunk_dims.at(0);
+    for (size_t d = 1; d < (kDsDimsNum - 1); d++) {
+      chunk->symbols_expected_ *= std::min(
+          chunk_dims.at(d), dataset.dims_.at(d) - offset.at(d));
+    }
+    std::fill_n(chunk->samples_.begin(),
+                dataset.chunk_samples_ * dataset.sample_bytes_, 0);
+    // AcquireChunk() may have dispatched an open chunk
+    open_index = open_chunks_.size();
+    open_chunks_.push_back(chunk);
+  }
+
+  Chunk* chunk = open_chunks_.at(open_index);
+  // Row major position of the symbol in the chunk
+  size_t symbol_index = 0;
+  for (size_t d = 0; d < (kDsDimsNum - 1); d++) {
+    symbol_index =
+        (symbol_index * chunk_dims.at(d)) + (start.at(d) - offset.at(d));
+  }
+  const size_t symbol_bytes = chunk_dims.back() * dataset.sample_bytes_;
+  if (non_temporal_) {
+    StreamingStore::Copy(&chunk->samples_.at(symbol_index * symbol_bytes),
+                         samples, symbol_bytes);
+  } else {
+    std::memcpy(&chunk->samples_.at(symbol_index * symbol_bytes), samples,
+                symbol_bytes);
+  }
+  chunk->symbols_filled_++;
+  if (chunk->symbols_filled_ == chunk->symbols_expected_) {
+    Dispatch(open_index);
+  }
+  return true;
+}
+
+void Hdf5ChunkWriter::ExtendDataset(
+    const std::string& dataset_name,
+    const std::array<hsize_t, kDsDimsNum>& extended_dims) {
+  std::lock_guard<std::mutex> lock(hdf5_mutex_);
+  hdf5_.ExtendDataset(dataset_name, extended_dims);
+}
+
+void Hdf5ChunkWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (open_chunks_.empty() == false) {
+    if (open_chunks_.front()->symbols_filled_ <
+        open_chunks_.front()->symbols_expected_) {
+      partial_chunks_++;
+    }
+    Dispatch(0);
+  }
+  free_cond_.wait(lock, [this] { return chunks_in_flight_ == 0; });
+
+  const size_t raw_bytes = raw_bytes_.load();
+  AGORA_LOG_INFO(
+      "Hdf5ChunkWriter: wrote %zu chunks (%zu partly filled, %zu failed), "
+      "%zu MB stored for %zu MB of samples (%.2f), %zu symbols dropped\n",
+      written_chunks_.load(), partial_chunks_, failed_chunks_.load(),
+      stored_bytes_.load() >> 20, raw_bytes >> 20,
+      (raw_bytes > 0) ? static_cast<double>(stored_bytes_.load()) / raw_bytes
+                      : 0.0,
+      dropped_symbols_);
+}
+
+void Hdf5ChunkWriter::Dispatch(size_t open_index) {
+  // The streamed symbols of the chunk before a writer thread takes it
+  if (non_temporal_) {
+    StreamingStore::Fence();
+  }
+  ready_chunks_.push_back(open_chunks_.at(open_index));
+  open_chunks_.erase(open_chunks_.begin() + open_index);
+  chunks_in_flight_++;
+  ready_cond_.notify_one();
+}
+
+Hdf5ChunkWriter::Chunk* Hdf5ChunkWriter::AcquireChunk(
+    std::unique_lock<std::mutex>& lock) {
+  if (free_chunks_.empty() && (chunks_in_flight_ == 0)) {
+    // Every chunk is open and waits for symbols, typically of frames with
+    // lost packets. Write the oldest one as it is to free it. Its missing
+    // symbols are dropped if they come later.
+    partial_chunks_++;
+    Dispatch(0);
+  }
+  if (free_chunks_.empty()) {
+    if (drop_when_full_) {
+      return nullptr;
+    }
+    // Backpressure on the recorder thread until a writer thread is done
+    free_cond_.wait(lock, [this] { return free_chunks_.empty() == false; });
+  }
+  Chunk* chunk = free_chunks_.back();
+  free_chunks_.pop_back();
+  return chunk;
+}
+
+void Hdf5ChunkWriter::WriterLoop() {
+  while (true) {
+    Chunk* chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_cond_.wait(
+          lock, [this] { return stop_ || (ready_chunks_.empty() == false); });
+      if (ready_chunks_.empty()) {
+        return;
+      }
+      chunk = ready_chunks_.front();
+      ready_chunks_.pop_front();
+    }
+    WriteChunk(*chunk);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_chunks_.push_back(chunk);
+      chunks_in_flight_--;
+    }
+    free_cond_.notify_all();
+  }
+}
+
+void Hdf5ChunkWriter::WriteChunk(Chunk& chunk) {
+  const Dataset& dataset = datasets_.at(chunk.dataset_id_);
+  const size_t num_samples = dataset.chunk_samples_;
+  const size_t raw_bytes = num_samples * dataset.sample_bytes_;
+  const uint8_t* samples = chunk.samples_.data();
+  uint8_t* stored = chunk.stored_.data();
+
+  // The chunk goes to the file as is, so do what the type conversion of the
+  // library and its filters would do: the datasets are big endian, and the
+  // shuffle filter stores the first (high) byte of all samples, then the
+  // second one. Neither changes int8 samples.
+  if (dataset.sample_bytes_ == 1) {
+    stored = chunk.samples_.data();
+  } else if (deflate_level_ > 0) {
+    for (size_t i = 0; i < num_samples; i++) {
+      stored[i] = samples[(2 * i) + 1];
+      stored[num_samples + i] = samples[2 * i];
+    }
+  } else {
+    for (size_t i = 0; i < num_samples; i++) {
+      stored[2 * i] = samples[(2 * i) + 1];
+      stored[(2 * i) + 1] = samples[2 * i];
+    }
+  }
+
+  const void* chunk_data = stored;
+  size_t chunk_bytes = raw_bytes;
+  if (deflate_level_ > 0) {
+    auto compressed_bytes = static_cast<uLongf>(chunk.compressed_.size());
+    if (::compress2(chunk.compressed_.data(), &compressed_bytes, stored,
+                    raw_bytes, static_cast<int>(deflate_level_)) != Z_OK) {
+      AGORA_LOG_ERROR("Hdf5ChunkWriter: failed to deflate a chunk of %s\n",
+                      dataset.name_.c_str());
+      failed_chunks_++;
+      return;
+    }
+    chunk_data = chunk.compressed_.data();
+    chunk_bytes = compressed_bytes;
+  }
+
+  herr_t ret;
+  {
+    std::lock_guard<std::mutex> lock(hdf5_mutex_);
+    ret = hdf5_.WriteChunk(dataset.name_, chunk.offset_, chunk_data,
+                           chunk_bytes);
+  }
+  if (ret < 0) {
+    failed_chunks_++;
+  } else {
+    written_chunks_++;
+    raw_bytes_ += raw_bytes;
+    stored_bytes_ += chunk_bytes;
+  }
+}
+};  // namespace Agora_recorder
@@ -0,0 +1,131 @@
+/**
+ * @file hdf5_chunk_writer.h
+ * @brief Gathers the rx symbols of the recorder into whole hdf5 chunks, which
+ * writer threads compress and write, off the recorder thread.
+ */
+#ifndef AGORA_HDF5_CHUNK_WRITER_H_
+#define AGORA_HDF5_CHUNK_WRITER_H_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdf5_lib.h"
+
+namespace Agora_recorder {
+
+class Hdf5ChunkWriter {
+ public:
+  /**
+   * @param hdf5 The file, which must outlive the writer. Once the writer
+   * exists, only call the file through the writer.
+   * @param num_threads Number of writer threads
+   * @param num_staging Number of chunks staged at a time, which bounds the
+   * memory of the writer
+   * @param max_chunk_bytes Bytes of the largest chunk of the datasets
+   * @param deflate_level Deflate level of the datasets, 0 for no filters
+   * @param drop_when_full Drop symbols when no staging chunk is free, instead
+   * of waiting for the writer threads
+   * @param non_temporal Copy the symbols into the staging chunks with
+   * non-temporal stores, as the writer threads read them on other cores
+   */
+  Hdf5ChunkWriter(Hdf5Lib& hdf5, size_t num_threads, size_t num_staging,
+                  size_t max_chunk_bytes, size_t deflate_level,
+                  bool drop_when_full, bool non_temporal = false);
+  ~Hdf5ChunkWriter();
+
+  /// Add a dataset of int16 (big endian) or int8 samples, as sample_bytes
+  /// tells, before the first Write(). The chunk dims must be the ones the
+  /// dataset was created with, without a filter or with the deflate level of
+  /// the writer. Returns the id of the dataset.
+  size_t AddDataset(const std::string& name,
+                    const std::array<hsize_t, kDsDimsNum>& chunk_dims,
+                    const std::array<hsize_t, kDsDimsNum>& dims,
+                    size_t sample_bytes = sizeof(short));
+
+  /**
+   * @brief Copy one symbol (start, with a count of 1 in all but the last
+   * dimension) into its staged chunk. The chunk is sent to the writer
+   * threads as soon as all its symbols are in.
+   * @return False if the symbol was dropped
+   */
+  bool Write(size_t dataset_id, const std::array<hsize_t, kDsDimsNum>& start,
+             const void* samples);
+
+  /// Hdf5Lib::ExtendDataset, in between the writes of the writer threads
+  void ExtendDataset(const std::string& dataset_name,
+                     const std::array<hsize_t, kDsDimsNum>& extended_dims);
+
+  /// Send the partially filled chunks to the writer threads and wait until
+  /// every chunk is written
+  void Flush();
+
+ private:
+  struct Dataset {
+    std::string name_;
+    std::array<hsize_t, kDsDimsNum> chunk_dims_;
+    std::array<hsize_t, kDsDimsNum> dims_;
+    size_t chunk_samples_;
+    size_t sample_bytes_;
+  };
+
+  struct Chunk {
+    size_t dataset_id_;
+    // Start of the chunk in the dataset
+    std::array<hsize_t, kDsDimsNum> offset_;
+    size_t symbols_filled_;
+    size_t symbols_expected_;
+    std::vector<uint8_t> samples_;
+    // The int16 samples in the byte order of the file (big endian), byte
+    // shuffled if deflated, then the deflated chunk
+    std::vector<uint8_t> stored_;
+    std::vector<uint8_t> compressed_;
+  };
+
+  void WriterLoop();
+  // Shuffle and deflate the chunk (if enabled), then write it to the file
+  void WriteChunk(Chunk& chunk);
+  // Queue a staged chunk for the writer threads. Needs mutex_.
+  void Dispatch(size_t open_index);
+  // A free chunk, or nullptr if the symbol must be dropped. Needs lock.
+  Chunk* AcquireChunk(std::unique_lock<std::mutex>& lock);
+
+  Hdf5Lib& hdf5_;
+  const size_t deflate_level_;
+  const bool drop_when_full_;
+  const bool non_temporal_;
+
+  std::vector<Dataset> datasets_;
+  // Every staging chunk, then the free / open / queued ones
+  std::vector<Chunk> chunks_;
+  std::vector<Chunk*> free_chunks_;
+  std::vector<Chunk*> open_chunks_;
+  std::deque<Chunk*> ready_chunks_;
+  // Chunks queued or being written
+  size_t chunks_in_flight_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_cond_;
+  std::condition_variable free_cond_;
+  // Serializes the calls into the hdf5 library
+  std::mutex hdf5_mutex_;
+  bool stop_;
+  std::vector<std::thread> threads_;
+
+  // Counters, logged by Flush()
+  size_t dropped_symbols_;
+  size_t partial_chunks_;
+  std::atomic<size_t> written_chunks_;
+  std::atomic<size_t> failed_chunks_;
+  std::atomic<size_t> raw_bytes_;
+  std::atomic<size_t> stored_bytes_;
+};
+};  // namespace Agora_recorder
+
+#endif  // AGORA_HDF5_CHUNK_WRITER_H_
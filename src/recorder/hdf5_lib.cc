@@ -51,7 +51,7 @@ void Hdf5Lib::CreateDataset(const std::string& dataset_name,
                             const std::array<hsize_t, kDsDimsNum>& chunk_dims,
                             const std::array<hsize_t, kDsDimsNum>& init_dims,
                             const ssize_t extend_dimension,
-                            const H5::PredType& type) {
+                            const H5::PredType& type, size_t deflate_level) {
   const std::string create_ds_name("/" + group_name_ + "/" + dataset_name);
   std::array<hsize_t, kDsDimsNum> max_ds_dims = init_dims;
   if ((extend_dimension >= 0) &&
@@ -65,6 +65,12 @@ void Hdf5Lib::CreateDataset(const std::string& dataset_name,
                                max_ds_dims.data());
     H5::DSetCreatPropList ds_prop;
     ds_prop.setChunk(kDsDimsNum, chunk_dims.data());
+    if (deflate_level > 0) {
+      // Shuffle the bytes of the samples first, so that the (mostly equal)
+      // high bytes compress together
+      ds_prop.setShuffle();
+      ds_prop.setDeflate(static_cast<int>(deflate_level));
+    }
     //ds_prop.setFillValue(type, &fill_val);
     datasets_.emplace_back(std::make_unique<H5::DataSet>(
         file_->createDataSet(create_ds_name, type, ds_dataspace, ds_prop)));
@@ -239,6 +245,77 @@ herr_t Hdf5Lib::WriteDataset(const std::string& dataset_name,
   return ret;
 }
 
+herr_t Hdf5Lib::WriteDataset(const std::string& dataset_name,
+                             const std::array<hsize_t, kDsDimsNum>& start,
+                             const std::array<hsize_t, kDsDimsNum>& count,
+                             const int8_t* wrt_data) {
+  const std::string ds_name("/" + group_name_ + "/" + dataset_name);
+  const size_t ds_id = ds_name_id_.at(dataset_name);
+  herr_t ret = 0;
+  AGORA_LOG_TRACE("WriteDataset: %s\n", dataset_name.c_str());
+
+  auto& current_dataset = datasets_.at(ds_id);
+  // Select a hyperslab in extended portion of the dataset
+  try {
+    H5::DataSpace working_space = current_dataset->getSpace();
+    ///Select the hyperslab
+    working_space.selectHyperslab(H5S_SELECT_SET, count.data(), start.data());
+
+    // define memory space (wrt / chunk)
+    H5::DataSpace mem_space(kDsDimsNum, count.data(), nullptr);
+    // Write the data to the hyperslab
+    current_dataset->write(wrt_data, H5::PredType::NATIVE_INT8, mem_space,
+                           working_space);
+    mem_space.close();
+  }
+  // catch failure caused by the DataSet operations
+  catch (H5::DataSetIException& error) {
+    H5::DataSetIException::printErrorStack();
+
+    AGORA_LOG_WARN(
+        "DataSet: Failed to write to dataset at primary dim index: %llu\n",
+        start.at(kDExtendDimIdx));
+
+    const int ndims = datasets_.at(ds_id)->getSpace().getSimpleExtentNdims();
+
+    std::stringstream ss;
+    ss.str(std::string());
+    ss << "\nRequested Write Dimension is: " << ndims;
+    for (size_t i = 0; i < (kDsDimsNum - 1); ++i) {
+      ss << start.at(i) << ", ";
+    }
+    ss << start.at(kDsDimsNum - 1);
+    AGORA_LOG_TRACE("%s\n", ss.str().c_str());
+    ret = -1;
+    throw;
+  }
+  // catch failure caused by the DataSpace operations
+  catch (H5::DataSpaceIException& error) {
+    H5::DataSpaceIException::printErrorStack();
+    ret = -1;
+    throw;
+  }
+  return ret;
+}
+
+herr_t Hdf5Lib::WriteChunk(const std::string& dataset_name,
+                           const std::array<hsize_t, kDsDimsNum>& offset,
+                           const void* chunk_data, size_t chunk_bytes) {
+  const size_t ds_id = ds_name_id_.at(dataset_name);
+  // All the filters of the dataset were applied to chunk_data
+  static constexpr uint32_t kFilterMask = 0;
+  const herr_t ret =
+      H5Dwrite_chunk(datasets_.at(ds_id)->getId(), H5P_DEFAULT, kFilterMask,
+                     offset.data(), chunk_bytes, chunk_data);
+  if (ret < 0) {
+    AGORA_LOG_WARN(
+        "WriteChunk: Failed to write to %s dataset at primary dim index: "
+        "%llu\n",
+        dataset_name.c_str(), offset.at(kDExtendDimIdx));
+  }
+  return ret;
+}
+
 void Hdf5Lib::WriteAttribute(const char name[], double val) {
   hsize_t dims[] = {1};
   H5::DataSpace attr_ds = H5::DataSpace(1, dims);
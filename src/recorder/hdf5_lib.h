@@ -13,8 +13,11 @@ Copyright (c) 2018-2022
 #include <algorithm>
 #include <array>
 #include <complex>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "H5Cpp.h"
 
@@ -30,7 +33,8 @@ class Hdf5Lib {
                      const std::array<hsize_t, kDsDimsNum>& chunk_dims,
                      const std::array<hsize_t, kDsDimsNum>& init_dims,
                      const ssize_t extend_dimension = 0,
-                     const H5::PredType& type = H5::PredType::STD_I16BE);
+                     const H5::PredType& type = H5::PredType::STD_I16BE,
+                     size_t deflate_level = 0);
   void FinalizeDataset(const std::string& dataset_name);
 
   void ExtendDataset(const std::string& dataset_name,
@@ -45,6 +49,17 @@ class Hdf5Lib {
                       const std::array<hsize_t, kDsDimsNum>& count,
                       const float* wrt_data);
 
+  herr_t WriteDataset(const std::string& dataset_name,
+                      const std::array<hsize_t, kDsDimsNum>& start,
+                      const std::array<hsize_t, kDsDimsNum>& count,
+                      const int8_t* wrt_data);
+
+  ///Write a whole chunk as stored in the file, i.e., after the filters of
+  ///the dataset. offset is the start of the chunk in the dataset.
+  herr_t WriteChunk(const std::string& dataset_name,
+                    const std::array<hsize_t, kDsDimsNum>& offset,
+                    const void* chunk_data, size_t chunk_bytes);
+
   void WriteAttribute(const char name[], double val);
   void WriteAttribute(const char name[], const std::vector<double>& val);
   void WriteAttribute(const char name[],
@@ -0,0 +1,92 @@
+/*
+ Copyright (c) 2018-2022, Rice University
+ RENEW OPEN SOURCE LICENSE: http://renew-wireless.org/license
+
+----------------------------------------------------------------------
+ Implementation of Hdf5Reader API Class
+---------------------------------------------------------------------
+*/
+#include "hdf5_reader.h"
+
+#include "logger.h"
+#include "utils.h"
+
+namespace Agora_recorder {
+
+Hdf5Reader::Hdf5Reader(const std::string& hdf5_name,
+                       const std::string& group_name) {
+  H5::Exception::dontPrint();
+  try {
+    file_ = std::make_unique<H5::H5File>(hdf5_name, H5F_ACC_RDONLY);
+    group_ = std::make_unique<H5::Group>(file_->openGroup("/" + group_name));
+  } catch (H5::Exception& error) {
+    AGORA_LOG_ERROR("Hdf5Reader: Failed to open group %s of %s\n",
+                    group_name.c_str(), hdf5_name.c_str());
+    throw std::runtime_error("Hdf5Reader: Failed to open " + hdf5_name);
+  }
+}
+
+Hdf5Reader::~Hdf5Reader() {
+  for (auto& dataset : datasets_) {
+    dataset.second.close();
+  }
+  datasets_.clear();
+  group_->close();
+  file_->close();
+}
+
+bool Hdf5Reader::HasDataset(const std::string& dataset_name) const {
+  return group_->nameExists(dataset_name);
+}
+
+H5::DataSet& Hdf5Reader::Dataset(const std::string& dataset_name) {
+  auto dataset = datasets_.find(dataset_name);
+  if (dataset == datasets_.end()) {
+    RtAssert(HasDataset(dataset_name),
+             "Hdf5Reader: No dataset " + dataset_name);
+    dataset =
+        datasets_.emplace(dataset_name, group_->openDataSet(dataset_name))
+            .first;
+  }
+  return dataset->second;
+}
+
+std::array<hsize_t, kDsDimsNum> Hdf5Reader::DatasetDims(
+    const std::string& dataset_name) {
+  H5::DataSpace space = Dataset(dataset_name).getSpace();
+  RtAssert(space.getSimpleExtentNdims() == static_cast<int>(kDsDimsNum),
+           "Hdf5Reader: Unexpected rank of dataset " + dataset_name);
+  std::array<hsize_t, kDsDimsNum> dims;
+  space.getSimpleExtentDims(dims.data());
+  return dims;
+}
+
+void Hdf5Reader::ReadDataset(const std::string& dataset_name,
+                             const std::array<hsize_t, kDsDimsNum>& start,
+                             const std::array<hsize_t, kDsDimsNum>& count,
+                             short* data) {
+  H5::DataSet& dataset = Dataset(dataset_name);
+  try {
+    H5::DataSpace file_space = dataset.getSpace();
+    file_space.selectHyperslab(H5S_SELECT_SET, count.data(), start.data());
+    H5::DataSpace mem_space(kDsDimsNum, count.data(), nullptr);
+    dataset.read(data, H5::PredType::NATIVE_INT16, mem_space, file_space);
+  } catch (H5::Exception& error) {
+    H5::Exception::printErrorStack();
+    AGORA_LOG_ERROR(
+        "Hdf5Reader: Failed to read %s dataset at primary dim index: %llu\n",
+        dataset_name.c_str(), start.at(0));
+    throw std::runtime_error("Hdf5Reader: Failed to read " + dataset_name);
+  }
+}
+
+bool Hdf5Reader::ReadAttribute(const char name[], size_t& val) const {
+  if (group_->attrExists(name) == false) {
+    return false;
+  }
+  uint32_t val_uint;
+  group_->openAttribute(name).read(H5::PredType::NATIVE_UINT, &val_uint);
+  val = val_uint;
+  return true;
+}
+};  // End namespace Agora_recorder
@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2018-2022
+ RENEW OPEN SOURCE LICENSE: http://renew-wireless.org/license
+ 
+----------------------------------------------------------------------
+ API to read the datasets of an hdf5 trace written by Hdf5Lib
+---------------------------------------------------------------------
+*/
+
+#ifndef AGORA_HDF5READER_H_
+#define AGORA_HDF5READER_H_
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "H5Cpp.h"
+#include "hdf5_lib.h"
+
+namespace Agora_recorder {
+
+class Hdf5Reader {
+ public:
+  /// Open the group of an existing file, read only
+  Hdf5Reader(const std::string& hdf5_name, const std::string& group_name);
+  ~Hdf5Reader();
+
+  bool HasDataset(const std::string& dataset_name) const;
+  std::array<hsize_t, kDsDimsNum> DatasetDims(
+      const std::string& dataset_name);
+
+  ///Read the hyperslab count at start of a dataset to data, as native int16
+  void ReadDataset(const std::string& dataset_name,
+                   const std::array<hsize_t, kDsDimsNum>& start,
+                   const std::array<hsize_t, kDsDimsNum>& count, short* data);
+
+  ///False if the group has no such attribute
+  bool ReadAttribute(const char name[], size_t& val) const;
+
+ private:
+  H5::DataSet& Dataset(const std::string& dataset_name);
+
+  std::unique_ptr<H5::H5File> file_;
+  std::unique_ptr<H5::Group> group_;
+  std::map<std::string, H5::DataSet> datasets_;
+};
+};      // namespace Agora_recorder
+#endif  // AGORA_HDF5READER_H_
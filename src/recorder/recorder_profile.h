@@ -0,0 +1,82 @@
+/**
+ * @file recorder_profile.h
+ * @brief The rx symbols a recorder worker records, and the format it writes
+ * them in: the recorder_antennas, recorder_symbols,
+ * recorder_frame_decimation and recorder_sample_format of the config.
+ */
+#ifndef AGORA_RECORDER_PROFILE_H_
+#define AGORA_RECORDER_PROFILE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "config.h"
+#include "message.h"
+#include "packed_iq.h"
+#include "utils.h"
+
+namespace Agora_recorder {
+
+class RecorderProfile {
+ public:
+  /// The profile of a worker of num_antennas antennas from antenna_offset
+  RecorderProfile(const Config* cfg, size_t antenna_offset,
+                  size_t num_antennas)
+      : cfg_(cfg),
+        first_antenna_(
+            std::max(antenna_offset, cfg->RecorderAntennas().at(0))),
+        end_antenna_(std::min(
+            antenna_offset + num_antennas,
+            // Saturated, as the default count is SIZE_MAX
+            cfg->RecorderAntennas().at(0) +
+                std::min(cfg->RecorderAntennas().at(1),
+                         SIZE_MAX - cfg->RecorderAntennas().at(0)))),
+        num_values_(2 * cfg->SampsPerSymbol()),
+        packed_(PackedIqBytes(num_values_, cfg->RecorderSampleFormat())) {
+    RtAssert(first_antenna_ < end_antenna_,
+             "recorder_antennas holds no antenna of the recorder");
+  }
+
+  /// True if the rx symbol of pkt is recorded
+  inline bool Records(const Packet* pkt) const {
+    return ((pkt->frame_id_ % cfg_->RecorderFrameDecimation()) == 0) &&
+           (pkt->ant_id_ >= first_antenna_) && (pkt->ant_id_ < end_antenna_) &&
+           cfg_->RecorderRecordsSymbol(cfg_->GetSymbolType(pkt->symbol_id_));
+  }
+
+  /// Position of a recorded frame among the recorded frames
+  inline size_t FrameIndex(size_t frame_id) const {
+    return frame_id / cfg_->RecorderFrameDecimation();
+  }
+  inline size_t FirstAntenna() const { return first_antenna_; }
+  inline size_t NumAntennas() const { return end_antenna_ - first_antenna_; }
+  inline IqFormat Format() const { return cfg_->RecorderSampleFormat(); }
+  /// Bytes of a recorded sample value: 2 for int16, 1 for the int8 formats
+  inline size_t SampleBytes() const {
+    return (Format() == IqFormat::kInt16) ? sizeof(short) : 1;
+  }
+  /// Bytes of a recorded rx symbol
+  inline size_t SymbolBytes() const { return packed_.size(); }
+
+  /// The samples of an rx symbol in the recorded format. Requantized ones
+  /// are in a buffer of the profile, which holds until the next call.
+  inline const void* Pack(const short* samples) {
+    if (Format() == IqFormat::kInt16) {
+      return samples;
+    }
+    PackIq(samples, packed_.data(), num_values_, Format());
+    return packed_.data();
+  }
+
+ private:
+  const Config* cfg_;
+  const size_t first_antenna_;
+  const size_t end_antenna_;
+  // int16 values (I and Q) of an rx symbol
+  const size_t num_values_;
+  std::vector<uint8_t> packed_;
+};
+};  // namespace Agora_recorder
+
+#endif  // AGORA_RECORDER_PROFILE_H_
@@ -9,11 +9,18 @@
 
 #include "recorder_thread.h"
 
+#include <cstdio>
+#include <string>
+#include <utility>
+
 #include "logger.h"
 #include "message.h"
 #include "utils.h"
 
 namespace Agora_recorder {
+static const std::vector<std::string> kCaptureTriggerNames = {
+    "crc burst", "deadline miss", "evm drop", "signal"};
+
 RecorderThread::RecorderThread(
     const Config* in_cfg, size_t thread_id, int core, size_t queue_size,
     size_t antenna_offset, size_t num_antennas, size_t interval,
@@ -23,6 +30,9 @@ RecorderThread::RecorderThread(
     : event_queue_(queue_size),
       producer_token_(event_queue_),
       id_(thread_id),
+      cfg_(in_cfg),
+      antenna_offset_(antenna_offset),
+      num_antennas_(num_antennas),
       core_alloc_(core),
       wait_signal_(wait_signal) {
   /// Create Workers
@@ -91,6 +101,38 @@ bool RecorderThread::DispatchWork(const EventData& event) {
   return ret;
 }
 
+void RecorderThread::EnableCapture(size_t num_frames) {
+  RtAssert(running_ == false, "EnableCapture() must be called before Start()");
+  capture_ring_ = std::make_unique<CaptureRing>(
+      num_frames, cfg_->Frame().NumTotalSyms() * num_antennas_,
+      cfg_->PacketLength());
+  AGORA_LOG_INFO("Recorder: capturing the last %zu frames until a trigger\n",
+                 num_frames);
+}
+
+void RecorderThread::AddCaptureTable(const std::string& name,
+                                     std::vector<const void*> frame_data,
+                                     size_t frame_bytes,
+                                     std::vector<uint8_t> header) {
+  RtAssert(capture_ring_ != nullptr,
+           "AddCaptureTable() must be called after EnableCapture()");
+  RtAssert(frame_data.empty() == false, "Capture table without frames");
+  capture_ring_->AddTable(name, frame_bytes);
+  capture_sources_.push_back(std::move(frame_data));
+  capture_headers_.push_back(std::move(header));
+}
+
+bool RecorderThread::CaptureFrame(size_t frame_id) {
+  return DispatchWork(EventData(EventType::kCaptureFrame, frame_id));
+}
+
+bool RecorderThread::TriggerCapture(size_t frame_id, CaptureTrigger reason) {
+  EventData event(EventType::kCaptureTrigger, frame_id);
+  event.num_tags_ = 2;
+  event.tags_.at(1) = static_cast<size_t>(reason);
+  return DispatchWork(event);
+}
+
 void RecorderThread::DoRecording() {
   // Sync the start
   {
@@ -141,14 +183,83 @@ void RecorderThread::DoRecording() {
 void RecorderThread::HandleEvent(const EventData& event) {
   if (event.event_type_ == EventType::kThreadTermination) {
     running_ = false;
+  } else if (event.event_type_ == EventType::kCaptureFrame) {
+    SaveCaptureTables(event.tags_[0u]);
+  } else if (event.event_type_ == EventType::kCaptureTrigger) {
+    WriteCapture(event.tags_[0u], static_cast<CaptureTrigger>(event.tags_[1u]));
   } else {
     auto* rx_packet = rx_tag_t(event.tags_[0u]).rx_packet_;
     if (event.event_type_ == EventType::kPacketRX) {
-      for (auto& worker : workers_) {
-        worker->Record(rx_packet->RawPacket());
+      // The recorder holds a reference on the packet, so it records the
+      // samples in place, even those of zero-copy rx packets
+      const Packet* pkt = rx_packet->RawPacket();
+      if (capture_ring_ != nullptr) {
+        capture_ring_->SavePacket(pkt, rx_packet->Samples(),
+                                  (pkt->symbol_id_ * num_antennas_) +
+                                      (pkt->ant_id_ - antenna_offset_));
+      } else {
+        for (auto& worker : workers_) {
+          worker->Record(pkt, rx_packet->Samples());
+        }
       }
     }
     rx_packet->Free();
   }
 }
+
+void RecorderThread::SaveCaptureTables(size_t frame_id) {
+  // The tables of a frame stay in their slot of the frame window until the
+  // packets of the frame one window later arrive, so this thread must not
+  // lag that far behind the frames
+  for (size_t table = 0; table < capture_sources_.size(); table++) {
+    const auto& frame_data = capture_sources_.at(table);
+    capture_ring_->SaveTable(table, frame_id,
+                             frame_data.at(frame_id % frame_data.size()));
+  }
+}
+
+void RecorderThread::WriteCapture(size_t frame_id, CaptureTrigger reason) {
+  const auto frames = capture_ring_->Frames(frame_id);
+  if (frames.empty()) {
+    AGORA_LOG_WARN("Recorder: %s capture at frame %zu holds no frames\n",
+                   kCaptureTriggerNames.at(static_cast<size_t>(reason)).c_str(),
+                   frame_id);
+    return;
+  }
+  AGORA_LOG_INFO("Recorder: %s capture at frame %zu, writing frames %zu-%zu\n",
+                 kCaptureTriggerNames.at(static_cast<size_t>(reason)).c_str(),
+                 frame_id, frames.front(), frames.back());
+
+  for (const size_t frame : frames) {
+    capture_ring_->ForEachPacket(frame, [this](const Packet* pkt) {
+      for (auto& worker : workers_) {
+        worker->Record(pkt, pkt->data_);
+      }
+    });
+    for (size_t table = 0; table < capture_ring_->NumTables(); table++) {
+      const void* data = capture_ring_->Table(table, frame);
+      if (data == nullptr) {
+        continue;
+      }
+      const std::string filename = kOutputFilePath + "capture_" +
+                                   capture_ring_->TableName(table) + "_F" +
+                                   std::to_string(frame) + ".bin";
+      auto* fp = std::fopen(filename.c_str(), "wb");
+      if (fp == nullptr) {
+        AGORA_LOG_ERROR("Recorder: failed to open %s for writing\n",
+                        filename.c_str());
+        continue;
+      }
+      const auto& header = capture_headers_.at(table);
+      const size_t bytes = capture_ring_->TableBytes(table);
+      if ((std::fwrite(header.data(), 1, header.size(), fp) !=
+           header.size()) ||
+          (std::fwrite(data, 1, bytes, fp) != bytes)) {
+        AGORA_LOG_ERROR("Recorder: failed to write %s\n", filename.c_str());
+      }
+      std::fclose(fp);
+    }
+  }
+  capture_ring_->Release(frames.back());
+}
 };  // End namespace Agora_recorder
\ No newline at end of file
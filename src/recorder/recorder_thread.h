@@ -10,14 +10,26 @@ Event based message queue thread class for the recorder worker
 #define AGORA_RECORDER_THREAD_H_
 
 #include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
+#include "capture_ring.h"
 #include "concurrentqueue.h"
 #include "recorder_worker.h"
 
 namespace Agora_recorder {
 
+/// What fired a capture, see RecorderThread::TriggerCapture()
+enum class CaptureTrigger : size_t {
+  kCrcBurst,
+  kDeadlineMiss,
+  kEvmDrop,
+  kSignal
+};
+
 class RecorderThread {
  public:
   RecorderThread(const Config *in_cfg, size_t thread_id, int core,
@@ -31,11 +43,38 @@ class RecorderThread {
   void Stop();
   bool DispatchWork(const EventData &event);
 
+  /**
+   * @brief Keep the rx packets of the last num_frames frames in memory
+   * instead of recording them, until TriggerCapture(). Call before Start().
+   */
+  void EnableCapture(size_t num_frames);
+
+  /**
+   * @brief Also keep a per-frame table in the capture, written out as
+   * capture_<name>_F<frame>.bin. Call after EnableCapture(), before Start().
+   * @param frame_data The table of frame f is frame_bytes at
+   * frame_data[f % frame_data.size()]
+   * @param header Written at the start of each file, before the table
+   */
+  void AddCaptureTable(const std::string &name,
+                       std::vector<const void *> frame_data,
+                       size_t frame_bytes,
+                       std::vector<uint8_t> header = {});
+
+  /// Copy the capture tables of frame_id, once the frame is processed and
+  /// before its frame window slot is reused
+  bool CaptureFrame(size_t frame_id);
+
+  /// Write out the frames of the capture up to frame_id, then start over
+  bool TriggerCapture(size_t frame_id, CaptureTrigger reason);
+
  private:
   /*Main threading loop */
   void DoRecording();
   void HandleEvent(const EventData &event);
   void Finalize();
+  void SaveCaptureTables(size_t frame_id);
+  void WriteCapture(size_t frame_id, CaptureTrigger reason);
 
   // 1 - Producer (dispatcher), 1 - Consumer
   moodycamel::ConcurrentQueue<EventData> event_queue_;
@@ -44,11 +83,19 @@ class RecorderThread {
   std::thread thread_;
 
   size_t id_;
+  const Config *cfg_;
+  size_t antenna_offset_;
+  size_t num_antennas_;
 
   /* >= 0 to assign a core to the thread
    * <0   to disable thread core assignment */
   int core_alloc_;
 
+  // The capture, if EnableCapture(), and where its tables are copied from
+  std::unique_ptr<CaptureRing> capture_ring_;
+  std::vector<std::vector<const void *>> capture_sources_;
+  std::vector<std::vector<uint8_t>> capture_headers_;
+
   /* Synchronization for startup and sleeping */
   /* Setting wait signal to false will disable the thread waiting on new message
    * may cause excessive CPU load for infrequent messages.
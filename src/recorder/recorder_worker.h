@@ -26,7 +26,9 @@ class RecorderWorker {
   virtual ~RecorderWorker() = default;
 
   virtual void Init() = 0;
-  virtual int Record(const Packet* pkg) = 0;
+  /// Record the samples of a packet, which are not always in pkt->data_
+  /// (e.g., zero-copy rx packets), see RxPacket::Samples()
+  virtual int Record(const Packet* pkt, const short* samples) = 0;
   virtual void Finalize() = 0;
 
   virtual size_t NumAntennas() const { return 0; }
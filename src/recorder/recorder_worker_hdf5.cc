@@ -5,6 +5,7 @@
 
 #include "recorder_worker_hdf5.h"
 
+#include <algorithm>
 #include <ctime>
 #include <fstream>
 #include <nlohmann/json.hpp>
@@ -19,6 +20,8 @@ namespace Agora_recorder {
 static constexpr bool kDebugPrint = false;
 static constexpr size_t kFrameInc = 2000;
 static constexpr ssize_t kFixedDimensions = -1;
+// The frame dimension of the rx datasets is extendable
+static constexpr ssize_t kDExtendDimIdx = 0;
 static const std::string kHdf5Group = "Data";
 
 static constexpr size_t kBeaconDatasetIndex = 0;
@@ -38,9 +41,14 @@ RecorderWorkerHDF5::RecorderWorkerHDF5(const Config* in_cfg,
       num_antennas_(num_antennas),
       interval_(record_interval),
       rx_direction_(rx_direction),
+      profile_(in_cfg, antenna_offset, num_antennas),
       max_frame_number_(0),
-      data_chunk_dims_{
-          {1, 1, 1, 1, static_cast<hsize_t>(2 * cfg_->SampsPerSymbol())}} {}
+      data_chunk_dims_{{1, 1, 1, 1,
+                        static_cast<hsize_t>(profile_.SymbolBytes() /
+                                             profile_.SampleBytes())}},
+      frame_inc_(((kFrameInc + cfg_->RecorderChunk().at(0) - 1) /
+                  cfg_->RecorderChunk().at(0)) *
+                 cfg_->RecorderChunk().at(0)) {}
 
 RecorderWorkerHDF5::~RecorderWorkerHDF5() = default;
 
@@ -127,10 +135,21 @@ void RecorderWorkerHDF5::Init() {
   // Beacon Antenna
   hdf5_->WriteAttribute("BS_BEACON_ANT", cfg_->BeaconAnt());
 
-  hdf5_->WriteAttribute("ANT_OFFSET", antenna_offset_);
-  hdf5_->WriteAttribute("ANT_NUM", num_antennas_);
+  // The recorded antennas of the rx datasets
+  hdf5_->WriteAttribute("ANT_OFFSET", profile_.FirstAntenna());
+  hdf5_->WriteAttribute("ANT_NUM", profile_.NumAntennas());
   hdf5_->WriteAttribute("ANT_TOTAL", cfg_->BsAntNum());
 
+  // The rx datasets hold one frame out of FRAME_DECIMATION, and int8 samples
+  // with a shift per RX_SAMPLE_BLOCK values if RX_SAMPLE_FORMAT is int8 or
+  // bfp (packed_iq.h)
+  hdf5_->WriteAttribute("FRAME_DECIMATION", cfg_->RecorderFrameDecimation());
+  hdf5_->WriteAttribute("RX_SAMPLE_FORMAT", IqFormatName(profile_.Format()));
+  hdf5_->WriteAttribute("RX_SAMPLE_BLOCK",
+                        (profile_.Format() == IqFormat::kBfp)
+                            ? kPackedIqBlock
+                            : 2 * cfg_->SampsPerSymbol());
+
   // Number of symbols in a frame
   hdf5_->WriteAttribute("BS_FRAME_LEN", cfg_->Frame().NumTotalSyms());
 
@@ -231,26 +250,11 @@ void RecorderWorkerHDF5::Init() {
 
   if (rx_direction_ == Direction::kDownlink) {
     if (cfg_->Frame().NumBeaconSyms() > 0) {
-      datasets_.emplace_back(
-          std::make_pair<std::string, std::array<hsize_t, kDsDimsNum>>(
-              std::string("BeaconData"),
-              {kFrameInc, cfg_->NumCells(), cfg_->Frame().NumBeaconSyms(),
-               num_antennas_, data_chunk_dims_.back()}));
-      auto& current_dataset = datasets_.back();
-      hdf5_->CreateDataset(current_dataset.first, data_chunk_dims_,
-                           current_dataset.second);
+      CreateRxDataset("BeaconData", cfg_->Frame().NumBeaconSyms());
     }
 
     if (cfg_->Frame().NumDLSyms() > 0) {
-      datasets_.emplace_back(
-          std::make_pair<std::string, std::array<hsize_t, kDsDimsNum>>(
-              std::string("DownlinkData"),
-              {kFrameInc, cfg_->NumCells(), cfg_->Frame().NumDLSyms(),
-               num_antennas_, data_chunk_dims_.back()}));
-
-      auto& current_dataset = datasets_.back();
-      hdf5_->CreateDataset(current_dataset.first, data_chunk_dims_,
-                           current_dataset.second);
+      CreateRxDataset("DownlinkData", cfg_->Frame().NumDLSyms());
 
       //Adding the ground truths as a DataSet
       {  //TxData
@@ -316,25 +320,11 @@ void RecorderWorkerHDF5::Init() {
     }  // end cfg_->Frame().NumDLSyms() > 0
   } else {
     if (cfg_->Frame().NumPilotSyms() > 0) {
-      datasets_.emplace_back(
-          std::make_pair<std::string, std::array<hsize_t, kDsDimsNum>>(
-              std::string("Pilot_Samples"),
-              {kFrameInc, cfg_->NumCells(), cfg_->Frame().NumPilotSyms(),
-               num_antennas_, data_chunk_dims_.back()}));
-      auto& current_dataset = datasets_.back();
-      hdf5_->CreateDataset(current_dataset.first, data_chunk_dims_,
-                           current_dataset.second);
+      CreateRxDataset("Pilot_Samples", cfg_->Frame().NumPilotSyms());
     }
 
     if (cfg_->Frame().NumULSyms() > 0) {
-      datasets_.emplace_back(
-          std::make_pair<std::string, std::array<hsize_t, kDsDimsNum>>(
-              std::string("UplinkData"),
-              {kFrameInc, cfg_->NumCells(), cfg_->Frame().NumULSyms(),
-               num_antennas_, data_chunk_dims_.back()}));
-      auto& current_dataset = datasets_.back();
-      hdf5_->CreateDataset(current_dataset.first, data_chunk_dims_,
-                           current_dataset.second);
+      CreateRxDataset("UplinkData", cfg_->Frame().NumULSyms());
 
       //Adding the ground truths as a DataSet
       {
@@ -369,16 +359,64 @@ void RecorderWorkerHDF5::Init() {
       }
     }
   }
+
+  if (cfg_->RecorderWriterThreads() > 0) {
+    size_t max_chunk_samples = 0;
+    for (const auto& dataset : datasets_) {
+      size_t chunk_samples = 1;
+      for (const auto dim : RxChunkDims(dataset.second.at(2))) {
+        chunk_samples *= dim;
+      }
+      max_chunk_samples = std::max(max_chunk_samples, chunk_samples);
+    }
+    chunk_writer_ = std::make_unique<Hdf5ChunkWriter>(
+        *hdf5_, cfg_->RecorderWriterThreads(), cfg_->RecorderStagingChunks(),
+        max_chunk_samples * profile_.SampleBytes(),
+        cfg_->RecorderCompression(), cfg_->RecorderDropWhenFull(),
+        cfg_->NtStores("recorder"));
+    for (const auto& dataset : datasets_) {
+      chunk_writer_->AddDataset(dataset.first,
+                                RxChunkDims(dataset.second.at(2)),
+                                dataset.second, profile_.SampleBytes());
+    }
+  }
+}
+
+void RecorderWorkerHDF5::Finalize() {
+  chunk_writer_.reset();
+  hdf5_.reset();
+}
+
+std::array<hsize_t, kDsDimsNum> RecorderWorkerHDF5::RxChunkDims(
+    size_t num_symbols) const {
+  const auto& chunk = cfg_->RecorderChunk();
+  return {chunk.at(0), 1, std::min(chunk.at(1), num_symbols),
+          std::min(chunk.at(2), profile_.NumAntennas()),
+          data_chunk_dims_.back()};
 }
 
-void RecorderWorkerHDF5::Finalize() { hdf5_.reset(); }
+void RecorderWorkerHDF5::CreateRxDataset(const std::string& name,
+                                         size_t num_symbols) {
+  datasets_.emplace_back(
+      name, std::array<hsize_t, kDsDimsNum>{frame_inc_, cfg_->NumCells(),
+                                            num_symbols, profile_.NumAntennas(),
+                                            data_chunk_dims_.back()});
+  hdf5_->CreateDataset(name, RxChunkDims(num_symbols), datasets_.back().second,
+                       kDExtendDimIdx,
+                       (profile_.Format() == IqFormat::kInt16)
+                           ? H5::PredType::STD_I16BE
+                           : H5::PredType::STD_I8BE,
+                       cfg_->RecorderCompression());
+}
 
 void RecorderWorkerHDF5::WriteDatasetValue(const Packet* pkt,
+                                           const short* samples,
                                            size_t symbol_index,
                                            size_t dataset_index) {
-  const size_t frame_id = pkt->frame_id_;
+  // The datasets hold the recorded frames and antennas only
+  const size_t frame_id = profile_.FrameIndex(pkt->frame_id_);
   const size_t ant_id = pkt->ant_id_;
-  const uint32_t antenna_index = ant_id - antenna_offset_;
+  const uint32_t antenna_index = ant_id - profile_.FirstAntenna();
   const std::array<hsize_t, kDsDimsNum> start = {
       frame_id, pkt->cell_id_, symbol_index, antenna_index, 0};
 
@@ -387,16 +425,29 @@ void RecorderWorkerHDF5::WriteDatasetValue(const Packet* pkt,
                   dataset.first.c_str(), start.at(0), start.at(1), start.at(2),
                   start.at(3), start.at(4));
   ///If the frame id is > than the current 0 indexed dimension then we need to extend
+  ///Captured frames can be far apart, so extend past frame_id at once
   if (frame_id >= dataset.second.at(0)) {
-    dataset.second.at(0) = dataset.second.at(0) + kFrameInc;
+    dataset.second.at(0) = ((frame_id / frame_inc_) + 1) * frame_inc_;
     RtAssert(dataset.second.at(0) > frame_id,
              "Frame ID must be less than extended dimension");
-    hdf5_->ExtendDataset(dataset.first, dataset.second);
+    if (chunk_writer_ != nullptr) {
+      chunk_writer_->ExtendDataset(dataset.first, dataset.second);
+    } else {
+      hdf5_->ExtendDataset(dataset.first, dataset.second);
+    }
+  }
+  const void* packed = profile_.Pack(samples);
+  if (chunk_writer_ != nullptr) {
+    chunk_writer_->Write(dataset_index, start, packed);
+  } else if (profile_.Format() == IqFormat::kInt16) {
+    hdf5_->WriteDataset(dataset.first, start, data_chunk_dims_, samples);
+  } else {
+    hdf5_->WriteDataset(dataset.first, start, data_chunk_dims_,
+                        static_cast<const int8_t*>(packed));
   }
-  hdf5_->WriteDataset(dataset.first, start, data_chunk_dims_, pkt->data_);
 }
 
-int RecorderWorkerHDF5::Record(const Packet* pkt) {
+int RecorderWorkerHDF5::Record(const Packet* pkt, const short* samples) {
   const size_t end_antenna = (antenna_offset_ + num_antennas_) - 1;
 
   if ((pkt->ant_id_ < antenna_offset_) || (pkt->ant_id_ > end_antenna)) {
@@ -415,22 +466,22 @@ int RecorderWorkerHDF5::Record(const Packet* pkt) {
     std::printf(
         "RecorderWorkerHDF5::record [frame %zu, symbol %zu, cell %d, "
         "ant %zu] samples: %d %d %d %d %d %d %d %d ....\n",
-        frame_id, symbol_id, pkt->cell_id_, ant_id, pkt->data_[0u],
-        pkt->data_[1u], pkt->data_[2u], pkt->data_[3u], pkt->data_[4u],
-        pkt->data_[5u], pkt->data_[6u], pkt->data_[7u]);
+        frame_id, symbol_id, pkt->cell_id_, ant_id, samples[0u], samples[1u],
+        samples[2u], samples[3u], samples[4u], samples[5u], samples[6u],
+        samples[7u]);
   }
 
   if (frame_id > cfg_->FramesToTest()) {
     AGORA_LOG_ERROR("Ignoring rx data due to frame id %zu : %zu max\n",
                     frame_id, cfg_->FramesToTest());
-  } else if ((frame_id % interval_) == 0) {
+  } else if (((frame_id % interval_) == 0) && profile_.Records(pkt)) {
     if (kDebugPrint) {
       AGORA_LOG_TRACE(
           "RecorderWorkerHDF5::record [frame %zu, symbol %zu, cell %d, "
           "ant %zu] samples: %d %d %d %d %d %d %d %d ....\n",
-          frame_id, symbol_id, pkt->cell_id_, pkt->ant_id_, pkt->data_[0u],
-          pkt->data_[1u], pkt->data_[2u], pkt->data_[3u], pkt->data_[4u],
-          pkt->data_[5u], pkt->data_[6u], pkt->data_[7u]);
+          frame_id, symbol_id, pkt->cell_id_, pkt->ant_id_, samples[0u],
+          samples[1u], samples[2u], samples[3u], samples[4u], samples[5u],
+          samples[6u], samples[7u]);
     }
 
     auto rx_symbol_type = cfg_->GetSymbolType(symbol_id);
@@ -438,25 +489,25 @@ int RecorderWorkerHDF5::Record(const Packet* pkt) {
       case SymbolType::kBeacon: {
         const size_t beacon_symbol_id =
             cfg_->Frame().GetBeaconSymbolIdx(pkt->symbol_id_);
-        WriteDatasetValue(pkt, beacon_symbol_id, kBeaconDatasetIndex);
+        WriteDatasetValue(pkt, samples, beacon_symbol_id, kBeaconDatasetIndex);
         break;
       }
       case SymbolType::kDL: {
         const size_t dl_symbol_id =
             cfg_->Frame().GetDLSymbolIdx(pkt->symbol_id_);
-        WriteDatasetValue(pkt, dl_symbol_id, kDownlinkDatasetIndex);
+        WriteDatasetValue(pkt, samples, dl_symbol_id, kDownlinkDatasetIndex);
         break;
       }
       case SymbolType::kPilot: {
         const size_t pilot_id =
             cfg_->Frame().GetPilotSymbolIdx(pkt->symbol_id_);
-        WriteDatasetValue(pkt, pilot_id, kPilotDatasetIndex);
+        WriteDatasetValue(pkt, samples, pilot_id, kPilotDatasetIndex);
         break;
       }
       case SymbolType::kUL: {
         const size_t ul_symbol_id =
             cfg_->Frame().GetULSymbolIdx(pkt->symbol_id_);
-        WriteDatasetValue(pkt, ul_symbol_id, kUplinkDatasetIndex);
+        WriteDatasetValue(pkt, samples, ul_symbol_id, kUplinkDatasetIndex);
         break;
       }
       default: {
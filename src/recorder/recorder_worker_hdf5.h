@@ -8,7 +8,9 @@
 #include <memory>
 #include <string>
 
+#include "hdf5_chunk_writer.h"
 #include "hdf5_lib.h"
+#include "recorder_profile.h"
 #include "recorder_worker.h"
 
 namespace Agora_recorder {
@@ -22,7 +24,7 @@ class RecorderWorkerHDF5 : public RecorderWorker {
 
   void Init() final;
   void Finalize() final;
-  int Record(const Packet* pkt) final;
+  int Record(const Packet* pkt, const short* samples) final;
 
   inline size_t NumAntennas() const final { return num_antennas_; }
   inline size_t AntennaOffset() const final { return antenna_offset_; }
@@ -31,8 +33,12 @@ class RecorderWorkerHDF5 : public RecorderWorker {
   void Open();
   void Close();
 
-  void WriteDatasetValue(const Packet* pkt, size_t symbol_index,
-                         size_t dataset_index);
+  void WriteDatasetValue(const Packet* pkt, const short* samples,
+                         size_t symbol_index, size_t dataset_index);
+  // Chunk of the rx datasets with num_symbols symbols
+  std::array<hsize_t, kDsDimsNum> RxChunkDims(size_t num_symbols) const;
+  // Create an extendable dataset of rx symbols, chunked as configured
+  void CreateRxDataset(const std::string& name, size_t num_symbols);
 
   const Config* cfg_;
 
@@ -40,12 +46,20 @@ class RecorderWorkerHDF5 : public RecorderWorker {
   size_t num_antennas_;
   size_t interval_;
   Direction rx_direction_;
+  RecorderProfile profile_;
 
   std::unique_ptr<Hdf5Lib> hdf5_;
+  // Writes the rx symbols when there are writer threads. Declared after
+  // hdf5_, so that it writes its last chunks before the file is closed.
+  std::unique_ptr<Hdf5ChunkWriter> chunk_writer_;
   size_t max_frame_number_;
   std::vector<std::pair<std::string, std::array<hsize_t, kDsDimsNum>>>
       datasets_;
+  // One rx symbol, in the recorded format
   const std::array<hsize_t, kDsDimsNum> data_chunk_dims_;
+  // The datasets are extended by this many frames, a multiple of the frames
+  // of a chunk
+  const size_t frame_inc_;
 };
 }; /* End namespace Agora_recorder */
 
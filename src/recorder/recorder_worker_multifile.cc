@@ -5,6 +5,7 @@
 
 #include "recorder_worker_multifile.h"
 
+#include <algorithm>
 #include <string>
 
 #include "logger.h"
@@ -25,14 +26,62 @@ RecorderWorkerMultiFile::RecorderWorkerMultiFile(const Config* in_cfg,
       antenna_offset_(antenna_offset),
       num_antennas_(num_antennas),
       interval_(record_interval),
-      rx_direction_(rx_direction) {}
+      rx_direction_(rx_direction),
+      profile_(in_cfg, antenna_offset, num_antennas) {}
 
 RecorderWorkerMultiFile::~RecorderWorkerMultiFile() = default;
 
-void RecorderWorkerMultiFile::Init() {}
-void RecorderWorkerMultiFile::Finalize() {}
+void RecorderWorkerMultiFile::Init() {
+  if (cfg_->RecorderDirectIo()) {
+    const size_t max_file_bytes =
+        std::max({2 * sizeof(short) * cfg_->SampsPerSymbol(),
+                  2 * sizeof(float) * cfg_->OfdmCaNum(),
+                  2 * sizeof(float) * cfg_->OfdmDataNum()});
+    direct_writer_ = std::make_unique<DirectFileWriter>(
+        kOutputFilePath, cfg_->RecorderIoDepth(), max_file_bytes,
+        cfg_->RecorderFsyncBatch(), cfg_->NtStores("recorder"));
+  }
+}
+
+void RecorderWorkerMultiFile::Finalize() {
+  if (direct_writer_ != nullptr) {
+    direct_writer_->Flush();
+  }
+}
 
-int RecorderWorkerMultiFile::Record(const Packet* pkt) {
+void RecorderWorkerMultiFile::WriteFile(const std::string& filename,
+                                        const void* data, size_t bytes) {
+  if (direct_writer_ != nullptr) {
+    direct_writer_->WriteFile(filename, data, bytes);
+    return;
+  }
+  auto* fp = std::fopen(filename.c_str(), "wb");
+  if (fp == nullptr) {
+    throw std::runtime_error("RecorderWorkerMultiFile failed to open " +
+                             filename + " for writing");
+  }
+  if (std::fwrite(data, 1, bytes, fp) != bytes) {
+    throw std::runtime_error("RecorderWorkerMultiFile failed to write " +
+                             filename);
+  }
+  if (std::fclose(fp) != 0) {
+    throw std::runtime_error("RecorderWorkerMultiFile failed to close " +
+                             filename);
+  }
+}
+
+void RecorderWorkerMultiFile::WriteRxFile(const std::string& filename,
+                                          const short* samples) {
+  const std::string format_suffix =
+      (profile_.Format() == IqFormat::kInt16)
+          ? ""
+          : "_" + IqFormatName(profile_.Format());
+  WriteFile(kOutputFilePath + filename + format_suffix + ".bin",
+            profile_.Pack(samples), profile_.SymbolBytes());
+}
+
+int RecorderWorkerMultiFile::Record(const Packet* pkt,
+                                    const short* samples) {
   const size_t end_antenna = (antenna_offset_ + num_antennas_) - 1;
 
   if ((pkt->ant_id_ < antenna_offset_) || (pkt->ant_id_ > end_antenna)) {
@@ -46,7 +95,7 @@ int RecorderWorkerMultiFile::Record(const Packet* pkt) {
   const size_t frame_id = pkt->frame_id_;
   const size_t symbol_id = pkt->symbol_id_;
 
-  if ((frame_id % interval_) == 0) {
+  if (((frame_id % interval_) == 0) && profile_.Records(pkt)) {
     auto rx_symbol_type = cfg_->GetSymbolType(symbol_id);
     const size_t ant_id = pkt->ant_id_;
     const size_t radio_id = ant_id / cfg_->NumUeChannels();
@@ -58,9 +107,8 @@ int RecorderWorkerMultiFile::Record(const Packet* pkt) {
             "RecorderWorkerMultiFile::record [frame %d, symbol %d, cell %d, "
             "ant %d] dl_id: %zu - samples: %d %d %d %d %d %d %d %d ....\n",
             pkt->frame_id_, pkt->symbol_id_, pkt->cell_id_, pkt->ant_id_,
-            dl_symbol_id, pkt->data_[0u], pkt->data_[1u], pkt->data_[2u],
-            pkt->data_[3u], pkt->data_[4u], pkt->data_[5u], pkt->data_[6u],
-            pkt->data_[7u]);
+            dl_symbol_id, samples[0u], samples[1u], samples[2u], samples[3u],
+            samples[4u], samples[5u], samples[6u], samples[7u]);
       }
 
       bool is_data = dl_symbol_id >= cfg_->Frame().ClientDlPilotSymbols();
@@ -70,90 +118,19 @@ int RecorderWorkerMultiFile::Record(const Packet* pkt) {
 
       const std::string short_serial = cfg_->UeRadioName().at(radio_id);
       if (is_data) {
-        const std::string fname_rxdata =
-            kOutputFilePath + "rxdata_" + pkt_id + "_" + short_serial + ".bin";
-        auto* fp_rxdata = std::fopen(fname_rxdata.c_str(), "wb");
-        if (fp_rxdata == nullptr) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to open rxdata file for "
-              "writing");
-        }
-
-        auto write_status = std::fwrite(pkt->data_, 2 * sizeof(short),
-                                        cfg_->SampsPerSymbol(), fp_rxdata);
-        if (write_status != cfg_->SampsPerSymbol()) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to write rxdata file");
-        }
-        auto close_status = std::fclose(fp_rxdata);
-        if (close_status != 0) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to close rxdata file");
-        }
+        WriteRxFile("rxdata_" + pkt_id + "_" + short_serial, samples);
 
         ///Tx data
-        const std::string fname_txdata =
-            kOutputFilePath + "txdata_" + pkt_id + ".bin";
-        FILE* fp_txdata = std::fopen(fname_txdata.c_str(), "wb");
-        if (fp_txdata == nullptr) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to open txdata file for "
-              "writing");
-        }
-        write_status =
-            std::fwrite(const_cast<Config*>(cfg_)->DlIqF()[dl_symbol_id] +
-                            ant_id * cfg_->OfdmCaNum(),
-                        2 * sizeof(float), cfg_->OfdmCaNum(), fp_txdata);
-        if (write_status != cfg_->OfdmCaNum()) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to write txdata file");
-        }
-        close_status = std::fclose(fp_txdata);
-        if (close_status != 0) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to close txdata file");
-        }
+        WriteFile(kOutputFilePath + "txdata_" + pkt_id + ".bin",
+                  const_cast<Config*>(cfg_)->DlIqF()[dl_symbol_id] +
+                      ant_id * cfg_->OfdmCaNum(),
+                  2 * sizeof(float) * cfg_->OfdmCaNum());
       } else {
-        const std::string fname_rxpilot =
-            kOutputFilePath + "rxpilot_" + pkt_id + "_" + short_serial + ".bin";
-        auto* fp_rxpilot = std::fopen(fname_rxpilot.c_str(), "wb");
-        if (fp_rxpilot == nullptr) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to open rxpilot file for "
-              "writing");
-        }
-        auto write_status = std::fwrite(pkt->data_, 2 * sizeof(short),
-                                        cfg_->SampsPerSymbol(), fp_rxpilot);
-        if (write_status != cfg_->SampsPerSymbol()) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to write rxpilot file");
-        }
-        auto close_status = std::fclose(fp_rxpilot);
-        if (close_status != 0) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to close rxpilot file");
-        }
+        WriteRxFile("rxpilot_" + pkt_id + "_" + short_serial, samples);
         ///Tx pilot
-        const std::string fname_txpilot =
-            kOutputFilePath + "txpilot_" + pkt_id + ".bin";
-        FILE* fp_txpilot = std::fopen(fname_txpilot.c_str(), "wb");
-        if (fp_txpilot == nullptr) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to open txpilot file for "
-              "writing");
-        }
-        write_status =
-            std::fwrite(const_cast<Config*>(cfg_)->UeSpecificPilot()[ant_id],
-                        2 * sizeof(float), cfg_->OfdmDataNum(), fp_txpilot);
-        if (write_status != cfg_->OfdmDataNum()) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to write txpilot file");
-        }
-        close_status = std::fclose(fp_txpilot);
-        if (close_status != 0) {
-          throw std::runtime_error(
-              "RecorderWorkerMultiFile failed to close txpilot file");
-        }
+        WriteFile(kOutputFilePath + "txpilot_" + pkt_id + ".bin",
+                  const_cast<Config*>(cfg_)->UeSpecificPilot()[ant_id],
+                  2 * sizeof(float) * cfg_->OfdmDataNum());
       }
     } else if (rx_symbol_type == SymbolType::kUL) {
       const size_t ul_symbol_id = cfg_->Frame().GetULSymbolIdx(pkt->symbol_id_);
@@ -162,9 +139,8 @@ int RecorderWorkerMultiFile::Record(const Packet* pkt) {
             "RecorderWorkerMultiFile::record [frame %d, symbol %d, cell %d, "
             "ant %d] dl_id: %zu - samples: %d %d %d %d %d %d %d %d ....\n",
             pkt->frame_id_, pkt->symbol_id_, pkt->cell_id_, pkt->ant_id_,
-            ul_symbol_id, pkt->data_[0u], pkt->data_[1u], pkt->data_[2u],
-            pkt->data_[3u], pkt->data_[4u], pkt->data_[5u], pkt->data_[6u],
-            pkt->data_[7u]);
+            ul_symbol_id, samples[0u], samples[1u], samples[2u], samples[3u],
+            samples[4u], samples[5u], samples[6u], samples[7u]);
       }
 
       const std::string pkt_id = "F" + std::to_string(frame_id) + "_S" +
@@ -172,26 +148,7 @@ int RecorderWorkerMultiFile::Record(const Packet* pkt) {
                                  std::to_string(ant_id);
 
       const std::string short_serial = cfg_->RadioId().at(radio_id);
-      const std::string fname_rxdata =
-          kOutputFilePath + "bs_rxdata_" + pkt_id + "_" + short_serial + ".bin";
-      auto* fp_rxdata = std::fopen(fname_rxdata.c_str(), "wb");
-      if (fp_rxdata == nullptr) {
-        throw std::runtime_error(
-            "RecorderWorkerMultiFile failed to open rxdata file for "
-            "writing");
-      }
-
-      auto write_status = std::fwrite(pkt->data_, 2 * sizeof(short),
-                                      cfg_->SampsPerSymbol(), fp_rxdata);
-      if (write_status != cfg_->SampsPerSymbol()) {
-        throw std::runtime_error(
-            "RecorderWorkerMultiFile failed to write rxdata file");
-      }
-      auto close_status = std::fclose(fp_rxdata);
-      if (close_status != 0) {
-        throw std::runtime_error(
-            "RecorderWorkerMultiFile failed to close rxdata file");
-      }
+      WriteRxFile("bs_rxdata_" + pkt_id + "_" + short_serial, samples);
     }
   }
   return ret;
@@ -5,6 +5,11 @@
 #ifndef AGORA_RECORDER_WORKER_MULTIFILE_H_
 #define AGORA_RECORDER_WORKER_MULTIFILE_H_
 
+#include <memory>
+#include <string>
+
+#include "direct_file_writer.h"
+#include "recorder_profile.h"
 #include "recorder_worker.h"
 
 namespace Agora_recorder {
@@ -18,7 +23,7 @@ class RecorderWorkerMultiFile : public RecorderWorker {
 
   void Init() final;
   void Finalize() final;
-  int Record(const Packet* pkt) final;
+  int Record(const Packet* pkt, const short* samples) final;
 
   inline size_t NumAntennas() const final { return num_antennas_; }
   inline size_t AntennaOffset() const final { return antenna_offset_; }
@@ -26,6 +31,11 @@ class RecorderWorkerMultiFile : public RecorderWorker {
  private:
   void Open();
   void Close();
+  // Write a whole file, through the direct writer if recorder_direct_io
+  void WriteFile(const std::string& filename, const void* data, size_t bytes);
+  // Write an rx symbol in the recorded format, which names the file if the
+  // samples are requantized
+  void WriteRxFile(const std::string& filename, const short* samples);
 
   const Config* cfg_;
 
@@ -33,6 +43,8 @@ class RecorderWorkerMultiFile : public RecorderWorker {
   size_t num_antennas_;
   size_t interval_;
   Direction rx_direction_;
+  RecorderProfile profile_;
+  std::unique_ptr<DirectFileWriter> direct_writer_;
 };
 }; /* End namespace Agora_recorder */
 
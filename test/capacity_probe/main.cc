@@ -0,0 +1,248 @@
+/**
+ * @file main.cc
+ * @brief Capacity probe. For every worker count and MCS of a config, binary
+ * searches the shortest frame duration that bench mode sustains within a
+ * deadline-miss target, and writes a capacity report as JSON.
+ */
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "agora.h"
+#include "config.h"
+#include "data_generator.h"
+#include "gflags/gflags.h"
+#include "logger.h"
+#include "utils.h"
+#include "version_config.h"
+
+DEFINE_string(
+    conf_file,
+    TOSTRING(PROJECT_DIRECTORY) "/files/config/ci/tddconfig-sim-ul.json",
+    "Base config of the probe");
+DEFINE_string(workers, "4,8,16", "Worker counts to probe");
+DEFINE_string(mcs, "10,17,27", "Uplink and downlink MCS indices to probe");
+DEFINE_uint64(frames, 1000, "Frames processed per run");
+DEFINE_double(min_frame_us, 100.0, "Shortest frame duration searched");
+DEFINE_double(max_frame_us, 10000.0, "Longest frame duration searched");
+DEFINE_double(resolution_us, 10.0,
+              "The search stops once the bounds are this close");
+DEFINE_double(miss_target_pct, 1.0,
+              "Frames that may miss a stage deadline, in percent");
+DEFINE_string(deadline_stage, "decode_done",
+              "Stage whose deadline is the frame duration of the run, if the "
+              "config sets no stage_deadlines_us");
+DEFINE_double(min_rate_pct, 99.0,
+              "Frame rate a run must sustain, in percent of the probed rate");
+DEFINE_uint64(core_offset, 0,
+              "Core offset of every run, which fixes the core layout");
+DEFINE_string(
+    report_out,
+    TOSTRING(PROJECT_DIRECTORY) "/files/experiment/capacity_probe.json",
+    "File the report is written to");
+
+static const std::string kExperimentDirectory =
+    TOSTRING(PROJECT_DIRECTORY) "/files/experiment/";
+
+static std::vector<size_t> ParseList(const std::string& list) {
+  std::vector<size_t> values;
+  for (const auto& value : Utils::Split(list, ',')) {
+    values.push_back(std::stoul(value));
+  }
+  return values;
+}
+
+/// Run conf in bench mode with frames released every frame_us, and write the
+/// frames per second and deadline-miss ratio to result_file
+static void RunProbe(nlohmann::json conf, double frame_us,
+                     const std::string& result_file) {
+  conf["bench_mode"] = true;
+  conf["bench_frame_duration_us"] = frame_us;
+  conf["max_frame"] = FLAGS_frames;
+  conf["core_offset"] = FLAGS_core_offset;
+  if (conf.contains("stage_deadlines_us") == false) {
+    conf["stage_deadlines_us"] = {{FLAGS_deadline_stage, frame_us}};
+  }
+  const std::string conf_file =
+      "/tmp/capacity_probe_" + std::to_string(::getpid()) + ".json";
+  {
+    std::ofstream out(conf_file);
+    out << conf.dump();
+  }
+  auto cfg = std::make_unique<Config>(conf_file);
+  DataGenerator(cfg.get()).DoDataGeneration(kExperimentDirectory);
+  cfg->GenData();
+  std::remove(conf_file.c_str());
+
+  nlohmann::json result;
+  {
+    auto agora = std::make_unique<Agora>(cfg.get());
+    agora->Start();
+    result = {{"frames_per_sec", agora->BenchFramesPerSec()},
+              {"deadline_miss_ratio", agora->BenchDeadlineMissRatio()}};
+  }
+  std::ofstream out(result_file);
+  out << result.dump();
+}
+
+/// RunProbe in a child process, as the cores that a run assigns stay taken
+/// until the process exits. Null if the run failed.
+static nlohmann::json RunProbeInChild(const nlohmann::json& conf,
+                                      double frame_us) {
+  const std::string result_file =
+      "/tmp/capacity_probe_" + std::to_string(::getpid()) + "_result.json";
+  std::fflush(stdout);
+  const pid_t pid = ::fork();
+  RtAssert(pid >= 0, "capacity_probe: fork failed");
+  if (pid == 0) {
+    AGORA_LOG_INIT();
+    int ret = EXIT_SUCCESS;
+    try {
+      RunProbe(conf, frame_us, result_file);
+    } catch (const std::exception& e) {
+      AGORA_LOG_ERROR("capacity_probe: run at %.1f us failed: %s\n", frame_us,
+                      e.what());
+      ret = EXIT_FAILURE;
+    }
+    AGORA_LOG_SHUTDOWN();
+    std::exit(ret);
+  }
+
+  int status;
+  ::waitpid(pid, &status, 0);
+  nlohmann::json result;
+  std::ifstream in(result_file);
+  if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS) &&
+      in.is_open()) {
+    in >> result;
+  }
+  std::remove(result_file.c_str());
+  return result;
+}
+
+/// One run of the search, and whether it sustained its frame rate within
+/// the deadline-miss target
+static nlohmann::json Probe(const nlohmann::json& conf, double frame_us) {
+  nlohmann::json run = {{"frame_us", frame_us},
+                        {"target_frames_per_sec", 1e6 / frame_us}};
+  const nlohmann::json result = RunProbeInChild(conf, frame_us);
+  if (result.is_null()) {
+    run["status"] = "error";
+    run["sustained"] = false;
+    return run;
+  }
+  const double frames_per_sec = result.at("frames_per_sec").get<double>();
+  const double miss_pct =
+      result.at("deadline_miss_ratio").get<double>() * 100.0;
+  const bool sustained =
+      (frames_per_sec * 1e2 >= (1e6 / frame_us) * FLAGS_min_rate_pct) &&
+      (miss_pct <= FLAGS_miss_target_pct);
+  run["frames_per_sec"] = frames_per_sec;
+  run["deadline_miss_pct"] = miss_pct;
+  run["status"] = sustained ? "sustained" : "overloaded";
+  run["sustained"] = sustained;
+  std::printf("capacity_probe:   %.1f us: %.1f frames/s, %.2f%% misses, %s\n",
+              frame_us, frames_per_sec, miss_pct,
+              run.at("status").get<std::string>().c_str());
+  return run;
+}
+
+/// Binary search of the shortest sustained frame duration of conf
+static nlohmann::json ProbeConfig(const nlohmann::json& conf) {
+  nlohmann::json runs = nlohmann::json::array();
+  double slow_us = FLAGS_max_frame_us;
+  runs.push_back(Probe(conf, slow_us));
+  if (runs.back().at("sustained") == false) {
+    return {{"sustained", false}, {"runs", runs}};
+  }
+  double fast_us = FLAGS_min_frame_us;
+  runs.push_back(Probe(conf, fast_us));
+  if (runs.back().at("sustained") == true) {
+    slow_us = fast_us;
+  }
+  while (slow_us - fast_us > FLAGS_resolution_us) {
+    const double frame_us = (slow_us + fast_us) / 2;
+    runs.push_back(Probe(conf, frame_us));
+    if (runs.back().at("sustained") == true) {
+      slow_us = frame_us;
+    } else {
+      fast_us = frame_us;
+    }
+  }
+  return {{"sustained", true},
+          {"min_frame_us", slow_us},
+          {"max_frames_per_sec", 1e6 / slow_us},
+          {"runs", runs}};
+}
+
+int main(int argc, char* argv[]) {
+  gflags::SetUsageMessage(
+      "Searches the highest frame rate that bench mode sustains for each "
+      "worker count and MCS");
+  gflags::SetVersionString(GetAgoraProjectVersion());
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  RtAssert(FLAGS_min_frame_us > 0.0,
+           "capacity_probe: min_frame_us must be positive");
+  RtAssert(FLAGS_min_frame_us < FLAGS_max_frame_us,
+           "capacity_probe: min_frame_us must be below max_frame_us");
+
+  // Set up the logger only in the runs, it does not survive a fork
+  std::string conf_text;
+  Utils::LoadTddConfig(FLAGS_conf_file, conf_text);
+  const auto base_conf = nlohmann::json::parse(conf_text, nullptr, true, true);
+
+  nlohmann::json results = nlohmann::json::array();
+  for (const size_t num_workers : ParseList(FLAGS_workers)) {
+    for (const size_t mcs : ParseList(FLAGS_mcs)) {
+      std::printf("capacity_probe: %zu workers, MCS %zu\n", num_workers, mcs);
+      nlohmann::json conf = base_conf;
+      conf["worker_thread_num"] = num_workers;
+      conf["ul_mcs"] = {{"mcs_index", mcs}};
+      conf["dl_mcs"] = {{"mcs_index", mcs}};
+      nlohmann::json result = ProbeConfig(conf);
+      if (result.at("sustained") == true) {
+        std::printf(
+            "capacity_probe: %zu workers, MCS %zu sustain %.1f us frames "
+            "(%.1f frames/s)\n",
+            num_workers, mcs, result.at("min_frame_us").get<double>(),
+            result.at("max_frames_per_sec").get<double>());
+      } else {
+        std::printf(
+            "capacity_probe: %zu workers, MCS %zu do not sustain %.1f us "
+            "frames\n",
+            num_workers, mcs, FLAGS_max_frame_us);
+      }
+      result["workers"] = num_workers;
+      result["mcs"] = mcs;
+      results.push_back(result);
+    }
+  }
+
+  char host[256] = {0};
+  ::gethostname(host, sizeof(host) - 1);
+  const nlohmann::json report = {
+      {"context",
+       {{"version", GetAgoraProjectVersion()},
+        {"host", host},
+        {"conf_file", FLAGS_conf_file},
+        {"frames", FLAGS_frames},
+        {"miss_target_pct", FLAGS_miss_target_pct},
+        {"min_rate_pct", FLAGS_min_rate_pct},
+        {"core_offset", FLAGS_core_offset},
+        {"thread_pinning", kEnableThreadPinning}}},
+      {"configs", results}};
+  {
+    std::ofstream out(FLAGS_report_out);
+    out << report.dump(2) << std::endl;
+  }
+  std::printf("capacity_probe: Report written to %s\n",
+              FLAGS_report_out.c_str());
+  gflags::ShutDownCommandLineFlags();
+  return EXIT_SUCCESS;
+}
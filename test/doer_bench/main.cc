@@ -0,0 +1,427 @@
+/**
+ * @file main.cc
+ * @brief Benchmark of the doers of Agora on the generated data of a matrix of
+ * antenna, UE, bandwidth and MCS configs, with the results written as JSON.
+ */
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "agora_buffer.h"
+#include "block_size_controller.h"
+#include "config.h"
+#include "data_generator.h"
+#include "datatype_conversion.h"
+#include "dobeamweights.h"
+#include "dodecode.h"
+#include "dodemul.h"
+#include "doencode.h"
+#include "dofft.h"
+#include "doifft.h"
+#include "doprecode.h"
+#include "gettime.h"
+#include "gflags/gflags.h"
+#include "logger.h"
+#include "mac_scheduler.h"
+#include "perf_counters.h"
+#include "phy_stats.h"
+#include "stats.h"
+#include "utils.h"
+#include "version_config.h"
+
+DEFINE_string(
+    conf_file,
+    TOSTRING(PROJECT_DIRECTORY) "/files/config/ci/tddconfig-sim-both.json",
+    "Base config of the matrix, which needs uplink and downlink symbols");
+DEFINE_string(antennas, "8,32,64", "Base station antennas of the configs");
+DEFINE_string(ues, "4,8,16",
+              "UEs of the configs, the ones above the antennas are skipped");
+DEFINE_string(bandwidths, "1024:624,2048:1200",
+              "fft_size:ofdm_data_num pairs of the configs");
+DEFINE_string(mcs, "10,17,27", "Uplink and downlink MCS indices of the configs");
+DEFINE_uint64(iterations, 20, "Frames of tasks timed per doer and config");
+DEFINE_string(workers, "4,8,16,32",
+              "Worker counts the block size controller is settled for");
+DEFINE_double(block_target_us, 10.0,
+              "adaptive_block_target_us of the block size controller");
+DEFINE_string(nt_stores, "default",
+              "Comma separated buffers written with non-temporal stores "
+              "(csi,fft,ifft,decode), empty for none, default for the "
+              "conf_file's");
+DEFINE_string(json_out,
+              TOSTRING(PROJECT_DIRECTORY) "/files/experiment/doer_bench.json",
+              "File the results are written to");
+
+static const std::string kExperimentDirectory =
+    TOSTRING(PROJECT_DIRECTORY) "/files/experiment/";
+
+static std::vector<size_t> ParseList(const std::string& list) {
+  std::vector<size_t> values;
+  for (const auto& value : Utils::Split(list, ',')) {
+    values.push_back(std::stoul(value));
+  }
+  return values;
+}
+
+/// Last level cache misses of the benchmark thread, 0 if its counters could
+/// not be opened
+static PerfCounters& BenchCounters() {
+  static PerfCounters counters(1);
+  return counters;
+}
+
+static size_t LlcMisses() {
+  PerfCounters::Counts counts{};
+  if (BenchCounters().EventAvailable(PerfCounters::Event::kLlcMisses)) {
+    BenchCounters().Read(counts);
+  }
+  return counts.at(static_cast<size_t>(PerfCounters::Event::kLlcMisses));
+}
+
+/// Time the tasks of one frame, tags, over FLAGS_iterations frames after an
+/// untimed one. before_frame runs before each frame, outside of the timing.
+/// The LLC misses of a doer include the misses on the outputs of the doer
+/// before it, which is how the nt_stores of a stage show.
+static nlohmann::json TimeDoer(
+    const std::string& name, Doer& doer, const std::vector<size_t>& tags,
+    double freq_ghz, const std::function<void()>& before_frame = nullptr) {
+  size_t total_cycles = 0;
+  size_t min_cycles = SIZE_MAX;
+  size_t total_misses = 0;
+  for (size_t i = 0; i <= FLAGS_iterations; i++) {
+    if (before_frame != nullptr) {
+      before_frame();
+    }
+    const size_t start_misses = LlcMisses();
+    const size_t start_tsc = GetTime::Rdtsc();
+    for (const size_t tag : tags) {
+      doer.Launch(tag);
+    }
+    const size_t cycles = GetTime::Rdtsc() - start_tsc;
+    // The first frame warms up the caches
+    if (i > 0) {
+      total_cycles += cycles;
+      min_cycles = std::min(min_cycles, cycles);
+      total_misses += LlcMisses() - start_misses;
+    }
+  }
+  const double cycles_per_task = static_cast<double>(total_cycles) /
+                                 (FLAGS_iterations * tags.size());
+  const double misses_per_task = static_cast<double>(total_misses) /
+                                 (FLAGS_iterations * tags.size());
+  AGORA_LOG_INFO(
+      "  %-14s %6zu tasks/frame %12.0f cycles/task %10.2f us/frame %10.1f "
+      "LLC misses/task\n",
+      name.c_str(), tags.size(), cycles_per_task,
+      GetTime::CyclesToUs(total_cycles / FLAGS_iterations, freq_ghz),
+      misses_per_task);
+  return {{"doer", name},
+          {"llc_misses_per_task", misses_per_task},
+          {"iterations", FLAGS_iterations},
+          {"tasks_per_frame", tags.size()},
+          {"cycles_per_task", cycles_per_task},
+          {"min_cycles_per_task",
+           static_cast<double>(min_cycles) / tags.size()},
+          {"us_per_frame",
+           GetTime::CyclesToUs(total_cycles / FLAGS_iterations, freq_ghz)}};
+}
+
+/// Where the BlockSizeController settles for each worker count, with idle
+/// and with backlogged task queues, given the block times of doers
+static nlohmann::json SettleBlockSizes(const Config* cfg,
+                                       const nlohmann::json& doers) {
+  const double freq_ghz = cfg->FreqGhz();
+  nlohmann::json settled = nlohmann::json::array();
+  for (const auto& stage :
+       {std::make_tuple(EventType::kBeam, "DoBeamWeights",
+                        cfg->BeamBlockSize(), cfg->BeamEventsPerSymbol()),
+        std::make_tuple(EventType::kDemul, "DoDemul", cfg->DemulBlockSize(),
+                        cfg->DemulEventsPerSymbol()),
+        std::make_tuple(EventType::kPrecode, "DoPrecode",
+                        cfg->DemulBlockSize(), cfg->DemulEventsPerSymbol())}) {
+    const auto doer = std::find_if(
+        doers.begin(), doers.end(), [&](const nlohmann::json& result) {
+          return result["doer"] == std::get<1>(stage);
+        });
+    const double block_us = GetTime::CyclesToUs(
+        static_cast<size_t>(doer->at("cycles_per_task").get<double>()),
+        freq_ghz);
+    for (const size_t num_workers : ParseList(FLAGS_workers)) {
+      for (const bool backlog : {false, true}) {
+        // Agora's master keeps two events per worker and symbol
+        BlockSizeController controller(FLAGS_block_target_us, num_workers, 2);
+        for (size_t i = 0; i < FLAGS_iterations; i++) {
+          controller.Update(std::get<0>(stage), block_us,
+                            backlog ? SIZE_MAX : 0);
+        }
+        const size_t blocks = controller.BlocksPerEvent(std::get<0>(stage),
+                                                        std::get<3>(stage));
+        AGORA_LOG_INFO(
+            "  %-14s %2zu workers%s: %zu blocks (%zu subcarriers) per "
+            "event\n",
+            std::get<1>(stage), num_workers, backlog ? ", backlog" : "",
+            blocks, blocks * std::get<2>(stage));
+        settled.push_back({{"doer", std::get<1>(stage)},
+                           {"workers", num_workers},
+                           {"backlog", backlog},
+                           {"block_us", block_us},
+                           {"blocks_per_event", blocks},
+                           {"subcarriers_per_event",
+                            blocks * std::get<2>(stage)}});
+      }
+    }
+  }
+  return settled;
+}
+
+/// Packets of the pilot and uplink symbols of the generated rx data
+static void LoadRxPackets(const Config* cfg, Table<char>& packets,
+                          std::vector<RxPacket>& rx_packets) {
+  const std::string filename = kExperimentDirectory + "LDPC_rx_data_" +
+                               std::to_string(cfg->OfdmCaNum()) + "_ant" +
+                               std::to_string(cfg->BsAntNum()) + ".bin";
+  const size_t num_samples = cfg->SampsPerSymbol() * 2;
+  Table<float> iq_float;
+  iq_float.Calloc(1, num_samples, Agora_memory::Alignment_t::kAlign64);
+  packets.Calloc(cfg->Frame().NumTotalSyms() * cfg->BsAntNum(),
+                 Roundup<64>(cfg->PacketLength()),
+                 Agora_memory::Alignment_t::kAlign64);
+  rx_packets.reserve(packets.Dim1());
+
+  FILE* fp = std::fopen(filename.c_str(), "rb");
+  RtAssert(fp != nullptr, "Failed to open " + filename);
+  for (size_t i = 0; i < packets.Dim1(); i++) {
+    RtAssert(std::fread(iq_float[0], sizeof(float), num_samples, fp) ==
+                 num_samples,
+             "Failed to read " + filename);
+    const size_t symbol_id = i / cfg->BsAntNum();
+    const SymbolType symbol_type = cfg->GetSymbolType(symbol_id);
+    if ((symbol_type != SymbolType::kPilot) &&
+        (symbol_type != SymbolType::kUL)) {
+      continue;
+    }
+    auto* pkt =
+        new (packets[i]) Packet(0, symbol_id, 0, i % cfg->BsAntNum());
+    SimdConvertFloatToShort(iq_float[0], pkt->data_, num_samples);
+    rx_packets.emplace_back(pkt);
+  }
+  std::fclose(fp);
+  iq_float.Free();
+}
+
+static nlohmann::json RunConfig(const nlohmann::json& base_conf,
+                                size_t num_antennas, size_t num_ues,
+                                size_t fft_size, size_t num_data_sc,
+                                size_t mcs) {
+  nlohmann::json conf = base_conf;
+  conf["bs_radio_num"] = num_antennas;
+  conf["ue_radio_num"] = num_ues;
+  conf["fft_size"] = fft_size;
+  conf["ofdm_data_num"] = num_data_sc;
+  conf["ul_mcs"] = {{"mcs_index", mcs}};
+  conf["dl_mcs"] = {{"mcs_index", mcs}};
+  if (FLAGS_nt_stores != "default") {
+    conf["nt_stores"] = FLAGS_nt_stores.empty()
+                            ? std::vector<std::string>()
+                            : Utils::Split(FLAGS_nt_stores, ',');
+  }
+  const std::string conf_file =
+      "/tmp/doer_bench_" + std::to_string(::getpid()) + ".json";
+  {
+    std::ofstream out(conf_file);
+    out << conf.dump();
+  }
+  auto cfg = std::make_unique<Config>(conf_file);
+  RtAssert((kUse12BitIQ == false) && (cfg->FronthaulBfpBits() == 0) &&
+               (cfg->FftInRru() == false),
+           "doer_bench: The packets must hold 16-bit time-domain samples");
+  RtAssert((cfg->Frame().NumULSyms() > cfg->Frame().ClientUlPilotSymbols()) &&
+               (cfg->Frame().NumDLSyms() > cfg->Frame().ClientDlPilotSymbols()),
+           "doer_bench: The frame needs uplink and downlink data symbols");
+  DataGenerator(cfg.get()).DoDataGeneration(kExperimentDirectory);
+  cfg->GenData();
+  std::remove(conf_file.c_str());
+
+  const std::string name = "ant" + std::to_string(num_antennas) + "_ue" +
+                           std::to_string(num_ues) + "_fft" +
+                           std::to_string(fft_size) + "_mcs" +
+                           std::to_string(mcs);
+  AGORA_LOG_INFO("doer_bench: %s\n", name.c_str());
+
+  auto mac_sched = std::make_unique<MacScheduler>(cfg.get(), true);
+  auto stats = std::make_unique<Stats>(cfg.get());
+  auto phy_stats = std::make_unique<PhyStats>(cfg.get(), Direction::kUplink);
+  auto buffer = std::make_unique<AgoraBuffer>(cfg.get());
+  const size_t tid = 0;
+
+  // The doers as AgoraWorker creates them, each stage on the output of the
+  // previous one
+  DoFFT fft(cfg.get(), tid, buffer->GetFft(), buffer->GetCsi(),
+            buffer->GetCalibDl(), buffer->GetCalibUl(),
+            buffer->GetFftSymbolPackets(), phy_stats.get(), stats.get());
+  DoBeamWeights beam(cfg.get(), tid, buffer->GetCsi(), buffer->GetCalibDl(),
+                     buffer->GetCalibUl(), buffer->GetCalibDlMsum(),
+                     buffer->GetCalibUlMsum(), buffer->GetCalib(),
+                     buffer->GetUlBeamMatrix(), buffer->GetDlBeamMatrix(),
+                     buffer->GetBeamRefCsi(), buffer->GetBeamReuseState(),
+                     mac_sched.get(), phy_stats.get(), stats.get());
+  DoDemul demul(cfg.get(), tid, buffer->GetFft(), buffer->GetUlBeamMatrix(),
+                buffer->GetUeSpecPilot(), buffer->GetEqual(),
+                buffer->GetDemod(), buffer->GetUlPhaseBase(),
+                buffer->GetUlPhaseShiftPerSymbol(), mac_sched.get(),
+                phy_stats.get(), stats.get());
+  if (cfg->UlBeamInt16()) {
+    beam.EnableInt16Beams(&buffer->GetUlBeamInt16(),
+                          &buffer->GetUlBeamScale());
+    demul.EnableInt16Beams(&buffer->GetUlBeamInt16(),
+                           &buffer->GetUlBeamScale());
+  }
+  DoEncode encode(cfg.get(), tid, Direction::kDownlink, cfg->DlBits(), 1,
+                  buffer->GetDlModBits(), mac_sched.get(), stats.get());
+  DoPrecode precode(cfg.get(), tid, buffer->GetDlBeamMatrix(),
+                    buffer->GetIfft(), buffer->GetDlModBits(),
+                    mac_sched.get(), stats.get());
+  DoIFFT ifft(cfg.get(), tid, buffer->GetIfft(), buffer->GetDlSocket(),
+              mac_sched.get(), stats.get());
+
+  // The tasks of frame 0, tagged as Agora schedules them
+  const size_t frame_id = 0;
+  Table<char> packets;
+  std::vector<RxPacket> rx_packets;
+  LoadRxPackets(cfg.get(), packets, rx_packets);
+  std::vector<size_t> fft_tags;
+  for (auto& rx_packet : rx_packets) {
+    fft_tags.push_back(fft_req_tag_t(rx_packet).tag_);
+  }
+  std::vector<size_t> beam_tags;
+  for (size_t sc = 0; sc < cfg->OfdmDataNum(); sc += cfg->BeamBlockSize()) {
+    beam_tags.push_back(gen_tag_t::FrmSc(frame_id, sc).tag_);
+  }
+  std::vector<size_t> demul_tags;
+  std::vector<size_t> decode_tags;
+  for (size_t i = 0; i < cfg->Frame().NumULSyms(); i++) {
+    const size_t symbol_id = cfg->Frame().GetULSymbol(i);
+    for (size_t sc = 0; sc < cfg->OfdmDataNum(); sc += cfg->DemulBlockSize()) {
+      demul_tags.push_back(gen_tag_t::FrmSymSc(frame_id, symbol_id, sc).tag_);
+    }
+    if (i < cfg->Frame().ClientUlPilotSymbols()) {
+      continue;
+    }
+    for (size_t cb = 0;
+         cb < cfg->SpatialStreamsNum() *
+                  cfg->LdpcConfig(Direction::kUplink).NumBlocksInSymbol();
+         cb++) {
+      decode_tags.push_back(gen_tag_t::FrmSymCb(frame_id, symbol_id, cb).tag_);
+    }
+  }
+  std::vector<size_t> encode_tags;
+  std::vector<size_t> precode_tags;
+  std::vector<size_t> ifft_tags;
+  for (size_t i = 0; i < cfg->Frame().NumDLSyms(); i++) {
+    const size_t symbol_id = cfg->Frame().GetDLSymbol(i);
+    if (i >= cfg->Frame().ClientDlPilotSymbols()) {
+      for (size_t cb = 0;
+           cb < cfg->SpatialStreamsNum() *
+                    cfg->LdpcConfig(Direction::kDownlink).NumBlocksInSymbol();
+           cb++) {
+        encode_tags.push_back(
+            gen_tag_t::FrmSymCb(frame_id, symbol_id, cb).tag_);
+      }
+    }
+    for (size_t sc = 0; sc < cfg->OfdmDataNum(); sc += cfg->DemulBlockSize()) {
+      precode_tags.push_back(
+          gen_tag_t::FrmSymSc(frame_id, symbol_id, sc).tag_);
+    }
+    // A batched IFFT task covers all the antennas
+    const size_t num_ifft_tasks =
+        cfg->IfftBatchSymbol() ? 1 : cfg->BsAntNum();
+    for (size_t ant = 0; ant < num_ifft_tasks; ant++) {
+      ifft_tags.push_back(gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant).tag_);
+    }
+  }
+
+  nlohmann::json doers = nlohmann::json::array();
+  const double freq_ghz = cfg->FreqGhz();
+  // Each task frees its packet
+  doers.push_back(TimeDoer("DoFFT", fft, fft_tags, freq_ghz, [&rx_packets]() {
+    for (auto& rx_packet : rx_packets) {
+      rx_packet.Use();
+    }
+  }));
+  doers.push_back(TimeDoer("DoBeamWeights", beam, beam_tags, freq_ghz));
+  doers.push_back(TimeDoer("DoDemul", demul, demul_tags, freq_ghz));
+#if !defined(USE_ACC100)
+  DoDecode decode(cfg.get(), tid, buffer->GetDemod(), buffer->GetDecod(),
+                  mac_sched.get(), phy_stats.get(), stats.get(),
+                  buffer->GetHarq());
+  doers.push_back(TimeDoer("DoDecode", decode, decode_tags, freq_ghz));
+#endif
+  doers.push_back(TimeDoer("DoEncode", encode, encode_tags, freq_ghz));
+  doers.push_back(TimeDoer("DoPrecode", precode, precode_tags, freq_ghz));
+  doers.push_back(TimeDoer("DoIFFT", ifft, ifft_tags, freq_ghz));
+  packets.Free();
+
+  return {{"name", name},
+          {"antennas", cfg->BsAntNum()},
+          {"ues", cfg->UeAntNum()},
+          {"fft_size", cfg->OfdmCaNum()},
+          {"ofdm_data_num", cfg->OfdmDataNum()},
+          {"mcs", mcs},
+          {"doers", doers},
+          {"block_size_controller", SettleBlockSizes(cfg.get(), doers)}};
+}
+
+int main(int argc, char* argv[]) {
+  gflags::SetUsageMessage(
+      "Times the doers on a matrix of configs derived from conf_file");
+  gflags::SetVersionString(GetAgoraProjectVersion());
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  AGORA_LOG_INIT();
+
+  std::string base_conf_text;
+  Utils::LoadTddConfig(FLAGS_conf_file, base_conf_text);
+  const auto base_conf =
+      nlohmann::json::parse(base_conf_text, nullptr, true, true);
+
+  nlohmann::json results = nlohmann::json::array();
+  for (const auto& bandwidth : Utils::Split(FLAGS_bandwidths, ',')) {
+    const auto fft_and_data = Utils::Split(bandwidth, ':');
+    RtAssert(fft_and_data.size() == 2,
+             "doer_bench: Bandwidths are fft_size:ofdm_data_num pairs");
+    for (const size_t num_antennas : ParseList(FLAGS_antennas)) {
+      for (const size_t num_ues : ParseList(FLAGS_ues)) {
+        if (num_ues > num_antennas) {
+          continue;
+        }
+        for (const size_t mcs : ParseList(FLAGS_mcs)) {
+          results.push_back(RunConfig(
+              base_conf, num_antennas, num_ues, std::stoul(fft_and_data.at(0)),
+              std::stoul(fft_and_data.at(1)), mcs));
+        }
+      }
+    }
+  }
+
+  const nlohmann::json report = {
+      {"context",
+       {{"version", GetAgoraProjectVersion()},
+        {"conf_file", FLAGS_conf_file},
+        {"nt_stores", FLAGS_nt_stores},
+        {"llc_misses",
+         BenchCounters().EventAvailable(PerfCounters::Event::kLlcMisses)},
+        {"freq_ghz", GetTime::MeasureRdtscFreq()}}},
+      {"benchmarks", results}};
+  std::ofstream out(FLAGS_json_out);
+  out << report.dump(2) << std::endl;
+  AGORA_LOG_INFO("doer_bench: Wrote %zu configs to %s\n", results.size(),
+                 FLAGS_json_out.c_str());
+  AGORA_LOG_SHUTDOWN();
+  return 0;
+}
@@ -0,0 +1,308 @@
+/**
+ * @file main.cc
+ * @brief Performance regression gate. Runs the ci configs in bench mode,
+ * compares the throughput and the per-stage latency of each to a checked-in
+ * baseline and writes the verdicts as a JSON report.
+ */
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "agora.h"
+#include "config.h"
+#include "data_generator.h"
+#include "gflags/gflags.h"
+#include "logger.h"
+#include "utils.h"
+#include "version_config.h"
+
+DEFINE_string(configs,
+              "tddconfig-sim-ul.json,tddconfig-sim-dl.json,"
+              "tddconfig-sim-both.json",
+              "Configs of files/config/ci to run");
+DEFINE_string(baseline,
+              TOSTRING(PROJECT_DIRECTORY) "/test/perf_gate/baseline.json",
+              "Baseline and tolerance bands the runs are compared to");
+DEFINE_string(report_out,
+              TOSTRING(PROJECT_DIRECTORY) "/files/experiment/perf_gate.json",
+              "File the report is written to");
+DEFINE_uint64(frames, 2000, "Frames processed per config");
+DEFINE_uint64(core_offset, 0,
+              "Core offset of every run, which fixes the core layout");
+DEFINE_bool(update_baseline, false,
+            "Write the measurements of this host as the new baseline");
+
+static const std::string kConfigDirectory =
+    TOSTRING(PROJECT_DIRECTORY) "/files/config/ci/";
+static const std::string kExperimentDirectory =
+    TOSTRING(PROJECT_DIRECTORY) "/files/experiment/";
+// Written by Stats::SaveToFile()
+static const std::string kStatsDataFilename =
+    kExperimentDirectory + "timeresult.txt";
+
+static double Median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  const size_t mid = values.size() / 2;
+  return ((values.size() % 2) == 1) ? values.at(mid)
+                                    : (values.at(mid - 1) + values.at(mid)) / 2;
+}
+
+/// Median of each column of the stats file over the frames after
+/// skip_frames. The first column, the absolute reference time, is left out.
+static nlohmann::json ReadStageLatency(size_t skip_frames) {
+  std::ifstream in(kStatsDataFilename);
+  RtAssert(in.is_open(), "perf_gate: Failed to open " + kStatsDataFilename);
+  std::string line;
+  std::getline(in, line);
+  std::vector<std::string> names;
+  for (auto name : Utils::Split(line, ',')) {
+    name.erase(0, name.find_first_not_of(' '));
+    names.push_back(name);
+  }
+  std::vector<std::vector<double>> columns(names.size());
+  for (size_t frame = 0; std::getline(in, line); frame++) {
+    if (frame < skip_frames) {
+      continue;
+    }
+    std::istringstream row(line);
+    double value;
+    for (size_t i = 0; (i < names.size()) && (row >> value); i++) {
+      columns.at(i).push_back(value);
+    }
+  }
+
+  nlohmann::json stages = nlohmann::json::object();
+  for (size_t i = 1; i < names.size(); i++) {
+    stages[names.at(i)] = Median(columns.at(i));
+  }
+  return stages;
+}
+
+/// Run conf_name in bench mode and write its measurements to result_file.
+/// Each run needs a process of its own, as the cores that a run assigns stay
+/// taken until the process exits.
+static void RunConfig(const std::string& conf_name,
+                      const std::string& result_file) {
+  std::string conf_text;
+  Utils::LoadTddConfig(kConfigDirectory + conf_name, conf_text);
+  auto conf = nlohmann::json::parse(conf_text, nullptr, true, true);
+  conf["bench_mode"] = true;
+  conf["max_frame"] = FLAGS_frames;
+  conf["core_offset"] = FLAGS_core_offset;
+  const std::string conf_file =
+      "/tmp/perf_gate_" + std::to_string(::getpid()) + ".json";
+  {
+    std::ofstream out(conf_file);
+    out << conf.dump();
+  }
+  auto cfg = std::make_unique<Config>(conf_file);
+  DataGenerator(cfg.get()).DoDataGeneration(kExperimentDirectory);
+  cfg->GenData();
+  std::remove(conf_file.c_str());
+
+  double frames_per_sec;
+  {
+    auto agora = std::make_unique<Agora>(cfg.get());
+    agora->Start();
+    frames_per_sec = agora->BenchFramesPerSec();
+  }
+  RtAssert(frames_per_sec > 0,
+           "perf_gate: " + conf_name + " did not get past the warm-up frames");
+
+  // The cores the threads of the run were pinned to
+  nlohmann::json txrx_cores = nlohmann::json::array();
+  for (size_t tid = 0; tid < cfg->SocketThreadNum(); tid++) {
+    txrx_cores.push_back(CoreIdWithOffset(cfg->CoreOffset() + 1, tid));
+  }
+  nlohmann::json worker_cores = nlohmann::json::array();
+  for (size_t tid = 0; tid < cfg->WorkerThreadNum(); tid++) {
+    worker_cores.push_back(CoreIdWithOffset(
+        cfg->CoreOffset() + 1 + cfg->SocketThreadNum(), tid));
+  }
+
+  const nlohmann::json result = {
+      {"frames_per_sec", frames_per_sec},
+      {"stage_latency_us", ReadStageLatency(cfg->FrameWindow())},
+      {"core_layout",
+       {{"master", CoreIdWithOffset(cfg->CoreOffset(), 0)},
+        {"txrx", txrx_cores},
+        {"workers", worker_cores}}}};
+  std::ofstream out(result_file);
+  out << result.dump();
+}
+
+/// Run conf_name in a child process, null if the run failed
+static nlohmann::json RunConfigInChild(const std::string& conf_name) {
+  const std::string result_file = "/tmp/perf_gate_" +
+                                  std::to_string(::getpid()) + "_" +
+                                  conf_name;
+  std::fflush(stdout);
+  const pid_t pid = ::fork();
+  RtAssert(pid >= 0, "perf_gate: fork failed");
+  if (pid == 0) {
+    AGORA_LOG_INIT();
+    int ret = EXIT_SUCCESS;
+    try {
+      RunConfig(conf_name, result_file);
+    } catch (const std::exception& e) {
+      AGORA_LOG_ERROR("perf_gate: %s failed: %s\n", conf_name.c_str(),
+                      e.what());
+      ret = EXIT_FAILURE;
+    }
+    AGORA_LOG_SHUTDOWN();
+    std::exit(ret);
+  }
+
+  int status;
+  ::waitpid(pid, &status, 0);
+  nlohmann::json result;
+  std::ifstream in(result_file);
+  if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS) &&
+      in.is_open()) {
+    in >> result;
+  }
+  std::remove(result_file.c_str());
+  return result;
+}
+
+/// Compare value to the baseline of a metric. Throughput regresses when it
+/// falls below the band, latency when it rises above it.
+static nlohmann::json CompareMetric(const std::string& metric, double value,
+                                    const nlohmann::json& baseline,
+                                    double tolerance_pct,
+                                    bool higher_is_better) {
+  nlohmann::json verdict = {{"metric", metric}, {"value", value}};
+  if (baseline.is_number() == false) {
+    verdict["status"] = "new";
+    return verdict;
+  }
+  const double base = baseline.get<double>();
+  const double change_pct =
+      (base != 0) ? ((value - base) * 100.0) / base : 0;
+  const double worse_pct = higher_is_better ? -change_pct : change_pct;
+  verdict["baseline"] = base;
+  verdict["change_pct"] = change_pct;
+  verdict["tolerance_pct"] = tolerance_pct;
+  if (worse_pct > tolerance_pct) {
+    verdict["status"] = "regression";
+  } else if (-worse_pct > tolerance_pct) {
+    verdict["status"] = "improved";
+  } else {
+    verdict["status"] = "pass";
+  }
+  return verdict;
+}
+
+int main(int argc, char* argv[]) {
+  gflags::SetUsageMessage(
+      "Compares the bench mode runs of the ci configs to a baseline");
+  gflags::SetVersionString(GetAgoraProjectVersion());
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Set up the logger only in the runs, it does not survive a fork
+  std::string baseline_text;
+  Utils::LoadTddConfig(FLAGS_baseline, baseline_text);
+  auto baseline = nlohmann::json::parse(baseline_text, nullptr, true, true);
+  const double throughput_tolerance =
+      baseline.at("tolerance_pct").value("frames_per_sec", 10.0);
+  const double latency_tolerance =
+      baseline.at("tolerance_pct").value("stage_latency_us", 10.0);
+
+  bool passed = true;
+  nlohmann::json results = nlohmann::json::array();
+  for (const auto& conf_name : Utils::Split(FLAGS_configs, ',')) {
+    std::printf("perf_gate: Running %s\n", conf_name.c_str());
+    const nlohmann::json result = RunConfigInChild(conf_name);
+    if (result.is_null()) {
+      std::printf("perf_gate: %s failed to run\n", conf_name.c_str());
+      results.push_back({{"config", conf_name}, {"status", "error"}});
+      passed = false;
+      continue;
+    }
+    const nlohmann::json base =
+        baseline["configs"].value(conf_name, nlohmann::json::object());
+    nlohmann::json metrics = nlohmann::json::array();
+    metrics.push_back(CompareMetric(
+        "frames_per_sec", result.at("frames_per_sec").get<double>(),
+        base.value("frames_per_sec", nlohmann::json()), throughput_tolerance,
+        true));
+    const nlohmann::json base_stages =
+        base.value("stage_latency_us", nlohmann::json::object());
+    for (const auto& stage : result.at("stage_latency_us").items()) {
+      metrics.push_back(CompareMetric(
+          stage.key(), stage.value().get<double>(),
+          base_stages.value(stage.key(), nlohmann::json()), latency_tolerance,
+          false));
+    }
+
+    std::string status = base.empty() ? "new" : "pass";
+    for (const auto& metric : metrics) {
+      if (metric.at("status") == "regression") {
+        status = "regression";
+        passed = false;
+        std::printf("perf_gate: %s %s regressed by %.1f%%\n",
+                    conf_name.c_str(),
+                    metric.at("metric").get<std::string>().c_str(),
+                    std::fabs(metric.at("change_pct").get<double>()));
+      }
+    }
+    // Numbers of different cores do not compare
+    const bool layout_matches = base.empty() || (base.value("core_layout",
+                                                            nlohmann::json()) ==
+                                                 result.at("core_layout"));
+    if (layout_matches == false) {
+      std::printf(
+          "perf_gate: %s ran on another core layout than its baseline\n",
+          conf_name.c_str());
+    }
+    std::printf("perf_gate: %s %s, %.1f frames/s\n", conf_name.c_str(),
+                status.c_str(), result.at("frames_per_sec").get<double>());
+    results.push_back({{"config", conf_name},
+                       {"status", status},
+                       {"core_layout", result.at("core_layout")},
+                       {"layout_matches_baseline", layout_matches},
+                       {"metrics", metrics}});
+    if (FLAGS_update_baseline) {
+      baseline["configs"][conf_name] = result;
+    }
+  }
+
+  char host[256] = {0};
+  ::gethostname(host, sizeof(host) - 1);
+  const nlohmann::json report = {
+      {"context",
+       {{"version", GetAgoraProjectVersion()},
+        {"host", host},
+        {"baseline", FLAGS_baseline},
+        {"frames", FLAGS_frames},
+        {"core_offset", FLAGS_core_offset},
+        {"thread_pinning", kEnableThreadPinning}}},
+      {"passed", passed},
+      {"configs", results}};
+  {
+    std::ofstream out(FLAGS_report_out);
+    out << report.dump(2) << std::endl;
+  }
+  if (FLAGS_update_baseline) {
+    std::ofstream out(FLAGS_baseline);
+    out << baseline.dump(2) << std::endl;
+    std::printf("perf_gate: Updated the baseline %s\n",
+                FLAGS_baseline.c_str());
+  }
+  std::printf("perf_gate: %s, report written to %s\n",
+              passed ? "Passed" : "Failed", FLAGS_report_out.c_str());
+  gflags::ShutDownCommandLineFlags();
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
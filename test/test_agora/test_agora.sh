@@ -74,6 +74,19 @@ for i in `seq 1 $num_iters`; do
     sleep 1; ${build_dir}/sender --num_threads 1 --core_offset 10 --conf_file ${input_filepath}/tddconfig-correctness-test-ul.json
     wait
 
+    echo "==========================================="
+    echo "Generating data for uplink beam prediction correctness test $i......"
+    echo -e "===========================================\n"
+    ${build_dir}/data_generator --conf_file ${input_filepath}/tddconfig-correctness-test-ul-beam-prediction.json
+
+    echo -e "-------------------------------------------------------\n\n\n"
+    echo "==========================================="
+    echo "Running uplink beam prediction correctness test $i......"
+    echo -e "===========================================\n"
+    ${build_dir}/test_agora --conf_file ${input_filepath}/tddconfig-correctness-test-ul-beam-prediction.json &
+    sleep 1; ${build_dir}/sender --num_threads 1 --core_offset 10 --conf_file ${input_filepath}/tddconfig-correctness-test-ul-beam-prediction.json
+    wait
+
     echo "==========================================="
     echo "Generating data for downlink correctness test $i......"
     echo -e "===========================================\n"
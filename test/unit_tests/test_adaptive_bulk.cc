@@ -0,0 +1,53 @@
+/**
+ * @file test_adaptive_bulk.cc
+ * @brief Test how the AdaptiveBulk dequeue size follows a queue backlog.
+ */
+#include <gtest/gtest.h>
+
+#include "adaptive_bulk.h"
+
+TEST(TestAdaptiveBulk, GrowsWithTheBacklog) {
+  AdaptiveBulk bulk(8, 32);
+  EXPECT_EQ(bulk.Size(), 8u);
+  bulk.Update(bulk.Size(), 8);
+  EXPECT_EQ(bulk.Size(), 16u);
+  bulk.Update(bulk.Size(), 16);
+  EXPECT_EQ(bulk.Size(), 32u);
+  // Capped at the largest size
+  bulk.Update(bulk.Size(), 32);
+  EXPECT_EQ(bulk.Size(), 32u);
+}
+
+TEST(TestAdaptiveBulk, ShrinksOnAShortQueue) {
+  AdaptiveBulk bulk(8, 32);
+  bulk.Update(8, 8);
+  bulk.Update(16, 16);
+  // At least half of the request keeps the size
+  bulk.Update(32, 16);
+  EXPECT_EQ(bulk.Size(), 32u);
+  bulk.Update(32, 15);
+  EXPECT_EQ(bulk.Size(), 16u);
+  bulk.Update(16, 0);
+  bulk.Update(8, 0);
+  EXPECT_EQ(bulk.Size(), 8u);
+}
+
+TEST(TestAdaptiveBulk, RequestsCappedByTheCaller) {
+  AdaptiveBulk bulk(8, 32);
+  // A full dequeue of a smaller request than the size does not grow it
+  bulk.Update(4, 4);
+  EXPECT_EQ(bulk.Size(), 8u);
+}
+
+TEST(TestAdaptiveBulk, FixedSize) {
+  AdaptiveBulk bulk(8, 8);
+  bulk.Update(8, 8);
+  EXPECT_EQ(bulk.Size(), 8u);
+  bulk.Update(8, 0);
+  EXPECT_EQ(bulk.Size(), 8u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
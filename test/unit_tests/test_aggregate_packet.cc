@@ -0,0 +1,41 @@
+/**
+ * @file test_aggregate_packet.cc
+ * @brief Test the index and payload layout of AggregatePacket.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "message.h"
+
+static constexpr size_t kPayloadBytes = 4 * 80;
+
+TEST(TestAggregatePacket, PayloadsFollowTheIndex) {
+  std::vector<std::byte> buf(AggregatePacket::Length(3, kPayloadBytes));
+  auto* agg = reinterpret_cast<AggregatePacket*>(buf.data());
+  EXPECT_EQ(reinterpret_cast<std::byte*>(agg->Samples(0, kPayloadBytes)),
+            buf.data() + Packet::kOffsetOfData);
+  EXPECT_EQ(reinterpret_cast<std::byte*>(agg->Samples(2, kPayloadBytes)),
+            buf.data() + Packet::kOffsetOfData + (2 * kPayloadBytes));
+  // One payload is as long as a Packet
+  EXPECT_EQ(AggregatePacket::Length(1, kPayloadBytes),
+            Packet::kOffsetOfData + kPayloadBytes);
+}
+
+TEST(TestAggregatePacket, NumEntriesChecksTheLength) {
+  std::vector<std::byte> buf(
+      AggregatePacket::Length(AggregatePacket::kMaxEntries, kPayloadBytes));
+  auto* agg = reinterpret_cast<AggregatePacket*>(buf.data());
+  agg->num_entries_ = 3;
+  EXPECT_EQ(agg->NumEntries(AggregatePacket::Length(3, kPayloadBytes),
+                            kPayloadBytes),
+            3u);
+  // A truncated datagram
+  EXPECT_EQ(agg->NumEntries(AggregatePacket::Length(3, kPayloadBytes) - 1,
+                            kPayloadBytes),
+            0u);
+  agg->num_entries_ = 0;
+  EXPECT_EQ(agg->NumEntries(Packet::kOffsetOfData, kPayloadBytes), 0u);
+  agg->num_entries_ = AggregatePacket::kMaxEntries + 1;
+  EXPECT_EQ(agg->NumEntries(buf.size() + kPayloadBytes, kPayloadBytes), 0u);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file test_amx_gram.cc
+ * @brief Test the AMX Gram matrix kernel against the float Gram matrix.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "amx_gram.h"
+
+using Cx = std::complex<float>;
+
+TEST(TestAmxGram, Bf16Rounding) {
+  EXPECT_EQ(AmxGram::ToBf16(1.0f), 0x3F80);
+  EXPECT_EQ(AmxGram::ToBf16(-2.0f), 0xC000);
+  // 1 + 2^-8 is halfway between 1 and 1 + 2^-7: ties to even
+  EXPECT_EQ(AmxGram::ToBf16(1.0f + std::ldexp(1.0f, -8)), 0x3F80);
+  EXPECT_EQ(AmxGram::ToBf16(1.0f + 3 * std::ldexp(1.0f, -8)), 0x3F82);
+}
+
+/// Compare the AMX Gram matrix of a random channel with the float one,
+/// relative to the norms of the columns
+static void CheckGram(size_t num_ants, size_t num_streams) {
+  std::mt19937 gen(num_ants * 100 + num_streams);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<Cx> csi(num_ants * num_streams);
+  for (auto& h : csi) {
+    h = Cx(dist(gen), dist(gen));
+  }
+  std::vector<Cx> gram(num_streams * num_streams);
+  AmxGram::ComputeGram(reinterpret_cast<const float*>(csi.data()), num_ants,
+                       num_streams, reinterpret_cast<float*>(gram.data()));
+
+  for (size_t j = 0; j < num_streams; j++) {
+    for (size_t i = 0; i < num_streams; i++) {
+      Cx expected = 0;
+      float norm_i = 0;
+      float norm_j = 0;
+      for (size_t ant = 0; ant < num_ants; ant++) {
+        const Cx& h_i = csi.at(i * num_ants + ant);
+        const Cx& h_j = csi.at(j * num_ants + ant);
+        expected += std::conj(h_i) * h_j;
+        norm_i += std::norm(h_i);
+        norm_j += std::norm(h_j);
+      }
+      const float bound =
+          4 * AmxGram::kBf16Epsilon * std::sqrt(norm_i * norm_j);
+      const Cx& g = gram.at(j * num_streams + i);
+      EXPECT_NEAR(g.real(), expected.real(), bound);
+      EXPECT_NEAR(g.imag(), expected.imag(), bound);
+      // Exactly Hermitian
+      EXPECT_EQ(g, std::conj(gram.at(i * num_streams + j)));
+    }
+  }
+}
+
+TEST(TestAmxGram, MatchesFloat) {
+  if (AmxGram::Available() == false) {
+    GTEST_SKIP() << "AMX-BF16 is not available";
+  }
+  CheckGram(64, 8);
+  CheckGram(16, 4);
+  // Antennas that do not fill a tile
+  CheckGram(40, 3);
+  CheckGram(7, 1);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
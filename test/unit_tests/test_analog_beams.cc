@@ -0,0 +1,65 @@
+/**
+ * @file test_analog_beams.cc
+ * @brief Test the beam sweep of AnalogBeams and its power kernel.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <thread>
+#include <vector>
+
+#include "analog_beams.h"
+
+TEST(TestAnalogBeams, Power) {
+  // Odd lengths go through the scalar tail
+  for (const size_t n : {1ul, 7ul, 8ul, 64ul, 1201ul}) {
+    std::vector<complex_float> x(n);
+    float expected = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+      x.at(i).re = 0.01f * static_cast<float>(i % 13);
+      x.at(i).im = -0.02f * static_cast<float>(i % 7);
+      expected += (x.at(i).re * x.at(i).re) + (x.at(i).im * x.at(i).im);
+    }
+    EXPECT_NEAR(AnalogBeams::Power(x.data(), n), expected, 1e-4 * expected)
+        << n;
+  }
+}
+
+TEST(TestAnalogBeams, Sweep) {
+  static constexpr size_t kNumBeams = 4;
+  static constexpr size_t kInterval = 10;
+  static constexpr size_t kNumWorkers = 4;
+  AnalogBeams beams(kNumBeams, kInterval);
+  EXPECT_EQ(beams.BeamOfFrame(2), 2u);
+  EXPECT_EQ(beams.BeamOfFrame(5), 0u);
+
+  // Beam 2 gets the most power in the first sweep, beam 1 in the second
+  for (size_t frame = 0; frame < 2 * kInterval; frame++) {
+    const size_t beam = beams.BeamOfFrame(frame);
+    const size_t best = (frame < kInterval) ? 2 : 1;
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < kNumWorkers; w++) {
+      workers.emplace_back([&]() {
+        for (size_t i = 0; i < 100; i++) {
+          beams.AddPilotPower(frame, (beam == best) ? 2.0f : 1.0f);
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    const bool changed = beams.CompleteFrame(frame);
+    EXPECT_EQ(changed, (frame == kNumBeams - 1) ||
+                           (frame == kInterval + kNumBeams - 1))
+        << frame;
+  }
+  EXPECT_EQ(beams.SelectedBeam(), 1u);
+  EXPECT_EQ(beams.BeamPower(1), 800.0f);
+  EXPECT_EQ(beams.BeamPower(3), 400.0f);
+  EXPECT_EQ(beams.BeamOfFrame(2 * kInterval + kNumBeams), 1u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
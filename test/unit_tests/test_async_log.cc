@@ -0,0 +1,92 @@
+/**
+ * @file test_async_log.cc
+ * @brief Test the records and the rate limit of the asynchronous log backend.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "async_log.h"
+#include "logger.h"
+
+static constexpr uint64_t kNsPerSec = 1000000000;
+
+// Everything written to stream since it was opened
+static std::string ReadAll(FILE* stream) {
+  std::fflush(stream);
+  std::rewind(stream);
+  std::string text;
+  char buf[512];
+  size_t len;
+  while ((len = std::fread(buf, 1, sizeof(buf), stream)) > 0) {
+    text.append(buf, len);
+  }
+  return text;
+}
+
+TEST(TestAsyncLog, CopiesTheArguments) {
+  FILE* stream = std::tmpfile();
+  ASSERT_NE(stream, nullptr);
+  AsyncLog::Start(stream);
+  std::string name = "first";
+  AsyncLog::Log(AGORA_LOG_LEVEL_INFO, 0, "%s %zu %.2f %d\n", name.c_str(),
+                size_t{42}, 1.5f, -3);
+  // The record holds its own copy of the string
+  name = "other";
+  AsyncLog::Log(AGORA_LOG_LEVEL_WARN, 5, "no arguments\n");
+  AsyncLog::Stop();
+
+  const std::string text = ReadAll(stream);
+  EXPECT_NE(text.find("INFOR: first 42 1.50 -3\n"), std::string::npos)
+      << text;
+  EXPECT_NE(
+      text.find("WARNG: (5 similar messages suppressed) no arguments\n"),
+      std::string::npos)
+      << text;
+  EXPECT_EQ(text.find("other"), std::string::npos) << text;
+  std::fclose(stream);
+}
+
+TEST(TestAsyncLog, TruncatesLongStrings) {
+  FILE* stream = std::tmpfile();
+  ASSERT_NE(stream, nullptr);
+  AsyncLog::Start(stream);
+  const std::string long_str(2 * AsyncLog::kRecordBytes, 'x');
+  AsyncLog::Log(AGORA_LOG_LEVEL_INFO, 0, "[%s][%s]\n", long_str.c_str(),
+                "second");
+  AsyncLog::Stop();
+
+  const std::string text = ReadAll(stream);
+  // The first string fills the record, the second one finds no space
+  const size_t start = text.find('[');
+  ASSERT_NE(start, std::string::npos);
+  const size_t end = text.find("][]\n", start);
+  ASSERT_NE(end, std::string::npos) << text;
+  EXPECT_GT(end - start - 1, AsyncLog::kRecordBytes / 2);
+  EXPECT_LT(end - start - 1, AsyncLog::kRecordBytes);
+  std::fclose(stream);
+}
+
+TEST(TestAsyncLog, RateLimit) {
+  AsyncLog::RateLimit limit;
+  const uint64_t start = 100 * kNsPerSec;
+  uint32_t suppressed = 0;
+  for (size_t i = 0; i < AsyncLog::kRateLimitPerSec; i++) {
+    EXPECT_TRUE(limit.Allow(start + i, suppressed));
+    EXPECT_EQ(suppressed, 0u);
+  }
+  for (size_t i = 0; i < 7; i++) {
+    EXPECT_FALSE(limit.Allow(start + kNsPerSec / 2, suppressed));
+  }
+  // The next second reports the suppressed messages once
+  EXPECT_TRUE(limit.Allow(start + kNsPerSec, suppressed));
+  EXPECT_EQ(suppressed, 7u);
+  EXPECT_TRUE(limit.Allow(start + kNsPerSec, suppressed));
+  EXPECT_EQ(suppressed, 0u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
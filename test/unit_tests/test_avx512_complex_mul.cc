@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <complex>
+
 #include "comms-lib.h"
 #include "gettime.h"
 
@@ -102,6 +104,53 @@ TEST(TestComplexMul, ConjMultiply) {
       << "AVX512 and AVX256 conjugate multiplication differ";
 }
 
+TEST(TestComplexMul, Sign) {
+  float values[16] __attribute((aligned(64)));
+  float out512[16] __attribute((aligned(64)));
+  for (float& value : values) {
+    // Set each float to a random value between -1 and 1
+    value = 2.0f * static_cast<float>(rand()) / static_cast<float>(RAND_MAX) -
+            1.0f;
+  }
+  // The sign of 0 is 0
+  values[6] = 0.0f;
+  values[7] = 0.0f;
+  _mm512_store_ps(out512,
+                  CommsLib::M512ComplexCf32Sign(_mm512_load_ps(values)));
+  for (size_t i = 0; i < 16; i += 2) {
+    const std::complex<float> z(values[i], values[i + 1]);
+    const std::complex<float> sign =
+        (std::abs(z) == 0.0f) ? std::complex<float>(0.0f, 0.0f)
+                              : z / std::abs(z);
+    ASSERT_NEAR(out512[i], sign.real(), 1e-6) << "complex sample " << i / 2;
+    ASSERT_NEAR(out512[i + 1], sign.imag(), 1e-6) << "complex sample " << i / 2;
+  }
+}
+
+TEST(TestComplexMul, EqualizeSiso) {
+  // Covers the AVX-512, AVX2 and scalar parts of the kernel
+  static constexpr size_t kNumSc = 29;
+  complex_float y[kNumSc];
+  complex_float h[kNumSc];
+  complex_float out[kNumSc];
+  for (size_t i = 0; i < kNumSc; i++) {
+    y[i] = {2.0f * static_cast<float>(rand()) / RAND_MAX - 1.0f,
+            2.0f * static_cast<float>(rand()) / RAND_MAX - 1.0f};
+    h[i] = {static_cast<float>(rand()) / RAND_MAX + 0.1f,
+            2.0f * static_cast<float>(rand()) / RAND_MAX - 1.0f};
+  }
+  const std::complex<float> phase = std::polar(1.0f, 0.3f);
+  CommsLib::EqualizeSisoCf32(y, h, {phase.real(), phase.imag()}, out, kNumSc);
+  for (size_t i = 0; i < kNumSc; i++) {
+    const std::complex<float> expected =
+        (std::complex<float>(y[i].re, y[i].im) /
+         std::complex<float>(h[i].re, h[i].im)) *
+        phase;
+    ASSERT_NEAR(out[i].re, expected.real(), 1e-4) << "subcarrier " << i;
+    ASSERT_NEAR(out[i].im, expected.imag(), 1e-4) << "subcarrier " << i;
+  }
+}
+
 #endif
 
 int main(int argc, char** argv) {
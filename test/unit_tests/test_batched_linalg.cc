@@ -0,0 +1,311 @@
+/**
+ * @file test_batched_linalg.cc
+ * @brief Test the batched small-matrix kernels of every backend the build
+ * supports against straightforward double precision references.
+ */
+
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <complex>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "batched_linalg.h"
+
+using BatchedLinalg::CxBatch;
+using BatchedLinalg::kBatchScs;
+using CxDouble = std::complex<double>;
+// Row-major reference matrix of one subcarrier
+using RefMat = std::vector<CxDouble>;
+
+static constexpr double kAllowedError = 1e-4;
+
+static std::mt19937 rng(1);
+
+template <size_t kRows, size_t kCols>
+static void FillRandom(CxBatch<kRows, kCols>& batch) {
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (size_t i = 0; i < CxBatch<kRows, kCols>::kPlaneSize; i++) {
+    batch.re_[i] = dist(rng);
+    batch.im_[i] = dist(rng);
+  }
+}
+
+/// a' * a + kRows * I, well conditioned Hermitian positive definite
+template <size_t kN>
+static void FillHpd(CxBatch<kN, kN>& batch) {
+  CxBatch<kN, kN> a;
+  FillRandom(a);
+  BatchedLinalg::GramBatch<BatchedLinalg::ScalarLanes>(
+      a.Planes(), static_cast<float>(kN), batch.Planes());
+}
+
+template <size_t kRows, size_t kCols>
+static RefMat ToRef(const CxBatch<kRows, kCols>& batch, size_t sc) {
+  RefMat m(kRows * kCols);
+  for (size_t r = 0; r < kRows; r++) {
+    for (size_t c = 0; c < kCols; c++) {
+      m.at(r * kCols + c) = CxDouble(batch.At(r, c, sc));
+    }
+  }
+  return m;
+}
+
+static RefMat RefMul(const RefMat& a, const RefMat& b, size_t m, size_t k,
+                     size_t n) {
+  RefMat c(m * n);
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      for (size_t x = 0; x < k; x++) {
+        c.at(i * n + j) += a.at(i * k + x) * b.at(x * n + j);
+      }
+    }
+  }
+  return c;
+}
+
+static RefMat RefHermitian(const RefMat& a, size_t rows, size_t cols) {
+  RefMat t(rows * cols);
+  for (size_t r = 0; r < rows; r++) {
+    for (size_t c = 0; c < cols; c++) {
+      t.at(c * rows + r) = std::conj(a.at(r * cols + c));
+    }
+  }
+  return t;
+}
+
+/// Inverse and determinant by Gauss-Jordan with partial pivoting
+static RefMat RefInverse(RefMat a, size_t n, CxDouble& det) {
+  RefMat inv(n * n);
+  for (size_t i = 0; i < n; i++) {
+    inv.at(i * n + i) = 1.0;
+  }
+  det = 1.0;
+  for (size_t k = 0; k < n; k++) {
+    size_t pivot_row = k;
+    for (size_t i = k + 1; i < n; i++) {
+      if (std::abs(a.at(i * n + k)) > std::abs(a.at(pivot_row * n + k))) {
+        pivot_row = i;
+      }
+    }
+    if (pivot_row != k) {
+      det = -det;
+      for (size_t j = 0; j < n; j++) {
+        std::swap(a.at(k * n + j), a.at(pivot_row * n + j));
+        std::swap(inv.at(k * n + j), inv.at(pivot_row * n + j));
+      }
+    }
+    const CxDouble pivot = a.at(k * n + k);
+    det *= pivot;
+    for (size_t j = 0; j < n; j++) {
+      a.at(k * n + j) /= pivot;
+      inv.at(k * n + j) /= pivot;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (i == k) {
+        continue;
+      }
+      const CxDouble factor = a.at(i * n + k);
+      for (size_t j = 0; j < n; j++) {
+        a.at(i * n + j) -= factor * a.at(k * n + j);
+        inv.at(i * n + j) -= factor * inv.at(k * n + j);
+      }
+    }
+  }
+  return inv;
+}
+
+/// ||actual - expected||_F / ||expected||_F
+template <size_t kRows, size_t kCols>
+static double RelError(const CxBatch<kRows, kCols>& batch, size_t sc,
+                       const RefMat& expected) {
+  const RefMat actual = ToRef(batch, sc);
+  double diff = 0;
+  double norm = 0;
+  for (size_t i = 0; i < expected.size(); i++) {
+    diff += std::norm(actual.at(i) - expected.at(i));
+    norm += std::norm(expected.at(i));
+  }
+  return std::sqrt(diff / norm);
+}
+
+template <class L, size_t kN>
+static void TestGemm() {
+  constexpr size_t kK = 5;
+  auto a = std::make_unique<CxBatch<kN, kK>>();
+  auto b = std::make_unique<CxBatch<kK, kN>>();
+  auto c = std::make_unique<CxBatch<kN, kN>>();
+  FillRandom(*a);
+  FillRandom(*b);
+  BatchedLinalg::Gemm<L>(std::as_const(*a).Planes(),
+                         std::as_const(*b).Planes(), c->Planes());
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    EXPECT_LT(RelError(*c, sc,
+                       RefMul(ToRef(*a, sc), ToRef(*b, sc), kN, kK, kN)),
+              kAllowedError)
+        << kN << "x" << kK << "x" << kN << " subcarrier " << sc;
+  }
+}
+
+template <class L, size_t kN>
+static void TestGram() {
+  constexpr size_t kRows = BatchedLinalg::kMaxDim;
+  auto a = std::make_unique<CxBatch<kRows, kN>>();
+  auto g = std::make_unique<CxBatch<kN, kN>>();
+  FillRandom(*a);
+  BatchedLinalg::GramBatch<L>(std::as_const(*a).Planes(), 0.5f, g->Planes());
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    const RefMat ref_a = ToRef(*a, sc);
+    RefMat expected = RefMul(RefHermitian(ref_a, kRows, kN), ref_a, kN,
+                             kRows, kN);
+    for (size_t i = 0; i < kN; i++) {
+      expected.at(i * kN + i) += 0.5;
+    }
+    EXPECT_LT(RelError(*g, sc, expected), kAllowedError)
+        << kN << " subcarrier " << sc;
+  }
+}
+
+template <class L, size_t kN>
+static void TestCholesky() {
+  auto a = std::make_unique<CxBatch<kN, kN>>();
+  auto l = std::make_unique<CxBatch<kN, kN>>();
+  FillHpd(*a);
+  ASSERT_TRUE(BatchedLinalg::CholeskyBatch<L>(std::as_const(*a).Planes(),
+                                              l->Planes()));
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    const RefMat ref_l = ToRef(*l, sc);
+    for (size_t i = 0; i < kN; i++) {
+      EXPECT_EQ(ref_l.at(i * kN + i).imag(), 0.0);
+      EXPECT_GT(ref_l.at(i * kN + i).real(), 0.0);
+      for (size_t j = i + 1; j < kN; j++) {
+        EXPECT_EQ(ref_l.at(i * kN + j), 0.0);
+      }
+    }
+    EXPECT_LT(RelError(*a, sc,
+                       RefMul(ref_l, RefHermitian(ref_l, kN, kN), kN, kN,
+                              kN)),
+              kAllowedError)
+        << kN << " subcarrier " << sc;
+  }
+}
+
+template <class L, size_t kN>
+static void TestInverse() {
+  auto a = std::make_unique<CxBatch<kN, kN>>();
+  auto inv = std::make_unique<CxBatch<kN, kN>>();
+  CxDouble det;
+
+  // General matrices, diagonally loaded so that they need no pivoting
+  FillRandom(*a);
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    for (size_t i = 0; i < kN; i++) {
+      a->Set(i, i, sc, a->At(i, i, sc) + static_cast<float>(2 * kN));
+    }
+  }
+  ASSERT_TRUE(
+      BatchedLinalg::InvertBatch<L>(std::as_const(*a).Planes(), inv->Planes()));
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    EXPECT_LT(RelError(*inv, sc, RefInverse(ToRef(*a, sc), kN, det)),
+              kAllowedError)
+        << kN << " subcarrier " << sc;
+  }
+
+  FillHpd(*a);
+  ASSERT_TRUE(BatchedLinalg::InvertBatch<L>(std::as_const(*a).Planes(),
+                                            inv->Planes(), true));
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    EXPECT_LT(RelError(*inv, sc, RefInverse(ToRef(*a, sc), kN, det)),
+              kAllowedError)
+        << kN << " Hermitian subcarrier " << sc;
+  }
+}
+
+template <class L, size_t kN>
+static void TestSolve() {
+  constexpr size_t kM = 3;
+  auto a = std::make_unique<CxBatch<kN, kN>>();
+  auto b = std::make_unique<CxBatch<kN, kM>>();
+  auto x = std::make_unique<CxBatch<kN, kM>>();
+  CxDouble det;
+  FillHpd(*a);
+  FillRandom(*b);
+  ASSERT_TRUE(BatchedLinalg::SolveBatch<L>(std::as_const(*a).Planes(),
+                                           std::as_const(*b).Planes(),
+                                           x->Planes()));
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    const RefMat expected =
+        RefMul(RefInverse(ToRef(*a, sc), kN, det), ToRef(*b, sc), kN, kN, kM);
+    EXPECT_LT(RelError(*x, sc, expected), kAllowedError)
+        << kN << " subcarrier " << sc;
+  }
+}
+
+template <class L, size_t kN>
+static void TestDeterminant() {
+  auto a = std::make_unique<CxBatch<kN, kN>>();
+  auto det = std::make_unique<CxBatch<1, 1>>();
+  FillHpd(*a);
+  ASSERT_TRUE(BatchedLinalg::DeterminantBatch<L>(std::as_const(*a).Planes(),
+                                                 det->Planes()));
+  for (size_t sc = 0; sc < kBatchScs; sc++) {
+    CxDouble expected;
+    RefInverse(ToRef(*a, sc), kN, expected);
+    EXPECT_LT(RelError(*det, sc, {expected}), kAllowedError)
+        << kN << " subcarrier " << sc;
+  }
+}
+
+// A rank-deficient matrix must be reported, not inverted
+template <class L>
+static void TestSingular() {
+  constexpr size_t kN = 4;
+  auto a = std::make_unique<CxBatch<kN, kN>>();
+  auto out = std::make_unique<CxBatch<kN, kN>>();
+  FillHpd(*a);
+  for (size_t i = 0; i < kN; i++) {
+    for (size_t j = 0; j < kN; j++) {
+      a->Set(i, j, kBatchScs - 1, (i == 0 || j == 0) ? 0.0f : 1.0f);
+    }
+  }
+  EXPECT_FALSE(BatchedLinalg::CholeskyBatch<L>(std::as_const(*a).Planes(),
+                                               out->Planes()));
+  EXPECT_FALSE(
+      BatchedLinalg::InvertBatch<L>(std::as_const(*a).Planes(), out->Planes()));
+  EXPECT_FALSE(BatchedLinalg::InvertBatch<L>(std::as_const(*a).Planes(),
+                                             out->Planes(), true));
+}
+
+template <class L, size_t... kNs>
+static void TestAllDims(std::index_sequence<kNs...> /*unused*/) {
+  (TestGemm<L, kNs + 1>(), ...);
+  (TestGram<L, kNs + 1>(), ...);
+  (TestCholesky<L, kNs + 1>(), ...);
+  (TestInverse<L, kNs + 1>(), ...);
+  (TestSolve<L, kNs + 1>(), ...);
+  (TestDeterminant<L, kNs + 1>(), ...);
+  TestSingular<L>();
+}
+
+template <class L>
+static void TestBackend() {
+  TestAllDims<L>(std::make_index_sequence<BatchedLinalg::kMaxDim>());
+}
+
+TEST(TestBatchedLinalg, Scalar) { TestBackend<BatchedLinalg::ScalarLanes>(); }
+
+#if defined(__AVX2__) && defined(__FMA__)
+TEST(TestBatchedLinalg, Avx2) { TestBackend<BatchedLinalg::Avx2Lanes>(); }
+#endif
+
+#if defined(__AVX512F__)
+TEST(TestBatchedLinalg, Avx512) { TestBackend<BatchedLinalg::Avx512Lanes>(); }
+#endif
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
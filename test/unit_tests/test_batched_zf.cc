@@ -0,0 +1,162 @@
+/**
+ * @file test_batched_zf.cc
+ * @brief Test the compile-time specialized batched ZF/MMSE and downlink
+ * precoder kernels against the Armadillo implementation.
+ */
+
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include "armadillo"
+#include "batched_beam.h"
+#include "memory_manage.h"
+
+static constexpr float kAllowedError = 1e-3;
+
+/// Fill the batch with random channels and compare every subcarrier with
+/// inv_sympd(H' * H + noise * I) * H'
+static void TestShape(size_t bs_ant_num, size_t ue_num, float noise,
+                      float* csi_re, float* csi_im, float* beam_re,
+                      float* beam_im) {
+  BatchedBeam::DetectorKernel kernel =
+      BatchedBeam::GetDetectorKernel(bs_ant_num, ue_num);
+  ASSERT_NE(kernel, nullptr);
+
+  std::vector<arma::cx_fmat> csi(BatchedBeam::kBatchScs);
+  for (size_t sc = 0; sc < BatchedBeam::kBatchScs; sc++) {
+    csi.at(sc) = arma::randn<arma::cx_fmat>(bs_ant_num, ue_num);
+    for (size_t i = 0; i < bs_ant_num * ue_num; i++) {
+      csi_re[i * BatchedBeam::kBatchScs + sc] = csi.at(sc)(i).real();
+      csi_im[i * BatchedBeam::kBatchScs + sc] = csi.at(sc)(i).imag();
+    }
+  }
+  ASSERT_TRUE(kernel(csi_re, csi_im, noise, beam_re, beam_im));
+
+  for (size_t sc = 0; sc < BatchedBeam::kBatchScs; sc++) {
+    const arma::cx_fmat& mat_csi = csi.at(sc);
+    arma::cx_fmat expected =
+        arma::inv_sympd(mat_csi.t() * mat_csi +
+                        noise * arma::eye<arma::cx_fmat>(ue_num, ue_num)) *
+        mat_csi.t();
+    arma::cx_fmat actual(ue_num, bs_ant_num);
+    for (size_t i = 0; i < bs_ant_num * ue_num; i++) {
+      actual(i) = arma::cx_float(beam_re[i * BatchedBeam::kBatchScs + sc],
+                                 beam_im[i * BatchedBeam::kBatchScs + sc]);
+    }
+    // Random square channels can be poorly conditioned, so compare the
+    // relative error of the whole matrix
+    const float error = arma::norm(actual - expected) / arma::norm(expected);
+    EXPECT_LT(error, kAllowedError)
+        << bs_ant_num << "x" << ue_num << " subcarrier " << sc;
+  }
+}
+
+static void TestAllShapes(float noise) {
+  auto* buffer = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      4 * BatchedBeam::kMaxPlaneSize * sizeof(float)));
+  float* csi_re = buffer;
+  float* csi_im = csi_re + BatchedBeam::kMaxPlaneSize;
+  float* beam_re = csi_im + BatchedBeam::kMaxPlaneSize;
+  float* beam_im = beam_re + BatchedBeam::kMaxPlaneSize;
+
+  arma::arma_rng::set_seed(1);
+  for (size_t bs_ant_num = 1; bs_ant_num <= BatchedBeam::kMaxBatchDim;
+       bs_ant_num++) {
+    for (size_t ue_num = 1; ue_num <= bs_ant_num; ue_num++) {
+      TestShape(bs_ant_num, ue_num, noise, csi_re, csi_im, beam_re, beam_im);
+    }
+  }
+  std::free(buffer);
+}
+
+TEST(TestBatchedZF, AllShapesZF) { TestAllShapes(0.0f); }
+
+TEST(TestBatchedZF, AllShapesMMSE) { TestAllShapes(0.1f); }
+
+TEST(TestBatchedZF, DownlinkPrecoder) {
+  auto* buffer = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      (4 * BatchedBeam::kMaxPlaneSize + 2 * BatchedBeam::kMaxVecPlaneSize) *
+          sizeof(float)));
+  float* ul_re = buffer;
+  float* ul_im = ul_re + BatchedBeam::kMaxPlaneSize;
+  float* dl_re = ul_im + BatchedBeam::kMaxPlaneSize;
+  float* dl_im = dl_re + BatchedBeam::kMaxPlaneSize;
+  float* calib_re = dl_im + BatchedBeam::kMaxPlaneSize;
+  float* calib_im = calib_re + BatchedBeam::kMaxVecPlaneSize;
+
+  arma::arma_rng::set_seed(2);
+  for (size_t bs_ant_num = 1; bs_ant_num <= BatchedBeam::kMaxBatchDim;
+       bs_ant_num++) {
+    for (size_t ue_num = 1; ue_num <= bs_ant_num; ue_num++) {
+      BatchedBeam::DownlinkKernel kernel =
+          BatchedBeam::GetDownlinkKernel(bs_ant_num, ue_num);
+      ASSERT_NE(kernel, nullptr);
+
+      std::vector<arma::cx_fmat> ul(BatchedBeam::kBatchScs);
+      std::vector<arma::cx_fvec> calib(BatchedBeam::kBatchScs);
+      for (size_t sc = 0; sc < BatchedBeam::kBatchScs; sc++) {
+        ul.at(sc) = arma::randn<arma::cx_fmat>(ue_num, bs_ant_num);
+        calib.at(sc) = arma::randn<arma::cx_fvec>(bs_ant_num);
+        for (size_t i = 0; i < bs_ant_num * ue_num; i++) {
+          ul_re[i * BatchedBeam::kBatchScs + sc] = ul.at(sc)(i).real();
+          ul_im[i * BatchedBeam::kBatchScs + sc] = ul.at(sc)(i).imag();
+        }
+        for (size_t i = 0; i < bs_ant_num; i++) {
+          calib_re[i * BatchedBeam::kBatchScs + sc] = calib.at(sc)(i).real();
+          calib_im[i * BatchedBeam::kBatchScs + sc] = calib.at(sc)(i).imag();
+        }
+      }
+      kernel(ul_re, ul_im, calib_re, calib_im, dl_re, dl_im);
+
+      for (size_t sc = 0; sc < BatchedBeam::kBatchScs; sc++) {
+        arma::cx_fmat tmp = ul.at(sc) * arma::diagmat(arma::sign(calib.at(sc)));
+        const arma::cx_fmat expected = (tmp / arma::abs(tmp).max()).st();
+        arma::cx_fmat actual(bs_ant_num, ue_num);
+        for (size_t i = 0; i < bs_ant_num * ue_num; i++) {
+          actual(i) = arma::cx_float(dl_re[i * BatchedBeam::kBatchScs + sc],
+                                     dl_im[i * BatchedBeam::kBatchScs + sc]);
+        }
+        EXPECT_LT(arma::abs(actual - expected).max(), kAllowedError)
+            << bs_ant_num << "x" << ue_num << " subcarrier " << sc;
+      }
+    }
+  }
+  std::free(buffer);
+}
+
+TEST(TestBatchedZF, UnsupportedShapes) {
+  EXPECT_EQ(BatchedBeam::GetDetectorKernel(BatchedBeam::kMaxBatchDim + 1, 1),
+            nullptr);
+  EXPECT_EQ(BatchedBeam::GetDetectorKernel(2, 3), nullptr);
+  EXPECT_EQ(BatchedBeam::GetDetectorKernel(4, 0), nullptr);
+  EXPECT_EQ(BatchedBeam::GetDownlinkKernel(2, 3), nullptr);
+}
+
+TEST(TestBatchedZF, SingularChannel) {
+  auto* buffer = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      4 * BatchedBeam::kMaxPlaneSize * sizeof(float)));
+  float* csi_re = buffer;
+  float* csi_im = csi_re + BatchedBeam::kMaxPlaneSize;
+  float* beam_re = csi_im + BatchedBeam::kMaxPlaneSize;
+  float* beam_im = beam_re + BatchedBeam::kMaxPlaneSize;
+
+  // Two identical UE columns
+  for (size_t i = 0; i < 4 * 2 * BatchedBeam::kBatchScs; i++) {
+    csi_re[i] = 1.0f;
+    csi_im[i] = 0.0f;
+  }
+  EXPECT_FALSE(BatchedBeam::GetDetectorKernel(4, 2)(csi_re, csi_im, 0.0f,
+                                                    beam_re, beam_im));
+  // Regularization makes the same channel invertible
+  EXPECT_TRUE(BatchedBeam::GetDetectorKernel(4, 2)(csi_re, csi_im, 0.1f,
+                                                   beam_re, beam_im));
+  std::free(buffer);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+/**
+ * @file test_beacon_correlator.cc
+ * @brief Test the streaming beacon correlator against
+ * CommsLib::FindBeaconAvx(), in one block and over many blocks.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <complex>
+#include <cstdlib>
+#include <vector>
+
+#include "beacon_correlator.h"
+#include "comms-lib.h"
+
+static constexpr size_t kWindowLen = 4096;
+static constexpr size_t kBeaconStart = 1000;
+static constexpr float kCorrScale = 1.0f;
+
+static std::vector<std::complex<float>> GoldSeq() {
+  const auto gold = CommsLib::GetSequence(128, CommsLib::kGoldIfft);
+  std::vector<std::complex<float>> seq;
+  for (size_t i = 0; i < gold.at(0).size(); i++) {
+    seq.emplace_back(gold.at(0).at(i), gold.at(1).at(i));
+  }
+  return seq;
+}
+
+// Noise with the beacon (two repetitions of seq) at beacon_start
+static std::vector<std::complex<int16_t>> MakeSamples(
+    const std::vector<std::complex<float>>& seq, size_t beacon_start) {
+  std::srand(0);
+  std::vector<std::complex<int16_t>> samples(kWindowLen);
+  for (auto& sample : samples) {
+    sample = std::complex<int16_t>((std::rand() % 401) - 200,
+                                   (std::rand() % 401) - 200);
+  }
+  float max_abs = 0;
+  for (const auto& value : seq) {
+    max_abs = std::max({max_abs, std::abs(value.real()),
+                        std::abs(value.imag())});
+  }
+  const float scale = 16000.0f / max_abs;
+  for (size_t i = 0; i < 2 * seq.size(); i++) {
+    const auto& value = seq.at(i % seq.size());
+    samples.at(beacon_start + i) +=
+        std::complex<int16_t>(static_cast<int16_t>(value.real() * scale),
+                              static_cast<int16_t>(value.imag() * scale));
+  }
+  return samples;
+}
+
+TEST(TestBeaconCorrelator, OneBlockMatchesFindBeaconAvx) {
+  const auto seq = GoldSeq();
+  const auto samples = MakeSamples(seq, kBeaconStart);
+  BeaconCorrelator correlator(seq, kWindowLen);
+
+  const ssize_t expected =
+      CommsLib::FindBeaconAvx(samples.data(), seq, kWindowLen, kCorrScale);
+  ASSERT_GE(expected, static_cast<ssize_t>(kBeaconStart + seq.size()));
+  EXPECT_EQ(correlator.Process(samples.data(), kWindowLen, kCorrScale),
+            expected);
+}
+
+TEST(TestBeaconCorrelator, ManyBlocksMatchOneBlock) {
+  const auto seq = GoldSeq();
+  // Blocks both smaller and larger than the sequence, split in the beacon
+  for (size_t block_len : {100u, 333u, 1024u}) {
+    const auto samples = MakeSamples(seq, kBeaconStart);
+    BeaconCorrelator correlator(seq, kWindowLen);
+    const ssize_t expected =
+        correlator.Process(samples.data(), kWindowLen, kCorrScale);
+    ASSERT_GE(expected, 0);
+
+    correlator.Reset();
+    ssize_t found = -1;
+    for (size_t offset = 0; offset < kWindowLen; offset += block_len) {
+      const size_t len = std::min(block_len, kWindowLen - offset);
+      const ssize_t peak =
+          correlator.Process(&samples.at(offset), len, kCorrScale);
+      if (peak >= 0) {
+        found = static_cast<ssize_t>(offset) + peak;
+      }
+    }
+    EXPECT_EQ(found, expected) << "block length " << block_len;
+  }
+}
+
+TEST(TestBeaconCorrelator, NoBeacon) {
+  const auto seq = GoldSeq();
+  auto samples = MakeSamples(seq, kBeaconStart);
+  for (size_t i = 0; i < 2 * seq.size(); i++) {
+    samples.at(kBeaconStart + i) = 0;
+  }
+  BeaconCorrelator correlator(seq, kWindowLen);
+  EXPECT_EQ(correlator.Process(samples.data(), kWindowLen, kCorrScale), -1);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,75 @@
+/**
+ * @file test_block_size_controller.cc
+ * @brief Test where the BlockSizeController settles for steady block times,
+ * worker counts and queue depths.
+ */
+#include <gtest/gtest.h>
+
+#include "block_size_controller.h"
+#include "message.h"
+
+static constexpr double kTargetUs = 10.0;
+static constexpr size_t kEventsPerWorker = 2;
+// Demul blocks of a symbol, e.g. 1200 subcarriers in blocks of 16
+static constexpr size_t kNumBlocks = 75;
+static constexpr size_t kFrames = 20;
+
+static void RunFrames(BlockSizeController& controller, double block_us,
+                      size_t queue_depth) {
+  for (size_t i = 0; i < kFrames; i++) {
+    controller.Update(EventType::kDemul, block_us, queue_depth);
+  }
+}
+
+TEST(TestBlockSizeController, ReachesTheTargetWithFewWorkers) {
+  BlockSizeController controller(kTargetUs, 2, kEventsPerWorker);
+  RunFrames(controller, 2.5, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks), 4u);
+  EXPECT_DOUBLE_EQ(controller.BlockUs(EventType::kDemul), 2.5);
+}
+
+TEST(TestBlockSizeController, StaysFineWithManyWorkers) {
+  // 75 blocks over 24 workers leave one block per event
+  BlockSizeController controller(kTargetUs, 24, kEventsPerWorker);
+  RunFrames(controller, 2.5, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks), 1u);
+
+  // Until the tasks queue up behind the busy workers
+  RunFrames(controller, 2.5, 1000);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks), 4u);
+}
+
+TEST(TestBlockSizeController, Bounds) {
+  BlockSizeController controller(kTargetUs, 1, kEventsPerWorker);
+  // Unmeasured stages follow the static batching
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kBeam, kNumBlocks),
+            EventData::kMaxTags);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kBeam, 1), 1u);
+
+  RunFrames(controller, 0.01, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks),
+            EventData::kMaxTags);
+  RunFrames(controller, 100.0, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks), 1u);
+}
+
+TEST(TestBlockSizeController, StepsGradually) {
+  BlockSizeController controller(kTargetUs, 1, kEventsPerWorker);
+  // At most a doubling per frame toward the 10 blocks of the target
+  controller.Update(EventType::kDemul, 1.0, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks), 2u);
+  controller.Update(EventType::kDemul, 1.0, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks), 4u);
+  controller.Update(EventType::kDemul, 1.0, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks),
+            EventData::kMaxTags);
+  // Frames without tasks of the stage leave it as it is
+  controller.Update(EventType::kDemul, 0.0, 0);
+  EXPECT_EQ(controller.BlocksPerEvent(EventType::kDemul, kNumBlocks),
+            EventData::kMaxTags);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
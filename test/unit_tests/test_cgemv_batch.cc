@@ -0,0 +1,107 @@
+/**
+ * @file test_cgemv_batch.cc
+ * @brief Test the batched complex matrix-vector products against one
+ * product per subcarrier.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "cgemv_batch.h"
+
+using Cx = std::complex<float>;
+
+/// y_k = A_k * x_k with column-major m x n matrices
+static std::vector<Cx> Reference(const std::vector<const Cx*>& a,
+                                 const std::vector<Cx>& x, size_t m,
+                                 size_t n) {
+  std::vector<Cx> y(a.size() * m);
+  for (size_t k = 0; k < a.size(); k++) {
+    for (size_t row = 0; row < m; row++) {
+      Cx sum = 0;
+      for (size_t col = 0; col < n; col++) {
+        sum += a.at(k)[col * m + row] * x.at(k * n + col);
+      }
+      y.at(k * m + row) = sum;
+    }
+  }
+  return y;
+}
+
+/// Multiply random matrices, with a matrix per subcarrier (strided) and with
+/// groups of share subcarriers sharing one (pointers)
+static void CheckBatch(size_t m, size_t n, size_t batch, size_t share) {
+  std::mt19937 gen(m * 100 + n);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  // Padded like the beam matrices in their backing buffer
+  const size_t stride = m * n + 8;
+  std::vector<Cx> mats(batch * stride);
+  std::vector<Cx> x(batch * n);
+  for (auto& v : mats) {
+    v = Cx(dist(gen), dist(gen));
+  }
+  for (auto& v : x) {
+    v = Cx(dist(gen), dist(gen));
+  }
+  CgemvBatch gemv(m, n, batch);
+
+  std::vector<const Cx*> strided(batch);
+  for (size_t k = 0; k < batch; k++) {
+    strided.at(k) = &mats.at(k * stride);
+  }
+  std::vector<Cx> y(batch * m);
+  gemv.RunStrided(reinterpret_cast<const complex_float*>(mats.data()), stride,
+                  reinterpret_cast<const complex_float*>(x.data()),
+                  reinterpret_cast<complex_float*>(y.data()), batch);
+  std::vector<Cx> ref = Reference(strided, x, m, n);
+  for (size_t i = 0; i < y.size(); i++) {
+    EXPECT_NEAR(std::abs(y.at(i) - ref.at(i)), 0.0f, 1e-4f) << "strided " << i;
+  }
+
+  std::vector<const Cx*> shared(batch);
+  for (size_t k = 0; k < batch; k++) {
+    shared.at(k) = &mats.at((k - (k % share)) * stride);
+  }
+  gemv.Run(reinterpret_cast<const complex_float* const*>(shared.data()),
+           reinterpret_cast<const complex_float*>(x.data()),
+           reinterpret_cast<complex_float*>(y.data()), batch);
+  ref = Reference(shared, x, m, n);
+  for (size_t i = 0; i < y.size(); i++) {
+    EXPECT_NEAR(std::abs(y.at(i) - ref.at(i)), 0.0f, 1e-4f) << "shared " << i;
+  }
+
+  // The same groups, one matrix per group, the last one partial
+  std::vector<const Cx*> group_mats;
+  std::vector<size_t> group_sizes;
+  for (size_t k = 0; k < batch; k += share) {
+    group_mats.push_back(shared.at(k));
+    group_sizes.push_back(std::min(share, batch - k));
+  }
+  std::fill(y.begin(), y.end(), Cx(0));
+  gemv.RunGroups(reinterpret_cast<const complex_float* const*>(
+                     group_mats.data()),
+                 group_sizes.data(), group_sizes.size(),
+                 reinterpret_cast<const complex_float*>(x.data()),
+                 reinterpret_cast<complex_float*>(y.data()));
+  for (size_t i = 0; i < y.size(); i++) {
+    EXPECT_NEAR(std::abs(y.at(i) - ref.at(i)), 0.0f, 1e-4f) << "groups " << i;
+  }
+}
+
+TEST(TestCgemvBatch, Equalize8x8) { CheckBatch(8, 8, 48, 1); }
+
+TEST(TestCgemvBatch, Equalize4x16) { CheckBatch(4, 16, 48, 4); }
+
+TEST(TestCgemvBatch, Precode16x4) { CheckBatch(16, 4, 64, 8); }
+
+TEST(TestCgemvBatch, PartialBatch) { CheckBatch(6, 10, 8, 2); }
+
+TEST(TestCgemvBatch, PartialGroup) { CheckBatch(4, 8, 20, 8); }
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
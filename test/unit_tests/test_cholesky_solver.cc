@@ -0,0 +1,98 @@
+/**
+ * @file test_cholesky_solver.cc
+ * @brief Test the Cholesky solver of the detector Gram matrices.
+ */
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "cholesky_solver.h"
+
+using Cx = std::complex<float>;
+
+/// Gram matrix H' * H (column-major) of a random num_ants x n channel whose
+/// last column is scaled by last_col_gain
+static std::vector<Cx> RandomGram(size_t num_ants, size_t n,
+                                  float last_col_gain) {
+  std::mt19937 gen(num_ants * 10 + n);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<Cx> csi(num_ants * n);
+  for (size_t i = 0; i < csi.size(); i++) {
+    csi.at(i) = Cx(dist(gen), dist(gen));
+    if (i >= (n - 1) * num_ants) {
+      csi.at(i) *= last_col_gain;
+    }
+  }
+  std::vector<Cx> gram(n * n);
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < n; i++) {
+      for (size_t ant = 0; ant < num_ants; ant++) {
+        gram.at(j * n + i) +=
+            std::conj(csi.at(i * num_ants + ant)) * csi.at(j * num_ants + ant);
+      }
+    }
+  }
+  return gram;
+}
+
+TEST(TestCholeskySolver, SolvesWellConditioned) {
+  const size_t n = 8;
+  const size_t m = 3;
+  const std::vector<Cx> gram = RandomGram(64, n, 1.0f);
+  std::vector<Cx> factor = gram;
+  float rcond = 0;
+  ASSERT_TRUE(CholeskySolver::Factor(reinterpret_cast<float*>(factor.data()),
+                                     n, rcond));
+  EXPECT_GT(rcond, 0.1f);
+  EXPECT_LE(rcond, 1.0f);
+
+  std::vector<Cx> rhs(n * m);
+  for (size_t i = 0; i < rhs.size(); i++) {
+    rhs.at(i) = Cx(static_cast<float>(i), 1.0f - static_cast<float>(i));
+  }
+  std::vector<Cx> x = rhs;
+  CholeskySolver::Solve(reinterpret_cast<const float*>(factor.data()), n,
+                        reinterpret_cast<float*>(x.data()), m);
+  for (size_t col = 0; col < m; col++) {
+    for (size_t i = 0; i < n; i++) {
+      Cx product = 0;
+      for (size_t k = 0; k < n; k++) {
+        product += gram.at(k * n + i) * x.at(col * n + k);
+      }
+      EXPECT_NEAR(std::abs(product - rhs.at(col * n + i)), 0.0f, 1e-3f);
+    }
+  }
+}
+
+TEST(TestCholeskySolver, EstimatesIllConditioning) {
+  const size_t n = 4;
+  std::vector<Cx> good = RandomGram(16, n, 1.0f);
+  std::vector<Cx> bad = RandomGram(16, n, 1e-3f);
+  float good_rcond = 0;
+  float bad_rcond = 0;
+  ASSERT_TRUE(CholeskySolver::Factor(reinterpret_cast<float*>(good.data()), n,
+                                     good_rcond));
+  ASSERT_TRUE(CholeskySolver::Factor(reinterpret_cast<float*>(bad.data()), n,
+                                     bad_rcond));
+  EXPECT_LT(bad_rcond, 1e-5f);
+  EXPECT_GT(good_rcond, 1e3f * bad_rcond);
+}
+
+TEST(TestCholeskySolver, RejectsSingular) {
+  // Rank one: both columns of H are equal
+  std::vector<Cx> gram = {Cx(2, 0), Cx(2, 0), Cx(2, 0), Cx(2, 0)};
+  float rcond = 0;
+  EXPECT_FALSE(
+      CholeskySolver::Factor(reinterpret_cast<float*>(gram.data()), 2, rcond));
+
+  std::vector<Cx> zero(4, Cx(0, 0));
+  EXPECT_FALSE(
+      CholeskySolver::Factor(reinterpret_cast<float*>(zero.data()), 2, rcond));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,63 @@
+/**
+ * @file test_clock_sync.cc
+ * @brief Test the map of ClockSync from hardware time to TSC against clocks
+ * with a delay and a drift.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "clock_sync.h"
+
+static constexpr double kFreqGhz = 2.0;
+static constexpr double kCyclesPerUs = kFreqGhz * 1e3;
+static constexpr double kTscAtZero = 1e12;
+
+// TSC at which the hardware clock reads hw_us, drifting by drift_ppm
+static double TrueTsc(double hw_us, double drift_ppm) {
+  return kTscAtZero + (hw_us * kCyclesPerUs * (1.0 + (drift_ppm * 1e-6)));
+}
+
+// Feed symbols every 71.4 us, seen after 5 to 60 us, with 1 in 50 at 5 us
+static void Feed(ClockSync& sync, size_t num_symbols, double drift_ppm) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> delay_us(5.0, 60.0);
+  for (size_t i = 0; i < num_symbols; i++) {
+    const double hw_us = 71.4 * i;
+    const double delay = ((i % 50) == 0) ? 5.0 : delay_us(gen);
+    sync.Update(hw_us, static_cast<size_t>(TrueTsc(hw_us, drift_ppm) +
+                                           (delay * kCyclesPerUs)));
+  }
+}
+
+TEST(TestClockSync, LowerEnvelope) {
+  ClockSync sync(kFreqGhz);
+  EXPECT_FALSE(sync.Synced());
+  Feed(sync, 10 * ClockSync::kWindowSamples, 0.0);
+  ASSERT_TRUE(sync.Synced());
+  // The least delay is left in the map
+  for (const double hw_us : {1e5, 5e5, 7e5}) {
+    const double error_us =
+        (sync.ToHostTsc(hw_us) - TrueTsc(hw_us, 0.0)) / kCyclesPerUs;
+    EXPECT_NEAR(error_us, 5.0, 1.0) << hw_us;
+  }
+}
+
+TEST(TestClockSync, Drift) {
+  static constexpr double kDriftPpm = 50.0;
+  ClockSync sync(kFreqGhz);
+  const size_t num_symbols = 20 * ClockSync::kWindowSamples;
+  Feed(sync, num_symbols, kDriftPpm);
+  // 50 ppm is 73 us over the run, and the map extrapolates past its end
+  for (const double hw_us : {num_symbols * 71.4, num_symbols * 71.4 + 1e5}) {
+    const double error_us =
+        (sync.ToHostTsc(hw_us) - TrueTsc(hw_us, kDriftPpm)) / kCyclesPerUs;
+    EXPECT_NEAR(error_us, 5.0, 2.0) << hw_us;
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,66 @@
+/**
+ * @file test_core_placement.cc
+ * @brief Test the automatic core layout on a made-up two-socket topology.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "core_placement.h"
+
+// Two sockets with one NUMA node each, four physical cores of two hardware
+// threads per socket. CPU i + 8 is the sibling of CPU i.
+static std::vector<CorePlacement::Cpu> TwoSocketTopology() {
+  std::vector<CorePlacement::Cpu> cpus;
+  for (size_t id = 0; id < 16; id++) {
+    CorePlacement::Cpu cpu;
+    cpu.id_ = id;
+    cpu.numa_node_ = static_cast<int>((id % 8) / 4);
+    cpu.package_ = cpu.numa_node_;
+    cpu.core_first_cpu_ = id % 8;
+    cpu.isolated_ = (id == 6) || (id == 7);
+    cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+TEST(TestCorePlacement, ParseCpuList) {
+  EXPECT_EQ(CorePlacement::ParseCpuList("0-3,8,10-11\n"),
+            (std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(CorePlacement::ParseCpuList("").empty());
+}
+
+TEST(TestCorePlacement, DeviceNodeFirst) {
+  const auto slots = CorePlacement::Plan(TwoSocketTopology(), {0}, {1});
+  std::vector<size_t> order;
+  for (const auto& slot : slots) {
+    order.push_back(slot.cpu_);
+  }
+  // The isolated cores of the NIC's node, its other cores, the other socket,
+  // then the SMT siblings. CPU 8 has its core to itself since CPU 0 is
+  // excluded.
+  EXPECT_EQ(order, (std::vector<size_t>{6, 7, 4, 5, 1, 2, 3, 8, 12, 13, 14,
+                                        15, 9, 10, 11}));
+  EXPECT_FALSE(slots.at(0).remote_);
+  EXPECT_TRUE(slots.at(0).isolated_);
+  EXPECT_TRUE(slots.at(4).remote_);
+  EXPECT_FALSE(slots.at(7).smt_sibling_);
+  EXPECT_TRUE(slots.at(8).smt_sibling_);
+}
+
+TEST(TestCorePlacement, NoDevices) {
+  const auto slots = CorePlacement::Plan(TwoSocketTopology(), {}, {-1});
+  ASSERT_EQ(slots.size(), 16u);
+  // Without a known device node, the nodes keep their order
+  EXPECT_EQ(slots.at(0).cpu_, 0u);
+  EXPECT_EQ(slots.at(4).cpu_, 6u);
+  for (size_t i = 0; i < 8; i++) {
+    EXPECT_FALSE(slots.at(i).smt_sibling_);
+    EXPECT_FALSE(slots.at(i).remote_);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
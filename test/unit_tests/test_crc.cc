@@ -0,0 +1,62 @@
+/**
+ * @file test_crc.cc
+ * @brief Test the CRC24 of DoCRC against a bit-serial reference, over the
+ * lengths handled by the table and by the carry-less multiply folding.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "crc.h"
+
+// Bit-serial CRC24A, MSB first with a zero initial value
+static uint32_t ReferenceCrc24(const unsigned char* data, size_t len) {
+  static constexpr uint32_t kPoly = 0x1864CFBu;
+  uint32_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= static_cast<uint32_t>(data[i]) << 16;
+    for (size_t bit = 0; bit < 8; bit++) {
+      crc <<= 1;
+      if ((crc & 0x1000000u) != 0) {
+        crc ^= kPoly;
+      }
+    }
+  }
+  return crc & 0xFFFFFFu;
+}
+
+TEST(TestCrc24, MatchesBitSerialReference) {
+  DoCRC crc;
+  std::vector<unsigned char> data(4096 + 63);
+  for (auto& byte : data) {
+    byte = rand() % 256;
+  }
+  for (size_t len = 0; len <= 300; len++) {
+    ASSERT_EQ(crc.CalculateCrc24(data.data(), len),
+              ReferenceCrc24(data.data(), len))
+        << "length " << len;
+  }
+  for (size_t len : {511, 512, 1000, 1500, 4096, 4096 + 63}) {
+    ASSERT_EQ(crc.CalculateCrc24(data.data() + 1, len - 1),
+              ReferenceCrc24(data.data() + 1, len - 1))
+        << "length " << len - 1;
+  }
+}
+
+TEST(TestCrc24, CheckCrc24) {
+  DoCRC crc;
+  std::vector<unsigned char> data(1024);
+  for (auto& byte : data) {
+    byte = rand() % 256;
+  }
+  const uint32_t ref_crc = ReferenceCrc24(data.data(), data.size());
+  EXPECT_TRUE(crc.CheckCrc24(data.data(), data.size(), ref_crc));
+  data.at(517) ^= 0x10;
+  EXPECT_FALSE(crc.CheckCrc24(data.data(), data.size(), ref_crc));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+/**
+ * @file test_data_tap.cc
+ * @brief Test the shared-memory data taps between a producer and readers.
+ */
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstring>
+#include <thread>
+
+#include "data_tap.h"
+
+static constexpr size_t kRecordBytes = 256;
+static constexpr size_t kNumRecords = 100000;
+
+static void PublishValue(DataTap& tap, size_t frame_id, size_t value) {
+  TapRecord record{};
+  record.frame_id_ = static_cast<uint32_t>(frame_id);
+  record.bytes_ = sizeof(value);
+  tap.Publish(record, &value);
+}
+
+TEST(TestDataTap, WantedOnlyWithReader) {
+  DataTap tap("test_wanted", kRecordBytes, 8, 1);
+  EXPECT_FALSE(tap.Wanted(0));
+  {
+    TapReader reader("test_wanted");
+    EXPECT_TRUE(tap.Wanted(0));
+    EXPECT_EQ(reader.RecordBytes(), kRecordBytes);
+  }
+  EXPECT_FALSE(tap.Wanted(0));
+  EXPECT_THROW(TapReader("test_no_such_tap"), std::runtime_error);
+}
+
+TEST(TestDataTap, Subsample) {
+  DataTap tap("test_subsample", kRecordBytes, 8, 4);
+  TapReader reader("test_subsample");
+  EXPECT_TRUE(tap.Wanted(0));
+  EXPECT_FALSE(tap.Wanted(3));
+  EXPECT_TRUE(tap.Wanted(8));
+}
+
+TEST(TestDataTap, RoundTrip) {
+  DataTap tap("test_round_trip", kRecordBytes, 8, 1);
+  TapReader reader("test_round_trip");
+  std::array<uint8_t, kRecordBytes> data;
+  for (size_t i = 0; i < data.size(); i++) {
+    data.at(i) = static_cast<uint8_t>(i);
+  }
+  TapRecord record{};
+  record.frame_id_ = 12;
+  record.symbol_id_ = 3;
+  record.index_ = 2;
+  record.offset_ = 64;
+  record.bytes_ = 200;
+  tap.Publish(record, data.data());
+
+  std::array<uint8_t, kRecordBytes> buf{};
+  TapRecord out{};
+  ASSERT_TRUE(reader.Read(out, buf.data(), buf.size()));
+  EXPECT_EQ(out.seq_, 0u);
+  EXPECT_EQ(out.frame_id_, 12u);
+  EXPECT_EQ(out.symbol_id_, 3u);
+  EXPECT_EQ(out.index_, 2u);
+  EXPECT_EQ(out.offset_, 64u);
+  EXPECT_EQ(out.bytes_, 200u);
+  EXPECT_EQ(std::memcmp(buf.data(), data.data(), 200), 0);
+  EXPECT_FALSE(reader.Read(out, buf.data(), buf.size()));
+}
+
+TEST(TestDataTap, LappedReaderLosesRecords) {
+  DataTap tap("test_lapped", kRecordBytes, 8, 1);
+  TapReader reader("test_lapped");
+  for (size_t i = 0; i < 20; i++) {
+    PublishValue(tap, i, i);
+  }
+  // Only the last ring of records is left
+  TapRecord record{};
+  size_t value = 0;
+  ASSERT_TRUE(reader.Read(record, &value, sizeof(value)));
+  EXPECT_EQ(value, 12u);
+  EXPECT_EQ(reader.Lost(), 12u);
+  for (size_t i = 13; i < 20; i++) {
+    ASSERT_TRUE(reader.Read(record, &value, sizeof(value)));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(reader.Read(record, &value, sizeof(value)));
+}
+
+TEST(TestDataTap, ConcurrentProducer) {
+  DataTap tap("test_concurrent", kRecordBytes, 1024, 1);
+  TapReader reader("test_concurrent");
+  std::thread producer([&tap]() {
+    for (size_t i = 0; i < kNumRecords; i++) {
+      PublishValue(tap, i, i);
+    }
+  });
+  // Every record read is whole and in order, the rest are counted lost
+  TapRecord record{};
+  size_t value = 0;
+  size_t read = 0;
+  size_t last = 0;
+  while (read + reader.Lost() < kNumRecords) {
+    if (reader.Read(record, &value, sizeof(value))) {
+      ASSERT_EQ(value, record.frame_id_);
+      ASSERT_EQ(value, record.seq_);
+      ASSERT_TRUE((read == 0) || (value > last));
+      last = value;
+      read++;
+    }
+  }
+  producer.join();
+  EXPECT_EQ(read + reader.Lost(), kNumRecords);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -4,7 +4,10 @@
  */
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <bitset>
+#include <complex>
+#include <vector>
 
 #include "comms-lib.h"
 #include "datatype_conversion.h"
@@ -321,6 +324,253 @@ TEST(SIMD, float_to_int_saturate) {
   std::free(check);
 }
 
+TEST(SIMD, int16_to_float_fft_shift) {
+  // Complex samples of one FFT, a multiple of the samples per SIMD loop
+  static constexpr size_t kFftSize = 64;
+  auto* short_buf = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kFftSize * 2 * sizeof(short)));
+  auto* float_buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kFftSize * 2 * sizeof(float)));
+  auto* check_float = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kFftSize * 2 * sizeof(float)));
+  for (size_t j = 0; j < kFftSize * 2; j++) {
+    short_buf[j] = static_cast<int16_t>(rand());
+  }
+  SimdConvertShortToFloatFftShift(short_buf, float_buf, kFftSize * 2);
+  ConvertShortToFloat(short_buf, check_float, kFftSize * 2);
+  for (size_t j = 0; j < kFftSize * 2; j++) {
+    const float sign = ((j / 2) % 2 == 0) ? 1.0f : -1.0f;
+    ASSERT_EQ(float_buf[j], sign * check_float[j]) << "at " << j;
+  }
+
+  // The DFT of the converted samples is the shifted DFT of the samples
+  auto dft = [](const float* in, size_t k) {
+    std::complex<double> sum(0.0, 0.0);
+    for (size_t n = 0; n < kFftSize; n++) {
+      sum += std::complex<double>(in[2 * n], in[2 * n + 1]) *
+             std::polar(1.0, -2.0 * M_PI * k * n / kFftSize);
+    }
+    return sum;
+  };
+  for (size_t k = 0; k < kFftSize; k++) {
+    const std::complex<double> shifted = dft(float_buf, k);
+    const std::complex<double> expected =
+        dft(check_float, (k + kFftSize / 2) % kFftSize);
+    ASSERT_NEAR(std::abs(shifted - expected), 0.0, 1e-4) << "at " << k;
+  }
+  std::free(short_buf);
+  std::free(float_buf);
+  std::free(check_float);
+}
+
+TEST(SIMD, int16_to_float_cfo_rotate) {
+  // Several restarts of the phasor recurrence per symbol
+  static constexpr size_t kFftSize = 1024;
+  static constexpr size_t kCpLen = 72;
+  static constexpr double kAmplitude = 8000.0;
+  // In subcarrier spacings
+  static constexpr double kCfo = 0.3;
+  std::vector<std::complex<double>> symbol(kFftSize);
+  for (auto& s : symbol) {
+    s = std::polar(kAmplitude, 2.0 * M_PI * rand() / RAND_MAX);
+  }
+  // The symbol with its cyclic prefix, rotated by the offset
+  auto* short_buf = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      (kCpLen + kFftSize) * 2 * sizeof(short)));
+  for (size_t m = 0; m < kCpLen + kFftSize; m++) {
+    const std::complex<double> rx =
+        symbol.at((m + kFftSize - kCpLen) % kFftSize) *
+        std::polar(1.0, 2.0 * M_PI * kCfo * m / kFftSize);
+    short_buf[2 * m] = static_cast<int16_t>(std::lround(rx.real()));
+    short_buf[2 * m + 1] = static_cast<int16_t>(std::lround(rx.imag()));
+  }
+
+  const float cfo = CommsLib::EstimateCfoCp(short_buf, kCpLen, kFftSize);
+  ASSERT_NEAR(cfo * kFftSize / (2.0 * M_PI), kCfo, 1e-3);
+
+  auto* float_buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kFftSize * 2 * sizeof(float)));
+  // Derotated, the FFT window is the symbol times the phase at its start
+  const std::complex<double> start =
+      std::polar(1.0 / kShrtFltConvFactor, 2.0 * M_PI * kCfo * kCpLen /
+                                               kFftSize);
+  for (const bool fft_shift : {false, true}) {
+    SimdConvertShortToFloatRotate(&short_buf[2 * kCpLen], float_buf,
+                                  kFftSize * 2, -cfo, fft_shift);
+    for (size_t n = 0; n < kFftSize; n++) {
+      const double sign = (fft_shift && (n % 2 == 1)) ? -1.0 : 1.0;
+      const std::complex<double> expected = sign * start * symbol.at(n);
+      ASSERT_NEAR(float_buf[2 * n], expected.real(), 1e-3) << "at " << n;
+      ASSERT_NEAR(float_buf[2 * n + 1], expected.imag(), 1e-3) << "at " << n;
+    }
+  }
+  std::free(short_buf);
+  std::free(float_buf);
+}
+
+TEST(SIMD, float_to_int16_peak) {
+  // IFFT output of one symbol with a cyclic prefix, as in DoIFFT
+  static constexpr size_t kNumElems = 256;
+  static constexpr size_t kPrefix = 32;
+  static constexpr float kScaleDown = 64.0f;
+  auto* float_buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kNumElems * sizeof(float)));
+  auto* short_buf = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      (kNumElems + kPrefix) * sizeof(short)));
+  auto* check = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      (kNumElems + kPrefix) * sizeof(short)));
+  for (size_t j = 0; j < kNumElems; j++) {
+    float_buf[j] = kScaleDown * (static_cast<float>(rand()) / RAND_MAX - 0.5f);
+  }
+  // A negative peak, which sets max_abs but not max_val
+  float_buf[77] = -0.75f * kScaleDown;
+
+  float max_val;
+  float max_abs;
+  SimdConvertFloatToShortPeak(float_buf, short_buf, kNumElems, kPrefix,
+                              kScaleDown, max_val, max_abs);
+  SimdConvertFloatToShort(float_buf, check, kNumElems, kPrefix, kScaleDown);
+  for (size_t j = 0; j < kNumElems + kPrefix; j++) {
+    ASSERT_EQ(short_buf[j], check[j]) << "at " << j;
+  }
+  float expected_max = -FLT_MAX;
+  for (size_t j = 0; j < kNumElems; j++) {
+    expected_max = std::max(expected_max, float_buf[j] / kScaleDown);
+  }
+  ASSERT_FLOAT_EQ(max_val, expected_max);
+  ASSERT_FLOAT_EQ(max_abs, 0.75f);
+
+  // A sample at full scale is reported as clipping
+  float_buf[200] = kScaleDown;
+  SimdConvertFloatToShortPeak(float_buf, short_buf, kNumElems, kPrefix,
+                              kScaleDown, max_val, max_abs);
+  ASSERT_GE(max_val, 1.0f);
+  ASSERT_FLOAT_EQ(max_abs, 1.0f);
+  std::free(float_buf);
+  std::free(short_buf);
+  std::free(check);
+}
+
+TEST(SIMD, float_to_int16_peak_fft_shift) {
+  // IFFT output of one symbol with a cyclic prefix, as in DoIFFT
+  static constexpr size_t kNumElems = 256;
+  static constexpr size_t kPrefix = 32;
+  static constexpr float kScaleDown = 64.0f;
+  auto* float_buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kNumElems * sizeof(float)));
+  auto* negated = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kNumElems * sizeof(float)));
+  auto* short_buf = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      (kNumElems + kPrefix) * sizeof(short)));
+  auto* check = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      (kNumElems + kPrefix) * sizeof(short)));
+  for (size_t j = 0; j < kNumElems; j++) {
+    float_buf[j] = kScaleDown * (static_cast<float>(rand()) / RAND_MAX - 0.5f);
+  }
+  // A negative peak on an odd sample, which is a positive one once negated
+  float_buf[2 * 37] = -0.75f * kScaleDown;
+  for (size_t j = 0; j < kNumElems; j++) {
+    negated[j] = ((j / 2) % 2 == 0) ? float_buf[j] : -float_buf[j];
+  }
+
+  float max_val;
+  float max_abs;
+  SimdConvertFloatToShortPeak(float_buf, short_buf, kNumElems, kPrefix,
+                              kScaleDown, max_val, max_abs, true);
+  SimdConvertFloatToShort(negated, check, kNumElems, kPrefix, kScaleDown);
+  for (size_t j = 0; j < kNumElems + kPrefix; j++) {
+    ASSERT_EQ(short_buf[j], check[j]) << "at " << j;
+  }
+  ASSERT_FLOAT_EQ(max_val, 0.75f);
+  ASSERT_FLOAT_EQ(max_abs, 0.75f);
+  std::free(float_buf);
+  std::free(negated);
+  std::free(short_buf);
+  std::free(check);
+}
+
+TEST(SIMD, bfp_round_trip) {
+  // Not a multiple of the block size, so the last block is partial
+  static constexpr size_t kNumSamples = 12 * 20 + 5;
+  std::vector<short> samples(kNumSamples * 2);
+  for (size_t j = 0; j < samples.size(); j++) {
+    // Blocks of different magnitudes get different exponents
+    const size_t block = j / (2 * kBfpBlockSamples);
+    samples.at(j) = static_cast<short>(static_cast<int16_t>(rand()) >>
+                                       (block % 12));
+  }
+  samples.at(3) = -32768;
+  samples.at(30) = 32767;
+  // An all-zero block
+  std::fill(samples.begin() + 48, samples.begin() + 72, 0);
+
+  for (size_t bfp_bits : {8, 9, 12, 16}) {
+    std::vector<uint8_t> compressed(BfpBytes(kNumSamples, bfp_bits));
+    BfpCompress(samples.data(), compressed.data(), kNumSamples, bfp_bits);
+
+    // Full range, and a range that starts and ends inside blocks
+    for (size_t first_sample : {size_t{0}, size_t{7}}) {
+      const size_t num_samples = kNumSamples - first_sample - 3;
+      std::vector<float> decompressed(num_samples * 2);
+      BfpDecompressToFloat(compressed.data(), decompressed.data(),
+                           first_sample, num_samples, bfp_bits);
+      for (size_t j = 0; j < num_samples * 2; j++) {
+        const size_t idx = (first_sample * 2) + j;
+        const size_t block = idx / (2 * kBfpBlockSamples);
+        const uint8_t exponent = compressed.at(block * BfpBlockBytes(bfp_bits));
+        // Truncating the low exponent bits loses less than one step
+        const float step = std::ldexp(1.0f, exponent) / 32768.f;
+        const float expected = samples.at(idx) / 32768.f;
+        ASSERT_LE(decompressed.at(j), expected)
+            << bfp_bits << " bits at " << idx;
+        ASSERT_GT(decompressed.at(j), expected - step)
+            << bfp_bits << " bits at " << idx;
+      }
+    }
+  }
+}
+
+TEST(SIMD, iq_12bit_round_trip) {
+  // Not a multiple of the samples of a kernel step, to cover the tails
+  static constexpr size_t kNumSamples = 16 * 20 + 5;
+  std::vector<float> in_buf(kNumSamples * 2);
+  for (size_t j = 0; j < in_buf.size(); j++) {
+    // 12-bit IQ covers [-0.25, 0.25)
+    in_buf.at(j) = (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 0.5f;
+  }
+  in_buf.at(0) = 0.0f;
+  in_buf.at(1) = -0.25f;
+
+  std::vector<uint8_t> packed(kNumSamples * 3 + 1, 0x55);
+  ConvertFloatTo12bitIq(in_buf.data(), packed.data(), kNumSamples * 2);
+  // The kernels must not write past the packed samples
+  ASSERT_EQ(packed.at(kNumSamples * 3), 0x55);
+
+  auto* out_buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, kNumSamples * 2 * sizeof(float)));
+  SimdConvert12bitIqToFloat(packed.data(), out_buf, kNumSamples * 3);
+  for (size_t j = 0; j < kNumSamples * 2; j++) {
+    // The packed value and the unpacked float, as the scalar code does it
+    const auto value = static_cast<unsigned short>(in_buf.at(j) *
+                                                   kShrtFltConvFactor * 4);
+    const uint8_t* sample = &packed.at((j / 2) * 3);
+    const unsigned short unpacked =
+        (j % 2 == 0) ? ((sample[0] << 4) | ((sample[1] & 0xf) << 12))
+                     : ((sample[1] & 0xf0) | (sample[2] << 8));
+    ASSERT_EQ(unpacked, value & 0xfff0) << "value " << j;
+    ASSERT_EQ(out_buf[j], static_cast<int16_t>(value & 0xfff0) / 131072.f)
+        << "value " << j;
+    // Truncating the low 4 bits loses less than 16 steps
+    ASSERT_NEAR(out_buf[j], in_buf.at(j), 16.f / 131072.f) << "value " << j;
+  }
+  std::free(out_buf);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
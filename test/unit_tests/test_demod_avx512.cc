@@ -0,0 +1,229 @@
+/**
+ * @file test_demod_avx512.cc
+ * @brief Test the AVX-512 soft and hard demodulators against the AVX2 and
+ * scalar implementations, the runtime dispatch of Demodulate() and the
+ * vectorized TranslateToLLR kernels.
+ */
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "memory_manage.h"
+#include "modulation.h"
+
+// Multiple of 32 symbols so that the AVX2 kernels never fall back to their
+// truncating scalar tails
+static constexpr size_t kNumSymbols = 1024;
+// Not a multiple of 8, to cover the partial register of the AVX-512 kernels
+static constexpr size_t kNumTailSymbols = 1021;
+
+using SoftDemodFunc = void (*)(const float*, int8_t*, int);
+using HardDemodFunc = void (*)(const float*, uint8_t*, int);
+using Hard16DemodFunc = void (*)(const float*, uint16_t*, int);
+
+class TestDemodAvx512 : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    AllocBuffer1d(&symbols_, 2 * kNumSymbols,
+                  Agora_memory::Alignment_t::kAlign64, 1);
+    AllocBuffer1d(&out_, kMaxModType * kNumSymbols,
+                  Agora_memory::Alignment_t::kAlign64, 1);
+    AllocBuffer1d(&ref_, kMaxModType * kNumSymbols,
+                  Agora_memory::Alignment_t::kAlign64, 1);
+    // Mostly inside the constellation, with a few saturating values
+    std::default_random_engine generator(0);
+    std::normal_distribution<float> distribution(0.0, 0.6);
+    for (size_t i = 0; i < 2 * kNumSymbols; i++) {
+      symbols_[i] = distribution(generator);
+    }
+    symbols_[0] = 5.0f;
+    symbols_[1] = -5.0f;
+  }
+
+  void TearDown() override {
+    FreeBuffer1d(&symbols_);
+    FreeBuffer1d(&out_);
+    FreeBuffer1d(&ref_);
+  }
+
+  void CompareSoft(SoftDemodFunc func, SoftDemodFunc ref_func,
+                   size_t mod_order) {
+    std::memset(out_, 0, kMaxModType * kNumSymbols);
+    std::memset(ref_, 0, kMaxModType * kNumSymbols);
+    func(symbols_, out_, kNumSymbols);
+    ref_func(symbols_, ref_, kNumSymbols);
+    EXPECT_EQ(std::memcmp(out_, ref_, mod_order * kNumSymbols), 0);
+
+    // The tail must match the full-length result and leave the rest untouched
+    std::memset(out_, 0x55, kMaxModType * kNumSymbols);
+    func(symbols_, out_, kNumTailSymbols);
+    EXPECT_EQ(std::memcmp(out_, ref_, mod_order * kNumTailSymbols), 0);
+    EXPECT_EQ(out_[mod_order * kNumTailSymbols], 0x55);
+  }
+
+  void CompareHard(HardDemodFunc func, HardDemodFunc ref_func) {
+    std::memset(out_, 0x55, kMaxModType * kNumSymbols);
+    std::memset(ref_, 0x55, kMaxModType * kNumSymbols);
+    func(symbols_, reinterpret_cast<uint8_t*>(out_), kNumTailSymbols);
+    ref_func(symbols_, reinterpret_cast<uint8_t*>(ref_), kNumTailSymbols);
+    EXPECT_EQ(std::memcmp(out_, ref_, kNumSymbols), 0);
+  }
+
+  void CompareHard16(Hard16DemodFunc func, Hard16DemodFunc ref_func) {
+    std::memset(out_, 0x55, kMaxModType * kNumSymbols);
+    std::memset(ref_, 0x55, kMaxModType * kNumSymbols);
+    func(symbols_, reinterpret_cast<uint16_t*>(out_), kNumTailSymbols);
+    ref_func(symbols_, reinterpret_cast<uint16_t*>(ref_), kNumTailSymbols);
+    EXPECT_EQ(std::memcmp(out_, ref_, 2 * kNumSymbols), 0);
+  }
+
+  float* symbols_;
+  int8_t* out_;
+  int8_t* ref_;
+};
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+TEST_F(TestDemodAvx512, SoftQpsk) {
+  CompareSoft(
+      DemodQpskSoftAvx512,
+      [](const float* in, int8_t* llr, int num) {
+        DemodQpskSoftSse(const_cast<float*>(in), llr, 2 * num);
+      },
+      2);
+}
+
+TEST_F(TestDemodAvx512, Soft16qam) {
+  CompareSoft(
+      Demod16qamSoftAvx512,
+      [](const float* in, int8_t* llr, int num) {
+        Demod16qamSoftAvx2(const_cast<float*>(in), llr, num);
+      },
+      4);
+}
+
+TEST_F(TestDemodAvx512, Soft64qam) {
+  CompareSoft(
+      Demod64qamSoftAvx512,
+      [](const float* in, int8_t* llr, int num) {
+        Demod64qamSoftAvx2(const_cast<float*>(in), llr, num);
+      },
+      6);
+}
+
+TEST_F(TestDemodAvx512, Soft1024qam) {
+  CompareSoft(Demod1024qamSoftAvx512, Demod1024qamSoftLoop, 10);
+}
+#endif
+
+#ifdef __AVX512F__
+TEST_F(TestDemodAvx512, HardQpsk) {
+  CompareHard(DemodQpskHardAvx512, DemodQpskHardLoop);
+}
+
+TEST_F(TestDemodAvx512, Hard16qam) {
+  CompareHard(Demod16qamHardAvx512, Demod16qamHardLoop);
+}
+
+TEST_F(TestDemodAvx512, Hard64qam) {
+  CompareHard(Demod64qamHardAvx512, Demod64qamHardLoop);
+}
+
+TEST_F(TestDemodAvx512, Hard1024qam) {
+  CompareHard16(Demod1024qamHardAvx512, Demod1024qamHardLoop);
+}
+#endif
+
+TEST_F(TestDemodAvx512, Dispatch) {
+  // Every kernel choice must produce the AVX2 LLRs, for all orders
+  Demodulate(symbols_, out_, kNumSymbols, 2, false);
+  DemodQpskSoftSse(symbols_, ref_, 2 * kNumSymbols);
+  EXPECT_EQ(std::memcmp(out_, ref_, 2 * kNumSymbols), 0);
+
+  Demodulate(symbols_, out_, kNumSymbols, 4, false);
+  Demod16qamSoftAvx2(symbols_, ref_, kNumSymbols);
+  EXPECT_EQ(std::memcmp(out_, ref_, 4 * kNumSymbols), 0);
+
+  Demodulate(symbols_, out_, kNumSymbols, 6, false);
+  Demod64qamSoftAvx2(symbols_, ref_, kNumSymbols);
+  EXPECT_EQ(std::memcmp(out_, ref_, 6 * kNumSymbols), 0);
+
+  Demodulate(symbols_, out_, kNumSymbols, 8, false);
+  Demod256qamSoftAvx2(symbols_, ref_, kNumSymbols);
+  EXPECT_EQ(std::memcmp(out_, ref_, 8 * kNumSymbols), 0);
+
+  Demodulate(symbols_, out_, kNumSymbols, 10, false);
+  Demod1024qamSoftLoop(symbols_, ref_, kNumSymbols);
+  EXPECT_EQ(std::memcmp(out_, ref_, 10 * kNumSymbols), 0);
+
+  Demodulate(symbols_, out_, kNumSymbols, 10, true);
+  Demod1024qamHardLoop(symbols_, reinterpret_cast<uint16_t*>(ref_),
+                       kNumSymbols);
+  EXPECT_EQ(std::memcmp(out_, ref_, 2 * kNumSymbols), 0);
+}
+
+TEST(TestQam1024, TableRoundTrip) {
+  // Every point of the table demodulates to its own bits, and the sign of
+  // each LLR is its bit, positive for 1 as with the other orders
+  Table<complex_float> mod_table;
+  InitModulationTable(mod_table, 10);
+  std::vector<uint16_t> hard(1024);
+  std::vector<int8_t> llr(10 * 1024);
+  Demod1024qamHardLoop(reinterpret_cast<const float*>(mod_table[0]),
+                       hard.data(), 1024);
+  Demod1024qamSoftLoop(reinterpret_cast<const float*>(mod_table[0]),
+                       llr.data(), 1024);
+  float power = 0;
+  for (size_t i = 0; i < 1024; i++) {
+    EXPECT_EQ(hard.at(i), i);
+    power += mod_table[0][i].re * mod_table[0][i].re +
+             mod_table[0][i].im * mod_table[0][i].im;
+    for (size_t b = 0; b < 10; b++) {
+      const bool bit = ((i >> (9 - b)) & 0x1) != 0;
+      EXPECT_EQ(llr.at(10 * i + b) > 0, bit) << "point " << i << " bit " << b;
+    }
+  }
+  EXPECT_NEAR(power / 1024, 1.0f, 1e-4);
+  mod_table.Free();
+}
+
+using TranslateFunc = void (*)(const uint8_t*, int8_t*, size_t, int8_t);
+
+static void CompareTranslate(TranslateFunc func) {
+  static constexpr size_t kNumBytes = 300;
+  std::vector<uint8_t> bits(kNumBytes);
+  std::default_random_engine generator(1);
+  for (auto& byte : bits) {
+    byte = static_cast<uint8_t>(generator());
+  }
+  std::vector<int8_t> llr(8 * kNumBytes + 64);
+  std::vector<int8_t> ref(8 * kNumBytes + 64);
+  // Full registers, partial registers and partial bytes, in the default
+  // format and in the saturated one of an accelerator
+  for (int8_t magnitude : {kHardLlrMagnitude, int8_t{31}}) {
+    for (size_t bit_len : {1ul, 7ul, 8ul, 31ul, 32ul, 63ul, 64ul, 65ul, 100ul,
+                           8 * kNumBytes}) {
+      std::fill(llr.begin(), llr.end(), 0x55);
+      std::fill(ref.begin(), ref.end(), 0x55);
+      func(bits.data(), llr.data(), bit_len, magnitude);
+      TranslateToLLRLoop(bits.data(), ref.data(), bit_len, magnitude);
+      EXPECT_EQ(llr, ref) << "bit_len " << bit_len;
+    }
+  }
+}
+
+#ifdef __AVX2__
+TEST(TestTranslateToLLR, Avx2) { CompareTranslate(TranslateToLLRAvx2); }
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+TEST(TestTranslateToLLR, Avx512) { CompareTranslate(TranslateToLLRAvx512); }
+#endif
+
+TEST(TestTranslateToLLR, Dispatch) { CompareTranslate(TranslateToLLR); }
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,66 @@
+/**
+ * @file test_demul_status.cc
+ * @brief Test the release of the uplink code blocks as the demul blocks of
+ * their LLRs complete.
+ */
+#include <gtest/gtest.h>
+
+#include "demul_status.h"
+
+static constexpr size_t kFrameWindow = 2;
+static constexpr size_t kNumUlSyms = 2;
+// Code block k takes subcarriers [5k, 5k + 4], the demul blocks are 4
+// subcarriers wide: block 0 feeds code block 0, block 1 code blocks 0 and 1,
+// block 2 code blocks 1 and 2 and block 3 code block 2.
+static constexpr size_t kLlrsPerCb = 10;
+static constexpr size_t kModOrderBits = 2;
+static constexpr size_t kDemulBlockSize = 4;
+static constexpr size_t kNumDemulBlocks = 4;
+
+TEST(TestDemulStatus, ReleaseOutOfOrder) {
+  DemulStatus status(kFrameWindow, kNumUlSyms, 3, kLlrsPerCb, kModOrderBits,
+                     kDemulBlockSize, kNumDemulBlocks);
+  size_t first_cb;
+  EXPECT_EQ(status.CompleteBlock(0, 1, 1 * kDemulBlockSize, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 1, 0 * kDemulBlockSize, first_cb), 1u);
+  EXPECT_EQ(first_cb, 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 1, 3 * kDemulBlockSize, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 1, 2 * kDemulBlockSize, first_cb), 2u);
+  EXPECT_EQ(first_cb, 1u);
+
+  // The last block of the symbol reset it for the next frame of the slot
+  EXPECT_EQ(status.CompleteBlock(kFrameWindow, 1, 0, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(kFrameWindow, 1, kDemulBlockSize, first_cb),
+            1u);
+  EXPECT_EQ(first_cb, 0u);
+}
+
+TEST(TestDemulStatus, SymbolsAreIndependent) {
+  DemulStatus status(kFrameWindow, kNumUlSyms, 3, kLlrsPerCb, kModOrderBits,
+                     kDemulBlockSize, kNumDemulBlocks);
+  size_t first_cb;
+  EXPECT_EQ(status.CompleteBlock(1, 0, 0, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 0, kDemulBlockSize, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(1, 1, kDemulBlockSize, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(1, 0, kDemulBlockSize, first_cb), 1u);
+  EXPECT_EQ(first_cb, 0u);
+}
+
+TEST(TestDemulStatus, BlocksWithoutCodeBlocks) {
+  // One code block in blocks 0 and 1, the subcarriers of blocks 2 and 3 are
+  // padding
+  DemulStatus status(kFrameWindow, kNumUlSyms, 1, kLlrsPerCb, kModOrderBits,
+                     kDemulBlockSize, kNumDemulBlocks);
+  size_t first_cb;
+  EXPECT_EQ(status.CompleteBlock(0, 0, 3 * kDemulBlockSize, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 0, 2 * kDemulBlockSize, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 0, 0, first_cb), 0u);
+  EXPECT_EQ(status.CompleteBlock(0, 0, kDemulBlockSize, first_cb), 1u);
+  EXPECT_EQ(first_cb, 0u);
+  EXPECT_EQ(status.NumCbs(), 1u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,68 @@
+/**
+ * @file test_event_tracer.cc
+ * @brief Test the trace rings and their Chrome trace output.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "event_tracer.h"
+
+static constexpr char kTraceFile[] = "/tmp/test_event_tracer.json";
+
+TEST(TestEventTracer, RingOverwrite) {
+  TraceRing ring("worker 0", 4);
+  for (size_t frame = 0; frame < 6; frame++) {
+    const EventData event(EventType::kDecode,
+                          gen_tag_t::FrmSymCb(frame, 2, 0).tag_);
+    ring.Record(event, 100 * frame, (100 * frame) + 10);
+  }
+  EXPECT_EQ(ring.NumRecorded(), 6u);
+
+  // Only the last records are kept, oldest first
+  const std::vector<TraceRecord> records = ring.Records();
+  ASSERT_EQ(records.size(), 4u);
+  for (size_t i = 0; i < records.size(); i++) {
+    EXPECT_EQ(records.at(i).frame_id_, i + 2);
+    EXPECT_EQ(records.at(i).symbol_id_, 2u);
+    EXPECT_EQ(records.at(i).start_tsc_, 100 * (i + 2));
+    EXPECT_EQ(records.at(i).num_tags_, 1u);
+  }
+}
+
+TEST(TestEventTracer, ChromeTraceJson) {
+  EventTracer tracer(16, 1.0, 1, 2);
+  tracer.MasterRing()->Record(
+      EventData(EventType::kFFT, gen_tag_t::FrmSymAnt(7, 1, 0).tag_), 1000,
+      2000);
+  tracer.TxRxRing(0)->Record(
+      EventData(EventType::kPacketTX, gen_tag_t::FrmSymAnt(7, 3, 0).tag_),
+      1500, 1500);
+  tracer.WorkerRing(1)->Record(
+      EventData(EventType::kDemul, gen_tag_t::FrmSymSc(7, 4, 0).tag_), 3000,
+      5000);
+  tracer.WriteJson(kTraceFile);
+
+  std::ifstream file(kTraceFile);
+  std::stringstream json;
+  json << file.rdbuf();
+  const std::string trace = json.str();
+
+  EXPECT_NE(trace.find("\"args\": {\"name\": \"worker 1\"}"),
+            std::string::npos);
+  // At 1 GHz, one cycle is 1 ns, and the times are from the first record
+  EXPECT_NE(trace.find("{\"name\": \"fft\", \"pid\": 0, \"tid\": 0, "
+                       "\"ph\": \"X\", \"ts\": 0.000, \"dur\": 1.000, "
+                       "\"args\": {\"tags\": 1, \"frame\": 7, \"symbol\": 1}}"),
+            std::string::npos);
+  EXPECT_NE(trace.find("{\"name\": \"packet_tx\", \"pid\": 0, \"tid\": 1, "
+                       "\"ph\": \"i\", \"s\": \"t\", \"ts\": 0.500, "),
+            std::string::npos);
+  EXPECT_NE(trace.find("{\"name\": \"demul\", \"pid\": 0, \"tid\": 3, "
+                       "\"ph\": \"X\", \"ts\": 2.000, \"dur\": 2.000, "),
+            std::string::npos);
+  EXPECT_EQ(trace.rfind("\n]}\n"), trace.size() - 4);
+}
@@ -0,0 +1,277 @@
+/**
+ * @file test_fast_math.cc
+ * @brief Accuracy suite of the fast-math tiers: the relative error of the
+ * reciprocal estimates, and the EVM and BER of zero-forcing equalization of
+ * QAM symbols with the small-MIMO beamweights of each tier against the exact
+ * ones. The deltas are printed, so that the ULPs traded for cycles are seen.
+ */
+
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "comms-lib.h"
+#include "fast_math.h"
+#include "small_mimo_kernels.h"
+#include "tile_layout.h"
+
+using CxFloat = std::complex<float>;
+
+static constexpr size_t kNumScs = 1024;
+// Symbols per subcarrier and stream of the EVM and BER runs
+static constexpr size_t kNumSymbols = 16;
+static constexpr float kSnrDb = 25.0f;
+
+static constexpr std::array<FastMath::Precision, FastMath::kNumPrecisions>
+    kPrecisions = {FastMath::Precision::kExact, FastMath::Precision::kRefined,
+                   FastMath::Precision::kApprox};
+
+static std::mt19937 rng(11);
+
+static std::vector<complex_float> RandomVector(size_t size, float stddev) {
+  std::normal_distribution<float> dist(0.0f, stddev);
+  std::vector<complex_float> v(size);
+  for (auto& x : v) {
+    x = {dist(rng), dist(rng)};
+  }
+  return v;
+}
+
+static CxFloat Cx(const complex_float& v) { return {v.re, v.im}; }
+
+/// Largest relative error of rcp(x) against 1 / x over x
+template <class F>
+static double MaxRelError(const std::vector<float>& x, F rcp,
+                          double (*exact)(double)) {
+  double max_error = 0;
+  for (float v : x) {
+    const double expected = exact(v);
+    max_error =
+        std::max(max_error, std::fabs((rcp(v) - expected) / expected));
+  }
+  return max_error;
+}
+
+static std::vector<float> PositiveFloats() {
+  std::uniform_real_distribution<float> exponent(-20.0f, 20.0f);
+  std::vector<float> x(4096);
+  for (float& v : x) {
+    v = std::exp2(exponent(rng));
+  }
+  return x;
+}
+
+#ifdef __AVX512F__
+template <FastMath::Precision kPrecision>
+static float Rcp512(float x) {
+  return _mm512_cvtss_f32(FastMath::Rcp<kPrecision>(_mm512_set1_ps(x)));
+}
+template <FastMath::Precision kPrecision>
+static float Rsqrt512(float x) {
+  return _mm512_cvtss_f32(FastMath::Rsqrt<kPrecision>(_mm512_set1_ps(x)));
+}
+
+TEST(TestFastMath, Avx512Estimates) {
+  const std::vector<float> x = PositiveFloats();
+  auto rcp = [](double v) { return 1.0 / v; };
+  auto rsqrt = [](double v) { return 1.0 / std::sqrt(v); };
+  const double rcp_exact =
+      MaxRelError(x, Rcp512<FastMath::Precision::kExact>, rcp);
+  const double rcp_refined =
+      MaxRelError(x, Rcp512<FastMath::Precision::kRefined>, rcp);
+  const double rcp_approx =
+      MaxRelError(x, Rcp512<FastMath::Precision::kApprox>, rcp);
+  const double rsqrt_refined =
+      MaxRelError(x, Rsqrt512<FastMath::Precision::kRefined>, rsqrt);
+  const double rsqrt_approx =
+      MaxRelError(x, Rsqrt512<FastMath::Precision::kApprox>, rsqrt);
+  std::printf(
+      "AVX-512 relative error: rcp exact %.2e refined %.2e approx %.2e, "
+      "rsqrt refined %.2e approx %.2e\n",
+      rcp_exact, rcp_refined, rcp_approx, rsqrt_refined, rsqrt_approx);
+  EXPECT_LE(rcp_exact, std::ldexp(1.0, -24));
+  EXPECT_LE(rcp_refined, std::ldexp(1.0, -22));
+  EXPECT_LE(rcp_approx, std::ldexp(1.0, -14));
+  EXPECT_LE(rsqrt_refined, std::ldexp(1.0, -21));
+  EXPECT_LE(rsqrt_approx, std::ldexp(1.0, -14));
+}
+
+/// The tiers of CommsLib on the random vectors of test_avx512_complex_mul
+TEST(TestFastMath, CommsLibTiers) {
+  float values[16] __attribute((aligned(64)));
+  for (float& value : values) {
+    value = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+  }
+  const __m512 data = _mm512_load_ps(values);
+  float exact_recip[16] __attribute((aligned(64)));
+  float exact_sign[16] __attribute((aligned(64)));
+  _mm512_store_ps(exact_recip, CommsLib::M512ComplexCf32Reciprocal(data));
+  _mm512_store_ps(exact_sign, CommsLib::M512ComplexCf32Sign(data));
+  for (const auto precision :
+       {FastMath::Precision::kRefined, FastMath::Precision::kApprox}) {
+    float recip[16] __attribute((aligned(64)));
+    float sign[16] __attribute((aligned(64)));
+    _mm512_store_ps(recip,
+                    CommsLib::M512ComplexCf32Reciprocal(data, precision));
+    _mm512_store_ps(sign, CommsLib::M512ComplexCf32Sign(data, precision));
+    const double tolerance = (precision == FastMath::Precision::kApprox)
+                                 ? std::ldexp(1.0, -13)
+                                 : std::ldexp(1.0, -21);
+    for (size_t i = 0; i < 16; i += 2) {
+      const CxFloat r(recip[i], recip[i + 1]);
+      const CxFloat r_exact(exact_recip[i], exact_recip[i + 1]);
+      EXPECT_LE(std::abs(r - r_exact) / std::abs(r_exact), tolerance)
+          << FastMath::PrecisionName(precision);
+      const CxFloat s(sign[i], sign[i + 1]);
+      const CxFloat s_exact(exact_sign[i], exact_sign[i + 1]);
+      EXPECT_LE(std::abs(s - s_exact), tolerance)
+          << FastMath::PrecisionName(precision);
+    }
+
+    std::vector<complex_float> y = RandomVector(kNumScs, 1.0f);
+    std::vector<complex_float> h = RandomVector(kNumScs, 1.0f);
+    std::vector<complex_float> out_exact(kNumScs);
+    std::vector<complex_float> out(kNumScs);
+    CommsLib::EqualizeSisoCf32(y.data(), h.data(), {0.6f, 0.8f},
+                               out_exact.data(), kNumScs);
+    CommsLib::EqualizeSisoCf32(y.data(), h.data(), {0.6f, 0.8f}, out.data(),
+                               kNumScs, precision);
+    for (size_t sc = 0; sc < kNumScs; sc++) {
+      EXPECT_LE(std::abs(Cx(out.at(sc)) - Cx(out_exact.at(sc))) /
+                    std::abs(Cx(out_exact.at(sc))),
+                tolerance)
+          << FastMath::PrecisionName(precision) << " subcarrier " << sc;
+    }
+  }
+}
+#endif
+
+/// Gray-coded PAM level of a QAM axis, and the bits of the level
+struct Pam {
+  size_t levels_;
+  float scale_;
+  float Level(size_t index) const {
+    return scale_ * (2.0f * index - (levels_ - 1.0f));
+  }
+  size_t Index(float amplitude) const {
+    const float index = std::round((amplitude / scale_ + levels_ - 1) / 2);
+    return static_cast<size_t>(
+        std::clamp(index, 0.0f, static_cast<float>(levels_ - 1)));
+  }
+  static size_t BitErrors(size_t a, size_t b) {
+    return __builtin_popcountll((a ^ (a >> 1)) ^ (b ^ (b >> 1)));
+  }
+};
+
+struct LinkResult {
+  double evm_;
+  double ber_;
+};
+
+/// ZF-equalize QAM of mod_bits through dim x dim Rayleigh channels with the
+/// beamweights of kernels, and measure the EVM and BER
+static LinkResult RunLink(const SmallMimo::Kernels& kernels, size_t dim,
+                          size_t mod_bits, uint32_t seed) {
+  std::mt19937 link_rng(seed);
+  std::normal_distribution<float> gauss(0.0f, std::sqrt(0.5f));
+  const size_t levels = size_t{1} << (mod_bits / 2);
+  // Unit average symbol energy
+  const Pam pam = {levels, std::sqrt(1.5f / ((levels * levels) - 1))};
+  const float noise_std = std::pow(10.0f, -kSnrDb / 20.0f);
+
+  // csi[ue] holds H(ant, ue) of every subcarrier, in the tile layout
+  std::vector<std::vector<complex_float>> csi(
+      dim, std::vector<complex_float>(dim * kNumScs));
+  std::vector<const complex_float*> csi_ptrs(dim);
+  for (size_t ue = 0; ue < dim; ue++) {
+    for (auto& h : csi.at(ue)) {
+      h = {gauss(link_rng), gauss(link_rng)};
+    }
+    csi_ptrs.at(ue) = csi.at(ue).data();
+  }
+  std::vector<complex_float> beam(dim * dim * kNumScs);
+  kernels.invert_[SmallMimo::DimIndex(dim)](csi_ptrs.data(),
+                                            SmallMimo::TileChunks(dim, kNumScs),
+                                            beam.data(), kNumScs);
+
+  std::uniform_int_distribution<size_t> symbol(0, levels - 1);
+  double error_energy = 0;
+  size_t bit_errors = 0;
+  for (size_t s = 0; s < kNumSymbols; s++) {
+    for (size_t sc = 0; sc < kNumScs; sc++) {
+      std::vector<size_t> tx_i(dim);
+      std::vector<size_t> tx_q(dim);
+      std::vector<CxFloat> x(dim);
+      for (size_t ue = 0; ue < dim; ue++) {
+        tx_i.at(ue) = symbol(link_rng);
+        tx_q.at(ue) = symbol(link_rng);
+        x.at(ue) = {pam.Level(tx_i.at(ue)), pam.Level(tx_q.at(ue))};
+      }
+      std::vector<CxFloat> y(dim);
+      for (size_t ant = 0; ant < dim; ant++) {
+        y.at(ant) = CxFloat(gauss(link_rng), gauss(link_rng)) * noise_std;
+        for (size_t ue = 0; ue < dim; ue++) {
+          y.at(ant) += Cx(csi.at(ue).at(TileLayout::Index(sc, ant, dim,
+                                                          kNumScs))) *
+                       x.at(ue);
+        }
+      }
+      for (size_t ue = 0; ue < dim; ue++) {
+        CxFloat equal = 0;
+        for (size_t ant = 0; ant < dim; ant++) {
+          equal += Cx(beam.at((ue * dim + ant) * kNumScs + sc)) * y.at(ant);
+        }
+        error_energy += std::norm(equal - x.at(ue));
+        bit_errors += Pam::BitErrors(tx_i.at(ue), pam.Index(equal.real())) +
+                      Pam::BitErrors(tx_q.at(ue), pam.Index(equal.imag()));
+      }
+    }
+  }
+  const double num_symbols = static_cast<double>(kNumSymbols * kNumScs * dim);
+  return {std::sqrt(error_energy / num_symbols),
+          bit_errors / (num_symbols * mod_bits)};
+}
+
+TEST(TestFastMath, SmallMimoEvmBer) {
+  for (SmallMimo::Isa isa :
+       {SmallMimo::Isa::kScalar, SmallMimo::Isa::kPortable,
+        SmallMimo::Isa::kAvx2, SmallMimo::Isa::kAvx512}) {
+    if (SmallMimo::ForIsa(isa) == nullptr) {
+      continue;
+    }
+    for (size_t dim : {1, 2, 4}) {
+      for (size_t mod_bits : {4, 6}) {
+        const uint32_t seed = static_cast<uint32_t>(dim * 16 + mod_bits);
+        const LinkResult exact =
+            RunLink(*SmallMimo::ForIsa(isa), dim, mod_bits, seed);
+        for (const auto precision : kPrecisions) {
+          const SmallMimo::Kernels& kernels =
+              *SmallMimo::ForIsa(isa, precision);
+          EXPECT_EQ(kernels.precision_, precision);
+          const LinkResult result = RunLink(kernels, dim, mod_bits, seed);
+          std::printf(
+              "%-8s %zux%zu %2zu-QAM %-7s EVM %6.3f%% (%+.2e) BER %.2e "
+              "(%+.2e)\n",
+              SmallMimo::IsaName(isa), dim, dim, size_t{1} << mod_bits,
+              FastMath::PrecisionName(precision).c_str(), result.evm_ * 100,
+              (result.evm_ - exact.evm_) * 100, result.ber_,
+              result.ber_ - exact.ber_);
+          // Noise, not the reciprocal, dominates the EVM at this SNR
+          EXPECT_LE(std::fabs(result.evm_ - exact.evm_), 1e-3 * exact.evm_);
+          EXPECT_LE(std::fabs(result.ber_ - exact.ber_), 1e-4);
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
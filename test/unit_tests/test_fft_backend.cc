@@ -0,0 +1,100 @@
+/**
+ * @file test_fft_backend.cc
+ * @brief Test the plans of every built-in FFT backend against a direct DFT,
+ * batched and out of place included.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "fft_backend.h"
+#include "memory_manage.h"
+
+static constexpr float kTolerance = 1e-2;
+
+// The unscaled DFT of in, sign -1 forward and +1 backward
+static std::vector<std::complex<float>> Dft(const complex_float* in,
+                                            size_t fft_size, int sign) {
+  std::vector<std::complex<float>> out(fft_size);
+  for (size_t k = 0; k < fft_size; k++) {
+    std::complex<double> sum = 0;
+    for (size_t n = 0; n < fft_size; n++) {
+      const double phase = sign * 2 * M_PI * static_cast<double>(k * n) /
+                           static_cast<double>(fft_size);
+      sum += std::complex<double>(in[n].re, in[n].im) *
+             std::complex<double>(std::cos(phase), std::sin(phase));
+    }
+    out[k] = std::complex<float>(sum);
+  }
+  return out;
+}
+
+static complex_float* Alloc(size_t num) {
+  return static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, num * sizeof(complex_float)));
+}
+
+static void Fill(complex_float* data, size_t num) {
+  for (size_t i = 0; i < num; i++) {
+    data[i] = {static_cast<float>((i * 7) % 11) / 11.0f - 0.5f,
+               static_cast<float>((i * 3) % 13) / 13.0f - 0.5f};
+  }
+}
+
+static void ExpectNear(const complex_float* data,
+                       const std::vector<std::complex<float>>& ref) {
+  for (size_t i = 0; i < ref.size(); i++) {
+    ASSERT_NEAR(data[i].re, ref[i].real(), kTolerance) << "at " << i;
+    ASSERT_NEAR(data[i].im, ref[i].imag(), kTolerance) << "at " << i;
+  }
+}
+
+TEST(TestFftBackend, MatchesDft) {
+  const size_t fft_size = 256;
+  const size_t num_transforms = 3;
+  const size_t num = fft_size * num_transforms;
+  for (const char* backend :
+       {FftBackend::kMkl, FftBackend::kFftw, FftBackend::kMufft}) {
+    if (FftBackend::Available(backend) == false) {
+      continue;
+    }
+    SCOPED_TRACE(backend);
+    auto plan =
+        FftBackend::CreatePlan(backend, fft_size, num_transforms, true);
+    complex_float* input = Alloc(num);
+    complex_float* data = Alloc(num);
+    complex_float* out = Alloc(num);
+    Fill(input, num);
+
+    std::memcpy(data, input, num * sizeof(complex_float));
+    plan->Forward(data);
+    for (size_t i = 0; i < num_transforms; i++) {
+      ExpectNear(&data[i * fft_size], Dft(&input[i * fft_size], fft_size, -1));
+    }
+
+    std::memcpy(data, input, num * sizeof(complex_float));
+    plan->Backward(data);
+    for (size_t i = 0; i < num_transforms; i++) {
+      ExpectNear(&data[i * fft_size], Dft(&input[i * fft_size], fft_size, 1));
+    }
+
+    plan->Backward(input, out);
+    ExpectNear(out, Dft(input, fft_size, 1));
+    Agora_memory::PaddedAlignedFree(input);
+    Agora_memory::PaddedAlignedFree(data);
+    Agora_memory::PaddedAlignedFree(out);
+  }
+}
+
+TEST(TestFftBackend, UnknownBackendThrows) {
+  EXPECT_THROW(FftBackend::CreatePlan("nope", 64), std::runtime_error);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,55 @@
+/**
+ * @file test_fixed_equalizer.cc
+ * @brief Test the compile-time specialized equalizer against a complex
+ * matrix-vector product.
+ */
+#include <gtest/gtest.h>
+
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "fixed_equalizer.h"
+
+using Cx = std::complex<float>;
+
+template <size_t kStreams, size_t kAnts>
+static void CheckEqualize() {
+  std::mt19937 gen(kStreams * 100 + kAnts);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  // Column-major kStreams x kAnts
+  std::vector<Cx> beam(kStreams * kAnts);
+  for (auto& w : beam) {
+    w = Cx(dist(gen), dist(gen));
+  }
+  std::vector<Cx> data(kAnts);
+  for (auto& d : data) {
+    d = Cx(dist(gen), dist(gen));
+  }
+  std::vector<Cx> equal(kStreams);
+  FixedEqualizer::Equalize<kStreams, kAnts>(
+      reinterpret_cast<const float*>(beam.data()),
+      reinterpret_cast<const float*>(data.data()),
+      reinterpret_cast<float*>(equal.data()));
+
+  for (size_t ss = 0; ss < kStreams; ss++) {
+    Cx expected = 0;
+    for (size_t ant = 0; ant < kAnts; ant++) {
+      expected += beam.at(ant * kStreams + ss) * data.at(ant);
+    }
+    EXPECT_NEAR(equal.at(ss).real(), expected.real(), 1e-4f);
+    EXPECT_NEAR(equal.at(ss).imag(), expected.imag(), 1e-4f);
+  }
+}
+
+TEST(TestFixedEqualizer, MatchesComplexProduct) {
+  CheckEqualize<1, 1>();
+  CheckEqualize<2, 8>();
+  CheckEqualize<4, 64>();
+  CheckEqualize<16, 16>();
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
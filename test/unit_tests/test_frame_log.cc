@@ -0,0 +1,122 @@
+/**
+ * @file test_frame_log.cc
+ * @brief Test the columnar binary frame log and its file format.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "frame_log.h"
+
+static constexpr char kLogFile[] = "/tmp/test_frame_log.bin";
+
+// The columns of a file, read back as in tools/python/frame_log.py
+struct ParsedLog {
+  std::vector<std::string> names_;
+  std::vector<uint32_t> types_;
+  std::vector<std::vector<uint64_t>> u64_;
+  std::vector<std::vector<float>> f32_;
+};
+
+template <typename T>
+static T ReadAt(const std::vector<char>& data, size_t& pos) {
+  T value;
+  std::memcpy(&value, &data.at(pos), sizeof(T));
+  pos += sizeof(T);
+  return value;
+}
+
+static ParsedLog ParseLog(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  const std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+  ParsedLog log;
+  EXPECT_EQ(std::string(data.data(), 8), "AGFRLOG1");
+  size_t pos = 8;
+  const auto num_columns = ReadAt<uint32_t>(data, pos);
+  EXPECT_EQ(ReadAt<uint32_t>(data, pos), FrameLog::kBlockRows);
+  for (size_t i = 0; i < num_columns; i++) {
+    log.names_.emplace_back(&data.at(pos));
+    pos += FrameLog::kNameBytes;
+    log.types_.push_back(ReadAt<uint32_t>(data, pos));
+    pos += sizeof(uint32_t);
+  }
+  log.u64_.resize(num_columns);
+  log.f32_.resize(num_columns);
+  while (pos < data.size()) {
+    EXPECT_EQ(std::string(&data.at(pos), 4), "BLCK");
+    pos += 4;
+    const auto num_rows = ReadAt<uint32_t>(data, pos);
+    for (size_t i = 0; i < num_columns; i++) {
+      for (size_t row = 0; row < num_rows; row++) {
+        if (log.types_.at(i) == 0) {
+          log.u64_.at(i).push_back(ReadAt<uint64_t>(data, pos));
+        } else {
+          log.f32_.at(i).push_back(ReadAt<float>(data, pos));
+        }
+      }
+      pos = (pos + 7) / 8 * 8;
+    }
+  }
+  return log;
+}
+
+TEST(TestFrameLog, RowsInColumns) {
+  // More rows than a block, and a partial block at the end
+  const size_t num_rows = FrameLog::kBlockRows + 3;
+  {
+    FrameLog log(kLogFile, {{"frame_id", FrameLog::ColumnType::kU64},
+                            {"beam_done_us", FrameLog::ColumnType::kF32},
+                            {"ue0_snr_db", FrameLog::ColumnType::kF32}});
+    for (size_t frame = 0; frame < num_rows;) {
+      FrameLog::Value* row = log.BeginRow();
+      if (row == nullptr) {
+        continue;
+      }
+      row[0].u_ = frame;
+      row[1].f_ = 0.5 * frame;
+      row[2].f_ = 20.0;
+      log.CommitRow();
+      frame++;
+    }
+  }
+
+  const ParsedLog parsed = ParseLog(kLogFile);
+  ASSERT_EQ(parsed.names_.size(), 3u);
+  EXPECT_EQ(parsed.names_.at(1), "beam_done_us");
+  EXPECT_EQ(parsed.types_.at(0), 0u);
+  EXPECT_EQ(parsed.types_.at(2), 1u);
+  ASSERT_EQ(parsed.u64_.at(0).size(), num_rows);
+  ASSERT_EQ(parsed.f32_.at(1).size(), num_rows);
+  for (size_t frame = 0; frame < num_rows; frame++) {
+    EXPECT_EQ(parsed.u64_.at(0).at(frame), frame);
+    EXPECT_FLOAT_EQ(parsed.f32_.at(1).at(frame), 0.5f * frame);
+    EXPECT_FLOAT_EQ(parsed.f32_.at(2).at(frame), 20.0f);
+  }
+}
+
+TEST(TestFrameLog, FullRingDropsRows) {
+  FrameLog log(kLogFile, {{"frame_id", FrameLog::ColumnType::kU64}}, 4);
+  size_t dropped = 0;
+  // The writer may or may not catch up, but never blocks the producer
+  for (size_t frame = 0; frame < 100000; frame++) {
+    FrameLog::Value* row = log.BeginRow();
+    if (row == nullptr) {
+      dropped++;
+      continue;
+    }
+    row[0].u_ = frame;
+    log.CommitRow();
+  }
+  EXPECT_EQ(log.DroppedRows(), dropped);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
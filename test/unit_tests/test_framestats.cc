@@ -0,0 +1,43 @@
+/**
+ * @file test_framestats.cc
+ * @brief Test the per-type symbol index lookups of the frame schedule.
+ */
+#include <gtest/gtest.h>
+
+#include "framestats.h"
+
+TEST(TestFrameStats, SymbolIndices) {
+  const FrameStats frame("BSPPGUUDDCL");
+  EXPECT_EQ(frame.GetBeaconSymbolIdx(0), 0u);
+  EXPECT_EQ(frame.GetDLControlSymbolIdx(1), 0u);
+  EXPECT_EQ(frame.GetPilotSymbolIdx(2), 0u);
+  EXPECT_EQ(frame.GetPilotSymbolIdx(3), 1u);
+  EXPECT_EQ(frame.GetULSymbolIdx(5), 0u);
+  EXPECT_EQ(frame.GetULSymbolIdx(6), 1u);
+  EXPECT_EQ(frame.GetDLSymbolIdx(7), 0u);
+  EXPECT_EQ(frame.GetDLSymbolIdx(8), 1u);
+  EXPECT_EQ(frame.GetDLCalSymbolIdx(9), 0u);
+
+  // Every index maps back to its symbol
+  for (size_t i = 0; i < frame.NumULSyms(); i++) {
+    EXPECT_EQ(frame.GetULSymbolIdx(frame.GetULSymbol(i)), i);
+  }
+  for (size_t i = 0; i < frame.NumDLSyms(); i++) {
+    EXPECT_EQ(frame.GetDLSymbolIdx(frame.GetDLSymbol(i)), i);
+  }
+}
+
+TEST(TestFrameStats, OtherSymbolTypes) {
+  const FrameStats frame("PGUD");
+  // Symbols of another type, guard symbols and symbols past the frame
+  EXPECT_EQ(frame.GetULSymbolIdx(0), SIZE_MAX);
+  EXPECT_EQ(frame.GetULSymbolIdx(1), SIZE_MAX);
+  EXPECT_EQ(frame.GetPilotSymbolIdx(2), SIZE_MAX);
+  EXPECT_EQ(frame.GetDLSymbolIdx(4), SIZE_MAX);
+  EXPECT_EQ(frame.GetBeaconSymbolIdx(0), SIZE_MAX);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+/**
+ * @file test_harq_buffer.cc
+ * @brief Test the combining and the soft bit storage of the uplink HARQ
+ * buffers.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "harq_buffer.h"
+
+static constexpr size_t kNumUes = 2;
+static constexpr size_t kNumProcesses = 4;
+static constexpr size_t kCbsPerFrame = 3;
+static constexpr size_t kLlrsPerCb = 9;
+static constexpr size_t kMaxTx = 3;
+
+static std::vector<int8_t> Llrs(int8_t first) {
+  std::vector<int8_t> llrs(kLlrsPerCb);
+  for (size_t i = 0; i < kLlrsPerCb; i++) {
+    llrs.at(i) = static_cast<int8_t>(first - static_cast<int8_t>(10 * i));
+  }
+  return llrs;
+}
+
+TEST(TestHarqBuffer, ChaseCombining) {
+  HarqBuffer harq(kNumUes, kNumProcesses, kCbsPerFrame, kLlrsPerCb, 8, kMaxTx);
+  std::vector<int8_t> llrs = Llrs(40);
+  EXPECT_EQ(harq.Combine(1, 5, 2, llrs.data()), 1u);
+  harq.Update(1, 5, 2, llrs.data(), false);
+
+  // Other UEs, code blocks and processes are new data
+  std::vector<int8_t> other = Llrs(40);
+  EXPECT_EQ(harq.Combine(0, 9, 2, other.data()), 1u);
+  EXPECT_EQ(harq.Combine(1, 9, 1, other.data()), 1u);
+  EXPECT_EQ(harq.Combine(1, 6, 2, other.data()), 1u);
+  EXPECT_EQ(other, Llrs(40));
+
+  // The retransmission one process cycle later
+  std::vector<int8_t> retx = Llrs(100);
+  EXPECT_EQ(harq.Combine(1, 5 + kNumProcesses, 2, retx.data()), 2u);
+  const std::vector<int8_t> first = Llrs(40);
+  const std::vector<int8_t> second = Llrs(100);
+  for (size_t i = 0; i < kLlrsPerCb; i++) {
+    const int sum = std::max(-127, std::min(127, first.at(i) + second.at(i)));
+    EXPECT_EQ(retx.at(i), sum);
+  }
+  harq.Update(1, 5 + kNumProcesses, 2, retx.data(), true);
+  EXPECT_EQ(harq.CombinedCbs(), 1u);
+  EXPECT_EQ(harq.RecoveredCbs(), 1u);
+
+  // Decoded, so the next use of the process is new data
+  std::vector<int8_t> next = Llrs(40);
+  EXPECT_EQ(harq.Combine(1, 5 + (2 * kNumProcesses), 2, next.data()), 1u);
+}
+
+TEST(TestHarqBuffer, MaxTxDrop) {
+  HarqBuffer harq(kNumUes, kNumProcesses, kCbsPerFrame, kLlrsPerCb, 8, kMaxTx);
+  size_t frame_id = 2;
+  for (size_t tx = 1; tx <= kMaxTx; tx++) {
+    std::vector<int8_t> llrs = Llrs(1);
+    EXPECT_EQ(harq.Combine(0, frame_id, 0, llrs.data()), tx);
+    harq.Update(0, frame_id, 0, llrs.data(), false);
+    frame_id += kNumProcesses;
+  }
+  EXPECT_EQ(harq.DroppedCbs(), 1u);
+  EXPECT_EQ(harq.RecoveredCbs(), 0u);
+  std::vector<int8_t> llrs = Llrs(1);
+  EXPECT_EQ(harq.Combine(0, frame_id, 0, llrs.data()), 1u);
+}
+
+TEST(TestHarqBuffer, MissedRetransmission) {
+  HarqBuffer harq(kNumUes, kNumProcesses, kCbsPerFrame, kLlrsPerCb, 8, kMaxTx);
+  std::vector<int8_t> llrs = Llrs(40);
+  harq.Combine(0, 3, 0, llrs.data());
+  harq.Update(0, 3, 0, llrs.data(), false);
+  // Two process cycles later the stored soft bits are stale
+  std::vector<int8_t> late = Llrs(40);
+  EXPECT_EQ(harq.Combine(0, 3 + (2 * kNumProcesses), 0, late.data()), 1u);
+  EXPECT_EQ(late, Llrs(40));
+}
+
+TEST(TestHarqBuffer, FourBitStorage) {
+  HarqBuffer harq(kNumUes, kNumProcesses, kCbsPerFrame, kLlrsPerCb, 4, kMaxTx);
+  EXPECT_EQ(harq.SizeBytes(), kNumUes * kNumProcesses * kCbsPerFrame *
+                                  ((kLlrsPerCb + 1) / 2));
+  const std::vector<int8_t> llrs = Llrs(40);
+  std::vector<int8_t> stored = llrs;
+  harq.Combine(1, 0, 1, stored.data());
+  harq.Update(1, 0, 1, stored.data(), false);
+
+  // Combining with zeros returns the stored LLRs
+  std::vector<int8_t> zeros(kLlrsPerCb, 0);
+  EXPECT_EQ(harq.Combine(1, kNumProcesses, 1, zeros.data()), 2u);
+  // The largest LLR is 40, stored with a step of 8
+  for (size_t i = 0; i < kLlrsPerCb; i++) {
+    EXPECT_NEAR(zeros.at(i), llrs.at(i), 4);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
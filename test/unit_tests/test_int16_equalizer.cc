@@ -0,0 +1,91 @@
+/**
+ * @file test_int16_equalizer.cc
+ * @brief Test the int16 uplink equalizer against the float equalization.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "int16_equalizer.h"
+
+using Cx = std::complex<float>;
+
+/// Compare the int16 equalization of random data with random beamweights
+/// to the float equalization, relative to the norms of the operands
+static void CheckEqualize(size_t num_streams, size_t num_ants) {
+  std::mt19937 gen(num_streams * 1000 + num_ants);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  // Column-major num_streams x num_ants, as the float beam matrices
+  std::vector<Cx> beam(num_streams * num_ants);
+  for (auto& w : beam) {
+    w = Cx(dist(gen), dist(gen)) * 1e-2f;
+  }
+  std::vector<int16_t> beam_q(Int16Equalizer::kValuesPerEntry * beam.size());
+  const float beam_scale = Int16Equalizer::QuantizeBeam(
+      reinterpret_cast<const float*>(beam.data()), num_streams, num_ants,
+      beam_q.data());
+  ASSERT_GT(beam_scale, 0.0f);
+
+  std::vector<int16_t> scratch(Int16Equalizer::ScratchSize(num_ants));
+  for (size_t trial = 0; trial < 20; trial++) {
+    std::vector<Cx> data(num_ants);
+    float data_norm_sq = 0;
+    for (auto& d : data) {
+      d = Cx(dist(gen), dist(gen)) * 1e3f;
+      data_norm_sq += std::norm(d);
+    }
+    std::vector<Cx> equal(num_streams);
+    Int16Equalizer::Equalize(
+        beam_q.data(), beam_scale, reinterpret_cast<const float*>(data.data()),
+        num_streams, num_ants, scratch.data(),
+        reinterpret_cast<float*>(equal.data()));
+
+    for (size_t ss = 0; ss < num_streams; ss++) {
+      Cx expected = 0;
+      float row_norm_sq = 0;
+      for (size_t ant = 0; ant < num_ants; ant++) {
+        expected += beam.at(ant * num_streams + ss) * data.at(ant);
+        row_norm_sq += std::norm(beam.at(ant * num_streams + ss));
+      }
+      const float bound =
+          1e-3f * std::sqrt(row_norm_sq) * std::sqrt(data_norm_sq);
+      EXPECT_NEAR(equal.at(ss).real(), expected.real(), bound);
+      EXPECT_NEAR(equal.at(ss).imag(), expected.imag(), bound);
+    }
+  }
+}
+
+TEST(TestInt16Equalizer, MatchesFloat) {
+  CheckEqualize(4, 64);
+  CheckEqualize(8, 32);
+}
+
+TEST(TestInt16Equalizer, AntennaTail) {
+  // Antennas that do not fill a SIMD register
+  CheckEqualize(3, 10);
+  CheckEqualize(2, 21);
+}
+
+TEST(TestInt16Equalizer, ZeroInputs) {
+  std::vector<float> beam(2 * 2 * 4, 0.0f);
+  std::vector<int16_t> beam_q(beam.size());
+  EXPECT_EQ(
+      Int16Equalizer::QuantizeBeam(beam.data(), 2, 4, beam_q.data()), 0.0f);
+
+  std::vector<float> data(2 * 4, 1.0f);
+  std::vector<float> equal(2 * 2, 1.0f);
+  std::vector<int16_t> scratch(Int16Equalizer::ScratchSize(4));
+  Int16Equalizer::Equalize(beam_q.data(), 0.0f, data.data(), 2, 4,
+                           scratch.data(), equal.data());
+  for (float value : equal) {
+    EXPECT_EQ(value, 0.0f);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
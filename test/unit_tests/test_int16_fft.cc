@@ -0,0 +1,94 @@
+/**
+ * @file test_int16_fft.cc
+ * @brief Test the block floating point int16 FFT against a direct DFT of
+ * the samples as SimdConvertShortToFloat() converts them.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "int16_fft.h"
+
+// The unscaled forward DFT of the int16 IQ samples in, divided by 2^15,
+// FFT-shifted
+static std::vector<std::complex<double>> ShiftedDft(
+    const std::vector<short>& in, size_t fft_size) {
+  std::vector<std::complex<double>> out(fft_size);
+  for (size_t k = 0; k < fft_size; k++) {
+    std::complex<double> sum = 0;
+    for (size_t n = 0; n < fft_size; n++) {
+      const double phase = -2 * M_PI * static_cast<double>(k * n) /
+                           static_cast<double>(fft_size);
+      sum += std::complex<double>(in[2 * n], in[2 * n + 1]) *
+             std::complex<double>(std::cos(phase), std::sin(phase));
+    }
+    out[(k + fft_size / 2) % fft_size] = sum / 32768.0;
+  }
+  return out;
+}
+
+// Error of the int16 FFT of in relative to the norm of the DFT
+static double RelativeError(const std::vector<short>& in, size_t fft_size,
+                            int& exponent) {
+  Int16Fft fft(fft_size);
+  fft.Forward(in.data());
+  exponent = fft.Exponent();
+  std::vector<complex_float> out(fft_size);
+  // In two calls, across the middle
+  fft.ToFloatShifted(out.data(), 0, fft_size / 2 + 3);
+  fft.ToFloatShifted(out.data(), fft_size / 2 + 3, fft_size / 2 - 3);
+
+  const auto ref = ShiftedDft(in, fft_size);
+  double err_sq = 0;
+  double ref_sq = 0;
+  for (size_t i = 0; i < fft_size; i++) {
+    err_sq += std::norm(std::complex<double>(out[i].re, out[i].im) - ref[i]);
+    ref_sq += std::norm(ref[i]);
+  }
+  return std::sqrt(err_sq / ref_sq);
+}
+
+TEST(TestInt16Fft, RandomSamples) {
+  std::mt19937 gen(7);
+  std::normal_distribution<double> dist(0.0, 3000.0);
+  for (size_t fft_size : {64, 512, 2048}) {
+    std::vector<short> in(2 * fft_size);
+    for (auto& value : in) {
+      value = static_cast<short>(
+          std::max(-32768.0, std::min(32767.0, std::round(dist(gen)))));
+    }
+    int exponent = 0;
+    EXPECT_LT(RelativeError(in, fft_size, exponent), 2e-3)
+        << "fft_size " << fft_size;
+    EXPECT_GT(exponent, 0);
+  }
+}
+
+TEST(TestInt16Fft, FullScaleTone) {
+  // A full-scale tone at bin 5 grows by the FFT size, so every stage halves
+  const size_t fft_size = 1024;
+  std::vector<short> in(2 * fft_size);
+  for (size_t n = 0; n < fft_size; n++) {
+    const double phase = 2 * M_PI * 5 * static_cast<double>(n) / fft_size;
+    in[2 * n] = static_cast<short>(std::lrint(32767 * std::cos(phase)));
+    in[2 * n + 1] = static_cast<short>(std::lrint(32767 * std::sin(phase)));
+  }
+  int exponent = 0;
+  EXPECT_LT(RelativeError(in, fft_size, exponent), 5e-3);
+  EXPECT_GE(exponent, 10);
+}
+
+TEST(TestInt16Fft, SmallSamples) {
+  // Small samples are scaled up first, and keep their precision
+  const size_t fft_size = 256;
+  std::vector<short> in(2 * fft_size);
+  for (size_t i = 0; i < in.size(); i++) {
+    in[i] = static_cast<short>((i * 7) % 11) - 5;
+  }
+  int exponent = 0;
+  EXPECT_LT(RelativeError(in, fft_size, exponent), 2e-3);
+  EXPECT_LT(exponent, 0);
+}
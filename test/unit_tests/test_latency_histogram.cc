@@ -0,0 +1,49 @@
+/**
+ * @file test_latency_histogram.cc
+ * @brief Test the percentiles of the latency histogram used by Stats.
+ */
+#include <gtest/gtest.h>
+
+#include "latency_histogram.h"
+
+// Bound of the relative error of a bucket
+static constexpr double kRelError = 1.0 / 32;
+
+TEST(TestLatencyHistogram, Empty) {
+  LatencyHistogram hist;
+  EXPECT_EQ(hist.Count(), 0u);
+  EXPECT_EQ(hist.PercentileUs(50.0), 0.0);
+}
+
+TEST(TestLatencyHistogram, Percentiles) {
+  LatencyHistogram hist;
+  for (size_t i = 1; i <= 10000; i++) {
+    hist.Record(static_cast<double>(i));
+  }
+  EXPECT_EQ(hist.Count(), 10000u);
+  EXPECT_NEAR(hist.PercentileUs(50.0), 5000.0, 5000.0 * kRelError);
+  EXPECT_NEAR(hist.PercentileUs(99.0), 9900.0, 9900.0 * kRelError);
+  EXPECT_NEAR(hist.PercentileUs(99.9), 9990.0, 9990.0 * kRelError);
+  EXPECT_EQ(hist.PercentileUs(100.0), 10000.0);
+  EXPECT_EQ(hist.MaxUs(), 10000.0);
+}
+
+TEST(TestLatencyHistogram, Tail) {
+  LatencyHistogram hist;
+  for (size_t i = 0; i < 999; i++) {
+    hist.Record(100.0);
+  }
+  hist.Record(3000.0);
+  EXPECT_NEAR(hist.PercentileUs(99.0), 100.0, 100.0 * kRelError);
+  EXPECT_NEAR(hist.PercentileUs(99.95), 3000.0, 3000.0 * kRelError);
+  // Out of range samples go to the last bucket
+  hist.Record(1e12);
+  EXPECT_GE(hist.PercentileUs(100.0), 1e9);
+  hist.Reset();
+  EXPECT_EQ(hist.Count(), 0u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,72 @@
+/**
+ * @file test_mac_phy_ring.cc
+ * @brief Test the single-producer single-consumer MAC-PHY ring.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "mac_phy_ring.h"
+
+static constexpr size_t kNumTbs = 100000;
+
+TEST(TestMacPhyRing, FullAndEmpty) {
+  MacPhyRing ring(5, false);
+  ASSERT_EQ(ring.NumSlots(), 8u);
+
+  MacTbDescriptor tb;
+  EXPECT_FALSE(ring.TryPop(tb));
+  for (uint32_t i = 0; i < ring.NumSlots(); i++) {
+    EXPECT_TRUE(ring.TryPush({i, i + 1}));
+  }
+  EXPECT_FALSE(ring.TryPush({0, 0}));
+  for (uint32_t i = 0; i < ring.NumSlots(); i++) {
+    ASSERT_TRUE(ring.TryPop(tb));
+    EXPECT_EQ(tb.frame_id_, i);
+    EXPECT_EQ(tb.ue_id_, i + 1);
+  }
+  EXPECT_FALSE(ring.TryPop(tb));
+}
+
+TEST(TestMacPhyRing, SharedMapping) {
+  MacPhyRing producer(64, false);
+  // The consumer maps the ring from its memfd, as another process would
+  MacPhyRing consumer(::dup(producer.Fd()));
+  ASSERT_EQ(consumer.NumSlots(), producer.NumSlots());
+
+  std::thread producer_thread([&producer]() {
+    for (uint32_t i = 0; i < kNumTbs;) {
+      if (producer.TryPush({i, i % 16})) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (uint32_t i = 0; i < kNumTbs;) {
+    MacTbDescriptor tb;
+    if (consumer.TryPop(tb)) {
+      ASSERT_EQ(tb.frame_id_, i);
+      ASSERT_EQ(tb.ue_id_, i % 16);
+      i++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer_thread.join();
+}
+
+TEST(TestMacPhyRing, Hugepage) {
+  // Falls back to 4 KB pages without hugepages
+  MacPhyRing ring(16, true);
+  EXPECT_TRUE(ring.TryPush({1, 2}));
+  MacTbDescriptor tb;
+  EXPECT_TRUE(ring.TryPop(tb));
+  EXPECT_EQ(tb.frame_id_, 1u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
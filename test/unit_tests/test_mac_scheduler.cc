@@ -0,0 +1,168 @@
+/**
+ * @file test_mac_scheduler.cc
+ * @brief Test the round-robin and proportional-fair MAC schedules, their
+ * MCS and the allocation of the offered load.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include "config.h"
+#include "mac_scheduler.h"
+#include "ran_config.h"
+
+// 4 UEs sharing 2 spatial streams
+static constexpr char kConfFile[] = "files/config/ci/tddconfig-sim-ul-pf.json";
+static constexpr size_t kNumFrames = 400;
+
+TEST(TestMacScheduler, RoundRobin) {
+  auto cfg = std::make_unique<Config>(kConfFile);
+  MacScheduler sched(cfg.get());
+
+  for (size_t frame = 0; frame < 8; frame++) {
+    const size_t gp = frame % cfg->UeAntNum();
+    for (size_t sc : {size_t{0}, cfg->OfdmDataNum() - 1}) {
+      const arma::uvec ue_list = sched.ScheduledUeList(frame, sc);
+      const arma::uvec ue_map = sched.ScheduledUeMap(frame, sc);
+      ASSERT_EQ(ue_list.n_elem, cfg->SpatialStreamsNum());
+      EXPECT_TRUE(ue_list.is_sorted());
+      for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+        const bool in_group =
+            ((ue + cfg->UeAntNum() - gp) % cfg->UeAntNum()) <
+            cfg->SpatialStreamsNum();
+        EXPECT_EQ(sched.IsUeScheduled(frame, sc, ue), in_group);
+        EXPECT_EQ(ue_map(ue) != 0, in_group);
+      }
+      for (size_t i = 0; i < ue_list.n_elem; i++) {
+        EXPECT_EQ(sched.ScheduledUeIndex(frame, sc, i), ue_list(i));
+      }
+    }
+  }
+}
+
+TEST(TestMacScheduler, ProportionalFair) {
+  auto cfg = std::make_unique<Config>(kConfFile);
+  MacScheduler sched(cfg.get(), true);
+
+  std::vector<size_t> num_scheduled(cfg->UeAntNum(), 0);
+  for (size_t frame = 0; frame < kNumFrames; frame++) {
+    sched.ScheduleFrame(frame);
+    const arma::uvec ue_list = sched.ScheduledUeList(frame, 0);
+    ASSERT_EQ(ue_list.n_elem, cfg->SpatialStreamsNum());
+    EXPECT_TRUE(ue_list.is_sorted());
+    for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+      if (sched.IsUeScheduled(frame, cfg->OfdmDataNum() - 1, ue)) {
+        num_scheduled.at(ue)++;
+      }
+    }
+  }
+  // Proportional fairness gives every UE its share of the frames, up to the
+  // averaging window
+  for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+    EXPECT_GT(num_scheduled.at(ue), kNumFrames / 4);
+  }
+}
+
+TEST(TestMacScheduler, RanConfigEpoch) {
+  auto cfg = std::make_unique<Config>(kConfFile);
+  MacScheduler sched(cfg.get(), true);
+
+  sched.ScheduleFrame(4);
+  RanConfig rc;
+  rc.n_antennas_ = 0;
+  rc.mcs_index_ = cfg->McsIndex(Direction::kUplink) + 1;
+  rc.frame_id_ = 8;
+  sched.UpdateRanConfig(rc);
+  sched.ScheduleFrame(12);
+  // The frames scheduled before the update, and the ones before its first
+  // frame, keep the old epoch
+  for (size_t frame = 0; frame <= 12; frame++) {
+    const ScheduleSnapshot& snapshot = sched.Schedule(frame);
+    EXPECT_EQ(snapshot.frame_id_, frame);
+    EXPECT_EQ(snapshot.epoch_, (frame < rc.frame_id_) ? 0u : 1u);
+    EXPECT_EQ(snapshot.phy_ul_mcs_, (frame < rc.frame_id_)
+                                        ? cfg->McsIndex(Direction::kUplink)
+                                        : rc.mcs_index_);
+    const arma::uvec ue_list = sched.ScheduledUeList(frame, 0);
+    for (size_t i = 0; i < ue_list.n_elem; i++) {
+      EXPECT_EQ(snapshot.ue_list_.at(i), ue_list(i));
+    }
+  }
+  // The same MCS again does not start an epoch
+  sched.UpdateRanConfig(rc);
+  sched.ScheduleFrame(13);
+  EXPECT_EQ(sched.Schedule(13).epoch_, 1u);
+}
+
+TEST(TestMacScheduler, PhyMcs) {
+  auto cfg = std::make_unique<Config>(kConfFile);
+  MacScheduler sched(cfg.get(), true);
+
+  // Every UE gets the MCS the PHY codes it with
+  for (size_t frame = 0; frame < 20; frame++) {
+    sched.ScheduleFrame(frame);
+    for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+      EXPECT_EQ(sched.ScheduledUeUlMcs(frame, ue),
+                sched.Schedule(frame).phy_ul_mcs_);
+      EXPECT_EQ(sched.ScheduledUeDlMcs(frame, ue),
+                cfg->McsIndex(Direction::kDownlink));
+    }
+  }
+}
+
+TEST(TestMacScheduler, OfferedLoad) {
+  auto cfg = std::make_unique<Config>(kConfFile);
+  MacScheduler sched(cfg.get(), true);
+  const McsParams& mcs =
+      cfg->Mcs(Direction::kUplink, cfg->McsIndex(Direction::kUplink));
+  const size_t num_cbs = mcs.ldpc_config_.NumBlocksInSymbol();
+
+  // The default full load allocates every subcarrier and code block
+  sched.ScheduleFrame(0);
+  const ScheduleSnapshot& full = sched.Schedule(0);
+  EXPECT_EQ(full.ul_num_sc_, cfg->OfdmDataNum());
+  EXPECT_EQ(full.dl_num_sc_, cfg->OfdmDataNum());
+  for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+    EXPECT_EQ(full.ul_num_cbs_.at(ue),
+              (full.ue_map_.at(ue) != 0) ? num_cbs : 0u);
+  }
+
+  // UE 0 has no traffic, the other UEs half of the grid
+  sched.SetOfferedLoad(0, 0.0f, 0.0f);
+  for (size_t ue = 1; ue < cfg->UeAntNum(); ue++) {
+    sched.SetOfferedLoad(ue, 0.5f, 0.5f);
+  }
+  for (size_t frame = 1; frame < 5; frame++) {
+    sched.ScheduleFrame(frame);
+    const ScheduleSnapshot& half = sched.Schedule(frame);
+    size_t max_cbs = 0;
+    for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+      const size_t ue_cbs = ((ue == 0) || (half.ue_map_.at(ue) == 0))
+                                ? 0
+                                : (num_cbs + 1) / 2;
+      EXPECT_EQ(half.ul_num_cbs_.at(ue), ue_cbs);
+      max_cbs = std::max(max_cbs, ue_cbs);
+    }
+    // The subcarriers hold the LLRs of the granted code blocks, in whole
+    // PRBs
+    EXPECT_GE(half.ul_num_sc_ * mcs.mod_order_bits_,
+              max_cbs * mcs.ldpc_config_.NumCbCodewLen());
+    EXPECT_LE(half.ul_num_sc_, cfg->OfdmDataNum());
+    EXPECT_GE(half.dl_num_sc_, cfg->OfdmDataNum() / 2);
+    EXPECT_LE(half.dl_num_sc_, cfg->OfdmDataNum());
+    for (size_t num_sc : {half.ul_num_sc_, half.dl_num_sc_}) {
+      EXPECT_TRUE((num_sc % 12 == 0) || (num_sc == cfg->OfdmDataNum()));
+    }
+  }
+
+  // No traffic at all leaves nothing to process
+  for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+    sched.SetOfferedLoad(ue, 0.0f, 0.0f);
+  }
+  sched.ScheduleFrame(5);
+  const ScheduleSnapshot& idle = sched.Schedule(5);
+  EXPECT_EQ(idle.ul_num_sc_, 0u);
+  EXPECT_EQ(idle.dl_num_sc_, 0u);
+  for (size_t ue = 0; ue < cfg->UeAntNum(); ue++) {
+    EXPECT_EQ(idle.ul_num_cbs_.at(ue), 0u);
+  }
+}
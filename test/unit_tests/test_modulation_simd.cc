@@ -0,0 +1,59 @@
+/**
+ * @file test_modulation_simd.cc
+ * @brief Test the gather-free ModSimd against the table lookup of
+ * ModSingleUint8 for every symbol of each modulation order.
+ */
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "memory_manage.h"
+#include "modulation.h"
+
+// Not a multiple of 8, to cover the partial register of the kernels
+static constexpr size_t kNumSymbols = 1021;
+
+static void CompareWithTable(size_t mod_order_bits) {
+  Table<complex_float> mod_table;
+  InitModulationTable(mod_table, mod_order_bits);
+
+  // Every symbol value first, then random ones
+  std::vector<uint8_t> bits(kNumSymbols);
+  std::default_random_engine generator(mod_order_bits);
+  std::uniform_int_distribution<int> distribution(
+      0, (1 << mod_order_bits) - 1);
+  for (size_t i = 0; i < kNumSymbols; i++) {
+    bits[i] = (i < (1u << mod_order_bits))
+                  ? static_cast<uint8_t>(i)
+                  : static_cast<uint8_t>(distribution(generator));
+  }
+
+  for (const size_t len : {kNumSymbols, size_t{1}, size_t{7}, size_t{8}}) {
+    // One guard point past len, which ModSimd must leave untouched
+    std::vector<complex_float> out(len + 1, complex_float{7.0f, 7.0f});
+    ModSimd(bits.data(), out.data(), len, mod_table, mod_order_bits);
+    for (size_t i = 0; i < len; i++) {
+      const complex_float ref = ModSingleUint8(bits[i], mod_table);
+      ASSERT_EQ(out[i].re, ref.re) << "symbol " << i << " of " << len;
+      ASSERT_EQ(out[i].im, ref.im) << "symbol " << i << " of " << len;
+    }
+    EXPECT_EQ(out[len].re, 7.0f);
+    EXPECT_EQ(out[len].im, 7.0f);
+  }
+  mod_table.Free();
+}
+
+TEST(TestModulationSimd, Qpsk) { CompareWithTable(2); }
+
+TEST(TestModulationSimd, Qam16) { CompareWithTable(4); }
+
+TEST(TestModulationSimd, Qam64) { CompareWithTable(6); }
+
+TEST(TestModulationSimd, Qam256) { CompareWithTable(8); }
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_noise_generator.cc
+ * @brief Test the Philox generator and the Gaussian noise built on it.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <cmath>
+#include <vector>
+
+#include "noise_generator.h"
+
+static constexpr size_t kNumValues = 1 << 20;
+
+TEST(TestNoiseGenerator, PhiloxKnownAnswers) {
+  // Known-answer vectors of Philox4x32-10 from Random123
+  using Words = std::array<uint32_t, 4>;
+  EXPECT_EQ(NoiseGenerator::Philox({0, 0, 0, 0}, {0, 0}),
+            (Words{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  EXPECT_EQ(NoiseGenerator::Philox(
+                {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                {0xffffffff, 0xffffffff}),
+            (Words{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  EXPECT_EQ(NoiseGenerator::Philox(
+                {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                {0xa4093822, 0x299f31d0}),
+            (Words{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(TestNoiseGenerator, Moments) {
+  NoiseGenerator noise(1234, 0);
+  std::vector<float> values(kNumValues);
+  noise.Gaussian(values.data(), values.size(), 2.0f);
+
+  double mean = 0.0;
+  double var = 0.0;
+  double fourth = 0.0;
+  for (const float value : values) {
+    mean += value;
+    var += value * value;
+    fourth += std::pow(value, 4);
+  }
+  mean /= kNumValues;
+  var /= kNumValues;
+  fourth /= kNumValues;
+  EXPECT_NEAR(mean, 0.0, 0.01);
+  EXPECT_NEAR(var, 4.0, 0.02);
+  // The kurtosis of a Gaussian is 3
+  EXPECT_NEAR(fourth / (var * var), 3.0, 0.03);
+}
+
+TEST(TestNoiseGenerator, Streams) {
+  std::vector<float> values(kNumValues);
+  NoiseGenerator noise(7, 1);
+  noise.Gaussian(values.data(), values.size(), 1.0f);
+
+  // The same values in several calls of any length
+  std::vector<float> pieces(kNumValues, 1.0f);
+  NoiseGenerator same(7, 1);
+  same.Gaussian(pieces.data(), 5, 1.0f);
+  same.Gaussian(pieces.data() + 5, 100, 1.0f);
+  same.AddGaussian(pieces.data() + 105, kNumValues - 105, 1.0f);
+  for (size_t i = 0; i < kNumValues; i++) {
+    // Added with a fused multiply-add
+    ASSERT_NEAR(pieces.at(i), (i < 105) ? values.at(i) : values.at(i) + 1.0f,
+                1e-6);
+  }
+
+  // Seek to a group without generating the ones before it
+  std::vector<float> group(NoiseGenerator::kGroupSize);
+  NoiseGenerator seek(7, 1);
+  seek.Seek(3);
+  seek.Gaussian(group.data(), group.size(), 1.0f);
+  for (size_t i = 0; i < group.size(); i++) {
+    ASSERT_EQ(group.at(i), values.at((3 * NoiseGenerator::kGroupSize) + i));
+  }
+
+  // Other streams of the same seed are uncorrelated
+  std::vector<float> other(kNumValues);
+  NoiseGenerator other_stream(7, 2);
+  other_stream.Gaussian(other.data(), other.size(), 1.0f);
+  double corr = 0.0;
+  for (size_t i = 0; i < kNumValues; i++) {
+    corr += values.at(i) * other.at(i);
+  }
+  EXPECT_NEAR(corr / kNumValues, 0.0, 0.01);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file test_numa_replica.cc
+ * @brief Test the per-NUMA-node copies of read-only tables.
+ */
+#include <gtest/gtest.h>
+
+#include "numa_replica.h"
+#include "utils.h"
+
+static void FillTable(Table<int16_t>& table, size_t dim1, size_t dim2) {
+  table.Malloc(dim1, dim2, Agora_memory::Alignment_t::kAlign64);
+  for (size_t i = 0; i < dim1; i++) {
+    for (size_t j = 0; j < dim2; j++) {
+      table[i][j] = static_cast<int16_t>((i * 1000) + j);
+    }
+  }
+}
+
+TEST(TestNumaReplica, WrapReturnsSource) {
+  Table<int16_t> src;
+  FillTable(src, 3, 100);
+  NumaReplica<int16_t> replica;
+  replica.Wrap(src);
+  EXPECT_EQ(&replica.On(-1), &src);
+  EXPECT_EQ(&replica.On(0), &src);
+  src.Free();
+}
+
+TEST(TestNumaReplica, CopiesOnEachNode) {
+  Table<int16_t> src;
+  FillTable(src, 4, 333);
+  const size_t num_nodes = NumaNodeCount();
+  NumaReplica<int16_t> replica;
+  replica.Replicate(src, num_nodes);
+  for (size_t node = 0; node < num_nodes; node++) {
+    Table<int16_t>& copy = replica.On(static_cast<int>(node));
+    ASSERT_NE(&copy, &src);
+    ASSERT_EQ(copy.Dim1(), src.Dim1());
+    ASSERT_EQ(copy.Dim2(), src.Dim2());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(copy[0]) % 64, 0u);
+    EXPECT_TRUE(copy == src) << "node " << node;
+  }
+  // Unknown and missing nodes read the source
+  EXPECT_EQ(&replica.On(-1), &src);
+  EXPECT_EQ(&replica.On(static_cast<int>(num_nodes)), &src);
+  replica.Free();
+  EXPECT_EQ(&replica.On(0), &src);
+  src.Free();
+}
+
+TEST(TestNumaReplica, EmptySource) {
+  Table<int16_t> src;
+  NumaReplica<int16_t> replica;
+  replica.Replicate(src, 2);
+  EXPECT_EQ(&replica.On(1), &src);
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_oran_fronthaul.cc
+ * @brief Test the O-RAN fronthaul messages, the compression of their PRBs
+ * and the timing of their symbols.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <random>
+#include <vector>
+
+#include "oran_fronthaul.h"
+
+TEST(TestOranFronthaul, Compression) {
+  static constexpr size_t kNumPrb = 5;
+  std::mt19937 gen(7);
+  std::normal_distribution<float> dist(0.0f, 0.2f);
+  std::vector<complex_float> in(kNumPrb * kOranPrbSubcarriers);
+  for (auto& sample : in) {
+    sample = {dist(gen), dist(gen)};
+  }
+  // A quiet PRB gets a smaller exponent
+  for (size_t sc = 0; sc < kOranPrbSubcarriers; sc++) {
+    in.at(kOranPrbSubcarriers + sc).re *= 1e-3f;
+    in.at(kOranPrbSubcarriers + sc).im *= 1e-3f;
+  }
+  for (const size_t bfp_bits : {0ul, 8ul, 9ul, 14ul, 16ul}) {
+    std::vector<uint8_t> packed(kNumPrb * OranPrbBytes(bfp_bits) +
+                                kOranPadding);
+    std::vector<complex_float> out(in.size());
+    OranCompress(in.data(), packed.data(), kNumPrb, bfp_bits, 32768.f);
+    OranDecompress(packed.data(), out.data(), kNumPrb, bfp_bits);
+    // Within a step of the mantissa of the largest sample of each PRB, and
+    // of the 16-bit samples in the quiet PRB
+    const float step = (bfp_bits == 0) ? (1.0f / 32768.f)
+                                       : (2.0f / static_cast<float>(
+                                                     1 << (bfp_bits - 1)));
+    for (size_t i = 0; i < in.size(); i++) {
+      const float tol =
+          (i / kOranPrbSubcarriers == 1) ? (1.0f / 32768.f) : step;
+      EXPECT_NEAR(out.at(i).re, in.at(i).re, tol) << bfp_bits << " " << i;
+      EXPECT_NEAR(out.at(i).im, in.at(i).im, tol) << bfp_bits << " " << i;
+    }
+  }
+
+  // 9-bit mantissas go out MSB first: I0 = 1, Q0 = -1
+  std::vector<complex_float> prb(kOranPrbSubcarriers, {0.0f, 0.0f});
+  prb.at(0) = {1.0f, -1.0f};
+  std::vector<uint8_t> packed(OranPrbBytes(9) + kOranPadding);
+  OranCompress(prb.data(), packed.data(), 1, 9, 1.0f);
+  EXPECT_EQ(packed.size(), 28 + kOranPadding);
+  EXPECT_EQ(packed.at(0), 0);
+  EXPECT_EQ(packed.at(1), 0x00);
+  EXPECT_EQ(packed.at(2), 0xFF);
+  EXPECT_EQ(packed.at(3), 0xC0);
+  EXPECT_EQ(packed.at(4), 0x00);
+}
+
+TEST(TestOranFronthaul, Messages) {
+  static constexpr size_t kNumPrb = 273;
+  static constexpr size_t kBfpBits = 9;
+  const size_t prb_bytes = OranPrbBytes(kBfpBits);
+  std::vector<uint8_t> msg(kOranUplaneHeaderBytes + kNumPrb * prb_bytes + 8);
+  const OranUplaneHeader sent = {0x0102, 7, false, {200, 9, 1, 13}};
+  OranWriteUplane(msg.data(), sent, kNumPrb, prb_bytes);
+  EXPECT_EQ(msg.at(0), 0x10);
+  EXPECT_EQ(msg.at(1), kEcpriIqData);
+  // frameId, then subframe 9, slot 1 and symbol 13 in 4, 6 and 6 bits
+  EXPECT_EQ(msg.at(9), 200);
+  EXPECT_EQ(msg.at(10), 0x90);
+  EXPECT_EQ(msg.at(11), 0x4D);
+  // Over 255 PRBs numPrbu is 0 for all of them
+  EXPECT_EQ(msg.at(15), 0);
+
+  OranUplaneHeader header;
+  std::array<OranSection, kOranMaxSections> sections;
+  // Ethernet padding after the message is ignored
+  ASSERT_EQ(OranParseUplane(msg.data(), msg.size(), kNumPrb, kBfpBits, header,
+                            sections),
+            1u);
+  EXPECT_EQ(header.eaxc_id_, sent.eaxc_id_);
+  EXPECT_EQ(header.seq_id_, sent.seq_id_);
+  EXPECT_EQ(header.downlink_, false);
+  EXPECT_EQ(header.symbol_.frame_id_, 200);
+  EXPECT_EQ(header.symbol_.subframe_id_, 9);
+  EXPECT_EQ(header.symbol_.slot_id_, 1);
+  EXPECT_EQ(header.symbol_.symbol_id_, 13);
+  EXPECT_EQ(sections.at(0).start_prb_, 0);
+  EXPECT_EQ(sections.at(0).num_prb_, kNumPrb);
+  EXPECT_EQ(sections.at(0).data_offset_, kOranUplaneHeaderBytes);
+  // A truncated message
+  EXPECT_EQ(OranParseUplane(msg.data(), msg.size() - 20, kNumPrb, kBfpBits,
+                            header, sections),
+            0u);
+
+  std::array<uint8_t, kOranCplaneBytes> cplane_msg;
+  const OranCplane cplane = {3, 1, true, {1, 2, 0, 4}, 10, 100, kBfpBits, 5};
+  OranWriteCplane(cplane_msg.data(), cplane);
+  EXPECT_EQ(cplane_msg.at(1), kEcpriRtControl);
+  EXPECT_EQ(cplane_msg.at(3), kOranCplaneBytes - 4);
+  EXPECT_EQ(cplane_msg.at(8), 0x90);
+  EXPECT_EQ(cplane_msg.at(13), 1);
+  EXPECT_EQ(cplane_msg.at(14), 0x91);
+  EXPECT_EQ(cplane_msg.at(19), 100);
+  EXPECT_EQ(cplane_msg.at(21), 0xFA);
+  EXPECT_EQ(cplane_msg.at(23), 5);
+}
+
+TEST(TestOranFronthaul, Timing) {
+  // 30 kHz subcarriers, and frames of 5 slots
+  OranTiming timing(1, 70);
+  const int64_t gps_ns = 1400000000123456789;
+  timing.Start(gps_ns, 1000, 2.0, 3000000);
+  // Frame 0 starts on the first radio frame 3 ms on
+  EXPECT_EQ(timing.SymbolNs(timing.FirstSymbol()), 1400000000130000000);
+  const OranSymbolId first = timing.ToOran(timing.FirstSymbol());
+  EXPECT_EQ(first.subframe_id_, 0);
+  EXPECT_EQ(first.slot_id_, 0);
+  EXPECT_EQ(first.symbol_id_, 0);
+
+  const size_t symbol = timing.AbsSymbol(3, 20);
+  size_t frame_id;
+  size_t symbol_id;
+  ASSERT_TRUE(timing.ToAgora(symbol, frame_id, symbol_id));
+  EXPECT_EQ(frame_id, 3u);
+  EXPECT_EQ(symbol_id, 20u);
+  EXPECT_FALSE(timing.ToAgora(timing.FirstSymbol() - 1, frame_id, symbol_id));
+  // 230 symbols in: slot 16 of the radio frame, and symbol 6 of it
+  const OranSymbolId id = timing.ToOran(symbol);
+  EXPECT_EQ(id.subframe_id_, 8);
+  EXPECT_EQ(id.slot_id_, 0);
+  EXPECT_EQ(id.symbol_id_, 6);
+
+  // The ids repeat every 256 radio frames, and are taken near the reference
+  const size_t period = 256 * 10 * 2 * 14;
+  EXPECT_EQ(timing.FromOran(id, symbol + 1000), symbol);
+  EXPECT_EQ(timing.FromOran(id, symbol - 1000), symbol);
+  EXPECT_EQ(timing.FromOran(id, symbol + period - 5), symbol + period);
+
+  EXPECT_NEAR(timing.SymbolTsc(timing.FirstSymbol()),
+              1000 + (2.0 * (1400000000130000000 - gps_ns)), 1.0);
+  EXPECT_EQ(timing.SymbolAt(static_cast<size_t>(timing.SymbolTsc(symbol)) + 2),
+            symbol);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,78 @@
+/**
+ * @file test_packed_iq.cc
+ * @brief Test the requantization of IQ samples to int8 and block floating
+ * point and back.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <random>
+#include <vector>
+
+#include "packed_iq.h"
+
+TEST(TestPackedIq, RoundTrip) {
+  // Not a multiple of the block, so that the last block is partial
+  static constexpr size_t kNumValues = 1000;
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<int> dist(-32768, 32767);
+  std::vector<short> iq(kNumValues);
+  for (auto& value : iq) {
+    value = static_cast<short>(dist(gen));
+  }
+  // A weak block keeps its small values in bfp
+  for (size_t i = 0; i < kPackedIqBlock; i++) {
+    iq.at(kPackedIqBlock + i) = static_cast<short>((i % 9) - 4);
+  }
+
+  for (const auto format : {IqFormat::kInt16, IqFormat::kInt8,
+                            IqFormat::kBfp}) {
+    std::vector<uint8_t> packed(PackedIqBytes(kNumValues, format));
+    PackIq(iq.data(), packed.data(), kNumValues, format);
+    std::vector<short> out(kNumValues);
+    UnpackIq(packed.data(), kNumValues, format, out.data());
+    for (size_t i = 0; i < kNumValues; i++) {
+      if (format == IqFormat::kInt16) {
+        EXPECT_EQ(out.at(i), iq.at(i)) << i;
+      } else {
+        // Within half a step of the shift of the block, which is 9 for a
+        // full scale block
+        const int shift =
+            packed.at((format == IqFormat::kInt8)
+                          ? 0
+                          : (i / kPackedIqBlock) * (kPackedIqBlock + 1));
+        EXPECT_LE(shift, 9);
+        EXPECT_NEAR(out.at(i), iq.at(i), (1 << shift) / 2 + 1)
+            << IqFormatName(format) << " " << i;
+      }
+    }
+    if (format == IqFormat::kBfp) {
+      for (size_t i = 0; i < kPackedIqBlock; i++) {
+        EXPECT_EQ(out.at(kPackedIqBlock + i), iq.at(kPackedIqBlock + i));
+      }
+    }
+  }
+  EXPECT_EQ(PackedIqBytes(kNumValues, IqFormat::kInt16), 2 * kNumValues);
+  EXPECT_EQ(PackedIqBytes(kNumValues, IqFormat::kInt8), 1 + kNumValues);
+  EXPECT_EQ(PackedIqBytes(kNumValues, IqFormat::kBfp), 32 + kNumValues);
+}
+
+TEST(TestPackedIq, FullScale) {
+  // The extremes of int16 survive, clamped where they round past it
+  std::vector<short> iq(kPackedIqBlock, 0);
+  iq.at(0) = -32768;
+  iq.at(1) = 32767;
+  iq.at(2) = 127;
+  std::vector<uint8_t> packed(PackedIqBytes(iq.size(), IqFormat::kBfp));
+  PackIq(iq.data(), packed.data(), iq.size(), IqFormat::kBfp);
+  std::vector<short> out(iq.size());
+  UnpackIq(packed.data(), iq.size(), IqFormat::kBfp, out.data());
+  EXPECT_EQ(out.at(0), -32768);
+  EXPECT_EQ(out.at(1), 32767);
+  EXPECT_NEAR(out.at(2), 127, 256);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,60 @@
+/**
+ * @file test_packed_llr.cc
+ * @brief Test the packing of LLRs to 4 and 6 bits and their unpacking.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <random>
+#include <vector>
+
+#include "packed_llr.h"
+
+TEST(TestPackedLlr, RoundTrip) {
+  static constexpr size_t kNumLlrs = 1000;
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> dist(-127, 127);
+  std::vector<int8_t> llrs(kNumLlrs);
+  for (auto& llr : llrs) {
+    llr = static_cast<int8_t>(dist(gen));
+  }
+  // A weak chunk keeps its small LLRs
+  for (size_t i = 0; i < kPackedLlrChunk; i++) {
+    llrs.at(kPackedLlrChunk + i) = static_cast<int8_t>((i % 7) - 3);
+  }
+
+  for (const size_t llr_bits : {4ul, 6ul}) {
+    std::vector<uint8_t> packed(PackedLlrBytes(kNumLlrs, llr_bits));
+    PackLlrs(llrs.data(), packed.data(), kNumLlrs, llr_bits);
+    std::vector<int8_t> out(kNumLlrs);
+    UnpackLlrs(packed.data(), 0, kNumLlrs, llr_bits, out.data());
+    // Within half a step, or the saturation at 7 or 31 steps, with the sign
+    const int tol = (llr_bits == 4) ? 15 : 3;
+    for (size_t i = 0; i < kNumLlrs; i++) {
+      EXPECT_NEAR(out.at(i), llrs.at(i), tol) << llr_bits << " " << i;
+      if (std::abs(llrs.at(i)) > tol) {
+        EXPECT_EQ(out.at(i) < 0, llrs.at(i) < 0) << llr_bits << " " << i;
+      }
+    }
+    for (size_t i = 0; i < kPackedLlrChunk; i++) {
+      EXPECT_EQ(out.at(kPackedLlrChunk + i), llrs.at(kPackedLlrChunk + i));
+    }
+
+    // From an LLR within a chunk, as the code blocks are read
+    for (const size_t first : {1ul, 17ul, 250ul}) {
+      std::vector<int8_t> part(kNumLlrs - first - 3);
+      UnpackLlrs(packed.data(), first, part.size(), llr_bits, part.data());
+      for (size_t i = 0; i < part.size(); i++) {
+        EXPECT_EQ(part.at(i), out.at(first + i)) << llr_bits << " " << first;
+      }
+    }
+  }
+  EXPECT_EQ(PackedLlrBytes(kNumLlrs, 4), 63 * 9u);
+  EXPECT_EQ(PackedLlrBytes(kNumLlrs, 6), 63 * 13u);
+  EXPECT_EQ(PackedLlrBytes(kNumLlrs, 8), kNumLlrs);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+/**
+ * @file test_page_faults.cc
+ * @brief Test the per-thread page fault counters, and that prefaulted
+ * buffers no longer fault.
+ */
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+
+#include <cstring>
+#include <thread>
+
+#include "memory_manage.h"
+#include "page_faults.h"
+
+static constexpr size_t kNumPages = 256;
+static constexpr size_t kPageSize = 4096;
+
+static std::byte* MapPages(size_t size) {
+  void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (ptr == MAP_FAILED) ? nullptr : static_cast<std::byte*>(ptr);
+}
+
+static void TouchPages(std::byte* ptr, size_t size) {
+  for (size_t offset = 0; offset < size; offset += kPageSize) {
+    ptr[offset] = std::byte{1};
+  }
+}
+
+// Faults of the registered thread named name, or zero
+static PageFaults::Counts RegisteredCounts(const std::string& name) {
+  for (const auto& thread : PageFaults::Registered()) {
+    if (thread.name_ == name) {
+      return thread.counts_;
+    }
+  }
+  return PageFaults::Counts();
+}
+
+TEST(TestPageFaults, FirstTouchFaults) {
+  PageFaults::RegisterThread("test main");
+  const size_t size = kNumPages * kPageSize;
+  std::byte* ptr = MapPages(size);
+  ASSERT_NE(ptr, nullptr);
+
+  const PageFaults::Counts before = PageFaults::ThisThread();
+  const PageFaults::Counts registered_before = RegisteredCounts("test main");
+  TouchPages(ptr, size);
+  const PageFaults::Counts after = PageFaults::ThisThread();
+  const PageFaults::Counts registered_after = RegisteredCounts("test main");
+  // Transparent hugepages can serve several pages with one fault
+  EXPECT_GT(after.minor_, before.minor_);
+  EXPECT_GT(registered_after.minor_, registered_before.minor_);
+
+  // Touching them again does not fault
+  const PageFaults::Counts again = PageFaults::ThisThread();
+  TouchPages(ptr, size);
+  EXPECT_EQ(PageFaults::ThisThread().minor_, again.minor_);
+  munmap(ptr, size);
+}
+
+TEST(TestPageFaults, OtherThreads) {
+  const size_t size = kNumPages * kPageSize;
+  std::byte* ptr = MapPages(size);
+  ASSERT_NE(ptr, nullptr);
+  PageFaults::Counts counts;
+  std::thread thread([&]() {
+    PageFaults::RegisterThread("test toucher");
+    TouchPages(ptr, size);
+    counts = PageFaults::ThisThread();
+  });
+  thread.join();
+  // The counts of a thread that exited are its last read ones, which may be
+  // from before it touched the pages
+  const PageFaults::Counts registered = RegisteredCounts("test toucher");
+  EXPECT_LE(registered.minor_, counts.minor_);
+  EXPECT_GT(counts.minor_, 0u);
+  munmap(ptr, size);
+}
+
+TEST(TestPageFaults, PrefaultedBuffersDoNotFault) {
+  // Two buffers, not multiples of the chunk size
+  const size_t size_a = (3ul << 20) + (5 * kPageSize);
+  const size_t size_b = 7 * kPageSize;
+  std::byte* a = MapPages(size_a);
+  std::byte* b = MapPages(size_b);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  std::memset(a, 0x5a, kPageSize);
+  if (Agora_memory::PrefaultParallel({{a, size_a}, {b, size_b}}, 3) ==
+      false) {
+    GTEST_SKIP() << "The kernel cannot prefault";
+  }
+  // Contents are kept
+  EXPECT_EQ(a[kPageSize - 1], std::byte{0x5a});
+  const PageFaults::Counts before = PageFaults::ThisThread();
+  TouchPages(a, size_a);
+  TouchPages(b, size_b);
+  EXPECT_EQ(PageFaults::ThisThread().minor_, before.minor_);
+  munmap(a, size_a);
+  munmap(b, size_b);
+}
@@ -0,0 +1,46 @@
+/**
+ * @file test_perf_counters.cc
+ * @brief Test the sampling and the counts of the PerfCounters of a thread.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "perf_counters.h"
+
+TEST(TestPerfCounters, SampleInterval) {
+  PerfCounters every(1);
+  for (size_t i = 0; i < 5; i++) {
+    EXPECT_TRUE(every.Sample());
+  }
+  PerfCounters one_in_three(3);
+  std::vector<bool> samples;
+  for (size_t i = 0; i < 7; i++) {
+    samples.push_back(one_in_three.Sample());
+  }
+  EXPECT_EQ(samples, std::vector<bool>({true, false, false, true, false,
+                                        false, true}));
+}
+
+TEST(TestPerfCounters, CountsIncrease) {
+  PerfCounters counters(1);
+  if (counters.Available() == false) {
+    GTEST_SKIP() << "perf_event_open is not permitted here";
+  }
+  PerfCounters::Counts start;
+  PerfCounters::Counts end;
+  counters.Read(start);
+  volatile size_t sum = 0;
+  for (size_t i = 0; i < 1000000; i++) {
+    sum = sum + i;
+  }
+  counters.Read(end);
+  const size_t cycles = static_cast<size_t>(PerfCounters::Event::kCycles);
+  EXPECT_GT(end.at(cycles), start.at(cycles));
+  if (counters.EventAvailable(PerfCounters::Event::kInstructions)) {
+    const size_t instr =
+        static_cast<size_t>(PerfCounters::Event::kInstructions);
+    // At least an add per iteration
+    EXPECT_GT(end.at(instr) - start.at(instr), 1000000u);
+  }
+}
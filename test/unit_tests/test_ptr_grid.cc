@@ -45,6 +45,57 @@ TEST(TestPtrCube, Basic) {
   ASSERT_EQ(ptr_cube.cube_[0][0][0], nullptr);
 }
 
+TEST(TestPtrCube, PartialAlloc) {
+  // Only the allocated part of the cube takes memory
+  PtrCube<kRows, kCols, kCol2s, float> ptr_cube(2, 3, 4, kNEntries);
+  ASSERT_EQ(ptr_cube.cube_.size(), 2u);
+  ASSERT_EQ(ptr_cube[1].size(), 3u);
+  ASSERT_EQ(ptr_cube[1][2].size(), 4u);
+  ASSERT_EQ(ptr_cube.SizeBytes(),
+            2 * 3 * 4 * (kNEntries * sizeof(float) + sizeof(float*)));
+
+  PtrGrid<kRows, kCols, float> ptr_grid(2, 3, kNEntries);
+  ASSERT_EQ(ptr_grid.SizeBytes(),
+            2 * 3 * (kNEntries * sizeof(float) + sizeof(float*)));
+}
+
+TEST(TestPtrGrid, MemoryPolicy) {
+  // Falls back to transparent hugepages if none are reserved
+  const Agora_memory::MemoryPolicy policy{Agora_memory::PageType::kHuge2M, 0};
+  PtrGrid<kRows, kCols, float> ptr_grid(kRows, kCols, kNEntries, policy);
+  ASSERT_NE(ptr_grid.backing_buf_, nullptr);
+  float sum = 0;
+  for (size_t i = 0; i < kRows; i++) {
+    for (size_t j = 0; j < kCols; j++) {
+      ptr_grid[i][j][kNEntries - 1] = 1.0f;
+      sum += ptr_grid[i][j][0] + ptr_grid[i][j][kNEntries - 1];
+    }
+  }
+  ASSERT_EQ(sum, kRows * kCols);
+}
+
+TEST(TestPtrGrid, Flat) {
+  // The flat views find the same cells as the pointer cells
+  PtrGrid<kRows, kCols, float> ptr_grid(3, 5, kNEntries);
+  const FlatGrid<float> flat_grid = ptr_grid.Flat();
+  for (size_t i = 0; i < 3; i++) {
+    for (size_t j = 0; j < 5; j++) {
+      ASSERT_EQ(flat_grid[i][j], ptr_grid[i][j]);
+    }
+  }
+  ASSERT_EQ(flat_grid.CellStride(), kNEntries);
+
+  PtrCube<kRows, kCols, kCol2s, float> ptr_cube(2, 3, 4, kNEntries);
+  const FlatCube<float> flat_cube = ptr_cube.Flat();
+  for (size_t i = 0; i < 2; i++) {
+    for (size_t j = 0; j < 3; j++) {
+      for (size_t k = 0; k < 4; k++) {
+        ASSERT_EQ(flat_cube[i][j][k], ptr_cube[i][j][k]);
+      }
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
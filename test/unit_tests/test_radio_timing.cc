@@ -0,0 +1,72 @@
+/**
+ * @file test_radio_timing.cc
+ * @brief Test the buckets of TimingHistogram and the per radio summaries of
+ * RadioTiming.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "radio_timing.h"
+
+TEST(TestRadioTiming, Buckets) {
+  // Every bucket holds its own middle time
+  for (size_t b = 0; b < 2 * TimingHistogram::kNumBuckets; b++) {
+    EXPECT_EQ(TimingHistogram::Bucket(TimingHistogram::BucketMidUs(b)), b);
+  }
+  // Ordered from the most negative to the most positive
+  EXPECT_LT(TimingHistogram::Bucket(-100.0), TimingHistogram::Bucket(-3.0));
+  EXPECT_LT(TimingHistogram::Bucket(-0.5), TimingHistogram::Bucket(0.5));
+  EXPECT_LT(TimingHistogram::Bucket(15.5), TimingHistogram::Bucket(16.5));
+  // Within 1/16 of the time past the linear buckets
+  for (const double us : {20.0, 300.0, 4567.0, 1e6}) {
+    const double mid =
+        TimingHistogram::BucketMidUs(TimingHistogram::Bucket(us));
+    EXPECT_LE(std::fabs(mid - us), us / 16) << us;
+  }
+  // Clamped
+  EXPECT_EQ(TimingHistogram::Bucket(1e12),
+            (2 * TimingHistogram::kNumBuckets) - 1);
+  EXPECT_EQ(TimingHistogram::Bucket(-1e12), 0u);
+}
+
+TEST(TestRadioTiming, Percentiles) {
+  TimingHistogram histogram;
+  EXPECT_EQ(histogram.Snapshot().PercentileUs(0.5), 0.0);
+  for (size_t i = 0; i < 98; i++) {
+    histogram.Record(5.2);
+  }
+  histogram.Record(-40.0);
+  histogram.Record(1000.0);
+  EXPECT_EQ(histogram.Count(), 100u);
+  const TimingHistogram::Counts counts = histogram.Snapshot();
+  EXPECT_EQ(counts.PercentileUs(0.5), 5.5);
+  EXPECT_LT(counts.PercentileUs(0.0), -32.0);
+  EXPECT_GT(counts.PercentileUs(0.999), 960.0);
+}
+
+TEST(TestRadioTiming, WorstRadio) {
+  RadioTiming timing(3);
+  for (size_t i = 0; i < 100; i++) {
+    timing.RecordRx(0, RadioTiming::RxType::kUplink, 10.0);
+    timing.RecordRx(2, RadioTiming::RxType::kUplink, 200.0);
+    timing.RecordTx(1, RadioTiming::TxType::kDownlink, 500.0);
+    timing.RecordTx(2, RadioTiming::TxType::kDownlink, 50.0);
+  }
+  const auto rx = timing.RxSummary(RadioTiming::RxType::kUplink);
+  EXPECT_EQ(rx.count_, 200u);
+  EXPECT_EQ(rx.worst_radio_, 2u);
+  EXPECT_GT(rx.worst_tail_us_, 190.0);
+  EXPECT_EQ(timing.RxSummary(RadioTiming::RxType::kPilot).count_, 0u);
+
+  // The radio with the least lead is the worst
+  const auto tx = timing.TxSummary(RadioTiming::TxType::kDownlink);
+  EXPECT_EQ(tx.count_, 200u);
+  EXPECT_EQ(tx.worst_radio_, 2u);
+  EXPECT_LT(tx.tail_us_, 60.0);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
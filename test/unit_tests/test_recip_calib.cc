@@ -0,0 +1,92 @@
+/**
+ * @file test_recip_calib.cc
+ * @brief Test the reciprocity calibration kernels against std::complex
+ * arithmetic.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "recip_calib.h"
+
+using Cx = std::complex<float>;
+
+// Not a multiple of 8, to cover the partial register of the kernels
+static constexpr size_t kNumScs = 301;
+
+static std::vector<complex_float> RandomVec(size_t len, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<complex_float> vec(len);
+  for (auto& v : vec) {
+    v = {dist(gen), dist(gen)};
+  }
+  return vec;
+}
+
+static Cx ToCx(const complex_float& v) { return {v.re, v.im}; }
+
+TEST(TestRecipCalib, UpdateMovingSum) {
+  const auto prev = RandomVec(kNumScs, 1);
+  const auto newest = RandomVec(kNumScs, 2);
+  const auto oldest = RandomVec(kNumScs, 3);
+  for (const size_t len : {kNumScs, size_t{1}, size_t{8}}) {
+    std::vector<complex_float> msum(len + 1, complex_float{7.0f, 7.0f});
+    RecipCalib::UpdateMovingSum(prev.data(), newest.data(), oldest.data(),
+                                msum.data(), len);
+    for (size_t i = 0; i < len; i++) {
+      const Cx ref = ToCx(prev[i]) + (ToCx(newest[i]) - ToCx(oldest[i]));
+      ASSERT_EQ(ToCx(msum[i]), ref) << "subcarrier " << i << " of " << len;
+    }
+    EXPECT_EQ(msum[len].re, 7.0f);
+  }
+}
+
+TEST(TestRecipCalib, Ratio) {
+  const auto num = RandomVec(kNumScs, 4);
+  const auto den = RandomVec(kNumScs, 5);
+  for (const size_t stride : {size_t{1}, size_t{3}}) {
+    for (const size_t len : {kNumScs, size_t{1}, size_t{8}}) {
+      // Each output slot followed by stride - 1 guard points
+      std::vector<complex_float> out((len + 1) * stride,
+                                     complex_float{7.0f, 7.0f});
+      RecipCalib::Ratio(num.data(), den.data(), out.data(), len, stride);
+      for (size_t i = 0; i < out.size(); i++) {
+        if ((i % stride != 0) || (i / stride >= len)) {
+          ASSERT_EQ(out[i].re, 7.0f) << "guard " << i;
+          continue;
+        }
+        const Cx ref = ToCx(num[i / stride]) / ToCx(den[i / stride]);
+        ASSERT_LE(std::abs(ToCx(out[i]) - ref), 1e-5f * (1 + std::abs(ref)))
+            << "subcarrier " << i / stride << " of " << len;
+      }
+    }
+  }
+}
+
+TEST(TestRecipCalib, RegressPhase) {
+  // A linear phase with a constant magnitude is reproduced exactly
+  static constexpr size_t kX0 = 100;
+  static constexpr float kSlope = 0.001f;
+  static constexpr float kIntercept = -0.4f;
+  static constexpr float kMag = 2.5f;
+  std::vector<complex_float> in(kNumScs);
+  for (size_t i = 0; i < kNumScs; i++) {
+    const Cx v = std::polar(kMag, kSlope * (kX0 + i) + kIntercept);
+    in[i] = {v.real(), v.imag()};
+  }
+  std::vector<complex_float> out(kX0 + kNumScs + 50);
+  RecipCalib::RegressPhase(in.data(), in.size(), kX0, out.data(), out.size());
+  for (size_t i = 0; i < out.size(); i++) {
+    const Cx ref = std::polar(kMag, kSlope * i + kIntercept);
+    ASSERT_LE(std::abs(ToCx(out[i]) - ref), 1e-4f) << "subcarrier " << i;
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
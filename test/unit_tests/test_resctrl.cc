@@ -0,0 +1,82 @@
+/**
+ * @file test_resctrl.cc
+ * @brief Test the resctrl groups of the thread classes on a directory that
+ * stands in for the resctrl file system.
+ */
+#include <gtest/gtest.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "resctrl.h"
+
+static std::string ReadAll(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+// A resctrl root with two cache and memory domains
+class TestResctrl : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    root_ = std::filesystem::temp_directory_path() /
+            ("test_resctrl_" + std::to_string(getpid()));
+    std::filesystem::create_directories(root_);
+    std::ofstream(root_ / "schemata") << "    L3:0=7ff;1=7ff\n"
+                                      << "    MB:0=100;1=100\n";
+  }
+  void TearDown() override {
+    Resctrl::Teardown();
+    std::filesystem::remove_all(root_);
+  }
+
+  std::filesystem::path root_;
+};
+
+TEST_F(TestResctrl, GroupsAndThreads) {
+  std::map<std::string, Resctrl::ClassAllocation> classes;
+  classes["txrx"].l3_mask_ = "0x00f";
+  classes["txrx"].mba_percent_ = 50;
+  classes["worker_decode"].l3_mask_ = "7f0";
+  ASSERT_TRUE(Resctrl::Setup(classes, root_.string()));
+
+  EXPECT_EQ(ReadAll(root_ / "agora_txrx" / "schemata"),
+            "L3:0=00f;1=00f\nMB:0=50;1=50\n");
+  EXPECT_EQ(ReadAll(root_ / "agora_worker_decode" / "schemata"),
+            "L3:0=7f0;1=7f0\n");
+  EXPECT_TRUE(Resctrl::HasClass("txrx"));
+  EXPECT_FALSE(Resctrl::HasClass("mac"));
+
+  Resctrl::AssignThread(Resctrl::ClassOf(ThreadType::kWorkerTXRX));
+  EXPECT_EQ(ReadAll(root_ / "agora_txrx" / "tasks"),
+            std::to_string(syscall(SYS_gettid)) + "\n");
+  // No group for the master, so the thread stays where it is
+  Resctrl::AssignThread(Resctrl::ClassOf(ThreadType::kMaster));
+  EXPECT_FALSE(std::filesystem::exists(root_ / "agora_master"));
+}
+
+TEST_F(TestResctrl, Unsupported) {
+  // Not mounted
+  std::map<std::string, Resctrl::ClassAllocation> classes;
+  classes["worker"].l3_mask_ = "0ff";
+  EXPECT_FALSE(Resctrl::Setup(classes, (root_ / "missing").string()));
+
+  // No memory bandwidth allocation on this system
+  std::ofstream(root_ / "schemata") << "L3:0=7ff\n";
+  classes["worker"].mba_percent_ = 30;
+  EXPECT_FALSE(Resctrl::Setup(classes, root_.string()));
+  EXPECT_FALSE(Resctrl::HasClass("worker"));
+}
+
+TEST(TestResctrlClasses, ClassOf) {
+  EXPECT_EQ(Resctrl::ClassOf(ThreadType::kMasterRX), "master");
+  EXPECT_EQ(Resctrl::ClassOf(ThreadType::kWorkerTXRX), "txrx");
+  EXPECT_EQ(Resctrl::ClassOf(ThreadType::kWorker), "worker");
+  EXPECT_EQ(Resctrl::ClassOf(ThreadType::kWorkerMacTXRX), "mac");
+  EXPECT_EQ(Resctrl::ClassOf(ThreadType::kRecorderWorker), "recorder");
+}
@@ -0,0 +1,106 @@
+/**
+ * @file test_rx_frame_tracker.cc
+ * @brief Test the timeout, the missing packets and the late packets of the
+ * frames tracked by RxFrameTracker.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "rx_frame_tracker.h"
+
+static constexpr size_t kFrameWindow = 4;
+static constexpr size_t kNumAntennas = 2;
+static constexpr size_t kTimeout = 100;
+// A pilot, a calibration and an uplink symbol, with one calibration packet
+// per frame
+static const std::vector<bool> kFillSymbols = {true, false, true};
+static constexpr size_t kCalSymbol = 1;
+
+using RxStatus = RxFrameTracker::RxStatus;
+
+// Receive all the packets of frame_id at tsc
+static void ReceiveFrame(RxFrameTracker& tracker, size_t frame_id,
+                         size_t tsc) {
+  for (const size_t symbol_id : {size_t{0}, size_t{2}}) {
+    for (size_t ant_id = 0; ant_id < kNumAntennas; ant_id++) {
+      EXPECT_EQ(tracker.Receive(frame_id, symbol_id, ant_id, tsc),
+                RxStatus::kNew);
+    }
+  }
+  EXPECT_EQ(tracker.Receive(frame_id, kCalSymbol, 0, tsc), RxStatus::kNew);
+}
+
+TEST(TestRxFrameTracker, CompleteFrames) {
+  RxFrameTracker tracker(kFrameWindow, kFillSymbols, kNumAntennas, 1,
+                         kTimeout);
+  EXPECT_FALSE(tracker.Expired(1000));
+  ReceiveFrame(tracker, 0, 10);
+  EXPECT_EQ(tracker.OpenFrame(), 1u);
+  // Frame 2 is complete before frame 1
+  ReceiveFrame(tracker, 2, 20);
+  EXPECT_EQ(tracker.OpenFrame(), 1u);
+  ReceiveFrame(tracker, 1, 30);
+  EXPECT_EQ(tracker.OpenFrame(), 3u);
+  EXPECT_FALSE(tracker.Expired(1000));
+  EXPECT_EQ(tracker.Receive(2, 0, 0, 40), RxStatus::kLate);
+  EXPECT_EQ(tracker.PartialFrames(), 0u);
+  EXPECT_EQ(tracker.LatePackets(), 1u);
+}
+
+TEST(TestRxFrameTracker, TimeoutFillsMissing) {
+  RxFrameTracker tracker(kFrameWindow, kFillSymbols, kNumAntennas, 1,
+                         kTimeout);
+  EXPECT_EQ(tracker.Receive(0, 0, 0, 10), RxStatus::kNew);
+  EXPECT_EQ(tracker.Receive(0, 0, 1, 20), RxStatus::kNew);
+  EXPECT_EQ(tracker.Receive(0, 2, 1, 30), RxStatus::kNew);
+  EXPECT_EQ(tracker.Receive(0, 2, 1, 40), RxStatus::kDuplicate);
+  // The timeout runs from the first packet of the frame
+  EXPECT_FALSE(tracker.Expired(10 + kTimeout - 1));
+  EXPECT_TRUE(tracker.Expired(10 + kTimeout));
+
+  std::vector<RxFrameTracker::MissingPacket> missing;
+  EXPECT_EQ(tracker.CloseOpenFrame(10 + kTimeout, missing), 1u);
+  ASSERT_EQ(missing.size(), 1u);
+  EXPECT_EQ(missing.at(0).symbol_id_, 2u);
+  EXPECT_EQ(missing.at(0).ant_id_, 0u);
+  EXPECT_EQ(tracker.OpenFrame(), 1u);
+  EXPECT_FALSE(tracker.Expired(1000));
+  EXPECT_EQ(tracker.Receive(0, 2, 0, 200), RxStatus::kLate);
+
+  // The slot of frame 0 is clear for frame kFrameWindow
+  for (size_t frame_id = 1; frame_id <= kFrameWindow; frame_id++) {
+    ReceiveFrame(tracker, frame_id, 300);
+  }
+  EXPECT_EQ(tracker.OpenFrame(), kFrameWindow + 1);
+  EXPECT_EQ(tracker.PartialFrames(), 1u);
+  EXPECT_EQ(tracker.LostPackets(), 2u);
+  EXPECT_EQ(tracker.LatePackets(), 1u);
+  EXPECT_EQ(tracker.DuplicatePackets(), 1u);
+}
+
+TEST(TestRxFrameTracker, LostFrame) {
+  RxFrameTracker tracker(kFrameWindow, kFillSymbols, kNumAntennas, 1,
+                         kTimeout);
+  ReceiveFrame(tracker, 0, 10);
+  // Frame 1 gets no packet, frame 2 starts its timeout
+  EXPECT_FALSE(tracker.Expired(1000));
+  EXPECT_EQ(tracker.Receive(2, 0, 0, 500), RxStatus::kNew);
+  EXPECT_TRUE(tracker.Expired(500 + kTimeout));
+
+  std::vector<RxFrameTracker::MissingPacket> missing;
+  EXPECT_EQ(tracker.CloseOpenFrame(500 + kTimeout, missing), 1u);
+  EXPECT_EQ(missing.size(), 2 * kNumAntennas);
+  // Frame 2 timed out from its own first packet
+  EXPECT_EQ(tracker.OpenFrame(), 2u);
+  EXPECT_TRUE(tracker.Expired(500 + kTimeout));
+  missing.clear();
+  EXPECT_EQ(tracker.CloseOpenFrame(500 + kTimeout, missing), 1u);
+  EXPECT_EQ(missing.size(), (2 * kNumAntennas) - 1);
+  EXPECT_FALSE(tracker.Expired(10000));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -159,6 +159,50 @@ TEST(WLAN_Scrambler, random_input_scramble_descramble) {
   std::free(byte_buffer_orig);
 }
 
+/**
+ * @brief  Bit-serial reference of the scrambler
+ *
+ * Bit i of the data, MSB first in each byte, is xor-ed with bit i % 127 of
+ * the x7 + x4 + 1 sequence from the initial state.
+ */
+static void ReferenceScramble(uint8_t* data, size_t num_bytes) {
+  uint8_t state = AgoraScrambler::kScramblerInitState;
+  uint8_t sequence[AgoraScrambler::kScramblerlength];
+  for (size_t i = 0; i < AgoraScrambler::kScramblerlength; i++) {
+    const uint8_t bit = (state ^ (state >> 3)) & 0x1;
+    sequence[i] = bit;
+    state = (state >> 1) | (bit << 6);
+  }
+  for (size_t i = 0; i < num_bytes * 8; i++) {
+    const uint8_t bit = sequence[i % AgoraScrambler::kScramblerlength];
+    data[i / 8] ^= bit << (7 - (i % 8));
+  }
+}
+
+/**
+ * @brief  long_input_bit_serial_reference
+ *
+ * Random inputs of sizes that cover the SIMD blocks, the tails and several
+ * periods of the sequence are scrambled as the bit-serial reference does.
+ */
+TEST(WLAN_Scrambler, long_input_bit_serial_reference) {
+  auto scrambler = std::make_unique<AgoraScrambler::Scrambler>();
+  for (size_t num_bytes : {1, 31, 33, 64, 127, 128, 200, 1000, 8191}) {
+    std::vector<uint8_t> input(num_bytes);
+    for (auto& byte : input) {
+      byte = rand() % 256;
+    }
+    std::vector<uint8_t> expect = input;
+    ReferenceScramble(expect.data(), num_bytes);
+
+    std::vector<uint8_t> output(num_bytes);
+    scrambler->Scramble(output.data(), input.data(), num_bytes);
+    for (size_t i = 0; i < num_bytes; i++) {
+      ASSERT_EQ(output[i], expect[i]) << "size " << num_bytes << " byte " << i;
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,135 @@
+/**
+ * @file test_shared_counters.cc
+ * @brief Test that exactly one worker completes each symbol of the shared
+ * task counters.
+ */
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "message.h"
+#include "shared_counters.h"
+
+TEST(TestSharedCounters, LastTask) {
+  SharedTaskCounters counters(3);
+  EXPECT_FALSE(counters.CompleteTasks(0, 1, 1));
+  EXPECT_FALSE(counters.CompleteTasks(0, 2, 2));
+  EXPECT_TRUE(counters.CompleteTasks(0, 1, 2));
+  EXPECT_TRUE(counters.CompleteTasks(0, 2, 1));
+  // The count is reset for the next frame in the same slot
+  EXPECT_FALSE(counters.CompleteTasks(kFrameWnd, 1, 2));
+  EXPECT_TRUE(counters.CompleteTasks(kFrameWnd, 1, 1));
+}
+
+TEST(TestSharedCounters, PerFrame) {
+  SharedTaskCounters counters(2);
+  EXPECT_FALSE(counters.CompleteTasks(5, gen_tag_t::kInvalidSymbolId, 1));
+  EXPECT_TRUE(counters.CompleteTasks(5, gen_tag_t::kInvalidSymbolId, 1));
+}
+
+TEST(TestSharedCounters, ThreadedOneLast) {
+  static constexpr size_t kNumWorkers = 4;
+  // The master never has more than kFrameWnd frames in flight
+  static constexpr size_t kNumFrames = kFrameWnd;
+  static constexpr size_t kNumSymbols = 8;
+  static constexpr size_t kTasksPerWorker = 64;
+  SharedTaskCounters counters(kNumWorkers * kTasksPerWorker);
+  std::vector<std::atomic<size_t>> num_last(kNumFrames * kNumSymbols);
+
+  std::vector<std::thread> workers;
+  for (size_t tid = 0; tid < kNumWorkers; tid++) {
+    workers.emplace_back([&]() {
+      for (size_t frame_id = 0; frame_id < kNumFrames; frame_id++) {
+        for (size_t symbol_id = 0; symbol_id < kNumSymbols; symbol_id++) {
+          for (size_t i = 0; i < kTasksPerWorker; i++) {
+            if (counters.CompleteTasks(frame_id, symbol_id, 1)) {
+              num_last.at(frame_id * kNumSymbols + symbol_id)++;
+            }
+          }
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (size_t i = 0; i < num_last.size(); i++) {
+    EXPECT_EQ(num_last.at(i).load(), 1u) << "symbol " << i;
+  }
+}
+
+TEST(TestRxCounters, Events) {
+  RxCounters counters;
+  // 2 pilot, 1 reciprocity and 1 other packet per frame
+  counters.Init(2, 1, 4);
+  EXPECT_EQ(counters.CountPacket(3, RxPacketKind::kPilot), kRxFirstPacket);
+  EXPECT_EQ(counters.CountPacket(3, RxPacketKind::kOther), 0u);
+  EXPECT_EQ(counters.CountPacket(3, RxPacketKind::kReciprocity),
+            kRxReciprocityDone);
+  EXPECT_FALSE(counters.FrameReceived(3));
+  EXPECT_EQ(counters.CountPacket(3, RxPacketKind::kPilot),
+            kRxPilotsDone | kRxFrameDone);
+  EXPECT_TRUE(counters.FrameReceived(3));
+  // The counts are reset for the next frame in the same slot
+  EXPECT_EQ(counters.CountPacket(3 + kFrameWnd, RxPacketKind::kOther),
+            kRxFirstPacket);
+  EXPECT_FALSE(counters.FrameReceived(3 + kFrameWnd));
+}
+
+TEST(TestRxCounters, ThreadedOneEach) {
+  static constexpr size_t kNumWorkers = 4;
+  static constexpr size_t kNumFrames = kFrameWnd;
+  static constexpr size_t kPilotsPerWorker = 8;
+  static constexpr size_t kOthersPerWorker = 32;
+  RxCounters counters;
+  counters.Init(kNumWorkers * kPilotsPerWorker, 0,
+                kNumWorkers * (kPilotsPerWorker + kOthersPerWorker));
+  std::vector<std::atomic<uint32_t>> events(kNumFrames);
+  // Written by each worker before it counts its packets of a frame
+  std::vector<std::array<std::atomic<size_t>, kNumWorkers>> written(
+      kNumFrames);
+
+  std::vector<std::thread> workers;
+  for (size_t tid = 0; tid < kNumWorkers; tid++) {
+    workers.emplace_back([&, tid]() {
+      for (size_t frame_id = 0; frame_id < kNumFrames; frame_id++) {
+        written.at(frame_id).at(tid).store(frame_id + 1,
+                                           std::memory_order_relaxed);
+        for (size_t i = 0; i < kPilotsPerWorker + kOthersPerWorker; i++) {
+          const RxPacketKind kind = (i < kPilotsPerWorker)
+                                        ? RxPacketKind::kPilot
+                                        : RxPacketKind::kOther;
+          const uint32_t frame_events = counters.CountPacket(frame_id, kind);
+          // Each event goes to one caller only
+          EXPECT_EQ(events.at(frame_id).fetch_or(frame_events) & frame_events,
+                    0u);
+        }
+      }
+    });
+  }
+  // The frames are received without a message from the workers
+  for (size_t frame_id = 0; frame_id < kNumFrames; frame_id++) {
+    while (counters.FrameReceived(frame_id) == false) {
+    }
+    for (size_t tid = 0; tid < kNumWorkers; tid++) {
+      EXPECT_EQ(written.at(frame_id).at(tid).load(std::memory_order_relaxed),
+                frame_id + 1);
+    }
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (size_t frame_id = 0; frame_id < kNumFrames; frame_id++) {
+    EXPECT_EQ(events.at(frame_id).load(),
+              kRxFirstPacket | kRxPilotsDone | kRxFrameDone)
+        << "frame " << frame_id;
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
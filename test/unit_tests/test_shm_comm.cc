@@ -0,0 +1,85 @@
+/**
+ * @file test_shm_comm.cc
+ * @brief Test the shared-memory packet link between two endpoints.
+ */
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "shm_comm.h"
+
+static constexpr size_t kSlotBytes = 256;
+static constexpr size_t kNumPackets = 10000;
+
+TEST(TestShmComm, DropsUntilPeerExists) {
+  auto first = std::make_unique<ShmComm>(41000, 41001, kSlotBytes, 4, false);
+  std::array<std::byte, kSlotBytes> pkt{};
+  // Nobody receives on 41001 yet
+  first->Send(pkt.data(), pkt.size());
+  EXPECT_EQ(first->TxDrops(), 1u);
+
+  ShmComm second(41001, 41000, kSlotBytes, 4, false);
+  std::array<std::byte, kSlotBytes> rx{};
+  EXPECT_EQ(second.Recv(rx.data(), rx.size()), 0);
+  pkt.fill(std::byte{7});
+  first->Send(pkt.data(), 100);
+  EXPECT_EQ(second.Recv(rx.data(), rx.size()), 100);
+  EXPECT_EQ(rx.at(99), std::byte{7});
+
+  // The ring holds 4 packets, the rest are dropped
+  for (size_t i = 0; i < 6; i++) {
+    first->Send(pkt.data(), pkt.size());
+  }
+  EXPECT_EQ(first->TxDrops(), 3u);
+  std::vector<std::vector<std::byte>> bufs(8, std::vector<std::byte>(64));
+  std::vector<std::byte*> buf_ptrs;
+  for (auto& buf : bufs) {
+    buf_ptrs.push_back(buf.data());
+  }
+  std::array<size_t, 8> lens{};
+  // Truncated to the buffers
+  EXPECT_EQ(second.RecvBatch(buf_ptrs.data(), 64, lens.data(), 8), 4);
+  EXPECT_EQ(lens.at(3), 64u);
+  EXPECT_EQ(second.RecvBatch(buf_ptrs.data(), 64, lens.data(), 8), 0);
+}
+
+TEST(TestShmComm, BothDirections) {
+  ShmComm left(41002, 41003, kSlotBytes, 64, false);
+  ShmComm right(41003, 41002, kSlotBytes, 64, false);
+
+  std::thread sender([&left]() {
+    std::array<std::byte, kSlotBytes> pkt{};
+    for (size_t i = 0; i < kNumPackets;) {
+      const size_t drops = left.TxDrops();
+      std::memcpy(pkt.data(), &i, sizeof(i));
+      left.Send(pkt.data(), sizeof(i));
+      if (left.TxDrops() == drops) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  std::array<std::byte, kSlotBytes> rx{};
+  for (size_t i = 0; i < kNumPackets;) {
+    if (right.Recv(rx.data(), rx.size()) > 0) {
+      size_t value;
+      std::memcpy(&value, rx.data(), sizeof(value));
+      ASSERT_EQ(value, i);
+      i++;
+    }
+  }
+  sender.join();
+
+  // And back
+  right.Send(rx.data(), 10);
+  EXPECT_EQ(left.Recv(rx.data(), rx.size()), 10);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
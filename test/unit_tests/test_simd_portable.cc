@@ -0,0 +1,168 @@
+/**
+ * @file test_simd_portable.cc
+ * @brief Test the portable SIMD helpers of simd_portable.h against
+ * std::complex, and the portable type conversions and soft demodulators
+ * against the x86 kernels they stand in for.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <complex>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "datatype_conversion.h"
+#include "memory_manage.h"
+#include "modulation.h"
+#include "simd_portable.h"
+
+using PortableSimd::F32x4;
+using CxFloat = std::complex<float>;
+
+static constexpr size_t kNumSymbols = 1024;
+// Odd, to cover the zero padded last symbol of the portable demodulators
+static constexpr size_t kNumTailSymbols = 1021;
+static constexpr float kAllowedError = 1e-5;
+
+static std::mt19937 rng(3);
+
+static F32x4 RandomVector() {
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  return F32x4{dist(rng), dist(rng), dist(rng), dist(rng)};
+}
+
+static CxFloat Cx(F32x4 v, size_t i) { return {v[2 * i], v[2 * i + 1]}; }
+
+TEST(TestSimdPortable, ComplexHelpers) {
+  for (size_t iter = 0; iter < 100; iter++) {
+    const F32x4 a = RandomVector();
+    const F32x4 b = RandomVector();
+    const F32x4 mult = PortableSimd::ComplexCf32Mult(a, b);
+    const F32x4 mult_conj = PortableSimd::ComplexCf32MultConj(a, b);
+    const F32x4 recip = PortableSimd::ComplexCf32Reciprocal(a);
+    for (size_t i = 0; i < PortableSimd::kCxPerVec; i++) {
+      EXPECT_LT(std::abs(Cx(mult, i) - Cx(a, i) * Cx(b, i)), kAllowedError);
+      EXPECT_LT(std::abs(Cx(mult_conj, i) - Cx(a, i) * std::conj(Cx(b, i))),
+                kAllowedError);
+      EXPECT_LT(std::abs(Cx(recip, i) * Cx(a, i) - 1.0f), 1e-4);
+    }
+    EXPECT_LT(std::abs(PortableSimd::ComplexCf32Sum(a) - (Cx(a, 0) + Cx(a, 1))),
+              kAllowedError);
+  }
+
+  EXPECT_FALSE(PortableSimd::ComplexCf32NearZeros(
+      F32x4{1.0f, 0.0f, 0.0f, -1.0f}, 0.5f));
+  EXPECT_TRUE(PortableSimd::ComplexCf32NearZeros(
+      F32x4{1.0f, 0.0f, 0.3f, 0.3f}, 0.5f));
+}
+
+TEST(TestSimdPortable, ShortToFloat) {
+  std::vector<short> in(kNumSymbols);
+  std::uniform_int_distribution<int> dist(SHRT_MIN, SHRT_MAX);
+  for (auto& v : in) {
+    v = static_cast<short>(dist(rng));
+  }
+  std::vector<float> out(kNumSymbols);
+  std::vector<float> ref(kNumSymbols);
+  SimdConvertShortToFloatPortable(in.data(), out.data(), kNumSymbols);
+  ConvertShortToFloat(in.data(), ref.data(), kNumSymbols);
+  EXPECT_EQ(out, ref);
+}
+
+TEST(TestSimdPortable, FloatToShort) {
+  static constexpr size_t kPrefix = 64;
+  float* in;
+  short* out;
+  short* ref;
+  AllocBuffer1d(&in, kNumSymbols, Agora_memory::Alignment_t::kAlign64, 1);
+  AllocBuffer1d(&out, kNumSymbols + kPrefix,
+                Agora_memory::Alignment_t::kAlign64, 1);
+  AllocBuffer1d(&ref, kNumSymbols + kPrefix,
+                Agora_memory::Alignment_t::kAlign64, 1);
+  // A few values saturate
+  std::normal_distribution<float> dist(0.0f, 0.5f);
+  for (size_t i = 0; i < kNumSymbols; i++) {
+    in[i] = dist(rng);
+  }
+
+  SimdConvertFloatToShortPortable(in, out, kNumSymbols, kPrefix, 2.0f);
+  for (size_t i = 0; i < kNumSymbols; i++) {
+    const float scaled = std::min(
+        std::max(std::rint(in[i] * kShrtFltConvFactor / 2.0f), -32768.0f),
+        32767.0f);
+    ASSERT_EQ(out[i + kPrefix], static_cast<short>(scaled)) << i;
+  }
+  EXPECT_EQ(std::memcmp(out, out + kNumSymbols, kPrefix * sizeof(short)), 0);
+
+  // The same as the x86 kernels
+  SimdConvertFloatToShort(in, ref, kNumSymbols, kPrefix, 2.0f);
+  EXPECT_EQ(
+      std::memcmp(out, ref, (kNumSymbols + kPrefix) * sizeof(short)), 0);
+
+  FreeBuffer1d(&in);
+  FreeBuffer1d(&out);
+  FreeBuffer1d(&ref);
+}
+
+#if defined(__AVX2__)
+using SoftDemodFunc = void (*)(const float*, int8_t*, int);
+
+static void CompareSoft(SoftDemodFunc ref_func, SoftDemodFunc func,
+                        size_t mod_order) {
+  float* symbols;
+  int8_t* out;
+  int8_t* ref;
+  AllocBuffer1d(&symbols, 2 * kNumSymbols,
+                Agora_memory::Alignment_t::kAlign64, 1);
+  AllocBuffer1d(&out, kMaxModType * kNumSymbols,
+                Agora_memory::Alignment_t::kAlign64, 1);
+  AllocBuffer1d(&ref, kMaxModType * kNumSymbols,
+                Agora_memory::Alignment_t::kAlign64, 1);
+  // Mostly inside the constellation, with a few saturating values
+  std::normal_distribution<float> dist(0.0f, 0.6f);
+  for (size_t i = 0; i < 2 * kNumSymbols; i++) {
+    symbols[i] = dist(rng);
+  }
+  symbols[0] = 5.0f;
+  symbols[1] = -5.0f;
+
+  ref_func(symbols, ref, kNumSymbols);
+  func(symbols, out, kNumSymbols);
+  EXPECT_EQ(std::memcmp(out, ref, mod_order * kNumSymbols), 0);
+
+  std::memset(out, 0x55, kMaxModType * kNumSymbols);
+  func(symbols, out, kNumTailSymbols);
+  EXPECT_EQ(std::memcmp(out, ref, mod_order * kNumTailSymbols), 0);
+  EXPECT_EQ(out[mod_order * kNumTailSymbols], 0x55);
+
+  FreeBuffer1d(&symbols);
+  FreeBuffer1d(&out);
+  FreeBuffer1d(&ref);
+}
+
+TEST(TestSimdPortable, SoftDemod) {
+  CompareSoft(
+      [](const float* in, int8_t* llr, int num) {
+        DemodQpskSoftSse(const_cast<float*>(in), llr, 2 * num);
+      },
+      DemodQpskSoftPortable, 2);
+  CompareSoft(
+      [](const float* in, int8_t* llr, int num) {
+        Demod16qamSoftAvx2(const_cast<float*>(in), llr, num);
+      },
+      Demod16qamSoftPortable, 4);
+  CompareSoft(
+      [](const float* in, int8_t* llr, int num) {
+        Demod64qamSoftAvx2(const_cast<float*>(in), llr, num);
+      },
+      Demod64qamSoftPortable, 6);
+  CompareSoft(Demod256qamSoftAvx2, Demod256qamSoftPortable, 8);
+  CompareSoft(Demod1024qamSoftLoop, Demod1024qamSoftPortable, 10);
+}
+#endif
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,202 @@
+/**
+ * @file test_small_mimo_kernels.cc
+ * @brief Test the small-MIMO kernels of every instruction set this CPU runs
+ * against straightforward complex arithmetic.
+ */
+
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <algorithm>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "small_mimo_kernels.h"
+#include "tile_layout.h"
+
+using CxFloat = std::complex<float>;
+
+static constexpr size_t kNumScs = 64;
+static constexpr float kAllowedError = 1e-4;
+
+static std::mt19937 rng(7);
+
+static std::vector<complex_float> RandomVector(size_t size) {
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<complex_float> v(size);
+  for (auto& x : v) {
+    x = {dist(rng), dist(rng)};
+  }
+  return v;
+}
+
+static CxFloat Cx(const complex_float& v) { return {v.re, v.im}; }
+
+static std::vector<SmallMimo::Isa> RunnableIsas() {
+  std::vector<SmallMimo::Isa> isas;
+  for (SmallMimo::Isa isa :
+       {SmallMimo::Isa::kScalar, SmallMimo::Isa::kPortable,
+        SmallMimo::Isa::kAvx2, SmallMimo::Isa::kAvx512}) {
+    if (SmallMimo::ForIsa(isa) != nullptr) {
+      isas.push_back(isa);
+    }
+  }
+  return isas;
+}
+
+static void TestInvert(const SmallMimo::Kernels& kernels, size_t dim) {
+  std::vector<std::vector<complex_float>> csi(dim);
+  std::vector<const complex_float*> csi_ptrs(dim);
+  for (size_t ue = 0; ue < dim; ue++) {
+    csi.at(ue) = RandomVector(dim * kNumScs);
+    csi_ptrs.at(ue) = csi.at(ue).data();
+  }
+  std::vector<complex_float> beam(dim * dim * kNumScs);
+  ASSERT_TRUE(kernels.invert_[SmallMimo::DimIndex(dim)](
+      csi_ptrs.data(), SmallMimo::TileChunks(dim, kNumScs), beam.data(),
+      kNumScs));
+
+  // beam * H = I
+  for (size_t sc = 0; sc < kNumScs; sc++) {
+    for (size_t i = 0; i < dim; i++) {
+      for (size_t j = 0; j < dim; j++) {
+        CxFloat sum = 0;
+        for (size_t k = 0; k < dim; k++) {
+          sum += Cx(beam.at((i * dim + k) * kNumScs + sc)) *
+                 Cx(csi.at(j).at(TileLayout::Index(sc, k, dim, kNumScs)));
+        }
+        EXPECT_LT(std::abs(sum - CxFloat(i == j ? 1.0f : 0.0f)), 1e-3)
+            << SmallMimo::IsaName(kernels.isa_) << " " << dim << "x" << dim
+            << " subcarrier " << sc;
+      }
+    }
+  }
+
+  // A zero channel must be reported
+  for (auto& c : csi) {
+    std::fill(c.begin(), c.end(), complex_float{0.0f, 0.0f});
+  }
+  EXPECT_FALSE(kernels.invert_[SmallMimo::DimIndex(dim)](
+      csi_ptrs.data(), SmallMimo::TileChunks(dim, kNumScs), beam.data(),
+      kNumScs));
+}
+
+static void TestEqualize(const SmallMimo::Kernels& kernels, size_t dim) {
+  const std::vector<complex_float> beam = RandomVector(dim * dim * kNumScs);
+  const std::vector<complex_float> data = RandomVector(dim * kNumScs);
+  std::vector<std::vector<complex_float>> equal(
+      dim, std::vector<complex_float>(kNumScs));
+  std::vector<complex_float*> equal_ptrs(dim);
+  for (size_t i = 0; i < dim; i++) {
+    equal_ptrs.at(i) = equal.at(i).data();
+  }
+  kernels.equalize_[SmallMimo::DimIndex(dim)](
+      beam.data(), data.data(), SmallMimo::TileChunks(dim, kNumScs),
+      equal_ptrs.data(), kNumScs);
+
+  for (size_t sc = 0; sc < kNumScs; sc++) {
+    for (size_t i = 0; i < dim; i++) {
+      CxFloat expected = 0;
+      for (size_t j = 0; j < dim; j++) {
+        expected += Cx(beam.at((i * dim + j) * kNumScs + sc)) *
+                    Cx(data.at(TileLayout::Index(sc, j, dim, kNumScs)));
+      }
+      EXPECT_LT(std::abs(Cx(equal.at(i).at(sc)) - expected), kAllowedError)
+          << SmallMimo::IsaName(kernels.isa_) << " " << dim << "x" << dim
+          << " subcarrier " << sc;
+    }
+  }
+}
+
+static void TestEqualizeGroup(const SmallMimo::Kernels& kernels) {
+  const std::vector<complex_float> data = RandomVector(kNumScs);
+  const complex_float beam = {0.3f, -1.2f};
+  // A group shorter than a vector, and one with a tail
+  for (size_t num_scs : {size_t{3}, kNumScs - 5}) {
+    std::vector<complex_float> equal(kNumScs, complex_float{0, 0});
+    kernels.equalize_group_(beam, data.data(), equal.data(), num_scs);
+    for (size_t sc = 0; sc < kNumScs; sc++) {
+      const CxFloat expected =
+          sc < num_scs ? Cx(beam) * Cx(data.at(sc)) : CxFloat(0);
+      EXPECT_LT(std::abs(Cx(equal.at(sc)) - expected), kAllowedError)
+          << SmallMimo::IsaName(kernels.isa_) << " subcarrier " << sc;
+    }
+  }
+}
+
+static void TestPhase(const SmallMimo::Kernels& kernels) {
+  std::vector<complex_float> equal = RandomVector(kNumScs);
+  const std::vector<complex_float> pilot = RandomVector(kNumScs);
+
+  CxFloat expected = 0;
+  for (size_t sc = 0; sc < kNumScs; sc++) {
+    expected += Cx(equal.at(sc)) * std::conj(Cx(pilot.at(sc)));
+  }
+  const CxFloat corr =
+      Cx(kernels.pilot_corr_(equal.data(), pilot.data(), kNumScs));
+  EXPECT_LT(std::abs(corr - expected), 1e-3);
+
+  const std::vector<complex_float> before = equal;
+  const complex_float phase = {0.6f, -0.8f};
+  kernels.rotate_(equal.data(), phase, kNumScs);
+  for (size_t sc = 0; sc < kNumScs; sc++) {
+    EXPECT_LT(std::abs(Cx(equal.at(sc)) - Cx(before.at(sc)) * Cx(phase)),
+              kAllowedError);
+  }
+}
+
+static void TestFillOutput(const SmallMimo::Kernels& kernels) {
+  static constexpr size_t kNumAnts = 4;
+  static constexpr size_t kAnt = 2;
+  alignas(64) complex_float src[kNumScs];
+  alignas(64) complex_float dst[kNumAnts * kNumScs];
+  const std::vector<complex_float> values = RandomVector(kNumScs);
+  std::copy(values.begin(), values.end(), src);
+  const std::vector<complex_float> pilot_sgn = RandomVector(kNumScs);
+
+  const SmallMimo::ChunkLayout layout =
+      SmallMimo::TileChunks(kNumAnts, kNumScs);
+  for (const complex_float* pilot : {static_cast<const complex_float*>(
+                                         nullptr),
+                                     pilot_sgn.data()}) {
+    for (const bool non_temporal : {true, false}) {
+      std::fill(dst, dst + kNumAnts * kNumScs, complex_float{0, 0});
+      kernels.fill_output_(src, pilot, dst + kAnt * layout.ant_stride_,
+                           layout.chunk_stride_, kNumScs, non_temporal);
+      for (size_t sc = 0; sc < kNumScs; sc++) {
+        const CxFloat expected =
+            pilot == nullptr ? Cx(src[sc])
+                             : Cx(src[sc]) * std::conj(Cx(pilot[sc]));
+        EXPECT_LT(std::abs(Cx(dst[TileLayout::Index(sc, kAnt, kNumAnts,
+                                                     kNumScs)]) -
+                           expected),
+                  kAllowedError)
+            << SmallMimo::IsaName(kernels.isa_) << " subcarrier " << sc;
+      }
+    }
+  }
+}
+
+TEST(TestSmallMimoKernels, AllIsas) {
+  for (SmallMimo::Isa isa : RunnableIsas()) {
+    const SmallMimo::Kernels& kernels = *SmallMimo::ForIsa(isa);
+    EXPECT_EQ(kernels.isa_, isa);
+    for (size_t dim : {1, 2, 4}) {
+      TestInvert(kernels, dim);
+      TestEqualize(kernels, dim);
+    }
+    TestEqualizeGroup(kernels);
+    TestPhase(kernels);
+    TestFillOutput(kernels);
+  }
+}
+
+TEST(TestSmallMimoKernels, PicksWidestIsa) {
+  EXPECT_EQ(SmallMimo::Get().isa_, RunnableIsas().back());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
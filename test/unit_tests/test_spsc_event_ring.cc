@@ -0,0 +1,66 @@
+/**
+ * @file test_spsc_event_ring.cc
+ * @brief Test the SpscEventRing between one producer and one consumer.
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "spsc_event_ring.h"
+
+TEST(TestSpscEventRing, BoundedAndInOrder) {
+  SpscEventRing ring(6);
+  // Rounded up to a power of two
+  ASSERT_EQ(ring.NumSlots(), 8u);
+
+  std::vector<EventData> events;
+  for (size_t i = 0; i < 10; i++) {
+    events.emplace_back(EventType::kPacketRX, i);
+  }
+  EXPECT_EQ(ring.TryPushBulk(events.data(), events.size()), 8u);
+  EXPECT_FALSE(ring.TryPush(events.at(8)));
+  EXPECT_EQ(ring.SizeApprox(), 8u);
+
+  std::vector<EventData> popped(4);
+  ASSERT_EQ(ring.TryPopBulk(popped.data(), popped.size()), 4u);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(popped.at(i).tags_[0], i);
+  }
+  // The freed slots wrap around
+  EXPECT_EQ(ring.TryPushBulk(&events.at(8), 2), 2u);
+  popped.resize(8);
+  ASSERT_EQ(ring.TryPopBulk(popped.data(), popped.size()), 6u);
+  for (size_t i = 0; i < 6; i++) {
+    EXPECT_EQ(popped.at(i).tags_[0], i + 4);
+  }
+  EXPECT_EQ(ring.TryPopBulk(popped.data(), popped.size()), 0u);
+}
+
+TEST(TestSpscEventRing, ProducerAndConsumerThreads) {
+  constexpr size_t kNumEvents = 100000;
+  SpscEventRing ring(64);
+
+  std::thread producer([&ring]() {
+    for (size_t i = 0; i < kNumEvents; i++) {
+      while (ring.TryPush(EventData(EventType::kPacketRX, i)) == false) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::vector<EventData> popped(16);
+  size_t next = 0;
+  while (next < kNumEvents) {
+    const size_t num_pop = ring.TryPopBulk(popped.data(), popped.size());
+    if (num_pop == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < num_pop; i++) {
+      ASSERT_EQ(popped.at(i).tags_[0], next);
+      next++;
+    }
+  }
+  producer.join();
+  EXPECT_EQ(ring.SizeApprox(), 0u);
+}
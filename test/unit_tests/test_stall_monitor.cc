@@ -0,0 +1,64 @@
+/**
+ * @file test_stall_monitor.cc
+ * @brief Test the stall thresholds of StallMonitor and that it reports each
+ * stalled task once.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <chrono>
+#include <thread>
+
+#include "gettime.h"
+#include "stall_monitor.h"
+
+static const double kFreqGhz = GetTime::MeasureRdtscFreq();
+
+TEST(TestStallMonitor, Threshold) {
+  StallMonitor monitor(2, 10.0, 100.0, kFreqGhz, nullptr);
+  const size_t min_cycles = GetTime::UsToCycles(100.0, kFreqGhz);
+  // Too few tasks for a percentile
+  EXPECT_EQ(monitor.StallCycles(EventType::kDecode), min_cycles);
+
+  const EventData event(EventType::kDecode, 0);
+  for (size_t i = 0; i < 2 * StallMonitor::kMinSamples; i++) {
+    monitor.Worker(i % 2)->Begin(event);
+    monitor.Worker(i % 2)->End();
+  }
+  // The tasks are short, so the least time applies
+  EXPECT_EQ(monitor.StallCycles(EventType::kDecode), min_cycles);
+  EXPECT_EQ(monitor.StallCycles(EventType::kFFT), min_cycles);
+
+  for (size_t i = 0; i < 2 * StallMonitor::kMinSamples; i++) {
+    monitor.Worker(0)->Begin(event);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    monitor.Worker(0)->End();
+  }
+  // Ten times the upper end of the bucket of at least 100 us
+  EXPECT_GT(monitor.StallCycles(EventType::kDecode), 10 * min_cycles);
+}
+
+TEST(TestStallMonitor, ReportOnce) {
+  StallMonitor monitor(2, 10.0, 1000.0, kFreqGhz,
+                       []() { return std::string("queues: none"); });
+  const EventData event(EventType::kDemul, 0);
+  monitor.Worker(1)->Begin(event);
+  EXPECT_EQ(monitor.Check(), 0u);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_EQ(monitor.Check(), 1u);
+  EXPECT_EQ(monitor.Check(), 0u);
+
+  // The next task of the worker stalls on its own
+  monitor.Worker(1)->End();
+  monitor.Worker(1)->Begin(event);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_EQ(monitor.Check(), 1u);
+  monitor.Worker(1)->End();
+  EXPECT_EQ(monitor.Check(), 0u);
+  EXPECT_EQ(monitor.Stalls(), 2u);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
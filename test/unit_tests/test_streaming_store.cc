@@ -0,0 +1,41 @@
+/**
+ * @file test_streaming_store.cc
+ * @brief Test the non-temporal copy of the write-once pipeline outputs.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "streaming_store.h"
+
+TEST(TestStreamingStore, Copy) {
+  static constexpr size_t kMaxBytes = 300;
+  // Unaligned sources too
+  std::vector<uint8_t> src(kMaxBytes + 2);
+  for (size_t i = 0; i < src.size(); i++) {
+    src.at(i) = static_cast<uint8_t>((i * 7) + 3);
+  }
+  // Every head and tail around the 64-byte lines of the destination
+  alignas(64) uint8_t dst[kMaxBytes + 128];
+  for (size_t offset = 0; offset < 64; offset += 5) {
+    for (size_t bytes = 0; bytes <= kMaxBytes; bytes += 13) {
+      std::fill(std::begin(dst), std::end(dst), 0xAA);
+      StreamingStore::Copy(dst + offset, src.data() + (offset % 3), bytes);
+      StreamingStore::Fence();
+      for (size_t i = 0; i < sizeof(dst); i++) {
+        const bool copied = (i >= offset) && (i < offset + bytes);
+        ASSERT_EQ(dst[i], copied ? src.at(i - offset + (offset % 3)) : 0xAA)
+            << "offset " << offset << " bytes " << bytes << " at " << i;
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
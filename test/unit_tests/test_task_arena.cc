@@ -0,0 +1,52 @@
+/**
+ * @file test_task_arena.cc
+ * @brief Test the bump allocation and reset of TaskArena, and Armadillo
+ * temporaries that live in it.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "armadillo"
+#include "heap_counter.h"
+#include "task_arena.h"
+
+TEST(TestTaskArena, AlignedBumpAndReset) {
+  TaskArena arena(1024);
+  auto* first = arena.Alloc<float>(3);
+  auto* second = arena.Alloc<arma::cx_float>(5);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % 64, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % 64, 0u);
+  EXPECT_EQ(reinterpret_cast<uint8_t*>(second) -
+                reinterpret_cast<uint8_t*>(first),
+            64);
+  EXPECT_EQ(arena.Used(), 128u);
+
+  arena.Reset();
+  EXPECT_EQ(arena.Used(), 0u);
+  EXPECT_EQ(arena.Alloc<float>(1), first);
+  EXPECT_THROW(arena.Alloc<float>(1024), std::runtime_error);
+}
+
+TEST(TestTaskArena, ArmadilloTemporaries) {
+  static constexpr size_t kRows = 8;
+  static constexpr size_t kCols = 32;
+  TaskArena arena(4 * kRows * kCols * sizeof(arma::cx_float));
+  arma::cx_fmat a(kCols, kRows, arma::fill::randn);
+  const arma::cx_fmat expected = a.t();
+
+  const size_t start_allocs = HeapCounter::ThreadAllocs();
+  arma::cx_float* mem = arena.Alloc<arma::cx_float>(kRows * kCols);
+  arma::cx_fmat b(mem, kRows, kCols, false, true);
+  b = a.t();
+  b *= 2.0f;
+  // Same-size assignments stay in the arena
+  EXPECT_EQ(b.memptr(), mem);
+  EXPECT_EQ(HeapCounter::ThreadAllocs(), start_allocs);
+  EXPECT_LT(arma::norm(b - 2.0f * expected, "fro"), 1e-4f);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+/**
+ * @file test_task_scheduler.cc
+ * @brief Test the task order, priorities and stealing of the work-stealing
+ * task scheduler.
+ */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "task_scheduler.h"
+
+static EventData MakeEvent(size_t tag) {
+  return EventData(EventType::kDemul, tag);
+}
+
+TEST(TestTaskScheduler, OwnTasksInOrder) {
+  WorkStealingScheduler scheduler(1);
+  for (size_t i = 0; i < 4; i++) {
+    scheduler.Push(MakeEvent(i), i & 0x1, TaskPriority::kNormal);
+  }
+  WorkStealingScheduler::Task task;
+  bool stolen;
+  for (size_t i = 0; i < 4; i++) {
+    ASSERT_TRUE(scheduler.Pop(0, task, stolen));
+    EXPECT_FALSE(stolen);
+    EXPECT_EQ(task.event_.tags_[0], i);
+    EXPECT_EQ(task.qid_, i & 0x1);
+  }
+  EXPECT_FALSE(scheduler.Pop(0, task, stolen));
+}
+
+TEST(TestTaskScheduler, CriticalFirst) {
+  WorkStealingScheduler scheduler(1);
+  scheduler.Push(MakeEvent(0), 0, TaskPriority::kNormal);
+  scheduler.Push(MakeEvent(1), 0, TaskPriority::kCritical);
+  WorkStealingScheduler::Task task;
+  bool stolen;
+  ASSERT_TRUE(scheduler.Pop(0, task, stolen));
+  EXPECT_EQ(task.event_.tags_[0], 1u);
+  ASSERT_TRUE(scheduler.Pop(0, task, stolen));
+  EXPECT_EQ(task.event_.tags_[0], 0u);
+}
+
+TEST(TestTaskScheduler, Steal) {
+  WorkStealingScheduler scheduler(2);
+  // Round-robin: tasks 0 and 2 go to worker 0, task 1 to worker 1
+  for (size_t i = 0; i < 3; i++) {
+    scheduler.Push(MakeEvent(i), 0, TaskPriority::kNormal);
+  }
+  WorkStealingScheduler::Task task;
+  bool stolen;
+  ASSERT_TRUE(scheduler.Pop(1, task, stolen));
+  EXPECT_FALSE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 1u);
+  // Steal the newest task of worker 0
+  ASSERT_TRUE(scheduler.Pop(1, task, stolen));
+  EXPECT_TRUE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 2u);
+  ASSERT_TRUE(scheduler.Pop(0, task, stolen));
+  EXPECT_FALSE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 0u);
+}
+
+TEST(TestTaskScheduler, Affinity) {
+  WorkStealingScheduler scheduler(4);
+  scheduler.SetAffinityWidth(2);
+  // Key 1 goes to workers 2 and 3, the less loaded one first
+  for (size_t i = 0; i < 3; i++) {
+    scheduler.PushAffine(MakeEvent(i), 0, TaskPriority::kNormal, 1);
+  }
+  WorkStealingScheduler::Task task;
+  bool stolen;
+  ASSERT_TRUE(scheduler.Pop(2, task, stolen));
+  EXPECT_FALSE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 0u);
+  ASSERT_TRUE(scheduler.Pop(3, task, stolen));
+  EXPECT_FALSE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 1u);
+  // Key 3 wraps around to workers 2 and 3, which hold task 2 and the new one
+  scheduler.PushAffine(MakeEvent(3), 0, TaskPriority::kNormal, 3);
+  ASSERT_TRUE(scheduler.Pop(3, task, stolen));
+  EXPECT_FALSE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 3u);
+  // An idle worker outside the subset steals from it
+  ASSERT_TRUE(scheduler.Pop(0, task, stolen));
+  EXPECT_TRUE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 2u);
+  EXPECT_FALSE(scheduler.Pop(0, task, stolen));
+
+  // Without a width, round-robin as Push()
+  scheduler.SetAffinityWidth(0);
+  scheduler.PushAffine(MakeEvent(4), 0, TaskPriority::kNormal, 1);
+  ASSERT_TRUE(scheduler.Pop(0, task, stolen));
+  EXPECT_FALSE(stolen);
+  EXPECT_EQ(task.event_.tags_[0], 4u);
+}
+
+TEST(TestTaskScheduler, ThreadedNoLoss) {
+  static constexpr size_t kNumWorkers = 4;
+  static constexpr size_t kNumTasks = 100000;
+  WorkStealingScheduler scheduler(kNumWorkers);
+  std::vector<size_t> seen(kNumTasks, 0);
+  std::atomic<size_t> num_done(0);
+
+  std::vector<std::thread> workers;
+  for (size_t tid = 0; tid < kNumWorkers; tid++) {
+    workers.emplace_back([&, tid]() {
+      WorkStealingScheduler::Task task;
+      bool stolen;
+      while (num_done.load() < kNumTasks) {
+        if (scheduler.Pop(tid, task, stolen)) {
+          seen.at(task.event_.tags_[0])++;
+          num_done++;
+        }
+      }
+    });
+  }
+  for (size_t i = 0; i < kNumTasks; i++) {
+    scheduler.Push(MakeEvent(i), 0,
+                   (i % 3 == 0) ? TaskPriority::kCritical
+                                : TaskPriority::kNormal);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (size_t i = 0; i < kNumTasks; i++) {
+    EXPECT_EQ(seen.at(i), 1u) << "task " << i;
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,104 @@
+/**
+ * @file test_telemetry.cc
+ * @brief Test the metrics served by the telemetry HTTP server.
+ */
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <string>
+
+#include "gettime.h"
+#include "telemetry.h"
+
+static constexpr uint16_t kPort = 29091;
+
+// Send a GET request for path and return the whole response
+static std::string HttpGet(const std::string& path) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(kPort);
+  ::inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+  EXPECT_EQ(
+      ::connect(fd, reinterpret_cast<sockaddr*>(&server), sizeof(server)), 0);
+  const std::string request = "GET " + path + " HTTP/1.1\r\nHost: x\r\n\r\n";
+  ::send(fd, request.data(), request.size(), 0);
+
+  std::string response;
+  char buf[4096];
+  ssize_t rx_bytes;
+  while ((rx_bytes = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+    response.append(buf, rx_bytes);
+  }
+  ::close(fd);
+  return response;
+}
+
+TEST(TestTelemetry, Metrics) {
+  TelemetryServer server("agora", "127.0.0.1", kPort, {"rx", "task"}, 100.0,
+                         GetTime::MeasureRdtscFreq());
+  EXPECT_TRUE(server.PublishDue());
+
+  // Nothing is served before the first snapshot
+  std::string response = HttpGet("/metrics");
+  EXPECT_EQ(response.rfind("HTTP/1.1 200 OK", 0), 0u);
+  EXPECT_EQ(response.find("agora_frames_total"), std::string::npos);
+
+  TelemetrySnapshot& snapshot = server.Staging();
+  snapshot.frames_ = 42;
+  snapshot.queue_depths_.at(1) = 7;
+  snapshot.acc_spilled_blocks_ = 5;
+  const auto decode_done = static_cast<size_t>(TsType::kDecodeDone);
+  snapshot.latency_frames_.at(decode_done) = 42;
+  snapshot.latency_us_.at(decode_done) = {100.0, 200.0, 300.0};
+  snapshot.num_ues_ = 2;
+  snapshot.snr_db_ = {12.5f, 20.0f};
+  snapshot.sinr_db_ = {15.0f, NAN};
+  snapshot.decode_iters_ = {3.5f, 2.0f};
+  snapshot.decoded_blocks_ = {10, 20};
+  snapshot.block_errors_ = {1, 0};
+  snapshot.radio_timing_ = true;
+  snapshot.rx_arrival_.at(
+      static_cast<size_t>(RadioTiming::RxType::kUplink)) = {
+      100, 20.5, 80.5, 3, 120.5};
+  server.Publish();
+  EXPECT_FALSE(server.PublishDue());
+  // Later changes to the staging snapshot are not served until published
+  snapshot.frames_ = 43;
+
+  response = HttpGet("/metrics");
+  EXPECT_NE(response.find("\nagora_frames_total 42\n"), std::string::npos);
+  EXPECT_NE(response.find("\nagora_queue_depth{queue=\"task\"} 7\n"),
+            std::string::npos);
+  EXPECT_NE(
+      response.find("\nagora_acc100_decode_blocks_total{path=\"cpu\"} 5\n"),
+      std::string::npos);
+  EXPECT_NE(response.find("\nagora_stage_latency_us{stage=\"decode_done\","
+                          "quantile=\"0.99\"} 200\n"),
+            std::string::npos);
+  EXPECT_EQ(response.find("stage=\"demul_done\""), std::string::npos);
+  EXPECT_NE(response.find("\nagora_radio_rx_arrival_us{type=\"uplink\","
+                          "quantile=\"0.99\"} 80.5\n"),
+            std::string::npos);
+  EXPECT_NE(
+      response.find("\nagora_radio_rx_arrival_worst_radio{type=\"uplink\"} "
+                    "3\n"),
+      std::string::npos);
+  EXPECT_EQ(response.find("type=\"pilot\""), std::string::npos);
+  EXPECT_NE(response.find("\nagora_ue_snr_db{ue=\"0\"} 12.5\n"),
+            std::string::npos);
+  EXPECT_NE(response.find("\nagora_ue_sinr_db{ue=\"1\"} NaN\n"),
+            std::string::npos);
+  EXPECT_NE(response.find("\nagora_ue_decode_iterations{ue=\"0\"} 3.5\n"),
+            std::string::npos);
+  EXPECT_NE(response.find("\nagora_ue_block_errors_total{ue=\"0\"} 1\n"),
+            std::string::npos);
+  EXPECT_EQ(response.find("ue=\"2\""), std::string::npos);
+
+  response = HttpGet("/");
+  EXPECT_EQ(response.rfind("HTTP/1.1 404 Not Found", 0), 0u);
+}
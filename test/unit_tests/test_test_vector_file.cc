@@ -0,0 +1,81 @@
+/**
+ * @file test_test_vector_file.cc
+ * @brief Test writing and mapping the test vector files.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <cstdio>
+#include <string>
+
+#include "test_vector_file.h"
+
+static constexpr char kVectorFile[] = "/tmp/test_test_vector_file.bin";
+static constexpr uint64_t kConfigHash = 0x1234;
+
+TEST(TestVectorFile, WriteAndMap) {
+  Table<int8_t> bits;
+  Table<std::complex<int16_t>> samples;
+  bits.Calloc(3, 100, Agora_memory::Alignment_t::kAlign64);
+  samples.Calloc(2, 5000, Agora_memory::Alignment_t::kAlign64);
+  for (size_t i = 0; i < 3; i++) {
+    for (size_t j = 0; j < 100; j++) {
+      bits[i][j] = static_cast<int8_t>(i + j);
+    }
+  }
+  for (size_t i = 0; i < 2; i++) {
+    for (size_t j = 0; j < 5000; j++) {
+      samples[i][j] = {static_cast<int16_t>(j), static_cast<int16_t>(-i)};
+    }
+  }
+  {
+    TestVectorFile file;
+    file.Add(bits);
+    file.Add(samples);
+    ASSERT_TRUE(file.Write(kVectorFile, kConfigHash, 2.5f));
+  }
+
+  TestVectorFile file;
+  ASSERT_TRUE(file.Map(kVectorFile, kConfigHash));
+  ASSERT_EQ(file.NumTables(), 2u);
+  EXPECT_EQ(file.Scale(), 2.5f);
+  Table<int8_t> mapped_bits;
+  Table<std::complex<int16_t>> mapped_samples;
+  file.Get(0, mapped_bits);
+  file.Get(1, mapped_samples);
+  EXPECT_TRUE(mapped_bits == bits);
+  EXPECT_TRUE(mapped_samples == samples);
+  // Each table starts on a page
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped_samples[0]) %
+                TestVectorFile::kPageSize,
+            0u);
+
+  // Writes are private to the process
+  mapped_bits[0][0] = 100;
+  TestVectorFile other;
+  ASSERT_TRUE(other.Map(kVectorFile, kConfigHash));
+  Table<int8_t> other_bits;
+  other.Get(0, other_bits);
+  EXPECT_EQ(other_bits[0][0], 0);
+
+  // Freeing a mapped table leaves the mapping alone
+  mapped_bits.Free();
+  EXPECT_EQ(other_bits[2][99], 101);
+  bits.Free();
+  samples.Free();
+}
+
+TEST(TestVectorFile, RejectOtherConfig) {
+  Table<complex_float> symbols;
+  symbols.Calloc(1, 64, Agora_memory::Alignment_t::kAlign64);
+  TestVectorFile file;
+  file.Add(symbols);
+  ASSERT_TRUE(file.Write(kVectorFile, kConfigHash, 1.0f));
+  symbols.Free();
+
+  TestVectorFile other_config;
+  EXPECT_FALSE(other_config.Map(kVectorFile, kConfigHash + 1));
+  std::remove(kVectorFile);
+  TestVectorFile missing;
+  EXPECT_FALSE(missing.Map(kVectorFile, kConfigHash));
+}
@@ -0,0 +1,48 @@
+/**
+ * @file test_tile_layout.cc
+ * @brief Test that the subcarrier tiles hold every (subcarrier, antenna) of a
+ * symbol once, with the subcarriers of a cache line contiguous.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tile_layout.h"
+
+TEST(TestTileLayout, CoversEverySubcarrierOnce) {
+  const size_t sc_num = 64;
+  for (size_t num_ants : {1, 2, 4, 6}) {
+    std::vector<size_t> hits(sc_num * num_ants, 0);
+    for (size_t ant = 0; ant < num_ants; ant++) {
+      for (size_t sc = 0; sc < sc_num; sc++) {
+        const size_t idx = TileLayout::Index(sc, ant, num_ants, sc_num);
+        ASSERT_LT(idx, hits.size());
+        hits.at(idx)++;
+      }
+    }
+    for (size_t hit : hits) {
+      EXPECT_EQ(hit, 1u);
+    }
+  }
+}
+
+TEST(TestTileLayout, CachelinesAreContiguous) {
+  const size_t sc_num = 64;
+  const size_t num_ants = 4;
+  for (size_t ant = 0; ant < num_ants; ant++) {
+    for (size_t sc = 0; sc < sc_num; sc += kSCsPerCacheline) {
+      const size_t first = TileLayout::Index(sc, ant, num_ants, sc_num);
+      for (size_t j = 1; j < kSCsPerCacheline; j++) {
+        EXPECT_EQ(TileLayout::Index(sc + j, ant, num_ants, sc_num), first + j);
+      }
+    }
+  }
+  // The next antenna of a tile is one tile row further
+  EXPECT_EQ(TileLayout::Index(0, 1, num_ants, sc_num),
+            kUsePartialTrans ? TileLayout::kTileScs : sc_num);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,77 @@
+/**
+ * @file test_tx_lookahead_ring.cc
+ * @brief Test the ring of the uplink frames a client prepares ahead of their
+ * transmit time.
+ */
+#include <gtest/gtest.h>
+
+#include "tx_lookahead_ring.h"
+
+static constexpr size_t kNumSlots = 8;
+static constexpr size_t kSampsPerFrame = 1000;
+static constexpr long long kLeadSamples = 2 * kSampsPerFrame;
+static constexpr long long kGuardSamples = 100;
+// Hardware time of frame 0 and the offset of its first tx symbol
+static constexpr long long kTime0 = 123456;
+static constexpr long long kTxSymbolOffset = 300;
+
+static TxLookaheadRing::PreparedTx Frame(size_t frame_id) {
+  return {kTime0 + static_cast<long long>(frame_id * kSampsPerFrame) +
+              kTxSymbolOffset,
+          frame_id, 0, EventType::kPacketTX};
+}
+
+TEST(TestTxLookaheadRing, ReleaseInOrder) {
+  TxLookaheadRing ring(kNumSlots, kSampsPerFrame, kLeadSamples, kGuardSamples);
+  // Pushed out of order, as the UEs finish their frames
+  for (size_t frame_id : {5, 3, 4, 6}) {
+    ASSERT_TRUE(ring.Push(Frame(frame_id)));
+  }
+  EXPECT_EQ(ring.NumQueued(), 4u);
+
+  TxLookaheadRing::PreparedTx prepared;
+  // Frame 3 is more than the lead away
+  long long now = Frame(3).tx_time_ - kLeadSamples - 1;
+  EXPECT_FALSE(ring.PopReady(now, prepared));
+
+  now = Frame(4).tx_time_ - kLeadSamples;
+  for (size_t frame_id : {3, 4}) {
+    ASSERT_TRUE(ring.PopReady(now, prepared));
+    EXPECT_EQ(prepared.frame_id_, frame_id);
+    EXPECT_FALSE(ring.IsLate(prepared, now));
+  }
+  EXPECT_FALSE(ring.PopReady(now, prepared));
+  EXPECT_EQ(ring.NumQueued(), 2u);
+}
+
+TEST(TestTxLookaheadRing, LateFrames) {
+  TxLookaheadRing ring(kNumSlots, kSampsPerFrame, kLeadSamples, kGuardSamples);
+  ASSERT_TRUE(ring.Push(Frame(1)));
+  ASSERT_TRUE(ring.Push(Frame(2)));
+
+  // The radio is within the guard of frame 1 and past frame 2's lead
+  const long long now = Frame(1).tx_time_ - kGuardSamples + 1;
+  TxLookaheadRing::PreparedTx prepared;
+  ASSERT_TRUE(ring.PopReady(now, prepared));
+  EXPECT_EQ(prepared.frame_id_, 1u);
+  EXPECT_TRUE(ring.IsLate(prepared, now));
+  ASSERT_TRUE(ring.PopReady(now, prepared));
+  EXPECT_EQ(prepared.frame_id_, 2u);
+  EXPECT_FALSE(ring.IsLate(prepared, now));
+}
+
+TEST(TestTxLookaheadRing, SlotTaken) {
+  TxLookaheadRing ring(kNumSlots, kSampsPerFrame, kLeadSamples, kGuardSamples);
+  ASSERT_TRUE(ring.Push(Frame(2)));
+  // Same hardware frame one pass around the ring later
+  EXPECT_FALSE(ring.Push(Frame(2 + kNumSlots)));
+
+  TxLookaheadRing::PreparedTx prepared;
+  ASSERT_TRUE(ring.PopReady(Frame(2).tx_time_, prepared));
+  EXPECT_TRUE(ring.Push(Frame(2 + kNumSlots)));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -238,6 +238,121 @@ TEST(UDPComm, PerfUDP) {
   send_thread.join();
 }
 
+///Test the batched send use case
+void UDPSendBatch(const std::string& local_address, uint16_t local_port,
+                  const std::string& remote_address, uint16_t remote_port) {
+  std::vector<std::vector<std::byte>> packets(
+      kNumPackets, std::vector<std::byte>(kMessageSize));
+  std::vector<const std::byte*> msgs;
+  const std::vector<size_t> lens(kNumPackets, kMessageSize);
+  UDPComm udp_client(local_address, local_port, 0, 0);
+
+  while (server_ready == false) {
+    // Wait for server to get ready
+  }
+  udp_client.Connect(remote_address, remote_port);
+
+  for (size_t i = 1; i <= kNumPackets; i++) {
+    *reinterpret_cast<size_t*>(&packets.at(i - 1)[0u]) = i;
+    msgs.push_back(packets.at(i - 1).data());
+  }
+  udp_client.SendBatch(msgs.data(), lens.data(), kNumPackets);
+}
+
+// Spin until kNumPackets are received in batches, in order
+void UDPRecvBatch(const std::string& local_address, uint16_t local_port,
+                  const std::string& remote_address, uint16_t remote_port) {
+  UDPComm udp_server(local_address, local_port, kMessageSize * kNumPackets, 0);
+  std::vector<std::vector<std::byte>> pkt_bufs(
+      kNumPackets, std::vector<std::byte>(kMessageSize));
+  std::vector<std::byte*> bufs;
+  for (auto& pkt_buf : pkt_bufs) {
+    bufs.push_back(pkt_buf.data());
+  }
+  std::vector<size_t> lens(kNumPackets);
+  udp_server.Connect(remote_address, remote_port);
+
+  server_ready = true;
+  size_t num_pkts_received = 0;
+  while (num_pkts_received < kNumPackets) {
+    const ssize_t ret =
+        udp_server.RecvBatch(&bufs.at(num_pkts_received), kMessageSize,
+                             &lens.at(num_pkts_received),
+                             kNumPackets - num_pkts_received);
+    ASSERT_GE(ret, 0);
+    for (ssize_t i = 0; i < ret; i++) {
+      ASSERT_EQ(lens.at(num_pkts_received), kMessageSize);
+      // Loopback keeps the order of the packets
+      ASSERT_EQ(*reinterpret_cast<size_t*>(bufs.at(num_pkts_received)),
+                num_pkts_received + 1);
+      num_pkts_received++;
+    }
+  }
+  server_ready = false;
+}
+
+TEST(UDPComm, Batch) {
+  server_ready = false;
+  std::thread receive_thread(UDPRecvBatch, kIpv4Address, kReceivePort,
+                             kIpv4Address, kSendPort);
+  std::thread send_thread(UDPSendBatch, kIpv4Address, kSendPort, kIpv4Address,
+                          kReceivePort);
+
+  receive_thread.join();
+  send_thread.join();
+}
+
+// Test a batch with one message per port, as sent by the MAC threads
+TEST(UDPClientServer, BatchToPorts) {
+  static constexpr size_t kNumPorts = 2;
+  UDPServer first_server(kIpv4Address, kReceivePort,
+                         kMessageSize * kNumPackets);
+  UDPServer second_server(kIpv4Address, kReceivePort + 1,
+                          kMessageSize * kNumPackets);
+  UDPClient udp_client(kIpv4Address);
+
+  std::vector<std::vector<std::byte>> packets(
+      kNumPackets, std::vector<std::byte>(kMessageSize));
+  std::vector<const std::byte*> msgs;
+  std::vector<size_t> lens;
+  std::vector<uint16_t> ports;
+  for (size_t i = 0; i < kNumPackets; i++) {
+    *reinterpret_cast<size_t*>(&packets.at(i)[0u]) = i;
+    msgs.push_back(packets.at(i).data());
+    // Each message of its own length, to check they are not mixed up
+    lens.push_back(kMessageSize - i);
+    ports.push_back(kReceivePort + (i % kNumPorts));
+  }
+  udp_client.SendBatch(kIpv4Address, ports.data(), msgs.data(), lens.data(),
+                       kNumPackets);
+
+  std::vector<std::byte> rx_buf(kMessageSize * kNumPackets);
+  std::vector<std::byte*> rx_bufs;
+  for (size_t i = 0; i < kNumPackets; i++) {
+    rx_bufs.push_back(&rx_buf.at(i * kMessageSize));
+  }
+  std::vector<size_t> rx_lens(kNumPackets);
+  size_t num_received = 0;
+  for (size_t port_id = 0; port_id < kNumPorts; port_id++) {
+    const UDPServer& server = (port_id == 0) ? first_server : second_server;
+    size_t num_port_received = 0;
+    // Loopback queues the packets at the receivers before send returns
+    while (num_port_received < kNumPackets / kNumPorts) {
+      const ssize_t ret = server.RecvBatch(rx_bufs.data(), kMessageSize,
+                                           rx_lens.data(), kNumPackets);
+      ASSERT_GT(ret, 0);
+      for (ssize_t i = 0; i < ret; i++) {
+        const size_t id = *reinterpret_cast<size_t*>(rx_bufs.at(i));
+        ASSERT_EQ(id, (num_port_received * kNumPorts) + port_id);
+        ASSERT_EQ(rx_lens.at(i), kMessageSize - id);
+        num_port_received++;
+      }
+    }
+    num_received += num_port_received;
+  }
+  EXPECT_EQ(num_received, kNumPackets);
+}
+
 // Test that the server is actually non-blocking
 TEST(UDPClientServer, ServerIsNonBlocking) {
   UDPServer udp_server(kIpv6Address, kReceivePort);
@@ -0,0 +1,85 @@
+/**
+ * @file test_ue_grouping.cc
+ * @brief Test the channel correlations of UeGrouping and the groups it
+ * forms from them.
+ */
+#include <gtest/gtest.h>
+// For some reason, gtest include order matters
+
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "ue_grouping.h"
+
+static constexpr size_t kNumAnts = 16;
+
+TEST(TestUeGrouping, Dot) {
+  std::mt19937 gen(3);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  // Lengths off the SIMD width go through the scalar tail
+  for (const size_t n : {1ul, 8ul, 13ul, 64ul}) {
+    std::vector<complex_float> a(n);
+    std::vector<complex_float> b(n);
+    std::complex<float> expected(0.0f, 0.0f);
+    for (size_t i = 0; i < n; i++) {
+      a.at(i) = {dist(gen), dist(gen)};
+      b.at(i) = {dist(gen), dist(gen)};
+      expected += std::conj(std::complex<float>(a.at(i).re, a.at(i).im)) *
+                  std::complex<float>(b.at(i).re, b.at(i).im);
+    }
+    const std::complex<float> dot = UeGrouping::Dot(a.data(), b.data(), n);
+    EXPECT_NEAR(dot.real(), expected.real(), 1e-4f * n) << n;
+    EXPECT_NEAR(dot.imag(), expected.imag(), 1e-4f * n) << n;
+  }
+}
+
+TEST(TestUeGrouping, Groups) {
+  // UEs 0 and 1 share a channel up to a phase, as do UEs 2 and 3
+  static constexpr size_t kNumUes = 4;
+  std::mt19937 gen(5);
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<complex_float> csi(UeGrouping::kNumSamples * kNumAnts *
+                                 kNumUes);
+  for (size_t sc = 0; sc < UeGrouping::kNumSamples; sc++) {
+    complex_float* h = &csi.at(sc * kNumAnts * kNumUes);
+    for (size_t ant = 0; ant < kNumAnts; ant++) {
+      for (const size_t ue : {0ul, 2ul}) {
+        h[(ue * kNumAnts) + ant] = {dist(gen), dist(gen)};
+        // The channel times j
+        h[((ue + 1) * kNumAnts) + ant] = {-h[(ue * kNumAnts) + ant].im,
+                                          h[(ue * kNumAnts) + ant].re};
+      }
+    }
+  }
+
+  UeGrouping grouping(kNumUes, 2, 0.5f);
+  EXPECT_EQ(grouping.Correlation(0, 1), 0.0f);
+  grouping.UpdateCorrelation(csi.data(), kNumAnts, UeGrouping::kNumSamples);
+  EXPECT_NEAR(grouping.Correlation(0, 1), 1.0f, 1e-4f);
+  EXPECT_NEAR(grouping.Correlation(3, 2), 1.0f, 1e-4f);
+  EXPECT_LT(grouping.Correlation(0, 2), 0.5f);
+  EXPECT_EQ(grouping.Correlation(1, 3), grouping.Correlation(3, 1));
+
+  // UE 1 goes first, and UE 0 is left out for the best of UEs 2 and 3
+  std::array<uint8_t, kMaxUEs> selected;
+  const float priority[kNumUes] = {3.0f, 4.0f, 1.0f, 2.0f};
+  grouping.FormGroup(priority, selected);
+  EXPECT_EQ(selected.at(0), 0);
+  EXPECT_EQ(selected.at(1), 1);
+  EXPECT_EQ(selected.at(2), 0);
+  EXPECT_EQ(selected.at(3), 1);
+
+  // With all UEs correlated the least correlated one is taken
+  UeGrouping strict(kNumUes, 3, 0.0f);
+  strict.UpdateCorrelation(csi.data(), kNumAnts, UeGrouping::kNumSamples);
+  strict.FormGroup(priority, selected);
+  EXPECT_EQ(selected.at(0) + selected.at(1) + selected.at(2) + selected.at(3),
+            3);
+  EXPECT_EQ(selected.at(1), 1);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 // For some reason, gtest include order matters
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "concurrentqueue.h"
 #include "config.h"
 #include "dobeamweights.h"
@@ -50,10 +55,15 @@ TEST(TestZF, Perf) {
   auto phy_stats = std::make_unique<PhyStats>(cfg.get(), Direction::kUplink);
   auto stats = std::make_unique<Stats>(cfg.get());
 
+  // Beamweight reuse is disabled in this config
+  Table<complex_float> beam_ref_csi_buffer;
+  std::vector<BeamReuseState> beam_reuse_state;
+
   auto compute_zf = std::make_unique<DoBeamWeights>(
       cfg.get(), tid, csi_buffers, calib_dl_buffer, calib_ul_buffer,
       calib_dl_msum_buffer, calib_ul_msum_buffer, calib_buffer, ul_zf_matrices,
-      dl_zf_matrices, mac_sched.get(), phy_stats.get(), stats.get());
+      dl_zf_matrices, beam_ref_csi_buffer, beam_reuse_state, mac_sched.get(),
+      phy_stats.get(), stats.get());
 
   FastRand fast_rand;
   size_t start_tsc = GetTime::Rdtsc();
@@ -75,6 +85,371 @@ TEST(TestZF, Perf) {
   calib_buffer.Free();
 }
 
+/// A DoBeamWeights with beamweight reuse, over the beam blocks of whole
+/// frames whose CSI the test writes
+class BeamReuseBench {
+ public:
+  explicit BeamReuseBench(const std::string& conf_file)
+      : cfg_(std::make_unique<Config>(conf_file)),
+        ul_beams_(cfg_->BsAntNum() * cfg_->UeAntNum()),
+        dl_beams_(cfg_->UeAntNum() * cfg_->BsAntNum()),
+        reuse_state_(cfg_->BeamEventsPerSymbol()) {
+    cfg_->GenData();
+    csi_buffers_.RandAllocCxFloat(cfg_->BsAntNum() * cfg_->OfdmDataNum());
+    for (auto* table : {&calib_dl_msum_, &calib_ul_msum_, &calib_dl_,
+                        &calib_ul_, &calib_}) {
+      table->RandAllocCxFloat(kFrameWnd, cfg_->OfdmDataNum() * cfg_->BsAntNum(),
+                              Agora_memory::Alignment_t::kAlign64);
+    }
+    const size_t block_mat_size = cfg_->BeamBlockSize() *
+                                  cfg_->BsAntNum() *
+                                  cfg_->SpatialStreamsNum();
+    ref_csi_.Calloc(cfg_->BeamEventsPerSymbol(), block_mat_size,
+                    Agora_memory::Alignment_t::kAlign64);
+    pred_.Calloc(cfg_->BeamEventsPerSymbol(), 2 * block_mat_size,
+                 Agora_memory::Alignment_t::kAlign64);
+    for (size_t i = 0; i < reuse_state_.size(); i++) {
+      BeamReuseState& state = reuse_state_.at(i);
+      state.busy_ = false;
+      state.computed_frame_ = SIZE_MAX;
+      state.computed_ue_list_.fill(SIZE_MAX);
+      state.written_frame_ = SIZE_MAX;
+      state.predicted_frame_ = SIZE_MAX;
+      state.predicted_ue_list_.fill(SIZE_MAX);
+      state.predicted_csi_ = pred_[i];
+      state.predicted_ul_beams_ = pred_[i] + block_mat_size;
+    }
+    mac_sched_ = std::make_unique<MacScheduler>(cfg_.get(), true);
+    phy_stats_ = std::make_unique<PhyStats>(cfg_.get(), Direction::kUplink);
+    stats_ = std::make_unique<Stats>(cfg_.get());
+    doer_ = std::make_unique<DoBeamWeights>(
+        cfg_.get(), 0, csi_buffers_, calib_dl_, calib_ul_, calib_dl_msum_,
+        calib_ul_msum_, calib_, ul_beams_, dl_beams_, ref_csi_, reuse_state_,
+        mac_sched_.get(), phy_stats_.get(), stats_.get());
+  }
+
+  ~BeamReuseBench() {
+    doer_.reset();
+    for (auto* table : {&calib_dl_msum_, &calib_ul_msum_, &calib_dl_,
+                        &calib_ul_, &calib_, &ref_csi_, &pred_}) {
+      table->Free();
+    }
+  }
+
+  /// Schedule a frame and run the beam tasks of all its blocks
+  void RunFrame(size_t frame_id) {
+    mac_sched_->ScheduleFrame(frame_id);
+    for (size_t block = 0; block < cfg_->BeamEventsPerSymbol(); block++) {
+      doer_->Launch(
+          gen_tag_t::FrmSc(frame_id, block * cfg_->BeamBlockSize()).tag_);
+    }
+  }
+
+  /// Set the CSI of a UE in a frame to scale times the CSI of another UE in
+  /// another frame
+  void CopyCsi(size_t frame_id, size_t ue_id, size_t from_frame_id,
+               size_t from_ue_id, float scale) {
+    const complex_float* src =
+        csi_buffers_[from_frame_id % cfg_->FrameWindow()][from_ue_id];
+    complex_float* dst = csi_buffers_[frame_id % cfg_->FrameWindow()][ue_id];
+    for (size_t i = 0; i < cfg_->BsAntNum() * cfg_->OfdmDataNum(); i++) {
+      dst[i] = {scale * src[i].re, scale * src[i].im};
+    }
+  }
+
+  /// Set the CSI of every UE in a frame to base + (frame_id * slope) *
+  /// drift, plus noise times the CSI of noise_frame_id
+  void LinearCsi(size_t frame_id, size_t base_frame_id, size_t drift_frame_id,
+                 float slope, size_t noise_frame_id, float noise) {
+    const size_t window = cfg_->FrameWindow();
+    for (size_t ue = 0; ue < cfg_->UeAntNum(); ue++) {
+      const complex_float* base = csi_buffers_[base_frame_id % window][ue];
+      const complex_float* drift = csi_buffers_[drift_frame_id % window][ue];
+      const complex_float* rand = csi_buffers_[noise_frame_id % window][ue];
+      complex_float* dst = csi_buffers_[frame_id % window][ue];
+      const float step = static_cast<float>(frame_id) * slope;
+      for (size_t i = 0; i < cfg_->BsAntNum() * cfg_->OfdmDataNum(); i++) {
+        dst[i] = {base[i].re + step * drift[i].re + noise * rand[i].re,
+                  base[i].im + step * drift[i].im + noise * rand[i].im};
+      }
+    }
+  }
+
+  /// Predict the next frame of every beam block on the idle doer, and
+  /// return the number of blocks predicted
+  size_t PredictAll() {
+    size_t num_predicted = 0;
+    for (size_t block = 0; block < cfg_->BeamEventsPerSymbol(); block++) {
+      num_predicted += doer_->IdleWork() ? 1 : 0;
+    }
+    return num_predicted;
+  }
+
+  /// Call f(block, sc, sc_idx) for the subcarriers of the beamweights of
+  /// every block, sc_idx counting them within the block
+  template <typename F>
+  void ForEachBeamSc(F f) {
+    const size_t stride = cfg_->BeamScStride();
+    for (size_t block = 0; block < cfg_->BeamEventsPerSymbol(); block++) {
+      const size_t base_sc = block * cfg_->BeamBlockSize();
+      const size_t last_sc = std::min(base_sc + cfg_->BeamBlockSize(),
+                                      cfg_->OfdmDataNum());
+      size_t sc_idx = 0;
+      for (size_t sc = ((base_sc + stride - 1) / stride) * stride;
+           sc < last_sc; sc += stride) {
+        f(block, sc, sc_idx);
+        sc_idx++;
+      }
+    }
+  }
+
+  /// Number of beam subcarriers whose uplink beamweights in frame_id are
+  /// the predicted ones of their block
+  size_t NumPredictedBeams(size_t frame_id) {
+    const size_t mat_size = cfg_->BsAntNum() * cfg_->SpatialStreamsNum();
+    size_t num_predicted = 0;
+    ForEachBeamSc([&](size_t block, size_t sc, size_t sc_idx) {
+      num_predicted +=
+          (std::memcmp(ul_beams_[frame_id % cfg_->FrameWindow()][sc],
+                       reuse_state_.at(block).predicted_ul_beams_ +
+                           sc_idx * mat_size,
+                       mat_size * sizeof(complex_float)) == 0)
+              ? 1
+              : 0;
+    });
+    return num_predicted;
+  }
+
+  /// Number of subcarriers with beamweights
+  size_t NumBeamScs() {
+    size_t num_scs = 0;
+    ForEachBeamSc([&](size_t, size_t, size_t) { num_scs++; });
+    return num_scs;
+  }
+
+  /// True if the uplink beamweights of two frames are the same
+  bool SameBeams(size_t frame_a, size_t frame_b) {
+    const size_t mat_bytes =
+        cfg_->BsAntNum() * cfg_->SpatialStreamsNum() * sizeof(complex_float);
+    for (size_t sc = 0; sc < cfg_->OfdmDataNum(); sc += cfg_->BeamScStride()) {
+      if (std::memcmp(ul_beams_[frame_a % cfg_->FrameWindow()][sc],
+                      ul_beams_[frame_b % cfg_->FrameWindow()][sc],
+                      mat_bytes) != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// True if every beam block computed its beamweights in frame_id
+  bool AllComputedIn(size_t frame_id) const {
+    for (const auto& state : reuse_state_) {
+      if (state.computed_frame_ != frame_id) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::unique_ptr<Config> cfg_;
+  PtrGrid<kFrameWnd, kMaxUEs, complex_float> csi_buffers_;
+  PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> ul_beams_;
+  PtrGrid<kFrameWnd, kMaxDataSCs, complex_float> dl_beams_;
+  Table<complex_float> calib_dl_msum_;
+  Table<complex_float> calib_ul_msum_;
+  Table<complex_float> calib_dl_;
+  Table<complex_float> calib_ul_;
+  Table<complex_float> calib_;
+  Table<complex_float> ref_csi_;
+  // Predicted CSI and uplink beamweights of each beam block
+  Table<complex_float> pred_;
+  std::vector<BeamReuseState> reuse_state_;
+  std::unique_ptr<MacScheduler> mac_sched_;
+  std::unique_ptr<PhyStats> phy_stats_;
+  std::unique_ptr<Stats> stats_;
+  std::unique_ptr<DoBeamWeights> doer_;
+};
+
+/// Reuse of the previous frame's beamweights, and its misses
+TEST(TestZF, BeamReuse) {
+  BeamReuseBench bench("files/config/ci/tddconfig-sim-ul-beam-reuse.json");
+  const size_t num_ues = bench.cfg_->UeAntNum();
+  ASSERT_GT(bench.cfg_->BeamReuseThreshold(), 0.0f);
+  ASSERT_FALSE(bench.mac_sched_->RotatesGroups());
+
+  bench.RunFrame(0);
+  EXPECT_TRUE(bench.AllComputedIn(0));
+
+  // A CSI change below the threshold reuses the beamweights of frame 0,
+  // which differ from those of the scaled CSI
+  for (size_t ue = 0; ue < num_ues; ue++) {
+    bench.CopyCsi(1, ue, 0, ue, 1.001f);
+  }
+  bench.RunFrame(1);
+  EXPECT_TRUE(bench.AllComputedIn(0));
+  EXPECT_TRUE(bench.SameBeams(1, 0));
+
+  // A CSI change above it recomputes them
+  for (size_t ue = 0; ue < num_ues; ue++) {
+    bench.CopyCsi(2, ue, 0, ue, 1.5f);
+  }
+  bench.RunFrame(2);
+  EXPECT_TRUE(bench.AllComputedIn(2));
+  EXPECT_FALSE(bench.SameBeams(2, 1));
+
+  // The same CSI is reused for beam_reuse_max_frames frames at most
+  const size_t max_frames = bench.cfg_->BeamReuseMaxFrames();
+  for (size_t frame = 3; frame <= 2 + max_frames; frame++) {
+    for (size_t ue = 0; ue < num_ues; ue++) {
+      bench.CopyCsi(frame, ue, 2, ue, 1.0f);
+    }
+    bench.RunFrame(frame);
+    const size_t computed = (frame < 2 + max_frames) ? 2 : frame;
+    EXPECT_TRUE(bench.AllComputedIn(computed)) << "frame " << frame;
+    EXPECT_TRUE(bench.SameBeams(frame, 2)) << "frame " << frame;
+  }
+
+  // A block held by another frame is computed without the bookkeeping, so
+  // the next frame can not reuse its beamweights
+  const size_t held_frame = 3 + max_frames;
+  for (size_t frame = held_frame; frame <= held_frame + 1; frame++) {
+    for (size_t ue = 0; ue < num_ues; ue++) {
+      bench.CopyCsi(frame, ue, 2, ue, 1.0f);
+    }
+  }
+  for (auto& state : bench.reuse_state_) {
+    state.busy_ = true;
+  }
+  bench.RunFrame(held_frame);
+  EXPECT_TRUE(bench.AllComputedIn(2 + max_frames));
+  for (auto& state : bench.reuse_state_) {
+    EXPECT_EQ(state.written_frame_, 2 + max_frames);
+    state.busy_ = false;
+  }
+  bench.RunFrame(held_frame + 1);
+  EXPECT_TRUE(bench.AllComputedIn(held_frame + 1));
+}
+
+/// The beamweights of other UEs are not reused, even for the same CSI
+TEST(TestZF, BeamReuseNewUes) {
+  BeamReuseBench bench("files/config/ci/tddconfig-sim-ul-beam-reuse-pf.json");
+  ASSERT_FALSE(bench.mac_sched_->RotatesGroups());
+  bench.RunFrame(0);
+  EXPECT_TRUE(bench.AllComputedIn(0));
+
+  // The proportional-fair schedule gives frame 1 to the other UEs. Their
+  // CSI, by spatial stream, is that of frame 0.
+  bench.mac_sched_->ScheduleFrame(1);
+  const ScheduleSnapshot& frame_0 = bench.mac_sched_->Schedule(0);
+  const ScheduleSnapshot& frame_1 = bench.mac_sched_->Schedule(1);
+  ASSERT_FALSE(std::equal(
+      frame_0.ue_list_.begin(),
+      frame_0.ue_list_.begin() + bench.cfg_->SpatialStreamsNum(),
+      frame_1.ue_list_.begin()));
+  for (size_t i = 0; i < bench.cfg_->SpatialStreamsNum(); i++) {
+    bench.CopyCsi(1, frame_1.ue_list_.at(i), 0, frame_0.ue_list_.at(i),
+                  1.0f);
+  }
+  bench.RunFrame(1);
+  EXPECT_TRUE(bench.AllComputedIn(1));
+}
+
+/// Beamweights predicted ahead of a frame from linearly varying CSI
+TEST(TestZF, BeamPrediction) {
+  BeamReuseBench bench("files/config/ci/tddconfig-sim-ul-beam-reuse.json");
+  const size_t num_frames = bench.cfg_->BeamPredictionFrames();
+  const size_t mat_size =
+      bench.cfg_->BsAntNum() * bench.cfg_->SpatialStreamsNum();
+  ASSERT_GE(num_frames, 2u);
+  // The random CSI of the last slots of the window are the base, the drift
+  // and the measurement noise of the frames
+  const size_t base = bench.cfg_->FrameWindow() - 1;
+  const size_t drift = base - 1;
+  const size_t noise = base - 2;
+  // A drift well above beam_reuse_threshold per frame, so that the
+  // beamweights are not reused
+  static constexpr float kSlope = 0.3f;
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    bench.LinearCsi(frame, base, drift, kSlope, noise, 0.0f);
+    bench.RunFrame(frame);
+    EXPECT_TRUE(bench.AllComputedIn(frame));
+  }
+
+  // Not before the master has scheduled the frame
+  EXPECT_EQ(bench.PredictAll(), 0u);
+  bench.mac_sched_->ScheduleFrame(num_frames);
+  EXPECT_EQ(bench.PredictAll(), bench.cfg_->BeamEventsPerSymbol());
+  EXPECT_EQ(bench.PredictAll(), 0u);
+
+  // The measured CSI is on the line up to a small noise, so the prediction
+  // hits
+  bench.LinearCsi(num_frames, base, drift, kSlope, noise, 1e-3f);
+  bench.RunFrame(num_frames);
+  EXPECT_TRUE(bench.AllComputedIn(num_frames));
+  ASSERT_EQ(bench.NumPredictedBeams(num_frames), bench.NumBeamScs());
+  std::vector<complex_float> predicted(bench.NumBeamScs() * mat_size);
+  size_t beam_idx = 0;
+  bench.ForEachBeamSc([&](size_t, size_t sc, size_t) {
+    std::memcpy(&predicted.at(beam_idx * mat_size),
+                bench.ul_beams_[num_frames][sc],
+                mat_size * sizeof(complex_float));
+    beam_idx++;
+  });
+
+  // They are within the threshold of the beamweights of the measured CSI,
+  // computed once the prediction and the previous frame are forgotten
+  for (auto& state : bench.reuse_state_) {
+    state.predicted_frame_ = SIZE_MAX;
+    state.written_frame_ = SIZE_MAX;
+  }
+  bench.RunFrame(num_frames);
+  EXPECT_EQ(bench.NumPredictedBeams(num_frames), 0u);
+  beam_idx = 0;
+  bench.ForEachBeamSc([&](size_t, size_t sc, size_t) {
+    const complex_float* measured = bench.ul_beams_[num_frames][sc];
+    float diff_energy = 0;
+    float energy = 0;
+    for (size_t i = 0; i < mat_size; i++) {
+      const complex_float& pred = predicted.at(beam_idx * mat_size + i);
+      const float diff_re = pred.re - measured[i].re;
+      const float diff_im = pred.im - measured[i].im;
+      diff_energy += diff_re * diff_re + diff_im * diff_im;
+      energy += measured[i].re * measured[i].re +
+                measured[i].im * measured[i].im;
+    }
+    const float threshold = bench.cfg_->BeamReuseThreshold();
+    EXPECT_LE(diff_energy, threshold * threshold * energy) << "sc " << sc;
+    beam_idx++;
+  });
+}
+
+/// A prediction for other UEs than those of the frame misses
+TEST(TestZF, BeamPredictionNewUes) {
+  BeamReuseBench bench("files/config/ci/tddconfig-sim-ul-beam-reuse-pf.json");
+  const size_t num_frames = bench.cfg_->BeamPredictionFrames();
+  const size_t base = bench.cfg_->FrameWindow() - 1;
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    bench.LinearCsi(frame, base, base - 1, 0.3f, base - 2, 0.0f);
+    bench.RunFrame(frame);
+  }
+  bench.mac_sched_->ScheduleFrame(num_frames);
+  ASSERT_EQ(bench.PredictAll(), bench.cfg_->BeamEventsPerSymbol());
+  bench.LinearCsi(num_frames, base, base - 1, 0.3f, base - 2, 1e-3f);
+
+  // The prediction matches the CSI of the frame, but it is taken as one for
+  // the UEs of the previous frame, which the proportional-fair schedule
+  // gave the other streams
+  const auto& prev_ue_list =
+      bench.mac_sched_->Schedule(num_frames - 1).ue_list_;
+  for (auto& state : bench.reuse_state_) {
+    ASSERT_NE(state.predicted_ue_list_.at(0), prev_ue_list.at(0));
+    state.predicted_ue_list_ = prev_ue_list;
+  }
+  bench.RunFrame(num_frames);
+  EXPECT_TRUE(bench.AllComputedIn(num_frames));
+  EXPECT_EQ(bench.NumPredictedBeams(num_frames), 0u);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
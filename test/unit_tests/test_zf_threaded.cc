@@ -71,10 +71,15 @@ void MasterToWorkerDynamicWorker(
     // Wait
   }
 
+  // Beamweight reuse is disabled in this config
+  Table<complex_float> beam_ref_csi_buffer;
+  std::vector<BeamReuseState> beam_reuse_state;
+
   auto compute_beam = std::make_unique<DoBeamWeights>(
       cfg, worker_id, csi_buffers, calib_dl_buffer, calib_ul_buffer,
       calib_dl_msum_buffer, calib_ul_msum_buffer, calib_buffer,
-      ul_beam_matrices, dl_beam_matrices, mac_sched, phy_stats, stats);
+      ul_beam_matrices, dl_beam_matrices, beam_ref_csi_buffer,
+      beam_reuse_state, mac_sched, phy_stats, stats);
 
   size_t start_tsc = GetTime::Rdtsc();
   size_t num_tasks = 0;
@@ -0,0 +1,61 @@
+#!/usr/bin/python3
+"""
+ agora_py_example.py
+ Runs the uplink doers of Agora through the agora_py module (built with
+ -DPYTHON_BINDINGS=True), and times a NumPy zero-forcing prototype of the
+ beamweights against DoBeamWeights on the same CSI.
+
+ Usage: PYTHONPATH=build agora_py_example.py [config.json]
+"""
+
+import sys
+import time
+import numpy as np
+import agora_py
+
+
+def print_timing(session, stage, cycles):
+    us = cycles / (session.freq_ghz * 1e3)
+    print('%-7s %5d tasks: median %8.2f us, max %8.2f us' %
+          (stage, len(us), np.median(us), us.max()))
+
+
+def zf_beams(session, frame_id):
+    """
+    Zero-forcing beamweights of every subcarrier from the CSI views,
+    [subcarrier][antenna][stream] as ul_beam_matrices() holds them
+    """
+    num_scs = session.ofdm_data_num
+    index = np.array([[session.tile_index(sc, ant)
+                       for ant in range(session.bs_ant_num)]
+                      for sc in range(num_scs)])
+    # csi[sc][ant][ue]
+    csi = np.stack([session.csi(frame_id, ue)[index]
+                    for ue in range(session.ue_ant_num)], axis=-1)
+    return np.transpose(np.linalg.pinv(csi), (0, 2, 1))
+
+
+def main():
+    conf_file = sys.argv[1] if len(sys.argv) > 1 else \
+        'files/config/ci/tddconfig-sim-ul.json'
+    session = agora_py.Session(conf_file)
+    frame_id = 0
+    for stage in ['fft', 'beam', 'demul', 'decode']:
+        print_timing(session, stage,
+                     session.launch(stage, session.tags(stage, frame_id)))
+
+    start = time.perf_counter()
+    beams = zf_beams(session, frame_id)
+    numpy_us = (time.perf_counter() - start) * 1e6
+    beam_cycles = session.launch('beam', session.tags('beam', frame_id))
+    agora_us = beam_cycles.sum() / (session.freq_ghz * 1e3)
+    # A view, so it holds what the beam tasks just wrote
+    agora_beams = session.ul_beam_matrices(frame_id)
+    error = np.linalg.norm(beams - agora_beams) / np.linalg.norm(agora_beams)
+    # Only close if the config's beamforming_algo is zero-forcing
+    print('Beamweights: NumPy %.1f us, DoBeamWeights %.1f us, relative '
+          'difference %.2e' % (numpy_us, agora_us, error))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,90 @@
+#!/usr/bin/python3
+"""
+ frame_log.py
+ Reader of the binary frame log of Agora (frame_log in the config), with a
+ converter to CSV or numpy .npz files.
+
+ Usage: frame_log.py <frame_log.bin> [out.csv | out.npz]
+ Without an output file, prints the mean of every column.
+"""
+
+import sys
+import numpy as np
+
+FILE_MAGIC = b'AGFRLOG1'
+BLOCK_MAGIC = b'BLCK'
+NAME_BYTES = 56
+DTYPES = {0: np.dtype('<u8'), 1: np.dtype('<f4')}
+
+
+def read_frame_log(filename):
+    """
+    Read a frame log into a dict of column name to numpy array, one value
+    per frame. The file is memory mapped, and a block still being written
+    at the end of the file is left out.
+    """
+    data = np.memmap(filename, dtype=np.uint8, mode='r')
+    if bytes(data[0:8]) != FILE_MAGIC:
+        raise ValueError(filename + ' is not a frame log')
+    num_columns = int(data[8:12].view('<u4')[0])
+    pos = 16
+    columns = []
+    for _ in range(num_columns):
+        name = bytes(data[pos:pos + NAME_BYTES]).split(b'\0')[0].decode()
+        col_type = int(data[pos + NAME_BYTES:pos + NAME_BYTES + 4]
+                       .view('<u4')[0])
+        columns.append((name, DTYPES[col_type]))
+        pos += NAME_BYTES + 8
+
+    chunks = {name: [] for name, _ in columns}
+    while pos + 8 <= len(data):
+        if bytes(data[pos:pos + 4]) != BLOCK_MAGIC:
+            raise ValueError('Bad block at offset %d' % pos)
+        num_rows = int(data[pos + 4:pos + 8].view('<u4')[0])
+        block_pos = pos + 8
+        block = {}
+        for name, dtype in columns:
+            num_bytes = num_rows * dtype.itemsize
+            if block_pos + num_bytes > len(data):
+                break
+            block[name] = data[block_pos:block_pos + num_bytes].view(dtype)
+            block_pos += (num_bytes + 7) // 8 * 8
+        if len(block) < num_columns:
+            break
+        for name in block:
+            chunks[name].append(block[name])
+        pos = block_pos
+
+    return {name: (np.concatenate(chunks[name]) if chunks[name]
+                   else np.empty(0, dtype))
+            for name, dtype in columns}
+
+
+def write_csv(log, filename):
+    names = list(log.keys())
+    fmts = ['%d' if log[name].dtype.kind == 'u' else '%.3f'
+            for name in names]
+    table = np.column_stack([log[name].astype(np.float64) for name in names])
+    np.savetxt(filename, table, fmt=fmts, delimiter=',',
+               header=','.join(names), comments='')
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+    log = read_frame_log(sys.argv[1])
+    num_frames = len(next(iter(log.values()), []))
+    if len(sys.argv) < 3:
+        print('%d frames' % num_frames)
+        for name, values in log.items():
+            print('%-32s %.3f' % (name, np.nanmean(values) if len(values)
+                                  else float('nan')))
+    elif sys.argv[2].endswith('.npz'):
+        np.savez(sys.argv[2], **log)
+    else:
+        write_csv(log, sys.argv[2])
+
+
+if __name__ == '__main__':
+    main()